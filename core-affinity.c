@@ -455,3 +455,434 @@ void stress_free_usable_cpus(uint32_t **cpus)
 		free(*cpus);
 	*cpus = NULL;
 }
+
+/*
+ *  --placement policies, instance n of the stressors is pinned
+ *  to the n'th CPU (modulo the number of CPUs) of a topology
+ *  ordered list of the CPUs that stress-ng is allowed to run on
+ */
+static const char * const stress_placement_names[] = {
+	"none",
+	"spread",	/* across NUMA nodes, then LLCs, then cores, SMT last */
+	"compact",	/* fill SMT siblings, cores, LLCs then nodes in order */
+	"smt",		/* one per physical core in order, SMT siblings last */
+	"l3",		/* across LLC domains, then cores, SMT last */
+	"numa",		/* across NUMA nodes, compact within a node, SMT last */
+};
+
+#if defined(HAVE_SCHED_GETAFFINITY) && \
+    defined(HAVE_SCHED_SETAFFINITY) && \
+    defined(HAVE_CPU_SET_T)
+
+typedef struct {
+	uint32_t cpu;		/* CPU number */
+	int32_t node;		/* NUMA node, -1 = unknown */
+	int32_t llc;		/* lowest CPU sharing the LLC, -1 = unknown */
+	int32_t core;		/* lowest SMT thread sibling CPU */
+	uint32_t smt;		/* SMT sibling index within the core */
+	uint32_t node_rank;	/* node index */
+	uint32_t llc_rank;	/* LLC index */
+	uint32_t llc_in_node;	/* LLC index within the node */
+	uint32_t core_in_llc;	/* core index within the LLC */
+	uint32_t core_in_node;	/* core index within the node */
+	uint32_t order;		/* compact order index */
+} stress_placement_topo_t;
+
+static uint32_t *stress_placement_cpus;
+static uint32_t stress_placement_n_cpus;
+static stress_placement_policy_t stress_placement_sort_policy;
+
+/*
+ *  stress_placement_first_cpu()
+ *	read a sysfs CPU list and return the lowest CPU, -1 if not readable
+ */
+static int32_t stress_placement_first_cpu(const char *filename)
+{
+	char buf[4096];
+	int cpu;
+
+	if (stress_system_read(filename, buf, sizeof(buf)) < 1)
+		return -1;
+	if (sscanf(buf, "%d", &cpu) != 1)
+		return -1;
+	return (int32_t)cpu;
+}
+
+/*
+ *  stress_placement_node()
+ *	find the NUMA node of a CPU from its sysfs nodeN link
+ */
+static int32_t stress_placement_node(const uint32_t cpu)
+{
+	char path[PATH_MAX];
+	DIR *dir;
+	const struct dirent *d;
+	int32_t node = -1;
+
+	(void)snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%" PRIu32, cpu);
+	dir = opendir(path);
+	if (!dir)
+		return -1;
+	while ((d = readdir(dir)) != NULL) {
+		int n;
+
+		if (strncmp(d->d_name, "node", 4) || !isdigit((unsigned char)d->d_name[4]))
+			continue;
+		if (sscanf(d->d_name + 4, "%d", &n) == 1) {
+			node = (int32_t)n;
+			break;
+		}
+	}
+	(void)closedir(dir);
+
+	return node;
+}
+
+/*
+ *  stress_placement_llc()
+ *	find the lowest CPU that shares the highest level cache with cpu
+ */
+static int32_t stress_placement_llc(const uint32_t cpu)
+{
+	int32_t llc = -1;
+	int level_max = 0;
+	int i;
+
+	for (i = 0; i < 16; i++) {
+		char filename[PATH_MAX];
+		char buf[32];
+		int level;
+
+		(void)snprintf(filename, sizeof(filename),
+			"/sys/devices/system/cpu/cpu%" PRIu32 "/cache/index%d/level", cpu, i);
+		if (stress_system_read(filename, buf, sizeof(buf)) < 1)
+			break;
+		if ((sscanf(buf, "%d", &level) != 1) || (level < level_max))
+			continue;
+		(void)snprintf(filename, sizeof(filename),
+			"/sys/devices/system/cpu/cpu%" PRIu32 "/cache/index%d/shared_cpu_list", cpu, i);
+		level_max = level;
+		llc = stress_placement_first_cpu(filename);
+	}
+	return llc;
+}
+
+/*
+ *  stress_placement_cmp_compact()
+ *	sort by node, LLC, core and SMT sibling
+ */
+static int stress_placement_cmp_compact(const void *p1, const void *p2)
+{
+	const stress_placement_topo_t *t1 = (const stress_placement_topo_t *)p1;
+	const stress_placement_topo_t *t2 = (const stress_placement_topo_t *)p2;
+
+	if (t1->node != t2->node)
+		return (t1->node < t2->node) ? -1 : 1;
+	if (t1->llc != t2->llc)
+		return (t1->llc < t2->llc) ? -1 : 1;
+	if (t1->core != t2->core)
+		return (t1->core < t2->core) ? -1 : 1;
+	if (t1->cpu != t2->cpu)
+		return (t1->cpu < t2->cpu) ? -1 : 1;
+	return 0;
+}
+
+/*
+ *  stress_placement_cmp_keys()
+ *	compare topology ranks x, y, z then fall back to compact order
+ */
+static inline int stress_placement_cmp_keys(
+	const uint32_t x1, const uint32_t y1, const uint32_t z1, const uint32_t order1,
+	const uint32_t x2, const uint32_t y2, const uint32_t z2, const uint32_t order2)
+{
+	if (x1 != x2)
+		return (x1 < x2) ? -1 : 1;
+	if (y1 != y2)
+		return (y1 < y2) ? -1 : 1;
+	if (z1 != z2)
+		return (z1 < z2) ? -1 : 1;
+	if (order1 != order2)
+		return (order1 < order2) ? -1 : 1;
+	return 0;
+}
+
+/*
+ *  stress_placement_cmp()
+ *	sort by the placement policy, SMT siblings are used
+ *	last by all policies apart from compact
+ */
+static int stress_placement_cmp(const void *p1, const void *p2)
+{
+	const stress_placement_topo_t *t1 = (const stress_placement_topo_t *)p1;
+	const stress_placement_topo_t *t2 = (const stress_placement_topo_t *)p2;
+
+	if ((stress_placement_sort_policy != STRESS_PLACEMENT_COMPACT) &&
+	    (t1->smt != t2->smt))
+		return (t1->smt < t2->smt) ? -1 : 1;
+
+	switch (stress_placement_sort_policy) {
+	case STRESS_PLACEMENT_SPREAD:
+		return stress_placement_cmp_keys(
+			t1->core_in_llc, t1->llc_in_node, t1->node_rank, t1->order,
+			t2->core_in_llc, t2->llc_in_node, t2->node_rank, t2->order);
+	case STRESS_PLACEMENT_L3:
+		return stress_placement_cmp_keys(
+			t1->core_in_llc, t1->llc_rank, 0, t1->order,
+			t2->core_in_llc, t2->llc_rank, 0, t2->order);
+	case STRESS_PLACEMENT_NUMA:
+		return stress_placement_cmp_keys(
+			t1->core_in_node, t1->node_rank, 0, t1->order,
+			t2->core_in_node, t2->node_rank, 0, t2->order);
+	default:
+		break;
+	}
+	return stress_placement_cmp_keys(
+		0, 0, 0, t1->order,
+		0, 0, 0, t2->order);
+}
+
+/*
+ *  stress_placement_init()
+ *	build the ordered CPU list for a placement policy from
+ *	the CPU affinity mask, returns number of CPUs, 0 on failure
+ */
+uint32_t stress_placement_init(const stress_placement_policy_t policy)
+{
+	cpu_set_t mask;
+	stress_placement_topo_t *topo;
+	uint32_t i, n = 0;
+	uint32_t node_rank = 0, llc_rank = 0, llc_in_node = 0;
+	uint32_t core_in_llc = 0, core_in_node = 0;
+
+	stress_placement_deinit();
+	if ((policy <= STRESS_PLACEMENT_NONE) || (policy >= STRESS_PLACEMENT_MAX))
+		return 0;
+	if (sched_getaffinity(0, sizeof(mask), &mask) < 0)
+		return 0;
+
+	topo = (stress_placement_topo_t *)calloc((size_t)CPU_COUNT(&mask), sizeof(*topo));
+	if (!topo)
+		return 0;
+	stress_placement_cpus = (uint32_t *)calloc((size_t)CPU_COUNT(&mask), sizeof(*stress_placement_cpus));
+	if (!stress_placement_cpus) {
+		free(topo);
+		return 0;
+	}
+
+	for (i = 0; (i < CPU_SETSIZE) && (n < (uint32_t)CPU_COUNT(&mask)); i++) {
+		char filename[PATH_MAX];
+
+		if (!CPU_ISSET((int)i, &mask))
+			continue;
+		(void)snprintf(filename, sizeof(filename),
+			"/sys/devices/system/cpu/cpu%" PRIu32 "/topology/thread_siblings_list", i);
+		topo[n].cpu = i;
+		topo[n].node = stress_placement_node(i);
+		topo[n].llc = stress_placement_llc(i);
+		topo[n].core = stress_placement_first_cpu(filename);
+		if (topo[n].core < 0)
+			topo[n].core = (int32_t)i;
+		n++;
+	}
+
+	/* rank the nodes, LLCs, cores and SMT siblings in compact order */
+	qsort(topo, (size_t)n, sizeof(*topo), stress_placement_cmp_compact);
+	for (i = 0; i < n; i++) {
+		const bool new_node = (i == 0) || (topo[i].node != topo[i - 1].node);
+		const bool new_llc = new_node || (topo[i].llc != topo[i - 1].llc);
+		const bool new_core = new_llc || (topo[i].core != topo[i - 1].core);
+
+		if (i > 0) {
+			if (new_node) {
+				node_rank++;
+				llc_in_node = 0;
+				core_in_node = 0;
+			} else if (new_llc) {
+				llc_in_node++;
+			}
+			if (new_llc) {
+				llc_rank++;
+				core_in_llc = 0;
+			} else if (new_core) {
+				core_in_llc++;
+			}
+			if (new_core && !new_node)
+				core_in_node++;
+		}
+		topo[i].smt = new_core ? 0 : topo[i - 1].smt + 1;
+		topo[i].node_rank = node_rank;
+		topo[i].llc_rank = llc_rank;
+		topo[i].llc_in_node = llc_in_node;
+		topo[i].core_in_llc = core_in_llc;
+		topo[i].core_in_node = core_in_node;
+		topo[i].order = i;
+	}
+
+	stress_placement_sort_policy = policy;
+	qsort(topo, (size_t)n, sizeof(*topo), stress_placement_cmp);
+	for (i = 0; i < n; i++)
+		stress_placement_cpus[i] = topo[i].cpu;
+	stress_placement_n_cpus = n;
+	free(topo);
+
+	return n;
+}
+
+/*
+ *  stress_placement_deinit()
+ *	free the placement CPU list
+ */
+void stress_placement_deinit(void)
+{
+	free(stress_placement_cpus);
+	stress_placement_cpus = NULL;
+	stress_placement_n_cpus = 0;
+}
+
+/*
+ *  stress_placement_cpu()
+ *	return the CPU that instance n is placed on, -1 if no placement
+ */
+int32_t stress_placement_cpu(const uint32_t n)
+{
+	if (!stress_placement_n_cpus)
+		return -1;
+	return (int32_t)stress_placement_cpus[n % stress_placement_n_cpus];
+}
+
+/*
+ *  stress_placement_set()
+ *	pin the calling process (or thread on Linux) to
+ *	placement CPU cpu, -1 = not placed
+ */
+void stress_placement_set(const int32_t cpu)
+{
+	cpu_set_t mask;
+
+	if (cpu < 0)
+		return;
+	CPU_ZERO(&mask);
+	CPU_SET((int)cpu, &mask);
+	if (sched_setaffinity(0, sizeof(mask), &mask) < 0)
+		pr_dbg("placement: cannot set CPU affinity to CPU %" PRId32 ", errno=%d (%s)\n",
+			cpu, errno, strerror(errno));
+}
+
+/*
+ *  stress_cpu_distance()
+ *	classify how far apart two CPUs are in the topology
+ */
+stress_cpu_distance_t stress_cpu_distance(const int32_t cpu1, const int32_t cpu2)
+{
+	char filename[PATH_MAX];
+	int32_t core1, core2, llc1, llc2, node1, node2;
+
+	if ((cpu1 < 0) || (cpu2 < 0))
+		return STRESS_CPU_DISTANCE_UNKNOWN;
+	if (cpu1 == cpu2)
+		return STRESS_CPU_DISTANCE_SAME;
+
+	(void)snprintf(filename, sizeof(filename),
+		"/sys/devices/system/cpu/cpu%" PRId32 "/topology/thread_siblings_list", cpu1);
+	core1 = stress_placement_first_cpu(filename);
+	(void)snprintf(filename, sizeof(filename),
+		"/sys/devices/system/cpu/cpu%" PRId32 "/topology/thread_siblings_list", cpu2);
+	core2 = stress_placement_first_cpu(filename);
+	if ((core1 >= 0) && (core1 == core2))
+		return STRESS_CPU_DISTANCE_SMT;
+
+	llc1 = stress_placement_llc((uint32_t)cpu1);
+	llc2 = stress_placement_llc((uint32_t)cpu2);
+	if ((llc1 >= 0) && (llc1 == llc2))
+		return STRESS_CPU_DISTANCE_LLC;
+
+	node1 = stress_placement_node((uint32_t)cpu1);
+	node2 = stress_placement_node((uint32_t)cpu2);
+	if ((node1 < 0) || (node2 < 0))
+		return STRESS_CPU_DISTANCE_UNKNOWN;
+	return (node1 == node2) ? STRESS_CPU_DISTANCE_NODE : STRESS_CPU_DISTANCE_REMOTE;
+}
+#else
+uint32_t stress_placement_init(const stress_placement_policy_t policy)
+{
+	(void)policy;
+
+	return 0;
+}
+
+void stress_placement_deinit(void)
+{
+}
+
+int32_t PURE stress_placement_cpu(const uint32_t n)
+{
+	(void)n;
+
+	return -1;
+}
+
+void stress_placement_set(const int32_t cpu)
+{
+	(void)cpu;
+}
+
+stress_cpu_distance_t stress_cpu_distance(const int32_t cpu1, const int32_t cpu2)
+{
+	if ((cpu1 >= 0) && (cpu1 == cpu2))
+		return STRESS_CPU_DISTANCE_SAME;
+	return STRESS_CPU_DISTANCE_UNKNOWN;
+}
+#endif
+
+/*
+ *  stress_cpu_distance_name()
+ *	return the name of a CPU topology distance
+ */
+const char *stress_cpu_distance_name(const stress_cpu_distance_t distance)
+{
+	static const char * const names[] = {
+		"same cpu",
+		"smt sibling",
+		"shared llc",
+		"same node",
+		"remote node",
+		"unknown",
+	};
+
+	if ((size_t)distance >= SIZEOF_ARRAY(names))
+		return "unknown";
+	return names[distance];
+}
+
+/*
+ *  stress_placement_name()
+ *	return the name of a placement policy
+ */
+const char *stress_placement_name(const stress_placement_policy_t policy)
+{
+	if ((size_t)policy >= SIZEOF_ARRAY(stress_placement_names))
+		return "unknown";
+	return stress_placement_names[policy];
+}
+
+/*
+ *  stress_placement_parse()
+ *	parse a --placement policy name, exits on an invalid name
+ */
+stress_placement_policy_t stress_placement_parse(const char *arg)
+{
+	size_t i;
+
+	for (i = 0; i < SIZEOF_ARRAY(stress_placement_names); i++) {
+		if (!strcmp(arg, stress_placement_names[i]))
+			return (stress_placement_policy_t)i;
+	}
+	if (strcmp("which", arg))
+		(void)fprintf(stderr, "Invalid placement option: %s\n", arg);
+
+	(void)fprintf(stderr, "Available options are:");
+	for (i = 1; i < SIZEOF_ARRAY(stress_placement_names); i++)
+		(void)fprintf(stderr, " %s", stress_placement_names[i]);
+	(void)fprintf(stderr, "\n");
+	_exit(EXIT_FAILURE);
+}
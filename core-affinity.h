@@ -31,4 +31,35 @@ extern int stress_parse_cpu_affinity(const char *arg, cpu_set_t *set, int *setbi
 extern WARN_UNUSED uint32_t stress_get_usable_cpus(uint32_t **cpus, const bool use_affinity);
 extern void stress_free_usable_cpus(uint32_t **cpus);
 
+/* --placement policies */
+typedef enum {
+	STRESS_PLACEMENT_NONE = 0,
+	STRESS_PLACEMENT_SPREAD,
+	STRESS_PLACEMENT_COMPACT,
+	STRESS_PLACEMENT_SMT,
+	STRESS_PLACEMENT_L3,
+	STRESS_PLACEMENT_NUMA,
+	STRESS_PLACEMENT_MAX,
+} stress_placement_policy_t;
+
+extern stress_placement_policy_t stress_placement_parse(const char *arg);
+extern const char *stress_placement_name(const stress_placement_policy_t policy);
+extern uint32_t stress_placement_init(const stress_placement_policy_t policy);
+extern void stress_placement_deinit(void);
+extern int32_t stress_placement_cpu(const uint32_t n);
+extern void stress_placement_set(const int32_t cpu);
+
+/* topology distance between two CPUs */
+typedef enum {
+	STRESS_CPU_DISTANCE_SAME = 0,	/* the same CPU */
+	STRESS_CPU_DISTANCE_SMT,	/* SMT siblings of one core */
+	STRESS_CPU_DISTANCE_LLC,	/* different cores sharing the LLC */
+	STRESS_CPU_DISTANCE_NODE,	/* same NUMA node, different LLCs */
+	STRESS_CPU_DISTANCE_REMOTE,	/* different NUMA nodes */
+	STRESS_CPU_DISTANCE_UNKNOWN,	/* topology not available */
+} stress_cpu_distance_t;
+
+extern stress_cpu_distance_t stress_cpu_distance(const int32_t cpu1, const int32_t cpu2);
+extern const char *stress_cpu_distance_name(const stress_cpu_distance_t distance);
+
 #endif
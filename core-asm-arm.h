@@ -73,6 +73,20 @@ static inline void ALWAYS_INLINE stress_asm_arm_dmb_sy(void)
 }
 #endif
 
+#if defined(HAVE_ASM_ARM_DSB_SY)
+static inline void ALWAYS_INLINE stress_asm_arm_dsb_sy(void)
+{
+	__asm__ __volatile__("dsb sy;\n" : : : "memory");
+}
+#endif
+
+#if defined(HAVE_ASM_ARM_DC_CVAP)
+static inline void ALWAYS_INLINE stress_asm_arm_dc_cvap(void *p)
+{
+	__asm__ __volatile__("dc cvap, %0\n" : : "r" (p) : "memory");
+}
+#endif
+
 /* #if defined(STRESS_ARCH_ARM) */
 #endif
 
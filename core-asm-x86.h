@@ -208,6 +208,50 @@ static inline uint64_t ALWAYS_INLINE stress_asm_x86_rdseed(void)
 }
 #endif
 
+#if defined(STRESS_ARCH_X86_64) &&	\
+    defined(HAVE_ASM_X86_RDRAND)
+/*
+ *  stress_asm_x86_rdrand_try()
+ *	single rdrand attempt, returns 1 if a random value was
+ *	returned or 0 if the carry flag indicated no data ready
+ */
+static inline int ALWAYS_INLINE stress_asm_x86_rdrand_try(uint64_t *val)
+{
+	uint8_t ok;
+
+	__asm__ __volatile__(
+	"rdrand %0;\n\
+		setc %1;\n"
+	: "=r"(*val), "=qm"(ok)
+	:
+	: "cc");
+
+	return (int)ok;
+}
+#endif
+
+#if defined(STRESS_ARCH_X86_64) &&	\
+    defined(HAVE_ASM_X86_RDSEED)
+/*
+ *  stress_asm_x86_rdseed_try()
+ *	single rdseed attempt, returns 1 if a random value was
+ *	returned or 0 if the carry flag indicated no data ready
+ */
+static inline int ALWAYS_INLINE stress_asm_x86_rdseed_try(uint64_t *val)
+{
+	uint8_t ok;
+
+	__asm__ __volatile__(
+	"rdseed %0;\n\
+		setc %1;\n"
+	: "=r"(*val), "=qm"(ok)
+	:
+	: "cc");
+
+	return (int)ok;
+}
+#endif
+
 /* #if defined(STRESS_ARCH_X86) */
 #endif
 
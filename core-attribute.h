@@ -65,6 +65,16 @@
 #define PACKED
 #endif
 
+/* per thread storage, falls back to per process storage */
+#if defined(HAVE_THREAD_LOCAL) &&					\
+    ((defined(HAVE_COMPILER_GCC_OR_MUSL) && NEED_GNUC(3, 3, 0)) || 	\
+     (defined(HAVE_COMPILER_CLANG) && NEED_CLANG(3, 0, 0)))
+#define STRESS_THREAD_LOCAL	__thread
+#define HAVE_STRESS_THREAD_LOCAL
+#else
+#define STRESS_THREAD_LOCAL
+#endif
+
 #if defined(ALWAYS_INLINE)
 #undef ALWAYS_INLINE
 #endif
@@ -0,0 +1,534 @@
+/*
+ * Copyright (C) 2025      Colin Ian King.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+#include "stress-ng.h"
+#include "core-builtin.h"
+#include "core-cgroup.h"
+
+#define STRESSOR_CGROUP_MAX	(64)	/* maximum --stressor-cgroup controls */
+
+/* a --stressor-cgroup control applied to a stressor's cgroup */
+typedef struct {
+	char	*stressor;		/* stressor name */
+	char	*control;		/* cgroup v2 control file, e.g. cpu.max */
+	char	*value;			/* value written to the control file */
+} stress_stressor_cgroup_t;
+
+/* cgroup v2 control files that can be set */
+static const char * const stressor_cgroup_files[] = {
+	"cpu.max",
+	"cpu.weight",
+	"cpuset.cpus",
+	"cpuset.mems",
+	"io.max",
+	"io.weight",
+	"memory.high",
+	"memory.low",
+	"memory.max",
+	"memory.min",
+	"memory.swap.max",
+	"pids.max",
+};
+
+static stress_stressor_cgroup_t stressor_cgroups[STRESSOR_CGROUP_MAX];
+static size_t stressor_cgroups_n;
+static char stressor_cgroup_parent[PATH_MAX];	/* cgroup stress-ng was started in */
+static char stressor_cgroup_root[PATH_MAX];	/* stress-ng-pid cgroup, empty if not created */
+
+/*
+ *  stress_stressor_cgroup_add()
+ *	parse a --stressor-cgroup STRESSOR:CONTROL=VALUE option, any
+ *	underscores in VALUE are written as spaces so that values
+ *	such as cpu.max quota and period can be used in job files
+ */
+int stress_stressor_cgroup_add(const char *opt)
+{
+	stress_stressor_cgroup_t *cg;
+	char *str, *colon, *equals, *ptr;
+	size_t i;
+
+	if (stressor_cgroups_n >= STRESSOR_CGROUP_MAX) {
+		(void)fprintf(stderr, "stressor-cgroup: too many controls, maximum is %d\n",
+			STRESSOR_CGROUP_MAX);
+		return -1;
+	}
+	str = strdup(opt);
+	if (!str) {
+		(void)fprintf(stderr, "stressor-cgroup: out of memory\n");
+		return -1;
+	}
+	colon = strchr(str, ':');
+	equals = colon ? strchr(colon, '=') : NULL;
+	if (!colon || !equals || (colon == str) || (equals == colon + 1) || !equals[1]) {
+		(void)fprintf(stderr, "stressor-cgroup: invalid option '%s', "
+			"expecting STRESSOR:CONTROL=VALUE\n", opt);
+		free(str);
+		return -1;
+	}
+	*colon = '\0';
+	*equals = '\0';
+	cg = &stressor_cgroups[stressor_cgroups_n];
+	cg->stressor = strdup(str);
+	cg->control = strdup(colon + 1);
+	cg->value = strdup(equals + 1);
+	free(str);
+	if (!cg->stressor || !cg->control || !cg->value) {
+		(void)fprintf(stderr, "stressor-cgroup: out of memory\n");
+		goto err;
+	}
+	for (i = 0; i < SIZEOF_ARRAY(stressor_cgroup_files); i++) {
+		if (!strcmp(cg->control, stressor_cgroup_files[i]))
+			break;
+	}
+	if (i == SIZEOF_ARRAY(stressor_cgroup_files)) {
+		(void)fprintf(stderr, "stressor-cgroup: unsupported control '%s', expecting one of:",
+			cg->control);
+		for (i = 0; i < SIZEOF_ARRAY(stressor_cgroup_files); i++)
+			(void)fprintf(stderr, " %s", stressor_cgroup_files[i]);
+		(void)fprintf(stderr, "\n");
+		goto err;
+	}
+	for (ptr = cg->value; *ptr; ptr++) {
+		if (*ptr == '_')
+			*ptr = ' ';
+	}
+	stressor_cgroups_n++;
+	return 0;
+err:
+	free(cg->stressor);
+	free(cg->control);
+	free(cg->value);
+	(void)shim_memset(cg, 0, sizeof(*cg));
+	return -1;
+}
+
+#if defined(__linux__)
+/*
+ *  stress_stressor_cgroup_mount()
+ *	find the cgroup v2 mount point, returns -1 if not mounted
+ */
+static int stress_stressor_cgroup_mount(char *path, const size_t path_len)
+{
+	FILE *fp;
+	char buf[4096];
+	int ret = -1;
+
+	fp = fopen("/proc/mounts", "r");
+	if (!fp)
+		return -1;
+	while (fgets(buf, sizeof(buf), fp)) {
+		char mnt[PATH_MAX], type[64];
+
+		if (sscanf(buf, "%*s %4095s %63s", mnt, type) != 2)
+			continue;
+		if (!strcmp(type, "cgroup2")) {
+			(void)shim_strscpy(path, mnt, path_len);
+			ret = 0;
+			break;
+		}
+	}
+	(void)fclose(fp);
+	return ret;
+}
+
+/*
+ *  stress_stressor_cgroup_self()
+ *	find the cgroup v2 path of the stress-ng process
+ */
+static int stress_stressor_cgroup_self(char *path, const size_t path_len)
+{
+	FILE *fp;
+	char buf[4096];
+	int ret = -1;
+
+	fp = fopen("/proc/self/cgroup", "r");
+	if (!fp)
+		return -1;
+	while (fgets(buf, sizeof(buf), fp)) {
+		if (strncmp(buf, "0::", 3))
+			continue;
+		buf[strcspn(buf, "\n")] = '\0';
+		(void)shim_strscpy(path, buf + 3, path_len);
+		ret = 0;
+		break;
+	}
+	(void)fclose(fp);
+	return ret;
+}
+
+/*
+ *  stress_stressor_cgroup_write()
+ *	write a string to a cgroup file, returns -errno on failure
+ */
+static ssize_t stress_stressor_cgroup_write(const char *dir, const char *file, const char *str)
+{
+	char filename[PATH_MAX + 64];
+
+	if (snprintf(filename, sizeof(filename), "%s/%s", dir, file) >= (int)sizeof(filename))
+		return -ENAMETOOLONG;
+	return stress_system_write(filename, str, strlen(str));
+}
+
+/*
+ *  stress_stressor_cgroup_move_self()
+ *	move the stress-ng process into cgroup dir
+ */
+static ssize_t stress_stressor_cgroup_move_self(const char *dir)
+{
+	char pid[32];
+
+	(void)snprintf(pid, sizeof(pid), "%" PRIdMAX "\n", (intmax_t)getpid());
+	return stress_stressor_cgroup_write(dir, "cgroup.procs", pid);
+}
+
+/*
+ *  stress_stressor_cgroup_controller()
+ *	enable the controller of a control file in the stress-ng
+ *	cgroup and, if need be, in the cgroup stress-ng started in
+ */
+static ssize_t stress_stressor_cgroup_controller(const char *control)
+{
+	char controller[64], buf[4096], filename[PATH_MAX + 64];
+	ssize_t ret;
+	char *ptr;
+
+	(void)snprintf(controller, sizeof(controller), "+%.*s",
+		(int)strcspn(control, "."), control);
+
+	(void)snprintf(filename, sizeof(filename), "%s/cgroup.subtree_control", stressor_cgroup_root);
+	if (stress_system_read(filename, buf, sizeof(buf)) > 0) {
+		for (ptr = strtok(buf, " \n"); ptr; ptr = strtok(NULL, " \n")) {
+			if (!strcmp(ptr, controller + 1))
+				return 0;
+		}
+	}
+	(void)stress_stressor_cgroup_write(stressor_cgroup_parent, "cgroup.subtree_control", controller);
+	ret = stress_stressor_cgroup_write(stressor_cgroup_root, "cgroup.subtree_control", controller);
+	return (ret < 0) ? ret : 0;
+}
+#endif
+
+/*
+ *  stress_stressor_cgroup_setup()
+ *	create a cgroup v2 child cgroup for each stressor that has
+ *	--stressor-cgroup controls and apply the controls, stress-ng
+ *	itself is moved into a leaf cgroup so that the controllers
+ *	can be enabled for the stressor cgroups
+ */
+void stress_stressor_cgroup_setup(stress_stressor_t *stressors_list)
+{
+#if defined(__linux__)
+	char mnt[PATH_MAX], self[PATH_MAX], dir[PATH_MAX + 64];
+	size_t i;
+
+	if (!stressor_cgroups_n)
+		return;
+
+	for (i = 0; i < stressor_cgroups_n; i++) {
+		const stress_stressor_t *ss;
+
+		for (ss = stressors_list; ss; ss = ss->next) {
+			if (!ss->ignore.run && !strcmp(ss->stressor->name, stressor_cgroups[i].stressor))
+				break;
+		}
+		if (!ss)
+			pr_inf("stressor-cgroup: stressor %s is not being run, ignoring %s=%s\n",
+				stressor_cgroups[i].stressor, stressor_cgroups[i].control,
+				stressor_cgroups[i].value);
+	}
+
+	if ((stress_stressor_cgroup_mount(mnt, sizeof(mnt)) < 0) ||
+	    (stress_stressor_cgroup_self(self, sizeof(self)) < 0)) {
+		pr_inf("stressor-cgroup: cgroup v2 is not mounted, ignoring --stressor-cgroup options\n");
+		return;
+	}
+	if ((snprintf(stressor_cgroup_parent, sizeof(stressor_cgroup_parent), "%s%s",
+			mnt, strcmp(self, "/") ? self : "") >= (int)sizeof(stressor_cgroup_parent)) ||
+	    (snprintf(stressor_cgroup_root, sizeof(stressor_cgroup_root), "%s/stress-ng-%" PRIdMAX,
+			stressor_cgroup_parent, (intmax_t)getpid()) >= (int)sizeof(stressor_cgroup_root))) {
+		pr_inf("stressor-cgroup: cgroup path too long, ignoring --stressor-cgroup options\n");
+		*stressor_cgroup_root = '\0';
+		return;
+	}
+	if (mkdir(stressor_cgroup_root, S_IRWXU) < 0) {
+		pr_inf("stressor-cgroup: cannot create cgroup %s, errno=%d (%s), "
+			"ignoring --stressor-cgroup options\n",
+			stressor_cgroup_root, errno, strerror(errno));
+		*stressor_cgroup_root = '\0';
+		return;
+	}
+	(void)snprintf(dir, sizeof(dir), "%s/harness", stressor_cgroup_root);
+	if ((mkdir(dir, S_IRWXU) < 0) || (stress_stressor_cgroup_move_self(dir) < 0))
+		pr_dbg("stressor-cgroup: cannot move stress-ng into cgroup %s\n", dir);
+
+	for (i = 0; i < stressor_cgroups_n; i++) {
+		const stress_stressor_cgroup_t *cg = &stressor_cgroups[i];
+		ssize_t ret;
+
+		(void)snprintf(dir, sizeof(dir), "%s/%s", stressor_cgroup_root, cg->stressor);
+		if ((mkdir(dir, S_IRWXU) < 0) && (errno != EEXIST)) {
+			pr_inf("stressor-cgroup: cannot create cgroup %s, errno=%d (%s)\n",
+				dir, errno, strerror(errno));
+			continue;
+		}
+		ret = stress_stressor_cgroup_controller(cg->control);
+		if (ret < 0) {
+			pr_inf("stressor-cgroup: cannot enable the controller for %s, errno=%d (%s), "
+				"ignoring %s:%s=%s\n", cg->control, (int)-ret, strerror((int)-ret),
+				cg->stressor, cg->control, cg->value);
+			continue;
+		}
+		ret = stress_stressor_cgroup_write(dir, cg->control, cg->value);
+		if (ret < 0) {
+			pr_inf("stressor-cgroup: cannot set %s %s to '%s', errno=%d (%s)\n",
+				cg->stressor, cg->control, cg->value, (int)-ret, strerror((int)-ret));
+			continue;
+		}
+		pr_dbg("stressor-cgroup: %s %s set to '%s'\n", cg->stressor, cg->control, cg->value);
+	}
+#else
+	(void)stressors_list;
+
+	if (stressor_cgroups_n)
+		pr_inf("stressor-cgroup: cgroups are not supported on this system, "
+			"ignoring --stressor-cgroup options\n");
+#endif
+}
+
+/*
+ *  stress_stressor_cgroup_join()
+ *	move a stressor process into its stressor cgroup
+ */
+void stress_stressor_cgroup_join(const char *name)
+{
+#if defined(__linux__)
+	char dir[PATH_MAX + 64];
+	size_t i;
+	ssize_t ret;
+
+	if (!*stressor_cgroup_root)
+		return;
+	for (i = 0; i < stressor_cgroups_n; i++) {
+		if (!strcmp(stressor_cgroups[i].stressor, name))
+			break;
+	}
+	if (i == stressor_cgroups_n)
+		return;
+
+	(void)snprintf(dir, sizeof(dir), "%s/%s", stressor_cgroup_root, name);
+	ret = stress_stressor_cgroup_move_self(dir);
+	if (ret < 0)
+		pr_dbg("%s: cannot move into cgroup %s, errno=%d (%s)\n",
+			name, dir, (int)-ret, strerror((int)-ret));
+#else
+	(void)name;
+#endif
+}
+
+/*
+ *  stress_stressor_cgroup_path()
+ *	get the cgroup directory of a stressor, returns false if
+ *	the stressor is not being run in its own cgroup
+ */
+bool stress_stressor_cgroup_path(const char *name, char *path, const size_t path_len)
+{
+	size_t i;
+
+	if (!*stressor_cgroup_root)
+		return false;
+	for (i = 0; i < stressor_cgroups_n; i++) {
+		if (!strcmp(stressor_cgroups[i].stressor, name))
+			break;
+	}
+	if (i == stressor_cgroups_n)
+		return false;
+	return snprintf(path, path_len, "%s/%s", stressor_cgroup_root, name) < (int)path_len;
+}
+
+#if defined(__linux__)
+/*
+ *  stress_stressor_cgroup_keys()
+ *	read a cgroup flat keyed file, the values of keys are summed
+ *	into vals, io.stat per device lines are summed over all devices
+ */
+static bool stress_stressor_cgroup_keys(
+	const char *dir,
+	const char *file,
+	const char * const keys[],
+	uint64_t vals[],
+	const size_t n)
+{
+	char filename[PATH_MAX + 64], buf[4096];
+	char *line, *saveptr = NULL;
+	size_t i;
+
+	for (i = 0; i < n; i++)
+		vals[i] = 0;
+	(void)snprintf(filename, sizeof(filename), "%s/%s", dir, file);
+	if (stress_system_read(filename, buf, sizeof(buf)) <= 0)
+		return false;
+
+	for (line = strtok_r(buf, "\n", &saveptr); line; line = strtok_r(NULL, "\n", &saveptr)) {
+		char *tok, *saveptr2 = NULL;
+
+		for (tok = strtok_r(line, " ", &saveptr2); tok; tok = strtok_r(NULL, " ", &saveptr2)) {
+			const char *eq = strchr(tok, '=');
+
+			for (i = 0; i < n; i++) {
+				const size_t len = strlen(keys[i]);
+
+				if (eq && ((size_t)(eq - tok) == len) && !strncmp(tok, keys[i], len)) {
+					vals[i] += (uint64_t)strtoull(eq + 1, NULL, 10);
+				} else if (!eq && !strcmp(tok, keys[i])) {
+					tok = strtok_r(NULL, " ", &saveptr2);
+					if (tok)
+						vals[i] += (uint64_t)strtoull(tok, NULL, 10);
+					break;
+				}
+			}
+			if (!tok)
+				break;
+		}
+	}
+	return true;
+}
+#endif
+
+/*
+ *  stress_stressor_cgroup_dump()
+ *	report the CPU throttling, memory events and I/O of the
+ *	stressor cgroups
+ */
+void stress_stressor_cgroup_dump(FILE *yaml)
+{
+#if defined(__linux__)
+	static const char * const cpu_keys[] = {
+		"nr_periods", "nr_throttled", "throttled_usec",
+	};
+	static const char * const mem_keys[] = {
+		"low", "high", "max", "oom", "oom_kill",
+	};
+	static const char * const io_keys[] = {
+		"rbytes", "wbytes", "rios", "wios",
+	};
+	bool header = false;
+	size_t i, j;
+
+	if (!*stressor_cgroup_root)
+		return;
+
+	pr_block_begin();
+	for (i = 0; i < stressor_cgroups_n; i++) {
+		const char *name = stressor_cgroups[i].stressor;
+		char dir[PATH_MAX + 64];
+		uint64_t cpu[SIZEOF_ARRAY(cpu_keys)];
+		uint64_t mem[SIZEOF_ARRAY(mem_keys)];
+		uint64_t io[SIZEOF_ARRAY(io_keys)];
+		bool has_cpu, has_mem, has_io;
+
+		/* report each stressor cgroup once */
+		for (j = 0; j < i; j++) {
+			if (!strcmp(stressor_cgroups[j].stressor, name))
+				break;
+		}
+		if (j < i)
+			continue;
+
+		(void)snprintf(dir, sizeof(dir), "%s/%s", stressor_cgroup_root, name);
+		has_cpu = stress_stressor_cgroup_keys(dir, "cpu.stat", cpu_keys, cpu, SIZEOF_ARRAY(cpu));
+		has_mem = stress_stressor_cgroup_keys(dir, "memory.events", mem_keys, mem, SIZEOF_ARRAY(mem));
+		has_io = stress_stressor_cgroup_keys(dir, "io.stat", io_keys, io, SIZEOF_ARRAY(io));
+		if (!has_cpu && !has_mem && !has_io)
+			continue;
+
+		if (!header) {
+			pr_inf("stressor-cgroup: %-13s %10s %10s %8s %8s %8s %10s %10s\n",
+				"stressor", "throttled", "throttled", "mem high", "mem max",
+				"oom kill", "read", "write");
+			pr_inf("stressor-cgroup: %-13s %10s %10s %8s %8s %8s %10s %10s\n",
+				"", "periods", "(secs)", "events", "events", "", "(MB)", "(MB)");
+			pr_yaml(yaml, "stressor-cgroup:\n");
+			header = true;
+		}
+		pr_inf("stressor-cgroup: %-13s %10" PRIu64 " %10.2f %8" PRIu64 " %8" PRIu64
+			" %8" PRIu64 " %10.2f %10.2f\n", name,
+			cpu[1], (double)cpu[2] / STRESS_DBL_MICROSECOND,
+			mem[1], mem[2], mem[4],
+			(double)io[0] / (double)MB, (double)io[1] / (double)MB);
+
+		pr_yaml(yaml, "    - stressor: %s\n", name);
+		for (j = i; j < stressor_cgroups_n; j++) {
+			if (!strcmp(stressor_cgroups[j].stressor, name))
+				pr_yaml(yaml, "      %s: '%s'\n", stressor_cgroups[j].control,
+					stressor_cgroups[j].value);
+		}
+		if (has_cpu) {
+			for (j = 0; j < SIZEOF_ARRAY(cpu_keys); j++)
+				pr_yaml(yaml, "      cpu-%s: %" PRIu64 "\n", cpu_keys[j], cpu[j]);
+		}
+		if (has_mem) {
+			for (j = 0; j < SIZEOF_ARRAY(mem_keys); j++)
+				pr_yaml(yaml, "      memory-events-%s: %" PRIu64 "\n", mem_keys[j], mem[j]);
+		}
+		if (has_io) {
+			for (j = 0; j < SIZEOF_ARRAY(io_keys); j++)
+				pr_yaml(yaml, "      io-%s: %" PRIu64 "\n", io_keys[j], io[j]);
+		}
+	}
+	if (header)
+		pr_yaml(yaml, "\n");
+	pr_block_end();
+#else
+	(void)yaml;
+#endif
+}
+
+/*
+ *  stress_stressor_cgroup_cleanup()
+ *	move stress-ng back to the cgroup it started in and
+ *	remove the stressor cgroups
+ */
+void stress_stressor_cgroup_cleanup(void)
+{
+	size_t i;
+
+#if defined(__linux__)
+	if (*stressor_cgroup_root) {
+		char dir[PATH_MAX + 64];
+
+		(void)stress_stressor_cgroup_move_self(stressor_cgroup_parent);
+		for (i = 0; i < stressor_cgroups_n; i++) {
+			(void)snprintf(dir, sizeof(dir), "%s/%s", stressor_cgroup_root,
+				stressor_cgroups[i].stressor);
+			(void)shim_rmdir(dir);
+		}
+		(void)snprintf(dir, sizeof(dir), "%s/harness", stressor_cgroup_root);
+		(void)shim_rmdir(dir);
+		if (shim_rmdir(stressor_cgroup_root) < 0)
+			pr_dbg("stressor-cgroup: cannot remove cgroup %s, errno=%d (%s)\n",
+				stressor_cgroup_root, errno, strerror(errno));
+		*stressor_cgroup_root = '\0';
+	}
+#endif
+	for (i = 0; i < stressor_cgroups_n; i++) {
+		free(stressor_cgroups[i].stressor);
+		free(stressor_cgroups[i].control);
+		free(stressor_cgroups[i].value);
+	}
+	stressor_cgroups_n = 0;
+}
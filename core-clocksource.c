@@ -76,3 +76,78 @@ void stress_clocksource_check(void)
 	(void)closedir(dir);
 #endif
 }
+
+#if defined(__linux__)
+/*
+ *  stress_clocksource_read()
+ *	read clocksource0 attribute into buf, stripping the
+ *	trailing white space, returns 0 or -errno
+ */
+static int stress_clocksource_read(const char *attr, char *buf, const size_t len)
+{
+	char path[PATH_MAX];
+	ssize_t ret;
+
+	(void)snprintf(path, sizeof(path),
+		"/sys/devices/system/clocksource/clocksource0/%s", attr);
+	ret = stress_system_read(path, buf, len);
+	if (ret < 0)
+		return (int)ret;
+	while ((ret > 0) && isspace((unsigned char)buf[ret - 1]))
+		buf[--ret] = '\0';
+	return 0;
+}
+#endif
+
+/*
+ *  stress_clocksource_get()
+ *	get the name of the current clocksource, returns 0 or -errno
+ */
+int stress_clocksource_get(char *buf, const size_t len)
+{
+#if defined(__linux__)
+	return stress_clocksource_read("current_clocksource", buf, len);
+#else
+	(void)buf;
+	(void)len;
+
+	return -ENOSYS;
+#endif
+}
+
+/*
+ *  stress_clocksource_available()
+ *	get the space separated names of the available
+ *	clocksources, returns 0 or -errno
+ */
+int stress_clocksource_available(char *buf, const size_t len)
+{
+#if defined(__linux__)
+	return stress_clocksource_read("available_clocksource", buf, len);
+#else
+	(void)buf;
+	(void)len;
+
+	return -ENOSYS;
+#endif
+}
+
+/*
+ *  stress_clocksource_set()
+ *	switch the system clocksource, needs root,
+ *	returns 0 or -errno
+ */
+int stress_clocksource_set(const char *name)
+{
+#if defined(__linux__)
+	const ssize_t ret = stress_system_write(
+		"/sys/devices/system/clocksource/clocksource0/current_clocksource",
+		name, strlen(name));
+
+	return (ret < 0) ? (int)ret : 0;
+#else
+	(void)name;
+
+	return -ENOSYS;
+#endif
+}
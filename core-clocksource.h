@@ -20,5 +20,8 @@
 #define CORE_CLOCKSOURCE_H
 
 extern void stress_clocksource_check(void);
+extern int stress_clocksource_get(char *buf, const size_t len);
+extern int stress_clocksource_available(char *buf, const size_t len);
+extern int stress_clocksource_set(const char *name);
 
 #endif
@@ -0,0 +1,1057 @@
+/*
+ * Copyright (C) 2025      Colin Ian King.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+#include "stress-ng.h"
+#include "core-builtin.h"
+#include "core-cluster.h"
+#include "core-job.h"
+#include "core-net.h"
+
+#include <ctype.h>
+#include <netinet/in.h>
+
+#if defined(HAVE_NETDB_H)
+#include <netdb.h>
+#endif
+
+#if defined(HAVE_POLL_H)
+#include <poll.h>
+#endif
+
+#define CLUSTER_PROTOCOL	"STRESS-NG-CLUSTER 1"
+#define CLUSTER_START_DELAY	(5)		/* seconds from job send to start */
+#define CLUSTER_HOSTS_MAX	(256)		/* maximum --coordinate hosts */
+#define CLUSTER_JOB_MAX		(1 * MB)	/* maximum job file size */
+#define CLUSTER_RESULT_MAX	(64 * MB)	/* maximum YAML result size */
+#define CLUSTER_LINE_MAX	(256)		/* maximum control line length */
+#define CLUSTER_POLL_MS		(1000)
+#define CLUSTER_IO_TIMEOUT	(30)		/* seconds to receive a job */
+#define CLUSTER_TOKEN_MAX	(128)		/* maximum shared secret length */
+
+/* a --coordinate agent host */
+typedef struct {
+	char	addr[CLUSTER_LINE_MAX];	/* HOST:PORT as specified */
+	int	fd;			/* control socket, -1 when closed */
+	char	*buf;			/* RESULT reply and YAML results */
+	size_t	len;			/* bytes in buf */
+	size_t	size;			/* allocated size of buf */
+	int	status;			/* agent stress-ng exit status */
+	char	*yaml;			/* YAML results in buf */
+	size_t	yaml_len;		/* length of YAML results */
+} stress_cluster_host_t;
+
+/*
+ *  run control options a job may use as well as the stressor
+ *  options, anything else may write files or run code as the
+ *  agent so is rejected
+ */
+static const int stress_cluster_job_allowed[] = {
+	OPT_abort,
+	OPT_aggressive,
+	OPT_all,
+	OPT_backoff,
+	OPT_class,
+	OPT_dry_run,
+	OPT_exclude,
+	OPT_instance_threads,
+	OPT_keep_name,
+	OPT_latency,
+	OPT_maximize,
+	OPT_metrics,
+	OPT_metrics_brief,
+	OPT_minimize,
+	OPT_no_madvise,
+	OPT_no_rand_seed,
+	OPT_oom_avoid,
+	OPT_oomable,
+	OPT_page_in,
+	OPT_permute,
+	OPT_progress,
+	OPT_quiet,
+	OPT_random,
+	OPT_seed,
+	OPT_sequential,
+	OPT_skip_silent,
+	OPT_sn,
+	OPT_stressor_time,
+	OPT_sync_start,
+	OPT_taskset,
+	OPT_taskset_random,
+	OPT_timeout,
+	OPT_times,
+	OPT_timestamp,
+	OPT_verbose,
+	OPT_verify,
+	OPT_with,
+};
+
+/* per stressor metrics summed over all the hosts */
+typedef struct {
+	char	stressor[64];		/* stressor name */
+	size_t	hosts;			/* hosts that ran the stressor */
+	uint64_t bogo_ops;		/* total bogo-ops */
+	double	bogo_rate;		/* total real time bogo-ops per second */
+} stress_cluster_metric_t;
+
+/*
+ *  stress_cluster_addr_split()
+ *	split HOST:PORT, [IPV6ADDR]:PORT or PORT into host and
+ *	port strings, the host is empty if just PORT is given
+ */
+static int stress_cluster_addr_split(
+	const char *opt,
+	char *host,
+	const size_t host_len,
+	char *port,
+	const size_t port_len)
+{
+	const char *port_str;
+	char *end;
+	long int val;
+	size_t n;
+
+	if (*opt == '[') {
+		const char *close = strchr(opt, ']');
+
+		if (!close || (close[1] != ':'))
+			return -1;
+		n = (size_t)(close - opt - 1);
+		port_str = close + 2;
+		opt++;
+	} else {
+		const char *colon = strrchr(opt, ':');
+
+		n = colon ? (size_t)(colon - opt) : 0;
+		port_str = colon ? colon + 1 : opt;
+	}
+	if (n >= host_len)
+		return -1;
+	(void)shim_memcpy(host, opt, n);
+	host[n] = '\0';
+
+	errno = 0;
+	val = strtol(port_str, &end, 10);
+	if ((errno != 0) || (end == port_str) || (*end != '\0') ||
+	    (val < 1) || (val > MAX_PORT))
+		return -1;
+	(void)snprintf(port, port_len, "%ld", val);
+	return 0;
+}
+
+/*
+ *  stress_cluster_set_agent()
+ *	parse --agent option
+ */
+int stress_cluster_set_agent(const char *opt)
+{
+	char host[CLUSTER_LINE_MAX], port[16];
+
+	if (stress_cluster_addr_split(opt, host, sizeof(host), port, sizeof(port)) < 0) {
+		(void)fprintf(stderr, "agent: invalid address '%s', "
+			"expecting PORT, ADDR:PORT or [IPV6ADDR]:PORT\n", opt);
+		return -1;
+	}
+	stress_set_setting_global("agent", TYPE_ID_STR, (void *)opt);
+	return 0;
+}
+
+/*
+ *  stress_cluster_set_coordinate()
+ *	parse --coordinate comma separated list of agent hosts
+ */
+int stress_cluster_set_coordinate(const char *opt)
+{
+	const char *ptr = opt;
+	size_t n = 0;
+
+	for (;;) {
+		char addr[CLUSTER_LINE_MAX], host[CLUSTER_LINE_MAX], port[16];
+		const size_t len = strcspn(ptr, ",");
+
+		if ((len == 0) || (len >= sizeof(addr))) {
+			(void)fprintf(stderr, "coordinate: invalid host list '%s'\n", opt);
+			return -1;
+		}
+		(void)shim_memcpy(addr, ptr, len);
+		addr[len] = '\0';
+		if ((stress_cluster_addr_split(addr, host, sizeof(host), port, sizeof(port)) < 0) || !*host) {
+			(void)fprintf(stderr, "coordinate: invalid agent '%s', "
+				"expecting HOST:PORT or [IPV6ADDR]:PORT\n", addr);
+			return -1;
+		}
+		if (++n > CLUSTER_HOSTS_MAX) {
+			(void)fprintf(stderr, "coordinate: too many agents, maximum is %d\n",
+				CLUSTER_HOSTS_MAX);
+			return -1;
+		}
+		if (!ptr[len])
+			break;
+		ptr += len + 1;
+	}
+	stress_set_setting_global("coordinate", TYPE_ID_STR, (void *)opt);
+	return 0;
+}
+
+/*
+ *  stress_cluster_mode()
+ *	return true if stress-ng is running as an agent or coordinator
+ */
+bool stress_cluster_mode(void)
+{
+	char *str = NULL;
+
+	if (stress_get_setting("agent", &str) && str)
+		return true;
+	str = NULL;
+	return stress_get_setting("coordinate", &str) && str;
+}
+
+#if defined(HAVE_NETDB_H) &&	\
+    defined(HAVE_POLL_H)
+/*
+ *  stress_cluster_write_all()
+ *	write all of buf to fd
+ */
+static int stress_cluster_write_all(const int fd, const char *buf, size_t len)
+{
+	while (len > 0) {
+		const ssize_t ret = write(fd, buf, len);
+
+		if (ret < 0) {
+			if (errno == EINTR)
+				continue;
+			return -1;
+		}
+		buf += ret;
+		len -= (size_t)ret;
+	}
+	return 0;
+}
+
+/*
+ *  stress_cluster_read_all()
+ *	read len bytes from fd into buf
+ */
+static int stress_cluster_read_all(const int fd, char *buf, size_t len)
+{
+	while (len > 0) {
+		const ssize_t ret = read(fd, buf, len);
+
+		if (ret < 0) {
+			if (errno == EINTR)
+				continue;
+			return -1;
+		}
+		if (ret == 0)
+			return -1;
+		buf += ret;
+		len -= (size_t)ret;
+	}
+	return 0;
+}
+
+/*
+ *  stress_cluster_recv_all()
+ *	read len bytes from socket fd into buf, fails with
+ *	ETIMEDOUT if the data is not all read by the deadline
+ */
+static int stress_cluster_recv_all(const int fd, char *buf, size_t len, const double deadline)
+{
+	while (len > 0) {
+		struct pollfd pfd;
+		const double remaining = deadline - stress_time_now();
+		ssize_t ret;
+
+		if (remaining <= 0.0) {
+			errno = ETIMEDOUT;
+			return -1;
+		}
+		pfd.fd = fd;
+		pfd.events = POLLIN;
+		pfd.revents = 0;
+		ret = poll(&pfd, 1, (int)(remaining * 1000.0) + 1);
+		if (ret < 0) {
+			if (errno == EINTR)
+				continue;
+			return -1;
+		}
+		if (ret == 0)
+			continue;
+		ret = read(fd, buf, len);
+		if (ret < 0) {
+			if ((errno == EINTR) || (errno == EAGAIN))
+				continue;
+			return -1;
+		}
+		if (ret == 0)
+			return -1;
+		buf += ret;
+		len -= (size_t)ret;
+	}
+	return 0;
+}
+
+/*
+ *  stress_cluster_read_line()
+ *	read a newline terminated control line by the deadline, the
+ *	short control lines are read a byte at a time so no payload
+ *	is consumed
+ */
+static int stress_cluster_read_line(const int fd, char *line, const size_t len, const double deadline)
+{
+	size_t i;
+
+	for (i = 0; i < len - 1; i++) {
+		if (stress_cluster_recv_all(fd, line + i, 1, deadline) < 0)
+			return -1;
+		if (line[i] == '\n') {
+			line[i] = '\0';
+			return 0;
+		}
+	}
+	return -1;
+}
+
+/*
+ *  stress_cluster_file_read()
+ *	read up to max bytes of a file into an allocated buffer
+ */
+static char *stress_cluster_file_read(const char *filename, size_t *len, const size_t max)
+{
+	struct stat statbuf;
+	char *buf;
+	int fd;
+
+	*len = 0;
+	fd = open(filename, O_RDONLY);
+	if (fd < 0)
+		return NULL;
+	if ((fstat(fd, &statbuf) < 0) || (statbuf.st_size < 0) ||
+	    ((size_t)statbuf.st_size > max)) {
+		(void)close(fd);
+		return NULL;
+	}
+	buf = (char *)malloc((size_t)statbuf.st_size + 1);
+	if (!buf) {
+		(void)close(fd);
+		return NULL;
+	}
+	if (stress_cluster_read_all(fd, buf, (size_t)statbuf.st_size) < 0) {
+		free(buf);
+		(void)close(fd);
+		return NULL;
+	}
+	(void)close(fd);
+	buf[statbuf.st_size] = '\0';
+	*len = (size_t)statbuf.st_size;
+	return buf;
+}
+
+/*
+ *  stress_cluster_file_write()
+ *	create a new file containing buf
+ */
+static int stress_cluster_file_write(const char *filename, const char *buf, const size_t len)
+{
+	int fd, ret;
+
+	(void)shim_unlink(filename);
+	fd = open(filename, O_CREAT | O_EXCL | O_WRONLY, S_IRUSR | S_IWUSR);
+	if (fd < 0)
+		return -1;
+	ret = stress_cluster_write_all(fd, buf, len);
+	(void)close(fd);
+	return ret;
+}
+
+/*
+ *  stress_cluster_token()
+ *	read the --cluster-token shared secret from the first line
+ *	of the token file, returns -1 if it is not set or invalid
+ */
+static int stress_cluster_token(const char *who, char *token, const size_t token_len)
+{
+	char *filename = NULL, *buf;
+	size_t len, i;
+
+	if (!stress_get_setting("cluster-token", &filename) || !filename) {
+		pr_err("%s: a --cluster-token shared secret file is required\n", who);
+		return -1;
+	}
+	buf = stress_cluster_file_read(filename, &len, CLUSTER_LINE_MAX);
+	if (!buf) {
+		pr_err("%s: cannot read --cluster-token file %s\n", who, filename);
+		return -1;
+	}
+	len = strcspn(buf, "\r\n");
+	for (i = 0; i < len; i++) {
+		if (!isgraph((int)(unsigned char)buf[i]))
+			break;
+	}
+	if ((len == 0) || (len >= token_len) || (i != len)) {
+		pr_err("%s: --cluster-token file %s must contain a 1 to %zu "
+			"character printable secret\n", who, filename, token_len - 1);
+		free(buf);
+		return -1;
+	}
+	(void)shim_memcpy(token, buf, len);
+	token[len] = '\0';
+	(void)shim_memset(buf, 0, len);
+	free(buf);
+	return 0;
+}
+
+/*
+ *  stress_cluster_token_match()
+ *	compare tokens in a time independent of where they differ
+ */
+static bool stress_cluster_token_match(const char *token, const char *str)
+{
+	const size_t len = strlen(token), str_len = strlen(str);
+	uint8_t diff = (uint8_t)(len != str_len);
+	size_t i;
+
+	for (i = 0; i < len; i++)
+		diff |= (uint8_t)token[i] ^ (uint8_t)((i < str_len) ? str[i] : 0);
+	return diff == 0;
+}
+
+/*
+ *  stress_cluster_job_opt_allowed()
+ *	true if a job may use option opt
+ */
+static bool stress_cluster_job_opt_allowed(const int opt)
+{
+	size_t i;
+
+	for (i = 0; i < SIZEOF_ARRAY(stress_cluster_job_allowed); i++) {
+		if (opt == stress_cluster_job_allowed[i])
+			return true;
+	}
+	return stress_stressor_opt_safe(opt);
+}
+
+/*
+ *  stress_cluster_agent_job()
+ *	receive a job from a coordinator, run it with a stress-ng
+ *	child process started at the coordinator's start time and
+ *	send back the exit status and YAML results. The job has to
+ *	be received by a deadline so idle connections cannot block
+ *	the agent
+ */
+static void stress_cluster_agent_job(const int fd, const char *token)
+{
+	char line[CLUSTER_LINE_MAX], start_str[32];
+	char job_filename[PATH_MAX], yaml_filename[PATH_MAX], exe_path[PATH_MAX];
+	char *job_buf = NULL, *yaml_buf = NULL, *exe;
+	char denied[64];
+	const double deadline = stress_time_now() + CLUSTER_IO_TIMEOUT;
+	uint64_t start_at;
+	size_t job_len, yaml_len = 0;
+	int status, rc;
+	pid_t pid;
+
+	if ((stress_cluster_read_line(fd, line, sizeof(line), deadline) < 0) ||
+	    strcmp(line, CLUSTER_PROTOCOL)) {
+		pr_err("agent: connection is not from a stress-ng coordinator\n");
+		return;
+	}
+	if ((stress_cluster_read_line(fd, line, sizeof(line), deadline) < 0) ||
+	    strncmp(line, "TOKEN ", 6) ||
+	    !stress_cluster_token_match(token, line + 6)) {
+		(void)shim_memset(line, 0, sizeof(line));
+		pr_err("agent: coordinator did not send the --cluster-token secret\n");
+		return;
+	}
+	if ((stress_cluster_read_line(fd, line, sizeof(line), deadline) < 0) ||
+	    (sscanf(line, "START %" SCNu64, &start_at) != 1)) {
+		pr_err("agent: missing coordinator start time\n");
+		return;
+	}
+	if ((stress_cluster_read_line(fd, line, sizeof(line), deadline) < 0) ||
+	    (sscanf(line, "JOB %zu", &job_len) != 1) ||
+	    (job_len < 1) || (job_len > CLUSTER_JOB_MAX)) {
+		pr_err("agent: missing or invalid coordinator job\n");
+		return;
+	}
+	job_buf = (char *)malloc(job_len);
+	if (!job_buf) {
+		pr_err("agent: cannot allocate %zu byte job buffer\n", job_len);
+		return;
+	}
+	if (stress_cluster_recv_all(fd, job_buf, job_len, deadline) < 0) {
+		pr_err("agent: short read of job from coordinator, errno=%d (%s)\n",
+			errno, strerror(errno));
+		free(job_buf);
+		return;
+	}
+	(void)snprintf(job_filename, sizeof(job_filename), "%s/stress-ng-agent-%" PRIdMAX ".job",
+		stress_get_temp_path(), (intmax_t)getpid());
+	(void)snprintf(yaml_filename, sizeof(yaml_filename), "%s/stress-ng-agent-%" PRIdMAX ".yaml",
+		stress_get_temp_path(), (intmax_t)getpid());
+	if (stress_cluster_file_write(job_filename, job_buf, job_len) < 0) {
+		pr_err("agent: cannot write job file %s, errno=%d (%s)\n",
+			job_filename, errno, strerror(errno));
+		free(job_buf);
+		return;
+	}
+	free(job_buf);
+	if (stress_jobfile_check(job_filename, stress_cluster_job_opt_allowed, denied, sizeof(denied)) < 0) {
+		pr_err("agent: rejecting job, option '%s' is not allowed\n", denied);
+		(void)shim_unlink(job_filename);
+		(void)snprintf(line, sizeof(line), "RESULT %d 0\n", EXIT_FAILURE);
+		(void)stress_cluster_write_all(fd, line, strlen(line));
+		return;
+	}
+	(void)shim_unlink(yaml_filename);
+
+	exe = stress_get_proc_self_exe(exe_path, sizeof(exe_path));
+	(void)snprintf(start_str, sizeof(start_str), "%" PRIu64, start_at);
+	pr_inf("agent: running %zu byte job, starting at %s\n", job_len, start_str);
+
+	pid = fork();
+	if (pid < 0) {
+		pr_err("agent: fork failed, errno=%d (%s)\n", errno, strerror(errno));
+		rc = EXIT_FAILURE;
+	} else if (pid == 0) {
+		char *argv[] = {
+			(char *)g_app_name,
+			"--job", job_filename,
+			"--yaml", yaml_filename,
+			"--sync-start-at", start_str,
+			NULL
+		};
+
+		if (exe)
+			(void)execv(exe, argv);
+		else
+			(void)execvp(g_app_name, argv);
+		_exit(EXIT_FAILURE);
+	} else {
+		while (shim_waitpid(pid, &status, 0) < 0) {
+			if (errno != EINTR) {
+				status = 0;
+				break;
+			}
+		}
+		rc = WIFEXITED(status) ? WEXITSTATUS(status) : EXIT_SIGNALED;
+	}
+	yaml_buf = stress_cluster_file_read(yaml_filename, &yaml_len, CLUSTER_RESULT_MAX);
+	(void)shim_unlink(job_filename);
+	(void)shim_unlink(yaml_filename);
+
+	pr_inf("agent: job completed with exit status %d, sending %zu bytes of results\n",
+		rc, yaml_len);
+	(void)snprintf(line, sizeof(line), "RESULT %d %zu\n", rc, yaml_len);
+	if ((stress_cluster_write_all(fd, line, strlen(line)) < 0) ||
+	    (yaml_buf && (stress_cluster_write_all(fd, yaml_buf, yaml_len) < 0)))
+		pr_err("agent: failed to send results to coordinator, errno=%d (%s)\n",
+			errno, strerror(errno));
+	free(yaml_buf);
+}
+
+/*
+ *  stress_cluster_agent()
+ *	wait for jobs from a coordinator on the --agent control socket
+ */
+static int stress_cluster_agent(const char *listen_addr)
+{
+	struct addrinfo hints, *res = NULL;
+	char host[CLUSTER_LINE_MAX], port[16], token[CLUSTER_TOKEN_MAX];
+	int fd, err, so_reuseaddr = 1;
+	struct timeval tv;
+
+	if (stress_cluster_addr_split(listen_addr, host, sizeof(host), port, sizeof(port)) < 0)
+		return EXIT_FAILURE;
+	if (stress_cluster_token("agent", token, sizeof(token)) < 0)
+		return EXIT_FAILURE;
+
+	/*
+	 *  with no address the agent is only bound to the loopback
+	 *  interface, 0.0.0.0:P or [::]:P must be used to explicitly
+	 *  listen on all interfaces
+	 */
+	(void)shim_memset(&hints, 0, sizeof(hints));
+	hints.ai_family = AF_UNSPEC;
+	hints.ai_socktype = SOCK_STREAM;
+	hints.ai_flags = AI_PASSIVE;
+	err = getaddrinfo(*host ? host : "127.0.0.1", port, &hints, &res);
+	if (err || !res) {
+		pr_err("agent: cannot resolve %s: %s\n", listen_addr, gai_strerror(err));
+		return EXIT_FAILURE;
+	}
+	fd = socket(res->ai_family, res->ai_socktype, res->ai_protocol);
+	if (fd < 0) {
+		pr_err("agent: socket failed, errno=%d (%s)\n", errno, strerror(errno));
+		freeaddrinfo(res);
+		return EXIT_FAILURE;
+	}
+	(void)setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &so_reuseaddr, sizeof(so_reuseaddr));
+	(void)fcntl(fd, F_SETFD, FD_CLOEXEC);
+	if (bind(fd, res->ai_addr, res->ai_addrlen) < 0) {
+		pr_err("agent: cannot bind to %s, errno=%d (%s)\n",
+			listen_addr, errno, strerror(errno));
+		freeaddrinfo(res);
+		(void)close(fd);
+		return EXIT_FAILURE;
+	}
+	freeaddrinfo(res);
+	if (listen(fd, 4) < 0) {
+		pr_err("agent: listen on %s failed, errno=%d (%s)\n",
+			listen_addr, errno, strerror(errno));
+		(void)close(fd);
+		return EXIT_FAILURE;
+	}
+	(void)signal(SIGPIPE, SIG_IGN);
+
+	pr_inf("agent: waiting for coordinator jobs on %s\n", listen_addr);
+	while (stress_continue_flag()) {
+		struct pollfd pfd;
+		int conn;
+
+		pfd.fd = fd;
+		pfd.events = POLLIN;
+		pfd.revents = 0;
+		if (poll(&pfd, 1, CLUSTER_POLL_MS) <= 0)
+			continue;
+		conn = accept(fd, NULL, NULL);
+		if (conn < 0)
+			continue;
+		(void)fcntl(conn, F_SETFD, FD_CLOEXEC);
+		/* don't block on coordinators that stop reading results */
+		tv.tv_sec = CLUSTER_IO_TIMEOUT;
+		tv.tv_usec = 0;
+		(void)setsockopt(conn, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+		stress_cluster_agent_job(conn, token);
+		(void)close(conn);
+	}
+	(void)close(fd);
+	(void)shim_memset(token, 0, sizeof(token));
+	return EXIT_SUCCESS;
+}
+
+/*
+ *  stress_cluster_connect()
+ *	connect to an agent HOST:PORT
+ */
+static int stress_cluster_connect(const char *addr)
+{
+	struct addrinfo hints, *res = NULL, *ai;
+	char host[CLUSTER_LINE_MAX], port[16];
+	int fd = -1, err, saved_errno = 0;
+
+	if (stress_cluster_addr_split(addr, host, sizeof(host), port, sizeof(port)) < 0)
+		return -1;
+
+	(void)shim_memset(&hints, 0, sizeof(hints));
+	hints.ai_family = AF_UNSPEC;
+	hints.ai_socktype = SOCK_STREAM;
+	err = getaddrinfo(host, port, &hints, &res);
+	if (err || !res) {
+		pr_err("coordinate: cannot resolve %s: %s\n", addr, gai_strerror(err));
+		return -1;
+	}
+	for (ai = res; ai; ai = ai->ai_next) {
+		fd = socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+		if (fd < 0) {
+			saved_errno = errno;
+			continue;
+		}
+		if (connect(fd, ai->ai_addr, ai->ai_addrlen) == 0)
+			break;
+		saved_errno = errno;
+		(void)close(fd);
+		fd = -1;
+	}
+	freeaddrinfo(res);
+	if (fd < 0)
+		pr_err("coordinate: cannot connect to agent %s, errno=%d (%s)\n",
+			addr, saved_errno, strerror(saved_errno));
+	return fd;
+}
+
+/*
+ *  stress_cluster_collect()
+ *	read the replies of all the agents until they close their
+ *	control sockets, agents may finish in any order
+ */
+static void stress_cluster_collect(stress_cluster_host_t *hosts, const size_t n_hosts)
+{
+	size_t i, pending = 0;
+
+	for (i = 0; i < n_hosts; i++) {
+		if (hosts[i].fd >= 0)
+			pending++;
+	}
+	while (pending > 0) {
+		struct pollfd pfds[CLUSTER_HOSTS_MAX];
+		size_t idx[CLUSTER_HOSTS_MAX];
+		size_t n = 0;
+		int ret;
+
+		for (i = 0; i < n_hosts; i++) {
+			if (hosts[i].fd < 0)
+				continue;
+			pfds[n].fd = hosts[i].fd;
+			pfds[n].events = POLLIN;
+			pfds[n].revents = 0;
+			idx[n++] = i;
+		}
+		ret = poll(pfds, (nfds_t)n, CLUSTER_POLL_MS);
+		if (ret < 0) {
+			if (errno == EINTR)
+				continue;
+			pr_err("coordinate: poll failed, errno=%d (%s)\n", errno, strerror(errno));
+			break;
+		}
+		for (i = 0; i < n; i++) {
+			stress_cluster_host_t *host = &hosts[idx[i]];
+			ssize_t len;
+
+			if (!pfds[i].revents)
+				continue;
+			if (host->len == host->size) {
+				const size_t size = host->size ? host->size * 2 : 64 * KB;
+				char *buf;
+
+				buf = (size > CLUSTER_RESULT_MAX + CLUSTER_LINE_MAX) ?
+					NULL : (char *)realloc(host->buf, size + 1);
+				if (!buf) {
+					pr_err("coordinate: %s: results too large\n", host->addr);
+					(void)close(host->fd);
+					host->fd = -1;
+					pending--;
+					continue;
+				}
+				host->buf = buf;
+				host->size = size;
+			}
+			len = read(host->fd, host->buf + host->len, host->size - host->len);
+			if ((len < 0) && (errno == EINTR))
+				continue;
+			if (len <= 0) {
+				(void)close(host->fd);
+				host->fd = -1;
+				pending--;
+				continue;
+			}
+			host->len += (size_t)len;
+			host->buf[host->len] = '\0';
+		}
+	}
+	for (i = 0; i < n_hosts; i++) {
+		if (hosts[i].fd >= 0) {
+			(void)close(hosts[i].fd);
+			hosts[i].fd = -1;
+		}
+	}
+}
+
+/*
+ *  stress_cluster_result()
+ *	parse an agent RESULT reply, returns -1 if the agent
+ *	did not reply with a complete set of results
+ */
+static int stress_cluster_result(stress_cluster_host_t *host)
+{
+	char *nl;
+	size_t yaml_len;
+	int status;
+
+	host->status = EXIT_FAILURE;
+	if (!host->buf)
+		return -1;
+	nl = strchr(host->buf, '\n');
+	if (!nl)
+		return -1;
+	*nl = '\0';
+	if (sscanf(host->buf, "RESULT %d %zu", &status, &yaml_len) != 2)
+		return -1;
+	host->status = status;
+	if ((size_t)(host->buf + host->len - (nl + 1)) != yaml_len)
+		return -1;
+	host->yaml = nl + 1;
+	host->yaml_len = yaml_len;
+	return 0;
+}
+
+/*
+ *  stress_cluster_metrics_add()
+ *	sum the bogo-ops of a host's YAML metrics section into the
+ *	cluster wide per stressor metrics
+ */
+static int stress_cluster_metrics_add(
+	const char *yaml,
+	stress_cluster_metric_t **metrics,
+	size_t *n_metrics)
+{
+	stress_cluster_metric_t *metric = NULL;
+	bool in_metrics = false;
+	const char *ptr = yaml;
+
+	while (*ptr) {
+		char line[512];
+		const size_t len = strcspn(ptr, "\n");
+		const char *str;
+		size_t i;
+
+		(void)shim_strscpy(line, ptr, STRESS_MINIMUM(len + 1, sizeof(line)));
+		ptr += len;
+		if (*ptr)
+			ptr++;
+
+		if (*line && (*line != ' ')) {
+			in_metrics = !strcmp(line, "metrics:");
+			metric = NULL;
+			continue;
+		}
+		if (!in_metrics)
+			continue;
+		for (str = line; *str == ' '; str++)
+			;
+		if (!strncmp(str, "- stressor: ", 12)) {
+			str += 12;
+			for (i = 0; i < *n_metrics; i++) {
+				if (!strcmp((*metrics)[i].stressor, str))
+					break;
+			}
+			if (i == *n_metrics) {
+				stress_cluster_metric_t *new_metrics;
+
+				new_metrics = (stress_cluster_metric_t *)realloc(*metrics,
+					(*n_metrics + 1) * sizeof(*new_metrics));
+				if (!new_metrics)
+					return -1;
+				*metrics = new_metrics;
+				(void)shim_memset(&new_metrics[i], 0, sizeof(new_metrics[i]));
+				(void)shim_strscpy(new_metrics[i].stressor, str, sizeof(new_metrics[i].stressor));
+				(*n_metrics)++;
+			}
+			metric = &(*metrics)[i];
+			metric->hosts++;
+		} else if (metric && !strncmp(str, "bogo-ops: ", 10)) {
+			metric->bogo_ops += (uint64_t)strtoull(str + 10, NULL, 10);
+		} else if (metric && !strncmp(str, "bogo-ops-per-second-real-time: ", 31)) {
+			metric->bogo_rate += strtod(str + 31, NULL);
+		}
+	}
+	return 0;
+}
+
+/*
+ *  stress_cluster_report()
+ *	report the per host exit status and the cluster wide
+ *	stressor metrics, the per host YAML results are merged
+ *	into a single --yaml cluster report
+ */
+static void stress_cluster_report(
+	stress_cluster_host_t *hosts,
+	const size_t n_hosts,
+	const uint64_t start_at)
+{
+	stress_cluster_metric_t *metrics = NULL;
+	size_t i, n_metrics = 0;
+	char *yaml_filename = NULL;
+	FILE *yaml = NULL;
+
+	if (stress_get_setting("yaml", &yaml_filename) && yaml_filename) {
+		yaml = fopen(yaml_filename, "w");
+		if (!yaml)
+			pr_err("Cannot output YAML data to %s\n", yaml_filename);
+	}
+	pr_yaml(yaml, "---\n");
+	pr_yaml(yaml, "cluster:\n");
+	pr_yaml(yaml, "      start-time: %" PRIu64 "\n", start_at);
+	pr_yaml(yaml, "      hosts: %zu\n", n_hosts);
+	pr_yaml(yaml, "      host-results:\n");
+
+	for (i = 0; i < n_hosts; i++) {
+		stress_cluster_host_t *host = &hosts[i];
+		const char *ptr;
+
+		pr_yaml(yaml, "        - host: %s\n", host->addr);
+		pr_yaml(yaml, "          exit-status: %d\n", host->status);
+		if (!host->yaml)
+			continue;
+		if (stress_cluster_metrics_add(host->yaml, &metrics, &n_metrics) < 0)
+			pr_err("coordinate: out of memory summing metrics of %s\n", host->addr);
+
+		/* nest the host results, dropping the YAML document markers */
+		pr_yaml(yaml, "          results:\n");
+		for (ptr = host->yaml; *ptr; ) {
+			const int len = (int)strcspn(ptr, "\n");
+
+			if (len && strncmp(ptr, "---", 3) && strncmp(ptr, "...", 3))
+				pr_yaml(yaml, "            %.*s\n", len, ptr);
+			ptr += len;
+			if (*ptr)
+				ptr++;
+		}
+	}
+	pr_yaml(yaml, "\n");
+
+	if (n_metrics > 0) {
+		pr_inf("coordinate: %-13s %5s %15s %15s\n",
+			"stressor", "hosts", "bogo ops", "bogo ops/s");
+		pr_inf("coordinate: %-13s %5s %15s %15s\n",
+			"", "", "", "(real time)");
+		pr_yaml(yaml, "cluster-metrics:\n");
+	}
+	for (i = 0; i < n_metrics; i++) {
+		const stress_cluster_metric_t *metric = &metrics[i];
+
+		pr_inf("coordinate: %-13s %5zu %15" PRIu64 " %15.2f\n",
+			metric->stressor, metric->hosts, metric->bogo_ops, metric->bogo_rate);
+		pr_yaml(yaml, "    - stressor: %s\n", metric->stressor);
+		pr_yaml(yaml, "      hosts: %zu\n", metric->hosts);
+		pr_yaml(yaml, "      bogo-ops: %" PRIu64 "\n", metric->bogo_ops);
+		pr_yaml(yaml, "      bogo-ops-per-second-real-time: %f\n", metric->bogo_rate);
+	}
+	if (n_metrics > 0)
+		pr_yaml(yaml, "\n");
+	pr_yaml(yaml, "...\n");
+	if (yaml)
+		(void)fclose(yaml);
+	free(metrics);
+}
+
+/*
+ *  stress_cluster_coordinate()
+ *	send the --job file and a common start time to all the
+ *	agents, wait for them to complete and merge the results
+ */
+static int stress_cluster_coordinate(const char *agents)
+{
+	stress_cluster_host_t *hosts;
+	char *job_filename = NULL, *job_buf;
+	char token[CLUSTER_TOKEN_MAX];
+	const char *ptr;
+	size_t i, n_hosts = 0, job_len;
+	uint64_t start_at;
+	int rc = EXIT_SUCCESS;
+
+	if (!stress_get_setting("job", &job_filename) || !job_filename) {
+		pr_err("coordinate: a --job file is required to run on the agents\n");
+		return EXIT_FAILURE;
+	}
+	if (stress_cluster_token("coordinate", token, sizeof(token)) < 0)
+		return EXIT_FAILURE;
+	job_buf = stress_cluster_file_read(job_filename, &job_len, CLUSTER_JOB_MAX);
+	if (!job_buf || !job_len) {
+		pr_err("coordinate: cannot read job file %s, the maximum size is %zu bytes\n",
+			job_filename, (size_t)CLUSTER_JOB_MAX);
+		free(job_buf);
+		return EXIT_FAILURE;
+	}
+	hosts = (stress_cluster_host_t *)calloc(CLUSTER_HOSTS_MAX, sizeof(*hosts));
+	if (!hosts) {
+		pr_err("coordinate: cannot allocate agent host table\n");
+		free(job_buf);
+		return EXIT_FAILURE;
+	}
+
+	/* connect to all the agents before any are sent the job */
+	for (ptr = agents; *ptr && (n_hosts < CLUSTER_HOSTS_MAX); ) {
+		stress_cluster_host_t *host = &hosts[n_hosts];
+		const size_t len = strcspn(ptr, ",");
+
+		(void)shim_memcpy(host->addr, ptr, STRESS_MINIMUM(len, sizeof(host->addr) - 1));
+		host->addr[STRESS_MINIMUM(len, sizeof(host->addr) - 1)] = '\0';
+		host->fd = stress_cluster_connect(host->addr);
+		n_hosts++;
+		if (host->fd < 0) {
+			rc = EXIT_FAILURE;
+			goto tidy;
+		}
+		ptr += len;
+		if (*ptr)
+			ptr++;
+	}
+
+	(void)signal(SIGPIPE, SIG_IGN);
+	start_at = (uint64_t)stress_time_now() + 1 + CLUSTER_START_DELAY;
+	for (i = 0; i < n_hosts; i++) {
+		char header[CLUSTER_LINE_MAX + CLUSTER_TOKEN_MAX];
+
+		(void)snprintf(header, sizeof(header), CLUSTER_PROTOCOL "\nTOKEN %s\nSTART %" PRIu64 "\nJOB %zu\n",
+			token, start_at, job_len);
+		if ((stress_cluster_write_all(hosts[i].fd, header, strlen(header)) < 0) ||
+		    (stress_cluster_write_all(hosts[i].fd, job_buf, job_len) < 0)) {
+			pr_err("coordinate: failed to send job to agent %s, errno=%d (%s)\n",
+				hosts[i].addr, errno, strerror(errno));
+			(void)close(hosts[i].fd);
+			hosts[i].fd = -1;
+		}
+	}
+	pr_inf("coordinate: sent job %s to %zu agent%s, starting at %" PRIu64 "\n",
+		job_filename, n_hosts, (n_hosts == 1) ? "" : "s", start_at);
+
+	stress_cluster_collect(hosts, n_hosts);
+
+	for (i = 0; i < n_hosts; i++) {
+		stress_cluster_host_t *host = &hosts[i];
+
+		if (stress_cluster_result(host) < 0) {
+			pr_err("coordinate: agent %s did not return complete results\n", host->addr);
+			rc = EXIT_FAILURE;
+		} else {
+			pr_inf("coordinate: agent %s exit status %d, %zu bytes of results\n",
+				host->addr, host->status, host->yaml_len);
+			if ((rc == EXIT_SUCCESS) && (host->status != EXIT_SUCCESS))
+				rc = host->status;
+		}
+	}
+	stress_cluster_report(hosts, n_hosts, start_at);
+tidy:
+	for (i = 0; i < n_hosts; i++) {
+		if (hosts[i].fd >= 0)
+			(void)close(hosts[i].fd);
+		free(hosts[i].buf);
+	}
+	free(hosts);
+	free(job_buf);
+	(void)shim_memset(token, 0, sizeof(token));
+	return rc;
+}
+#endif
+
+/*
+ *  stress_cluster_run()
+ *	run as an --agent or --coordinate, returns the exit status
+ */
+int stress_cluster_run(void)
+{
+	char *agent = NULL, *coordinate = NULL;
+
+	(void)stress_get_setting("agent", &agent);
+	(void)stress_get_setting("coordinate", &coordinate);
+	if (agent && coordinate) {
+		pr_err("--agent and --coordinate cannot be used together\n");
+		return EXIT_FAILURE;
+	}
+#if defined(HAVE_NETDB_H) &&	\
+    defined(HAVE_POLL_H)
+	if (agent)
+		return stress_cluster_agent(agent);
+	return stress_cluster_coordinate(coordinate);
+#else
+	pr_inf("%s: multi-host runs are not supported on this system\n",
+		agent ? "agent" : "coordinate");
+	return EXIT_NOT_IMPLEMENTED;
+#endif
+}
@@ -0,0 +1,371 @@
+/*
+ * Copyright (C) 2025      Colin Ian King.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+#include "stress-ng.h"
+#include "core-compare.h"
+
+#include <ctype.h>
+#include <math.h>
+
+#define COMPARE_HIGHER_BETTER	(1)
+#define COMPARE_LOWER_BETTER	(-1)
+#define COMPARE_INFO_ONLY	(0)
+
+/* a numeric stressor value from a YAML results file */
+typedef struct {
+	char	*section;		/* YAML section, e.g. metrics */
+	char	*stressor;		/* stressor name */
+	char	*key;			/* metric name */
+	double	value;			/* metric value */
+} stress_compare_item_t;
+
+typedef struct {
+	stress_compare_item_t *items;	/* array of items */
+	size_t	n;			/* number of items */
+	size_t	n_max;			/* allocated number of items */
+} stress_compare_items_t;
+
+/* YAML sections that are compared */
+static const char * const compare_sections[] = {
+	"metrics",
+	"perfstats",
+};
+
+/* values that depend on run duration or are not a performance metric */
+static const char * const compare_ignore[] = {
+	"bogo-ops",
+	"wall-clock-time",
+	"user-time",
+	"system-time",
+	"cpu-usage-per-instance",
+	"max-rss",
+	"duration",
+};
+
+/*
+ *  stress_compare_item_add()
+ *	add a section, stressor, key and value item
+ */
+static int stress_compare_item_add(
+	stress_compare_items_t *items,
+	const char *section,
+	const char *stressor,
+	const char *key,
+	const double value)
+{
+	stress_compare_item_t *item;
+
+	if (items->n >= items->n_max) {
+		const size_t n_max = items->n_max ? items->n_max * 2 : 256;
+		stress_compare_item_t *new_items;
+
+		new_items = (stress_compare_item_t *)realloc(items->items, n_max * sizeof(*new_items));
+		if (!new_items)
+			return -1;
+		items->items = new_items;
+		items->n_max = n_max;
+	}
+	item = &items->items[items->n];
+	item->section = strdup(section);
+	item->stressor = strdup(stressor);
+	item->key = strdup(key);
+	item->value = value;
+	if (!item->section || !item->stressor || !item->key) {
+		free(item->section);
+		free(item->stressor);
+		free(item->key);
+		return -1;
+	}
+	items->n++;
+	return 0;
+}
+
+/*
+ *  stress_compare_items_free()
+ *	free items
+ */
+static void stress_compare_items_free(stress_compare_items_t *items)
+{
+	size_t i;
+
+	for (i = 0; i < items->n; i++) {
+		free(items->items[i].section);
+		free(items->items[i].stressor);
+		free(items->items[i].key);
+	}
+	free(items->items);
+	items->items = NULL;
+	items->n = 0;
+	items->n_max = 0;
+}
+
+/*
+ *  stress_compare_parse()
+ *	parse the per stressor numeric values of the compared
+ *	sections of a stress-ng YAML results file
+ */
+static int stress_compare_parse(FILE *fp, stress_compare_items_t *items)
+{
+	char buffer[4096];
+	char section[128], stressor[128];
+	bool compare = false;
+
+	*section = '\0';
+	*stressor = '\0';
+
+	while (fgets(buffer, sizeof(buffer), fp)) {
+		char *ptr, *key, *val, *end;
+		double value;
+		size_t i, indent;
+
+		buffer[strcspn(buffer, "\r\n")] = '\0';
+		for (indent = 0; buffer[indent] == ' '; indent++)
+			;
+		ptr = buffer + indent;
+		if (!*ptr || (*ptr == '#'))
+			continue;
+
+		/* top level section */
+		if (indent == 0) {
+			const size_t len = strlen(ptr);
+
+			compare = false;
+			*stressor = '\0';
+			if ((len < 2) || (ptr[len - 1] != ':'))
+				continue;
+			ptr[len - 1] = '\0';
+			(void)shim_strscpy(section, ptr, sizeof(section));
+			for (i = 0; i < SIZEOF_ARRAY(compare_sections); i++) {
+				if (!strcmp(section, compare_sections[i])) {
+					compare = true;
+					break;
+				}
+			}
+			continue;
+		}
+		if (!compare)
+			continue;
+
+		if (!strncmp(ptr, "- stressor:", 11)) {
+			ptr += 11;
+			while (*ptr == ' ')
+				ptr++;
+			(void)shim_strscpy(stressor, ptr, sizeof(stressor));
+			continue;
+		}
+		if (!*stressor || (*ptr == '-'))
+			continue;
+
+		/* key: value */
+		key = ptr;
+		val = strchr(ptr, ':');
+		if (!val)
+			continue;
+		*val++ = '\0';
+		while (*val == ' ')
+			val++;
+		if (!*val)
+			continue;
+		value = strtod(val, &end);
+		if (end == val)
+			continue;
+		while (*end == ' ')
+			end++;
+		if (*end)
+			continue;
+		if (stress_compare_item_add(items, section, stressor, key, value) < 0)
+			return -1;
+	}
+	return 0;
+}
+
+/*
+ *  stress_compare_direction()
+ *	determine if a higher or lower value of a metric is better,
+ *	COMPARE_INFO_ONLY metrics are reported but not checked for
+ *	regressions
+ */
+static int stress_compare_direction(const char *section, const char *key)
+{
+	static const char * const higher[] = {
+		"per-sec", "per-second", "per-joule", "gflops",
+	};
+	static const char * const lower[] = {
+		"nanosec", "microsec", "millisec", "usec", "msec",
+		"latency", "joules", "watts", "cycles-per",
+	};
+	size_t i;
+
+	for (i = 0; i < SIZEOF_ARRAY(compare_ignore); i++) {
+		if (!strcmp(key, compare_ignore[i]))
+			return COMPARE_INFO_ONLY;
+	}
+
+	if (!strcmp(section, "perfstats")) {
+		/* raw event counts depend on the run duration */
+		if (strstr(key, "_total") || strstr(key, "_per_second"))
+			return COMPARE_INFO_ONLY;
+		if (strstr(key, "per_cycle"))
+			return COMPARE_HIGHER_BETTER;
+		if (strstr(key, "miss") || strstr(key, "mpki"))
+			return COMPARE_LOWER_BETTER;
+		return COMPARE_INFO_ONLY;
+	}
+
+	for (i = 0; i < SIZEOF_ARRAY(higher); i++) {
+		if (strstr(key, higher[i]))
+			return COMPARE_HIGHER_BETTER;
+	}
+	for (i = 0; i < SIZEOF_ARRAY(lower); i++) {
+		if (strstr(key, lower[i]))
+			return COMPARE_LOWER_BETTER;
+	}
+	/* most misc metrics are rates */
+	return COMPARE_HIGHER_BETTER;
+}
+
+/*
+ *  stress_compare_find()
+ *	find a matching item in the baseline
+ */
+static const stress_compare_item_t *stress_compare_find(
+	const stress_compare_items_t *items,
+	const stress_compare_item_t *item)
+{
+	size_t i;
+
+	for (i = 0; i < items->n; i++) {
+		const stress_compare_item_t *it = &items->items[i];
+
+		if (!strcmp(it->key, item->key) &&
+		    !strcmp(it->stressor, item->stressor) &&
+		    !strcmp(it->section, item->section))
+			return it;
+	}
+	return NULL;
+}
+
+/*
+ *  stress_compare_yaml()
+ *	compare the results in the current run YAML file (which must
+ *	be readable) against a baseline YAML results file, report per
+ *	stressor deltas and return the number of metrics that regressed
+ *	by more than threshold percent, -1 on error
+ */
+int stress_compare_yaml(FILE *yaml, const char *baseline_filename, const double threshold)
+{
+	stress_compare_items_t baseline = { NULL, 0, 0 };
+	stress_compare_items_t current = { NULL, 0, 0 };
+	FILE *fp;
+	size_t i, compared = 0;
+	int regressions = 0, ret;
+
+	if (!yaml)
+		return -1;
+
+	fp = fopen(baseline_filename, "r");
+	if (!fp) {
+		pr_err("compare: cannot open baseline %s, errno=%d (%s)\n",
+			baseline_filename, errno, strerror(errno));
+		return -1;
+	}
+	ret = stress_compare_parse(fp, &baseline);
+	(void)fclose(fp);
+	if (ret < 0) {
+		pr_err("compare: out of memory parsing baseline %s\n", baseline_filename);
+		stress_compare_items_free(&baseline);
+		return -1;
+	}
+
+	(void)fflush(yaml);
+	rewind(yaml);
+	ret = stress_compare_parse(yaml, &current);
+	(void)fseek(yaml, 0, SEEK_END);
+	if (ret < 0) {
+		pr_err("compare: out of memory parsing current results\n");
+		goto free_items;
+	}
+	if (baseline.n == 0) {
+		pr_err("compare: no metrics found in baseline %s\n", baseline_filename);
+		ret = -1;
+		goto free_items;
+	}
+
+	pr_inf("compare: against baseline %s, regression threshold %.2f%%\n",
+		baseline_filename, threshold);
+	pr_inf("compare: %-13s %-36s %14s %14s %8s\n",
+		"stressor", "metric", "baseline", "current", "delta %");
+	pr_yaml(yaml, "compare:\n");
+	pr_yaml(yaml, "    baseline: %s\n", baseline_filename);
+	pr_yaml(yaml, "    threshold-percent: %.2f\n", threshold);
+	pr_yaml(yaml, "    regressions:\n");
+
+	for (i = 0; i < current.n; i++) {
+		const stress_compare_item_t *item = &current.items[i];
+		const stress_compare_item_t *base = stress_compare_find(&baseline, item);
+		const int direction = stress_compare_direction(item->section, item->key);
+		double delta;
+		const char *verdict = "";
+		bool regressed = false;
+
+		if (!base || (base->value == 0.0))
+			continue;
+
+		compared++;
+		delta = 100.0 * (item->value - base->value) / fabs(base->value);
+		if (direction != COMPARE_INFO_ONLY) {
+			const double change = (double)direction * delta;
+
+			if (change < -threshold) {
+				verdict = " REGRESSION";
+				regressed = true;
+				regressions++;
+				pr_yaml(yaml, "      - stressor: %s\n", item->stressor);
+				pr_yaml(yaml, "        metric: %s\n", item->key);
+				pr_yaml(yaml, "        baseline: %f\n", base->value);
+				pr_yaml(yaml, "        current: %f\n", item->value);
+				pr_yaml(yaml, "        delta-percent: %.2f\n", delta);
+			} else if (change > threshold) {
+				verdict = " improved";
+			}
+		}
+		if (regressed) {
+			pr_warn("compare: %-13s %-36.36s %14.4g %14.4g %+8.2f%s\n",
+				item->stressor, item->key, base->value, item->value, delta, verdict);
+		} else {
+			pr_inf("compare: %-13s %-36.36s %14.4g %14.4g %+8.2f%s\n",
+				item->stressor, item->key, base->value, item->value, delta, verdict);
+		}
+	}
+	pr_yaml(yaml, "    regression-count: %d\n", regressions);
+	pr_yaml(yaml, "\n");
+
+	if (compared == 0)
+		pr_inf("compare: no metrics in common with baseline %s\n", baseline_filename);
+	else if (regressions)
+		pr_warn("compare: %d of %zu metrics regressed by more than %.2f%%\n",
+			regressions, compared, threshold);
+	else
+		pr_inf("compare: no regressions in %zu metrics\n", compared);
+	ret = regressions;
+
+free_items:
+	stress_compare_items_free(&current);
+	stress_compare_items_free(&baseline);
+	return ret;
+}
@@ -23,6 +23,10 @@
 #include "core-builtin.h"
 #include "core-cpu.h"
 
+#if defined(HAVE_SYS_AUXV_H)
+#include <sys/auxv.h>
+#endif
+
 	/* Name + dest reg */			/* Input -> Output */
 #define CPUID_sse3_ECX		(1U << 0)	/* EAX=0x1 -> ECX */
 #define CPUID_pclmulqdq_ECX	(1U << 1)	/* EAX=0x1 -> ECX */
@@ -617,6 +621,106 @@ bool stress_cpu_x86_has_sse2(void)
 #endif
 }
 
+/*
+ *  stress_cpu_x86_has_sse4_2()
+ *	does x86 cpu support sse4.2 (and hence crc32)?
+ */
+bool stress_cpu_x86_has_sse4_2(void)
+{
+#if defined(STRESS_ARCH_X86)
+	uint32_t eax = 0x1, ebx = 0, ecx = 0, edx = 0;
+
+	if (!stress_cpu_is_x86())
+		return false;
+
+	stress_asm_x86_cpuid(eax, ebx, ecx, edx);
+
+	return !!(ecx & CPUID_sse4_2_ECX);
+#else
+	return false;
+#endif
+}
+
+/*
+ *  stress_cpu_x86_has_pclmulqdq()
+ *	does x86 cpu support carry-less multiply?
+ */
+bool stress_cpu_x86_has_pclmulqdq(void)
+{
+#if defined(STRESS_ARCH_X86)
+	uint32_t eax = 0x1, ebx = 0, ecx = 0, edx = 0;
+
+	if (!stress_cpu_is_x86())
+		return false;
+
+	stress_asm_x86_cpuid(eax, ebx, ecx, edx);
+
+	return !!(ecx & CPUID_pclmulqdq_ECX);
+#else
+	return false;
+#endif
+}
+
+/*
+ *  stress_cpu_x86_has_aes()
+ *	does x86 cpu support aes-ni?
+ */
+bool stress_cpu_x86_has_aes(void)
+{
+#if defined(STRESS_ARCH_X86)
+	uint32_t eax = 0x1, ebx = 0, ecx = 0, edx = 0;
+
+	if (!stress_cpu_is_x86())
+		return false;
+
+	stress_asm_x86_cpuid(eax, ebx, ecx, edx);
+
+	return !!(ecx & CPUID_aes_ECX);
+#else
+	return false;
+#endif
+}
+
+/*
+ *  stress_cpu_x86_has_vaes()
+ *	does x86 cpu support vector aes?
+ */
+bool stress_cpu_x86_has_vaes(void)
+{
+#if defined(STRESS_ARCH_X86)
+	uint32_t ebx = 0, ecx = 0, edx = 0;
+
+	if (!stress_cpu_is_x86())
+		return false;
+
+	stress_cpu_x86_extended_features(ebx, ecx, edx);
+
+	return !!(ecx & CPUID_vaes_ECX);
+#else
+	return false;
+#endif
+}
+
+/*
+ *  stress_cpu_x86_has_fma()
+ *	does x86 cpu support fma3?
+ */
+bool stress_cpu_x86_has_fma(void)
+{
+#if defined(STRESS_ARCH_X86)
+	uint32_t eax = 0x1, ebx = 0, ecx = 0, edx = 0;
+
+	if (!stress_cpu_is_x86())
+		return false;
+
+	stress_asm_x86_cpuid(eax, ebx, ecx, edx);
+
+	return !!(ecx & CPUID_fma_ECX);
+#else
+	return false;
+#endif
+}
+
 /*
  *  stress_cpu_x86_has_serialize()
  *	does x86 cpu support serialize opcode?
@@ -637,6 +741,46 @@ bool stress_cpu_x86_has_serialize(void)
 #endif
 }
 
+/*
+ *  stress_cpu_x86_has_erms()
+ *	does x86 cpu support enhanced rep movsb/stosb
+ */
+bool stress_cpu_x86_has_erms(void)
+{
+#if defined(STRESS_ARCH_X86)
+	uint32_t eax = 0x7, ebx = 0, ecx = 0, edx = 0;
+
+	if (!stress_cpu_is_x86())
+		return false;
+
+	stress_asm_x86_cpuid(eax, ebx, ecx, edx);
+
+	return !!(ebx & CPUID_erms_EBX);
+#else
+	return false;
+#endif
+}
+
+/*
+ *  stress_cpu_x86_has_fsrm()
+ *	does x86 cpu support fast short rep movsb
+ */
+bool stress_cpu_x86_has_fsrm(void)
+{
+#if defined(STRESS_ARCH_X86)
+	uint32_t eax = 0x7, ebx = 0, ecx = 0, edx = 0;
+
+	if (!stress_cpu_is_x86())
+		return false;
+
+	stress_asm_x86_cpuid(eax, ebx, ecx, edx);
+
+	return !!(edx & CPUID_fsrm_EDX);
+#else
+	return false;
+#endif
+}
+
 /*
  *  stress_cpu_x86_has_avx_vnni()
  *	does x86 cpu support avx_vnni
@@ -717,3 +861,234 @@ bool stress_cpu_x86_has_avx512_bw(void)
 #endif
 }
 
+
+/*
+ *  stress_cpu_x86_has_avx2()
+ *	does x86 cpu support avx2
+ */
+bool stress_cpu_x86_has_avx2(void)
+{
+#if defined(STRESS_ARCH_X86)
+	uint32_t eax = 0x7, ebx = 0, ecx = 0, edx = 0;
+
+	if (!stress_cpu_is_x86())
+		return false;
+
+	stress_asm_x86_cpuid(eax, ebx, ecx, edx);
+
+	return !!(ebx & CPUID_avx2_EBX);
+#else
+	return false;
+#endif
+}
+
+/*
+ *  stress_cpu_x86_has_avx512_f()
+ *	does x86 cpu support avx512_f
+ */
+bool stress_cpu_x86_has_avx512_f(void)
+{
+#if defined(STRESS_ARCH_X86)
+	uint32_t eax = 0x7, ebx = 0, ecx = 0, edx = 0;
+
+	if (!stress_cpu_is_x86())
+		return false;
+
+	stress_asm_x86_cpuid(eax, ebx, ecx, edx);
+
+	return !!(ebx & CPUID_avx512_f_EBX);
+#else
+	return false;
+#endif
+}
+
+/*
+ *  stress_cpu_arm_has_neon()
+ *	does arm cpu support neon (advanced SIMD)
+ */
+bool stress_cpu_arm_has_neon(void)
+{
+#if defined(STRESS_ARCH_ARM) &&	\
+    defined(__aarch64__)
+	/* advanced SIMD is mandatory on aarch64 */
+	return true;
+#elif defined(STRESS_ARCH_ARM) &&	\
+    defined(HAVE_GETAUXVAL) &&		\
+    defined(HAVE_SYS_AUXV_H) &&		\
+    defined(HWCAP_NEON)
+	return !!(getauxval(AT_HWCAP) & HWCAP_NEON);
+#else
+	return false;
+#endif
+}
+
+/*
+ *  stress_cpu_arm_has_sve()
+ *	does arm cpu support the scalable vector extension
+ */
+bool stress_cpu_arm_has_sve(void)
+{
+#if defined(STRESS_ARCH_ARM) &&	\
+    defined(HAVE_GETAUXVAL) &&		\
+    defined(HAVE_SYS_AUXV_H) &&		\
+    defined(HWCAP_SVE)
+	return !!(getauxval(AT_HWCAP) & HWCAP_SVE);
+#else
+	return false;
+#endif
+}
+
+/*
+ *  stress_cpu_arm_has_crc32()
+ *	does arm cpu support the crc32 instructions
+ */
+bool stress_cpu_arm_has_crc32(void)
+{
+#if defined(STRESS_ARCH_ARM) &&	\
+    defined(HAVE_GETAUXVAL) &&		\
+    defined(HAVE_SYS_AUXV_H) &&		\
+    defined(HWCAP_CRC32)
+	return !!(getauxval(AT_HWCAP) & HWCAP_CRC32);
+#else
+	return false;
+#endif
+}
+
+/*
+ *  stress_cpu_arm_has_aes()
+ *	does arm cpu support the aes crypto extension instructions
+ */
+bool stress_cpu_arm_has_aes(void)
+{
+#if defined(STRESS_ARCH_ARM) &&	\
+    defined(HAVE_GETAUXVAL) &&		\
+    defined(HAVE_SYS_AUXV_H) &&		\
+    defined(HWCAP_AES)
+	return !!(getauxval(AT_HWCAP) & HWCAP_AES);
+#else
+	return false;
+#endif
+}
+
+/*
+ *  stress_cpu_arm_has_dcpop()
+ *	does arm cpu support the dc cvap persist to point of persistence
+ */
+bool stress_cpu_arm_has_dcpop(void)
+{
+#if defined(STRESS_ARCH_ARM) &&	\
+    defined(HAVE_GETAUXVAL) &&		\
+    defined(HAVE_SYS_AUXV_H) &&		\
+    defined(HWCAP_DCPOP)
+	return !!(getauxval(AT_HWCAP) & HWCAP_DCPOP);
+#else
+	return false;
+#endif
+}
+
+#if defined(STRESS_ARCH_X86_64)
+/*
+ *  stress_cpu_x86_xcr0()
+ *	read the XCR0 register to check which register states the OS
+ *	saves and restores, returns 0 if xgetbv is not enabled
+ */
+static uint64_t stress_cpu_x86_xcr0(void)
+{
+	uint32_t eax = 0x1, ebx = 0, ecx = 0, edx = 0;
+	uint32_t lo, hi;
+
+	stress_asm_x86_cpuid(eax, ebx, ecx, edx);
+	if (!(ecx & CPUID_osxsave_ECX))
+		return 0;
+	__asm__ __volatile__("xgetbv\n" : "=a"(lo), "=d"(hi) : "c"(0));
+	return ((uint64_t)hi << 32) | lo;
+}
+#endif
+
+/*
+ *  stress_cpu_x86_isa_level()
+ *	return the x86-64 psABI micro-architecture level 1..4 of
+ *	the cpu, 0 if not x86-64. Levels 3 and 4 also require the
+ *	OS to save the AVX and AVX-512 register states
+ */
+int stress_cpu_x86_isa_level(void)
+{
+#if defined(STRESS_ARCH_X86_64)
+	uint32_t eax, ebx, ecx1, ecx7, ecxe, edx;
+	uint64_t xcr0;
+
+	if (!stress_cpu_is_x86())
+		return 0;
+
+	eax = 0x1, ebx = 0, ecx1 = 0, edx = 0;
+	stress_asm_x86_cpuid(eax, ebx, ecx1, edx);
+	if ((ecx1 & (CPUID_sse3_ECX | CPUID_ssse3_ECX | CPUID_sse4_1_ECX |
+		     CPUID_sse4_2_ECX | CPUID_popcnt_ECX | CPUID_cx16_ECX)) !=
+		    (CPUID_sse3_ECX | CPUID_ssse3_ECX | CPUID_sse4_1_ECX |
+		     CPUID_sse4_2_ECX | CPUID_popcnt_ECX | CPUID_cx16_ECX))
+		return 1;
+
+	eax = 0x80000000, ebx = 0, ecxe = 0, edx = 0;
+	stress_asm_x86_cpuid(eax, ebx, ecxe, edx);
+	if (eax >= 0x80000001) {
+		eax = 0x80000001, ebx = 0, ecxe = 0, edx = 0;
+		stress_asm_x86_cpuid(eax, ebx, ecxe, edx);
+	} else {
+		ecxe = 0;
+	}
+	/* lahf/sahf in 64 bit mode */
+	if (!(ecxe & (1U << 0)))
+		return 1;
+
+	xcr0 = stress_cpu_x86_xcr0();
+	ebx = 0, ecx7 = 0, edx = 0;
+	stress_cpu_x86_extended_features(ebx, ecx7, edx);
+	(void)ecx7;
+
+	/* avx, avx2, bmi1, bmi2, f16c, fma, lzcnt, movbe + xmm/ymm state */
+	if (((ecx1 & (CPUID_avx_ECX | CPUID_f16c_ECX | CPUID_fma_ECX | CPUID_movbe_ECX)) !=
+		     (CPUID_avx_ECX | CPUID_f16c_ECX | CPUID_fma_ECX | CPUID_movbe_ECX)) ||
+	    ((ebx & (CPUID_avx2_EBX | CPUID_bmi1_EBX | CPUID_bmi2_EBX)) !=
+		    (CPUID_avx2_EBX | CPUID_bmi1_EBX | CPUID_bmi2_EBX)) ||
+	    !(ecxe & (1U << 5)) ||
+	    ((xcr0 & 0x6) != 0x6))
+		return 2;
+
+	/* avx512 f, bw, cd, dq, vl + opmask/zmm state */
+	if (((ebx & (CPUID_avx512_f_EBX | CPUID_avx512_bw_EBX | CPUID_avx512_cd_EBX |
+		     CPUID_avx512_dq_EBX | CPUID_avx512_vl_EBX)) !=
+		    (CPUID_avx512_f_EBX | CPUID_avx512_bw_EBX | CPUID_avx512_cd_EBX |
+		     CPUID_avx512_dq_EBX | CPUID_avx512_vl_EBX)) ||
+	    ((xcr0 & 0xe6) != 0xe6))
+		return 3;
+
+	return 4;
+#else
+	return 0;
+#endif
+}
+
+/*
+ *  stress_cpu_arm_has_armv8_2()
+ *	does arm cpu support the armv8.2-a mandatory features that
+ *	the compiler may use (lse atomics, rdm, crc32, dc cvap)
+ */
+bool stress_cpu_arm_has_armv8_2(void)
+{
+#if defined(STRESS_ARCH_ARM) &&	\
+    defined(__aarch64__) &&		\
+    defined(HAVE_GETAUXVAL) &&		\
+    defined(HAVE_SYS_AUXV_H) &&		\
+    defined(HWCAP_ATOMICS) &&		\
+    defined(HWCAP_ASIMDRDM) &&		\
+    defined(HWCAP_CRC32) &&		\
+    defined(HWCAP_DCPOP)
+	const unsigned long int hwcap = getauxval(AT_HWCAP);
+	const unsigned long int mask = HWCAP_ATOMICS | HWCAP_ASIMDRDM |
+				       HWCAP_CRC32 | HWCAP_DCPOP;
+
+	return (hwcap & mask) == mask;
+#else
+	return false;
+#endif
+}
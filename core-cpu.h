@@ -23,6 +23,9 @@
 #include "core-arch.h"
 
 extern WARN_UNUSED bool stress_cpu_is_x86(void);
+extern WARN_UNUSED bool stress_cpu_x86_has_aes(void);
+extern WARN_UNUSED bool stress_cpu_x86_has_avx2(void);
+extern WARN_UNUSED bool stress_cpu_x86_has_avx512_f(void);
 extern WARN_UNUSED bool stress_cpu_x86_has_avx_vnni(void);
 extern WARN_UNUSED bool stress_cpu_x86_has_avx512_vl(void);
 extern WARN_UNUSED bool stress_cpu_x86_has_avx512_vnni(void);
@@ -38,10 +41,23 @@ extern WARN_UNUSED bool stress_cpu_x86_has_rdrand(void);
 extern WARN_UNUSED bool stress_cpu_x86_has_rdseed(void);
 extern WARN_UNUSED bool stress_cpu_x86_has_rdtscp(void);
 extern WARN_UNUSED bool stress_cpu_x86_has_serialize(void);
+extern WARN_UNUSED bool stress_cpu_x86_has_erms(void);
+extern WARN_UNUSED bool stress_cpu_x86_has_fma(void);
+extern WARN_UNUSED bool stress_cpu_x86_has_fsrm(void);
 extern WARN_UNUSED bool stress_cpu_x86_has_sse(void);
 extern WARN_UNUSED bool stress_cpu_x86_has_sse2(void);
+extern WARN_UNUSED bool stress_cpu_x86_has_sse4_2(void);
+extern WARN_UNUSED bool stress_cpu_x86_has_pclmulqdq(void);
 extern WARN_UNUSED bool stress_cpu_x86_has_syscall(void);
 extern WARN_UNUSED bool stress_cpu_x86_has_tsc(void);
+extern WARN_UNUSED bool stress_cpu_x86_has_vaes(void);
 extern WARN_UNUSED bool stress_cpu_x86_has_waitpkg(void);
+extern WARN_UNUSED int stress_cpu_x86_isa_level(void);
+extern WARN_UNUSED bool stress_cpu_arm_has_aes(void);
+extern WARN_UNUSED bool stress_cpu_arm_has_neon(void);
+extern WARN_UNUSED bool stress_cpu_arm_has_sve(void);
+extern WARN_UNUSED bool stress_cpu_arm_has_crc32(void);
+extern WARN_UNUSED bool stress_cpu_arm_has_dcpop(void);
+extern WARN_UNUSED bool stress_cpu_arm_has_armv8_2(void);
 
 #endif
@@ -27,6 +27,11 @@
 static cpu_cstate_t *cpu_cstate_list;
 static size_t cpu_cstate_list_len;
 
+/* shared per stressor per CPU C-state stats */
+static stress_cstate_cpu_t *cstates_cpu;
+static size_t cstates_cpu_size;
+static int32_t cstates_cpus;
+
 #if defined(STRESS_ARCH_X86)
 static char *busy_state = "C0";
 #else
@@ -179,6 +184,176 @@ void stress_cpuidle_free(void)
 	}
 	cpu_cstate_list = NULL;
 	cpu_cstate_list_len = 0;
+
+	if (cstates_cpu) {
+		(void)munmap((void *)cstates_cpu, cstates_cpu_size);
+		cstates_cpu = NULL;
+	}
+}
+
+/*
+ *  stress_cpuidle_percpu_init()
+ *	allocate shared per CPU C-state stats for each stressor
+ */
+void stress_cpuidle_percpu_init(stress_stressor_t *stressors_list)
+{
+	stress_stressor_t *ss;
+	size_t n;
+
+	cstates_cpus = stress_get_processors_configured();
+	if ((cstates_cpus < 1) || (cpu_cstate_list_len < 1))
+		return;
+
+	for (n = 0, ss = stressors_list; ss; ss = ss->next)
+		n++;
+	if (n == 0)
+		return;
+
+	cstates_cpu_size = n * (size_t)cstates_cpus * sizeof(*cstates_cpu);
+	cstates_cpu = (stress_cstate_cpu_t *)mmap(NULL, cstates_cpu_size,
+		PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANON, -1, 0);
+	if (cstates_cpu == MAP_FAILED) {
+		pr_inf("C-states: cannot mmap per CPU C-state stats, errno=%d (%s)\n",
+			errno, strerror(errno));
+		cstates_cpu = NULL;
+		return;
+	}
+	stress_set_vma_anon_name(cstates_cpu, cstates_cpu_size, "cstates-percpu");
+
+	for (n = 0, ss = stressors_list; ss; ss = ss->next, n++)
+		ss->cstates_cpu = cstates_cpu + (n * (size_t)cstates_cpus);
+}
+
+#if defined(__linux__)
+/*
+ *  stress_cpuidle_percpu_read()
+ *	read the C-state time (microseconds) and usage counts of a CPU,
+ *	returns false if the CPU has no C-states
+ */
+static bool stress_cpuidle_percpu_read(
+	const int32_t cpu,
+	double *residency,
+	uint64_t *usage)
+{
+	int state;
+	bool valid = false;
+
+	for (state = 0; state < STRESS_CSTATES_MAX * 2; state++) {
+		char path[PATH_MAX], cstate[64], data[64], *ptr;
+		uint64_t cstate_time, cstate_usage;
+		cpu_cstate_t *cc;
+		size_t i;
+
+		(void)snprintf(path, sizeof(path),
+			"/sys/devices/system/cpu/cpu%" PRId32 "/cpuidle/state%d/name", cpu, state);
+		if (stress_system_read(path, cstate, sizeof(cstate)) < 1)
+			break;
+		ptr = strchr(cstate, '\n');
+		if (ptr)
+			*ptr = '\0';
+
+		(void)snprintf(path, sizeof(path),
+			"/sys/devices/system/cpu/cpu%" PRId32 "/cpuidle/state%d/time", cpu, state);
+		if ((stress_system_read(path, data, sizeof(data)) < 1) ||
+		    (sscanf(data, "%" SCNu64, &cstate_time) != 1))
+			continue;
+		(void)snprintf(path, sizeof(path),
+			"/sys/devices/system/cpu/cpu%" PRId32 "/cpuidle/state%d/usage", cpu, state);
+		if ((stress_system_read(path, data, sizeof(data)) < 1) ||
+		    (sscanf(data, "%" SCNu64, &cstate_usage) != 1))
+			cstate_usage = 0;
+
+		for (i = 0, cc = cpu_cstate_list; (i < STRESS_CSTATES_MAX) && cc; i++, cc = cc->next) {
+			if (strcmp(cc->cstate, cstate) == 0) {
+				residency[i] += (double)cstate_time;
+				usage[i] += cstate_usage;
+				valid = true;
+				break;
+			}
+		}
+	}
+	return valid;
+}
+#endif
+
+/*
+ *  stress_cpuidle_percpu_begin()
+ *	mark the stressor instance affinity CPUs and for instance 0
+ *	snapshot the per CPU C-state residencies and usage counts
+ */
+void stress_cpuidle_percpu_begin(stress_stressor_t *ss, const uint32_t instance)
+{
+#if defined(__linux__)
+	stress_cstate_cpu_t *cpus;
+	int32_t cpu;
+	const double now = stress_time_now();
+#if defined(HAVE_SCHED_GETAFFINITY)
+	cpu_set_t mask;
+	const bool has_mask = (sched_getaffinity(0, sizeof(mask), &mask) == 0);
+#endif
+
+	if (!ss || !ss->cstates_cpu)
+		return;
+	cpus = ss->cstates_cpu;
+
+	for (cpu = 0; cpu < cstates_cpus; cpu++) {
+#if defined(HAVE_SCHED_GETAFFINITY)
+		if (has_mask && (cpu < CPU_SETSIZE) && CPU_ISSET(cpu, &mask))
+			cpus[cpu].affinity = true;
+#endif
+		if (instance != 0)
+			continue;
+		(void)shim_memset(cpus[cpu].residency, 0, sizeof(cpus[cpu].residency));
+		(void)shim_memset(cpus[cpu].usage, 0, sizeof(cpus[cpu].usage));
+		/* valid is only set once the run has completed */
+		cpus[cpu].valid = false;
+		cpus[cpu].time = stress_cpuidle_percpu_read(cpu,
+			cpus[cpu].residency, cpus[cpu].usage) ? now : 0.0;
+	}
+#else
+	(void)ss;
+	(void)instance;
+#endif
+}
+
+/*
+ *  stress_cpuidle_percpu_end()
+ *	for instance 0 convert the per CPU C-state snapshot into
+ *	deltas over the run
+ */
+void stress_cpuidle_percpu_end(stress_stressor_t *ss, const uint32_t instance)
+{
+#if defined(__linux__)
+	stress_cstate_cpu_t *cpus;
+	int32_t cpu;
+	const double now = stress_time_now();
+
+	if (!ss || !ss->cstates_cpu || (instance != 0))
+		return;
+	cpus = ss->cstates_cpu;
+
+	for (cpu = 0; cpu < cstates_cpus; cpu++) {
+		double residency[STRESS_CSTATES_MAX];
+		uint64_t usage[STRESS_CSTATES_MAX];
+		size_t i;
+
+		if (cpus[cpu].time <= 0.0)
+			continue;
+		(void)shim_memset(residency, 0, sizeof(residency));
+		(void)shim_memset(usage, 0, sizeof(usage));
+		if (!stress_cpuidle_percpu_read(cpu, residency, usage))
+			continue;
+		for (i = 0; i < STRESS_CSTATES_MAX; i++) {
+			cpus[cpu].residency[i] = residency[i] - cpus[cpu].residency[i];
+			cpus[cpu].usage[i] = usage[i] - cpus[cpu].usage[i];
+		}
+		cpus[cpu].time = now - cpus[cpu].time;
+		cpus[cpu].valid = true;
+	}
+#else
+	(void)ss;
+	(void)instance;
+#endif
 }
 
 static void stress_cpuidle_read_cstates(
@@ -278,6 +453,75 @@ void stress_cpuidle_read_cstates_end(stress_cstate_stats_t *cstate_stats)
 	stress_cpuidle_read_cstates(1, cstate_stats);
 }
 
+/*
+ *  stress_cpuidle_percpu_dump()
+ *	dump per CPU C-state residency (%) heatmap and C-state transition
+ *	rates, CPUs in the stressor affinity set are marked with a *,
+ *	--c-states-affinity restricts the report to these CPUs
+ */
+static void stress_cpuidle_percpu_dump(FILE *yaml, const stress_stressor_t *ss)
+{
+	const stress_cstate_cpu_t *cpus = ss->cstates_cpu;
+	bool affinity_only = false, heading = false;
+	int32_t cpu;
+
+	if (!cpus)
+		return;
+	(void)stress_get_setting("c-states-affinity", &affinity_only);
+
+	for (cpu = 0; cpu < cstates_cpus; cpu++) {
+		char buf[16 + (STRESS_CSTATES_MAX * 7)];
+		const cpu_cstate_t *cc;
+		double busy = 100.0, transitions = 0.0;
+		size_t i;
+
+		if (!cpus[cpu].valid || (cpus[cpu].time <= 0.0))
+			continue;
+		if (affinity_only && !cpus[cpu].affinity)
+			continue;
+
+		if (!heading) {
+			(void)shim_strscpy(buf, "", sizeof(buf));
+			for (i = 0, cc = cpu_cstate_list; (i < STRESS_CSTATES_MAX) && cc; i++, cc = cc->next) {
+				char tmp[8];
+
+				(void)snprintf(tmp, sizeof(tmp), " %6.6s", cc->cstate);
+				(void)shim_strlcat(buf, tmp, sizeof(buf));
+			}
+			pr_inf(" per CPU C-state residency (%%), * = affinity CPU:\n");
+			pr_inf(" CPU  %s  trans/s\n", buf);
+			pr_yaml(yaml, "      per-cpu:\n");
+			heading = true;
+		}
+
+		for (i = 0, cc = cpu_cstate_list; (i < STRESS_CSTATES_MAX) && cc; i++, cc = cc->next) {
+			if (strcmp(cc->cstate, busy_state))
+				busy -= 100.0 * cpus[cpu].residency[i] / (STRESS_DBL_MICROSECOND * cpus[cpu].time);
+			transitions += (double)cpus[cpu].usage[i];
+		}
+		if (busy < 0.0)
+			busy = 0.0;
+
+		pr_yaml(yaml, "        - cpu: %" PRId32 "\n", cpu);
+		pr_yaml(yaml, "          affinity: %s\n", cpus[cpu].affinity ? "true" : "false");
+		(void)shim_strscpy(buf, "", sizeof(buf));
+		for (i = 0, cc = cpu_cstate_list; (i < STRESS_CSTATES_MAX) && cc; i++, cc = cc->next) {
+			char tmp[8];
+			const double residency = (strcmp(cc->cstate, busy_state) == 0) ? busy :
+				100.0 * cpus[cpu].residency[i] / (STRESS_DBL_MICROSECOND * cpus[cpu].time);
+
+			(void)snprintf(tmp, sizeof(tmp), " %6.2f", residency);
+			(void)shim_strlcat(buf, tmp, sizeof(buf));
+			pr_yaml(yaml, "          %s: %.2f\n", cc->cstate, residency);
+			if (strcmp(cc->cstate, busy_state))
+				pr_yaml(yaml, "          %s-transitions-per-sec: %.2f\n", cc->cstate,
+					(double)cpus[cpu].usage[i] / cpus[cpu].time);
+		}
+		pr_inf(" %3" PRId32 "%c %s %8.1f\n", cpu, cpus[cpu].affinity ? '*' : ' ',
+			buf, transitions / cpus[cpu].time);
+	}
+}
+
 void stress_cpuidle_dump(FILE *yaml, stress_stressor_t *stressors_list)
 {
 	stress_stressor_t *ss;
@@ -320,6 +564,7 @@ void stress_cpuidle_dump(FILE *yaml, stress_stressor_t *stressors_list)
 				pr_inf(" %-5.5s %6.2f%%\n", cc->cstate, residencies[i]);
 				pr_yaml(yaml, "      %s: %.2f\n", cc->cstate, residencies[i]);
 			}
+			stress_cpuidle_percpu_dump(yaml, ss);
 			pr_yaml(yaml, "\n");
 		}
 	}
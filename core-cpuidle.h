@@ -34,6 +34,9 @@ extern cpu_cstate_t *stress_cpuidle_cstate_list_head(void);
 
 extern void stress_cpuidle_read_cstates_begin(stress_cstate_stats_t *cstate_stats);
 extern void stress_cpuidle_read_cstates_end(stress_cstate_stats_t *cstate_stats);
+extern void stress_cpuidle_percpu_init(stress_stressor_t *stressors_list);
+extern void stress_cpuidle_percpu_begin(stress_stressor_t *ss, const uint32_t instance);
+extern void stress_cpuidle_percpu_end(stress_stressor_t *ss, const uint32_t instance);
 extern void stress_cpuidle_dump(FILE *yaml, stress_stressor_t *stressors_list);
 
 #endif
@@ -0,0 +1,109 @@
+/*
+ * Copyright (C) 2025      Colin Ian King.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+#include "stress-ng.h"
+#include "core-ebr.h"
+
+#if defined(STRESS_EBR)
+/*
+ *  stress_ebr_init()
+ *	initialize a reclamation domain for threads_n threads,
+ *	returns -1 if the thread state cannot be allocated
+ */
+int stress_ebr_init(stress_ebr_t *ebr, const size_t threads_n)
+{
+	ebr->epoch = 0;
+	ebr->threads_n = threads_n;
+	ebr->threads = (stress_ebr_thread_t *)calloc(threads_n, sizeof(*ebr->threads));
+	return ebr->threads ? 0 : -1;
+}
+
+/*
+ *  stress_ebr_free_list()
+ *	free a list of retired nodes
+ */
+void stress_ebr_free_list(stress_ebr_node_t *node)
+{
+	while (node) {
+		stress_ebr_node_t *next = node->retired;
+
+		free(node);
+		node = next;
+	}
+}
+
+/*
+ *  stress_ebr_free()
+ *	free all the retired nodes and the thread state
+ */
+void stress_ebr_free(stress_ebr_t *ebr)
+{
+	size_t i, k;
+
+	if (!ebr->threads)
+		return;
+	for (i = 0; i < ebr->threads_n; i++) {
+		for (k = 0; k < STRESS_EBR_EPOCHS; k++)
+			stress_ebr_free_list(ebr->threads[i].limbo[k]);
+	}
+	free(ebr->threads);
+	ebr->threads = NULL;
+	ebr->threads_n = 0;
+}
+
+/*
+ *  stress_ebr_try_advance()
+ *	advance the global epoch if all active threads have observed it
+ */
+void stress_ebr_try_advance(stress_ebr_t *ebr)
+{
+	uint64_t e = __atomic_load_n(&ebr->epoch, __ATOMIC_SEQ_CST);
+	size_t i;
+
+	for (i = 0; i < ebr->threads_n; i++) {
+		const stress_ebr_thread_t *t = &ebr->threads[i];
+
+		if (__atomic_load_n(&t->active, __ATOMIC_SEQ_CST) &&
+		    (__atomic_load_n(&t->epoch, __ATOMIC_SEQ_CST) != e))
+			return;
+	}
+	(void)__atomic_compare_exchange_n(&ebr->epoch, &e, e + 1, false,
+		__ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+}
+
+/*
+ *  stress_ebr_retire()
+ *	retire an unlinked node in the current global epoch, the
+ *	node starts with a stress_ebr_node_t and is freed with free()
+ */
+void stress_ebr_retire(stress_ebr_t *ebr, stress_ebr_thread_t *t, void *node)
+{
+	const uint64_t e = __atomic_load_n(&ebr->epoch, __ATOMIC_SEQ_CST);
+	const size_t i = (size_t)(e % STRESS_EBR_EPOCHS);
+	stress_ebr_node_t *n = (stress_ebr_node_t *)node;
+
+	if (t->limbo_epoch[i] != e) {
+		/* bucket holds nodes at least STRESS_EBR_EPOCHS epochs old */
+		stress_ebr_free_list(t->limbo[i]);
+		t->limbo[i] = NULL;
+		t->limbo_epoch[i] = e;
+	}
+	n->retired = t->limbo[i];
+	t->limbo[i] = n;
+}
+#endif
@@ -0,0 +1,95 @@
+/*
+ * Copyright (C) 2025      Colin Ian King.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+#ifndef CORE_EBR_H
+#define CORE_EBR_H
+
+#include "core-attribute.h"
+
+/*
+ *  Epoch based reclamation, a node retired in global epoch e is
+ *  freed once the global epoch reaches e + 2 as by then all threads
+ *  that could have a reference to it have finished their ops.
+ */
+#if defined(HAVE_ATOMIC_COMPARE_EXCHANGE) &&	\
+    defined(HAVE_ATOMIC_LOAD) &&		\
+    defined(HAVE_ATOMIC_STORE)
+#define STRESS_EBR
+#endif
+
+#define STRESS_EBR_EPOCHS	(3)
+
+/* retired list link, must be the first member of a reclaimed node */
+typedef struct stress_ebr_node {
+	struct stress_ebr_node *retired;	/* next node on a retired list */
+} stress_ebr_node_t;
+
+/* per thread epoch state */
+typedef struct {
+	uint64_t epoch;			/* epoch observed at op start */
+	uint32_t active;		/* non-zero when inside an op */
+	stress_ebr_node_t *limbo[STRESS_EBR_EPOCHS];	/* retired nodes per epoch */
+	uint64_t limbo_epoch[STRESS_EBR_EPOCHS];	/* epoch of retired nodes */
+} ALIGN64 stress_ebr_thread_t;
+
+/* reclamation domain shared by threads_n threads */
+typedef struct {
+	uint64_t epoch;			/* global epoch */
+	stress_ebr_thread_t *threads;	/* per thread state */
+	size_t threads_n;		/* number of threads */
+} stress_ebr_t;
+
+#if defined(STRESS_EBR)
+extern int stress_ebr_init(stress_ebr_t *ebr, const size_t threads_n);
+extern void stress_ebr_free(stress_ebr_t *ebr);
+extern void stress_ebr_free_list(stress_ebr_node_t *node);
+extern void stress_ebr_try_advance(stress_ebr_t *ebr);
+extern void stress_ebr_retire(stress_ebr_t *ebr, stress_ebr_thread_t *t, void *node);
+
+/*
+ *  stress_ebr_enter()
+ *	start an op, free retired nodes that are now two epochs old
+ */
+static inline void stress_ebr_enter(stress_ebr_t *ebr, stress_ebr_thread_t *t)
+{
+	uint64_t e;
+	size_t i;
+
+	__atomic_store_n(&t->active, 1, __ATOMIC_SEQ_CST);
+	e = __atomic_load_n(&ebr->epoch, __ATOMIC_SEQ_CST);
+	__atomic_store_n(&t->epoch, e, __ATOMIC_SEQ_CST);
+
+	for (i = 0; i < STRESS_EBR_EPOCHS; i++) {
+		if (t->limbo[i] && (t->limbo_epoch[i] + 2 <= e)) {
+			stress_ebr_free_list(t->limbo[i]);
+			t->limbo[i] = NULL;
+		}
+	}
+}
+
+/*
+ *  stress_ebr_exit()
+ *	end an op
+ */
+static inline void stress_ebr_exit(stress_ebr_thread_t *t)
+{
+	__atomic_store_n(&t->active, 0, __ATOMIC_RELEASE);
+}
+#endif
+
+#endif
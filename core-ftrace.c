@@ -22,10 +22,15 @@
 #include "core-builtin.h"
 #include "core-capabilities.h"
 #include "core-ftrace.h"
+#include "core-killpid.h"
 #include "core-mounts.h"
 
 #include <ctype.h>
 
+#if defined(HAVE_POLL_H)
+#include <poll.h>
+#endif
+
 #if defined(HAVE_SYS_TREE_H)
 #include <sys/tree.h>
 #endif
@@ -38,6 +43,814 @@
 #include <bsd/sys/tree.h>
 #endif
 
+#if defined(__linux__) &&	\
+    defined(HAVE_POLL_H)
+#define STRESS_FTRACE_RAW
+#endif
+
+/*
+ *  stress_ftrace_raw_enabled()
+ *	true if --ftrace-raw is used
+ */
+static bool stress_ftrace_raw_enabled(void)
+{
+	bool raw = false;
+
+	(void)stress_get_setting("ftrace-raw", &raw);
+	return raw;
+}
+
+#if defined(STRESS_FTRACE_RAW)
+
+#define FTRACE_RAW_FUNCS_MAX	(65536)		/* stressor + function hash table size */
+#define FTRACE_RAW_PIDS_MAX	(4096)		/* pid to stressor hash table size */
+#define FTRACE_RAW_NAMES_MAX	(256)		/* stressor names */
+#define FTRACE_RAW_TOP_MAX	(10)		/* functions reported per stressor */
+#define FTRACE_RAW_GAP_MAX_NS	(1000000)	/* max time attributed between calls */
+#define FTRACE_RAW_POLL_MS	(100)		/* ring buffer read interval */
+#define FTRACE_RAW_PPID_DEPTH	(8)		/* parent pid search depth */
+
+/* ring buffer event header type_len values */
+#define RB_TYPE_PADDING		(29)
+#define RB_TYPE_TIME_EXTEND	(30)
+#define RB_TYPE_TIME_STAMP	(31)
+#define RB_MISSED_FLAGS		(0xc0000000UL)
+
+/* pid and stressor name sent by the parent to the reader */
+typedef struct {
+	pid_t pid;
+	char name[60];
+} stress_ftrace_raw_msg_t;
+
+/* per stressor kernel function call count and time */
+typedef struct {
+	uint64_t ip;			/* function address, 0 = unused */
+	uint64_t count;			/* number of calls */
+	uint64_t time_ns;		/* time until next traced call */
+	uint32_t name;			/* stressor name index */
+} stress_ftrace_raw_func_t;
+
+/* pid to stressor name index cache */
+typedef struct {
+	pid_t pid;			/* 0 = unused */
+	int32_t name;			/* stressor name index, -1 = unknown */
+} stress_ftrace_raw_pid_t;
+
+/* per CPU ring buffer reader state */
+typedef struct {
+	int fd;				/* trace_pipe_raw fd */
+	uint64_t ts;			/* timestamp of previous event */
+	pid_t pid;			/* pid of previous event */
+	stress_ftrace_raw_func_t *func;	/* function of previous event */
+} stress_ftrace_raw_cpu_t;
+
+/* kernel text symbol */
+typedef struct {
+	uint64_t addr;
+	char *name;
+} stress_ftrace_raw_sym_t;
+
+/* binary layout of the ring buffer pages and function events */
+typedef struct {
+	size_t ts_offset;		/* page timestamp */
+	size_t commit_offset;		/* page commit (data length) */
+	size_t commit_size;
+	size_t data_offset;		/* page event data */
+	size_t page_size;		/* sub-buffer size */
+	uint16_t id;			/* function event type */
+	size_t pid_offset;		/* common_pid */
+	size_t ip_offset;		/* ip */
+} stress_ftrace_raw_layout_t;
+
+static pid_t ftrace_raw_pid = -1;	/* reader process */
+static int ftrace_raw_fd = -1;		/* write end of pipe to reader */
+static const char *ftrace_raw_path;	/* tracefs mount */
+static stress_ftrace_raw_layout_t ftrace_raw_layout;
+
+/* reader process state */
+static stress_ftrace_raw_func_t *raw_funcs;
+static stress_ftrace_raw_pid_t *raw_pids;
+static char *raw_names[FTRACE_RAW_NAMES_MAX];
+static size_t raw_names_n;
+static uint64_t raw_events, raw_dropped, raw_missed;
+
+/*
+ *  stress_ftrace_raw_get_path()
+ *	find the tracefs mount, returns NULL if not found
+ */
+static const char *stress_ftrace_raw_get_path(void)
+{
+	static const char * const paths[] = {
+		"/sys/kernel/tracing",
+		"/sys/kernel/debug/tracing",
+	};
+	size_t i;
+
+	for (i = 0; i < SIZEOF_ARRAY(paths); i++) {
+		char filename[PATH_MAX];
+
+		(void)snprintf(filename, sizeof(filename), "%s/per_cpu", paths[i]);
+		if (access(filename, R_OK) == 0)
+			return paths[i];
+	}
+	return NULL;
+}
+
+/*
+ *  stress_ftrace_raw_write()
+ *	write a string to a tracefs file
+ */
+static int stress_ftrace_raw_write(const char *file, const char *str)
+{
+	char filename[PATH_MAX];
+
+	(void)snprintf(filename, sizeof(filename), "%s/%s", ftrace_raw_path, file);
+	return (stress_system_write(filename, str, strlen(str)) < 0) ? -1 : 0;
+}
+
+/*
+ *  stress_ftrace_raw_field()
+ *	find the offset and size of a field in a tracefs format file
+ */
+static int stress_ftrace_raw_field(
+	const char *format,
+	const char *field,
+	size_t *offset,
+	size_t *size)
+{
+	const char *ptr = strstr(format, field);
+	unsigned int off, sz;
+
+	if (!ptr)
+		return -1;
+	ptr = strstr(ptr, "offset:");
+	if (!ptr || (sscanf(ptr, "offset:%u;%*[ \t]size:%u;", &off, &sz) != 2))
+		return -1;
+	*offset = (size_t)off;
+	*size = (size_t)sz;
+	return 0;
+}
+
+/*
+ *  stress_ftrace_raw_get_layout()
+ *	parse the ring buffer page header and function event
+ *	formats so that the binary ring buffer pages can be decoded
+ */
+static int stress_ftrace_raw_get_layout(stress_ftrace_raw_layout_t *layout)
+{
+	char filename[PATH_MAX], buf[4096];
+	const char *ptr;
+	size_t size, data_size;
+	unsigned int id;
+
+	(void)snprintf(filename, sizeof(filename), "%s/events/header_page", ftrace_raw_path);
+	if (stress_system_read(filename, buf, sizeof(buf)) <= 0)
+		return -1;
+	if ((stress_ftrace_raw_field(buf, " timestamp;", &layout->ts_offset, &size) < 0) ||
+	    (size != sizeof(uint64_t)))
+		return -1;
+	if ((stress_ftrace_raw_field(buf, " commit;", &layout->commit_offset, &layout->commit_size) < 0) ||
+	    ((layout->commit_size != sizeof(uint32_t)) && (layout->commit_size != sizeof(uint64_t))))
+		return -1;
+	if (stress_ftrace_raw_field(buf, " data;", &layout->data_offset, &data_size) < 0)
+		return -1;
+	layout->page_size = layout->data_offset + data_size;
+
+	(void)snprintf(filename, sizeof(filename), "%s/events/ftrace/function/format", ftrace_raw_path);
+	if (stress_system_read(filename, buf, sizeof(buf)) <= 0)
+		return -1;
+	ptr = strstr(buf, "ID:");
+	if (!ptr || (sscanf(ptr, "ID: %u", &id) != 1))
+		return -1;
+	layout->id = (uint16_t)id;
+	if ((stress_ftrace_raw_field(buf, " common_pid;", &layout->pid_offset, &size) < 0) ||
+	    (size != sizeof(int32_t)))
+		return -1;
+	if ((stress_ftrace_raw_field(buf, " ip;", &layout->ip_offset, &size) < 0) ||
+	    (size != sizeof(unsigned long int)))
+		return -1;
+	return 0;
+}
+
+/*
+ *  stress_ftrace_raw_name_add()
+ *	add a stressor name, return its index, -1 if full
+ */
+static int32_t stress_ftrace_raw_name_add(const char *name)
+{
+	size_t i;
+
+	for (i = 0; i < raw_names_n; i++) {
+		if (!strcmp(raw_names[i], name))
+			return (int32_t)i;
+	}
+	if (raw_names_n >= FTRACE_RAW_NAMES_MAX)
+		return -1;
+	raw_names[raw_names_n] = strdup(name);
+	if (!raw_names[raw_names_n])
+		return -1;
+	return (int32_t)raw_names_n++;
+}
+
+/*
+ *  stress_ftrace_raw_pid_slot()
+ *	find the pid cache slot for a pid, NULL if the cache is full
+ */
+static stress_ftrace_raw_pid_t *stress_ftrace_raw_pid_slot(const pid_t pid)
+{
+	size_t i, h = (size_t)pid % FTRACE_RAW_PIDS_MAX;
+
+	for (i = 0; i < FTRACE_RAW_PIDS_MAX; i++) {
+		stress_ftrace_raw_pid_t *p = &raw_pids[h];
+
+		if ((p->pid == pid) || (p->pid == 0))
+			return p;
+		h = (h + 1) % FTRACE_RAW_PIDS_MAX;
+	}
+	return NULL;
+}
+
+/*
+ *  stress_ftrace_raw_pid_name()
+ *	map a pid to a stressor name index, pids not registered by
+ *	the parent are children of stressor instances, so search
+ *	up the parent pids until a registered pid is found
+ */
+static int32_t stress_ftrace_raw_pid_name(const pid_t pid)
+{
+	stress_ftrace_raw_pid_t *p = stress_ftrace_raw_pid_slot(pid);
+	pid_t ppid = pid;
+	int32_t name = -1;
+	int depth;
+
+	if (!p)
+		return -1;
+	if (p->pid == pid)
+		return p->name;
+
+	for (depth = 0; depth < FTRACE_RAW_PPID_DEPTH; depth++) {
+		const stress_ftrace_raw_pid_t *pp;
+		char path[64], buf[512];
+		const char *ptr;
+		int val;
+
+		(void)snprintf(path, sizeof(path), "/proc/%" PRIdMAX "/stat", (intmax_t)ppid);
+		if (stress_system_read(path, buf, sizeof(buf)) <= 0)
+			break;
+		ptr = strrchr(buf, ')');
+		if (!ptr || (sscanf(ptr + 2, "%*c %d", &val) != 1) || (val <= 1))
+			break;
+		ppid = (pid_t)val;
+		pp = stress_ftrace_raw_pid_slot(ppid);
+		if (pp && (pp->pid == ppid)) {
+			name = pp->name;
+			break;
+		}
+	}
+	p->pid = pid;
+	p->name = name;
+	return name;
+}
+
+/*
+ *  stress_ftrace_raw_func()
+ *	find or add the stressor + function entry
+ */
+static stress_ftrace_raw_func_t *stress_ftrace_raw_func(const uint32_t name, const uint64_t ip)
+{
+	size_t i, h = (size_t)(((ip >> 4) ^ ((uint64_t)name * 0x9e3779b97f4a7c15ULL)) % FTRACE_RAW_FUNCS_MAX);
+
+	for (i = 0; i < FTRACE_RAW_FUNCS_MAX; i++) {
+		stress_ftrace_raw_func_t *f = &raw_funcs[h];
+
+		if (f->ip == 0) {
+			f->ip = ip;
+			f->name = name;
+			return f;
+		}
+		if ((f->ip == ip) && (f->name == name))
+			return f;
+		h = (h + 1) % FTRACE_RAW_FUNCS_MAX;
+	}
+	return NULL;
+}
+
+/*
+ *  stress_ftrace_raw_event()
+ *	account a function event, the time until the next event
+ *	of the same pid on the same CPU is attributed to the function
+ */
+static void stress_ftrace_raw_event(
+	stress_ftrace_raw_cpu_t *cpu,
+	const uint8_t *data,
+	const size_t len,
+	const uint64_t ts)
+{
+	const stress_ftrace_raw_layout_t *layout = &ftrace_raw_layout;
+	stress_ftrace_raw_func_t *f;
+	uint16_t type;
+	int32_t pid, name;
+	unsigned long int ip;
+
+	if (len < layout->ip_offset + sizeof(ip))
+		return;
+	(void)shim_memcpy(&type, data, sizeof(type));
+	if (type != layout->id)
+		return;
+	(void)shim_memcpy(&pid, data + layout->pid_offset, sizeof(pid));
+	(void)shim_memcpy(&ip, data + layout->ip_offset, sizeof(ip));
+	raw_events++;
+
+	if (cpu->func && (cpu->pid == (pid_t)pid) &&
+	    (ts > cpu->ts) && (ts - cpu->ts < FTRACE_RAW_GAP_MAX_NS))
+		cpu->func->time_ns += ts - cpu->ts;
+	cpu->func = NULL;
+	cpu->pid = (pid_t)pid;
+	cpu->ts = ts;
+
+	name = stress_ftrace_raw_pid_name((pid_t)pid);
+	if (name < 0)
+		return;
+	f = stress_ftrace_raw_func((uint32_t)name, (uint64_t)ip);
+	if (!f) {
+		raw_dropped++;
+		return;
+	}
+	f->count++;
+	cpu->func = f;
+}
+
+/*
+ *  stress_ftrace_raw_page()
+ *	decode the events in a binary ring buffer page
+ */
+static void stress_ftrace_raw_page(stress_ftrace_raw_cpu_t *cpu, const uint8_t *page, const size_t len)
+{
+	const stress_ftrace_raw_layout_t *layout = &ftrace_raw_layout;
+	const uint8_t *ptr, *end;
+	uint64_t ts, commit;
+
+	if (len < layout->data_offset)
+		return;
+	(void)shim_memcpy(&ts, page + layout->ts_offset, sizeof(ts));
+	if (layout->commit_size == sizeof(uint64_t)) {
+		(void)shim_memcpy(&commit, page + layout->commit_offset, sizeof(commit));
+	} else {
+		uint32_t commit32;
+
+		(void)shim_memcpy(&commit32, page + layout->commit_offset, sizeof(commit32));
+		commit = commit32;
+	}
+	if (commit & RB_MISSED_FLAGS)
+		raw_missed++;
+	commit &= ~(uint64_t)RB_MISSED_FLAGS;
+
+	ptr = page + layout->data_offset;
+	end = ptr + STRESS_MINIMUM(commit, len - layout->data_offset);
+	while (ptr + sizeof(uint32_t) <= end) {
+		uint32_t header, type_len, delta, array0 = 0;
+		size_t length;
+
+		(void)shim_memcpy(&header, ptr, sizeof(header));
+		type_len = header & 0x1f;
+		delta = header >> 5;
+		if (ptr + (2 * sizeof(uint32_t)) <= end)
+			(void)shim_memcpy(&array0, ptr + sizeof(uint32_t), sizeof(array0));
+
+		switch (type_len) {
+		case RB_TYPE_PADDING:
+			/* a zero delta padding event fills the rest of the page */
+			if (delta == 0)
+				return;
+			ts += delta;
+			ptr += sizeof(uint32_t) + array0;
+			break;
+		case RB_TYPE_TIME_EXTEND:
+			ts += delta + ((uint64_t)array0 << 27);
+			ptr += 2 * sizeof(uint32_t);
+			break;
+		case RB_TYPE_TIME_STAMP:
+			ts = (ts & ~((1ULL << 59) - 1)) | ((uint64_t)array0 << 27) | delta;
+			ptr += 2 * sizeof(uint32_t);
+			break;
+		case 0:
+			/* large event, length in array[0] includes itself */
+			if (array0 < sizeof(uint32_t))
+				return;
+			ts += delta;
+			length = array0 - sizeof(uint32_t);
+			if (ptr + (2 * sizeof(uint32_t)) + length > end)
+				return;
+			stress_ftrace_raw_event(cpu, ptr + (2 * sizeof(uint32_t)), length, ts);
+			ptr += sizeof(uint32_t) + array0;
+			break;
+		default:
+			ts += delta;
+			length = (size_t)type_len * sizeof(uint32_t);
+			if (ptr + sizeof(uint32_t) + length > end)
+				return;
+			stress_ftrace_raw_event(cpu, ptr + sizeof(uint32_t), length, ts);
+			ptr += sizeof(uint32_t) + length;
+			break;
+		}
+	}
+}
+
+/*
+ *  stress_ftrace_raw_drain()
+ *	read all the available pages from the per CPU ring buffers
+ */
+static void stress_ftrace_raw_drain(stress_ftrace_raw_cpu_t *cpus, const size_t n_cpus, uint8_t *page)
+{
+	size_t i;
+
+	for (i = 0; i < n_cpus; i++) {
+		ssize_t ret;
+
+		if (cpus[i].fd < 0)
+			continue;
+		while ((ret = read(cpus[i].fd, page, ftrace_raw_layout.page_size)) > 0)
+			stress_ftrace_raw_page(&cpus[i], page, (size_t)ret);
+	}
+}
+
+/*
+ *  stress_ftrace_raw_sym_cmp()
+ *	sort symbols by address
+ */
+static int stress_ftrace_raw_sym_cmp(const void *p1, const void *p2)
+{
+	const stress_ftrace_raw_sym_t *s1 = (const stress_ftrace_raw_sym_t *)p1;
+	const stress_ftrace_raw_sym_t *s2 = (const stress_ftrace_raw_sym_t *)p2;
+
+	if (s1->addr < s2->addr)
+		return -1;
+	return (s1->addr > s2->addr) ? 1 : 0;
+}
+
+/*
+ *  stress_ftrace_raw_func_cmp()
+ *	sort functions by stressor, descending time then count
+ */
+static int stress_ftrace_raw_func_cmp(const void *p1, const void *p2)
+{
+	const stress_ftrace_raw_func_t *f1 = (const stress_ftrace_raw_func_t *)p1;
+	const stress_ftrace_raw_func_t *f2 = (const stress_ftrace_raw_func_t *)p2;
+
+	if (f1->name != f2->name)
+		return (f1->name < f2->name) ? -1 : 1;
+	if (f1->time_ns != f2->time_ns)
+		return (f1->time_ns < f2->time_ns) ? 1 : -1;
+	if (f1->count != f2->count)
+		return (f1->count < f2->count) ? 1 : -1;
+	return 0;
+}
+
+/*
+ *  stress_ftrace_raw_syms_load()
+ *	load the kernel text symbols, sorted by address
+ */
+static stress_ftrace_raw_sym_t *stress_ftrace_raw_syms_load(size_t *n_syms)
+{
+	stress_ftrace_raw_sym_t *syms = NULL;
+	size_t n = 0, n_max = 0;
+	char buf[512];
+	FILE *fp;
+
+	*n_syms = 0;
+	fp = fopen("/proc/kallsyms", "r");
+	if (!fp)
+		return NULL;
+	while (fgets(buf, sizeof(buf), fp)) {
+		unsigned long long int addr;
+		char type, name[256];
+
+		if (sscanf(buf, "%llx %c %255s", &addr, &type, name) != 3)
+			continue;
+		if ((type != 't') && (type != 'T'))
+			continue;
+		if (n >= n_max) {
+			stress_ftrace_raw_sym_t *new_syms;
+
+			n_max = n_max ? n_max * 2 : 65536;
+			new_syms = (stress_ftrace_raw_sym_t *)realloc(syms, n_max * sizeof(*syms));
+			if (!new_syms)
+				break;
+			syms = new_syms;
+		}
+		syms[n].addr = (uint64_t)addr;
+		syms[n].name = strdup(name);
+		if (!syms[n].name)
+			break;
+		n++;
+	}
+	(void)fclose(fp);
+	if (syms)
+		qsort(syms, n, sizeof(*syms), stress_ftrace_raw_sym_cmp);
+	*n_syms = n;
+	return syms;
+}
+
+/*
+ *  stress_ftrace_raw_sym_name()
+ *	find the kernel function containing addr
+ */
+static const char *stress_ftrace_raw_sym_name(
+	const stress_ftrace_raw_sym_t *syms,
+	const size_t n_syms,
+	const uint64_t addr)
+{
+	size_t lo = 0, hi = n_syms;
+
+	while (lo < hi) {
+		const size_t mid = lo + ((hi - lo) / 2);
+
+		if (syms[mid].addr <= addr)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	/* kallsyms addresses are all zero without permission */
+	if ((lo == 0) || (syms[lo - 1].addr == 0))
+		return NULL;
+	return syms[lo - 1].name;
+}
+
+/*
+ *  stress_ftrace_raw_report()
+ *	report the kernel functions with the most time per stressor
+ */
+static void stress_ftrace_raw_report(void)
+{
+	stress_ftrace_raw_sym_t *syms;
+	size_t i, n = 0, n_syms;
+	uint32_t name = UINT32_MAX;
+	int top = 0;
+
+	for (i = 0; i < FTRACE_RAW_FUNCS_MAX; i++) {
+		if (raw_funcs[i].ip)
+			raw_funcs[n++] = raw_funcs[i];
+	}
+	qsort(raw_funcs, n, sizeof(*raw_funcs), stress_ftrace_raw_func_cmp);
+	syms = stress_ftrace_raw_syms_load(&n_syms);
+
+	pr_block_begin();
+	pr_inf("ftrace: %-13s %-36s %14s %14s\n", "stressor", "kernel function", "calls", "time (us)");
+	for (i = 0; i < n; i++) {
+		const stress_ftrace_raw_func_t *f = &raw_funcs[i];
+		const char *func_name;
+		char addr[32];
+
+		if (f->name != name) {
+			name = f->name;
+			top = 0;
+		}
+		if (top++ >= FTRACE_RAW_TOP_MAX)
+			continue;
+		func_name = syms ? stress_ftrace_raw_sym_name(syms, n_syms, f->ip) : NULL;
+		if (!func_name) {
+			(void)snprintf(addr, sizeof(addr), "0x%" PRIx64, f->ip);
+			func_name = addr;
+		}
+		pr_inf("ftrace: %-13s %-36.36s %14" PRIu64 " %14.2f\n",
+			raw_names[f->name], func_name, f->count, (double)f->time_ns / 1000.0);
+	}
+	pr_inf("ftrace: %" PRIu64 " function events, %zu stressor functions, %" PRIu64
+		" events dropped, %" PRIu64 " ring buffer pages with lost events\n",
+		raw_events, n, raw_dropped, raw_missed);
+	pr_block_end();
+
+	if (syms) {
+		for (i = 0; i < n_syms; i++)
+			free(syms[i].name);
+		free(syms);
+	}
+}
+
+/*
+ *  stress_ftrace_raw_reader()
+ *	ring buffer reader process, reads the binary per CPU ring
+ *	buffers during the run and receives the stressor pids from
+ *	the parent, the end of the run is signalled by the parent
+ *	closing the pipe
+ */
+static void NORETURN stress_ftrace_raw_reader(
+	const int fd,
+	stress_ftrace_raw_cpu_t *cpus,
+	const size_t n_cpus)
+{
+	uint8_t *page;
+
+	stress_parent_died_alarm();
+	stress_set_proc_name("stat [ftrace]");
+
+	page = (uint8_t *)malloc(ftrace_raw_layout.page_size);
+	raw_funcs = (stress_ftrace_raw_func_t *)calloc(FTRACE_RAW_FUNCS_MAX, sizeof(*raw_funcs));
+	raw_pids = (stress_ftrace_raw_pid_t *)calloc(FTRACE_RAW_PIDS_MAX, sizeof(*raw_pids));
+	if (!page || !raw_funcs || !raw_pids) {
+		pr_inf("ftrace: disabled, out of memory allocating ring buffer reader\n");
+		_exit(EXIT_FAILURE);
+	}
+
+	for (;;) {
+		struct pollfd pfd;
+		stress_ftrace_raw_msg_t msg;
+
+		stress_ftrace_raw_drain(cpus, n_cpus, page);
+
+		pfd.fd = fd;
+		pfd.events = POLLIN;
+		pfd.revents = 0;
+		if (poll(&pfd, 1, FTRACE_RAW_POLL_MS) <= 0)
+			continue;
+		if (read(fd, &msg, sizeof(msg)) == (ssize_t)sizeof(msg)) {
+			stress_ftrace_raw_pid_t *p = stress_ftrace_raw_pid_slot(msg.pid);
+
+			msg.name[sizeof(msg.name) - 1] = '\0';
+			if (p) {
+				p->pid = msg.pid;
+				p->name = stress_ftrace_raw_name_add(msg.name);
+			}
+			continue;
+		}
+		/* parent closed the pipe, tracing has stopped */
+		break;
+	}
+	stress_ftrace_raw_drain(cpus, n_cpus, page);
+	stress_ftrace_raw_report();
+	_exit(EXIT_SUCCESS);
+}
+
+/*
+ *  stress_ftrace_raw_start()
+ *	start the function tracer and a process to read the
+ *	binary per CPU ring buffers
+ */
+static int stress_ftrace_raw_start(void)
+{
+	stress_ftrace_raw_cpu_t *cpus;
+	const int32_t n_cpus = stress_get_processors_configured();
+	int32_t i;
+	int fds[2];
+
+	if (!stress_check_capability(SHIM_CAP_SYS_ADMIN)) {
+		pr_inf("ftrace: requires CAP_SYS_ADMIN capability for tracing\n");
+		return -1;
+	}
+	ftrace_raw_path = stress_ftrace_raw_get_path();
+	if (!ftrace_raw_path) {
+		pr_inf("ftrace: cannot find a mounted tracefs\n");
+		return -1;
+	}
+	if ((stress_ftrace_raw_write("tracing_on", "0") < 0) ||
+	    (stress_ftrace_raw_write("current_tracer", "nop") < 0)) {
+		pr_inf("ftrace: cannot configure tracing, errno=%d (%s)\n",
+			errno, strerror(errno));
+		return -1;
+	}
+	if (stress_ftrace_raw_get_layout(&ftrace_raw_layout) < 0) {
+		pr_inf("ftrace: cannot parse the ring buffer and function event formats\n");
+		return -1;
+	}
+
+	cpus = (stress_ftrace_raw_cpu_t *)calloc((size_t)n_cpus, sizeof(*cpus));
+	if (!cpus) {
+		pr_inf("ftrace: cannot allocate per CPU ring buffer readers\n");
+		return -1;
+	}
+	for (i = 0; i < n_cpus; i++) {
+		char filename[PATH_MAX];
+
+		(void)snprintf(filename, sizeof(filename), "%s/per_cpu/cpu%" PRId32 "/trace_pipe_raw",
+			ftrace_raw_path, i);
+		cpus[i].fd = open(filename, O_RDONLY | O_NONBLOCK);
+	}
+	if (pipe(fds) < 0) {
+		pr_inf("ftrace: pipe failed, errno=%d (%s)\n", errno, strerror(errno));
+		goto close_cpus;
+	}
+
+	/* fork the reader before tracing starts so that it is not traced */
+	ftrace_raw_pid = fork();
+	if (ftrace_raw_pid < 0) {
+		pr_inf("ftrace: fork failed, errno=%d (%s)\n", errno, strerror(errno));
+		(void)close(fds[0]);
+		(void)close(fds[1]);
+		goto close_cpus;
+	} else if (ftrace_raw_pid == 0) {
+		(void)close(fds[1]);
+		stress_ftrace_raw_reader(fds[0], cpus, (size_t)n_cpus);
+	}
+	(void)close(fds[0]);
+	ftrace_raw_fd = fds[1];
+	for (i = 0; i < n_cpus; i++) {
+		if (cpus[i].fd >= 0)
+			(void)close(cpus[i].fd);
+	}
+	free(cpus);
+
+	/* trace this process (to avoid tracing everything) and the stressors it forks */
+	(void)stress_ftrace_raw_write("set_ftrace_pid", " ");
+	{
+		char buf[32];
+
+		(void)snprintf(buf, sizeof(buf), "%" PRIdMAX, (intmax_t)getpid());
+		(void)stress_ftrace_raw_write("set_ftrace_pid", buf);
+	}
+	(void)stress_ftrace_raw_write("options/function-fork", "1");
+	if ((stress_ftrace_raw_write("current_tracer", "function") < 0) ||
+	    (stress_ftrace_raw_write("tracing_on", "1") < 0)) {
+		pr_inf("ftrace: cannot enable the function tracer, errno=%d (%s)\n",
+			errno, strerror(errno));
+		(void)close(ftrace_raw_fd);
+		ftrace_raw_fd = -1;
+		(void)stress_kill_pid_wait(ftrace_raw_pid, NULL);
+		ftrace_raw_pid = -1;
+		return -1;
+	}
+	return 0;
+
+close_cpus:
+	for (i = 0; i < n_cpus; i++) {
+		if (cpus[i].fd >= 0)
+			(void)close(cpus[i].fd);
+	}
+	free(cpus);
+	return -1;
+}
+
+/*
+ *  stress_ftrace_raw_add_pid()
+ *	trace a stressor pid and tell the reader which stressor it is
+ */
+static void stress_ftrace_raw_add_pid(const pid_t pid, const char *name)
+{
+	stress_ftrace_raw_msg_t msg;
+	char filename[PATH_MAX], buf[32];
+	int fd;
+
+	if ((ftrace_raw_fd < 0) || (pid <= 0))
+		return;
+
+	(void)snprintf(filename, sizeof(filename), "%s/set_ftrace_pid", ftrace_raw_path);
+	fd = open(filename, O_WRONLY | O_APPEND);
+	if (fd >= 0) {
+		(void)snprintf(buf, sizeof(buf), "%" PRIdMAX, (intmax_t)pid);
+		VOID_RET(ssize_t, write(fd, buf, strlen(buf)));
+		(void)close(fd);
+	}
+	if (!name)
+		return;
+	(void)shim_memset(&msg, 0, sizeof(msg));
+	msg.pid = pid;
+	(void)shim_strscpy(msg.name, name, sizeof(msg.name));
+	VOID_RET(ssize_t, write(ftrace_raw_fd, &msg, sizeof(msg)));
+}
+
+/*
+ *  stress_ftrace_raw_stop()
+ *	stop tracing, let the reader drain the ring buffers and
+ *	report, then restore the tracer settings
+ */
+static void stress_ftrace_raw_stop(void)
+{
+	if (ftrace_raw_fd < 0)
+		return;
+
+	(void)stress_ftrace_raw_write("tracing_on", "0");
+	(void)close(ftrace_raw_fd);
+	ftrace_raw_fd = -1;
+	if (ftrace_raw_pid > 0) {
+		int status;
+
+		(void)shim_waitpid(ftrace_raw_pid, &status, 0);
+		ftrace_raw_pid = -1;
+	}
+	(void)stress_ftrace_raw_write("current_tracer", "nop");
+	(void)stress_ftrace_raw_write("options/function-fork", "0");
+	(void)stress_ftrace_raw_write("set_ftrace_pid", " ");
+}
+
+#else
+
+static int stress_ftrace_raw_start(void)
+{
+	pr_inf("ftrace: --ftrace-raw is not implemented on this system: %s %s\n",
+		stress_get_uname_info(), stress_get_compiler());
+	return -1;
+}
+
+static void stress_ftrace_raw_add_pid(const pid_t pid, const char *name)
+{
+	(void)pid;
+	(void)name;
+}
+
+static void stress_ftrace_raw_stop(void)
+{
+}
+#endif
+
 #if defined(HAVE_LIB_BSD) &&		\
     defined(HAVE_BSD_SYS_TREE_H) &&	\
     defined(RB_ENTRY) &&		\
@@ -268,7 +1081,7 @@ static int stress_ftrace_parse_stat_files(const char *path, const bool start)
  *	if pid < 0 then tracing pids are all removed otherwise
  *	the pid is added to the tracing events
  */
-void stress_ftrace_add_pid(const pid_t pid)
+void stress_ftrace_add_pid(const pid_t pid, const char *name)
 {
 	char filename[PATH_MAX];
 	const char *path;
@@ -277,6 +1090,10 @@ void stress_ftrace_add_pid(const pid_t pid)
 
 	if (!(g_opt_flags & OPT_FLAGS_FTRACE))
 		return;
+	if (stress_ftrace_raw_enabled()) {
+		stress_ftrace_raw_add_pid(pid, name);
+		return;
+	}
 
 	path = stress_ftrace_get_debugfs_path();
 	if (!path)
@@ -306,6 +1123,8 @@ int stress_ftrace_start(void)
 
 	if (!(g_opt_flags & OPT_FLAGS_FTRACE))
 		return 0;
+	if (stress_ftrace_raw_enabled())
+		return stress_ftrace_raw_start();
 
 	RB_INIT(&rb_root);
 
@@ -326,8 +1145,8 @@ int stress_ftrace_start(void)
 			filename, errno, strerror(errno));
 		return -1;
 	}
-	stress_ftrace_add_pid(-1);
-	stress_ftrace_add_pid(getpid());
+	stress_ftrace_add_pid(-1, NULL);
+	stress_ftrace_add_pid(getpid(), NULL);
 	(void)snprintf(filename, sizeof(filename), "%s/tracing/function_profile_enabled", path);
 	if (stress_system_write(filename, "1", 1) < 0) {
 		pr_inf("ftrace: cannot enable function profiling, cannot write to '%s', errno=%d (%s)\n",
@@ -400,6 +1219,10 @@ void stress_ftrace_stop(void)
 
 	if (!(g_opt_flags & OPT_FLAGS_FTRACE))
 		return;
+	if (stress_ftrace_raw_enabled()) {
+		stress_ftrace_raw_stop();
+		return;
+	}
 
 	if (!tracing_enabled)
 		return;
@@ -408,7 +1231,7 @@ void stress_ftrace_stop(void)
 	if (!path)
 		return;
 
-	stress_ftrace_add_pid(-1);
+	stress_ftrace_add_pid(-1, NULL);
 	(void)snprintf(filename, sizeof(filename), "%s/tracing/function_profile_enabled", path);
 	if (stress_system_write(filename, "0", 1) < 0) {
 		pr_inf("ftrace: cannot disable function profiling, errno=%d (%s)\n",
@@ -423,9 +1246,10 @@ void stress_ftrace_stop(void)
 }
 
 #else
-void stress_ftrace_add_pid(const pid_t pid)
+void stress_ftrace_add_pid(const pid_t pid, const char *name)
 {
-	(void)pid;
+	if ((g_opt_flags & OPT_FLAGS_FTRACE) && stress_ftrace_raw_enabled())
+		stress_ftrace_raw_add_pid(pid, name);
 }
 
 void stress_ftrace_free(void)
@@ -436,6 +1260,8 @@ int stress_ftrace_start(void)
 {
 	if (!(g_opt_flags & OPT_FLAGS_FTRACE))
 		return 0;
+	if (stress_ftrace_raw_enabled())
+		return stress_ftrace_raw_start();
 	pr_inf("ftrace: this option is not implemented on this system: %s %s\n",
 		stress_get_uname_info(), stress_get_compiler());
 
@@ -444,5 +1270,7 @@ int stress_ftrace_start(void)
 
 void stress_ftrace_stop(void)
 {
+	if ((g_opt_flags & OPT_FLAGS_FTRACE) && stress_ftrace_raw_enabled())
+		stress_ftrace_raw_stop();
 }
 #endif
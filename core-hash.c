@@ -20,8 +20,36 @@
 #include "stress-ng.h"
 #include "core-attribute.h"
 #include "core-builtin.h"
+#include "core-cpu.h"
 #include "core-hash.h"
 #include "core-pragma.h"
+#include "core-target-clones.h"
+#include "core-vecmath.h"
+
+#if defined(HAVE_COMPILER_MUSL)
+#undef HAVE_IMMINTRIN_H
+#endif
+
+#if defined(STRESS_ARCH_X86_64) &&	\
+    defined(HAVE_IMMINTRIN_H) &&	\
+    (defined(HAVE_COMPILER_GCC) ||	\
+     defined(HAVE_COMPILER_CLANG) ||	\
+     defined(HAVE_COMPILER_ICX)) &&	\
+    !defined(HAVE_COMPILER_ICC)
+#include <immintrin.h>
+#define STRESS_HASH_CRC32C_X86
+#define TARGET_SSE42		__attribute__ ((target("sse4.2")))
+#define TARGET_SSE42_PCLMUL	__attribute__ ((target("sse4.2,pclmul")))
+#endif
+
+#if defined(STRESS_ARCH_ARM) &&			\
+    defined(__aarch64__) &&			\
+    (defined(HAVE_COMPILER_GCC_OR_MUSL) &&	\
+     NEED_GNUC(10, 0, 0))
+#include <arm_acle.h>
+#define STRESS_HASH_CRC32C_ARM
+#define TARGET_CRC		__attribute__ ((target("+crc")))
+#endif
 
 /*
  *  stress_hash_jenkin()
@@ -300,6 +328,209 @@ PRAGMA_UNROLL_N(4)
 	return ~crc;
 }
 
+/*
+ *  stress_hash_crc32c_update()
+ *	table driven crc32c update of crc over len bytes
+ */
+static inline uint32_t PURE OPTIMIZE3 stress_hash_crc32c_update(
+	register uint32_t crc,
+	register const uint8_t *data,
+	register size_t len)
+{
+PRAGMA_UNROLL_N(4)
+	while (len--)
+		crc = (crc >> 8) ^ crc32c_table[(crc ^ *data++) & 0xff];
+
+	return crc;
+}
+
+/*
+ *  stress_hash_crc32c_buf()
+ *	crc32c the Castagnoli CRC32 of a buffer,
+ *	lookup table implementation
+ */
+uint32_t PURE OPTIMIZE3 stress_hash_crc32c_buf(const uint8_t *data, const size_t len)
+{
+	return ~stress_hash_crc32c_update(~0U, data, len);
+}
+
+#if defined(STRESS_HASH_CRC32C_X86)
+/*
+ *  stress_hash_crc32c_x86_update()
+ *	crc32c update using the SSE4.2 crc32 instruction
+ */
+static inline uint32_t PURE TARGET_SSE42 stress_hash_crc32c_x86_update(
+	uint32_t crc,
+	const uint8_t *data,
+	size_t len)
+{
+	uint64_t crc64 = crc;
+
+	while (len >= sizeof(uint64_t)) {
+		uint64_t val;
+
+		(void)shim_memcpy(&val, data, sizeof(val));
+		crc64 = _mm_crc32_u64(crc64, val);
+		data += sizeof(val);
+		len -= sizeof(val);
+	}
+	crc = (uint32_t)crc64;
+	while (len--)
+		crc = _mm_crc32_u8(crc, *data++);
+
+	return crc;
+}
+
+/*
+ *  stress_hash_crc32c_fold()
+ *	fold 128 bits of x forward by the distance encoded
+ *	in k and add in the next 128 bits of data y
+ */
+static inline __m128i TARGET_SSE42_PCLMUL stress_hash_crc32c_fold(
+	const __m128i x,
+	const __m128i k,
+	const __m128i y)
+{
+	return _mm_xor_si128(_mm_xor_si128(_mm_clmulepi64_si128(x, k, 0x00),
+					   _mm_clmulepi64_si128(x, k, 0x11)), y);
+}
+
+/*
+ *  stress_hash_crc32c_pclmul_update()
+ *	crc32c update folding 4 x 128 bits at a time with carry-less
+ *	multiplies. Fold constants are reflect(x^(d +/- 32) mod P) << 1
+ *	for fold distances d of 512 and 128 bits. The final 128 bits
+ *	are reduced with the crc32 instruction.
+ */
+static uint32_t PURE TARGET_SSE42_PCLMUL OPTIMIZE3 stress_hash_crc32c_pclmul_update(
+	uint32_t crc,
+	const uint8_t *data,
+	size_t len)
+{
+	__m128i x0, x1, x2, x3, k;
+	uint8_t buf[16] ALIGNED(16);
+
+	if (len < 64)
+		return stress_hash_crc32c_x86_update(crc, data, len);
+
+	x0 = _mm_loadu_si128((const __m128i *)(const void *)(data + 0));
+	x1 = _mm_loadu_si128((const __m128i *)(const void *)(data + 16));
+	x2 = _mm_loadu_si128((const __m128i *)(const void *)(data + 32));
+	x3 = _mm_loadu_si128((const __m128i *)(const void *)(data + 48));
+	x0 = _mm_xor_si128(x0, _mm_cvtsi32_si128((int)crc));
+	data += 64;
+	len -= 64;
+
+	k = _mm_set_epi64x(0x9e4addf8LL, 0x740eef02LL);
+	while (len >= 64) {
+		x0 = stress_hash_crc32c_fold(x0, k, _mm_loadu_si128((const __m128i *)(const void *)(data + 0)));
+		x1 = stress_hash_crc32c_fold(x1, k, _mm_loadu_si128((const __m128i *)(const void *)(data + 16)));
+		x2 = stress_hash_crc32c_fold(x2, k, _mm_loadu_si128((const __m128i *)(const void *)(data + 32)));
+		x3 = stress_hash_crc32c_fold(x3, k, _mm_loadu_si128((const __m128i *)(const void *)(data + 48)));
+		data += 64;
+		len -= 64;
+	}
+
+	k = _mm_set_epi64x(0x14cd00bd6LL, 0xf20c0dfeLL);
+	x0 = stress_hash_crc32c_fold(x0, k, x1);
+	x0 = stress_hash_crc32c_fold(x0, k, x2);
+	x0 = stress_hash_crc32c_fold(x0, k, x3);
+	while (len >= 16) {
+		x0 = stress_hash_crc32c_fold(x0, k, _mm_loadu_si128((const __m128i *)(const void *)data));
+		data += 16;
+		len -= 16;
+	}
+
+	_mm_store_si128((__m128i *)(void *)buf, x0);
+	crc = stress_hash_crc32c_x86_update(0, buf, sizeof(buf));
+
+	return stress_hash_crc32c_x86_update(crc, data, len);
+}
+#endif
+
+#if defined(STRESS_HASH_CRC32C_ARM)
+/*
+ *  stress_hash_crc32c_arm_update()
+ *	crc32c update using the ARMv8 crc32c instructions
+ */
+static uint32_t PURE TARGET_CRC OPTIMIZE3 stress_hash_crc32c_arm_update(
+	uint32_t crc,
+	const uint8_t *data,
+	size_t len)
+{
+	while (len >= sizeof(uint64_t)) {
+		uint64_t val;
+
+		(void)shim_memcpy(&val, data, sizeof(val));
+		crc = __crc32cd(crc, val);
+		data += sizeof(val);
+		len -= sizeof(val);
+	}
+	while (len--)
+		crc = __crc32cb(crc, *data++);
+
+	return crc;
+}
+#endif
+
+/*
+ *  stress_hash_crc32c_hw_usable()
+ *	true if the crc32c instruction implementation can be used
+ */
+bool stress_hash_crc32c_hw_usable(void)
+{
+#if defined(STRESS_HASH_CRC32C_X86)
+	return stress_cpu_x86_has_sse4_2();
+#elif defined(STRESS_HASH_CRC32C_ARM)
+	return stress_cpu_arm_has_crc32();
+#else
+	return false;
+#endif
+}
+
+/*
+ *  stress_hash_crc32c_hw()
+ *	crc32c of a buffer using the crc32c instructions,
+ *	only call this if stress_hash_crc32c_hw_usable() is true
+ */
+uint32_t PURE stress_hash_crc32c_hw(const uint8_t *data, const size_t len)
+{
+#if defined(STRESS_HASH_CRC32C_X86)
+	return ~stress_hash_crc32c_x86_update(~0U, data, len);
+#elif defined(STRESS_HASH_CRC32C_ARM)
+	return ~stress_hash_crc32c_arm_update(~0U, data, len);
+#else
+	return stress_hash_crc32c_buf(data, len);
+#endif
+}
+
+/*
+ *  stress_hash_crc32c_pclmul_usable()
+ *	true if the carry-less multiply folding implementation can be used
+ */
+bool stress_hash_crc32c_pclmul_usable(void)
+{
+#if defined(STRESS_HASH_CRC32C_X86)
+	return stress_cpu_x86_has_sse4_2() && stress_cpu_x86_has_pclmulqdq();
+#else
+	return false;
+#endif
+}
+
+/*
+ *  stress_hash_crc32c_pclmul()
+ *	crc32c of a buffer using carry-less multiply folding,
+ *	only call this if stress_hash_crc32c_pclmul_usable() is true
+ */
+uint32_t PURE stress_hash_crc32c_pclmul(const uint8_t *data, const size_t len)
+{
+#if defined(STRESS_HASH_CRC32C_X86)
+	return ~stress_hash_crc32c_pclmul_update(~0U, data, len);
+#else
+	return stress_hash_crc32c_buf(data, len);
+#endif
+}
+
 /*
  *  stress_hash_adler32()
  *	Mark Adler 32 bit hash
@@ -681,6 +912,180 @@ PRAGMA_UNROLL_N(4)
 	return hash;
 }
 
+#define XXVEC_LANES		(8)
+#define XXVEC_STRIPE		(XXVEC_LANES * sizeof(uint64_t))
+#define XXVEC_STRIPES		(16)	/* stripes per scrambled block */
+#define XXVEC_PRIME32_1		(0x9e3779b1ULL)
+#define XXVEC_PRIME64_1		(0x9e3779b185ebca87ULL)
+
+/*
+ *  xxvec secret, generated using splitmix64 seeded
+ *  with 0x5a23bbc6f261eab7
+ */
+static const uint64_t ALIGN64 xxvec_secret[XXVEC_STRIPES + XXVEC_LANES] = {
+	0xc324c983625b136fULL, 0x86d3c864a07ef021ULL,
+	0xe118617da2acc18dULL, 0x923ba8fb965218adULL,
+	0xfa6b6f584598f792ULL, 0x0674b3265644c021ULL,
+	0x98fb458e9bfb017bULL, 0xe214c123c8b4c3b5ULL,
+	0xf565b06a86a7e825ULL, 0x61bfeccd585da342ULL,
+	0x07c13649fc006b8aULL, 0xc6ea28121020e335ULL,
+	0xd394f23c5e069533ULL, 0x5876d15bf2afa6deULL,
+	0x331511852bfb7aa5ULL, 0x463efe4e15c5f359ULL,
+	0x2663fdff6dbf9e30ULL, 0x4145b150b1bf8e35ULL,
+	0xadb3d64579ee40a7ULL, 0x6d498539f63040b0ULL,
+	0x88abf395f31e7972ULL, 0xe09dfa4fce5b9c51ULL,
+	0xcbcff150118196cbULL, 0xe325085f6e491052ULL,
+};
+
+#if defined(HAVE_VECMATH)
+typedef uint64_t stress_hash_xxvec_t __attribute__ ((vector_size(XXVEC_STRIPE)));
+#else
+typedef struct {
+	uint64_t lane[XXVEC_LANES];
+} stress_hash_xxvec_t;
+#endif
+
+/*
+ *  stress_hash_xxvec_stripes()
+ *	xxh3 style accumulate of n 64 byte stripes, each 64 bit lane
+ *	accumulates the 32 x 32 bit product of the keyed data in mul and
+ *	the raw data in add; add is swapped into the neighbouring lane
+ *	when the block is scrambled
+ */
+static void TARGET_CLONES OPTIMIZE3 stress_hash_xxvec_stripes(
+	stress_hash_xxvec_t *mul,
+	stress_hash_xxvec_t *add,
+	const uint8_t *data,
+	const size_t n)
+{
+	register size_t i;
+
+	for (i = 0; i < n; i++, data += XXVEC_STRIPE) {
+		stress_hash_xxvec_t d, k;
+
+		(void)shim_memcpy(&d, data, sizeof(d));
+		(void)shim_memcpy(&k, &xxvec_secret[i], sizeof(k));
+#if defined(HAVE_VECMATH)
+		k ^= d;
+		*mul += (k & 0xffffffffULL) * (k >> 32);
+		*add += d;
+#else
+		{
+			register size_t j;
+
+			for (j = 0; j < XXVEC_LANES; j++) {
+				const uint64_t dk = d.lane[j] ^ k.lane[j];
+
+				mul->lane[j] += (dk & 0xffffffffULL) * (dk >> 32);
+				add->lane[j] += d.lane[j];
+			}
+		}
+#endif
+	}
+}
+
+/*
+ *  stress_hash_xxvec_merge()
+ *	merge mul and swapped add lanes into acc
+ */
+static inline void stress_hash_xxvec_merge(
+	uint64_t acc[XXVEC_LANES],
+	const stress_hash_xxvec_t *mul,
+	const stress_hash_xxvec_t *add)
+{
+	uint64_t m[XXVEC_LANES], a[XXVEC_LANES];
+	size_t i;
+
+	(void)shim_memcpy(m, mul, sizeof(m));
+	(void)shim_memcpy(a, add, sizeof(a));
+	for (i = 0; i < XXVEC_LANES; i++)
+		acc[i] = m[i] + a[i ^ 1];
+}
+
+/*
+ *  stress_hash_xxvec_mul128_fold64()
+ *	64 x 64 bit multiply, xor high and low 64 bits of the product
+ */
+static inline uint64_t stress_hash_xxvec_mul128_fold64(const uint64_t a, const uint64_t b)
+{
+#if defined(HAVE_INT128_T)
+	const __uint128_t p = (__uint128_t)a * b;
+
+	return (uint64_t)p ^ (uint64_t)(p >> 64);
+#else
+	const uint64_t a_lo = a & 0xffffffffULL, a_hi = a >> 32;
+	const uint64_t b_lo = b & 0xffffffffULL, b_hi = b >> 32;
+	const uint64_t lo_lo = a_lo * b_lo;
+	const uint64_t hi_lo = a_hi * b_lo;
+	const uint64_t lo_hi = a_lo * b_hi;
+	const uint64_t hi_hi = a_hi * b_hi;
+	const uint64_t cross = (lo_lo >> 32) + (hi_lo & 0xffffffffULL) + lo_hi;
+	const uint64_t hi = hi_hi + (hi_lo >> 32) + (cross >> 32);
+	const uint64_t lo = (cross << 32) | (lo_lo & 0xffffffffULL);
+
+	return lo ^ hi;
+#endif
+}
+
+/*
+ *  stress_hash_xxvec64()
+ *	64 bit hash modelled on the xxh3 long input loop: eight 64 bit
+ *	lanes of independent multiply-accumulates over 64 byte stripes
+ *	that vectorize well, with a scramble every 1K block. This is not
+ *	bit compatible with xxh3.
+ */
+uint64_t PURE OPTIMIZE3 stress_hash_xxvec64(const uint8_t *data, const size_t len)
+{
+	static const stress_hash_xxvec_t zero;
+	stress_hash_xxvec_t mul, add;
+	uint64_t acc[XXVEC_LANES] = {
+		XXVEC_PRIME32_1, XXVEC_PRIME64_1, 0x3c6ef372fe94f82bULL, 0xa54ff53a5f1d36f1ULL,
+		0x510e527fade682d1ULL, 0x9b05688c2b3e6c1fULL, 0x1f83d9abfb41bd6bULL, 0x5be0cd19137e2179ULL,
+	};
+	const size_t block = XXVEC_STRIPE * XXVEC_STRIPES;
+	size_t i, n = len;
+	uint64_t h;
+	uint8_t tail[XXVEC_STRIPE] ALIGN64;
+
+	(void)shim_memcpy(&mul, acc, sizeof(mul));
+	add = zero;
+
+	while (n >= block) {
+		stress_hash_xxvec_stripes(&mul, &add, data, XXVEC_STRIPES);
+		data += block;
+		n -= block;
+
+		stress_hash_xxvec_merge(acc, &mul, &add);
+		for (i = 0; i < XXVEC_LANES; i++) {
+			acc[i] ^= acc[i] >> 47;
+			acc[i] ^= xxvec_secret[XXVEC_STRIPES + i];
+			acc[i] *= XXVEC_PRIME32_1;
+		}
+		(void)shim_memcpy(&mul, acc, sizeof(mul));
+		add = zero;
+	}
+	stress_hash_xxvec_stripes(&mul, &add, data, n / XXVEC_STRIPE);
+	data += n & ~(XXVEC_STRIPE - 1);
+	n &= (XXVEC_STRIPE - 1);
+	if (n) {
+		(void)shim_memset(tail, 0, sizeof(tail));
+		(void)shim_memcpy(tail, data, n);
+		stress_hash_xxvec_stripes(&mul, &add, tail, 1);
+	}
+	stress_hash_xxvec_merge(acc, &mul, &add);
+
+	h = (uint64_t)len * XXVEC_PRIME64_1;
+	for (i = 0; i < XXVEC_LANES; i += 2) {
+		h += stress_hash_xxvec_mul128_fold64(acc[i] ^ xxvec_secret[i + 3],
+						     acc[i + 1] ^ xxvec_secret[i + 4]);
+	}
+	h ^= h >> 37;
+	h *= 0x165667919e3779f9ULL;
+	h ^= h >> 32;
+
+	return h;
+}
+
 /*
  *  stress_hash_create()
  *	create a hash table with size of n base hash entries
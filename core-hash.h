@@ -47,6 +47,11 @@ extern WARN_UNUSED uint32_t stress_hash_coffin(const char *str);
 extern WARN_UNUSED uint32_t stress_hash_coffin32_be(const char *str, const size_t len);
 extern WARN_UNUSED uint32_t stress_hash_coffin32_le(const char *str, const size_t len);
 extern WARN_UNUSED uint32_t stress_hash_crc32c(const char *str);
+extern WARN_UNUSED uint32_t stress_hash_crc32c_buf(const uint8_t *data, const size_t len);
+extern WARN_UNUSED bool stress_hash_crc32c_hw_usable(void);
+extern WARN_UNUSED uint32_t stress_hash_crc32c_hw(const uint8_t *data, const size_t len);
+extern WARN_UNUSED bool stress_hash_crc32c_pclmul_usable(void);
+extern WARN_UNUSED uint32_t stress_hash_crc32c_pclmul(const uint8_t *data, const size_t len);
 extern WARN_UNUSED uint32_t stress_hash_djb2a(const char *str);
 extern WARN_UNUSED uint32_t stress_hash_fnv1a(const char *str);
 extern WARN_UNUSED uint32_t stress_hash_jenkin(const uint8_t *data, const size_t len);
@@ -67,5 +72,6 @@ extern WARN_UNUSED uint32_t stress_hash_sdbm(const char *str);
 extern WARN_UNUSED uint32_t stress_hash_x17(const char *str);
 extern WARN_UNUSED uint32_t stress_hash_sedgwick(const char *str);
 extern WARN_UNUSED uint32_t stress_hash_sobel(const char *str);
+extern WARN_UNUSED uint64_t stress_hash_xxvec64(const uint8_t *data, const size_t len);
 
 #endif
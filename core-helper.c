@@ -26,6 +26,7 @@
 #include "core-cpu-cache.h"
 #include "core-hash.h"
 #include "core-lock.h"
+#include "core-mmap.h"
 #include "core-numa.h"
 #include "core-pthread.h"
 #include "core-pragma.h"
@@ -726,6 +727,30 @@ int32_t stress_get_processors_configured(void)
 	return processors_configured;
 }
 
+/*
+ *  stress_get_processors_allowed()
+ *	get number of processors stress-ng is allowed to run on, this
+ *	is the cpuset size of the cgroup or the affinity mask, falling
+ *	back to the number of processors configured
+ */
+int32_t stress_get_processors_allowed(void)
+{
+	int32_t processors = stress_get_processors_configured();
+#if defined(HAVE_SCHED_GETAFFINITY) &&	\
+    defined(HAVE_CPU_SET_T)
+	cpu_set_t mask;
+
+	CPU_ZERO(&mask);
+	if (sched_getaffinity(0, sizeof(mask), &mask) == 0) {
+		const int32_t allowed = (int32_t)CPU_COUNT(&mask);
+
+		if ((allowed > 0) && (allowed < processors))
+			processors = allowed;
+	}
+#endif
+	return processors;
+}
+
 /*
  *  stress_get_ticks_per_second()
  *	get number of ticks perf second
@@ -746,6 +771,176 @@ int32_t stress_get_ticks_per_second(void)
 #endif
 }
 
+#if defined(__linux__)
+#define STRESS_CGROUP_MEM_LEVELS	(16)
+#define STRESS_CGROUP_MEM_UNLIMITED	(1ULL << 62)	/* v1 reports no limit as ~2^63 */
+
+/* cgroup levels of the cgroup of a process that limit memory */
+typedef struct {
+	pid_t pid;			/* process the levels were resolved for */
+	size_t n;			/* number of limiting levels */
+	const char *current;		/* memory usage file name */
+	char path[PATH_MAX + 32];	/* cgroup directory of the process */
+	struct {
+		size_t path_len;	/* length of path of the level */
+		uint64_t limit;		/* lowest memory limit of the level */
+	} level[STRESS_CGROUP_MEM_LEVELS];
+} stress_cgroup_mem_t;
+
+static stress_cgroup_mem_t cgroup_mem;
+
+/*
+ *  stress_cgroup_mem_read()
+ *	read a cgroup memory control file value, "max" is returned as
+ *	UINT64_MAX, returns false if the file cannot be read
+ */
+static bool stress_cgroup_mem_read(
+	const char *path,
+	const size_t path_len,
+	const char *filename,
+	uint64_t *value)
+{
+	char filepath[PATH_MAX + 64], buf[64];
+
+	(void)snprintf(filepath, sizeof(filepath), "%.*s/%s", (int)path_len, path, filename);
+	if (stress_system_read(filepath, buf, sizeof(buf)) <= 0)
+		return false;
+	if (!strncmp(buf, "max", 3)) {
+		*value = UINT64_MAX;
+		return true;
+	}
+	if (sscanf(buf, "%" SCNu64, value) != 1)
+		return false;
+	if (*value >= STRESS_CGROUP_MEM_UNLIMITED)
+		*value = UINT64_MAX;
+	return true;
+}
+
+/*
+ *  stress_cgroup_mem_resolve()
+ *	find the cgroup directory of the process and the levels of it
+ *	and its ancestors that have a memory limit. The cgroup v1 memory
+ *	controller is used if it is mounted (hybrid hierarchies), otherwise
+ *	the cgroup v2 memory.max and memory.high limits are used. This is
+ *	redone in child processes as they may have been moved to a
+ *	different cgroup by --stressor-cgroup
+ */
+static void stress_cgroup_mem_resolve(void)
+{
+	static const char root_v1[] = "/sys/fs/cgroup/memory";
+	static const char root_v2[] = "/sys/fs/cgroup";
+	const pid_t pid = getpid();
+	char buf[PATH_MAX], cgroup[PATH_MAX];
+	const char *root = NULL;
+	char *ptr;
+	size_t len, root_len;
+	FILE *fp;
+
+	if (cgroup_mem.pid == pid)
+		return;
+	cgroup_mem.pid = pid;
+	cgroup_mem.n = 0;
+
+	fp = fopen("/proc/self/cgroup", "r");
+	if (!fp)
+		return;
+	while (fgets(buf, sizeof(buf), fp)) {
+		ptr = strchr(buf, '\n');
+		if (ptr)
+			*ptr = '\0';
+		ptr = strchr(buf, ':');
+		if (!ptr)
+			continue;
+		ptr++;
+		if (!strncmp(ptr, "memory:", 7)) {
+			root = root_v1;
+			(void)shim_strscpy(cgroup, ptr + 7, sizeof(cgroup));
+			break;
+		} else if (!strncmp(buf, "0::", 3)) {
+			root = root_v2;
+			(void)shim_strscpy(cgroup, buf + 3, sizeof(cgroup));
+		}
+	}
+	(void)fclose(fp);
+	if (!root)
+		return;
+	if (root == root_v1) {
+		cgroup_mem.current = "memory.usage_in_bytes";
+	} else {
+		cgroup_mem.current = "memory.current";
+	}
+	root_len = strlen(root);
+	(void)snprintf(cgroup_mem.path, sizeof(cgroup_mem.path), "%s%s", root, cgroup);
+
+	/* walk from the cgroup of the process up to the (namespace) root */
+	len = strlen(cgroup_mem.path);
+	while ((len > root_len) && (cgroup_mem.path[len - 1] == '/'))
+		len--;
+	cgroup_mem.path[len] = '\0';
+	while ((len >= root_len) && (cgroup_mem.n < STRESS_CGROUP_MEM_LEVELS)) {
+		uint64_t mem_max = UINT64_MAX, mem_high = UINT64_MAX;
+
+		if (root == root_v1) {
+			(void)stress_cgroup_mem_read(cgroup_mem.path, len, "memory.limit_in_bytes", &mem_max);
+		} else {
+			(void)stress_cgroup_mem_read(cgroup_mem.path, len, "memory.max", &mem_max);
+			(void)stress_cgroup_mem_read(cgroup_mem.path, len, "memory.high", &mem_high);
+		}
+		mem_max = STRESS_MINIMUM(mem_max, mem_high);
+		if (mem_max != UINT64_MAX) {
+			cgroup_mem.level[cgroup_mem.n].path_len = len;
+			cgroup_mem.level[cgroup_mem.n].limit = mem_max;
+			cgroup_mem.n++;
+		}
+		if (len == root_len)
+			break;
+		for (ptr = cgroup_mem.path + len - 1; (ptr > cgroup_mem.path) && (*ptr != '/'); ptr--)
+			;
+		len = (size_t)(ptr - cgroup_mem.path);
+	}
+}
+
+/*
+ *  stress_get_cgroup_mem()
+ *	get the tightest cgroup memory limit of the process and the
+ *	memory still available under it, returns false if the cgroup
+ *	memory is not limited or cannot be determined
+ */
+bool stress_get_cgroup_mem(uint64_t *limit, uint64_t *available)
+{
+	size_t i;
+	bool limited = false;
+
+	stress_cgroup_mem_resolve();
+	*limit = UINT64_MAX;
+	*available = UINT64_MAX;
+
+	for (i = 0; i < cgroup_mem.n; i++) {
+		const size_t len = cgroup_mem.level[i].path_len;
+		const uint64_t level_limit = cgroup_mem.level[i].limit;
+		uint64_t current = 0, level_available;
+
+		if (!stress_cgroup_mem_read(cgroup_mem.path, len, cgroup_mem.current, &current))
+			current = 0;
+		level_available = (current < level_limit) ? level_limit - current : 0;
+
+		if (*limit > level_limit)
+			*limit = level_limit;
+		if (*available > level_available)
+			*available = level_available;
+		limited = true;
+	}
+	return limited;
+}
+#else
+bool stress_get_cgroup_mem(uint64_t *limit, uint64_t *available)
+{
+	*limit = UINT64_MAX;
+	*available = UINT64_MAX;
+	return false;
+}
+#endif
+
 /*
  *  stress_get_meminfo()
  *	wrapper for linux sysinfo
@@ -766,10 +961,20 @@ static int stress_get_meminfo(
 		(void)shim_memset(&info, 0, sizeof(info));
 
 		if (LIKELY(sysinfo(&info) == 0)) {
+			uint64_t limit, available;
+
 			*freemem = info.freeram * info.mem_unit;
 			*totalmem = info.totalram * info.mem_unit;
 			*freeswap = info.freeswap * info.mem_unit;
 			*totalswap = info.totalswap * info.mem_unit;
+
+			/* a cgroup memory limit caps what can be used */
+			if (stress_get_cgroup_mem(&limit, &available)) {
+				if ((uint64_t)*totalmem > limit)
+					*totalmem = (size_t)limit;
+				if ((uint64_t)*freemem > available)
+					*freemem = (size_t)available;
+			}
 			return 0;
 		}
 	}
@@ -1004,12 +1209,13 @@ update:
 
 /*
  *  stress_get_phys_mem_size()
- *	get size of physical memory still available, 0 if failed
+ *	get size of physical memory still available, capped by
+ *	the memory still available under a cgroup limit, 0 if failed
  */
 uint64_t stress_get_phys_mem_size(void)
 {
 #if defined(STRESS_SC_PAGES)
-	uint64_t phys_pages;
+	uint64_t phys_pages, limit, available;
 	const size_t page_size = stress_get_page_size();
 	const uint64_t max_pages = ~0ULL / page_size;
 	long int ret;
@@ -1023,6 +1229,9 @@ uint64_t stress_get_phys_mem_size(void)
 	/* Avoid overflow */
 	if (UNLIKELY(phys_pages > max_pages))
 		phys_pages = max_pages;
+	if (stress_get_cgroup_mem(&limit, &available) &&
+	    (available < phys_pages * page_size))
+		return available;
 	return phys_pages * page_size;
 #else
 	UNEXPECTED
@@ -5046,9 +5255,12 @@ void *stress_mmap_populate(
 	int fd,
 	off_t offset)
 {
-#if defined(MAP_POPULATE)
 	void *ret;
 
+	ret = stress_mmap_policy(addr, length, prot, flags, fd, offset, true);
+	if (ret != MAP_FAILED)
+		return ret;
+#if defined(MAP_POPULATE)
 	flags |= MAP_POPULATE;
 	ret = mmap(addr, length, prot, flags, fd, offset);
 	if (ret != MAP_FAILED)
@@ -53,6 +53,7 @@ extern size_t stress_mk_filename(char *fullname, const size_t fullname_len,
 extern size_t stress_get_page_size(void);
 extern WARN_UNUSED int32_t stress_get_processors_online(void);
 extern WARN_UNUSED int32_t stress_get_processors_configured(void);
+extern WARN_UNUSED int32_t stress_get_processors_allowed(void);
 extern WARN_UNUSED int32_t stress_get_ticks_per_second(void);
 extern void stress_get_memlimits(size_t *shmall, size_t *freemem,
 	size_t *totalmem, size_t *freeswap, size_t *totalswap);
@@ -60,6 +61,7 @@ extern void stress_get_gpu_freq_mhz(double *gpu_freq);
 extern void stress_ksm_memory_merge(const int flag);
 extern WARN_UNUSED bool stress_low_memory(const size_t requested);
 extern WARN_UNUSED uint64_t stress_get_phys_mem_size(void);
+extern bool stress_get_cgroup_mem(uint64_t *limit, uint64_t *available);
 extern WARN_UNUSED uint64_t stress_get_filesystem_size(void);
 extern WARN_UNUSED uint64_t stress_get_filesystem_available_inodes(void);
 extern WARN_UNUSED int stress_set_nonblock(const int fd);
@@ -18,6 +18,7 @@
  */
 #include "stress-ng.h"
 #include "core-arch.h"
+#include "core-builtin.h"
 #include "core-interrupts.h"
 
 #include <ctype.h>
@@ -52,6 +53,26 @@ static const stress_interrupt_info_t info[] = {
 
 STRESS_ASSERT(SIZEOF_ARRAY(info) <= STRESS_INTERRUPTS_MAX)
 
+typedef struct {
+	const char *file;		/* /proc file to parse */
+	const char *type;		/* row name, NULL = all numbered device IRQs */
+	const char *descr;		/* description of interrupt type */
+} stress_irq_dist_info_t;
+
+static const stress_irq_dist_info_t dist_info[] = {
+	{ "/proc/interrupts",	NULL,		"Device Interrupts" },
+	{ "/proc/softirqs",	"TIMER:",	"TIMER Softirqs" },
+	{ "/proc/softirqs",	"NET_TX:",	"NET_TX Softirqs" },
+	{ "/proc/softirqs",	"NET_RX:",	"NET_RX Softirqs" },
+	{ "/proc/softirqs",	"BLOCK:",	"BLOCK Softirqs" },
+};
+
+STRESS_ASSERT(SIZEOF_ARRAY(dist_info) <= STRESS_IRQ_DIST_MAX)
+
+/* per CPU counts at start of run, private to the stressor process */
+static uint64_t *dist_start;
+static int32_t dist_cpus;
+
 /*
  *  stress_interrupts_counter_set()
  *	set interrupts counter if it is value
@@ -144,6 +165,164 @@ static void stress_interrupts_count(stress_interrupts_t *counters, const int whi
 	(void)fclose(fp);
 }
 
+/*
+ *  stress_interrupts_dist_file()
+ *	read per CPU counts of interrupt types in dist_info[] that are
+ *	from the given /proc file into counts[type * cpus + cpu], the
+ *	CPU numbers of the columns are taken from the CPUn header
+ */
+static void stress_interrupts_dist_file(const char *file, uint64_t *counts, const int32_t cpus)
+{
+	FILE *fp;
+	char buffer[8192];
+	int32_t cpu_ids[1024];
+	size_t n_cols = 0;
+	char *ptr;
+
+	fp = fopen(file, "r");
+	if (UNLIKELY(!fp))
+		return;
+
+	/* header, list of online CPUs */
+	if (!fgets(buffer, sizeof(buffer), fp)) {
+		(void)fclose(fp);
+		return;
+	}
+	for (ptr = buffer; (ptr = strstr(ptr, "CPU")) != NULL; ) {
+		int32_t cpu;
+
+		ptr += 3;
+		if (sscanf(ptr, "%" SCNd32, &cpu) != 1)
+			continue;
+		if (n_cols >= SIZEOF_ARRAY(cpu_ids))
+			break;
+		cpu_ids[n_cols++] = cpu;
+	}
+
+	while (fgets(buffer, sizeof(buffer), fp)) {
+		size_t i, col;
+
+		ptr = buffer;
+		while (*ptr == ' ')
+			ptr++;
+
+		for (i = 0; i < SIZEOF_ARRAY(dist_info); i++) {
+			const char *type = dist_info[i].type;
+
+			if (strcmp(dist_info[i].file, file))
+				continue;
+			if (type) {
+				if (!strncmp(ptr, type, strlen(type))) {
+					ptr += strlen(type);
+					break;
+				}
+			} else if (isdigit((unsigned char)*ptr)) {
+				/* numbered device IRQ */
+				while (isdigit((unsigned char)*ptr))
+					ptr++;
+				if (*ptr == ':') {
+					ptr++;
+					break;
+				}
+			}
+		}
+		if (i >= SIZEOF_ARRAY(dist_info))
+			continue;
+
+		for (col = 0; col < n_cols; col++) {
+			uint64_t val;
+
+			while (*ptr == ' ')
+				ptr++;
+			if (!isdigit((unsigned char)*ptr))
+				break;
+			if ((sscanf(ptr, "%" SCNu64, &val) == 1) &&
+			    (cpu_ids[col] >= 0) && (cpu_ids[col] < cpus))
+				counts[(i * (size_t)cpus) + (size_t)cpu_ids[col]] += val;
+			while (isdigit((unsigned char)*ptr))
+				ptr++;
+		}
+	}
+	(void)fclose(fp);
+}
+
+/*
+ *  stress_interrupts_dist_count()
+ *	read per CPU counts of all the interrupt types in dist_info[]
+ */
+static void stress_interrupts_dist_count(uint64_t *counts, const int32_t cpus)
+{
+	(void)shim_memset(counts, 0, sizeof(*counts) * SIZEOF_ARRAY(dist_info) * (size_t)cpus);
+	stress_interrupts_dist_file("/proc/interrupts", counts, cpus);
+	stress_interrupts_dist_file("/proc/softirqs", counts, cpus);
+}
+
+/*
+ *  stress_interrupts_dist_start()
+ *	snapshot per CPU interrupt and softirq counts at start of run
+ */
+void stress_interrupts_dist_start(void)
+{
+	dist_cpus = stress_get_processors_configured();
+	if (dist_cpus < 1)
+		return;
+	dist_start = (uint64_t *)calloc(SIZEOF_ARRAY(dist_info) * (size_t)dist_cpus, sizeof(*dist_start));
+	if (!dist_start)
+		return;
+	stress_interrupts_dist_count(dist_start, dist_cpus);
+}
+
+/*
+ *  stress_interrupts_dist_stop()
+ *	compute the per CPU distribution of interrupts and softirqs
+ *	that occurred since stress_interrupts_dist_start()
+ */
+void stress_interrupts_dist_stop(stress_irq_dist_t *dist)
+{
+	uint64_t *dist_stop;
+	size_t i;
+
+	(void)shim_memset(dist, 0, sizeof(*dist) * STRESS_IRQ_DIST_MAX);
+	if (!dist_start)
+		return;
+	dist_stop = (uint64_t *)calloc(SIZEOF_ARRAY(dist_info) * (size_t)dist_cpus, sizeof(*dist_stop));
+	if (!dist_stop)
+		goto free_start;
+	stress_interrupts_dist_count(dist_stop, dist_cpus);
+
+	for (i = 0; i < SIZEOF_ARRAY(dist_info); i++) {
+		uint64_t max = 0;
+		int32_t cpu;
+
+		dist[i].busiest_cpu = -1;
+		for (cpu = 0; cpu < dist_cpus; cpu++) {
+			const size_t idx = (i * (size_t)dist_cpus) + (size_t)cpu;
+			const uint64_t delta = (dist_stop[idx] >= dist_start[idx]) ?
+				dist_stop[idx] - dist_start[idx] : 0;
+
+			if (delta == 0)
+				continue;
+			dist[i].total += delta;
+			dist[i].cpus++;
+			if (delta > max) {
+				max = delta;
+				dist[i].busiest_cpu = cpu;
+			}
+		}
+		if (dist[i].total > 0) {
+			const int32_t online = stress_get_processors_online();
+			const double mean = (double)dist[i].total / (double)((online > 0) ? online : dist_cpus);
+
+			dist[i].busiest_share = 100.0 * (double)max / (double)dist[i].total;
+			dist[i].imbalance = (double)max / mean;
+		}
+	}
+	free(dist_stop);
+free_start:
+	free(dist_start);
+	dist_start = NULL;
+}
+
 /*
  *  stress_interrupts_start()
  *	count interrupts at start of run
@@ -257,6 +436,48 @@ void stress_interrupts_dump(FILE *yaml, stress_stressor_t *stressors_list)
 				pr_nl = true;
 			}
 		}
+
+		/*
+		 *  interrupts are system wide so instances overlap, report
+		 *  the distribution seen by the instance with the most events
+		 */
+		for (i = 0; i < SIZEOF_ARRAY(dist_info); i++) {
+			const stress_irq_dist_t *dist = NULL;
+			int32_t j;
+
+			for (j = 0; j < ss->instances; j++) {
+				const stress_irq_dist_t *d = &ss->stats[j]->irq_dist[i];
+
+				if ((d->total > 0) && (!dist || (d->total > dist->total)))
+					dist = d;
+			}
+			if (dist) {
+				char munged[64];
+				const char *name = ss->stressor->name;
+
+				if (!pr_heading) {
+					pr_yaml(yaml, "interrupts:\n");
+					pr_heading = true;
+				}
+				if (!pr_name) {
+					pr_inf("%s:\n", name);
+					pr_yaml(yaml, "    - stressor: %s\n", name);
+					pr_name = true;
+				}
+				pr_inf("   %7" PRIu64 " %s on %" PRIu32 " CPU%s, busiest CPU %" PRId32
+					" %.1f%%, imbalance %.2f\n", dist->total, dist_info[i].descr,
+					dist->cpus, dist->cpus > 1 ? "s" : "", dist->busiest_cpu,
+					dist->busiest_share, dist->imbalance);
+				(void)shim_strscpy(munged, dist_info[i].descr, sizeof(munged));
+				stress_interrupt_tolower(munged);
+				pr_yaml(yaml, "      %s: %" PRIu64 "\n", munged, dist->total);
+				pr_yaml(yaml, "      %s_cpus: %" PRIu32 "\n", munged, dist->cpus);
+				pr_yaml(yaml, "      %s_busiest_cpu: %" PRId32 "\n", munged, dist->busiest_cpu);
+				pr_yaml(yaml, "      %s_busiest_cpu_percent: %.2f\n", munged, dist->busiest_share);
+				pr_yaml(yaml, "      %s_imbalance: %.3f\n", munged, dist->imbalance);
+				pr_nl = true;
+			}
+		}
 		if (pr_nl)
 			pr_yaml(yaml, "\n");
 	}
@@ -23,6 +23,8 @@
 
 extern void stress_interrupts_start(stress_interrupts_t *counters);
 extern void stress_interrupts_stop(stress_interrupts_t *counters);
+extern void stress_interrupts_dist_start(void);
+extern void stress_interrupts_dist_stop(stress_irq_dist_t *dist);
 extern void stress_interrupts_check_failure(const char *name,
 	stress_interrupts_t *counters, uint32_t instance, int *rc);
 extern void stress_interrupts_dump(FILE *yaml, stress_stressor_t *stressors_list);
@@ -17,9 +17,132 @@
  * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
  *
  */
-#include "config.h"
+#include "stress-ng.h"
+#include "core-builtin.h"
+#include "core-io-uring.h"
 
-#if defined(__linux__) &&	\
-    defined(HAVE_LINUX_IO_URING_H)
-#include <linux/io_uring.h>
+/* this file is also preprocessed to generate io-uring.h */
+
+#if defined(STRESS_IO_URING)
+/*
+ *  shim_io_uring_setup
+ *	wrapper for io_uring_setup()
+ */
+int shim_io_uring_setup(unsigned int entries, struct io_uring_params *p)
+{
+	return (int)syscall(__NR_io_uring_setup, entries, p);
+}
+
+/*
+ *  shim_io_uring_enter
+ *	wrapper for io_uring_enter()
+ */
+int shim_io_uring_enter(
+	int fd,
+	unsigned int to_submit,
+	unsigned int min_complete,
+	unsigned int flags,
+	void *arg,
+	size_t argsz)
+{
+	return (int)syscall(__NR_io_uring_enter, fd, to_submit,
+		min_complete, flags, arg, argsz);
+}
+
+#if defined(__NR_io_uring_register)
+/*
+ *  shim_io_uring_register
+ *	wrapper for io_uring_register()
+ */
+int shim_io_uring_register(
+	int fd,
+	unsigned int opcode,
+	void *arg,
+	unsigned int nr_args)
+{
+	return (int)syscall(__NR_io_uring_register, fd, opcode, arg, nr_args);
+}
+#endif
+
+/*
+ *  stress_io_uring_deinit()
+ *	unmap the rings and close the io_uring
+ */
+void stress_io_uring_deinit(stress_io_uring_t *ring)
+{
+	if (ring->sqes)
+		(void)munmap((void *)ring->sqes, ring->sqes_size);
+	if (ring->cq_mmap && (ring->cq_mmap != ring->sq_mmap))
+		(void)munmap(ring->cq_mmap, ring->cq_size);
+	if (ring->sq_mmap)
+		(void)munmap(ring->sq_mmap, ring->sq_size);
+	if (ring->fd >= 0)
+		(void)close(ring->fd);
+	ring->sqes = NULL;
+	ring->cq_mmap = NULL;
+	ring->sq_mmap = NULL;
+	ring->fd = -1;
+}
+
+/*
+ *  stress_io_uring_init()
+ *	create an io_uring of entries submission queue entries and
+ *	map the rings, returns 0 on success, -1 on failure
+ */
+int stress_io_uring_init(stress_io_uring_t *ring, const unsigned int entries)
+{
+	struct io_uring_params p;
+	void *ptr;
+
+	(void)shim_memset(ring, 0, sizeof(*ring));
+	(void)shim_memset(&p, 0, sizeof(p));
+	ring->fd = shim_io_uring_setup(entries, &p);
+	if (ring->fd < 0)
+		return -1;
+	ring->features = p.features;
+
+	ring->sq_size = p.sq_off.array + p.sq_entries * sizeof(unsigned int);
+	ring->cq_size = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+	if (p.features & IORING_FEAT_SINGLE_MMAP) {
+		if (ring->cq_size > ring->sq_size)
+			ring->sq_size = ring->cq_size;
+		ring->cq_size = ring->sq_size;
+	}
+	ptr = mmap(NULL, ring->sq_size, PROT_READ | PROT_WRITE,
+		MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_SQ_RING);
+	if (ptr == MAP_FAILED)
+		goto fail;
+	ring->sq_mmap = ptr;
+
+	if (p.features & IORING_FEAT_SINGLE_MMAP) {
+		ring->cq_mmap = ring->sq_mmap;
+	} else {
+		ptr = mmap(NULL, ring->cq_size, PROT_READ | PROT_WRITE,
+			MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_CQ_RING);
+		if (ptr == MAP_FAILED)
+			goto fail;
+		ring->cq_mmap = ptr;
+	}
+
+	ring->sqes_size = p.sq_entries * sizeof(struct io_uring_sqe);
+	ptr = mmap(NULL, ring->sqes_size, PROT_READ | PROT_WRITE,
+		MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_SQES);
+	if (ptr == MAP_FAILED)
+		goto fail;
+	ring->sqes = (struct io_uring_sqe *)ptr;
+
+	ring->sq_head = (unsigned int *)((uint8_t *)ring->sq_mmap + p.sq_off.head);
+	ring->sq_tail = (unsigned int *)((uint8_t *)ring->sq_mmap + p.sq_off.tail);
+	ring->sq_mask = (unsigned int *)((uint8_t *)ring->sq_mmap + p.sq_off.ring_mask);
+	ring->sq_array = (unsigned int *)((uint8_t *)ring->sq_mmap + p.sq_off.array);
+	ring->sq_entries = p.sq_entries;
+	ring->cq_head = (unsigned int *)((uint8_t *)ring->cq_mmap + p.cq_off.head);
+	ring->cq_tail = (unsigned int *)((uint8_t *)ring->cq_mmap + p.cq_off.tail);
+	ring->cq_mask = (unsigned int *)((uint8_t *)ring->cq_mmap + p.cq_off.ring_mask);
+	ring->cqes = (struct io_uring_cqe *)((uint8_t *)ring->cq_mmap + p.cq_off.cqes);
+	return 0;
+fail:
+	stress_io_uring_deinit(ring);
+	return -1;
+}
 #endif
@@ -0,0 +1,70 @@
+/*
+ * Copyright (C) 2025      Colin Ian King.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+#ifndef CORE_IO_URING_H
+#define CORE_IO_URING_H
+
+#if defined(HAVE_LINUX_IO_URING_H)
+#include <linux/io_uring.h>
+#endif
+
+/*
+ *  raw system call io_uring, no liburing required
+ */
+#if defined(HAVE_LINUX_IO_URING_H) &&	\
+    defined(HAVE_SYSCALL) &&		\
+    defined(__NR_io_uring_enter) &&	\
+    defined(__NR_io_uring_setup) &&	\
+    defined(IORING_OFF_SQ_RING) &&	\
+    defined(IORING_OFF_CQ_RING) &&	\
+    defined(IORING_OFF_SQES)
+#define STRESS_IO_URING
+
+/* mapped submission and completion rings */
+typedef struct {
+	int fd;				/* io_uring file descriptor */
+	uint32_t features;		/* IORING_FEAT_* flags */
+	void *sq_mmap;			/* submission ring mapping */
+	void *cq_mmap;			/* completion ring mapping */
+	size_t sq_size;
+	size_t cq_size;
+	size_t sqes_size;
+	struct io_uring_sqe *sqes;	/* submission queue entries */
+	unsigned int *sq_head;
+	unsigned int *sq_tail;
+	unsigned int *sq_mask;
+	unsigned int *sq_array;
+	unsigned int sq_entries;
+	unsigned int *cq_head;
+	unsigned int *cq_tail;
+	unsigned int *cq_mask;
+	struct io_uring_cqe *cqes;	/* completion queue entries */
+} stress_io_uring_t;
+
+extern int shim_io_uring_setup(unsigned int entries, struct io_uring_params *p);
+extern int shim_io_uring_enter(int fd, unsigned int to_submit,
+	unsigned int min_complete, unsigned int flags, void *arg, size_t argsz);
+#if defined(__NR_io_uring_register)
+extern int shim_io_uring_register(int fd, unsigned int opcode, void *arg,
+	unsigned int nr_args);
+#endif
+extern int stress_io_uring_init(stress_io_uring_t *ring, const unsigned int entries);
+extern void stress_io_uring_deinit(stress_io_uring_t *ring);
+#endif
+
+#endif
@@ -0,0 +1,372 @@
+/*
+ * Copyright (C) 2025      Colin Ian King.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+#include "stress-ng.h"
+#include "core-builtin.h"
+#include "core-ipcsweep.h"
+#include "core-killpid.h"
+#include "core-latency.h"
+
+#include <sys/socket.h>
+
+#define IPC_SWEEP_STREAM_MSGS	(1024)	/* one way messages per step */
+#define IPC_SWEEP_PINGPONGS	(256)	/* round trips per step */
+#define IPC_SWEEP_SIZES_MAX	(32)
+#define IPC_SWEEP_TRANSPORTS	(3)	/* stressor's transport, pipe, unix socket */
+
+typedef struct {
+	uint64_t msgs;			/* streamed messages */
+	double duration;		/* time taken to stream msgs */
+	stress_latency_hist_t rtt;	/* ping-pong round trip times */
+} stress_ipc_sweep_stat_t;
+
+typedef struct {
+	int fds[2][2];			/* per direction read/write fds */
+} stress_ipc_sweep_fds_t;
+
+/*
+ *  stress_ipc_sweep_fd_send()
+ *	write a whole message to a pipe or unix socket
+ */
+static int stress_ipc_sweep_fd_send(void *priv, const int dir, const void *buf, const size_t len)
+{
+	const stress_ipc_sweep_fds_t *fds = (const stress_ipc_sweep_fds_t *)priv;
+	const char *ptr = (const char *)buf;
+	size_t n = 0;
+
+	while (n < len) {
+		const ssize_t ret = write(fds->fds[dir][1], ptr + n, len - n);
+
+		if (ret <= 0)
+			return -1;
+		n += (size_t)ret;
+	}
+	return 0;
+}
+
+/*
+ *  stress_ipc_sweep_fd_recv()
+ *	read a whole message from a pipe or unix socket
+ */
+static int stress_ipc_sweep_fd_recv(void *priv, const int dir, void *buf, const size_t len)
+{
+	const stress_ipc_sweep_fds_t *fds = (const stress_ipc_sweep_fds_t *)priv;
+	char *ptr = (char *)buf;
+	size_t n = 0;
+
+	while (n < len) {
+		const ssize_t ret = read(fds->fds[dir][0], ptr + n, len - n);
+
+		if (ret <= 0) {
+			if (ret == 0)
+				errno = EPIPE;
+			return -1;
+		}
+		n += (size_t)ret;
+	}
+	return 0;
+}
+
+/*
+ *  stress_ipc_sweep_fds_close()
+ *	close pipe or unix socket baseline transport fds
+ */
+static void stress_ipc_sweep_fds_close(stress_ipc_sweep_fds_t *fds)
+{
+	size_t i, j;
+
+	for (i = 0; i < 2; i++) {
+		for (j = 0; j < 2; j++) {
+			if (fds->fds[i][j] >= 0)
+				(void)close(fds->fds[i][j]);
+			fds->fds[i][j] = -1;
+		}
+	}
+}
+
+/*
+ *  stress_ipc_sweep_pipe_open()
+ *	one pipe per direction
+ */
+static int stress_ipc_sweep_pipe_open(stress_ipc_sweep_fds_t *fds)
+{
+	if (pipe(fds->fds[STRESS_IPC_SWEEP_TO_CHILD]) < 0)
+		return -1;
+	if (pipe(fds->fds[STRESS_IPC_SWEEP_TO_PARENT]) < 0) {
+		stress_ipc_sweep_fds_close(fds);
+		return -1;
+	}
+	return 0;
+}
+
+/*
+ *  stress_ipc_sweep_unix_open()
+ *	one unix socket pair, the parent uses one end, the child the other
+ */
+static int stress_ipc_sweep_unix_open(stress_ipc_sweep_fds_t *fds)
+{
+#if defined(AF_UNIX)
+	int sv[2];
+#if defined(SOCK_SEQPACKET)
+	const int type = SOCK_SEQPACKET;
+#else
+	const int type = SOCK_STREAM;
+#endif
+
+	if (socketpair(AF_UNIX, type, 0, sv) < 0)
+		return -1;
+	/* parent writes sv[0] and reads sv[0], child reads sv[1] and writes sv[1] */
+	fds->fds[STRESS_IPC_SWEEP_TO_CHILD][1] = sv[0];
+	fds->fds[STRESS_IPC_SWEEP_TO_CHILD][0] = sv[1];
+	fds->fds[STRESS_IPC_SWEEP_TO_PARENT][1] = dup(sv[1]);
+	fds->fds[STRESS_IPC_SWEEP_TO_PARENT][0] = dup(sv[0]);
+	if ((fds->fds[STRESS_IPC_SWEEP_TO_PARENT][0] < 0) ||
+	    (fds->fds[STRESS_IPC_SWEEP_TO_PARENT][1] < 0)) {
+		stress_ipc_sweep_fds_close(fds);
+		return -1;
+	}
+	return 0;
+#else
+	(void)fds;
+
+	errno = ENOSYS;
+	return -1;
+#endif
+}
+
+/*
+ *  stress_ipc_sweep_child()
+ *	receive the streamed messages and acknowledge them, then
+ *	echo back the ping-pong messages
+ */
+static void NORETURN stress_ipc_sweep_child(const stress_ipc_sweep_ops_t *ops, char *buf, const size_t size)
+{
+	int i;
+
+	stress_parent_died_alarm();
+	for (i = 0; i < IPC_SWEEP_STREAM_MSGS; i++) {
+		if (ops->recv(ops->priv, STRESS_IPC_SWEEP_TO_CHILD, buf, size) < 0)
+			_exit(EXIT_FAILURE);
+	}
+	if (ops->send(ops->priv, STRESS_IPC_SWEEP_TO_PARENT, buf, size) < 0)
+		_exit(EXIT_FAILURE);
+	for (i = 0; i < IPC_SWEEP_PINGPONGS; i++) {
+		if (ops->recv(ops->priv, STRESS_IPC_SWEEP_TO_CHILD, buf, size) < 0)
+			_exit(EXIT_FAILURE);
+		if (ops->send(ops->priv, STRESS_IPC_SWEEP_TO_PARENT, buf, size) < 0)
+			_exit(EXIT_FAILURE);
+	}
+	_exit(EXIT_SUCCESS);
+}
+
+/*
+ *  stress_ipc_sweep_step()
+ *	stream messages of one size to a child and time them until
+ *	acknowledged, then time ping-pong round trips. Returns 0 on
+ *	success, 1 if the run was stopped and -1 on failure
+ */
+static int stress_ipc_sweep_step(
+	stress_args_t *args,
+	const stress_ipc_sweep_ops_t *ops,
+	char *buf,
+	const size_t size,
+	stress_ipc_sweep_stat_t *stat)
+{
+	pid_t pid;
+	int i, status;
+	double t;
+
+again:
+	pid = fork();
+	if (pid < 0) {
+		if (stress_redo_fork(args, errno))
+			goto again;
+		if (!stress_continue(args))
+			return 1;
+		pr_fail("%s: fork failed, errno=%d (%s)\n",
+			args->name, errno, strerror(errno));
+		return -1;
+	} else if (pid == 0) {
+		stress_ipc_sweep_child(ops, buf, size);
+	}
+
+	t = stress_time_now();
+	for (i = 0; i < IPC_SWEEP_STREAM_MSGS; i++) {
+		buf[0] = (char)i;
+		if (UNLIKELY(ops->send(ops->priv, STRESS_IPC_SWEEP_TO_CHILD, buf, size) < 0))
+			goto err;
+	}
+	if (UNLIKELY(ops->recv(ops->priv, STRESS_IPC_SWEEP_TO_PARENT, buf, size) < 0))
+		goto err;
+	stat->duration += stress_time_now() - t;
+	stat->msgs += IPC_SWEEP_STREAM_MSGS;
+	stress_bogo_add(args, IPC_SWEEP_STREAM_MSGS);
+
+	for (i = 0; i < IPC_SWEEP_PINGPONGS; i++) {
+		const uint64_t t_begin = stress_latency_now();
+
+		buf[0] = (char)i;
+		if (UNLIKELY(ops->send(ops->priv, STRESS_IPC_SWEEP_TO_CHILD, buf, size) < 0))
+			goto err;
+		if (UNLIKELY(ops->recv(ops->priv, STRESS_IPC_SWEEP_TO_PARENT, buf, size) < 0))
+			goto err;
+		stress_latency_hist_record(&stat->rtt, stress_latency_now() - t_begin);
+		if (UNLIKELY(buf[0] != (char)i)) {
+			pr_fail("%s: %s %zu byte ping-pong message mismatch, "
+				"got 0x%2.2x, expected 0x%2.2x\n", args->name,
+				ops->name, size, (uint8_t)buf[0], (uint8_t)i);
+			(void)stress_kill_pid_wait(pid, NULL);
+			return -1;
+		}
+	}
+	stress_bogo_add(args, IPC_SWEEP_PINGPONGS * 2);
+
+	if (shim_waitpid(pid, &status, 0) < 0)
+		(void)stress_kill_pid_wait(pid, NULL);
+	return 0;
+
+err:
+	(void)stress_kill_pid_wait(pid, NULL);
+	if ((errno == EINTR) || !stress_continue(args))
+		return 1;
+	pr_fail("%s: %s %zu byte message transfer failed, errno=%d (%s)\n",
+		args->name, ops->name, size, errno, strerror(errno));
+	return -1;
+}
+
+/*
+ *  stress_ipc_sweep()
+ *	sweep message sizes from STRESS_IPC_SWEEP_MIN_SIZE bytes up to
+ *	max_size bytes, measuring streamed throughput and ping-pong round
+ *	trip latency of the stressor's transport and of pipe and unix
+ *	socket baselines with the same message sizes
+ */
+int stress_ipc_sweep(stress_args_t *args, const stress_ipc_sweep_ops_t *ops, const size_t max_size)
+{
+	stress_ipc_sweep_ops_t transports[IPC_SWEEP_TRANSPORTS];
+	stress_ipc_sweep_fds_t pipe_fds, unix_fds;
+	stress_ipc_sweep_stat_t *stats;
+	size_t sizes[IPC_SWEEP_SIZES_MAX];
+	size_t i, j, n_sizes = 0, n_transports = 0, idx;
+	size_t size;
+	char *buf;
+	int rc = EXIT_SUCCESS;
+
+	for (size = STRESS_IPC_SWEEP_MIN_SIZE; (size < max_size) && (n_sizes < IPC_SWEEP_SIZES_MAX - 1); size <<= 1)
+		sizes[n_sizes++] = size;
+	sizes[n_sizes++] = max_size;
+
+	buf = (char *)malloc(max_size);
+	stats = (stress_ipc_sweep_stat_t *)calloc(IPC_SWEEP_TRANSPORTS * n_sizes, sizeof(*stats));
+	if (!buf || !stats) {
+		pr_inf_skip("%s: cannot allocate message buffer and statistics, skipping stressor\n",
+			args->name);
+		free(stats);
+		free(buf);
+		return EXIT_NO_RESOURCE;
+	}
+	(void)shim_memset(buf, 0xa5, max_size);
+	for (i = 0; i < IPC_SWEEP_TRANSPORTS * n_sizes; i++)
+		stress_latency_hist_init(&stats[i].rtt);
+
+	transports[n_transports++] = *ops;
+	for (i = 0; i < 2; i++) {
+		for (j = 0; j < 2; j++) {
+			pipe_fds.fds[i][j] = -1;
+			unix_fds.fds[i][j] = -1;
+		}
+	}
+	if (stress_ipc_sweep_pipe_open(&pipe_fds) == 0) {
+		transports[n_transports].name = "pipe";
+		transports[n_transports].priv = &pipe_fds;
+		transports[n_transports].send = stress_ipc_sweep_fd_send;
+		transports[n_transports].recv = stress_ipc_sweep_fd_recv;
+		n_transports++;
+	}
+	if (stress_ipc_sweep_unix_open(&unix_fds) == 0) {
+		transports[n_transports].name = "unix";
+		transports[n_transports].priv = &unix_fds;
+		transports[n_transports].send = stress_ipc_sweep_fd_send;
+		transports[n_transports].recv = stress_ipc_sweep_fd_recv;
+		n_transports++;
+	}
+
+	stress_set_proc_state(args->name, STRESS_STATE_SYNC_WAIT);
+	stress_sync_start_wait(args);
+	stress_set_proc_state(args->name, STRESS_STATE_RUN);
+
+	do {
+		for (i = 0; i < n_sizes; i++) {
+			for (j = 0; j < n_transports; j++) {
+				const int ret = stress_ipc_sweep_step(args, &transports[j], buf,
+						sizes[i], &stats[(j * n_sizes) + i]);
+
+				if (ret < 0)
+					rc = EXIT_FAILURE;
+				if (ret != 0)
+					goto done;
+			}
+		}
+	} while (stress_continue(args));
+done:
+	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
+
+	if (args->instance == 0)
+		pr_inf("%s: %-8s %8s %12s %10s %10s %10s\n", args->name, "ipc", "size",
+			"msgs/sec", "MB/sec", "rtt p50us", "rtt p99us");
+	for (idx = 0, j = 0; j < n_transports; j++) {
+		for (i = 0; i < n_sizes; i++) {
+			const stress_ipc_sweep_stat_t *stat = &stats[(j * n_sizes) + i];
+			const double rate = (stat->duration > 0.0) ? (double)stat->msgs / stat->duration : 0.0;
+			const double mb_rate = (rate * (double)sizes[i]) / (double)MB;
+			const double p50 = (double)stress_latency_hist_percentile(&stat->rtt, 50.0) / 1000.0;
+			const double p99 = (double)stress_latency_hist_percentile(&stat->rtt, 99.0) / 1000.0;
+			char desc[64];
+
+			if (!stat->msgs)
+				continue;
+			if (args->instance == 0)
+				pr_inf("%s: %-8s %8zu %12.0f %10.2f %10.2f %10.2f\n", args->name,
+					transports[j].name, sizes[i], rate, mb_rate, p50, p99);
+
+			/* metrics for the smallest and largest message sizes */
+			if (i == 0) {
+				(void)snprintf(desc, sizeof(desc), "%s %zu byte msgs per sec",
+					transports[j].name, sizes[i]);
+				stress_metrics_set(args, idx++, desc, rate, STRESS_METRIC_HARMONIC_MEAN);
+				(void)snprintf(desc, sizeof(desc), "%s %zu byte rtt p50 usec",
+					transports[j].name, sizes[i]);
+				stress_metrics_set(args, idx++, desc, p50, STRESS_METRIC_GEOMETRIC_MEAN);
+			} else if (i == n_sizes - 1) {
+				(void)snprintf(desc, sizeof(desc), "%s %zu byte MB per sec",
+					transports[j].name, sizes[i]);
+				stress_metrics_set(args, idx++, desc, mb_rate, STRESS_METRIC_HARMONIC_MEAN);
+				(void)snprintf(desc, sizeof(desc), "%s %zu byte rtt p50 usec",
+					transports[j].name, sizes[i]);
+				stress_metrics_set(args, idx++, desc, p50, STRESS_METRIC_GEOMETRIC_MEAN);
+			}
+		}
+	}
+
+	stress_ipc_sweep_fds_close(&unix_fds);
+	stress_ipc_sweep_fds_close(&pipe_fds);
+	free(stats);
+	free(buf);
+
+	return rc;
+}
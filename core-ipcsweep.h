@@ -0,0 +1,46 @@
+/*
+ * Copyright (C) 2025      Colin Ian King.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+#ifndef CORE_IPCSWEEP_H
+#define CORE_IPCSWEEP_H
+
+#include "core-attribute.h"
+
+#define STRESS_IPC_SWEEP_TO_CHILD	(0)	/* parent sends, child receives */
+#define STRESS_IPC_SWEEP_TO_PARENT	(1)	/* child sends, parent receives */
+
+#define STRESS_IPC_SWEEP_MIN_SIZE	(8)	/* smallest message size swept */
+#define STRESS_IPC_SWEEP_METRICS	(12)	/* metrics set by stress_ipc_sweep */
+
+/*
+ *  message transport for the IPC size sweep, send and recv transfer a
+ *  whole len byte message in direction dir and return 0 on success or
+ *  -1 with errno set on failure. recv buffers are at least the maximum
+ *  swept message size bytes long.
+ */
+typedef struct stress_ipc_sweep_ops {
+	const char *name;		/* transport name */
+	void *priv;			/* transport private data */
+	int (*send)(void *priv, const int dir, const void *buf, const size_t len);
+	int (*recv)(void *priv, const int dir, void *buf, const size_t len);
+} stress_ipc_sweep_ops_t;
+
+extern int stress_ipc_sweep(stress_args_t *args, const stress_ipc_sweep_ops_t *ops,
+	const size_t max_size);
+
+#endif
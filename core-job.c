@@ -96,6 +96,164 @@ static void stress_parse_error(
 		lineno, line);
 }
 
+/*
+ *  stress_job_tokenize()
+ *	strip comments from a job file line and split it into
+ *	blank separated tokens from new_argv[1] onwards, returns
+ *	the new argc
+ */
+static int stress_job_tokenize(char *buf, char *new_argv[MAX_ARGS])
+{
+	char *ptr;
+	int new_argc = 1;
+
+	/* remove comments */
+	stress_str_chop(buf, '#');
+
+	/* skip leading blanks */
+	for (ptr = buf; ISBLANK(*ptr); ptr++)
+		;
+
+	while (new_argc < MAX_ARGS && *ptr) {
+		new_argv[new_argc++] = ptr;
+
+		/* eat up chars until eos or blank */
+		while (*ptr && !ISBLANK(*ptr))
+			ptr++;
+
+		if (!*ptr)
+			break;
+		*ptr++ = '\0';
+
+		/* skip over blanks */
+		while (ISBLANK(*ptr))
+			ptr++;
+	}
+	return new_argc;
+}
+
+/*
+ *  stress_job_long_opt_allowed()
+ *	check a long option name, getopt_long selects an option from
+ *	an exact match of its name or an unambiguous prefix of it, so
+ *	all the options that the prefix matches have to be allowed
+ */
+static bool stress_job_long_opt_allowed(
+	const char *name,
+	bool (*opt_allowed)(const int opt))
+{
+	const struct option *opt;
+	const char *eq = strchr(name, '=');
+	const size_t len = eq ? (size_t)(eq - name) : strlen(name);
+	bool matched = false;
+
+	if (!len)
+		return false;
+	for (opt = stress_long_options; opt->name; opt++) {
+		if (strncmp(opt->name, name, len))
+			continue;
+		if (strlen(opt->name) == len)
+			return opt_allowed(opt->val);
+		if (!opt_allowed(opt->val))
+			return false;
+		matched = true;
+	}
+	return matched;
+}
+
+/*
+ *  stress_job_short_opts_allowed()
+ *	check a cluster of short options, the remainder of the
+ *	token after an option that takes an argument is the argument
+ */
+static bool stress_job_short_opts_allowed(
+	const char *opts,
+	bool (*opt_allowed)(const int opt))
+{
+	for (; *opts; opts++) {
+		const char *short_opt;
+
+		if (*opts == ':')
+			return false;
+		short_opt = strchr(STRESS_SHORT_OPTIONS, *opts);
+		if (!short_opt || !opt_allowed((int)(unsigned char)*opts))
+			return false;
+		if (short_opt[1] == ':')
+			break;
+	}
+	return true;
+}
+
+/*
+ *  stress_jobfile_check()
+ *	check all the options in a job file with opt_allowed, the
+ *	job file is read and tokenized as stress_parse_jobfile()
+ *	does. Returns -1 and the first rejected token in bad if an
+ *	option is not allowed or the job file cannot be read
+ */
+int stress_jobfile_check(
+	const char *jobfile,
+	bool (*opt_allowed)(const int opt),
+	char *bad,
+	const size_t bad_len)
+{
+	FILE *fp;
+	char buf[4096];
+	char *new_argv[MAX_ARGS];
+	int ret = 0;
+
+	fp = fopen(jobfile, "r");
+	if (!fp) {
+		(void)shim_strscpy(bad, jobfile, bad_len);
+		return -1;
+	}
+
+	while (fgets(buf, sizeof(buf), fp)) {
+		int i, new_argc;
+
+		(void)shim_memset(new_argv, 0, sizeof(new_argv));
+		stress_str_chop(buf, '\n');
+		new_argc = stress_job_tokenize(buf, new_argv);
+		if (new_argc < 2)
+			continue;
+		/* run sequential or run parallel, anything else is an error */
+		if (!strcmp(new_argv[1], "run") && (new_argc > 2))
+			continue;
+
+		/* the first token is turned into a long option */
+		if (!stress_job_long_opt_allowed(new_argv[1], opt_allowed)) {
+			(void)shim_strscpy(bad, new_argv[1], bad_len);
+			ret = -1;
+			break;
+		}
+		/*
+		 *  any other token that starts with - is checked as an
+		 *  option, including arguments of the previous option
+		 */
+		for (i = 2; i < new_argc; i++) {
+			const char *arg = new_argv[i];
+			bool allowed;
+
+			if ((arg[0] != '-') || (arg[1] == '\0'))
+				continue;
+			if (arg[1] == '-')
+				allowed = stress_job_long_opt_allowed(arg + 2, opt_allowed);
+			else
+				allowed = stress_job_short_opts_allowed(arg + 1, opt_allowed);
+			if (!allowed) {
+				(void)shim_strscpy(bad, arg, bad_len);
+				ret = -1;
+				break;
+			}
+		}
+		if (ret < 0)
+			break;
+	}
+	(void)fclose(fp);
+
+	return ret;
+}
+
 /*
  *  stress_parse_jobfile()
  *	parse a jobfile, turn job commands into
@@ -141,8 +299,7 @@ int stress_parse_jobfile(
 	ret = -1;
 
 	while (fgets(buf, sizeof(buf), fp)) {
-		char *ptr;
-		int new_argc = 1;
+		int new_argc;
 
 		(void)shim_memset(new_argv, 0, sizeof(new_argv));
 		new_argv[0] = argv[0];
@@ -152,30 +309,7 @@ int stress_parse_jobfile(
 		stress_str_chop(buf, '\n');
 		(void)shim_strscpy(txt, buf, sizeof(txt) - 1);
 
-		/* remove comments */
-		stress_str_chop(buf, '#');
-		if (!*buf)
-			continue;
-
-		/* skip leading blanks */
-		for (ptr = buf; ISBLANK(*ptr); ptr++)
-			;
-
-		while (new_argc < MAX_ARGS && *ptr) {
-			new_argv[new_argc++] = ptr;
-
-			/* eat up chars until eos or blank */
-			while (*ptr && !ISBLANK(*ptr))
-				ptr++;
-
-			if (!*ptr)
-				break;
-			*ptr++ = '\0';
-
-			/* skip over blanks */
-			while (ISBLANK(*ptr))
-				ptr++;
-		}
+		new_argc = stress_job_tokenize(buf, new_argv);
 
 		/* managed to get any tokens? */
 		if (new_argc > 1) {
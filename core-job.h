@@ -20,5 +20,7 @@
 #define CORE_JOB_H
 
 extern int stress_parse_jobfile(const int argc, char **argv, const char *jobfile);
+extern int stress_jobfile_check(const char *jobfile, bool (*opt_allowed)(const int opt),
+	char *bad, const size_t bad_len);
 
 #endif
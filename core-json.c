@@ -0,0 +1,239 @@
+/*
+ * Copyright (C) 2025      Colin Ian King.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+#include "stress-ng.h"
+#include "core-json.h"
+
+#include <math.h>
+#include <stdarg.h>
+
+/*
+ *  The --json file is a stream of JSON records, one object per
+ *  line. The file is opened O_APPEND and each record is written
+ *  with a single write() so that records written by the main
+ *  process and the periodic stats process do not interleave and
+ *  a killed run still leaves every completed record intact.
+ */
+static int json_fd = -1;
+
+/*
+ *  stress_json_open()
+ *	open the --json file, truncating any previous contents
+ */
+int stress_json_open(const char *filename)
+{
+	json_fd = open(filename, O_WRONLY | O_CREAT | O_TRUNC | O_APPEND, 0644);
+	if (json_fd < 0) {
+		pr_err("cannot open JSON file %s, errno=%d (%s)\n",
+			filename, errno, strerror(errno));
+		return -1;
+	}
+	return 0;
+}
+
+/*
+ *  stress_json_close()
+ *	close the --json file
+ */
+void stress_json_close(void)
+{
+	if (json_fd >= 0) {
+		(void)close(json_fd);
+		json_fd = -1;
+	}
+}
+
+/*
+ *  stress_json_enabled()
+ *	true if JSON records are being written
+ */
+bool stress_json_enabled(void)
+{
+	return json_fd >= 0;
+}
+
+/*
+ *  stress_json_printf()
+ *	append formatted text to a record, growing the buffer as required
+ */
+static void FORMAT(printf, 2, 3) stress_json_printf(stress_json_t *json, const char *fmt, ...)
+{
+	va_list ap;
+	int n;
+
+	if (json->failed)
+		return;
+	for (;;) {
+		const size_t avail = json->size - json->len;
+
+		va_start(ap, fmt);
+		n = vsnprintf(json->buf + json->len, avail, fmt, ap);
+		va_end(ap);
+		if (n < 0) {
+			json->failed = true;
+			return;
+		}
+		if ((size_t)n < avail) {
+			json->len += (size_t)n;
+			return;
+		} else {
+			const size_t size = (json->size * 2) + (size_t)n;
+			char *buf;
+
+			buf = (char *)realloc(json->buf, size);
+			if (!buf) {
+				json->failed = true;
+				return;
+			}
+			json->buf = buf;
+			json->size = size;
+		}
+	}
+}
+
+/*
+ *  stress_json_puts()
+ *	append a JSON quoted and escaped string
+ */
+static void stress_json_puts(stress_json_t *json, const char *str)
+{
+	stress_json_printf(json, "\"");
+	for (; *str; str++) {
+		const unsigned char ch = (unsigned char)*str;
+
+		if ((ch == '"') || (ch == '\\'))
+			stress_json_printf(json, "\\%c", ch);
+		else if (ch < ' ')
+			stress_json_printf(json, "\\u%4.4x", ch);
+		else
+			stress_json_printf(json, "%c", ch);
+	}
+	stress_json_printf(json, "\"");
+}
+
+/*
+ *  stress_json_key()
+ *	append a member separator and key
+ */
+static void stress_json_key(stress_json_t *json, const char *key)
+{
+	if (json->comma)
+		stress_json_printf(json, ", ");
+	stress_json_puts(json, key);
+	stress_json_printf(json, ": ");
+	json->comma = true;
+}
+
+/*
+ *  stress_json_begin()
+ *	start a record of the given record type
+ */
+void stress_json_begin(stress_json_t *json, const char *record)
+{
+	json->size = 512;
+	json->len = 0;
+	json->comma = false;
+	json->buf = (char *)malloc(json->size);
+	json->failed = (json->buf == NULL);
+	stress_json_printf(json, "{");
+	stress_json_str(json, "record", record);
+	stress_json_double(json, "time", stress_time_now());
+}
+
+/*
+ *  stress_json_end_file()
+ *	close the record and write it out as a single line to the
+ *	--json file and also to stream fp if it is not NULL
+ */
+void stress_json_end_file(stress_json_t *json, FILE *fp)
+{
+	stress_json_printf(json, "}\n");
+	if (!json->failed && (json_fd >= 0)) {
+		ssize_t ret;
+
+		ret = write(json_fd, json->buf, json->len);
+		if (ret != (ssize_t)json->len)
+			pr_dbg("JSON record write failed, errno=%d (%s)\n",
+				errno, strerror(errno));
+	}
+	if (!json->failed && fp)
+		(void)fwrite(json->buf, 1, json->len, fp);
+	free(json->buf);
+	json->buf = NULL;
+}
+
+/*
+ *  stress_json_end()
+ *	close the record and write it out as a single line
+ */
+void stress_json_end(stress_json_t *json)
+{
+	stress_json_end_file(json, NULL);
+}
+
+/*
+ *  stress_json_object_begin()
+ *	start a nested object member
+ */
+void stress_json_object_begin(stress_json_t *json, const char *key)
+{
+	stress_json_key(json, key);
+	stress_json_printf(json, "{");
+	json->comma = false;
+}
+
+/*
+ *  stress_json_object_end()
+ *	close a nested object member
+ */
+void stress_json_object_end(stress_json_t *json)
+{
+	stress_json_printf(json, "}");
+	json->comma = true;
+}
+
+void stress_json_str(stress_json_t *json, const char *key, const char *value)
+{
+	stress_json_key(json, key);
+	stress_json_puts(json, value);
+}
+
+void stress_json_int64(stress_json_t *json, const char *key, const int64_t value)
+{
+	stress_json_key(json, key);
+	stress_json_printf(json, "%" PRId64, value);
+}
+
+void stress_json_uint64(stress_json_t *json, const char *key, const uint64_t value)
+{
+	stress_json_key(json, key);
+	stress_json_printf(json, "%" PRIu64, value);
+}
+
+/*
+ *  stress_json_double()
+ *	append a double, NaN and infinities are not valid JSON so use null
+ */
+void stress_json_double(stress_json_t *json, const char *key, const double value)
+{
+	stress_json_key(json, key);
+	if (isnan(value) || isinf(value))
+		stress_json_printf(json, "null");
+	else
+		stress_json_printf(json, "%.15g", value);
+}
@@ -0,0 +1,47 @@
+/*
+ * Copyright (C) 2025      Colin Ian King.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+#ifndef CORE_JSON_H
+#define CORE_JSON_H
+
+#define STRESS_JSON_SCHEMA	(1)	/* bump on incompatible record changes */
+
+/* a JSON record being built, written as one line by stress_json_end() */
+typedef struct {
+	char *buf;			/* record text */
+	size_t len;			/* length of record text */
+	size_t size;			/* allocated size of buf */
+	bool comma;			/* next member needs a separator */
+	bool failed;			/* out of memory, record is dropped */
+} stress_json_t;
+
+extern int stress_json_open(const char *filename);
+extern void stress_json_close(void);
+extern bool stress_json_enabled(void);
+
+extern void stress_json_begin(stress_json_t *json, const char *record);
+extern void stress_json_end(stress_json_t *json);
+extern void stress_json_end_file(stress_json_t *json, FILE *fp);
+extern void stress_json_object_begin(stress_json_t *json, const char *key);
+extern void stress_json_object_end(stress_json_t *json);
+extern void stress_json_str(stress_json_t *json, const char *key, const char *value);
+extern void stress_json_int64(stress_json_t *json, const char *key, const int64_t value);
+extern void stress_json_uint64(stress_json_t *json, const char *key, const uint64_t value);
+extern void stress_json_double(stress_json_t *json, const char *key, const double value);
+
+#endif
@@ -0,0 +1,275 @@
+/*
+ * Copyright (C) 2025      Colin Ian King.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+#include "stress-ng.h"
+#include "core-builtin.h"
+#include "core-ksm.h"
+
+#include <ctype.h>
+
+#if defined(HAVE_DIRENT_H)
+#include <dirent.h>
+#endif
+
+/* system wide KSM counters */
+typedef struct {
+	uint64_t pages_shared;		/* shared pages in use */
+	uint64_t pages_sharing;		/* sites sharing them, i.e. pages saved */
+	uint64_t full_scans;		/* number of full scans by ksmd */
+	uint64_t pages_scanned;		/* pages scanned by ksmd */
+	double ksmd_cpu;		/* ksmd user + system time in seconds */
+	bool valid;			/* true if the counters could be read */
+} stress_ksm_counters_t;
+
+static stress_ksm_counters_t ksm_start;
+static double ksm_time_start;
+
+/*
+ *  stress_ksm_read()
+ *	read a /sys/kernel/mm/ksm counter, false if not available
+ */
+static bool stress_ksm_read(const char *name, uint64_t *value)
+{
+	char path[64], buf[32];
+
+	(void)snprintf(path, sizeof(path), "/sys/kernel/mm/ksm/%s", name);
+	if (stress_system_read(path, buf, sizeof(buf)) <= 0)
+		return false;
+	return sscanf(buf, "%" SCNu64, value) == 1;
+}
+
+/*
+ *  stress_ksm_ksmd_cpu()
+ *	find the ksmd kernel thread and return its CPU time in
+ *	seconds, 0.0 if it cannot be found
+ */
+static double stress_ksm_ksmd_cpu(void)
+{
+#if defined(__linux__) &&	\
+    defined(HAVE_DIRENT_H)
+	static pid_t ksmd_pid = 0;
+	char path[64], buf[512];
+	const char *ptr;
+	unsigned long int utime, stime;
+	const long int ticks = sysconf(_SC_CLK_TCK);
+
+	if (ksmd_pid == 0) {
+		DIR *dir;
+		const struct dirent *d;
+
+		dir = opendir("/proc");
+		if (!dir)
+			return 0.0;
+		while ((d = readdir(dir)) != NULL) {
+			if (!isdigit((unsigned char)d->d_name[0]))
+				continue;
+			(void)snprintf(path, sizeof(path), "/proc/%s/comm", d->d_name);
+			if (stress_system_read(path, buf, sizeof(buf)) <= 0)
+				continue;
+			if (!strncmp(buf, "ksmd\n", 5)) {
+				ksmd_pid = (pid_t)atoi(d->d_name);
+				break;
+			}
+		}
+		(void)closedir(dir);
+		if (ksmd_pid == 0) {
+			ksmd_pid = -1;
+			return 0.0;
+		}
+	}
+	if ((ksmd_pid < 0) || (ticks <= 0))
+		return 0.0;
+
+	(void)snprintf(path, sizeof(path), "/proc/%" PRIdMAX "/stat", (intmax_t)ksmd_pid);
+	if (stress_system_read(path, buf, sizeof(buf)) <= 0)
+		return 0.0;
+	ptr = strrchr(buf, ')');
+	if (!ptr)
+		return 0.0;
+	if (sscanf(ptr + 1, " %*c %*d %*d %*d %*d %*d %*u %*u %*u %*u %*u %lu %lu",
+		   &utime, &stime) != 2)
+		return 0.0;
+	return (double)(utime + stime) / (double)ticks;
+#else
+	return 0.0;
+#endif
+}
+
+/*
+ *  stress_ksm_counters()
+ *	read the system wide KSM counters and ksmd CPU time
+ */
+static void stress_ksm_counters(stress_ksm_counters_t *counters)
+{
+	(void)shim_memset(counters, 0, sizeof(*counters));
+	counters->valid = stress_ksm_read("pages_shared", &counters->pages_shared) &&
+			  stress_ksm_read("pages_sharing", &counters->pages_sharing);
+	(void)stress_ksm_read("full_scans", &counters->full_scans);
+	(void)stress_ksm_read("pages_scanned", &counters->pages_scanned);
+	counters->ksmd_cpu = stress_ksm_ksmd_cpu();
+}
+
+/*
+ *  stress_ksm_start()
+ *	snapshot the KSM counters at the start of a --ksm run
+ */
+void stress_ksm_start(void)
+{
+	stress_ksm_counters(&ksm_start);
+	ksm_time_start = stress_time_now();
+	g_shared->ksm.pages_sharing_peak = ksm_start.pages_sharing;
+	g_shared->ksm.pages_shared_peak = ksm_start.pages_shared;
+}
+
+/*
+ *  stress_ksm_merging_pages()
+ *	read /proc/pid/ksm_merging_pages (Linux 6.1+), 0 if not available
+ */
+static uint64_t stress_ksm_merging_pages(const pid_t pid)
+{
+	char path[64], buf[32];
+	uint64_t pages;
+
+	(void)snprintf(path, sizeof(path), "/proc/%" PRIdMAX "/ksm_merging_pages", (intmax_t)pid);
+	if (stress_system_read(path, buf, sizeof(buf)) <= 0)
+		return 0;
+	if (sscanf(buf, "%" SCNu64, &pages) != 1)
+		return 0;
+	return pages;
+}
+
+/*
+ *  stress_ksm_sample()
+ *	sample the pages merged by KSM of a stressor instance and its
+ *	oomable child (if any), keeping the peak
+ */
+void stress_ksm_sample(stress_ksm_t *ksm, const pid_t pid, const pid_t child)
+{
+	uint64_t pages;
+
+	pages = stress_ksm_merging_pages(pid);
+	if (child)
+		pages += stress_ksm_merging_pages(child);
+	if (pages > ksm->merging_pages_peak)
+		ksm->merging_pages_peak = pages;
+	ksm->samples++;
+}
+
+/*
+ *  stress_ksm_sys_sample()
+ *	sample the system wide pages sharing, keeping the peak as
+ *	merged pages are unmerged when the stressors exit
+ */
+void stress_ksm_sys_sample(void)
+{
+	uint64_t pages_sharing, pages_shared;
+
+	if (!stress_ksm_read("pages_sharing", &pages_sharing) ||
+	    !stress_ksm_read("pages_shared", &pages_shared))
+		return;
+	if (pages_sharing > g_shared->ksm.pages_sharing_peak) {
+		g_shared->ksm.pages_sharing_peak = pages_sharing;
+		g_shared->ksm.pages_shared_peak = pages_shared;
+	}
+}
+
+/*
+ *  stress_ksm_dump()
+ *	report the memory saved by KSM, the merge rate and the ksmd
+ *	CPU cost of the run and the peak pages merged per stressor
+ *	alongside the stressor throughput
+ */
+void stress_ksm_dump(FILE *yaml, stress_stressor_t *stressors_list)
+{
+	stress_ksm_counters_t ksm_end;
+	stress_stressor_t *ss;
+	const double page_mb = (double)stress_get_page_size() / (double)MB;
+	double duration, ksmd_cpu, merge_rate;
+	uint64_t sharing_peak;
+	bool header = false;
+
+	stress_ksm_counters(&ksm_end);
+	if (!ksm_start.valid || !ksm_end.valid) {
+		pr_inf("ksm: cannot read /sys/kernel/mm/ksm counters, no KSM statistics\n");
+		return;
+	}
+	stress_ksm_sys_sample();
+	sharing_peak = g_shared->ksm.pages_sharing_peak;
+	duration = stress_time_now() - ksm_time_start;
+	ksmd_cpu = ksm_end.ksmd_cpu - ksm_start.ksmd_cpu;
+	merge_rate = ((duration > 0.0) && (sharing_peak > ksm_start.pages_sharing)) ?
+		(double)(sharing_peak - ksm_start.pages_sharing) / duration : 0.0;
+
+	pr_block_begin();
+	pr_inf("ksm: peak %" PRIu64 " pages sharing %" PRIu64 " shared pages, "
+		"%.2f MB saved, merge rate %.2f pages/sec\n",
+		sharing_peak, g_shared->ksm.pages_shared_peak,
+		(double)sharing_peak * page_mb, merge_rate);
+	pr_inf("ksm: %" PRIu64 " full scans, %" PRIu64 " pages scanned, "
+		"ksmd CPU %.2f secs (%.2f%% of a CPU)\n",
+		ksm_end.full_scans - ksm_start.full_scans,
+		ksm_end.pages_scanned - ksm_start.pages_scanned,
+		ksmd_cpu, (duration > 0.0) ? 100.0 * ksmd_cpu / duration : 0.0);
+	pr_yaml(yaml, "ksm:\n");
+	pr_yaml(yaml, "    pages-sharing-peak: %" PRIu64 "\n", sharing_peak);
+	pr_yaml(yaml, "    pages-shared-peak: %" PRIu64 "\n", g_shared->ksm.pages_shared_peak);
+	pr_yaml(yaml, "    memory-saved-mb-peak: %.2f\n", (double)sharing_peak * page_mb);
+	pr_yaml(yaml, "    merge-rate-pages-per-sec: %.2f\n", merge_rate);
+	pr_yaml(yaml, "    full-scans: %" PRIu64 "\n", ksm_end.full_scans - ksm_start.full_scans);
+	pr_yaml(yaml, "    pages-scanned: %" PRIu64 "\n", ksm_end.pages_scanned - ksm_start.pages_scanned);
+	pr_yaml(yaml, "    ksmd-cpu-secs: %.2f\n", ksmd_cpu);
+
+	for (ss = stressors_list; ss; ss = ss->next) {
+		uint64_t merged = 0;
+		double bogo_rate = 0.0;
+		int32_t j, sampled = 0;
+
+		if (ss->ignore.run || ss->ignore.permute || !ss->stats)
+			continue;
+
+		for (j = 0; j < ss->instances; j++) {
+			const stress_stats_t *stats = ss->stats[j];
+
+			if (stats->duration_total > 0.0)
+				bogo_rate += (double)stats->counter_total / stats->duration_total;
+			if (!stats->ksm.samples)
+				continue;
+			sampled++;
+			merged += stats->ksm.merging_pages_peak;
+		}
+		if (!sampled)
+			continue;
+
+		if (!header) {
+			pr_inf("ksm: %-13s %14s %10s %12s\n",
+				"stressor", "merged pages", "saved MB", "bogo ops/s");
+			pr_yaml(yaml, "    stressors:\n");
+			header = true;
+		}
+		pr_inf("ksm: %-13s %14" PRIu64 " %10.2f %12.2f\n",
+			ss->stressor->name, merged, (double)merged * page_mb, bogo_rate);
+		pr_yaml(yaml, "      - stressor: %s\n", ss->stressor->name);
+		pr_yaml(yaml, "        merged-pages-peak: %" PRIu64 "\n", merged);
+		pr_yaml(yaml, "        bogo-ops-per-sec: %.2f\n", bogo_rate);
+	}
+	if (header)
+		pr_inf("ksm: merged pages are the sum of per instance peaks from "
+			"/proc/pid/ksm_merging_pages\n");
+	pr_yaml(yaml, "\n");
+	pr_block_end();
+}
@@ -0,0 +1,401 @@
+/*
+ * Copyright (C) 2025      Colin Ian King
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+#include "stress-ng.h"
+#include "core-builtin.h"
+#include "core-latency.h"
+
+#include <math.h>
+
+#if defined(RUSAGE_THREAD)
+#define STRESS_LATENCY_RUSAGE	RUSAGE_THREAD
+#else
+#define STRESS_LATENCY_RUSAGE	RUSAGE_SELF
+#endif
+
+#define STRESS_LATENCY_THP_SIZE	(2 * MB)	/* default THP size */
+
+/*
+ *  stress_latency_hist_init()
+ *	reset a histogram to an empty state
+ */
+void stress_latency_hist_init(stress_latency_hist_t *hist)
+{
+	(void)shim_memset(hist, 0, sizeof(*hist));
+	hist->min_ns = UINT64_MAX;
+}
+
+/*
+ *  stress_latency_hist_merge()
+ *	accumulate histogram src into histogram dst
+ */
+void stress_latency_hist_merge(
+	stress_latency_hist_t *dst,
+	const stress_latency_hist_t *src)
+{
+	size_t i;
+
+	if (!src->count)
+		return;
+
+	for (i = 0; i < STRESS_LATENCY_BUCKETS; i++)
+		dst->buckets[i] += src->buckets[i];
+	dst->count += src->count;
+	dst->total_ns += src->total_ns;
+	dst->total_sq_ns += src->total_sq_ns;
+	if (src->min_ns < dst->min_ns)
+		dst->min_ns = src->min_ns;
+	if (src->max_ns > dst->max_ns)
+		dst->max_ns = src->max_ns;
+}
+
+/*
+ *  stress_latency_hist_bucket_value()
+ *	return the value a bucket represents, exact for the
+ *	linear buckets and the mid-point of the range for
+ *	the log-linear buckets
+ */
+uint64_t stress_latency_hist_bucket_value(const size_t idx)
+{
+	size_t i, shift;
+	uint64_t lo;
+
+	if (idx < STRESS_LATENCY_LINEAR)
+		return (uint64_t)idx;
+
+	i = idx - STRESS_LATENCY_LINEAR;
+	shift = (i / STRESS_LATENCY_SUB_BUCKETS) + 1;
+	lo = ((i % STRESS_LATENCY_SUB_BUCKETS) + STRESS_LATENCY_SUB_BUCKETS) << shift;
+
+	return lo + ((1ULL << shift) >> 1);
+}
+
+/*
+ *  stress_latency_hist_clamp()
+ *	bucket values are approximate, keep them inside
+ *	the range of values actually recorded
+ */
+static uint64_t stress_latency_hist_clamp(
+	const stress_latency_hist_t *hist,
+	const uint64_t ns)
+{
+	if (ns < hist->min_ns)
+		return hist->min_ns;
+	if (ns > hist->max_ns)
+		return hist->max_ns;
+	return ns;
+}
+
+/*
+ *  stress_latency_hist_percentile()
+ *	return the latency at which percentile % of the
+ *	samples are less than or equal to
+ */
+uint64_t stress_latency_hist_percentile(
+	const stress_latency_hist_t *hist,
+	const double percentile)
+{
+	uint64_t rank, sum = 0;
+	size_t i;
+
+	if (!hist->count)
+		return 0;
+	if (percentile >= 100.0)
+		return hist->max_ns;
+
+	rank = (uint64_t)ceil(((double)hist->count * percentile) / 100.0);
+	if (rank < 1)
+		rank = 1;
+
+	for (i = 0; i < STRESS_LATENCY_BUCKETS; i++) {
+		sum += hist->buckets[i];
+		if (sum >= rank)
+			return stress_latency_hist_clamp(hist, stress_latency_hist_bucket_value(i));
+	}
+	return hist->max_ns;
+}
+
+/*
+ *  stress_latency_hist_mode()
+ *	return the most frequent latency bucket value
+ */
+uint64_t stress_latency_hist_mode(const stress_latency_hist_t *hist)
+{
+	uint64_t best = 0;
+	size_t i, best_idx = 0;
+
+	if (!hist->count)
+		return 0;
+
+	for (i = 0; i < STRESS_LATENCY_BUCKETS; i++) {
+		if (hist->buckets[i] > best) {
+			best = hist->buckets[i];
+			best_idx = i;
+		}
+	}
+	return stress_latency_hist_clamp(hist, stress_latency_hist_bucket_value(best_idx));
+}
+
+/*
+ *  stress_latency_hist_mean()
+ *	return the mean latency
+ */
+double stress_latency_hist_mean(const stress_latency_hist_t *hist)
+{
+	return hist->count ? hist->total_ns / (double)hist->count : 0.0;
+}
+
+/*
+ *  stress_latency_hist_std_dev()
+ *	return the standard deviation of the latencies
+ */
+double stress_latency_hist_std_dev(const stress_latency_hist_t *hist)
+{
+	double mean, variance;
+
+	if (!hist->count)
+		return 0.0;
+
+	mean = hist->total_ns / (double)hist->count;
+	variance = (hist->total_sq_ns / (double)hist->count) - (mean * mean);
+
+	return (variance > 0.0) ? sqrt(variance) : 0.0;
+}
+
+static stress_latency_stat_t *stress_latency_stats = NULL;
+static size_t stress_latency_stats_size;
+static int32_t stress_latency_stats_procs;
+
+/*
+ *  stress_latency_map()
+ *	allocate shared per-instance latency statistics for
+ *	num_procs stressor instances, returns 0 if OK, -1 on error
+ */
+int stress_latency_map(const int32_t num_procs)
+{
+	const size_t page_size = stress_get_page_size();
+	size_t len;
+	int32_t i;
+
+	if (num_procs < 1)
+		return -1;
+
+	len = sizeof(*stress_latency_stats) * STRESS_LATENCY_MAX_IDS * (size_t)num_procs;
+	len = (len + page_size - 1) & ~(page_size - 1);
+	stress_latency_stats = (stress_latency_stat_t *)mmap(NULL, len,
+		PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANON, -1, 0);
+	if (stress_latency_stats == MAP_FAILED) {
+		stress_latency_stats = NULL;
+		return -1;
+	}
+	stress_set_vma_anon_name(stress_latency_stats, len, "latency-stats");
+	stress_latency_stats_size = len;
+	stress_latency_stats_procs = num_procs;
+
+	for (i = 0; i < num_procs * STRESS_LATENCY_MAX_IDS; i++) {
+		stress_latency_stats[i].description[0] = '\0';
+		stress_latency_hist_init(&stress_latency_stats[i].hist);
+	}
+	return 0;
+}
+
+/*
+ *  stress_latency_unmap()
+ *	free shared latency statistics
+ */
+void stress_latency_unmap(void)
+{
+	if (stress_latency_stats) {
+		(void)munmap((void *)stress_latency_stats, stress_latency_stats_size);
+		stress_latency_stats = NULL;
+	}
+}
+
+/*
+ *  stress_latency_instance()
+ *	return the STRESS_LATENCY_MAX_IDS latency statistics
+ *	for stressor instance n, NULL if latency stats are disabled
+ */
+stress_latency_stat_t *stress_latency_instance(const int32_t n)
+{
+	if (!stress_latency_stats || (n < 0) || (n >= stress_latency_stats_procs))
+		return NULL;
+	return &stress_latency_stats[n * STRESS_LATENCY_MAX_IDS];
+}
+
+/*
+ *  stress_latency_set_description()
+ *	name the latency path id, only named paths are reported
+ */
+void stress_latency_set_description(
+	stress_args_t *args,
+	const size_t id,
+	const char *description)
+{
+	if (!args->latency || (id >= STRESS_LATENCY_MAX_IDS))
+		return;
+	(void)shim_strscpy(args->latency[id].description, description,
+		sizeof(args->latency[id].description));
+}
+
+/*
+ *  stress_latency_merge()
+ *	merge latency path id histograms of all the instances
+ *	of a stressor, returns true if there is any data
+ */
+bool stress_latency_merge(
+	struct stress_stats * const *stats,
+	const int32_t instances,
+	const size_t id,
+	stress_latency_stat_t *merged)
+{
+	int32_t i;
+
+	merged->description[0] = '\0';
+	stress_latency_hist_init(&merged->hist);
+	if (id >= STRESS_LATENCY_MAX_IDS)
+		return false;
+
+	for (i = 0; i < instances; i++) {
+		const stress_latency_stat_t *latency = stats[i]->args.latency;
+
+		if (!latency || !latency[id].description[0])
+			continue;
+		if (!merged->description[0])
+			(void)shim_strscpy(merged->description, latency[id].description,
+				sizeof(merged->description));
+		stress_latency_hist_merge(&merged->hist, &latency[id].hist);
+	}
+	return merged->hist.count > 0;
+}
+
+/*
+ *  stress_latency_fault_init()
+ *	initialize first touch page fault latency classification and
+ *	name the minor, major and THP fault latency paths
+ */
+void stress_latency_fault_init(stress_args_t *args, stress_latency_fault_t *fault)
+{
+	size_t thp_size = STRESS_LATENCY_THP_SIZE;
+#if defined(__linux__)
+	char buf[64];
+
+	if (stress_system_read("/sys/kernel/mm/transparent_hugepage/hpage_pmd_size",
+			       buf, sizeof(buf)) > 0) {
+		unsigned long int val;
+
+		if ((sscanf(buf, "%lu", &val) == 1) && (val > 0) && !(val & (val - 1)))
+			thp_size = (size_t)val;
+	}
+#endif
+	(void)shim_memset(fault, 0, sizeof(*fault));
+	fault->thp_mask = ~((uintptr_t)thp_size - 1);
+
+	stress_latency_set_description(args, STRESS_LATENCY_FAULT_MINOR, "minor fault");
+	stress_latency_set_description(args, STRESS_LATENCY_FAULT_MAJOR, "major fault");
+	stress_latency_set_description(args, STRESS_LATENCY_FAULT_THP, "THP fault");
+}
+
+/*
+ *  stress_latency_fault_begin()
+ *	snapshot fault counts and return the start time of a touch
+ */
+uint64_t stress_latency_fault_begin(stress_latency_fault_t *fault)
+{
+	struct rusage usage;
+
+	if (LIKELY(shim_getrusage(STRESS_LATENCY_RUSAGE, &usage) == 0)) {
+		fault->minflt = usage.ru_minflt;
+		fault->majflt = usage.ru_majflt;
+	}
+	return stress_latency_now();
+}
+
+/*
+ *  stress_latency_fault_end()
+ *	classify and record the latency of the touch of addr that
+ *	started at t_begin, touches that did not fault are not recorded
+ */
+void stress_latency_fault_end(
+	stress_args_t *args,
+	stress_latency_fault_t *fault,
+	const void *addr,
+	const uint64_t t_begin)
+{
+	const uint64_t ns = stress_latency_now() - t_begin;
+	const uintptr_t region = (uintptr_t)addr & fault->thp_mask;
+	struct rusage usage;
+
+	if (UNLIKELY(shim_getrusage(STRESS_LATENCY_RUSAGE, &usage) < 0))
+		return;
+
+	if (usage.ru_majflt > fault->majflt) {
+		stress_latency_record(args, STRESS_LATENCY_FAULT_MAJOR, ns);
+	} else if (usage.ru_minflt > fault->minflt) {
+		/* a new minor fault, the pending one was not a THP fault */
+		stress_latency_fault_flush(args, fault);
+		fault->pending = true;
+		fault->pending_addr = region;
+		fault->pending_ns = ns;
+	} else if (fault->pending) {
+		/* no fault, pending fault populated a huge page if in the same region */
+		if (fault->pending_addr == region) {
+			stress_latency_record(args, STRESS_LATENCY_FAULT_THP, fault->pending_ns);
+			fault->pending = false;
+		} else {
+			stress_latency_fault_flush(args, fault);
+		}
+	}
+}
+
+/*
+ *  stress_latency_fault_flush()
+ *	record any pending minor fault as a minor fault
+ */
+void stress_latency_fault_flush(stress_args_t *args, stress_latency_fault_t *fault)
+{
+	if (fault->pending) {
+		stress_latency_record(args, STRESS_LATENCY_FAULT_MINOR, fault->pending_ns);
+		fault->pending = false;
+	}
+}
+
+/*
+ *  stress_latency_fault_touch_pages()
+ *	write to the first byte of each page in buf timing
+ *	the first touch page faults
+ */
+void stress_latency_fault_touch_pages(
+	stress_args_t *args,
+	stress_latency_fault_t *fault,
+	void *buf,
+	const size_t buf_len,
+	const size_t page_size)
+{
+	volatile uint8_t *ptr = (volatile uint8_t *)buf;
+	const volatile uint8_t *end = ptr + buf_len;
+
+	while (LIKELY(stress_continue_flag() && (ptr < end))) {
+		const uint64_t t_begin = stress_latency_fault_begin(fault);
+
+		*ptr = 0;
+		stress_latency_fault_end(args, fault, (const void *)ptr, t_begin);
+		ptr += page_size;
+	}
+	stress_latency_fault_flush(args, fault);
+}
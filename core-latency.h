@@ -0,0 +1,212 @@
+/*
+ * Copyright (C) 2025      Colin Ian King
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+#ifndef CORE_LATENCY_H
+#define CORE_LATENCY_H
+
+#include "core-attribute.h"
+
+/*
+ *  Log-linear latency histogram. Values 0..63 ns are recorded
+ *  exactly, larger values are recorded into 32 linear sub-buckets
+ *  per power of 2, giving a worst case error of ~3% over the
+ *  entire 64 bit range with a fixed memory footprint.
+ */
+#define STRESS_LATENCY_SUB_BITS		(5)
+#define STRESS_LATENCY_SUB_BUCKETS	(1ULL << STRESS_LATENCY_SUB_BITS)
+#define STRESS_LATENCY_LINEAR		(STRESS_LATENCY_SUB_BUCKETS * 2)
+#define STRESS_LATENCY_BUCKETS		(STRESS_LATENCY_LINEAR + \
+					 ((64 - STRESS_LATENCY_SUB_BITS - 1) * STRESS_LATENCY_SUB_BUCKETS))
+
+typedef struct {
+	uint64_t	count;		/* number of samples */
+	uint64_t	min_ns;		/* minimum sample */
+	uint64_t	max_ns;		/* maximum sample */
+	double		total_ns;	/* sum of samples */
+	double		total_sq_ns;	/* sum of squares of samples */
+	uint64_t	buckets[STRESS_LATENCY_BUCKETS];
+} stress_latency_hist_t;
+
+/*
+ *  stress_latency_hist_index()
+ *	map a nanosecond value to a histogram bucket index
+ */
+static inline size_t ALWAYS_INLINE stress_latency_hist_index(const uint64_t ns)
+{
+	int msb, shift;
+
+	if (ns < STRESS_LATENCY_LINEAR)
+		return (size_t)ns;
+#if defined(HAVE_BUILTIN_CLZLL)
+	msb = 63 - __builtin_clzll((unsigned long long int)ns);
+#else
+	{
+		uint64_t v = ns;
+
+		for (msb = -1; v; msb++)
+			v >>= 1;
+	}
+#endif
+	shift = msb - STRESS_LATENCY_SUB_BITS;
+	return (size_t)(STRESS_LATENCY_LINEAR +
+		((uint64_t)(shift - 1) * STRESS_LATENCY_SUB_BUCKETS) +
+		((ns >> shift) - STRESS_LATENCY_SUB_BUCKETS));
+}
+
+/*
+ *  stress_latency_hist_record()
+ *	add a latency sample to a histogram, O(1)
+ */
+static inline void ALWAYS_INLINE stress_latency_hist_record(
+	stress_latency_hist_t *hist,
+	const uint64_t ns)
+{
+	const double dns = (double)ns;
+
+	hist->buckets[stress_latency_hist_index(ns)]++;
+	hist->count++;
+	hist->total_ns += dns;
+	hist->total_sq_ns += dns * dns;
+	if (UNLIKELY(ns < hist->min_ns))
+		hist->min_ns = ns;
+	if (UNLIKELY(ns > hist->max_ns))
+		hist->max_ns = ns;
+}
+
+/*
+ *  Per stressor instance latency statistics, enabled with --latency,
+ *  each instance can record up to STRESS_LATENCY_MAX_IDS different
+ *  latency paths (e.g. wakeup, round-trip) identified by id
+ */
+#define STRESS_LATENCY_MAX_IDS		(4)
+#define STRESS_LATENCY_DESC_LEN		(32)
+
+typedef struct stress_latency_stat {
+	char		description[STRESS_LATENCY_DESC_LEN];	/* latency path name */
+	stress_latency_hist_t hist;	/* latency histogram */
+} stress_latency_stat_t;
+
+/*
+ *  stress_latency_enabled()
+ *	true if latency recording is enabled for this instance,
+ *	use this to avoid the cost of time stamping when disabled
+ */
+static inline bool ALWAYS_INLINE stress_latency_enabled(stress_args_t *args)
+{
+	return args->latency != NULL;
+}
+
+/*
+ *  stress_latency_now()
+ *	monotonic time in nanoseconds for latency measurements
+ */
+static inline uint64_t ALWAYS_INLINE stress_latency_now(void)
+{
+#if defined(HAVE_CLOCK_GETTIME) &&	\
+    defined(CLOCK_MONOTONIC)
+	struct timespec ts;
+
+	if (LIKELY(clock_gettime(CLOCK_MONOTONIC, &ts) == 0))
+		return ((uint64_t)ts.tv_sec * STRESS_NANOSECOND) + (uint64_t)ts.tv_nsec;
+#endif
+	return (uint64_t)(stress_time_now() * STRESS_DBL_NANOSECOND);
+}
+
+/*
+ *  stress_latency_record()
+ *	record a latency of ns nanoseconds for latency path id,
+ *	a no-op if --latency is not enabled
+ */
+static inline void ALWAYS_INLINE stress_latency_record(
+	stress_args_t *args,
+	const size_t id,
+	const uint64_t ns)
+{
+	if (args->latency && LIKELY(id < STRESS_LATENCY_MAX_IDS))
+		stress_latency_hist_record(&args->latency[id].hist, ns);
+}
+
+/*
+ *  stress_latency_begin()
+ *	start timestamp of a latency measurement, zero if disabled
+ */
+static inline uint64_t ALWAYS_INLINE stress_latency_begin(stress_args_t *args)
+{
+	return args->latency ? stress_latency_now() : 0;
+}
+
+/*
+ *  stress_latency_end()
+ *	record time elapsed since stress_latency_begin for path id
+ */
+static inline void ALWAYS_INLINE stress_latency_end(
+	stress_args_t *args,
+	const size_t id,
+	const uint64_t t_begin)
+{
+	if (args->latency)
+		stress_latency_record(args, id, stress_latency_now() - t_begin);
+}
+
+/*
+ *  First touch page fault latency, faults are classified as minor,
+ *  major or THP faults from getrusage fault count deltas and recorded
+ *  into the --latency paths below. A minor fault is only known to be
+ *  a THP fault once a later touch in the same huge page does not
+ *  fault, so the classification of minor faults is deferred.
+ */
+#define STRESS_LATENCY_FAULT_MINOR	(0)
+#define STRESS_LATENCY_FAULT_MAJOR	(1)
+#define STRESS_LATENCY_FAULT_THP	(2)
+
+typedef struct {
+	long int minflt;		/* minor faults before the touch */
+	long int majflt;		/* major faults before the touch */
+	uintptr_t thp_mask;		/* ~(THP size - 1) */
+	uintptr_t pending_addr;		/* THP region of pending minor fault */
+	uint64_t pending_ns;		/* latency of pending minor fault */
+	bool pending;			/* true if a minor fault is pending */
+} stress_latency_fault_t;
+
+extern void stress_latency_fault_init(stress_args_t *args, stress_latency_fault_t *fault);
+extern uint64_t stress_latency_fault_begin(stress_latency_fault_t *fault);
+extern void stress_latency_fault_end(stress_args_t *args, stress_latency_fault_t *fault,
+	const void *addr, const uint64_t t_begin);
+extern void stress_latency_fault_flush(stress_args_t *args, stress_latency_fault_t *fault);
+extern void stress_latency_fault_touch_pages(stress_args_t *args, stress_latency_fault_t *fault,
+	void *buf, const size_t buf_len, const size_t page_size);
+
+extern void stress_latency_hist_init(stress_latency_hist_t *hist);
+extern void stress_latency_hist_merge(stress_latency_hist_t *dst,
+	const stress_latency_hist_t *src);
+extern uint64_t stress_latency_hist_bucket_value(const size_t idx);
+extern uint64_t stress_latency_hist_percentile(const stress_latency_hist_t *hist,
+	const double percentile);
+extern uint64_t stress_latency_hist_mode(const stress_latency_hist_t *hist);
+extern double stress_latency_hist_mean(const stress_latency_hist_t *hist);
+extern double stress_latency_hist_std_dev(const stress_latency_hist_t *hist);
+
+extern void stress_latency_set_description(stress_args_t *args, const size_t id,
+	const char *description);
+extern int stress_latency_map(const int32_t num_procs);
+extern void stress_latency_unmap(void);
+extern stress_latency_stat_t *stress_latency_instance(const int32_t n);
+extern bool stress_latency_merge(struct stress_stats * const *stats,
+	const int32_t instances, const size_t id, stress_latency_stat_t *merged);
+
+#endif
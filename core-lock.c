@@ -109,13 +109,38 @@
 #define LOCK_METHOD_SEM_SYSV		(0)
 #endif
 
+/*
+ *  Ticket and MCS queue locks are optional fair lock types
+ *  that can be selected at run time with --lock-type
+ */
+#if defined(HAVE_ATOMIC_FETCH_ADD) &&		\
+    defined(HAVE_ATOMIC_LOAD) &&		\
+    defined(HAVE_ATOMIC_STORE)
+#define LOCK_METHOD_TICKET		(0x0080)
+#else
+#define LOCK_METHOD_TICKET		(0)
+#endif
+
+#if defined(HAVE_ATOMIC_COMPARE_EXCHANGE) &&	\
+    defined(HAVE_ATOMIC_LOAD) &&		\
+    defined(HAVE_ATOMIC_STORE)
+#define LOCK_METHOD_MCS			(0x0100)
+#else
+#define LOCK_METHOD_MCS			(0)
+#endif
+
 #define LOCK_METHOD_ALL			\
 	(LOCK_METHOD_ATOMIC_SPINLOCK |	\
 	 LOCK_METHOD_PTHREAD_SPINLOCK | \
 	 LOCK_METHOD_PTHREAD_MUTEX |	\
 	 LOCK_METHOD_FUTEX |		\
 	 LOCK_METHOD_SEM_POSIX | 	\
-	 LOCK_METHOD_SEM_SYSV)
+	 LOCK_METHOD_SEM_SYSV |		\
+	 LOCK_METHOD_TICKET |		\
+	 LOCK_METHOD_MCS)
+
+#define STRESS_LOCK_MCS_NODES	(4096)	/* max concurrent MCS lock waiters */
+#define STRESS_LOCK_SPINS	(64)	/* spins before yielding */
 
 typedef union {
 #if LOCK_METHOD_ATOMIC_SPINLOCK != 0
@@ -138,8 +163,33 @@ typedef union {
 typedef struct stress_lock {
 	uint32_t	magic;		/* Lock magic struct pattern, zero when not in use */
 	stress_lock_u_t u;		/* Lock union */
+#if LOCK_METHOD_TICKET != 0
+	struct {
+		uint32_t next;		/* next ticket to hand out */
+		uint32_t serving;	/* ticket now being served */
+	} ticket;
+#endif
+#if LOCK_METHOD_MCS != 0
+	struct {
+		uint32_t tail;		/* index + 1 of tail waiter node, 0 = unlocked */
+		uint32_t owner;		/* index + 1 of lock owner node */
+	} mcs;
+#endif
 } stress_lock_t;
 
+#if LOCK_METHOD_MCS != 0
+/*
+ *  MCS waiter queue node, one per waiter, allocated from the
+ *  locks shared memory region, cacheline aligned so each waiter
+ *  spins on its own cacheline
+ */
+typedef struct {
+	uint32_t next;			/* index + 1 of next waiter, 0 = none */
+	bool	locked;			/* true whilst waiting for the lock */
+	bool	in_use;			/* node allocated to a waiter */
+} ALIGN64 stress_lock_mcs_node_t;
+#endif
+
 typedef struct stress_lock_funcs {
 	const char *type;
 	int (*init)(struct stress_lock *lock);
@@ -151,6 +201,9 @@ typedef struct stress_lock_funcs {
 
 static stress_lock_t *stress_locks;
 static stress_lock_t *stress_lock_big_lock;
+#if LOCK_METHOD_MCS != 0
+static stress_lock_mcs_node_t *stress_lock_mcs_nodes;
+#endif
 
 static stress_lock_t *stress_lock_get(void);
 static int stress_lock_put(stress_lock_t *lock);
@@ -262,7 +315,7 @@ static int stress_atomic_lock_release(stress_lock_t *lock)
 	return 0;
 }
 
-static const stress_lock_funcs_t stress_lock_funcs = {
+static const stress_lock_funcs_t stress_lock_funcs_default = {
 	"atomic",
 	stress_atomic_lock_init,
 	stress_atomic_lock_deinit,
@@ -322,7 +375,7 @@ static int stress_pthread_spinlock_release(stress_lock_t *lock)
 	return -1;
 }
 
-static const stress_lock_funcs_t stress_lock_funcs = {
+static const stress_lock_funcs_t stress_lock_funcs_default = {
 	"spinlock",
 	stress_pthread_spinlock_init,
 	stress_pthread_spinlock_deinit,
@@ -378,7 +431,7 @@ static int stress_pthread_mutex_release(stress_lock_t *lock)
 	return -1;
 }
 
-static const stress_lock_funcs_t stress_lock_funcs = {
+static const stress_lock_funcs_t stress_lock_funcs_default = {
 	"pthread-mutex",
 	stress_pthread_mutex_init,
 	stress_pthread_mutex_deinit,
@@ -425,7 +478,7 @@ static int stress_mtx_release(stress_lock_t *lock)
 	return -1;
 }
 
-static const stress_lock_funcs_t stress_lock_funcs = {
+static const stress_lock_funcs_t stress_lock_funcs_default = {
 	"OSI-C-mtx",
 	stress_mtx_init,
 	stress_mtx_deinit,
@@ -462,7 +515,7 @@ static int stress_futex_release(stress_lock_t *lock)
 	return (int)syscall(__NR_futex, &lock->u.futex, FUTEX_UNLOCK_PI, 0, 0, 0, 0);
 }
 
-static const stress_lock_funcs_t stress_lock_funcs = {
+static const stress_lock_funcs_t stress_lock_funcs_default = {
 	"futex",
 	stress_futex_init,
 	stress_futex_deinit,
@@ -497,7 +550,7 @@ static int stress_sem_posix_release(stress_lock_t *lock)
 	return sem_post(&lock->u.sem_posix);
 }
 
-static const stress_lock_funcs_t stress_lock_funcs = {
+static const stress_lock_funcs_t stress_lock_funcs_default = {
 	"sem-posix",
 	stress_sem_posix_init,
 	stress_sem_posix_deinit,
@@ -562,7 +615,7 @@ static int stress_sem_sysv_release(stress_lock_t *lock)
 	return semop(lock->u.sem_id, sops, 1);
 }
 
-static const stress_lock_funcs_t stress_lock_funcs = {
+static const stress_lock_funcs_t stress_lock_funcs_default = {
 	"sem-sysv",
 	stress_sem_sysv_init,
 	stress_sem_sysv_deinit,
@@ -580,7 +633,7 @@ static int PURE stress_no_lock_fail(stress_lock_t *lock)
 	return -1;
 }
 
-static const stress_lock_funcs_t stress_lock_funcs = {
+static const stress_lock_funcs_t stress_lock_funcs_default = {
 	"no-lock",
 	stress_no_lock_fail,
 	stress_no_lock_fail,
@@ -591,6 +644,250 @@ static const stress_lock_funcs_t stress_lock_funcs = {
 
 #endif
 
+#if LOCK_METHOD_TICKET != 0 ||	\
+    LOCK_METHOD_MCS != 0
+/*
+ *  stress_lock_spin_relax()
+ *	relax whilst spin waiting, yield every STRESS_LOCK_SPINS
+ *	spins to allow lock holders to run on over-committed systems
+ */
+static inline void stress_lock_spin_relax(uint32_t *spins)
+{
+	if (++(*spins) < STRESS_LOCK_SPINS) {
+#if defined(HAVE_ASM_X86_PAUSE)
+		stress_asm_x86_pause();
+#elif defined(HAVE_ASM_LOONG64_DBAR)
+		stress_asm_loong64_dbar();
+#elif defined(STRESS_ARCH_PPC64)
+		stress_asm_ppc64_yield();
+#elif defined(STRESS_ARCH_RISCV)
+		stress_asm_riscv_pause();
+#else
+		stress_asm_nop();
+#endif
+	} else {
+		*spins = 0;
+		(void)shim_sched_yield();
+	}
+}
+#endif
+
+/*
+ *  Locking via ticket lock
+ */
+#if LOCK_METHOD_TICKET != 0
+static int stress_ticket_lock_init(stress_lock_t *lock)
+{
+	lock->ticket.next = 0;
+	lock->ticket.serving = 0;
+
+	return 0;
+}
+
+static int PURE stress_ticket_lock_deinit(stress_lock_t *lock)
+{
+	(void)lock;
+
+	return 0;
+}
+
+static int stress_ticket_lock_acquire(stress_lock_t *lock)
+{
+	const uint32_t ticket = __atomic_fetch_add(&lock->ticket.next, 1, __ATOMIC_RELAXED);
+	uint32_t spins = 0;
+
+	while (__atomic_load_n(&lock->ticket.serving, __ATOMIC_ACQUIRE) != ticket)
+		stress_lock_spin_relax(&spins);
+
+	return 0;
+}
+
+static int stress_ticket_lock_release(stress_lock_t *lock)
+{
+	const uint32_t serving = lock->ticket.serving + 1;
+
+	__atomic_store_n(&lock->ticket.serving, serving, __ATOMIC_RELEASE);
+
+	return 0;
+}
+
+static const stress_lock_funcs_t stress_lock_funcs_ticket = {
+	"ticket",
+	stress_ticket_lock_init,
+	stress_ticket_lock_deinit,
+	stress_ticket_lock_acquire,
+	stress_ticket_lock_acquire,
+	stress_ticket_lock_release
+};
+#endif
+
+/*
+ *  Locking via MCS queue lock, each waiter spins on
+ *  its own queue node and the lock is handed over
+ *  in FIFO order
+ */
+#if LOCK_METHOD_MCS != 0
+/*
+ *  stress_mcs_node_get()
+ *	allocate a free MCS waiter node, returns index + 1
+ */
+static uint32_t stress_mcs_node_get(void)
+{
+	uint32_t i = (uint32_t)(getpid() + shim_gettid()) % STRESS_LOCK_MCS_NODES;
+	uint32_t n = 0, spins = 0;
+
+	for (;;) {
+		stress_lock_mcs_node_t *node = &stress_lock_mcs_nodes[i];
+		bool in_use = false;
+
+		if (__atomic_compare_exchange_n(&node->in_use, &in_use, true,
+						false, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED))
+			return i + 1;
+		i = (i + 1) % STRESS_LOCK_MCS_NODES;
+		if (++n >= STRESS_LOCK_MCS_NODES) {
+			/* all nodes busy, wait a while */
+			n = 0;
+			stress_lock_spin_relax(&spins);
+		}
+	}
+}
+
+static int stress_mcs_lock_init(stress_lock_t *lock)
+{
+	lock->mcs.tail = 0;
+	lock->mcs.owner = 0;
+
+	return 0;
+}
+
+static int PURE stress_mcs_lock_deinit(stress_lock_t *lock)
+{
+	(void)lock;
+
+	return 0;
+}
+
+static int stress_mcs_lock_acquire(stress_lock_t *lock)
+{
+	const uint32_t idx = stress_mcs_node_get();
+	stress_lock_mcs_node_t *node = &stress_lock_mcs_nodes[idx - 1];
+	uint32_t prev, spins = 0;
+
+	node->next = 0;
+	node->locked = true;
+
+	/* atomically swap ourselves in as the new tail */
+	prev = __atomic_load_n(&lock->mcs.tail, __ATOMIC_RELAXED);
+	while (!__atomic_compare_exchange_n(&lock->mcs.tail, &prev, idx,
+					    false, __ATOMIC_ACQ_REL, __ATOMIC_RELAXED))
+		;
+
+	if (prev) {
+		__atomic_store_n(&stress_lock_mcs_nodes[prev - 1].next, idx, __ATOMIC_RELEASE);
+		while (__atomic_load_n(&node->locked, __ATOMIC_ACQUIRE))
+			stress_lock_spin_relax(&spins);
+	}
+	lock->mcs.owner = idx;
+
+	return 0;
+}
+
+static int stress_mcs_lock_release(stress_lock_t *lock)
+{
+	const uint32_t idx = lock->mcs.owner;
+	stress_lock_mcs_node_t *node;
+	uint32_t next, spins = 0;
+
+	if (UNLIKELY(idx == 0)) {
+		errno = EINVAL;
+		return -1;
+	}
+	node = &stress_lock_mcs_nodes[idx - 1];
+	lock->mcs.owner = 0;
+
+	next = __atomic_load_n(&node->next, __ATOMIC_ACQUIRE);
+	if (next == 0) {
+		uint32_t expected = idx;
+
+		/* no known successor, try to mark lock as free */
+		if (__atomic_compare_exchange_n(&lock->mcs.tail, &expected, 0,
+						false, __ATOMIC_RELEASE, __ATOMIC_RELAXED))
+			goto free_node;
+		/* a successor is enqueuing, wait for it to link in */
+		while ((next = __atomic_load_n(&node->next, __ATOMIC_ACQUIRE)) == 0)
+			stress_lock_spin_relax(&spins);
+	}
+	__atomic_store_n(&stress_lock_mcs_nodes[next - 1].locked, false, __ATOMIC_RELEASE);
+free_node:
+	__atomic_store_n(&node->in_use, false, __ATOMIC_RELEASE);
+
+	return 0;
+}
+
+static const stress_lock_funcs_t stress_lock_funcs_mcs = {
+	"mcs",
+	stress_mcs_lock_init,
+	stress_mcs_lock_deinit,
+	stress_mcs_lock_acquire,
+	stress_mcs_lock_acquire,
+	stress_mcs_lock_release
+};
+#endif
+
+/*
+ *  Lock types that can be selected with --lock-type
+ */
+static const stress_lock_funcs_t * const stress_lock_types[] = {
+	&stress_lock_funcs_default,
+#if LOCK_METHOD_TICKET != 0
+	&stress_lock_funcs_ticket,
+#endif
+#if LOCK_METHOD_MCS != 0
+	&stress_lock_funcs_mcs,
+#endif
+};
+
+static const stress_lock_funcs_t *stress_lock_funcs = &stress_lock_funcs_default;
+
+/*
+ *  stress_lock_set_type()
+ *	select lock type by name, "default" is the compiled in
+ *	default lock type, returns 0 if OK, -1 if not found
+ */
+int stress_lock_set_type(const char *name)
+{
+	size_t i;
+
+	if (!strcmp(name, "default")) {
+		stress_lock_funcs = &stress_lock_funcs_default;
+		return 0;
+	}
+	for (i = 0; i < SIZEOF_ARRAY(stress_lock_types); i++) {
+		if (!strcmp(name, stress_lock_types[i]->type)) {
+			stress_lock_funcs = stress_lock_types[i];
+			return 0;
+		}
+	}
+	if (strcmp(name, "which"))
+		(void)fprintf(stderr, "Invalid lock-type option: %s\n", name);
+
+	(void)fprintf(stderr, "Available options are: default");
+	for (i = 0; i < SIZEOF_ARRAY(stress_lock_types); i++)
+		(void)fprintf(stderr, " %s", stress_lock_types[i]->type);
+	(void)fprintf(stderr, "\n");
+
+	return -1;
+}
+
+/*
+ *  stress_lock_type_name()
+ *	return the name of the selected lock type
+ */
+const char *stress_lock_type_name(void)
+{
+	return stress_lock_funcs->type;
+}
+
 /*
  *  stress_lock_create()
  *	generic lock creation and initialization
@@ -611,7 +908,7 @@ void *stress_lock_create(const char *name)
 	if (UNLIKELY(!lock))
 		return NULL;
 
-	if (LIKELY(stress_lock_funcs.init(lock) == 0))
+	if (LIKELY(stress_lock_funcs->init(lock) == 0))
 		return lock;
 
 	VOID_RET(int, stress_lock_destroy(lock));
@@ -627,7 +924,7 @@ int stress_lock_destroy(void *lock_handle)
 	stress_lock_t *lock = (stress_lock_t *)lock_handle;
 
 	if (LIKELY(stress_lock_valid(lock))) {
-		(void)stress_lock_funcs.deinit(lock);
+		(void)stress_lock_funcs->deinit(lock);
 		return stress_lock_put(lock);
 	}
 	errno = EINVAL;
@@ -643,7 +940,7 @@ int stress_lock_acquire(void *lock_handle)
 	stress_lock_t *lock = (stress_lock_t *)lock_handle;
 
 	if (LIKELY(stress_lock_valid(lock)))
-		return stress_lock_funcs.acquire(lock);
+		return stress_lock_funcs->acquire(lock);
 
 	errno = EINVAL;
 	return -1;
@@ -658,7 +955,7 @@ int stress_lock_acquire_relax(void *lock_handle)
 	stress_lock_t *lock = (stress_lock_t *)lock_handle;
 
 	if (LIKELY(stress_lock_valid(lock)))
-		return stress_lock_funcs.acquire_relax(lock);
+		return stress_lock_funcs->acquire_relax(lock);
 
 	errno = EINVAL;
 	return -1;
@@ -673,7 +970,7 @@ int stress_lock_release(void *lock_handle)
 	stress_lock_t *lock = (stress_lock_t *)lock_handle;
 
 	if (LIKELY(stress_lock_valid(lock)))
-		return stress_lock_funcs.release(lock);
+		return stress_lock_funcs->release(lock);
 
 	errno = EINVAL;
 	return -1;
@@ -692,7 +989,7 @@ static stress_lock_t *stress_lock_get(void)
 		return NULL;
 	if (UNLIKELY(!stress_lock_valid(stress_lock_big_lock)))
 		return NULL;
-	if (UNLIKELY(stress_lock_funcs.acquire(stress_lock_big_lock) < 0))
+	if (UNLIKELY(stress_lock_funcs_default.acquire(stress_lock_big_lock) < 0))
 		return NULL;
 	for (i = 0; i < STRESS_LOCK_MAX; i++) {
 		if (stress_locks[i].magic == STRESS_LOCK_MAGIC_FREE) {
@@ -701,7 +998,7 @@ static stress_lock_t *stress_lock_get(void)
 			break;
 		}
 	}
-	stress_lock_funcs.release(stress_lock_big_lock);
+	stress_lock_funcs_default.release(stress_lock_big_lock);
 
 	return lock;
 
@@ -721,12 +1018,12 @@ static int stress_lock_put(stress_lock_t *lock)
 		return -1;
 	if (UNLIKELY(!stress_lock_valid(stress_lock_big_lock)))
 		return -1;
-	if (UNLIKELY(stress_lock_funcs.acquire(stress_lock_big_lock) < 0))
+	if (UNLIKELY(stress_lock_funcs_default.acquire(stress_lock_big_lock) < 0))
 		return -1;
 
 	(void)shim_memset(lock, 0, sizeof(*lock));
 
-	stress_lock_funcs.release(stress_lock_big_lock);
+	stress_lock_funcs_default.release(stress_lock_big_lock);
 
 	return 0;
 }
@@ -748,13 +1045,28 @@ int stress_lock_mem_map(void)
 	if (UNLIKELY(stress_locks == MAP_FAILED))
 		return -1;
 
-	(void)snprintf(name, sizeof(name), "lock-%s", stress_lock_funcs.type);
+	(void)snprintf(name, sizeof(name), "lock-%s", stress_lock_funcs->type);
 	stress_set_vma_anon_name(stress_locks, mmap_size, name);
 
 	stress_lock_big_lock = &stress_locks[0];
-	stress_lock_funcs.init(stress_lock_big_lock);
+	stress_lock_funcs_default.init(stress_lock_big_lock);
 	stress_lock_big_lock->magic = STRESS_LOCK_MAGIC;
 
+#if LOCK_METHOD_MCS != 0
+	if (stress_lock_funcs == &stress_lock_funcs_mcs) {
+		mmap_size = STRESS_LOCK_MCS_NODES * sizeof(*stress_lock_mcs_nodes);
+		stress_lock_mcs_nodes = (stress_lock_mcs_node_t *)mmap(NULL, mmap_size,
+						PROT_READ | PROT_WRITE,
+						MAP_ANONYMOUS | MAP_SHARED,
+						-1, 0);
+		if (UNLIKELY(stress_lock_mcs_nodes == MAP_FAILED)) {
+			stress_lock_mcs_nodes = NULL;
+			stress_lock_mem_unmap();
+			return -1;
+		}
+		stress_set_vma_anon_name(stress_lock_mcs_nodes, mmap_size, "lock-mcs-nodes");
+	}
+#endif
 	return 0;
 }
 
@@ -766,6 +1078,13 @@ void stress_lock_mem_unmap(void)
 {
 	const size_t mmap_size = STRESS_LOCK_MAX * sizeof(*stress_locks);
 
+#if LOCK_METHOD_MCS != 0
+	if (stress_lock_mcs_nodes) {
+		(void)munmap((void *)stress_lock_mcs_nodes,
+			STRESS_LOCK_MCS_NODES * sizeof(*stress_lock_mcs_nodes));
+		stress_lock_mcs_nodes = NULL;
+	}
+#endif
 	(void)munmap((void *)stress_locks, mmap_size);
 	stress_locks = NULL;
 	stress_lock_big_lock = NULL;
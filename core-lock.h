@@ -23,6 +23,8 @@
 
 extern int stress_lock_mem_map(void);
 extern void stress_lock_mem_unmap(void);
+extern int stress_lock_set_type(const char *name);
+extern const char *stress_lock_type_name(void);
 
 extern void *stress_lock_create(const char *name);
 extern int stress_lock_destroy(void *lock_handle);
@@ -44,6 +44,17 @@ typedef struct {
 
 pr_msg_buf_t pr_msg_buf;
 
+/*
+ *  Messages are also copied into the capture buffer while capturing,
+ *  this is per process and not shared
+ */
+typedef struct {
+	char *buf;	/* captured messages, NULL if not capturing */
+	size_t len;	/* size of buf */
+} pr_capture_t;
+
+static pr_capture_t pr_capture;
+
 static inline int pr_fd(void)
 {
 	return (g_opt_flags & OPT_FLAGS_STDERR) ? fileno(stderr) : fileno(stdout);
@@ -125,6 +136,31 @@ static void pr_log_write(const char *buf, const size_t buf_len)
 	pr_log_write_buf(buf, buf_len);
 }
 
+/*
+ *  pr_capture_begin()
+ *	copy the text of all non-debug messages into buf until
+ *	pr_capture_end(), messages are captured even if they are
+ *	not printed
+ */
+void pr_capture_begin(char *buf, const size_t len)
+{
+	if (!len)
+		return;
+	*buf = '\0';
+	pr_capture.buf = buf;
+	pr_capture.len = len;
+}
+
+/*
+ *  pr_capture_end()
+ *	stop capturing messages
+ */
+void pr_capture_end(void)
+{
+	pr_capture.buf = NULL;
+	pr_capture.len = 0;
+}
+
 /*
  *  pr_block_begin()
  *	start of buffering messages up for a final atomic write
@@ -141,12 +177,15 @@ void pr_block_begin(void)
  */
 void pr_block_end(void)
 {
-	if (pr_msg_buf.buf && (pr_msg_buf.pid == getpid())) {
+	if (pr_msg_buf.pid != getpid())
+		return;
+	/* empty blocks must also end buffering */
+	if (pr_msg_buf.buf) {
 		pr_log_write_buf(pr_msg_buf.buf, strlen(pr_msg_buf.buf));
 		free(pr_msg_buf.buf);
 		pr_msg_buf.buf = NULL;
-		pr_msg_buf.pid = -1;
 	}
+	pr_msg_buf.pid = -1;
 }
 
 /*
@@ -229,6 +268,15 @@ static int pr_msg(
 	char ts[32];
 	pid_t pid = getpid();
 
+	if (pr_capture.buf && !(flag & OPT_FLAGS_PR_DEBUG)) {
+		const size_t len = strlen(pr_capture.buf);
+		va_list aq;
+
+		va_copy(aq, ap);
+		(void)vsnprintf(pr_capture.buf + len, pr_capture.len - len, fmt, aq);
+		va_end(aq);
+	}
+
 	if (g_opt_flags & OPT_FLAGS_TIMESTAMP) {
 		struct timeval tv;
 		static const char empty_ts[] = "xx-xx-xx.xxx ";
@@ -23,6 +23,8 @@
 
 extern void pr_block_begin(void);
 extern void pr_block_end(void);
+extern void pr_capture_begin(char *buf, const size_t len);
+extern void pr_capture_end(void);
 extern void pr_fail_check(int *const rc);
 extern int pr_yaml(FILE *fp, const char *const fmt, ...) FORMAT(printf, 2, 3);
 extern void pr_closelog(void);
@@ -0,0 +1,227 @@
+/*
+ * Copyright (C) 2025      Colin Ian King.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+#include "stress-ng.h"
+#include "core-builtin.h"
+#include "core-memfootprint.h"
+
+#define MEMFOOTPRINT_BUF_SIZE	(4096)
+
+typedef struct {
+	uint64_t rss_kb;		/* Rss: */
+	uint64_t pss_kb;		/* Pss: */
+	uint64_t uss_kb;		/* Private_Clean: + Private_Dirty: */
+	uint64_t anon_kb;		/* Anonymous: */
+	uint64_t anon_huge_kb;		/* AnonHugePages: */
+} stress_memfootprint_rollup_t;
+
+/*
+ *  stress_memfootprint_rollup()
+ *	add the /proc/pid/smaps_rollup memory usage of pid to rollup,
+ *	returns false if it cannot be read
+ */
+static bool stress_memfootprint_rollup(const pid_t pid, stress_memfootprint_rollup_t *rollup)
+{
+	static const struct {
+		const char *field;
+		const size_t offset;
+	} fields[] = {
+		{ "Rss:",		offsetof(stress_memfootprint_rollup_t, rss_kb) },
+		{ "Pss:",		offsetof(stress_memfootprint_rollup_t, pss_kb) },
+		{ "Private_Clean:",	offsetof(stress_memfootprint_rollup_t, uss_kb) },
+		{ "Private_Dirty:",	offsetof(stress_memfootprint_rollup_t, uss_kb) },
+		{ "Anonymous:",		offsetof(stress_memfootprint_rollup_t, anon_kb) },
+		{ "AnonHugePages:",	offsetof(stress_memfootprint_rollup_t, anon_huge_kb) },
+	};
+	char path[64], buf[MEMFOOTPRINT_BUF_SIZE];
+	char *line, *next;
+
+	(void)snprintf(path, sizeof(path), "/proc/%" PRIdMAX "/smaps_rollup", (intmax_t)pid);
+	if (stress_system_read(path, buf, sizeof(buf)) <= 0)
+		return false;
+
+	for (line = buf; line && *line; line = next) {
+		size_t i;
+
+		next = strchr(line, '\n');
+		if (next)
+			*next++ = '\0';
+
+		for (i = 0; i < SIZEOF_ARRAY(fields); i++) {
+			const size_t len = strlen(fields[i].field);
+			uint64_t kb;
+
+			if (strncmp(line, fields[i].field, len))
+				continue;
+			if (sscanf(line + len, "%" SCNu64, &kb) == 1)
+				*(uint64_t *)((uintptr_t)rollup + fields[i].offset) += kb;
+			break;
+		}
+	}
+	return true;
+}
+
+/*
+ *  stress_memfootprint_faults()
+ *	read the minor and major page fault counts of pid
+ */
+static bool stress_memfootprint_faults(const pid_t pid, uint64_t *minflt, uint64_t *majflt)
+{
+	char path[64], buf[512];
+	const char *ptr;
+
+	(void)snprintf(path, sizeof(path), "/proc/%" PRIdMAX "/stat", (intmax_t)pid);
+	if (stress_system_read(path, buf, sizeof(buf)) <= 0)
+		return false;
+	/* process name may contain spaces, skip to the last ) */
+	ptr = strrchr(buf, ')');
+	if (!ptr)
+		return false;
+	return sscanf(ptr + 1, " %*c %*d %*d %*d %*d %*d %*u %" SCNu64 " %*u %" SCNu64,
+		minflt, majflt) == 2;
+}
+
+/*
+ *  stress_memfootprint_sample()
+ *	sample the memory footprint of a stressor instance, the
+ *	smaps_rollup usage of the instance and its oomable child
+ *	(if any) are summed and the values at peak PSS are kept.
+ *	Page faults are accumulated from the process doing the
+ *	work, the oomable child if there is one
+ */
+void stress_memfootprint_sample(
+	stress_memfootprint_t *memfootprint,
+	const pid_t pid,
+	const pid_t child,
+	const double now)
+{
+#if defined(__linux__)
+	stress_memfootprint_rollup_t rollup;
+	const pid_t worker = child ? child : pid;
+	uint64_t minflt, majflt;
+
+	(void)shim_memset(&rollup, 0, sizeof(rollup));
+	if (!stress_memfootprint_rollup(pid, &rollup))
+		return;
+	if (child)
+		(void)stress_memfootprint_rollup(child, &rollup);
+
+	memfootprint->samples++;
+	if (rollup.pss_kb > memfootprint->pss_kb) {
+		memfootprint->rss_kb = rollup.rss_kb;
+		memfootprint->pss_kb = rollup.pss_kb;
+		memfootprint->uss_kb = rollup.uss_kb;
+		memfootprint->anon_kb = rollup.anon_kb;
+		memfootprint->anon_huge_kb = rollup.anon_huge_kb;
+	}
+
+	if (!stress_memfootprint_faults(worker, &minflt, &majflt))
+		return;
+	if ((memfootprint->pid == worker) &&
+	    (minflt >= memfootprint->minflt_prev) &&
+	    (majflt >= memfootprint->majflt_prev) &&
+	    (now > memfootprint->time_prev)) {
+		memfootprint->minflt += minflt - memfootprint->minflt_prev;
+		memfootprint->majflt += majflt - memfootprint->majflt_prev;
+		memfootprint->wall += now - memfootprint->time_prev;
+	}
+	memfootprint->pid = worker;
+	memfootprint->minflt_prev = minflt;
+	memfootprint->majflt_prev = majflt;
+	memfootprint->time_prev = now;
+#else
+	(void)memfootprint;
+	(void)pid;
+	(void)child;
+	(void)now;
+#endif
+}
+
+/*
+ *  stress_memfootprint_dump()
+ *	report the per instance peak PSS, USS and RSS, the THP coverage
+ *	of anonymous memory and the page fault rates of each stressor
+ */
+void stress_memfootprint_dump(FILE *yaml, stress_stressor_t *stressors_list)
+{
+	stress_stressor_t *ss;
+	bool header = false;
+
+	pr_block_begin();
+	for (ss = stressors_list; ss; ss = ss->next) {
+		uint64_t rss_kb = 0, pss_kb = 0, uss_kb = 0, anon_kb = 0, anon_huge_kb = 0;
+		uint64_t minflt = 0, majflt = 0;
+		double wall = 0.0, thp_pc, minflt_rate, majflt_rate, n;
+		int32_t j, sampled = 0;
+
+		if (ss->ignore.run || ss->ignore.permute || !ss->stats)
+			continue;
+
+		for (j = 0; j < ss->instances; j++) {
+			const stress_memfootprint_t *memfootprint = &ss->stats[j]->memfootprint;
+
+			if (!memfootprint->samples)
+				continue;
+			sampled++;
+			rss_kb += memfootprint->rss_kb;
+			pss_kb += memfootprint->pss_kb;
+			uss_kb += memfootprint->uss_kb;
+			anon_kb += memfootprint->anon_kb;
+			anon_huge_kb += memfootprint->anon_huge_kb;
+			minflt += memfootprint->minflt;
+			majflt += memfootprint->majflt;
+			wall += memfootprint->wall;
+		}
+		if (!sampled)
+			continue;
+
+		n = (double)sampled;
+		thp_pc = anon_kb ? 100.0 * (double)anon_huge_kb / (double)anon_kb : 0.0;
+		/* per instance rates, faults over sampled time of all instances */
+		minflt_rate = (wall > 0.0) ? (double)minflt / wall : 0.0;
+		majflt_rate = (wall > 0.0) ? (double)majflt / wall : 0.0;
+
+		if (!header) {
+			pr_inf("memfootprint: %-13s %10s %10s %10s %10s %6s %12s %12s\n",
+				"stressor", "PSS MB", "PSS total", "USS MB", "RSS MB",
+				"THP %", "minflt/sec", "majflt/sec");
+			pr_yaml(yaml, "memfootprint:\n");
+			header = true;
+		}
+		pr_inf("memfootprint: %-13s %10.2f %10.2f %10.2f %10.2f %6.2f %12.2f %12.2f\n",
+			ss->stressor->name,
+			((double)pss_kb / n) / 1024.0, (double)pss_kb / 1024.0,
+			((double)uss_kb / n) / 1024.0, ((double)rss_kb / n) / 1024.0,
+			thp_pc, minflt_rate, majflt_rate);
+		pr_yaml(yaml, "    - stressor: %s\n", ss->stressor->name);
+		pr_yaml(yaml, "      instances-sampled: %" PRId32 "\n", sampled);
+		pr_yaml(yaml, "      pss-kb-per-instance: %.0f\n", (double)pss_kb / n);
+		pr_yaml(yaml, "      pss-kb-total: %" PRIu64 "\n", pss_kb);
+		pr_yaml(yaml, "      uss-kb-per-instance: %.0f\n", (double)uss_kb / n);
+		pr_yaml(yaml, "      rss-kb-per-instance: %.0f\n", (double)rss_kb / n);
+		pr_yaml(yaml, "      anon-huge-pages-percent: %.2f\n", thp_pc);
+		pr_yaml(yaml, "      minor-faults-per-sec: %.2f\n", minflt_rate);
+		pr_yaml(yaml, "      major-faults-per-sec: %.2f\n", majflt_rate);
+	}
+	if (header) {
+		pr_inf("memfootprint: PSS, USS and RSS are per instance at peak PSS, "
+			"fault rates are per instance\n");
+		pr_yaml(yaml, "\n");
+	}
+	pr_block_end();
+}
@@ -163,3 +163,43 @@ int stress_mincore_touch_pages_interruptible(void *buf, const size_t buf_len)
 {
 	return stress_mincore_touch_pages_generic(buf, buf_len, true);
 }
+
+/*
+ *  stress_mincore_resident()
+ *	count the pages in the page aligned range buf .. buf + buf_len
+ *	that are resident in memory, for file mappings this is the page
+ *	cache residency. Returns 0 on success, -1 if it cannot be determined
+ */
+int stress_mincore_resident(void *buf, const size_t buf_len, size_t *resident)
+{
+#if defined(HAVE_MINCORE)
+	const size_t page_size = stress_get_page_size();
+	const size_t n_pages = (buf_len + page_size - 1) / page_size;
+	unsigned char vec_small[64], *vec = vec_small;
+	size_t i, count = 0;
+
+	*resident = 0;
+	if (n_pages > sizeof(vec_small)) {
+		vec = (unsigned char *)calloc(n_pages, 1);
+		if (!vec)
+			return -1;
+	}
+	if (shim_mincore(buf, buf_len, vec) < 0) {
+		if (vec != vec_small)
+			free(vec);
+		return -1;
+	}
+	for (i = 0; i < n_pages; i++)
+		count += (vec[i] & 1);
+	if (vec != vec_small)
+		free(vec);
+	*resident = count;
+	return 0;
+#else
+	(void)buf;
+	(void)buf_len;
+
+	*resident = 0;
+	return -1;
+#endif
+}
@@ -21,5 +21,6 @@
 
 extern int stress_mincore_touch_pages(void *buf, const size_t buf_len);
 extern int stress_mincore_touch_pages_interruptible(void *buf, const size_t buf_len);
+extern int stress_mincore_resident(void *buf, const size_t buf_len, size_t *resident);
 
 #endif
@@ -22,11 +22,25 @@
 #include "core-cpu-cache.h"
 #include "core-mmap.h"
 
+#if defined(HAVE_SYS_PRCTL_H)
+#include <sys/prctl.h>
+#endif
+
 #if defined(HAVE_ASM_X86_REP_STOSQ) &&  \
     !defined(__ILP32__)
 #define USE_ASM_X86_REP_STOSQ
 #endif
 
+static const char * const stress_mmap_thp_names[] = {
+	"default",	/* STRESS_MMAP_THP_DEFAULT */
+	"always",	/* STRESS_MMAP_THP_ALWAYS */
+	"never",	/* STRESS_MMAP_THP_NEVER */
+};
+
+/* --thp and --hugetlb policy of this stressor process, see stress_mmap_policy_init() */
+static int32_t stress_mmap_thp = STRESS_MMAP_THP_DEFAULT;
+static size_t stress_mmap_hugetlb_sz = 0;
+
 /*
  *  stress_mmap_set()
  *	set mmap'd data, touching pages in
@@ -199,3 +213,252 @@ int OPTIMIZE3 stress_mmap_check_light(
 	return 0;
 }
 
+
+/*
+ *  stress_mmap_thp_parse()
+ *	parse a --thp policy name, exits on an invalid name
+ */
+int32_t stress_mmap_thp_parse(const char *arg)
+{
+	size_t i;
+
+	for (i = 0; i < SIZEOF_ARRAY(stress_mmap_thp_names); i++) {
+		if (!strcmp(arg, stress_mmap_thp_names[i]))
+			return (int32_t)i;
+	}
+	if (strcmp("which", arg))
+		(void)fprintf(stderr, "Invalid thp option: %s\n", arg);
+
+	(void)fprintf(stderr, "Available options are:");
+	for (i = 0; i < SIZEOF_ARRAY(stress_mmap_thp_names); i++)
+		(void)fprintf(stderr, " %s", stress_mmap_thp_names[i]);
+	(void)fprintf(stderr, "\n");
+	_exit(EXIT_FAILURE);
+}
+
+/*
+ *  stress_mmap_default_hugetlb_size()
+ *	get the default hugetlb page size from /proc/meminfo,
+ *	returns 0 if it is not known
+ */
+static size_t stress_mmap_default_hugetlb_size(void)
+{
+	size_t sz = 0;
+#if defined(__linux__)
+	FILE *fp;
+	char buf[128];
+
+	fp = fopen("/proc/meminfo", "r");
+	if (!fp)
+		return 0;
+	while (fgets(buf, sizeof(buf), fp)) {
+		uint64_t kb;
+
+		if (sscanf(buf, "Hugepagesize: %" SCNu64, &kb) == 1) {
+			sz = (size_t)(kb * KB);
+			break;
+		}
+	}
+	(void)fclose(fp);
+#endif
+	return sz;
+}
+
+/*
+ *  stress_mmap_policy_init()
+ *	set up the --thp and --hugetlb policy of the calling stressor
+ *	process. --thp never disables THP for the entire process so it
+ *	also covers buffers that stressors mmap directly, --thp always
+ *	and --hugetlb are applied to the anonymous buffers allocated with
+ *	stress_mmap_populate() and stress_mmap_hugetlb()
+ */
+void stress_mmap_policy_init(void)
+{
+	bool hugetlb = false;
+
+	(void)stress_get_setting("thp", &stress_mmap_thp);
+#if defined(HAVE_SYS_PRCTL_H) &&	\
+    defined(PR_SET_THP_DISABLE)
+	if (stress_mmap_thp == STRESS_MMAP_THP_NEVER)
+		VOID_RET(int, prctl(PR_SET_THP_DISABLE, 1, 0, 0, 0));
+#endif
+	(void)stress_get_setting("hugetlb", &hugetlb);
+	if (hugetlb) {
+		uint64_t hugetlb_size = 0;
+
+		(void)stress_get_setting("hugetlb-size", &hugetlb_size);
+		stress_mmap_hugetlb_sz = hugetlb_size ?
+			(size_t)hugetlb_size : stress_mmap_default_hugetlb_size();
+	}
+}
+
+/*
+ *  stress_mmap_populate_range()
+ *	populate an unpopulated anonymous mapping, this is used
+ *	after madvise'ing the mapping so that the pages are faulted
+ *	in according to the advice. Writable mappings are touched a
+ *	page at a time if MADV_POPULATE_WRITE is not available
+ */
+void stress_mmap_populate_range(void *ptr, const size_t length, const int prot)
+{
+	if (prot & PROT_WRITE) {
+		const size_t page_size = stress_get_page_size();
+		volatile uint8_t *vptr = (volatile uint8_t *)ptr;
+		size_t i;
+
+#if defined(HAVE_MADVISE) &&	\
+    defined(MADV_POPULATE_WRITE)
+		if (madvise(ptr, length, MADV_POPULATE_WRITE) == 0)
+			return;
+#endif
+		for (i = 0; i < length; i += page_size)
+			vptr[i] = vptr[i];
+		return;
+	}
+#if defined(HAVE_MADVISE) &&	\
+    defined(MADV_POPULATE_READ)
+	if (prot & PROT_READ)
+		(void)madvise(ptr, length, MADV_POPULATE_READ);
+#endif
+}
+
+/*
+ *  stress_mmap_policy()
+ *	mmap an anonymous buffer using the --hugetlb or --thp always
+ *	policy. Returns MAP_FAILED if no policy applies or the mapping
+ *	failed, the caller then falls back to a normal mmap. Hugetlb
+ *	pages are only used if length is a multiple of the hugetlb page
+ *	size as hugetlb mappings can only be munmap'd in whole pages.
+ */
+void *stress_mmap_policy(
+	void *addr,
+	const size_t length,
+	const int prot,
+	const int flags,
+	const int fd,
+	const off_t offset,
+	const bool populate)
+{
+	void *ptr;
+
+	if ((stress_mmap_thp != STRESS_MMAP_THP_ALWAYS) && (stress_mmap_hugetlb_sz == 0))
+		return MAP_FAILED;
+#if defined(MAP_ANONYMOUS)
+	if ((fd != -1) || !(flags & MAP_ANONYMOUS))
+		return MAP_FAILED;
+#else
+	return MAP_FAILED;
+#endif
+#if defined(MAP_FIXED)
+	if (flags & MAP_FIXED)
+		return MAP_FAILED;
+#endif
+#if defined(MAP_HUGETLB)
+	if (flags & MAP_HUGETLB)
+		return MAP_FAILED;
+	if ((stress_mmap_hugetlb_sz > 0) && ((length & (stress_mmap_hugetlb_sz - 1)) == 0)) {
+		int huge_flags = flags | MAP_HUGETLB;
+#if defined(MAP_HUGE_SHIFT)
+		int shift;
+
+		for (shift = 0; ((size_t)1 << shift) < stress_mmap_hugetlb_sz; shift++)
+			;
+		huge_flags |= shift << MAP_HUGE_SHIFT;
+#endif
+#if defined(MAP_POPULATE)
+		if (populate)
+			huge_flags |= MAP_POPULATE;
+#endif
+		ptr = mmap(addr, length, prot, huge_flags, fd, offset);
+		if (ptr != MAP_FAILED)
+			return ptr;
+	}
+#endif
+#if defined(HAVE_MADVISE) &&	\
+    defined(MADV_HUGEPAGE)
+	if (stress_mmap_thp == STRESS_MMAP_THP_ALWAYS) {
+		/* advise before populating so the pages are faulted in as THPs */
+		ptr = mmap(addr, length, prot, flags, fd, offset);
+		if (ptr == MAP_FAILED)
+			return MAP_FAILED;
+		(void)madvise(ptr, length, MADV_HUGEPAGE);
+		if (populate)
+			stress_mmap_populate_range(ptr, length, prot);
+		return ptr;
+	}
+#endif
+	(void)addr;
+	(void)length;
+	(void)prot;
+	(void)offset;
+	(void)populate;
+	return MAP_FAILED;
+}
+
+/*
+ *  stress_mmap_hugetlb()
+ *	mmap an anonymous sz byte buffer backed by explicit --hugetlb-size
+ *	hugetlbfs pages, falling back to normal pages if --hugetlb-size is
+ *	not set or the hugetlb pages cannot be allocated. If populate is
+ *	true the pages are prefaulted. The size of the mapping (sz rounded
+ *	up to the page size used) is returned in mapped_sz and must be
+ *	used to munmap the buffer.
+ */
+void *stress_mmap_hugetlb(
+	stress_args_t *args,
+	const size_t sz,
+	const int prot,
+	const int flags,
+	const bool populate,
+	size_t *mapped_sz)
+{
+#if defined(MAP_HUGETLB)
+	uint64_t hugetlb_size = 0;
+
+	(void)stress_get_setting("hugetlb-size", &hugetlb_size);
+	if (hugetlb_size == 0)
+		hugetlb_size = (uint64_t)stress_mmap_hugetlb_sz;
+	if (hugetlb_size > (uint64_t)args->page_size) {
+		static bool warned = false;
+		const size_t huge_sz = (size_t)((sz + hugetlb_size - 1) & ~(hugetlb_size - 1));
+		int huge_flags = flags | MAP_HUGETLB;
+		void *ptr;
+#if defined(MAP_HUGE_SHIFT)
+		int shift;
+
+		for (shift = 0; (1ULL << shift) < hugetlb_size; shift++)
+			;
+		huge_flags |= shift << MAP_HUGE_SHIFT;
+#endif
+		ptr = populate ?
+			stress_mmap_populate(NULL, huge_sz, prot, huge_flags, -1, 0) :
+			mmap(NULL, huge_sz, prot, huge_flags, -1, 0);
+		if (ptr != MAP_FAILED) {
+			*mapped_sz = huge_sz;
+			return ptr;
+		}
+		if (!warned && (args->instance == 0)) {
+			char str[32];
+
+			(void)stress_uint64_to_str(str, sizeof(str), hugetlb_size);
+			pr_inf("%s: cannot mmap %zu bytes using %s hugetlb pages, "
+				"errno=%d (%s), using normal pages instead\n",
+				args->name, huge_sz, str, errno, strerror(errno));
+		}
+		warned = true;
+	}
+#else
+	(void)args;
+#endif
+	*mapped_sz = sz;
+	if (stress_mmap_thp == STRESS_MMAP_THP_ALWAYS) {
+		void *ptr;
+
+		ptr = stress_mmap_policy(NULL, sz, prot, flags, -1, 0, populate);
+		if (ptr != MAP_FAILED)
+			return ptr;
+	}
+	return populate ?
+		stress_mmap_populate(NULL, sz, prot, flags, -1, 0) :
+		mmap(NULL, sz, prot, flags, -1, 0);
+}
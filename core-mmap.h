@@ -21,9 +21,21 @@
 
 #include "core-attribute.h"
 
+/* --thp transparent huge page policy */
+#define STRESS_MMAP_THP_DEFAULT		(0)	/* leave kernel THP setting */
+#define STRESS_MMAP_THP_ALWAYS		(1)	/* madvise MADV_HUGEPAGE */
+#define STRESS_MMAP_THP_NEVER		(2)	/* prctl PR_SET_THP_DISABLE */
+
 extern void stress_mmap_set(uint8_t *buf, const size_t sz, const size_t page_size);
 extern int stress_mmap_check(uint8_t *buf, const size_t sz, const size_t page_size);
 extern void stress_mmap_set_light(uint8_t *buf, const size_t sz, const size_t page_size);
 extern int stress_mmap_check_light(uint8_t *buf, const size_t sz, const size_t page_size);
+extern void *stress_mmap_hugetlb(stress_args_t *args, const size_t sz, const int prot,
+	const int flags, const bool populate, size_t *mapped_sz);
+extern int32_t stress_mmap_thp_parse(const char *arg);
+extern void stress_mmap_policy_init(void);
+extern void *stress_mmap_policy(void *addr, const size_t length, const int prot,
+	const int flags, const int fd, const off_t offset, const bool populate);
+extern void stress_mmap_populate_range(void *ptr, const size_t length, const int prot);
 
 #endif
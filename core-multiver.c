@@ -0,0 +1,146 @@
+/*
+ * Copyright (C) 2025      Colin Ian King.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+#include "stress-ng.h"
+#include "core-cpu.h"
+#include "core-multiver.h"
+
+/*
+ *  A MULTIVER=1 build compiles the compute and memory stressors listed
+ *  in MULTIVER_SRC in the Makefile once per target micro-architecture,
+ *  renaming each stress_*_info to stress_*_info_<tag>. The Makefile
+ *  generates multiver.h with a MULTIVER(name, tag, target) line for each
+ *  variant, in ascending order of capability, and at start up the
+ *  stressor table is pointed at the most capable variant the cpu
+ *  supports. Normal builds generate an empty multiver.h.
+ */
+typedef struct {
+	const stressor_info_t *base;	/* baseline ISA stressor info */
+	const stressor_info_t *variant;	/* multi-versioned stressor info */
+	const char *target;		/* -march target of variant */
+} stress_multiver_t;
+
+typedef struct {
+	const char *target;		/* -march target */
+	bool (*supported)(void);	/* can cpu run the target? */
+} stress_multiver_target_t;
+
+static bool stress_multiver_x86_64_v2(void)
+{
+	return stress_cpu_x86_isa_level() >= 2;
+}
+
+static bool stress_multiver_x86_64_v3(void)
+{
+	return stress_cpu_x86_isa_level() >= 3;
+}
+
+static bool stress_multiver_x86_64_v4(void)
+{
+	return stress_cpu_x86_isa_level() >= 4;
+}
+
+static bool stress_multiver_armv8_2_a(void)
+{
+	return stress_cpu_arm_has_armv8_2();
+}
+
+static bool stress_multiver_armv8_2_a_sve(void)
+{
+	return stress_cpu_arm_has_armv8_2() && stress_cpu_arm_has_sve();
+}
+
+static const stress_multiver_target_t stress_multiver_targets[] = {
+	{ "x86-64-v2",		stress_multiver_x86_64_v2 },
+	{ "x86-64-v3",		stress_multiver_x86_64_v3 },
+	{ "x86-64-v4",		stress_multiver_x86_64_v4 },
+	{ "armv8.2-a",		stress_multiver_armv8_2_a },
+	{ "armv8.2-a+sve",	stress_multiver_armv8_2_a_sve },
+};
+
+#define MULTIVER(name, tag, target)	\
+	extern stressor_info_t stress_ ## name ## _info;	\
+	extern stressor_info_t stress_ ## name ## _info_ ## tag;
+#include "multiver.h"
+#undef MULTIVER
+
+#define MULTIVER(name, tag, target)	\
+	{ &stress_ ## name ## _info, &stress_ ## name ## _info_ ## tag, target },
+
+static const stress_multiver_t stress_multiver[] = {
+#include "multiver.h"
+	{ NULL, NULL, NULL },
+};
+#undef MULTIVER
+
+static size_t stress_multiver_selected;		/* number of variants selected */
+static const char *stress_multiver_target;	/* most capable target selected */
+
+/*
+ *  stress_multiver_supported()
+ *	can the cpu run code built for the given -march target?
+ */
+static bool stress_multiver_supported(const char *target)
+{
+	size_t i;
+
+	for (i = 0; i < SIZEOF_ARRAY(stress_multiver_targets); i++) {
+		if (!strcmp(stress_multiver_targets[i].target, target))
+			return stress_multiver_targets[i].supported();
+	}
+	return false;
+}
+
+/*
+ *  stress_multiver_select()
+ *	point the stressor table at the most capable multi-versioned
+ *	variant of each stressor that this cpu supports
+ */
+void stress_multiver_select(stress_t *stressors, const size_t n)
+{
+	size_t i, j;
+
+	for (i = 0; i < n; i++) {
+		const stressor_info_t *base = stressors[i].info;
+		const stress_multiver_t *best = NULL;
+
+		for (j = 0; stress_multiver[j].base; j++) {
+			if ((stress_multiver[j].base == base) &&
+			    stress_multiver_supported(stress_multiver[j].target))
+				best = &stress_multiver[j];
+		}
+		if (best) {
+			stressors[i].info = best->variant;
+			stress_multiver_selected++;
+			stress_multiver_target = best->target;
+		}
+	}
+}
+
+/*
+ *  stress_multiver_log_info()
+ *	report the multi-versioned stressors in use
+ */
+void stress_multiver_log_info(void)
+{
+	if (stress_multiver_selected)
+		pr_dbg("multi-versioned build, %zu stressor%s using %s variants\n",
+			stress_multiver_selected,
+			stress_multiver_selected == 1 ? "" : "s",
+			stress_multiver_target);
+}
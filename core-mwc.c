@@ -19,6 +19,7 @@
  */
 #include "stress-ng.h"
 #include "core-attribute.h"
+#include "core-builtin.h"
 #include "core-cpu-cache.h"
 #include "core-helper.h"
 #include "core-mwc.h"
@@ -47,7 +48,7 @@ typedef struct {
 	uint32_t saved1;
 } stress_mwc_t;
 
-static stress_mwc_t mwc = {
+static STRESS_THREAD_LOCAL stress_mwc_t mwc = {
 	STRESS_MWC_SEED_W,
 	STRESS_MWC_SEED_Z,
 	0,
@@ -418,11 +419,53 @@ uint64_t OPTIMIZE3 stress_mwc64modn(const uint64_t max)
  */
 OPTIMIZE3 void stress_rndbuf(void *buf, const size_t len)
 {
-	register char *ptr = (char *)buf;
-	register const char *end = ptr + len;
+	stress_mwc_fill(buf, len);
+}
+
+/*
+ *  stress_mwc_fill()
+ *	fill buffer with pseudorandom data using STRESS_MWC_FILL_LANES
+ *	independent interleaved MWC generators. Each lane is the same
+ *	MWC generator as stress_mwc32() seeded from the thread's main
+ *	generator, the lanes have no dependency on each other so the
+ *	compiler can vectorize the lane loop with SIMD instructions
+ */
+OPTIMIZE3 void stress_mwc_fill(void *buf, const size_t len)
+{
+	uint32_t w[STRESS_MWC_FILL_LANES], z[STRESS_MWC_FILL_LANES];
+	uint32_t r[STRESS_MWC_FILL_LANES];
+	register uint8_t *ptr = (uint8_t *)buf;
+	register size_t n = len;
+	size_t i;
+
+	if (UNLIKELY(!buf || !len))
+		return;
 
-	while (ptr < end)
-		*ptr++ = stress_mwc8();
+	for (i = 0; i < STRESS_MWC_FILL_LANES; i++) {
+		/* avoid the degenerate all zero 16 bit MWC states */
+		do {
+			w[i] = stress_mwc32();
+		} while (UNLIKELY((w[i] & 0xffff) == 0));
+		do {
+			z[i] = stress_mwc32();
+		} while (UNLIKELY((z[i] & 0xffff) == 0));
+	}
+
+	while (n > 0) {
+		for (i = 0; i < STRESS_MWC_FILL_LANES; i++) {
+			z[i] = 36969 * (z[i] & 65535) + (z[i] >> 16);
+			w[i] = 18000 * (w[i] & 65535) + (w[i] >> 16);
+			r[i] = (z[i] << 16) + w[i];
+		}
+		if (LIKELY(n >= sizeof(r))) {
+			(void)shim_memcpy(ptr, r, sizeof(r));
+			ptr += sizeof(r);
+			n -= sizeof(r);
+		} else {
+			(void)shim_memcpy(ptr, r, n);
+			break;
+		}
+	}
 }
 
 /*
@@ -32,6 +32,9 @@
  */
 #define HAVE_FAST_MODULO_REDUCTION
 
+/* number of interleaved MWC generators used by stress_mwc_fill() */
+#define STRESS_MWC_FILL_LANES	(8)
+
 extern void stress_mwc_reseed(void);
 extern void stress_mwc_set_seed(const uint32_t w, const uint32_t z);
 extern void stress_mwc_get_seed(uint32_t *w, uint32_t *z);
@@ -42,7 +45,7 @@ extern uint8_t stress_mwc8(void);
 extern uint16_t stress_mwc16(void);
 extern uint32_t stress_mwc32(void);
 extern uint64_t stress_mwc64(void);
-
+extern void stress_mwc_fill(void *buf, const size_t len);
 
 extern void stress_rndbuf(void *buf, const size_t len);
 extern void stress_rndstr(char *str, const size_t len);
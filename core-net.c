@@ -321,6 +321,149 @@ static bool PURE stress_net_port_range_ok(const int start_port, const int end_po
 	return true;
 }
 
+/*
+ *  Ports can be reserved without the allocator lock if atomic
+ *  load, fetch-and and compare-exchange are available
+ */
+#if defined(HAVE_ATOMIC_COMPARE_EXCHANGE) &&	\
+    defined(HAVE_ATOMIC_FETCH_AND) &&		\
+    defined(HAVE_ATOMIC_LOAD)
+#define STRESS_NET_PORT_LOCK_FREE
+
+/*
+ *  stress_net_port_mask()
+ *	bits of port bitmap word w that cover ports start_port..end_port
+ */
+static inline uint64_t stress_net_port_mask(
+	const int w,
+	const int start_port,
+	const int end_port)
+{
+	const int lo = STRESS_MAXIMUM(start_port, w * 64) - (w * 64);
+	const int hi = STRESS_MINIMUM(end_port, (w * 64) + 63) - (w * 64);
+	const int n = hi - lo + 1;
+
+	return ((n == 64) ? ~0ULL : ((1ULL << n) - 1)) << lo;
+}
+
+/*
+ *  stress_net_port_unclaim()
+ *	atomically clear the bits for ports start_port..end_port
+ */
+static void stress_net_port_unclaim(const int start_port, const int end_port)
+{
+	uint64_t *map = g_shared->net_port_map.allocated;
+	int w;
+
+	for (w = start_port / 64; w <= end_port / 64; w++) {
+		const uint64_t mask = stress_net_port_mask(w, start_port, end_port);
+
+		(void)__atomic_fetch_and(&map[w], ~mask, __ATOMIC_RELEASE);
+	}
+}
+
+/*
+ *  stress_net_port_claim()
+ *	atomically set the bits for ports start_port..end_port a word
+ *	at a time, if any port is already taken then the words claimed
+ *	so far are released and false is returned
+ */
+static bool stress_net_port_claim(const int start_port, const int end_port)
+{
+	uint64_t *map = g_shared->net_port_map.allocated;
+	int w;
+
+	for (w = start_port / 64; w <= end_port / 64; w++) {
+		const uint64_t mask = stress_net_port_mask(w, start_port, end_port);
+		uint64_t old = __atomic_load_n(&map[w], __ATOMIC_RELAXED);
+
+		do {
+			if (old & mask) {
+				if (w > start_port / 64)
+					stress_net_port_unclaim(start_port, (w * 64) - 1);
+				return false;
+			}
+		} while (!__atomic_compare_exchange_n(&map[w], &old, old | mask,
+				false, __ATOMIC_ACQ_REL, __ATOMIC_RELAXED));
+	}
+	return true;
+}
+
+/*
+ *  stress_net_port_free()
+ *	return first free port at or after port, or -1 if none
+ */
+static int stress_net_port_free(int port)
+{
+	const uint64_t *map = g_shared->net_port_map.allocated;
+
+	while (port < 65536) {
+		const int w = port / 64;
+		const uint64_t avail = ~__atomic_load_n(&map[w], __ATOMIC_RELAXED) &
+				       (~0ULL << (port & 63));
+
+		if (avail) {
+#if defined(HAVE_BUILTIN_CTZ)
+			return (w * 64) + __builtin_ctzll(avail);
+#else
+			int bit;
+
+			for (bit = port & 63; !(avail & (1ULL << bit)); bit++)
+				;
+			return (w * 64) + bit;
+#endif
+		}
+		port = (w + 1) * 64;
+	}
+	return -1;
+}
+
+/*
+ *   stress_net_reserve_ports()
+ *	attempt to reserve ports, returns nearest available contiguous
+ *	ports that are available or -1 if none could be found. Ports
+ *	are claimed with compare-exchange on the 64 bit bitmap words so
+ *	instances starting together do not serialize on a lock
+ */
+int stress_net_reserve_ports(const int start_port, const int end_port)
+{
+	const int quantity = (end_port - start_port) + 1;
+	int port = start_port;
+
+	if (UNLIKELY(!stress_net_port_range_ok(start_port, end_port)))
+		return -1;
+
+	for (;;) {
+		int i;
+
+		port = stress_net_port_free(port);
+		if (UNLIKELY((port < 0) || (port + quantity > 65536)))
+			return -1;
+		/* check the rest of the range is free before trying to claim it */
+		for (i = port + 1; i < port + quantity; i++) {
+			if (stress_net_port_free(i) != i)
+				break;
+		}
+		if (i < port + quantity) {
+			port = i + 1;
+			continue;
+		}
+		if (LIKELY(stress_net_port_claim(port, port + quantity - 1)))
+			return port;
+		/* lost a race with another instance, rescan from the same port */
+	}
+}
+
+/*
+ *   stress_net_release_ports()
+ *	release allocated ports
+ */
+void stress_net_release_ports(const int start_port, const int end_port)
+{
+	if (LIKELY(stress_net_port_range_ok(start_port, end_port)))
+		stress_net_port_unclaim(start_port, end_port);
+}
+#else
 /*
  *   stress_net_reserve_ports()
  *	attempt to reserve ports, returns nearest available contiguous
@@ -373,7 +516,7 @@ int stress_net_reserve_ports(const int start_port, const int end_port)
 }
 
 /*
- *   stress_net_reserve_ports()
+ *   stress_net_release_ports()
  *	release allocated ports
  */
 void stress_net_release_ports(const int start_port, const int end_port)
@@ -381,7 +524,11 @@ void stress_net_release_ports(const int start_port, const int end_port)
 	if (LIKELY(stress_net_port_range_ok(start_port, end_port))) {
 		int i;
 
+		if (UNLIKELY(stress_lock_acquire(g_shared->net_port_map.lock) < 0))
+			return;
 		for (i = start_port; i <= end_port; i++)
 			STRESS_CLRBIT(g_shared->net_port_map.allocated, i);
+		(void)stress_lock_release(g_shared->net_port_map.lock);
 	}
 }
+#endif
@@ -220,6 +220,72 @@ void stress_numa_randomize_pages(
 	errno = 0;
 }
 
+/*
+ *  stress_numa_bind_local()
+ *	set preferred NUMA node of the unpopulated pages in buffer
+ *	to the node the caller is currently running on so that first
+ *	touch places the pages locally, returns the node or -1 on
+ *	failure
+ */
+long int stress_numa_bind_local(
+	stress_numa_mask_t *numa_mask,
+	void *buffer,
+	const size_t buffer_size)
+{
+	unsigned int cpu, node;
+
+	if (UNLIKELY(!numa_mask))
+		return -1;
+	if (UNLIKELY(!buffer))
+		return -1;
+	if (shim_getcpu(&cpu, &node, NULL) < 0)
+		return -1;
+	if ((unsigned long int)node >= numa_mask->max_nodes)
+		return -1;
+
+	(void)shim_memset(numa_mask->mask, 0, numa_mask->mask_size);
+	STRESS_SETBIT(numa_mask->mask, (unsigned long int)node);
+	if (shim_mbind(buffer, buffer_size, MPOL_PREFERRED, numa_mask->mask,
+			numa_mask->max_nodes, MPOL_MF_MOVE) < 0) {
+		STRESS_CLRBIT(numa_mask->mask, (unsigned long int)node);
+		return -1;
+	}
+	STRESS_CLRBIT(numa_mask->mask, (unsigned long int)node);
+	return (long int)node;
+}
+
+/*
+ *  stress_numa_bind_node()
+ *	bind the pages in buffer to NUMA node node modulo the number
+ *	of NUMA nodes, returns the node or -1 on failure
+ */
+long int stress_numa_bind_node(
+	stress_numa_mask_t *numa_mask,
+	void *buffer,
+	const size_t buffer_size,
+	const unsigned long int node)
+{
+	unsigned long int bind_node;
+
+	if (UNLIKELY(!numa_mask))
+		return -1;
+	if (UNLIKELY(!buffer))
+		return -1;
+	if (UNLIKELY(numa_mask->nodes < 1))
+		return -1;
+
+	bind_node = node % numa_mask->nodes;
+	(void)shim_memset(numa_mask->mask, 0, numa_mask->mask_size);
+	STRESS_SETBIT(numa_mask->mask, bind_node);
+	if (shim_mbind(buffer, buffer_size, MPOL_BIND, numa_mask->mask,
+			numa_mask->max_nodes, MPOL_MF_MOVE) < 0) {
+		STRESS_CLRBIT(numa_mask->mask, bind_node);
+		return -1;
+	}
+	STRESS_CLRBIT(numa_mask->mask, bind_node);
+	return (long int)bind_node;
+}
+
 /*
  *  stress_numa_nodes()
  *	determine the number of NUMA memory nodes,
@@ -345,6 +411,32 @@ void stress_numa_randomize_pages(
 	(void)shim_memset(numa_mask->mask, 0, numa_mask->mask_size);
 }
 
+long int stress_numa_bind_local(
+	stress_numa_mask_t *numa_mask,
+	void *buffer,
+	const size_t buffer_size)
+{
+	(void)numa_mask;
+	(void)buffer;
+	(void)buffer_size;
+
+	return -1;
+}
+
+long int stress_numa_bind_node(
+	stress_numa_mask_t *numa_mask,
+	void *buffer,
+	const size_t buffer_size,
+	const unsigned long int node)
+{
+	(void)numa_mask;
+	(void)buffer;
+	(void)buffer_size;
+	(void)node;
+
+	return -1;
+}
+
 unsigned long int PURE stress_numa_nodes(void)
 {
 	return 1;
@@ -96,5 +96,9 @@ extern stress_numa_mask_t *stress_numa_mask_alloc(void);
 extern void stress_numa_mask_free(stress_numa_mask_t *mask);
 extern void stress_numa_randomize_pages(stress_numa_mask_t *numa_mask, void *buffer,
         const size_t page_size, const size_t buffer_size);
+extern long int stress_numa_bind_local(stress_numa_mask_t *numa_mask, void *buffer,
+        const size_t buffer_size);
+extern long int stress_numa_bind_node(stress_numa_mask_t *numa_mask, void *buffer,
+        const size_t buffer_size, const unsigned long int node);
 
 #endif
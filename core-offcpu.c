@@ -0,0 +1,200 @@
+/*
+ * Copyright (C) 2025      Colin Ian King.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+#include "stress-ng.h"
+#include "core-builtin.h"
+#include "core-offcpu.h"
+
+#define OFFCPU_TOP_MAX		(5)	/* top blocking functions reported */
+#define OFFCPU_MERGE_MAX	(32)	/* blocking functions merged per stressor */
+
+/*
+ *  stress_offcpu_wchan_add()
+ *	account a blocked sample to a kernel wait function
+ */
+static void stress_offcpu_wchan_add(stress_offcpu_t *offcpu, const char *name)
+{
+	size_t i;
+
+	for (i = 0; i < SIZEOF_ARRAY(offcpu->wchan); i++) {
+		stress_offcpu_wchan_t *wchan = &offcpu->wchan[i];
+
+		if (!*wchan->name) {
+			(void)shim_strscpy(wchan->name, name, sizeof(wchan->name));
+			wchan->count = 1;
+			return;
+		}
+		if (!strcmp(wchan->name, name)) {
+			wchan->count++;
+			return;
+		}
+	}
+	offcpu->wchan_other++;
+}
+
+/*
+ *  stress_offcpu_sample()
+ *	sample the scheduler statistics of a stressor task, the on-CPU
+ *	and runqueue wait time come from /proc/pid/schedstat, the rest
+ *	of the sampled wall clock time the task was blocked. The kernel
+ *	function a blocked task is waiting in is sampled from
+ *	/proc/pid/wchan to summarise where the task blocks
+ */
+void stress_offcpu_sample(stress_offcpu_t *offcpu, const pid_t pid, const double now)
+{
+#if defined(__linux__)
+	char path[64], buf[128];
+	uint64_t oncpu_ns, runq_ns;
+
+	(void)snprintf(path, sizeof(path), "/proc/%" PRIdMAX "/schedstat", (intmax_t)pid);
+	if (stress_system_read(path, buf, sizeof(buf)) <= 0)
+		return;
+	if (sscanf(buf, "%" SCNu64 " %" SCNu64, &oncpu_ns, &runq_ns) != 2)
+		return;
+
+	if ((offcpu->pid == pid) &&
+	    (oncpu_ns >= offcpu->oncpu_ns_prev) &&
+	    (runq_ns >= offcpu->runq_ns_prev) &&
+	    (now > offcpu->time_prev)) {
+		offcpu->oncpu_ns += oncpu_ns - offcpu->oncpu_ns_prev;
+		offcpu->runq_ns += runq_ns - offcpu->runq_ns_prev;
+		offcpu->wall += now - offcpu->time_prev;
+		offcpu->samples++;
+
+		/* wchan is 0 whilst the task is running or runnable */
+		(void)snprintf(path, sizeof(path), "/proc/%" PRIdMAX "/wchan", (intmax_t)pid);
+		if (stress_system_read(path, buf, sizeof(buf)) > 0) {
+			buf[strcspn(buf, "\n")] = '\0';
+			if (*buf && strcmp(buf, "0")) {
+				offcpu->blocked_samples++;
+				stress_offcpu_wchan_add(offcpu, buf);
+			}
+		}
+	}
+	offcpu->pid = pid;
+	offcpu->oncpu_ns_prev = oncpu_ns;
+	offcpu->runq_ns_prev = runq_ns;
+	offcpu->time_prev = now;
+#else
+	(void)offcpu;
+	(void)pid;
+	(void)now;
+#endif
+}
+
+/*
+ *  stress_offcpu_wchan_cmp()
+ *	sort blocking functions by descending sample count
+ */
+static int stress_offcpu_wchan_cmp(const void *p1, const void *p2)
+{
+	const stress_offcpu_wchan_t *w1 = (const stress_offcpu_wchan_t *)p1;
+	const stress_offcpu_wchan_t *w2 = (const stress_offcpu_wchan_t *)p2;
+
+	if (w1->count < w2->count)
+		return 1;
+	if (w1->count > w2->count)
+		return -1;
+	return strcmp(w1->name, w2->name);
+}
+
+/*
+ *  stress_offcpu_dump()
+ *	report the per stressor on-CPU, runqueue wait and blocked time
+ *	breakdown and the kernel functions the stressors block in most
+ */
+void stress_offcpu_dump(FILE *yaml, stress_stressor_t *stressors_list)
+{
+	stress_stressor_t *ss;
+	bool header = false;
+
+	pr_block_begin();
+	for (ss = stressors_list; ss; ss = ss->next) {
+		stress_offcpu_wchan_t merged[OFFCPU_MERGE_MAX];
+		size_t i, n = 0;
+		uint64_t oncpu_ns = 0, runq_ns = 0;
+		uint32_t blocked_samples = 0;
+		double wall = 0.0, on_pc, runq_pc, blocked_pc;
+		int32_t j;
+
+		if (ss->ignore.run || ss->ignore.permute || !ss->stats)
+			continue;
+
+		(void)shim_memset(merged, 0, sizeof(merged));
+		for (j = 0; j < ss->instances; j++) {
+			const stress_offcpu_t *offcpu = &ss->stats[j]->offcpu;
+
+			oncpu_ns += offcpu->oncpu_ns;
+			runq_ns += offcpu->runq_ns;
+			wall += offcpu->wall;
+			blocked_samples += offcpu->blocked_samples;
+
+			for (i = 0; i < SIZEOF_ARRAY(offcpu->wchan) && *offcpu->wchan[i].name; i++) {
+				size_t k;
+
+				for (k = 0; k < n; k++) {
+					if (!strcmp(merged[k].name, offcpu->wchan[i].name))
+						break;
+				}
+				if (k == n) {
+					if (n >= SIZEOF_ARRAY(merged))
+						continue;
+					(void)shim_strscpy(merged[n].name, offcpu->wchan[i].name, sizeof(merged[n].name));
+					n++;
+				}
+				merged[k].count += offcpu->wchan[i].count;
+			}
+		}
+		if (wall <= 0.0)
+			continue;
+
+		on_pc = 100.0 * ((double)oncpu_ns / STRESS_DBL_NANOSECOND) / wall;
+		runq_pc = 100.0 * ((double)runq_ns / STRESS_DBL_NANOSECOND) / wall;
+		blocked_pc = 100.0 - on_pc - runq_pc;
+		if (blocked_pc < 0.0)
+			blocked_pc = 0.0;
+		qsort(merged, n, sizeof(*merged), stress_offcpu_wchan_cmp);
+
+		if (!header) {
+			pr_inf("offcpu: %-13s %8s %10s %8s  top blocking kernel functions\n",
+				"stressor", "on-CPU %", "runq-wait %", "blocked %");
+			pr_yaml(yaml, "offcpu:\n");
+			header = true;
+		}
+		pr_inf("offcpu: %-13s %8.2f %10.2f %8.2f\n",
+			ss->stressor->name, on_pc, runq_pc, blocked_pc);
+		pr_yaml(yaml, "    - stressor: %s\n", ss->stressor->name);
+		pr_yaml(yaml, "      on-cpu-percent: %.2f\n", on_pc);
+		pr_yaml(yaml, "      runqueue-wait-percent: %.2f\n", runq_pc);
+		pr_yaml(yaml, "      blocked-percent: %.2f\n", blocked_pc);
+		pr_yaml(yaml, "      blocked-samples: %" PRIu32 "\n", blocked_samples);
+		if (n > 0)
+			pr_yaml(yaml, "      top-blocking:\n");
+		for (i = 0; (i < n) && (i < OFFCPU_TOP_MAX); i++) {
+			const double pc = blocked_samples ?
+				100.0 * (double)merged[i].count / (double)blocked_samples : 0.0;
+
+			pr_inf("offcpu: %-13s %30s %6.2f%% %s\n", "", "", pc, merged[i].name);
+			pr_yaml(yaml, "        - function: %s\n", merged[i].name);
+			pr_yaml(yaml, "          percent: %.2f\n", pc);
+		}
+	}
+	if (header)
+		pr_yaml(yaml, "\n");
+	pr_block_end();
+}
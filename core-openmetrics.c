@@ -0,0 +1,354 @@
+/*
+ * Copyright (C) 2025      Colin Ian King.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+#include "stress-ng.h"
+#include "core-builtin.h"
+#include "core-killpid.h"
+#include "core-net.h"
+#include "core-openmetrics.h"
+#include "core-rapl.h"
+#include "core-thermal-zone.h"
+#include "core-vmstat.h"
+
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#if defined(HAVE_POLL_H)
+#include <poll.h>
+#endif
+
+#define OPENMETRICS_REQUEST_MAX		(4096)
+#define OPENMETRICS_POLL_MS		(500)
+#define OPENMETRICS_CONTENT_TYPE	"application/openmetrics-text; version=1.0.0; charset=utf-8"
+
+#if defined(HAVE_POLL_H) &&	\
+    defined(AF_INET) &&		\
+    defined(AF_INET6)
+static pid_t openmetrics_pid = -1;
+#endif
+
+/*
+ *  stress_openmetrics_addr()
+ *	parse ADDR:PORT, [IPV6ADDR]:PORT or PORT into a socket
+ *	address, an empty or * address listens on all interfaces
+ */
+static int stress_openmetrics_addr(
+	const char *opt,
+	struct sockaddr_storage *addr,
+	socklen_t *addr_len)
+{
+	char host[128];
+	const char *port_str;
+	const bool ipv6 = (*opt == '[');
+	char *end;
+	long int port;
+	size_t n;
+
+	(void)shim_memset(addr, 0, sizeof(*addr));
+	*host = '\0';
+	if (ipv6) {
+		const char *close = strchr(opt, ']');
+
+		if (!close || (close[1] != ':'))
+			return -1;
+		n = (size_t)(close - opt - 1);
+		port_str = close + 2;
+		opt++;
+	} else {
+		const char *colon = strrchr(opt, ':');
+
+		n = colon ? (size_t)(colon - opt) : 0;
+		port_str = colon ? colon + 1 : opt;
+	}
+	if (n >= sizeof(host))
+		return -1;
+	(void)shim_memcpy(host, opt, n);
+	host[n] = '\0';
+
+	errno = 0;
+	port = strtol(port_str, &end, 10);
+	if ((errno != 0) || (end == port_str) || (*end != '\0') ||
+	    (port < 1) || (port > MAX_PORT))
+		return -1;
+
+	if (ipv6) {
+		struct sockaddr_in6 *addr6 = (struct sockaddr_in6 *)addr;
+
+		addr6->sin6_family = AF_INET6;
+		addr6->sin6_port = htons((uint16_t)port);
+		if (inet_pton(AF_INET6, host, &addr6->sin6_addr) != 1)
+			return -1;
+		*addr_len = (socklen_t)sizeof(*addr6);
+	} else {
+		struct sockaddr_in *addr4 = (struct sockaddr_in *)addr;
+
+		addr4->sin_family = AF_INET;
+		addr4->sin_port = htons((uint16_t)port);
+		if (!*host || !strcmp(host, "*"))
+			addr4->sin_addr.s_addr = htonl(INADDR_ANY);
+		else if (!strcmp(host, "localhost"))
+			addr4->sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+		else if (inet_pton(AF_INET, host, &addr4->sin_addr) != 1)
+			return -1;
+		*addr_len = (socklen_t)sizeof(*addr4);
+	}
+	return 0;
+}
+
+/*
+ *  stress_openmetrics_set_listen()
+ *	parse --metrics-listen option
+ */
+int stress_openmetrics_set_listen(const char *opt)
+{
+	struct sockaddr_storage addr;
+	socklen_t addr_len;
+
+	if (stress_openmetrics_addr(opt, &addr, &addr_len) < 0) {
+		(void)fprintf(stderr, "metrics-listen: invalid address '%s', "
+			"expecting ADDR:PORT, [IPV6ADDR]:PORT or PORT\n", opt);
+		return -1;
+	}
+	stress_set_setting_global("metrics-listen", TYPE_ID_STR, (void *)opt);
+	return 0;
+}
+
+#if defined(HAVE_POLL_H) &&	\
+    defined(AF_INET) &&		\
+    defined(AF_INET6)
+/*
+ *  stress_openmetrics_system()
+ *	output system wide load, memory, CPU frequency, thermal
+ *	and RAPL power readings
+ */
+static void stress_openmetrics_system(FILE *fp, const double now)
+{
+	double min1, min5, min15, avg_ghz, min_ghz, max_ghz;
+	size_t shmall = 0, freemem = 0, totalmem = 0, freeswap = 0, totalswap = 0;
+
+	(void)fprintf(fp, "# TYPE stress_ng_run_time_seconds gauge\n");
+	(void)fprintf(fp, "# HELP stress_ng_run_time_seconds Time since the stressors were started.\n");
+	(void)fprintf(fp, "stress_ng_run_time_seconds %.3f\n", now - g_shared->time_started);
+
+	if (stress_get_load_avg(&min1, &min5, &min15) == 0) {
+		(void)fprintf(fp, "# TYPE stress_ng_load_average gauge\n");
+		(void)fprintf(fp, "# HELP stress_ng_load_average System load average.\n");
+		(void)fprintf(fp, "stress_ng_load_average{period=\"1m\"} %.2f\n", min1);
+		(void)fprintf(fp, "stress_ng_load_average{period=\"5m\"} %.2f\n", min5);
+		(void)fprintf(fp, "stress_ng_load_average{period=\"15m\"} %.2f\n", min15);
+	}
+
+	stress_get_memlimits(&shmall, &freemem, &totalmem, &freeswap, &totalswap);
+	if (totalmem > 0) {
+		(void)fprintf(fp, "# TYPE stress_ng_memory_bytes gauge\n");
+		(void)fprintf(fp, "# HELP stress_ng_memory_bytes System memory and swap.\n");
+		(void)fprintf(fp, "stress_ng_memory_bytes{type=\"free\"} %zu\n", freemem);
+		(void)fprintf(fp, "stress_ng_memory_bytes{type=\"total\"} %zu\n", totalmem);
+		(void)fprintf(fp, "stress_ng_memory_bytes{type=\"swap_free\"} %zu\n", freeswap);
+		(void)fprintf(fp, "stress_ng_memory_bytes{type=\"swap_total\"} %zu\n", totalswap);
+	}
+
+	stress_get_cpu_ghz(&avg_ghz, &min_ghz, &max_ghz);
+	if (avg_ghz > 0.0) {
+		(void)fprintf(fp, "# TYPE stress_ng_cpu_frequency_ghz gauge\n");
+		(void)fprintf(fp, "# HELP stress_ng_cpu_frequency_ghz Online CPU scaling frequency.\n");
+		(void)fprintf(fp, "stress_ng_cpu_frequency_ghz{stat=\"avg\"} %.3f\n", avg_ghz);
+		(void)fprintf(fp, "stress_ng_cpu_frequency_ghz{stat=\"min\"} %.3f\n", min_ghz);
+		(void)fprintf(fp, "stress_ng_cpu_frequency_ghz{stat=\"max\"} %.3f\n", max_ghz);
+	}
+
+#if defined(STRESS_THERMAL_ZONES)
+	{
+		const double temperature = stress_tz_get_max_temperature();
+
+		if (temperature > 0.0) {
+			(void)fprintf(fp, "# TYPE stress_ng_thermal_max_celsius gauge\n");
+			(void)fprintf(fp, "# HELP stress_ng_thermal_max_celsius Hottest thermal zone temperature.\n");
+			(void)fprintf(fp, "stress_ng_thermal_max_celsius %.2f\n", temperature);
+		}
+	}
+#endif
+
+#if defined(STRESS_RAPL)
+	/* the server process has a private copy of the RAPL domains */
+	if ((g_opt_flags & OPT_FLAGS_RAPL_REQUIRED) &&
+	    g_shared->rapl_domains &&
+	    (stress_rapl_get_power_raplstat(g_shared->rapl_domains) == 0)) {
+		const stress_rapl_domain_t *rapl;
+
+		(void)fprintf(fp, "# TYPE stress_ng_rapl_watts gauge\n");
+		(void)fprintf(fp, "# HELP stress_ng_rapl_watts RAPL power since the previous scrape.\n");
+		for (rapl = g_shared->rapl_domains; rapl; rapl = rapl->next)
+			(void)fprintf(fp, "stress_ng_rapl_watts{domain=\"%s\"} %.3f\n",
+				rapl->domain_name,
+				rapl->data[STRESS_RAPL_DATA_RAPLSTAT].power_watts);
+	}
+#endif
+}
+
+/*
+ *  stress_openmetrics_request()
+ *	read a HTTP request and reply with the metrics, the
+ *	stressor counters are only read and never locked
+ */
+static void stress_openmetrics_request(const int fd)
+{
+	char request[OPENMETRICS_REQUEST_MAX];
+	size_t len = 0;
+	FILE *fp;
+	bool found;
+
+	/* read the request header, clients should send it in one go */
+	while (len < sizeof(request) - 1) {
+		struct pollfd pfd;
+		ssize_t ret;
+
+		pfd.fd = fd;
+		pfd.events = POLLIN;
+		pfd.revents = 0;
+		if (poll(&pfd, 1, OPENMETRICS_POLL_MS) <= 0)
+			break;
+		ret = recv(fd, request + len, sizeof(request) - 1 - len, 0);
+		if (ret <= 0)
+			break;
+		len += (size_t)ret;
+		request[len] = '\0';
+		if (strstr(request, "\r\n\r\n") || strstr(request, "\n\n"))
+			break;
+	}
+	request[len] = '\0';
+	if (strncmp(request, "GET ", 4)) {
+		(void)close(fd);
+		return;
+	}
+
+	fp = fdopen(fd, "w");
+	if (!fp) {
+		(void)close(fd);
+		return;
+	}
+	found = !strncmp(request + 4, "/ ", 2) ||
+		(!strncmp(request + 4, "/metrics", 8) &&
+		 ((request[12] == ' ') || (request[12] == '?')));
+	if (found) {
+		const double now = stress_time_now();
+
+		(void)fprintf(fp, "HTTP/1.0 200 OK\r\n"
+			"Content-Type: " OPENMETRICS_CONTENT_TYPE "\r\n"
+			"Connection: close\r\n\r\n");
+		stress_openmetrics_system(fp, now);
+		stress_metrics_openmetrics_dump(fp, now);
+		(void)fprintf(fp, "# EOF\n");
+	} else {
+		(void)fprintf(fp, "HTTP/1.0 404 Not Found\r\n"
+			"Content-Type: text/plain\r\n"
+			"Connection: close\r\n\r\n"
+			"metrics are served on /metrics\n");
+	}
+	/* closes fd too */
+	(void)fclose(fp);
+}
+#endif
+
+/*
+ *  stress_openmetrics_start()
+ *	start the --metrics-listen OpenMetrics server process, the
+ *	socket is bound by the parent so that errors are reported
+ *	before the stressors are started
+ */
+void stress_openmetrics_start(void)
+{
+#if defined(HAVE_POLL_H) &&	\
+    defined(AF_INET) &&		\
+    defined(AF_INET6)
+	struct sockaddr_storage addr;
+	socklen_t addr_len;
+	char *listen_addr = NULL;
+	int fd, so_reuseaddr = 1;
+
+	if (!stress_get_setting("metrics-listen", &listen_addr) || !listen_addr)
+		return;
+	if (stress_openmetrics_addr(listen_addr, &addr, &addr_len) < 0)
+		return;
+
+	fd = socket(addr.ss_family, SOCK_STREAM, 0);
+	if (fd < 0) {
+		pr_err("metrics-listen: socket failed, errno=%d (%s)\n",
+			errno, strerror(errno));
+		return;
+	}
+	(void)setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &so_reuseaddr, sizeof(so_reuseaddr));
+	if (bind(fd, (struct sockaddr *)&addr, addr_len) < 0) {
+		pr_err("metrics-listen: cannot bind to %s, errno=%d (%s)\n",
+			listen_addr, errno, strerror(errno));
+		(void)close(fd);
+		return;
+	}
+	if (listen(fd, 8) < 0) {
+		pr_err("metrics-listen: listen on %s failed, errno=%d (%s)\n",
+			listen_addr, errno, strerror(errno));
+		(void)close(fd);
+		return;
+	}
+
+	openmetrics_pid = fork();
+	if (openmetrics_pid < 0) {
+		pr_err("metrics-listen: fork failed, errno=%d (%s)\n",
+			errno, strerror(errno));
+	} else if (openmetrics_pid == 0) {
+		stress_parent_died_alarm();
+		stress_set_proc_name("stat [openmetrics]");
+		(void)signal(SIGPIPE, SIG_IGN);
+
+		while (stress_continue_flag()) {
+			struct pollfd pfd;
+			int conn;
+
+			pfd.fd = fd;
+			pfd.events = POLLIN;
+			pfd.revents = 0;
+			if (poll(&pfd, 1, OPENMETRICS_POLL_MS) <= 0)
+				continue;
+			conn = accept(fd, NULL, NULL);
+			if (conn < 0)
+				continue;
+			stress_openmetrics_request(conn);
+		}
+		(void)close(fd);
+		_exit(0);
+	} else {
+		pr_inf("metrics-listen: serving OpenMetrics on http://%s/metrics\n", listen_addr);
+	}
+	(void)close(fd);
+#endif
+}
+
+/*
+ *  stress_openmetrics_stop()
+ *	stop the --metrics-listen OpenMetrics server process
+ */
+void stress_openmetrics_stop(void)
+{
+#if defined(HAVE_POLL_H) &&	\
+    defined(AF_INET) &&		\
+    defined(AF_INET6)
+	if (openmetrics_pid > 0)
+		(void)stress_kill_pid_wait(openmetrics_pid, NULL);
+	openmetrics_pid = -1;
+#endif
+}
@@ -29,6 +29,7 @@ const struct option stress_long_options[] = {
 	{ "acl-rand",		0,	0,	OPT_acl_rand },
 	{ "acl-ops",		1,	0,	OPT_acl_ops },
 	{ "af-alg",		1,	0,	OPT_af_alg },
+	{ "af-alg-bench",	0,	0,	OPT_af_alg_bench },
 	{ "af-alg-dump",	0,	0,	OPT_af_alg_dump },
 	{ "af-alg-ops",		1,	0,	OPT_af_alg_ops },
 	{ "affinity",		1,	0,	OPT_affinity },
@@ -37,11 +38,15 @@ const struct option stress_long_options[] = {
 	{ "affinity-pin",	0,	0,	OPT_affinity_pin },
 	{ "affinity-rand",	0,	0,	OPT_affinity_rand },
 	{ "affinity-sleep",	1,	0,	OPT_affinity_sleep },
+	{ "agent",		1,	0,	OPT_agent },
 	{ "aggressive",		0,	0,	OPT_aggressive },
 	{ "aio",		1,	0,	OPT_aio },
 	{ "aio-ops",		1,	0,	OPT_aio_ops },
 	{ "aio-requests",	1,	0,	OPT_aio_requests },
 	{ "aiol",		1,	0,	OPT_aiol},
+	{ "aiol-batch",		1,	0,	OPT_aiol_batch },
+	{ "aiol-eventfd",	0,	0,	OPT_aiol_eventfd },
+	{ "aiol-min-nr",	1,	0,	OPT_aiol_min_nr },
 	{ "aiol-ops",		1,	0,	OPT_aiol_ops },
 	{ "aiol-requests",	1,	0,	OPT_aiol_requests },
 	{ "alarm",		1,	0,	OPT_alarm },
@@ -70,6 +75,7 @@ const struct option stress_long_options[] = {
 	{ "binderfs",		1,	0,	OPT_binderfs },
 	{ "binderfs-ops",	1,	0,	OPT_binderfs_ops },
 	{ "bitonicsort",	1,	0,	OPT_bitonicsort },
+	{ "bitonicsort-method",	1,	0,	OPT_bitonicsort_method },
 	{ "bitonicsort-ops",	1,	0,	OPT_bitonicsort_ops },
 	{ "bitonicsort-size",	1,	0,	OPT_bitonicsort_size },
 	{ "bitops",		1,	0,	OPT_bitops },
@@ -77,6 +83,7 @@ const struct option stress_long_options[] = {
 	{ "bitops-ops",		1,	0,	OPT_bitops_ops },
 	{ "branch",		1,	0,	OPT_branch },
 	{ "branch-ops",		1,	0,	OPT_branch_ops },
+	{ "branch-sweep",	0,	0,	OPT_branch_sweep },
 	{ "brk",		1,	0,	OPT_brk },
 	{ "brk-bytes",		1,	0,	OPT_brk_bytes },
 	{ "brk-mlock",		0,	0,	OPT_brk_mlock },
@@ -91,6 +98,7 @@ const struct option stress_long_options[] = {
 	{ "bubblesort-ops",	1,	0,	OPT_bubblesort_ops },
 	{ "bubblesort-size",	1,	0,	OPT_bubblesort_size },
 	{ "c-states",		0,	0,	OPT_c_states },
+	{ "c-states-affinity",	0,	0,	OPT_c_states_affinity },
 	{ "cache",		1,	0, 	OPT_cache },
 	{ "cache-size",		1,	0, 	OPT_cache_size},
 	{ "cache-cldemote",	0,	0,	OPT_cache_cldemote },
@@ -110,6 +118,7 @@ const struct option stress_long_options[] = {
 	{ "cachehammer-ops",	1,	0,	OPT_cachehammer_ops },
 	{ "cacheline",		1,	0, 	OPT_cacheline },
 	{ "cacheline-affinity",	0,	0,	OPT_cacheline_affinity },
+	{ "cacheline-c2c",	0,	0,	OPT_cacheline_c2c },
 	{ "cacheline-method",	1,	0,	OPT_cacheline_method },
 	{ "cacheline-ops",	1,	0,	OPT_cacheline_ops },
 	{ "cap",		1,	0, 	OPT_cap },
@@ -130,26 +139,34 @@ const struct option stress_long_options[] = {
 	{ "cgroup-ops",		1,	0,	OPT_cgroup_ops },
 	{ "class",		1,	0,	OPT_class },
 	{ "clock",		1,	0,	OPT_clock },
+	{ "cluster-token",	1,	0,	OPT_cluster_token },
 	{ "clock-ops",		1,	0,	OPT_clock_ops },
 	{ "clone",		1,	0,	OPT_clone },
 	{ "clone-max",		1,	0,	OPT_clone_max },
 	{ "clone-ops",		1,	0,	OPT_clone_ops },
 	{ "close",		1,	0,	OPT_close },
 	{ "close-ops",		1,	0,	OPT_close_ops },
+	{ "compare",		1,	0,	OPT_compare },
+	{ "compare-threshold",	1,	0,	OPT_compare_threshold },
 	{ "config",		0,	0,	OPT_config },
 	{ "context",		1,	0,	OPT_context },
 	{ "context-ops",	1,	0,	OPT_context_ops },
+	{ "coordinate",		1,	0,	OPT_coordinate },
 	{ "copy-file",		1,	0,	OPT_copy_file },
 	{ "copy-file-bytes",	1,	0,	OPT_copy_file_bytes },
+	{ "copy-file-cross-dir", 1,	0,	OPT_copy_file_cross_dir },
 	{ "copy-file-ops",	1,	0,	OPT_copy_file_ops },
+	{ "copy-file-sweep",	0,	0,	OPT_copy_file_sweep },
 	{ "cpu",		1,	0,	OPT_cpu },
 	{ "cpu-ops",		1,	0,	OPT_cpu_ops },
+	{ "cpu-fft-sweep",	0,	0,	OPT_cpu_fft_sweep },
 	{ "cpu-load",		1,	0,	OPT_cpu_load },
 	{ "cpu-load-slice",	1,	0,	OPT_cpu_load_slice },
 	{ "cpu-method",		1,	0,	OPT_cpu_method },
 	{ "cpu-online",		1,	0,	OPT_cpu_online },
 	{ "cpu-online-affinity",0,	0,	OPT_cpu_online_affinity },
 	{ "cpu-online-all",	0,	0,	OPT_cpu_online_all },
+	{ "cpu-online-latency",	0,	0,	OPT_cpu_online_latency },
 	{ "cpu-online-ops",	1,	0,	OPT_cpu_online_ops },
 	{ "cpu-sched",		1,	0,	OPT_cpu_sched },
 	{ "cpu-sched-ops",	1,	0,	OPT_cpu_sched_ops },
@@ -179,6 +196,7 @@ const struct option stress_long_options[] = {
 	{ "dentry",		1,	0,	OPT_dentry },
 	{ "dentry-ops",		1,	0,	OPT_dentry_ops },
 	{ "dentries",		1,	0,	OPT_dentries },
+	{ "dentry-mdtest",	1,	0,	OPT_dentry_mdtest },
 	{ "dentry-order",	1,	0,	OPT_dentry_order },
 	{ "dev",		1,	0,	OPT_dev },
 	{ "dev-file",		1,	0,	OPT_dev_file },
@@ -211,6 +229,7 @@ const struct option stress_long_options[] = {
 	{ "eigen-ops",		1,	0,	OPT_eigen_ops },
 	{ "eigen-method",	1,	0,	OPT_eigen_method },
 	{ "eigen-size",		1,	0,	OPT_eigen_size },
+	{ "eigen-threads",	1,	0,	OPT_eigen_threads },
 	{ "efivar",		1,	0,	OPT_efivar },
 	{ "efivar-ops",		1,	0,	OPT_efivar_ops },
 	{ "enosys",		1,	0,	OPT_enosys },
@@ -218,20 +237,26 @@ const struct option stress_long_options[] = {
 	{ "env",		1,	0,	OPT_env },
 	{ "env-ops",		1,	0,	OPT_env_ops },
 	{ "epoll",		1,	0,	OPT_epoll },
+	{ "epoll-busy-poll",	1,	0,	OPT_epoll_busy_poll },
+	{ "epoll-busy-poll-budget",1,	0,	OPT_epoll_busy_poll_budget },
 	{ "epoll-domain",	1,	0,	OPT_epoll_domain },
+	{ "epoll-exclusive",	0,	0,	OPT_epoll_exclusive },
 	{ "epoll-ops",		1,	0,	OPT_epoll_ops },
 	{ "epoll-port",		1,	0,	OPT_epoll_port },
 	{ "epoll-sockets",	1,	0,	OPT_epoll_sockets },
+	{ "epoll-waiters",	1,	0,	OPT_epoll_waiters },
 	{ "eventfd",		1,	0,	OPT_eventfd },
 	{ "eventfd-nonblock",	0,	0,	OPT_eventfd_nonblock },
 	{ "eventfd-ops",	1,	0,	OPT_eventfd_ops },
 	{ "exclude",		1,	0,	OPT_exclude },
 	{ "exec",		1,	0,	OPT_exec },
+	{ "exec-cold",		1,	0,	OPT_exec_cold },
 	{ "exec-fork-method",	1,	0,	OPT_exec_fork_method },
 	{ "exec-max",		1,	0,	OPT_exec_max },
 	{ "exec-method",	1,	0,	OPT_exec_method },
 	{ "exec-no-pthread",	0,	0,	OPT_exec_no_pthread },
 	{ "exec-ops",		1,	0,	OPT_exec_ops },
+	{ "exec-prog",		1,	0,	OPT_exec_prog },
 	{ "exit-group",		1,	0,	OPT_exit_group },
 	{ "exit-group-ops",	1,	0,	OPT_exit_group_ops },
 	{ "expmath",		1,	0,	OPT_expmath },
@@ -242,13 +267,18 @@ const struct option stress_long_options[] = {
 	{ "factor-ops",		1,	0,	OPT_factor_ops },
 	{ "fallocate",		1,	0,	OPT_fallocate },
 	{ "fallocate-bytes",	1,	0,	OPT_fallocate_bytes },
+	{ "fallocate-chunk",	1,	0,	OPT_fallocate_chunk },
+	{ "fallocate-mode",	1,	0,	OPT_fallocate_mode },
 	{ "fallocate-ops",	1,	0,	OPT_fallocate_ops },
+	{ "fallocate-shared",	0,	0,	OPT_fallocate_shared },
+	{ "fallocate-threads",	1,	0,	OPT_fallocate_threads },
 	{ "fanotify",		1,	0,	OPT_fanotify },
 	{ "fanotify-ops",	1,	0,	OPT_fanotify_ops },
 	{ "far-branch",		1,	0,	OPT_far_branch },
 	{ "far-branch-flush",	0,	0,	OPT_far_branch_flush },
 	{ "far-branch-ops",	1,	0,	OPT_far_branch_ops },
 	{ "far-branch-pages",	1,	0,	OPT_far_branch_pages },
+	{ "far-branch-sweep",	0,	0,	OPT_far_branch_sweep },
 	{ "fault",		1,	0,	OPT_fault },
 	{ "fault-ops",		1,	0,	OPT_fault_ops },
 	{ "fcntl",		1,	0,	OPT_fcntl},
@@ -284,10 +314,13 @@ const struct option stress_long_options[] = {
 	{ "flock",		1,	0,	OPT_flock },
 	{ "flock-ops",		1,	0,	OPT_flock_ops },
 	{ "flushcache",		1,	0,	OPT_flushcache },
+	{ "flushcache-dax",	1,	0,	OPT_flushcache_dax },
+	{ "flushcache-dax-size",1,	0,	OPT_flushcache_dax_size },
 	{ "flushcache-ops",	1,	0,	OPT_flushcache_ops },
 	{ "fma",		1,	0,	OPT_fma },
 	{ "fma-ops",		1,	0,	OPT_fma_ops },
 	{ "fma-libc",		0,	0,	OPT_fma_libc },
+	{ "fma-peak",		0,	0,	OPT_fma_peak },
 	{ "fork",		1,	0,	OPT_fork },
 	{ "fork-max",		1,	0,	OPT_fork_max },
 	{ "fork-ops",		1,	0,	OPT_fork_ops },
@@ -319,6 +352,7 @@ const struct option stress_long_options[] = {
 	{ "fstat-dir",		1,	0,	OPT_fstat_dir },
 	{ "fstat-ops",		1,	0,	OPT_fstat_ops },
 	{ "ftrace",		0,	0,	OPT_ftrace },
+	{ "ftrace-raw",		0,	0,	OPT_ftrace_raw },
 	{ "full",		1,	0,	OPT_full },
 	{ "full-ops",		1,	0,	OPT_full_ops },
 	{ "funccall",		1,	0,	OPT_funccall },
@@ -328,7 +362,11 @@ const struct option stress_long_options[] = {
 	{ "funcret-method",	1,	0,	OPT_funcret_method },
 	{ "funcret-ops",	1,	0,	OPT_funcret_ops },
 	{ "futex",		1,	0,	OPT_futex },
+	{ "futex-method",	1,	0,	OPT_futex_method },
 	{ "futex-ops",		1,	0,	OPT_futex_ops },
+	{ "futex-waitv",	1,	0,	OPT_futex_waitv },
+	{ "futex-waiter-cpu",	1,	0,	OPT_futex_waiter_cpu },
+	{ "futex-waker-cpu",	1,	0,	OPT_futex_waker_cpu },
 	{ "get",		1,	0,	OPT_get },
 	{ "get-ops",		1,	0,	OPT_get_ops },
 	{ "get-slow-sync",	0,	0,	OPT_get_slow_sync },
@@ -350,17 +388,30 @@ const struct option stress_long_options[] = {
 	{ "handle",		1,	0,	OPT_handle },
 	{ "handle-ops",		1,	0,	OPT_handle_ops },
 	{ "hash",		1,	0,	OPT_hash },
+	{ "hash-bulk",		0,	0,	OPT_hash_bulk },
 	{ "hash-method",	1,	0,	OPT_hash_method },
 	{ "hash-ops",		1,	0,	OPT_hash_ops },
+	{ "hashmap",		1,	0,	OPT_hashmap },
+	{ "hashmap-method",	1,	0,	OPT_hashmap_method },
+	{ "hashmap-ops",	1,	0,	OPT_hashmap_ops },
+	{ "hashmap-rwmix",	1,	0,	OPT_hashmap_rwmix },
+	{ "hashmap-size",	1,	0,	OPT_hashmap_size },
+	{ "hashmap-threads",	1,	0,	OPT_hashmap_threads },
+	{ "hashmap-zipf",	1,	0,	OPT_hashmap_zipf },
 	{ "hdd",		1,	0,	OPT_hdd },
+	{ "hdd-bs-sweep",	0,	0,	OPT_hdd_bs_sweep },
 	{ "hdd-bytes",		1,	0,	OPT_hdd_bytes },
+	{ "hdd-engine",		1,	0,	OPT_hdd_engine },
+	{ "hdd-iodepth",	1,	0,	OPT_hdd_iodepth },
 	{ "hdd-ops",		1,	0,	OPT_hdd_ops },
 	{ "hdd-opts",		1,	0,	OPT_hdd_opts },
+	{ "hdd-rwmix",		1,	0,	OPT_hdd_rwmix },
 	{ "hdd-write-size", 	1,	0,	OPT_hdd_write_size },
 	{ "heapsort",		1,	0,	OPT_heapsort },
 	{ "heapsort-method",	1,	0,	OPT_heapsort_method },
 	{ "heapsort-ops",	1,	0,	OPT_heapsort_ops },
 	{ "heapsort-size",	1,	0,	OPT_heapsort_size },
+	{ "heapsort-threads",	1,	0,	OPT_heapsort_threads },
 	{ "hrtimers",		1,	0,	OPT_hrtimers },
 	{ "hrtimers-adjust",	0,	0,	OPT_hrtimers_adjust },
 	{ "hrtimers-ops",	1,	0,	OPT_hrtimers_ops },
@@ -369,6 +420,8 @@ const struct option stress_long_options[] = {
 	{ "hsearch-method",	1,	0,	OPT_hsearch_method },
 	{ "hsearch-ops",	1,	0,	OPT_hsearch_ops },
 	{ "hsearch-size",	1,	0,	OPT_hsearch_size },
+	{ "hugetlb",		0,	0,	OPT_hugetlb },
+	{ "hugetlb-size",	1,	0,	OPT_hugetlb_size },
 	{ "hyperbolic",		1,	0,	OPT_hyperbolic },
 	{ "hyperbolic-method",	1,	0,	OPT_hyperbolic_method },
 	{ "hyperbolic-ops",	1,	0,	OPT_hyperbolic_ops },
@@ -379,7 +432,12 @@ const struct option stress_long_options[] = {
 	{ "icmp-flood-max-size", 0,	0,	OPT_icmp_flood_max_size },
 	{ "idle-page",		1,	0,	OPT_idle_page },
 	{ "idle-page-ops",	1,	0,	OPT_idle_page_ops },
+	{ "idle-page-wss",	0,	0,	OPT_idle_page_wss },
+	{ "idle-page-wss-interval",1,	0,	OPT_idle_page_wss_interval },
+	{ "idle-page-wss-pid",	1,	0,	OPT_idle_page_wss_pid },
 	{ "ignite-cpu",		0,	0, 	OPT_ignite_cpu },
+	{ "instance-threads",	0,	0,	OPT_instance_threads },
+	{ "interference",	1,	0,	OPT_interference },
 	{ "interrupts",		0,	0,	OPT_interrupts },
 	{ "inode-flags",	1,	0,	OPT_inode_flags },
 	{ "inode-flags-ops",	1,	0,	OPT_inode_flags_ops },
@@ -397,6 +455,7 @@ const struct option stress_long_options[] = {
 	{ "iomix",		1,	0,	OPT_iomix },
 	{ "iomix-bytes",	1,	0,	OPT_iomix_bytes },
 	{ "iomix-ops",		1,	0,	OPT_iomix_ops },
+	{ "iomix-profile",	1,	0,	OPT_iomix_profile },
 	{ "ionice-class",	1,	0,	OPT_ionice_class },
 	{ "ionice-level",	1,	0,	OPT_ionice_level },
 	{ "ioport",		1,	0,	OPT_ioport },
@@ -405,10 +464,17 @@ const struct option stress_long_options[] = {
 	{ "ioprio",		1,	0,	OPT_ioprio },
 	{ "ioprio-ops",		1,	0,	OPT_ioprio_ops },
 	{ "iostat",		1,	0,	OPT_iostat },
+	{ "iostat-yaml",	1,	0,	OPT_iostat_yaml },
 	{ "io-uring",		1,	0,	OPT_io_uring },
+	{ "io-uring-batch",	1,	0,	OPT_io_uring_batch },
+	{ "io-uring-depth",	1,	0,	OPT_io_uring_depth },
 	{ "io-uring-entries",	1,	0,	OPT_io_uring_entries },
+	{ "io-uring-fixed",	0,	0,	OPT_io_uring_fixed },
 	{ "io-uring-ops",	1,	0,	OPT_io_uring_ops },
 	{ "io-uring-rand",	0,	0,	OPT_io_uring_rand },
+	{ "io-uring-sqpoll",	0,	0,	OPT_io_uring_sqpoll },
+	{ "io-uring-sqpoll-cpu",1,	0,	OPT_io_uring_sqpoll_cpu },
+	{ "io-uring-taskrun",	1,	0,	OPT_io_uring_taskrun },
 	{ "ipsec-mb",		1,	0,	OPT_ipsec_mb },
 	{ "ipsec-mb-feature",	1,	0,	OPT_ipsec_mb_feature },
 	{ "ipsec-mb-jobs",	1,	0,	OPT_ipsec_mb_jobs },
@@ -423,8 +489,11 @@ const struct option stress_long_options[] = {
 	{ "jpeg-height",	1,	0,	OPT_jpeg_height },
 	{ "jpeg-image",		1,	0,	OPT_jpeg_image },
 	{ "jpeg-ops",		1,	0,	OPT_jpeg_ops },
+	{ "jpeg-pipeline",	1,	0,	OPT_jpeg_pipeline },
+	{ "jpeg-producers",	1,	0,	OPT_jpeg_producers },
 	{ "jpeg-quality",	1,	0,	OPT_jpeg_quality },
 	{ "jpeg-width",		1,	0,	OPT_jpeg_width },
+	{ "json",		1,	0,	OPT_json },
 	{ "judy",		1,	0,	OPT_judy },
 	{ "judy-ops",		1,	0,	OPT_judy_ops },
 	{ "judy-size",		1,	0,	OPT_judy_size },
@@ -441,8 +510,11 @@ const struct option stress_long_options[] = {
 	{ "klog-ops",		1,	0,	OPT_klog_ops },
 	{ "ksm",		0,	0,	OPT_ksm },
 	{ "kvm",		1,	0,	OPT_kvm },
+	{ "kvm-exit",		1,	0,	OPT_kvm_exit },
 	{ "kvm-ops",		1,	0,	OPT_kvm_ops },
+	{ "kvm-vcpus",		1,	0,	OPT_kvm_vcpus },
 	{ "l1cache",		1,	0, 	OPT_l1cache },
+	{ "l1cache-bandwidth",	0,	0,	OPT_l1cache_bandwidth },
 	{ "l1cache-line-size",	1,	0,	OPT_l1cache_line_size },
 	{ "l1cache-method",	1,	0,	OPT_l1cache_method },
 	{ "l1cache-mlock",	0,	0,	OPT_l1cache_mlock },
@@ -452,15 +524,25 @@ const struct option stress_long_options[] = {
 	{ "l1cache-ways",	1,	0,	OPT_l1cache_ways},
 	{ "landlock",		1,	0,	OPT_landlock },
 	{ "landlock-ops",	1,	0,	OPT_landlock_ops },
+	{ "latency",		0,	0,	OPT_latency },
+	{ "launchers",		1,	0,	OPT_launchers },
 	{ "led",		1,	0,	OPT_led },
 	{ "led-ops",		1,	0,	OPT_led_ops },
 	{ "lease",		1,	0,	OPT_lease },
 	{ "lease-breakers",	1,	0,	OPT_lease_breakers },
 	{ "lease-ops",		1,	0,	OPT_lease_ops },
+	{ "lfqueue",		1,	0,	OPT_lfqueue },
+	{ "lfqueue-consumers",	1,	0,	OPT_lfqueue_consumers },
+	{ "lfqueue-method",	1,	0,	OPT_lfqueue_method },
+	{ "lfqueue-ops",	1,	0,	OPT_lfqueue_ops },
+	{ "lfqueue-placement",	1,	0,	OPT_lfqueue_placement },
+	{ "lfqueue-producers",	1,	0,	OPT_lfqueue_producers },
+	{ "lfqueue-size",	1,	0,	OPT_lfqueue_size },
 	{ "link",		1,	0,	OPT_link },
 	{ "link-ops",		1,	0,	OPT_link_ops },
 	{ "link-sync",		0,	0,	OPT_link_sync },
 	{ "list",		1,	0,	OPT_list },
+	{ "list-layout",	1,	0,	OPT_list_layout },
 	{ "list-method",	1,	0,	OPT_list_method },
 	{ "list-ops",		1,	0,	OPT_list_ops },
 	{ "list-size",		1,	0,	OPT_list_size },
@@ -477,6 +559,7 @@ const struct option stress_long_options[] = {
 	{ "lockbus",		1,	0,	OPT_lockbus },
 	{ "lockbus-ops",	1,	0,	OPT_lockbus_ops },
 	{ "lockbus-nosplit",	0,	0,	OPT_lockbus_nosplit },
+	{ "lockbus-victim",	0,	0,	OPT_lockbus_victim },
 	{ "lockf",		1,	0,	OPT_lockf },
 	{ "lockf-nonblock", 	0,	0,	OPT_lockf_nonblock },
 	{ "lockf-ops",		1,	0,	OPT_lockf_ops },
@@ -484,6 +567,7 @@ const struct option stress_long_options[] = {
 	{ "lockmix-ops",	1,	0,	OPT_lockmix_ops },
 	{ "lockofd",		1,	0,	OPT_lockofd },
 	{ "lockofd-ops",	1,	0,	OPT_lockofd_ops },
+	{ "lock-type",		1,	0,	OPT_lock_type },
 	{ "log-brief",		0,	0,	OPT_log_brief },
 	{ "log-file",		1,	0,	OPT_log_file },
 	{ "log-lockless",	0,	0,	OPT_log_lockless },
@@ -503,17 +587,22 @@ const struct option stress_long_options[] = {
 	{ "madvise",		1,	0,	OPT_madvise },
 	{ "madvise-ops",	1,	0,	OPT_madvise_ops },
 	{ "madvise-hwpoison",	0,	0,	OPT_madvise_hwpoison },
+	{ "madvise-prefault",	0,	0,	OPT_madvise_prefault },
+	{ "madvise-prefault-bytes", 1,	0,	OPT_madvise_prefault_bytes },
 	{ "malloc",		1,	0,	OPT_malloc },
+	{ "malloc-allocator",	1,	0,	OPT_malloc_allocator },
 	{ "malloc-bytes",	1,	0,	OPT_malloc_bytes },
 	{ "malloc-max",		1,	0,	OPT_malloc_max },
 	{ "malloc-mlock",	0,	0,	OPT_malloc_mlock },
 	{ "malloc-ops",		1,	0,	OPT_malloc_ops },
 	{ "malloc-pthreads",	1,	0,	OPT_malloc_pthreads },
+	{ "malloc-sizes",	1,	0,	OPT_malloc_sizes },
 	{ "malloc-thresh",	1,	0,	OPT_malloc_threshold },
 	{ "malloc-touch",	0,	0,	OPT_malloc_touch },
 	{ "malloc-trim",	0,	0,	OPT_malloc_trim },
 	{ "malloc-zerofree",	0,	0,	OPT_malloc_zerofree },
 	{ "matrix",		1,	0,	OPT_matrix },
+	{ "matrix-gemm-threads",1,	0,	OPT_matrix_gemm_threads },
 	{ "matrix-method",	1,	0,	OPT_matrix_method },
 	{ "matrix-ops",		1,	0,	OPT_matrix_ops },
 	{ "matrix-size",	1,	0,	OPT_matrix_size },
@@ -529,11 +618,15 @@ const struct option stress_long_options[] = {
 	{ "mcontend",		1,	0,	OPT_mcontend },
 	{ "mcontend-numa",	0,	0,	OPT_mcontend_numa },
 	{ "mcontend-ops",	1,	0,	OPT_mcontend_ops },
+	{ "mem-footprint",	0,	0,	OPT_mem_footprint },
 	{ "membarrier",		1,	0,	OPT_membarrier },
 	{ "membarrier-ops",	1,	0,	OPT_membarrier_ops },
+	{ "membarrier-sweep",	0,	0,	OPT_membarrier_sweep },
+	{ "membarrier-sweep-threads", 1, 0,	OPT_membarrier_sweep_threads },
 	{ "memcpy",		1,	0,	OPT_memcpy },
 	{ "memcpy-method",	1,	0,	OPT_memcpy_method },
 	{ "memcpy-ops",		1,	0,	OPT_memcpy_ops },
+	{ "memcpy-sweep",	0,	0,	OPT_memcpy_sweep },
 	{ "memfd",		1,	0,	OPT_memfd },
 	{ "memfd-bytes",	1,	0,	OPT_memfd_bytes },
 	{ "memfd-fds",		1,	0,	OPT_memfd_fds },
@@ -555,15 +648,25 @@ const struct option stress_long_options[] = {
 	{ "memthrash",		1,	0,	OPT_memthrash },
 	{ "memthrash-method",	1,	0,	OPT_memthrash_method },
 	{ "memthrash-ops",	1,	0,	OPT_memthrash_ops },
+	{ "memthrash-threads",	1,	0,	OPT_memthrash_threads },
+	{ "memtier",		1,	0,	OPT_memtier },
+	{ "memtier-bytes",	1,	0,	OPT_memtier_bytes },
+	{ "memtier-hot",	1,	0,	OPT_memtier_hot },
+	{ "memtier-ops",	1,	0,	OPT_memtier_ops },
+	{ "memtier-wait",	1,	0,	OPT_memtier_wait },
 	{ "mergesort",		1,	0,	OPT_mergesort },
 	{ "mergesort-method",	1,	0,	OPT_mergesort_method },
 	{ "mergesort-ops",	1,	0,	OPT_mergesort_ops },
 	{ "mergesort-size",	1,	0,	OPT_mergesort_size },
+	{ "mergesort-threads",	1,	0,	OPT_mergesort_threads },
 	{ "metamix",		1,	0,	OPT_metamix },
         { "metamix-ops",	1,	0,	OPT_metamix_ops },
         { "metamix-bytes",	1,	0,	OPT_metamix_bytes },
 	{ "metrics",		0,	0,	OPT_metrics },
 	{ "metrics-brief",	0,	0,	OPT_metrics_brief },
+	{ "metrics-interval",	1,	0,	OPT_metrics_interval },
+	{ "metrics-interval-file",1,	0,	OPT_metrics_interval_file },
+	{ "metrics-listen",	1,	0,	OPT_metrics_listen },
 	{ "mincore",		1,	0,	OPT_mincore },
 	{ "mincore-ops",	1,	0,	OPT_mincore_ops },
 	{ "mincore-random",	0,	0,	OPT_mincore_rand },
@@ -572,12 +675,15 @@ const struct option stress_long_options[] = {
 	{ "min-nanosleep-max",	1,	0,	OPT_min_nanosleep_max },
 	{ "min-nanosleep-sched",1,	0,	OPT_min_nanosleep_sched },
 	{ "misaligned",		1,	0,	OPT_misaligned },
+	{ "misaligned-matrix",	0,	0,	OPT_misaligned_matrix },
 	{ "misaligned-method",	1,	0,	OPT_misaligned_method },
 	{ "misaligned-ops",	1,	0,	OPT_misaligned_ops },
 	{ "minimize",		0,	0,	OPT_minimize },
 	{ "mknod",		1,	0,	OPT_mknod },
 	{ "mknod-ops",		1,	0,	OPT_mknod_ops },
 	{ "mlock",		1,	0,	OPT_mlock },
+	{ "mlock-bytes",	1,	0,	OPT_mlock_bytes },
+	{ "mlock-method",	1,	0,	OPT_mlock_method },
 	{ "mlock-ops",		1,	0,	OPT_mlock_ops },
 	{ "mlockmany",		1,	0,	OPT_mlockmany },
 	{ "mlockmany-ops",	1,	0,	OPT_mlockmany_ops },
@@ -605,6 +711,8 @@ const struct option stress_long_options[] = {
 	{ "mmapfiles-numa",	0,	0,	OPT_mmapfiles_numa },
 	{ "mmapfiles-ops",	1,	0,	OPT_mmapfiles_ops },
 	{ "mmapfiles-populate",	0,	0,	OPT_mmapfiles_populate },
+	{ "mmapfiles-scan",	0,	0,	OPT_mmapfiles_scan },
+	{ "mmapfiles-scan-bytes",1,	0,	OPT_mmapfiles_scan_bytes },
 	{ "mmapfiles-shared",	0,	0,	OPT_mmapfiles_shared },
 	{ "mmapfixed",		1,	0,	OPT_mmapfixed},
 	{ "mmapfixed-mlock",	0,	0,	OPT_mmapfixed_mlock },
@@ -614,6 +722,7 @@ const struct option stress_long_options[] = {
 	{ "mmapfork-ops",	1,	0,	OPT_mmapfork_ops },
 	{ "mmapfork-bytes",	1,	0,	OPT_mmapfork_bytes},
 	{ "mmaphuge",		1,	0,	OPT_mmaphuge },
+	{ "mmaphuge-collapse",	0,	0,	OPT_mmaphuge_collapse },
 	{ "mmaphuge-file",	0,	0,	OPT_mmaphuge_file },
 	{ "mmaphuge-mlock",	0,	0,	OPT_mmaphuge_mlock },
 	{ "mmaphuge-mmaps",	1,	0,	OPT_mmaphuge_mmaps },
@@ -634,10 +743,12 @@ const struct option stress_long_options[] = {
 	{ "module-no-vermag",	0,	0,	OPT_module_no_vermag,},
 	{ "module-no-unload",	0,	0,	OPT_module_no_unload},
 	{ "monte-carlo",	1,	0,	OPT_monte_carlo },
+	{ "monte-carlo-batch",	0,	0,	OPT_monte_carlo_batch },
 	{ "monte-carlo-method",	1,	0,	OPT_monte_carlo_method },
 	{ "monte-carlo-ops",	1,	0,	OPT_monte_carlo_ops },
 	{ "monte-carlo-rand",	1,	0,	OPT_monte_carlo_rand },
 	{ "monte-carlo-samples",1,	0,	OPT_monte_carlo_samples },
+	{ "monte-carlo-threads",1,	0,	OPT_monte_carlo_threads },
 	{ "mprotect",		1,	0,	OPT_mprotect },
 	{ "mprotect-ops",	1,	0,	OPT_mprotect_ops },
 	{ "mpfr",		1,	0,	OPT_mpfr },
@@ -646,16 +757,20 @@ const struct option stress_long_options[] = {
 	{ "mq",			1,	0,	OPT_mq },
 	{ "mq-ops",		1,	0,	OPT_mq_ops },
 	{ "mq-size",		1,	0,	OPT_mq_size },
+	{ "mq-sweep",		0,	0,	OPT_mq_sweep },
 	{ "mremap",		1,	0,	OPT_mremap },
+	{ "mremap-bench",	0,	0,	OPT_mremap_bench },
 	{ "mremap-bytes",	1,	0,	OPT_mremap_bytes },
 	{ "mremap-mlock",	0,	0,	OPT_mremap_mlock },
 	{ "mremap-numa",	0,	0,	OPT_mremap_numa },
 	{ "mremap-ops",		1,	0,	OPT_mremap_ops },
+	{ "mremap-thp",		0,	0,	OPT_mremap_thp },
 	{ "mseal",		1,	0,	OPT_mseal },
 	{ "mseal-ops",		1,	0,	OPT_mseal_ops,},
 	{ "msg",		1,	0,	OPT_msg },
 	{ "msg-bytes",		1,	0,	OPT_msg_bytes },
 	{ "msg-ops",		1,	0,	OPT_msg_ops },
+	{ "msg-sweep",		0,	0,	OPT_msg_sweep },
 	{ "msg-types",		1,	0,	OPT_msg_types },
 	{ "msync",		1,	0,	OPT_msync },
 	{ "msync-bytes",	1,	0,	OPT_msync_bytes },
@@ -669,6 +784,7 @@ const struct option stress_long_options[] = {
 	{ "munmap-ops",		1,	0,	OPT_munmap_ops },
 	{ "mutex",		1,	0,	OPT_mutex },
 	{ "mutex-affinity",	0,	0,	OPT_mutex_affinity },
+	{ "mutex-bench",	0,	0,	OPT_mutex_bench },
 	{ "mutex-ops",		1,	0,	OPT_mutex_ops },
 	{ "mutex-procs",	1,	0,	OPT_mutex_procs },
 	{ "nanosleep",		1,	0,	OPT_nanosleep },
@@ -693,10 +809,13 @@ const struct option stress_long_options[] = {
 	{ "null-ops",		1,	0,	OPT_null_ops },
 	{ "null-write",		0,	0,	OPT_null_write },
 	{ "numa",		1,	0,	OPT_numa },
+	{ "numa-balance",	0,	0,	OPT_numa_balance },
 	{ "numa-bytes",		1,	0,	OPT_numa_bytes },
+	{ "numa-matrix",	0,	0,	OPT_numa_matrix },
 	{ "numa-ops",		1,	0,	OPT_numa_ops },
 	{ "numa-shuffle-addr",	0,	0,	OPT_numa_shuffle_addr },
 	{ "numa-shuffle-node",	0,	0,	OPT_numa_shuffle_node },
+	{ "offcpu",		0,	0,	OPT_offcpu },
 	{ "oomable",		0,	0,	OPT_oomable },
 	{ "oom-avoid",		0,	0,	OPT_oom_avoid },
 	{ "oom-avoid-bytes",	1,	0,	OPT_oom_avoid_bytes },
@@ -727,6 +846,7 @@ const struct option stress_long_options[] = {
 #if defined(STRESS_PERF_STATS) && 	\
     defined(HAVE_LINUX_PERF_EVENT_H)
 	{ "perf",		0,	0,	OPT_perf_stats },
+	{ "perf-sample",	1,	0,	OPT_perf_sample },
 #endif
 	{ "permute",		1,	0,	OPT_permute },
 	{ "personality",	1,	0,	OPT_personality },
@@ -748,10 +868,14 @@ const struct option stress_long_options[] = {
 #endif
 	{ "pipe-vmsplice",	0,	0,	OPT_pipe_vmsplice },
 	{ "pipeherd",		1,	0,	OPT_pipeherd },
+	{ "pipeherd-broadcast",	1,	0,	OPT_pipeherd_broadcast },
 	{ "pipeherd-ops",	1,	0,	OPT_pipeherd_ops },
+	{ "pipeherd-readers",	1,	0,	OPT_pipeherd_readers },
 	{ "pipeherd-yield", 	0,	0,	OPT_pipeherd_yield },
+	{ "pipeline-seq",	0,	0,	OPT_pipeline_seq },
 	{ "pkey",		1,	0,	OPT_pkey },
 	{ "pkey-ops",		1,	0,	OPT_pkey_ops },
+	{ "placement",		1,	0,	OPT_placement },
 	{ "plugin",		1,	0,	OPT_plugin },
 	{ "plugin-method",	1,	0,	OPT_plugin_method },
 	{ "plugin-ops",		1,	0,	OPT_plugin_ops },
@@ -769,11 +893,13 @@ const struct option stress_long_options[] = {
 	{ "prefetch-l3-size",	1,	0,	OPT_prefetch_l3_size },
 	{ "prefetch-method",	1,	0,	OPT_prefetch_method },
 	{ "prefetch-ops",	1,	0,	OPT_prefetch_ops },
+	{ "prefetch-sweep",	0,	0,	OPT_prefetch_sweep },
 	{ "prime",		1,	0,	OPT_prime },
 	{ "prime-method",	1,	0,	OPT_prime_method },
 	{ "prime-ops",		1,	0,	OPT_prime_ops },
 	{ "prime-progress",	0,	0,	OPT_prime_progress },
 	{ "prime-start",	1,	0,	OPT_prime_start },
+	{ "prime-threads",	1,	0,	OPT_prime_threads },
 	{ "prio-inv",		1,	0,	OPT_prio_inv },
 	{ "prio-inv-ops",	1,	0,	OPT_prio_inv_ops },
 	{ "prio-inv-policy",	1,	0,	OPT_prio_inv_policy },
@@ -782,17 +908,28 @@ const struct option stress_long_options[] = {
 	{ "priv-instr-ops",	1,	0,	OPT_priv_instr_ops },
 	{ "procfs",		1,	0,	OPT_procfs },
 	{ "procfs-ops",		1,	0,	OPT_procfs_ops },
+	{ "procfs-readers",	1,	0,	OPT_procfs_readers },
+	{ "proclat",		1,	0,	OPT_proclat },
+	{ "proclat-method",	1,	0,	OPT_proclat_method },
+	{ "proclat-ops",	1,	0,	OPT_proclat_ops },
+	{ "proclat-rss",	1,	0,	OPT_proclat_rss },
+	{ "probe-cache",	1,	0,	OPT_probe_cache },
 	{ "progress",		0,	0,	OPT_progress },
 	{ "pseek",		1,	0,	OPT_pseek },
 	{ "pseek-ops",		1,	0,	OPT_pseek_ops },
 	{ "pseek-rand",		0,	0,	OPT_pseek_rand },
 	{ "pseek-io-size",	1,	0,	OPT_pseek_io_size },
+	{ "psi",		0,	0,	OPT_psi },
 	{ "pthread",		1,	0,	OPT_pthread },
+	{ "pthread-bench",	0,	0,	OPT_pthread_bench },
 	{ "pthread-max",	1,	0,	OPT_pthread_max },
 	{ "pthread-ops",	1,	0,	OPT_pthread_ops },
 	{ "ptrace",		1,	0,	OPT_ptrace },
 	{ "ptrace-ops",		1,	0,	OPT_ptrace_ops },
 	{ "ptr-chase",		1,	0,	OPT_ptr_chase },
+	{ "ptr-chase-curve",	0,	0,	OPT_ptr_chase_curve },
+	{ "ptr-chase-hugepages",0,	0,	OPT_ptr_chase_hugepages },
+	{ "ptr-chase-max-size",	1,	0,	OPT_ptr_chase_max_size },
 	{ "ptr-chase-ops",	1,	0,	OPT_ptr_chase_ops },
 	{ "ptr-chase-pages",	1,	0,	OPT_ptr_chase_pages },
 	{ "pty",		1,	0,	OPT_pty },
@@ -802,6 +939,7 @@ const struct option stress_long_options[] = {
 	{ "qsort-method",	1,	0,	OPT_qsort_method },
 	{ "qsort-ops",		1,	0,	OPT_qsort_ops },
 	{ "qsort-size",		1,	0,	OPT_qsort_size },
+	{ "qsort-threads",	1,	0,	OPT_qsort_threads },
 	{ "quiet",		0,	0,	OPT_quiet },
 	{ "quota",		1,	0,	OPT_quota },
 	{ "quota-ops",		1,	0,	OPT_quota_ops },
@@ -819,6 +957,7 @@ const struct option stress_long_options[] = {
 	{ "randlist",		1,	0,	OPT_randlist },
 	{ "randlist-compact",	0,	0,	OPT_randlist_compact },
 	{ "randlist-items", 	1,	0,	OPT_randlist_items },
+	{ "randlist-layout",	1,	0,	OPT_randlist_layout },
 	{ "randlist-ops",	1,	0,	OPT_randlist_ops },
 	{ "randlist-size", 	1,	0,	OPT_randlist_size },
 	{ "random",		1,	0,	OPT_random },
@@ -826,11 +965,15 @@ const struct option stress_long_options[] = {
 	{ "raplstat",		1,	0,	OPT_raplstat },
 	{ "rawdev",		1,	0,	OPT_rawdev },
 	{ "rawdev-method",	1,	0,	OPT_rawdev_method },
+	{ "rawdev-mq",		0,	0,	OPT_rawdev_mq },
 	{ "rawdev-ops",		1,	0,	OPT_rawdev_ops },
 	{ "rawpkt",		1,	0,	OPT_rawpkt },
+	{ "rawpkt-batch",	1,	0,	OPT_rawpkt_batch },
 	{ "rawpkt-ops",		1,	0,	OPT_rawpkt_ops },
 	{ "rawpkt-port",	1,	0,	OPT_rawpkt_port },
 	{ "rawpkt-rxring",	1,	0,	OPT_rawpkt_rxring },
+	{ "rawpkt-txring",	1,	0,	OPT_rawpkt_txring },
+	{ "rawpkt-xdp",		0,	0,	OPT_rawpkt_xdp },
 	{ "rawsock",		1,	0,	OPT_rawsock },
 	{ "rawsock-ops",	1,	0,	OPT_rawsock_ops },
 	{ "rawsock-port",	1,	0,	OPT_rawsock_port },
@@ -840,13 +983,17 @@ const struct option stress_long_options[] = {
 	{ "rawudp-port",	1,	0,	OPT_rawudp_port },
 	{ "rdrand",		1,	0,	OPT_rdrand },
 	{ "rdrand-ops",		1,	0,	OPT_rdrand_ops },
+	{ "rdrand-scale",	0,	0,	OPT_rdrand_scale },
 	{ "rdrand-seed",	0,	0,	OPT_rdrand_seed },
 	{ "readahead",		1,	0,	OPT_readahead },
 	{ "readahead-bytes",	1,	0,	OPT_readahead_bytes },
+	{ "readahead-mode",	1,	0,	OPT_readahead_mode },
 	{ "readahead-ops",	1,	0,	OPT_readahead_ops },
 	{ "reboot",		1,	0,	OPT_reboot },
 	{ "reboot-ops",		1,	0,	OPT_reboot_ops },
 	{ "regex",		1,	0,	OPT_regex },
+	{ "regex-corpus",	1,	0,	OPT_regex_corpus },
+	{ "regex-file",		1,	0,	OPT_regex_file },
 	{ "regex-ops",		1,	0,	OPT_regex_ops },
 	{ "regs",		1,	0,	OPT_regs },
 	{ "regs-ops",		1,	0,	OPT_regs_ops },
@@ -856,8 +1003,12 @@ const struct option stress_long_options[] = {
 	{ "remap-pages",	1,	0,	OPT_remap_pages },
 	{ "rename",		1,	0,	OPT_rename },
 	{ "rename-ops",		1,	0,	OPT_rename_ops },
+	{ "repeat",		1,	0,	OPT_repeat },
+	{ "repeat-cov",		1,	0,	OPT_repeat_cov },
+	{ "repeat-warmup",	1,	0,	OPT_repeat_warmup },
 	{ "resched",		1,	0,	OPT_resched },
 	{ "resched-ops",	1,	0,	OPT_resched_ops },
+	{ "resctrl",		1,	0,	OPT_resctrl },
 	{ "resources",		1,	0,	OPT_resources },
 	{ "resources-mlock",	0,	0,	OPT_resources_mlock },
 	{ "resources-ops",	1,	0,	OPT_resources_ops },
@@ -878,9 +1029,12 @@ const struct option stress_long_options[] = {
 	{ "rotate-method",	1,	0,	OPT_rotate_method },
 	{ "rotate-ops",		1,	0,	OPT_rotate_ops },
 	{ "rseq",		1,	0,	OPT_rseq },
+	{ "rseq-bench",		0,	0,	OPT_rseq_bench },
 	{ "rseq-ops",		1,	0,	OPT_rseq_ops },
+	{ "rseq-threads",	1,	0,	OPT_rseq_threads },
 	{ "rtc",		1,	0,	OPT_rtc },
 	{ "rtc-ops",		1,	0,	OPT_rtc_ops },
+	{ "scale-sweep",	0,	0,	OPT_scale_sweep },
 	{ "sched",		1,	0,	OPT_sched },
 	{ "sched-deadline",	1,	0,	OPT_sched_deadline },
 	{ "sched-period",	1,	0,	OPT_sched_period },
@@ -889,22 +1043,29 @@ const struct option stress_long_options[] = {
 	{ "sched-runtime",	1,	0,	OPT_sched_runtime },
 	{ "schedmix",		1,	0,	OPT_schedmix },
 	{ "schedmix-ops",	1,	0,	OPT_schedmix_ops },
+	{ "schedmix-policy",	1,	0,	OPT_schedmix_policy },
 	{ "schedmix-procs",	1,	0,	OPT_schedmix_procs },
+	{ "schedmix-slice-us",	1,	0,	OPT_schedmix_slice_us },
 	{ "schedpolicy",	1,	0,	OPT_schedpolicy },
 	{ "schedpolicy-ops",	1,	0,	OPT_schedpolicy_ops },
 	{ "schedpolicy-rand",	0,	0,	OPT_schedpolicy_rand },
 	{ "sctp",		1,	0,	OPT_sctp },
 	{ "sctp-domain",	1,	0,	OPT_sctp_domain },
 	{ "sctp-if",		1,	0,	OPT_sctp_if },
+	{ "sctp-msg-size",	1,	0,	OPT_sctp_msg_size },
 	{ "sctp-ops",		1,	0,	OPT_sctp_ops },
 	{ "sctp-port",		1,	0,	OPT_sctp_port },
 	{ "sctp-sched",		1,	0,	OPT_sctp_sched },
+	{ "sctp-streams",	1,	0,	OPT_sctp_streams },
+	{ "sctp-style",		1,	0,	OPT_sctp_style },
 	{ "seal",		1,	0,	OPT_seal },
 	{ "seal-ops",		1,	0,	OPT_seal_ops },
 	{ "seccomp",		1,	0,	OPT_seccomp },
 	{ "seccomp-ops",	1,	0,	OPT_seccomp_ops },
 	{ "secretmem",		1,	0,	OPT_secretmem },
 	{ "secretmem-ops",	1,	0,	OPT_secretmem_ops },
+	{ "secretmem-probe",	0,	0,	OPT_secretmem_probe },
+	{ "secretmem-rate",	1,	0,	OPT_secretmem_rate },
 	{ "seed",		1,	0,	OPT_seed },
 	{ "seek",		1,	0,	OPT_seek },
 	{ "seek-ops",		1,	0,	OPT_seek_ops },
@@ -935,6 +1096,7 @@ const struct option stress_long_options[] = {
 	{ "shm-mlock",		0,	0,	OPT_shm_mlock },
 	{ "shm-objs",		1,	0,	OPT_shm_objs },
 	{ "shm-ops",		1,	0,	OPT_shm_ops },
+	{ "shm-ring",		1,	0,	OPT_shm_ring },
 	{ "shm-sysv",		1,	0,	OPT_shm_sysv },
 	{ "shm-sysv-bytes",	1,	0,	OPT_shm_sysv_bytes },
 	{ "shm-sysv-mlock",	0,	0,	OPT_shm_sysv_mlock },
@@ -948,6 +1110,7 @@ const struct option stress_long_options[] = {
 	{ "sigchld-ops",	1,	0,	OPT_sigchld_ops },
 	{ "sigfd",		1,	0,	OPT_sigfd },
 	{ "sigfd-ops",		1,	0,	OPT_sigfd_ops },
+	{ "sigfd-latency",	0,	0,	OPT_sigfd_latency },
 	{ "sighup",		1,	0,	OPT_sighup },
 	{ "sighup-ops",		1,	0,	OPT_sighup_ops },
 	{ "sigill",		1,	0,	OPT_sigill },
@@ -958,16 +1121,20 @@ const struct option stress_long_options[] = {
 	{ "sigfpe-ops",		1,	0,	OPT_sigfpe_ops },
 	{ "signal",		1,	0,	OPT_signal },
 	{ "signal-ops",		1,	0,	OPT_signal_ops },
+	{ "signal-latency",	0,	0,	OPT_signal_latency },
 	{ "signest",		1,	0,	OPT_signest },
 	{ "signest-ops",	1,	0,	OPT_signest_ops },
 	{ "sigpending",		1,	0,	OPT_sigpending},
 	{ "sigpending-ops",	1,	0,	OPT_sigpending_ops },
+	{ "sigpending-latency",	0,	0,	OPT_sigpending_latency },
 	{ "sigpipe",		1,	0,	OPT_sigpipe },
 	{ "sigpipe-ops",	1,	0,	OPT_sigpipe_ops },
 	{ "sigq",		1,	0,	OPT_sigq },
 	{ "sigq-ops",		1,	0,	OPT_sigq_ops },
+	{ "sigq-latency",	0,	0,	OPT_sigq_latency },
 	{ "sigrt",		1,	0,	OPT_sigrt },
 	{ "sigrt-ops",		1,	0,	OPT_sigrt_ops },
+	{ "sigrt-latency",	0,	0,	OPT_sigrt_latency },
 	{ "sigsegv",		1,	0,	OPT_sigsegv },
 	{ "sigsegv-ops",	1,	0,	OPT_sigsegv_ops },
 	{ "sigsuspend",		1,	0,	OPT_sigsuspend },
@@ -983,8 +1150,11 @@ const struct option stress_long_options[] = {
 	{ "sigxfsz",		1,	0,	OPT_sigxfsz },
 	{ "sigxfsz-ops",	1,	0,	OPT_sigxfsz_ops },
 	{ "skiplist",		1,	0,	OPT_skiplist },
+	{ "skiplist-insmix",	1,	0,	OPT_skiplist_insmix },
 	{ "skiplist-ops",	1,	0,	OPT_skiplist_ops },
+	{ "skiplist-rwmix",	1,	0,	OPT_skiplist_rwmix },
 	{ "skiplist-size",	1,	0,	OPT_skiplist_size },
+	{ "skiplist-threads",	1,	0,	OPT_skiplist_threads },
 	{ "skip-silent",	0,	0,	OPT_skip_silent },
 	{ "sleep",		1,	0,	OPT_sleep },
 	{ "sleep-max",		1,	0,	OPT_sleep_max },
@@ -995,6 +1165,7 @@ const struct option stress_long_options[] = {
 	{ "sn",			0,	0,	OPT_sn },
 	{ "sock",		1,	0,	OPT_sock },
 	{ "sock-domain",	1,	0,	OPT_sock_domain },
+	{ "sock-engine",	1,	0,	OPT_sock_engine },
 	{ "sock-if",		1,	0,	OPT_sock_if },
 	{ "sock-msgs",		1,	0,	OPT_sock_msgs },
 	{ "sock-nodelay",	0,	0,	OPT_sock_nodelay },
@@ -1002,21 +1173,35 @@ const struct option stress_long_options[] = {
 	{ "sock-opts",		1,	0,	OPT_sock_opts },
 	{ "sock-port",		1,	0,	OPT_sock_port },
 	{ "sock-protocol",	1,	0,	OPT_sock_protocol },
+	{ "sock-reuseport",	1,	0,	OPT_sock_reuseport },
+	{ "sock-reuseport-cbpf",0,	0,	OPT_sock_reuseport_cbpf },
+	{ "sock-reuseport-conns",1,	0,	OPT_sock_reuseport_conns },
+	{ "sock-reuseport-size",1,	0,	OPT_sock_reuseport_size },
+	{ "sock-rr",		1,	0,	OPT_sock_rr },
+	{ "sock-rr-client-cpu",	1,	0,	OPT_sock_rr_client_cpu },
+	{ "sock-rr-server-cpu",	1,	0,	OPT_sock_rr_server_cpu },
 	{ "sock-type",		1,	0,	OPT_sock_type },
 	{ "sock-zerocopy", 	0,	0,	OPT_sock_zerocopy },
+	{ "sock-zerocopy-window",1,	0,	OPT_sock_zerocopy_window },
 	{ "sockabuse",		1,	0,	OPT_sockabuse },
 	{ "sockabuse-ops",	1,	0,	OPT_sockabuse_ops },
 	{ "sockabuse-port",	1,	0,	OPT_sockabuse_port },
 	{ "sockdiag",		1,	0,	OPT_sockdiag },
 	{ "sockdiag-ops",	1,	0,	OPT_sockdiag_ops },
+	{ "sockdiag-sockets",	1,	0,	OPT_sockdiag_sockets },
 	{ "sockfd",		1,	0,	OPT_sockfd },
 	{ "sockfd-ops",		1,	0,	OPT_sockfd_ops },
 	{ "sockfd-port",	1,	0,	OPT_sockfd_port },
 	{ "sockfd-reuse",	0,	0,	OPT_sockfd_reuse },
 	{ "sockmany",		1,	0,	OPT_sockmany },
+	{ "sockmany-defer-accept",0,	0,	OPT_sockmany_defer_accept },
+	{ "sockmany-fastopen",	0,	0,	OPT_sockmany_fastopen },
 	{ "sockmany-if",	1,	0,	OPT_sockmany_if },
 	{ "sockmany-ops",	1,	0,	OPT_sockmany_ops },
 	{ "sockmany-port",	1,	0,	OPT_sockmany_port },
+	{ "sockmany-rate",	1,	0,	OPT_sockmany_rate },
+	{ "sockmany-reuseport",	1,	0,	OPT_sockmany_reuseport },
+	{ "sockmany-syncookies",0,	0,	OPT_sockmany_syncookies },
 	{ "sockpair",		1,	0,	OPT_sockpair },
 	{ "sockpair-ops",	1,	0,	OPT_sockpair_ops },
 	{ "softlockup",		1,	0,	OPT_softlockup },
@@ -1026,6 +1211,7 @@ const struct option stress_long_options[] = {
 	{ "sparsematrix-method",1,	0,	OPT_sparsematrix_method },
 	{ "sparsematrix-ops",	1,	0,	OPT_sparsematrix_ops },
 	{ "sparsematrix-size",	1,	0,	OPT_sparsematrix_size },
+	{ "sparsematrix-spmv",	1,	0,	OPT_sparsematrix_spmv },
 	{ "spawn",		1,	0,	OPT_spawn },
 	{ "spawn-ops",		1,	0,	OPT_spawn_ops },
 	{ "spinmem",		1,	0,	OPT_spinmem },
@@ -1049,14 +1235,19 @@ const struct option stress_long_options[] = {
 	{ "stderr",		0,	0,	OPT_stderr },
 	{ "stdout",		0,	0,	OPT_stdout },
 	{ "str",		1,	0,	OPT_str },
+	{ "str-hit",		1,	0,	OPT_str_hit },
 	{ "str-method",		1,	0,	OPT_str_method },
+	{ "str-sweep",		0,	0,	OPT_str_sweep },
 	{ "str-ops",		1,	0,	OPT_str_ops },
 	{ "stream",		1,	0,	OPT_stream },
 	{ "stream-index",	1,	0,	OPT_stream_index },
 	{ "stream-l3-size",	1,	0,	OPT_stream_l3_size },
 	{ "stream-madvise",	1,	0,	OPT_stream_madvise },
+	{ "stream-method",	1,	0,	OPT_stream_method },
 	{ "stream-mlock",	0,	0,	OPT_stream_mlock },
 	{ "stream-ops",		1,	0,	OPT_stream_ops },
+	{ "stream-parallel",	0,	0,	OPT_stream_parallel },
+	{ "stressor-cgroup",	1,	0,	OPT_stressor_cgroup },
 	{ "stressor-time",	0,	0,	OPT_stressor_time },
 	{ "stressors",		0,	0,	OPT_stressors },
 	{ "swap",		1,	0,	OPT_swap },
@@ -1064,6 +1255,7 @@ const struct option stress_long_options[] = {
 	{ "swap-self",		0,	0,	OPT_swap_self },
 	{ "switch",		1,	0,	OPT_switch },
 	{ "switch-freq",	1,	0,	OPT_switch_freq },
+	{ "switch-matrix",	0,	0,	OPT_switch_matrix },
 	{ "switch-method",	1,	0,	OPT_switch_method },
 	{ "switch-ops",		1,	0,	OPT_switch_ops },
 	{ "symlink",		1,	0,	OPT_symlink },
@@ -1072,7 +1264,11 @@ const struct option stress_long_options[] = {
 	{ "sync-file",		1,	0,	OPT_sync_file },
 	{ "sync-file-bytes", 	1,	0,	OPT_sync_file_bytes },
 	{ "sync-file-ops", 	1,	0,	OPT_sync_file_ops },
+	{ "sync-file-per-writer",0,	0,	OPT_sync_file_per_writer },
+	{ "sync-file-record",	1,	0,	OPT_sync_file_record },
+	{ "sync-file-writers",	1,	0,	OPT_sync_file_writers },
 	{ "sync-start",		0,	0,	OPT_sync_start },
+	{ "sync-start-at",	1,	0,	OPT_sync_start_at },
 	{ "syncload",		1,	0,	OPT_syncload },
 	{ "syncload-msbusy",	1,	0,	OPT_syncload_msbusy },
 	{ "syncload-mssleep",	1,	0,	OPT_syncload_mssleep },
@@ -1080,6 +1276,8 @@ const struct option stress_long_options[] = {
 	{ "sysbadaddr",		1,	0,	OPT_sysbadaddr },
 	{ "sysbadaddr-ops",	1,	0,	OPT_sysbadaddr_ops },
 	{ "syscall",		1,	0,	OPT_syscall },
+	{ "syscall-latency",	0,	0,	OPT_syscall_latency },
+	{ "syscall-latency-yaml",1,	0,	OPT_syscall_latency_yaml },
 	{ "syscall-method",	1,	0,	OPT_syscall_method },
 	{ "syscall-ops",	1,	0,	OPT_syscall_ops },
 	{ "syscall-top",	1,	0,	OPT_syscall_top },
@@ -1092,6 +1290,8 @@ const struct option stress_long_options[] = {
 #if defined(HAVE_SYSLOG_H)
 	{ "syslog",		0,	0,	OPT_syslog },
 #endif
+	{ "target-power",	1,	0,	OPT_target_power },
+	{ "target-util",	1,	0,	OPT_target_util },
 	{ "taskset",		1,	0,	OPT_taskset },
 	{ "taskset-random",	0,	0,	OPT_taskset_random },
 	{ "tee",		1,	0,	OPT_tee },
@@ -1112,6 +1312,7 @@ const struct option stress_long_options[] = {
 	{ "time-warp-ops",	1,	0,	OPT_time_warp_ops },
 	{ "tlb-shootdown",	1,	0,	OPT_tlb_shootdown },
 	{ "tlb-shootdown-ops",	1,	0,	OPT_tlb_shootdown_ops },
+	{ "tlb-shootdown-sweep",	0,	0,	OPT_tlb_shootdown_sweep },
 	{ "tmpfs",		1,	0,	OPT_tmpfs },
 	{ "tmpfs-mmap-async",	0,	0,	OPT_tmpfs_mmap_async },
 	{ "tmpfs-mmap-file",	0,	0,	OPT_tmpfs_mmap_file },
@@ -1131,24 +1332,33 @@ const struct option stress_long_options[] = {
 	{ "tsc-lfence",		0,	0,	OPT_tsc_lfence },
 	{ "tsc-ops",		1,	0,	OPT_tsc_ops },
 	{ "tsc-rdtscp",		0,	0,	OPT_tsc_rdtscp },
+	{ "tsc-skew",		0,	0,	OPT_tsc_skew },
 	{ "tsearch",		1,	0,	OPT_tsearch },
 	{ "tsearch-ops",	1,	0,	OPT_tsearch_ops },
 	{ "tsearch-size",	1,	0,	OPT_tsearch_size },
 	{ "thermalstat",	1,	0,	OPT_thermalstat },
+	{ "thp",		1,	0,	OPT_thp },
 	{ "thrash",		0,	0,	OPT_thrash },
 	{ "times",		0,	0,	OPT_times },
 	{ "timestamp",		0,	0,	OPT_timestamp },
 	{ "tz",			0,	0,	OPT_thermal_zones },
 	{ "tun",		1,	0,	OPT_tun},
+	{ "tun-gso",		1,	0,	OPT_tun_gso },
+	{ "tun-queues",		1,	0,	OPT_tun_queues },
 	{ "tun-tap",		0,	0,	OPT_tun_tap },
 	{ "tun-ops",		1,	0,	OPT_tun_ops },
 	{ "udp",		1,	0,	OPT_udp },
+	{ "udp-batch",		1,	0,	OPT_udp_batch },
 	{ "udp-domain",		1,	0,	OPT_udp_domain },
 	{ "udp-gro",		0,	0,	OPT_udp_gro },
+	{ "udp-gso",		1,	0,	OPT_udp_gso },
 	{ "udp-if",		1,	0,	OPT_udp_if },
 	{ "udp-lite",		0,	0,	OPT_udp_lite },
 	{ "udp-ops",		1,	0,	OPT_udp_ops },
 	{ "udp-port",		1,	0,	OPT_udp_port },
+	{ "udp-rr",		1,	0,	OPT_udp_rr },
+	{ "udp-rr-client-cpu",	1,	0,	OPT_udp_rr_client_cpu },
+	{ "udp-rr-server-cpu",	1,	0,	OPT_udp_rr_server_cpu },
 	{ "udp-flood",		1,	0,	OPT_udp_flood },
 	{ "udp-flood-domain",	1,	0,	OPT_udp_flood_domain },
 	{ "udp-flood-if",	1,	0,	OPT_udp_flood_if },
@@ -1166,16 +1376,21 @@ const struct option stress_long_options[] = {
 	{ "urandom",		1,	0,	OPT_urandom },
 	{ "urandom-ops",	1,	0,	OPT_urandom_ops },
 	{ "userfaultfd",	1,	0,	OPT_userfaultfd },
+	{ "userfaultfd-batch",	1,	0,	OPT_userfaultfd_batch },
 	{ "userfaultfd-bytes",	1,	0,	OPT_userfaultfd_bytes },
+	{ "userfaultfd-mode",	1,	0,	OPT_userfaultfd_mode },
 	{ "userfaultfd-ops",	1,	0,	OPT_userfaultfd_ops },
+	{ "userfaultfd-threads",1,	0,	OPT_userfaultfd_threads },
 	{ "usersyscall",	1,	0,	OPT_usersyscall },
 	{ "usersyscall-ops",	1,	0,	OPT_usersyscall_ops },
 	{ "utime",		1,	0,	OPT_utime },
 	{ "utime-fsync",	0,	0,	OPT_utime_fsync },
 	{ "utime-ops",		1,	0,	OPT_utime_ops },
 	{ "vdso",		1,	0,	OPT_vdso },
+	{ "vdso-clocksources", 0,	0,	OPT_vdso_clocksources },
 	{ "vdso-func",		1,	0,	OPT_vdso_func },
 	{ "vdso-ops",		1,	0,	OPT_vdso_ops },
+	{ "vdso-timing",	0,	0,	OPT_vdso_timing },
 	{ "veccmp",		1,	0,	OPT_veccmp},
 	{ "veccmp-ops",		1,	0,	OPT_veccmp_ops },
 	{ "vecfp",		1,	0,	OPT_vecfp },
@@ -1215,6 +1430,7 @@ const struct option stress_long_options[] = {
 #if defined(MAP_POPULATE)
 	{ "vm-populate",	0,	0,	OPT_vm_populate },
 #endif
+	{ "vm-threads",		1,	0,	OPT_vm_threads },
 	{ "vm-addr",		1,	0,	OPT_vm_addr },
 	{ "vm-addr-method",	1,	0,	OPT_vm_addr_method },
 	{ "vm-addr-mlock",	0,	0,	OPT_vm_addr_mlock },
@@ -1223,6 +1439,7 @@ const struct option stress_long_options[] = {
 	{ "vm-rw",		1,	0,	OPT_vm_rw },
 	{ "vm-rw-bytes",	1,	0,	OPT_vm_rw_bytes },
 	{ "vm-rw-ops",		1,	0,	OPT_vm_rw_ops },
+	{ "vm-rw-sweep",	0,	0,	OPT_vm_rw_sweep },
 	{ "vm-segv",		1,	0,	OPT_vm_segv },
 	{ "vm-segv-ops",	1,	0,	OPT_vm_segv_ops },
 	{ "vm-splice",		1,	0,	OPT_vm_splice },
@@ -1236,17 +1453,22 @@ const struct option stress_long_options[] = {
 	{ "vnni-intrinsic",	0,	0,	OPT_vnni_intrinsic },
 	{ "vnni-method",	1,	0,	OPT_vnni_method },
 	{ "vnni-ops",		1,	0,	OPT_vnni_ops },
+	{ "vnni-width-report",	0,	0,	OPT_vnni_width_report },
 	{ "wait",		1,	0,	OPT_wait },
 	{ "wait-ops",		1,	0,	OPT_wait_ops },
 	{ "waitcpu",		1,	0,	OPT_waitcpu },
 	{ "waitcpu-ops",	1,	0,	OPT_waitcpu_ops },
+	{ "warmup",		1,	0,	OPT_warmup },
 	{ "watchdog",		1,	0,	OPT_watchdog },
 	{ "watchdog-ops",	1,	0,	OPT_watchdog_ops },
 	{ "with",		1,	0,	OPT_with },
 	{ "wcs",		1,	0,	OPT_wcs},
+	{ "wcs-hit",		1,	0,	OPT_wcs_hit },
 	{ "wcs-method",		1,	0,	OPT_wcs_method },
+	{ "wcs-sweep",		0,	0,	OPT_wcs_sweep },
 	{ "wcs-ops",		1,	0,	OPT_wcs_ops },
 	{ "workload",		1,	0,	OPT_workload },
+	{ "workload-deadline-us", 1,	0,	OPT_workload_deadline_us },
 	{ "workload-dist",	1,	0,	OPT_workload_dist },
 	{ "workload-load",	1,	0,	OPT_workload_load },
 	{ "workload-method",	1,	0,	OPT_workload_method },
@@ -1255,6 +1477,7 @@ const struct option stress_long_options[] = {
 	{ "workload-sched",	1,	0,	OPT_workload_sched },
 	{ "workload-slice-us",	1,	0,	OPT_workload_slice_us },
 	{ "workload-threads",	1,	0,	OPT_workload_threads },
+	{ "workload-trace",	1,	0,	OPT_workload_trace },
 	{ "x86cpuid",		1,	0,	OPT_x86cpuid },
 	{ "x86cpuid-ops",	1,	0,	OPT_x86cpuid_ops },
 	{ "x86syscall",		1,	0,	OPT_x86syscall },
@@ -1270,11 +1493,18 @@ const struct option stress_long_options[] = {
 	{ "zero",		1,	0,	OPT_zero },
 	{ "zero-ops",		1,	0,	OPT_zero_ops },
 	{ "zero-read",		0,	0,	OPT_zero_read },
+	{ "zerocopy",		1,	0,	OPT_zerocopy },
+	{ "zerocopy-bytes",	1,	0,	OPT_zerocopy_bytes },
+	{ "zerocopy-if",	1,	0,	OPT_zerocopy_if },
+	{ "zerocopy-method",	1,	0,	OPT_zerocopy_method },
+	{ "zerocopy-ops",	1,	0,	OPT_zerocopy_ops },
+	{ "zerocopy-port",	1,	0,	OPT_zerocopy_port },
 	{ "zlib",		1,	0,	OPT_zlib },
 	{ "zlib-level",		1,	0,	OPT_zlib_level },
 	{ "zlib-method",	1,	0,	OPT_zlib_method },
 	{ "zlib-mem-level",	1,	0,	OPT_zlib_mem_level },
 	{ "zlib-ops",		1,	0,	OPT_zlib_ops },
+	{ "zlib-parallel",	1,	0,	OPT_zlib_parallel },
 	{ "zlib-strategy",	1,	0,	OPT_zlib_strategy, },
 	{ "zlib-stream-bytes",	1,	0,	OPT_zlib_stream_bytes, },
 	{ "zlib-window-bits",	1,	0,	OPT_zlib_window_bits },
@@ -88,6 +88,10 @@
 #define OPT_FLAGS_C_STATES	 STRESS_BIT_ULL(57)	/* --c-states */
 #define OPT_FLAGS_STRESSOR_TIME	 STRESS_BIT_ULL(58)	/* --stressor-time */
 #define OPT_FLAGS_TASKSET_RANDOM STRESS_BIT_ULL(59)	/* --taskset-random */
+#define OPT_FLAGS_LATENCY	 STRESS_BIT_ULL(60)	/* --latency */
+#define OPT_FLAGS_INSTANCE_THREADS STRESS_BIT_ULL(61)	/* --instance-threads */
+#define OPT_FLAGS_SCALE_SWEEP	 STRESS_BIT_ULL(62)	/* --scale-sweep */
+#define OPT_FLAGS_THROTTLE	 STRESS_BIT_ULL(63)	/* --target-power, --target-util */
 
 #define OPT_FLAGS_MINMAX_MASK		\
 	(OPT_FLAGS_MINIMIZE | OPT_FLAGS_MAXIMIZE)
@@ -99,6 +103,9 @@
 	 OPT_FLAGS_AGGRESSIVE |		\
 	 OPT_FLAGS_IGNITE_CPU)
 
+/* getopt_long short options */
+#define STRESS_SHORT_OPTIONS	"?kKhMVvqnt:b:c:i:j:m:d:f:s:l:p:P:C:S:a:y:F:D:T:u:o:r:B:R:w:x:Y:"
+
 extern const struct option stress_long_options[];
 
 /* Command line long options */
@@ -162,8 +169,11 @@ typedef enum {
 	OPT_affinity_rand,
 	OPT_affinity_sleep,
 
+	OPT_agent,
+
 	OPT_af_alg,
 	OPT_af_alg_ops,
+	OPT_af_alg_bench,
 	OPT_af_alg_dump,
 
 	OPT_aggressive,
@@ -173,6 +183,9 @@ typedef enum {
 	OPT_aio_requests,
 
 	OPT_aiol,
+	OPT_aiol_batch,
+	OPT_aiol_eventfd,
+	OPT_aiol_min_nr,
 	OPT_aiol_ops,
 	OPT_aiol_requests,
 
@@ -209,6 +222,7 @@ typedef enum {
 
 	OPT_bitonicsort,
 	OPT_bitonicsort_ops,
+	OPT_bitonicsort_method,
 	OPT_bitonicsort_size,
 
 	OPT_bitops,
@@ -217,6 +231,7 @@ typedef enum {
 
 	OPT_branch,
 	OPT_branch_ops,
+	OPT_branch_sweep,
 
 	OPT_brk,
 	OPT_brk_bytes,
@@ -235,8 +250,10 @@ typedef enum {
 	OPT_bubblesort_size,
 
 	OPT_c_states,
+	OPT_c_states_affinity,
 
 	OPT_class,
+	OPT_cluster_token,
 
 	OPT_cache_ops,
 	OPT_cache_size,
@@ -259,6 +276,7 @@ typedef enum {
 	OPT_cacheline,
 	OPT_cacheline_ops,
 	OPT_cacheline_affinity,
+	OPT_cacheline_c2c,
 	OPT_cacheline_method,
 
 	OPT_cap,
@@ -295,16 +313,24 @@ typedef enum {
 	OPT_close,
 	OPT_close_ops,
 
+	OPT_compare,
+	OPT_compare_threshold,
+
 	OPT_context,
 	OPT_context_ops,
 
+	OPT_coordinate,
+
 	OPT_config,
 
 	OPT_copy_file,
 	OPT_copy_file_ops,
 	OPT_copy_file_bytes,
+	OPT_copy_file_cross_dir,
+	OPT_copy_file_sweep,
 
 	OPT_cpu_ops,
+	OPT_cpu_fft_sweep,
 	OPT_cpu_method,
 	OPT_cpu_load_slice,
 	OPT_cpu_old_metrics,
@@ -312,6 +338,7 @@ typedef enum {
 	OPT_cpu_online,
 	OPT_cpu_online_affinity,
 	OPT_cpu_online_all,
+	OPT_cpu_online_latency,
 	OPT_cpu_online_ops,
 
 	OPT_cpu_sched,
@@ -347,6 +374,7 @@ typedef enum {
 
 	OPT_dentry_ops,
 	OPT_dentries,
+	OPT_dentry_mdtest,
 	OPT_dentry_order,
 
 	OPT_dev,
@@ -388,6 +416,7 @@ typedef enum {
 	OPT_eigen_ops,
 	OPT_eigen_method,
 	OPT_eigen_size,
+	OPT_eigen_threads,
 
 	OPT_efivar,
 	OPT_efivar_ops,
@@ -400,9 +429,13 @@ typedef enum {
 
 	OPT_epoll,
 	OPT_epoll_ops,
+	OPT_epoll_busy_poll,
+	OPT_epoll_busy_poll_budget,
 	OPT_epoll_port,
 	OPT_epoll_domain,
+	OPT_epoll_exclusive,
 	OPT_epoll_sockets,
+	OPT_epoll_waiters,
 
 	OPT_eventfd,
 	OPT_eventfd_ops,
@@ -410,10 +443,12 @@ typedef enum {
 
 	OPT_exec,
 	OPT_exec_ops,
+	OPT_exec_cold,
 	OPT_exec_max,
 	OPT_exec_method,
 	OPT_exec_fork_method,
 	OPT_exec_no_pthread,
+	OPT_exec_prog,
 
 	OPT_exit_group,
 	OPT_exit_group_ops,
@@ -428,6 +463,10 @@ typedef enum {
 
 	OPT_fallocate_ops,
 	OPT_fallocate_bytes,
+	OPT_fallocate_chunk,
+	OPT_fallocate_mode,
+	OPT_fallocate_shared,
+	OPT_fallocate_threads,
 
 	OPT_fanotify,
 	OPT_fanotify_ops,
@@ -436,6 +475,7 @@ typedef enum {
 	OPT_far_branch_flush,
 	OPT_far_branch_ops,
 	OPT_far_branch_pages,
+	OPT_far_branch_sweep,
 
 	OPT_fault,
 	OPT_fault_ops,
@@ -483,11 +523,14 @@ typedef enum {
 	OPT_flock_ops,
 
 	OPT_flushcache,
+	OPT_flushcache_dax,
+	OPT_flushcache_dax_size,
 	OPT_flushcache_ops,
 
 	OPT_fma,
 	OPT_fma_ops,
 	OPT_fma_libc,
+	OPT_fma_peak,
 
 	OPT_fork_max,
 	OPT_fork_ops,
@@ -527,6 +570,7 @@ typedef enum {
 	OPT_fstat_dir,
 
 	OPT_ftrace,
+	OPT_ftrace_raw,
 
 	OPT_full,
 	OPT_full_ops,
@@ -541,6 +585,10 @@ typedef enum {
 
 	OPT_futex,
 	OPT_futex_ops,
+	OPT_futex_method,
+	OPT_futex_waitv,
+	OPT_futex_waiter_cpu,
+	OPT_futex_waker_cpu,
 
 	OPT_get,
 	OPT_get_ops,
@@ -570,22 +618,39 @@ typedef enum {
 
 	OPT_hash,
 	OPT_hash_ops,
+	OPT_hash_bulk,
 	OPT_hash_method,
 
+	OPT_hashmap,
+	OPT_hashmap_ops,
+	OPT_hashmap_method,
+	OPT_hashmap_rwmix,
+	OPT_hashmap_size,
+	OPT_hashmap_threads,
+	OPT_hashmap_zipf,
+
+	OPT_hdd_bs_sweep,
 	OPT_hdd_bytes,
+	OPT_hdd_engine,
+	OPT_hdd_iodepth,
 	OPT_hdd_write_size,
 	OPT_hdd_ops,
 	OPT_hdd_opts,
+	OPT_hdd_rwmix,
 
 	OPT_heapsort,
 	OPT_heapsort_method,
 	OPT_heapsort_ops,
 	OPT_heapsort_size,
+	OPT_heapsort_threads,
 
 	OPT_hrtimers,
 	OPT_hrtimers_ops,
 	OPT_hrtimers_adjust,
 
+	OPT_hugetlb,
+	OPT_hugetlb_size,
+
 	OPT_hsearch,
 	OPT_hsearch_method,
 	OPT_hsearch_ops,
@@ -604,9 +669,16 @@ typedef enum {
 
 	OPT_idle_page,
 	OPT_idle_page_ops,
+	OPT_idle_page_wss,
+	OPT_idle_page_wss_interval,
+	OPT_idle_page_wss_pid,
 
 	OPT_ignite_cpu,
 
+	OPT_instance_threads,
+
+	OPT_interference,
+
 	OPT_interrupts,
 
 	OPT_inode_flags,
@@ -627,6 +699,7 @@ typedef enum {
 	OPT_iomix,
 	OPT_iomix_bytes,
 	OPT_iomix_ops,
+	OPT_iomix_profile,
 
 	OPT_ioport,
 	OPT_ioport_ops,
@@ -639,13 +712,20 @@ typedef enum {
 	OPT_ioprio_ops,
 
 	OPT_iostat,
+	OPT_iostat_yaml,
 
 	OPT_io_ops,
 
 	OPT_io_uring,
+	OPT_io_uring_batch,
+	OPT_io_uring_depth,
 	OPT_io_uring_entries,
+	OPT_io_uring_fixed,
 	OPT_io_uring_ops,
 	OPT_io_uring_rand,
+	OPT_io_uring_sqpoll,
+	OPT_io_uring_sqpoll_cpu,
+	OPT_io_uring_taskrun,
 
 	OPT_ipsec_mb,
 	OPT_ipsec_mb_ops,
@@ -662,9 +742,13 @@ typedef enum {
 	OPT_jpeg_ops,
 	OPT_jpeg_height,
 	OPT_jpeg_image,
+	OPT_jpeg_pipeline,
+	OPT_jpeg_producers,
 	OPT_jpeg_width,
 	OPT_jpeg_quality,
 
+	OPT_json,
+
 	OPT_judy,
 	OPT_judy_ops,
 	OPT_judy_size,
@@ -686,9 +770,12 @@ typedef enum {
 	OPT_ksm,
 
 	OPT_kvm,
+	OPT_kvm_exit,
 	OPT_kvm_ops,
+	OPT_kvm_vcpus,
 
 	OPT_l1cache,
+	OPT_l1cache_bandwidth,
 	OPT_l1cache_line_size,
 	OPT_l1cache_method,
 	OPT_l1cache_mlock,
@@ -700,6 +787,9 @@ typedef enum {
 	OPT_landlock,
 	OPT_landlock_ops,
 
+	OPT_latency,
+	OPT_launchers,
+
 	OPT_lease,
 	OPT_lease_ops,
 	OPT_lease_breakers,
@@ -707,12 +797,21 @@ typedef enum {
 	OPT_led,
 	OPT_led_ops,
 
+	OPT_lfqueue,
+	OPT_lfqueue_ops,
+	OPT_lfqueue_consumers,
+	OPT_lfqueue_method,
+	OPT_lfqueue_placement,
+	OPT_lfqueue_producers,
+	OPT_lfqueue_size,
+
 	OPT_link,
 	OPT_link_ops,
 	OPT_link_sync,
 
 	OPT_list,
 	OPT_list_ops,
+	OPT_list_layout,
 	OPT_list_method,
 	OPT_list_size,
 
@@ -729,6 +828,7 @@ typedef enum {
 	OPT_lockbus,
 	OPT_lockbus_ops,
 	OPT_lockbus_nosplit,
+	OPT_lockbus_victim,
 
 	OPT_locka,
 	OPT_locka_ops,
@@ -743,6 +843,8 @@ typedef enum {
 	OPT_lockofd,
 	OPT_lockofd_ops,
 
+	OPT_lock_type,
+
 	OPT_log_brief,
 	OPT_log_file,
 	OPT_log_lockless,
@@ -768,15 +870,19 @@ typedef enum {
 	OPT_madvise,
 	OPT_madvise_ops,
 	OPT_madvise_hwpoison,
+	OPT_madvise_prefault,
+	OPT_madvise_prefault_bytes,
 
 	OPT_mbind,
 
 	OPT_malloc,
 	OPT_malloc_ops,
+	OPT_malloc_allocator,
 	OPT_malloc_bytes,
 	OPT_malloc_max,
 	OPT_malloc_mlock,
 	OPT_malloc_pthreads,
+	OPT_malloc_sizes,
 	OPT_malloc_threshold,
 	OPT_malloc_touch,
 	OPT_malloc_trim,
@@ -784,6 +890,7 @@ typedef enum {
 
 	OPT_matrix,
 	OPT_matrix_ops,
+	OPT_matrix_gemm_threads,
 	OPT_matrix_size,
 	OPT_matrix_method,
 	OPT_matrix_yx,
@@ -803,10 +910,13 @@ typedef enum {
 
 	OPT_membarrier,
 	OPT_membarrier_ops,
+	OPT_membarrier_sweep,
+	OPT_membarrier_sweep_threads,
 
 	OPT_memcpy,
 	OPT_memcpy_ops,
 	OPT_memcpy_method,
+	OPT_memcpy_sweep,
 
 	OPT_memfd,
 	OPT_memfd_bytes,
@@ -832,17 +942,28 @@ typedef enum {
 	OPT_memthrash,
 	OPT_memthrash_ops,
 	OPT_memthrash_method,
+	OPT_memthrash_threads,
+
+	OPT_memtier,
+	OPT_memtier_ops,
+	OPT_memtier_bytes,
+	OPT_memtier_hot,
+	OPT_memtier_wait,
 
 	OPT_mergesort,
 	OPT_mergesort_method,
 	OPT_mergesort_ops,
 	OPT_mergesort_size,
+	OPT_mergesort_threads,
 
 	OPT_metamix,
 	OPT_metamix_ops,
 	OPT_metamix_bytes,
 
 	OPT_metrics_brief,
+	OPT_metrics_interval,
+	OPT_metrics_interval_file,
+	OPT_metrics_listen,
 
 	OPT_mincore,
 	OPT_mincore_ops,
@@ -855,6 +976,7 @@ typedef enum {
 
 	OPT_misaligned,
 	OPT_misaligned_ops,
+	OPT_misaligned_matrix,
 	OPT_misaligned_method,
 
 	OPT_mknod,
@@ -863,6 +985,8 @@ typedef enum {
 	OPT_minimize,
 
 	OPT_mlock,
+	OPT_mlock_bytes,
+	OPT_mlock_method,
 	OPT_mlock_ops,
 
 	OPT_mlockmany,
@@ -894,6 +1018,8 @@ typedef enum {
 	OPT_mmapfiles_numa,
 	OPT_mmapfiles_ops,
 	OPT_mmapfiles_populate,
+	OPT_mmapfiles_scan,
+	OPT_mmapfiles_scan_bytes,
 	OPT_mmapfiles_shared,
 
 	OPT_mmapfixed,
@@ -906,6 +1032,7 @@ typedef enum {
 	OPT_mmapfork_bytes,
 
 	OPT_mmaphuge,
+	OPT_mmaphuge_collapse,
 	OPT_mmaphuge_file,
 	OPT_mmaphuge_mlock,
 	OPT_mmaphuge_mmaps,
@@ -934,6 +1061,8 @@ typedef enum {
 	OPT_monte_carlo_ops,
 	OPT_monte_carlo_rand,
 	OPT_monte_carlo_samples,
+	OPT_monte_carlo_batch,
+	OPT_monte_carlo_threads,
 
 	OPT_mprotect,
 	OPT_mprotect_ops,
@@ -945,12 +1074,15 @@ typedef enum {
 	OPT_mq,
 	OPT_mq_ops,
 	OPT_mq_size,
+	OPT_mq_sweep,
 
 	OPT_mremap,
 	OPT_mremap_ops,
+	OPT_mremap_bench,
 	OPT_mremap_bytes,
 	OPT_mremap_mlock,
 	OPT_mremap_numa,
+	OPT_mremap_thp,
 
 	OPT_mseal,
 	OPT_mseal_ops,
@@ -958,6 +1090,7 @@ typedef enum {
 	OPT_msg,
 	OPT_msg_bytes,
 	OPT_msg_ops,
+	OPT_msg_sweep,
 	OPT_msg_types,
 
 	OPT_msync,
@@ -977,6 +1110,7 @@ typedef enum {
 	OPT_mutex,
 	OPT_mutex_ops,
 	OPT_mutex_affinity,
+	OPT_mutex_bench,
 	OPT_mutex_procs,
 
 	OPT_nanosleep,
@@ -1009,11 +1143,17 @@ typedef enum {
 	OPT_null_write,
 
 	OPT_numa,
+	OPT_numa_balance,
 	OPT_numa_bytes,
+	OPT_numa_matrix,
 	OPT_numa_ops,
 	OPT_numa_shuffle_addr,
 	OPT_numa_shuffle_node,
 
+	OPT_mem_footprint,
+
+	OPT_offcpu,
+
 	OPT_oomable,
 	OPT_oom_avoid,
 	OPT_oom_avoid_bytes,
@@ -1049,6 +1189,7 @@ typedef enum {
 	OPT_pci_ops,
 	OPT_pci_ops_rate,
 
+	OPT_perf_sample,
 	OPT_perf_stats,
 
 	OPT_permute,
@@ -1075,12 +1216,16 @@ typedef enum {
 	OPT_pipe_vmsplice,
 
 	OPT_pipeherd,
+	OPT_pipeherd_broadcast,
 	OPT_pipeherd_ops,
+	OPT_pipeherd_readers,
 	OPT_pipeherd_yield,
 
 	OPT_pkey,
 	OPT_pkey_ops,
 
+	OPT_placement,
+
 	OPT_plugin,
 	OPT_plugin_ops,
 	OPT_plugin_method,
@@ -1098,6 +1243,7 @@ typedef enum {
 	OPT_prefetch_l3_size,
 	OPT_prefetch_method,
 	OPT_prefetch_ops,
+	OPT_prefetch_sweep,
 
 	OPT_prctl,
 	OPT_prctl_ops,
@@ -1107,6 +1253,7 @@ typedef enum {
 	OPT_prime_ops,
 	OPT_prime_progress,
 	OPT_prime_start,
+	OPT_prime_threads,
 
 	OPT_prio_inv,
 	OPT_prio_inv_ops,
@@ -1118,9 +1265,19 @@ typedef enum {
 
 	OPT_procfs,
 	OPT_procfs_ops,
+	OPT_procfs_readers,
+
+	OPT_proclat,
+	OPT_proclat_method,
+	OPT_proclat_ops,
+	OPT_proclat_rss,
+
+	OPT_probe_cache,
 
 	OPT_progress,
 
+	OPT_psi,
+
 	OPT_pseek,
 	OPT_pseek_ops,
 	OPT_pseek_rand,
@@ -1128,12 +1285,16 @@ typedef enum {
 
 	OPT_pthread,
 	OPT_pthread_ops,
+	OPT_pthread_bench,
 	OPT_pthread_max,
 
 	OPT_ptrace,
 	OPT_ptrace_ops,
 
 	OPT_ptr_chase,
+	OPT_ptr_chase_curve,
+	OPT_ptr_chase_hugepages,
+	OPT_ptr_chase_max_size,
 	OPT_ptr_chase_ops,
 	OPT_ptr_chase_pages,
 
@@ -1145,6 +1306,7 @@ typedef enum {
 	OPT_qsort_ops,
 	OPT_qsort_size,
 	OPT_qsort_method,
+	OPT_qsort_threads,
 
 	OPT_quota,
 	OPT_quota_ops,
@@ -1162,6 +1324,7 @@ typedef enum {
 	OPT_randlist_ops,
 	OPT_randlist_compact,
 	OPT_randlist_items,
+	OPT_randlist_layout,
 	OPT_randlist_size,
 
 	OPT_rapl,
@@ -1174,12 +1337,16 @@ typedef enum {
 
 	OPT_rawdev,
 	OPT_rawdev_method,
+	OPT_rawdev_mq,
 	OPT_rawdev_ops,
 
 	OPT_rawpkt,
 	OPT_rawpkt_ops,
+	OPT_rawpkt_batch,
 	OPT_rawpkt_port,
 	OPT_rawpkt_rxring,
+	OPT_rawpkt_txring,
+	OPT_rawpkt_xdp,
 
 	OPT_rawsock,
 	OPT_rawsock_ops,
@@ -1192,17 +1359,21 @@ typedef enum {
 
 	OPT_rdrand,
 	OPT_rdrand_ops,
+	OPT_rdrand_scale,
 	OPT_rdrand_seed,
 
 	OPT_readahead,
 	OPT_readahead_ops,
 	OPT_readahead_bytes,
+	OPT_readahead_mode,
 
 	OPT_reboot,
 	OPT_reboot_ops,
 
 	OPT_regex,
 	OPT_regex_ops,
+	OPT_regex_corpus,
+	OPT_regex_file,
 
 	OPT_regs,
 	OPT_regs_ops,
@@ -1214,9 +1385,15 @@ typedef enum {
 
 	OPT_rename_ops,
 
+	OPT_repeat,
+	OPT_repeat_cov,
+	OPT_repeat_warmup,
+
 	OPT_resched,
 	OPT_resched_ops,
 
+	OPT_resctrl,
+
 	OPT_resources,
 	OPT_resources_mlock,
 	OPT_resources_ops,
@@ -1243,17 +1420,23 @@ typedef enum {
 	OPT_rotate_ops,
 
 	OPT_rseq,
+	OPT_rseq_bench,
 	OPT_rseq_ops,
+	OPT_rseq_threads,
 
 	OPT_rtc,
 	OPT_rtc_ops,
 
+	OPT_scale_sweep,
+
 	OPT_sched,
 	OPT_sched_prio,
 
 	OPT_schedmix,
 	OPT_schedmix_ops,
+	OPT_schedmix_policy,
 	OPT_schedmix_procs,
+	OPT_schedmix_slice_us,
 
 	OPT_schedpolicy,
 	OPT_schedpolicy_ops,
@@ -1268,8 +1451,11 @@ typedef enum {
 	OPT_sctp_ops,
 	OPT_sctp_domain,
 	OPT_sctp_if,
+	OPT_sctp_msg_size,
 	OPT_sctp_port,
 	OPT_sctp_sched,
+	OPT_sctp_streams,
+	OPT_sctp_style,
 
 	OPT_seal,
 	OPT_seal_ops,
@@ -1279,6 +1465,8 @@ typedef enum {
 
 	OPT_secretmem,
 	OPT_secretmem_ops,
+	OPT_secretmem_probe,
+	OPT_secretmem_rate,
 
 	OPT_seed,
 
@@ -1318,6 +1506,7 @@ typedef enum {
 	OPT_shm_mlock,
 	OPT_shm_ops,
 	OPT_shm_objs,
+	OPT_shm_ring,
 
 	OPT_shm_sysv,
 	OPT_shm_sysv_bytes,
@@ -1326,6 +1515,7 @@ typedef enum {
 	OPT_shm_sysv_segs,
 
 	OPT_sequential,
+	OPT_pipeline_seq,
 
 	OPT_sigabrt,
 	OPT_sigabrt_ops,
@@ -1338,6 +1528,7 @@ typedef enum {
 
 	OPT_sigfd,
 	OPT_sigfd_ops,
+	OPT_sigfd_latency,
 
 	OPT_sigfpe,
 	OPT_sigfpe_ops,
@@ -1353,21 +1544,25 @@ typedef enum {
 
 	OPT_signal,
 	OPT_signal_ops,
+	OPT_signal_latency,
 
 	OPT_signest,
 	OPT_signest_ops,
 
 	OPT_sigpending,
 	OPT_sigpending_ops,
+	OPT_sigpending_latency,
 
 	OPT_sigpipe,
 	OPT_sigpipe_ops,
 
 	OPT_sigq,
 	OPT_sigq_ops,
+	OPT_sigq_latency,
 
 	OPT_sigrt,
 	OPT_sigrt_ops,
+	OPT_sigrt_latency,
 
 	OPT_sigsegv,
 	OPT_sigsegv_ops,
@@ -1391,8 +1586,11 @@ typedef enum {
 	OPT_sigxfsz_ops,
 
 	OPT_skiplist,
+	OPT_skiplist_insmix,
 	OPT_skiplist_ops,
+	OPT_skiplist_rwmix,
 	OPT_skiplist_size,
+	OPT_skiplist_threads,
 
 	OPT_skip_silent,
 
@@ -1409,14 +1607,23 @@ typedef enum {
 
 	OPT_sock_ops,
 	OPT_sock_domain,
+	OPT_sock_engine,
 	OPT_sock_if,
 	OPT_sock_msgs,
 	OPT_sock_nodelay,
 	OPT_sock_opts,
 	OPT_sock_port,
 	OPT_sock_protocol,
+	OPT_sock_reuseport,
+	OPT_sock_reuseport_cbpf,
+	OPT_sock_reuseport_conns,
+	OPT_sock_reuseport_size,
+	OPT_sock_rr,
+	OPT_sock_rr_client_cpu,
+	OPT_sock_rr_server_cpu,
 	OPT_sock_type,
 	OPT_sock_zerocopy,
+	OPT_sock_zerocopy_window,
 
 	OPT_sockabuse,
 	OPT_sockabuse_ops,
@@ -1424,6 +1631,7 @@ typedef enum {
 
 	OPT_sockdiag,
 	OPT_sockdiag_ops,
+	OPT_sockdiag_sockets,
 
 	OPT_sockfd,
 	OPT_sockfd_ops,
@@ -1431,9 +1639,14 @@ typedef enum {
 	OPT_sockfd_reuse,
 
 	OPT_sockmany,
+	OPT_sockmany_defer_accept,
+	OPT_sockmany_fastopen,
 	OPT_sockmany_if,
 	OPT_sockmany_ops,
 	OPT_sockmany_port,
+	OPT_sockmany_rate,
+	OPT_sockmany_reuseport,
+	OPT_sockmany_syncookies,
 
 	OPT_sockpair,
 	OPT_sockpair_ops,
@@ -1447,6 +1660,7 @@ typedef enum {
 
 	OPT_switch_ops,
 	OPT_switch_freq,
+	OPT_switch_matrix,
 	OPT_switch_method,
 
 	OPT_spawn,
@@ -1457,6 +1671,7 @@ typedef enum {
 	OPT_sparsematrix_items,
 	OPT_sparsematrix_method,
 	OPT_sparsematrix_size,
+	OPT_sparsematrix_spmv,
 
 	OPT_spinmem,
 	OPT_spinmem_affinity,
@@ -1488,14 +1703,19 @@ typedef enum {
 	OPT_str,
 	OPT_str_ops,
 	OPT_str_method,
+	OPT_str_hit,
+	OPT_str_sweep,
 
 	OPT_stream,
 	OPT_stream_index,
 	OPT_stream_l3_size,
 	OPT_stream_madvise,
+	OPT_stream_method,
 	OPT_stream_mlock,
 	OPT_stream_ops,
+	OPT_stream_parallel,
 
+	OPT_stressor_cgroup,
 	OPT_stressor_time,
 
 	OPT_stressors,
@@ -1507,8 +1727,12 @@ typedef enum {
 	OPT_sync_file,
 	OPT_sync_file_ops,
 	OPT_sync_file_bytes,
+	OPT_sync_file_per_writer,
+	OPT_sync_file_record,
+	OPT_sync_file_writers,
 
 	OPT_sync_start,
+	OPT_sync_start_at,
 
 	OPT_syncload,
 	OPT_syncload_ops,
@@ -1519,6 +1743,8 @@ typedef enum {
 	OPT_sysbadaddr_ops,
 
 	OPT_syscall,
+	OPT_syscall_latency,
+	OPT_syscall_latency_yaml,
 	OPT_syscall_method,
 	OPT_syscall_ops,
 	OPT_syscall_top,
@@ -1537,6 +1763,9 @@ typedef enum {
 	OPT_tee,
 	OPT_tee_ops,
 
+	OPT_target_power,
+	OPT_target_util,
+
 	OPT_taskset,
 
 	OPT_taskset_random,
@@ -1546,6 +1775,8 @@ typedef enum {
 	OPT_thermalstat,
 	OPT_thermal_zones,
 
+	OPT_thp,
+
 	OPT_thrash,
 
 	OPT_timer_slack,
@@ -1569,6 +1800,7 @@ typedef enum {
 
 	OPT_tlb_shootdown,
 	OPT_tlb_shootdown_ops,
+	OPT_tlb_shootdown_sweep,
 
 	OPT_tmpfs,
 	OPT_tmpfs_ops,
@@ -1593,6 +1825,7 @@ typedef enum {
 	OPT_tsc_ops,
 	OPT_tsc_lfence,
 	OPT_tsc_rdtscp,
+	OPT_tsc_skew,
 
 	OPT_tsearch,
 	OPT_tsearch_ops,
@@ -1600,15 +1833,22 @@ typedef enum {
 
 	OPT_tun,
 	OPT_tun_ops,
+	OPT_tun_gso,
+	OPT_tun_queues,
 	OPT_tun_tap,
 
 	OPT_udp,
 	OPT_udp_ops,
 	OPT_udp_port,
+	OPT_udp_batch,
 	OPT_udp_domain,
 	OPT_udp_lite,
 	OPT_udp_gro,
+	OPT_udp_gso,
 	OPT_udp_if,
+	OPT_udp_rr,
+	OPT_udp_rr_client_cpu,
+	OPT_udp_rr_server_cpu,
 
 	OPT_udp_flood,
 	OPT_udp_flood_ops,
@@ -1634,7 +1874,10 @@ typedef enum {
 
 	OPT_userfaultfd,
 	OPT_userfaultfd_ops,
+	OPT_userfaultfd_batch,
 	OPT_userfaultfd_bytes,
+	OPT_userfaultfd_mode,
+	OPT_userfaultfd_threads,
 
 	OPT_usersyscall,
 	OPT_usersyscall_ops,
@@ -1646,6 +1889,8 @@ typedef enum {
 	OPT_vdso,
 	OPT_vdso_ops,
 	OPT_vdso_func,
+	OPT_vdso_clocksources,
+	OPT_vdso_timing,
 
 	OPT_veccmp,
 	OPT_veccmp_ops,
@@ -1688,6 +1933,7 @@ typedef enum {
 	OPT_vm_madvise,
 	OPT_vm_method,
 	OPT_vm_numa,
+	OPT_vm_threads,
 
 	OPT_vm_addr,
 	OPT_vm_addr_method,
@@ -1698,6 +1944,7 @@ typedef enum {
 	OPT_vm_rw,
 	OPT_vm_rw_ops,
 	OPT_vm_rw_bytes,
+	OPT_vm_rw_sweep,
 
 	OPT_vm_segv,
 	OPT_vm_segv_ops,
@@ -1716,6 +1963,7 @@ typedef enum {
 	OPT_vnni_intrinsic,
 	OPT_vnni_method,
 	OPT_vnni_ops,
+	OPT_vnni_width_report,
 
 	OPT_wait,
 	OPT_wait_ops,
@@ -1723,14 +1971,19 @@ typedef enum {
 	OPT_waitcpu,
 	OPT_waitcpu_ops,
 
+	OPT_warmup,
+
 	OPT_watchdog,
 	OPT_watchdog_ops,
 
 	OPT_wcs,
 	OPT_wcs_ops,
 	OPT_wcs_method,
+	OPT_wcs_hit,
+	OPT_wcs_sweep,
 
 	OPT_workload,
+	OPT_workload_deadline_us,
 	OPT_workload_dist,
 	OPT_workload_load,
 	OPT_workload_method,
@@ -1739,6 +1992,7 @@ typedef enum {
 	OPT_workload_sched,
 	OPT_workload_slice_us,
 	OPT_workload_threads,
+	OPT_workload_trace,
 
 	OPT_x86cpuid,
 	OPT_x86cpuid_ops,
@@ -1758,11 +2012,19 @@ typedef enum {
 	OPT_zero_read,
 	OPT_zero_ops,
 
+	OPT_zerocopy,
+	OPT_zerocopy_ops,
+	OPT_zerocopy_bytes,
+	OPT_zerocopy_if,
+	OPT_zerocopy_method,
+	OPT_zerocopy_port,
+
 	OPT_zlib,
 	OPT_zlib_ops,
 	OPT_zlib_level,
 	OPT_zlib_mem_level,
 	OPT_zlib_method,
+	OPT_zlib_parallel,
 	OPT_zlib_window_bits,
 	OPT_zlib_stream_bytes,
 	OPT_zlib_strategy,
@@ -538,7 +538,7 @@ int32_t stress_get_int32_instance_percent(const char *const str)
 		if (val < 0.0) {
 			return -1;
 		} else if (val > 0.0) {
-			const int32_t cpus = stress_get_processors_configured();
+			const int32_t cpus = stress_get_processors_allowed();
 
 			val = (double)cpus * val / 100.0;
 			if (val < 1.0)
@@ -563,9 +563,29 @@ uint64_t stress_get_uint64_byte_memory(
 	const uint32_t instances)
 {
 	const uint64_t phys_mem = stress_get_phys_mem_size();
+	const size_t len = strlen(str);
+	uint64_t bytes, limit, available;
 
-	return stress_get_uint64_percent(str, instances, phys_mem,
+	bytes = stress_get_uint64_percent(str, instances, phys_mem,
 		"Cannot determine physical memory size");
+	if ((len > 1) && (str[len - 1] == '%')) {
+		char buf_bytes[32], buf_avail[32];
+
+		/* sizes are limited by the cgroup when available < physical memory */
+		if (stress_get_cgroup_mem(&limit, &available) && (available == phys_mem)) {
+			char buf_limit[32];
+
+			pr_inf("memory size %s of %s available in cgroup (limit %s) is %s\n",
+				str, stress_uint64_to_str(buf_avail, sizeof(buf_avail), available),
+				stress_uint64_to_str(buf_limit, sizeof(buf_limit), limit),
+				stress_uint64_to_str(buf_bytes, sizeof(buf_bytes), bytes));
+		} else {
+			pr_dbg("memory size %s of %s available memory is %s\n",
+				str, stress_uint64_to_str(buf_avail, sizeof(buf_avail), phys_mem),
+				stress_uint64_to_str(buf_bytes, sizeof(buf_bytes), bytes));
+		}
+	}
+	return bytes;
 }
 
 /*
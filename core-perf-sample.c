@@ -0,0 +1,633 @@
+/*
+ * Copyright (C) 2025      Colin Ian King
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+#include "stress-ng.h"
+#include "core-builtin.h"
+#include "core-perf-sample.h"
+
+#if defined(HAVE_LINUX_PERF_EVENT_H)
+#include <linux/perf_event.h>
+#endif
+
+#if defined(HAVE_LINK_H)
+#include <link.h>
+#endif
+
+#if defined(STRESS_PERF_SAMPLE)
+
+#include <pthread.h>
+
+#define STRESS_PERF_SAMPLE_FREQ		(997)		/* samples per second */
+#define STRESS_PERF_SAMPLE_PAGES	(64)		/* ring buffer pages, power of 2 */
+#define STRESS_PERF_SAMPLE_DRAIN_US	(100000)	/* ring buffer drain period */
+#define STRESS_PERF_SAMPLE_STACK_MAX	(128)		/* max callchain depth used */
+
+/* function symbol from the stress-ng executable */
+typedef struct {
+	uintptr_t addr;			/* run time address */
+	uintptr_t size;			/* size of function */
+	const char *name;		/* name, in the mmap'd executable */
+} stress_perf_sample_sym_t;
+
+/* per stressor sample counts */
+typedef struct stress_perf_sample_stressor {
+	struct stress_perf_sample_stressor *next;
+	const stress_stressor_t *ss;	/* stressor being sampled */
+	uint64_t samples;		/* total samples */
+	uint64_t lost;			/* samples lost, ring buffer full */
+	uint64_t unknown;		/* samples that can't be symbolised */
+	uint64_t *self;			/* samples with the IP in each symbol */
+	uint64_t *via;			/* samples outside stress-ng called from each symbol */
+} stress_perf_sample_stressor_t;
+
+/* per stressor instance perf sampling ring buffer */
+typedef struct stress_perf_sample_ring {
+	struct stress_perf_sample_ring *next;
+	stress_perf_sample_stressor_t *owner;
+	int fd;				/* perf event fd */
+	void *mmap;			/* perf ring buffer */
+	size_t mmap_size;		/* size of ring buffer mapping */
+} stress_perf_sample_ring_t;
+
+/* used to sort the top-N functions */
+typedef struct {
+	uint64_t count;			/* samples */
+	size_t sym;			/* symbol index */
+	bool via;			/* true if in an external callee */
+} stress_perf_sample_hit_t;
+
+static stress_perf_sample_sym_t *syms;
+static size_t n_syms;
+static void *exe_mmap = MAP_FAILED;
+static size_t exe_size;
+
+static stress_perf_sample_stressor_t *stressors_sampled;
+static stress_perf_sample_ring_t *rings;
+static pthread_mutex_t rings_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_t drain_thread;
+static bool drain_thread_running;
+static volatile bool drain_thread_stop;
+static size_t page_size;
+
+/*
+ *  stress_perf_sample_base()
+ *	dl_iterate_phdr callback, the first object is the
+ *	executable, get its load bias
+ */
+static int stress_perf_sample_base(struct dl_phdr_info *info, size_t size, void *data)
+{
+	(void)size;
+
+	*(uintptr_t *)data = (uintptr_t)info->dlpi_addr;
+	return 1;
+}
+
+/*
+ *  stress_perf_sample_sym_cmp()
+ *	sort symbols by address
+ */
+static int stress_perf_sample_sym_cmp(const void *p1, const void *p2)
+{
+	const stress_perf_sample_sym_t *s1 = (const stress_perf_sample_sym_t *)p1;
+	const stress_perf_sample_sym_t *s2 = (const stress_perf_sample_sym_t *)p2;
+
+	if (s1->addr < s2->addr)
+		return -1;
+	if (s1->addr > s2->addr)
+		return 1;
+	return 0;
+}
+
+/*
+ *  stress_perf_sample_syms_load()
+ *	load the function symbols from the stress-ng executable,
+ *	this uses the full symbol table and falls back to the
+ *	dynamic symbols if the executable is stripped
+ */
+static int stress_perf_sample_syms_load(void)
+{
+	const ElfW(Ehdr) *ehdr;
+	const ElfW(Shdr) *shdrs, *symtab = NULL, *strtab;
+	const ElfW(Sym) *sym;
+	const char *strs;
+	uintptr_t bias = 0;
+	struct stat statbuf;
+	size_t i, n;
+	int fd;
+
+	fd = open("/proc/self/exe", O_RDONLY);
+	if (fd < 0)
+		return -1;
+	if ((fstat(fd, &statbuf) < 0) || (statbuf.st_size < (off_t)sizeof(*ehdr))) {
+		(void)close(fd);
+		return -1;
+	}
+	exe_size = (size_t)statbuf.st_size;
+	exe_mmap = mmap(NULL, exe_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	(void)close(fd);
+	if (exe_mmap == MAP_FAILED)
+		return -1;
+
+	ehdr = (const ElfW(Ehdr) *)exe_mmap;
+	if ((memcmp(ehdr->e_ident, ELFMAG, SELFMAG) != 0) ||
+	    (ehdr->e_shentsize != sizeof(ElfW(Shdr))) ||
+	    (ehdr->e_shoff + ((size_t)ehdr->e_shnum * sizeof(ElfW(Shdr))) > exe_size))
+		return -1;
+
+	shdrs = (const ElfW(Shdr) *)((const uint8_t *)exe_mmap + ehdr->e_shoff);
+	for (i = 0; i < ehdr->e_shnum; i++) {
+		if (shdrs[i].sh_type == SHT_SYMTAB) {
+			symtab = &shdrs[i];
+			break;
+		}
+		if ((shdrs[i].sh_type == SHT_DYNSYM) && !symtab)
+			symtab = &shdrs[i];
+	}
+	if (!symtab || (symtab->sh_link >= ehdr->e_shnum) ||
+	    (symtab->sh_offset + symtab->sh_size > exe_size))
+		return -1;
+	strtab = &shdrs[symtab->sh_link];
+	if (strtab->sh_offset + strtab->sh_size > exe_size)
+		return -1;
+
+	sym = (const ElfW(Sym) *)((const uint8_t *)exe_mmap + symtab->sh_offset);
+	strs = (const char *)exe_mmap + strtab->sh_offset;
+	n = symtab->sh_size / sizeof(*sym);
+
+	syms = (stress_perf_sample_sym_t *)calloc(n, sizeof(*syms));
+	if (!syms)
+		return -1;
+
+	(void)dl_iterate_phdr(stress_perf_sample_base, &bias);
+
+	for (n_syms = 0, i = 0; i < n; i++) {
+		if ((ELF64_ST_TYPE(sym[i].st_info) != STT_FUNC) ||
+		    (sym[i].st_value == 0) || (sym[i].st_size == 0) ||
+		    (sym[i].st_name >= strtab->sh_size))
+			continue;
+		syms[n_syms].addr = bias + (uintptr_t)sym[i].st_value;
+		syms[n_syms].size = (uintptr_t)sym[i].st_size;
+		syms[n_syms].name = strs + sym[i].st_name;
+		n_syms++;
+	}
+	if (!n_syms)
+		return -1;
+	qsort(syms, n_syms, sizeof(*syms), stress_perf_sample_sym_cmp);
+
+	return 0;
+}
+
+/*
+ *  stress_perf_sample_sym_find()
+ *	find the symbol an address is in, returns
+ *	n_syms if it is not in a known function
+ */
+static size_t stress_perf_sample_sym_find(const uintptr_t addr)
+{
+	size_t lo = 0, hi = n_syms;
+
+	while (lo < hi) {
+		const size_t mid = lo + ((hi - lo) >> 1);
+
+		if (syms[mid].addr <= addr)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	if ((lo == 0) || (addr >= syms[lo - 1].addr + syms[lo - 1].size))
+		return n_syms;
+	return lo - 1;
+}
+
+/*
+ *  stress_perf_sample_ring_copy()
+ *	copy len bytes from ring buffer offset, handling wrap around
+ */
+static void stress_perf_sample_ring_copy(
+	void *dst,
+	const uint8_t *data,
+	const uint64_t offset,
+	const size_t len,
+	const uint64_t mask)
+{
+	const size_t start = (size_t)(offset & mask);
+	const size_t first = (size_t)(mask + 1) - start;
+
+	if (len <= first) {
+		(void)shim_memcpy(dst, data + start, len);
+	} else {
+		(void)shim_memcpy(dst, data + start, first);
+		(void)shim_memcpy((uint8_t *)dst + first, data, len - first);
+	}
+}
+
+/*
+ *  stress_perf_sample_account()
+ *	account a sample, samples in external code (libc, vDSO)
+ *	are charged to the first stress-ng caller in the callchain
+ */
+static void stress_perf_sample_account(
+	stress_perf_sample_stressor_t *owner,
+	const uint64_t *sample,
+	const size_t n)
+{
+	uint64_t i, nr;
+	size_t idx;
+
+	if (n < 1)
+		return;
+	owner->samples++;
+
+	idx = stress_perf_sample_sym_find((uintptr_t)sample[0]);
+	if (idx < n_syms) {
+		owner->self[idx]++;
+		return;
+	}
+	nr = (n > 1) ? sample[1] : 0;
+	if (nr > n - 2)
+		nr = n - 2;
+	for (i = 0; i < nr; i++) {
+		const uint64_t ip = sample[2 + i];
+
+		/* skip PERF_CONTEXT_* markers */
+		if (ip >= (uint64_t)PERF_CONTEXT_MAX)
+			continue;
+		idx = stress_perf_sample_sym_find((uintptr_t)ip);
+		if (idx < n_syms) {
+			owner->via[idx]++;
+			return;
+		}
+	}
+	owner->unknown++;
+}
+
+/*
+ *  stress_perf_sample_ring_drain()
+ *	consume all the records in a ring buffer
+ */
+static void stress_perf_sample_ring_drain(stress_perf_sample_ring_t *ring)
+{
+	struct perf_event_mmap_page *meta = (struct perf_event_mmap_page *)ring->mmap;
+	const uint8_t *data = (const uint8_t *)ring->mmap + page_size;
+	const uint64_t mask = (uint64_t)(page_size * STRESS_PERF_SAMPLE_PAGES) - 1;
+	uint64_t head, tail;
+
+#if defined(HAVE_ATOMIC_LOAD)
+	head = __atomic_load_n(&meta->data_head, __ATOMIC_ACQUIRE);
+#else
+	head = *(volatile uint64_t *)&meta->data_head;
+	__sync_synchronize();
+#endif
+	tail = meta->data_tail;
+
+	while (tail + sizeof(struct perf_event_header) <= head) {
+		struct perf_event_header hdr;
+		uint64_t record[2 + STRESS_PERF_SAMPLE_STACK_MAX];
+		size_t len;
+
+		stress_perf_sample_ring_copy(&hdr, data, tail, sizeof(hdr), mask);
+		if ((hdr.size < sizeof(hdr)) || (tail + hdr.size > head))
+			break;
+
+		len = hdr.size - sizeof(hdr);
+		if (len > sizeof(record))
+			len = sizeof(record);
+		stress_perf_sample_ring_copy(record, data, tail + sizeof(hdr), len, mask);
+
+		switch (hdr.type) {
+		case PERF_RECORD_SAMPLE:
+			stress_perf_sample_account(ring->owner, record, len / sizeof(uint64_t));
+			break;
+		case PERF_RECORD_LOST:
+			/* u64 id followed by u64 number lost */
+			if (len >= 2 * sizeof(uint64_t))
+				ring->owner->lost += record[1];
+			break;
+		default:
+			break;
+		}
+		tail += hdr.size;
+	}
+#if defined(HAVE_ATOMIC_STORE)
+	__atomic_store_n(&meta->data_tail, tail, __ATOMIC_RELEASE);
+#else
+	__sync_synchronize();
+	*(volatile uint64_t *)&meta->data_tail = tail;
+#endif
+}
+
+/*
+ *  stress_perf_sample_drain()
+ *	parent thread, periodically drain the ring buffers
+ *	so they don't overflow on long runs
+ */
+static void *stress_perf_sample_drain(void *arg)
+{
+	sigset_t set;
+
+	(void)arg;
+
+	/* signals are handled by the main stress-ng thread */
+	(void)sigfillset(&set);
+	(void)pthread_sigmask(SIG_BLOCK, &set, NULL);
+
+	while (!drain_thread_stop) {
+		stress_perf_sample_ring_t *ring;
+
+		(void)pthread_mutex_lock(&rings_lock);
+		for (ring = rings; ring; ring = ring->next)
+			stress_perf_sample_ring_drain(ring);
+		(void)pthread_mutex_unlock(&rings_lock);
+		(void)shim_usleep(STRESS_PERF_SAMPLE_DRAIN_US);
+	}
+	return NULL;
+}
+
+/*
+ *  stress_perf_sample_stressor()
+ *	find or add the sample counts for a stressor
+ */
+static stress_perf_sample_stressor_t *stress_perf_sample_stressor(const stress_stressor_t *ss)
+{
+	stress_perf_sample_stressor_t *pss, **tail = &stressors_sampled;
+
+	for (pss = stressors_sampled; pss; pss = pss->next) {
+		if (pss->ss == ss)
+			return pss;
+		tail = &pss->next;
+	}
+
+	pss = (stress_perf_sample_stressor_t *)calloc(1, sizeof(*pss));
+	if (!pss)
+		return NULL;
+	pss->self = (uint64_t *)calloc(n_syms, sizeof(*pss->self));
+	pss->via = (uint64_t *)calloc(n_syms, sizeof(*pss->via));
+	if (!pss->self || !pss->via) {
+		free(pss->via);
+		free(pss->self);
+		free(pss);
+		return NULL;
+	}
+	pss->ss = ss;
+	*tail = pss;
+
+	return pss;
+}
+
+/*
+ *  stress_perf_sample_open()
+ *	open a cycles sampling event on process pid, fall back
+ *	to the CPU clock software event on systems without a PMU
+ */
+static int stress_perf_sample_open(const pid_t pid)
+{
+	struct perf_event_attr attr;
+	int fd;
+
+	(void)shim_memset(&attr, 0, sizeof(attr));
+	attr.size = sizeof(attr);
+	attr.type = PERF_TYPE_HARDWARE;
+	attr.config = PERF_COUNT_HW_CPU_CYCLES;
+	attr.freq = 1;
+	attr.sample_freq = STRESS_PERF_SAMPLE_FREQ;
+	attr.sample_type = PERF_SAMPLE_IP | PERF_SAMPLE_CALLCHAIN;
+	attr.exclude_kernel = 1;
+	attr.exclude_hv = 1;
+	attr.exclude_callchain_kernel = 1;
+
+	fd = (int)syscall(__NR_perf_event_open, &attr, pid, -1, -1, 0);
+	if (fd >= 0)
+		return fd;
+
+	attr.type = PERF_TYPE_SOFTWARE;
+	attr.config = PERF_COUNT_SW_CPU_CLOCK;
+	return (int)syscall(__NR_perf_event_open, &attr, pid, -1, -1, 0);
+}
+
+/*
+ *  stress_perf_sample_attach()
+ *	start sampling stressor instance process pid
+ */
+void stress_perf_sample_attach(const stress_stressor_t *ss, const pid_t pid)
+{
+	stress_perf_sample_ring_t *ring;
+	stress_perf_sample_stressor_t *pss;
+
+	if (!drain_thread_running)
+		return;
+
+	pss = stress_perf_sample_stressor(ss);
+	if (!pss)
+		return;
+	ring = (stress_perf_sample_ring_t *)calloc(1, sizeof(*ring));
+	if (!ring)
+		return;
+
+	ring->owner = pss;
+	ring->fd = stress_perf_sample_open(pid);
+	if (ring->fd < 0) {
+		free(ring);
+		return;
+	}
+	ring->mmap_size = page_size * (STRESS_PERF_SAMPLE_PAGES + 1);
+	ring->mmap = mmap(NULL, ring->mmap_size, PROT_READ | PROT_WRITE,
+			MAP_SHARED, ring->fd, 0);
+	if (ring->mmap == MAP_FAILED) {
+		(void)close(ring->fd);
+		free(ring);
+		return;
+	}
+#if defined(HAVE_MADVISE) &&	\
+    defined(MADV_DONTFORK)
+	/* don't leak the ring buffers into stressors forked later */
+	(void)madvise(ring->mmap, ring->mmap_size, MADV_DONTFORK);
+#endif
+
+	(void)pthread_mutex_lock(&rings_lock);
+	ring->next = rings;
+	rings = ring;
+	(void)pthread_mutex_unlock(&rings_lock);
+}
+
+/*
+ *  stress_perf_sample_detach_all()
+ *	drain and close all the ring buffers, called once
+ *	all the stressor instances have been reaped
+ */
+void stress_perf_sample_detach_all(void)
+{
+	stress_perf_sample_ring_t *ring;
+
+	(void)pthread_mutex_lock(&rings_lock);
+	ring = rings;
+	rings = NULL;
+	(void)pthread_mutex_unlock(&rings_lock);
+
+	while (ring) {
+		stress_perf_sample_ring_t *next = ring->next;
+
+		stress_perf_sample_ring_drain(ring);
+		(void)munmap(ring->mmap, ring->mmap_size);
+		(void)close(ring->fd);
+		free(ring);
+		ring = next;
+	}
+}
+
+/*
+ *  stress_perf_sample_init()
+ *	load symbols and start the ring buffer drain thread,
+ *	returns 0 if OK, -1 if sampling is not available
+ */
+int stress_perf_sample_init(void)
+{
+	page_size = stress_get_page_size();
+
+	if (stress_perf_sample_syms_load() < 0) {
+		pr_inf("perf-sample: cannot read function symbols from the "
+			"stress-ng executable, disabling sampling\n");
+		stress_perf_sample_deinit();
+		return -1;
+	}
+	drain_thread_stop = false;
+	if (pthread_create(&drain_thread, NULL, stress_perf_sample_drain, NULL) != 0) {
+		pr_inf("perf-sample: cannot create ring buffer drain thread, "
+			"disabling sampling\n");
+		stress_perf_sample_deinit();
+		return -1;
+	}
+	drain_thread_running = true;
+	pr_dbg("perf-sample: %zu function symbols loaded\n", n_syms);
+
+	return 0;
+}
+
+/*
+ *  stress_perf_sample_deinit()
+ *	stop sampling and free all sampling resources
+ */
+void stress_perf_sample_deinit(void)
+{
+	if (drain_thread_running) {
+		drain_thread_stop = true;
+		(void)pthread_join(drain_thread, NULL);
+		drain_thread_running = false;
+	}
+	stress_perf_sample_detach_all();
+
+	while (stressors_sampled) {
+		stress_perf_sample_stressor_t *next = stressors_sampled->next;
+
+		free(stressors_sampled->via);
+		free(stressors_sampled->self);
+		free(stressors_sampled);
+		stressors_sampled = next;
+	}
+	free(syms);
+	syms = NULL;
+	n_syms = 0;
+	if (exe_mmap != MAP_FAILED) {
+		(void)munmap(exe_mmap, exe_size);
+		exe_mmap = MAP_FAILED;
+	}
+}
+
+/*
+ *  stress_perf_sample_hit_cmp()
+ *	sort hits into descending sample count order
+ */
+static int stress_perf_sample_hit_cmp(const void *p1, const void *p2)
+{
+	const stress_perf_sample_hit_t *h1 = (const stress_perf_sample_hit_t *)p1;
+	const stress_perf_sample_hit_t *h2 = (const stress_perf_sample_hit_t *)p2;
+
+	if (h1->count > h2->count)
+		return -1;
+	if (h1->count < h2->count)
+		return 1;
+	return 0;
+}
+
+/*
+ *  stress_perf_sample_dump()
+ *	output the top_n hottest functions of each stressor
+ */
+void stress_perf_sample_dump(FILE *yaml, const int32_t top_n)
+{
+	stress_perf_sample_stressor_t *pss;
+	bool header = false;
+
+	pr_block_begin();
+	for (pss = stressors_sampled; pss; pss = pss->next) {
+		const char *name = pss->ss->stressor->name;
+		stress_perf_sample_hit_t *hits;
+		size_t i, n_hits = 0;
+
+		if (!pss->samples)
+			continue;
+		hits = (stress_perf_sample_hit_t *)calloc(2 * n_syms, sizeof(*hits));
+		if (!hits) {
+			pr_inf("perf-sample: cannot allocate function sort buffer, "
+				"skipping %s\n", name);
+			continue;
+		}
+		for (i = 0; i < n_syms; i++) {
+			if (pss->self[i]) {
+				hits[n_hits].count = pss->self[i];
+				hits[n_hits].sym = i;
+				hits[n_hits].via = false;
+				n_hits++;
+			}
+			if (pss->via[i]) {
+				hits[n_hits].count = pss->via[i];
+				hits[n_hits].sym = i;
+				hits[n_hits].via = true;
+				n_hits++;
+			}
+		}
+		qsort(hits, n_hits, sizeof(*hits), stress_perf_sample_hit_cmp);
+
+		if (!header) {
+			pr_yaml(yaml, "perf-sample:\n");
+			header = true;
+		}
+		pr_inf("perf-sample: %s: %" PRIu64 " samples, %" PRIu64 " lost, "
+			"%" PRIu64 " unknown\n", name, pss->samples, pss->lost, pss->unknown);
+		pr_yaml(yaml, "    - stressor: %s\n", name);
+		pr_yaml(yaml, "      samples: %" PRIu64 "\n", pss->samples);
+		pr_yaml(yaml, "      lost: %" PRIu64 "\n", pss->lost);
+		pr_yaml(yaml, "      unknown: %" PRIu64 "\n", pss->unknown);
+		pr_yaml(yaml, "      functions:\n");
+
+		for (i = 0; (i < n_hits) && (i < (size_t)top_n); i++) {
+			const double percent = 100.0 * (double)hits[i].count / (double)pss->samples;
+			const char *func = syms[hits[i].sym].name;
+
+			pr_inf("perf-sample: %s: %6.2f%% %10" PRIu64 " %s%s\n",
+				name, percent, hits[i].count, func,
+				hits[i].via ? " (external callee)" : "");
+			pr_yaml(yaml, "        - function: %s\n", func);
+			pr_yaml(yaml, "          external-callee: %s\n", hits[i].via ? "true" : "false");
+			pr_yaml(yaml, "          samples: %" PRIu64 "\n", hits[i].count);
+			pr_yaml(yaml, "          percent: %f\n", percent);
+		}
+		free(hits);
+	}
+	pr_block_end();
+}
+#endif
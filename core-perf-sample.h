@@ -0,0 +1,46 @@
+/*
+ * Copyright (C) 2025      Colin Ian King
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+#ifndef CORE_PERF_SAMPLE_H
+#define CORE_PERF_SAMPLE_H
+
+#include "stress-ng.h"
+#include "core-perf.h"
+
+/*
+ *  --perf-sample IP sampling profiler, stressor instances are
+ *  sampled by the parent and the samples are symbolised against
+ *  the stress-ng executable to find the hottest functions
+ */
+#if defined(STRESS_PERF_STATS) &&	\
+    defined(HAVE_LINUX_PERF_EVENT_H) &&	\
+    defined(HAVE_LINK_H) &&		\
+    defined(HAVE_SYSCALL)
+#define STRESS_PERF_SAMPLE	(1)
+
+#define STRESS_PERF_SAMPLE_TOP_DEFAULT	(10)
+#define STRESS_PERF_SAMPLE_TOP_MAX	(1000)
+
+extern int stress_perf_sample_init(void);
+extern void stress_perf_sample_deinit(void);
+extern void stress_perf_sample_attach(const stress_stressor_t *ss, const pid_t pid);
+extern void stress_perf_sample_detach_all(void);
+extern void stress_perf_sample_dump(FILE *yaml, const int32_t top_n);
+#endif
+
+#endif
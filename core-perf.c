@@ -50,12 +50,25 @@
 
 #define UNRESOLVED	(~0UL)
 
+/*
+ *  Events in the same group are scheduled onto the PMU together
+ *  and read with one read() so that ratios between them are
+ *  computed from counters sampled over the same time
+ */
+#define STRESS_PERF_GROUP_NONE	(0)	/* not grouped */
+#define STRESS_PERF_GROUP_CORE	(1)	/* cycles, instructions, branches */
+#define STRESS_PERF_GROUP_LLC	(2)	/* last level cache */
+#define STRESS_PERF_GROUP_DTLB	(3)	/* data TLB */
+#define STRESS_PERF_GROUP_MAX	(4)
+
 /* used for table of perf events to gather */
 typedef struct {
 	const unsigned int type;	/* perf types */
 	unsigned long int config;	/* perf type specific config */
 	const char *path;		/* perf trace point path (only for trace points) */
 	const char *label;		/* human readable name for perf type */
+	const uint8_t group;		/* event group, STRESS_PERF_GROUP_NONE if not grouped */
+	const bool shadow;		/* group copy of an event, used for derived metrics only */
 } stress_perf_info_t;
 
 /* perf data */
@@ -65,6 +78,14 @@ typedef struct {
 	uint64_t time_running;		/* perf time running */
 } stress_perf_data_t;
 
+/* perf group data, PERF_FORMAT_GROUP read format */
+typedef struct {
+	uint64_t nr;			/* number of events in group */
+	uint64_t time_enabled;		/* perf time enabled */
+	uint64_t time_running;		/* perf time running */
+	uint64_t counter[STRESS_PERF_MAX]; /* counters, leader first */
+} stress_perf_group_data_t;
+
 typedef struct {
 	const double	threshold;	/* scaling threshold */
 	const double	scale;		/* scaling value */
@@ -73,15 +94,23 @@ typedef struct {
 
 /* Tracepoint */
 #define PERF_INFO_TP(path, label)	\
-	{ PERF_TYPE_TRACEPOINT, UNRESOLVED, path, label }
+	{ PERF_TYPE_TRACEPOINT, UNRESOLVED, path, label, STRESS_PERF_GROUP_NONE, false }
 
 /* Hardware */
 #define PERF_INFO_HW(config, label)	\
-	{ PERF_TYPE_HARDWARE, PERF_COUNT_ ## config, NULL, label }
+	{ PERF_TYPE_HARDWARE, PERF_COUNT_ ## config, NULL, label, STRESS_PERF_GROUP_NONE, false }
+
+/* Hardware, grouped */
+#define PERF_INFO_HW_G(config, label, group)	\
+	{ PERF_TYPE_HARDWARE, PERF_COUNT_ ## config, NULL, label, group, false }
+
+/* Hardware, grouped copy of an event that is not reported */
+#define PERF_INFO_HW_SHADOW(config, label, group)	\
+	{ PERF_TYPE_HARDWARE, PERF_COUNT_ ## config, NULL, label, group, true }
 
 /* Software */
 #define PERF_INFO_SW(config, label)	\
-	{ PERF_TYPE_SOFTWARE, PERF_COUNT_ ## config, NULL, label }
+	{ PERF_TYPE_SOFTWARE, PERF_COUNT_ ## config, NULL, label, STRESS_PERF_GROUP_NONE, false }
 
 #define PERF_INFO_HW_CACHE_CONFIG(cache_id, op_id, result_id)	\
 	  (PERF_COUNT_HW_CACHE_ ## cache_id) |			\
@@ -92,7 +121,13 @@ typedef struct {
 #define PERF_INFO_HW_C(cache_id, op_id, result_id, label)	\
 	{ PERF_TYPE_HW_CACHE, 					\
 	  PERF_INFO_HW_CACHE_CONFIG(cache_id, op_id, result_id),\
-	  NULL, label }
+	  NULL, label, STRESS_PERF_GROUP_NONE, false }
+
+/* Hardware Cache, grouped */
+#define PERF_INFO_HW_C_G(cache_id, op_id, result_id, label, group)	\
+	{ PERF_TYPE_HW_CACHE, 					\
+	  PERF_INFO_HW_CACHE_CONFIG(cache_id, op_id, result_id),\
+	  NULL, label, group, false }
 
 #define STRESS_PERF_DEFINED(x) STRESS_PERF_COUNT_ ## x
 
@@ -118,16 +153,16 @@ static stress_perf_info_t perf_info[STRESS_PERF_MAX] = {
 	 *  Hardware counters
 	 */
 #if STRESS_PERF_DEFINED(HW_CPU_CYCLES)
-	PERF_INFO_HW(HW_CPU_CYCLES,		"CPU Cycles"),
+	PERF_INFO_HW_G(HW_CPU_CYCLES,		"CPU Cycles", STRESS_PERF_GROUP_CORE),
 #endif
 #if STRESS_PERF_DEFINED(HW_INSTRUCTIONS)
-	PERF_INFO_HW(HW_INSTRUCTIONS,		"Instructions"),
+	PERF_INFO_HW_G(HW_INSTRUCTIONS,		"Instructions", STRESS_PERF_GROUP_CORE),
 #endif
 #if STRESS_PERF_DEFINED(HW_BRANCH_INSTRUCTIONS)
-	PERF_INFO_HW(HW_BRANCH_INSTRUCTIONS,	"Branch Instructions"),
+	PERF_INFO_HW_G(HW_BRANCH_INSTRUCTIONS,	"Branch Instructions", STRESS_PERF_GROUP_CORE),
 #endif
 #if STRESS_PERF_DEFINED(HW_BRANCH_MISSES)
-	PERF_INFO_HW(HW_BRANCH_MISSES,		"Branch Misses"),
+	PERF_INFO_HW_G(HW_BRANCH_MISSES,		"Branch Misses", STRESS_PERF_GROUP_CORE),
 #endif
 #if STRESS_PERF_DEFINED(HW_STALLED_CYCLES_FRONTEND)
 	PERF_INFO_HW(HW_STALLED_CYCLES_FRONTEND,"Stalled Cycles Frontend"),
@@ -142,10 +177,13 @@ static stress_perf_info_t perf_info[STRESS_PERF_MAX] = {
 	PERF_INFO_HW(HW_REF_CPU_CYCLES,		"Total Cycles"),
 #endif
 #if STRESS_PERF_DEFINED(HW_CACHE_REFERENCES)
-	PERF_INFO_HW(HW_CACHE_REFERENCES,	"Cache References"),
+	PERF_INFO_HW_G(HW_CACHE_REFERENCES,	"Cache References", STRESS_PERF_GROUP_LLC),
 #endif
 #if STRESS_PERF_DEFINED(HW_CACHE_MISSES)
-	PERF_INFO_HW(HW_CACHE_MISSES,		"Cache Misses"),
+	PERF_INFO_HW_G(HW_CACHE_MISSES,		"Cache Misses", STRESS_PERF_GROUP_LLC),
+#endif
+#if STRESS_PERF_DEFINED(HW_INSTRUCTIONS)
+	PERF_INFO_HW_SHADOW(HW_INSTRUCTIONS,	"Instructions", STRESS_PERF_GROUP_LLC),
 #endif
 
 	/*
@@ -179,8 +217,11 @@ static stress_perf_info_t perf_info[STRESS_PERF_MAX] = {
 #endif
 
 #if STRESS_PERF_DEFINED(HW_CACHE_DTLB)
-	PERF_INFO_HW_C(DTLB, READ, ACCESS, 	"Cache DTLB Read"),
-	PERF_INFO_HW_C(DTLB, READ, MISS, 	"Cache DTLB Read Miss"),
+	PERF_INFO_HW_C_G(DTLB, READ, ACCESS, 	"Cache DTLB Read", STRESS_PERF_GROUP_DTLB),
+	PERF_INFO_HW_C_G(DTLB, READ, MISS, 	"Cache DTLB Read Miss", STRESS_PERF_GROUP_DTLB),
+#if STRESS_PERF_DEFINED(HW_INSTRUCTIONS)
+	PERF_INFO_HW_SHADOW(HW_INSTRUCTIONS,	"Instructions", STRESS_PERF_GROUP_DTLB),
+#endif
 	PERF_INFO_HW_C(DTLB, WRITE, ACCESS, 	"Cache DTLB Write"),
 	PERF_INFO_HW_C(DTLB, WRITE, MISS, 	"Cache DTLB Write Miss"),
 	PERF_INFO_HW_C(DTLB, PREFETCH, ACCESS, 	"Cache DTLB Prefetch"),
@@ -366,7 +407,7 @@ static stress_perf_info_t perf_info[STRESS_PERF_MAX] = {
 
 	PERF_INFO_TP("thermal/thermal_zone_trip",	"Thermal Zone Trip"),
 
-	{ 0, 0, NULL, NULL }
+	{ 0, 0, NULL, NULL, STRESS_PERF_GROUP_NONE, false }
 };
 
 static inline size_t stress_perf_info_find(const unsigned int type, const unsigned long int config)
@@ -474,6 +515,7 @@ static char *stress_perf_yaml_label(char *dst, const char *src, const size_t n)
 int stress_perf_open(stress_perf_t *sp)
 {
 	size_t i;
+	int group_leader[STRESS_PERF_GROUP_MAX];
 
 	if (!sp)
 		return -1;
@@ -485,12 +527,16 @@ int stress_perf_open(stress_perf_t *sp)
 
 	for (i = 0; i < STRESS_PERF_MAX; i++) {
 		sp->perf_stat[i].fd = -1;
+		sp->perf_stat[i].leader = -1;
 		sp->perf_stat[i].counter = 0;
 	}
+	for (i = 0; i < STRESS_PERF_GROUP_MAX; i++)
+		group_leader[i] = -1;
 
 	for (i = 0; (i < STRESS_PERF_MAX) && perf_info[i].label; i++) {
 		if (perf_info[i].config != UNRESOLVED) {
 			struct perf_event_attr attr;
+			const uint8_t group = perf_info[i].group;
 
 			(void)shim_memset(&attr, 0, sizeof(attr));
 			attr.type = perf_info[i].type;
@@ -500,6 +546,27 @@ int stress_perf_open(stress_perf_t *sp)
 			attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED |
 					   PERF_FORMAT_TOTAL_TIME_RUNNING;
 			attr.size = sizeof(attr);
+
+			if ((group != STRESS_PERF_GROUP_NONE) && (group < STRESS_PERF_GROUP_MAX)) {
+				const int leader = group_leader[group];
+				const int group_fd = (leader < 0) ? -1 : sp->perf_stat[leader].fd;
+
+				/* group members are enabled and disabled by the leader */
+				attr.disabled = (leader < 0);
+				attr.read_format |= PERF_FORMAT_GROUP;
+				sp->perf_stat[i].fd =
+					stress_sys_perf_event_open(&attr, 0, -1, group_fd, 0);
+				if (sp->perf_stat[i].fd > -1) {
+					if (leader < 0)
+						group_leader[group] = (int)i;
+					sp->perf_stat[i].leader = group_leader[group];
+					sp->perf_opened++;
+					continue;
+				}
+				/* can't group it, fall back to an ungrouped event */
+				attr.disabled = 1;
+				attr.read_format &= ~(uint64_t)PERF_FORMAT_GROUP;
+			}
 			sp->perf_stat[i].fd =
 				stress_sys_perf_event_open(&attr, 0, -1, -1, 0);
 			if (sp->perf_stat[i].fd > -1)
@@ -530,6 +597,87 @@ int stress_perf_open(stress_perf_t *sp)
 	return 0;
 }
 
+/*
+ *  stress_perf_is_leader()
+ *	true if perf event i is an ungrouped event or a group leader
+ */
+static inline bool stress_perf_is_leader(const stress_perf_t *sp, const size_t i)
+{
+	const int leader = sp->perf_stat[i].leader;
+
+	return (leader < 0) || ((size_t)leader == i);
+}
+
+/*
+ *  stress_perf_close_group()
+ *	close perf event leader and all the members of its group
+ */
+static void stress_perf_close_group(stress_perf_t *sp, const size_t leader)
+{
+	size_t i;
+
+	if (sp->perf_stat[leader].leader < 0) {
+		(void)close(sp->perf_stat[leader].fd);
+		sp->perf_stat[leader].fd = -1;
+		return;
+	}
+	for (i = leader; (i < STRESS_PERF_MAX) && perf_info[i].label; i++) {
+		if ((sp->perf_stat[i].leader == (int)leader) && (sp->perf_stat[i].fd > -1)) {
+			(void)close(sp->perf_stat[i].fd);
+			sp->perf_stat[i].fd = -1;
+		}
+	}
+}
+
+/*
+ *  stress_perf_scale()
+ *	scale factor for a counter that was multiplexed
+ *	and only running for part of the time it was enabled
+ */
+static inline double stress_perf_scale(const uint64_t time_enabled, const uint64_t time_running)
+{
+	/* Ensure we don't get division by zero */
+	if (time_running == 0)
+		return (time_enabled == 0) ? 1.0 : 0.0;
+	return (double)time_enabled / (double)time_running;
+}
+
+/*
+ *  stress_perf_read_group()
+ *	read all the counters of the group with one read, the
+ *	kernel returns the leader followed by the members in
+ *	the order they were added to the group
+ */
+static void stress_perf_read_group(stress_perf_t *sp, const size_t leader)
+{
+	stress_perf_group_data_t data;
+	ssize_t ret;
+	uint64_t n = 0;
+	double scale = 0.0;
+	size_t i;
+
+	(void)shim_memset(&data, 0, sizeof(data));
+	ret = read(sp->perf_stat[leader].fd, &data, sizeof(data));
+	if (ret < (ssize_t)(3 * sizeof(uint64_t)) ||
+	    (data.nr > STRESS_PERF_MAX) ||
+	    ((size_t)ret < (3 + data.nr) * sizeof(uint64_t)))
+		data.nr = 0;
+	else
+		scale = stress_perf_scale(data.time_enabled, data.time_running);
+
+	for (i = leader; (i < STRESS_PERF_MAX) && perf_info[i].label; i++) {
+		if ((sp->perf_stat[i].leader != (int)leader) || (sp->perf_stat[i].fd < 0))
+			continue;
+		if (n < data.nr) {
+			sp->perf_stat[i].counter = (uint64_t)
+				((double)data.counter[n] * scale);
+			n++;
+		} else {
+			sp->perf_stat[i].counter = STRESS_PERF_INVALID;
+		}
+	}
+}
+
 /*
  *  stress_perf_enable()
  *	enable perf counters
@@ -546,17 +694,15 @@ int stress_perf_enable(stress_perf_t *sp)
 	for (i = 0; (i < STRESS_PERF_MAX) && perf_info[i].label; i++) {
 		const int fd = sp->perf_stat[i].fd;
 
-		if (fd > -1) {
+		if ((fd > -1) && stress_perf_is_leader(sp, i)) {
 			if (ioctl(fd, PERF_EVENT_IOC_RESET,
 				  PERF_IOC_FLAG_GROUP) < 0) {
-				(void)close(fd);
-				sp->perf_stat[i].fd = -1;
+				stress_perf_close_group(sp, i);
 				continue;
 			}
 			if (ioctl(fd, PERF_EVENT_IOC_ENABLE,
 				  PERF_IOC_FLAG_GROUP) < 0) {
-				(void)close(fd);
-				sp->perf_stat[i].fd = -1;
+				stress_perf_close_group(sp, i);
 			}
 		}
 	}
@@ -579,11 +725,10 @@ int stress_perf_disable(stress_perf_t *sp)
 	for (i = 0; (i < STRESS_PERF_MAX) && perf_info[i].label; i++) {
 		const int fd = sp->perf_stat[i].fd;
 
-		if (fd > -1) {
+		if ((fd > -1) && stress_perf_is_leader(sp, i)) {
 			if (ioctl(fd, PERF_EVENT_IOC_DISABLE,
 			          PERF_IOC_FLAG_GROUP) < 0) {
-				(void)close(fd);
-				sp->perf_stat[i].fd = -1;
+				stress_perf_close_group(sp, i);
 			}
 		}
 	}
@@ -599,13 +744,18 @@ int stress_perf_close(stress_perf_t *sp)
 	size_t i = 0;
 	stress_perf_data_t data;
 	ssize_t ret;
-	double scale;
 
 	if (!sp)
 		return -1;
 	if (!sp->perf_opened)
 		goto out_ok;
 
+	/* group leaders are read first, this fills in the group counters */
+	for (i = 0; (i < STRESS_PERF_MAX) && perf_info[i].label; i++) {
+		if ((sp->perf_stat[i].fd > -1) && (sp->perf_stat[i].leader == (int)i))
+			stress_perf_read_group(sp, i);
+	}
+
 	for (i = 0; (i < STRESS_PERF_MAX) && perf_info[i].label; i++) {
 		const int fd = sp->perf_stat[i].fd;
 
@@ -614,20 +764,15 @@ int stress_perf_close(stress_perf_t *sp)
 			continue;
 		}
 
-		(void)shim_memset(&data, 0, sizeof(data));
-		ret = read(fd, &data, sizeof(data));
-		if (ret != sizeof(data))
-			sp->perf_stat[i].counter = STRESS_PERF_INVALID;
-		else {
-			/* Ensure we don't get division by zero */
-			if (data.time_running == 0) {
-				scale = (data.time_enabled == 0) ? 1.0 : 0.0;
-			} else {
-				scale = (double)data.time_enabled /
-					(double)data.time_running;
-			}
-			sp->perf_stat[i].counter = (uint64_t)
-				((double)data.counter * scale);
+		if (sp->perf_stat[i].leader < 0) {
+			(void)shim_memset(&data, 0, sizeof(data));
+			ret = read(fd, &data, sizeof(data));
+			if (ret != sizeof(data))
+				sp->perf_stat[i].counter = STRESS_PERF_INVALID;
+			else
+				sp->perf_stat[i].counter = (uint64_t)
+					((double)data.counter *
+					 stress_perf_scale(data.time_enabled, data.time_running));
 		}
 		(void)close(fd);
 		sp->perf_stat[i].fd = -1;
@@ -640,6 +785,158 @@ out_ok:
 	return 0;
 }
 
+/*
+ *  stress_perf_cycles_open()
+ *	open user space core cycle and reference cycle counters on the
+ *	calling thread, these are the perf equivalents of the x86 APERF
+ *	and MPERF MSRs. Returns 0 if at least the core cycle counter opened
+ */
+int stress_perf_cycles_open(stress_perf_cycles_t *pc)
+{
+	static const unsigned long int configs[] = {
+		PERF_COUNT_HW_CPU_CYCLES,
+		PERF_COUNT_HW_REF_CPU_CYCLES,
+	};
+	size_t i;
+
+	for (i = 0; i < SIZEOF_ARRAY(configs); i++) {
+		struct perf_event_attr attr;
+
+		(void)shim_memset(&attr, 0, sizeof(attr));
+		attr.type = PERF_TYPE_HARDWARE;
+		attr.config = configs[i];
+		attr.exclude_kernel = 1;
+		attr.exclude_hv = 1;
+		attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED |
+				   PERF_FORMAT_TOTAL_TIME_RUNNING;
+		attr.size = sizeof(attr);
+		pc->fd[i] = stress_sys_perf_event_open(&attr, 0, -1, -1, 0);
+	}
+	if (pc->fd[0] < 0) {
+		stress_perf_cycles_close(pc);
+		return -1;
+	}
+	return 0;
+}
+
+/*
+ *  stress_perf_cycles_read()
+ *	read the multiplex scaled cycle counters, ref_cycles is
+ *	zero if the reference cycle counter is not available
+ */
+int stress_perf_cycles_read(const stress_perf_cycles_t *pc, uint64_t *cycles, uint64_t *ref_cycles)
+{
+	uint64_t *counters[2];
+	size_t i;
+
+	counters[0] = cycles;
+	counters[1] = ref_cycles;
+
+	for (i = 0; i < SIZEOF_ARRAY(counters); i++) {
+		stress_perf_data_t data;
+
+		*counters[i] = 0;
+		if (pc->fd[i] < 0)
+			continue;
+		(void)shim_memset(&data, 0, sizeof(data));
+		if (read(pc->fd[i], &data, sizeof(data)) != sizeof(data))
+			return -1;
+		*counters[i] = (uint64_t)((double)data.counter *
+			stress_perf_scale(data.time_enabled, data.time_running));
+	}
+	return 0;
+}
+
+/*
+ *  stress_perf_cycles_close()
+ *	close the cycle counters
+ */
+void stress_perf_cycles_close(stress_perf_cycles_t *pc)
+{
+	size_t i;
+
+	for (i = 0; i < SIZEOF_ARRAY(pc->fd); i++) {
+		if (pc->fd[i] > -1)
+			(void)close(pc->fd[i]);
+		pc->fd[i] = -1;
+	}
+}
+
+/*
+ *  stress_perf_counters_open()
+ *	open n user space counters on the calling thread, counters
+ *	that are not available are marked with a -1 fd. Returns the
+ *	number of counters that were opened
+ */
+size_t stress_perf_counters_open(
+	stress_perf_counters_t *pc,
+	const stress_perf_counter_cfg_t *cfgs,
+	const size_t n)
+{
+	size_t i, opened = 0;
+
+	pc->n = (n > STRESS_PERF_COUNTERS_MAX) ? STRESS_PERF_COUNTERS_MAX : n;
+	for (i = 0; i < STRESS_PERF_COUNTERS_MAX; i++)
+		pc->fd[i] = -1;
+
+	for (i = 0; i < pc->n; i++) {
+		struct perf_event_attr attr;
+
+		(void)shim_memset(&attr, 0, sizeof(attr));
+		attr.type = cfgs[i].type;
+		attr.config = cfgs[i].config;
+		attr.exclude_kernel = 1;
+		attr.exclude_hv = 1;
+		attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED |
+				   PERF_FORMAT_TOTAL_TIME_RUNNING;
+		attr.size = sizeof(attr);
+		pc->fd[i] = stress_sys_perf_event_open(&attr, 0, -1, -1, 0);
+		if (pc->fd[i] > -1)
+			opened++;
+	}
+	return opened;
+}
+
+/*
+ *  stress_perf_counters_read()
+ *	read the multiplex scaled counters, counters that are
+ *	not available are read as zero
+ */
+int stress_perf_counters_read(const stress_perf_counters_t *pc, uint64_t *counters)
+{
+	size_t i;
+
+	for (i = 0; i < pc->n; i++) {
+		stress_perf_data_t data;
+
+		counters[i] = 0;
+		if (pc->fd[i] < 0)
+			continue;
+		(void)shim_memset(&data, 0, sizeof(data));
+		if (read(pc->fd[i], &data, sizeof(data)) != sizeof(data))
+			return -1;
+		counters[i] = (uint64_t)((double)data.counter *
+			stress_perf_scale(data.time_enabled, data.time_running));
+	}
+	return 0;
+}
+
+/*
+ *  stress_perf_counters_close()
+ *	close the counters
+ */
+void stress_perf_counters_close(stress_perf_counters_t *pc)
+{
+	size_t i;
+
+	for (i = 0; i < STRESS_PERF_COUNTERS_MAX; i++) {
+		if (pc->fd[i] > -1)
+			(void)close(pc->fd[i]);
+		pc->fd[i] = -1;
+	}
+	pc->n = 0;
+}
+
 /*
  *  stress_perf_stat_succeeded()
  *	did perf event open work OK?
@@ -730,6 +1027,153 @@ static const perf_relative_t perf_relatives[] = {
 	  true, " (%6.3f%%)" },
 };
 
+/*
+ *  Metrics derived from events in the same group, the events
+ *  are counted over the same time so the ratios are exact even
+ *  when the PMU is multiplexing the events
+ */
+typedef struct {
+	const unsigned int	type;
+	const unsigned long int	config;
+	const unsigned int	ref_type;
+	const unsigned long int	ref_config;
+	const double		scale;		/* ratio scaling */
+	const char		*label;		/* human readable name of the metric */
+} perf_derived_t;
+
+static const perf_derived_t perf_derived[] = {
+	{ PERF_TYPE_HARDWARE,	PERF_COUNT_HW_INSTRUCTIONS,
+	  PERF_TYPE_HARDWARE,	PERF_COUNT_HW_CPU_CYCLES,
+	  1.0, "Instructions Per Cycle" },
+	{ PERF_TYPE_HARDWARE,	PERF_COUNT_HW_BRANCH_MISSES,
+	  PERF_TYPE_HARDWARE,	PERF_COUNT_HW_BRANCH_INSTRUCTIONS,
+	  100.0, "Branch Miss Percent" },
+	{ PERF_TYPE_HARDWARE,	PERF_COUNT_HW_BRANCH_MISSES,
+	  PERF_TYPE_HARDWARE,	PERF_COUNT_HW_INSTRUCTIONS,
+	  1000.0, "Branch MPKI" },
+	{ PERF_TYPE_HARDWARE,	PERF_COUNT_HW_CACHE_MISSES,
+	  PERF_TYPE_HARDWARE,	PERF_COUNT_HW_CACHE_REFERENCES,
+	  100.0, "LLC Miss Percent" },
+	{ PERF_TYPE_HARDWARE,	PERF_COUNT_HW_CACHE_MISSES,
+	  PERF_TYPE_HARDWARE,	PERF_COUNT_HW_INSTRUCTIONS,
+	  1000.0, "LLC MPKI" },
+	{ PERF_TYPE_HW_CACHE,	PERF_INFO_HW_CACHE_CONFIG(DTLB, READ, MISS),
+	  PERF_TYPE_HW_CACHE,	PERF_INFO_HW_CACHE_CONFIG(DTLB, READ, ACCESS),
+	  100.0, "DTLB Read Miss Percent" },
+	{ PERF_TYPE_HW_CACHE,	PERF_INFO_HW_CACHE_CONFIG(DTLB, READ, MISS),
+	  PERF_TYPE_HARDWARE,	PERF_COUNT_HW_INSTRUCTIONS,
+	  1000.0, "DTLB Read MPKI" },
+};
+
+/*
+ *  stress_perf_derived()
+ *	compute a derived metric from two events in the same
+ *	group, returns false if the events were not counted
+ */
+static bool stress_perf_derived(
+	const perf_derived_t *pd,
+	const uint64_t *counter_totals,
+	double *value)
+{
+	size_t i, j;
+
+	for (i = 0; (i < STRESS_PERF_MAX) && perf_info[i].label; i++) {
+		if ((perf_info[i].type != pd->type) ||
+		    (perf_info[i].config != pd->config) ||
+		    (perf_info[i].group == STRESS_PERF_GROUP_NONE) ||
+		    (counter_totals[i] == STRESS_PERF_INVALID))
+			continue;
+
+		for (j = 0; (j < STRESS_PERF_MAX) && perf_info[j].label; j++) {
+			if ((perf_info[j].type == pd->ref_type) &&
+			    (perf_info[j].config == pd->ref_config) &&
+			    (perf_info[j].group == perf_info[i].group) &&
+			    (counter_totals[j] != STRESS_PERF_INVALID) &&
+			    (counter_totals[j] > 0)) {
+				*value = pd->scale * (double)counter_totals[i] /
+					(double)counter_totals[j];
+				return true;
+			}
+		}
+	}
+	return false;
+}
+
+/*
+ *  stress_perf_stat_totals()
+ *	sum perf counters across all instances of a stressor,
+ *	returns false if no counter data was gathered
+ */
+static bool stress_perf_stat_totals(const stress_stressor_t *ss, uint64_t *counter_totals)
+{
+	bool got_data = false;
+	int p;
+
+	(void)shim_memset(counter_totals, 0, sizeof(*counter_totals) * STRESS_PERF_MAX);
+
+	for (p = 0; (p < STRESS_PERF_MAX) && perf_info[p].label; p++) {
+		int32_t j;
+
+		for (j = 0; j < ss->instances; j++) {
+			const stress_perf_t *sp = &ss->stats[j]->sp;
+			uint64_t counter;
+
+			/* thread instances are counted by their process */
+			if (!stress_perf_stat_succeeded(sp))
+				continue;
+			counter = sp->perf_stat[p].counter;
+
+			if (counter == STRESS_PERF_INVALID) {
+				counter_totals[p] = STRESS_PERF_INVALID;
+				break;
+			}
+			counter_totals[p] += counter;
+			got_data |= (counter > 0);
+		}
+	}
+	return got_data;
+}
+
+/*
+ *  stress_perf_stat_json()
+ *	add the perf counter totals and derived statistics of a
+ *	stressor to a JSON record
+ */
+void stress_perf_stat_json(stress_json_t *json, const stress_stressor_t *ss, const double duration)
+{
+	uint64_t counter_totals[STRESS_PERF_MAX];
+	char label[128];
+	size_t i;
+	int p;
+
+	if (!ss->stats || !stress_perf_stat_succeeded(&ss->stats[0]->sp))
+		return;
+	if (!stress_perf_stat_totals(ss, counter_totals))
+		return;
+
+	stress_json_object_begin(json, "perf");
+	for (p = 0; (p < STRESS_PERF_MAX) && perf_info[p].label; p++) {
+		const uint64_t ct = counter_totals[p];
+
+		if (perf_info[p].shadow || (ct == STRESS_PERF_INVALID))
+			continue;
+		*label = '\0';
+		stress_perf_yaml_label(label, perf_info[p].label, sizeof(label));
+		stress_json_uint64(json, label, ct);
+	}
+	for (i = 0; i < SIZEOF_ARRAY(perf_derived); i++) {
+		double value;
+
+		if (!stress_perf_derived(&perf_derived[i], counter_totals, &value))
+			continue;
+		*label = '\0';
+		stress_perf_yaml_label(label, perf_derived[i].label, sizeof(label));
+		stress_json_double(json, label, value);
+	}
+	stress_json_double(json, "duration", duration);
+	stress_json_object_end(json);
+}
+
 /*
  *  stress_perf_stat_dump()
  *	emit perf statistics
@@ -748,36 +1192,16 @@ void stress_perf_stat_dump(FILE *yaml, stress_stressor_t *stressors_list, const
 	for (ss = stressors_list; ss; ss = ss->next) {
 		int p;
 		uint64_t counter_totals[STRESS_PERF_MAX];
-		bool got_data = false;
-		stress_perf_t *sp;
+		size_t i;
 
 		if (ss->ignore.run)
 			continue;
 		if (!ss->stats)
 			continue;
-		sp = &ss->stats[0]->sp;
-		if (!stress_perf_stat_succeeded(sp))
+		if (!stress_perf_stat_succeeded(&ss->stats[0]->sp))
 			continue;
 
-		(void)shim_memset(counter_totals, 0, sizeof(counter_totals));
-
-		/* Sum totals across all instances of the stressor */
-		for (p = 0; (p < STRESS_PERF_MAX) && perf_info[p].label; p++) {
-			int32_t j;
-
-			for (j = 0; j < ss->instances; j++) {
-				const uint64_t counter = sp->perf_stat[p].counter;
-
-				if (counter == STRESS_PERF_INVALID) {
-					counter_totals[p] = STRESS_PERF_INVALID;
-					break;
-				}
-				counter_totals[p] += counter;
-				got_data |= (counter > 0);
-			}
-		}
-
-		if (!got_data)
+		if (!stress_perf_stat_totals(ss, counter_totals))
 			continue;
 
 		pr_inf("%s:\n", ss->stressor->name);
@@ -788,11 +1212,12 @@ void stress_perf_stat_dump(FILE *yaml, stress_stressor_t *stressors_list, const
 			const char *label = perf_info[p].label;
 			const uint64_t ct = counter_totals[p];
 
+			if (perf_info[p].shadow)
+				continue;
 			if (label && (ct != STRESS_PERF_INVALID)) {
 				char extra[32];
 				char yaml_label[128];
 				*extra = '\0';
-				size_t i;
 
 				no_perf_stats = false;
 
@@ -824,6 +1249,20 @@ void stress_perf_stat_dump(FILE *yaml, stress_stressor_t *stressors_list, const
 					yaml_label, (double)ct / duration);
 			}
 		}
+
+		for (i = 0; i < SIZEOF_ARRAY(perf_derived); i++) {
+			char yaml_label[128];
+			double value;
+
+			if (!stress_perf_derived(&perf_derived[i], counter_totals, &value))
+				continue;
+
+			pr_inf("%26.3f %-24s\n", value, perf_derived[i].label);
+
+			*yaml_label = '\0';
+			stress_perf_yaml_label(yaml_label, perf_derived[i].label, sizeof(yaml_label));
+			pr_yaml(yaml, "      %s: %f\n", yaml_label, value);
+		}
 		pr_yaml(yaml, "\n");
 	}
 	if (no_perf_stats) {
@@ -21,6 +21,7 @@
 
 #include "stress-ng.h"
 #include "core-attribute.h"
+#include "core-json.h"
 
 /* perf related constants */
 #if defined(HAVE_LIB_PTHREAD) &&	\
@@ -34,7 +35,7 @@
 typedef struct {
 	uint64_t counter;		/* perf counter */
 	int	 fd;			/* perf per counter fd */
-	uint8_t	 padding[4];		/* padding */
+	int	 leader;		/* index of group leader, -1 if not grouped */
 } stress_perf_stat_t;
 
 /* per stressor perf info */
@@ -50,7 +51,37 @@ extern int stress_perf_disable(stress_perf_t *sp);
 extern int stress_perf_close(stress_perf_t *sp);
 extern void stress_perf_stat_dump(FILE *yaml, stress_stressor_t *procs_head,
 	const double duration);
+extern void stress_perf_stat_json(stress_json_t *json, const stress_stressor_t *ss,
+	const double duration);
 extern void stress_perf_init(void);
+
+/* per thread core and reference cycle counters, APERF and MPERF equivalents */
+typedef struct {
+	int fd[2];			/* core cycles, reference cycles */
+} stress_perf_cycles_t;
+
+extern int stress_perf_cycles_open(stress_perf_cycles_t *pc);
+extern int stress_perf_cycles_read(const stress_perf_cycles_t *pc,
+	uint64_t *cycles, uint64_t *ref_cycles);
+extern void stress_perf_cycles_close(stress_perf_cycles_t *pc);
+
+/* per thread set of user space counters, e.g. front-end miss rates */
+#define STRESS_PERF_COUNTERS_MAX	(8)
+
+typedef struct {
+	uint32_t type;			/* perf event type, PERF_TYPE_* */
+	uint64_t config;		/* perf event config */
+} stress_perf_counter_cfg_t;
+
+typedef struct {
+	int fd[STRESS_PERF_COUNTERS_MAX];	/* counter fds, -1 if not available */
+	size_t n;				/* number of counters */
+} stress_perf_counters_t;
+
+extern size_t stress_perf_counters_open(stress_perf_counters_t *pc,
+	const stress_perf_counter_cfg_t *cfgs, const size_t n);
+extern int stress_perf_counters_read(const stress_perf_counters_t *pc, uint64_t *counters);
+extern void stress_perf_counters_close(stress_perf_counters_t *pc);
 #endif
 
 #endif
@@ -0,0 +1,384 @@
+/*
+ * Copyright (C) 2025      Colin Ian King.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+#include "stress-ng.h"
+#include "core-probe-cache.h"
+
+#if defined(HAVE_LINK_H)
+#include <link.h>
+#endif
+
+#if defined(HAVE_SYS_UTSNAME_H)
+#include <sys/utsname.h>
+#endif
+
+#define STRESS_PROBE_CACHE_MAGIC	"stress-ng probe cache 1"
+#define STRESS_PROBE_REASON_MAX		(2048)	/* max captured probe message text */
+
+#if defined(HAVE_LINK_H) &&	\
+    defined(NT_GNU_BUILD_ID) &&	\
+    defined(PT_NOTE) &&		\
+    defined(__linux__)
+#define STRESS_PROBE_CACHE_BUILD_ID
+#endif
+
+/* cached result of a stressor supported() probe */
+typedef struct stress_probe_entry {
+	struct stress_probe_entry *next;
+	char *name;			/* stressor name */
+	char *reason;			/* messages emitted by the probe, may be empty */
+	int ret;			/* supported() return, 0 = supported */
+} stress_probe_entry_t;
+
+static char *probe_cache_filename;	/* NULL = probe cache not used */
+static char probe_cache_key[512];	/* kernel, boot and build the results are valid for */
+static stress_probe_entry_t *probe_entries;
+static bool probe_cache_dirty;
+
+#if defined(STRESS_PROBE_CACHE_BUILD_ID)
+/*
+ *  stress_probe_cache_build_id_cb()
+ *	dl_iterate_phdr callback, the first object is the executable,
+ *	find the GNU build ID note and convert it to hex
+ */
+static int stress_probe_cache_build_id_cb(struct dl_phdr_info *info, size_t size, void *data)
+{
+	char *build_id = (char *)data;
+	ElfW(Half) i;
+
+	(void)size;
+
+	for (i = 0; i < info->dlpi_phnum; i++) {
+		const ElfW(Phdr) *phdr = &info->dlpi_phdr[i];
+		const uint8_t *ptr, *end;
+
+		if (phdr->p_type != PT_NOTE)
+			continue;
+		ptr = (const uint8_t *)(info->dlpi_addr + phdr->p_vaddr);
+		end = ptr + phdr->p_memsz;
+
+		while (ptr + sizeof(ElfW(Nhdr)) <= end) {
+			const ElfW(Nhdr) *nhdr = (const ElfW(Nhdr) *)ptr;
+			const uint8_t *name = ptr + sizeof(*nhdr);
+			const uint8_t *desc = name + ((nhdr->n_namesz + 3) & ~3U);
+
+			if (desc + nhdr->n_descsz > end)
+				break;
+			if ((nhdr->n_type == NT_GNU_BUILD_ID) &&
+			    (nhdr->n_namesz == 4) &&
+			    (memcmp(name, "GNU", 4) == 0) &&
+			    (nhdr->n_descsz > 0) && (nhdr->n_descsz <= 64)) {
+				ElfW(Word) j;
+
+				for (j = 0; j < nhdr->n_descsz; j++)
+					(void)snprintf(build_id + (j * 2), 3, "%2.2x", desc[j]);
+				return 1;
+			}
+			ptr = desc + ((nhdr->n_descsz + 3) & ~3U);
+		}
+	}
+	return 1;
+}
+#endif
+
+/*
+ *  stress_probe_cache_build_id()
+ *	identify the stress-ng binary, use the GNU build ID if the
+ *	executable has one, otherwise the version and executable
+ *	size and modification time
+ */
+static void stress_probe_cache_build_id(char *build_id, const size_t len)
+{
+	struct stat statbuf;
+
+	*build_id = '\0';
+#if defined(STRESS_PROBE_CACHE_BUILD_ID)
+	{
+		char buf[129];
+
+		*buf = '\0';
+		(void)dl_iterate_phdr(stress_probe_cache_build_id_cb, buf);
+		if (*buf) {
+			(void)shim_strscpy(build_id, buf, len);
+			return;
+		}
+	}
+#endif
+	if (stat("/proc/self/exe", &statbuf) == 0) {
+		(void)snprintf(build_id, len, "%s-%jd-%jd", VERSION,
+			(intmax_t)statbuf.st_size, (intmax_t)statbuf.st_mtime);
+	} else {
+		(void)shim_strscpy(build_id, VERSION, len);
+	}
+}
+
+/*
+ *  stress_probe_cache_make_key()
+ *	the probe results are valid for the running kernel release
+ *	and boot, the stress-ng binary and the effective user
+ */
+static void stress_probe_cache_make_key(char *key, const size_t len)
+{
+	char release[256], boot_id[64], build_id[160];
+#if defined(HAVE_UNAME) &&	\
+    defined(HAVE_SYS_UTSNAME_H)
+	struct utsname uts;
+
+	if (uname(&uts) == 0)
+		(void)shim_strscpy(release, uts.release, sizeof(release));
+	else
+		(void)shim_strscpy(release, "unknown", sizeof(release));
+#else
+	(void)shim_strscpy(release, "unknown", sizeof(release));
+#endif
+	if (stress_system_read("/proc/sys/kernel/random/boot_id", boot_id, sizeof(boot_id)) > 0) {
+		char *ptr = strchr(boot_id, '\n');
+
+		if (ptr)
+			*ptr = '\0';
+	} else {
+		(void)shim_strscpy(boot_id, "unknown", sizeof(boot_id));
+	}
+	stress_probe_cache_build_id(build_id, sizeof(build_id));
+
+	(void)snprintf(key, len, "key %s %s %s %jd", release, boot_id,
+		build_id, (intmax_t)geteuid());
+}
+
+/*
+ *  stress_probe_cache_add()
+ *	add a probe result to the cache
+ */
+static stress_probe_entry_t *stress_probe_cache_add(const char *name, const int ret, const char *reason)
+{
+	stress_probe_entry_t *pe;
+
+	pe = (stress_probe_entry_t *)calloc(1, sizeof(*pe));
+	if (!pe)
+		return NULL;
+	pe->name = strdup(name);
+	pe->reason = strdup(reason);
+	if (!pe->name || !pe->reason) {
+		free(pe->reason);
+		free(pe->name);
+		free(pe);
+		return NULL;
+	}
+	pe->ret = ret;
+	pe->next = probe_entries;
+	probe_entries = pe;
+	return pe;
+}
+
+/*
+ *  stress_probe_cache_unescape()
+ *	convert an escaped reason back to message text in place
+ */
+static void stress_probe_cache_unescape(char *str)
+{
+	char *src, *dst;
+
+	for (src = str, dst = str; *src; src++) {
+		if ((*src == '\\') && src[1]) {
+			src++;
+			*dst++ = (*src == 'n') ? '\n' : *src;
+		} else {
+			*dst++ = *src;
+		}
+	}
+	*dst = '\0';
+}
+
+/*
+ *  stress_probe_cache_load()
+ *	use filename as the probe cache, load the cached results
+ *	if they were saved for the same kernel, boot and binary
+ */
+void stress_probe_cache_load(const char *filename)
+{
+	FILE *fp;
+	char buf[STRESS_PROBE_REASON_MAX * 2 + 256];
+	size_t n = 0;
+
+	probe_cache_filename = strdup(filename);
+	if (!probe_cache_filename) {
+		pr_inf("probe-cache: cannot allocate file name, probe cache disabled\n");
+		return;
+	}
+	stress_probe_cache_make_key(probe_cache_key, sizeof(probe_cache_key));
+
+	fp = fopen(filename, "r");
+	if (!fp) {
+		pr_dbg("probe-cache: %s not found, probing stressors\n", filename);
+		return;
+	}
+	if (!fgets(buf, sizeof(buf), fp) ||
+	    strncmp(buf, STRESS_PROBE_CACHE_MAGIC "\n", sizeof(buf)))
+		goto stale;
+	if (!fgets(buf, sizeof(buf), fp))
+		goto stale;
+	buf[strcspn(buf, "\n")] = '\0';
+	if (strcmp(buf, probe_cache_key))
+		goto stale;
+
+	while (fgets(buf, sizeof(buf), fp)) {
+		char *name = buf, *ret_str, *reason, *end;
+		long int ret;
+
+		buf[strcspn(buf, "\n")] = '\0';
+		ret_str = strchr(name, ' ');
+		if (!ret_str)
+			continue;
+		*ret_str++ = '\0';
+		reason = strchr(ret_str, ' ');
+		if (reason)
+			*reason++ = '\0';
+		else
+			reason = ret_str + strlen(ret_str);
+		ret = strtol(ret_str, &end, 10);
+		if (*end || (end == ret_str))
+			continue;
+		stress_probe_cache_unescape(reason);
+		if (stress_probe_cache_add(name, (int)ret, reason))
+			n++;
+	}
+	(void)fclose(fp);
+	pr_dbg("probe-cache: using %zu cached probe result%s from %s\n",
+		n, (n == 1) ? "" : "s", filename);
+	return;
+
+stale:
+	(void)fclose(fp);
+	pr_dbg("probe-cache: %s is stale, probing stressors\n", filename);
+	probe_cache_dirty = true;
+}
+
+/*
+ *  stress_probe_cache_supported()
+ *	return the stressor supported() result, reuse the cached
+ *	result and replay the probe messages if it has been probed
+ *	before, otherwise probe and cache the result
+ */
+int stress_probe_cache_supported(const char *name, int (*supported)(const char *name))
+{
+	stress_probe_entry_t *pe;
+	char reason[STRESS_PROBE_REASON_MAX];
+	int ret;
+
+	if (!probe_cache_filename)
+		return supported(name);
+
+	for (pe = probe_entries; pe; pe = pe->next) {
+		if (!strcmp(pe->name, name)) {
+			const char *ptr;
+
+			/* replay the probe messages a line at a time */
+			for (ptr = pe->reason; *ptr; ) {
+				const int len = (int)strcspn(ptr, "\n");
+
+				pr_inf_skip("%.*s\n", len, ptr);
+				ptr += len;
+				if (*ptr)
+					ptr++;
+			}
+			return pe->ret;
+		}
+	}
+
+	pr_capture_begin(reason, sizeof(reason));
+	ret = supported(name);
+	pr_capture_end();
+
+	if (stress_probe_cache_add(name, ret, reason))
+		probe_cache_dirty = true;
+	return ret;
+}
+
+/*
+ *  stress_probe_cache_save()
+ *	save the probe results if any new stressors have been probed,
+ *	the cache is written to a temporary file and renamed so that
+ *	concurrent stress-ng instances never see a partial cache
+ */
+void stress_probe_cache_save(void)
+{
+	char tmp[PATH_MAX];
+	stress_probe_entry_t *pe;
+	FILE *fp;
+	int fd;
+
+	if (!probe_cache_filename || !probe_cache_dirty)
+		return;
+
+	(void)snprintf(tmp, sizeof(tmp), "%s.%jd", probe_cache_filename, (intmax_t)getpid());
+	fd = open(tmp, O_WRONLY | O_CREAT | O_TRUNC, S_IRUSR | S_IWUSR);
+	if (fd < 0) {
+		pr_inf("probe-cache: cannot create %s, errno=%d (%s)\n",
+			tmp, errno, strerror(errno));
+		return;
+	}
+	fp = fdopen(fd, "w");
+	if (!fp) {
+		(void)close(fd);
+		(void)shim_unlink(tmp);
+		return;
+	}
+	(void)fprintf(fp, "%s\n%s\n", STRESS_PROBE_CACHE_MAGIC, probe_cache_key);
+	for (pe = probe_entries; pe; pe = pe->next) {
+		const char *ptr;
+
+		(void)fprintf(fp, "%s %d ", pe->name, pe->ret);
+		for (ptr = pe->reason; *ptr; ptr++) {
+			if (*ptr == '\n')
+				(void)fputs("\\n", fp);
+			else if (*ptr == '\\')
+				(void)fputs("\\\\", fp);
+			else
+				(void)fputc(*ptr, fp);
+		}
+		(void)fputc('\n', fp);
+	}
+	if ((fclose(fp) != 0) || (rename(tmp, probe_cache_filename) < 0)) {
+		pr_inf("probe-cache: cannot save %s, errno=%d (%s)\n",
+			probe_cache_filename, errno, strerror(errno));
+		(void)shim_unlink(tmp);
+		return;
+	}
+	probe_cache_dirty = false;
+}
+
+/*
+ *  stress_probe_cache_free()
+ *	free the cached probe results
+ */
+void stress_probe_cache_free(void)
+{
+	stress_probe_entry_t *pe = probe_entries;
+
+	while (pe) {
+		stress_probe_entry_t *next = pe->next;
+
+		free(pe->reason);
+		free(pe->name);
+		free(pe);
+		pe = next;
+	}
+	probe_entries = NULL;
+	free(probe_cache_filename);
+	probe_cache_filename = NULL;
+}
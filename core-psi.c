@@ -0,0 +1,274 @@
+/*
+ * Copyright (C) 2025      Colin Ian King.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+#include "stress-ng.h"
+#include "core-builtin.h"
+#include "core-cgroup.h"
+#include "core-psi.h"
+
+static const char * const psi_resources[STRESS_PSI_RESOURCES] = {
+	"cpu",
+	"memory",
+	"io",
+};
+
+/*
+ *  stress_psi_read()
+ *	read a pressure stall information file, e.g.
+ *	some avg10=1.23 avg60=0.50 avg300=0.10 total=123456
+ *	full avg10=0.00 avg60=0.00 avg300=0.00 total=0
+ */
+static bool stress_psi_read(const char *filename, stress_psi_resource_t *res)
+{
+	char buf[256];
+	char *line, *saveptr = NULL;
+	bool valid = false;
+
+	(void)shim_memset(res, 0, sizeof(*res));
+	if (stress_system_read(filename, buf, sizeof(buf)) <= 0)
+		return false;
+
+	for (line = strtok_r(buf, "\n", &saveptr); line; line = strtok_r(NULL, "\n", &saveptr)) {
+		double avg10, avg60, avg300;
+		uint64_t total;
+		char type[8];
+
+		if (sscanf(line, "%7s avg10=%lf avg60=%lf avg300=%lf total=%" SCNu64,
+			   type, &avg10, &avg60, &avg300, &total) != 5)
+			continue;
+		if (!strcmp(type, "some")) {
+			res->some_avg10 = avg10;
+			res->some_total = total;
+			valid = true;
+		} else if (!strcmp(type, "full")) {
+			res->full_avg10 = avg10;
+			res->full_total = total;
+		}
+	}
+	return valid;
+}
+
+/*
+ *  stress_psi_snapshot()
+ *	snapshot the host pressure stall information and, if the
+ *	stressor runs in its own --stressor-cgroup cgroup, the
+ *	cgroup pressure stall information
+ */
+void stress_psi_snapshot(stress_psi_snapshot_t *snapshot, const char *name)
+{
+#if defined(__linux__)
+	char dir[PATH_MAX], filename[PATH_MAX + 32];
+	size_t i;
+
+	snapshot->time = stress_time_now();
+	snapshot->host_valid = true;
+	for (i = 0; i < STRESS_PSI_RESOURCES; i++) {
+		(void)snprintf(filename, sizeof(filename), "/proc/pressure/%s", psi_resources[i]);
+		if (!stress_psi_read(filename, &snapshot->host[i]))
+			snapshot->host_valid = false;
+	}
+
+	snapshot->cgroup_valid = stress_stressor_cgroup_path(name, dir, sizeof(dir));
+	for (i = 0; snapshot->cgroup_valid && (i < STRESS_PSI_RESOURCES); i++) {
+		(void)snprintf(filename, sizeof(filename), "%s/%s.pressure", dir, psi_resources[i]);
+		if (!stress_psi_read(filename, &snapshot->cgroup[i]))
+			snapshot->cgroup_valid = false;
+	}
+#else
+	(void)shim_memset(snapshot, 0, sizeof(*snapshot));
+	(void)name;
+#endif
+}
+
+/*
+ *  stress_psi_interval()
+ *	add the current 10 second host (and stressor cgroup) stall
+ *	averages to a --metrics-interval sample, as JSON record members
+ *	if json is not NULL, otherwise logged
+ */
+void stress_psi_interval(stress_json_t *json, const char *name)
+{
+	stress_psi_snapshot_t snapshot;
+	size_t i;
+
+	stress_psi_snapshot(&snapshot, name);
+	if (!snapshot.host_valid)
+		return;
+
+	if (!json) {
+		pr_inf("metrics-interval: %-13s psi avg10 some cpu %.2f%%, memory %.2f%%, io %.2f%%%s\n",
+			name, snapshot.host[0].some_avg10, snapshot.host[1].some_avg10,
+			snapshot.host[2].some_avg10, snapshot.cgroup_valid ? " (host)" : "");
+		if (snapshot.cgroup_valid)
+			pr_inf("metrics-interval: %-13s psi avg10 some cpu %.2f%%, memory %.2f%%, io %.2f%% (cgroup)\n",
+				name, snapshot.cgroup[0].some_avg10, snapshot.cgroup[1].some_avg10,
+				snapshot.cgroup[2].some_avg10);
+		return;
+	}
+	for (i = 0; i < STRESS_PSI_RESOURCES; i++) {
+		char key[64];
+
+		(void)snprintf(key, sizeof(key), "psi-%s-some-avg10", psi_resources[i]);
+		stress_json_double(json, key, snapshot.host[i].some_avg10);
+		(void)snprintf(key, sizeof(key), "psi-%s-full-avg10", psi_resources[i]);
+		stress_json_double(json, key, snapshot.host[i].full_avg10);
+	}
+	for (i = 0; snapshot.cgroup_valid && (i < STRESS_PSI_RESOURCES); i++) {
+		char key[64];
+
+		(void)snprintf(key, sizeof(key), "cgroup-psi-%s-some-avg10", psi_resources[i]);
+		stress_json_double(json, key, snapshot.cgroup[i].some_avg10);
+		(void)snprintf(key, sizeof(key), "cgroup-psi-%s-full-avg10", psi_resources[i]);
+		stress_json_double(json, key, snapshot.cgroup[i].full_avg10);
+	}
+}
+
+/*
+ *  stress_psi_stall_pc()
+ *	stall time between two snapshot totals as a percentage of
+ *	the wall clock time between them
+ */
+static inline double stress_psi_stall_pc(
+	const uint64_t start,
+	const uint64_t stop,
+	const double duration)
+{
+	if ((stop < start) || (duration <= 0.0))
+		return 0.0;
+	return 100.0 * ((double)(stop - start) / STRESS_DBL_MICROSECOND) / duration;
+}
+
+/*
+ *  stress_psi_dump_resources()
+ *	yaml stall deltas and stall percentages of each resource
+ */
+static void stress_psi_dump_resources(
+	FILE *yaml,
+	const char *prefix,
+	const stress_psi_resource_t *start,
+	const stress_psi_resource_t *stop,
+	const double duration)
+{
+	size_t i;
+
+	for (i = 0; i < STRESS_PSI_RESOURCES; i++) {
+		const uint64_t some_usec = (stop[i].some_total >= start[i].some_total) ?
+			stop[i].some_total - start[i].some_total : 0;
+		const uint64_t full_usec = (stop[i].full_total >= start[i].full_total) ?
+			stop[i].full_total - start[i].full_total : 0;
+
+		pr_yaml(yaml, "      %s%s-some-stall-usec: %" PRIu64 "\n", prefix, psi_resources[i], some_usec);
+		pr_yaml(yaml, "      %s%s-some-stall-percent: %.2f\n", prefix, psi_resources[i],
+			stress_psi_stall_pc(start[i].some_total, stop[i].some_total, duration));
+		pr_yaml(yaml, "      %s%s-some-avg10-at-stop: %.2f\n", prefix, psi_resources[i],
+			stop[i].some_avg10);
+		pr_yaml(yaml, "      %s%s-full-stall-usec: %" PRIu64 "\n", prefix, psi_resources[i], full_usec);
+		pr_yaml(yaml, "      %s%s-full-stall-percent: %.2f\n", prefix, psi_resources[i],
+			stress_psi_stall_pc(start[i].full_total, stop[i].full_total, duration));
+		pr_yaml(yaml, "      %s%s-full-avg10-at-stop: %.2f\n", prefix, psi_resources[i],
+			stop[i].full_avg10);
+	}
+}
+
+/*
+ *  stress_psi_dump()
+ *	report the pressure stall time accrued between the start of the
+ *	first instance and the end of the last instance of each stressor
+ *	as a percentage of that time. Host stalls include those caused by
+ *	any concurrently running stressors, stressors with their own
+ *	--stressor-cgroup cgroup also have their cgroup stalls reported
+ */
+void stress_psi_dump(FILE *yaml, stress_stressor_t *stressors_list)
+{
+	stress_stressor_t *ss;
+	bool header = false;
+
+	pr_block_begin();
+	for (ss = stressors_list; ss; ss = ss->next) {
+		const stress_psi_snapshot_t *start = NULL, *stop = NULL;
+		const stress_psi_snapshot_t *cg_start = NULL, *cg_stop = NULL;
+		double duration;
+		int32_t j;
+		size_t i;
+		char line[128];
+		int len;
+
+		if (ss->ignore.run || ss->ignore.permute || !ss->stats)
+			continue;
+
+		for (j = 0; j < ss->instances; j++) {
+			const stress_psi_t *psi = &ss->stats[j]->psi;
+
+			if (psi->start.host_valid && psi->stop.host_valid) {
+				if (!start || (psi->start.time < start->time))
+					start = &psi->start;
+				if (!stop || (psi->stop.time > stop->time))
+					stop = &psi->stop;
+			}
+			if (psi->start.cgroup_valid && psi->stop.cgroup_valid) {
+				if (!cg_start || (psi->start.time < cg_start->time))
+					cg_start = &psi->start;
+				if (!cg_stop || (psi->stop.time > cg_stop->time))
+					cg_stop = &psi->stop;
+			}
+		}
+		if (!start || !stop)
+			continue;
+		duration = stop->time - start->time;
+		if (duration <= 0.0)
+			continue;
+
+		if (!header) {
+			pr_inf("psi: %-13s %-6s %9s %9s %9s %9s %9s %9s\n",
+				"stressor", "", "cpu some", "cpu full", "mem some",
+				"mem full", "io some", "io full");
+			pr_yaml(yaml, "psi:\n");
+			header = true;
+		}
+		len = 0;
+		for (i = 0; i < STRESS_PSI_RESOURCES; i++) {
+			len += snprintf(line + len, sizeof(line) - (size_t)len, " %8.2f%% %8.2f%%",
+				stress_psi_stall_pc(start->host[i].some_total, stop->host[i].some_total, duration),
+				stress_psi_stall_pc(start->host[i].full_total, stop->host[i].full_total, duration));
+		}
+		pr_inf("psi: %-13s %-6s%s\n", ss->stressor->name, "host", line);
+
+		pr_yaml(yaml, "    - stressor: %s\n", ss->stressor->name);
+		pr_yaml(yaml, "      duration: %.3f\n", duration);
+		stress_psi_dump_resources(yaml, "host-", start->host, stop->host, duration);
+
+		if (cg_start && cg_stop && (cg_stop->time > cg_start->time)) {
+			const double cg_duration = cg_stop->time - cg_start->time;
+
+			len = 0;
+			for (i = 0; i < STRESS_PSI_RESOURCES; i++) {
+				len += snprintf(line + len, sizeof(line) - (size_t)len, " %8.2f%% %8.2f%%",
+					stress_psi_stall_pc(cg_start->cgroup[i].some_total, cg_stop->cgroup[i].some_total, cg_duration),
+					stress_psi_stall_pc(cg_start->cgroup[i].full_total, cg_stop->cgroup[i].full_total, cg_duration));
+			}
+			pr_inf("psi: %-13s %-6s%s\n", "", "cgroup", line);
+			stress_psi_dump_resources(yaml, "cgroup-", cg_start->cgroup, cg_stop->cgroup, cg_duration);
+		}
+	}
+	if (header) {
+		pr_inf("psi: percentage of wall clock time stalled from start of first "
+			"to end of last instance\n");
+		pr_yaml(yaml, "\n");
+	}
+	pr_block_end();
+}
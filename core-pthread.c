@@ -0,0 +1,62 @@
+/*
+ * Copyright (C) 2025      Colin Ian King.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+#include "stress-ng.h"
+#include "core-pthread.h"
+
+/*
+ *  stress_pthread_work_run()
+ *	run func on each of the n work items of size bytes in work,
+ *	each item starts with a stress_pthread_work_t. The first item
+ *	is run by the calling thread, the others by a thread each, or
+ *	by the calling thread if a thread cannot be created
+ */
+void stress_pthread_work_run(
+	void *work,
+	const size_t size,
+	const size_t n,
+	void *(*func)(void *arg))
+{
+	char *ptr = (char *)work;
+	size_t i;
+
+	for (i = 0; i < n; i++) {
+		stress_pthread_work_t *w = (stress_pthread_work_t *)(ptr + (i * size));
+
+#if defined(HAVE_LIB_PTHREAD)
+		w->ret = (i == 0) ? -1 :
+			pthread_create(&w->pthread, NULL, func, (void *)w);
+#else
+		w->ret = -1;
+#endif
+	}
+	for (i = 0; i < n; i++) {
+		stress_pthread_work_t *w = (stress_pthread_work_t *)(ptr + (i * size));
+
+		if (w->ret != 0)
+			(void)func((void *)w);
+	}
+#if defined(HAVE_LIB_PTHREAD)
+	for (i = 1; i < n; i++) {
+		stress_pthread_work_t *w = (stress_pthread_work_t *)(ptr + (i * size));
+
+		if (w->ret == 0)
+			(void)pthread_join(w->pthread, NULL);
+	}
+#endif
+}
@@ -30,6 +30,20 @@ typedef struct {
 	int pthread_ret;		/* Per thread return value */
 } stress_pthread_args_t;
 
+/*
+ *  stress_pthread_work_run() work item, must be the first
+ *  member of the caller's per thread work struct
+ */
+typedef struct {
+#if defined(HAVE_LIB_PTHREAD)
+	pthread_t pthread;		/* thread handle */
+#endif
+	int ret;			/* pthread_create return */
+} stress_pthread_work_t;
+
+extern void stress_pthread_work_run(void *work, const size_t size,
+	const size_t n, void *(*func)(void *arg));
+
 /* pthread porting shims, spinlock or fallback to mutex */
 #if defined(HAVE_LIB_PTHREAD)
 #if defined(HAVE_LIB_PTHREAD_SPINLOCK) &&	\
@@ -294,6 +294,373 @@ int stress_rapl_get_power_stressor(stress_rapl_domain_t *rapl_domains, stress_ra
 	return 0;
 }
 
+/*
+ *  stress_rapl_is_package()
+ *	true if domain is a CPU package domain
+ */
+static inline bool stress_rapl_is_package(const stress_rapl_domain_t *rapl_domain)
+{
+	return !strncmp(rapl_domain->domain_name, "pkg-", 4);
+}
+
+/*
+ *  stress_rapl_package_watts()
+ *	sum of the package domain power of a stressor RAPL measurement
+ */
+double stress_rapl_package_watts(const stress_rapl_domain_t *rapl_domains, const stress_rapl_t *rapl)
+{
+	const stress_rapl_domain_t *rapl_domain;
+	double watts = 0.0;
+
+	for (rapl_domain = rapl_domains; rapl_domain; rapl_domain = rapl_domain->next) {
+		if (rapl_domain->index >= STRESS_RAPL_DOMAINS_MAX)
+			continue;
+		if (stress_rapl_is_package(rapl_domain))
+			watts += rapl->power_watts[rapl_domain->index];
+	}
+	return watts;
+}
+
+/*
+ *  stress_rapl_package_energy()
+ *	read the sum of the package domain energy counters, returns
+ *	-1 if no package domains can be read
+ */
+static int stress_rapl_package_energy(
+	const stress_rapl_domain_t *rapl_domains,
+	double *energy_uj,
+	double *max_energy_uj)
+{
+	const stress_rapl_domain_t *rapl_domain;
+	int ret = -1;
+
+	*energy_uj = 0.0;
+	*max_energy_uj = 0.0;
+	for (rapl_domain = rapl_domains; rapl_domain; rapl_domain = rapl_domain->next) {
+		char path[PATH_MAX];
+		FILE *fp;
+		double ujoules;
+
+		if (!stress_rapl_is_package(rapl_domain))
+			continue;
+		(void)snprintf(path, sizeof(path),
+			"/sys/class/powercap/%s/energy_uj",
+			rapl_domain->name);
+		if ((fp = fopen(path, "r")) == NULL)
+			continue;
+		if (fscanf(fp, "%lf\n", &ujoules) == 1) {
+			*energy_uj += ujoules;
+			if (*max_energy_uj < rapl_domain->max_energy_uj)
+				*max_energy_uj = rapl_domain->max_energy_uj;
+			ret = 0;
+		}
+		(void)fclose(fp);
+	}
+	return ret;
+}
+
+/*
+ *  stress_rapl_method()
+ *	account package energy, time and bogo ops to the method that
+ *	was running up to now and start accounting to method name. This
+ *	is called by stressors that iterate over all their methods,
+ *	name NULL ends the accounting. Package energy is system wide so
+ *	the per method breakdown is most accurate with just one instance.
+ */
+void stress_rapl_method(stress_args_t *args, const char *name)
+{
+	stress_rapl_t *rapl;
+	double now, energy_uj, max_energy_uj;
+	uint64_t ops;
+	size_t i;
+
+	if (!(g_opt_flags & OPT_FLAGS_RAPL) || !args->stats)
+		return;
+	if (stress_rapl_package_energy(g_shared->rapl_domains, &energy_uj, &max_energy_uj) < 0)
+		return;
+
+	rapl = &args->stats->rapl;
+	now = stress_time_now();
+	ops = stress_bogo_get(args);
+
+	if (rapl->methods.current < rapl->methods.n) {
+		stress_rapl_method_t *method = &rapl->methods.method[rapl->methods.current];
+		double delta_uj = energy_uj - rapl->methods.energy_uj;
+
+		/* counter wrapped? */
+		if (delta_uj < 0.0)
+			delta_uj += max_energy_uj;
+		method->energy_uj += delta_uj;
+		method->duration += now - rapl->methods.time;
+		if (ops > rapl->methods.ops)
+			method->ops += ops - rapl->methods.ops;
+	}
+	rapl->methods.current = rapl->methods.n;
+	if (!name)
+		return;
+
+	for (i = 0; i < rapl->methods.n; i++) {
+		if ((rapl->methods.method[i].name == name) ||
+		    !strcmp(rapl->methods.method[i].name, name))
+			break;
+	}
+	if (i == rapl->methods.n) {
+		if (i >= STRESS_RAPL_METHODS_MAX)
+			return;
+		rapl->methods.method[i].name = name;
+		rapl->methods.method[i].ops = 0;
+		rapl->methods.method[i].duration = 0.0;
+		rapl->methods.method[i].energy_uj = 0.0;
+		rapl->methods.n++;
+	}
+	rapl->methods.current = i;
+	rapl->methods.ops = ops;
+	rapl->methods.time = now;
+	rapl->methods.energy_uj = energy_uj;
+}
+
+/*
+ *  stress_rapl_energy()
+ *	compute mean package power, energy and bogo ops per Joule of a
+ *	stressor. Package power is system wide, so the energy used by all
+ *	the concurrent instances is the package power over the mean run
+ *	time. Returns false if there are no power measurements.
+ */
+static bool stress_rapl_energy(
+	const stress_rapl_domain_t *rapl_domains,
+	const stress_stressor_t *ss,
+	double *watts,
+	double *energy_j,
+	double *ops_per_j)
+{
+	uint64_t c_total = 0;
+	double r_total = 0.0, w_total = 0.0;
+	int32_t j, n = 0, completed = 0;
+
+	for (j = 0; j < ss->instances; j++) {
+		const stress_stats_t *const stats = ss->stats[j];
+		const double w = stress_rapl_package_watts(rapl_domains, &stats->rapl);
+
+		c_total += stats->counter_total;
+		if (stats->completed) {
+			r_total += stats->duration_total;
+			completed++;
+		}
+		if (w > 0.0) {
+			w_total += w;
+			n++;
+		}
+	}
+	if ((n == 0) || (completed == 0))
+		return false;
+
+	*watts = w_total / (double)n;
+	*energy_j = *watts * (r_total / (double)completed);
+	*ops_per_j = (*energy_j > 0.0) ? (double)c_total / *energy_j : 0.0;
+	return true;
+}
+
+/*
+ *  stress_rapl_energy_methods()
+ *	merge the per method energy accounting of all the instances
+ *	of a stressor into methods, method ops are scaled so that they
+ *	sum to the instance bogo ops count as some stressors count
+ *	bogo ops in finer grained units. Returns number of methods.
+ */
+static size_t stress_rapl_energy_methods(
+	const stress_stressor_t *ss,
+	stress_rapl_method_t *methods,
+	int32_t *instances)
+{
+	size_t n = 0;
+	int32_t j;
+
+	*instances = 0;
+	for (j = 0; j < ss->instances; j++) {
+		const stress_stats_t *const stats = ss->stats[j];
+		const stress_rapl_t *rapl = &stats->rapl;
+		uint64_t ops = 0;
+		double scale;
+		size_t i, k;
+
+		if (rapl->methods.n == 0)
+			continue;
+		(*instances)++;
+		for (i = 0; i < rapl->methods.n; i++)
+			ops += rapl->methods.method[i].ops;
+		scale = ops ? (double)stats->counter_total / (double)ops : 0.0;
+
+		for (i = 0; i < rapl->methods.n; i++) {
+			const stress_rapl_method_t *method = &rapl->methods.method[i];
+
+			for (k = 0; k < n; k++) {
+				if (!strcmp(methods[k].name, method->name))
+					break;
+			}
+			if (k == n) {
+				if (n >= STRESS_RAPL_METHODS_MAX)
+					continue;
+				methods[k].name = method->name;
+				methods[k].ops = 0;
+				methods[k].duration = 0.0;
+				methods[k].energy_uj = 0.0;
+				n++;
+			}
+			methods[k].ops += (uint64_t)((double)method->ops * scale);
+			methods[k].duration += method->duration;
+			methods[k].energy_uj += method->energy_uj;
+		}
+	}
+	return n;
+}
+
+/*
+ *  stress_rapl_method_energy()
+ *	mean package power and bogo ops per Joule of a merged method,
+ *	the method energy is the mean package power whilst running the
+ *	method over the mean time each instance ran the method for
+ */
+static void stress_rapl_method_energy(
+	const stress_rapl_method_t *method,
+	const int32_t instances,
+	double *watts,
+	double *ops_per_j)
+{
+	double energy_j;
+
+	*watts = (method->duration > 0.0) ?
+		(method->energy_uj / STRESS_DBL_MICROSECOND) / method->duration : 0.0;
+	energy_j = *watts * method->duration / (double)instances;
+	*ops_per_j = (energy_j > 0.0) ? (double)method->ops / energy_j : 0.0;
+}
+
+/*
+ *  stress_rapl_metrics_yaml()
+ *	add energy efficiency metrics to a stressor's YAML metrics
+ */
+void stress_rapl_metrics_yaml(
+	FILE *yaml,
+	const stress_stressor_t *ss,
+	const stress_rapl_domain_t *rapl_domains)
+{
+	stress_rapl_method_t methods[STRESS_RAPL_METHODS_MAX];
+	double watts, energy_j, ops_per_j;
+	int32_t instances;
+	size_t i, n;
+
+	if (!stress_rapl_energy(rapl_domains, ss, &watts, &energy_j, &ops_per_j))
+		return;
+
+	pr_yaml(yaml, "      package-watts: %f\n", watts);
+	pr_yaml(yaml, "      energy-joules: %f\n", energy_j);
+	pr_yaml(yaml, "      bogo-ops-per-joule: %f\n", ops_per_j);
+
+	n = stress_rapl_energy_methods(ss, methods, &instances);
+	for (i = 0; i < n; i++) {
+		stress_rapl_method_energy(&methods[i], instances, &watts, &ops_per_j);
+		pr_yaml(yaml, "      method-%s-package-watts: %f\n", methods[i].name, watts);
+		pr_yaml(yaml, "      method-%s-bogo-ops-per-joule: %f\n", methods[i].name, ops_per_j);
+	}
+}
+
+/*
+ *  stress_rapl_metrics_dump()
+ *	dump energy efficiency metrics table
+ */
+void stress_rapl_metrics_dump(
+	const stress_stressor_t *stressors_list,
+	const stress_rapl_domain_t *rapl_domains)
+{
+	const stress_stressor_t *ss;
+	bool header = false;
+
+	for (ss = stressors_list; ss; ss = ss->next) {
+		stress_rapl_method_t methods[STRESS_RAPL_METHODS_MAX];
+		double watts, energy_j, ops_per_j;
+		int32_t instances;
+		size_t i, n;
+
+		if (ss->ignore.run || ss->ignore.permute)
+			continue;
+		if (!ss->stats)
+			continue;
+		if (!stress_rapl_energy(rapl_domains, ss, &watts, &energy_j, &ops_per_j))
+			continue;
+
+		if (!header) {
+			pr_metrics("energy metrics (RAPL package power):\n");
+			pr_metrics("%-13s %-20s %10s %12s %14s\n",
+				"stressor", "method", "Watts", "Joules", "bogo ops/J");
+			header = true;
+		}
+		pr_metrics("%-13s %-20s %10.2f %12.2f %14.2f\n",
+			ss->stressor->name, "", watts, energy_j, ops_per_j);
+
+		n = stress_rapl_energy_methods(ss, methods, &instances);
+		for (i = 0; i < n; i++) {
+			stress_rapl_method_energy(&methods[i], instances, &watts, &ops_per_j);
+			pr_metrics("%-13s %-20.20s %10.2f %12.2f %14.2f\n",
+				"", methods[i].name, watts,
+				watts * methods[i].duration / (double)instances, ops_per_j);
+		}
+	}
+}
+
+/*
+ *  stress_rapl_json()
+ *	add the per domain mean power and package energy of a
+ *	stressor to a JSON record
+ */
+void stress_rapl_json(
+	stress_json_t *json,
+	const stress_stressor_t *ss,
+	const stress_rapl_domain_t *rapl_domains)
+{
+	const stress_rapl_domain_t *rapl_domain;
+	double watts, energy_j, ops_per_j;
+	bool begun = false;
+
+	if (!ss->stats)
+		return;
+
+	for (rapl_domain = rapl_domains; rapl_domain; rapl_domain = rapl_domain->next) {
+		const size_t i = rapl_domain->index;
+		double harmonic_total = 0.0;
+		int count = 0;
+		int32_t j;
+
+		if (i >= STRESS_RAPL_DOMAINS_MAX)
+			continue;
+		for (j = 0; j < ss->instances; j++) {
+			const double power = ss->stats[j]->rapl.power_watts[i];
+
+			if (power > 0.0) {
+				harmonic_total += 1.0 / power;
+				count++;
+			}
+		}
+		if (harmonic_total > 0.0) {
+			if (!begun) {
+				stress_json_object_begin(json, "rapl");
+				begun = true;
+			}
+			stress_json_double(json, rapl_domain->domain_name,
+				(double)count / harmonic_total);
+		}
+	}
+	if (stress_rapl_energy(rapl_domains, ss, &watts, &energy_j, &ops_per_j)) {
+		if (!begun) {
+			stress_json_object_begin(json, "rapl");
+			begun = true;
+		}
+		stress_json_double(json, "package-watts", watts);
+		stress_json_double(json, "package-joules", energy_j);
+		stress_json_double(json, "bogo-ops-per-joule", ops_per_j);
+	}
+	if (begun)
+		stress_json_object_end(json);
+}
+
 /*
  *  stress_rapl_dump()
  *	dump rapl power measurements
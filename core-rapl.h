@@ -27,8 +27,10 @@
 
 #define STRESS_RAPL
 #define STRESS_RAPL_DOMAINS_MAX		(32)
+#define STRESS_RAPL_METHODS_MAX		(128)
 
 #include "stress-ng.h"
+#include "core-json.h"
 
 #define STRESS_RAPL_DATA_RAPLSTAT	(0)
 #define STRESS_RAPL_DATA_STRESSOR	(1)
@@ -50,15 +52,39 @@ typedef struct stress_rapl_domain {
 	stress_rapl_data_t data[STRESS_RAPL_DATA_MAX];
 } stress_rapl_domain_t;
 
+/* Per method package energy, for stressors that iterate over all methods */
+typedef struct {
+	const char *name;		/* method name */
+	uint64_t ops;			/* bogo ops counted whilst running method */
+	double duration;		/* time spent running method */
+	double energy_uj;		/* package energy used in micro Joules */
+} stress_rapl_method_t;
+
 typedef struct {
 	double read_time;
         double power_watts[STRESS_RAPL_DOMAINS_MAX];
+	struct {
+		size_t n;		/* number of methods used */
+		size_t current;		/* index of running method, n if none */
+		uint64_t ops;		/* bogo ops at start of current method */
+		double time;		/* time at start of current method */
+		double energy_uj;	/* package energy at start of current method */
+		stress_rapl_method_t method[STRESS_RAPL_METHODS_MAX];
+	} methods;
 } stress_rapl_t;
 
 extern void stress_rapl_free_domains(stress_rapl_domain_t *rapl_domains);
 extern int stress_rapl_get_domains(stress_rapl_domain_t **rapl_domains);
 extern int stress_rapl_get_power_raplstat(stress_rapl_domain_t *rapl_domains);
 extern int stress_rapl_get_power_stressor(stress_rapl_domain_t *rapl_domains, stress_rapl_t *rapl);
+extern double stress_rapl_package_watts(const stress_rapl_domain_t *rapl_domains, const stress_rapl_t *rapl);
+extern void stress_rapl_method(stress_args_t *args, const char *name);
+extern void stress_rapl_metrics_yaml(FILE *yaml, const stress_stressor_t *ss,
+	const stress_rapl_domain_t *rapl_domains);
+extern void stress_rapl_metrics_dump(const stress_stressor_t *stressors_list,
+	const stress_rapl_domain_t *rapl_domains);
+extern void stress_rapl_json(stress_json_t *json, const stress_stressor_t *ss,
+	const stress_rapl_domain_t *rapl_domains);
 extern void stress_rapl_dump(FILE *yaml, stress_stressor_t *stressors_list, stress_rapl_domain_t *rapl_domains);
 #endif
 
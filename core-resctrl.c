@@ -0,0 +1,485 @@
+/*
+ * Copyright (C) 2025      Colin Ian King.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+#include "stress-ng.h"
+#include "core-builtin.h"
+#include "core-resctrl.h"
+
+#include <ctype.h>
+
+#define RESCTRL_MAX		(64)	/* maximum --resctrl allocations */
+#define RESCTRL_PATH		"/sys/fs/resctrl"
+
+/* a --resctrl allocation applied to a stressor's resctrl group */
+typedef struct {
+	char	*stressor;		/* stressor name */
+	char	*resource;		/* schemata resource, e.g. L3 or MB */
+	char	*value;			/* cache bit mask or bandwidth percentage */
+} stress_resctrl_t;
+
+/* schemata resources that can be allocated */
+static const char * const resctrl_resources[] = {
+	"L2",
+	"L3",
+	"MB",
+};
+
+static stress_resctrl_t resctrls[RESCTRL_MAX];
+static size_t resctrls_n;
+static bool resctrl_created;		/* true if resctrl groups were created */
+static double resctrl_time_start;	/* time resctrl groups were created */
+
+/*
+ *  stress_resctrl_add()
+ *	parse a --resctrl STRESSOR:RESOURCE=VALUE option, RESOURCE
+ *	is L2 or L3 with a hexadecimal cache allocation bit mask
+ *	or MB with a memory bandwidth allocation percentage
+ */
+int stress_resctrl_add(const char *opt)
+{
+	stress_resctrl_t *rc;
+	char *str, *colon, *equals, *ptr;
+	size_t i;
+
+	if (resctrls_n >= RESCTRL_MAX) {
+		(void)fprintf(stderr, "resctrl: too many allocations, maximum is %d\n",
+			RESCTRL_MAX);
+		return -1;
+	}
+	str = strdup(opt);
+	if (!str) {
+		(void)fprintf(stderr, "resctrl: out of memory\n");
+		return -1;
+	}
+	colon = strchr(str, ':');
+	equals = colon ? strchr(colon, '=') : NULL;
+	if (!colon || !equals || (colon == str) || (equals == colon + 1) || !equals[1]) {
+		(void)fprintf(stderr, "resctrl: invalid option '%s', "
+			"expecting STRESSOR:RESOURCE=VALUE\n", opt);
+		free(str);
+		return -1;
+	}
+	*colon = '\0';
+	*equals = '\0';
+	for (ptr = colon + 1; *ptr; ptr++)
+		*ptr = (char)toupper((unsigned char)*ptr);
+
+	rc = &resctrls[resctrls_n];
+	rc->stressor = strdup(str);
+	rc->resource = strdup(colon + 1);
+	rc->value = strdup(equals + 1);
+	free(str);
+	if (!rc->stressor || !rc->resource || !rc->value) {
+		(void)fprintf(stderr, "resctrl: out of memory\n");
+		goto err;
+	}
+	for (i = 0; i < SIZEOF_ARRAY(resctrl_resources); i++) {
+		if (!strcmp(rc->resource, resctrl_resources[i]))
+			break;
+	}
+	if (i == SIZEOF_ARRAY(resctrl_resources)) {
+		(void)fprintf(stderr, "resctrl: unsupported resource '%s', expecting one of:",
+			rc->resource);
+		for (i = 0; i < SIZEOF_ARRAY(resctrl_resources); i++)
+			(void)fprintf(stderr, " %s", resctrl_resources[i]);
+		(void)fprintf(stderr, "\n");
+		goto err;
+	}
+	ptr = rc->value;
+	if (!strcmp(rc->resource, "MB")) {
+		const unsigned long int pc = strtoul(ptr, &ptr, 10);
+
+		if (*ptr || (pc < 1) || (pc > 100)) {
+			(void)fprintf(stderr, "resctrl: invalid MB value '%s', "
+				"expecting a percentage 1..100\n", rc->value);
+			goto err;
+		}
+	} else {
+		if (!strncasecmp(ptr, "0x", 2))
+			ptr += 2;
+		if (!*ptr || (strspn(ptr, "0123456789abcdefABCDEF") != strlen(ptr))) {
+			(void)fprintf(stderr, "resctrl: invalid %s value '%s', "
+				"expecting a hexadecimal cache bit mask\n", rc->resource, rc->value);
+			goto err;
+		}
+		(void)memmove(rc->value, ptr, strlen(ptr) + 1);
+	}
+	resctrls_n++;
+	return 0;
+err:
+	free(rc->stressor);
+	free(rc->resource);
+	free(rc->value);
+	(void)shim_memset(rc, 0, sizeof(*rc));
+	return -1;
+}
+
+#if defined(__linux__)
+/*
+ *  stress_resctrl_group()
+ *	get the resctrl group path of a stressor
+ */
+static void stress_resctrl_group(char *path, const size_t path_len, const char *name)
+{
+	(void)snprintf(path, path_len, RESCTRL_PATH "/stress-ng-%" PRIdMAX "-%s",
+		(intmax_t)getpid(), name);
+}
+
+/*
+ *  stress_resctrl_first()
+ *	return true if allocation i is the first one for its stressor
+ */
+static bool stress_resctrl_first(const size_t i)
+{
+	size_t j;
+
+	for (j = 0; j < i; j++) {
+		if (!strcmp(resctrls[j].stressor, resctrls[i].stressor))
+			return false;
+	}
+	return true;
+}
+
+/*
+ *  stress_resctrl_schemata()
+ *	build a schemata line that sets value on all the domains
+ *	of a resource, the domains are taken from the default group
+ */
+static int stress_resctrl_schemata(
+	const char *resource,
+	const char *value,
+	char *line,
+	const size_t line_len)
+{
+	char buf[4096], *str, *saveptr = NULL;
+	const size_t len = strlen(resource);
+
+	if (stress_system_read(RESCTRL_PATH "/schemata", buf, sizeof(buf)) <= 0)
+		return -1;
+
+	for (str = strtok_r(buf, "\n", &saveptr); str; str = strtok_r(NULL, "\n", &saveptr)) {
+		char *domain, *saveptr2 = NULL;
+		size_t n = 0;
+		int ret;
+
+		str += strspn(str, " ");
+		if (strncmp(str, resource, len) || (str[len] != ':'))
+			continue;
+
+		ret = snprintf(line, line_len, "%s:", resource);
+		if ((ret < 0) || ((size_t)ret >= line_len))
+			return -1;
+		n = (size_t)ret;
+		for (domain = strtok_r(str + len + 1, ";", &saveptr2); domain;
+		     domain = strtok_r(NULL, ";", &saveptr2)) {
+			ret = snprintf(line + n, line_len - n, "%s%d=%s",
+				(line[n - 1] == ':') ? "" : ";", atoi(domain), value);
+			if ((ret < 0) || ((size_t)ret >= line_len - n))
+				return -1;
+			n += (size_t)ret;
+		}
+		return (snprintf(line + n, line_len - n, "\n") == 1) ? 0 : -1;
+	}
+	return -1;
+}
+
+/*
+ *  stress_resctrl_mon()
+ *	sum a monitoring counter over all the L3 domains of a
+ *	resctrl group, returns false if it cannot be read
+ */
+static bool stress_resctrl_mon(const char *group, const char *counter, uint64_t *val)
+{
+	char path[PATH_MAX + 64];
+	DIR *dir;
+	const struct dirent *d;
+	bool ok = false;
+
+	*val = 0;
+	(void)snprintf(path, sizeof(path), "%s/mon_data", group);
+	dir = opendir(path);
+	if (!dir)
+		return false;
+	while ((d = readdir(dir)) != NULL) {
+		char filename[PATH_MAX * 2], buf[64], *end;
+		uint64_t v;
+
+		if (strncmp(d->d_name, "mon_L3_", 7))
+			continue;
+		if (snprintf(filename, sizeof(filename), "%s/%s/%s", path, d->d_name, counter) >= (int)sizeof(filename))
+			continue;
+		if (stress_system_read(filename, buf, sizeof(buf)) <= 0)
+			continue;
+		/* counters read as Unavailable or Error when not valid */
+		v = (uint64_t)strtoull(buf, &end, 10);
+		if (end == buf)
+			continue;
+		*val += v;
+		ok = true;
+	}
+	(void)closedir(dir);
+	return ok;
+}
+#endif
+
+/*
+ *  stress_resctrl_setup()
+ *	create a resctrl control and monitoring group for each stressor
+ *	that has --resctrl allocations and write the allocations to the
+ *	group schemata
+ */
+void stress_resctrl_setup(stress_stressor_t *stressors_list)
+{
+#if defined(__linux__)
+	char group[PATH_MAX], line[4096];
+	size_t i;
+
+	if (!resctrls_n)
+		return;
+
+	for (i = 0; i < resctrls_n; i++) {
+		const stress_stressor_t *ss;
+
+		for (ss = stressors_list; ss; ss = ss->next) {
+			if (!ss->ignore.run && !strcmp(ss->stressor->name, resctrls[i].stressor))
+				break;
+		}
+		if (!ss)
+			pr_inf("resctrl: stressor %s is not being run, ignoring %s=%s\n",
+				resctrls[i].stressor, resctrls[i].resource, resctrls[i].value);
+	}
+
+	if (access(RESCTRL_PATH "/schemata", R_OK) < 0) {
+		pr_inf("resctrl: %s is not mounted, ignoring --resctrl options\n", RESCTRL_PATH);
+		return;
+	}
+
+	for (i = 0; i < resctrls_n; i++) {
+		const stress_resctrl_t *rc = &resctrls[i];
+		char filename[PATH_MAX + 16];
+		ssize_t ret;
+
+		stress_resctrl_group(group, sizeof(group), rc->stressor);
+		if ((mkdir(group, S_IRWXU) < 0) && (errno != EEXIST)) {
+			pr_inf("resctrl: cannot create group %s, errno=%d (%s)%s\n",
+				group, errno, strerror(errno),
+				(errno == ENOSPC) ? ", no free CLOS or RMID" : "");
+			continue;
+		}
+		resctrl_created = true;
+		if (stress_resctrl_schemata(rc->resource, rc->value, line, sizeof(line)) < 0) {
+			pr_inf("resctrl: resource %s is not available, ignoring %s:%s=%s\n",
+				rc->resource, rc->stressor, rc->resource, rc->value);
+			continue;
+		}
+		(void)snprintf(filename, sizeof(filename), "%s/schemata", group);
+		ret = stress_system_write(filename, line, strlen(line));
+		if (ret < 0) {
+			pr_inf("resctrl: cannot set %s schemata '%.*s', errno=%d (%s), "
+				"see %s/info/last_cmd_status\n", rc->stressor,
+				(int)strcspn(line, "\n"), line, (int)-ret, strerror((int)-ret),
+				RESCTRL_PATH);
+			continue;
+		}
+		pr_dbg("resctrl: %s schemata set to '%.*s'\n", rc->stressor,
+			(int)strcspn(line, "\n"), line);
+	}
+	resctrl_time_start = stress_time_now();
+#else
+	(void)stressors_list;
+
+	if (resctrls_n)
+		pr_inf("resctrl: resctrl is not supported on this system, "
+			"ignoring --resctrl options\n");
+#endif
+}
+
+/*
+ *  stress_resctrl_join()
+ *	move a stressor process into its resctrl group
+ */
+void stress_resctrl_join(const char *name)
+{
+#if defined(__linux__)
+	char group[PATH_MAX], filename[PATH_MAX + 16], pid[32];
+	size_t i;
+	ssize_t ret;
+
+	if (!resctrl_created)
+		return;
+	for (i = 0; i < resctrls_n; i++) {
+		if (!strcmp(resctrls[i].stressor, name))
+			break;
+	}
+	if (i == resctrls_n)
+		return;
+
+	stress_resctrl_group(group, sizeof(group), name);
+	(void)snprintf(filename, sizeof(filename), "%s/tasks", group);
+	(void)snprintf(pid, sizeof(pid), "%" PRIdMAX "\n", (intmax_t)getpid());
+	ret = stress_system_write(filename, pid, strlen(pid));
+	if (ret < 0)
+		pr_dbg("%s: cannot move into resctrl group %s, errno=%d (%s)\n",
+			name, group, (int)-ret, strerror((int)-ret));
+#else
+	(void)name;
+#endif
+}
+
+/*
+ *  stress_resctrl_sample()
+ *	sample the LLC occupancy of a stressor's resctrl group, this
+ *	is called by each stressor instance as it finishes so the
+ *	occupancy is sampled while the stressor is still cache hot
+ */
+void stress_resctrl_sample(const char *name, uint64_t *llc_occupancy)
+{
+#if defined(__linux__)
+	char group[PATH_MAX];
+	size_t i;
+
+	if (!resctrl_created)
+		return;
+	for (i = 0; i < resctrls_n; i++) {
+		if (!strcmp(resctrls[i].stressor, name))
+			break;
+	}
+	if (i == resctrls_n)
+		return;
+
+	stress_resctrl_group(group, sizeof(group), name);
+	(void)stress_resctrl_mon(group, "llc_occupancy", llc_occupancy);
+#else
+	(void)name;
+	(void)llc_occupancy;
+#endif
+}
+
+/*
+ *  stress_resctrl_dump()
+ *	report the LLC occupancy and memory bandwidth of the stressor
+ *	resctrl groups, the bandwidth is averaged over the run
+ */
+void stress_resctrl_dump(FILE *yaml, stress_stressor_t *stressors_list)
+{
+#if defined(__linux__)
+	bool header = false;
+	double duration;
+	size_t i, j;
+
+	if (!resctrl_created)
+		return;
+
+	duration = stress_time_now() - resctrl_time_start;
+	pr_block_begin();
+	for (i = 0; i < resctrls_n; i++) {
+		const char *name = resctrls[i].stressor;
+		const stress_stressor_t *ss;
+		char group[PATH_MAX];
+		uint64_t llc_occupancy = 0, mbm_total, mbm_local;
+		bool has_total, has_local;
+		double total_rate, local_rate;
+		int32_t k;
+
+		if (!stress_resctrl_first(i))
+			continue;
+		for (ss = stressors_list; ss; ss = ss->next) {
+			if (!strcmp(ss->stressor->name, name))
+				break;
+		}
+		if (!ss || !ss->stats)
+			continue;
+		for (k = 0; k < ss->instances; k++) {
+			if (ss->stats[k]->resctrl_llc_occupancy > llc_occupancy)
+				llc_occupancy = ss->stats[k]->resctrl_llc_occupancy;
+		}
+
+		stress_resctrl_group(group, sizeof(group), name);
+		has_total = stress_resctrl_mon(group, "mbm_total_bytes", &mbm_total);
+		has_local = stress_resctrl_mon(group, "mbm_local_bytes", &mbm_local);
+		if (!has_total && !has_local && !llc_occupancy)
+			continue;
+		total_rate = (has_total && (duration > 0.0)) ? (double)mbm_total / duration : 0.0;
+		local_rate = (has_local && (duration > 0.0)) ? (double)mbm_local / duration : 0.0;
+
+		if (!header) {
+			pr_inf("resctrl: %-13s %12s %12s %12s\n",
+				"stressor", "LLC occupancy", "total MB/sec", "local MB/sec");
+			pr_yaml(yaml, "resctrl:\n");
+			header = true;
+		}
+		pr_inf("resctrl: %-13s %10.2fMB %12.2f %12.2f\n", name,
+			(double)llc_occupancy / (double)MB,
+			total_rate / (double)MB, local_rate / (double)MB);
+
+		pr_yaml(yaml, "    - stressor: %s\n", name);
+		for (j = i; j < resctrls_n; j++) {
+			if (!strcmp(resctrls[j].stressor, name))
+				pr_yaml(yaml, "      %s: '%s'\n", resctrls[j].resource,
+					resctrls[j].value);
+		}
+		pr_yaml(yaml, "      llc-occupancy-bytes: %" PRIu64 "\n", llc_occupancy);
+		if (has_total) {
+			pr_yaml(yaml, "      mbm-total-bytes: %" PRIu64 "\n", mbm_total);
+			pr_yaml(yaml, "      mbm-total-bytes-per-sec: %.2f\n", total_rate);
+		}
+		if (has_local) {
+			pr_yaml(yaml, "      mbm-local-bytes: %" PRIu64 "\n", mbm_local);
+			pr_yaml(yaml, "      mbm-local-bytes-per-sec: %.2f\n", local_rate);
+		}
+	}
+	if (header)
+		pr_yaml(yaml, "\n");
+	pr_block_end();
+#else
+	(void)yaml;
+	(void)stressors_list;
+#endif
+}
+
+/*
+ *  stress_resctrl_cleanup()
+ *	remove the stressor resctrl groups, this frees the CLOS and
+ *	RMIDs and moves any remaining tasks back to the default group
+ */
+void stress_resctrl_cleanup(void)
+{
+	size_t i;
+
+#if defined(__linux__)
+	if (resctrl_created) {
+		char group[PATH_MAX];
+
+		for (i = 0; i < resctrls_n; i++) {
+			if (!stress_resctrl_first(i))
+				continue;
+			stress_resctrl_group(group, sizeof(group), resctrls[i].stressor);
+			if ((shim_rmdir(group) < 0) && (errno != ENOENT))
+				pr_dbg("resctrl: cannot remove group %s, errno=%d (%s)\n",
+					group, errno, strerror(errno));
+		}
+		resctrl_created = false;
+	}
+#endif
+	for (i = 0; i < resctrls_n; i++) {
+		free(resctrls[i].stressor);
+		free(resctrls[i].resource);
+		free(resctrls[i].value);
+	}
+	resctrls_n = 0;
+}
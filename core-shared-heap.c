@@ -17,6 +17,7 @@
  *
  */
 #include "stress-ng.h"
+#include "core-hash.h"
 #include "core-lock.h"
 #include "core-madvise.h"
 #include "core-stressors.h"
@@ -40,6 +41,19 @@ enum {
         STRESS_MAX
 };
 
+/* Number of hash buckets for the intern table of dup'd strings */
+#define STRESS_SHARED_HEAP_HASH_SIZE		(256)
+
+/*
+ *  Lock-free allocation and string interning can be used if
+ *  atomic fetch-add and compare-exchange are available
+ */
+#if defined(HAVE_ATOMIC_FETCH_ADD) &&		\
+    defined(HAVE_ATOMIC_COMPARE_EXCHANGE) &&	\
+    defined(HAVE_ATOMIC_LOAD)
+#define STRESS_SHARED_HEAP_LOCK_FREE
+#endif
+
 typedef struct stress_shared_heap_str {
 	struct stress_shared_heap_str	*next;
 	char str[];
@@ -47,21 +61,24 @@ typedef struct stress_shared_heap_str {
 
 /*
  *  stress_shared_heap_init()
- *	initialized shared heap
+ *	initialized shared heap, metrics_size is the space reserved for
+ *	the lazily allocated per stressor instance misc metrics. The heap
+ *	is not populated, pages of the reserved space that are never
+ *	used are never faulted in.
  */
-void *stress_shared_heap_init(void)
+void *stress_shared_heap_init(const size_t metrics_size)
 {
 	const size_t page_size = stress_get_page_size();
+	const size_t hash_size = sizeof(stress_shared_heap_str_t *) * STRESS_SHARED_HEAP_HASH_SIZE;
 
 	/* Allocate enough heap for all stressor descriptions with 100% metrics allocated */
 	size_t size = (STRESS_MISC_METRICS_MAX * (32 + sizeof(void *)) * STRESS_MAX);
 
-	size = STRESS_MINIMUM(size, STRESS_MAX_SHARED_HEAP_SIZE);
+	size = STRESS_MINIMUM(size, STRESS_MAX_SHARED_HEAP_SIZE) + hash_size + metrics_size;
 	g_shared->shared_heap.out_of_memory = false;
 	g_shared->shared_heap.heap_size = (size + page_size - 1) & ~(page_size - 1);
-	g_shared->shared_heap.str_list_head = NULL;
-	g_shared->shared_heap.heap = stress_mmap_populate(NULL, size,
-					PROT_READ | PROT_WRITE,
+	g_shared->shared_heap.str_hash_table = NULL;
+	g_shared->shared_heap.heap = mmap(NULL, size, PROT_READ | PROT_WRITE,
 					MAP_ANONYMOUS | MAP_SHARED, -1, 0);
 	if (UNLIKELY(g_shared->shared_heap.heap == MAP_FAILED)) {
 		g_shared->shared_heap.lock = NULL;
@@ -69,10 +86,16 @@ void *stress_shared_heap_init(void)
 	}
 	stress_set_vma_anon_name(g_shared->shared_heap.heap, size, "shared-heap");
 	(void)stress_madvise_mergeable(g_shared->shared_heap.heap, size);
+
+	/* Intern hash table lives at the start of the heap, mmap'd pages are zero'd */
+	g_shared->shared_heap.str_hash_table = g_shared->shared_heap.heap;
+	g_shared->shared_heap.offset = hash_size;
+
 	g_shared->shared_heap.lock = stress_lock_create("shared-heap");
 	if (UNLIKELY(!g_shared->shared_heap.lock)) {
 		(void)munmap((void *)g_shared->shared_heap.heap, g_shared->shared_heap.heap_size);
 		g_shared->shared_heap.heap = NULL;
+		g_shared->shared_heap.str_hash_table = NULL;
 		return NULL;
 	}
 	return g_shared->shared_heap.lock;
@@ -95,6 +118,7 @@ void stress_shared_heap_free(void)
 	if (g_shared->shared_heap.heap) {
 		(void)munmap((void *)g_shared->shared_heap.heap, g_shared->shared_heap.heap_size);
 		g_shared->shared_heap.heap = NULL;
+		g_shared->shared_heap.str_hash_table = NULL;
 	}
 	if (g_shared->shared_heap.lock) {
 		(void)stress_lock_destroy(g_shared->shared_heap.lock);
@@ -107,27 +131,56 @@ void stress_shared_heap_free(void)
  *  stress_shared_heap_malloc()
  *	Primitive non-free'ing heap allocator. Just return next allocated chunk from
  *	the shared memory heap. We don't use need a per-object free'ing, so no need
- *	to keep track of holes or do hole coalescing. Keep it simple for now.
+ *	to keep track of holes or do hole coalescing. Keep it simple for now. Where
+ *	possible this is a lock-free atomic bump of the heap offset. Chunks are
+ *	64 bit aligned so doubles in metrics items are naturally aligned.
  */
 void *stress_shared_heap_malloc(const size_t size)
 {
-	ssize_t heap_free;
-	void *ptr;
+	const size_t aligned_size = (size + sizeof(uint64_t) - 1) & ~(sizeof(uint64_t) - 1);
+	size_t offset;
 
+	if (UNLIKELY(!g_shared->shared_heap.heap))
+		return NULL;
+#if defined(STRESS_SHARED_HEAP_LOCK_FREE)
+	offset = __atomic_fetch_add(&g_shared->shared_heap.offset, aligned_size, __ATOMIC_RELAXED);
+	if (UNLIKELY(offset + size > g_shared->shared_heap.heap_size)) {
+		g_shared->shared_heap.out_of_memory = true;
+		return NULL;
+	}
+#else
 	if (UNLIKELY(stress_lock_acquire(g_shared->shared_heap.lock) < 0))
 		return NULL;
 
-	heap_free = g_shared->shared_heap.heap_size - g_shared->shared_heap.offset;
-	if (heap_free < (ssize_t)size) {
+	offset = g_shared->shared_heap.offset;
+	if (offset + size > g_shared->shared_heap.heap_size) {
 		g_shared->shared_heap.out_of_memory = true;
 		(void)stress_lock_release(g_shared->shared_heap.lock);
 		return NULL;
 	}
-	ptr = (void *)((uintptr_t)g_shared->shared_heap.heap + g_shared->shared_heap.offset);
-	g_shared->shared_heap.offset += (size + sizeof(void *) - 1) & ~(sizeof(void *) - 1);
+	g_shared->shared_heap.offset += aligned_size;
 	(void)stress_lock_release(g_shared->shared_heap.lock);
+#endif
+	return (void *)((uintptr_t)g_shared->shared_heap.heap + offset);
+}
+
+/*
+ *  stress_shared_heap_str_find()
+ *	find str in hash bucket list from head up to (but not including) end,
+ *	returns NULL if not found
+ */
+static stress_shared_heap_str_t *stress_shared_heap_str_find(
+	stress_shared_heap_str_t *head,
+	const stress_shared_heap_str_t *end,
+	const char *str)
+{
+	stress_shared_heap_str_t *heap_str;
 
-	return ptr;
+	for (heap_str = head; heap_str && (heap_str != end); heap_str = heap_str->next) {
+		if (strcmp(str, heap_str->str) == 0)
+			return heap_str;
+	}
+	return NULL;
 }
 
 /*
@@ -136,23 +189,33 @@ void *stress_shared_heap_malloc(const size_t size)
  *	modified as this dup operation re-used existing identical strings
  *	allocated on the shared heap. This is designed for storing metric
  *	descriptions that get allocated per stressor and we want to reduce
- *	duplicated allocations where possible.
+ *	duplicated allocations where possible. Strings are interned in a
+ *	hash table of bucket lists that are prepended to with compare-exchange
+ *	so no lock is required.
  */
 char *stress_shared_heap_dup_const(const char *str)
 {
 	size_t len, str_len;
-	stress_shared_heap_str_t *heap_str;
+	stress_shared_heap_str_t *heap_str, *head, *found;
+	stress_shared_heap_str_t **bucket;
 
-	if (UNLIKELY(stress_lock_acquire(g_shared->shared_heap.lock) < 0))
+	if (UNLIKELY(!g_shared->shared_heap.str_hash_table))
 		return NULL;
 
-	for (heap_str = (stress_shared_heap_str_t *)g_shared->shared_heap.str_list_head; heap_str; heap_str = heap_str->next) {
-		if (strcmp(str, heap_str->str) == 0) {
-			(void)stress_lock_release(g_shared->shared_heap.lock);
-			return heap_str->str;
-		}
-	}
+	bucket = &((stress_shared_heap_str_t **)g_shared->shared_heap.str_hash_table)
+			[stress_hash_fnv1a(str) % STRESS_SHARED_HEAP_HASH_SIZE];
+#if defined(STRESS_SHARED_HEAP_LOCK_FREE)
+	__atomic_load(bucket, &head, __ATOMIC_ACQUIRE);
+#else
+	if (UNLIKELY(stress_lock_acquire(g_shared->shared_heap.lock) < 0))
+		return NULL;
+	head = *bucket;
 	(void)stress_lock_release(g_shared->shared_heap.lock);
+#endif
+	found = stress_shared_heap_str_find(head, NULL, str);
+	if (found)
+		return found->str;
+
 	str_len = strlen(str) + 1;
 	len = str_len + sizeof(void *);
 	heap_str = (stress_shared_heap_str_t *)stress_shared_heap_malloc(len);
@@ -160,8 +223,22 @@ char *stress_shared_heap_dup_const(const char *str)
 		return NULL;
 
 	(void)shim_strscpy(heap_str->str, str, str_len);
-	heap_str->next = NULL;
 
+#if defined(STRESS_SHARED_HEAP_LOCK_FREE)
+	/*
+	 *  Prepend to the bucket list, if another process got there first
+	 *  check the newly added entries in case the same string was added
+	 *  and re-use that, wasting our allocation
+	 */
+	heap_str->next = head;
+	while (!__atomic_compare_exchange_n(bucket, &heap_str->next, heap_str,
+					    false, __ATOMIC_RELEASE, __ATOMIC_ACQUIRE)) {
+		found = stress_shared_heap_str_find(heap_str->next, head, str);
+		if (found)
+			return found->str;
+		head = heap_str->next;
+	}
+#else
 	/*
 	 *  We failed to acquire so we can't add to list, return dup'd string
 	 *  and skip adding it to the list, at least the dup worked!
@@ -172,10 +249,10 @@ char *stress_shared_heap_dup_const(const char *str)
 	/*
 	 *  Save a copy so it can be re-used
 	 */
-	heap_str->next = (stress_shared_heap_str_t *)g_shared->shared_heap.str_list_head;
-	g_shared->shared_heap.str_list_head = (void *)heap_str;
+	heap_str->next = *bucket;
+	*bucket = heap_str;
 
 	(void)stress_lock_release(g_shared->shared_heap.lock);
+#endif
 	return heap_str->str;
 }
-
@@ -0,0 +1,511 @@
+/*
+ * Copyright (C) 2025      Colin Ian King.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+#include "stress-ng.h"
+#include "core-affinity.h"
+#include "core-builtin.h"
+#include "core-latency.h"
+#include "core-pthread.h"
+#include "core-siglat.h"
+
+#if defined(HAVE_SYS_SIGNALFD_H)
+#include <sys/signalfd.h>
+#endif
+
+#if defined(HAVE_SYS_SIGNALFD_H) &&	\
+    defined(HAVE_SIGNALFD) &&		\
+    NEED_GLIBC(2,8,0)
+#define STRESS_SIGLAT_HAVE_SIGNALFD
+#endif
+
+#if defined(HAVE_LIB_PTHREAD) &&	\
+    defined(HAVE_PTHREAD_SIGQUEUE)
+#define STRESS_SIGLAT_HAVE_PTHREAD_SIGQUEUE
+#endif
+
+/* round trips between sender same CPU / cross CPU placement switches */
+#define STRESS_SIGLAT_SWITCH	(4096)
+
+static const char * const stress_siglat_methods[] = {
+	"kill",			/* STRESS_SIGLAT_KILL */
+	"sigqueue",		/* STRESS_SIGLAT_SIGQUEUE */
+	"sigwaitinfo",		/* STRESS_SIGLAT_SIGWAITINFO */
+	"signalfd",		/* STRESS_SIGLAT_SIGNALFD */
+	"pthread_sigqueue",	/* STRESS_SIGLAT_PTHREAD_SIGQUEUE */
+};
+
+#if defined(HAVE_SIGQUEUE) &&	\
+    defined(SA_SIGINFO)
+
+/*
+ *  ping-pong state shared by the receiver (the stressor) and the
+ *  sender (a child process or, for pthread_sigqueue, a thread).
+ *  Only one signal is in flight at a time, the sender time stamps
+ *  it into t_send and the payload and waits for the receiver to
+ *  bump ack before sending the next one.
+ */
+typedef struct {
+	uint64_t t_send ALIGNED(64);	/* sender time stamp, CLOCK_MONOTONIC ns */
+	uint32_t placement;		/* 0 = same CPU, 1 = cross CPU */
+	uint32_t ack ALIGNED(64);	/* receiver acknowledges each signal */
+	bool stop;			/* receiver tells sender to stop */
+	int error;			/* sender errno, 0 if ok */
+	int method;			/* STRESS_SIGLAT_* delivery method */
+	int signum;			/* signal being delivered */
+	pid_t pid;			/* receiver process */
+	int32_t cpus[2];		/* same CPU, cross CPU, -1 if none */
+#if defined(STRESS_SIGLAT_HAVE_PTHREAD_SIGQUEUE)
+	pthread_t thread;		/* receiver thread */
+#endif
+} stress_siglat_t;
+
+static volatile bool stress_siglat_handled;
+static volatile uint64_t stress_siglat_recv_ns;
+static void * volatile stress_siglat_value;
+
+/*
+ *  stress_siglat_handler()
+ *	time stamp handler entry as early as possible
+ */
+static void MLOCKED_TEXT stress_siglat_handler(int sig, siginfo_t *info, void *ucontext)
+{
+	stress_siglat_recv_ns = stress_latency_now();
+	(void)sig;
+	(void)ucontext;
+
+	stress_siglat_value = info ? info->si_value.sival_ptr : NULL;
+	stress_siglat_handled = true;
+}
+
+/*
+ *  stress_siglat_payload()
+ *	time stamp carried by a sigqueue value, the value is only
+ *	wide enough for a 64 bit time stamp on 64 bit systems, use
+ *	the shared slot otherwise
+ */
+static inline uint64_t stress_siglat_payload(const stress_siglat_t *sl, void *value)
+{
+	if (sizeof(value) >= sizeof(uint64_t))
+		return (uint64_t)(uintptr_t)value;
+	return sl->t_send;
+}
+
+/*
+ *  stress_siglat_send()
+ *	send a time stamped signal with the method under test
+ */
+static int stress_siglat_send(stress_siglat_t *sl, const uint64_t t_send)
+{
+	union sigval sv;
+
+	(void)shim_memset(&sv, 0, sizeof(sv));
+	sv.sival_ptr = (void *)(uintptr_t)t_send;
+
+	switch (sl->method) {
+	case STRESS_SIGLAT_KILL:
+		return shim_kill(sl->pid, sl->signum);
+#if defined(STRESS_SIGLAT_HAVE_PTHREAD_SIGQUEUE)
+	case STRESS_SIGLAT_PTHREAD_SIGQUEUE:
+		errno = pthread_sigqueue(sl->thread, sl->signum, sv);
+		return errno ? -1 : 0;
+#endif
+	default:
+		return sigqueue(sl->pid, sl->signum, sv);
+	}
+}
+
+/*
+ *  stress_siglat_sender()
+ *	send one signal at a time, switching between the same CPU as
+ *	the receiver and a different CPU every STRESS_SIGLAT_SWITCH
+ *	signals, and wait for the receiver to acknowledge each one
+ */
+static void stress_siglat_sender(stress_siglat_t *sl)
+{
+	uint32_t n = 0, placement = 1;
+
+	while (LIKELY(!sl->stop && stress_continue_flag())) {
+		const uint32_t ack = __atomic_load_n(&sl->ack, __ATOMIC_ACQUIRE);
+		uint64_t t_send;
+
+		if ((n++ % STRESS_SIGLAT_SWITCH) == 0) {
+			placement = (sl->cpus[1] < 0) ? 0 : !placement;
+			stress_placement_set(sl->cpus[placement]);
+		}
+		sl->placement = placement;
+		t_send = stress_latency_now();
+		sl->t_send = t_send;
+		__atomic_thread_fence(__ATOMIC_RELEASE);
+		if (UNLIKELY(stress_siglat_send(sl, t_send) < 0)) {
+			if (errno == EAGAIN)
+				continue;
+			sl->error = errno;
+			return;
+		}
+		while (__atomic_load_n(&sl->ack, __ATOMIC_ACQUIRE) == ack) {
+			if (UNLIKELY(sl->stop || !stress_continue_flag()))
+				return;
+			(void)shim_sched_yield();
+		}
+	}
+}
+
+#if defined(STRESS_SIGLAT_HAVE_PTHREAD_SIGQUEUE)
+/*
+ *  stress_siglat_sender_thread()
+ *	pthread_sigqueue sender thread
+ */
+static void *stress_siglat_sender_thread(void *arg)
+{
+	sigset_t set;
+
+	/* process directed signals are handled by the receiver thread */
+	(void)sigfillset(&set);
+	(void)pthread_sigmask(SIG_BLOCK, &set, NULL);
+	stress_siglat_sender((stress_siglat_t *)arg);
+	return &g_nowt;
+}
+#endif
+
+/*
+ *  stress_siglat_receive()
+ *	wait for the next signal, fetch the receive and send time
+ *	stamps, returns -1 and errno on a failure or interruption
+ */
+static int stress_siglat_receive(
+	stress_siglat_t *sl,
+	const int sfd,
+	const sigset_t *mask,
+	const sigset_t *wait_mask,
+	uint64_t *t_recv,
+	uint64_t *t_send)
+{
+	(void)sfd;
+	(void)mask;
+
+	switch (sl->method) {
+#if defined(HAVE_SIGWAITINFO)
+	case STRESS_SIGLAT_SIGWAITINFO: {
+		siginfo_t info;
+
+		(void)shim_memset(&info, 0, sizeof(info));
+		if (sigwaitinfo(mask, &info) < 0)
+			return -1;
+		*t_recv = stress_latency_now();
+		*t_send = stress_siglat_payload(sl, info.si_value.sival_ptr);
+		return 0;
+	}
+#endif
+#if defined(STRESS_SIGLAT_HAVE_SIGNALFD)
+	case STRESS_SIGLAT_SIGNALFD: {
+		struct signalfd_siginfo fdsi;
+		ssize_t ret;
+
+		ret = read(sfd, &fdsi, sizeof(fdsi));
+		if (ret != (ssize_t)sizeof(fdsi)) {
+			if (ret >= 0)
+				errno = EIO;
+			return -1;
+		}
+		*t_recv = stress_latency_now();
+		*t_send = stress_siglat_payload(sl, (void *)(uintptr_t)fdsi.ssi_ptr);
+		return 0;
+	}
+#endif
+	default:
+		while (!stress_siglat_handled) {
+			if (UNLIKELY(!stress_continue_flag())) {
+				errno = EINTR;
+				return -1;
+			}
+			(void)sigsuspend(wait_mask);
+		}
+		stress_siglat_handled = false;
+		*t_recv = stress_siglat_recv_ns;
+		*t_send = (sl->method == STRESS_SIGLAT_KILL) ? sl->t_send :
+			stress_siglat_payload(sl, stress_siglat_value);
+		return 0;
+	}
+}
+
+/*
+ *  stress_siglat_cross_cpu()
+ *	find a usable CPU other than cpu, -1 if there is none
+ */
+static int32_t stress_siglat_cross_cpu(const int32_t cpu)
+{
+	uint32_t *cpus, n_cpus, i;
+	int32_t cross = -1;
+
+	n_cpus = stress_get_usable_cpus(&cpus, true);
+	for (i = 0; i < n_cpus; i++) {
+		if ((int32_t)cpus[i] != cpu) {
+			cross = (int32_t)cpus[i];
+			break;
+		}
+	}
+	stress_free_usable_cpus(&cpus);
+	return cross;
+}
+
+/*
+ *  stress_siglat()
+ *	measure the delivery latency of signals sent with the method,
+ *	from the send to handler entry, sigwaitinfo() return or signalfd
+ *	read, with the sender on the same CPU as the receiver and on a
+ *	different CPU. Latencies are recorded into --latency paths 0
+ *	(same CPU) and 1 (cross CPU) and reported as metrics starting
+ *	at metrics_base.
+ */
+int stress_siglat(
+	stress_args_t *args,
+	const int method,
+	const int signum,
+	const size_t metrics_base)
+{
+	stress_siglat_t *sl;
+	stress_latency_hist_t *hist;
+	struct sigaction sa, sa_old;
+	sigset_t mask, old_mask, wait_mask;
+	char names[2][STRESS_LATENCY_DESC_LEN];
+	const char *method_name = stress_siglat_methods[method];
+	int sfd = -1, rc = EXIT_SUCCESS;
+	pid_t pid = -1;
+	size_t i;
+#if defined(STRESS_SIGLAT_HAVE_PTHREAD_SIGQUEUE)
+	pthread_t sender;
+	bool sender_running = false;
+#endif
+
+#if !defined(HAVE_SIGWAITINFO)
+	if (method == STRESS_SIGLAT_SIGWAITINFO) {
+		if (args->instance == 0)
+			pr_inf_skip("%s: sigwaitinfo() not available, skipping stressor\n", args->name);
+		return EXIT_NOT_IMPLEMENTED;
+	}
+#endif
+#if !defined(STRESS_SIGLAT_HAVE_SIGNALFD)
+	if (method == STRESS_SIGLAT_SIGNALFD) {
+		if (args->instance == 0)
+			pr_inf_skip("%s: signalfd() not available, skipping stressor\n", args->name);
+		return EXIT_NOT_IMPLEMENTED;
+	}
+#endif
+#if !defined(STRESS_SIGLAT_HAVE_PTHREAD_SIGQUEUE)
+	if (method == STRESS_SIGLAT_PTHREAD_SIGQUEUE) {
+		if (args->instance == 0)
+			pr_inf_skip("%s: pthread_sigqueue() not available, skipping stressor\n", args->name);
+		return EXIT_NOT_IMPLEMENTED;
+	}
+#endif
+
+	sl = (stress_siglat_t *)stress_mmap_populate(NULL, sizeof(*sl),
+		PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+	if (sl == MAP_FAILED) {
+		pr_inf_skip("%s: cannot mmap %zu bytes, errno=%d (%s), skipping stressor\n",
+			args->name, sizeof(*sl), errno, strerror(errno));
+		return EXIT_NO_RESOURCE;
+	}
+	stress_set_vma_anon_name(sl, sizeof(*sl), "siglat");
+	hist = (stress_latency_hist_t *)calloc(2, sizeof(*hist));
+	if (!hist) {
+		pr_inf_skip("%s: cannot allocate latency histograms, skipping stressor\n", args->name);
+		(void)munmap((void *)sl, sizeof(*sl));
+		return EXIT_NO_RESOURCE;
+	}
+	stress_latency_hist_init(&hist[0]);
+	stress_latency_hist_init(&hist[1]);
+
+	(void)shim_memset((void *)sl, 0, sizeof(*sl));
+	sl->method = method;
+	sl->signum = signum;
+	sl->pid = getpid();
+	sl->cpus[0] = (int32_t)stress_get_cpu();
+	sl->cpus[1] = stress_siglat_cross_cpu(sl->cpus[0]);
+#if defined(STRESS_SIGLAT_HAVE_PTHREAD_SIGQUEUE)
+	sl->thread = pthread_self();
+#endif
+	(void)snprintf(names[0], sizeof(names[0]), "%s same cpu", method_name);
+	(void)snprintf(names[1], sizeof(names[1]), "%s %s", method_name,
+		stress_cpu_distance_name(stress_cpu_distance(sl->cpus[0], sl->cpus[1])));
+	stress_latency_set_description(args, 0, names[0]);
+	if (sl->cpus[1] >= 0)
+		stress_latency_set_description(args, 1, names[1]);
+	pr_dbg("%s: %s delivery latency, receiver CPU %" PRId32 ", cross CPU %" PRId32 "\n",
+		args->name, method_name, sl->cpus[0], sl->cpus[1]);
+	stress_placement_set(sl->cpus[0]);
+
+	/* the signal is only taken in sigsuspend, sigwaitinfo or via signalfd */
+	(void)sigemptyset(&mask);
+	(void)sigaddset(&mask, signum);
+	if (sigprocmask(SIG_BLOCK, &mask, &old_mask) < 0) {
+		pr_fail("%s: sigprocmask failed, errno=%d (%s)\n",
+			args->name, errno, strerror(errno));
+		rc = EXIT_FAILURE;
+		goto free_hist;
+	}
+	wait_mask = old_mask;
+	(void)sigdelset(&wait_mask, signum);
+
+	(void)shim_memset(&sa, 0, sizeof(sa));
+	sa.sa_sigaction = stress_siglat_handler;
+	sa.sa_flags = SA_SIGINFO;
+	(void)sigemptyset(&sa.sa_mask);
+	if (sigaction(signum, &sa, &sa_old) < 0) {
+		pr_fail("%s: sigaction on signal %d failed, errno=%d (%s)\n",
+			args->name, signum, errno, strerror(errno));
+		rc = EXIT_FAILURE;
+		goto restore_mask;
+	}
+	stress_siglat_handled = false;
+
+#if defined(STRESS_SIGLAT_HAVE_SIGNALFD)
+	if (method == STRESS_SIGLAT_SIGNALFD) {
+		sfd = signalfd(-1, &mask, 0);
+		if (sfd < 0) {
+			pr_fail("%s: signalfd failed, errno=%d (%s)\n",
+				args->name, errno, strerror(errno));
+			rc = EXIT_FAILURE;
+			goto restore_action;
+		}
+	}
+#endif
+
+#if defined(STRESS_SIGLAT_HAVE_PTHREAD_SIGQUEUE)
+	if (method == STRESS_SIGLAT_PTHREAD_SIGQUEUE) {
+		const int ret = pthread_create(&sender, NULL, stress_siglat_sender_thread, (void *)sl);
+
+		if (ret) {
+			pr_inf_skip("%s: pthread_create failed, errno=%d (%s), skipping stressor\n",
+				args->name, ret, strerror(ret));
+			rc = EXIT_NO_RESOURCE;
+			goto close_sfd;
+		}
+		sender_running = true;
+	} else
+#endif
+	{
+again:
+		pid = fork();
+		if (pid < 0) {
+			if (stress_redo_fork(args, errno))
+				goto again;
+			if (UNLIKELY(!stress_continue(args)))
+				goto close_sfd;
+			pr_err("%s: fork failed, errno=%d (%s)\n",
+				args->name, errno, strerror(errno));
+			rc = EXIT_NO_RESOURCE;
+			goto close_sfd;
+		} else if (pid == 0) {
+			stress_parent_died_alarm();
+			(void)sched_settings_apply(true);
+			stress_siglat_sender(sl);
+			_exit(sl->error ? EXIT_FAILURE : EXIT_SUCCESS);
+		}
+	}
+
+	do {
+		uint64_t t_recv, t_send, ns;
+		uint32_t placement;
+
+		if (UNLIKELY(stress_siglat_receive(sl, sfd, &mask, &wait_mask, &t_recv, &t_send) < 0)) {
+			if ((errno == EINTR) || (errno == EAGAIN))
+				continue;
+			pr_fail("%s: %s receive failed, errno=%d (%s)\n",
+				args->name, method_name, errno, strerror(errno));
+			rc = EXIT_FAILURE;
+			break;
+		}
+		/* the sender does not change placement until the ack */
+		placement = sl->placement & 1;
+		ns = (t_recv > t_send) ? t_recv - t_send : 0;
+		stress_latency_hist_record(&hist[placement], ns);
+		stress_latency_record(args, placement, ns);
+		stress_bogo_inc(args);
+		(void)__atomic_add_fetch(&sl->ack, 1, __ATOMIC_RELEASE);
+	} while (!sl->error && stress_continue(args));
+
+	if (sl->error) {
+		pr_fail("%s: %s failed, errno=%d (%s)\n",
+			args->name, method_name, sl->error, strerror(sl->error));
+		rc = EXIT_FAILURE;
+	}
+	sl->stop = true;
+	(void)__atomic_add_fetch(&sl->ack, 1, __ATOMIC_RELEASE);
+#if defined(STRESS_SIGLAT_HAVE_PTHREAD_SIGQUEUE)
+	if (sender_running)
+		(void)pthread_join(sender, NULL);
+#endif
+	if (pid > 0) {
+		int status;
+
+		(void)shim_kill(pid, SIGALRM);
+		(void)shim_waitpid(pid, &status, 0);
+	}
+
+	for (i = 0; i < 2; i++) {
+		char msg[64];
+		const size_t idx = metrics_base + (i * 3);
+		const char *where = names[i] + strlen(method_name) + 1;
+
+		if (hist[i].count == 0)
+			continue;
+		(void)snprintf(msg, sizeof(msg), "%s latency mean (usec), %s", method_name, where);
+		stress_metrics_set(args, idx, msg, stress_latency_hist_mean(&hist[i]) / 1000.0,
+			STRESS_METRIC_GEOMETRIC_MEAN);
+		(void)snprintf(msg, sizeof(msg), "%s latency p50 (usec), %s", method_name, where);
+		stress_metrics_set(args, idx + 1, msg,
+			(double)stress_latency_hist_percentile(&hist[i], 50.0) / 1000.0,
+			STRESS_METRIC_GEOMETRIC_MEAN);
+		(void)snprintf(msg, sizeof(msg), "%s latency p99 (usec), %s", method_name, where);
+		stress_metrics_set(args, idx + 2, msg,
+			(double)stress_latency_hist_percentile(&hist[i], 99.0) / 1000.0,
+			STRESS_METRIC_GEOMETRIC_MEAN);
+	}
+
+close_sfd:
+	if (sfd >= 0)
+		(void)close(sfd);
+#if defined(STRESS_SIGLAT_HAVE_SIGNALFD)
+restore_action:
+#endif
+	(void)sigaction(signum, &sa_old, NULL);
+restore_mask:
+	(void)sigprocmask(SIG_SETMASK, &old_mask, NULL);
+free_hist:
+	free(hist);
+	(void)munmap((void *)sl, sizeof(*sl));
+
+	return rc;
+}
+#else
+int stress_siglat(
+	stress_args_t *args,
+	const int method,
+	const int signum,
+	const size_t metrics_base)
+{
+	(void)signum;
+	(void)metrics_base;
+
+	if (args->instance == 0)
+		pr_inf_skip("%s: %s signal delivery latency not available, skipping stressor\n",
+			args->name, stress_siglat_methods[method]);
+	return EXIT_NOT_IMPLEMENTED;
+}
+#endif
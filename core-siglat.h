@@ -0,0 +1,34 @@
+/*
+ * Copyright (C) 2025      Colin Ian King.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+#ifndef CORE_SIGLAT_H
+#define CORE_SIGLAT_H
+
+/* signal delivery methods measured by stress_siglat() */
+#define STRESS_SIGLAT_KILL		(0)	/* kill() to a handler */
+#define STRESS_SIGLAT_SIGQUEUE		(1)	/* sigqueue() to a handler */
+#define STRESS_SIGLAT_SIGWAITINFO	(2)	/* sigqueue() to sigwaitinfo() */
+#define STRESS_SIGLAT_SIGNALFD		(3)	/* sigqueue() to a signalfd read */
+#define STRESS_SIGLAT_PTHREAD_SIGQUEUE	(4)	/* pthread_sigqueue() to a handler */
+
+#define STRESS_SIGLAT_METRICS		(6)	/* metrics set by stress_siglat() */
+
+extern int stress_siglat(stress_args_t *args, const int method, const int signum,
+	const size_t metrics_base);
+
+#endif
@@ -0,0 +1,433 @@
+/*
+ * Copyright (C) 2025      Colin Ian King
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+#include "stress-ng.h"
+#include "core-arch.h"
+#include "core-cpu.h"
+#include "core-simd.h"
+
+#if defined(HAVE_COMPILER_MUSL)
+#undef HAVE_IMMINTRIN_H
+#endif
+
+#if defined(STRESS_ARCH_X86) &&		\
+    defined(HAVE_IMMINTRIN_H) &&	\
+    (defined(HAVE_COMPILER_GCC) ||	\
+     defined(HAVE_COMPILER_CLANG) ||	\
+     defined(HAVE_COMPILER_ICX)) &&	\
+    !defined(HAVE_COMPILER_ICC)
+#include <immintrin.h>
+#define STRESS_SIMD_X86
+#define TARGET_SSE2		__attribute__ ((target("sse2")))
+#define TARGET_AVX2		__attribute__ ((target("avx2")))
+#define TARGET_AVX512F		__attribute__ ((target("avx512f")))
+#if NEED_GNUC(5, 0, 0) ||	\
+    defined(HAVE_COMPILER_CLANG) ||	\
+    defined(HAVE_COMPILER_ICX)
+#define STRESS_SIMD_X86_AVX512
+#endif
+#endif
+
+#if defined(STRESS_ARCH_ARM) &&	\
+    defined(__aarch64__) &&	\
+    defined(__ARM_NEON)
+#include <arm_neon.h>
+#define STRESS_SIMD_NEON
+#endif
+
+/*
+ *  SVE intrinsics are only available when the compiler
+ *  has been configured to generate SVE code
+ */
+#if defined(STRESS_ARCH_ARM) &&	\
+    defined(__aarch64__) &&	\
+    defined(__ARM_FEATURE_SVE)
+#include <arm_sve.h>
+#define STRESS_SIMD_SVE
+#endif
+
+/*
+ *  STRESS_SIMD_KERNELS()
+ *	generate read, write, copy, scale, add and triad kernels
+ *	for a fixed vector width ISA. Each loop is unrolled 4 vectors
+ *	wide with scalar loops to mop up any remaining tail.
+ */
+#define STRESS_SIMD_KERNELS(isa, attr, vbytes, vi_t, vd_t,		\
+	vi_load, vi_store, vi_or, vi_dup,				\
+	vd_load, vd_store, vd_add, vd_mul, vd_dup)			\
+static uint64_t attr OPTIMIZE3 stress_simd_read_##isa(			\
+	const void *buf,						\
+	const size_t len)						\
+{									\
+	const uint8_t *ptr = (const uint8_t *)buf;			\
+	const uint8_t *end = ptr + len;					\
+	const uint8_t *end4 = ptr + (len & ~((size_t)(4 * vbytes) - 1));\
+	vi_t v0 = vi_dup(0), v1 = v0, v2 = v0, v3 = v0;			\
+	uint64_t tmp[vbytes / sizeof(uint64_t)], sum = 0;		\
+	size_t i;							\
+									\
+	for (; ptr < end4; ptr += 4 * vbytes) {				\
+		v0 = vi_or(v0, vi_load(ptr + (0 * vbytes)));		\
+		v1 = vi_or(v1, vi_load(ptr + (1 * vbytes)));		\
+		v2 = vi_or(v2, vi_load(ptr + (2 * vbytes)));		\
+		v3 = vi_or(v3, vi_load(ptr + (3 * vbytes)));		\
+	}								\
+	v0 = vi_or(vi_or(v0, v1), vi_or(v2, v3));			\
+	vi_store(tmp, v0);						\
+	for (i = 0; i < SIZEOF_ARRAY(tmp); i++)				\
+		sum |= tmp[i];						\
+	for (; ptr < end; ptr++)					\
+		sum |= *ptr;						\
+	return sum;							\
+}									\
+									\
+static void attr OPTIMIZE3 stress_simd_write_##isa(			\
+	void *buf,							\
+	const size_t len,						\
+	const uint64_t val)						\
+{									\
+	uint8_t *ptr = (uint8_t *)buf;					\
+	const uint8_t *end = ptr + len;					\
+	const uint8_t *end4 = ptr + (len & ~((size_t)(4 * vbytes) - 1));\
+	const vi_t v = vi_dup(val);					\
+									\
+	for (; ptr < end4; ptr += 4 * vbytes) {				\
+		vi_store(ptr + (0 * vbytes), v);			\
+		vi_store(ptr + (1 * vbytes), v);			\
+		vi_store(ptr + (2 * vbytes), v);			\
+		vi_store(ptr + (3 * vbytes), v);			\
+	}								\
+	for (; ptr < end; ptr++)					\
+		*ptr = (uint8_t)val;					\
+}									\
+									\
+static void attr OPTIMIZE3 stress_simd_copy_##isa(			\
+	void *dst,							\
+	const void *src,						\
+	const size_t len)						\
+{									\
+	uint8_t *d = (uint8_t *)dst;					\
+	const uint8_t *s = (const uint8_t *)src;			\
+	const uint8_t *end = s + len;					\
+	const uint8_t *end4 = s + (len & ~((size_t)(4 * vbytes) - 1));	\
+									\
+	for (; s < end4; s += 4 * vbytes, d += 4 * vbytes) {		\
+		const vi_t v0 = vi_load(s + (0 * vbytes));		\
+		const vi_t v1 = vi_load(s + (1 * vbytes));		\
+		const vi_t v2 = vi_load(s + (2 * vbytes));		\
+		const vi_t v3 = vi_load(s + (3 * vbytes));		\
+									\
+		vi_store(d + (0 * vbytes), v0);				\
+		vi_store(d + (1 * vbytes), v1);				\
+		vi_store(d + (2 * vbytes), v2);				\
+		vi_store(d + (3 * vbytes), v3);				\
+	}								\
+	for (; s < end; s++, d++)					\
+		*d = *s;						\
+}									\
+									\
+static void attr OPTIMIZE3 stress_simd_scale_##isa(			\
+	double *a,							\
+	const double *b,						\
+	const double q,							\
+	const size_t n)							\
+{									\
+	const size_t per = vbytes / sizeof(double);			\
+	const size_t n4 = n & ~((4 * per) - 1);				\
+	const vd_t vq = vd_dup(q);					\
+	size_t i;							\
+									\
+	for (i = 0; i < n4; i += 4 * per) {				\
+		vd_store(a + i + (0 * per), vd_mul(vq, vd_load(b + i + (0 * per))));	\
+		vd_store(a + i + (1 * per), vd_mul(vq, vd_load(b + i + (1 * per))));	\
+		vd_store(a + i + (2 * per), vd_mul(vq, vd_load(b + i + (2 * per))));	\
+		vd_store(a + i + (3 * per), vd_mul(vq, vd_load(b + i + (3 * per))));	\
+	}								\
+	for (; i < n; i++)						\
+		a[i] = q * b[i];					\
+}									\
+									\
+static void attr OPTIMIZE3 stress_simd_add_##isa(			\
+	double *a,							\
+	const double *b,						\
+	const double *c,						\
+	const size_t n)							\
+{									\
+	const size_t per = vbytes / sizeof(double);			\
+	const size_t n4 = n & ~((4 * per) - 1);				\
+	size_t i;							\
+									\
+	for (i = 0; i < n4; i += 4 * per) {				\
+		vd_store(a + i + (0 * per), vd_add(vd_load(b + i + (0 * per)), vd_load(c + i + (0 * per))));	\
+		vd_store(a + i + (1 * per), vd_add(vd_load(b + i + (1 * per)), vd_load(c + i + (1 * per))));	\
+		vd_store(a + i + (2 * per), vd_add(vd_load(b + i + (2 * per)), vd_load(c + i + (2 * per))));	\
+		vd_store(a + i + (3 * per), vd_add(vd_load(b + i + (3 * per)), vd_load(c + i + (3 * per))));	\
+	}								\
+	for (; i < n; i++)						\
+		a[i] = b[i] + c[i];					\
+}									\
+									\
+static void attr OPTIMIZE3 stress_simd_triad_##isa(			\
+	double *a,							\
+	const double *b,						\
+	const double *c,						\
+	const double q,							\
+	const size_t n)							\
+{									\
+	const size_t per = vbytes / sizeof(double);			\
+	const size_t n4 = n & ~((4 * per) - 1);				\
+	const vd_t vq = vd_dup(q);					\
+	size_t i;							\
+									\
+	for (i = 0; i < n4; i += 4 * per) {				\
+		vd_store(a + i + (0 * per), vd_add(vd_load(b + i + (0 * per)), vd_mul(vq, vd_load(c + i + (0 * per)))));	\
+		vd_store(a + i + (1 * per), vd_add(vd_load(b + i + (1 * per)), vd_mul(vq, vd_load(c + i + (1 * per)))));	\
+		vd_store(a + i + (2 * per), vd_add(vd_load(b + i + (2 * per)), vd_mul(vq, vd_load(c + i + (2 * per)))));	\
+		vd_store(a + i + (3 * per), vd_add(vd_load(b + i + (3 * per)), vd_mul(vq, vd_load(c + i + (3 * per)))));	\
+	}								\
+	for (; i < n; i++)						\
+		a[i] = b[i] + q * c[i];					\
+}
+
+#if defined(STRESS_SIMD_X86)
+#define SSE2_VI_LOAD(p)		_mm_loadu_si128((const __m128i *)(const void *)(p))
+#define SSE2_VI_STORE(p, v)	_mm_storeu_si128((__m128i *)(void *)(p), v)
+#define SSE2_VI_DUP(v)		_mm_set1_epi64x((long long int)(v))
+#define SSE2_VD_LOAD(p)		_mm_loadu_pd(p)
+#define SSE2_VD_STORE(p, v)	_mm_storeu_pd(p, v)
+
+STRESS_SIMD_KERNELS(sse2, TARGET_SSE2, 16, __m128i, __m128d,
+	SSE2_VI_LOAD, SSE2_VI_STORE, _mm_or_si128, SSE2_VI_DUP,
+	SSE2_VD_LOAD, SSE2_VD_STORE, _mm_add_pd, _mm_mul_pd, _mm_set1_pd)
+
+#define AVX2_VI_LOAD(p)		_mm256_loadu_si256((const __m256i *)(const void *)(p))
+#define AVX2_VI_STORE(p, v)	_mm256_storeu_si256((__m256i *)(void *)(p), v)
+#define AVX2_VI_DUP(v)		_mm256_set1_epi64x((long long int)(v))
+#define AVX2_VD_LOAD(p)		_mm256_loadu_pd(p)
+#define AVX2_VD_STORE(p, v)	_mm256_storeu_pd(p, v)
+
+STRESS_SIMD_KERNELS(avx2, TARGET_AVX2, 32, __m256i, __m256d,
+	AVX2_VI_LOAD, AVX2_VI_STORE, _mm256_or_si256, AVX2_VI_DUP,
+	AVX2_VD_LOAD, AVX2_VD_STORE, _mm256_add_pd, _mm256_mul_pd, _mm256_set1_pd)
+
+#if defined(STRESS_SIMD_X86_AVX512)
+#define AVX512_VI_LOAD(p)	_mm512_loadu_si512((const void *)(p))
+#define AVX512_VI_STORE(p, v)	_mm512_storeu_si512((void *)(p), v)
+#define AVX512_VI_DUP(v)	_mm512_set1_epi64((long long int)(v))
+#define AVX512_VD_LOAD(p)	_mm512_loadu_pd(p)
+#define AVX512_VD_STORE(p, v)	_mm512_storeu_pd(p, v)
+
+STRESS_SIMD_KERNELS(avx512, TARGET_AVX512F, 64, __m512i, __m512d,
+	AVX512_VI_LOAD, AVX512_VI_STORE, _mm512_or_si512, AVX512_VI_DUP,
+	AVX512_VD_LOAD, AVX512_VD_STORE, _mm512_add_pd, _mm512_mul_pd, _mm512_set1_pd)
+#endif
+#endif
+
+#if defined(STRESS_SIMD_NEON)
+#define NEON_VI_LOAD(p)		vld1q_u64((const uint64_t *)(const void *)(p))
+#define NEON_VI_STORE(p, v)	vst1q_u64((uint64_t *)(void *)(p), v)
+#define NEON_VI_DUP(v)		vdupq_n_u64((uint64_t)(v))
+
+STRESS_SIMD_KERNELS(neon, , 16, uint64x2_t, float64x2_t,
+	NEON_VI_LOAD, NEON_VI_STORE, vorrq_u64, NEON_VI_DUP,
+	vld1q_f64, vst1q_f64, vaddq_f64, vmulq_f64, vdupq_n_f64)
+#endif
+
+#if defined(STRESS_SIMD_SVE)
+/*
+ *  SVE kernels are vector length agnostic, predication
+ *  handles the loop tails so no scalar mop up is required
+ */
+static uint64_t OPTIMIZE3 stress_simd_read_sve(const void *buf, const size_t len)
+{
+	const uint64_t *ptr = (const uint64_t *)buf;
+	const uint8_t *tail;
+	const uint64_t n = (uint64_t)(len / sizeof(uint64_t));
+	const uint64_t vl = (uint64_t)svcntd();
+	svuint64_t v = svdup_n_u64(0);
+	uint64_t i, sum;
+
+	for (i = 0; i < n; i += vl) {
+		const svbool_t pg = svwhilelt_b64(i, n);
+
+		v = svorr_u64_m(pg, v, svld1_u64(pg, ptr + i));
+	}
+	sum = svorv_u64(svptrue_b64(), v);
+	for (tail = (const uint8_t *)(ptr + n); tail < (const uint8_t *)buf + len; tail++)
+		sum |= *tail;
+	return sum;
+}
+
+static void OPTIMIZE3 stress_simd_write_sve(void *buf, const size_t len, const uint64_t val)
+{
+	uint64_t *ptr = (uint64_t *)buf;
+	uint8_t *tail;
+	const uint64_t n = (uint64_t)(len / sizeof(uint64_t));
+	const uint64_t vl = (uint64_t)svcntd();
+	const svuint64_t v = svdup_n_u64(val);
+	uint64_t i;
+
+	for (i = 0; i < n; i += vl)
+		svst1_u64(svwhilelt_b64(i, n), ptr + i, v);
+	for (tail = (uint8_t *)(ptr + n); tail < (uint8_t *)buf + len; tail++)
+		*tail = (uint8_t)val;
+}
+
+static void OPTIMIZE3 stress_simd_copy_sve(void *dst, const void *src, const size_t len)
+{
+	uint8_t *d = (uint8_t *)dst;
+	const uint8_t *s = (const uint8_t *)src;
+	const uint64_t n = (uint64_t)len;
+	const uint64_t vl = (uint64_t)svcntb();
+	uint64_t i;
+
+	for (i = 0; i < n; i += vl) {
+		const svbool_t pg = svwhilelt_b8(i, n);
+
+		svst1_u8(pg, d + i, svld1_u8(pg, s + i));
+	}
+}
+
+static void OPTIMIZE3 stress_simd_scale_sve(double *a, const double *b, const double q, const size_t n)
+{
+	const uint64_t vl = (uint64_t)svcntd();
+	uint64_t i;
+
+	for (i = 0; i < (uint64_t)n; i += vl) {
+		const svbool_t pg = svwhilelt_b64(i, (uint64_t)n);
+
+		svst1_f64(pg, a + i, svmul_n_f64_x(pg, svld1_f64(pg, b + i), q));
+	}
+}
+
+static void OPTIMIZE3 stress_simd_add_sve(double *a, const double *b, const double *c, const size_t n)
+{
+	const uint64_t vl = (uint64_t)svcntd();
+	uint64_t i;
+
+	for (i = 0; i < (uint64_t)n; i += vl) {
+		const svbool_t pg = svwhilelt_b64(i, (uint64_t)n);
+
+		svst1_f64(pg, a + i, svadd_f64_x(pg, svld1_f64(pg, b + i), svld1_f64(pg, c + i)));
+	}
+}
+
+static void OPTIMIZE3 stress_simd_triad_sve(double *a, const double *b, const double *c, const double q, const size_t n)
+{
+	const uint64_t vl = (uint64_t)svcntd();
+	uint64_t i;
+
+	for (i = 0; i < (uint64_t)n; i += vl) {
+		const svbool_t pg = svwhilelt_b64(i, (uint64_t)n);
+
+		svst1_f64(pg, a + i, svmla_n_f64_x(pg, svld1_f64(pg, b + i), svld1_f64(pg, c + i), q));
+	}
+}
+#endif
+
+#define STRESS_SIMD_METHOD(isa)	\
+	{ #isa, stress_simd_read_##isa, stress_simd_write_##isa, stress_simd_copy_##isa,	\
+	  stress_simd_scale_##isa, stress_simd_add_##isa, stress_simd_triad_##isa }
+
+#if defined(STRESS_SIMD_X86)
+static const stress_simd_method_t stress_simd_sse2 = STRESS_SIMD_METHOD(sse2);
+static const stress_simd_method_t stress_simd_avx2 = STRESS_SIMD_METHOD(avx2);
+#endif
+#if defined(STRESS_SIMD_X86_AVX512)
+static const stress_simd_method_t stress_simd_avx512 = STRESS_SIMD_METHOD(avx512);
+#endif
+#if defined(STRESS_SIMD_NEON)
+static const stress_simd_method_t stress_simd_neon = STRESS_SIMD_METHOD(neon);
+#endif
+#if defined(STRESS_SIMD_SVE)
+static const stress_simd_method_t stress_simd_sve = STRESS_SIMD_METHOD(sve);
+#endif
+
+static const char * const stress_simd_names[] = {
+	"sse2",		/* STRESS_SIMD_SSE2 */
+	"avx2",		/* STRESS_SIMD_AVX2 */
+	"avx512",	/* STRESS_SIMD_AVX512 */
+	"neon",		/* STRESS_SIMD_NEON */
+	"sve",		/* STRESS_SIMD_SVE */
+};
+
+/*
+ *  stress_simd_name()
+ *	name of SIMD method type
+ */
+const char *stress_simd_name(const stress_simd_type_t type)
+{
+	return ((size_t)type < SIZEOF_ARRAY(stress_simd_names)) ?
+		stress_simd_names[type] : "unknown";
+}
+
+/*
+ *  stress_simd_method()
+ *	return the SIMD kernels for type, NULL if they are not built
+ *	in or the CPU does not support the instructions they use
+ */
+const stress_simd_method_t *stress_simd_method(const stress_simd_type_t type)
+{
+	switch (type) {
+#if defined(STRESS_SIMD_X86)
+	case STRESS_SIMD_SSE2:
+		return stress_cpu_x86_has_sse2() ? &stress_simd_sse2 : NULL;
+	case STRESS_SIMD_AVX2:
+		return stress_cpu_x86_has_avx2() ? &stress_simd_avx2 : NULL;
+#endif
+#if defined(STRESS_SIMD_X86_AVX512)
+	case STRESS_SIMD_AVX512:
+		return stress_cpu_x86_has_avx512_f() ? &stress_simd_avx512 : NULL;
+#endif
+#if defined(STRESS_SIMD_NEON)
+	case STRESS_SIMD_NEON:
+		return stress_cpu_arm_has_neon() ? &stress_simd_neon : NULL;
+#endif
+#if defined(STRESS_SIMD_SVE)
+	case STRESS_SIMD_SVE:
+		return stress_cpu_arm_has_sve() ? &stress_simd_sve : NULL;
+#endif
+	default:
+		break;
+	}
+	return NULL;
+}
+
+/*
+ *  stress_simd_method_best()
+ *	return the widest supported SIMD kernels, NULL if none
+ */
+const stress_simd_method_t *stress_simd_method_best(void)
+{
+	static const stress_simd_type_t order[] = {
+		STRESS_SIMD_AVX512,
+		STRESS_SIMD_SVE,
+		STRESS_SIMD_AVX2,
+		STRESS_SIMD_NEON,
+		STRESS_SIMD_SSE2,
+	};
+	size_t i;
+
+	for (i = 0; i < SIZEOF_ARRAY(order); i++) {
+		const stress_simd_method_t *method = stress_simd_method(order[i]);
+
+		if (method)
+			return method;
+	}
+	return NULL;
+}
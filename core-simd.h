@@ -0,0 +1,57 @@
+/*
+ * Copyright (C) 2025      Colin Ian King
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+#ifndef CORE_SIMD_H
+#define CORE_SIMD_H
+
+/*
+ *  Explicit SIMD memory kernels, these use hand written vector
+ *  intrinsics rather than relying on compiler auto-vectorization
+ *  so that memory bandwidth stressors can exercise the full
+ *  vector load/store width of the CPU.
+ */
+typedef enum {
+	STRESS_SIMD_SSE2 = 0,
+	STRESS_SIMD_AVX2,
+	STRESS_SIMD_AVX512,
+	STRESS_SIMD_NEON,
+	STRESS_SIMD_SVE,
+	STRESS_SIMD_MAX,
+} stress_simd_type_t;
+
+typedef struct {
+	const char *name;
+	/* sum (or) of all the 64 bit words read from buf */
+	uint64_t (*read)(const void *buf, const size_t len);
+	/* fill buf with 64 bit value val */
+	void (*write)(void *buf, const size_t len, const uint64_t val);
+	/* copy len bytes from src to dst */
+	void (*copy)(void *dst, const void *src, const size_t len);
+	/* STREAM scale, a[i] = q * b[i] */
+	void (*scale)(double *a, const double *b, const double q, const size_t n);
+	/* STREAM add, a[i] = b[i] + c[i] */
+	void (*add)(double *a, const double *b, const double *c, const size_t n);
+	/* STREAM triad, a[i] = b[i] + q * c[i] */
+	void (*triad)(double *a, const double *b, const double *c, const double q, const size_t n);
+} stress_simd_method_t;
+
+extern const char *stress_simd_name(const stress_simd_type_t type);
+extern WARN_UNUSED const stress_simd_method_t *stress_simd_method(const stress_simd_type_t type);
+extern WARN_UNUSED const stress_simd_method_t *stress_simd_method_best(void);
+
+#endif
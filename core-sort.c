@@ -17,8 +17,10 @@
  *
  */
 #include "stress-ng.h"
-#include "core-sort.h"
+#include "core-builtin.h"
 #include "core-pragma.h"
+#include "core-pthread.h"
+#include "core-sort.h"
 
 uint64_t stress_sort_compares ALIGN64;
 
@@ -248,3 +250,322 @@ sort_copy_func_t sort_copy_func(const size_t size)
 	}
 	return sort_copy;
 }
+
+/*
+ *  Parallel sample sort of 32 bit integers, a sample of the data
+ *  is sorted to find threads - 1 splitters, each thread counts and
+ *  then scatters its contiguous chunk of the data into per-thread
+ *  bucket ranges of a temporary buffer, each thread sorts one bucket
+ *  with the stressor's sort function and the buckets are merged
+ *  back in order into the data.
+ */
+#define STRESS_SORT_PAR_OVERSAMPLE	(32)
+
+#define STRESS_SORT_PAR_COUNT		(0)
+#define STRESS_SORT_PAR_SCATTER		(1)
+#define STRESS_SORT_PAR_SORT		(2)
+#define STRESS_SORT_PAR_MERGE		(3)
+
+typedef struct {
+	int32_t *data;			/* data to sort */
+	int32_t *tmp;			/* bucket buffer, n elements */
+	size_t n;			/* number of elements */
+	size_t threads;			/* number of threads and buckets */
+	int32_t *splitters;		/* threads - 1 bucket splitters */
+	size_t *counts;			/* [thread][bucket] element counts */
+	size_t *bucket_start;		/* threads + 1 bucket offsets */
+	stress_sort_int32_func_t sort_func; /* bucket sort function */
+	int phase;			/* STRESS_SORT_PAR_* phase to run */
+	bool reverse;			/* true for descending order */
+} stress_sort_par_t;
+
+typedef struct {
+	stress_pthread_work_t work;	/* thread work item, must be first */
+	stress_sort_par_t *par;		/* shared sort state */
+	size_t id;			/* thread and bucket number */
+	int sort_ret;			/* bucket sort function return */
+} stress_sort_par_thread_t;
+
+/*
+ *  stress_sort_par_bucket()
+ *	find the bucket for value v
+ */
+static inline size_t OPTIMIZE3 stress_sort_par_bucket(
+	const stress_sort_par_t *par,
+	const int32_t v)
+{
+	register size_t lo = 0, hi = par->threads - 1;
+
+	/* number of splitters <= v */
+	while (lo < hi) {
+		register const size_t mid = (lo + hi) >> 1;
+
+		if (par->splitters[mid] <= v)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	return par->reverse ? (par->threads - 1 - lo) : lo;
+}
+
+/*
+ *  stress_sort_par_thread()
+ *	run the current phase of the parallel sort for a thread
+ */
+static void *stress_sort_par_thread(void *arg)
+{
+	stress_sort_par_thread_t *t = (stress_sort_par_thread_t *)arg;
+	stress_sort_par_t *par = t->par;
+	const size_t lo = (par->n * t->id) / par->threads;
+	const size_t hi = (par->n * (t->id + 1)) / par->threads;
+	size_t * const counts = par->counts + (t->id * par->threads);
+	register size_t i;
+
+	switch (par->phase) {
+	case STRESS_SORT_PAR_COUNT:
+		(void)shim_memset(counts, 0, par->threads * sizeof(*counts));
+		for (i = lo; i < hi; i++)
+			counts[stress_sort_par_bucket(par, par->data[i])]++;
+		break;
+	case STRESS_SORT_PAR_SCATTER:
+		/* counts now hold the scatter offsets of this thread */
+		for (i = lo; i < hi; i++) {
+			register const int32_t v = par->data[i];
+
+			par->tmp[counts[stress_sort_par_bucket(par, v)]++] = v;
+		}
+		break;
+	case STRESS_SORT_PAR_SORT:
+		t->sort_ret = par->sort_func(par->tmp + par->bucket_start[t->id],
+			par->bucket_start[t->id + 1] - par->bucket_start[t->id], par->reverse);
+		break;
+	case STRESS_SORT_PAR_MERGE:
+		(void)shim_memcpy(par->data + par->bucket_start[t->id],
+			par->tmp + par->bucket_start[t->id],
+			(par->bucket_start[t->id + 1] - par->bucket_start[t->id]) * sizeof(*par->data));
+		break;
+	default:
+		break;
+	}
+	return &g_nowt;
+}
+
+/*
+ *  stress_sort_par_run()
+ *	run a phase of the parallel sort on all the threads
+ */
+static void stress_sort_par_run(
+	stress_sort_par_t *par,
+	stress_sort_par_thread_t *threads,
+	const int phase)
+{
+	par->phase = phase;
+	stress_pthread_work_run(threads, sizeof(*threads), par->threads,
+		stress_sort_par_thread);
+}
+
+/*
+ *  stress_sort_par_sort()
+ *	parallel sample sort of the data, returns -1 if a
+ *	bucket sort failed, 0 otherwise
+ */
+static int stress_sort_par_sort(
+	stress_sort_par_t *par,
+	stress_sort_par_thread_t *threads,
+	const bool reverse)
+{
+	const size_t threads_n = par->threads;
+	const size_t n_samples = threads_n * STRESS_SORT_PAR_OVERSAMPLE;
+	int32_t samples[n_samples];
+	size_t i, j, t;
+
+	par->reverse = reverse;
+
+	/* insertion sort a random sample to pick the splitters */
+	for (i = 0; i < n_samples; i++) {
+		const int32_t v = par->data[stress_mwc32modn((uint32_t)par->n)];
+
+		for (j = i; (j > 0) && (samples[j - 1] > v); j--)
+			samples[j] = samples[j - 1];
+		samples[j] = v;
+	}
+	for (i = 1; i < threads_n; i++)
+		par->splitters[i - 1] = samples[i * STRESS_SORT_PAR_OVERSAMPLE];
+
+	stress_sort_par_run(par, threads, STRESS_SORT_PAR_COUNT);
+
+	/* turn the per thread bucket counts into scatter offsets */
+	par->bucket_start[0] = 0;
+	for (j = 0; j < threads_n; j++) {
+		size_t offset = par->bucket_start[j];
+
+		for (t = 0; t < threads_n; t++) {
+			size_t * const count = &par->counts[(t * threads_n) + j];
+			const size_t c = *count;
+
+			*count = offset;
+			offset += c;
+		}
+		par->bucket_start[j + 1] = offset;
+	}
+
+	stress_sort_par_run(par, threads, STRESS_SORT_PAR_SCATTER);
+	stress_sort_par_run(par, threads, STRESS_SORT_PAR_SORT);
+	for (i = 0; i < threads_n; i++) {
+		if (threads[i].sort_ret < 0)
+			return -1;
+	}
+	stress_sort_par_run(par, threads, STRESS_SORT_PAR_MERGE);
+	return 0;
+}
+
+/*
+ *  stress_sort_int32_verify()
+ *	check data is in ascending or descending order
+ */
+static bool OPTIMIZE3 stress_sort_int32_verify(
+	const int32_t *data,
+	const size_t n,
+	const bool reverse)
+{
+	register size_t i;
+
+	for (i = 1; i < n; i++) {
+		if (UNLIKELY(reverse ? (data[i - 1] < data[i]) : (data[i - 1] > data[i])))
+			return false;
+	}
+	return true;
+}
+
+/*
+ *  stress_sort_int32_parallel()
+ *	parallel sort mode for the integer sorting stressors, each bogo-op
+ *	sample sorts shuffled data in ascending and then descending order
+ *	on threads threads and sorts shuffled data on a single thread with
+ *	sort_func as a baseline to compute the scaling efficiency
+ */
+int stress_sort_int32_parallel(
+	stress_args_t *args,
+	int32_t *data,
+	const size_t n,
+	const uint32_t threads_n,
+	stress_sort_int32_func_t sort_func)
+{
+	stress_sort_par_t par;
+	stress_sort_par_thread_t *threads;
+	size_t i, tmp_size;
+	double t, duration_par = 0.0, duration_fwd = 0.0, duration_one = 0.0;
+	double sorted_par = 0.0, sorted_fwd = 0.0, sorted_one = 0.0;
+	double rate_par, rate_fwd, rate_one;
+	char msg[40];
+	int rc = EXIT_SUCCESS;
+	const bool verify = !!(g_opt_flags & OPT_FLAGS_VERIFY);
+
+	(void)shim_memset(&par, 0, sizeof(par));
+	par.data = data;
+	par.n = n;
+	par.threads = (size_t)threads_n;
+	par.sort_func = sort_func;
+
+	threads = (stress_sort_par_thread_t *)calloc(par.threads, sizeof(*threads));
+	par.splitters = (int32_t *)calloc(par.threads, sizeof(*par.splitters));
+	par.counts = (size_t *)calloc(par.threads * par.threads, sizeof(*par.counts));
+	par.bucket_start = (size_t *)calloc(par.threads + 1, sizeof(*par.bucket_start));
+	if (!threads || !par.splitters || !par.counts || !par.bucket_start) {
+		pr_inf_skip("%s: cannot allocate parallel sort state for %zu threads, "
+			"skipping stressor\n", args->name, par.threads);
+		rc = EXIT_NO_RESOURCE;
+		goto free_state;
+	}
+	tmp_size = n * sizeof(*par.tmp);
+	par.tmp = (int32_t *)stress_mmap_populate(NULL, tmp_size,
+			PROT_READ | PROT_WRITE, MAP_ANONYMOUS | MAP_PRIVATE, -1, 0);
+	if (par.tmp == MAP_FAILED) {
+		pr_inf_skip("%s: mmap failed allocating %zu 32 bit integers for "
+			"parallel sort buckets, skipping stressor\n", args->name, n);
+		rc = EXIT_NO_RESOURCE;
+		goto free_state;
+	}
+	stress_set_vma_anon_name(par.tmp, tmp_size, "sort-buckets");
+	for (i = 0; i < par.threads; i++) {
+		threads[i].par = &par;
+		threads[i].id = i;
+	}
+
+	stress_set_proc_state(args->name, STRESS_STATE_SYNC_WAIT);
+	stress_sync_start_wait(args);
+	stress_set_proc_state(args->name, STRESS_STATE_RUN);
+
+	do {
+		bool reverse;
+
+		/* parallel sort of random data, forward then reverse */
+		stress_sort_data_int32_shuffle(data, n);
+		for (i = 0; i < 2; i++) {
+			reverse = (i == 1);
+			t = stress_time_now();
+			if (stress_sort_par_sort(&par, threads, reverse) < 0) {
+				pr_fail("%s: parallel %ssort of %zu integers failed\n",
+					args->name, reverse ? "reverse " : "", n);
+				rc = EXIT_FAILURE;
+				break;
+			}
+			t = stress_time_now() - t;
+			duration_par += t;
+			sorted_par += (double)n;
+			if (!reverse) {
+				duration_fwd += t;
+				sorted_fwd += (double)n;
+			}
+			if (verify && !stress_sort_int32_verify(data, n, reverse)) {
+				pr_fail("%s: parallel %ssort error detected, incorrect "
+					"ordering found\n", args->name, reverse ? "reverse " : "");
+				rc = EXIT_FAILURE;
+				break;
+			}
+		}
+		if (UNLIKELY((rc != EXIT_SUCCESS) || !stress_continue_flag()))
+			break;
+
+		/* single threaded baseline of random data */
+		stress_sort_data_int32_shuffle(data, n);
+		t = stress_time_now();
+		if (sort_func(data, n, false) < 0) {
+			pr_fail("%s: sort of %zu integers failed\n", args->name, n);
+			rc = EXIT_FAILURE;
+			break;
+		}
+		duration_one += stress_time_now() - t;
+		sorted_one += (double)n;
+		if (verify && !stress_sort_int32_verify(data, n, false)) {
+			pr_fail("%s: sort error detected, incorrect ordering found\n",
+				args->name);
+			rc = EXIT_FAILURE;
+			break;
+		}
+
+		stress_bogo_inc(args);
+	} while (stress_continue(args));
+
+	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
+
+	rate_par = (duration_par > 0.0) ? sorted_par / duration_par : 0.0;
+	rate_fwd = (duration_fwd > 0.0) ? sorted_fwd / duration_fwd : 0.0;
+	rate_one = (duration_one > 0.0) ? sorted_one / duration_one : 0.0;
+	(void)snprintf(msg, sizeof(msg), "Mkeys sorted per sec, %zu threads", par.threads);
+	stress_metrics_set(args, 0, msg, rate_par / 1000000.0, STRESS_METRIC_HARMONIC_MEAN);
+	stress_metrics_set(args, 1, "Mkeys sorted per sec, 1 thread",
+		rate_one / 1000000.0, STRESS_METRIC_HARMONIC_MEAN);
+	stress_metrics_set(args, 2, "% parallel scaling efficiency",
+		(rate_one > 0.0) ? 100.0 * rate_fwd / (rate_one * (double)par.threads) : 0.0,
+		STRESS_METRIC_HARMONIC_MEAN);
+
+	(void)munmap((void *)par.tmp, tmp_size);
+free_state:
+	free(par.bucket_start);
+	free(par.counts);
+	free(par.splitters);
+	free(threads);
+
+	return rc;
+}
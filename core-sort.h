@@ -24,6 +24,7 @@
 
 typedef void (*sort_swap_func_t)(void *p1, void *p2, register size_t size);
 typedef void (*sort_copy_func_t)(void *p1, void *p2, register size_t size);
+typedef int (*stress_sort_int32_func_t)(int32_t *data, const size_t n, const bool reverse);
 
 extern void stress_sort_data_int32_init(int32_t *data, const size_t n);
 extern void stress_sort_data_int32_shuffle(int32_t *data, const size_t n);
@@ -32,6 +33,9 @@ extern void stress_sort_compare_reset(void);
 extern uint64_t stress_sort_compare_get(void);
 extern uint64_t stress_sort_compares ALIGN64;
 
+extern int stress_sort_int32_parallel(stress_args_t *args, int32_t *data,
+	const size_t n, const uint32_t threads_n, stress_sort_int32_func_t sort_func);
+
 extern sort_swap_func_t sort_swap_func(const size_t size);
 extern sort_copy_func_t sort_copy_func(const size_t size);
 
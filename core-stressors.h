@@ -124,6 +124,7 @@
 	MACRO(gpu)		\
 	MACRO(handle)		\
 	MACRO(hash)		\
+	MACRO(hashmap)		\
 	MACRO(hdd)		\
 	MACRO(heapsort)		\
 	MACRO(hrtimers)		\
@@ -154,6 +155,7 @@
 	MACRO(landlock)		\
 	MACRO(lease)		\
 	MACRO(led)		\
+	MACRO(lfqueue)		\
 	MACRO(link)		\
 	MACRO(list)		\
 	MACRO(llc_affinity)	\
@@ -179,6 +181,7 @@
 	MACRO(memhotplug)	\
 	MACRO(memrate)		\
 	MACRO(memthrash)	\
+	MACRO(memtier)		\
 	MACRO(mergesort)	\
 	MACRO(metamix)		\
 	MACRO(mincore)		\
@@ -239,6 +242,7 @@
 	MACRO(prio_inv)		\
 	MACRO(priv_instr)	\
 	MACRO(procfs)		\
+	MACRO(proclat)		\
 	MACRO(pseek)		\
 	MACRO(pthread)		\
 	MACRO(ptrace)		\
@@ -384,6 +388,7 @@
 	MACRO(xattr)		\
 	MACRO(yield)		\
 	MACRO(zero)		\
+	MACRO(zerocopy)		\
 	MACRO(zlib)		\
 	MACRO(zombie)
 
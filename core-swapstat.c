@@ -0,0 +1,157 @@
+/*
+ * Copyright (C) 2025      Colin Ian King.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+#include "stress-ng.h"
+#include "core-builtin.h"
+#include "core-latency.h"
+#include "core-swapstat.h"
+
+/*
+ *  stress_swapstat_read()
+ *	read the system wide swap counters from /proc/vmstat and
+ *	the zswap pool sizes from /proc/meminfo
+ */
+void stress_swapstat_read(stress_swapstat_t *stat)
+{
+	FILE *fp;
+	char buf[256];
+
+	(void)shim_memset(stat, 0, sizeof(*stat));
+	stat->time = stress_time_now();
+
+	fp = fopen("/proc/vmstat", "r");
+	if (fp) {
+		while (fgets(buf, sizeof(buf), fp) != NULL) {
+			uint64_t val;
+
+			if (sscanf(buf, "pswpin %" SCNu64, &val) == 1)
+				stat->pswpin = val;
+			else if (sscanf(buf, "pswpout %" SCNu64, &val) == 1)
+				stat->pswpout = val;
+			else if (sscanf(buf, "zswpin %" SCNu64, &val) == 1)
+				stat->zswpin = val;
+			else if (sscanf(buf, "zswpout %" SCNu64, &val) == 1)
+				stat->zswpout = val;
+			else if (sscanf(buf, "zswpwb %" SCNu64, &val) == 1)
+				stat->zswpwb = val;
+		}
+		(void)fclose(fp);
+	}
+
+	fp = fopen("/proc/meminfo", "r");
+	if (fp) {
+		while (fgets(buf, sizeof(buf), fp) != NULL) {
+			uint64_t val;
+
+			if (sscanf(buf, "Zswap: %" SCNu64, &val) == 1)
+				stat->zswap_kb = val;
+			else if (sscanf(buf, "Zswapped: %" SCNu64, &val) == 1)
+				stat->zswapped_kb = val;
+		}
+		(void)fclose(fp);
+	}
+}
+
+/*
+ *  stress_swapstat_fault_latency()
+ *	touch the pages in buf that are not resident and record the
+ *	time of each fault into hist, returns the number of pages
+ *	faulted in. Resident pages are not touched.
+ */
+size_t stress_swapstat_fault_latency(
+	void *buf,
+	const size_t len,
+	const size_t page_size,
+	stress_latency_hist_t *hist)
+{
+#if defined(HAVE_MINCORE)
+	const size_t n_pages = len / page_size;
+	unsigned char vec_small[64], *vec = vec_small;
+	size_t i, faulted = 0;
+
+	if (n_pages > sizeof(vec_small)) {
+		vec = (unsigned char *)calloc(n_pages, 1);
+		if (!vec)
+			return 0;
+	}
+	if (shim_mincore(buf, len, vec) == 0) {
+		for (i = 0; i < n_pages; i++) {
+			volatile uint8_t *ptr = (uint8_t *)buf + (i * page_size);
+			uint64_t t;
+
+			if (vec[i] & 1)
+				continue;
+			t = stress_latency_now();
+			(void)*ptr;
+			stress_latency_hist_record(hist, stress_latency_now() - t);
+			faulted++;
+		}
+	}
+	if (vec != vec_small)
+		free(vec);
+	return faulted;
+#else
+	(void)buf;
+	(void)len;
+	(void)page_size;
+	(void)hist;
+
+	return 0;
+#endif
+}
+
+/*
+ *  stress_swapstat_metrics()
+ *	set the swap in/out rates, zswap activity and compression ratio
+ *	between start and end and the swap in fault latencies from hist
+ *	as metrics from index idx, returns the next free metrics index
+ */
+size_t stress_swapstat_metrics(
+	stress_args_t *args,
+	size_t idx,
+	const stress_swapstat_t *start,
+	const stress_swapstat_t *end,
+	const stress_latency_hist_t *hist)
+{
+	const double duration = end->time - start->time;
+
+	if (duration <= 0.0)
+		return idx;
+
+	stress_metrics_set(args, idx++, "pages swapped in per second",
+		(double)(end->pswpin - start->pswpin) / duration, STRESS_METRIC_GEOMETRIC_MEAN);
+	stress_metrics_set(args, idx++, "pages swapped out per second",
+		(double)(end->pswpout - start->pswpout) / duration, STRESS_METRIC_GEOMETRIC_MEAN);
+	if (hist->count > 0) {
+		stress_metrics_set(args, idx++, "swap in fault latency p50 (nanosecs)",
+			(double)stress_latency_hist_percentile(hist, 50.0), STRESS_METRIC_GEOMETRIC_MEAN);
+		stress_metrics_set(args, idx++, "swap in fault latency p99 (nanosecs)",
+			(double)stress_latency_hist_percentile(hist, 99.0), STRESS_METRIC_GEOMETRIC_MEAN);
+	}
+	/* zswap is disabled or not built in */
+	if ((end->zswpout == start->zswpout) && (end->zswap_kb == 0))
+		return idx;
+	stress_metrics_set(args, idx++, "zswap pages stored per second",
+		(double)(end->zswpout - start->zswpout) / duration, STRESS_METRIC_GEOMETRIC_MEAN);
+	stress_metrics_set(args, idx++, "zswap pages written back per second",
+		(double)(end->zswpwb - start->zswpwb) / duration, STRESS_METRIC_GEOMETRIC_MEAN);
+	if (end->zswap_kb > 0)
+		stress_metrics_set(args, idx++, "zswap compression ratio",
+			(double)end->zswapped_kb / (double)end->zswap_kb, STRESS_METRIC_GEOMETRIC_MEAN);
+	return idx;
+}
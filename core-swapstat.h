@@ -0,0 +1,48 @@
+/*
+ * Copyright (C) 2025      Colin Ian King.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+#ifndef CORE_SWAPSTAT_H
+#define CORE_SWAPSTAT_H
+
+#include "core-attribute.h"
+#include "core-latency.h"
+
+#define STRESS_SWAPSTAT_METRICS	(7)	/* metrics set by stress_swapstat_metrics */
+
+/*
+ *  system wide swap and zswap counters, zero if not available
+ */
+typedef struct {
+	double time;		/* time the counters were read */
+	uint64_t pswpin;	/* pages swapped in */
+	uint64_t pswpout;	/* pages swapped out */
+	uint64_t zswpin;	/* pages loaded from zswap */
+	uint64_t zswpout;	/* pages stored into zswap */
+	uint64_t zswpwb;	/* zswap pages written back to swap */
+	uint64_t zswap_kb;	/* compressed zswap pool size */
+	uint64_t zswapped_kb;	/* uncompressed size of pages in zswap */
+} stress_swapstat_t;
+
+extern void stress_swapstat_read(stress_swapstat_t *stat);
+extern size_t stress_swapstat_fault_latency(void *buf, const size_t len,
+	const size_t page_size, stress_latency_hist_t *hist);
+extern size_t stress_swapstat_metrics(stress_args_t *args, size_t idx,
+	const stress_swapstat_t *start, const stress_swapstat_t *end,
+	const stress_latency_hist_t *hist);
+
+#endif
@@ -201,6 +201,94 @@ int stress_tz_get_temperatures(stress_tz_info_t **tz_info_list, stress_tz_t *tz)
 	return 0;
 }
 
+/*
+ *  stress_tz_get_max_temperature()
+ *	return the hottest thermal zone temperature in degrees C,
+ *	0.0 if no thermal zones are available
+ */
+double stress_tz_get_max_temperature(void)
+{
+	stress_tz_t tz;
+	stress_tz_info_t *tz_info;
+	uint64_t max = 0;
+
+	if (!g_shared->tz_info)
+		return 0.0;
+
+	(void)stress_tz_get_temperatures(&g_shared->tz_info, &tz);
+	for (tz_info = g_shared->tz_info; tz_info; tz_info = tz_info->next) {
+		const uint64_t temp = tz.tz_stat[tz_info->index].temperature;
+
+		/* Avoid crazy temperatures. e.g. > 250 C */
+		if ((temp <= 250000) && (temp > max))
+			max = temp;
+	}
+	return (double)max / 1000.0;
+}
+
+/*
+ *  stress_tz_get_throttle()
+ *	sum the x86 core and package thermal throttle event counters
+ *	of all CPUs. Package counters are shared by all the CPUs in a
+ *	package so only the first CPU of each package is counted.
+ *	Returns -1 if no throttle counters are available.
+ */
+int stress_tz_get_throttle(stress_tz_throttle_t *throttle)
+{
+	static bool no_throttle = false;
+	int32_t cpu, n_packages = 0;
+	int32_t packages[64];
+	const int32_t n_cpus = stress_get_processors_configured();
+	bool found = false;
+
+	throttle->core = 0;
+	throttle->package = 0;
+
+	if (no_throttle)
+		return -1;
+
+	for (cpu = 0; cpu < n_cpus; cpu++) {
+		char path[PATH_MAX], buf[64];
+		uint64_t count;
+		int32_t i, package_id = -1;
+
+		(void)snprintf(path, sizeof(path),
+			"/sys/devices/system/cpu/cpu%" PRId32 "/thermal_throttle/core_throttle_count", cpu);
+		if (stress_system_read(path, buf, sizeof(buf)) <= 0)
+			continue;
+		if (sscanf(buf, "%" SCNu64, &count) != 1)
+			continue;
+		throttle->core += count;
+		found = true;
+
+		(void)snprintf(path, sizeof(path),
+			"/sys/devices/system/cpu/cpu%" PRId32 "/topology/physical_package_id", cpu);
+		if (stress_system_read(path, buf, sizeof(buf)) > 0)
+			if (sscanf(buf, "%" SCNd32, &package_id) != 1)
+				package_id = -1;
+		for (i = 0; i < n_packages; i++) {
+			if (packages[i] == package_id)
+				break;
+		}
+		if (i < n_packages)
+			continue;
+		if (n_packages < (int32_t)SIZEOF_ARRAY(packages))
+			packages[n_packages++] = package_id;
+
+		(void)snprintf(path, sizeof(path),
+			"/sys/devices/system/cpu/cpu%" PRId32 "/thermal_throttle/package_throttle_count", cpu);
+		if (stress_system_read(path, buf, sizeof(buf)) <= 0)
+			continue;
+		if (sscanf(buf, "%" SCNu64, &count) == 1)
+			throttle->package += count;
+	}
+	if (!found) {
+		no_throttle = true;
+		return -1;
+	}
+	return 0;
+}
+
 /*
  *  stress_tz_compare()
  *	sort on type name and if type names are duplicated on
@@ -220,6 +308,64 @@ static int stress_tz_compare(const void *p1, const void *p2)
 }
 
 
+/*
+ *  stress_tz_json()
+ *	add the mean thermal zone temperatures and the throttle
+ *	events of a stressor to a JSON record
+ */
+void stress_tz_json(stress_json_t *json, const stress_stressor_t *ss)
+{
+	const stress_tz_info_t *tz_info;
+	stress_tz_throttle_t throttle = { 0, 0 };
+	bool throttle_valid = false;
+	int32_t j;
+
+	if (!ss->stats)
+		return;
+
+	stress_json_object_begin(json, "thermal-zones");
+	for (tz_info = g_shared->tz_info; tz_info; tz_info = tz_info->next) {
+		uint64_t total = 0;
+		uint32_t count = 0;
+
+		for (j = 0; j < ss->instances; j++) {
+			const uint64_t temp =
+				ss->stats[j]->tz.tz_stat[tz_info->index].temperature;
+			/* Avoid crazy temperatures. e.g. > 250 C */
+			if (temp <= 250000) {
+				total += temp;
+				count++;
+			}
+		}
+		if (total) {
+			char tmp[64];
+
+			if (stress_tz_type_instance(g_shared->tz_info, tz_info->type) <= 1)
+				(void)shim_strscpy(tmp, tz_info->type, sizeof(tmp));
+			else
+				(void)snprintf(tmp, sizeof(tmp), "%s%" PRIu32,
+					tz_info->type, tz_info->type_instance);
+			stress_json_double(json, tmp, ((double)total / count) / 1000.0);
+		}
+	}
+	for (j = 0; j < ss->instances; j++) {
+		const stress_tz_t *tz = &ss->stats[j]->tz;
+
+		if (!tz->throttle_valid)
+			continue;
+		throttle_valid = true;
+		if (throttle.core < tz->throttle.core)
+			throttle.core = tz->throttle.core;
+		if (throttle.package < tz->throttle.package)
+			throttle.package = tz->throttle.package;
+	}
+	if (throttle_valid) {
+		stress_json_uint64(json, "core-throttle-events", throttle.core);
+		stress_json_uint64(json, "package-throttle-events", throttle.package);
+	}
+	stress_json_object_end(json);
+}
+
 /*
  *  stress_tz_dump()
  *	dump thermal zone temperatures
@@ -301,6 +447,42 @@ void stress_tz_dump(FILE *yaml, stress_stressor_t *stressors_list)
 				print_nl = true;
 			}
 		}
+
+		/*
+		 *  throttle counters are system wide so instances overlap,
+		 *  report the largest number of events seen by an instance
+		 */
+		{
+			stress_tz_throttle_t throttle = { 0, 0 };
+			bool throttle_valid = false;
+
+			for (j = 0; j < ss->instances; j++) {
+				const stress_tz_t *tz = &ss->stats[j]->tz;
+
+				if (!tz->throttle_valid)
+					continue;
+				throttle_valid = true;
+				if (throttle.core < tz->throttle.core)
+					throttle.core = tz->throttle.core;
+				if (throttle.package < tz->throttle.package)
+					throttle.package = tz->throttle.package;
+			}
+			if (throttle_valid) {
+				if (!dumped_heading) {
+					const char *name = ss->stressor->name;
+
+					dumped_heading = true;
+					pr_inf("%s:\n", name);
+					pr_yaml(yaml, "    - stressor: %s\n", name);
+				}
+				pr_inf(" %-20s %7" PRIu64 "\n", "core throttles", throttle.core);
+				pr_inf(" %-20s %7" PRIu64 "\n", "package throttles", throttle.package);
+				pr_yaml(yaml, "      core-throttle-events: %" PRIu64 "\n", throttle.core);
+				pr_yaml(yaml, "      package-throttle-events: %" PRIu64 "\n", throttle.package);
+				no_tz_stats = false;
+				print_nl = true;
+			}
+		}
 		if (print_nl)
 			pr_yaml(yaml, "\n");
 
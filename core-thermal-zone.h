@@ -20,6 +20,7 @@
 #define CORE_THERMAL_ZONES_H
 
 #include "core-attribute.h"
+#include "core-json.h"
 
 /* linux thermal zones */
 #define	STRESS_THERMAL_ZONES	 (1)
@@ -39,15 +40,26 @@ typedef struct {
 	uint64_t temperature;		/* temperature in Celsius * 1000 */
 } stress_tz_stat_t;
 
+/* x86 thermal throttle event counts */
+typedef struct {
+	uint64_t core;			/* core throttle events, all CPUs */
+	uint64_t package;		/* package throttle events, all packages */
+} stress_tz_throttle_t;
+
 typedef struct {
 	stress_tz_stat_t tz_stat[STRESS_THERMAL_ZONES_MAX];
+	stress_tz_throttle_t throttle;	/* throttle events during stressor run */
+	bool	throttle_valid;		/* true if throttle counters were read */
 } stress_tz_t;
 
 extern int stress_tz_init(stress_tz_info_t **tz_info_list);
 extern void stress_tz_free(stress_tz_info_t **tz_info_list);
 extern int stress_tz_get_temperatures(stress_tz_info_t **tz_info_list,
 	stress_tz_t *tz);
+extern int stress_tz_get_throttle(stress_tz_throttle_t *throttle);
+extern double stress_tz_get_max_temperature(void);
 extern void stress_tz_dump(FILE *yaml, stress_stressor_t *stressors_list);
+extern void stress_tz_json(stress_json_t *json, const stress_stressor_t *ss);
 #endif
 
 #endif
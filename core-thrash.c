@@ -25,6 +25,30 @@
 #include <ctype.h>
 #include <sched.h>
 
+/*
+ *  stress_drop_caches_mode()
+ *	drop clean caches, mode 1 drops the page cache, 2 drops
+ *	reclaimable slab objects and 3 drops both. Returns the
+ *	number of bytes written or -errno on failure
+ */
+ssize_t stress_drop_caches_mode(const int mode)
+{
+#if defined(__linux__)
+	char str[2];
+
+	if ((mode < 1) || (mode > 3))
+		return -EINVAL;
+	str[0] = '0' + (char)mode;
+	str[1] = '\0';
+
+	return stress_system_write("/proc/sys/vm/drop_caches", str, 1);
+#else
+	(void)mode;
+
+	return -ENOSYS;
+#endif
+}
+
 #if defined(__linux__) &&	\
     defined(HAVE_PTRACE)
 
@@ -421,13 +445,9 @@ static inline void stress_drop_caches(void)
 {
 #if defined(__linux__)
 	static int method = 0;
-	char str[3];
-
-	str[0] = '1' + (char)method;
-	str[1] = '\0';
 
 	stress_thrash_state("dropcache");
-	VOID_RET(ssize_t, stress_system_write("/proc/sys/vm/drop_caches", str, 1));
+	VOID_RET(ssize_t, stress_drop_caches_mode(method + 1));
 	if (method++ >= 2)
 		method = 0;
 #endif
@@ -25,5 +25,6 @@
 extern int  stress_thrash_start(void);
 extern void stress_thrash_stop(void);
 extern int stress_pagein_self(const char *name);
+extern ssize_t stress_drop_caches_mode(const int mode);
 
 #endif
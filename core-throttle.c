@@ -0,0 +1,274 @@
+/*
+ * Copyright (C) 2025      Colin Ian King
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+#include "stress-ng.h"
+#include "core-killpid.h"
+#include "core-rapl.h"
+#include "core-throttle.h"
+
+#define STRESS_THROTTLE_PERIOD		(0.05)	/* stressor duty cycle period, seconds */
+#define STRESS_THROTTLE_SLEEP_MAX	(1.0)	/* longest single throttle sleep, seconds */
+#define STRESS_THROTTLE_INTERVAL	(1.0)	/* controller update interval, seconds */
+#define STRESS_THROTTLE_GAIN		(0.5)	/* controller damping gain */
+#define STRESS_THROTTLE_DUTY_MIN	(0.01)
+#define STRESS_THROTTLE_DUTY_MAX	(1.0)
+
+typedef struct {
+	uint64_t busy;			/* busy jiffies, all CPUs */
+	uint64_t total;			/* total jiffies, all CPUs */
+} stress_throttle_cpu_t;
+
+/*
+ *  stress_throttle()
+ *	throttle hook called from stress_continue() when a --target-*
+ *	option is enabled, the stressor runs for duty * period and then
+ *	sleeps for the remainder of the period. If the stressor checks
+ *	in less often than the period the sleep is scaled to match the
+ *	time it has been running for.
+ */
+void stress_throttle(stress_args_t *args)
+{
+	const double duty = g_shared->throttle.duty;
+	double now, run, idle;
+
+	if (duty >= STRESS_THROTTLE_DUTY_MAX)
+		return;
+	now = stress_time_now();
+	run = now - args->throttle_start;
+	if (run < STRESS_THROTTLE_PERIOD * duty)
+		return;
+
+	idle = run * (1.0 - duty) / duty;
+	if (idle > STRESS_THROTTLE_SLEEP_MAX)
+		idle = STRESS_THROTTLE_SLEEP_MAX;
+	if (now + idle > args->time_end)
+		idle = args->time_end - now;
+	if (idle > 0.0)
+		(void)shim_nanosleep_uint64((uint64_t)(idle * STRESS_DBL_NANOSECOND));
+	args->throttle_start = stress_time_now();
+}
+
+#if defined(__linux__)
+static pid_t throttle_pid;
+
+/*
+ *  stress_throttle_read_cpu()
+ *	read aggregate CPU busy and total jiffies from /proc/stat
+ */
+static int stress_throttle_read_cpu(stress_throttle_cpu_t *cpu)
+{
+	FILE *fp;
+	char buffer[1024];
+	uint64_t user = 0, nice = 0, system = 0, idle = 0;
+	uint64_t iowait = 0, irq = 0, softirq = 0, steal = 0;
+	int n;
+
+	fp = fopen("/proc/stat", "r");
+	if (!fp)
+		return -1;
+	if (!fgets(buffer, sizeof(buffer), fp)) {
+		(void)fclose(fp);
+		return -1;
+	}
+	(void)fclose(fp);
+
+	n = sscanf(buffer, "cpu %" SCNu64 " %" SCNu64 " %" SCNu64 " %" SCNu64
+		" %" SCNu64 " %" SCNu64 " %" SCNu64 " %" SCNu64,
+		&user, &nice, &system, &idle, &iowait, &irq, &softirq, &steal);
+	if (n < 4)
+		return -1;
+
+	cpu->busy = user + nice + system + irq + softirq + steal;
+	cpu->total = cpu->busy + idle + iowait;
+	return 0;
+}
+
+#if defined(STRESS_RAPL)
+/*
+ *  stress_throttle_read_power()
+ *	sum the power of the RAPL package domains
+ */
+static int stress_throttle_read_power(double *watts)
+{
+	const stress_rapl_domain_t *rapl_domain;
+	bool found = false;
+
+	if (stress_rapl_get_power_raplstat(g_shared->rapl_domains) < 0)
+		return -1;
+
+	*watts = 0.0;
+	for (rapl_domain = g_shared->rapl_domains; rapl_domain; rapl_domain = rapl_domain->next) {
+		if (strncmp(rapl_domain->domain_name, "pkg-", 4))
+			continue;
+		*watts += rapl_domain->data[STRESS_RAPL_DATA_RAPLSTAT].power_watts;
+		found = true;
+	}
+	return found ? 0 : -1;
+}
+#endif
+
+/*
+ *  stress_throttle_start()
+ *	start the --target-power or --target-util controller process,
+ *	returns 0 if started or not required, -1 if it cannot be started
+ */
+int stress_throttle_start(void)
+{
+	int32_t target_power = 0, target_util = 0;
+	stress_throttle_cpu_t cpu_prev;
+	const char *units;
+	double target, duty = STRESS_THROTTLE_DUTY_MAX;
+	double t_next;
+
+	g_shared->throttle.duty = STRESS_THROTTLE_DUTY_MAX;
+	g_shared->throttle.achieved_total = 0.0;
+	g_shared->throttle.samples = 0;
+
+	(void)stress_get_setting("target-power", &target_power);
+	(void)stress_get_setting("target-util", &target_util);
+	if (target_power > 0) {
+#if defined(STRESS_RAPL)
+		double watts;
+
+		if (!g_shared->rapl_domains ||
+		    (stress_throttle_read_power(&watts) < 0)) {
+			pr_inf("cannot read RAPL package power, --target-power disabled\n");
+			return -1;
+		}
+		target = (double)target_power;
+		units = "W";
+#else
+		pr_inf("--target-power requires RAPL power domains which are not supported on this system\n");
+		return -1;
+#endif
+	} else if (target_util > 0) {
+		if (stress_throttle_read_cpu(&cpu_prev) < 0) {
+			pr_inf("cannot read /proc/stat, --target-util disabled\n");
+			return -1;
+		}
+		target = (double)target_util;
+		units = "%";
+	} else {
+		return 0;
+	}
+
+	throttle_pid = fork();
+	if (throttle_pid < 0) {
+		pr_err("cannot fork throttle controller, errno=%d (%s), "
+			"--target-%s disabled\n", errno, strerror(errno),
+			(target_power > 0) ? "power" : "util");
+		throttle_pid = 0;
+		return -1;
+	} else if (throttle_pid > 0) {
+		return 0;
+	}
+
+	stress_parent_died_alarm();
+	stress_set_proc_name("throttle [periodic]");
+
+	t_next = stress_time_now() + STRESS_THROTTLE_INTERVAL;
+	while (stress_continue_flag()) {
+		double achieved = 0.0, ratio;
+		const double delay = t_next - stress_time_now();
+
+		if (delay > 0.0)
+			(void)shim_nanosleep_uint64((uint64_t)(delay * STRESS_DBL_NANOSECOND));
+		t_next += STRESS_THROTTLE_INTERVAL;
+		if (!stress_continue_flag())
+			break;
+
+		if (target_power > 0) {
+#if defined(STRESS_RAPL)
+			if (stress_throttle_read_power(&achieved) < 0)
+				continue;
+#endif
+		} else {
+			stress_throttle_cpu_t cpu;
+			uint64_t total;
+
+			if (stress_throttle_read_cpu(&cpu) < 0)
+				continue;
+			total = cpu.total - cpu_prev.total;
+			if (total > 0)
+				achieved = 100.0 * (double)(cpu.busy - cpu_prev.busy) / (double)total;
+			cpu_prev = cpu;
+		}
+
+		/*
+		 *  Damped multiplicative update, achieved power and
+		 *  utilization scale roughly linearly with duty cycle
+		 */
+		ratio = (achieved > 0.0) ? target / achieved : 2.0;
+		if (ratio > 2.0)
+			ratio = 2.0;
+		else if (ratio < 0.5)
+			ratio = 0.5;
+		duty *= 1.0 + STRESS_THROTTLE_GAIN * (ratio - 1.0);
+		if (duty > STRESS_THROTTLE_DUTY_MAX)
+			duty = STRESS_THROTTLE_DUTY_MAX;
+		else if (duty < STRESS_THROTTLE_DUTY_MIN)
+			duty = STRESS_THROTTLE_DUTY_MIN;
+
+		g_shared->throttle.duty = duty;
+		g_shared->throttle.achieved_total += achieved;
+		g_shared->throttle.samples++;
+
+		pr_inf("throttle: target %.2f%s, achieved %.2f%s, duty cycle %.1f%%\n",
+			target, units, achieved, units, duty * 100.0);
+	}
+	_exit(0);
+}
+
+/*
+ *  stress_throttle_stop()
+ *	stop the controller and report the mean achieved value
+ */
+void stress_throttle_stop(void)
+{
+	int32_t target_power = 0, target_util = 0;
+	uint64_t samples;
+
+	if (throttle_pid <= 0)
+		return;
+	(void)stress_kill_pid_wait(throttle_pid, NULL);
+	throttle_pid = 0;
+
+	samples = g_shared->throttle.samples;
+	if (samples == 0)
+		return;
+	(void)stress_get_setting("target-power", &target_power);
+	(void)stress_get_setting("target-util", &target_util);
+	if (target_power > 0)
+		pr_inf("throttle: target %" PRId32 "W, mean achieved %.2fW over %" PRIu64 " samples\n",
+			target_power, g_shared->throttle.achieved_total / (double)samples, samples);
+	else
+		pr_inf("throttle: target %" PRId32 "%%, mean achieved %.2f%% over %" PRIu64 " samples\n",
+			target_util, g_shared->throttle.achieved_total / (double)samples, samples);
+}
+#else
+int stress_throttle_start(void)
+{
+	g_shared->throttle.duty = STRESS_THROTTLE_DUTY_MAX;
+	pr_inf("--target-power and --target-util are only supported on Linux\n");
+	return -1;
+}
+
+void stress_throttle_stop(void)
+{
+}
+#endif
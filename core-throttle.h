@@ -0,0 +1,36 @@
+/*
+ * Copyright (C) 2025      Colin Ian King
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+#ifndef CORE_THROTTLE_H
+#define CORE_THROTTLE_H
+
+#include "core-attribute.h"
+
+#define STRESS_TARGET_POWER_MAX		(100000)	/* Watts */
+#define STRESS_TARGET_UTIL_MAX		(100)		/* Percent */
+
+/*
+ *  --target-power and --target-util closed loop controller,
+ *  a periodic process measures package power or host CPU
+ *  utilization and adjusts a shared duty cycle that the
+ *  stressors honour via stress_continue()
+ */
+extern int stress_throttle_start(void);
+extern void stress_throttle_stop(void);
+
+#endif
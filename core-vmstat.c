@@ -115,13 +115,30 @@ typedef struct {
 	uint64_t	discard_ticks;	/* total wait time for discard requests */
 } stress_iostat_t;
 
+/*
+ *  Persistently opened stat file, re-read with pread() into
+ *  a reusable buffer to keep the sampling overhead low
+ */
+typedef struct {
+	int fd;				/* file descriptor, -1 if not open */
+	char *buf;			/* reusable read buffer */
+	size_t len;			/* size of buf */
+	bool opened;			/* true if open has been attempted */
+} stress_stat_file_t;
+
+#define STRESS_STAT_DELAY_MIN	(0.1)	/* seconds */
+#define STRESS_STAT_DELAY_MAX	(3600.0)/* seconds */
+
 static uint64_t vmstat_units_kb = 1;	/* kilobytes */
 
+/* delays are in milliseconds */
 static int32_t status_delay = 0;
 static int32_t vmstat_delay = 0;
 static int32_t thermalstat_delay = 0;
 static int32_t iostat_delay = 0;
 static int32_t raplstat_delay = 0;
+static int32_t metrics_interval_delay = 0;
+static int32_t warmup_delay = 0;	/* or STRESS_WARMUP_AUTO */
 
 
 #if defined(__FreeBSD__)
@@ -190,13 +207,28 @@ static int stress_set_generic_stat(
 	const char *name,
 	int32_t *delay)
 {
-	const uint64_t delay64 = stress_get_uint64_time(opt);
+	double delay_secs;
+
+	/* fractional seconds allow for sub-second sampling */
+	if (strchr(opt, '.')) {
+		char *end;
 
-        if (UNLIKELY((delay64 < 1) || (delay64 > 3600))) {
-                (void)fprintf(stderr, "%s must in the range 1 to 3600 seconds.\n", name);
+		errno = 0;
+		delay_secs = strtod(opt, &end);
+		if ((errno != 0) || (end == opt) || (*end != '\0')) {
+			(void)fprintf(stderr, "%s: invalid time '%s'\n", name, opt);
+			_exit(EXIT_FAILURE);
+		}
+	} else {
+		delay_secs = (double)stress_get_uint64_time(opt);
+	}
+
+        if (UNLIKELY((delay_secs < STRESS_STAT_DELAY_MIN) || (delay_secs > STRESS_STAT_DELAY_MAX))) {
+                (void)fprintf(stderr, "%s must in the range %.1f to %.0f seconds.\n",
+			name, STRESS_STAT_DELAY_MIN, STRESS_STAT_DELAY_MAX);
                 _exit(EXIT_FAILURE);
         }
-	*delay = (int32_t)(delay64 & 0x7fffffff);
+	*delay = (int32_t)(delay_secs * 1000.0);
 	return 0;
 }
 
@@ -251,6 +283,32 @@ int stress_set_raplstat(const char *const opt)
 	return stress_set_generic_stat(opt, "raplstat", &raplstat_delay);
 }
 
+/*
+ *  stress_set_metrics_interval()
+ *	parse --metrics-interval option
+ */
+int stress_set_metrics_interval(const char *const opt)
+{
+	g_opt_flags |= OPT_FLAGS_TZ_INFO;
+	return stress_set_generic_stat(opt, "metrics-interval", &metrics_interval_delay);
+}
+
+/*
+ *  stress_set_warmup()
+ *	parse --warmup option, seconds or auto
+ */
+int stress_set_warmup(const char *const opt)
+{
+	int ret = 0;
+
+	if (!strcmp(opt, "auto"))
+		warmup_delay = STRESS_WARMUP_AUTO;
+	else
+		ret = stress_set_generic_stat(opt, "warmup", &warmup_delay);
+	stress_set_setting_global("warmup", TYPE_ID_INT32, &warmup_delay);
+	return ret;
+}
+
 /*
  *  stress_find_mount_dev()
  *	find the path of the device that the file is located on
@@ -357,6 +415,115 @@ char *stress_find_mount_dev(const char *name)
 
 static pid_t vmstat_pid;
 
+#if defined(__linux__)
+/*
+ *  stress_stat_file_open()
+ *	open a stat file for repeated reading with stress_stat_file_read()
+ */
+static void stress_stat_file_open(stress_stat_file_t *sf, const char *path, const size_t len)
+{
+	sf->fd = open(path, O_RDONLY);
+	sf->buf = NULL;
+	sf->len = len;
+	sf->opened = true;
+}
+
+/*
+ *  stress_stat_file_close()
+ *	close a stat file and free its buffer so it can be re-opened
+ */
+static void stress_stat_file_close(stress_stat_file_t *sf)
+{
+	if (sf->fd >= 0)
+		(void)close(sf->fd);
+	free(sf->buf);
+	sf->fd = -1;
+	sf->buf = NULL;
+	sf->len = 0;
+	sf->opened = false;
+}
+
+/*
+ *  stress_stat_file_read()
+ *	re-read a stat file from the start into its reusable buffer,
+ *	the file is opened on the first read if it is not already open
+ *	and the buffer is only grown if the contents do not fit. Returns
+ *	the NUL terminated contents or NULL on failure.
+ */
+static const char *stress_stat_file_read(stress_stat_file_t *sf, const char *path)
+{
+	if (!sf->opened && path)
+		stress_stat_file_open(sf, path, 4096);
+	if (sf->fd < 0)
+		return NULL;
+
+	if (!sf->buf) {
+		sf->buf = (char *)malloc(sf->len);
+		if (!sf->buf)
+			return NULL;
+	}
+
+	for (;;) {
+		char *buf;
+		const ssize_t n = pread(sf->fd, sf->buf, sf->len - 1, 0);
+
+		if (n < 0)
+			return NULL;
+		sf->buf[n] = '\0';
+		if ((size_t)n < sf->len - 1)
+			break;
+
+		/* possibly truncated, grow buffer and re-read */
+		buf = (char *)realloc(sf->buf, sf->len << 1);
+		if (!buf)
+			break;
+		sf->buf = buf;
+		sf->len <<= 1;
+	}
+	return sf->buf;
+}
+
+/*
+ *  stress_stat_u64()
+ *	parse an unsigned decimal number skipping leading white space,
+ *	*ptr is advanced to the end of the number
+ */
+static inline uint64_t stress_stat_u64(const char **ptr)
+{
+	const char *p = *ptr;
+	uint64_t val = 0;
+
+	while ((*p == ' ') || (*p == '\t'))
+		p++;
+	while ((*p >= '0') && (*p <= '9')) {
+		val = (val * 10) + (uint64_t)(*p - '0');
+		p++;
+	}
+	*ptr = p;
+	return val;
+}
+
+/*
+ *  stress_stat_key()
+ *	return pointer to the text after key if line starts with key,
+ *	otherwise NULL
+ */
+static inline const char *stress_stat_key(const char *line, const char *key, const size_t len)
+{
+	return strncmp(line, key, len) ? NULL : line + len;
+}
+
+/*
+ *  stress_stat_next_line()
+ *	return start of the next line, NULL if there are no more lines
+ */
+static inline const char *stress_stat_next_line(const char *ptr)
+{
+	ptr = strchr(ptr, '\n');
+	return (ptr && ptr[1]) ? ptr + 1 : NULL;
+}
+#endif
+
 #if defined(HAVE_SYS_SYSMACROS_H) &&	\
     defined(__linux__)
 
@@ -412,33 +579,33 @@ static char *stress_iostat_iostat_name(
  */
 static void stress_read_iostat(const char *iostat_name, stress_iostat_t *iostat)
 {
-	FILE *fp;
-
-	fp = fopen(iostat_name, "r");
-	if (fp) {
-		int ret;
-
-		ret = fscanf(fp,
-			    "%" PRIu64 " %" PRIu64
-			    " %" PRIu64 " %" PRIu64
-			    " %" PRIu64 " %" PRIu64
-			    " %" PRIu64 " %" PRIu64
-			    " %" PRIu64 " %" PRIu64
-			    " %" PRIu64 " %" PRIu64
-			    " %" PRIu64 " %" PRIu64
-			    " %" PRIu64,
-			&iostat->read_io, &iostat->read_merges,
-			&iostat->read_sectors, &iostat->read_ticks,
-			&iostat->write_io, &iostat->write_merges,
-			&iostat->write_sectors, &iostat->write_ticks,
-			&iostat->in_flight, &iostat->io_ticks,
-			&iostat->time_in_queue,
-			&iostat->discard_io, &iostat->discard_merges,
-			&iostat->discard_sectors, &iostat->discard_ticks);
-		(void)fclose(fp);
-
-		if (ret != 15)
-			(void)shim_memset(iostat, 0, sizeof(*iostat));
+	static stress_stat_file_t iostat_file;
+	static char iostat_file_name[PATH_MAX];
+	const char *ptr;
+
+	/* the file is kept open, re-open it if the device changes */
+	if (iostat_file.opened && strcmp(iostat_file_name, iostat_name))
+		stress_stat_file_close(&iostat_file);
+	if (!iostat_file.opened)
+		(void)shim_strscpy(iostat_file_name, iostat_name, sizeof(iostat_file_name));
+
+	ptr = stress_stat_file_read(&iostat_file, iostat_name);
+	if (ptr) {
+		iostat->read_io = stress_stat_u64(&ptr);
+		iostat->read_merges = stress_stat_u64(&ptr);
+		iostat->read_sectors = stress_stat_u64(&ptr);
+		iostat->read_ticks = stress_stat_u64(&ptr);
+		iostat->write_io = stress_stat_u64(&ptr);
+		iostat->write_merges = stress_stat_u64(&ptr);
+		iostat->write_sectors = stress_stat_u64(&ptr);
+		iostat->write_ticks = stress_stat_u64(&ptr);
+		iostat->in_flight = stress_stat_u64(&ptr);
+		iostat->io_ticks = stress_stat_u64(&ptr);
+		iostat->time_in_queue = stress_stat_u64(&ptr);
+		iostat->discard_io = stress_stat_u64(&ptr);
+		iostat->discard_merges = stress_stat_u64(&ptr);
+		iostat->discard_sectors = stress_stat_u64(&ptr);
+		iostat->discard_ticks = stress_stat_u64(&ptr);
 	}
 }
 
@@ -465,7 +632,8 @@ static void stress_get_iostat(const char *iostat_name, stress_iostat_t *iostat)
 	STRESS_IOSTAT_DELTA(write_merges);
 	STRESS_IOSTAT_DELTA(write_sectors);
 	STRESS_IOSTAT_DELTA(write_ticks);
-	STRESS_IOSTAT_DELTA(in_flight);
+	/* in_flight is a gauge and not a counter */
+	iostat->in_flight = iostat_current.in_flight;
 	STRESS_IOSTAT_DELTA(io_ticks);
 	STRESS_IOSTAT_DELTA(time_in_queue);
 	STRESS_IOSTAT_DELTA(discard_io);
@@ -477,217 +645,78 @@ static void stress_get_iostat(const char *iostat_name, stress_iostat_t *iostat)
 #endif
 
 #if defined(__linux__)
-/*
- *  stress_next_field()
- *	skip to next field, returns false if end of
- *	string and/or no next field.
- */
-static bool stress_next_field(char **str)
-{
-	char *ptr = *str;
-
-	while (*ptr && (*ptr != ' '))
-		ptr++;
-
-	if (!*ptr)
-		return false;
-
-	while (*ptr == ' ')
-		ptr++;
-
-	if (!*ptr)
-		return false;
-
-	*str = ptr;
-	return true;
-}
-
 /*
  *  stress_read_vmstat()
- *	read vmstat statistics
+ *	read vmstat statistics, the files are kept open and re-read
+ *	with pread() and parsed in place to minimize sampling overhead
  */
 static void stress_read_vmstat(stress_vmstat_t *vmstat)
 {
-	FILE *fp;
-	char buffer[1024];
-
-	fp = fopen("/proc/stat", "r");
-	if (fp) {
-		while (fgets(buffer, sizeof(buffer), fp)) {
-			char *ptr = buffer;
-
-			if (!strncmp(buffer, "cpu ", 4))
-				continue;
-			if (!strncmp(buffer, "cpu", 3)) {
-				if (!stress_next_field(&ptr))
-					continue;
-				/* user time */
-				vmstat->user_time += (uint64_t)atoll(ptr);
-				if (!stress_next_field(&ptr))
-					continue;
-
-				/* user time nice */
-				vmstat->user_time += (uint64_t)atoll(ptr);
-				if (!stress_next_field(&ptr))
-					continue;
-
-				/* system time */
-				vmstat->system_time += (uint64_t)atoll(ptr);
-				if (!stress_next_field(&ptr))
-					continue;
-
-				/* idle time */
-				vmstat->idle_time += (uint64_t)atoll(ptr);
-				if (!stress_next_field(&ptr))
-					continue;
-
-				/* iowait time */
-				vmstat->wait_time += (uint64_t)atoll(ptr);
-				if (!stress_next_field(&ptr))
-					continue;
-
-				/* irq time, account in system time */
-				vmstat->system_time += (uint64_t)atoll(ptr);
-				if (!stress_next_field(&ptr))
-					continue;
-
-				/* soft time, account in system time */
-				vmstat->system_time += (uint64_t)atoll(ptr);
-				if (!stress_next_field(&ptr))
-					continue;
-
-				/* stolen time */
-				vmstat->stolen_time += (uint64_t)atoll(ptr);
-				if (!stress_next_field(&ptr))
-					continue;
-
-				/* guest time, add to stolen stats */
-				vmstat->stolen_time += (uint64_t)atoll(ptr);
-				if (!stress_next_field(&ptr))
-					continue;
-
-				/* guest_nice time, add to stolen stats */
-				vmstat->stolen_time += (uint64_t)atoll(ptr);
-				if (!stress_next_field(&ptr))
-					continue;
-			}
-
-			if (!strncmp(buffer, "intr", 4)) {
-				if (!stress_next_field(&ptr))
-					continue;
-				/* interrupts */
-				vmstat->interrupt = (uint64_t)atoll(ptr);
-			}
-			if (!strncmp(buffer, "ctxt", 4)) {
-				if (!stress_next_field(&ptr))
-					continue;
-				/* context switches */
-				vmstat->context_switch = (uint64_t)atoll(ptr);
-			}
-			if (!strncmp(buffer, "procs_running", 13)) {
-				if (!stress_next_field(&ptr))
-					continue;
-				/* processes running */
-				vmstat->procs_running = (uint64_t)atoll(ptr);
-			}
-			if (!strncmp(buffer, "procs_blocked", 13)) {
-				if (!stress_next_field(&ptr))
-					continue;
-				/* procesess blocked */
-				vmstat->procs_blocked = (uint64_t)atoll(ptr);
-			}
-			if (!strncmp(buffer, "swap", 4)) {
-				if (!stress_next_field(&ptr))
-					continue;
-				/* swap in */
-				vmstat->swap_in = (uint64_t)atoll(ptr);
-
-				if (!stress_next_field(&ptr))
-					continue;
-				/* swap out */
-				vmstat->swap_out = (uint64_t)atoll(ptr);
-			}
+	static stress_stat_file_t stat_file, meminfo_file, vmstat_file;
+	const char *line, *ptr;
+
+	for (line = stress_stat_file_read(&stat_file, "/proc/stat"); line; line = stress_stat_next_line(line)) {
+		if ((ptr = stress_stat_key(line, "cpu ", 4)) != NULL) {
+			/* user and nice time */
+			vmstat->user_time = stress_stat_u64(&ptr);
+			vmstat->user_time += stress_stat_u64(&ptr);
+			/* system time */
+			vmstat->system_time = stress_stat_u64(&ptr);
+			/* idle and iowait time */
+			vmstat->idle_time = stress_stat_u64(&ptr);
+			vmstat->wait_time = stress_stat_u64(&ptr);
+			/* irq and soft irq time, account in system time */
+			vmstat->system_time += stress_stat_u64(&ptr);
+			vmstat->system_time += stress_stat_u64(&ptr);
+			/* stolen, guest and guest_nice time */
+			vmstat->stolen_time = stress_stat_u64(&ptr);
+			vmstat->stolen_time += stress_stat_u64(&ptr);
+			vmstat->stolen_time += stress_stat_u64(&ptr);
+		} else if ((ptr = stress_stat_key(line, "intr ", 5)) != NULL) {
+			vmstat->interrupt = stress_stat_u64(&ptr);
+		} else if ((ptr = stress_stat_key(line, "ctxt ", 5)) != NULL) {
+			vmstat->context_switch = stress_stat_u64(&ptr);
+		} else if ((ptr = stress_stat_key(line, "procs_running ", 14)) != NULL) {
+			vmstat->procs_running = stress_stat_u64(&ptr);
+		} else if ((ptr = stress_stat_key(line, "procs_blocked ", 14)) != NULL) {
+			vmstat->procs_blocked = stress_stat_u64(&ptr);
+		} else if ((ptr = stress_stat_key(line, "swap ", 5)) != NULL) {
+			vmstat->swap_in = stress_stat_u64(&ptr);
+			vmstat->swap_out = stress_stat_u64(&ptr);
 		}
-		(void)fclose(fp);
 	}
 
-	fp = fopen("/proc/meminfo", "r");
-	if (fp) {
-		while (fgets(buffer, sizeof(buffer), fp)) {
-			char *ptr = buffer;
-
-			if (!strncmp(buffer, "MemFree", 7)) {
-				if (!stress_next_field(&ptr))
-					continue;
-				vmstat->memory_free = (uint64_t)atoll(ptr);
-			}
-			if (!strncmp(buffer, "Buffers", 7)) {
-				if (!stress_next_field(&ptr))
-					continue;
-				vmstat->memory_buff = (uint64_t)atoll(ptr);
-			}
-			if (!strncmp(buffer, "Cached", 6)) {
-				if (!stress_next_field(&ptr))
-					continue;
-				vmstat->memory_cached = (uint64_t)atoll(ptr);
-			}
-			if (!strncmp(buffer, "KReclaimable", 12)) {
-				if (!stress_next_field(&ptr))
-					continue;
-				vmstat->memory_reclaimable = (uint64_t)atoll(ptr);
-			}
-			if (!strncmp(buffer, "SwapTotal", 9)) {
-				if (!stress_next_field(&ptr))
-					continue;
-				vmstat->swap_total = (uint64_t)atoll(ptr);
-			}
-			if (!strncmp(buffer, "SwapFree", 8)) {
-				if (!stress_next_field(&ptr))
-					continue;
-				vmstat->swap_free = (uint64_t)atoll(ptr);
-			}
-			if (!strncmp(buffer, "SwapUsed", 8)) {
-				if (!stress_next_field(&ptr))
-					continue;
-				vmstat->swap_used = (uint64_t)atoll(ptr);
-			}
-		}
-		(void)fclose(fp);
-
-		if ((vmstat->swap_used == 0) &&
-		    (vmstat->swap_free > 0) &&
-		    (vmstat->swap_total > 0)) {
-			vmstat->swap_used = vmstat->swap_total - vmstat->swap_free;
-		}
+	for (line = stress_stat_file_read(&meminfo_file, "/proc/meminfo"); line; line = stress_stat_next_line(line)) {
+		if ((ptr = stress_stat_key(line, "MemFree:", 8)) != NULL)
+			vmstat->memory_free = stress_stat_u64(&ptr);
+		else if ((ptr = stress_stat_key(line, "Buffers:", 8)) != NULL)
+			vmstat->memory_buff = stress_stat_u64(&ptr);
+		else if ((ptr = stress_stat_key(line, "Cached:", 7)) != NULL)
+			vmstat->memory_cached = stress_stat_u64(&ptr);
+		else if ((ptr = stress_stat_key(line, "KReclaimable:", 13)) != NULL)
+			vmstat->memory_reclaimable = stress_stat_u64(&ptr);
+		else if ((ptr = stress_stat_key(line, "SwapTotal:", 10)) != NULL)
+			vmstat->swap_total = stress_stat_u64(&ptr);
+		else if ((ptr = stress_stat_key(line, "SwapFree:", 9)) != NULL)
+			vmstat->swap_free = stress_stat_u64(&ptr);
+		else if ((ptr = stress_stat_key(line, "SwapUsed:", 9)) != NULL)
+			vmstat->swap_used = stress_stat_u64(&ptr);
+	}
+	if ((vmstat->swap_used == 0) &&
+	    (vmstat->swap_free > 0) &&
+	    (vmstat->swap_total > 0)) {
+		vmstat->swap_used = vmstat->swap_total - vmstat->swap_free;
 	}
 
-	fp = fopen("/proc/vmstat", "r");
-	if (fp) {
-		while (fgets(buffer, sizeof(buffer), fp)) {
-			char *ptr = buffer;
-
-			if (!strncmp(buffer, "pgpgin", 6)) {
-				if (!stress_next_field(&ptr))
-					continue;
-				vmstat->block_in = (uint64_t)atoll(ptr);
-			}
-			if (!strncmp(buffer, "pgpgout", 7)) {
-				if (!stress_next_field(&ptr))
-					continue;
-				vmstat->block_out = (uint64_t)atoll(ptr);
-			}
-			if (!strncmp(buffer, "pswpin", 6)) {
-				if (!stress_next_field(&ptr))
-					continue;
-				vmstat->swap_in = (uint64_t)atoll(ptr);
-			}
-			if (!strncmp(buffer, "pswpout", 7)) {
-				if (!stress_next_field(&ptr))
-					continue;
-				vmstat->swap_out = (uint64_t)atoll(ptr);
-			}
-		}
-		(void)fclose(fp);
+	for (line = stress_stat_file_read(&vmstat_file, "/proc/vmstat"); line; line = stress_stat_next_line(line)) {
+		if ((ptr = stress_stat_key(line, "pgpgin ", 7)) != NULL)
+			vmstat->block_in = stress_stat_u64(&ptr);
+		else if ((ptr = stress_stat_key(line, "pgpgout ", 8)) != NULL)
+			vmstat->block_out = stress_stat_u64(&ptr);
+		else if ((ptr = stress_stat_key(line, "pswpin ", 7)) != NULL)
+			vmstat->swap_in = stress_stat_u64(&ptr);
+		else if ((ptr = stress_stat_key(line, "pswpout ", 8)) != NULL)
+			vmstat->swap_out = stress_stat_u64(&ptr);
 	}
 }
 #elif defined(__FreeBSD__)
@@ -967,24 +996,45 @@ static void stress_get_vmstat(stress_vmstat_t *vmstat)
 #if defined(__linux__)
 /*
  *  stress_get_tz_info()
- *	get temperature in degrees C from a thermal zone
+ *	get temperature in degrees C from a thermal zone temp file
+ */
+static double stress_get_tz_info(stress_stat_file_t *tz_file)
+{
+	const char *ptr = stress_stat_file_read(tz_file, NULL);
+	bool negative;
+	double temp;
+
+	if (!ptr)
+		return 0.0;
+	negative = (*ptr == '-');
+	if (negative)
+		ptr++;
+	temp = (double)stress_stat_u64(&ptr) / 1000.0;
+	return negative ? -temp : temp;
+}
+
+/*
+ *  stress_tz_files_open()
+ *	open the temp files of the thermal zones
  */
-static double stress_get_tz_info(const stress_tz_info_t *tz_info)
+static stress_stat_file_t *stress_tz_files_open(const size_t tz_num)
 {
-	double temp = 0.0;
-	FILE *fp;
-	char path[PATH_MAX];
-
-	(void)snprintf(path, sizeof(path),
-		"/sys/class/thermal/%s/temp",
-		tz_info->path);
-
-	if ((fp = fopen(path, "r")) != NULL) {
-		if (fscanf(fp, "%lf", &temp) == 1)
-			temp /= 1000.0;
-		(void)fclose(fp);
+	stress_stat_file_t *tz_files;
+	const stress_tz_info_t *tz_info;
+	size_t i;
+
+	tz_files = (stress_stat_file_t *)calloc(tz_num, sizeof(*tz_files));
+	if (!tz_files)
+		return NULL;
+	for (i = 0, tz_info = g_shared->tz_info; tz_info && (i < tz_num); tz_info = tz_info->next, i++) {
+		char path[PATH_MAX];
+
+		(void)snprintf(path, sizeof(path),
+			"/sys/class/thermal/%s/temp",
+			tz_info->path);
+		stress_stat_file_open(&tz_files[i], path, 32);
 	}
-	return temp;
+	return tz_files;
 }
 #endif
 
@@ -1005,50 +1055,63 @@ static inline void stress_zero_cpu_ghz(
 #if defined(__linux__)
 /*
  *  stress_get_cpu_ghz()
- *	get CPU frequencies in GHz
+ *	get CPU frequencies in GHz, the CPU scaling_cur_freq files are
+ *	found and opened on the first call and re-read on later calls
  */
-static void stress_get_cpu_ghz(
+void stress_get_cpu_ghz(
 	double *avg_ghz,
 	double *min_ghz,
 	double *max_ghz)
 {
-	struct dirent **cpu_list = NULL;
-	int i, n_cpus, n = 0;
+	static stress_stat_file_t *freq_files;
+	static int n_freq_files = -1;
+	int i, n = 0;
 	double total_freq = 0.0;
 
+	if (n_freq_files < 0) {
+		struct dirent **cpu_list = NULL;
+		int n_cpus;
+
+		n_freq_files = 0;
+		n_cpus = scandir("/sys/devices/system/cpu", &cpu_list, NULL, alphasort);
+		if (n_cpus > 0)
+			freq_files = (stress_stat_file_t *)calloc((size_t)n_cpus, sizeof(*freq_files));
+		for (i = 0; i < n_cpus; i++) {
+			const char *name = cpu_list[i]->d_name;
+
+			if (freq_files && !strncmp(name, "cpu", 3) && isdigit((unsigned char)name[3])) {
+				char path[PATH_MAX];
+
+				(void)snprintf(path, sizeof(path),
+					"/sys/devices/system/cpu/%s/cpufreq/scaling_cur_freq",
+					name);
+				stress_stat_file_open(&freq_files[n_freq_files], path, 32);
+				if (freq_files[n_freq_files].fd >= 0)
+					n_freq_files++;
+			}
+			free(cpu_list[i]);
+		}
+		if (n_cpus > -1)
+			free(cpu_list);
+	}
+
 	*min_ghz = DBL_MAX;
 	*max_ghz = 0.0;
 
-	n_cpus = scandir("/sys/devices/system/cpu", &cpu_list, NULL, alphasort);
-	for (i = 0; i < n_cpus; i++) {
-		const char *name = cpu_list[i]->d_name;
-
-		if (!strncmp(name, "cpu", 3) && isdigit((unsigned char)name[3])) {
-			char path[PATH_MAX];
-			double freq;
-			FILE *fp;
-
-			(void)snprintf(path, sizeof(path),
-				"/sys/devices/system/cpu/%s/cpufreq/scaling_cur_freq",
-				name);
-			if ((fp = fopen(path, "r")) != NULL) {
-				if (fscanf(fp, "%lf", &freq) == 1) {
-					if (freq >= 0.0) {
-						total_freq += freq;
-						if (*min_ghz > freq)
-							*min_ghz = freq;
-						if (*max_ghz < freq)
-							*max_ghz = freq;
-						n++;
-					}
-				}
-				(void)fclose(fp);
-			}
-		}
-		free(cpu_list[i]);
+	for (i = 0; i < n_freq_files; i++) {
+		const char *ptr = stress_stat_file_read(&freq_files[i], NULL);
+		double freq;
+
+		if (!ptr || !isdigit((unsigned char)*ptr))
+			continue;
+		freq = (double)stress_stat_u64(&ptr);
+		total_freq += freq;
+		if (*min_ghz > freq)
+			*min_ghz = freq;
+		if (*max_ghz < freq)
+			*max_ghz = freq;
+		n++;
 	}
-	if (n_cpus > -1)
-		free(cpu_list);
 
 	if (n == 0) {
 		stress_zero_cpu_ghz(avg_ghz, min_ghz, max_ghz);
@@ -1060,7 +1123,7 @@ static void stress_get_cpu_ghz(
 }
 #elif defined(__FreeBSD__) ||	\
       defined(__APPLE__)
-static void stress_get_cpu_ghz(
+void stress_get_cpu_ghz(
 	double *avg_ghz,
 	double *min_ghz,
 	double *max_ghz)
@@ -1101,7 +1164,7 @@ static void stress_get_cpu_ghz(
 	}
 }
 #elif defined(__OpenBSD__)
-static void stress_get_cpu_ghz(
+void stress_get_cpu_ghz(
 	double *avg_ghz,
 	double *min_ghz,
 	double *max_ghz)
@@ -1121,12 +1184,109 @@ static void stress_get_cpu_ghz(
 	}
 }
 #else
-static void stress_get_cpu_ghz(
+void stress_get_cpu_ghz(
+	double *avg_ghz,
+	double *min_ghz,
+	double *max_ghz)
+{
+	stress_zero_cpu_ghz(avg_ghz, min_ghz, max_ghz);
+}
+#endif
+
+#if defined(__linux__) &&	\
+    defined(STRESS_ARCH_X86)
+#define MSR_IA32_TSC		(0x10)
+#define MSR_IA32_MPERF		(0xe7)
+#define MSR_IA32_APERF		(0xe8)
+
+typedef struct {
+	uint64_t aperf;		/* actual cycles */
+	uint64_t mperf;		/* maximum (nominal) cycles */
+	uint64_t tsc;		/* time stamp counter */
+	bool	 valid;		/* true if last read succeeded */
+} stress_cpu_perf_msr_t;
+
+/*
+ *  stress_get_cpu_eff_ghz()
+ *	get the effective (delivered) CPU frequencies in GHz since the
+ *	previous call from the APERF/MPERF MSR ratio of each CPU scaled by
+ *	the TSC (nominal) rate. Unlike scaling_cur_freq this shows thermal,
+ *	power and AVX frequency throttling. Returns 0 if valid, 1 if there
+ *	is no previous sample yet and -1 if the MSRs cannot be read.
+ */
+int stress_get_cpu_eff_ghz(
+	double *avg_ghz,
+	double *min_ghz,
+	double *max_ghz)
+{
+	static stress_cpu_perf_msr_t *msrs;
+	static int32_t n_cpus = -1;
+	static double t_prev;
+	const double t_now = stress_time_now();
+	const double dt = t_now - t_prev;
+	double total_ghz = 0.0;
+	int32_t cpu, n = 0, n_read = 0;
+
+	if (n_cpus < 0) {
+		n_cpus = stress_get_processors_configured();
+		msrs = (n_cpus > 0) ? (stress_cpu_perf_msr_t *)calloc((size_t)n_cpus, sizeof(*msrs)) : NULL;
+		if (!msrs)
+			n_cpus = 0;
+	}
+
+	*min_ghz = DBL_MAX;
+	*max_ghz = 0.0;
+
+	for (cpu = 0; cpu < n_cpus; cpu++) {
+		stress_cpu_perf_msr_t *prev = &msrs[cpu];
+		uint64_t aperf, mperf, tsc;
+
+		if ((stress_x86_readmsr64(cpu, MSR_IA32_APERF, &aperf) < 0) ||
+		    (stress_x86_readmsr64(cpu, MSR_IA32_MPERF, &mperf) < 0) ||
+		    (stress_x86_readmsr64(cpu, MSR_IA32_TSC, &tsc) < 0)) {
+			prev->valid = false;
+			continue;
+		}
+		n_read++;
+		if (prev->valid && (mperf > prev->mperf) && (tsc > prev->tsc) && (dt > 0.0)) {
+			const double ratio = (double)(aperf - prev->aperf) / (double)(mperf - prev->mperf);
+			const double ghz = ratio * ((double)(tsc - prev->tsc) / dt) * ONE_BILLIONTH;
+
+			total_ghz += ghz;
+			if (*min_ghz > ghz)
+				*min_ghz = ghz;
+			if (*max_ghz < ghz)
+				*max_ghz = ghz;
+			n++;
+		}
+		prev->aperf = aperf;
+		prev->mperf = mperf;
+		prev->tsc = tsc;
+		prev->valid = true;
+	}
+	t_prev = t_now;
+
+	/* no readable MSRs, don't try again */
+	if (n_read == 0) {
+		free(msrs);
+		msrs = NULL;
+		n_cpus = 0;
+	}
+	if (n == 0) {
+		stress_zero_cpu_ghz(avg_ghz, min_ghz, max_ghz);
+		return (n_read > 0) ? 1 : -1;
+	}
+	*avg_ghz = total_ghz / n;
+	return 0;
+}
+#else
+int stress_get_cpu_eff_ghz(
 	double *avg_ghz,
 	double *min_ghz,
 	double *max_ghz)
 {
 	stress_zero_cpu_ghz(avg_ghz, min_ghz, max_ghz);
+	return -1;
 }
 #endif
 
@@ -1140,18 +1300,38 @@ void stress_vmstat_start(void)
 	size_t tz_num = 0;
 	stress_tz_info_t *tz_info;
 	int32_t vmstat_sleep, thermalstat_sleep, iostat_sleep, status_sleep, raplstat_sleep;
+	int32_t metrics_interval_sleep, warmup_sleep, offcpu_sleep;
+	int32_t mem_footprint_sleep, ksm_sleep;
 	double t1, t2, t_start;
+	FILE *metrics_interval_fp = NULL;
 #if defined(HAVE_SYS_SYSMACROS_H) &&	\
     defined(__linux__)
 	char iostat_name[PATH_MAX];
 	stress_iostat_t iostat;
+	FILE *iostat_yaml_fp = NULL;
+#endif
+	char *therms = NULL;
+#if defined(__linux__)
+	stress_stat_file_t *tz_files = NULL;
 #endif
+	bool have_eff_ghz = false;
+	bool offcpu = false;
+	bool mem_footprint = false;
+	const bool ksm = !!(g_opt_flags & OPT_FLAGS_KSM);
+
+	(void)stress_get_setting("offcpu", &offcpu);
+	(void)stress_get_setting("mem-footprint", &mem_footprint);
 
 	if ((vmstat_delay == 0) &&
 	    (thermalstat_delay == 0) &&
 	    (iostat_delay == 0) &&
 	    (status_delay == 0) &&
-	    (raplstat_delay == 0))
+	    (raplstat_delay == 0) &&
+	    (metrics_interval_delay == 0) &&
+	    (warmup_delay == 0) &&
+	    !offcpu &&
+	    !mem_footprint &&
+	    !ksm)
 		return;
 
 	vmstat_sleep = vmstat_delay;
@@ -1159,6 +1339,11 @@ void stress_vmstat_start(void)
 	iostat_sleep = iostat_delay;
 	status_sleep = status_delay;
 	raplstat_sleep = raplstat_delay;
+	metrics_interval_sleep = metrics_interval_delay;
+	warmup_sleep = STRESS_WARMUP_POLL_MS;
+	offcpu_sleep = STRESS_OFFCPU_POLL_MS;
+	mem_footprint_sleep = STRESS_MEMFOOTPRINT_POLL_MS;
+	ksm_sleep = STRESS_KSM_POLL_MS;
 
 	vmstat_pid = fork();
 	if ((vmstat_pid < 0) || (vmstat_pid > 0))
@@ -1167,12 +1352,22 @@ void stress_vmstat_start(void)
 	stress_parent_died_alarm();
 	stress_set_proc_name("stat [periodic]");
 
-	if (vmstat_delay)
+	if (vmstat_delay) {
+		double avg_ghz, min_ghz, max_ghz;
+
 		stress_get_vmstat(&vmstat);
+		/* prime the effective frequency counters */
+		have_eff_ghz = (stress_get_cpu_eff_ghz(&avg_ghz, &min_ghz, &max_ghz) >= 0);
+	}
 
 	if (thermalstat_delay) {
 		for (tz_info = g_shared->tz_info; tz_info; tz_info = tz_info->next)
 			tz_num++;
+#if defined(__linux__)
+		if (tz_num > 0)
+			tz_files = stress_tz_files_open(tz_num);
+#endif
+		therms = (char *)calloc(1 + (tz_num * 7), sizeof(*therms));
 	}
 #if defined(STRESS_RAPL)
 	if (raplstat_delay && (g_opt_flags & OPT_FLAGS_RAPL_REQUIRED))
@@ -1185,8 +1380,38 @@ void stress_vmstat_start(void)
 		iostat_sleep = 0;
 	if (iostat_delay)
 		stress_get_iostat(iostat_name, &iostat);
+	if (iostat_sleep) {
+		char *iostat_yaml = NULL;
+
+		(void)stress_get_setting("iostat-yaml", &iostat_yaml);
+		if (iostat_yaml) {
+			iostat_yaml_fp = fopen(iostat_yaml, "w");
+			if (iostat_yaml_fp) {
+				pr_yaml(iostat_yaml_fp, "---\n");
+				pr_yaml(iostat_yaml_fp, "iostat:\n");
+				pr_yaml(iostat_yaml_fp, "  device: '%s'\n", iostat_name);
+				pr_yaml(iostat_yaml_fp, "  interval: %.3f\n", (double)iostat_delay / 1000.0);
+				pr_yaml(iostat_yaml_fp, "  samples:\n");
+			} else {
+				pr_err("cannot open iostat YAML file %s, errno=%d (%s)\n",
+					iostat_yaml, errno, strerror(errno));
+			}
+		}
+	}
 #endif
 
+	if (metrics_interval_delay) {
+		char *metrics_interval_file = NULL;
+
+		(void)stress_get_setting("metrics-interval-file", &metrics_interval_file);
+		if (metrics_interval_file) {
+			metrics_interval_fp = fopen(metrics_interval_file, "w");
+			if (!metrics_interval_fp)
+				pr_err("cannot open metrics interval file %s, errno=%d (%s)\n",
+					metrics_interval_file, errno, strerror(errno));
+		}
+	}
+
 #if defined(SCHED_DEADLINE)
 	VOID_RET(int, stress_set_sched(getpid(), SCHED_DEADLINE, 99, true));
 #endif
@@ -1210,8 +1435,18 @@ void stress_vmstat_start(void)
 		if (status_delay > 0)
 			sleep_delay = STRESS_MINIMUM(status_delay, sleep_delay);
 		if (raplstat_delay > 0)
-			sleep_delay = STRESS_MINIMUM(raplstat_delay, raplstat_delay);
-		t1 += sleep_delay;
+			sleep_delay = STRESS_MINIMUM(raplstat_delay, sleep_delay);
+		if (metrics_interval_delay > 0)
+			sleep_delay = STRESS_MINIMUM(metrics_interval_delay, sleep_delay);
+		if (warmup_delay != 0)
+			sleep_delay = STRESS_MINIMUM(STRESS_WARMUP_POLL_MS, sleep_delay);
+		if (offcpu)
+			sleep_delay = STRESS_MINIMUM(STRESS_OFFCPU_POLL_MS, sleep_delay);
+		if (mem_footprint)
+			sleep_delay = STRESS_MINIMUM(STRESS_MEMFOOTPRINT_POLL_MS, sleep_delay);
+		if (ksm)
+			sleep_delay = STRESS_MINIMUM(STRESS_KSM_POLL_MS, sleep_delay);
+		t1 += (double)sleep_delay / 1000.0;
 		t2 = stress_time_now();
 
 		delta = t1 - t2;
@@ -1225,6 +1460,12 @@ void stress_vmstat_start(void)
 		thermalstat_sleep -= sleep_delay;
 		iostat_sleep -= sleep_delay;
 		status_sleep -= sleep_delay;
+		raplstat_sleep -= sleep_delay;
+		metrics_interval_sleep -= sleep_delay;
+		warmup_sleep -= sleep_delay;
+		offcpu_sleep -= sleep_delay;
+		mem_footprint_sleep -= sleep_delay;
+		ksm_sleep -= sleep_delay;
 
 		if ((vmstat_delay > 0) && (vmstat_sleep <= 0))
 			vmstat_sleep = vmstat_delay;
@@ -1236,22 +1477,45 @@ void stress_vmstat_start(void)
 			status_sleep = status_delay;
 		if ((raplstat_delay > 0) && (raplstat_sleep <= 0))
 			raplstat_sleep = raplstat_delay;
+		if ((metrics_interval_delay > 0) && (metrics_interval_sleep <= 0))
+			metrics_interval_sleep = metrics_interval_delay;
+		if ((warmup_delay != 0) && (warmup_sleep <= 0))
+			warmup_sleep = STRESS_WARMUP_POLL_MS;
+		if (offcpu && (offcpu_sleep <= 0))
+			offcpu_sleep = STRESS_OFFCPU_POLL_MS;
+		if (mem_footprint && (mem_footprint_sleep <= 0))
+			mem_footprint_sleep = STRESS_MEMFOOTPRINT_POLL_MS;
+		if (ksm && (ksm_sleep <= 0))
+			ksm_sleep = STRESS_KSM_POLL_MS;
 
 		if (vmstat_sleep == vmstat_delay) {
 			static uint32_t vmstat_count = 0;
 			double total_ticks, percent;
+			const double scale = 1000.0 / (double)vmstat_delay;
+			char eff_ghz[20] = "";
 
 			stress_get_vmstat(&vmstat);
+			if (have_eff_ghz) {
+				double avg_ghz, min_ghz, max_ghz;
+
+				if (stress_get_cpu_eff_ghz(&avg_ghz, &min_ghz, &max_ghz) == 0)
+					(void)snprintf(eff_ghz, sizeof(eff_ghz), " %5.2f %5.2f %5.2f",
+						avg_ghz, min_ghz, max_ghz);
+				else
+					(void)snprintf(eff_ghz, sizeof(eff_ghz), " %5.5s %5.5s %5.5s",
+						" n/a ", " n/a ", " n/a ");
+			}
 
 			pr_block_begin();
 			if (vmstat_count == 0)
 				pr_inf("vmstat: %3s %3s %9s %9s %9s %9s "
 					"%4s %4s %6s %6s %4s %4s %2s %2s "
-					"%2s %2s %2s\n",
+					"%2s %2s %2s%s\n",
 					"r", "b", "swpd", "free", "buff",
 					"cache", "si", "so", "bi", "bo",
 					"in", "cs", "us", "sy", "id",
-					"wa", "st");
+					"wa", "st",
+					have_eff_ghz ? " EfGHz EfMin EfMax" : "");
 
 			total_ticks = (double)vmstat.user_time +
 				      (double)vmstat.system_time +
@@ -1263,29 +1527,30 @@ void stress_vmstat_start(void)
 			pr_inf("vmstat: %3" PRIu64 " %3" PRIu64 /* procs */
 			       " %9" PRIu64 " %9" PRIu64	/* vm used */
 			       " %9" PRIu64 " %9" PRIu64	/* memory_buff */
-			       " %4" PRIu64 " %4" PRIu64	/* si, so*/
-			       " %6" PRIu64 " %6" PRIu64	/* bi, bo*/
-			       " %4" PRIu64 " %4" PRIu64	/* int, cs*/
+			       " %4.0f %4.0f"			/* si, so*/
+			       " %6.0f %6.0f"			/* bi, bo*/
+			       " %4.0f %4.0f"			/* int, cs*/
 			       " %2.0f %2.0f" 			/* us, sy */
 			       " %2.0f %2.0f" 			/* id, wa */
-			       " %2.0f\n",			/* st */
+			       " %2.0f%s\n",			/* st, effective GHz */
 				vmstat.procs_running,
 				vmstat.procs_blocked,
 				vmstat.swap_used / vmstat_units_kb,
 				vmstat.memory_free / vmstat_units_kb,
 				vmstat.memory_buff / vmstat_units_kb,
 				(vmstat.memory_cached + vmstat.memory_reclaimable) / vmstat_units_kb,
-				vmstat.swap_in / (uint64_t)vmstat_delay,
-				vmstat.swap_out / (uint64_t)vmstat_delay,
-				vmstat.block_in / (uint64_t)vmstat_delay,
-				vmstat.block_out / (uint64_t)vmstat_delay,
-				vmstat.interrupt / (uint64_t)vmstat_delay,
-				vmstat.context_switch / (uint64_t)vmstat_delay,
+				floor((double)vmstat.swap_in * scale),
+				floor((double)vmstat.swap_out * scale),
+				floor((double)vmstat.block_in * scale),
+				floor((double)vmstat.block_out * scale),
+				floor((double)vmstat.interrupt * scale),
+				floor((double)vmstat.context_switch * scale),
 				percent * (double)vmstat.user_time,
 				percent * (double)vmstat.system_time,
 				percent * (double)vmstat.idle_time,
 				percent * (double)vmstat.wait_time,
-				percent * (double)vmstat.stolen_time);
+				percent * (double)vmstat.stolen_time,
+				eff_ghz);
 			pr_block_end();
 
 			vmstat_count++;
@@ -1295,15 +1560,13 @@ void stress_vmstat_start(void)
 
 		if (thermalstat_delay == thermalstat_sleep) {
 			double min1, min5, min15, avg_ghz, min_ghz, max_ghz;
-			size_t therms_len = 1 + (tz_num * 7);
-			char *therms;
 			char cpuspeed[19];
 #if defined(__linux__)
 			char *ptr;
+			size_t i;
 #endif
 			static uint32_t thermalstat_count = 0;
 
-			therms = (char *)calloc(therms_len, sizeof(*therms));
 			if (therms) {
 #if defined(__linux__)
 				for (ptr = therms, tz_info = g_shared->tz_info; tz_info; tz_info = tz_info->next) {
@@ -1325,8 +1588,8 @@ void stress_vmstat_start(void)
 					pr_inf("therm: AvGHz MnGHz MxGHz  LdA1  LdA5 LdA15 %s\n", therms);
 
 #if defined(__linux__)
-				for (ptr = therms, tz_info = g_shared->tz_info; tz_info; tz_info = tz_info->next) {
-					(void)snprintf(ptr, 8, " %6.2f", stress_get_tz_info(tz_info));
+				for (i = 0, ptr = therms, tz_info = g_shared->tz_info; tz_info; tz_info = tz_info->next, i++) {
+					(void)snprintf(ptr, 8, " %6.2f", tz_files ? stress_get_tz_info(&tz_files[i]) : 0.0);
 					ptr += 7;
 				}
 #endif
@@ -1338,7 +1601,6 @@ void stress_vmstat_start(void)
 						cpuspeed, min1, min5, min15, therms);
 				}
 				pr_block_end();
-				free(therms);
 
 				thermalstat_count++;
 				if (thermalstat_count >= 25)
@@ -1349,26 +1611,64 @@ void stress_vmstat_start(void)
 #if defined(HAVE_SYS_SYSMACROS_H) &&	\
     defined(__linux__)
 		if (iostat_delay == iostat_sleep) {
-			double clk_scale = (iostat_delay > 0) ? 1.0 / iostat_delay : 0.0;
+			double clk_scale = (iostat_delay > 0) ? 1000.0 / iostat_delay : 0.0;
 			static uint32_t iostat_count = 0;
+			uint64_t ios, ticks;
+			double await, util, avgqu;
 
 			stress_get_iostat(iostat_name, &iostat);
 
+			/*
+			 *  ticks are in milliseconds, await is the mean time per
+			 *  completed request, util the percentage of the interval
+			 *  the device was busy and avgqu the mean requests in
+			 *  the queue over the interval
+			 */
+			ios = iostat.read_io + iostat.write_io + iostat.discard_io;
+			ticks = iostat.read_ticks + iostat.write_ticks + iostat.discard_ticks;
+			await = (ios > 0) ? (double)ticks / (double)ios : 0.0;
+			util = (double)iostat.io_ticks * clk_scale / 10.0;
+			if (util > 100.0)
+				util = 100.0;
+			avgqu = (double)iostat.time_in_queue * clk_scale / 1000.0;
+
 			pr_block_begin();
 			if (iostat_count == 0)
-				pr_inf("iostat: Inflght   Rd K/s   Wr K/s Dscd K/s     Rd/s     Wr/s   Dscd/s\n");
+				pr_inf("iostat: Inflght   Rd K/s   Wr K/s Dscd K/s     Rd/s     Wr/s   Dscd/s Await ms  Util%%  AvgQu\n");
 
 			/* sectors are 512 bytes, so >> 1 to get stats in 1024 bytes */
-			pr_inf("iostat: %7.0f %8.0f %8.0f %8.0f %8.0f %8.0f %8.0f\n",
-				(double)iostat.in_flight * clk_scale,
+			pr_inf("iostat: %7.0f %8.0f %8.0f %8.0f %8.0f %8.0f %8.0f %8.2f %6.1f %6.2f\n",
+				(double)iostat.in_flight,
 				(double)(iostat.read_sectors >> 1) * clk_scale,
 				(double)(iostat.write_sectors >> 1) * clk_scale,
 				(double)(iostat.discard_sectors >> 1) * clk_scale,
 				(double)iostat.read_io * clk_scale,
 				(double)iostat.write_io * clk_scale,
-				(double)iostat.discard_io * clk_scale);
+				(double)iostat.discard_io * clk_scale,
+				await, util, avgqu);
 			pr_block_end();
 
+			if (iostat_yaml_fp) {
+				pr_yaml(iostat_yaml_fp, "    - time: %.3f\n", stress_time_now() - t_start);
+				pr_yaml(iostat_yaml_fp, "      inflight: %" PRIu64 "\n", iostat.in_flight);
+				pr_yaml(iostat_yaml_fp, "      read-kb-per-sec: %.2f\n",
+					(double)(iostat.read_sectors >> 1) * clk_scale);
+				pr_yaml(iostat_yaml_fp, "      write-kb-per-sec: %.2f\n",
+					(double)(iostat.write_sectors >> 1) * clk_scale);
+				pr_yaml(iostat_yaml_fp, "      discard-kb-per-sec: %.2f\n",
+					(double)(iostat.discard_sectors >> 1) * clk_scale);
+				pr_yaml(iostat_yaml_fp, "      reads-per-sec: %.2f\n",
+					(double)iostat.read_io * clk_scale);
+				pr_yaml(iostat_yaml_fp, "      writes-per-sec: %.2f\n",
+					(double)iostat.write_io * clk_scale);
+				pr_yaml(iostat_yaml_fp, "      discards-per-sec: %.2f\n",
+					(double)iostat.discard_io * clk_scale);
+				pr_yaml(iostat_yaml_fp, "      await-ms: %.3f\n", await);
+				pr_yaml(iostat_yaml_fp, "      util-percent: %.2f\n", util);
+				pr_yaml(iostat_yaml_fp, "      avg-queue-size: %.3f\n", avgqu);
+				(void)fflush(iostat_yaml_fp);
+			}
+
 			iostat_count++;
 			if (iostat_count >= 25)
 				iostat_count = 0;
@@ -1385,6 +1685,18 @@ void stress_vmstat_start(void)
 				g_shared->instance_count.alarmed,
 				stress_duration_to_str(runtime, false, true));
 		}
+		if ((metrics_interval_delay > 0) &&
+		    (metrics_interval_sleep == metrics_interval_delay))
+			stress_metrics_interval_dump(metrics_interval_fp, stress_time_now());
+		if ((warmup_delay != 0) &&
+		    (warmup_sleep == STRESS_WARMUP_POLL_MS))
+			stress_metrics_warmup_check(warmup_delay, stress_time_now());
+		if (offcpu && (offcpu_sleep == STRESS_OFFCPU_POLL_MS))
+			stress_metrics_offcpu_sample(stress_time_now());
+		if (mem_footprint && (mem_footprint_sleep == STRESS_MEMFOOTPRINT_POLL_MS))
+			stress_metrics_memfootprint_sample(stress_time_now());
+		if (ksm && (ksm_sleep == STRESS_KSM_POLL_MS))
+			stress_metrics_ksm_sample();
 #if defined(STRESS_RAPL)
 		if ((raplstat_delay > 0) &&
 		    (raplstat_sleep == raplstat_delay) &&
@@ -1428,6 +1740,13 @@ void stress_vmstat_start(void)
 		}
 #endif
 	}
+	if (metrics_interval_fp)
+		(void)fclose(metrics_interval_fp);
+#if defined(HAVE_SYS_SYSMACROS_H) &&	\
+    defined(__linux__)
+	if (iostat_yaml_fp)
+		(void)fclose(iostat_yaml_fp);
+#endif
 	_exit(0);
 }
 
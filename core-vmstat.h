@@ -27,9 +27,13 @@ extern WARN_UNUSED int stress_set_vmstat(const char *const opt);
 extern WARN_UNUSED int stress_set_thermalstat(const char *const opt);
 extern WARN_UNUSED int stress_set_iostat(const char *const opt);
 extern WARN_UNUSED int stress_set_raplstat(const char *const opt);
+extern WARN_UNUSED int stress_set_metrics_interval(const char *const opt);
+extern WARN_UNUSED int stress_set_warmup(const char *const opt);
 extern WARN_UNUSED char *stress_find_mount_dev(const char *name);
 extern void stress_set_vmstat_units(const char *const opt);
 extern void stress_vmstat_start(void);
 extern void stress_vmstat_stop(void);
+extern void stress_get_cpu_ghz(double *avg_ghz, double *min_ghz, double *max_ghz);
+extern int stress_get_cpu_eff_ghz(double *avg_ghz, double *min_ghz, double *max_ghz);
 
 #endif
@@ -529,5 +529,6 @@ const stressor_info_t stress_access_info = {
 	.stressor = stress_access,
 	.class = CLASS_FILESYSTEM | CLASS_OS,
 	.verify = VERIFY_ALWAYS,
+	.metrics_max = 1,
 	.help = help
 };
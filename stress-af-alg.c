@@ -18,8 +18,11 @@
  *
  */
 #include "stress-ng.h"
+#include "core-arch.h"
+#include "core-asm-x86.h"
 #include "core-attribute.h"
 #include "core-builtin.h"
+#include "core-cpu.h"
 
 #include <sys/socket.h>
 
@@ -35,12 +38,14 @@
 
 static const stress_help_t help[] = {
 	{ NULL,	"af-alg N",	"start N workers that stress AF_ALG socket domain" },
+	{ NULL,	"af-alg-bench",	"compare AES-128-CTR GB/sec of AF_ALG and userspace AES" },
 	{ NULL,	"af-alg-dump",	"dump internal list from /proc/crypto to stdout" },
 	{ NULL,	"af-alg-ops N",	"stop after N af-alg bogo operations" },
 	{ NULL, NULL,		NULL }
 };
 
 static const stress_opt_t opts[] = {
+	{ OPT_af_alg_bench, "af-alg-bench", TYPE_ID_BOOL, 0, 1, NULL },
 	{ OPT_af_alg_dump, "af-alg-dump", TYPE_ID_BOOL, 0, 1, NULL },
 	END_OPT,
 };
@@ -859,6 +864,895 @@ static void stress_af_alg_dump_crypto_list(void)
 	(void)fflush(stdout);
 }
 
+#if defined(HAVE_COMPILER_MUSL)
+#undef HAVE_IMMINTRIN_H
+#endif
+
+#if defined(STRESS_ARCH_X86_64) &&	\
+    defined(HAVE_IMMINTRIN_H) &&	\
+    (defined(HAVE_COMPILER_GCC) ||	\
+     defined(HAVE_COMPILER_CLANG) ||	\
+     defined(HAVE_COMPILER_ICX)) &&	\
+    !defined(HAVE_COMPILER_ICC)
+#include <immintrin.h>
+#define STRESS_AF_ALG_AESNI
+#define TARGET_AESNI		__attribute__ ((target("aes,sse4.1")))
+#if NEED_GNUC(8, 0, 0) ||		\
+    defined(HAVE_COMPILER_CLANG) ||	\
+    defined(HAVE_COMPILER_ICX)
+#define STRESS_AF_ALG_VAES
+#define TARGET_VAES		__attribute__ ((target("aes,sse4.1,avx2,vaes")))
+#endif
+#endif
+
+#if defined(STRESS_ARCH_ARM) &&			\
+    defined(__aarch64__) &&			\
+    defined(HAVE_COMPILER_GCC_OR_MUSL) &&	\
+    NEED_GNUC(10, 0, 0)
+#include <arm_neon.h>
+#define STRESS_AF_ALG_ARMV8_CE
+#define TARGET_ARMV8_CE		__attribute__ ((target("+crypto")))
+#endif
+
+#if defined(HAVE_INTEL_IPSEC_MB_H) &&	\
+    defined(HAVE_LIB_IPSEC_MB) &&	\
+    defined(STRESS_ARCH_X86_64)
+#include <intel-ipsec-mb.h>
+#if IMB_VERSION_NUM > 0x3700
+#define STRESS_AF_ALG_IPSEC_MB
+#endif
+#endif
+
+#define AF_ALG_BENCH_MIN_SHIFT		(6)	/* 64 bytes */
+#define AF_ALG_BENCH_SHIFT_STEP		(2)
+#define AF_ALG_BENCH_SIZES		(6)	/* 64 bytes .. 64K */
+#define AF_ALG_BENCH_MAX_SIZE		((size_t)1 << (AF_ALG_BENCH_MIN_SHIFT + \
+					 (AF_ALG_BENCH_SHIFT_STEP * (AF_ALG_BENCH_SIZES - 1))))
+#define AF_ALG_BENCH_CELL_BYTES		(MB)	/* bytes encrypted per size */
+#define AF_ALG_BENCH_KEY_SIZE		(16)	/* AES-128 */
+#define AF_ALG_BENCH_BLOCK_SIZE		(16)
+
+typedef struct {
+	uint8_t key[AF_ALG_BENCH_KEY_SIZE];	/* AES-128 key */
+	uint8_t iv[AF_ALG_BENCH_BLOCK_SIZE];	/* initial counter block */
+	uint8_t rk[11 * AF_ALG_BENCH_BLOCK_SIZE] ALIGN64; /* key schedule */
+	int opfd;				/* AF_ALG operation socket */
+	int pipefd[2];				/* pipe for vmsplice/splice */
+#if defined(STRESS_AF_ALG_IPSEC_MB)
+	IMB_MGR *mb_mgr;			/* ipsec-mb manager */
+	uint32_t expkey[4 * 15] ALIGNED(16);	/* ipsec-mb key schedules */
+	uint32_t dust[4 * 15] ALIGNED(16);
+#endif
+} stress_af_alg_bench_t;
+
+typedef int (*stress_af_alg_bench_func_t)(stress_af_alg_bench_t *bench,
+	const uint8_t *in, uint8_t *out, const size_t len);
+
+typedef struct {
+	const char *name;			/* engine name */
+	const stress_af_alg_bench_func_t func;	/* AES-128-CTR encrypt */
+} stress_af_alg_bench_engine_t;
+
+typedef struct {
+	double duration;			/* run time */
+	double bytes;				/* bytes encrypted */
+	double cycles;				/* TSC cycles, zero if no TSC */
+} stress_af_alg_bench_stats_t;
+
+/*
+ *  NIST SP 800-38A F.5.1 CTR-AES128.Encrypt test vector
+ */
+static const uint8_t af_alg_bench_key[AF_ALG_BENCH_KEY_SIZE] = {
+	0x2b, 0x7e, 0x15, 0x16, 0x28, 0xae, 0xd2, 0xa6,
+	0xab, 0xf7, 0x15, 0x88, 0x09, 0xcf, 0x4f, 0x3c,
+};
+
+static const uint8_t af_alg_bench_iv[AF_ALG_BENCH_BLOCK_SIZE] = {
+	0xf0, 0xf1, 0xf2, 0xf3, 0xf4, 0xf5, 0xf6, 0xf7,
+	0xf8, 0xf9, 0xfa, 0xfb, 0xfc, 0xfd, 0xfe, 0xff,
+};
+
+static const uint8_t af_alg_bench_plaintext[64] = {
+	0x6b, 0xc1, 0xbe, 0xe2, 0x2e, 0x40, 0x9f, 0x96,
+	0xe9, 0x3d, 0x7e, 0x11, 0x73, 0x93, 0x17, 0x2a,
+	0xae, 0x2d, 0x8a, 0x57, 0x1e, 0x03, 0xac, 0x9c,
+	0x9e, 0xb7, 0x6f, 0xac, 0x45, 0xaf, 0x8e, 0x51,
+	0x30, 0xc8, 0x1c, 0x46, 0xa3, 0x5c, 0xe4, 0x11,
+	0xe5, 0xfb, 0xc1, 0x19, 0x1a, 0x0a, 0x52, 0xef,
+	0xf6, 0x9f, 0x24, 0x45, 0xdf, 0x4f, 0x9b, 0x17,
+	0xad, 0x2b, 0x41, 0x7b, 0xe6, 0x6c, 0x37, 0x10,
+};
+
+static const uint8_t af_alg_bench_ciphertext[64] = {
+	0x87, 0x4d, 0x61, 0x91, 0xb6, 0x20, 0xe3, 0x26,
+	0x1b, 0xef, 0x68, 0x64, 0x99, 0x0d, 0xb6, 0xce,
+	0x98, 0x06, 0xf6, 0x6b, 0x79, 0x70, 0xfd, 0xff,
+	0x86, 0x17, 0x18, 0x7b, 0xb9, 0xff, 0xfd, 0xff,
+	0x5a, 0xe4, 0xdf, 0x3e, 0xdb, 0xd5, 0xd3, 0x5e,
+	0x5b, 0x4f, 0x09, 0x02, 0x0d, 0xb0, 0x3e, 0xab,
+	0x1e, 0x03, 0x1d, 0xda, 0x2f, 0xbe, 0x03, 0xd1,
+	0x79, 0x21, 0x70, 0xa0, 0xf3, 0x00, 0x9c, 0xee,
+};
+
+/*
+ *  stress_af_alg_bench_ctr_load()
+ *	load the 128 bit big endian counter block as hi, lo
+ */
+static inline void stress_af_alg_bench_ctr_load(
+	const uint8_t *iv,
+	uint64_t *hi,
+	uint64_t *lo)
+{
+	size_t i;
+
+	*hi = 0;
+	*lo = 0;
+	for (i = 0; i < 8; i++) {
+		*hi = (*hi << 8) | iv[i];
+		*lo = (*lo << 8) | iv[i + 8];
+	}
+}
+
+/*
+ *  stress_af_alg_bench_afalg_op()
+ *	AES-128-CTR using the kernel ctr(aes) skcipher, the input is
+ *	either copied in with sendmsg or spliced in zero copy with
+ *	vmsplice and splice
+ */
+static int stress_af_alg_bench_afalg_op(
+	stress_af_alg_bench_t *bench,
+	const uint8_t *in,
+	uint8_t *out,
+	const size_t len,
+	const bool zero_copy)
+{
+	char cbuf[CMSG_SPACE(sizeof(__u32)) +
+		  CMSG_SPACE(sizeof(struct af_alg_iv) + AF_ALG_BENCH_BLOCK_SIZE)] ALIGN64;
+	struct msghdr msg;
+	struct cmsghdr *cmsg;
+	struct af_alg_iv *iv;
+	struct iovec iov;
+	size_t n;
+
+	(void)shim_memset(&msg, 0, sizeof(msg));
+	(void)shim_memset(cbuf, 0, sizeof(cbuf));
+	msg.msg_control = cbuf;
+	msg.msg_controllen = sizeof(cbuf);
+
+	cmsg = CMSG_FIRSTHDR(&msg);
+	if (UNLIKELY(!cmsg))
+		return -1;
+	cmsg->cmsg_level = SOL_ALG;
+	cmsg->cmsg_type = ALG_SET_OP;
+	cmsg->cmsg_len = CMSG_LEN(sizeof(__u32));
+	*(__u32 *)(uintptr_t)CMSG_DATA(cmsg) = ALG_OP_ENCRYPT;
+
+	cmsg = CMSG_NXTHDR(&msg, cmsg);
+	if (UNLIKELY(!cmsg))
+		return -1;
+	cmsg->cmsg_level = SOL_ALG;
+	cmsg->cmsg_type = ALG_SET_IV;
+	cmsg->cmsg_len = CMSG_LEN(sizeof(struct af_alg_iv) + AF_ALG_BENCH_BLOCK_SIZE);
+	iv = (struct af_alg_iv *)(uintptr_t)CMSG_DATA(cmsg);
+	iv->ivlen = AF_ALG_BENCH_BLOCK_SIZE;
+	(void)shim_memcpy(iv->iv, bench->iv, AF_ALG_BENCH_BLOCK_SIZE);
+
+	iov.iov_base = (void *)(uintptr_t)in;
+	iov.iov_len = len;
+
+	if (!zero_copy) {
+		msg.msg_iov = &iov;
+		msg.msg_iovlen = 1;
+		if (UNLIKELY(sendmsg(bench->opfd, &msg, 0) != (ssize_t)len))
+			return -1;
+	} else {
+#if defined(HAVE_VMSPLICE) &&	\
+    defined(HAVE_SPLICE) &&	\
+    defined(SPLICE_F_MORE)
+		if (UNLIKELY(sendmsg(bench->opfd, &msg, MSG_MORE) < 0))
+			return -1;
+		for (n = 0; n < len; ) {
+			ssize_t ret, spliced;
+
+			iov.iov_base = (void *)(uintptr_t)(in + n);
+			iov.iov_len = len - n;
+			ret = vmsplice(bench->pipefd[1], &iov, 1, 0);
+			if (UNLIKELY(ret <= 0))
+				return -1;
+			for (spliced = 0; spliced < ret; ) {
+				const ssize_t sz = splice(bench->pipefd[0], NULL, bench->opfd, NULL,
+					(size_t)(ret - spliced),
+					((n + (size_t)ret) < len) ? SPLICE_F_MORE : 0);
+
+				if (UNLIKELY(sz <= 0))
+					return -1;
+				spliced += sz;
+			}
+			n += (size_t)ret;
+		}
+#else
+		return -1;
+#endif
+	}
+	for (n = 0; n < len; ) {
+		const ssize_t ret = read(bench->opfd, out + n, len - n);
+
+		if (UNLIKELY(ret <= 0))
+			return -1;
+		n += (size_t)ret;
+	}
+	return 0;
+}
+
+static int stress_af_alg_bench_afalg(
+	stress_af_alg_bench_t *bench,
+	const uint8_t *in,
+	uint8_t *out,
+	const size_t len)
+{
+	return stress_af_alg_bench_afalg_op(bench, in, out, len, false);
+}
+
+static int stress_af_alg_bench_afalg_splice(
+	stress_af_alg_bench_t *bench,
+	const uint8_t *in,
+	uint8_t *out,
+	const size_t len)
+{
+	return stress_af_alg_bench_afalg_op(bench, in, out, len, true);
+}
+
+#if defined(STRESS_AF_ALG_IPSEC_MB)
+/*
+ *  stress_af_alg_bench_ipsec_mb()
+ *	AES-128-CTR using a single synchronous intel-ipsec-mb job
+ */
+static int stress_af_alg_bench_ipsec_mb(
+	stress_af_alg_bench_t *bench,
+	const uint8_t *in,
+	uint8_t *out,
+	const size_t len)
+{
+	IMB_JOB *job;
+	int rc = -1;
+
+	job = IMB_GET_NEXT_JOB(bench->mb_mgr);
+	job->cipher_direction = IMB_DIR_ENCRYPT;
+	job->chain_order = IMB_ORDER_CIPHER_HASH;
+	job->cipher_mode = IMB_CIPHER_CNTR;
+	job->hash_alg = IMB_AUTH_NULL;
+	job->src = in;
+	job->dst = out;
+	job->enc_keys = bench->expkey;
+	job->dec_keys = bench->dust;
+	job->key_len_in_bytes = AF_ALG_BENCH_KEY_SIZE;
+	job->iv = bench->iv;
+	job->iv_len_in_bytes = AF_ALG_BENCH_BLOCK_SIZE;
+	job->cipher_start_src_offset_in_bytes = 0;
+	job->msg_len_to_cipher_in_bytes = len;
+
+	job = IMB_SUBMIT_JOB(bench->mb_mgr);
+	if (job)
+		rc = (job->status == IMB_STATUS_COMPLETED) ? 0 : -1;
+	while ((job = IMB_FLUSH_JOB(bench->mb_mgr)) != NULL)
+		rc = (job->status == IMB_STATUS_COMPLETED) ? 0 : -1;
+
+	return rc;
+}
+#endif
+
+#if defined(STRESS_AF_ALG_AESNI)
+#define AESNI_KEY_EXP(rk, i, rcon)	\
+	rk[i] = stress_af_alg_aesni_key_assist(rk[i - 1], _mm_aeskeygenassist_si128(rk[i - 1], rcon))
+
+static inline __m128i TARGET_AESNI stress_af_alg_aesni_key_assist(__m128i key, __m128i t)
+{
+	t = _mm_shuffle_epi32(t, 0xff);
+	key = _mm_xor_si128(key, _mm_slli_si128(key, 4));
+	key = _mm_xor_si128(key, _mm_slli_si128(key, 4));
+	key = _mm_xor_si128(key, _mm_slli_si128(key, 4));
+
+	return _mm_xor_si128(key, t);
+}
+
+/*
+ *  stress_af_alg_aesni_key_expand()
+ *	AES-128 key schedule using aeskeygenassist
+ */
+static void TARGET_AESNI stress_af_alg_aesni_key_expand(stress_af_alg_bench_t *bench)
+{
+	__m128i rk[11];
+	size_t i;
+
+	rk[0] = _mm_loadu_si128((const __m128i *)(const void *)bench->key);
+	AESNI_KEY_EXP(rk, 1, 0x01);
+	AESNI_KEY_EXP(rk, 2, 0x02);
+	AESNI_KEY_EXP(rk, 3, 0x04);
+	AESNI_KEY_EXP(rk, 4, 0x08);
+	AESNI_KEY_EXP(rk, 5, 0x10);
+	AESNI_KEY_EXP(rk, 6, 0x20);
+	AESNI_KEY_EXP(rk, 7, 0x40);
+	AESNI_KEY_EXP(rk, 8, 0x80);
+	AESNI_KEY_EXP(rk, 9, 0x1b);
+	AESNI_KEY_EXP(rk, 10, 0x36);
+
+	for (i = 0; i < 11; i++)
+		_mm_store_si128((__m128i *)(void *)&bench->rk[i * 16], rk[i]);
+}
+
+/*
+ *  stress_af_alg_aesni_ctr()
+ *	AES-128-CTR with AES-NI from counter hi:lo, 8 counter
+ *	blocks are interleaved to cover the aesenc latency
+ */
+static void TARGET_AESNI OPTIMIZE3 stress_af_alg_aesni_ctr(
+	const uint8_t *rk_buf,
+	uint64_t hi,
+	uint64_t lo,
+	const uint8_t *in,
+	uint8_t *out,
+	size_t n)
+{
+	const __m128i bswap = _mm_set_epi8(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+	__m128i rk[11];
+	size_t i, j;
+
+	for (i = 0; i < 11; i++)
+		rk[i] = _mm_load_si128((const __m128i *)(const void *)&rk_buf[i * 16]);
+
+	while (n > 0) {
+		__m128i b[8];
+		const size_t blocks = (n >= 8 * 16) ? 8 : (n + 15) / 16;
+
+		for (j = 0; j < blocks; j++) {
+			b[j] = _mm_shuffle_epi8(_mm_set_epi64x((long long int)hi, (long long int)lo), bswap);
+			b[j] = _mm_xor_si128(b[j], rk[0]);
+			lo++;
+			hi += (lo == 0);
+		}
+		for (i = 1; i < 10; i++) {
+			for (j = 0; j < blocks; j++)
+				b[j] = _mm_aesenc_si128(b[j], rk[i]);
+		}
+		for (j = 0; j < blocks; j++) {
+			b[j] = _mm_aesenclast_si128(b[j], rk[10]);
+			if (LIKELY(n >= 16)) {
+				const __m128i d = _mm_loadu_si128((const __m128i *)(const void *)in);
+
+				_mm_storeu_si128((__m128i *)(void *)out, _mm_xor_si128(d, b[j]));
+				in += 16;
+				out += 16;
+				n -= 16;
+			} else {
+				uint8_t ks[16] ALIGNED(16);
+
+				_mm_store_si128((__m128i *)(void *)ks, b[j]);
+				for (i = 0; i < n; i++)
+					out[i] = in[i] ^ ks[i];
+				n = 0;
+			}
+		}
+	}
+}
+
+static int stress_af_alg_bench_aesni(
+	stress_af_alg_bench_t *bench,
+	const uint8_t *in,
+	uint8_t *out,
+	const size_t len)
+{
+	uint64_t hi, lo;
+
+	stress_af_alg_bench_ctr_load(bench->iv, &hi, &lo);
+	stress_af_alg_aesni_ctr(bench->rk, hi, lo, in, out, len);
+
+	return 0;
+}
+#endif
+
+#if defined(STRESS_AF_ALG_VAES)
+/*
+ *  stress_af_alg_bench_vaes()
+ *	AES-128-CTR with 256 bit VAES, 4 x 2 counter blocks interleaved,
+ *	the tail is handled by the AES-NI path
+ */
+static int TARGET_VAES OPTIMIZE3 stress_af_alg_bench_vaes(
+	stress_af_alg_bench_t *bench,
+	const uint8_t *in,
+	uint8_t *out,
+	const size_t len)
+{
+	const __m256i bswap = _mm256_set_epi8(
+		0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15,
+		0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+	__m256i rk[11];
+	uint64_t hi, lo;
+	size_t i, j, n = len;
+
+	for (i = 0; i < 11; i++)
+		rk[i] = _mm256_broadcastsi128_si256(_mm_load_si128((const __m128i *)(const void *)&bench->rk[i * 16]));
+	stress_af_alg_bench_ctr_load(bench->iv, &hi, &lo);
+
+	while (n >= 8 * 16) {
+		__m256i b[4];
+
+		for (j = 0; j < 4; j++) {
+			const uint64_t lo1 = lo + 1;
+			const uint64_t hi1 = hi + (lo1 == 0);
+
+			b[j] = _mm256_shuffle_epi8(_mm256_set_epi64x((long long int)hi1, (long long int)lo1,
+					(long long int)hi, (long long int)lo), bswap);
+			b[j] = _mm256_xor_si256(b[j], rk[0]);
+			lo = lo1 + 1;
+			hi = hi1 + (lo == 0);
+		}
+		for (i = 1; i < 10; i++) {
+			for (j = 0; j < 4; j++)
+				b[j] = _mm256_aesenc_epi128(b[j], rk[i]);
+		}
+		for (j = 0; j < 4; j++) {
+			const __m256i d = _mm256_loadu_si256((const __m256i *)(const void *)in);
+
+			b[j] = _mm256_aesenclast_epi128(b[j], rk[10]);
+			_mm256_storeu_si256((__m256i *)(void *)out, _mm256_xor_si256(d, b[j]));
+			in += 32;
+			out += 32;
+		}
+		n -= 8 * 16;
+	}
+	/* remaining blocks with AES-NI */
+	if (n > 0)
+		stress_af_alg_aesni_ctr(bench->rk, hi, lo, in, out, n);
+	return 0;
+}
+#endif
+
+#if defined(STRESS_AF_ALG_ARMV8_CE)
+/*
+ *  stress_af_alg_armv8_ce_key_expand()
+ *	AES-128 key schedule, SubWord is computed with aese on
+ *	a vector of identical words so ShiftRows has no effect
+ */
+static void TARGET_ARMV8_CE stress_af_alg_armv8_ce_key_expand(stress_af_alg_bench_t *bench)
+{
+	static const uint8_t rcon[10] = {
+		0x01, 0x02, 0x04, 0x08, 0x10, 0x20, 0x40, 0x80, 0x1b, 0x36
+	};
+	uint32_t w[44];
+	size_t i;
+
+	(void)shim_memcpy(w, bench->key, AF_ALG_BENCH_KEY_SIZE);
+	for (i = 4; i < 44; i++) {
+		uint32_t t = w[i - 1];
+
+		if ((i & 3) == 0) {
+			uint8x16_t v = vreinterpretq_u8_u32(vdupq_n_u32(t));
+
+			v = vaeseq_u8(v, vdupq_n_u8(0));
+			t = vgetq_lane_u32(vreinterpretq_u32_u8(v), 0);
+			t = ((t >> 8) | (t << 24)) ^ rcon[(i / 4) - 1];
+		}
+		w[i] = w[i - 4] ^ t;
+	}
+	(void)shim_memcpy(bench->rk, w, sizeof(bench->rk));
+}
+
+/*
+ *  stress_af_alg_bench_armv8_ce()
+ *	AES-128-CTR with ARMv8 crypto extensions, 4 counter
+ *	blocks interleaved
+ */
+static int TARGET_ARMV8_CE OPTIMIZE3 stress_af_alg_bench_armv8_ce(
+	stress_af_alg_bench_t *bench,
+	const uint8_t *in,
+	uint8_t *out,
+	const size_t len)
+{
+	uint8x16_t rk[11];
+	uint64_t hi, lo;
+	size_t i, j, n = len;
+
+	for (i = 0; i < 11; i++)
+		rk[i] = vld1q_u8(&bench->rk[i * 16]);
+	stress_af_alg_bench_ctr_load(bench->iv, &hi, &lo);
+
+	while (n > 0) {
+		uint8x16_t b[4];
+		const size_t blocks = (n >= 4 * 16) ? 4 : (n + 15) / 16;
+
+		for (j = 0; j < blocks; j++) {
+			b[j] = vrev64q_u8(vreinterpretq_u8_u64(vcombine_u64(vcreate_u64(hi), vcreate_u64(lo))));
+			lo++;
+			hi += (lo == 0);
+		}
+		for (i = 0; i < 9; i++) {
+			for (j = 0; j < blocks; j++)
+				b[j] = vaesmcq_u8(vaeseq_u8(b[j], rk[i]));
+		}
+		for (j = 0; j < blocks; j++) {
+			b[j] = veorq_u8(vaeseq_u8(b[j], rk[9]), rk[10]);
+			if (LIKELY(n >= 16)) {
+				vst1q_u8(out, veorq_u8(vld1q_u8(in), b[j]));
+				in += 16;
+				out += 16;
+				n -= 16;
+			} else {
+				uint8_t ks[16];
+
+				vst1q_u8(ks, b[j]);
+				for (i = 0; i < n; i++)
+					out[i] = in[i] ^ ks[i];
+				n = 0;
+			}
+		}
+	}
+	return 0;
+}
+#endif
+
+static const stress_af_alg_bench_engine_t af_alg_bench_engines[] = {
+	{ "af-alg",		stress_af_alg_bench_afalg },
+	{ "af-alg-splice",	stress_af_alg_bench_afalg_splice },
+#if defined(STRESS_AF_ALG_IPSEC_MB)
+	{ "ipsec-mb",		stress_af_alg_bench_ipsec_mb },
+#endif
+#if defined(STRESS_AF_ALG_AESNI)
+	{ "aesni",		stress_af_alg_bench_aesni },
+#endif
+#if defined(STRESS_AF_ALG_VAES)
+	{ "vaes",		stress_af_alg_bench_vaes },
+#endif
+#if defined(STRESS_AF_ALG_ARMV8_CE)
+	{ "armv8-ce",		stress_af_alg_bench_armv8_ce },
+#endif
+};
+
+#define AF_ALG_BENCH_ENGINES	(SIZEOF_ARRAY(af_alg_bench_engines))
+
+/*
+ *  stress_af_alg_bench_usable()
+ *	set up each engine and return true if it can be used
+ */
+static bool stress_af_alg_bench_usable(
+	stress_args_t *args,
+	stress_af_alg_bench_t *bench,
+	const char *name,
+	const int sockfd)
+{
+	if (!strncmp(name, "af-alg", 6)) {
+		if (sockfd < 0)
+			return false;
+		if (!strcmp(name, "af-alg-splice")) {
+#if defined(HAVE_VMSPLICE) &&	\
+    defined(HAVE_SPLICE) &&	\
+    defined(SPLICE_F_MORE)
+			return (bench->pipefd[0] >= 0);
+#else
+			return false;
+#endif
+		}
+		return true;
+	}
+#if defined(STRESS_AF_ALG_IPSEC_MB)
+	if (!strcmp(name, "ipsec-mb"))
+		return (bench->mb_mgr != NULL);
+#endif
+#if defined(STRESS_AF_ALG_AESNI)
+	if (!strcmp(name, "aesni")) {
+		if (!stress_cpu_x86_has_aes() || !stress_cpu_x86_has_sse4_2())
+			return false;
+		stress_af_alg_aesni_key_expand(bench);
+		return true;
+	}
+#endif
+#if defined(STRESS_AF_ALG_VAES)
+	if (!strcmp(name, "vaes"))
+		return stress_cpu_x86_has_aes() && stress_cpu_x86_has_avx2() &&
+		       stress_cpu_x86_has_vaes();
+#endif
+#if defined(STRESS_AF_ALG_ARMV8_CE)
+	if (!strcmp(name, "armv8-ce")) {
+		if (!stress_cpu_arm_has_aes())
+			return false;
+		stress_af_alg_armv8_ce_key_expand(bench);
+		return true;
+	}
+#endif
+	(void)args;
+
+	return false;
+}
+
+/*
+ *  stress_af_alg_bench_afalg_init()
+ *	bind a ctr(aes) skcipher, set the key and accept an operation socket
+ */
+static int stress_af_alg_bench_afalg_init(stress_args_t *args, stress_af_alg_bench_t *bench)
+{
+	struct sockaddr_alg sa;
+	int sockfd;
+
+	sockfd = socket(AF_ALG, SOCK_SEQPACKET, 0);
+	if (sockfd < 0) {
+		if (args->instance == 0)
+			pr_inf("%s: AF_ALG socket failed, errno=%d (%s), skipping AF_ALG engines\n",
+				args->name, errno, strerror(errno));
+		return -1;
+	}
+	(void)shim_memset(&sa, 0, sizeof(sa));
+	sa.salg_family = AF_ALG;
+	(void)shim_strscpy((char *)sa.salg_type, "skcipher", sizeof(sa.salg_type));
+	(void)shim_strscpy((char *)sa.salg_name, "ctr(aes)", sizeof(sa.salg_name));
+	if (bind(sockfd, (struct sockaddr *)&sa, sizeof(sa)) < 0) {
+		if (args->instance == 0)
+			pr_inf("%s: AF_ALG bind to ctr(aes) failed, errno=%d (%s), skipping AF_ALG engines\n",
+				args->name, errno, strerror(errno));
+		(void)close(sockfd);
+		return -1;
+	}
+#if defined(ALG_SET_KEY)
+	if (setsockopt(sockfd, SOL_ALG, ALG_SET_KEY, bench->key, AF_ALG_BENCH_KEY_SIZE) < 0) {
+		if (args->instance == 0)
+			pr_inf("%s: AF_ALG ctr(aes) ALG_SET_KEY failed, errno=%d (%s), skipping AF_ALG engines\n",
+				args->name, errno, strerror(errno));
+		(void)close(sockfd);
+		return -1;
+	}
+#endif
+	bench->opfd = accept(sockfd, NULL, 0);
+	if (bench->opfd < 0) {
+		if (args->instance == 0)
+			pr_inf("%s: AF_ALG accept failed, errno=%d (%s), skipping AF_ALG engines\n",
+				args->name, errno, strerror(errno));
+		(void)close(sockfd);
+		return -1;
+	}
+#if defined(HAVE_VMSPLICE) &&	\
+    defined(HAVE_SPLICE) &&	\
+    defined(SPLICE_F_MORE)
+	if (pipe(bench->pipefd) < 0) {
+		bench->pipefd[0] = -1;
+		bench->pipefd[1] = -1;
+	}
+#endif
+	return sockfd;
+}
+
+/*
+ *  stress_af_alg_bench()
+ *	compare AES-128-CTR throughput of the kernel AF_ALG interface
+ *	(copy and zero copy input), intel-ipsec-mb and inline AES
+ *	instructions over buffer sizes from 64 bytes to 64K. Each
+ *	engine is first checked against the SP 800-38A test vector
+ */
+static int stress_af_alg_bench(stress_args_t *args)
+{
+	stress_af_alg_bench_t bench;
+	stress_af_alg_bench_stats_t stats[AF_ALG_BENCH_ENGINES][AF_ALG_BENCH_SIZES];
+	bool usable[AF_ALG_BENCH_ENGINES];
+	uint8_t *buf, *in, *out, *check;
+	const char *ref;
+	const size_t buf_size = 3 * AF_ALG_BENCH_MAX_SIZE;
+	size_t i, j, n_usable = 0;
+	int sockfd, rc = EXIT_SUCCESS;
+#if defined(STRESS_ARCH_X86) &&	\
+    defined(HAVE_ASM_X86_RDTSC)
+	const bool tsc = stress_cpu_x86_has_tsc();
+#else
+	const bool tsc = false;
+#endif
+
+	(void)shim_memset(&bench, 0, sizeof(bench));
+	(void)shim_memcpy(bench.key, af_alg_bench_key, sizeof(bench.key));
+	(void)shim_memcpy(bench.iv, af_alg_bench_iv, sizeof(bench.iv));
+	bench.opfd = -1;
+	bench.pipefd[0] = -1;
+	bench.pipefd[1] = -1;
+
+	buf = (uint8_t *)stress_mmap_populate(NULL, buf_size,
+			PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (buf == MAP_FAILED) {
+		pr_inf_skip("%s: cannot mmap %zu bytes for crypto buffers, skipping stressor\n",
+			args->name, buf_size);
+		return EXIT_NO_RESOURCE;
+	}
+	stress_set_vma_anon_name(buf, buf_size, "af-alg-bench");
+	in = buf;
+	out = in + AF_ALG_BENCH_MAX_SIZE;
+	check = out + AF_ALG_BENCH_MAX_SIZE;
+
+	sockfd = stress_af_alg_bench_afalg_init(args, &bench);
+#if defined(STRESS_AF_ALG_IPSEC_MB)
+	bench.mb_mgr = alloc_mb_mgr(0);
+	if (bench.mb_mgr) {
+		const uint64_t features = bench.mb_mgr->features;
+
+		if ((features & IMB_FEATURE_AVX512_SKX) == IMB_FEATURE_AVX512_SKX)
+			init_mb_mgr_avx512(bench.mb_mgr);
+		else if ((features & IMB_FEATURE_AVX2) == IMB_FEATURE_AVX2)
+			init_mb_mgr_avx2(bench.mb_mgr);
+		else
+			init_mb_mgr_sse(bench.mb_mgr);
+		IMB_AES_KEYEXP_128(bench.mb_mgr, bench.key, bench.expkey, bench.dust);
+	}
+#endif
+
+	/* check each engine against the test vector */
+	for (i = 0; i < AF_ALG_BENCH_ENGINES; i++) {
+		const stress_af_alg_bench_engine_t *engine = &af_alg_bench_engines[i];
+
+		usable[i] = stress_af_alg_bench_usable(args, &bench, engine->name, sockfd);
+		if (!usable[i]) {
+			if (args->instance == 0)
+				pr_inf("%s: %s not supported, skipping it\n", args->name, engine->name);
+			continue;
+		}
+		(void)shim_memcpy(in, af_alg_bench_plaintext, sizeof(af_alg_bench_plaintext));
+		(void)shim_memset(out, 0, sizeof(af_alg_bench_ciphertext));
+		if (engine->func(&bench, in, out, sizeof(af_alg_bench_plaintext)) < 0) {
+			if (args->instance == 0)
+				pr_inf("%s: %s failed, errno=%d (%s), skipping it\n",
+					args->name, engine->name, errno, strerror(errno));
+			usable[i] = false;
+			continue;
+		}
+		if (shim_memcmp(out, af_alg_bench_ciphertext, sizeof(af_alg_bench_ciphertext))) {
+			pr_fail("%s: %s AES-128-CTR output does not match the "
+				"SP 800-38A test vector\n", args->name, engine->name);
+			rc = EXIT_FAILURE;
+			goto tidy;
+		}
+		n_usable++;
+	}
+	if (n_usable == 0) {
+		if (args->instance == 0)
+			pr_inf_skip("%s: no AES-128-CTR engines available, skipping stressor\n",
+				args->name);
+		rc = EXIT_NO_RESOURCE;
+		goto tidy;
+	}
+
+	/* cross check the engines on a larger buffer with a partial last block */
+	stress_rndbuf(in, AF_ALG_BENCH_MAX_SIZE);
+	for (ref = NULL, i = 0; i < AF_ALG_BENCH_ENGINES; i++) {
+		const size_t len = AF_ALG_BENCH_MAX_SIZE - 7;
+
+		if (!usable[i])
+			continue;
+		if (af_alg_bench_engines[i].func(&bench, in, ref ? out : check, len) < 0) {
+			pr_fail("%s: %s encrypt of %zu bytes failed, errno=%d (%s)\n",
+				args->name, af_alg_bench_engines[i].name, len,
+				errno, strerror(errno));
+			rc = EXIT_FAILURE;
+			goto tidy;
+		}
+		if (!ref) {
+			ref = af_alg_bench_engines[i].name;
+		} else if (shim_memcmp(out, check, len)) {
+			pr_fail("%s: %s AES-128-CTR output on %zu bytes does not match %s\n",
+				args->name, af_alg_bench_engines[i].name, len, ref);
+			rc = EXIT_FAILURE;
+			goto tidy;
+		}
+	}
+	(void)shim_memset(stats, 0, sizeof(stats));
+
+	stress_set_proc_state(args->name, STRESS_STATE_SYNC_WAIT);
+	stress_sync_start_wait(args);
+	stress_set_proc_state(args->name, STRESS_STATE_RUN);
+
+	do {
+		for (i = 0; i < AF_ALG_BENCH_ENGINES; i++) {
+			const stress_af_alg_bench_func_t func = af_alg_bench_engines[i].func;
+
+			if (!usable[i])
+				continue;
+			for (j = 0; j < AF_ALG_BENCH_SIZES; j++) {
+				const size_t size = (size_t)1 << (AF_ALG_BENCH_MIN_SHIFT +
+							 (j * AF_ALG_BENCH_SHIFT_STEP));
+				const size_t ops = AF_ALG_BENCH_CELL_BYTES / size;
+				size_t k;
+				uint64_t c1 = 0, c2 = 0;
+				double t1, t2;
+
+				t1 = stress_time_now();
+				if (tsc)
+					c1 = stress_asm_x86_rdtsc();
+				for (k = 0; k < ops; k++) {
+					if (UNLIKELY(func(&bench, in, out, size) < 0))
+						break;
+				}
+				if (tsc)
+					c2 = stress_asm_x86_rdtsc();
+				t2 = stress_time_now();
+				if (UNLIKELY(k < ops)) {
+					if ((errno == EINTR) || !stress_continue_flag())
+						goto done;
+					pr_fail("%s: %s encrypt of %zu bytes failed, errno=%d (%s)\n",
+						args->name, af_alg_bench_engines[i].name, size,
+						errno, strerror(errno));
+					rc = EXIT_FAILURE;
+					goto done;
+				}
+				stats[i][j].duration += t2 - t1;
+				stats[i][j].bytes += (double)(ops * size);
+				stats[i][j].cycles += (double)(c2 - c1);
+			}
+			if (UNLIKELY(!stress_continue_flag()))
+				break;
+		}
+		stress_bogo_inc(args);
+	} while (stress_continue(args));
+
+done:
+	if (args->instance == 0) {
+		pr_block_begin();
+		pr_inf("%s: %-13s %s\n", args->name, "GB/sec",
+			"    64B    256B     1KB     4KB    16KB    64KB");
+	}
+	for (i = 0; i < AF_ALG_BENCH_ENGINES; i++) {
+		char rates[AF_ALG_BENCH_SIZES * 8 + 1], cpbs[AF_ALG_BENCH_SIZES * 8 + 1];
+
+		*rates = '\0';
+		*cpbs = '\0';
+		for (j = 0; j < AF_ALG_BENCH_SIZES; j++) {
+			const stress_af_alg_bench_stats_t *st = &stats[i][j];
+			const size_t size = (size_t)1 << (AF_ALG_BENCH_MIN_SHIFT +
+						 (j * AF_ALG_BENCH_SHIFT_STEP));
+			const size_t idx = (i * AF_ALG_BENCH_SIZES + j) * 2;
+			const double rate = (st->duration > 0.0) ? st->bytes / (st->duration * 1.0E9) : 0.0;
+			const double cpb = (st->bytes > 0.0) ? st->cycles / st->bytes : 0.0;
+			char msg[64];
+
+			(void)snprintf(rates + (j * 8), sizeof(rates) - (j * 8), " %7.3f", rate);
+			(void)snprintf(cpbs + (j * 8), sizeof(cpbs) - (j * 8), " %7.2f", cpb);
+			if (st->duration <= 0.0)
+				continue;
+			if (size < 1024)
+				(void)snprintf(msg, sizeof(msg), "%s %zuB GB/sec",
+					af_alg_bench_engines[i].name, size);
+			else
+				(void)snprintf(msg, sizeof(msg), "%s %zuKB GB/sec",
+					af_alg_bench_engines[i].name, size >> 10);
+			stress_metrics_set(args, idx, msg, rate, STRESS_METRIC_HARMONIC_MEAN);
+			if (!tsc)
+				continue;
+			if (size < 1024)
+				(void)snprintf(msg, sizeof(msg), "%s %zuB TSC cycles/byte",
+					af_alg_bench_engines[i].name, size);
+			else
+				(void)snprintf(msg, sizeof(msg), "%s %zuKB TSC cycles/byte",
+					af_alg_bench_engines[i].name, size >> 10);
+			stress_metrics_set(args, idx + 1, msg, cpb, STRESS_METRIC_GEOMETRIC_MEAN);
+		}
+		if (usable[i] && (args->instance == 0)) {
+			pr_inf("%s: %-13s%s\n", args->name, af_alg_bench_engines[i].name, rates);
+			if (tsc)
+				pr_inf("%s: %-13s%s TSC cycles/byte\n", args->name, "", cpbs);
+		}
+	}
+	if (args->instance == 0)
+		pr_block_end();
+
+tidy:
+	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
+#if defined(STRESS_AF_ALG_IPSEC_MB)
+	if (bench.mb_mgr)
+		free_mb_mgr(bench.mb_mgr);
+#endif
+	if (bench.pipefd[0] >= 0)
+		(void)close(bench.pipefd[0]);
+	if (bench.pipefd[1] >= 0)
+		(void)close(bench.pipefd[1]);
+	if (bench.opfd >= 0)
+		(void)close(bench.opfd);
+	if (sockfd >= 0)
+		(void)close(sockfd);
+	(void)munmap((void *)buf, buf_size);
+
+	return rc;
+}
+
 /*
  *  stress_af_alg()
  *	stress socket AF_ALG domain
@@ -871,11 +1765,15 @@ static int stress_af_alg(stress_args_t *args)
 	int retries = MAX_AF_ALG_RETRIES;
 	size_t proc_count, count, internal, idx;
 	bool af_alg_dump = false;
+	bool af_alg_bench = false;
 	stress_crypto_info_t *info;
 
 	stress_af_alg_count_crypto(&proc_count, &internal);
 
 	(void)stress_get_setting("af-alg-dump", &af_alg_dump);
+	(void)stress_get_setting("af-alg-bench", &af_alg_bench);
+	if (af_alg_bench)
+		return stress_af_alg_bench(args);
 
 	if (af_alg_dump && (args->instance == 0)) {
 		pr_inf("%s: dumping cryptographic algorithms found in /proc/crypto to stdout\n",
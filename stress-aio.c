@@ -376,6 +376,7 @@ const stressor_info_t stress_aio_info = {
 	.class = CLASS_IO | CLASS_INTERRUPT | CLASS_OS,
 	.opts = opts,
 	.verify = VERIFY_ALWAYS,
+	.metrics_max = 2,
 	.help = help
 };
 #else
@@ -20,6 +20,7 @@
 #include "stress-ng.h"
 #include "core-attribute.h"
 #include "core-builtin.h"
+#include "core-latency.h"
 #include "core-pragma.h"
 #include "core-target-clones.h"
 
@@ -33,21 +34,38 @@
 #include <poll.h>
 #endif
 
+#if defined(HAVE_SYS_EVENTFD_H)
+#include <sys/eventfd.h>
+#endif
+
 #define MIN_AIO_LINUX_REQUESTS		(1)
 #define MAX_AIO_LINUX_REQUESTS		(4096)
 #define DEFAULT_AIO_LINUX_REQUESTS	(64)
 
+#define MIN_AIO_LINUX_BATCH		(0)
+#define MAX_AIO_LINUX_BATCH		(4096)
+
+#define MIN_AIO_LINUX_MIN_NR		(1)
+#define MAX_AIO_LINUX_MIN_NR		(4096)
+
 #define BUFFER_SZ			(4096)
 #define DEFAULT_AIO_MAX_NR		(65536)
+#define STRESS_AIOL_BENCH_FILE		(64 * MB)
 
 static const stress_help_t help[] = {
 	{ NULL,	"aiol N",	   "start N workers that exercise Linux async I/O" },
+	{ NULL,	"aiol-batch N",	   "benchmark random I/O submitting N iocbs per io_submit call" },
+	{ NULL,	"aiol-eventfd",	   "reap completions on eventfd notification with --aiol-batch" },
+	{ NULL,	"aiol-min-nr N",   "io_getevents min_nr completions with --aiol-batch" },
 	{ NULL,	"aiol-ops N",	   "stop after N bogo Linux aio async I/O requests" },
 	{ NULL,	"aiol-requests N", "number of Linux aio async I/O requests per worker" },
 	{ NULL,	NULL,		   NULL }
 };
 
 static const stress_opt_t opts[] = {
+	{ OPT_aiol_batch,    "aiol-batch",    TYPE_ID_UINT32, MIN_AIO_LINUX_BATCH, MAX_AIO_LINUX_BATCH, NULL },
+	{ OPT_aiol_eventfd,  "aiol-eventfd",  TYPE_ID_BOOL, 0, 1, NULL },
+	{ OPT_aiol_min_nr,   "aiol-min-nr",   TYPE_ID_UINT32, MIN_AIO_LINUX_MIN_NR, MAX_AIO_LINUX_MIN_NR, NULL },
 	{ OPT_aiol_requests, "aiol-requests", TYPE_ID_UINT32, MIN_AIO_LINUX_REQUESTS, MAX_AIO_LINUX_REQUESTS, NULL },
 	END_OPT,
 };
@@ -61,6 +79,13 @@ static const stress_opt_t opts[] = {
     defined(__NR_io_submit) &&		\
     defined(__NR_io_getevents)
 
+#if defined(HAVE_SYS_EVENTFD_H) &&	\
+    defined(HAVE_EVENTFD) &&		\
+    defined(HAVE_POLL_H) &&		\
+    defined(HAVE_POLL)
+#define STRESS_AIOL_EVENTFD
+#endif
+
 typedef struct {
 	uint64_t aiol_completions;
 	uint8_t *buffer;
@@ -370,6 +395,242 @@ static void stress_aiol_free(stress_aiol_info_t *info)
 	(void)shim_memset(info, 0, sizeof(*info));
 }
 
+/*
+ *  stress_aiol_bench()
+ *	keep requests random 4K read/write requests in flight on a laid
+ *	out file, submitting up to batch iocbs per io_submit call and
+ *	reaping with io_getevents min_nr or eventfd notifications.
+ *	io_submit call and submit to completion latencies are reported
+ *	separately
+ */
+static int stress_aiol_bench(
+	stress_args_t *args,
+	stress_aiol_info_t *info,
+	const uint32_t requests,
+	const uint32_t batch,
+	const uint32_t min_nr,
+	const bool aiol_eventfd,
+	const bool direct)
+{
+	const uint64_t blocks = STRESS_AIOL_BENCH_FILE / BUFFER_SZ;
+	stress_latency_hist_t *submit_hist = NULL, *complete_hist = NULL;
+	uint64_t *t_submit = NULL, i, reaps = 0, reaped = 0;
+	uint32_t *free_slots = NULL, n_free, inflight = 0;
+	int efd = -1, rc = EXIT_SUCCESS;
+	double t_start, duration, rate;
+
+	if (aiol_eventfd) {
+#if defined(STRESS_AIOL_EVENTFD)
+		efd = eventfd(0, 0);
+		if (efd < 0) {
+			pr_inf_skip("%s: eventfd failed, errno=%d (%s), skipping stressor\n",
+				args->name, errno, strerror(errno));
+			return EXIT_NO_RESOURCE;
+		}
+#else
+		if (args->instance == 0)
+			pr_inf("%s: eventfd reaping not supported, using io_getevents\n",
+				args->name);
+#endif
+	}
+	if (!direct && (args->instance == 0))
+		pr_inf("%s: O_DIRECT not supported on this file system, using buffered I/O\n",
+			args->name);
+
+	t_submit = (uint64_t *)calloc(requests, sizeof(*t_submit));
+	free_slots = (uint32_t *)calloc(requests, sizeof(*free_slots));
+	submit_hist = (stress_latency_hist_t *)malloc(sizeof(*submit_hist));
+	complete_hist = (stress_latency_hist_t *)malloc(sizeof(*complete_hist));
+	if (!t_submit || !free_slots || !submit_hist || !complete_hist) {
+		pr_inf_skip("%s: cannot allocate %" PRIu32 " request slots, "
+			"skipping stressor\n", args->name, requests);
+		rc = EXIT_NO_RESOURCE;
+		goto tidy;
+	}
+	stress_latency_hist_init(submit_hist);
+	stress_latency_hist_init(complete_hist);
+
+	/* lay the file out so reads are not satisfied from holes */
+	stress_aiol_fill_buffer(stress_mwc8(), info->buffer, BUFFER_SZ);
+	for (i = 0; i < blocks; i++) {
+		if (pwrite(info->fds[0], info->buffer, BUFFER_SZ, (off_t)(i * BUFFER_SZ)) < 0) {
+			if ((errno == ENOSPC) || (errno == EDQUOT)) {
+				pr_inf_skip("%s: out of space laying out file, skipping stressor\n",
+					args->name);
+				rc = EXIT_NO_RESOURCE;
+			} else {
+				rc = stress_exit_status(errno);
+				pr_fail("%s: pwrite failed, errno=%d (%s)\n",
+					args->name, errno, strerror(errno));
+			}
+			goto tidy;
+		}
+		if (UNLIKELY(!stress_continue_flag()))
+			goto tidy;
+	}
+
+	for (n_free = 0; n_free < requests; n_free++)
+		free_slots[n_free] = n_free;
+
+	t_start = stress_time_now();
+	do {
+		uint64_t t_now;
+		int n, k;
+
+		/* submit free slots in batches of up to batch iocbs */
+		while ((n_free > 0) && stress_continue_flag()) {
+			const uint32_t nr = STRESS_MINIMUM(batch, n_free);
+			uint64_t t0;
+			int ret;
+
+			for (k = 0; k < (int)nr; k++) {
+				const uint32_t slot = free_slots[--n_free];
+				struct iocb *cb = &info->cb[slot];
+				uint8_t *buf = info->buffer + ((size_t)slot * BUFFER_SZ);
+				const long long int offset = (long long int)(stress_mwc64modn(blocks) * BUFFER_SZ);
+
+				if (stress_mwc1())
+					io_prep_pread(cb, info->fds[slot], buf, BUFFER_SZ, offset);
+				else
+					io_prep_pwrite(cb, info->fds[slot], buf, BUFFER_SZ, offset);
+#if defined(STRESS_AIOL_EVENTFD)
+				if (efd >= 0)
+					io_set_eventfd(cb, efd);
+#endif
+				info->cbs[k] = cb;
+			}
+			t0 = stress_latency_now();
+			ret = shim_io_submit(info->ctx_id, (long int)nr, info->cbs);
+			t_now = stress_latency_now();
+			if (UNLIKELY(ret < 0)) {
+				if (errno == EAGAIN)
+					ret = 0;
+				else {
+					rc = EXIT_FAILURE;
+					pr_fail("%s: io_submit failed, errno=%d (%s)\n",
+						args->name, errno, strerror(errno));
+					goto drain;
+				}
+			}
+			stress_latency_hist_record(submit_hist, t_now - t0);
+			for (k = 0; k < ret; k++)
+				t_submit[info->cbs[k] - info->cb] = t0;
+			/* return unsubmitted slots */
+			for (k = ret; k < (int)nr; k++)
+				free_slots[n_free++] = (uint32_t)(info->cbs[k] - info->cb);
+			inflight += (uint32_t)ret;
+			if (ret < (int)nr)
+				break;
+		}
+		if (inflight == 0)
+			continue;
+
+#if defined(STRESS_AIOL_EVENTFD)
+		if (efd >= 0) {
+			struct pollfd pfd;
+			uint64_t count;
+			struct timespec timeout;
+
+			pfd.fd = efd;
+			pfd.events = POLLIN;
+			pfd.revents = 0;
+			n = poll(&pfd, 1, 1000);
+			if (n <= 0)
+				continue;
+			if (read(efd, &count, sizeof(count)) < 0)
+				continue;
+			/* events may already be reaped, so never block */
+			timeout.tv_sec = 0;
+			timeout.tv_nsec = 0;
+			n = shim_io_getevents(info->ctx_id, 0, (long int)requests,
+				info->events, &timeout);
+		} else
+#endif
+		{
+			n = shim_io_getevents(info->ctx_id,
+				(long int)STRESS_MINIMUM(min_nr, inflight),
+				(long int)requests, info->events, NULL);
+		}
+		if (UNLIKELY(n < 0)) {
+			if (errno == EINTR)
+				continue;
+			rc = EXIT_FAILURE;
+			pr_fail("%s: io_getevents failed, errno=%d (%s)\n",
+				args->name, errno, strerror(errno));
+			break;
+		}
+		t_now = stress_latency_now();
+		reaps++;
+		reaped += (uint64_t)n;
+		for (k = 0; k < n; k++) {
+			const struct iocb *obj = info->events[k].obj;
+			const long int res = (long int)info->events[k].res;
+			uint32_t slot;
+			uint64_t ns;
+
+			if (UNLIKELY(!obj))
+				continue;
+			slot = (uint32_t)(obj - info->cb);
+			ns = t_now - t_submit[slot];
+			stress_latency_hist_record(complete_hist, ns);
+			stress_latency_record(args, 0, ns);
+			free_slots[n_free++] = slot;
+			inflight--;
+			info->aiol_completions++;
+			stress_bogo_inc(args);
+			if (UNLIKELY(res < 0)) {
+				rc = EXIT_FAILURE;
+				pr_fail("%s: async I/O request failed, errno=%d (%s)\n",
+					args->name, (int)-res, strerror((int)-res));
+				goto drain;
+			}
+		}
+	} while (stress_continue(args));
+drain:
+	duration = stress_time_now() - t_start;
+
+	/* reap any requests still in flight */
+	while (inflight > 0) {
+		const int n = shim_io_getevents(info->ctx_id, 1, (long int)requests,
+			info->events, NULL);
+
+		if (n < 0) {
+			if (errno == EINTR)
+				continue;
+			break;
+		}
+		inflight -= ((uint32_t)n > inflight) ? inflight : (uint32_t)n;
+	}
+
+	rate = (duration > 0.0) ? (double)complete_hist->count / duration : 0.0;
+	stress_metrics_set(args, 2, "IOPS", rate, STRESS_METRIC_HARMONIC_MEAN);
+	stress_metrics_set(args, 3, "usec p50 io_submit latency",
+		(double)stress_latency_hist_percentile(submit_hist, 50.0) / 1000.0,
+		STRESS_METRIC_HARMONIC_MEAN);
+	stress_metrics_set(args, 4, "usec p99 io_submit latency",
+		(double)stress_latency_hist_percentile(submit_hist, 99.0) / 1000.0,
+		STRESS_METRIC_MAXIMUM);
+	stress_metrics_set(args, 5, "usec p50 completion latency",
+		(double)stress_latency_hist_percentile(complete_hist, 50.0) / 1000.0,
+		STRESS_METRIC_HARMONIC_MEAN);
+	stress_metrics_set(args, 6, "usec p99 completion latency",
+		(double)stress_latency_hist_percentile(complete_hist, 99.0) / 1000.0,
+		STRESS_METRIC_MAXIMUM);
+	rate = (reaps > 0) ? (double)reaped / (double)reaps : 0.0;
+	stress_metrics_set(args, 7, "events per io_getevents call",
+		rate, STRESS_METRIC_HARMONIC_MEAN);
+tidy:
+	free(complete_hist);
+	free(submit_hist);
+	free(free_slots);
+	free(t_submit);
+#if defined(STRESS_AIOL_EVENTFD)
+	if (efd >= 0)
+		(void)close(efd);
+#endif
+	return rc;
+}
+
 /*
  *  stress_aiol
  *	stress asynchronous I/O using the linux specific aio ABI
@@ -382,6 +643,8 @@ static int stress_aiol(stress_args_t *args)
 	char buf[1];
 	uint32_t aiol_requiests = DEFAULT_AIO_LINUX_REQUESTS;
 	uint32_t aio_max_nr = DEFAULT_AIO_MAX_NR;
+	uint32_t aiol_batch = 0, aiol_min_nr = 1;
+	bool aiol_eventfd = false;
 	int j = 0;
 	size_t i;
 	int warnings = 0;
@@ -399,6 +662,9 @@ static int stress_aiol(stress_args_t *args)
 		if (g_opt_flags & OPT_FLAGS_MINIMIZE)
 			aiol_requiests = MIN_AIO_LINUX_REQUESTS;
 	}
+	(void)stress_get_setting("aiol-batch", &aiol_batch);
+	(void)stress_get_setting("aiol-min-nr", &aiol_min_nr);
+	(void)stress_get_setting("aiol-eventfd", &aiol_eventfd);
 	if ((aiol_requiests < MIN_AIO_LINUX_REQUESTS) ||
 	    (aiol_requiests > MAX_AIO_LINUX_REQUESTS)) {
 		pr_fail("%s: iol_requests out of range", args->name);
@@ -519,6 +785,17 @@ retry_open:
 	stress_sync_start_wait(args);
 	stress_set_proc_state(args->name, STRESS_STATE_RUN);
 
+	if (aiol_batch > 0) {
+		t = stress_time_now();
+		rc = stress_aiol_bench(args, &info, aiol_requiests, aiol_batch,
+			aiol_min_nr, aiol_eventfd, !!(flags & O_DIRECT));
+		duration = stress_time_now() - t;
+		goto close_fds;
+	}
+	if ((aiol_eventfd || (aiol_min_nr > 1)) && (args->instance == 0))
+		pr_inf("%s: --aiol-eventfd and --aiol-min-nr are only used with --aiol-batch\n",
+			args->name);
+
 	t = stress_time_now();
 	do {
 		register uint8_t *bufptr;
@@ -789,6 +1066,7 @@ retry_open:
 	duration = stress_time_now() - t;
 	rc = EXIT_SUCCESS;
 
+close_fds:
 	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
 	(void)close(info.fds[0]);
 	for (i = 1; i < aiol_requiests; i++) {
@@ -819,6 +1097,7 @@ const stressor_info_t stress_aiol_info = {
 	.class = CLASS_IO | CLASS_INTERRUPT | CLASS_OS,
 	.opts = opts,
 	.verify = VERIFY_ALWAYS,
+	.metrics_max = 8,
 	.help = help
 };
 #else
@@ -19,6 +19,7 @@
  */
 #include "stress-ng.h"
 #include "core-builtin.h"
+#include "core-latency.h"
 #include "core-out-of-memory.h"
 
 #if defined(HAVE_MALLOC_H)
@@ -129,6 +130,8 @@ static int stress_bigheap_child(stress_args_t *args, void *context)
 	const bool verify = !!(g_opt_flags & OPT_FLAGS_VERIFY);
 	const bool oom_avoid = !!(g_opt_flags & OPT_FLAGS_OOM_AVOID);
 	const bool aggressive = !!(g_opt_flags & OPT_FLAGS_AGGRESSIVE);
+	const bool fault_latency = stress_latency_enabled(args);
+	stress_latency_fault_t fault;
 	bool bigheap_mlock = false;
 	struct sigaction action;
 	int ret;
@@ -189,6 +192,9 @@ static int stress_bigheap_child(stress_args_t *args, void *context)
 		return EXIT_FAILURE;
 	}
 
+	if (fault_latency)
+		stress_latency_fault_init(args, &fault);
+
 	stress_set_proc_state(args->name, STRESS_STATE_SYNC_WAIT);
 	stress_sync_start_wait(args);
 	stress_set_proc_state(args->name, STRESS_STATE_RUN);
@@ -275,11 +281,26 @@ static int stress_bigheap_child(stress_args_t *args, void *context)
 				uintptr = (uintptr_t *)ptr;
 				*uintptr = (uintptr_t)uintptr;
 			}
-			while (uintptr < uintptr_end) {
-				if (UNLIKELY(!stress_continue(args)))
-					goto finish;
-				*uintptr = (uintptr_t)uintptr;
-				uintptr += stride / sizeof(uintptr_t);
+			if (UNLIKELY(fault_latency)) {
+				/* time the first touch page faults */
+				while (uintptr < uintptr_end) {
+					uint64_t t_begin;
+
+					if (UNLIKELY(!stress_continue(args)))
+						goto finish;
+					t_begin = stress_latency_fault_begin(&fault);
+					*uintptr = (uintptr_t)uintptr;
+					stress_latency_fault_end(args, &fault, uintptr, t_begin);
+					uintptr += stride / sizeof(uintptr_t);
+				}
+				stress_latency_fault_flush(args, &fault);
+			} else {
+				while (uintptr < uintptr_end) {
+					if (UNLIKELY(!stress_continue(args)))
+						goto finish;
+					*uintptr = (uintptr_t)uintptr;
+					uintptr += stride / sizeof(uintptr_t);
+				}
 			}
 
 			if (verify) {
@@ -341,5 +362,6 @@ const stressor_info_t stress_bigheap_info = {
 	.class = CLASS_OS | CLASS_VM,
 	.opts = opts,
 	.verify = VERIFY_OPTIONAL,
+	.metrics_max = 1,
 	.help = help
 };
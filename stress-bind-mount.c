@@ -253,6 +253,7 @@ const stressor_info_t stress_bind_mount_info = {
 	.stressor = stress_bind_mount,
 	.class = CLASS_FILESYSTEM | CLASS_OS | CLASS_PATHOLOGICAL,
 	.verify = VERIFY_ALWAYS,
+	.metrics_max = 2,
 	.help = help
 };
 #else
@@ -257,6 +257,7 @@ const stressor_info_t stress_binderfs_info = {
 	.supported = stress_binderfs_supported,
 	.class = CLASS_FILESYSTEM | CLASS_OS,
 	.verify = VERIFY_ALWAYS,
+	.metrics_max = 2,
 	.help = help
 };
 #else
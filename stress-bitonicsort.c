@@ -17,9 +17,12 @@
  *
  */
 #include "stress-ng.h"
+#include "core-builtin.h"
 #include "core-madvise.h"
 #include "core-pragma.h"
 #include "core-sort.h"
+#include "core-target-clones.h"
+#include "core-vecmath.h"
 
 #define MIN_BITONICSORT_SIZE		(1 * KB)
 #define MAX_BITONICSORT_SIZE		(4 * MB)
@@ -31,16 +34,12 @@ static uint64_t bitonic_count;
 
 static const stress_help_t help[] = {
 	{ NULL,	"bitonicsort N",	"start N workers bitonic sorting 32 bit random integers" },
+	{ NULL,	"bitonicsort-method M",	"select sort method: all, scalar, vec16, vec32, vec64" },
 	{ NULL,	"bitonicsort-ops N",  	"stop after N bitonic sort bogo operations" },
 	{ NULL,	"bitonicsort-size N", 	"number of 32 bit integers to sort" },
 	{ NULL,	NULL,			NULL }
 };
 
-static const stress_opt_t opts[] = {
-	{ OPT_bitonicsort_size, "bitonicsort-size", TYPE_ID_UINT64, MIN_BITONICSORT_SIZE, MAX_BITONICSORT_SIZE, NULL },
-	END_OPT,
-};
-
 /*
  *  stress_bitonicsort_handler()
  *	SIGALRM generic handler
@@ -115,6 +114,228 @@ static inline void OPTIMIZE3 bitonicsort32_rev(void *base, const size_t nmemb)
 	}
 }
 
+#if defined(HAVE_VECMATH) &&		\
+    defined(HAVE_BUILTIN_SHUFFLE)
+#define HAVE_BITONICSORT_VEC
+
+/*
+ *  Vector bitonic sort, the same network as the scalar sort but
+ *  compare-exchanges are performed on 8 x 32 bit lane vectors so the
+ *  compiler can emit AVX-512, AVX2, SSE or NEON min/max instructions.
+ *  Blocks of 16, 32 or 64 keys (2, 4 or 8 vectors) are sorted in
+ *  registers, larger merge stages compare-exchange whole vectors in
+ *  memory until the pair distance fits in a block, the remaining stages
+ *  are then run in registers, lane distances < 8 use lane shuffles.
+ */
+#define BITONIC_VEC_LANES	(8)
+
+typedef uint32_t bitonic_vec_t __attribute__ ((vector_size (BITONIC_VEC_LANES * sizeof(uint32_t))));
+
+static bitonic_vec_t bitonic_vec_perm[3];	/* lane i ^ j, j = 1, 2, 4 */
+static bitonic_vec_t bitonic_vec_lo[3];		/* lanes where (i & j) == 0 */
+static bitonic_vec_t bitonic_vec_dir[3];	/* lanes where (i & k) != 0, k = 2, 4 */
+
+static void bitonic_vec_init(void)
+{
+	size_t b, i;
+
+	for (b = 0; b < 3; b++) {
+		const uint32_t j = 1U << b;
+
+		for (i = 0; i < BITONIC_VEC_LANES; i++) {
+			bitonic_vec_perm[b][i] = (uint32_t)i ^ j;
+			bitonic_vec_lo[b][i] = (i & j) ? 0 : ~0U;
+			bitonic_vec_dir[b][i] = (i & (j << 1)) ? ~0U : 0;
+		}
+	}
+}
+
+/*
+ *  bitonic_vec_cmpswap()
+ *	compare-exchange lanes of two vectors, ascending puts the
+ *	minimums in *a and the maximums in *b
+ */
+static inline void ALWAYS_INLINE bitonic_vec_cmpswap(
+	bitonic_vec_t *a,
+	bitonic_vec_t *b,
+	const bool ascending)
+{
+	const bitonic_vec_t x = *a;
+	const bitonic_vec_t y = *b;
+	bitonic_vec_t vmin, vmax;
+	size_t i;
+
+	/* element-wise form, compilers map this onto vector min/max */
+	for (i = 0; i < BITONIC_VEC_LANES; i++) {
+		vmin[i] = (x[i] < y[i]) ? x[i] : y[i];
+		vmax[i] = (x[i] < y[i]) ? y[i] : x[i];
+	}
+	*a = ascending ? vmin : vmax;
+	*b = ascending ? vmax : vmin;
+}
+
+/*
+ *  bitonic_vec_lanes()
+ *	compare-exchange lanes i and i ^ j of a vector, lanes in keep
+ *	take the minimum, the others the maximum
+ */
+static inline void ALWAYS_INLINE bitonic_vec_lanes(
+	bitonic_vec_t *vp,
+	const size_t jbit,
+	const bitonic_vec_t *keepp)
+{
+	const bitonic_vec_t v = *vp;
+	const bitonic_vec_t keep = *keepp;
+	const bitonic_vec_t o = __builtin_shuffle(v, bitonic_vec_perm[jbit]);
+	bitonic_vec_t vmin, vmax;
+	size_t i;
+
+	for (i = 0; i < BITONIC_VEC_LANES; i++) {
+		vmin[i] = (v[i] < o[i]) ? v[i] : o[i];
+		vmax[i] = (v[i] < o[i]) ? o[i] : v[i];
+	}
+
+	*vp = (vmin & keep) | (vmax & ~keep);
+}
+
+/*
+ *  bitonic_vec_block()
+ *	run bitonic stages k = klo..khi with pair distances j < block size
+ *	on each block of vecs vectors, in registers
+ */
+static inline void ALWAYS_INLINE bitonic_vec_block(
+	uint32_t *array,
+	const size_t n,
+	const size_t vecs,
+	const size_t klo,
+	const size_t khi)
+{
+	const size_t block = vecs * BITONIC_VEC_LANES;
+	size_t i;
+
+	for (i = 0; i < n; i += block) {
+		bitonic_vec_t v[8];
+		size_t a, k;
+
+		for (a = 0; a < vecs; a++)
+			v[a] = *(bitonic_vec_t *)&array[i + (a * BITONIC_VEC_LANES)];
+
+		for (k = klo; k <= khi; k <<= 1) {
+			size_t j = (k >> 1) < (block >> 1) ? (k >> 1) : (block >> 1);
+
+			/* distances of whole vectors */
+			for (; j >= BITONIC_VEC_LANES; j >>= 1) {
+				const size_t jv = j / BITONIC_VEC_LANES;
+
+				for (a = 0; a < vecs; a++) {
+					if ((a ^ jv) > a)
+						bitonic_vec_cmpswap(&v[a], &v[a ^ jv],
+							((i + (a * BITONIC_VEC_LANES)) & k) == 0);
+				}
+			}
+			/* distances within a vector */
+			for (; j > 0; j >>= 1) {
+				const size_t jbit = (j == 1) ? 0 : (j == 2) ? 1 : 2;
+
+				for (a = 0; a < vecs; a++) {
+					bitonic_vec_t dir, keep;
+
+					if (k >= BITONIC_VEC_LANES) {
+						dir = (((i + (a * BITONIC_VEC_LANES)) & k) != 0) ?
+							~(bitonic_vec_t){ 0 } : (bitonic_vec_t){ 0 };
+					} else {
+						dir = bitonic_vec_dir[(k == 2) ? 0 : 1];
+					}
+					keep = bitonic_vec_lo[jbit] ^ dir;
+					bitonic_vec_lanes(&v[a], jbit, &keep);
+				}
+			}
+		}
+
+		for (a = 0; a < vecs; a++)
+			*(bitonic_vec_t *)&array[i + (a * BITONIC_VEC_LANES)] = v[a];
+	}
+}
+
+/*
+ *  bitonicsort32_vec()
+ *	ascending vector bitonic sort of n keys, n is a power of 2
+ *	and at least vecs * 8
+ */
+static inline void ALWAYS_INLINE bitonicsort32_vec(uint32_t *array, const size_t n, const size_t vecs)
+{
+	bitonic_vec_t *varray = (bitonic_vec_t *)array;
+	const size_t block = vecs * BITONIC_VEC_LANES;
+	size_t k;
+
+	/* sort each block in registers */
+	bitonic_vec_block(array, n, vecs, 2, block);
+
+	/* bitonic merges larger than a block */
+	for (k = block << 1; k <= n; k <<= 1) {
+		size_t j;
+
+		for (j = k >> 1; j >= block; j >>= 1) {
+			const size_t jv = j / BITONIC_VEC_LANES;
+			size_t p;
+
+			for (p = 0; p < n / BITONIC_VEC_LANES; p++) {
+				const size_t l = p ^ jv;
+
+				if (l > p)
+					bitonic_vec_cmpswap(&varray[p], &varray[l],
+						((p * BITONIC_VEC_LANES) & k) == 0);
+			}
+		}
+		bitonic_vec_block(array, n, vecs, k, k);
+	}
+}
+
+static void TARGET_CLONES OPTIMIZE3 bitonicsort32_vec16(uint32_t *array, const size_t n)
+{
+	bitonicsort32_vec(array, n, 2);
+}
+
+static void TARGET_CLONES OPTIMIZE3 bitonicsort32_vec32(uint32_t *array, const size_t n)
+{
+	bitonicsort32_vec(array, n, 4);
+}
+
+static void TARGET_CLONES OPTIMIZE3 bitonicsort32_vec64(uint32_t *array, const size_t n)
+{
+	bitonicsort32_vec(array, n, 8);
+}
+#endif
+
+typedef void (*bitonicsort_func_t)(uint32_t *array, const size_t n);
+
+typedef struct {
+	const char *name;		/* method name */
+	const bitonicsort_func_t func;	/* vector sort, NULL for scalar */
+	const size_t block;		/* keys per vector block */
+} stress_bitonicsort_method_t;
+
+static const stress_bitonicsort_method_t bitonicsort_methods[] = {
+	{ "all",	NULL,			0 },
+	{ "scalar",	NULL,			0 },
+#if defined(HAVE_BITONICSORT_VEC)
+	{ "vec16",	bitonicsort32_vec16,	16 },
+	{ "vec32",	bitonicsort32_vec32,	32 },
+	{ "vec64",	bitonicsort32_vec64,	64 },
+#endif
+};
+
+static const char *stress_bitonicsort_method(const size_t i)
+{
+	return (i < SIZEOF_ARRAY(bitonicsort_methods)) ? bitonicsort_methods[i].name : NULL;
+}
+
+static const stress_opt_t opts[] = {
+	{ OPT_bitonicsort_method, "bitonicsort-method", TYPE_ID_SIZE_T_METHOD, 0, 1, stress_bitonicsort_method },
+	{ OPT_bitonicsort_size,   "bitonicsort-size",   TYPE_ID_UINT64, MIN_BITONICSORT_SIZE, MAX_BITONICSORT_SIZE, NULL },
+	END_OPT,
+};
+
 /*
  *  stress_bitonicsort()
  *	stress bitonicsort
@@ -129,7 +350,17 @@ static int OPTIMIZE3 stress_bitonicsort(stress_args_t *args)
 	NOCLOBBER int rc = EXIT_SUCCESS;
 	double rate;
 	NOCLOBBER double duration = 0.0, count = 0.0, sorted = 0.0;
+	NOCLOBBER double vec_duration[SIZEOF_ARRAY(bitonicsort_methods)];
+	NOCLOBBER double vec_sorted[SIZEOF_ARRAY(bitonicsort_methods)];
 	const bool verify = !!(g_opt_flags & OPT_FLAGS_VERIFY);
+	size_t bitonicsort_method = 0;	/* all */
+	size_t m, vec_n;
+	bool do_scalar;
+
+	(void)shim_memset(vec_duration, 0, sizeof(vec_duration));
+	(void)shim_memset(vec_sorted, 0, sizeof(vec_sorted));
+	(void)stress_get_setting("bitonicsort-method", &bitonicsort_method);
+	do_scalar = (bitonicsort_method <= 1);
 
 	if (!stress_get_setting("bitonicsort-size", &bitonicsort_size)) {
 		if (g_opt_flags & OPT_FLAGS_MAXIMIZE)
@@ -140,6 +371,13 @@ static int OPTIMIZE3 stress_bitonicsort(stress_args_t *args)
 	n = (size_t)bitonicsort_size;
 	data_size = n * sizeof(*data);
 
+	/* vector sorts use the largest power of 2 number of keys <= n */
+	for (vec_n = 1; (vec_n << 1) <= n; vec_n <<= 1)
+		;
+#if defined(HAVE_BITONICSORT_VEC)
+	bitonic_vec_init();
+#endif
+
 	data = (int32_t *)stress_mmap_populate(NULL, data_size,
 				PROT_READ | PROT_WRITE,
 				MAP_ANONYMOUS | MAP_PRIVATE, -1, 0);
@@ -173,81 +411,113 @@ static int OPTIMIZE3 stress_bitonicsort(stress_args_t *args)
 	do {
 		double t;
 
-		stress_sort_data_int32_shuffle(data, n);
+		if (do_scalar) {
+			stress_sort_data_int32_shuffle(data, n);
 
-		/* Sort "random" data */
-		bitonic_count = 0;
-		t = stress_time_now();
-		bitonicsort32_fwd(data, n);
-		duration += stress_time_now() - t;
-		count += (double)bitonic_count;
-		sorted += (double)n;
+			/* Sort "random" data */
+			bitonic_count = 0;
+			t = stress_time_now();
+			bitonicsort32_fwd(data, n);
+			duration += stress_time_now() - t;
+			count += (double)bitonic_count;
+			sorted += (double)n;
 
-		if (UNLIKELY(verify)) {
-			register size_t i;
+			if (UNLIKELY(verify)) {
+				register size_t i;
 
 PRAGMA_UNROLL_N(4)
-			for (ptr = data, i = 0; i < n - 1; i++, ptr++) {
-				if (UNLIKELY(*ptr > *(ptr + 1))) {
-					pr_fail("%s: sort error "
-						"detected, incorrect ordering "
-						"found\n", args->name);
-					rc = EXIT_FAILURE;
-					break;
+				for (ptr = data, i = 0; i < n - 1; i++, ptr++) {
+					if (UNLIKELY(*ptr > *(ptr + 1))) {
+						pr_fail("%s: sort error "
+							"detected, incorrect ordering "
+							"found\n", args->name);
+						rc = EXIT_FAILURE;
+						break;
+					}
 				}
 			}
-		}
-		if (UNLIKELY(!stress_continue_flag()))
-			break;
+			if (UNLIKELY(!stress_continue_flag()))
+				break;
 
-		/* Reverse sort */
-		bitonic_count = 0;
-		t = stress_time_now();
-		bitonicsort32_rev(data, n);
-		duration += stress_time_now() - t;
-		count += (double)bitonic_count;
-		sorted += (double)n;
+			/* Reverse sort */
+			bitonic_count = 0;
+			t = stress_time_now();
+			bitonicsort32_rev(data, n);
+			duration += stress_time_now() - t;
+			count += (double)bitonic_count;
+			sorted += (double)n;
 
-		if (UNLIKELY(verify)) {
-			register size_t i;
+			if (UNLIKELY(verify)) {
+				register size_t i;
 
 PRAGMA_UNROLL_N(4)
-			for (ptr = data, i = 0; i < n - 1; i++, ptr++) {
-				if (UNLIKELY(*ptr < *(ptr + 1))) {
-					pr_fail("%s: reverse sort "
-						"error detected, incorrect "
-						"ordering found\n", args->name);
-					rc = EXIT_FAILURE;
-					break;
+				for (ptr = data, i = 0; i < n - 1; i++, ptr++) {
+					if (UNLIKELY(*ptr < *(ptr + 1))) {
+						pr_fail("%s: reverse sort "
+							"error detected, incorrect "
+							"ordering found\n", args->name);
+						rc = EXIT_FAILURE;
+						break;
+					}
 				}
 			}
+			if (UNLIKELY(!stress_continue_flag()))
+				break;
+
+			/* And re-order */
+			stress_sort_data_int32_mangle(data, n);
+
+			/* Reverse sort this again */
+			bitonic_count = 0;
+			t = stress_time_now();
+			bitonicsort32_rev(data, n);
+			duration += stress_time_now() - t;
+			count += (double)bitonic_count;
+			sorted += (double)n;
+
+			if (UNLIKELY(verify)) {
+				register size_t i;
+
+				for (ptr = data, i = 0; i < n - 1; i++, ptr++) {
+					if (UNLIKELY(*ptr < *(ptr + 1))) {
+						pr_fail("%s: reverse sort "
+							"error detected, incorrect "
+							"ordering found\n", args->name);
+						rc = EXIT_FAILURE;
+						break;
+					}
+				}
+			}
+			if (UNLIKELY(!stress_continue_flag()))
+				break;
 		}
-		if (UNLIKELY(!stress_continue_flag()))
-			break;
-
-		/* And re-order */
-		stress_sort_data_int32_mangle(data, n);
 
-		/* Reverse sort this again */
-		bitonic_count = 0;
-		t = stress_time_now();
-		bitonicsort32_rev(data, n);
-		duration += stress_time_now() - t;
-		count += (double)bitonic_count;
-		sorted += (double)n;
-
-		if (UNLIKELY(verify)) {
+		for (m = 2; m < SIZEOF_ARRAY(bitonicsort_methods); m++) {
 			register size_t i;
-
-			for (ptr = data, i = 0; i < n - 1; i++, ptr++) {
-				if (UNLIKELY(*ptr < *(ptr + 1))) {
-					pr_fail("%s: reverse sort "
-						"error detected, incorrect "
-						"ordering found\n", args->name);
-					rc = EXIT_FAILURE;
-					break;
+			register const uint32_t *uptr = (const uint32_t *)data;
+
+			if ((bitonicsort_method != 0) && (bitonicsort_method != m))
+				continue;
+
+			stress_sort_data_int32_shuffle(data, vec_n);
+			t = stress_time_now();
+			bitonicsort_methods[m].func((uint32_t *)data, vec_n);
+			vec_duration[m] += stress_time_now() - t;
+			vec_sorted[m] += (double)vec_n;
+
+			if (UNLIKELY(verify)) {
+				for (i = 0; i < vec_n - 1; i++) {
+					if (UNLIKELY(uptr[i] > uptr[i + 1])) {
+						pr_fail("%s: %s sort error detected, "
+							"incorrect ordering found\n",
+							args->name, bitonicsort_methods[m].name);
+						rc = EXIT_FAILURE;
+						break;
+					}
 				}
 			}
+			if (UNLIKELY(!stress_continue_flag()))
+				break;
 		}
 		if (UNLIKELY(!stress_continue_flag()))
 			break;
@@ -263,7 +533,23 @@ tidy:
 	stress_metrics_set(args, 0, "bitonicsort comparisons per sec",
 		rate, STRESS_METRIC_HARMONIC_MEAN);
 	stress_metrics_set(args, 1, "bitonicsort comparisons per item",
-		count / sorted, STRESS_METRIC_HARMONIC_MEAN);
+		(sorted > 0.0) ? count / sorted : 0.0, STRESS_METRIC_HARMONIC_MEAN);
+	if (do_scalar) {
+		rate = (duration > 0.0) ? sorted / duration : 0.0;
+		stress_metrics_set(args, 2, "scalar Mkeys sorted per sec",
+			rate / 1.0E6, STRESS_METRIC_HARMONIC_MEAN);
+	}
+	for (m = 2; m < SIZEOF_ARRAY(bitonicsort_methods); m++) {
+		if (vec_duration[m] > 0.0) {
+			char msg[40];
+
+			(void)snprintf(msg, sizeof(msg), "%s Mkeys sorted per sec",
+				bitonicsort_methods[m].name);
+			rate = vec_sorted[m] / vec_duration[m];
+			stress_metrics_set(args, 1 + m, msg,
+				rate / 1.0E6, STRESS_METRIC_HARMONIC_MEAN);
+		}
+	}
 
 	(void)munmap((void *)data, data_size);
 
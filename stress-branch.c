@@ -19,13 +19,27 @@
  */
 #include "stress-ng.h"
 #include "core-arch.h"
+#include "core-asm-generic.h"
+#include "core-perf.h"
+#include "core-pragma.h"
+#include "core-put.h"
+
+#if defined(HAVE_LINUX_PERF_EVENT_H)
+#include <linux/perf_event.h>
+#endif
 
 static const stress_help_t help[] = {
 	{ NULL,	"branch N",	"start N workers that force branch misprediction" },
 	{ NULL,	"branch-ops N",	"stop after N branch misprediction branches" },
+	{ NULL,	"branch-sweep",	"report mispredicts over branch sites and pattern periods" },
 	{ NULL,	NULL,		NULL }
 };
 
+static const stress_opt_t opts[] = {
+	{ OPT_branch_sweep, "branch-sweep", TYPE_ID_BOOL, 0, 1, NULL },
+	END_OPT,
+};
+
 #if defined(HAVE_LABEL_AS_VALUE) &&		\
     !defined(HAVE_COMPILER_PCC)
 
@@ -45,6 +59,222 @@ static const stress_help_t help[] = {
 
 #define J(n) L ## n:	RESEED_JMP(n)
 
+/*
+ *  Branch predictor sweep, BRANCH_SWEEP_SITES_MAX distinct conditional
+ *  branch sites, each site n has its own random taken/not-taken
+ *  pattern of BRANCH_SWEEP_PERIOD_MAX bits in the pattern stream and
+ *  only uses the first period bits so its history repeats every period
+ *  iterations. The number of sites executed is selected by switching
+ *  into the fall through site sequence. The taken path contains an
+ *  empty volatile asm statement to stop the compiler from converting
+ *  the branches into conditional moves. The site cases deliberately
+ *  fall through, so the implicit fall through warning is disabled.
+ */
+#define BRANCH_SWEEP_SITES_MAX	(1024)
+#define BRANCH_SWEEP_PERIOD_MAX	(1024)
+#define BRANCH_SWEEP_TIME	(0.02)		/* seconds per measurement */
+
+#if ((defined(HAVE_COMPILER_GCC_OR_MUSL) &&	\
+      NEED_GNUC(7, 0, 0)) ||			\
+     defined(HAVE_COMPILER_CLANG)) &&		\
+    defined(HAVE_PRAGMA)
+#define BRANCH_SWEEP_WARN_FALLTHROUGH_OFF	\
+	_Pragma("GCC diagnostic ignored \"-Wimplicit-fallthrough\"")
+#else
+#define BRANCH_SWEEP_WARN_FALLTHROUGH_OFF
+#endif
+
+#define BRANCH_SITE(n)							\
+	case (n): {							\
+		register const size_t bit = ((n) * BRANCH_SWEEP_PERIOD_MAX) + phase; \
+									\
+		if ((stream[bit >> 6] >> (bit & 63)) & 1) {		\
+			stress_asm_nothing();				\
+			taken++;					\
+		}							\
+	}
+
+#define BRANCH_SITE4(n)		\
+	BRANCH_SITE(n)		\
+	BRANCH_SITE(n + 1)	\
+	BRANCH_SITE(n + 2)	\
+	BRANCH_SITE(n + 3)
+
+#define BRANCH_SITE16(n)	\
+	BRANCH_SITE4(n)		\
+	BRANCH_SITE4(n + 4)	\
+	BRANCH_SITE4(n + 8)	\
+	BRANCH_SITE4(n + 12)
+
+#define BRANCH_SITE64(n)	\
+	BRANCH_SITE16(n)	\
+	BRANCH_SITE16(n + 16)	\
+	BRANCH_SITE16(n + 32)	\
+	BRANCH_SITE16(n + 48)
+
+#define BRANCH_SITE256(n)	\
+	BRANCH_SITE64(n)	\
+	BRANCH_SITE64(n + 64)	\
+	BRANCH_SITE64(n + 128)	\
+	BRANCH_SITE64(n + 192)
+
+static const size_t branch_sweep_sites[] = {
+	1, 4, 16, 64, 256, 1024
+};
+
+static const size_t branch_sweep_periods[] = {
+	1, 4, 16, 64, 256, 1024
+};
+
+STRESS_PRAGMA_PUSH
+BRANCH_SWEEP_WARN_FALLTHROUGH_OFF
+/*
+ *  stress_branch_sweep_run()
+ *	execute the last sites branch sites for iterations times
+ *	with a pattern period of period iterations
+ */
+static uint64_t OPTIMIZE3 NOINLINE stress_branch_sweep_run(
+	const uint64_t *stream,
+	const size_t sites,
+	const size_t period,
+	const uint64_t iterations)
+{
+	const size_t first = BRANCH_SWEEP_SITES_MAX - sites;
+	register uint64_t i, taken = 0;
+	register size_t phase = 0;
+
+	for (i = 0; i < iterations; i++) {
+		switch (first) {
+		BRANCH_SITE256(0)
+		BRANCH_SITE256(256)
+		BRANCH_SITE256(512)
+		BRANCH_SITE256(768)
+		default:
+			break;
+		}
+		phase++;
+		if (phase >= period)
+			phase = 0;
+	}
+	return taken;
+}
+STRESS_PRAGMA_POP
+
+#if defined(STRESS_PERF_STATS)
+static const stress_perf_counter_cfg_t branch_sweep_cfgs[] = {
+	{ PERF_TYPE_HARDWARE,	PERF_COUNT_HW_BRANCH_MISSES },
+};
+#endif
+
+/*
+ *  stress_branch_sweep()
+ *	measure the time per branch and branch mispredict rate for
+ *	a range of distinct branch sites and pattern periods to
+ *	characterise the branch predictor capacity and history length
+ */
+static void stress_branch_sweep(stress_args_t *args)
+{
+	const size_t stream_words = (BRANCH_SWEEP_SITES_MAX * BRANCH_SWEEP_PERIOD_MAX) / 64;
+	uint64_t *stream, taken = 0;
+	size_t i, j, len;
+	double ns[SIZEOF_ARRAY(branch_sweep_sites)][SIZEOF_ARRAY(branch_sweep_periods)];
+	double miss[SIZEOF_ARRAY(branch_sweep_sites)][SIZEOF_ARRAY(branch_sweep_periods)];
+	char line[256];
+#if defined(STRESS_PERF_STATS)
+	stress_perf_counters_t pc;
+	const bool have_counters =
+		(stress_perf_counters_open(&pc, branch_sweep_cfgs,
+			SIZEOF_ARRAY(branch_sweep_cfgs)) > 0);
+#else
+	const bool have_counters = false;
+#endif
+
+	stream = (uint64_t *)calloc(stream_words, sizeof(*stream));
+	if (!stream) {
+		pr_inf("%s: cannot allocate branch pattern stream, skipping sweep\n", args->name);
+		goto close_counters;
+	}
+	for (i = 0; i < stream_words; i++)
+		stream[i] = stress_mwc64();
+
+	for (i = 0; i < SIZEOF_ARRAY(branch_sweep_sites); i++) {
+		const size_t sites = branch_sweep_sites[i];
+		const uint64_t iterations = (64 * KB) / sites;
+
+		for (j = 0; j < SIZEOF_ARRAY(branch_sweep_periods); j++) {
+			const size_t period = branch_sweep_periods[j];
+			uint64_t before = 0, after = 0, n = 0;
+			double t, duration;
+
+			ns[i][j] = 0.0;
+			miss[i][j] = 0.0;
+			if (UNLIKELY(!stress_continue(args)))
+				continue;
+
+			/* warm up predictor */
+			taken += stress_branch_sweep_run(stream, sites, period, iterations);
+#if defined(STRESS_PERF_STATS)
+			if (have_counters)
+				(void)stress_perf_counters_read(&pc, &before);
+#endif
+			t = stress_time_now();
+			do {
+				taken += stress_branch_sweep_run(stream, sites, period, iterations);
+				n += iterations;
+				duration = stress_time_now() - t;
+			} while (duration < BRANCH_SWEEP_TIME);
+#if defined(STRESS_PERF_STATS)
+			if (have_counters)
+				(void)stress_perf_counters_read(&pc, &after);
+#endif
+			ns[i][j] = STRESS_DBL_NANOSECOND * duration / ((double)n * (double)sites);
+			if (after > before)
+				miss[i][j] = 100.0 * (double)(after - before) / ((double)n * (double)sites);
+		}
+	}
+	stress_uint64_put(taken);
+	free(stream);
+
+	pr_block_begin();
+	if (have_counters) {
+		pr_inf("%s: branch mispredicts (%% of site branches) by sites (rows) and pattern period (columns):\n",
+			args->name);
+		len = (size_t)snprintf(line, sizeof(line), "%6s", "sites");
+		for (j = 0; j < SIZEOF_ARRAY(branch_sweep_periods); j++)
+			len += (size_t)snprintf(line + len, sizeof(line) - len, " %8zu", branch_sweep_periods[j]);
+		pr_inf("%s: %s\n", args->name, line);
+		for (i = 0; i < SIZEOF_ARRAY(branch_sweep_sites); i++) {
+			len = (size_t)snprintf(line, sizeof(line), "%6zu", branch_sweep_sites[i]);
+			for (j = 0; j < SIZEOF_ARRAY(branch_sweep_periods); j++)
+				len += (size_t)snprintf(line + len, sizeof(line) - len, " %8.2f", miss[i][j]);
+			pr_inf("%s: %s\n", args->name, line);
+		}
+	} else {
+		pr_inf("%s: cannot open perf branch miss counter, mispredict "
+			"rates will not be reported\n", args->name);
+	}
+	pr_inf("%s: nanosecs per site branch by sites (rows) and pattern period (columns):\n",
+		args->name);
+	len = (size_t)snprintf(line, sizeof(line), "%6s", "sites");
+	for (j = 0; j < SIZEOF_ARRAY(branch_sweep_periods); j++)
+		len += (size_t)snprintf(line + len, sizeof(line) - len, " %8zu", branch_sweep_periods[j]);
+	pr_inf("%s: %s\n", args->name, line);
+	for (i = 0; i < SIZEOF_ARRAY(branch_sweep_sites); i++) {
+		len = (size_t)snprintf(line, sizeof(line), "%6zu", branch_sweep_sites[i]);
+		for (j = 0; j < SIZEOF_ARRAY(branch_sweep_periods); j++)
+			len += (size_t)snprintf(line + len, sizeof(line) - len, " %8.3f", ns[i][j]);
+		pr_inf("%s: %s\n", args->name, line);
+	}
+	pr_block_end();
+
+close_counters:
+#if defined(STRESS_PERF_STATS)
+	if (have_counters)
+		stress_perf_counters_close(&pc);
+#endif
+	return;
+}
+
 /*
  *  stress_branch()
  *	stress instruction branch prediction
@@ -208,6 +438,9 @@ static int OPTIMIZE3 stress_branch(stress_args_t *args)
 	register uint32_t seed = 123456789;
 	register uint32_t idx = (seed >> 22);
 	register const void *label_next = labels[idx];
+	bool branch_sweep = false;
+
+	(void)stress_get_setting("branch-sweep", &branch_sweep);
 
 	for (i = 0; i < SIZEOF_ARRAY(counters); i++)
 		counters[i] = 0ULL;
@@ -216,6 +449,9 @@ static int OPTIMIZE3 stress_branch(stress_args_t *args)
 	stress_sync_start_wait(args);
 	stress_set_proc_state(args->name, STRESS_STATE_RUN);
 
+	if (branch_sweep && (args->instance == 0))
+		stress_branch_sweep(args);
+
 	for (;;) {
 L0x000:
 		stress_bogo_inc(args);
@@ -401,6 +637,7 @@ L0x000:
 const stressor_info_t stress_branch_info = {
 	.stressor = stress_branch,
 	.class = CLASS_CPU,
+	.opts = opts,
 	.verify = VERIFY_ALWAYS,
 	.help = help
 };
@@ -408,6 +645,7 @@ const stressor_info_t stress_branch_info = {
 const stressor_info_t stress_branch_info = {
 	.stressor = stress_unimplemented,
 	.class = CLASS_CPU,
+	.opts = opts,
 	.verify = VERIFY_ALWAYS,
 	.help = help,
 	.unimplemented_reason = "built without compiler support gcc style 'labels as values' feature"
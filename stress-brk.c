@@ -292,5 +292,6 @@ const stressor_info_t stress_brk_info = {
 	.class = CLASS_OS | CLASS_VM,
 	.opts = opts,
 	.verify = VERIFY_ALWAYS,
+	.metrics_max = 2,
 	.help = help
 };
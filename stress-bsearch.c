@@ -18,6 +18,7 @@
  *
  */
 #include "stress-ng.h"
+#include "core-cpu-cache.h"
 #include "core-shim.h"
 #include "core-sort.h"
 
@@ -28,9 +29,17 @@
 typedef void * (*bsearch_func_t)(const void *key, const void *base, size_t nmemb, size_t size,
 			       int (*compare)(const void *p1, const void *p2));
 
+/*
+ *  int32 searches inline the key comparison so they can be branchless,
+ *  they search either the sorted data or its Eytzinger layout
+ */
+typedef const int32_t * (*bsearch_int32_func_t)(const int32_t key, const int32_t *base, const size_t n);
+
 typedef struct {
 	const char *name;
-	const bsearch_func_t bsearch_func;
+	const bsearch_func_t bsearch_func;		/* generic compare based search */
+	const bsearch_int32_func_t bsearch_int32_func;	/* int32 search, used if bsearch_func is NULL */
+	const bool eytzinger;				/* int32 search needs Eytzinger layout */
 } stress_bsearch_method_t;
 
 #define MIN_BSEARCH_SIZE	(1 * KB)
@@ -39,7 +48,7 @@ typedef struct {
 
 static const stress_help_t help[] = {
 	{ NULL,	"bsearch N",	  	"start N workers that exercise a binary search" },
-	{ NULL,	"bsearch-method M",	"select bsearch method [ bsearch-libc | bsearch-nonlibc ]" },
+	{ NULL,	"bsearch-method M",	"select bsearch method [ bsearch-libc | bsearch-nonlibc | ternary | branchless | eytzinger ]" },
 	{ NULL,	"bsearch-ops N",  	"stop after N binary search bogo operations" },
 	{ NULL,	"bsearch-size N", 	"number of 32 bit integers to bsearch" },
 	{ NULL,	NULL,			NULL }
@@ -110,12 +119,83 @@ static void OPTIMIZE3 * bsearch_ternary(
 	return NULL;
 }
 
+/*
+ *  bsearch_branchless()
+ *	search sorted data, the compare selects the next base with a
+ *	conditional move rather than a branch, the loop trip count only
+ *	depends on n so there are no data dependent mispredicts
+ */
+static const int32_t OPTIMIZE3 * bsearch_branchless(
+	const int32_t key,
+	const int32_t *base,
+	const size_t n)
+{
+	register const int32_t *ptr = base;
+	register size_t len = n;
+
+	if (UNLIKELY(len == 0))
+		return NULL;
+	while (len > 1) {
+		register const size_t half = len >> 1;
+
+		ptr = (ptr[half] <= key) ? ptr + half : ptr;
+		len -= half;
+	}
+	return (*ptr == key) ? ptr : NULL;
+}
+
+/*
+ *  bsearch_eytzinger_layout()
+ *	lay out the n sorted items in Eytzinger (breadth first) order,
+ *	node k has children 2k and 2k + 1, element 0 is not used
+ */
+static size_t bsearch_eytzinger_layout(
+	int32_t *eytzinger,
+	const int32_t *sorted,
+	const size_t n,
+	size_t i,
+	const size_t k)
+{
+	if (k <= n) {
+		i = bsearch_eytzinger_layout(eytzinger, sorted, n, i, k << 1);
+		eytzinger[k] = sorted[i++];
+		i = bsearch_eytzinger_layout(eytzinger, sorted, n, i, (k << 1) + 1);
+	}
+	return i;
+}
+
+/*
+ *  bsearch_eytzinger()
+ *	branchless search of an Eytzinger layout, the 4 grandchildren of
+ *	node k are contiguous at 4k so they are prefetched while node k is
+ *	compared. The path taken is encoded in k, the last right turn is
+ *	undone by shifting out the trailing ones and the final zero.
+ */
+static const int32_t OPTIMIZE3 * bsearch_eytzinger(
+	const int32_t key,
+	const int32_t *base,
+	const size_t n)
+{
+	register size_t k = 1;
+
+	while (k <= n) {
+		shim_builtin_prefetch(base + (k << 2));
+		k = (k << 1) + (size_t)(base[k] < key);
+	}
+	while (k & 1)
+		k >>= 1;
+	k >>= 1;
+	return (k && (base[k] == key)) ? base + k : NULL;
+}
+
 static const stress_bsearch_method_t stress_bsearch_methods[] = {
 #if defined(HAVE_BSEARCH)
-	{ "bsearch-libc",	bsearch },
+	{ "bsearch-libc",	bsearch,		NULL,			false },
 #endif
-	{ "bsearch-nonlibc",	bsearch_nonlibc },
-	{ "ternary",		bsearch_ternary },
+	{ "bsearch-nonlibc",	bsearch_nonlibc,	NULL,			false },
+	{ "ternary",		bsearch_ternary,	NULL,			false },
+	{ "branchless",		NULL,			bsearch_branchless,	false },
+	{ "eytzinger",		NULL,			bsearch_eytzinger,	true },
 };
 
 static const char *stress_bsearch_method(const size_t i)
@@ -129,15 +209,19 @@ static const char *stress_bsearch_method(const size_t i)
  */
 static int OPTIMIZE3 stress_bsearch(stress_args_t *args)
 {
-	int32_t *data, *ptr;
+	int32_t *data, *ptr, *search;
 	size_t n, n8, i, bsearch_method = 0, data_size;
 	uint64_t bsearch_size = DEFAULT_BSEARCH_SIZE;
 	double rate, duration = 0.0, count = 0.0, sorted = 0.0;
 	bsearch_func_t bsearch_func;
+	bsearch_int32_func_t bsearch_int32_func;
+	bool eytzinger;
 	int rc = EXIT_SUCCESS;
 
 	(void)stress_get_setting("bsearch-method", &bsearch_method);
 	bsearch_func = stress_bsearch_methods[bsearch_method].bsearch_func;
+	bsearch_int32_func = stress_bsearch_methods[bsearch_method].bsearch_int32_func;
+	eytzinger = stress_bsearch_methods[bsearch_method].eytzinger;
 
 	if (!stress_get_setting("bsearch-size", &bsearch_size)) {
 		if (g_opt_flags & OPT_FLAGS_MAXIMIZE)
@@ -148,6 +232,9 @@ static int OPTIMIZE3 stress_bsearch(stress_args_t *args)
 	n = (size_t)bsearch_size;
 	n8 = (n + 7) & ~7UL;
 	data_size = n8 * sizeof(*data);
+	/* Eytzinger layout follows the sorted data, it is 1 based */
+	if (eytzinger)
+		data_size += (n8 + 8) * sizeof(*data);
 
 	/* allocate in multiples of 8 */
 	data = (int32_t *)stress_mmap_populate(NULL,
@@ -159,6 +246,7 @@ static int OPTIMIZE3 stress_bsearch(stress_args_t *args)
 		return EXIT_NO_RESOURCE;
 	}
 	stress_set_vma_anon_name(data, data_size, "bsearch-data");
+	search = eytzinger ? data + n8 : data;
 
 	stress_set_proc_state(args->name, STRESS_STATE_SYNC_WAIT);
 	stress_sync_start_wait(args);
@@ -168,12 +256,17 @@ static int OPTIMIZE3 stress_bsearch(stress_args_t *args)
 		double t;
 
 		stress_sort_data_int32_init(data, n);
+		if (eytzinger)
+			(void)bsearch_eytzinger_layout(search, data, n, 0, 1);
 		stress_sort_compare_reset();
 		t = stress_time_now();
 		for (ptr = data, i = 0; i < n; i++, ptr++) {
-			int32_t *result;
+			const int32_t *result;
 
-			result = bsearch_func(ptr, data, n, sizeof(*ptr), stress_sort_cmp_fwd_int32);
+			if (bsearch_func)
+				result = bsearch_func(ptr, data, n, sizeof(*ptr), stress_sort_cmp_fwd_int32);
+			else
+				result = bsearch_int32_func(*ptr, search, n);
 			if (g_opt_flags & OPT_FLAGS_VERIFY) {
 				if (result == NULL)
 					pr_fail("%s: element %zu could not be found\n",
@@ -196,11 +289,17 @@ static int OPTIMIZE3 stress_bsearch(stress_args_t *args)
 
 	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
 
-	rate = (duration > 0.0) ? count / duration : 0.0;
-	stress_metrics_set(args, 0, "bsearch comparisons per sec",
-		rate, STRESS_METRIC_HARMONIC_MEAN);
-	stress_metrics_set(args, 1, "bsearch comparisons per item",
-		count / sorted, STRESS_METRIC_HARMONIC_MEAN);
+	/* int32 searches inline the compare so comparisons are not counted */
+	if (bsearch_func) {
+		rate = (duration > 0.0) ? count / duration : 0.0;
+		stress_metrics_set(args, 0, "bsearch comparisons per sec",
+			rate, STRESS_METRIC_HARMONIC_MEAN);
+		stress_metrics_set(args, 1, "bsearch comparisons per item",
+			count / sorted, STRESS_METRIC_HARMONIC_MEAN);
+	}
+	rate = (sorted > 0.0) ? (duration * STRESS_DBL_NANOSECOND) / sorted : 0.0;
+	stress_metrics_set(args, bsearch_func ? 2 : 0, "nanosecs per lookup",
+		rate, STRESS_METRIC_GEOMETRIC_MEAN);
 
 	(void)munmap((void *)data, data_size);
 	return rc;
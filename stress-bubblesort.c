@@ -321,5 +321,6 @@ const stressor_info_t stress_bubblesort_info = {
 	.class = CLASS_CPU_CACHE | CLASS_CPU | CLASS_MEMORY | CLASS_SORT,
 	.opts = opts,
 	.verify = VERIFY_OPTIONAL,
+	.metrics_max = 2,
 	.help = help
 };
@@ -28,6 +28,10 @@
 
 #define DEFAULT_L1_SIZE		(64)
 
+#define C2C_ROUNDS		(10000)	/* timed transfers per CPU pair per pass */
+#define C2C_WARMUP		(1000)	/* untimed transfers after re-pinning */
+#define C2C_TABLE_CPUS		(64)	/* largest matrix printed as a table */
+
 #if defined(HAVE_ATOMIC_FETCH_ADD) &&	\
     defined(__ATOMIC_RELAXED)
 #define SHIM_ATOMIC_INC(ptr)       \
@@ -47,6 +51,7 @@ do {				\
 static const stress_help_t help[] = {
 	{ NULL,	"cacheline N",		"start N workers that exercise cachelines" },
 	{ NULL,	"cacheline-affinity",	"modify CPU affinity" },
+	{ NULL,	"cacheline-c2c",	"measure cacheline transfer latency between every pair of CPUs" },
 	{ NULL,	"cacheline-method M",	"use cacheline stressing method M" },
 	{ NULL,	"cacheline-ops N",	"stop after N cacheline bogo operations" },
 	{ NULL,	NULL,			NULL }
@@ -699,6 +704,308 @@ static int stress_cacheline_next_idx(void)
 	return ret * 2;
 }
 
+#if defined(HAVE_ATOMIC_COMPARE_EXCHANGE) &&	\
+    defined(HAVE_ATOMIC_LOAD) &&		\
+    defined(HAVE_ATOMIC_STORE) &&		\
+    defined(HAVE_SCHED_GETAFFINITY) &&		\
+    defined(HAVE_SCHED_SETAFFINITY)
+#define STRESS_CACHELINE_C2C
+
+/*
+ *  c2c mode shared state, the bounced line and the control
+ *  line are kept on separate (double) cachelines
+ */
+typedef struct {
+	uint64_t seq ALIGNED(128);	/* line bounced between the two CPUs */
+	uint32_t gen ALIGNED(128);	/* pair generation, bumped by the pinger */
+	uint32_t ready;			/* generation the ponger is pinned for */
+	int32_t cpu;			/* CPU the ponger pins to */
+	bool stop;			/* ponger exit request */
+} stress_c2c_t;
+
+/*
+ *  stress_cacheline_c2c_spin()
+ *	compare-exchange *seq from expected to expected + 1, spinning
+ *	until the other CPU has moved it to expected, returns false
+ *	if the stressor is stopping
+ */
+static inline bool OPTIMIZE3 stress_cacheline_c2c_spin(
+	uint64_t *seq,
+	const uint64_t expected)
+{
+	uint32_t spins = 0;
+
+	for (;;) {
+		uint64_t val = expected;
+
+		if (LIKELY(__atomic_compare_exchange_n(seq, &val, expected + 1,
+				false, __ATOMIC_ACQ_REL, __ATOMIC_RELAXED)))
+			return true;
+		/* avoid live lock if the other end is preempted */
+		if (UNLIKELY(++spins >= 0x10000)) {
+			spins = 0;
+			(void)shim_sched_yield();
+			if (!stress_continue_flag())
+				return false;
+		}
+	}
+}
+
+/*
+ *  stress_cacheline_c2c_ponger()
+ *	child, pin to the CPU of each new pair and bounce the
+ *	line back on every odd sequence number
+ */
+static void stress_cacheline_c2c_ponger(stress_c2c_t *c2c)
+{
+	uint32_t gen = 0;
+
+	stress_parent_died_alarm();
+
+	for (;;) {
+		uint32_t i, next, spins = 0;
+
+		while ((next = __atomic_load_n(&c2c->gen, __ATOMIC_ACQUIRE)) == gen) {
+			if (__atomic_load_n(&c2c->stop, __ATOMIC_ACQUIRE) || !stress_continue_flag())
+				return;
+			if (++spins >= 1024) {
+				spins = 0;
+				(void)shim_sched_yield();
+			}
+		}
+		gen = next;
+		stress_placement_set(c2c->cpu);
+		__atomic_store_n(&c2c->ready, gen, __ATOMIC_RELEASE);
+
+		for (i = 0; i < C2C_WARMUP + C2C_ROUNDS; i++) {
+			if (UNLIKELY(!stress_cacheline_c2c_spin(&c2c->seq, ((uint64_t)i * 2) + 1)))
+				return;
+		}
+	}
+}
+
+/*
+ *  stress_cacheline_c2c_pair()
+ *	bounce the line to the ponger on cpu and back, returns
+ *	nanoseconds per one-way transfer or < 0 if stopped
+ */
+static double OPTIMIZE3 stress_cacheline_c2c_pair(stress_c2c_t *c2c, const int32_t cpu)
+{
+	uint32_t i, gen;
+	double t = 0.0;
+
+	__atomic_store_n(&c2c->seq, 0, __ATOMIC_RELAXED);
+	c2c->cpu = cpu;
+	gen = __atomic_add_fetch(&c2c->gen, 1, __ATOMIC_ACQ_REL);
+	while (__atomic_load_n(&c2c->ready, __ATOMIC_ACQUIRE) != gen) {
+		if (UNLIKELY(!stress_continue_flag()))
+			return -1.0;
+		(void)shim_sched_yield();
+	}
+
+	for (i = 0; i < C2C_WARMUP + C2C_ROUNDS; i++) {
+		if (UNLIKELY(i == C2C_WARMUP))
+			t = stress_time_now();
+		if (UNLIKELY(!stress_cacheline_c2c_spin(&c2c->seq, (uint64_t)i * 2)))
+			return -1.0;
+	}
+	/* wait for the final transfer back */
+	while (__atomic_load_n(&c2c->seq, __ATOMIC_ACQUIRE) != (uint64_t)i * 2)
+		;
+	t = stress_time_now() - t;
+
+	return (t * STRESS_NANOSECOND) / (2.0 * (double)C2C_ROUNDS);
+}
+
+/*
+ *  stress_cacheline_c2c_table()
+ *	log the matrix of best transfer times as a table
+ */
+static void stress_cacheline_c2c_table(
+	stress_args_t *args,
+	const uint32_t *cpus,
+	const uint32_t n,
+	const double *best)
+{
+	char *line;
+	const size_t line_len = 8 + ((size_t)n * 16);
+	uint32_t i, j;
+
+	line = (char *)malloc(line_len);
+	if (!line)
+		return;
+
+	pr_inf("%s: cacheline transfer latency (nanosecs, best of all passes):\n", args->name);
+	(void)snprintf(line, line_len, "%6s", "cpu");
+	for (j = 0; j < n; j++)
+		(void)snprintf(line + strlen(line), line_len - strlen(line), " %6" PRIu32, cpus[j]);
+	pr_inf("%s: %s\n", args->name, line);
+
+	for (i = 0; i < n; i++) {
+		(void)snprintf(line, line_len, "%6" PRIu32, cpus[i]);
+		for (j = 0; j < n; j++) {
+			const uint32_t lo = STRESS_MINIMUM(i, j), hi = STRESS_MAXIMUM(i, j);
+			/* upper triangle index of pair lo, hi with lo < hi */
+			const size_t k = ((size_t)lo * ((2 * (size_t)n) - lo - 1)) / 2 + (hi - lo - 1);
+
+			if (i == j)
+				(void)snprintf(line + strlen(line), line_len - strlen(line), " %6s", "-");
+			else if (best[k] == 0.0)
+				(void)snprintf(line + strlen(line), line_len - strlen(line), " %6s", "?");
+			else
+				(void)snprintf(line + strlen(line), line_len - strlen(line), " %6.1f", best[k]);
+		}
+		pr_inf("%s: %s\n", args->name, line);
+	}
+	free(line);
+}
+
+/*
+ *  stress_cacheline_c2c()
+ *	like c2clat, pin two processes to each pair of CPUs in turn
+ *	and bounce a cacheline between them with compare-exchange,
+ *	repeating over all pairs until the run ends
+ */
+static int stress_cacheline_c2c(stress_args_t *args)
+{
+	stress_c2c_t *c2c;
+	uint32_t *cpus = NULL, n_cpus, n, i, j, k, n_pairs, reported = 0;
+	double *best = NULL, class_ns[STRESS_CPU_DISTANCE_UNKNOWN + 1], sum = 0.0;
+	uint64_t class_n[STRESS_CPU_DISTANCE_UNKNOWN + 1], sum_n = 0;
+	size_t idx;
+	pid_t pid;
+	int rc = EXIT_SUCCESS;
+
+	n_cpus = stress_get_usable_cpus(&cpus, true);
+	/* drop offline or otherwise disallowed CPUs */
+	for (n = 0, i = 0; i < n_cpus; i++) {
+		stress_placement_set((int32_t)cpus[i]);
+		if (stress_get_cpu() == cpus[i])
+			cpus[n++] = cpus[i];
+	}
+	n_pairs = (n * (n - 1)) / 2;
+	if ((n < 2) || (n_pairs == 0)) {
+		if (args->instance == 0)
+			pr_inf_skip("%s: --cacheline-c2c needs at least 2 usable CPUs, skipping stressor\n",
+				args->name);
+		stress_free_usable_cpus(&cpus);
+		return EXIT_NO_RESOURCE;
+	}
+	best = (double *)calloc(n_pairs, sizeof(*best));
+	c2c = (stress_c2c_t *)stress_mmap_populate(NULL, sizeof(*c2c),
+		PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+	if (!best || (c2c == MAP_FAILED)) {
+		pr_inf_skip("%s: cannot allocate %" PRIu32 " CPU pair results, skipping stressor\n",
+			args->name, n_pairs);
+		if (c2c != MAP_FAILED)
+			(void)munmap((void *)c2c, sizeof(*c2c));
+		free(best);
+		stress_free_usable_cpus(&cpus);
+		return EXIT_NO_RESOURCE;
+	}
+	stress_set_vma_anon_name(c2c, sizeof(*c2c), "c2c-cacheline");
+	(void)shim_memset((void *)c2c, 0, sizeof(*c2c));
+	pr_dbg("%s: measuring %" PRIu32 " CPU pairs of %" PRIu32 " CPUs\n",
+		args->name, n_pairs, n);
+
+	stress_set_proc_state(args->name, STRESS_STATE_SYNC_WAIT);
+	stress_sync_start_wait(args);
+	stress_set_proc_state(args->name, STRESS_STATE_RUN);
+again:
+	pid = fork();
+	if (pid < 0) {
+		if (stress_redo_fork(args, errno))
+			goto again;
+		if (UNLIKELY(!stress_continue(args)))
+			goto finish;
+		pr_err("%s: fork failed: errno=%d: (%s)\n",
+			args->name, errno, strerror(errno));
+		rc = EXIT_NO_RESOURCE;
+		goto finish;
+	} else if (pid == 0) {
+		stress_cacheline_c2c_ponger(c2c);
+		_exit(EXIT_SUCCESS);
+	}
+
+	do {
+		for (k = 0, i = 0; i < n; i++) {
+			stress_placement_set((int32_t)cpus[i]);
+			for (j = i + 1; j < n; j++, k++) {
+				const double ns = stress_cacheline_c2c_pair(c2c, (int32_t)cpus[j]);
+
+				if (UNLIKELY(ns < 0.0))
+					goto stop;
+				if ((best[k] == 0.0) || (ns < best[k]))
+					best[k] = ns;
+				stress_bogo_add(args, 2 * C2C_ROUNDS);
+				if (UNLIKELY(!stress_continue(args)))
+					goto stop;
+			}
+		}
+	} while (stress_continue(args));
+stop:
+	__atomic_store_n(&c2c->stop, true, __ATOMIC_RELEASE);
+	if (stress_kill_and_wait(args, pid, SIGALRM, false) != EXIT_SUCCESS)
+		rc = EXIT_FAILURE;
+
+	/* per distance averages first, then as many pairs as there are metrics */
+	for (i = 0; i <= STRESS_CPU_DISTANCE_UNKNOWN; i++) {
+		class_ns[i] = 0.0;
+		class_n[i] = 0;
+	}
+	for (k = 0, i = 0; i < n; i++) {
+		for (j = i + 1; j < n; j++, k++) {
+			const stress_cpu_distance_t d = stress_cpu_distance((int32_t)cpus[i], (int32_t)cpus[j]);
+
+			if (best[k] == 0.0)
+				continue;
+			class_ns[d] += best[k];
+			class_n[d]++;
+			sum += best[k];
+			sum_n++;
+		}
+	}
+	stress_metrics_set(args, 0, "nanosecs per cacheline transfer",
+		sum_n ? sum / (double)sum_n : 0.0, STRESS_METRIC_HARMONIC_MEAN);
+	idx = 1;
+	for (i = 0; i <= STRESS_CPU_DISTANCE_UNKNOWN; i++) {
+		char msg[64];
+
+		if (!class_n[i])
+			continue;
+		(void)snprintf(msg, sizeof(msg), "%s nsec per transfer",
+			stress_cpu_distance_name((stress_cpu_distance_t)i));
+		stress_metrics_set(args, idx++, msg,
+			class_ns[i] / (double)class_n[i], STRESS_METRIC_HARMONIC_MEAN);
+	}
+	for (k = 0, i = 0; (i < n) && (idx < STRESS_MISC_METRICS_MAX); i++) {
+		for (j = i + 1; (j < n) && (idx < STRESS_MISC_METRICS_MAX); j++, k++) {
+			char msg[64];
+
+			(void)snprintf(msg, sizeof(msg), "c2c cpu %" PRIu32 " to %" PRIu32 " nsec",
+				cpus[i], cpus[j]);
+			stress_metrics_set(args, idx++, msg, best[k], STRESS_METRIC_HARMONIC_MEAN);
+			reported++;
+		}
+	}
+	if (args->instance == 0) {
+		if (n <= C2C_TABLE_CPUS)
+			stress_cacheline_c2c_table(args, cpus, n, best);
+		if (reported < n_pairs)
+			pr_inf("%s: only the first %" PRIu32 " of %" PRIu32 " CPU pairs are "
+				"reported as metrics\n", args->name, reported, n_pairs);
+	}
+
+finish:
+	(void)munmap((void *)c2c, sizeof(*c2c));
+	free(best);
+	stress_free_usable_cpus(&cpus);
+	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
+
+	return rc;
+}
+#endif
+
 /*
  *  stress_cacheline()
  *	exercise a cacheline by multiple processes
@@ -712,10 +1019,22 @@ static int stress_cacheline(stress_args_t *args)
 	size_t cacheline_method = 0;
 	stress_cacheline_func func;
 	bool cacheline_affinity = false;
+	bool cacheline_c2c = false;
 
 	if (stress_sigchld_set_handler(args) < 0)
 		return EXIT_NO_RESOURCE;
 
+	(void)stress_get_setting("cacheline-c2c", &cacheline_c2c);
+	if (cacheline_c2c) {
+#if defined(STRESS_CACHELINE_C2C)
+		return stress_cacheline_c2c(args);
+#else
+		if (args->instance == 0)
+			pr_inf("%s: --cacheline-c2c needs atomic compare-exchange and "
+				"CPU affinity support, ignoring it\n", args->name);
+#endif
+	}
+
 	if (!g_shared->cacheline.lock) {
 		pr_inf("%s: failed to initialized cacheline lock, skipping stressor\n", args->name);
 		return EXIT_NO_RESOURCE;
@@ -772,6 +1091,7 @@ finish:
 
 static const stress_opt_t opts[] = {
 	{ OPT_cacheline_affinity, "cacheline-affinity", TYPE_ID_BOOL, 0, 1, NULL },
+	{ OPT_cacheline_c2c,      "cacheline-c2c",      TYPE_ID_BOOL, 0, 1, NULL },
 	{ OPT_cacheline_method,   "cacheline-method",   TYPE_ID_SIZE_T_METHOD, 0, 0, stress_cacheline_method },
 	END_OPT,
 };
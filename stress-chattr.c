@@ -426,6 +426,7 @@ const stressor_info_t stress_chattr_info = {
 	.stressor = stress_chattr,
 	.class = CLASS_FILESYSTEM | CLASS_OS,
 	.verify = VERIFY_ALWAYS,
+	.metrics_max = 1,
 	.help = help
 };
 
@@ -298,5 +298,6 @@ const stressor_info_t stress_chdir_info = {
 	.class = CLASS_FILESYSTEM | CLASS_OS,
 	.opts = opts,
 	.verify = VERIFY_ALWAYS,
+	.metrics_max = 1,
 	.help = help
 };
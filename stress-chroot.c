@@ -513,6 +513,7 @@ const stressor_info_t stress_chroot_info = {
 	.supported = stress_chroot_supported,
 	.class = CLASS_OS,
 	.verify = VERIFY_ALWAYS,
+	.metrics_max = 1,
 	.help = help
 };
 #else
@@ -648,6 +648,7 @@ const stressor_info_t stress_clone_info = {
 	.class = CLASS_SCHEDULER | CLASS_OS,
 	.opts = opts,
 	.verify = VERIFY_ALWAYS,
+	.metrics_max = 1,
 	.help = help
 };
 #else
@@ -514,6 +514,7 @@ const stressor_info_t stress_close_info = {
 	.stressor = stress_close,
 	.class = CLASS_OS,
 	.verify = VERIFY_ALWAYS,
+	.metrics_max = 1,
 	.help = help
 };
 #else
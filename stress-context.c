@@ -250,6 +250,7 @@ const stressor_info_t stress_context_info = {
 	.stressor = stress_context,
 	.class = CLASS_MEMORY | CLASS_CPU,
 	.verify = VERIFY_ALWAYS,
+	.metrics_max = 1,
 	.help = help
 };
 #else
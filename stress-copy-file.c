@@ -20,6 +20,16 @@
 #include "stress-ng.h"
 #include "core-builtin.h"
 
+#include <sys/ioctl.h>
+
+#if defined(HAVE_LINUX_FS_H)
+#include <linux/fs.h>
+#endif
+
+#if defined(HAVE_SYS_SENDFILE_H)
+#include <sys/sendfile.h>
+#endif
+
 #define MIN_COPY_FILE_BYTES	(128 * MB)
 #define MAX_COPY_FILE_BYTES	(MAX_FILE_LIMIT)
 #define DEFAULT_COPY_FILE_BYTES	(256 * MB)
@@ -28,13 +38,17 @@
 static const stress_help_t help[] = {
 	{ NULL,	"copy-file N",		"start N workers that copy file data" },
 	{ NULL,	"copy-file-bytes N",	"specify size of file to be copied" },
+	{ NULL,	"copy-file-cross-dir D", "directory on another file system for --copy-file-sweep" },
 	{ NULL,	"copy-file-ops N",	"stop after N copy bogo operations" },
+	{ NULL,	"copy-file-sweep",	"compare copy_file_range, reflink, sendfile, splice and read/write" },
 	{ NULL,	NULL,			NULL }
 
 };
 
 static const stress_opt_t opts[] = {
 	{ OPT_copy_file_bytes, "copy-file-bytes", TYPE_ID_UINT64_BYTES_FS, MIN_COPY_FILE_BYTES, MAX_COPY_FILE_BYTES, NULL },
+	{ OPT_copy_file_cross_dir, "copy-file-cross-dir", TYPE_ID_STR, 0, 0, NULL },
+	{ OPT_copy_file_sweep, "copy-file-sweep", TYPE_ID_BOOL, 0, 1, NULL },
 	END_OPT,
 };
 
@@ -42,6 +56,53 @@ static const stress_opt_t opts[] = {
 
 #define COPY_FILE_MAX_BUF_SIZE	(4096)
 
+#define COPY_SWEEP_BYTES	(32 * MB)	/* size of file copied per sweep step */
+#define COPY_SWEEP_CROSS_DIR	"/dev/shm"	/* default cross file system directory */
+
+#define COPY_SWEEP_CFR		(0)	/* copy_file_range */
+#define COPY_SWEEP_REFLINK	(1)	/* FICLONERANGE */
+#define COPY_SWEEP_SENDFILE	(2)	/* sendfile file to file */
+#define COPY_SWEEP_SPLICE	(3)	/* splice file to pipe to file */
+#define COPY_SWEEP_RW		(4)	/* read/write with a reused buffer */
+#define COPY_SWEEP_METHODS	(5)
+
+#define COPY_SWEEP_SAME_FS	(0)
+#define COPY_SWEEP_CROSS_FS	(1)
+#define COPY_SWEEP_TARGETS	(2)
+
+static const char * const stress_copy_sweep_methods[COPY_SWEEP_METHODS] = {
+	"copy_file_range",
+	"reflink",
+	"sendfile",
+	"splice",
+	"read-write",
+};
+
+static const char * const stress_copy_sweep_targets[COPY_SWEEP_TARGETS] = {
+	"same-fs",
+	"cross-fs",
+};
+
+static const size_t stress_copy_sweep_chunks[] = {
+	4 * KB, 64 * KB, 1 * MB, 16 * MB,
+};
+
+#define COPY_SWEEP_CHUNKS	(SIZEOF_ARRAY(stress_copy_sweep_chunks))
+
+typedef struct {
+	double bytes;		/* bytes copied */
+	double duration;	/* wall clock time */
+	double cpu;		/* user + system time */
+} stress_copy_sweep_stat_t;
+
+typedef struct {
+	int fd_in;		/* source file */
+	int fd_out[COPY_SWEEP_TARGETS];	/* destination files, -1 = no target */
+	int pipe_fds[2];	/* splice pipe */
+	size_t pipe_size;	/* splice pipe capacity */
+	uint8_t *buf;		/* read/write buffer, largest chunk size */
+} stress_copy_sweep_t;
+
 /*
  *  stress_copy_file_seek64()
  *	seek with off64_t
@@ -143,6 +204,394 @@ static int stress_copy_file_range_verify(
 	return 0;
 }
 
+/*
+ *  stress_copy_sweep_cpu_time()
+ *	user + system CPU time used by this process
+ */
+static double stress_copy_sweep_cpu_time(void)
+{
+	struct rusage usage;
+
+	if (shim_getrusage(RUSAGE_SELF, &usage) < 0)
+		return 0.0;
+	return (double)usage.ru_utime.tv_sec + ((double)usage.ru_utime.tv_usec / 1000000.0) +
+	       (double)usage.ru_stime.tv_sec + ((double)usage.ru_stime.tv_usec / 1000000.0);
+}
+
+/*
+ *  stress_copy_sweep_chunk()
+ *	copy len bytes at offset off from the source to fd_out using
+ *	a given method, returns bytes copied or -1 on failure
+ */
+static ssize_t stress_copy_sweep_chunk(
+	stress_copy_sweep_t *cs,
+	const int fd_out,
+	const size_t method,
+	const shim_off64_t off,
+	const size_t len)
+{
+	shim_off64_t off_in = off, off_out = off;
+	size_t done = 0;
+	ssize_t n;
+
+	switch (method) {
+	case COPY_SWEEP_CFR:
+		while (done < len) {
+			n = shim_copy_file_range(cs->fd_in, &off_in, fd_out, &off_out, len - done, 0);
+			if (n <= 0)
+				return -1;
+			done += (size_t)n;
+		}
+		return (ssize_t)done;
+	case COPY_SWEEP_REFLINK:
+#if defined(FICLONERANGE)
+		{
+			struct file_clone_range fcr;
+
+			fcr.src_fd = cs->fd_in;
+			fcr.src_offset = (uint64_t)off;
+			fcr.src_length = (uint64_t)len;
+			fcr.dest_offset = (uint64_t)off;
+			if (ioctl(fd_out, FICLONERANGE, &fcr) < 0)
+				return -1;
+			return (ssize_t)len;
+		}
+#else
+		errno = ENOSYS;
+		return -1;
+#endif
+	case COPY_SWEEP_SENDFILE:
+#if defined(HAVE_SENDFILE) &&	\
+    defined(HAVE_SYS_SENDFILE_H)
+		{
+			off_t off_sf = (off_t)off;
+
+			if (lseek(fd_out, (off_t)off, SEEK_SET) < 0)
+				return -1;
+			while (done < len) {
+				n = sendfile(fd_out, cs->fd_in, &off_sf, len - done);
+				if (n <= 0)
+					return -1;
+				done += (size_t)n;
+			}
+			return (ssize_t)done;
+		}
+#else
+		errno = ENOSYS;
+		return -1;
+#endif
+	case COPY_SWEEP_SPLICE:
+#if defined(HAVE_SPLICE) &&	\
+    defined(SPLICE_F_MOVE)
+		while (done < len) {
+			const size_t sz = STRESS_MINIMUM(len - done, cs->pipe_size);
+			size_t piped;
+
+			n = splice(cs->fd_in, &off_in, cs->pipe_fds[1], NULL, sz, SPLICE_F_MOVE);
+			if (n <= 0)
+				return -1;
+			piped = (size_t)n;
+			while (piped > 0) {
+				n = splice(cs->pipe_fds[0], NULL, fd_out, &off_out, piped, SPLICE_F_MOVE);
+				if (n <= 0)
+					return -1;
+				piped -= (size_t)n;
+				done += (size_t)n;
+			}
+		}
+		return (ssize_t)done;
+#else
+		errno = ENOSYS;
+		return -1;
+#endif
+	case COPY_SWEEP_RW:
+		while (done < len) {
+			n = pread(cs->fd_in, cs->buf, len - done, (off_t)(off + (shim_off64_t)done));
+			if (n <= 0)
+				return -1;
+			if (pwrite(fd_out, cs->buf, (size_t)n, (off_t)(off + (shim_off64_t)done)) != n)
+				return -1;
+			done += (size_t)n;
+		}
+		return (ssize_t)done;
+	default:
+		errno = EINVAL;
+		return -1;
+	}
+}
+
+/*
+ *  stress_copy_sweep_file()
+ *	copy the whole source file to fd_out in chunk sized pieces,
+ *	returns 0 on success or -1 on failure
+ */
+static int stress_copy_sweep_file(
+	stress_copy_sweep_t *cs,
+	const int fd_out,
+	const size_t method,
+	const size_t chunk,
+	const size_t file_size)
+{
+	shim_off64_t off;
+
+	for (off = 0; off < (shim_off64_t)file_size; off += (shim_off64_t)chunk) {
+		const size_t len = STRESS_MINIMUM(chunk, file_size - (size_t)off);
+
+		if (stress_copy_sweep_chunk(cs, fd_out, method, off, len) != (ssize_t)len)
+			return -1;
+	}
+	return 0;
+}
+
+/*
+ *  stress_copy_sweep_verify()
+ *	check the destination file matches the source file
+ */
+static int stress_copy_sweep_verify(stress_copy_sweep_t *cs, const int fd_out, const size_t file_size)
+{
+	uint8_t buf_out[COPY_FILE_MAX_BUF_SIZE];
+	size_t off;
+
+	for (off = 0; off < file_size; off += COPY_FILE_MAX_BUF_SIZE) {
+		const size_t len = STRESS_MINIMUM(COPY_FILE_MAX_BUF_SIZE, file_size - off);
+
+		if (pread(cs->fd_in, cs->buf, len, (off_t)off) != (ssize_t)len)
+			return -1;
+		if (pread(fd_out, buf_out, len, (off_t)off) != (ssize_t)len)
+			return -1;
+		if (shim_memcmp(cs->buf, buf_out, len))
+			return -1;
+	}
+	return 0;
+}
+
+/*
+ *  stress_copy_sweep_open()
+ *	create an unlinked file in directory dir, returns fd or -1
+ */
+static int stress_copy_sweep_open(stress_args_t *args, const char *dir, const char *suffix)
+{
+	char filename[PATH_MAX];
+	int fd;
+
+	(void)snprintf(filename, sizeof(filename), "%s/%s-%" PRIdMAX "-%" PRIu32 "-%s",
+		dir, args->name, (intmax_t)args->pid, args->instance, suffix);
+	fd = open(filename, O_CREAT | O_RDWR | O_TRUNC, S_IRUSR | S_IWUSR);
+	if (fd >= 0)
+		(void)shim_unlink(filename);
+	return fd;
+}
+
+/*
+ *  stress_copy_file_sweep()
+ *	compare copy_file_range, FICLONERANGE reflinks, sendfile, splice
+ *	and read/write copy throughput and CPU cost over a range of chunk
+ *	sizes to a file on the same and on another file system
+ */
+static int stress_copy_file_sweep(stress_args_t *args)
+{
+	stress_copy_sweep_t cs;
+	stress_copy_sweep_stat_t *stats;
+	bool supported[COPY_SWEEP_TARGETS][COPY_SWEEP_METHODS];
+	const bool verify = !!(g_opt_flags & OPT_FLAGS_VERIFY);
+	const char *cross_dir = COPY_SWEEP_CROSS_DIR;
+	const size_t file_size = COPY_SWEEP_BYTES;
+	char tmp_dir[PATH_MAX];
+	struct stat statbuf_tmp, statbuf_cross;
+	size_t target, method, i, idx;
+	int ret, rc = EXIT_SUCCESS;
+
+	(void)stress_get_setting("copy-file-cross-dir", &cross_dir);
+
+	(void)shim_memset(&cs, 0, sizeof(cs));
+	cs.fd_in = -1;
+	cs.fd_out[COPY_SWEEP_SAME_FS] = -1;
+	cs.fd_out[COPY_SWEEP_CROSS_FS] = -1;
+	cs.pipe_fds[0] = -1;
+	cs.pipe_fds[1] = -1;
+
+	stats = (stress_copy_sweep_stat_t *)calloc(COPY_SWEEP_TARGETS * COPY_SWEEP_METHODS * COPY_SWEEP_CHUNKS,
+						   sizeof(*stats));
+	cs.buf = (uint8_t *)malloc(stress_copy_sweep_chunks[COPY_SWEEP_CHUNKS - 1]);
+	if (!stats || !cs.buf) {
+		pr_inf_skip("%s: cannot allocate sweep buffers, skipping stressor\n", args->name);
+		free(cs.buf);
+		free(stats);
+		return EXIT_NO_RESOURCE;
+	}
+
+	ret = stress_temp_dir_mk_args(args);
+	if (ret < 0) {
+		free(cs.buf);
+		free(stats);
+		return stress_exit_status(-ret);
+	}
+	(void)stress_temp_dir_args(args, tmp_dir, sizeof(tmp_dir));
+
+	cs.fd_in = stress_copy_sweep_open(args, tmp_dir, "orig");
+	cs.fd_out[COPY_SWEEP_SAME_FS] = stress_copy_sweep_open(args, tmp_dir, "copy");
+	if ((cs.fd_in < 0) || (cs.fd_out[COPY_SWEEP_SAME_FS] < 0)) {
+		rc = stress_exit_status(errno);
+		pr_fail("%s: cannot create files in %s, errno=%d (%s)\n",
+			args->name, tmp_dir, errno, strerror(errno));
+		goto tidy;
+	}
+	if ((stat(tmp_dir, &statbuf_tmp) == 0) &&
+	    (stat(cross_dir, &statbuf_cross) == 0) &&
+	    (statbuf_tmp.st_dev != statbuf_cross.st_dev)) {
+		cs.fd_out[COPY_SWEEP_CROSS_FS] = stress_copy_sweep_open(args, cross_dir, "copy");
+	}
+	if ((cs.fd_out[COPY_SWEEP_CROSS_FS] < 0) && (args->instance == 0))
+		pr_inf("%s: cannot create a file on a different file system in %s, "
+			"skipping cross-fs copies\n", args->name, cross_dir);
+
+	for (i = 0; i < file_size; i += COPY_FILE_MAX_BUF_SIZE) {
+		stress_uint8rnd4(cs.buf, COPY_FILE_MAX_BUF_SIZE);
+		if (write(cs.fd_in, cs.buf, COPY_FILE_MAX_BUF_SIZE) != COPY_FILE_MAX_BUF_SIZE) {
+			pr_inf_skip("%s: cannot write %zu byte source file, errno=%d (%s)%s, "
+				"skipping stressor\n", args->name, file_size, errno,
+				strerror(errno), stress_get_fs_type(tmp_dir));
+			rc = EXIT_NO_RESOURCE;
+			goto tidy;
+		}
+	}
+	/* reflinks need the source extents on disk */
+	(void)shim_fsync(cs.fd_in);
+
+	if (pipe(cs.pipe_fds) == 0) {
+		cs.pipe_size = 64 * KB;
+#if defined(F_SETPIPE_SZ)
+		ret = fcntl(cs.pipe_fds[1], F_SETPIPE_SZ, (int)(1 * MB));
+		if (ret > 0)
+			cs.pipe_size = (size_t)ret;
+#endif
+	}
+
+	/* probe each method and target with a small copy */
+	for (target = 0; target < COPY_SWEEP_TARGETS; target++) {
+		for (method = 0; method < COPY_SWEEP_METHODS; method++) {
+			const int fd_out = cs.fd_out[target];
+
+			supported[target][method] = false;
+			if (fd_out < 0)
+				continue;
+			if ((method == COPY_SWEEP_SPLICE) && (cs.pipe_fds[0] < 0))
+				continue;
+			if (stress_copy_sweep_chunk(&cs, fd_out, method, 0, 4 * KB) == (ssize_t)(4 * KB)) {
+				supported[target][method] = true;
+			} else if (args->instance == 0) {
+				pr_inf("%s: %s %s not supported, errno=%d (%s)%s\n", args->name,
+					stress_copy_sweep_targets[target], stress_copy_sweep_methods[method],
+					errno, strerror(errno), stress_get_fs_type(target ? cross_dir : tmp_dir));
+			}
+			VOID_RET(int, ftruncate(fd_out, 0));
+		}
+	}
+
+	stress_set_proc_state(args->name, STRESS_STATE_SYNC_WAIT);
+	stress_sync_start_wait(args);
+	stress_set_proc_state(args->name, STRESS_STATE_RUN);
+
+	do {
+		for (target = 0; target < COPY_SWEEP_TARGETS; target++) {
+			const int fd_out = cs.fd_out[target];
+
+			for (method = 0; method < COPY_SWEEP_METHODS; method++) {
+				if (!supported[target][method])
+					continue;
+				for (i = 0; (i < COPY_SWEEP_CHUNKS) && stress_continue(args); i++) {
+					stress_copy_sweep_stat_t *stat =
+						&stats[(((target * COPY_SWEEP_METHODS) + method) * COPY_SWEEP_CHUNKS) + i];
+					double t, cpu;
+
+					VOID_RET(int, ftruncate(fd_out, 0));
+					cpu = stress_copy_sweep_cpu_time();
+					t = stress_time_now();
+					if (UNLIKELY(stress_copy_sweep_file(&cs, fd_out, method,
+							stress_copy_sweep_chunks[i], file_size) < 0)) {
+						if (errno == ENOSPC)
+							continue;
+						pr_fail("%s: %s %s copy with %zu byte chunks failed, errno=%d (%s)\n",
+							args->name, stress_copy_sweep_targets[target],
+							stress_copy_sweep_methods[method], stress_copy_sweep_chunks[i],
+							errno, strerror(errno));
+						rc = EXIT_FAILURE;
+						goto done;
+					}
+					stat->duration += stress_time_now() - t;
+					stat->cpu += stress_copy_sweep_cpu_time() - cpu;
+					stat->bytes += (double)file_size;
+
+					if (UNLIKELY(verify && (stress_copy_sweep_verify(&cs, fd_out, file_size) < 0))) {
+						pr_fail("%s: %s %s copy with %zu byte chunks does not match the source\n",
+							args->name, stress_copy_sweep_targets[target],
+							stress_copy_sweep_methods[method], stress_copy_sweep_chunks[i]);
+						rc = EXIT_FAILURE;
+						goto done;
+					}
+				}
+			}
+		}
+		stress_bogo_inc(args);
+	} while (stress_continue(args));
+done:
+	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
+
+	if (args->instance == 0)
+		pr_inf("%s: %-8s %-15s %6s %10s %12s\n", args->name,
+			"target", "method", "chunk", "GB/sec", "CPU secs/GB");
+	for (idx = 0, target = 0; target < COPY_SWEEP_TARGETS; target++) {
+		for (method = 0; method < COPY_SWEEP_METHODS; method++) {
+			for (i = 0; i < COPY_SWEEP_CHUNKS; i++) {
+				const stress_copy_sweep_stat_t *stat =
+					&stats[(((target * COPY_SWEEP_METHODS) + method) * COPY_SWEEP_CHUNKS) + i];
+				const double gb = stat->bytes / (double)GB;
+				double rate, cpu_per_gb;
+				char chunk_str[32], desc[64];
+
+				if ((stat->duration <= 0.0) || (gb <= 0.0))
+					continue;
+				rate = gb / stat->duration;
+				cpu_per_gb = stat->cpu / gb;
+				(void)stress_uint64_to_str(chunk_str, sizeof(chunk_str),
+					(uint64_t)stress_copy_sweep_chunks[i]);
+				if (args->instance == 0)
+					pr_inf("%s: %-8s %-15s %6s %10.3f %12.3f\n", args->name,
+						stress_copy_sweep_targets[target],
+						stress_copy_sweep_methods[method],
+						chunk_str, rate, cpu_per_gb);
+				if (i != COPY_SWEEP_CHUNKS - 1)
+					continue;
+				(void)snprintf(desc, sizeof(desc), "%s %s %s GB per sec",
+					stress_copy_sweep_targets[target],
+					stress_copy_sweep_methods[method], chunk_str);
+				stress_metrics_set(args, idx++, desc, rate, STRESS_METRIC_HARMONIC_MEAN);
+				(void)snprintf(desc, sizeof(desc), "%s %s %s CPU secs per GB",
+					stress_copy_sweep_targets[target],
+					stress_copy_sweep_methods[method], chunk_str);
+				stress_metrics_set(args, idx++, desc, cpu_per_gb, STRESS_METRIC_GEOMETRIC_MEAN);
+			}
+		}
+	}
+
+tidy:
+	if (cs.pipe_fds[0] >= 0)
+		(void)close(cs.pipe_fds[0]);
+	if (cs.pipe_fds[1] >= 0)
+		(void)close(cs.pipe_fds[1]);
+	for (target = 0; target < COPY_SWEEP_TARGETS; target++) {
+		if (cs.fd_out[target] >= 0)
+			(void)close(cs.fd_out[target]);
+	}
+	if (cs.fd_in >= 0)
+		(void)close(cs.fd_in);
+	(void)stress_temp_dir_rm_args(args);
+	free(cs.buf);
+	free(stats);
+
+	return rc;
+}
+
 /*
  *  stress_copy_file
  *	stress reading chunks of file using copy_file_range()
@@ -155,6 +604,11 @@ static int stress_copy_file(stress_args_t *args)
 	uint64_t copy_file_bytes = DEFAULT_COPY_FILE_BYTES;
 	double duration = 0.0, bytes = 0.0, rate;
 	const bool verify = !!(g_opt_flags & OPT_FLAGS_VERIFY);
+	bool copy_file_sweep = false;
+
+	(void)stress_get_setting("copy-file-sweep", &copy_file_sweep);
+	if (copy_file_sweep)
+		return stress_copy_file_sweep(args);
 
 	if (!stress_get_setting("copy-file-bytes", &copy_file_bytes)) {
 		if (g_opt_flags & OPT_FLAGS_MAXIMIZE)
@@ -324,6 +778,7 @@ const stressor_info_t stress_copy_file_info = {
 	.class = CLASS_FILESYSTEM | CLASS_OS,
 	.opts = opts,
 	.verify = VERIFY_OPTIONAL,
+	.metrics_max = COPY_SWEEP_TARGETS * COPY_SWEEP_METHODS * 2,
 	.help = help
 };
 #else
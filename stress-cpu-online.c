@@ -20,6 +20,7 @@
 #include "stress-ng.h"
 #include "core-builtin.h"
 #include "core-killpid.h"
+#include "core-latency.h"
 
 #include <sched.h>
 
@@ -27,20 +28,32 @@ static const stress_help_t help[] = {
 	{ NULL,	"cpu-online N",		"start N workers offlining/onlining the CPUs" },
 	{ NULL, "cpu-online-affinity",	"set CPU affinity to the CPU to be offlined" },
 	{ NULL, "cpu-online-all",	"attempt to exercise all CPUs include CPU 0" },
+	{ NULL, "cpu-online-latency",	"report per CPU offline, online and run latency percentiles" },
 	{ NULL,	"cpu-online-ops N",	"stop after N offline/online operations" },
 	{ NULL,	NULL,			NULL }
 };
 
 #define STRESS_CPU_ONLINE_MAX_CPUS	(65536)
+#define STRESS_CPU_ONLINE_RUN_TIMEOUT	(1000000000ULL)	/* 1 second in ns */
 
 static const stress_opt_t opts[] = {
 	{ OPT_cpu_online_affinity, "cpu-online-affinity", TYPE_ID_BOOL, 0, 1, NULL },
 	{ OPT_cpu_online_all,      "cpu-online-all",      TYPE_ID_BOOL, 0, 1, NULL },
+	{ OPT_cpu_online_latency,  "cpu-online-latency",  TYPE_ID_BOOL, 0, 1, NULL },
 	END_OPT,
 };
 
 #if defined(__linux__)
 
+/*
+ *  per CPU hotplug transition latencies, --cpu-online-latency
+ */
+typedef struct {
+	stress_latency_hist_t offline;	/* offline sysfs write time */
+	stress_latency_hist_t online;	/* online sysfs write time */
+	stress_latency_hist_t run;	/* online to pinned task running */
+} stress_cpu_online_latency_t;
+
 /*
  *  stress_cpu_online_set_affinity(const uint32_t cpu)
  *	try to set cpu affinity
@@ -129,6 +142,132 @@ static int stress_cpu_online_get(const uint32_t cpu, int *setting)
 }
 
 
+/*
+ *  stress_cpu_online_latency_get()
+ *	get latency histograms for a cpu, allocated on first use
+ *	as only the online/offline capable CPUs are ever exercised
+ */
+static stress_cpu_online_latency_t *stress_cpu_online_latency_get(
+	stress_cpu_online_latency_t **latencies,
+	const uint32_t cpu)
+{
+	stress_cpu_online_latency_t *lat;
+
+	if (!latencies)
+		return NULL;
+	if (latencies[cpu])
+		return latencies[cpu];
+
+	lat = (stress_cpu_online_latency_t *)malloc(sizeof(*lat));
+	if (!lat)
+		return NULL;
+	stress_latency_hist_init(&lat->offline);
+	stress_latency_hist_init(&lat->online);
+	stress_latency_hist_init(&lat->run);
+	latencies[cpu] = lat;
+	return lat;
+}
+
+/*
+ *  stress_cpu_online_run_latency()
+ *	time from a cpu being onlined until the stressor is pinned
+ *	to it and actually running on it, returns 0 on failure. The
+ *	original affinity is restored afterwards
+ */
+static uint64_t stress_cpu_online_run_latency(const uint32_t cpu, const uint64_t t_online)
+{
+#if defined(HAVE_SCHED_GETAFFINITY) &&	\
+    defined(HAVE_SCHED_SETAFFINITY)
+	cpu_set_t mask, old_mask;
+	uint64_t run_ns = 0;
+
+	if (sched_getaffinity(0, sizeof(old_mask), &old_mask) < 0)
+		return 0;
+	CPU_ZERO(&mask);
+	CPU_SET(cpu, &mask);
+	if (sched_setaffinity(0, sizeof(mask), &mask) < 0)
+		return 0;
+
+	for (;;) {
+		const uint64_t t = stress_latency_now();
+
+		if (stress_get_cpu() == cpu) {
+			run_ns = t - t_online;
+			break;
+		}
+		if ((t - t_online) > STRESS_CPU_ONLINE_RUN_TIMEOUT)
+			break;
+		(void)shim_sched_yield();
+	}
+	VOID_RET(int, sched_setaffinity(0, sizeof(old_mask), &old_mask));
+
+	return run_ns;
+#else
+	(void)cpu;
+	(void)t_online;
+
+	return 0;
+#endif
+}
+
+/*
+ *  stress_cpu_online_latency_report()
+ *	report per cpu hotplug latency percentiles and set the overall
+ *	p99 latencies as metrics
+ */
+static void stress_cpu_online_latency_report(
+	stress_args_t *args,
+	stress_cpu_online_latency_t **latencies,
+	const int32_t cpus)
+{
+	int32_t i;
+	stress_latency_hist_t *all;
+
+	all = (stress_latency_hist_t *)calloc(3, sizeof(*all));
+	if (!all)
+		return;
+	stress_latency_hist_init(&all[0]);
+	stress_latency_hist_init(&all[1]);
+	stress_latency_hist_init(&all[2]);
+
+	pr_block_begin();
+	pr_inf("%s: CPU hotplug latencies (timings in microsecs):\n", args->name);
+	pr_inf("%s: %5s %7s %9s %9s %9s %9s %9s %9s %9s %9s\n", args->name,
+		"CPU", "Cycles", "Off p50", "Off p99", "Off max",
+		"On p50", "On p99", "On max", "Run p50", "Run p99");
+	for (i = 0; i < cpus; i++) {
+		const stress_cpu_online_latency_t *lat = latencies[i];
+
+		if (!lat || (lat->online.count == 0))
+			continue;
+		pr_inf("%s: %5" PRId32 " %7" PRIu64 " %9.1f %9.1f %9.1f %9.1f %9.1f %9.1f %9.1f %9.1f\n",
+			args->name, i, lat->online.count,
+			(double)stress_latency_hist_percentile(&lat->offline, 50.0) / 1000.0,
+			(double)stress_latency_hist_percentile(&lat->offline, 99.0) / 1000.0,
+			(double)lat->offline.max_ns / 1000.0,
+			(double)stress_latency_hist_percentile(&lat->online, 50.0) / 1000.0,
+			(double)stress_latency_hist_percentile(&lat->online, 99.0) / 1000.0,
+			(double)lat->online.max_ns / 1000.0,
+			(double)stress_latency_hist_percentile(&lat->run, 50.0) / 1000.0,
+			(double)stress_latency_hist_percentile(&lat->run, 99.0) / 1000.0);
+		stress_latency_hist_merge(&all[0], &lat->offline);
+		stress_latency_hist_merge(&all[1], &lat->online);
+		stress_latency_hist_merge(&all[2], &lat->run);
+	}
+	pr_block_end();
+
+	stress_metrics_set(args, 2, "millisecs offline p99 latency",
+		(double)stress_latency_hist_percentile(&all[0], 99.0) / STRESS_DBL_MICROSECOND,
+		STRESS_METRIC_GEOMETRIC_MEAN);
+	stress_metrics_set(args, 3, "millisecs online p99 latency",
+		(double)stress_latency_hist_percentile(&all[1], 99.0) / STRESS_DBL_MICROSECOND,
+		STRESS_METRIC_GEOMETRIC_MEAN);
+	stress_metrics_set(args, 4, "microsecs online to run p99 latency",
+		(double)stress_latency_hist_percentile(&all[2], 99.0) / STRESS_DBL_MILLISECOND,
+		STRESS_METRIC_GEOMETRIC_MEAN);
+	free(all);
+}
+
 /*
  *  stress_cpu_online_supported()
  *      check if we can run this as root
@@ -165,6 +304,7 @@ static int stress_cpu_online(stress_args_t *args)
 	bool *cpu_online;
 	bool cpu_online_affinity = false;
 	bool cpu_online_all = false;
+	bool cpu_online_latency = false;
 	bool child_affinity = true;
 	int rc = EXIT_SUCCESS;
 	int fds[2];
@@ -172,9 +312,11 @@ static int stress_cpu_online(stress_args_t *args)
 	double offline_duration = 0.0, offline_count = 0.0;
 	double online_duration  = 0.0, online_count = 0.0;
 	double rate;
+	stress_cpu_online_latency_t **latencies = NULL;
 
 	(void)stress_get_setting("cpu-online-affinity", &cpu_online_affinity);
 	(void)stress_get_setting("cpu-online-all", &cpu_online_all);
+	(void)stress_get_setting("cpu-online-latency", &cpu_online_latency);
 
 	if (geteuid() != 0) {
 		if (args->instance == 0)
@@ -233,6 +375,13 @@ static int stress_cpu_online(stress_args_t *args)
 		cpu_online_all = false;
 	}
 
+	if (cpu_online_latency) {
+		latencies = (stress_cpu_online_latency_t **)calloc((size_t)cpus, sizeof(*latencies));
+		if (!latencies)
+			pr_inf("%s: out of memory allocating latency histograms, "
+				"disabling --cpu-online-latency\n", args->name);
+	}
+
 	if ((args->instance == 0) && cpu_online_all) {
 		pr_inf("%s: exercising all %" PRId32 " cpus\n",
 			args->name, cpu_online_count + 1);
@@ -323,7 +472,9 @@ static int stress_cpu_online(stress_args_t *args)
 			continue;
 		if (cpu_online[cpu]) {
 			double t;
+			uint64_t t1, t2;
 			int setting;
+			stress_cpu_online_latency_t *lat;
 
 			/* Don't try if already offline */
 			stress_cpu_online_get(cpu, &setting);
@@ -344,11 +495,17 @@ static int stress_cpu_online(stress_args_t *args)
 			if (cpu_online_affinity)
 				stress_cpu_online_set_affinity(cpu);
 
+			lat = stress_cpu_online_latency_get(latencies, cpu);
+
 			t = stress_time_now();
+			t1 = stress_latency_now();
 			rc = stress_cpu_online_set(args, cpu, 0);
+			t2 = stress_latency_now();
 			if (rc == EXIT_FAILURE)
 				break;
 			if (rc == EXIT_SUCCESS) {
+				if (lat)
+					stress_latency_hist_record(&lat->offline, t2 - t1);
 				rc = stress_cpu_online_get(cpu, &setting);
 				if ((rc == EXIT_SUCCESS) && (args->instances == 0) && (setting != 0)) {
 					pr_inf("%s: set cpu %" PRIu32 " offline, expecting setting to be 0, got %d instead\n",
@@ -360,10 +517,20 @@ static int stress_cpu_online(stress_args_t *args)
 			}
 
 			t = stress_time_now();
+			t1 = stress_latency_now();
 			rc = stress_cpu_online_set(args, cpu, 1);
+			t2 = stress_latency_now();
 			if (rc == EXIT_FAILURE)
 				break;
 			if (rc == EXIT_SUCCESS) {
+				if (lat) {
+					uint64_t run_ns;
+
+					stress_latency_hist_record(&lat->online, t2 - t1);
+					run_ns = stress_cpu_online_run_latency(cpu, t2);
+					if (run_ns)
+						stress_latency_hist_record(&lat->run, run_ns);
+				}
 				rc = stress_cpu_online_get(cpu, &setting);
 				if ((rc == EXIT_SUCCESS) && (args->instances == 0) && (setting != 1)) {
 					pr_inf("%s: set cpu %" PRIu32 " offline, expecting setting to be 1, got %d instead\n",
@@ -409,6 +576,13 @@ static int stress_cpu_online(stress_args_t *args)
 	stress_metrics_set(args, 1, "millisecs per online action",
 		rate * STRESS_DBL_MILLISECOND, STRESS_METRIC_HARMONIC_MEAN);
 
+	if (latencies) {
+		stress_cpu_online_latency_report(args, latencies, cpus);
+		for (i = 0; i < cpus; i++)
+			free(latencies[i]);
+		free(latencies);
+	}
+
 	return rc;
 }
 
@@ -418,6 +592,7 @@ const stressor_info_t stress_cpu_online_info = {
 	.class = CLASS_CPU | CLASS_OS | CLASS_PATHOLOGICAL,
 	.opts = opts,
 	.verify = VERIFY_ALWAYS,
+	.metrics_max = 5,
 	.help = help
 };
 #else
@@ -90,6 +90,7 @@ typedef struct {
 static const stress_help_t help[] = {
 	{ "c N", "cpu N",		"start N workers that perform CPU only loading" },
 	{ "l P", "cpu-load P",		"load CPU by P %, 0=sleep, 100=full load (see -c)" },
+	{ NULL,	 "cpu-fft-sweep",	"benchmark float and double FFTs over a range of sizes" },
 	{ NULL,	 "cpu-load-slice S",	"specify time slice during busy load" },
 	{ NULL,  "cpu-method M",	"specify stress cpu method M, default is all" },
 	{ NULL,	 "cpu-old-metrics",	"use old CPU metrics instead of normalized metrics" },
@@ -99,8 +100,28 @@ static const stress_help_t help[] = {
 
 static const stress_cpu_method_info_t stress_cpu_methods[];
 
-/* Don't make this static to ensure dithering does not get optimised out */
-uint8_t pixels[STRESS_CPU_DITHER_X][STRESS_CPU_DITHER_Y];
+/*
+ *  per instance method work buffers, instances may be run as
+ *  threads (--instance-threads) so these cannot be static
+ */
+typedef struct {
+	uint8_t pixels[STRESS_CPU_DITHER_X][STRESS_CPU_DITHER_Y];
+#if defined(HAVE_COMPLEX_H) &&		\
+    defined(HAVE_COMPLEX) &&		\
+    defined(__STDC_IEC_559_COMPLEX__) &&\
+    !defined(__UCLIBC__)
+	double complex fft_buf[FFT_SIZE] ALIGN64;
+	double complex fft_tmp[FFT_SIZE] ALIGN64;
+#endif
+	long double prod_a[MATRIX_PROD_SIZE][MATRIX_PROD_SIZE] ALIGN64;
+	long double prod_b[MATRIX_PROD_SIZE][MATRIX_PROD_SIZE] ALIGN64;
+	long double prod_r[MATRIX_PROD_SIZE][MATRIX_PROD_SIZE] ALIGN64;
+	double correlate_data[CORRELATE_DATA_LEN];
+	double correlate_corr[CORRELATE_LEN + 1];
+	uint32_t sieve[(SIEVE_SIZE + 31) / 32];
+} stress_cpu_buffers_t;
+
+static STRESS_THREAD_LOCAL stress_cpu_buffers_t *cpu_buffers;
 
 /*
  *  stress_cpu_sqrt()
@@ -363,7 +384,7 @@ PRAGMA_UNROLL_N(8)
  */
 static int OPTIMIZE3 stress_cpu_logmap(const char *name)
 {
-	static double x = 0.4;
+	static STRESS_THREAD_LOCAL double x = 0.4;
 	/*
 	 * Use an accumulation point that is slightly larger
 	 * than the point where chaotic behaviour starts
@@ -450,7 +471,7 @@ static int OPTIMIZE3 stress_cpu_rand48(const char *name)
  */
 static int OPTIMIZE3 stress_cpu_lfsr32(const char *name)
 {
-        static uint32_t lfsr = 0xf63acb01;
+        static STRESS_THREAD_LOCAL uint32_t lfsr = 0xf63acb01;
 	register int i;
 
 	(void)name;
@@ -611,7 +632,8 @@ static void OPTIMIZE3 fft_partial(
  */
 static int TARGET_CLONES stress_cpu_fft(const char *name)
 {
-	static double complex buf[FFT_SIZE] ALIGN64, tmp[FFT_SIZE] ALIGN64;
+	double complex *buf = cpu_buffers->fft_buf;
+	double complex *tmp = cpu_buffers->fft_tmp;
 	int i;
 
 	(void)name;
@@ -627,6 +649,213 @@ static int TARGET_CLONES stress_cpu_fft(const char *name)
 	UNEXPECTED
 #endif
 
+#if defined(HAVE_VECMATH)
+#define STRESS_CPU_FFT_SWEEP	(1)
+
+#define STRESS_CPU_FFT_MIN_SHIFT	(8)	/* 256 points, L1 cache resident */
+#define STRESS_CPU_FFT_MAX_SHIFT	(22)	/* 4M points, DRAM resident */
+#define STRESS_CPU_FFT_SHIFT_STEP	(2)
+#define STRESS_CPU_FFT_SIZES		\
+	(((STRESS_CPU_FFT_MAX_SHIFT - STRESS_CPU_FFT_MIN_SHIFT) / STRESS_CPU_FFT_SHIFT_STEP) + 1)
+#define STRESS_CPU_FFT_CELL		(0.025)	/* seconds per size per sweep */
+
+/*
+ *  STRESS_CPU_FFT_SWEEP_FUNCS()
+ *	generate an iterative radix-2 Stockham autosort FFT and its size
+ *	sweep for type with vl elements per SIMD vector. Real and imaginary
+ *	parts are held in separate arrays and the butterflies of each pass
+ *	are contiguous once the stride reaches vl, so all but the first
+ *	log2(vl) passes run on whole vectors and no bit reversal is needed.
+ *	The sweep runs each size for STRESS_CPU_FFT_CELL seconds on a single
+ *	tone input and checks the tone lands in the expected bin.
+ */
+#define STRESS_CPU_FFT_SWEEP_FUNCS(type, prec, vl, tolerance)			\
+typedef type stress_cpu_fft_ ## prec ## _vec_t					\
+	__attribute__ ((vector_size(sizeof(type) * vl)));			\
+										\
+static void OPTIMIZE3 TARGET_CLONES stress_cpu_fft_ ## prec(			\
+	const size_t n,								\
+	type **xr,								\
+	type **xi,								\
+	type **yr,								\
+	type **yi,								\
+	const type *wr,								\
+	const type *wi)								\
+{										\
+	size_t len, s;								\
+										\
+	for (len = n, s = 1; len > 1; len >>= 1, s <<= 1) {			\
+		const size_t m = len >> 1;					\
+		const type *ar = *xr, *ai = *xi;				\
+		type *br = *yr, *bi = *yi, *tmp;				\
+		size_t p;							\
+										\
+		for (p = 0; p < m; p++) {					\
+			const type twr = wr[p * s], twi = wi[p * s];		\
+			const size_t i0 = s * p, i1 = s * (p + m);		\
+			const size_t o0 = s * 2 * p, o1 = o0 + s;		\
+			size_t q = 0;						\
+										\
+			if (s >= vl) {						\
+				for (; q < s; q += vl) {			\
+					stress_cpu_fft_ ## prec ## _vec_t	\
+						r0, i0v, r1, i1v, dr, di;	\
+										\
+					shim_memcpy(&r0, &ar[i0 + q], sizeof(r0));	\
+					shim_memcpy(&i0v, &ai[i0 + q], sizeof(i0v));	\
+					shim_memcpy(&r1, &ar[i1 + q], sizeof(r1));	\
+					shim_memcpy(&i1v, &ai[i1 + q], sizeof(i1v));	\
+					dr = r0 - r1;				\
+					di = i0v - i1v;				\
+					r0 += r1;				\
+					i0v += i1v;				\
+					r1 = (dr * twr) - (di * twi);		\
+					i1v = (dr * twi) + (di * twr);		\
+					shim_memcpy(&br[o0 + q], &r0, sizeof(r0));	\
+					shim_memcpy(&bi[o0 + q], &i0v, sizeof(i0v));	\
+					shim_memcpy(&br[o1 + q], &r1, sizeof(r1));	\
+					shim_memcpy(&bi[o1 + q], &i1v, sizeof(i1v));	\
+				}						\
+			}							\
+			for (; q < s; q++) {					\
+				const type dr = ar[i0 + q] - ar[i1 + q];	\
+				const type di = ai[i0 + q] - ai[i1 + q];	\
+										\
+				br[o0 + q] = ar[i0 + q] + ar[i1 + q];		\
+				bi[o0 + q] = ai[i0 + q] + ai[i1 + q];		\
+				br[o1 + q] = (dr * twr) - (di * twi);		\
+				bi[o1 + q] = (dr * twi) + (di * twr);		\
+			}							\
+		}								\
+		tmp = *xr; *xr = *yr; *yr = tmp;				\
+		tmp = *xi; *xi = *yi; *yi = tmp;				\
+	}									\
+}										\
+										\
+static int stress_cpu_fft_ ## prec ## _sweep(					\
+	stress_args_t *args,							\
+	stress_metrics_t *metrics)						\
+{										\
+	size_t i;								\
+										\
+	for (i = 0; (i < STRESS_CPU_FFT_SIZES) && stress_continue(args); i++) {	\
+		const size_t shift = STRESS_CPU_FFT_MIN_SHIFT + (i * STRESS_CPU_FFT_SHIFT_STEP); \
+		const size_t n = (size_t)1 << shift;				\
+		const size_t sz = 7 * n * sizeof(type);				\
+		const size_t tone = (n / 8) + 1;				\
+		const double t_end = stress_time_now() + STRESS_CPU_FFT_CELL;	\
+		type *buf, *in_r, *in_i, *xr, *xi, *yr, *yi, *wr, *wi;		\
+		size_t k;							\
+		bool checked = false;						\
+										\
+		buf = (type *)stress_mmap_populate(NULL, sz,			\
+			PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0); \
+		if (buf == MAP_FAILED)						\
+			continue;						\
+		stress_set_vma_anon_name(buf, sz, "fft-data");			\
+		in_r = buf;							\
+		in_i = in_r + n;						\
+		wr = in_i + n;							\
+		wi = wr + (n / 2);						\
+		xr = wi + (n / 2);						\
+		xi = xr + n;							\
+		yr = xi + n;							\
+		yi = yr + n;							\
+										\
+		for (k = 0; k < n / 2; k++) {					\
+			const double theta = (-2.0 * (double)PI * (double)k) / (double)n; \
+										\
+			wr[k] = (type)shim_cos(theta);				\
+			wi[k] = (type)shim_sin(theta);				\
+		}								\
+		for (k = 0; k < n; k++) {					\
+			const double theta = (2.0 * (double)PI * (double)((k * tone) & (n - 1))) / (double)n; \
+										\
+			in_r[k] = (type)shim_cos(theta);			\
+			in_i[k] = (type)shim_sin(theta);			\
+		}								\
+										\
+		do {								\
+			double t;						\
+										\
+			(void)shim_memcpy(xr, in_r, n * sizeof(type));		\
+			(void)shim_memcpy(xi, in_i, n * sizeof(type));		\
+			t = stress_time_now();					\
+			stress_cpu_fft_ ## prec(n, &xr, &xi, &yr, &yi, wr, wi);	\
+			metrics[i].duration += stress_time_now() - t;		\
+			metrics[i].count += 1.0;				\
+			stress_bogo_inc(args);					\
+										\
+			if (!checked) {						\
+				const double tol = (double)n * tolerance;	\
+										\
+				checked = true;					\
+				if ((shim_fabs((double)xr[tone] - (double)n) > tol) ||	\
+				    (shim_fabs((double)xi[tone]) > tol) ||	\
+				    (shim_fabs((double)xr[0]) > tol) ||		\
+				    (shim_fabs((double)xi[0]) > tol)) {		\
+					pr_fail("%s: fft " # prec " %zu points: "	\
+						"unexpected spectrum, bin %zu is "	\
+						"(%g, %g), expected (%zu, 0)\n",	\
+						args->name, n, tone,		\
+						(double)xr[tone], (double)xi[tone], n);	\
+					(void)munmap((void *)buf, sz);		\
+					return EXIT_FAILURE;			\
+				}						\
+			}							\
+		} while ((stress_time_now() < t_end) && stress_continue(args));	\
+		(void)munmap((void *)buf, sz);					\
+	}									\
+	return EXIT_SUCCESS;							\
+}
+
+STRESS_CPU_FFT_SWEEP_FUNCS(float, float, 8, 1.0E-3)
+STRESS_CPU_FFT_SWEEP_FUNCS(double, double, 4, 1.0E-9)
+
+/*
+ *  stress_cpu_fft_sweep()
+ *	FFT benchmark, sweep single and double precision transforms
+ *	from L1 cache resident sizes up to DRAM resident sizes and report
+ *	the throughput of each size in GFLOPS (5 N log2(N) flops per FFT)
+ */
+static int stress_cpu_fft_sweep(stress_args_t *args)
+{
+	static const char * const precisions[] = { "float", "double" };
+	stress_metrics_t metrics[2][STRESS_CPU_FFT_SIZES];
+	size_t i, j, idx = 0;
+	int rc = EXIT_SUCCESS;
+
+	stress_zero_metrics(&metrics[0][0], 2 * STRESS_CPU_FFT_SIZES);
+
+	do {
+		rc = stress_cpu_fft_float_sweep(args, metrics[0]);
+		if (rc != EXIT_SUCCESS)
+			break;
+		rc = stress_cpu_fft_double_sweep(args, metrics[1]);
+		if (rc != EXIT_SUCCESS)
+			break;
+	} while (stress_continue(args));
+
+	for (i = 0; i < 2; i++) {
+		for (j = 0; j < STRESS_CPU_FFT_SIZES; j++) {
+			const size_t shift = STRESS_CPU_FFT_MIN_SHIFT + (j * STRESS_CPU_FFT_SHIFT_STEP);
+			const double n = (double)((size_t)1 << shift);
+			char msg[64];
+
+			if (metrics[i][j].duration <= 0.0)
+				continue;
+			(void)snprintf(msg, sizeof(msg), "fft %s %zu points GFLOPS",
+				precisions[i], (size_t)1 << shift);
+			stress_metrics_set(args, idx, msg,
+				(5.0 * n * (double)shift * metrics[i][j].count) /
+				(metrics[i][j].duration * 1.0E9), STRESS_METRIC_HARMONIC_MEAN);
+			idx++;
+		}
+	}
+	return rc;
+}
+#endif
+
 /*
  *   stress_cpu_euler()
  *	compute e using series
@@ -1206,9 +1435,9 @@ static int OPTIMIZE3 TARGET_CLONES stress_cpu_matrix_prod(const char *name)
 {
 	int i, j, k;
 
-	static long double a[MATRIX_PROD_SIZE][MATRIX_PROD_SIZE] ALIGN64,
-			   b[MATRIX_PROD_SIZE][MATRIX_PROD_SIZE] ALIGN64,
-			   r[MATRIX_PROD_SIZE][MATRIX_PROD_SIZE] ALIGN64;
+	long double (*a)[MATRIX_PROD_SIZE] = cpu_buffers->prod_a;
+	long double (*b)[MATRIX_PROD_SIZE] = cpu_buffers->prod_b;
+	long double (*r)[MATRIX_PROD_SIZE] = cpu_buffers->prod_r;
 	const long double v = 1 / (long double)((uint32_t)~0);
 	long double sum = 0.0L;
 
@@ -1634,8 +1863,8 @@ static int OPTIMIZE3 stress_cpu_correlate(const char *name)
 {
 	size_t i, j;
 	double data_average = 0.0;
-	static double data[CORRELATE_DATA_LEN];
-	static double corr[CORRELATE_LEN + 1];
+	double *data = cpu_buffers->correlate_data;
+	double *corr = cpu_buffers->correlate_corr;
 
 	(void)name;
 
@@ -1669,10 +1898,10 @@ static int OPTIMIZE3 stress_cpu_sieve(const char *name)
 {
 	const double dsqrt = shim_sqrt(SIEVE_SIZE);
 	const uint32_t nsqrt = (uint32_t)dsqrt;
-	static uint32_t sieve[(SIEVE_SIZE + 31) / 32];
+	uint32_t *sieve = cpu_buffers->sieve;
 	uint32_t i, j;
 
-	(void)shim_memset(sieve, 0xff, sizeof(sieve));
+	(void)shim_memset(sieve, 0xff, sizeof(cpu_buffers->sieve));
 	for (i = 2; i < nsqrt; i++)
 		if (STRESS_GETBIT(sieve, i))
 			for (j = i * i; j < SIEVE_SIZE; j += i)
@@ -2354,6 +2583,7 @@ static int stress_cpu_parity(const char *name)
  */
 static int TARGET_CLONES stress_cpu_dither(const char *name)
 {
+	uint8_t (*pixels)[STRESS_CPU_DITHER_Y] = cpu_buffers->pixels;
 	size_t x, y;
 
 	(void)name;
@@ -2610,7 +2840,7 @@ static int TARGET_CLONES stress_cpu_union(const char *name)
 		uint32_t	u32:30;
 	} stress_u_t;
 
-	static stress_u_t u;
+	static STRESS_THREAD_LOCAL stress_u_t u;
 	size_t i;
 
 	(void)name;
@@ -2983,37 +3213,110 @@ static const stress_cpu_method_info_t stress_cpu_methods[] = {
 #endif
 };
 
-static double stress_cpu_counter_scale[SIZEOF_ARRAY(stress_cpu_methods)];
+static STRESS_THREAD_LOCAL double stress_cpu_counter_scale[SIZEOF_ARRAY(stress_cpu_methods)];
+
+/* per method invocations and CPU time when rotating through all methods */
+typedef struct {
+	uint64_t ops;		/* number of times the method was run */
+	double cpu_time;	/* CPU time used by the method in seconds */
+} stress_cpu_method_stats_t;
 
-static int stress_call_cpu_method(size_t method, stress_args_t *args, double *counter)
+/*
+ *  stress_per_thread_cpu_time()
+ *	CPU time of the calling thread, cpu instances may be threads
+ *	so the process CPU time cannot be used to time a method.
+ *	Falls back to wall clock time if not possible.
+ */
+static double stress_per_thread_cpu_time(void)
+{
+#if defined(CLOCK_THREAD_CPUTIME_ID)
+	struct timespec ts;
+
+	if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts) == 0)
+		return (double)ts.tv_sec + ((double)ts.tv_nsec) / (double)STRESS_NANOSECOND;
+#endif
+	return stress_time_now();
+}
+
+static int stress_call_cpu_method(
+	size_t method,
+	stress_args_t *args,
+	double *counter,
+	stress_cpu_method_stats_t *method_stats)
 {
 	int rc;
 
 	if (method == 0) {
-		static size_t i = 1;	/* Skip over stress_cpu_all */
+		static STRESS_THREAD_LOCAL size_t i = 1;	/* Skip over stress_cpu_all */
 
 		method = i;
 		i++;
 		if (i >= SIZEOF_ARRAY(stress_cpu_methods))
 			i = 1;
+#if defined(STRESS_RAPL)
+		stress_rapl_method(args, stress_cpu_methods[method].name);
+#endif
+	}
+	if (method_stats) {
+		const double t = stress_per_thread_cpu_time();
+
+		rc = stress_cpu_methods[method].func(args->name);
+		method_stats[method].cpu_time += stress_per_thread_cpu_time() - t;
+		method_stats[method].ops++;
+	} else {
+		rc = stress_cpu_methods[method].func(args->name);
 	}
-	rc = stress_cpu_methods[method].func(args->name);
 	*counter += stress_cpu_counter_scale[method];
 	stress_bogo_set(args, (uint64_t)*counter);
 
 	return rc;
 }
 
+/*
+ *  stress_cpu_method_metrics()
+ *	report the rate of each method in runs per second of CPU
+ *	time so that a regression in a single method can be spotted
+ *	with --cpu-method all and compared against a --compare baseline
+ */
+static void stress_cpu_method_metrics(
+	stress_args_t *args,
+	const stress_cpu_method_stats_t *method_stats)
+{
+	size_t i;
+
+	if (!method_stats)
+		return;
+
+	for (i = 1; i < SIZEOF_ARRAY(stress_cpu_methods); i++) {
+		char msg[64];
+
+		if ((method_stats[i].ops == 0) || (method_stats[i].cpu_time <= 0.0))
+			continue;
+		(void)snprintf(msg, sizeof(msg), "%s ops per cpu sec",
+			stress_cpu_methods[i].name);
+		/* fixed index per method so instances combine consistently */
+		stress_metrics_set(args, i - 1, msg,
+			(double)method_stats[i].ops / method_stats[i].cpu_time,
+			STRESS_METRIC_HARMONIC_MEAN);
+	}
+}
+
 /*
  *  stress_per_cpu_time()
  *	try to get accurage CPU time from CPUTIME clock,
  *	or fall back to wall clock time if not possible.
+ *	The thread clock is used since instances may be threads
  */
 static double stress_per_cpu_time(void)
 {
-#if defined(CLOCK_PROCESS_CPUTIME_ID)
+#if defined(CLOCK_THREAD_CPUTIME_ID)
+#define STRESS_CPU_CLOCK	CLOCK_THREAD_CPUTIME_ID
+#elif defined(CLOCK_PROCESS_CPUTIME_ID)
+#define STRESS_CPU_CLOCK	CLOCK_PROCESS_CPUTIME_ID
+#endif
+#if defined(STRESS_CPU_CLOCK)
 	struct timespec ts;
-	static bool use_clock_gettime = true;
+	static STRESS_THREAD_LOCAL bool use_clock_gettime = true;
 
 	/*
 	 *  Where possible try to get time used on the CPU
@@ -3021,7 +3324,7 @@ static double stress_per_cpu_time(void)
 	 *  CPU consumption measurements
 	 */
 	if (use_clock_gettime) {
-		if (clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts) == 0) {
+		if (clock_gettime(STRESS_CPU_CLOCK, &ts) == 0) {
 			return (double)ts.tv_sec + ((double)ts.tv_nsec) / (double)STRESS_NANOSECOND;
 		} else {
 			use_clock_gettime = false;
@@ -3035,10 +3338,10 @@ static double stress_per_cpu_time(void)
 }
 
 /*
- *  stress_cpu()
+ *  stress_cpu_run()
  *	stress CPU by doing floating point math ops
  */
-static int OPTIMIZE3 stress_cpu(stress_args_t *args)
+static int OPTIMIZE3 stress_cpu_run(stress_args_t *args)
 {
 	double bias;
 	size_t cpu_method = 0;
@@ -3046,14 +3349,17 @@ static int OPTIMIZE3 stress_cpu(stress_args_t *args)
 	int32_t cpu_load_slice = -64;
 	double counter = 0.0;
 	bool cpu_old_metrics = false;
+	bool cpu_fft_sweep = false;
 	size_t i;
 	int rc = EXIT_SUCCESS;
+	stress_cpu_method_stats_t *method_stats = NULL;
 
 	stress_catch_sigill();
 
 	(void)stress_get_setting("cpu-load-slice", &cpu_load_slice);
 	(void)stress_get_setting("cpu-old-metrics", &cpu_old_metrics);
 	(void)stress_get_setting("cpu-method", &cpu_method);
+	(void)stress_get_setting("cpu-fft-sweep", &cpu_fft_sweep);
 	if (stress_get_setting("cpu-load", &cpu_load)) {
 		if (cpu_method == 0)
 			pr_inf("%s: for stable load results, select a "
@@ -3088,15 +3394,38 @@ static int OPTIMIZE3 stress_cpu(stress_args_t *args)
 	stress_sync_start_wait(args);
 	stress_set_proc_state(args->name, STRESS_STATE_RUN);
 
+	if (cpu_fft_sweep) {
+#if defined(STRESS_CPU_FFT_SWEEP)
+		rc = stress_cpu_fft_sweep(args);
+
+		stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
+		return rc;
+#else
+		if (args->instance == 0)
+			pr_inf("%s: --cpu-fft-sweep requires compiler vector support, "
+				"ignoring option\n", args->name);
+#endif
+	}
+
+	if (cpu_method == 0) {
+		method_stats = (stress_cpu_method_stats_t *)
+			calloc(SIZEOF_ARRAY(stress_cpu_methods), sizeof(*method_stats));
+		if (!method_stats && (args->instance == 0))
+			pr_inf("%s: cannot allocate per method statistics, "
+				"not reporting per method rates\n", args->name);
+	}
+
 	/*
 	 * Normal use case, 100% load, simple spinning on CPU
 	 */
 	if (cpu_load == 100) {
 		do {
-			rc = stress_call_cpu_method(cpu_method, args, &counter);
+			rc = stress_call_cpu_method(cpu_method, args, &counter, method_stats);
 		} while ((rc == EXIT_SUCCESS) && stress_continue(args));
 
 		stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
+		stress_cpu_method_metrics(args, method_stats);
+		free(method_stats);
 		return rc;
 	}
 
@@ -3121,7 +3450,7 @@ static int OPTIMIZE3 stress_cpu(stress_args_t *args)
 			int j;
 
 			for (j = 0; j < -cpu_load_slice; j++) {
-				rc = stress_call_cpu_method(cpu_method, args, &counter);
+				rc = stress_call_cpu_method(cpu_method, args, &counter, method_stats);
 				if ((rc != EXIT_SUCCESS) || !stress_continue_flag())
 					break;
 			}
@@ -3132,7 +3461,7 @@ static int OPTIMIZE3 stress_cpu(stress_args_t *args)
 			const uint16_t r = stress_mwc16();
 			double slice_end = t1_cpu_clock + ((double)r / 131072.0);
 			do {
-				rc = stress_call_cpu_method(cpu_method, args, &counter);
+				rc = stress_call_cpu_method(cpu_method, args, &counter, method_stats);
 				t2_wall_clock = stress_time_now();
 				t2_cpu_clock = stress_per_cpu_time();
 				if ((rc != EXIT_SUCCESS) || !stress_continue_flag())
@@ -3143,7 +3472,7 @@ static int OPTIMIZE3 stress_cpu(stress_args_t *args)
 			const double slice_end = t1_cpu_clock + ((double)cpu_load_slice / STRESS_DBL_MILLISECOND);
 
 			do {
-				rc = stress_call_cpu_method(cpu_method, args, &counter);
+				rc = stress_call_cpu_method(cpu_method, args, &counter, method_stats);
 				t2_wall_clock = stress_time_now();
 				t2_cpu_clock = stress_per_cpu_time();
 				if ((rc != EXIT_SUCCESS) || !stress_continue_flag())
@@ -3190,6 +3519,36 @@ static int OPTIMIZE3 stress_cpu(stress_args_t *args)
 	}
 
 	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
+	stress_cpu_method_metrics(args, method_stats);
+	free(method_stats);
+
+	return rc;
+}
+
+/*
+ *  stress_cpu()
+ *	allocate per instance method buffers and stress CPU
+ */
+static int stress_cpu(stress_args_t *args)
+{
+	int rc;
+
+	cpu_buffers = (stress_cpu_buffers_t *)stress_mmap_populate(NULL,
+			sizeof(*cpu_buffers), PROT_READ | PROT_WRITE,
+			MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (cpu_buffers == MAP_FAILED) {
+		pr_inf_skip("%s: failed to mmap %zu bytes for method buffers, "
+			"errno=%d (%s), skipping stressor\n",
+			args->name, sizeof(*cpu_buffers), errno, strerror(errno));
+		cpu_buffers = NULL;
+		return EXIT_NO_RESOURCE;
+	}
+	stress_set_vma_anon_name(cpu_buffers, sizeof(*cpu_buffers), "cpu-buffers");
+
+	rc = stress_cpu_run(args);
+
+	(void)munmap((void *)cpu_buffers, sizeof(*cpu_buffers));
+	cpu_buffers = NULL;
 
 	return rc;
 }
@@ -3200,6 +3559,7 @@ static const char *stress_cpu_method(const size_t i)
 }
 
 static const stress_opt_t opts[] = {
+	{ OPT_cpu_fft_sweep,   "cpu-fft-sweep",   TYPE_ID_BOOL,  0, 1, NULL },
 	{ OPT_cpu_load,        "cpu-load",        TYPE_ID_INT32, 0, 100, NULL },
 	{ OPT_cpu_load_slice,  "cpu-load-slice",  TYPE_ID_INT32, (uint64_t)-5000, (uint64_t)5000, NULL },
 	{ OPT_cpu_method,      "cpu-method",      TYPE_ID_SIZE_T_METHOD, 0, 0, stress_cpu_method },
@@ -3212,5 +3572,6 @@ const stressor_info_t stress_cpu_info = {
 	.class = CLASS_CPU | CLASS_COMPUTE,
 	.opts = opts,
 	.verify = VERIFY_OPTIONAL,
+	.instance_threads = true,
 	.help = help
 };
@@ -21,6 +21,7 @@
 #include "core-builtin.h"
 #include "core-capabilities.h"
 #include "core-killpid.h"
+#include "core-latency.h"
 #include "core-lock.h"
 
 #include <math.h>
@@ -29,12 +30,14 @@
 
 #define DEFAULT_DELAY_NS	(100000)
 #define MAX_SAMPLES		(100000000)
-#define DEFAULT_SAMPLES		(10000)
 #define MAX_BUCKETS		(250)
 
 typedef struct {
 	void *lock;			/* lock protecting count */
 	uint32_t count;			/* count of error messages emitted */
+	uint32_t instances;		/* number of per-instance histograms */
+	stress_latency_hist_t *hists;	/* per-instance latency histograms */
+	size_t hists_size;		/* size of hists allocation */
 } stress_cyclic_state_t;
 
 typedef struct {
@@ -46,17 +49,13 @@ typedef struct {
 typedef struct {
 	int64_t		min_ns;		/* min latency */
 	int64_t		max_ns;		/* max latency */
-	int64_t		*latencies;	/* latency samples */
-	size_t		latencies_size;	/* size of latencies allocation */
-	size_t		cyclic_samples;	/* number of latency samples */
-	size_t		index;		/* index into latencies */
-	size_t		index_reqd;	/* theoretic size of index required for the run */
 	int32_t		min_prio;	/* min priority allowed */
 	int32_t		max_prio;	/* max priority allowed */
 	double		ns;		/* total nanosecond latency */
 	double		latency_mean;	/* average latency */
 	int64_t		latency_mode;	/* first mode */
 	double		std_dev;	/* standard deviation */
+	stress_latency_hist_t hist;	/* latency histogram */
 } stress_rt_stats_t;
 
 typedef int (*stress_cyclic_func)(stress_args_t *args, stress_rt_stats_t *rt_stats, uint64_t cyclic_sleep);
@@ -73,7 +72,7 @@ static const stress_help_t help[] = {
 	{ NULL,	"cyclic-ops N",		"stop after N cyclic timing cycles" },
 	{ NULL,	"cyclic-policy P",	"used rr or fifo scheduling policy" },
 	{ NULL,	"cyclic-prio N",	"real time scheduling priority 1..100" },
-	{ NULL, "cyclic-samples N",	"number of latency samples to take" },
+	{ NULL, "cyclic-samples N",	"ignored, latency samples are no longer limited" },
 	{ NULL,	"cyclic-sleep N",	"sleep time of real time timer in nanosecs" },
 	{ NULL,	NULL,			NULL }
 };
@@ -96,7 +95,9 @@ static const stress_policy_t cyclic_policies[] = {
 
 static void stress_cyclic_init(const uint32_t instances)
 {
-	(void)instances;
+	stress_latency_hist_t *hists;
+	size_t hists_size;
+	uint32_t i;
 
 	stress_cyclic_state = (stress_cyclic_state_t *)
 		stress_mmap_populate(NULL, sizeof(*stress_cyclic_state),
@@ -107,17 +108,107 @@ static void stress_cyclic_init(const uint32_t instances)
 
 	stress_set_vma_anon_name(stress_cyclic_state, sizeof(*stress_cyclic_state), "cyclic-state");
 	stress_cyclic_state->lock = stress_lock_create("cyclic-state");
+
+	/*
+	 *  Per-instance histograms, these are merged by the parent
+	 *  in stress_cyclic_deinit once all the instances have completed
+	 */
+	stress_cyclic_state->hists = NULL;
+	stress_cyclic_state->instances = 0;
+	if (instances < 1)
+		return;
+	hists_size = (size_t)instances * sizeof(*hists);
+	hists = (stress_latency_hist_t *)
+		stress_mmap_populate(NULL, hists_size,
+				PROT_READ | PROT_WRITE,
+				MAP_ANONYMOUS | MAP_SHARED, -1, 0);
+	if (hists == MAP_FAILED)
+		return;
+	stress_set_vma_anon_name(hists, hists_size, "cyclic-histograms");
+	for (i = 0; i < instances; i++)
+		stress_latency_hist_init(&hists[i]);
+	stress_cyclic_state->hists = hists;
+	stress_cyclic_state->hists_size = hists_size;
+	stress_cyclic_state->instances = instances;
+}
+
+/*
+ *  stress_cyclic_merged_stats()
+ *	report latencies merged across all the cyclic instances
+ */
+static void stress_cyclic_merged_stats(void)
+{
+	static const double percentiles[] = {
+		50.0, 90.0, 99.0, 99.9, 99.99,
+	};
+	stress_latency_hist_t *merged;
+	uint32_t i, n = 0;
+	size_t j;
+
+	if (stress_cyclic_state->instances < 2)
+		return;
+
+	merged = (stress_latency_hist_t *)malloc(sizeof(*merged));
+	if (!merged)
+		return;
+	stress_latency_hist_init(merged);
+	for (i = 0; i < stress_cyclic_state->instances; i++) {
+		if (stress_cyclic_state->hists[i].count) {
+			stress_latency_hist_merge(merged, &stress_cyclic_state->hists[i]);
+			n++;
+		}
+	}
+	if (n > 1) {
+		pr_block_begin();
+		pr_inf("cyclic: latencies merged across %" PRIu32 " instances, %" PRIu64 " samples\n",
+			n, merged->count);
+		pr_inf("cyclic:   mean: %.2f ns, mode: %" PRIu64 " ns\n",
+			stress_latency_hist_mean(merged),
+			stress_latency_hist_mode(merged));
+		pr_inf("cyclic:   min: %" PRIu64 " ns, max: %" PRIu64 " ns, std.dev. %.2f\n",
+			merged->min_ns, merged->max_ns,
+			stress_latency_hist_std_dev(merged));
+		pr_inf("cyclic: merged latency percentiles:\n");
+		for (j = 0; j < SIZEOF_ARRAY(percentiles); j++) {
+			pr_inf("cyclic:   %5.2f%%: %10" PRIu64 " ns\n",
+				percentiles[j],
+				stress_latency_hist_percentile(merged, percentiles[j]));
+		}
+		pr_block_end();
+	}
+	free(merged);
 }
 
 static void stress_cyclic_deinit(void)
 {
 	if (stress_cyclic_state != MAP_FAILED) {
+		if (stress_cyclic_state->hists) {
+			stress_cyclic_merged_stats();
+			(void)munmap((void *)stress_cyclic_state->hists,
+				stress_cyclic_state->hists_size);
+		}
 		if (stress_cyclic_state->lock)
 			stress_lock_destroy(stress_cyclic_state->lock);
 		(void)munmap((void *)stress_cyclic_state, sizeof(*stress_cyclic_state));
 	}
 }
 
+/*
+ *  stress_cyclic_record()
+ *	record a latency sample
+ */
+static inline void stress_cyclic_record(
+	stress_rt_stats_t *rt_stats,
+	const int64_t delta_ns)
+{
+	/* early wakeups are negative, the histogram clamps these to zero */
+	stress_latency_hist_record(&rt_stats->hist, delta_ns < 0 ? 0 : (uint64_t)delta_ns);
+	if (delta_ns > rt_stats->max_ns)
+		rt_stats->max_ns = delta_ns;
+	if (delta_ns < rt_stats->min_ns)
+		rt_stats->min_ns = delta_ns;
+}
+
 #if (defined(HAVE_CLOCK_GETTIME) && defined(HAVE_CLOCK_NANOSLEEP)) ||	\
     (defined(HAVE_CLOCK_GETTIME) && defined(HAVE_NANOSLEEP)) ||		\
     (defined(HAVE_CLOCK_GETTIME) && defined(HAVE_PSELECT)) ||		\
@@ -134,9 +225,7 @@ static void stress_cyclic_stats(
 		   (t2->tv_nsec - t1->tv_nsec);
 	delta_ns -= cyclic_sleep;
 
-	if (rt_stats->index < rt_stats->cyclic_samples)
-		rt_stats->latencies[rt_stats->index++] = delta_ns;
-	rt_stats->index_reqd++;
+	stress_cyclic_record(rt_stats, delta_ns);
 
 	rt_stats->ns += (double)delta_ns;
 }
@@ -235,9 +324,7 @@ static int stress_cyclic_poll(
 		if (delta_ns >= (int64_t)cyclic_sleep) {
 			delta_ns -= cyclic_sleep;
 
-			if (rt_stats->index < rt_stats->cyclic_samples)
-				rt_stats->latencies[rt_stats->index++] = delta_ns;
-			rt_stats->index_reqd++;
+			stress_cyclic_record(rt_stats, delta_ns);
 
 			rt_stats->ns += (double)delta_ns;
 			break;
@@ -335,9 +422,7 @@ static int stress_cyclic_itimer(
 		(itimer_time.tv_nsec - t1.tv_nsec);
 	delta_ns -= cyclic_sleep;
 
-	if (rt_stats->index < rt_stats->cyclic_samples)
-		rt_stats->latencies[rt_stats->index++] = delta_ns;
-	rt_stats->index_reqd++;
+	stress_cyclic_record(rt_stats, delta_ns);
 
 	rt_stats->ns += (double)delta_ns;
 
@@ -397,74 +482,17 @@ static void NORETURN MLOCKED_TEXT stress_rlimit_handler(int signum)
 	siglongjmp(jmp_env, 1);
 }
 
-/*
- *  stress_cyclic_cmp()
- *	sort latencies into order, least first
- */
-static int stress_cyclic_cmp(const void *p1, const void *p2)
-{
-	const int64_t *i1 = (const int64_t *)p1;
-	const int64_t *i2 = (const int64_t *)p2;
-
-	if (*i1 > *i2)
-		return 1;
-	else if (*i1 < *i2)
-		return -1;
-	return 0;
-}
-
 /*
  *  stress_rt_stats()
  *	compute statistics on gathered latencies
  */
 static void stress_rt_stats(stress_rt_stats_t *rt_stats)
 {
-	size_t i;
-	size_t n = 0, best_n = 0;
-	int64_t current;
-	double variance = 0.0;
-
-	rt_stats->latency_mean = 0.0;
-	rt_stats->latency_mode = 0;
-
-	for (i = 0; i < rt_stats->index; i++) {
-		const int64_t ns = rt_stats->latencies[i];
-
-		if (ns > rt_stats->max_ns)
-			rt_stats->max_ns = ns;
-		if (ns < rt_stats->min_ns)
-			rt_stats->min_ns = ns;
-
-		rt_stats->latency_mean += (double)ns;
-	}
-	if (rt_stats->index)
-		rt_stats->latency_mean /= (double)rt_stats->index;
-
-	qsort(rt_stats->latencies, rt_stats->index, sizeof(*(rt_stats->latencies)), stress_cyclic_cmp);
-
-	current = rt_stats->latency_mode = rt_stats->latencies[0];
-
-	for (i = 0; i < rt_stats->index; i++) {
-		const int64_t ns = rt_stats->latencies[i];
-		double diff;
+	const stress_latency_hist_t *hist = &rt_stats->hist;
 
-		if (ns == current) {
-			n++;
-			if (n > best_n) {
-				rt_stats->latency_mode = current;
-				best_n = n;
-			}
-		} else {
-			current = ns;
-			n = 0;
-		}
-		diff = ((double)ns - rt_stats->latency_mean);
-		variance += (diff * diff);
-	}
-	if (rt_stats->index) {
-		variance /= (double)rt_stats->index;
-		rt_stats->std_dev = sqrt(variance);
-	}
+	rt_stats->latency_mean = hist->count ? rt_stats->ns / (double)hist->count : 0.0;
+	rt_stats->latency_mode = (int64_t)stress_latency_hist_mode(hist);
+	rt_stats->std_dev = stress_latency_hist_std_dev(hist);
 }
 
 /*
@@ -529,11 +557,14 @@ static void stress_rt_dist(
 		return;
 	}
 
-	for (i = 0; i < (ssize_t)rt_stats->index; i++) {
-		const int64_t lat = rt_stats->latencies[i] / cyclic_dist;
+	for (i = 0; i < (ssize_t)STRESS_LATENCY_BUCKETS; i++) {
+		int64_t lat;
 
+		if (!rt_stats->hist.buckets[i])
+			continue;
+		lat = (int64_t)stress_latency_hist_bucket_value((size_t)i) / cyclic_dist;
 		if (lat < (int64_t)dist_size)
-			dist[lat]++;
+			dist[lat] += (int64_t)rt_stats->hist.buckets[i];
 	}
 
 	for (n = dist_size; n >= 1; n--) {
@@ -593,7 +624,6 @@ static int stress_cyclic(stress_args_t *args)
 	uint64_t cyclic_sleep = DEFAULT_DELAY_NS;
 	uint64_t cyclic_dist = 0;
 	int32_t cyclic_prio = INT32_MAX;
-	size_t cyclic_samples = DEFAULT_SAMPLES;
 	int policy, rc = EXIT_SUCCESS;
 	size_t cyclic_policy = 0;
 	size_t cyclic_method = 0;
@@ -608,7 +638,6 @@ static int stress_cyclic(stress_args_t *args)
 	(void)stress_get_setting("cyclic-method", &cyclic_method);
 	(void)stress_get_setting("cyclic-policy", &cyclic_policy);
 	(void)stress_get_setting("cyclic-prio", &cyclic_prio);
-	(void)stress_get_setting("cyclic-samples", &cyclic_samples);
 	(void)stress_get_setting("cyclic-sleep", &cyclic_sleep);
 
 	if (NUM_CYCLIC_POLICIES == 0) {
@@ -665,19 +694,7 @@ static int stress_cyclic(stress_args_t *args)
 		return EXIT_NO_RESOURCE;
 	}
 	stress_set_vma_anon_name(rt_stats, size, "rt-statistics");
-	rt_stats->cyclic_samples = cyclic_samples;
-	rt_stats->latencies_size = cyclic_samples * sizeof(*rt_stats->latencies);
-	rt_stats->latencies = (int64_t *)stress_mmap_populate(NULL,
-						rt_stats->latencies_size,
-						PROT_READ | PROT_WRITE,
-						MAP_SHARED | MAP_ANONYMOUS, -1, 0);
-	if (rt_stats->latencies == MAP_FAILED) {
-		pr_inf_skip("%s: mmap of %zd samples failed: %d (%s)\n",
-			args->name, cyclic_samples, errno, strerror(errno));
-		(void)munmap((void *)rt_stats, size);
-		return EXIT_NO_RESOURCE;
-	}
-	stress_set_vma_anon_name(rt_stats->latencies, rt_stats->latencies_size, "latencies");
+	stress_latency_hist_init(&rt_stats->hist);
 	rt_stats->min_ns = INT64_MAX;
 	rt_stats->max_ns = INT64_MIN;
 	rt_stats->ns = 0.0;
@@ -715,7 +732,6 @@ again:
 			goto finish;
 		pr_inf("%s: cannot fork, errno=%d (%s)\n",
 			args->name, errno, strerror(errno));
-		(void)munmap((void *)rt_stats->latencies, rt_stats->latencies_size);
 		(void)munmap((void *)rt_stats, size);
 		return EXIT_NO_RESOURCE;
 	} else if (pid == 0) {
@@ -820,7 +836,6 @@ tidy_ok:
 		ncrc = EXIT_SUCCESS;
 tidy:
 		(void)fflush(stdout);
-		(void)munmap((void *)rt_stats->latencies, rt_stats->latencies_size);
 		(void)munmap((void *)rt_stats, size);
 		_exit(ncrc);
 	} else {
@@ -833,8 +848,34 @@ tidy:
 
 	stress_rt_stats(rt_stats);
 
+	if (rt_stats->hist.count) {
+		const stress_latency_hist_t *hist = &rt_stats->hist;
+
+		stress_metrics_set(args, 0, "ns mean latency",
+			rt_stats->latency_mean, STRESS_METRIC_GEOMETRIC_MEAN);
+		stress_metrics_set(args, 1, "ns p50 latency",
+			(double)stress_latency_hist_percentile(hist, 50.0), STRESS_METRIC_GEOMETRIC_MEAN);
+		stress_metrics_set(args, 2, "ns p90 latency",
+			(double)stress_latency_hist_percentile(hist, 90.0), STRESS_METRIC_GEOMETRIC_MEAN);
+		stress_metrics_set(args, 3, "ns p99 latency",
+			(double)stress_latency_hist_percentile(hist, 99.0), STRESS_METRIC_GEOMETRIC_MEAN);
+		stress_metrics_set(args, 4, "ns p99.9 latency",
+			(double)stress_latency_hist_percentile(hist, 99.9), STRESS_METRIC_GEOMETRIC_MEAN);
+		stress_metrics_set(args, 5, "ns p99.99 latency",
+			(double)stress_latency_hist_percentile(hist, 99.99), STRESS_METRIC_GEOMETRIC_MEAN);
+		stress_metrics_set(args, 6, "ns max latency",
+			(double)rt_stats->max_ns, STRESS_METRIC_MAXIMUM);
+
+		/* hand over to parent to merge with the other instances */
+		if ((stress_cyclic_state != MAP_FAILED) &&
+		    (stress_cyclic_state->hists) &&
+		    (args->instance < stress_cyclic_state->instances))
+			(void)shim_memcpy(&stress_cyclic_state->hists[args->instance],
+				hist, sizeof(*hist));
+	}
+
 	if (args->instance == 0) {
-		if (rt_stats->index) {
+		if (rt_stats->hist.count) {
 			size_t i;
 
 			static const double percentiles[] = {
@@ -850,11 +891,11 @@ tidy:
 			};
 
 			pr_block_begin();
-			pr_inf("%s: sched %s: %" PRIu64 " ns delay, %zd samples\n",
+			pr_inf("%s: sched %s: %" PRIu64 " ns delay, %" PRIu64 " samples\n",
 				args->name,
 				cyclic_policies[cyclic_policy].name,
 				cyclic_sleep,
-				rt_stats->index);
+				rt_stats->hist.count);
 			pr_inf( "%s:   mean: %.2f ns, mode: %" PRId64 " ns\n",
 				args->name,
 				rt_stats->latency_mean,
@@ -867,17 +908,12 @@ tidy:
 
 			pr_inf("%s: latency percentiles:\n", args->name);
 			for (i = 0; i < sizeof(percentiles) / sizeof(percentiles[0]); i++) {
-				size_t j = (size_t)(((double)rt_stats->index * percentiles[i]) / 100.0);
-				pr_inf("%s:   %5.2f%%: %10" PRId64 " ns\n",
+				pr_inf("%s:   %5.2f%%: %10" PRIu64 " ns\n",
 					args->name,
 					percentiles[i],
-					rt_stats->latencies[j]);
+					stress_latency_hist_percentile(&rt_stats->hist, percentiles[i]));
 			}
 			stress_rt_dist(args->name, rt_stats, (int64_t)cyclic_dist);
-
-			if (rt_stats->index < rt_stats->index_reqd)
-				pr_inf("%s: Note: --cyclic-samples needed to be %zd to capture all the data for this run\n",
-					args->name, rt_stats->index_reqd);
 			pr_block_end();
 		} else {
 			pr_inf("%s: %10s: no latency information available\n",
@@ -889,7 +925,6 @@ tidy:
 finish:
 	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
 
-	(void)munmap((void *)rt_stats->latencies, rt_stats->latencies_size);
 	(void)munmap((void *)rt_stats, size);
 
 	return rc;
@@ -924,5 +959,6 @@ const stressor_info_t stress_cyclic_info = {
 	.opts = opts,
 	.init = stress_cyclic_init,
 	.deinit = stress_cyclic_deinit,
+	.metrics_max = 7,
 	.help = help
 };
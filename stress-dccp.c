@@ -476,6 +476,7 @@ const stressor_info_t stress_dccp_info = {
 	.class = CLASS_NETWORK | CLASS_OS,
 	.opts = opts,
 	.verify = VERIFY_ALWAYS,
+	.metrics_max = 1,
 	.help = help
 };
 #else
@@ -271,6 +271,7 @@ const stressor_info_t stress_dekker_info = {
 	.stressor = stress_dekker,
 	.class = CLASS_CPU_CACHE | CLASS_IPC,
 	.verify = VERIFY_ALWAYS,
+	.metrics_max = 1,
 	.supported = stress_dekker_supported,
 	.help = help
 };
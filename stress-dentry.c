@@ -40,6 +40,10 @@
 #define ORDER_RANDOM		(0x03)
 #define ORDER_NONE		(0x04)
 
+#define MDTEST_NONE		(0)	/* default dentry thrashing */
+#define MDTEST_SHARED		(1)	/* all instances in one directory */
+#define MDTEST_UNIQUE		(2)	/* one directory per instance */
+
 typedef struct {
 	const char *name;
 	const uint8_t denty_order;
@@ -48,6 +52,7 @@ typedef struct {
 static const stress_help_t help[] = {
 	{ "D N","dentry N",	  "start N dentry thrashing stressors" },
 	{ NULL,	"dentry-ops N",	  "stop after N dentry bogo operations" },
+	{ NULL,	"dentry-mdtest M", "create/stat/unlink phases in a shared or unique directory" },
 	{ NULL,	"dentry-order O", "specify unlink order (reverse, forward, stride)" },
 	{ NULL,	"dentries N",	  "create N dentries per iteration" },
 	{ NULL,	NULL,		  NULL }
@@ -65,6 +70,17 @@ static const char *stress_dentry_order(const size_t i)
 	return (i < SIZEOF_ARRAY(dentry_removals)) ? dentry_removals[i].name : NULL;
 }
 
+static const char *stress_dentry_mdtest_mode(const size_t i)
+{
+	static const char * const modes[] = {
+		"none",
+		"shared",
+		"unique",
+	};
+
+	return (i < SIZEOF_ARRAY(modes)) ? modes[i] : NULL;
+}
+
 /*
  *  stress_dentry_unlink_file()
  *	unlink a file. if verify mode is enabled, read and check
@@ -303,6 +319,145 @@ static void stress_dentry_misc(const char *path)
 
 }
 
+/*
+ *  stress_dentry_mdtest_filename()
+ *	name of file i of this instance in directory dir
+ */
+static inline void stress_dentry_mdtest_filename(
+	stress_args_t *args,
+	char *path,
+	const size_t len,
+	const char *dir,
+	const uint64_t i)
+{
+	(void)snprintf(path, len, "%s/f-%" PRIu32 "-%" PRIu64, dir, args->instance, i);
+}
+
+/*
+ *  stress_dentry_mdtest()
+ *	mdtest style metadata phases, create, stat and then unlink N
+ *	files, either in one directory shared by all the instances to
+ *	contend on the parent directory inode lock or in a directory
+ *	per instance for comparison
+ */
+static int stress_dentry_mdtest(
+	stress_args_t *args,
+	const size_t mode,
+	const uint64_t dentries)
+{
+	const bool shared = (mode == MDTEST_SHARED);
+	const pid_t ppid = getppid();
+	char dir_path[PATH_MAX];
+	double create_duration = 0.0, create_count = 0.0;
+	double stat_duration = 0.0, stat_count = 0.0;
+	double unlink_duration = 0.0, unlink_count = 0.0;
+	int ret, rc = EXIT_SUCCESS;
+	const char *desc;
+
+	if (shared) {
+		/* all instances use the same directory */
+		(void)stress_temp_dir(dir_path, sizeof(dir_path), args->name, ppid, 0);
+		if ((mkdir(dir_path, S_IRWXU) < 0) && (errno != EEXIST)) {
+			rc = stress_exit_status(errno);
+			pr_fail("%s: mkdir %s failed, errno=%d (%s)\n",
+				args->name, dir_path, errno, strerror(errno));
+			return rc;
+		}
+	} else {
+		ret = stress_temp_dir_mk_args(args);
+		if (ret < 0)
+			return stress_exit_status(-ret);
+		(void)stress_temp_dir(dir_path, sizeof(dir_path), args->name,
+			args->pid, args->instance);
+	}
+
+	stress_set_proc_state(args->name, STRESS_STATE_SYNC_WAIT);
+	stress_sync_start_wait(args);
+	stress_set_proc_state(args->name, STRESS_STATE_RUN);
+
+	do {
+		uint64_t i, n = dentries;
+		char path[PATH_MAX + 48];
+		double t;
+
+		t = stress_time_now();
+		for (i = 0; i < n; i++) {
+			int fd;
+
+			if (UNLIKELY(!stress_continue(args)))
+				break;
+			stress_dentry_mdtest_filename(args, path, sizeof(path), dir_path, i);
+			fd = open(path, O_CREAT | O_EXCL | O_WRONLY, S_IRUSR | S_IWUSR);
+			if (UNLIKELY(fd < 0)) {
+				if ((errno != ENOSPC) && (errno != EDQUOT)) {
+					pr_fail("%s: open %s failed, errno=%d (%s)\n",
+						args->name, path, errno, strerror(errno));
+					rc = EXIT_FAILURE;
+				}
+				break;
+			}
+			(void)close(fd);
+			stress_bogo_inc(args);
+		}
+		n = i;
+		create_duration += stress_time_now() - t;
+		create_count += (double)n;
+
+		t = stress_time_now();
+		for (i = 0; LIKELY((i < n) && stress_continue_flag()); i++) {
+			struct stat statbuf;
+
+			stress_dentry_mdtest_filename(args, path, sizeof(path), dir_path, i);
+			if (UNLIKELY(shim_stat(path, &statbuf) < 0)) {
+				pr_fail("%s: stat %s failed, errno=%d (%s)\n",
+					args->name, path, errno, strerror(errno));
+				rc = EXIT_FAILURE;
+				break;
+			}
+		}
+		stat_duration += stress_time_now() - t;
+		stat_count += (double)i;
+
+		/* always remove all the files created */
+		t = stress_time_now();
+		for (i = 0; i < n; i++) {
+			stress_dentry_mdtest_filename(args, path, sizeof(path), dir_path, i);
+			if (UNLIKELY(shim_unlink(path) < 0)) {
+				pr_fail("%s: unlink %s failed, errno=%d (%s)\n",
+					args->name, path, errno, strerror(errno));
+				rc = EXIT_FAILURE;
+			}
+		}
+		unlink_duration += stress_time_now() - t;
+		unlink_count += (double)n;
+	} while ((rc == EXIT_SUCCESS) && stress_continue(args));
+
+	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
+
+	desc = shared ? "shared dir" : "unique dir";
+	if (create_duration > 0.0) {
+		char str[64];
+
+		(void)snprintf(str, sizeof(str), "creates per sec (%s)", desc);
+		stress_metrics_set(args, 0, str, create_count / create_duration,
+			STRESS_METRIC_HARMONIC_MEAN);
+		(void)snprintf(str, sizeof(str), "stats per sec (%s)", desc);
+		stress_metrics_set(args, 1, str, (stat_duration > 0.0) ?
+			stat_count / stat_duration : 0.0, STRESS_METRIC_HARMONIC_MEAN);
+		(void)snprintf(str, sizeof(str), "unlinks per sec (%s)", desc);
+		stress_metrics_set(args, 2, str, (unlink_duration > 0.0) ?
+			unlink_count / unlink_duration : 0.0, STRESS_METRIC_HARMONIC_MEAN);
+	}
+
+	if (shared) {
+		/* last instance out removes the shared directory */
+		(void)shim_rmdir(dir_path);
+	} else {
+		(void)stress_temp_dir_rm_args(args);
+	}
+	return rc;
+}
+
 /*
  *  stress_dentry
  *	stress dentries.  file names are based
@@ -323,6 +478,7 @@ static int stress_dentry(stress_args_t *args)
 	double bogus_unlink_duration = 0.0, bogus_unlink_count = 0.0;
 	double rate;
 	const bool verify = !!(g_opt_flags & OPT_FLAGS_VERIFY);
+	size_t dentry_mdtest = MDTEST_NONE;
 
 	if (!stress_get_setting("dentries", &dentries)) {
 		if (g_opt_flags & OPT_FLAGS_MAXIMIZE)
@@ -331,6 +487,9 @@ static int stress_dentry(stress_args_t *args)
 			dentries = MIN_DENTRIES;
 	}
 	(void)stress_get_setting("dentry-order", &dentry_order);
+	(void)stress_get_setting("dentry-mdtest", &dentry_mdtest);
+	if (dentry_mdtest != MDTEST_NONE)
+		return stress_dentry_mdtest(args, dentry_mdtest, dentries);
 
 	ret = stress_temp_dir_mk_args(args);
 	if (ret < 0)
@@ -478,8 +637,9 @@ abort:
 }
 
 static const stress_opt_t opts[] = {
-	{ OPT_dentries,	    "dentries",     TYPE_ID_UINT64, MIN_DENTRIES, MAX_DENTRIES, NULL },
-	{ OPT_dentry_order, "dentry-order", TYPE_ID_SIZE_T_METHOD, 0, 0, stress_dentry_order },
+	{ OPT_dentries,	     "dentries",      TYPE_ID_UINT64, MIN_DENTRIES, MAX_DENTRIES, NULL },
+	{ OPT_dentry_mdtest, "dentry-mdtest", TYPE_ID_SIZE_T_METHOD, 0, 0, stress_dentry_mdtest_mode },
+	{ OPT_dentry_order,  "dentry-order",  TYPE_ID_SIZE_T_METHOD, 0, 0, stress_dentry_order },
 	END_OPT,
 };
 
@@ -488,5 +648,6 @@ const stressor_info_t stress_dentry_info = {
 	.class = CLASS_FILESYSTEM | CLASS_OS,
 	.opts = opts,
 	.verify = VERIFY_OPTIONAL,
+	.metrics_max = 4,
 	.help = help
 };
@@ -248,5 +248,6 @@ const stressor_info_t stress_dirmany_info = {
 	.class = CLASS_FILESYSTEM | CLASS_OS,
 	.opts = opts,
 	.verify = VERIFY_ALWAYS,
+	.metrics_max = 4,
 	.help = help
 };
@@ -427,5 +427,6 @@ const stressor_info_t stress_dup_info = {
 	.stressor = stress_dup,
 	.class = CLASS_FILESYSTEM | CLASS_OS,
 	.verify = VERIFY_ALWAYS,
+	.metrics_max = 1,
 	.help = help
 };
@@ -195,6 +195,7 @@ tidy:
 const stressor_info_t stress_dynlib_info = {
 	.stressor = stress_dynlib,
 	.class = CLASS_OS,
+	.metrics_max = 1,
 	.help = help
 };
 #else
@@ -567,6 +567,7 @@ const stressor_info_t stress_efivar_info = {
 	.supported = stress_efivar_supported,
 	.class = CLASS_OS,
 	.verify = VERIFY_ALWAYS,
+	.metrics_max = 1,
 	.help = help
 };
 #else
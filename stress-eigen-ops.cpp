@@ -26,8 +26,74 @@ double stress_time_now(void);
 #if defined(HAVE_EIGEN)
 
 #include <eigen3/Eigen/Dense>
+#include <functional>
+#if defined(HAVE_LIB_PTHREAD)
+#include <pthread.h>
+#endif
 using namespace Eigen;
 
+static size_t eigen_threads = 1;
+
+typedef std::function<void(const Index col, const Index cols)> eigen_cols_func_t;
+
+typedef struct {
+	const eigen_cols_func_t *func;	/* columns worker */
+	Index col;			/* first column */
+	Index cols;			/* number of columns */
+} eigen_cols_t;
+
+#if defined(HAVE_LIB_PTHREAD)
+static void *eigen_cols_thread(void *arg)
+{
+	const eigen_cols_t *cols = static_cast<const eigen_cols_t *>(arg);
+
+	(*cols->func)(cols->col, cols->cols);
+	return NULL;
+}
+#endif
+
+/*
+ *  eigen_parallel_cols()
+ *	split the size columns of a result into eigen_threads
+ *	contiguous blocks, the caller computes the first block
+ *	and pthreads the others. Eigen only threads itself with
+ *	OpenMP so the work is partitioned explicitly
+ */
+static void eigen_parallel_cols(const size_t size, const eigen_cols_func_t &func)
+{
+#if defined(HAVE_LIB_PTHREAD)
+	const size_t threads = (eigen_threads < size) ? eigen_threads : size;
+	pthread_t pthreads[EIGEN_THREADS_MAX];
+	eigen_cols_t cols[EIGEN_THREADS_MAX];
+	bool created[EIGEN_THREADS_MAX];
+	size_t i;
+
+	if (threads <= 1) {
+		func(0, (Index)size);
+		return;
+	}
+	for (i = 0; i < threads; i++) {
+		const size_t col = (size * i) / threads;
+
+		cols[i].func = &func;
+		cols[i].col = (Index)col;
+		cols[i].cols = (Index)(((size * (i + 1)) / threads) - col);
+		created[i] = false;
+	}
+	for (i = 1; i < threads; i++)
+		created[i] = (pthread_create(&pthreads[i], NULL, eigen_cols_thread, &cols[i]) == 0);
+	func(cols[0].col, cols[0].cols);
+	for (i = 1; i < threads; i++) {
+		if (created[i])
+			(void)pthread_join(pthreads[i], NULL);
+		else
+			func(cols[i].col, cols[i].cols);
+	}
+#else
+	func(0, (Index)size);
+#endif
+}
+
 template <typename T> static int eigen_add(const size_t size, double *duration, double *count)
 {
 	try {
@@ -38,14 +104,20 @@ template <typename T> static int eigen_add(const size_t size, double *duration,
 
 		a = matrix::Random(size, size);
 		b = matrix::Random(size, size);
+		result.resize(size, size);
+		result_check.resize(size, size);
 
 		t = stress_time_now();
-		result = a + b;
+		eigen_parallel_cols(size, [&](const Index col, const Index cols) {
+			result.middleCols(col, cols) = a.middleCols(col, cols) + b.middleCols(col, cols);
+		});
 		*duration += stress_time_now() - t;
 		*count += 1.0;
 
 		t = stress_time_now();
-		result_check = a + b;
+		eigen_parallel_cols(size, [&](const Index col, const Index cols) {
+			result_check.middleCols(col, cols) = a.middleCols(col, cols) + b.middleCols(col, cols);
+		});
 		*duration += stress_time_now() - t;
 		*count += 1.0;
 
@@ -68,14 +140,20 @@ template <typename T> static int eigen_multiply(const size_t size, double *durat
 
 		a = matrix::Random(size, size);
 		b = matrix::Random(size, size);
+		result.resize(size, size);
+		result_check.resize(size, size);
 
 		t = stress_time_now();
-		result = a * b;
+		eigen_parallel_cols(size, [&](const Index col, const Index cols) {
+			result.middleCols(col, cols).noalias() = a * b.middleCols(col, cols);
+		});
 		*duration += stress_time_now() - t;
 		*count += 1.0;
 
 		t = stress_time_now();
-		result_check = a * b;
+		eigen_parallel_cols(size, [&](const Index col, const Index cols) {
+			result_check.middleCols(col, cols).noalias() = a * b.middleCols(col, cols);
+		});
 		*duration += stress_time_now() - t;
 		*count += 1.0;
 
@@ -97,14 +175,20 @@ template <typename T> static int eigen_transpose(const size_t size, double *dura
 		bool r;
 
 		a = matrix::Random(size, size);
+		result.resize(size, size);
+		result_check.resize(size, size);
 
 		t = stress_time_now();
-		result = a.transpose();
+		eigen_parallel_cols(size, [&](const Index col, const Index cols) {
+			result.middleCols(col, cols) = a.middleRows(col, cols).transpose();
+		});
 		*duration += stress_time_now() - t;
 		*count += 1.0;
 
 		t = stress_time_now();
-		result_check = a.transpose();
+		eigen_parallel_cols(size, [&](const Index col, const Index cols) {
+			result_check.middleCols(col, cols) = a.middleRows(col, cols).transpose();
+		});
 		*duration += stress_time_now() - t;
 		*count += 1.0;
 
@@ -177,6 +261,11 @@ template <typename T> static int eigen_determinant(const size_t size, double *du
 
 extern "C" {
 
+void eigen_set_threads(const size_t threads)
+{
+	eigen_threads = (threads < 1) ? 1 : ((threads > EIGEN_THREADS_MAX) ? EIGEN_THREADS_MAX : threads);
+}
+
 int eigen_add_long_double(const size_t size, double *duration, double *count)
 {
 	return eigen_add<long double>(size, duration, count);
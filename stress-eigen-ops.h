@@ -21,6 +21,9 @@
 
 #include <stdlib.h>
 
+#define EIGEN_THREADS_MAX	(256)
+
+extern void eigen_set_threads(const size_t threads);
 extern int eigen_add_long_double(const size_t size, double *duration, double *count);
 extern int eigen_add_double(const size_t size, double *duration, double *count);
 extern int eigen_add_float(const size_t size, double *duration, double *count);
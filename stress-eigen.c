@@ -23,12 +23,12 @@
 #define MAX_MATRIX_SIZE		(1024)
 #define DEFAULT_MATRIX_SIZE	(32)
 
-
 static const stress_help_t help[] = {
 	{ NULL,	"eigen N",	  "start N workers exercising eigen operations" },
 	{ NULL,	"eigen-method M", "specify eigen stress method M, default is all" },
 	{ NULL,	"eigen-ops N",	  "stop after N maxtrix bogo operations" },
 	{ NULL,	"eigen-size N",	  "specify the size of the N x N eigen" },
+	{ NULL,	"eigen-threads N", "use N threads for add, multiply and transpose" },
 	{ NULL,	NULL,		  NULL }
 };
 
@@ -39,9 +39,20 @@ static const stress_help_t help[] = {
  */
 typedef int (*stress_eigen_func_t)(const size_t size, double *duration, double *count);
 
+typedef enum {
+	EIGEN_OP_NONE,
+	EIGEN_OP_ADD,
+	EIGEN_OP_DETERMINANT,
+	EIGEN_OP_INVERSE,
+	EIGEN_OP_MULTIPLY,
+	EIGEN_OP_TRANSPOSE,
+} stress_eigen_op_t;
+
 typedef struct {
 	const char			*name;		/* human readable form of stressor */
 	const stress_eigen_func_t	func;		/* method functions */
+	const stress_eigen_op_t		op;		/* operation, for flop and byte counts */
+	const size_t			elem_size;	/* size of a matrix element */
 } stress_eigen_method_info_t;
 
 static const char *current_method = NULL;		/* current eigen method */
@@ -58,22 +69,22 @@ static int stress_eigen_all();
  * Table of eigen stress methods, ordered x by y and y by x
  */
 static const stress_eigen_method_info_t eigen_methods[] = {
-	{ "all",			stress_eigen_all },
-	{ "add-longdouble",		eigen_add_long_double, },
-	{ "add-double",			eigen_add_double, },
-	{ "add-float",			eigen_add_float, },
-	{ "determinant-longdouble",	eigen_determinant_long_double, },
-	{ "determinant-double",		eigen_determinant_double, },
-	{ "determinant-float",		eigen_determinant_float, },
-	{ "inverse-longdouble",		eigen_inverse_long_double, },
-	{ "inverse-double",		eigen_inverse_double, },
-	{ "inverse-float",		eigen_inverse_float, },
-	{ "multiply-longdouble",	eigen_multiply_long_double, },
-	{ "multiply-double",		eigen_multiply_double, },
-	{ "multiply-float",		eigen_multiply_float, },
-	{ "transpose-longdouble",	eigen_transpose_long_double, },
-	{ "transpose-double",		eigen_transpose_double, },
-	{ "transpose-float",		eigen_transpose_float, },
+	{ "all",			stress_eigen_all,		EIGEN_OP_NONE,		0 },
+	{ "add-longdouble",		eigen_add_long_double,		EIGEN_OP_ADD,		sizeof(long double) },
+	{ "add-double",			eigen_add_double,		EIGEN_OP_ADD,		sizeof(double) },
+	{ "add-float",			eigen_add_float,		EIGEN_OP_ADD,		sizeof(float) },
+	{ "determinant-longdouble",	eigen_determinant_long_double,	EIGEN_OP_DETERMINANT,	sizeof(long double) },
+	{ "determinant-double",		eigen_determinant_double,	EIGEN_OP_DETERMINANT,	sizeof(double) },
+	{ "determinant-float",		eigen_determinant_float,	EIGEN_OP_DETERMINANT,	sizeof(float) },
+	{ "inverse-longdouble",		eigen_inverse_long_double,	EIGEN_OP_INVERSE,	sizeof(long double) },
+	{ "inverse-double",		eigen_inverse_double,		EIGEN_OP_INVERSE,	sizeof(double) },
+	{ "inverse-float",		eigen_inverse_float,		EIGEN_OP_INVERSE,	sizeof(float) },
+	{ "multiply-longdouble",	eigen_multiply_long_double,	EIGEN_OP_MULTIPLY,	sizeof(long double) },
+	{ "multiply-double",		eigen_multiply_double,		EIGEN_OP_MULTIPLY,	sizeof(double) },
+	{ "multiply-float",		eigen_multiply_float,		EIGEN_OP_MULTIPLY,	sizeof(float) },
+	{ "transpose-longdouble",	eigen_transpose_long_double,	EIGEN_OP_TRANSPOSE,	sizeof(long double) },
+	{ "transpose-double",		eigen_transpose_double,		EIGEN_OP_TRANSPOSE,	sizeof(double) },
+	{ "transpose-float",		eigen_transpose_float,		EIGEN_OP_TRANSPOSE,	sizeof(float) },
 };
 
 #define NUM_EIGEN_METHODS	(SIZEOF_ARRAY(eigen_methods))
@@ -108,6 +119,47 @@ static int stress_eigen_all(
 	return rc;
 }
 
+/*
+ *  stress_eigen_flops()
+ *	nominal floating point operations of an n x n operation,
+ *	inverse is LU factorisation plus n triangular solves
+ */
+static double stress_eigen_flops(const stress_eigen_op_t op, const double n)
+{
+	switch (op) {
+	case EIGEN_OP_ADD:
+		return n * n;
+	case EIGEN_OP_DETERMINANT:
+		return (2.0 * n * n * n) / 3.0;
+	case EIGEN_OP_INVERSE:
+	case EIGEN_OP_MULTIPLY:
+		return 2.0 * n * n * n;
+	default:
+		return 0.0;
+	}
+}
+
+/*
+ *  stress_eigen_matrices()
+ *	number of n x n matrices read or written by an operation,
+ *	the minimum memory traffic assuming perfect cache reuse
+ */
+static double stress_eigen_matrices(const stress_eigen_op_t op)
+{
+	switch (op) {
+	case EIGEN_OP_ADD:
+	case EIGEN_OP_MULTIPLY:
+		return 3.0;
+	case EIGEN_OP_INVERSE:
+	case EIGEN_OP_TRANSPOSE:
+		return 2.0;
+	case EIGEN_OP_DETERMINANT:
+		return 1.0;
+	default:
+		return 0.0;
+	}
+}
+
 static inline int stress_eigen_exercise(
 	stress_args_t *args,
 	const size_t eigen_method,
@@ -155,10 +207,25 @@ static inline int stress_eigen_exercise(
 			char msg[64];
 			const double rate = eigen_metrics[i].count / eigen_metrics[i].duration;
 
+			const double n = (double)eigen_size;
+			const double flops = stress_eigen_flops(eigen_methods[i].op, n);
+			const double bytes = stress_eigen_matrices(eigen_methods[i].op) *
+					     n * n * (double)eigen_methods[i].elem_size;
+
 			(void)snprintf(msg, sizeof(msg), "%s matrix %zd x %zd ops per sec",
 				eigen_methods[i].name, eigen_size, eigen_size);
 			stress_metrics_set(args, j, msg, rate, STRESS_METRIC_HARMONIC_MEAN);
 			j++;
+			if (flops > 0.0) {
+				(void)snprintf(msg, sizeof(msg), "%s GFLOPS", eigen_methods[i].name);
+				stress_metrics_set(args, j, msg, rate * flops / 1.0E9,
+					STRESS_METRIC_HARMONIC_MEAN);
+				j++;
+			}
+			(void)snprintf(msg, sizeof(msg), "%s GB per sec", eigen_methods[i].name);
+			stress_metrics_set(args, j, msg, rate * bytes / (double)GB,
+				STRESS_METRIC_HARMONIC_MEAN);
+			j++;
 		}
 	}
 
@@ -173,10 +240,13 @@ static int stress_eigen(stress_args_t *args)
 {
 	size_t eigen_method = 0;	/* All method */
 	size_t eigen_size = DEFAULT_MATRIX_SIZE;
+	size_t eigen_threads = 1;
 	int rc;
 
 	(void)stress_get_setting("eigen-method", &eigen_method);
 	(void)stress_get_setting("eigen-size", &eigen_size);
+	(void)stress_get_setting("eigen-threads", &eigen_threads);
+	eigen_set_threads(eigen_threads);
 
 	if (!stress_get_setting("eigen-size", &eigen_size)) {
 		if (g_opt_flags & OPT_FLAGS_MAXIMIZE)
@@ -199,6 +269,7 @@ static int stress_eigen(stress_args_t *args)
 static const stress_opt_t opts[] = {
 	{ OPT_eigen_method, "eigen-method",  TYPE_ID_SIZE_T_METHOD, 0, 0, stress_eigen_method },
 	{ OPT_eigen_size,   "eigen-size",    TYPE_ID_SIZE_T, MIN_MATRIX_SIZE, MAX_MATRIX_SIZE, NULL },
+	{ OPT_eigen_threads, "eigen-threads", TYPE_ID_SIZE_T, 1, EIGEN_THREADS_MAX, NULL },
 	END_OPT,
 };
 
@@ -215,6 +286,7 @@ const stressor_info_t stress_eigen_info = {
 static const stress_opt_t opts[] = {
 	{ OPT_eigen_method, "eigen-method",  TYPE_ID_SIZE_T_METHOD, 0, 0, stress_unimplemented_method },
 	{ OPT_eigen_size,   "eigen-size",    TYPE_ID_SIZE_T, MIN_MATRIX_SIZE, MAX_MATRIX_SIZE, NULL },
+	{ OPT_eigen_threads, "eigen-threads", TYPE_ID_SIZE_T, 1, EIGEN_THREADS_MAX, NULL },
 	END_OPT,
 };
 
@@ -25,6 +25,8 @@
 
 #include <time.h>
 
+#include <sys/ioctl.h>
+
 #if defined(HAVE_SYS_UN_H)
 #include <sys/un.h>
 #endif
@@ -40,13 +42,47 @@
 #define MIN_EPOLL_SOCKETS	(64)
 #define MAX_EPOLL_SOCKETS	(100000)
 #define DEFAULT_EPOLL_SOCKETS	(4096)
+#define MIN_EPOLL_WAITERS	(1)
+#define MAX_EPOLL_WAITERS	(1024)
+#define MIN_EPOLL_BUSY_POLL	(1)
+#define MAX_EPOLL_BUSY_POLL	(1000000)
+#define MIN_EPOLL_BUSY_POLL_BUDGET	(1)
+#define MAX_EPOLL_BUSY_POLL_BUDGET	(65535)
+#define DEFAULT_EPOLL_BUSY_POLL_BUDGET	(8)
+
+/* kernel ABI of the EPIOCSPARAMS epoll busy poll parameters */
+typedef struct {
+	uint32_t busy_poll_usecs;
+	uint16_t busy_poll_budget;
+	uint8_t prefer_busy_poll;
+	uint8_t pad;
+} stress_epoll_params_t;
+
+#if defined(__linux__) &&	\
+    defined(_IOW) &&		\
+    !defined(EPIOCSPARAMS)
+#define EPIOCSPARAMS		_IOW(0x8A, 0x01, stress_epoll_params_t)
+#endif
+
+/* per waiter process statistics for the --epoll-waiters mode */
+typedef struct {
+	uint64_t wakeups;	/* epoll_wait returns with an event */
+	uint64_t spurious;	/* wakeups that found no connection to accept */
+	uint64_t events;	/* connections accepted */
+	uint64_t nvcsw;		/* voluntary context switches */
+	double latency;		/* total connect to wakeup latency in seconds */
+} stress_epoll_waiter_t;
 
 static const stress_help_t help[] = {
 	{ NULL,	"epoll N",	  	"start N workers doing epoll handled socket activity" },
+	{ NULL,	"epoll-busy-poll N",	"busy poll for N microseconds in --epoll-waiters mode" },
+	{ NULL,	"epoll-busy-poll-budget N", "busy poll packet budget, default 8" },
 	{ NULL,	"epoll-domain D", 	"specify socket domain, default is unix" },
+	{ NULL,	"epoll-exclusive",	"add the listener with EPOLLEXCLUSIVE in --epoll-waiters mode" },
 	{ NULL,	"epoll-ops N",	  	"stop after N epoll bogo operations" },
 	{ NULL,	"epoll-port P",	  	"use socket ports P upwards" },
 	{ NULL, "epoll-sockets N",	"specify maximum number of open sockets" },
+	{ NULL, "epoll-waiters N",	"N processes epoll wait on one shared listening socket" },
 	{ NULL,	NULL,			NULL }
 };
 
@@ -74,9 +110,13 @@ static timer_t epoll_timerid;
 static int epoll_domain_mask = DOMAIN_ALL;
 
 static const stress_opt_t opts[] = {
+	{ OPT_epoll_busy_poll,	      "epoll-busy-poll",	TYPE_ID_UINT32,	MIN_EPOLL_BUSY_POLL, MAX_EPOLL_BUSY_POLL, NULL },
+	{ OPT_epoll_busy_poll_budget, "epoll-busy-poll-budget", TYPE_ID_UINT32, MIN_EPOLL_BUSY_POLL_BUDGET, MAX_EPOLL_BUSY_POLL_BUDGET, NULL },
 	{ OPT_epoll_domain,  "epoll-domain",  TYPE_ID_INT_DOMAIN, 0, 0, &epoll_domain_mask },
+	{ OPT_epoll_exclusive, "epoll-exclusive", TYPE_ID_BOOL,   0, 1, NULL },
 	{ OPT_epoll_port,    "epoll-port",    TYPE_ID_INT_PORT,   MIN_PORT, MAX_PORT, NULL },
 	{ OPT_epoll_sockets, "epoll-sockets", TYPE_ID_INT,        MIN_EPOLL_SOCKETS, MAX_EPOLL_SOCKETS, NULL },
+	{ OPT_epoll_waiters, "epoll-waiters", TYPE_ID_INT,        MIN_EPOLL_WAITERS, MAX_EPOLL_WAITERS, NULL },
 	END_OPT,
 };
 
@@ -963,6 +1003,342 @@ die:
 	_exit(rc);
 }
 
+/*
+ *  epoll_busy_poll()
+ *	enable socket busy polling on fd and, if efd is valid, epoll
+ *	busy polling with the given packet budget, ignore failures
+ *	as older kernels or unprivileged users may not support them
+ */
+static void epoll_busy_poll(
+	stress_args_t *args,
+	const int efd,
+	const int fd,
+	const uint32_t busy_poll,
+	const uint32_t busy_poll_budget)
+{
+#if defined(SO_BUSY_POLL)
+	{
+		int val = (int)busy_poll;
+
+		VOID_RET(int, setsockopt(fd, SOL_SOCKET, SO_BUSY_POLL, &val, sizeof(val)));
+	}
+#endif
+#if defined(SO_BUSY_POLL_BUDGET)
+	{
+		int val = (int)busy_poll_budget;
+
+		VOID_RET(int, setsockopt(fd, SOL_SOCKET, SO_BUSY_POLL_BUDGET, &val, sizeof(val)));
+	}
+#endif
+#if defined(EPIOCSPARAMS)
+	if (efd >= 0) {
+		stress_epoll_params_t params;
+
+		(void)shim_memset(&params, 0, sizeof(params));
+		params.busy_poll_usecs = busy_poll;
+		params.busy_poll_budget = (uint16_t)busy_poll_budget;
+		params.prefer_busy_poll = 1;
+		if ((ioctl(efd, EPIOCSPARAMS, &params) < 0) && (args->instance == 0))
+			pr_dbg("%s: epoll EPIOCSPARAMS busy poll failed, errno=%d (%s)\n",
+				args->name, errno, strerror(errno));
+	}
+#else
+	(void)args;
+	(void)efd;
+#endif
+#if !defined(SO_BUSY_POLL) &&	\
+    !defined(SO_BUSY_POLL_BUDGET)
+	(void)fd;
+	(void)busy_poll;
+	(void)busy_poll_budget;
+#endif
+}
+
+/*
+ *  epoll_waiter()
+ *	wait on the shared listening socket sfd with a private epoll
+ *	instance, every wakeup that finds no connection to accept is
+ *	spurious. The client sends the time it started to connect so
+ *	the event delivery latency can be measured
+ */
+static void NORETURN epoll_waiter(
+	stress_args_t *args,
+	const int sfd,
+	const bool epoll_exclusive,
+	const uint32_t busy_poll,
+	const uint32_t busy_poll_budget,
+	stress_epoll_waiter_t *waiter)
+{
+	int efd, rc = EXIT_SUCCESS;
+	uint32_t events = EPOLLIN;
+
+#if defined(EPOLLEXCLUSIVE)
+	if (epoll_exclusive)
+		events |= EPOLLEXCLUSIVE;
+#else
+	(void)epoll_exclusive;
+#endif
+	efd = epoll_create(1);
+	if (efd < 0) {
+		pr_fail("%s: epoll_create failed, errno=%d (%s)\n",
+			args->name, errno, strerror(errno));
+		_exit(EXIT_FAILURE);
+	}
+	if (epoll_ctl_add(efd, sfd, events) < 0) {
+		pr_fail("%s: epoll_ctl_add failed, errno=%d (%s)\n",
+			args->name, errno, strerror(errno));
+		(void)close(efd);
+		_exit(EXIT_FAILURE);
+	}
+	if (busy_poll)
+		epoll_busy_poll(args, efd, sfd, busy_poll, busy_poll_budget);
+
+	while (stress_continue_flag()) {
+		struct epoll_event event;
+		double t_wake, t_sent;
+		int n, fd;
+#if defined(HAVE_GETRUSAGE) &&	\
+    defined(RUSAGE_SELF)
+		struct rusage usage;
+#endif
+
+		n = epoll_wait(efd, &event, 1, 100);
+#if defined(HAVE_GETRUSAGE) &&	\
+    defined(RUSAGE_SELF)
+		/*
+		 *  the kernel re-checks readiness before returning so
+		 *  herd wakeups that lose the race to accept are mostly
+		 *  invisible to epoll_wait, they do show up as context
+		 *  switches though
+		 */
+		if (LIKELY(shim_getrusage(RUSAGE_SELF, &usage) == 0))
+			waiter->nvcsw = (uint64_t)usage.ru_nvcsw;
+#endif
+		if (n <= 0) {
+			if ((n < 0) && (errno != EINTR)) {
+				pr_fail("%s: epoll_wait failed, errno=%d (%s)\n",
+					args->name, errno, strerror(errno));
+				rc = EXIT_FAILURE;
+				break;
+			}
+			continue;
+		}
+		t_wake = stress_time_now();
+		waiter->wakeups++;
+
+		fd = accept(sfd, NULL, NULL);
+		if (fd < 0) {
+			if ((errno == EAGAIN) || (errno == EWOULDBLOCK)) {
+				/* another waiter got the connection */
+				waiter->spurious++;
+				continue;
+			}
+			if ((errno == EINTR) || (errno == ECONNABORTED) ||
+			    (errno == EMFILE) || (errno == ENFILE))
+				continue;
+			pr_fail("%s: accept failed, errno=%d (%s)\n",
+				args->name, errno, strerror(errno));
+			rc = EXIT_FAILURE;
+			break;
+		}
+		if (busy_poll)
+			epoll_busy_poll(args, -1, fd, busy_poll, busy_poll_budget);
+		if (recv(fd, &t_sent, sizeof(t_sent), MSG_WAITALL) == (ssize_t)sizeof(t_sent)) {
+			waiter->events++;
+			if (t_wake > t_sent)
+				waiter->latency += t_wake - t_sent;
+		}
+		(void)close(fd);
+	}
+	(void)close(efd);
+	_exit(rc);
+}
+
+/*
+ *  stress_epoll_waiters()
+ *	thundering herd mode, epoll_waiters processes each wait on
+ *	their own epoll instance for connections on one shared listening
+ *	socket. The stressor makes one connection at a time and waits for
+ *	it to be closed, so without EPOLLEXCLUSIVE all the waiters are
+ *	woken for every connection
+ */
+static int stress_epoll_waiters(
+	stress_args_t *args,
+	const pid_t mypid,
+	const int epoll_port,
+	const int epoll_domain,
+	const int epoll_waiters,
+	const bool epoll_exclusive,
+	const uint32_t busy_poll,
+	const uint32_t busy_poll_budget)
+{
+	stress_pid_t *s_pids, *s_pids_head = NULL;
+	stress_epoll_waiter_t *waiters;
+	const size_t waiters_size = sizeof(*waiters) * (size_t)epoll_waiters;
+	struct sockaddr *addr = NULL;
+	socklen_t addr_len = 0;
+	int sfd, i, so_reuseaddr = 1, rc = EXIT_SUCCESS;
+	const int port = epoll_port + (int)args->instance;
+	uint64_t wakeups = 0, spurious = 0, events = 0, nvcsw = 0;
+	double latency = 0.0, rate;
+
+	s_pids = stress_s_pids_mmap((size_t)epoll_waiters);
+	if (s_pids == MAP_FAILED) {
+		pr_inf_skip("%s: failed to mmap %d PIDs, skipping stressor\n",
+			args->name, epoll_waiters);
+		return EXIT_NO_RESOURCE;
+	}
+	waiters = (stress_epoll_waiter_t *)stress_mmap_populate(NULL, waiters_size,
+		PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+	if (waiters == MAP_FAILED) {
+		pr_inf_skip("%s: failed to mmap %zu bytes of waiter statistics, skipping stressor\n",
+			args->name, waiters_size);
+		(void)stress_s_pids_munmap(s_pids, (size_t)epoll_waiters);
+		return EXIT_NO_RESOURCE;
+	}
+	stress_set_vma_anon_name(waiters, waiters_size, "epoll-waiters");
+
+	if ((sfd = socket(epoll_domain, SOCK_STREAM, 0)) < 0) {
+		pr_fail("%s: socket failed, errno=%d (%s)\n",
+			args->name, errno, strerror(errno));
+		rc = EXIT_FAILURE;
+		goto unmap;
+	}
+	if (setsockopt(sfd, SOL_SOCKET, SO_REUSEADDR,
+			&so_reuseaddr, sizeof(so_reuseaddr)) < 0) {
+		pr_fail("%s: setsockopt SO_REUSEADDR failed, errno=%d (%s)\n",
+			args->name, errno, strerror(errno));
+		rc = EXIT_FAILURE;
+		goto close_sfd;
+	}
+	if (stress_set_sockaddr(args->name, args->instance, mypid,
+		epoll_domain, port, &addr, &addr_len, NET_ADDR_ANY) < 0) {
+		rc = EXIT_FAILURE;
+		goto close_sfd;
+	}
+	if (bind(sfd, addr, addr_len) < 0) {
+		pr_fail("%s: bind failed, errno=%d (%s)\n",
+			args->name, errno, strerror(errno));
+		rc = EXIT_FAILURE;
+		goto close_sfd;
+	}
+	if ((epoll_set_fd_nonblock(sfd) < 0) || (listen(sfd, SOMAXCONN) < 0)) {
+		pr_fail("%s: listen failed, errno=%d (%s)\n",
+			args->name, errno, strerror(errno));
+		rc = EXIT_FAILURE;
+		goto close_sfd;
+	}
+
+	for (i = 0; i < epoll_waiters; i++) {
+		stress_sync_start_init(&s_pids[i]);
+again:
+		s_pids[i].pid = fork();
+		if (s_pids[i].pid < 0) {
+			if (stress_redo_fork(args, errno))
+				goto again;
+			pr_fail("%s: fork failed, errno=%d (%s)\n",
+				args->name, errno, strerror(errno));
+			rc = EXIT_FAILURE;
+			goto reap;
+		} else if (s_pids[i].pid == 0) {
+			s_pids[i].pid = getpid();
+			stress_parent_died_alarm();
+			(void)sched_settings_apply(true);
+			stress_sync_start_wait_s_pid(&s_pids[i]);
+
+			epoll_waiter(args, sfd, epoll_exclusive, busy_poll,
+				busy_poll_budget, &waiters[i]);
+		}
+		stress_sync_start_s_pid_list_add(&s_pids_head, &s_pids[i]);
+	}
+
+	stress_set_proc_state(args->name, STRESS_STATE_SYNC_WAIT);
+	stress_sync_start_wait(args);
+	stress_sync_start_cont_list(s_pids_head);
+	stress_set_proc_state(args->name, STRESS_STATE_RUN);
+
+	do {
+		struct timeval tv;
+		double t;
+		char ch;
+		int fd;
+
+		if (UNLIKELY((fd = socket(epoll_domain, SOCK_STREAM, 0)) < 0)) {
+			if ((errno == EMFILE) || (errno == ENFILE) ||
+			    (errno == ENOMEM) || (errno == ENOBUFS))
+				continue;
+			pr_fail("%s: socket failed, errno=%d (%s)\n",
+				args->name, errno, strerror(errno));
+			rc = EXIT_FAILURE;
+			break;
+		}
+		/* don't block forever if a waiter is killed mid connection */
+		tv.tv_sec = 1;
+		tv.tv_usec = 0;
+		(void)setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+
+		t = stress_time_now();
+		if (UNLIKELY(connect(fd, addr, addr_len) < 0)) {
+			(void)close(fd);
+			if ((errno == EINTR) || (errno == EAGAIN) ||
+			    (errno == ECONNREFUSED) || (errno == EADDRNOTAVAIL)) {
+				(void)shim_usleep(10000);
+				continue;
+			}
+			pr_fail("%s: connect failed, errno=%d (%s)\n",
+				args->name, errno, strerror(errno));
+			rc = EXIT_FAILURE;
+			break;
+		}
+		if (LIKELY(send(fd, &t, sizeof(t), 0) == (ssize_t)sizeof(t))) {
+			/* wait for the waiter to close, one event at a time */
+			VOID_RET(ssize_t, recv(fd, &ch, sizeof(ch), 0));
+			stress_bogo_inc(args);
+		}
+		(void)close(fd);
+	} while (stress_continue(args));
+
+reap:
+	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
+	stress_kill_and_wait_many(args, s_pids, (size_t)epoll_waiters, SIGALRM, true);
+
+	for (i = 0; i < epoll_waiters; i++) {
+		wakeups += waiters[i].wakeups;
+		spurious += waiters[i].spurious;
+		events += waiters[i].events;
+		nvcsw += waiters[i].nvcsw;
+		latency += waiters[i].latency;
+	}
+	rate = (events > 0) ? (double)wakeups / (double)events : 0.0;
+	stress_metrics_set(args, 0, "wakeups per event",
+		rate, STRESS_METRIC_HARMONIC_MEAN);
+	rate = (events > 0) ? (double)spurious / (double)events : 0.0;
+	stress_metrics_set(args, 1, "spurious wakeups per event",
+		rate, STRESS_METRIC_HARMONIC_MEAN);
+	rate = (events > 0) ? (double)nvcsw / (double)events : 0.0;
+	stress_metrics_set(args, 2, "waiter context switches per event",
+		rate, STRESS_METRIC_HARMONIC_MEAN);
+	rate = (events > 0) ? latency / (double)events : 0.0;
+	stress_metrics_set(args, 3, "event delivery latency (usec)",
+		rate * STRESS_DBL_MICROSECOND, STRESS_METRIC_HARMONIC_MEAN);
+
+close_sfd:
+	(void)close(sfd);
+#if defined(AF_UNIX) &&		\
+    defined(HAVE_SOCKADDR_UN)
+	if (addr && (epoll_domain == AF_UNIX)) {
+		const struct sockaddr_un *addr_un = (struct sockaddr_un *)addr;
+
+		(void)shim_unlink(addr_un->sun_path);
+	}
+#endif
+unmap:
+	(void)munmap((void *)waiters, waiters_size);
+	(void)stress_s_pids_munmap(s_pids, (size_t)epoll_waiters);
+
+	return rc;
+}
+
 /*
  *  stress_epoll
  *	stress by heavy socket I/O
@@ -977,9 +1353,17 @@ static int stress_epoll(stress_args_t *args)
 	int epoll_sockets = DEFAULT_EPOLL_SOCKETS;
 	int start_port, end_port, reserved_port;
 	int max_servers;
+	int epoll_waiters = 0;
+	bool epoll_exclusive = false;
+	uint32_t epoll_busy_poll = 0;
+	uint32_t epoll_busy_poll_budget = DEFAULT_EPOLL_BUSY_POLL_BUDGET;
 
+	(void)stress_get_setting("epoll-busy-poll", &epoll_busy_poll);
+	(void)stress_get_setting("epoll-busy-poll-budget", &epoll_busy_poll_budget);
 	(void)stress_get_setting("epoll-domain", &epoll_domain);
+	(void)stress_get_setting("epoll-exclusive", &epoll_exclusive);
 	(void)stress_get_setting("epoll-port", &epoll_port);
+	(void)stress_get_setting("epoll-waiters", &epoll_waiters);
 	if (!stress_get_setting("epoll-sockets", &epoll_sockets)) {
 		if (g_opt_flags & OPT_FLAGS_MAXIMIZE)
 			epoll_sockets = MAX_EPOLL_SOCKETS;
@@ -990,6 +1374,37 @@ static int stress_epoll(stress_args_t *args)
 	if (stress_sighandler(args->name, SIGPIPE, SIG_IGN, NULL) < 0)
 		return EXIT_NO_RESOURCE;
 
+	if ((epoll_exclusive || epoll_busy_poll) && !epoll_waiters) {
+		if (args->instance == 0)
+			pr_inf("%s: --epoll-exclusive and --epoll-busy-poll require "
+				"--epoll-waiters, ignoring them\n", args->name);
+	}
+#if !defined(EPOLLEXCLUSIVE)
+	if (epoll_exclusive && (args->instance == 0))
+		pr_inf("%s: EPOLLEXCLUSIVE is not supported, ignoring --epoll-exclusive\n",
+			args->name);
+#endif
+	if (epoll_waiters) {
+		start_port = epoll_port + (int)args->instance;
+		if (start_port > MAX_PORT)
+			start_port -= (MAX_PORT - MIN_PORT + 1);
+		reserved_port = stress_net_reserve_ports(start_port, start_port);
+		if (reserved_port < 0) {
+			pr_inf_skip("%s: cannot reserve port %d, skipping stressor\n",
+				args->name, start_port);
+			return EXIT_NO_RESOURCE;
+		}
+		epoll_port = reserved_port - (int)args->instance;
+		pr_dbg("%s: process [%" PRIdMAX "] using socket port %d with %d waiters\n",
+			args->name, (intmax_t)args->pid, reserved_port, epoll_waiters);
+
+		rc = stress_epoll_waiters(args, mypid, epoll_port, epoll_domain,
+			epoll_waiters, epoll_exclusive, epoll_busy_poll,
+			epoll_busy_poll_budget);
+		stress_net_release_ports(reserved_port, reserved_port);
+		return rc;
+	}
+
 	s_pids = stress_s_pids_mmap(MAX_SERVERS);
 	if (s_pids == MAP_FAILED) {
 		pr_inf_skip("%s: failed to mmap %d PIDs, skipping stressor\n", args->name, MAX_SERVERS);
@@ -1092,6 +1507,7 @@ const stressor_info_t stress_epoll_info = {
 	.class = CLASS_NETWORK | CLASS_OS,
 	.opts = opts,
 	.verify = VERIFY_ALWAYS,
+	.metrics_max = 4,
 	.help = help
 };
 #else
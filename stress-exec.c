@@ -20,7 +20,10 @@
 #include "stress-ng.h"
 #include "core-builtin.h"
 #include "core-capabilities.h"
+#include "core-killpid.h"
+#include "core-latency.h"
 #include "core-pthread.h"
+#include "core-thrash.h"
 
 #if defined(HAVE_SPAWN_H)
 #include <spawn.h>
@@ -54,6 +57,19 @@ UNEXPECTED
 #define EXEC_FORK_METHOD_RFORK	(0x14)
 #endif
 
+#define EXEC_COLD_NONE		(0)	/* keep target page cache hot */
+#define EXEC_COLD_FADVISE	(1)	/* POSIX_FADV_DONTNEED the target */
+#define EXEC_COLD_DROP_CACHES	(2)	/* drop the entire page cache */
+
+#define EXEC_LAT_EXEC		(0)	/* fork to execve() completed */
+#define EXEC_LAT_MAIN		(1)	/* fork to main() handshake */
+#define EXEC_LAT_EXIT		(2)	/* fork to target exit */
+#define EXEC_LAT_MAX		(3)
+
+#define EXEC_WARM		(0)
+#define EXEC_COLD		(1)
+#define EXEC_TEMPS		(2)
+
 #define MAX_ARG_PAGES		(32)
 
 #define CLONE_STACK_SIZE	(8 * 1024)
@@ -142,10 +158,12 @@ static const stress_help_t help[] = {
 					" vfork"
 #endif
 					"" },
+	{ NULL,	"exec-cold M",		"time exec startup, drop target page cache: none, fadvise, drop-caches" },
 	{ NULL,	"exec-max P",		"create P workers per iteration, default is 4096" },
 	{ NULL,	"exec-method M",	"select exec method: all, execve, execveat" },
 	{ NULL,	"exec-no-pthread",	"do not use pthread_create" },
 	{ NULL,	"exec-ops N",		"stop after N exec bogo operations" },
+	{ NULL,	"exec-prog P",		"time exec startup of program P rather than stress-ng" },
 	{ NULL,	NULL,			NULL },
 };
 
@@ -159,11 +177,24 @@ static const char *stress_exec_fork_method(const size_t i)
 	return (i < SIZEOF_ARRAY(stress_exec_fork_methods)) ? stress_exec_fork_methods[i].name : NULL;
 }
 
+static const char * const stress_exec_colds[] = {
+	"none",
+	"fadvise",
+	"drop-caches",
+};
+
+static const char *stress_exec_cold(const size_t i)
+{
+	return (i < SIZEOF_ARRAY(stress_exec_colds)) ? stress_exec_colds[i] : NULL;
+}
+
 static const stress_opt_t opts[] = {
+	{ OPT_exec_cold,	"exec-cold",        TYPE_ID_SIZE_T_METHOD, 0, 0, stress_exec_cold },
 	{ OPT_exec_max,		"exec-max",         TYPE_ID_INT32, MIN_EXECS, MAX_EXECS, NULL },
 	{ OPT_exec_method,	"exec-method",	    TYPE_ID_SIZE_T_METHOD, 0, 0, stress_exec_method },
 	{ OPT_exec_fork_method,	"exec-fork-method", TYPE_ID_SIZE_T_METHOD, 0, 0, stress_exec_fork_method },
 	{ OPT_exec_no_pthread,	"exec-no-pthread",  TYPE_ID_BOOL, 0, 1, NULL },
+	{ OPT_exec_prog,	"exec-prog",        TYPE_ID_STR, 0, 0, NULL },
 	END_OPT,
 };
 
@@ -312,6 +343,16 @@ static void stress_exec_remove_pid(const pid_t pid)
  */
 static int stress_exec_supported(const char *name)
 {
+	size_t exec_cold;
+	char *exec_target;
+
+	/*
+	 *  The startup latency mode only execs the user specified
+	 *  target, and dropping caches requires root, so allow it
+	 */
+	if (stress_get_setting("exec-cold", &exec_cold) ||
+	    stress_get_setting("exec-prog", &exec_target))
+		return 0;
 	/*
 	 *  Don't want to run this when running as root as
 	 *  this could allow somebody to try and run another
@@ -638,6 +679,298 @@ do_exec:
 	return rc;
 }
 
+/*
+ *  stress_exec_is_dynamic()
+ *	check if a native ELF executable has a PT_INTERP program
+ *	header, returns 1 if dynamically linked, 0 if statically
+ *	linked and -1 if it is not a native ELF executable
+ */
+static int stress_exec_is_dynamic(const char *path)
+{
+	unsigned char ehdr[64];
+	const bool is64 = (sizeof(void *) == 8);
+	uint64_t phoff;
+	uint16_t phentsize, phnum, i;
+	int fd, ret = -1;
+
+	fd = open(path, O_RDONLY);
+	if (fd < 0)
+		return -1;
+	if (read(fd, ehdr, sizeof(ehdr)) != (ssize_t)sizeof(ehdr))
+		goto done;
+	if (memcmp(ehdr, "\177ELF", 4) || (ehdr[4] != (is64 ? 2 : 1)))
+		goto done;
+	if (is64) {
+		(void)shim_memcpy(&phoff, ehdr + 32, sizeof(phoff));
+		(void)shim_memcpy(&phentsize, ehdr + 54, sizeof(phentsize));
+		(void)shim_memcpy(&phnum, ehdr + 56, sizeof(phnum));
+	} else {
+		uint32_t phoff32;
+
+		(void)shim_memcpy(&phoff32, ehdr + 28, sizeof(phoff32));
+		(void)shim_memcpy(&phentsize, ehdr + 42, sizeof(phentsize));
+		(void)shim_memcpy(&phnum, ehdr + 44, sizeof(phnum));
+		phoff = (uint64_t)phoff32;
+	}
+	ret = 0;
+	for (i = 0; i < phnum; i++) {
+		uint32_t p_type;
+		const off_t offset = (off_t)(phoff + ((uint64_t)i * phentsize));
+
+		if (pread(fd, &p_type, sizeof(p_type), offset) != (ssize_t)sizeof(p_type))
+			break;
+		if (p_type == 3) {	/* PT_INTERP */
+			ret = 1;
+			break;
+		}
+	}
+done:
+	(void)close(fd);
+	return ret;
+}
+
+/*
+ *  stress_exec_drop_cache()
+ *	evict the target program from the page cache, fadvise only
+ *	drops the target's unmapped clean pages, drop-caches drops
+ *	the entire clean page cache including shared libraries
+ */
+static int stress_exec_drop_cache(const char *path, const int exec_cold)
+{
+	if (exec_cold == EXEC_COLD_DROP_CACHES) {
+		const ssize_t ret = stress_drop_caches_mode(1);
+
+		return (ret < 0) ? (int)ret : 0;
+	}
+#if defined(HAVE_POSIX_FADVISE) &&	\
+    defined(POSIX_FADV_DONTNEED)
+	{
+		int fd, ret;
+
+		fd = open(path, O_RDONLY);
+		if (fd < 0)
+			return -errno;
+		ret = posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+		(void)close(fd);
+		return -ret;
+	}
+#else
+	(void)path;
+
+	return -ENOSYS;
+#endif
+}
+
+/*
+ *  stress_exec_startup()
+ *	time the startup of a program, fork and execve the target and
+ *	use a close-on-exec status pipe to time execve() completion.
+ *	stress-ng itself is exec'd with a handshake fd that it writes to
+ *	once main() is reached. Any other target is timed until it exits,
+ *	so pick a program that exits immediately, e.g. /bin/true. With a
+ *	cold method every other run is made with the target page cache
+ *	dropped so warm and cold startup can be compared
+ */
+static int stress_exec_startup(
+	stress_args_t *args,
+	const char *exec_prog,
+	const bool self,
+	int exec_cold)
+{
+	static const char * const lat_names[EXEC_LAT_MAX] = {
+		"exec",
+		"exec-to-main",
+		"exec-to-exit",
+	};
+	static const char * const temp_names[EXEC_TEMPS] = {
+		"warm",
+		"cold",
+	};
+	stress_latency_hist_t *hists;
+	uint64_t count[EXEC_TEMPS] = { 0, 0 };
+	int dynamic, rc = EXIT_SUCCESS;
+	size_t i, j, idx;
+	bool cold = false;
+	char *argv[4], *env[1], fdstr[16];
+
+	if (access(exec_prog, X_OK) < 0) {
+		pr_inf_skip("%s: cannot execute %s, errno=%d (%s), skipping stressor\n",
+			args->name, exec_prog, errno, strerror(errno));
+		return EXIT_NO_RESOURCE;
+	}
+	dynamic = stress_exec_is_dynamic(exec_prog);
+
+	hists = (stress_latency_hist_t *)calloc(EXEC_TEMPS * EXEC_LAT_MAX, sizeof(*hists));
+	if (!hists) {
+		pr_inf_skip("%s: failed to allocate latency histograms, skipping stressor\n",
+			args->name);
+		return EXIT_NO_RESOURCE;
+	}
+	for (i = 0; i < EXEC_TEMPS * EXEC_LAT_MAX; i++)
+		stress_latency_hist_init(&hists[i]);
+
+	if (exec_cold != EXEC_COLD_NONE) {
+		const int ret = stress_exec_drop_cache(exec_prog, exec_cold);
+
+		if (ret < 0) {
+			if (args->instance == 0)
+				pr_inf("%s: cannot drop page cache using %s, errno=%d (%s), "
+					"timing warm startup only\n", args->name,
+					stress_exec_colds[exec_cold], -ret, strerror(-ret));
+			exec_cold = EXEC_COLD_NONE;
+		}
+	}
+
+	argv[0] = (char *)exec_prog;
+	argv[1] = NULL;
+	argv[2] = NULL;
+	argv[3] = NULL;
+	env[0] = NULL;
+
+	stress_set_proc_state(args->name, STRESS_STATE_SYNC_WAIT);
+	stress_sync_start_wait(args);
+	stress_set_proc_state(args->name, STRESS_STATE_RUN);
+
+	do {
+		int exec_fds[2], main_fds[2] = { -1, -1 };
+		int status, err;
+		char ch;
+		pid_t pid;
+		uint64_t t_begin, t_exec, t_main = 0, t_exit;
+		ssize_t n;
+		stress_latency_hist_t *hist;
+
+		if (exec_cold != EXEC_COLD_NONE) {
+			cold = !cold;
+			if (cold)
+				(void)stress_exec_drop_cache(exec_prog, exec_cold);
+		}
+
+		if (pipe(exec_fds) < 0) {
+			pr_fail("%s: pipe failed, errno=%d (%s)\n",
+				args->name, errno, strerror(errno));
+			rc = EXIT_FAILURE;
+			break;
+		}
+		(void)fcntl(exec_fds[1], F_SETFD, FD_CLOEXEC);
+		if (self) {
+			if (pipe(main_fds) < 0) {
+				pr_fail("%s: pipe failed, errno=%d (%s)\n",
+					args->name, errno, strerror(errno));
+				(void)close(exec_fds[0]);
+				(void)close(exec_fds[1]);
+				rc = EXIT_FAILURE;
+				break;
+			}
+			(void)snprintf(fdstr, sizeof(fdstr), "%d", main_fds[1]);
+			argv[1] = "--exec-exit";
+			argv[2] = fdstr;
+		}
+
+		t_begin = stress_latency_now();
+		pid = fork();
+		if (pid < 0) {
+			(void)close(exec_fds[0]);
+			(void)close(exec_fds[1]);
+			if (self) {
+				(void)close(main_fds[0]);
+				(void)close(main_fds[1]);
+			}
+			if (stress_redo_fork(args, errno))
+				continue;
+			break;
+		} else if (pid == 0) {
+			(void)close(exec_fds[0]);
+			if (self)
+				(void)close(main_fds[0]);
+			(void)execve(exec_prog, argv, env);
+			err = errno;
+			VOID_RET(ssize_t, write(exec_fds[1], &err, sizeof(err)));
+			_exit(EXIT_FAILURE);
+		}
+		(void)close(exec_fds[1]);
+		if (self)
+			(void)close(main_fds[1]);
+
+		/* EOF on the close-on-exec pipe means execve() succeeded */
+		n = read(exec_fds[0], &err, sizeof(err));
+		t_exec = stress_latency_now();
+		(void)close(exec_fds[0]);
+		if (self) {
+			if ((n == 0) && (read(main_fds[0], &ch, sizeof(ch)) == (ssize_t)sizeof(ch)))
+				t_main = stress_latency_now();
+			(void)close(main_fds[0]);
+		}
+		if (waitpid(pid, &status, 0) < 0) {
+			(void)stress_kill_pid_wait(pid, NULL);
+			break;
+		}
+		t_exit = stress_latency_now();
+
+		if (n == (ssize_t)sizeof(err)) {
+			pr_fail("%s: execve %s failed, errno=%d (%s)\n",
+				args->name, exec_prog, err, strerror(err));
+			rc = EXIT_FAILURE;
+			break;
+		}
+		if (n < 0) {
+			/* interrupted, e.g. end of run */
+			if (!stress_continue(args))
+				break;
+			continue;
+		}
+		if (self && !t_main) {
+			if (!stress_continue(args))
+				break;
+			pr_fail("%s: no main() handshake from %s, status 0x%x\n",
+				args->name, exec_prog, status);
+			rc = EXIT_FAILURE;
+			break;
+		}
+
+		idx = cold ? EXEC_COLD : EXEC_WARM;
+		hist = &hists[idx * EXEC_LAT_MAX];
+		stress_latency_hist_record(&hist[EXEC_LAT_EXEC], t_exec - t_begin);
+		if (self)
+			stress_latency_hist_record(&hist[EXEC_LAT_MAIN], t_main - t_begin);
+		stress_latency_hist_record(&hist[EXEC_LAT_EXIT], t_exit - t_begin);
+		count[idx]++;
+		stress_bogo_inc(args);
+	} while (stress_continue(args));
+
+	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
+
+	if (args->instance == 0)
+		pr_inf("%s: %s, %s binary, page cache %s\n", args->name, exec_prog,
+			(dynamic < 0) ? "non-ELF" : (dynamic ? "dynamically linked" : "statically linked"),
+			(exec_cold == EXEC_COLD_NONE) ? "warm" : stress_exec_colds[exec_cold]);
+
+	for (idx = 0, i = 0; i < EXEC_TEMPS; i++) {
+		const stress_latency_hist_t *hist = &hists[i * EXEC_LAT_MAX];
+
+		if (!count[i])
+			continue;
+		for (j = 0; j < EXEC_LAT_MAX; j++) {
+			char desc[64];
+			const double p50 = (double)stress_latency_hist_percentile(&hist[j], 50.0) / 1000.0;
+			const double p99 = (double)stress_latency_hist_percentile(&hist[j], 99.0) / 1000.0;
+
+			if ((j == EXEC_LAT_MAIN) && !self)
+				continue;
+			if (args->instance == 0)
+				pr_inf("%s: %s %-12s p50 %10.2f usec, p99 %10.2f usec\n",
+					args->name, temp_names[i], lat_names[j], p50, p99);
+			(void)snprintf(desc, sizeof(desc), "%s %s p50 usec", temp_names[i], lat_names[j]);
+			stress_metrics_set(args, idx++, desc, p50, STRESS_METRIC_GEOMETRIC_MEAN);
+			(void)snprintf(desc, sizeof(desc), "%s %s p99 usec", temp_names[i], lat_names[j]);
+			stress_metrics_set(args, idx++, desc, p99, STRESS_METRIC_GEOMETRIC_MEAN);
+		}
+	}
+	free(hists);
+
+	return rc;
+}
+
 /*
  *  stress_exec()
  *	stress by forking and exec'ing
@@ -660,7 +993,9 @@ static int stress_exec(stress_args_t *args)
 	int exec_fork_method = EXEC_FORK_METHOD_FORK;
 	bool exec_no_pthread = false;
 	size_t arg_max, cache_max;
-	char *str;
+	size_t exec_cold = EXEC_COLD_NONE;
+	char *str, *exec_target = NULL;
+	bool exec_startup;
 
 	if (!stress_get_setting("exec-max", &exec_max)) {
 		if (g_opt_flags & OPT_FLAGS_MAXIMIZE)
@@ -673,6 +1008,9 @@ static int stress_exec(stress_args_t *args)
 		exec_method = stress_exec_methods[exec_method_idx].method;
 	if (stress_get_setting("exec-fork-method", &exec_fork_method_idx))
 		exec_fork_method = stress_exec_fork_methods[exec_fork_method_idx].method;
+	exec_startup = stress_get_setting("exec-cold", &exec_cold);
+	if (stress_get_setting("exec-prog", &exec_target))
+		exec_startup = true;
 
 	stress_ksm_memory_merge(1);
 
@@ -686,6 +1024,9 @@ static int stress_exec(stress_args_t *args)
 				"executable name\n", args->name);
 		return EXIT_NOT_IMPLEMENTED;
 	}
+	if (exec_startup)
+		return stress_exec_startup(args, exec_target ? exec_target : exec_prog,
+			!exec_target, (int)exec_cold);
 
 #if defined(HAVE_VFORK)
 	/* Remind folk that vfork can only do execve in this stressor */
@@ -918,5 +1259,6 @@ const stressor_info_t stress_exec_info = {
 	.class = CLASS_SCHEDULER | CLASS_OS,
 	.opts = opts,
 	.verify = VERIFY_OPTIONAL,
+	.metrics_max = (EXEC_TEMPS * EXEC_LAT_MAX * 2),
 	.help = help
 };
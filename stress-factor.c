@@ -141,6 +141,7 @@ const stressor_info_t stress_factor_info = {
 	.stressor = stress_factor,
 	.class = CLASS_CPU | CLASS_INTEGER | CLASS_COMPUTE,
 	.verify = VERIFY_ALWAYS,
+	.metrics_max = 3,
 	.opts = opts,
 	.help = help
 };
@@ -18,20 +18,64 @@
  *
  */
 #include "stress-ng.h"
+#include "core-builtin.h"
+
+#if defined(HAVE_LIB_PTHREAD)
+#include <pthread.h>
+#endif
 
 #define MIN_FALLOCATE_BYTES	(1 * MB)
 #define MAX_FALLOCATE_BYTES	(MAX_FILE_LIMIT)
 #define DEFAULT_FALLOCATE_BYTES	(1 * GB)
 
+#define MIN_FALLOCATE_CHUNK	(4 * KB)
+#define MAX_FALLOCATE_CHUNK	(1 * GB)
+#define DEFAULT_FALLOCATE_CHUNK	(1 * MB)
+
+#define FALLOCATE_THREADS_MAX	(64)
+
 static const stress_help_t help[] = {
 	{ NULL,	"fallocate N",		"start N workers fallocating 16MB files" },
 	{ NULL,	"fallocate-bytes N",	"specify size of file to allocate" },
+	{ NULL,	"fallocate-chunk N",	"specify bytes per fallocate call in threaded mode" },
+	{ NULL,	"fallocate-mode M",	"select threaded mode fallocate flags [ default | keep-size | zero-range ]" },
 	{ NULL,	"fallocate-ops N",	"stop after N fallocate bogo operations" },
+	{ NULL,	"fallocate-shared",	"threads allocate in one shared file rather than a file each" },
+	{ NULL,	"fallocate-threads N",	"use N threads concurrently preallocating chunks" },
 	{ NULL,	NULL,			NULL }
 };
 
+typedef struct {
+	const char *name;	/* --fallocate-mode name */
+	const int mode;		/* fallocate flags, -1 if not available */
+	const bool keep_size;	/* file size is not changed */
+} stress_fallocate_mode_t;
+
+static const stress_fallocate_mode_t fallocate_modes[] = {
+	{ "default",	0,				false },
+#if defined(FALLOC_FL_KEEP_SIZE)
+	{ "keep-size",	FALLOC_FL_KEEP_SIZE,		true },
+#else
+	{ "keep-size",	-1,				true },
+#endif
+#if defined(FALLOC_FL_ZERO_RANGE)
+	{ "zero-range",	FALLOC_FL_ZERO_RANGE,		false },
+#else
+	{ "zero-range",	-1,				false },
+#endif
+};
+
+static const char *stress_fallocate_mode(const size_t i)
+{
+	return (i < SIZEOF_ARRAY(fallocate_modes)) ? fallocate_modes[i].name : NULL;
+}
+
 static const stress_opt_t opts[] = {
-	{ OPT_fallocate_bytes, "fallocate-bytes", TYPE_ID_OFF_T, MIN_FALLOCATE_BYTES, MAX_FALLOCATE_BYTES, NULL },
+	{ OPT_fallocate_bytes,   "fallocate-bytes",   TYPE_ID_OFF_T, MIN_FALLOCATE_BYTES, MAX_FALLOCATE_BYTES, NULL },
+	{ OPT_fallocate_chunk,   "fallocate-chunk",   TYPE_ID_OFF_T, MIN_FALLOCATE_CHUNK, MAX_FALLOCATE_CHUNK, NULL },
+	{ OPT_fallocate_mode,    "fallocate-mode",    TYPE_ID_SIZE_T_METHOD, 0, 0, stress_fallocate_mode },
+	{ OPT_fallocate_shared,  "fallocate-shared",  TYPE_ID_BOOL, 0, 1, NULL },
+	{ OPT_fallocate_threads, "fallocate-threads", TYPE_ID_SIZE_T, 1, FALLOCATE_THREADS_MAX, NULL },
 	END_OPT,
 };
 
@@ -83,6 +127,304 @@ static const int illegal_modes[] = {
 #endif
 };
 
+typedef struct {
+	int fd;			/* file to allocate in */
+	int mode;		/* fallocate mode flags */
+	off_t chunk;		/* bytes per fallocate call */
+	off_t base;		/* offset of first chunk */
+	off_t stride;		/* offset step between chunks */
+	size_t chunks;		/* chunks to allocate */
+	uint64_t bytes;		/* bytes allocated */
+	uint64_t calls;		/* successful fallocate calls */
+	double latency;		/* total fallocate call time */
+	double latency_max;	/* slowest fallocate call */
+	int err;		/* first unexpected errno, 0 if none */
+	bool enospc;		/* ran out of space */
+} stress_fallocate_thread_t;
+
+/*
+ *  stress_fallocate_worker()
+ *	preallocate chunks at base, base + stride, ...
+ */
+static void *stress_fallocate_worker(void *arg)
+{
+	stress_fallocate_thread_t *thread = (stress_fallocate_thread_t *)arg;
+	size_t k;
+
+	for (k = 0; k < thread->chunks; k++) {
+		const off_t offset = thread->base + ((off_t)k * thread->stride);
+		double t, delta;
+		int ret;
+
+		t = stress_time_now();
+		ret = shim_fallocate(thread->fd, thread->mode, offset, thread->chunk);
+		delta = stress_time_now() - t;
+		if (UNLIKELY(ret < 0)) {
+			if (errno == ENOSPC) {
+				thread->enospc = true;
+				break;
+			}
+			if (errno == EINTR)
+				break;
+			thread->err = errno;
+			break;
+		}
+		thread->bytes += (uint64_t)thread->chunk;
+		thread->calls++;
+		thread->latency += delta;
+		if (delta > thread->latency_max)
+			thread->latency_max = delta;
+		if (UNLIKELY(!stress_continue_flag()))
+			break;
+	}
+	return NULL;
+}
+
+/*
+ *  stress_fallocate_threads()
+ *	run the workers, the caller runs worker 0
+ */
+static void stress_fallocate_threads(stress_fallocate_thread_t *threads, const size_t n)
+{
+	size_t i;
+#if defined(HAVE_LIB_PTHREAD)
+	pthread_t pthreads[FALLOCATE_THREADS_MAX];
+	bool created[FALLOCATE_THREADS_MAX];
+
+	for (i = 1; i < n; i++)
+		created[i] = (pthread_create(&pthreads[i], NULL,
+				stress_fallocate_worker, &threads[i]) == 0);
+	(void)stress_fallocate_worker(&threads[0]);
+	for (i = 1; i < n; i++) {
+		if (created[i])
+			(void)pthread_join(pthreads[i], NULL);
+		else
+			(void)stress_fallocate_worker(&threads[i]);
+	}
+#else
+	for (i = 0; i < n; i++)
+		(void)stress_fallocate_worker(&threads[i]);
+#endif
+}
+
+/*
+ *  stress_fallocate_open()
+ *	create an unlinked temporary file, returns fd or -errno
+ */
+static int stress_fallocate_open(stress_args_t *args)
+{
+	char filename[PATH_MAX];
+	int fd;
+
+	(void)stress_temp_filename_args(args,
+		filename, sizeof(filename), stress_mwc32());
+	fd = open(filename, O_CREAT | O_RDWR, S_IRUSR | S_IWUSR);
+	if (fd < 0)
+		return -errno;
+	(void)shim_unlink(filename);
+	return fd;
+}
+
+/*
+ *  stress_fallocate_concurrent()
+ *	N threads preallocating chunks of a shared file or of a file
+ *	per thread, each round starts with new files so the extent
+ *	allocator always starts from empty files
+ */
+static int stress_fallocate_concurrent(
+	stress_args_t *args,
+	const off_t fallocate_bytes,
+	const size_t fallocate_threads)
+{
+	stress_fallocate_thread_t threads[FALLOCATE_THREADS_MAX];
+	int fds[FALLOCATE_THREADS_MAX];
+	off_t fallocate_chunk = DEFAULT_FALLOCATE_CHUNK;
+	size_t fallocate_mode = 0;
+	bool fallocate_shared = false;
+	size_t i, nfds, chunks;
+	char path[PATH_MAX];
+	const char *fs_type;
+	double duration = 0.0, latency = 0.0, latency_max = 0.0;
+	double extents = 0.0, files = 0.0;
+	uint64_t bytes = 0, calls = 0;
+	bool enospc = false;
+	int fd, ret, mode, rc = EXIT_SUCCESS;
+
+	(void)stress_get_setting("fallocate-chunk", &fallocate_chunk);
+	(void)stress_get_setting("fallocate-mode", &fallocate_mode);
+	(void)stress_get_setting("fallocate-shared", &fallocate_shared);
+	mode = fallocate_modes[fallocate_mode].mode;
+
+	if (fallocate_chunk > fallocate_bytes)
+		fallocate_chunk = fallocate_bytes;
+	chunks = (size_t)(fallocate_bytes / (fallocate_chunk * (off_t)fallocate_threads));
+	if (chunks < 1)
+		chunks = 1;
+	nfds = fallocate_shared ? 1 : fallocate_threads;
+
+	ret = stress_temp_dir_mk_args(args);
+	if (ret < 0)
+		return stress_exit_status(-ret);
+
+	/* check the file system supports the mode */
+	fd = stress_fallocate_open(args);
+	if (fd < 0) {
+		pr_fail("%s: open failed, errno=%d (%s)\n",
+			args->name, -fd, strerror(-fd));
+		(void)stress_temp_dir_rm_args(args);
+		return stress_exit_status(-fd);
+	}
+	(void)stress_temp_dir_args(args, path, sizeof(path));
+	fs_type = stress_get_fs_type(path);
+	if ((fallocate_modes[fallocate_mode].mode < 0) ||
+	    (shim_fallocate(fd, mode, (off_t)0, fallocate_chunk) < 0)) {
+		const int err = errno;
+
+		(void)close(fd);
+		(void)stress_temp_dir_rm_args(args);
+		if ((fallocate_modes[fallocate_mode].mode < 0) ||
+		    (err == EOPNOTSUPP) || (err == ENOSYS) || (err == EINVAL)) {
+			if (args->instance == 0)
+				pr_inf_skip("%s: fallocate mode %s not supported%s, skipping stressor\n",
+					args->name, fallocate_modes[fallocate_mode].name, fs_type);
+			return EXIT_NO_RESOURCE;
+		}
+		if (err == ENOSPC) {
+			if (args->instance == 0)
+				pr_inf_skip("%s: no space to fallocate %" PRIdMAX " bytes%s, skipping stressor\n",
+					args->name, (intmax_t)fallocate_chunk, fs_type);
+			return EXIT_NO_RESOURCE;
+		}
+		pr_fail("%s: fallocate failed, errno=%d (%s)%s\n",
+			args->name, err, strerror(err), fs_type);
+		return EXIT_FAILURE;
+	}
+	(void)close(fd);
+
+	stress_set_proc_state(args->name, STRESS_STATE_SYNC_WAIT);
+	stress_sync_start_wait(args);
+	stress_set_proc_state(args->name, STRESS_STATE_RUN);
+
+	do {
+		double t;
+		off_t expected = 0;
+
+		for (i = 0; i < nfds; i++) {
+			fds[i] = stress_fallocate_open(args);
+			if (fds[i] < 0) {
+				pr_fail("%s: open failed, errno=%d (%s)\n",
+					args->name, -fds[i], strerror(-fds[i]));
+				rc = EXIT_FAILURE;
+				break;
+			}
+		}
+		if (rc != EXIT_SUCCESS) {
+			while (i > 0)
+				(void)close(fds[--i]);
+			break;
+		}
+
+		for (i = 0; i < fallocate_threads; i++) {
+			stress_fallocate_thread_t *thread = &threads[i];
+
+			(void)shim_memset(thread, 0, sizeof(*thread));
+			thread->mode = mode;
+			thread->chunk = fallocate_chunk;
+			thread->chunks = chunks;
+			if (fallocate_shared) {
+				/* interleave the threads chunk by chunk */
+				thread->fd = fds[0];
+				thread->base = (off_t)i * fallocate_chunk;
+				thread->stride = (off_t)fallocate_threads * fallocate_chunk;
+			} else {
+				thread->fd = fds[i];
+				thread->base = 0;
+				thread->stride = fallocate_chunk;
+			}
+		}
+
+		t = stress_time_now();
+		stress_fallocate_threads(threads, fallocate_threads);
+		duration += stress_time_now() - t;
+
+		for (i = 0; i < fallocate_threads; i++) {
+			const stress_fallocate_thread_t *thread = &threads[i];
+
+			stress_bogo_add(args, thread->calls);
+			bytes += thread->bytes;
+			calls += thread->calls;
+			latency += thread->latency;
+			if (thread->latency_max > latency_max)
+				latency_max = thread->latency_max;
+			enospc |= thread->enospc;
+			if (thread->err && (rc == EXIT_SUCCESS)) {
+				pr_fail("%s: fallocate failed, errno=%d (%s)%s\n",
+					args->name, thread->err, strerror(thread->err), fs_type);
+				rc = EXIT_FAILURE;
+			}
+		}
+
+		for (i = 0; i < nfds; i++) {
+			const size_t n = stress_get_extents(fds[i]);
+
+			if (n) {
+				extents += (double)n;
+				files += 1.0;
+			}
+		}
+
+		/* file sizes are only predictable when no space ran out */
+		expected = fallocate_shared ?
+			(off_t)chunks * (off_t)fallocate_threads * fallocate_chunk :
+			(off_t)chunks * fallocate_chunk;
+		if (fallocate_modes[fallocate_mode].keep_size)
+			expected = 0;
+		if ((g_opt_flags & OPT_FLAGS_VERIFY) && !enospc &&
+		    (rc == EXIT_SUCCESS) && stress_continue_flag()) {
+			for (i = 0; i < nfds; i++) {
+				struct stat buf;
+
+				if (shim_fstat(fds[i], &buf) < 0) {
+					pr_fail("%s: fstat failed, errno=%d (%s)%s\n",
+						args->name, errno, strerror(errno), fs_type);
+					rc = EXIT_FAILURE;
+				} else if (buf.st_size != expected) {
+					pr_fail("%s: file size %" PRIdMAX " does not match "
+						"the expected file size of %" PRIdMAX "\n",
+						args->name, (intmax_t)buf.st_size,
+						(intmax_t)expected);
+					rc = EXIT_FAILURE;
+				}
+			}
+		}
+		for (i = 0; i < nfds; i++)
+			(void)close(fds[i]);
+	} while ((rc == EXIT_SUCCESS) && stress_continue(args));
+
+	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
+	(void)stress_temp_dir_rm_args(args);
+
+	if (enospc && (args->instance == 0))
+		pr_dbg("%s: ran out of file system space, allocations were truncated\n",
+			args->name);
+
+	stress_metrics_set(args, 0, "GB per sec allocated",
+		(duration > 0.0) ? ((double)bytes / duration) / (double)GB : 0.0,
+		STRESS_METRIC_HARMONIC_MEAN);
+	stress_metrics_set(args, 1, "microsecs per fallocate call",
+		(calls > 0) ? STRESS_DBL_MICROSECOND * latency / (double)calls : 0.0,
+		STRESS_METRIC_HARMONIC_MEAN);
+	stress_metrics_set(args, 2, "microsecs max fallocate call",
+		STRESS_DBL_MICROSECOND * latency_max, STRESS_METRIC_MAXIMUM);
+	if (files > 0.0) {
+		stress_metrics_set(args, 3, "extents per file",
+			extents / files, STRESS_METRIC_HARMONIC_MEAN);
+		stress_metrics_set(args, 4, "KB per extent",
+			((double)bytes / extents) / (double)KB, STRESS_METRIC_HARMONIC_MEAN);
+	}
+	return rc;
+}
+
 /*
  *  stress_fallocate
  *	stress I/O via fallocate and ftruncate
@@ -97,15 +439,12 @@ static int stress_fallocate(stress_args_t *args)
 	char filename[PATH_MAX];
 	uint64_t ftrunc_errs = 0;
 	off_t fallocate_bytes = DEFAULT_FALLOCATE_BYTES;
+	size_t fallocate_threads = 0;
 	int *mode_perms = NULL, all_modes;
 	size_t i, mode_count;
 	const char *fs_type;
 	int count = 0, rc = EXIT_SUCCESS;
 
-	for (all_modes = 0, i = 0; i < SIZEOF_ARRAY(modes); i++)
-		all_modes |= modes[i];
-	mode_count = stress_flag_permutation(all_modes, &mode_perms);
-
 	if (!stress_get_setting("fallocate-bytes", &fallocate_bytes)) {
 		if (g_opt_flags & OPT_FLAGS_MAXIMIZE)
 			fallocate_bytes = MAXIMIZED_FILE_SIZE;
@@ -116,6 +455,13 @@ static int stress_fallocate(stress_args_t *args)
 	fallocate_bytes /= args->instances;
 	if (fallocate_bytes < (off_t)MIN_FALLOCATE_BYTES)
 		fallocate_bytes = (off_t)MIN_FALLOCATE_BYTES;
+
+	if (stress_get_setting("fallocate-threads", &fallocate_threads))
+		return stress_fallocate_concurrent(args, fallocate_bytes, fallocate_threads);
+
+	for (all_modes = 0, i = 0; i < SIZEOF_ARRAY(modes); i++)
+		all_modes |= modes[i];
+	mode_count = stress_flag_permutation(all_modes, &mode_perms);
 	ret = stress_temp_dir_mk_args(args);
 	if (ret < 0) {
 		free(mode_perms);
@@ -747,6 +747,7 @@ const stressor_info_t stress_fanotify_info = {
 	.supported = stress_fanotify_supported,
 	.class = CLASS_FILESYSTEM | CLASS_OS,
 	.verify = VERIFY_ALWAYS,
+	.metrics_max = 6,
 	.help = help
 };
 #else
@@ -21,22 +21,35 @@
 #include "core-asm-ret.h"
 #include "core-builtin.h"
 #include "core-madvise.h"
+#include "core-perf.h"
 #include "core-pragma.h"
 
+#if defined(HAVE_LINUX_PERF_EVENT_H)
+#include <linux/perf_event.h>
+#endif
+
 #define MIN_FAR_BRANCH_PAGES	(1)
 #define MAX_FAR_BRANCH_PAGES	(65536)
 
+#define FAR_BRANCH_SWEEP_MIN	(4 * KB)	/* smallest code footprint */
+#define FAR_BRANCH_SWEEP_MAX	(256 * MB)	/* largest code footprint */
+#define FAR_BRANCH_SWEEP_LINE	(64)		/* one function per cache line */
+#define FAR_BRANCH_SWEEP_HUGE	(2 * MB)	/* transparent huge page size */
+#define FAR_BRANCH_SWEEP_TIME	(0.1)		/* seconds per footprint */
+
 static const stress_help_t help[] = {
 	{ NULL,	"far-branch N",		"start N far branching workers" },
 	{ NULL, "far-branch-flush",	"periodically flush instruction cache" },
 	{ NULL,	"far-branch-ops N",	"stop after N far branching bogo operations" },
 	{ NULL, "far-branch-pages N",	"number of pages to populate with functions" },
+	{ NULL, "far-branch-sweep",	"report IPC, iTLB and i-cache misses over code footprints" },
 	{ NULL,	NULL,			NULL }
 };
 
 static const stress_opt_t opts[] = {
 	{ OPT_far_branch_flush, "far-branch-flush", TYPE_ID_BOOL, 0, 1, NULL },
 	{ OPT_far_branch_pages, "far-branch-pages", TYPE_ID_SIZE_T, MIN_FAR_BRANCH_PAGES, MAX_FAR_BRANCH_PAGES, NULL },
+	{ OPT_far_branch_sweep, "far-branch-sweep", TYPE_ID_BOOL, 0, 1, NULL },
 	END_OPT,
 };
 
@@ -262,6 +275,201 @@ static inline void stress_far_branch_shuffle(stress_ret_func_t *funcs, const siz
 	}
 }
 
+#if defined(STRESS_PERF_STATS)
+#define FAR_BRANCH_HW_CACHE(id, op, result)	\
+	((uint64_t)(id) | ((uint64_t)(op) << 8) | ((uint64_t)(result) << 16))
+
+/* front-end counters used by the code footprint sweep */
+static const stress_perf_counter_cfg_t far_branch_sweep_cfgs[] = {
+	{ PERF_TYPE_HARDWARE,	PERF_COUNT_HW_CPU_CYCLES },
+	{ PERF_TYPE_HARDWARE,	PERF_COUNT_HW_INSTRUCTIONS },
+	{ PERF_TYPE_HW_CACHE,	FAR_BRANCH_HW_CACHE(PERF_COUNT_HW_CACHE_ITLB,
+				PERF_COUNT_HW_CACHE_OP_READ, PERF_COUNT_HW_CACHE_RESULT_MISS) },
+	{ PERF_TYPE_HW_CACHE,	FAR_BRANCH_HW_CACHE(PERF_COUNT_HW_CACHE_L1I,
+				PERF_COUNT_HW_CACHE_OP_READ, PERF_COUNT_HW_CACHE_RESULT_MISS) },
+};
+#endif
+
+/*
+ *  stress_far_branch_sweep_map()
+ *	map a code footprint of size bytes filled with return
+ *	functions, huge page aligned and advised to use transparent
+ *	huge pages if huge is true, returns the mapping or MAP_FAILED
+ */
+static uint8_t *stress_far_branch_sweep_map(
+	const size_t size,
+	const size_t page_size,
+	const bool huge,
+	size_t *map_size,
+	uint8_t **map)
+{
+	uint8_t *code;
+	size_t i;
+
+	*map_size = huge ? size + FAR_BRANCH_SWEEP_HUGE : size;
+	*map = (uint8_t *)mmap(NULL, *map_size, PROT_READ | PROT_WRITE,
+				MAP_ANONYMOUS | MAP_PRIVATE, -1, 0);
+	if (*map == MAP_FAILED)
+		return MAP_FAILED;
+	code = *map;
+	if (huge) {
+		const uintptr_t addr = ((uintptr_t)*map + FAR_BRANCH_SWEEP_HUGE - 1) &
+					~(uintptr_t)(FAR_BRANCH_SWEEP_HUGE - 1);
+
+		code = (uint8_t *)addr;
+#if defined(MADV_HUGEPAGE)
+		(void)shim_madvise(code, size, MADV_HUGEPAGE);
+#endif
+	} else {
+#if defined(MADV_NOHUGEPAGE)
+		(void)shim_madvise(code, size, MADV_NOHUGEPAGE);
+#endif
+	}
+	stress_set_vma_anon_name(*map, *map_size, "far-branch-sweep");
+
+	/* fill first page with return functions and replicate it */
+	for (i = 0; i < page_size; i += stress_ret_opcode.stride)
+		(void)shim_memcpy(code + i, stress_ret_opcode.opcodes, stress_ret_opcode.len);
+	for (i = page_size; i < size; i += page_size)
+		(void)shim_memcpy(code + i, code, page_size);
+
+	if (mprotect((void *)*map, *map_size, PROT_READ | PROT_EXEC) < 0) {
+		(void)munmap((void *)*map, *map_size);
+		return MAP_FAILED;
+	}
+	shim_flush_icache((char *)code, (char *)code + size);
+	return code;
+}
+
+/*
+ *  stress_far_branch_sweep()
+ *	call one return function per cache line in a randomized order
+ *	over code footprints from 4K to 256MB, with normal and with
+ *	transparent huge page code mappings, and report the call rate,
+ *	instructions per cycle and iTLB and L1 i-cache misses per
+ *	thousand instructions for each footprint
+ */
+static void stress_far_branch_sweep(stress_args_t *args)
+{
+	const size_t spacing = ((FAR_BRANCH_SWEEP_LINE + stress_ret_opcode.stride - 1) /
+				stress_ret_opcode.stride) * stress_ret_opcode.stride;
+	size_t size;
+#if defined(STRESS_PERF_STATS)
+	stress_perf_counters_t pc;
+	const bool have_counters =
+		(stress_perf_counters_open(&pc, far_branch_sweep_cfgs,
+			SIZEOF_ARRAY(far_branch_sweep_cfgs)) > 0);
+#else
+	const bool have_counters = false;
+#endif
+
+	if (!have_counters)
+		pr_inf("%s: cannot open perf counters, IPC and iTLB and i-cache "
+			"misses will not be reported\n", args->name);
+
+	pr_block_begin();
+	pr_inf("%s: code footprint sweep, one function call per %zu bytes, "
+		"misses per 1000 instructions:\n", args->name, spacing);
+	pr_inf("%s: %10s %5s %10s %8s %10s %10s\n", args->name,
+		"footprint", "pages", "ns/call", "IPC", "iTLB MPKI", "L1I MPKI");
+
+	for (size = FAR_BRANCH_SWEEP_MIN; size <= FAR_BRANCH_SWEEP_MAX; size <<= 2) {
+		int huge;
+
+		for (huge = 0; huge < 2; huge++) {
+			const size_t n_funcs = size / spacing;
+			uint8_t *code, *map;
+			stress_ret_func_t *funcs;
+			size_t i, map_size;
+			uint64_t before[STRESS_PERF_COUNTERS_MAX], after[STRESS_PERF_COUNTERS_MAX];
+			double t, duration, calls = 0.0, ipc = 0.0, itlb = 0.0, l1i = 0.0;
+			char sz[32];
+
+			if (UNLIKELY(!stress_continue(args)))
+				goto done;
+			/* huge page mappings only make sense for >= huge page sizes */
+			if (huge && (size < FAR_BRANCH_SWEEP_HUGE))
+				continue;
+
+			funcs = (stress_ret_func_t *)calloc(n_funcs, sizeof(*funcs));
+			if (!funcs)
+				break;
+			code = stress_far_branch_sweep_map(size, args->page_size, huge, &map_size, &map);
+			if (code == MAP_FAILED) {
+				free(funcs);
+				break;
+			}
+			for (i = 0; i < n_funcs; i++)
+				funcs[i] = (stress_ret_func_t)(code + (i * spacing));
+			stress_far_branch_shuffle(funcs, n_funcs);
+
+			/* warm up, fault in and fill the TLBs and caches */
+			for (i = 0; i < n_funcs; i++)
+				funcs[i]();
+
+			(void)shim_memset(before, 0, sizeof(before));
+			(void)shim_memset(after, 0, sizeof(after));
+#if defined(STRESS_PERF_STATS)
+			if (have_counters)
+				(void)stress_perf_counters_read(&pc, before);
+#endif
+			t = stress_time_now();
+			do {
+				for (i = 0; i < n_funcs; i += 16) {
+					funcs[i + 0x0]();
+					funcs[i + 0x1]();
+					funcs[i + 0x2]();
+					funcs[i + 0x3]();
+					funcs[i + 0x4]();
+					funcs[i + 0x5]();
+					funcs[i + 0x6]();
+					funcs[i + 0x7]();
+					funcs[i + 0x8]();
+					funcs[i + 0x9]();
+					funcs[i + 0xa]();
+					funcs[i + 0xb]();
+					funcs[i + 0xc]();
+					funcs[i + 0xd]();
+					funcs[i + 0xe]();
+					funcs[i + 0xf]();
+				}
+				calls += (double)n_funcs;
+				duration = stress_time_now() - t;
+			} while (duration < FAR_BRANCH_SWEEP_TIME);
+#if defined(STRESS_PERF_STATS)
+			if (have_counters)
+				(void)stress_perf_counters_read(&pc, after);
+#endif
+			if ((after[0] > before[0]) && (after[1] > before[1])) {
+				const double instr = (double)(after[1] - before[1]);
+
+				ipc = instr / (double)(after[0] - before[0]);
+				itlb = 1000.0 * (double)(after[2] - before[2]) / instr;
+				l1i = 1000.0 * (double)(after[3] - before[3]) / instr;
+			}
+
+			stress_uint64_to_str(sz, sizeof(sz), (uint64_t)size);
+			if (have_counters)
+				pr_inf("%s: %10s %5s %10.2f %8.3f %10.3f %10.3f\n", args->name,
+					sz, huge ? "thp" : "base",
+					STRESS_DBL_NANOSECOND * duration / calls, ipc, itlb, l1i);
+			else
+				pr_inf("%s: %10s %5s %10.2f %8s %10s %10s\n", args->name,
+					sz, huge ? "thp" : "base",
+					STRESS_DBL_NANOSECOND * duration / calls, "n/a", "n/a", "n/a");
+
+			(void)munmap((void *)map, map_size);
+			free(funcs);
+		}
+	}
+done:
+	pr_block_end();
+#if defined(STRESS_PERF_STATS)
+	if (have_counters)
+		stress_perf_counters_close(&pc);
+#endif
+}
+
 /*
  *  stress_far_branch()
  *	exercise a broad randomized set of branches to functions
@@ -285,8 +493,10 @@ static int stress_far_branch(stress_args_t *args)
 	NOCLOBBER size_t total_funcs = 0;
 	NOCLOBBER double calls = 0.0;
 	NOCLOBBER bool far_branch_flush = false;
+	NOCLOBBER bool far_branch_sweep = false;
 
 	(void)stress_get_setting("far-branch-flush", &far_branch_flush);
+	(void)stress_get_setting("far-branch-sweep", &far_branch_sweep);
 	if (!stress_get_setting("far-branch-pages", &n_pages)) {
 		if (g_opt_flags & OPT_FLAGS_MAXIMIZE)
 			n_pages = MAX_FAR_BRANCH_PAGES;
@@ -396,6 +606,9 @@ static int stress_far_branch(stress_args_t *args)
 	stress_sync_start_wait(args);
 	stress_set_proc_state(args->name, STRESS_STATE_RUN);
 
+	if (far_branch_sweep && (args->instance == 0))
+		stress_far_branch_sweep(args);
+
 	t_start = stress_time_now();
 	do {
 		for (i = 0; i < total_funcs; i += 16) {
@@ -456,6 +669,7 @@ const stressor_info_t stress_far_branch_info = {
 	.stressor = stress_far_branch,
 	.class = CLASS_CPU_CACHE,
 	.verify = VERIFY_ALWAYS,
+	.metrics_max = 2,
 	.supported = stress_asm_ret_supported,
 	.opts = opts,
 	.help = help
@@ -292,5 +292,6 @@ const stressor_info_t stress_fd_fork_info = {
 	.class = CLASS_FILESYSTEM | CLASS_OS,
 	.opts = opts,
 	.verify = VERIFY_ALWAYS,
+	.metrics_max = 3,
 	.help = help
 };
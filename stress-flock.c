@@ -369,6 +369,7 @@ const stressor_info_t stress_flock_info = {
 	.stressor = stress_flock,
 	.class = CLASS_FILESYSTEM | CLASS_OS,
 	.verify = VERIFY_ALWAYS,
+	.metrics_max = 2,
 	.help = help
 };
 #else
@@ -18,20 +18,36 @@
  */
 #include "stress-ng.h"
 #include "core-arch.h"
+#include "core-asm-arm.h"
 #include "core-asm-ppc64.h"
 #include "core-asm-x86.h"
 #include "core-asm-ret.h"
 #include "core-builtin.h"
+#include "core-cpu.h"
 #include "core-cpu-cache.h"
 #include "core-numa.h"
 #include "core-out-of-memory.h"
 
 static const stress_help_t help[] = {
 	{ NULL,	"flushcache N",		"start N CPU instruction + data cache flush workers" },
+	{ NULL,	"flushcache-dax P",	"report persist rates on DAX directory or device-dax P" },
+	{ NULL,	"flushcache-dax-size N","size of DAX mapping for the persist report" },
 	{ NULL,	"flushcache-ops N",	"stop after N flush cache bogo operations" },
 	{ NULL,	NULL,		NULL }
 };
 
+#define FLUSHCACHE_DAX_SIZE_DEFAULT	(64 * MB)
+#define FLUSHCACHE_DAX_SIZE_MIN		(2 * MB)
+#define FLUSHCACHE_DAX_SIZE_MAX		(MAX_MEM_LIMIT)
+#define FLUSHCACHE_DAX_RUN_NS		(50000000.0)
+#define FLUSHCACHE_DAX_SLOTS		(4096)
+
+static const stress_opt_t opts[] = {
+	{ OPT_flushcache_dax,      "flushcache-dax",      TYPE_ID_STR, 0, 0, NULL },
+	{ OPT_flushcache_dax_size, "flushcache-dax-size", TYPE_ID_SIZE_T_BYTES_VM, FLUSHCACHE_DAX_SIZE_MIN, FLUSHCACHE_DAX_SIZE_MAX, NULL },
+	END_OPT,
+};
+
 #if (defined(STRESS_ARCH_X86) ||		\
      defined(STRESS_ARCH_ARM) ||	\
      defined(STRESS_ARCH_RISCV) ||	\
@@ -52,6 +68,8 @@ typedef struct {
 	size_t	cl_size;		/* cache line size */
 	bool	x86_clfsh;		/* true if x86 clflush op is available */
 	bool	x86_demote;		/* true if x86 cldemote op is available */
+	char	*dax_path;		/* DAX directory or device-dax, NULL if not used */
+	size_t	dax_size;		/* size of DAX mapping */
 } stress_flushcache_context_t;
 
 static int stress_flushcache_nohugepage(void *addr, size_t size)
@@ -243,6 +261,324 @@ static inline int stress_flush_dcache(
 	return 0;
 }
 
+#if defined(HAVE_ASM_X86_CLFLUSH) ||		\
+    (defined(HAVE_ASM_X86_CLFLUSHOPT) &&	\
+     defined(HAVE_ASM_X86_SFENCE)) ||		\
+    (defined(HAVE_ASM_X86_CLWB) &&		\
+     defined(HAVE_ASM_X86_SFENCE)) ||		\
+    (defined(HAVE_ASM_ARM_DC_CVAP) &&		\
+     defined(HAVE_ASM_ARM_DSB_SY))
+#define HAVE_FLUSHCACHE_PERSIST
+#endif
+
+#if defined(HAVE_FLUSHCACHE_PERSIST)
+typedef void (*stress_flushcache_persist_func_t)(uint8_t *addr,
+	const size_t len, const size_t cl_size);
+
+typedef struct {
+	const char *name;			/* persist method name */
+	bool (*supported)(void);		/* CPU supports the flush op */
+	const stress_flushcache_persist_func_t persist;
+} stress_flushcache_persist_t;
+
+#if defined(HAVE_ASM_X86_CLFLUSH)
+/*
+ *  clflush is ordered with respect to writes, no fence required
+ */
+static void stress_flushcache_persist_clflush(
+	uint8_t *addr,
+	const size_t len,
+	const size_t cl_size)
+{
+	register uint8_t *ptr = addr;
+	const uint8_t *ptr_end = ptr + len;
+
+	while (ptr < ptr_end) {
+		stress_asm_x86_clflush((void *)ptr);
+		ptr += cl_size;
+	}
+}
+#endif
+
+#if defined(HAVE_ASM_X86_CLFLUSHOPT) &&	\
+    defined(HAVE_ASM_X86_SFENCE)
+static void stress_flushcache_persist_clflushopt(
+	uint8_t *addr,
+	const size_t len,
+	const size_t cl_size)
+{
+	register uint8_t *ptr = addr;
+	const uint8_t *ptr_end = ptr + len;
+
+	while (ptr < ptr_end) {
+		stress_asm_x86_clflushopt((void *)ptr);
+		ptr += cl_size;
+	}
+	stress_asm_x86_sfence();
+}
+#endif
+
+#if defined(HAVE_ASM_X86_CLWB) &&	\
+    defined(HAVE_ASM_X86_SFENCE)
+static void stress_flushcache_persist_clwb(
+	uint8_t *addr,
+	const size_t len,
+	const size_t cl_size)
+{
+	register uint8_t *ptr = addr;
+	const uint8_t *ptr_end = ptr + len;
+
+	while (ptr < ptr_end) {
+		stress_asm_x86_clwb((void *)ptr);
+		ptr += cl_size;
+	}
+	stress_asm_x86_sfence();
+}
+#endif
+
+#if defined(HAVE_ASM_ARM_DC_CVAP) &&	\
+    defined(HAVE_ASM_ARM_DSB_SY)
+static void stress_flushcache_persist_dc_cvap(
+	uint8_t *addr,
+	const size_t len,
+	const size_t cl_size)
+{
+	register uint8_t *ptr = addr;
+	const uint8_t *ptr_end = ptr + len;
+
+	while (ptr < ptr_end) {
+		stress_asm_arm_dc_cvap((void *)ptr);
+		ptr += cl_size;
+	}
+	stress_asm_arm_dsb_sy();
+}
+#endif
+
+static const stress_flushcache_persist_t stress_flushcache_persist_methods[] = {
+#if defined(HAVE_ASM_X86_CLFLUSH)
+	{ "clflush",		stress_cpu_x86_has_clfsh,	stress_flushcache_persist_clflush },
+#endif
+#if defined(HAVE_ASM_X86_CLFLUSHOPT) &&	\
+    defined(HAVE_ASM_X86_SFENCE)
+	{ "clflushopt+sfence",	stress_cpu_x86_has_clflushopt,	stress_flushcache_persist_clflushopt },
+#endif
+#if defined(HAVE_ASM_X86_CLWB) &&	\
+    defined(HAVE_ASM_X86_SFENCE)
+	{ "clwb+sfence",	stress_cpu_x86_has_clwb,	stress_flushcache_persist_clwb },
+#endif
+#if defined(HAVE_ASM_ARM_DC_CVAP) &&	\
+    defined(HAVE_ASM_ARM_DSB_SY)
+	{ "dc-cvap+dsb",	stress_cpu_arm_has_dcpop,	stress_flushcache_persist_dc_cvap },
+#endif
+};
+
+static const size_t stress_flushcache_dax_records[] = {
+	64, 256, 4096
+};
+
+/*
+ *  stress_flushcache_dax_map()
+ *	map a device-dax character device or a file created in a
+ *	directory on a DAX filesystem, try MAP_SYNC on files so
+ *	that non-DAX filesystems are detected
+ */
+static uint8_t *stress_flushcache_dax_map(
+	stress_args_t *args,
+	const char *path,
+	const size_t size,
+	const char **mode)
+{
+	struct stat statbuf;
+	char filename[PATH_MAX];
+	uint8_t *addr;
+	int fd;
+
+	if (stat(path, &statbuf) < 0) {
+		pr_inf("%s: cannot stat DAX path %s, errno=%d (%s)\n",
+			args->name, path, errno, strerror(errno));
+		return MAP_FAILED;
+	}
+	if (S_ISCHR(statbuf.st_mode)) {
+		fd = open(path, O_RDWR);
+		if (fd < 0) {
+			pr_inf("%s: cannot open device-dax %s, errno=%d (%s)\n",
+				args->name, path, errno, strerror(errno));
+			return MAP_FAILED;
+		}
+		addr = (uint8_t *)mmap(NULL, size, PROT_READ | PROT_WRITE,
+					MAP_SHARED, fd, 0);
+		if (addr == MAP_FAILED)
+			pr_inf("%s: cannot mmap %zu bytes of device-dax %s, errno=%d (%s)\n",
+				args->name, size, path, errno, strerror(errno));
+		(void)close(fd);
+		*mode = "device-dax";
+		return addr;
+	}
+	if (!S_ISDIR(statbuf.st_mode)) {
+		pr_inf("%s: DAX path %s must be a directory on a DAX filesystem "
+			"or a device-dax character device\n", args->name, path);
+		return MAP_FAILED;
+	}
+
+	(void)snprintf(filename, sizeof(filename), "%s/stress-ng-flushcache-%" PRIdMAX "-%" PRIu32,
+		path, (intmax_t)args->pid, args->instance);
+	fd = open(filename, O_CREAT | O_RDWR | O_EXCL, S_IRUSR | S_IWUSR);
+	if (fd < 0) {
+		pr_inf("%s: cannot create %s, errno=%d (%s)\n",
+			args->name, filename, errno, strerror(errno));
+		return MAP_FAILED;
+	}
+	(void)shim_unlink(filename);
+	if (ftruncate(fd, (off_t)size) < 0) {
+		pr_inf("%s: cannot size %s to %zu bytes, errno=%d (%s)\n",
+			args->name, filename, size, errno, strerror(errno));
+		(void)close(fd);
+		return MAP_FAILED;
+	}
+#if defined(MAP_SHARED_VALIDATE) &&	\
+    defined(MAP_SYNC)
+	addr = (uint8_t *)mmap(NULL, size, PROT_READ | PROT_WRITE,
+				MAP_SHARED_VALIDATE | MAP_SYNC, fd, 0);
+	if (addr != MAP_FAILED) {
+		(void)close(fd);
+		*mode = "fsdax MAP_SYNC";
+		return addr;
+	}
+	pr_inf("%s: %s does not support MAP_SYNC, it is not on a DAX filesystem, "
+		"persist rates will reflect the page cache and not the media\n",
+		args->name, path);
+#endif
+	addr = (uint8_t *)mmap(NULL, size, PROT_READ | PROT_WRITE,
+				MAP_SHARED, fd, 0);
+	if (addr == MAP_FAILED)
+		pr_inf("%s: cannot mmap %zu bytes of %s, errno=%d (%s)\n",
+			args->name, size, filename, errno, strerror(errno));
+	(void)close(fd);
+	*mode = "non-DAX";
+	return addr;
+}
+
+/*
+ *  stress_flushcache_dax_run()
+ *	write and persist records sequentially or at random record
+ *	slots for FLUSHCACHE_DAX_RUN_NS, returns number of persists
+ *	and the run duration in seconds
+ */
+static uint64_t stress_flushcache_dax_run(
+	const stress_flushcache_persist_t *method,
+	uint8_t *addr,
+	const size_t size,
+	const size_t record,
+	const size_t cl_size,
+	const uint32_t *slots,
+	double *duration)
+{
+	const size_t n_records = size / record;
+	const double t_start = stress_time_now();
+	double t_end;
+	uint64_t persists = 0;
+	size_t i = 0;
+
+	do {
+		int j;
+
+		for (j = 0; j < 64; j++) {
+			const size_t idx = slots ?
+				slots[persists & (FLUSHCACHE_DAX_SLOTS - 1)] % n_records :
+				i;
+			register uint64_t *ptr = (uint64_t *)(addr + (idx * record));
+			const uint64_t *ptr_end = (uint64_t *)(addr + (idx * record) + record);
+
+			while (ptr < ptr_end)
+				*ptr++ = persists;
+			method->persist(addr + (idx * record), record, cl_size);
+			persists++;
+			i++;
+			if (i >= n_records)
+				i = 0;
+		}
+		t_end = stress_time_now();
+	} while (((t_end - t_start) * STRESS_DBL_NANOSECOND < FLUSHCACHE_DAX_RUN_NS) &&
+		 stress_continue_flag());
+
+	*duration = t_end - t_start;
+	return persists;
+}
+
+/*
+ *  stress_flushcache_dax()
+ *	report persist throughput and per-persist latency for each
+ *	available flush method over sequential and random records
+ */
+static void stress_flushcache_dax(
+	stress_args_t *args,
+	const char *path,
+	const size_t size,
+	const size_t cl_size)
+{
+	const char *mode = "";
+	uint8_t *addr;
+	uint32_t *slots;
+	size_t i;
+
+	slots = (uint32_t *)malloc(FLUSHCACHE_DAX_SLOTS * sizeof(*slots));
+	if (!slots) {
+		pr_inf("%s: cannot allocate DAX random slots, skipping DAX report\n",
+			args->name);
+		return;
+	}
+	for (i = 0; i < FLUSHCACHE_DAX_SLOTS; i++)
+		slots[i] = stress_mwc32();
+
+	addr = stress_flushcache_dax_map(args, path, size, &mode);
+	if (addr == MAP_FAILED) {
+		free(slots);
+		return;
+	}
+	/* fault in and allocate all the backing blocks up front */
+	(void)shim_memset(addr, 0, size);
+
+	pr_block_begin();
+	pr_inf("%s: DAX persist report for %s (%s), %zu MB mapped, %zu byte cache lines:\n",
+		args->name, path, mode, (size_t)(size / MB), cl_size);
+	pr_inf("%s: %-18s %-7s %7s %10s %12s\n", args->name,
+		"method", "pattern", "record", "GB/s", "ns/persist");
+	for (i = 0; i < SIZEOF_ARRAY(stress_flushcache_persist_methods); i++) {
+		const stress_flushcache_persist_t *method = &stress_flushcache_persist_methods[i];
+		size_t j;
+
+		if (!method->supported()) {
+			pr_inf("%s: %-18s not supported by this CPU\n", args->name, method->name);
+			continue;
+		}
+		for (j = 0; j < SIZEOF_ARRAY(stress_flushcache_dax_records); j++) {
+			const size_t record = stress_flushcache_dax_records[j];
+			int random;
+
+			for (random = 0; random < 2; random++) {
+				double duration;
+				uint64_t persists;
+
+				if (!stress_continue_flag())
+					goto done;
+				persists = stress_flushcache_dax_run(method, addr, size,
+					record, cl_size, random ? slots : NULL, &duration);
+				if ((persists == 0) || (duration <= 0.0))
+					continue;
+				pr_inf("%s: %-18s %-7s %7zu %10.3f %12.1f\n", args->name,
+					method->name, random ? "random" : "seq", record,
+					((double)persists * (double)record) / (duration * 1.0E9),
+					(duration * STRESS_DBL_NANOSECOND) / (double)persists);
+			}
+		}
+	}
+done:
+	pr_block_end();
+	(void)munmap((void *)addr, size);
+	free(slots);
+}
+#endif
+
 static int stress_flushcache_child(stress_args_t *args, void *ctxt)
 {
 	stress_flushcache_context_t *context = (stress_flushcache_context_t *)ctxt;
@@ -265,6 +601,15 @@ static int stress_flushcache_child(stress_args_t *args, void *ctxt)
 	stress_sync_start_wait(args);
 	stress_set_proc_state(args->name, STRESS_STATE_RUN);
 
+	if (context->dax_path && (args->instance == 0)) {
+#if defined(HAVE_FLUSHCACHE_PERSIST)
+		stress_flushcache_dax(args, context->dax_path, context->dax_size, context->cl_size);
+#else
+		pr_inf("%s: no persistent memory flush instructions available, "
+			"skipping DAX report\n", args->name);
+#endif
+	}
+
 	do {
 		if (context->i_addr)
 			stress_flush_icache(args, context);
@@ -296,6 +641,11 @@ static int stress_flushcache(stress_args_t *args)
 	stress_flushcache_context_t context;
 	int ret;
 
+	context.dax_path = NULL;
+	context.dax_size = FLUSHCACHE_DAX_SIZE_DEFAULT;
+	(void)stress_get_setting("flushcache-dax", &context.dax_path);
+	(void)stress_get_setting("flushcache-dax-size", &context.dax_size);
+
 	context.x86_clfsh = stress_cpu_x86_has_clfsh();
 	context.x86_demote = stress_cpu_x86_has_cldemote();
 	context.i_addr = stress_mmap_populate(NULL, page_size,
@@ -332,6 +682,7 @@ const stressor_info_t stress_flushcache_info = {
 	.stressor = stress_flushcache,
 	.class = CLASS_CPU_CACHE,
 	.supported = stress_asm_ret_supported,
+	.opts = opts,
 	.help = help
 };
 #else
@@ -339,6 +690,7 @@ const stressor_info_t stress_flushcache_info = {
 	.stressor = stress_unimplemented,
 	.class = CLASS_CPU_CACHE,
 	.supported = stress_asm_ret_supported,
+	.opts = opts,
 	.help = help,
 	.unimplemented_reason = "built without cache flush support"
 };
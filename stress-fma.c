@@ -19,10 +19,12 @@
 #include "stress-ng.h"
 #include "core-arch.h"
 #include "core-builtin.h"
+#include "core-cpu.h"
 #include "core-madvise.h"
 #include "core-put.h"
 #include "core-pragma.h"
 #include "core-target-clones.h"
+#include "core-vmstat.h"
 
 #include <math.h>
 
@@ -59,6 +61,7 @@ static const stress_help_t help[] = {
 	{ NULL,	"fma N",	"start N workers performing floating point multiply-add ops" },
 	{ NULL,	"fma-ops N",	"stop after N floating point multiply-add bogo operations" },
 	{ NULL, "fma-libc",	"use fma libc fused multiply-add helpers" },
+	{ NULL, "fma-peak",	"measure peak fma GFLOPS per vector width" },
 	{ NULL,	NULL,		 NULL }
 };
 
@@ -221,7 +224,7 @@ PRAGMA_UNROLL_N(FMA_UNROLL)
 	}
 }
 
-stress_fma_func_t stress_fma_funcs[] = {
+static const stress_fma_func_t stress_fma_funcs[] = {
 	stress_fma_add132_double,
 	stress_fma_add132_float,
 	stress_fma_add213_double,
@@ -460,7 +463,7 @@ PRAGMA_UNROLL_N(FMA_UNROLL)
 	}
 }
 
-stress_fma_func_t stress_fma_libc_funcs[] = {
+static const stress_fma_func_t stress_fma_libc_funcs[] = {
 	stress_fma_add132_libc_double,
 	stress_fma_add132_libc_float,
 	stress_fma_add213_libc_double,
@@ -499,6 +502,231 @@ static inline void OPTIMIZE3 TARGET_CLONES stress_fma_reset_a(stress_fma_t *pfma
 	(void)shim_memcpy(pfma->float_a2, pfma->float_init, sizeof(pfma->float_init));
 }
 
+/*
+ *  Peak FMA throughput, FMA_PEAK_ACC independent accumulator chains
+ *  per vector width cover the FMA latency x FMA ports product on current
+ *  CPUs so the kernels are throughput rather than latency bound.
+ *  mul and add are chosen so the accumulators converge on 1.0 and
+ *  never overflow or become denormal.
+ */
+#define FMA_PEAK_ACC		(12)
+#define FMA_PEAK_LOOPS		(65536)
+#define FMA_PEAK_CELL		(0.1)	/* seconds per width per round */
+
+#if defined(STRESS_ARCH_X86) &&			\
+    (defined(HAVE_COMPILER_GCC) ||		\
+     defined(HAVE_COMPILER_CLANG) ||		\
+     defined(HAVE_COMPILER_ICX)) &&		\
+    !defined(HAVE_COMPILER_ICC)
+#define TARGET_FMA		__attribute__ ((target("fma")))
+#define TARGET_AVX512F		__attribute__ ((target("avx512f")))
+#define STRESS_FMA_PEAK_X86
+#else
+#define TARGET_FMA
+#define TARGET_AVX512F
+#endif
+
+/* stop the scalar kernel being SLP vectorized into packed FMAs */
+#if defined(HAVE_COMPILER_GCC_OR_MUSL) &&	\
+    !defined(HAVE_COMPILER_CLANG) &&		\
+    !defined(HAVE_COMPILER_ICC)
+#define OPTIMIZE3_NO_VECTORIZE	__attribute__((optimize("-O3", "no-tree-vectorize")))
+#else
+#define OPTIMIZE3_NO_VECTORIZE	OPTIMIZE3
+#endif
+
+#define STRESS_FMA_PEAK_FUNC(name, vtype, target, optimize)		\
+static double target optimize stress_fma_peak_ ## name(const uint64_t loops)\
+{									\
+	const vtype zero = (vtype){ 0 };				\
+	const vtype mul = zero + 0.9999999;				\
+	const vtype add = zero + 1.0E-7;				\
+	vtype acc[FMA_PEAK_ACC];					\
+	double lanes[sizeof(vtype) / sizeof(double)];			\
+	register uint64_t i;						\
+	register size_t k;						\
+	double sum = 0.0;						\
+									\
+	for (k = 0; k < FMA_PEAK_ACC; k++)				\
+		acc[k] = zero + ((double)(k + 1) * 0.001);		\
+	for (i = 0; i < loops; i++) {					\
+PRAGMA_UNROLL_N(FMA_PEAK_ACC)						\
+		for (k = 0; k < FMA_PEAK_ACC; k++)			\
+			acc[k] = (acc[k] * mul) + add;			\
+	}								\
+	for (k = 0; k < FMA_PEAK_ACC; k++) {				\
+		register size_t l;					\
+									\
+		(void)shim_memcpy(lanes, &acc[k], sizeof(lanes));	\
+		for (l = 0; l < SIZEOF_ARRAY(lanes); l++)		\
+			sum += lanes[l];				\
+	}								\
+	return sum;							\
+}
+
+STRESS_FMA_PEAK_FUNC(scalar, double, TARGET_FMA, OPTIMIZE3_NO_VECTORIZE)
+
+#if defined(HAVE_VECMATH)
+typedef double stress_fma_vec128_t __attribute__ ((vector_size(16)));
+STRESS_FMA_PEAK_FUNC(vec128, stress_fma_vec128_t, TARGET_FMA, OPTIMIZE3)
+#if defined(STRESS_FMA_PEAK_X86)
+typedef double stress_fma_vec256_t __attribute__ ((vector_size(32)));
+STRESS_FMA_PEAK_FUNC(vec256, stress_fma_vec256_t, TARGET_FMA, OPTIMIZE3)
+#if defined(HAVE_TARGET_CLONES_SKYLAKE_AVX512)
+typedef double stress_fma_vec512_t __attribute__ ((vector_size(64)));
+STRESS_FMA_PEAK_FUNC(vec512, stress_fma_vec512_t, TARGET_AVX512F, OPTIMIZE3)
+#endif
+#endif
+#endif
+
+static bool stress_fma_peak_scalar_supported(void)
+{
+#if defined(STRESS_FMA_PEAK_X86)
+	return stress_cpu_x86_has_fma();
+#else
+	return true;
+#endif
+}
+
+#if defined(HAVE_VECMATH)
+static bool stress_fma_peak_vec128_supported(void)
+{
+#if defined(STRESS_FMA_PEAK_X86)
+	return stress_cpu_x86_has_fma();
+#elif defined(STRESS_ARCH_ARM)
+	return stress_cpu_arm_has_neon();
+#else
+	return true;
+#endif
+}
+#endif
+
+#if defined(HAVE_VECMATH) &&		\
+    defined(STRESS_FMA_PEAK_X86) &&	\
+    defined(HAVE_TARGET_CLONES_SKYLAKE_AVX512)
+static bool stress_fma_peak_vec512_supported(void)
+{
+	return stress_cpu_x86_has_avx512_f();
+}
+#endif
+
+typedef struct {
+	const char *name;			/* vector width */
+	double (*func)(const uint64_t loops);	/* peak FMA kernel */
+	bool (*supported)(void);		/* true if CPU can run it */
+	const size_t lanes;			/* doubles per vector */
+} stress_fma_peak_method_t;
+
+static const stress_fma_peak_method_t stress_fma_peak_methods[] = {
+	{ "scalar",	stress_fma_peak_scalar,	stress_fma_peak_scalar_supported,	1 },
+#if defined(HAVE_VECMATH)
+	{ "vec128",	stress_fma_peak_vec128,	stress_fma_peak_vec128_supported,	2 },
+#if defined(STRESS_FMA_PEAK_X86)
+	{ "vec256",	stress_fma_peak_vec256,	stress_fma_peak_scalar_supported,	4 },
+#if defined(HAVE_TARGET_CLONES_SKYLAKE_AVX512)
+	{ "vec512",	stress_fma_peak_vec512,	stress_fma_peak_vec512_supported,	8 },
+#endif
+#endif
+#endif
+};
+
+/*
+ *  stress_fma_peak()
+ *	run each supported vector width for FMA_PEAK_CELL seconds in turn
+ *	and report the double precision GFLOPS per instance and the mean
+ *	CPU frequency while each width was running, wider vectors may run
+ *	at a lower frequency (e.g. AVX-512 frequency licenses)
+ */
+static int stress_fma_peak(stress_args_t *args)
+{
+	stress_metrics_t metrics[SIZEOF_ARRAY(stress_fma_peak_methods)];
+	double ghz_total[SIZEOF_ARRAY(stress_fma_peak_methods)];
+	double ghz_samples[SIZEOF_ARRAY(stress_fma_peak_methods)];
+	bool supported[SIZEOF_ARRAY(stress_fma_peak_methods)];
+	size_t i, n_supported = 0;
+
+	stress_zero_metrics(metrics, SIZEOF_ARRAY(metrics));
+	for (i = 0; i < SIZEOF_ARRAY(stress_fma_peak_methods); i++) {
+		supported[i] = stress_fma_peak_methods[i].supported();
+		ghz_total[i] = 0.0;
+		ghz_samples[i] = 0.0;
+		if (supported[i])
+			n_supported++;
+		else if (args->instance == 0)
+			pr_inf("%s: %s fma not supported by this CPU, skipping it\n",
+				args->name, stress_fma_peak_methods[i].name);
+	}
+	if (n_supported == 0) {
+		if (args->instance == 0)
+			pr_inf_skip("%s: no fma capable vector widths available, "
+				"skipping stressor\n", args->name);
+		return EXIT_NOT_IMPLEMENTED;
+	}
+
+	stress_set_proc_state(args->name, STRESS_STATE_SYNC_WAIT);
+	stress_sync_start_wait(args);
+	stress_set_proc_state(args->name, STRESS_STATE_RUN);
+
+	do {
+		for (i = 0; (i < SIZEOF_ARRAY(stress_fma_peak_methods)) && stress_continue(args); i++) {
+			const double t_start = stress_time_now();
+			double t;
+
+			if (!supported[i])
+				continue;
+			do {
+				stress_double_put(stress_fma_peak_methods[i].func(FMA_PEAK_LOOPS));
+				metrics[i].count += (double)FMA_PEAK_LOOPS;
+				stress_bogo_inc(args);
+				t = stress_time_now();
+			} while ((t < t_start + FMA_PEAK_CELL) && stress_continue(args));
+			metrics[i].duration += t - t_start;
+
+			/* scaling_cur_freq lookup is not thread safe, sample on instance 0 only */
+			if (args->instance == 0) {
+				double avg_ghz, min_ghz, max_ghz;
+
+				stress_get_cpu_ghz(&avg_ghz, &min_ghz, &max_ghz);
+				if (avg_ghz > 0.0) {
+					ghz_total[i] += avg_ghz;
+					ghz_samples[i] += 1.0;
+				}
+			}
+		}
+	} while (stress_continue(args));
+
+	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
+
+	if (args->instance == 0) {
+		double samples = 0.0;
+
+		for (i = 0; i < SIZEOF_ARRAY(ghz_samples); i++)
+			samples += ghz_samples[i];
+		if (samples <= 0.0)
+			pr_inf("%s: CPU frequency not available, CPU GHz metrics not reported\n",
+				args->name);
+	}
+
+	for (i = 0; i < SIZEOF_ARRAY(stress_fma_peak_methods); i++) {
+		const stress_fma_peak_method_t *method = &stress_fma_peak_methods[i];
+		char msg[64];
+
+		if (metrics[i].duration > 0.0) {
+			const double flops = 2.0 * FMA_PEAK_ACC * (double)method->lanes * metrics[i].count;
+
+			(void)snprintf(msg, sizeof(msg), "%s fma GFLOPS per instance", method->name);
+			stress_metrics_set(args, i * 2, msg,
+				flops / (metrics[i].duration * 1.0E9), STRESS_METRIC_HARMONIC_MEAN);
+		}
+		if (ghz_samples[i] > 0.0) {
+			(void)snprintf(msg, sizeof(msg), "%s fma CPU GHz", method->name);
+			stress_metrics_set(args, (i * 2) + 1, msg,
+				ghz_total[i] / ghz_samples[i], STRESS_METRIC_GEOMETRIC_MEAN);
+		}
+	}
+	return EXIT_SUCCESS;
+}
+
 static int stress_fma(stress_args_t *args)
 {
 	stress_fma_t *pfma;
@@ -506,10 +734,12 @@ static int stress_fma(stress_args_t *args)
 	const bool verify = !!(g_opt_flags & OPT_FLAGS_VERIFY);
 	const stress_fma_func_t *fma_func_array;
 	bool fma_libc = false;
+	bool fma_peak = false;
 	int rc = EXIT_SUCCESS;
 	size_t offset = 0;
 
 	(void)stress_get_setting("fma-libc", &fma_libc);
+	(void)stress_get_setting("fma-peak", &fma_peak);
 #if (defined(HAVE_FMA)  || defined(FP_FAST_FMA)) && 	\
     (defined(HAVE_FMAF) || defined(FP_FAST_FMAF))
 	fma_func_array = fma_libc ? stress_fma_libc_funcs : stress_fma_funcs;
@@ -523,6 +753,9 @@ static int stress_fma(stress_args_t *args)
 
 	stress_catch_sigill();
 
+	if (fma_peak)
+		return stress_fma_peak(args);
+
 	pfma = (stress_fma_t *)stress_mmap_populate(NULL, sizeof(*pfma),
 				PROT_READ | PROT_WRITE,
 				MAP_ANONYMOUS | MAP_PRIVATE, -1, 0);
@@ -598,6 +831,7 @@ static int stress_fma(stress_args_t *args)
 
 static const stress_opt_t opts[] = {
 	{ OPT_fma_libc, "fma-libc", TYPE_ID_BOOL, 0, 1, NULL },
+	{ OPT_fma_peak, "fma-peak", TYPE_ID_BOOL, 0, 1, NULL },
 	END_OPT,
 };
 
@@ -606,5 +840,6 @@ const stressor_info_t stress_fma_info = {
 	.class = CLASS_CPU | CLASS_FP | CLASS_COMPUTE,
 	.opts = opts,
 	.verify = VERIFY_OPTIONAL,
+	.instance_threads = true,
 	.help = help
 };
@@ -306,5 +306,6 @@ const stressor_info_t stress_forkheavy_info = {
 	.stressor = stress_forkheavy,
 	.class = CLASS_SCHEDULER | CLASS_OS,
 	.opts = opts,
+	.metrics_max = 1,
 	.help = help
 };
@@ -421,6 +421,7 @@ const stressor_info_t stress_fpunch_info = {
 	.class = CLASS_FILESYSTEM | CLASS_OS,
 	.opts = opts,
 	.verify = VERIFY_OPTIONAL,
+	.metrics_max = 1,
 	.help = help
 };
 #else
@@ -305,6 +305,7 @@ const stressor_info_t stress_fractal_info = {
 	.init = stress_fractal_init,
 	.deinit = stress_fractal_deinit,
 	.verify = VERIFY_NONE,
+	.metrics_max = 2,
 	.opts = opts,
 	.help = help
 };
@@ -331,6 +331,7 @@ const stressor_info_t stress_fsize_info = {
 	.stressor = stress_fsize,
 	.class = CLASS_FILESYSTEM | CLASS_OS,
 	.verify = VERIFY_ALWAYS,
+	.metrics_max = 1,
 	.help = help
 };
 #else
@@ -211,7 +211,7 @@ stress_funccall_ ## type(stress_args_t *args)			\
 			}						\
 		}							\
 	}								\
-	stress_bogo_inc(args);						\
+	stress_bogo_batch_inc(args);					\
 	return true;							\
 }
 
@@ -1259,7 +1259,7 @@ static int stress_funccall(stress_args_t *args)
 
 	do {
 		success = stress_funccall_exercise(args, funccall_method);
-	} while (success && stress_continue(args));
+	} while (success && stress_bogo_batch_continue(args));
 
 	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
 
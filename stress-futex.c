@@ -20,6 +20,7 @@
 #include "stress-ng.h"
 #include "core-affinity.h"
 #include "core-builtin.h"
+#include "core-latency.h"
 
 #include <time.h>
 
@@ -27,10 +28,43 @@
 #include <linux/futex.h>
 #endif
 
+#define FUTEX_METHOD_CLASSIC	(0)	/* FUTEX_WAIT/FUTEX_WAKE polling stressor */
+#define FUTEX_METHOD_WAITV	(1)	/* futex_waitv wake latency */
+#define FUTEX_METHOD_FUTEX2	(2)	/* futex_wait/futex_wake wake latency */
+#define FUTEX_METHOD_FUTEX2_NUMA (3)	/* FUTEX2_NUMA futex_wait/futex_wake */
+
+#define MIN_FUTEX_WAITV		(1)
+#define MAX_FUTEX_WAITV		(128)	/* FUTEX_WAITV_MAX */
+#define DEFAULT_FUTEX_WAITV	(8)
+
 static const stress_help_t help[] = {
-	{ NULL,	"futex N",	"start N workers exercising a fast mutex" },
-	{ NULL,	"futex-ops N",	"stop after N fast mutex bogo operations" },
-	{ NULL,	NULL,		NULL }
+	{ NULL,	"futex N",		"start N workers exercising a fast mutex" },
+	{ NULL,	"futex-method M",	"select method: classic, waitv, futex2 or futex2-numa" },
+	{ NULL,	"futex-ops N",		"stop after N fast mutex bogo operations" },
+	{ NULL,	"futex-waitv N",	"wait on N futexes with the waitv method" },
+	{ NULL,	"futex-waiter-cpu N",	"pin the waiter to CPU N in wake latency methods" },
+	{ NULL,	"futex-waker-cpu N",	"pin the waker to CPU N in wake latency methods" },
+	{ NULL,	NULL,			NULL }
+};
+
+static const char * const futex_methods[] = {
+	"classic",	/* FUTEX_METHOD_CLASSIC */
+	"waitv",	/* FUTEX_METHOD_WAITV */
+	"futex2",	/* FUTEX_METHOD_FUTEX2 */
+	"futex2-numa",	/* FUTEX_METHOD_FUTEX2_NUMA */
+};
+
+static const char *stress_futex_method(const size_t i)
+{
+	return (i < SIZEOF_ARRAY(futex_methods)) ? futex_methods[i] : NULL;
+}
+
+static const stress_opt_t opts[] = {
+	{ OPT_futex_method,	"futex-method",	    TYPE_ID_SIZE_T_METHOD, 0, 0, stress_futex_method },
+	{ OPT_futex_waitv,	"futex-waitv",	    TYPE_ID_UINT32, MIN_FUTEX_WAITV, MAX_FUTEX_WAITV, NULL },
+	{ OPT_futex_waiter_cpu,	"futex-waiter-cpu", TYPE_ID_INT32, 0, INT32_MAX, NULL },
+	{ OPT_futex_waker_cpu,	"futex-waker-cpu",  TYPE_ID_INT32, 0, INT32_MAX, NULL },
+	END_OPT,
 };
 
 #if defined(HAVE_LINUX_FUTEX_H) &&	\
@@ -38,6 +72,34 @@ static const stress_help_t help[] = {
 
 #define THRESHOLD	(100000)
 
+/*
+ *  futex2 system calls (Linux 6.7) use the generic system call
+ *  numbers on every architecture that has futex_waitv at 449
+ */
+#if defined(__NR_futex_wake)
+#define STRESS_NR_futex_wake	__NR_futex_wake
+#define STRESS_NR_futex_wait	__NR_futex_wait
+#elif defined(__NR_futex_waitv) &&	\
+      (__NR_futex_waitv == 449)
+#define STRESS_NR_futex_wake	(454)
+#define STRESS_NR_futex_wait	(455)
+#endif
+
+#define STRESS_FUTEX2_SIZE_U32	(0x02)
+#define STRESS_FUTEX2_NUMA	(0x04)	/* Linux 6.16 */
+#define STRESS_FUTEX_NO_NODE	(~0U)
+#define STRESS_FUTEX_MATCH_ANY	(0xffffffffUL)	/* must fit the futex size */
+
+/*
+ *  wake latency ping-pong state shared by the waker and the
+ *  waiter, with FUTEX2_NUMA each futex is a value and node pair
+ */
+typedef struct {
+	uint32_t futex[MAX_FUTEX_WAITV * 2] ALIGNED(64); /* waited on futexes */
+	uint32_t ack ALIGNED(64);	/* waiter acknowledges each wake */
+	uint64_t t_wake;		/* waker time stamp, CLOCK_MONOTONIC ns */
+} stress_futex_pingpong_t;
+
 /*
  *  stress_futex_wait()
  *     exercise futex_wait and every 16th time futex_waitv
@@ -87,6 +149,363 @@ static int stress_futex_wait(uint32_t *futex, const int val, const long int nsec
 	return shim_futex_wait(futex, val, &t);
 }
 
+/*
+ *  stress_futex_cpu()
+ *	fetch a futex CPU pinning setting, -1 if not
+ *	set or not a configured CPU
+ */
+static int32_t stress_futex_cpu(stress_args_t *args, const char *opt)
+{
+	int32_t cpu = -1;
+	const int32_t cpus = stress_get_processors_configured();
+
+	if (!stress_get_setting(opt, &cpu))
+		return -1;
+	if ((cpus > 0) && (cpu >= cpus)) {
+		if (args->instance == 0)
+			pr_inf("%s: --%s %" PRId32 " is not a configured CPU, not pinning\n",
+				args->name, opt, cpu);
+		return -1;
+	}
+	return cpu;
+}
+
+/*
+ *  stress_futex_timeout()
+ *	absolute CLOCK_MONOTONIC time nsec nanoseconds from now
+ */
+static void stress_futex_timeout(struct timespec *t, const long int nsec)
+{
+	if (clock_gettime(CLOCK_MONOTONIC, t) < 0) {
+		t->tv_sec = 0;
+		t->tv_nsec = 0;
+	}
+	t->tv_nsec += nsec;
+	while (t->tv_nsec >= 1000000000) {
+		t->tv_sec++;
+		t->tv_nsec -= 1000000000;
+	}
+}
+
+/*
+ *  stress_futex2_wake()
+ *	futex2 futex_wake, wake up to n waiters
+ */
+static int stress_futex2_wake(uint32_t *futex, const int n, const unsigned int flags)
+{
+#if defined(STRESS_NR_futex_wake) &&	\
+    defined(HAVE_SYSCALL)
+	return (int)syscall(STRESS_NR_futex_wake, futex, STRESS_FUTEX_MATCH_ANY, n, flags);
+#else
+	return (int)shim_enosys(0, futex, STRESS_FUTEX_MATCH_ANY, n, flags);
+#endif
+}
+
+/*
+ *  stress_futex2_wait()
+ *	futex2 futex_wait with an absolute CLOCK_MONOTONIC timeout
+ */
+static int stress_futex2_wait(
+	uint32_t *futex,
+	const uint32_t val,
+	const unsigned int flags,
+	struct timespec *timeout)
+{
+#if defined(STRESS_NR_futex_wait) &&	\
+    defined(HAVE_SYSCALL)
+	return (int)syscall(STRESS_NR_futex_wait, futex, (unsigned long int)val,
+		STRESS_FUTEX_MATCH_ANY, flags, timeout, CLOCK_MONOTONIC);
+#else
+	return (int)shim_enosys(0, futex, val, STRESS_FUTEX_MATCH_ANY, flags, timeout);
+#endif
+}
+
+/*
+ *  stress_futex_pingpong_wake()
+ *	wake the waiter on futex with the method under test
+ */
+static int stress_futex_pingpong_wake(const size_t method, uint32_t *futex)
+{
+	switch (method) {
+	case FUTEX_METHOD_FUTEX2:
+		return stress_futex2_wake(futex, 1, STRESS_FUTEX2_SIZE_U32);
+	case FUTEX_METHOD_FUTEX2_NUMA:
+		return stress_futex2_wake(futex, 1, STRESS_FUTEX2_SIZE_U32 | STRESS_FUTEX2_NUMA);
+	default:
+		/* futex_waitv waiters are woken with a classic FUTEX_WAKE */
+		return shim_futex_wake(futex, 1);
+	}
+}
+
+/*
+ *  stress_futex_pingpong_waker()
+ *	waker, bump one futex at a time, time stamp and wake it,
+ *	then wait for the waiter to acknowledge the wake
+ */
+static int stress_futex_pingpong_waker(
+	stress_args_t *args,
+	stress_futex_pingpong_t *pp,
+	const size_t method,
+	const uint32_t n_futexes,
+	const size_t stride)
+{
+	uint32_t k = 0;
+
+	stress_parent_died_alarm();
+	(void)sched_settings_apply(true);
+
+	while (LIKELY(stress_continue_flag())) {
+		const uint32_t ack = __atomic_load_n(&pp->ack, __ATOMIC_ACQUIRE);
+		uint32_t *futex = &pp->futex[k * stride];
+
+		pp->t_wake = stress_latency_now();
+		(void)__atomic_add_fetch(futex, 1, __ATOMIC_SEQ_CST);
+		if (UNLIKELY(stress_futex_pingpong_wake(method, futex) < 0)) {
+			if (errno == ENOSYS)
+				return EXIT_NOT_IMPLEMENTED;
+			pr_fail("%s: futex wake failed, errno=%d (%s)\n",
+				args->name, errno, strerror(errno));
+			return EXIT_FAILURE;
+		}
+		while (__atomic_load_n(&pp->ack, __ATOMIC_ACQUIRE) == ack) {
+			struct timespec t;
+
+			if (UNLIKELY(!stress_continue_flag()))
+				return EXIT_SUCCESS;
+			t.tv_sec = 0;
+			t.tv_nsec = 100000000;
+			(void)shim_futex_wait(&pp->ack, (int)ack, &t);
+		}
+		k++;
+		if (k >= n_futexes)
+			k = 0;
+	}
+	return EXIT_SUCCESS;
+}
+
+/*
+ *  stress_futex_pingpong_wait()
+ *	waiter, wait with the method under test, returns 0 when woken
+ *	or if a futex had already changed, -1 and errno on error
+ */
+static int stress_futex_pingpong_wait(
+	stress_futex_pingpong_t *pp,
+	const size_t method,
+	const uint32_t *expected,
+	const uint32_t n_futexes)
+{
+	struct timespec t;
+	int ret;
+
+	stress_futex_timeout(&t, 100000000);
+	switch (method) {
+	case FUTEX_METHOD_WAITV: {
+#if defined(FUTEX_32)
+		struct shim_futex_waitv w[MAX_FUTEX_WAITV];
+		uint32_t i;
+
+		(void)shim_memset(w, 0, sizeof(*w) * n_futexes);
+		for (i = 0; i < n_futexes; i++) {
+			w[i].val = (uint64_t)expected[i];
+			w[i].uaddr = (uintptr_t)&pp->futex[i];
+			w[i].flags = FUTEX_32;
+		}
+		ret = shim_futex_waitv(w, n_futexes, 0, &t, CLOCK_MONOTONIC);
+		if (ret > 0)
+			ret = 0;	/* index of the woken futex */
+#else
+		(void)pp;
+		(void)expected;
+		(void)n_futexes;
+		errno = ENOSYS;
+		ret = -1;
+#endif
+		break;
+	}
+	case FUTEX_METHOD_FUTEX2_NUMA:
+		ret = stress_futex2_wait(&pp->futex[0], expected[0],
+			STRESS_FUTEX2_SIZE_U32 | STRESS_FUTEX2_NUMA, &t);
+		break;
+	default:
+		ret = stress_futex2_wait(&pp->futex[0], expected[0],
+			STRESS_FUTEX2_SIZE_U32, &t);
+		break;
+	}
+
+	/* value changed before the wait started, the wake was not missed */
+	if ((ret < 0) && (errno == EAGAIN))
+		ret = 0;
+	return ret;
+}
+
+/*
+ *  stress_futex_pingpong()
+ *	measure wake-to-run latency from a waker to a waiter, the
+ *	waker and waiter can be pinned to CPUs at a chosen distance
+ */
+static int stress_futex_pingpong(stress_args_t *args, const size_t method)
+{
+	stress_futex_pingpong_t *pp;
+	stress_latency_hist_t *hist;
+	const int32_t waker_cpu = stress_futex_cpu(args, "futex-waker-cpu");
+	const int32_t waiter_cpu = stress_futex_cpu(args, "futex-waiter-cpu");
+	const size_t stride = (method == FUTEX_METHOD_FUTEX2_NUMA) ? 2 : 1;
+	uint32_t expected[MAX_FUTEX_WAITV];
+	uint32_t n_futexes = DEFAULT_FUTEX_WAITV, i;
+	uint64_t wakes = 0, stalls = 0;
+	const char *distance;
+	char msg[64];
+	double t_start, duration, rate;
+	pid_t pid;
+	int rc = EXIT_SUCCESS;
+
+	(void)stress_get_setting("futex-waitv", &n_futexes);
+	if (method != FUTEX_METHOD_WAITV)
+		n_futexes = 1;
+	distance = ((waker_cpu < 0) || (waiter_cpu < 0)) ? "unpinned" :
+		stress_cpu_distance_name(stress_cpu_distance(waker_cpu, waiter_cpu));
+
+	pp = (stress_futex_pingpong_t *)stress_mmap_populate(NULL, sizeof(*pp),
+		PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+	if (pp == MAP_FAILED) {
+		pr_inf_skip("%s: cannot mmap %zu bytes, errno=%d (%s), skipping stressor\n",
+			args->name, sizeof(*pp), errno, strerror(errno));
+		return EXIT_NO_RESOURCE;
+	}
+	stress_set_vma_anon_name(pp, sizeof(*pp), "futex-pingpong");
+	hist = (stress_latency_hist_t *)malloc(sizeof(*hist));
+	if (!hist) {
+		pr_inf_skip("%s: cannot allocate latency histogram, skipping stressor\n", args->name);
+		(void)munmap((void *)pp, sizeof(*pp));
+		return EXIT_NO_RESOURCE;
+	}
+	stress_latency_hist_init(hist);
+	(void)shim_memset(expected, 0, sizeof(expected));
+	(void)shim_memset((void *)pp, 0, sizeof(*pp));
+	if (stride == 2) {
+		/* let the kernel pick the node of the first waiter */
+		for (i = 0; i < n_futexes; i++)
+			pp->futex[(i * stride) + 1] = STRESS_FUTEX_NO_NODE;
+	}
+
+	/* check the method is available before starting the waker */
+	if ((stress_futex_pingpong_wait(pp, method, expected, n_futexes) < 0) &&
+	    (errno != ETIMEDOUT)) {
+		if ((errno == ENOSYS) || (errno == EINVAL)) {
+			if (args->instance == 0)
+				pr_inf_skip("%s: %s futex method not supported, errno=%d (%s), "
+					"skipping stressor\n", args->name,
+					futex_methods[method], errno, strerror(errno));
+			rc = EXIT_NOT_IMPLEMENTED;
+		} else {
+			pr_fail("%s: %s futex wait failed, errno=%d (%s)\n",
+				args->name, futex_methods[method], errno, strerror(errno));
+			rc = EXIT_FAILURE;
+		}
+		goto free_pp;
+	}
+	pr_dbg("%s: waker CPU %" PRId32 ", waiter CPU %" PRId32 ", distance %s\n",
+		args->name, waker_cpu, waiter_cpu, distance);
+
+again:
+	pid = fork();
+	if (pid < 0) {
+		if (stress_redo_fork(args, errno))
+			goto again;
+		if (UNLIKELY(!stress_continue(args)))
+			goto free_pp;
+		pr_err("%s: fork failed: errno=%d: (%s)\n",
+			args->name, errno, strerror(errno));
+		rc = EXIT_NO_RESOURCE;
+		goto free_pp;
+	} else if (pid == 0) {
+		stress_placement_set(waker_cpu);
+		_exit(stress_futex_pingpong_waker(args, pp, method, n_futexes, stride));
+	}
+
+	stress_placement_set(waiter_cpu);
+	t_start = stress_time_now();
+	do {
+		uint64_t ns;
+		bool woken = false;
+
+		if (UNLIKELY(stress_futex_pingpong_wait(pp, method, expected, n_futexes) < 0)) {
+			if (errno == ETIMEDOUT) {
+				stalls++;
+				continue;
+			}
+			if (errno == EINTR)
+				continue;
+			pr_fail("%s: %s futex wait failed, errno=%d (%s)\n",
+				args->name, futex_methods[method], errno, strerror(errno));
+			rc = EXIT_FAILURE;
+			break;
+		}
+		ns = stress_latency_now();
+		for (i = 0; i < n_futexes; i++) {
+			const uint32_t val = __atomic_load_n(&pp->futex[i * stride], __ATOMIC_ACQUIRE);
+
+			if (val != expected[i]) {
+				expected[i] = val;
+				woken = true;
+			}
+		}
+		if (!woken)
+			continue;	/* spurious wakeup */
+		ns = (ns > pp->t_wake) ? ns - pp->t_wake : 0;
+		stress_latency_hist_record(hist, ns);
+		stress_latency_record(args, 0, ns);
+		wakes++;
+		stress_bogo_inc(args);
+		(void)__atomic_add_fetch(&pp->ack, 1, __ATOMIC_RELEASE);
+		(void)shim_futex_wake(&pp->ack, 1);
+	} while (stress_continue(args));
+	duration = stress_time_now() - t_start;
+
+	(void)shim_kill(pid, SIGALRM);
+	(void)__atomic_add_fetch(&pp->ack, 1, __ATOMIC_RELEASE);
+	(void)shim_futex_wake(&pp->ack, 1);
+	{
+		int status;
+
+		if ((shim_waitpid(pid, &status, 0) == pid) && WIFEXITED(status) &&
+		    (WEXITSTATUS(status) != EXIT_SUCCESS) && (rc == EXIT_SUCCESS))
+			rc = WEXITSTATUS(status);
+	}
+	if (stalls)
+		pr_dbg("%s: %" PRIu64 " waits timed out\n", args->name, stalls);
+
+	/* each round trip is a wake of the waiter and a wake of the waker */
+	rate = (duration > 0.0) ? (double)(wakes * 2) / duration : 0.0;
+	(void)snprintf(msg, sizeof(msg), "wakes per sec, %s", distance);
+	stress_metrics_set(args, 0, msg, rate, STRESS_METRIC_HARMONIC_MEAN);
+	(void)snprintf(msg, sizeof(msg), "wake latency mean (usec), %s", distance);
+	stress_metrics_set(args, 1, msg, stress_latency_hist_mean(hist) / 1000.0,
+		STRESS_METRIC_GEOMETRIC_MEAN);
+	(void)snprintf(msg, sizeof(msg), "wake latency p50 (usec), %s", distance);
+	stress_metrics_set(args, 2, msg,
+		(double)stress_latency_hist_percentile(hist, 50.0) / 1000.0,
+		STRESS_METRIC_GEOMETRIC_MEAN);
+	(void)snprintf(msg, sizeof(msg), "wake latency p90 (usec), %s", distance);
+	stress_metrics_set(args, 3, msg,
+		(double)stress_latency_hist_percentile(hist, 90.0) / 1000.0,
+		STRESS_METRIC_GEOMETRIC_MEAN);
+	(void)snprintf(msg, sizeof(msg), "wake latency p99 (usec), %s", distance);
+	stress_metrics_set(args, 4, msg,
+		(double)stress_latency_hist_percentile(hist, 99.0) / 1000.0,
+		STRESS_METRIC_GEOMETRIC_MEAN);
+	(void)snprintf(msg, sizeof(msg), "wake latency p99.9 (usec), %s", distance);
+	stress_metrics_set(args, 5, msg,
+		(double)stress_latency_hist_percentile(hist, 99.9) / 1000.0,
+		STRESS_METRIC_GEOMETRIC_MEAN);
+
+free_pp:
+	free(hist);
+	(void)munmap((void *)pp, sizeof(*pp));
+
+	return rc;
+}
+
 /*
  *  stress_futex()
  *	stress system by futex calls. The intention is not to
@@ -99,6 +518,23 @@ static int stress_futex(stress_args_t *args)
 	uint32_t *futex = &g_shared->futex.futex[args->instance];
 	pid_t pid;
 	int parent_cpu, rc = EXIT_SUCCESS;
+	size_t futex_method = FUTEX_METHOD_CLASSIC;
+
+	(void)stress_get_setting("futex-method", &futex_method);
+	if (futex_method != FUTEX_METHOD_CLASSIC) {
+		stress_latency_set_description(args, 0, "futex wake-to-run");
+
+		stress_set_proc_state(args->name, STRESS_STATE_SYNC_WAIT);
+		stress_sync_start_wait(args);
+		stress_set_proc_state(args->name, STRESS_STATE_RUN);
+		rc = stress_futex_pingpong(args, futex_method);
+		stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
+		return rc;
+	}
+
+	/* the waker and waiter record into separate histograms */
+	stress_latency_set_description(args, 0, "futex wake");
+	stress_latency_set_description(args, 1, "futex wakeup");
 
 	stress_set_proc_state(args->name, STRESS_STATE_SYNC_WAIT);
 	stress_sync_start_wait(args);
@@ -119,6 +555,7 @@ again:
 
 		do {
 			int ret;
+			uint64_t t_lat;
 
 			/*
 			 *  Break early in case wake gets stuck
@@ -126,7 +563,10 @@ again:
 			 */
 			if (UNLIKELY(!stress_continue_flag()))
 				break;
+			t_lat = stress_latency_begin(args);
 			ret = shim_futex_wake(futex, 1);
+			if (ret > 0)
+				stress_latency_end(args, 0, t_lat);
 			if (g_opt_flags & OPT_FLAGS_VERIFY) {
 				if (ret < 0) {
 					pr_fail("%s: futex_wake failed, errno=%d (%s)\n",
@@ -152,12 +592,16 @@ again:
 		do {
 			/* Small timeout to force rapid timer wakeups */
 			int ret;
+			uint64_t t_lat;
 
 			/* Break early before potential long wait */
 			if (UNLIKELY(!stress_continue_flag()))
 				break;
 
+			t_lat = stress_latency_begin(args);
 			ret = stress_futex_wait(futex, 0, 5000);
+			if (ret == 0)
+				stress_latency_end(args, 1, t_lat);
 
 			/* timeout, re-do, stress on stupid fast polling */
 			if ((ret < 0) && (errno == ETIMEDOUT)) {
@@ -192,13 +636,16 @@ finish:
 const stressor_info_t stress_futex_info = {
 	.stressor = stress_futex,
 	.class = CLASS_SCHEDULER | CLASS_OS | CLASS_IPC,
+	.opts = opts,
 	.verify = VERIFY_OPTIONAL,
+	.metrics_max = 6,
 	.help = help
 };
 #else
 const stressor_info_t stress_futex_info = {
 	.stressor = stress_unimplemented,
 	.class = CLASS_SCHEDULER | CLASS_OS | CLASS_IPC,
+	.opts = opts,
 	.verify = VERIFY_OPTIONAL,
 	.help = help,
 	.unimplemented_reason = "built without linux/futex.h or futex() system call"
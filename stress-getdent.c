@@ -324,6 +324,7 @@ const stressor_info_t stress_getdent_info = {
 	.stressor = stress_getdent,
 	.class = CLASS_FILESYSTEM | CLASS_OS,
 	.verify = VERIFY_ALWAYS,
+	.metrics_max = 1,
 	.help = help
 };
 #else
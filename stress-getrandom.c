@@ -182,6 +182,7 @@ const stressor_info_t stress_getrandom_info = {
 	.supported = stress_getrandom_supported,
 	.class = CLASS_OS | CLASS_CPU,
 	.verify = VERIFY_ALWAYS,
+	.metrics_max = 1,
 	.help = help
 };
 #else
@@ -444,6 +444,7 @@ const stressor_info_t stress_goto_info = {
 	.class = CLASS_CPU,
 	.opts = opts,
 	.verify = VERIFY_ALWAYS,
+	.metrics_max = 1,
 	.help = help
 };
 #else
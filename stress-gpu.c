@@ -18,6 +18,8 @@
  *
  */
 #include "stress-ng.h"
+#include "core-builtin.h"
+#include "core-latency.h"
 #include "core-out-of-memory.h"
 #include "core-pthread.h"
 
@@ -82,6 +84,46 @@ static struct gbm_surface *gs;
 static const char default_gpu_devnode[] = "/dev/dri/renderD128";
 static GLubyte *teximage = NULL;
 
+/* EXT_disjoint_timer_query tokens, gl2ext.h may not be available */
+#if !defined(GL_QUERY_RESULT_EXT)
+#define GL_QUERY_RESULT_EXT		(0x8866)
+#endif
+#if !defined(GL_TIME_ELAPSED_EXT)
+#define GL_TIME_ELAPSED_EXT		(0x88BF)
+#endif
+#if !defined(GL_GPU_DISJOINT_EXT)
+#define GL_GPU_DISJOINT_EXT		(0x8FBB)
+#endif
+
+typedef void (GL_APIENTRY *stress_gl_gen_queries_t)(GLsizei n, GLuint *ids);
+typedef void (GL_APIENTRY *stress_gl_delete_queries_t)(GLsizei n, const GLuint *ids);
+typedef void (GL_APIENTRY *stress_gl_begin_query_t)(GLenum target, GLuint id);
+typedef void (GL_APIENTRY *stress_gl_end_query_t)(GLenum target);
+typedef void (GL_APIENTRY *stress_gl_get_query_objectui64v_t)(GLuint id, GLenum pname, uint64_t *params);
+
+/* GPU timer queries, upload and draw are timed separately */
+typedef struct {
+	stress_gl_gen_queries_t gen_queries;
+	stress_gl_delete_queries_t delete_queries;
+	stress_gl_begin_query_t begin_query;
+	stress_gl_end_query_t end_query;
+	stress_gl_get_query_objectui64v_t get_query_objectui64v;
+	GLuint query[2];		/* upload and draw queries */
+	bool enabled;			/* true if timer queries are usable */
+} stress_gpu_timer_t;
+
+/* per frame GPU timing statistics */
+typedef struct {
+	double upload_ns;		/* GPU time uploading textures */
+	double upload_bytes;		/* bytes uploaded in timed frames */
+	double draw_ns;			/* GPU time clearing and drawing */
+	double pixels;			/* pixels drawn in timed frames */
+	stress_latency_hist_t *frame_hist; /* frame time histogram */
+} stress_gpu_stats_t;
+
+static stress_gpu_timer_t gpu_timer;
+static stress_gpu_stats_t gpu_stats;
+
 static void stress_gpu_trim_newline(char *str)
 {
 	char *ptr = strrchr(str, '\n');
@@ -299,19 +341,95 @@ static int gles2_init(
 	return EXIT_SUCCESS;
 }
 
-static void stress_gpu_run(const GLsizei texsize, const GLsizei uploads)
+/*
+ *  stress_gpu_timer_init()
+ *	look up the EXT_disjoint_timer_query functions, if the
+ *	extension is not available the GPU timings are not reported
+ */
+static void stress_gpu_timer_init(stress_args_t *args)
+{
+	const char *extensions = (const char *)glGetString(GL_EXTENSIONS);
+
+	(void)shim_memset(&gpu_timer, 0, sizeof(gpu_timer));
+	if (!extensions || !strstr(extensions, "GL_EXT_disjoint_timer_query")) {
+		if (args->instance == 0)
+			pr_inf("%s: EXT_disjoint_timer_query not supported, "
+				"upload and fill rate metrics disabled\n", args->name);
+		return;
+	}
+	gpu_timer.gen_queries = (stress_gl_gen_queries_t)
+		eglGetProcAddress("glGenQueriesEXT");
+	gpu_timer.delete_queries = (stress_gl_delete_queries_t)
+		eglGetProcAddress("glDeleteQueriesEXT");
+	gpu_timer.begin_query = (stress_gl_begin_query_t)
+		eglGetProcAddress("glBeginQueryEXT");
+	gpu_timer.end_query = (stress_gl_end_query_t)
+		eglGetProcAddress("glEndQueryEXT");
+	gpu_timer.get_query_objectui64v = (stress_gl_get_query_objectui64v_t)
+		eglGetProcAddress("glGetQueryObjectui64vEXT");
+	if (!gpu_timer.gen_queries || !gpu_timer.delete_queries ||
+	    !gpu_timer.begin_query || !gpu_timer.end_query ||
+	    !gpu_timer.get_query_objectui64v)
+		return;
+
+	gpu_timer.gen_queries(2, gpu_timer.query);
+	gpu_timer.enabled = (glGetError() == GL_NO_ERROR);
+}
+
+/*
+ *  stress_gpu_run()
+ *	render a frame, the CPU wall clock frame time is recorded
+ *	and the GPU upload and draw times are accounted from timer
+ *	queries, frames where the GPU timer was disjoint (e.g. by a
+ *	frequency change) are not accounted
+ */
+static void stress_gpu_run(
+	stress_args_t *args,
+	const GLsizei texsize,
+	const GLsizei uploads,
+	const double pixels)
 {
+	const uint64_t t_begin = stress_latency_now();
+	uint64_t frame_ns;
+	int i = 0;
+
+	if (gpu_timer.enabled)
+		gpu_timer.begin_query(GL_TIME_ELAPSED_EXT, gpu_timer.query[0]);
 	if (texsize > 0) {
-		int i;
 		for (i = 0; LIKELY(stress_continue_flag() && (i < uploads)); i++) {
 			glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, texsize,
 				     texsize, 0, GL_RGBA, GL_UNSIGNED_BYTE,
 				     teximage);
 		}
 	}
+	if (gpu_timer.enabled) {
+		gpu_timer.end_query(GL_TIME_ELAPSED_EXT);
+		gpu_timer.begin_query(GL_TIME_ELAPSED_EXT, gpu_timer.query[1]);
+	}
 	glClear(GL_COLOR_BUFFER_BIT);
 	glDrawArrays(GL_TRIANGLES, 0, 6);
+	if (gpu_timer.enabled)
+		gpu_timer.end_query(GL_TIME_ELAPSED_EXT);
 	glFinish();
+	frame_ns = stress_latency_now() - t_begin;
+
+	stress_latency_hist_record(gpu_stats.frame_hist, frame_ns);
+	stress_latency_record(args, 0, frame_ns);
+
+	if (gpu_timer.enabled) {
+		uint64_t upload_ns = 0, draw_ns = 0;
+		GLint disjoint = 0;
+
+		gpu_timer.get_query_objectui64v(gpu_timer.query[0], GL_QUERY_RESULT_EXT, &upload_ns);
+		gpu_timer.get_query_objectui64v(gpu_timer.query[1], GL_QUERY_RESULT_EXT, &draw_ns);
+		glGetIntegerv(GL_GPU_DISJOINT_EXT, &disjoint);
+		if (!disjoint) {
+			gpu_stats.upload_ns += (double)upload_ns;
+			gpu_stats.upload_bytes += (double)i * (double)texsize * (double)texsize * 4.0;
+			gpu_stats.draw_ns += (double)draw_ns;
+			gpu_stats.pixels += pixels;
+		}
+	}
 }
 
 static int get_config(stress_args_t *args, EGLConfig *config)
@@ -513,10 +631,10 @@ static int stress_gpu_child(stress_args_t *args, void *context)
 	const char *gpu_devnode = default_gpu_devnode;
 	struct sigaction old_action;
 	sigset_t set;
+	double pixels, rate;
 #if defined(HAVE_LIB_PTHREAD)
 	pthread_t pthread;
 	int pret;
-	double rate;
 
 	gpu_freq_sum = 0.0;
 	gpu_freq_count = 0;
@@ -553,6 +671,18 @@ static int stress_gpu_child(stress_args_t *args, void *context)
 	if (ret != EXIT_SUCCESS)
 		goto deinit;
 
+	(void)shim_memset(&gpu_stats, 0, sizeof(gpu_stats));
+	gpu_stats.frame_hist = (stress_latency_hist_t *)malloc(sizeof(*gpu_stats.frame_hist));
+	if (!gpu_stats.frame_hist) {
+		pr_inf_skip("%s: failed to allocate frame time histogram, skipping stressor\n", args->name);
+		ret = EXIT_NO_RESOURCE;
+		goto deinit;
+	}
+	stress_latency_hist_init(gpu_stats.frame_hist);
+	stress_latency_set_description(args, 0, "gpu frame");
+	stress_gpu_timer_init(args);
+	pixels = (double)size_x * (double)size_y;
+
 #if defined(HAVE_LIB_PTHREAD)
 	pret = pthread_create(&pthread, NULL, stress_gpu_pthread, (void *)args);
 #endif
@@ -570,7 +700,7 @@ static int stress_gpu_child(stress_args_t *args, void *context)
 	}
 
 	do {
-		stress_gpu_run(texsize, uploads);
+		stress_gpu_run(args, texsize, uploads, pixels);
 		if (glGetError() != GL_NO_ERROR)
 			return EXIT_NO_RESOURCE;
 		stress_bogo_inc(args);
@@ -588,12 +718,39 @@ finish:
 					rate, STRESS_METRIC_HARMONIC_MEAN);
 	}
 #endif
+	if (gpu_timer.enabled) {
+		rate = (gpu_stats.upload_ns > 0.0) ? gpu_stats.upload_bytes / gpu_stats.upload_ns : 0.0;
+		if (rate > 0.0)
+			stress_metrics_set(args, 1, "GB per sec texture upload rate",
+					rate, STRESS_METRIC_HARMONIC_MEAN);
+		rate = (gpu_stats.draw_ns > 0.0) ? gpu_stats.pixels / gpu_stats.draw_ns : 0.0;
+		if (rate > 0.0)
+			stress_metrics_set(args, 2, "Gpixels per sec fill rate",
+					rate, STRESS_METRIC_HARMONIC_MEAN);
+	}
+	if (gpu_stats.frame_hist->count > 0) {
+		stress_metrics_set(args, 3, "frame time p50 (msec)",
+			(double)stress_latency_hist_percentile(gpu_stats.frame_hist, 50.0) / 1000000.0,
+			STRESS_METRIC_GEOMETRIC_MEAN);
+		stress_metrics_set(args, 4, "frame time p95 (msec)",
+			(double)stress_latency_hist_percentile(gpu_stats.frame_hist, 95.0) / 1000000.0,
+			STRESS_METRIC_GEOMETRIC_MEAN);
+		stress_metrics_set(args, 5, "frame time p99 (msec)",
+			(double)stress_latency_hist_percentile(gpu_stats.frame_hist, 99.0) / 1000000.0,
+			STRESS_METRIC_GEOMETRIC_MEAN);
+	}
 
 	do_jmp = false;
 	(void)stress_sigrestore(args->name, SIGALRM, &old_action);
 
 	ret = EXIT_SUCCESS;
 deinit:
+	if (gpu_timer.enabled) {
+		gpu_timer.delete_queries(2, gpu_timer.query);
+		gpu_timer.enabled = false;
+	}
+	free(gpu_stats.frame_hist);
+	gpu_stats.frame_hist = NULL;
 	if (teximage)
 		free(teximage);
 
@@ -612,6 +769,7 @@ const stressor_info_t stress_gpu_info = {
 	.class = CLASS_GPU,
 	.opts = opts,
 	.supported = stress_gpu_supported,
+	.metrics_max = 6,
 	.help = help
 };
 #else
@@ -20,6 +20,7 @@
 #include "core-attribute.h"
 #include "core-builtin.h"
 #include "core-hash.h"
+#include "core-put.h"
 
 #include <math.h>
 
@@ -30,6 +31,12 @@
 #define STRESS_HASH_N_BUCKETS	(256)
 #define STRESS_HASH_N_KEYS	(128)
 
+#define STRESS_HASH_BULK_MIN_SHIFT	(4)	/* 16 bytes */
+#define STRESS_HASH_BULK_SHIFT_STEP	(2)
+#define STRESS_HASH_BULK_SIZES		(9)	/* 16 bytes .. 1 MB */
+#define STRESS_HASH_BULK_BUF_SIZE	((size_t)1 << (STRESS_HASH_BULK_MIN_SHIFT + \
+					 (STRESS_HASH_BULK_SHIFT_STEP * (STRESS_HASH_BULK_SIZES - 1))))
+
 typedef struct {
 	double		duration;
 	double		chi_squared;
@@ -46,15 +53,21 @@ typedef struct stress_hash_method_info stress_hash_method_info_t;
 
 typedef uint32_t (*stress_hash_func)(const char *str, const size_t len);
 typedef int (*stress_method_func)(const char *name, const stress_hash_method_info_t *hmi, stress_bucket_t *bucket);
+typedef uint64_t (*stress_hash_bulk_func)(const uint8_t *data, const size_t len);
 
 struct stress_hash_method_info {
 	const char		*name;	/* human readable form of stressor */
 	const stress_method_func	func;	/* the hash method function */
-	stress_hash_stats_t	*stats;
 };
 
+static const stress_hash_method_info_t hash_methods[];
+
+/* per instance method stats, instances may be run as threads */
+static STRESS_THREAD_LOCAL stress_hash_stats_t *hash_stats;
+
 static const stress_help_t help[] = {
 	{ NULL,  "hash N",		"start N workers that exercise various hash functions" },
+	{ NULL,  "hash-bulk",		"measure GB/s of buffer hashes on 16 byte to 1 MB inputs" },
 	{ NULL,  "hash-method M",	"specify stress hash method M, default is all" },
 	{ NULL,  "hash-ops N",		"stop after N hash bogo operations" },
 	{ NULL,	 NULL,			NULL }
@@ -76,7 +89,7 @@ static int stress_hash_generic(
 	uint32_t i_sum = 0;
 	size_t i;
 	const uint32_t result = stress_little_endian() ? le_result: be_result;
-	stress_hash_stats_t *stats = hmi->stats;
+	stress_hash_stats_t *stats = &hash_stats[hmi - hash_methods];
 	double t1, t2;
 	const bool verify = !!(g_opt_flags & OPT_FLAGS_VERIFY);
 
@@ -580,36 +593,36 @@ static OPTIMIZE3 int stress_hash_all(
 /*
  * Table of has stress methods
  */
-static stress_hash_method_info_t hash_methods[] = {
-	{ "all",		stress_hash_all,		NULL },	/* Special "all" test */
-	{ "adler32",		stress_hash_method_adler32,	NULL },
-	{ "coffin",		stress_hash_method_coffin,	NULL },
-	{ "coffin32",		stress_hash_method_coffin32,	NULL },
-	{ "crc32c",		stress_hash_method_crc32c,	NULL },
-	{ "djb2a",		stress_hash_method_djb2a,	NULL },
-	{ "fnv1a",		stress_hash_method_fnv1a,	NULL },
-	{ "jenkin",		stress_hash_method_jenkin,	NULL },
-	{ "kandr",		stress_hash_method_kandr,	NULL },
-	{ "knuth",		stress_hash_method_knuth,	NULL },
-	{ "loselose",		stress_hash_method_loselose,	NULL },
-	{ "mid5",		stress_hash_method_mid5,	NULL },
-	{ "muladd32",		stress_hash_method_muladd32,	NULL },
-	{ "muladd64",		stress_hash_method_muladd64,	NULL },
-	{ "mulxror32",		stress_hash_method_mulxror32,	NULL },
-	{ "mulxror64",		stress_hash_method_mulxror64,	NULL },
-	{ "murmur3_32",		stress_hash_method_murmur3_32,	NULL },
-	{ "nhash",		stress_hash_method_nhash,	NULL },
-	{ "pjw",		stress_hash_method_pjw,		NULL },
-	{ "sdbm",		stress_hash_method_sdbm,	NULL },
-	{ "sedgwick",		stress_hash_method_sedgwick,	NULL },
-	{ "sobel",		stress_hash_method_sobel,	NULL },
-	{ "x17",		stress_hash_method_x17,		NULL },
-	{ "xor",		stress_hash_method_xor,		NULL },
-	{ "xorror32",		stress_hash_method_xorror32,	NULL },
-	{ "xorror64",		stress_hash_method_xorror64,	NULL },
+static const stress_hash_method_info_t hash_methods[] = {
+	{ "all",		stress_hash_all },	/* Special "all" test */
+	{ "adler32",		stress_hash_method_adler32 },
+	{ "coffin",		stress_hash_method_coffin },
+	{ "coffin32",		stress_hash_method_coffin32 },
+	{ "crc32c",		stress_hash_method_crc32c },
+	{ "djb2a",		stress_hash_method_djb2a },
+	{ "fnv1a",		stress_hash_method_fnv1a },
+	{ "jenkin",		stress_hash_method_jenkin },
+	{ "kandr",		stress_hash_method_kandr },
+	{ "knuth",		stress_hash_method_knuth },
+	{ "loselose",		stress_hash_method_loselose },
+	{ "mid5",		stress_hash_method_mid5 },
+	{ "muladd32",		stress_hash_method_muladd32 },
+	{ "muladd64",		stress_hash_method_muladd64 },
+	{ "mulxror32",		stress_hash_method_mulxror32 },
+	{ "mulxror64",		stress_hash_method_mulxror64 },
+	{ "murmur3_32",		stress_hash_method_murmur3_32 },
+	{ "nhash",		stress_hash_method_nhash },
+	{ "pjw",		stress_hash_method_pjw },
+	{ "sdbm",		stress_hash_method_sdbm },
+	{ "sedgwick",		stress_hash_method_sedgwick },
+	{ "sobel",		stress_hash_method_sobel },
+	{ "x17",		stress_hash_method_x17 },
+	{ "xor",		stress_hash_method_xor },
+	{ "xorror32",		stress_hash_method_xorror32 },
+	{ "xorror64",		stress_hash_method_xorror64 },
 #if defined(HAVE_XXHASH_H) &&	\
     defined(HAVE_LIB_XXHASH)
-	{ "xxh64",		stress_hash_method_xxh64,	NULL },
+	{ "xxh64",		stress_hash_method_xxh64 },
 #endif
 };
 
@@ -624,7 +637,7 @@ static OPTIMIZE3 int stress_hash_all(
 	const stress_hash_method_info_t *hmi,
 	stress_bucket_t *bucket)
 {
-	static size_t i = 1;	/* Skip over stress_hash_all */
+	static STRESS_THREAD_LOCAL size_t i = 1;	/* Skip over stress_hash_all */
 	const stress_hash_method_info_t *h = &hash_methods[i];
 	int rc;
 
@@ -637,7 +650,206 @@ static OPTIMIZE3 int stress_hash_all(
 	return rc;
 }
 
-static stress_hash_stats_t hash_stats[NUM_HASH_METHODS];
+static uint64_t PURE stress_hash_bulk_crc32c(const uint8_t *data, const size_t len)
+{
+	return (uint64_t)stress_hash_crc32c_buf(data, len);
+}
+
+static uint64_t PURE stress_hash_bulk_crc32c_hw(const uint8_t *data, const size_t len)
+{
+	return (uint64_t)stress_hash_crc32c_hw(data, len);
+}
+
+static uint64_t PURE stress_hash_bulk_crc32c_pclmul(const uint8_t *data, const size_t len)
+{
+	return (uint64_t)stress_hash_crc32c_pclmul(data, len);
+}
+
+static uint64_t PURE stress_hash_bulk_jenkin(const uint8_t *data, const size_t len)
+{
+	return (uint64_t)stress_hash_jenkin(data, len);
+}
+
+static uint64_t PURE stress_hash_bulk_murmur3_32(const uint8_t *data, const size_t len)
+{
+	return (uint64_t)stress_hash_murmur3_32(data, len, 0xf261eab7);
+}
+
+#if defined(HAVE_XXHASH_H) &&	\
+    defined(HAVE_LIB_XXHASH)
+static uint64_t PURE stress_hash_bulk_xxh64(const uint8_t *data, const size_t len)
+{
+	return (uint64_t)XXH64(data, len, 0xf261eab7);
+}
+#endif
+
+typedef struct {
+	const char		*name;		/* method name */
+	const stress_hash_bulk_func func;	/* buffer hash function */
+	bool (*usable)(void);			/* NULL = always usable */
+} stress_hash_bulk_method_t;
+
+/*
+ *  Table of buffer hash methods for the --hash-bulk sweep
+ */
+static const stress_hash_bulk_method_t hash_bulk_methods[] = {
+	{ "crc32c",		stress_hash_bulk_crc32c,	NULL },
+	{ "crc32c-hw",		stress_hash_bulk_crc32c_hw,	stress_hash_crc32c_hw_usable },
+	{ "crc32c-pclmul",	stress_hash_bulk_crc32c_pclmul,	stress_hash_crc32c_pclmul_usable },
+	{ "jenkin",		stress_hash_bulk_jenkin,	NULL },
+	{ "murmur3_32",		stress_hash_bulk_murmur3_32,	NULL },
+	{ "xxvec64",		stress_hash_xxvec64,		NULL },
+#if defined(HAVE_XXHASH_H) &&	\
+    defined(HAVE_LIB_XXHASH)
+	{ "xxh64",		stress_hash_bulk_xxh64,		NULL },
+#endif
+};
+
+#define NUM_HASH_BULK_METHODS	(SIZEOF_ARRAY(hash_bulk_methods))
+
+/*
+ *  stress_hash_bulk_check()
+ *	sanity check the accelerated crc32c variants against
+ *	the table driven implementation
+ */
+static int stress_hash_bulk_check(
+	stress_args_t *args,
+	const bool *usable,
+	const uint8_t *buf)
+{
+	static const char check[] = "123456789";
+	size_t i, len;
+
+	for (i = 0; i < NUM_HASH_BULK_METHODS; i++) {
+		const stress_hash_bulk_func func = hash_bulk_methods[i].func;
+
+		if (!usable[i] || strncmp(hash_bulk_methods[i].name, "crc32c", 6))
+			continue;
+		if (func((const uint8_t *)check, sizeof(check) - 1) != 0xe3069283) {
+			pr_fail("%s: %s check value failed, expected 0xe3069283\n",
+				args->name, hash_bulk_methods[i].name);
+			return EXIT_FAILURE;
+		}
+		for (len = 0; len <= STRESS_HASH_BULK_BUF_SIZE; len = (len < 512) ? len + 1 : len * 2) {
+			const uint64_t expected = stress_hash_bulk_crc32c(buf + (len & 7), len);
+			const uint64_t got = func(buf + (len & 7), len);
+
+			if (got != expected) {
+				pr_fail("%s: %s on %zu bytes failed, expected %" PRIx64 ", got %" PRIx64 "\n",
+					args->name, hash_bulk_methods[i].name, len, expected, got);
+				return EXIT_FAILURE;
+			}
+		}
+	}
+	return EXIT_SUCCESS;
+}
+
+/*
+ *  stress_hash_bulk()
+ *	sweep buffer hashes over input sizes from 16 bytes to 1 MB,
+ *	each size hashes the whole buffer once in size sized chunks,
+ *	and report the throughput per method and size in GB/s
+ */
+static int stress_hash_bulk(stress_args_t *args)
+{
+	stress_metrics_t metrics[NUM_HASH_BULK_METHODS][STRESS_HASH_BULK_SIZES];
+	bool usable[NUM_HASH_BULK_METHODS];
+	uint8_t *buf;
+	size_t i, j;
+	int rc;
+
+	buf = (uint8_t *)stress_mmap_populate(NULL, STRESS_HASH_BULK_BUF_SIZE,
+			PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (buf == MAP_FAILED) {
+		pr_inf_skip("%s: cannot mmap %zu bytes for bulk hash buffer, "
+			"skipping stressor\n", args->name, STRESS_HASH_BULK_BUF_SIZE);
+		return EXIT_NO_RESOURCE;
+	}
+	stress_set_vma_anon_name(buf, STRESS_HASH_BULK_BUF_SIZE, "hash-data");
+	stress_mwc_fill(buf, STRESS_HASH_BULK_BUF_SIZE);
+
+	for (i = 0; i < NUM_HASH_BULK_METHODS; i++) {
+		usable[i] = hash_bulk_methods[i].usable ? hash_bulk_methods[i].usable() : true;
+		if (!usable[i] && (args->instance == 0))
+			pr_inf("%s: %s not supported on this system, skipping it\n",
+				args->name, hash_bulk_methods[i].name);
+	}
+	stress_zero_metrics(&metrics[0][0], NUM_HASH_BULK_METHODS * STRESS_HASH_BULK_SIZES);
+
+	rc = stress_hash_bulk_check(args, usable, buf);
+	if (rc != EXIT_SUCCESS)
+		goto tidy;
+
+	stress_set_proc_state(args->name, STRESS_STATE_SYNC_WAIT);
+	stress_sync_start_wait(args);
+	stress_set_proc_state(args->name, STRESS_STATE_RUN);
+
+	do {
+		for (i = 0; i < NUM_HASH_BULK_METHODS; i++) {
+			const stress_hash_bulk_func func = hash_bulk_methods[i].func;
+
+			if (!usable[i])
+				continue;
+			for (j = 0; j < STRESS_HASH_BULK_SIZES; j++) {
+				const size_t size = (size_t)1 << (STRESS_HASH_BULK_MIN_SHIFT +
+							 (j * STRESS_HASH_BULK_SHIFT_STEP));
+				const uint8_t *ptr, *end = buf + STRESS_HASH_BULK_BUF_SIZE;
+				uint64_t sum = 0;
+				double t;
+
+				t = stress_time_now();
+				for (ptr = buf; ptr < end; ptr += size)
+					sum += func(ptr, size);
+				metrics[i][j].duration += stress_time_now() - t;
+				metrics[i][j].count += (double)STRESS_HASH_BULK_BUF_SIZE;
+				stress_uint64_put(sum);
+			}
+			if (UNLIKELY(!stress_continue_flag()))
+				break;
+		}
+		stress_bogo_inc(args);
+	} while (stress_continue(args));
+
+	if (args->instance == 0) {
+		pr_block_begin();
+		pr_inf("%s: %13.13s %s\n", args->name, "GB/s per size",
+			"     16B     64B    256B     1KB     4KB    16KB    64KB   256KB     1MB");
+	}
+	for (i = 0; i < NUM_HASH_BULK_METHODS; i++) {
+		char line[STRESS_HASH_BULK_SIZES * 8 + 1];
+		char *ptr = line;
+
+		*ptr = '\0';
+		for (j = 0; j < STRESS_HASH_BULK_SIZES; j++) {
+			const size_t size = (size_t)1 << (STRESS_HASH_BULK_MIN_SHIFT +
+						 (j * STRESS_HASH_BULK_SHIFT_STEP));
+			const double duration = metrics[i][j].duration;
+			const double rate = (duration > 0.0) ? metrics[i][j].count / (duration * 1.0E9) : 0.0;
+			char msg[64];
+
+			(void)snprintf(ptr, sizeof(line) - (size_t)(ptr - line), " %7.2f", rate);
+			ptr += 8;
+			if (duration <= 0.0)
+				continue;
+			if (size < 1024)
+				(void)snprintf(msg, sizeof(msg), "%s %zuB GB/sec", hash_bulk_methods[i].name, size);
+			else if (size < 1024 * 1024)
+				(void)snprintf(msg, sizeof(msg), "%s %zuKB GB/sec", hash_bulk_methods[i].name, size >> 10);
+			else
+				(void)snprintf(msg, sizeof(msg), "%s %zuMB GB/sec", hash_bulk_methods[i].name, size >> 20);
+			stress_metrics_set(args, (i * STRESS_HASH_BULK_SIZES) + j, msg,
+				rate, STRESS_METRIC_HARMONIC_MEAN);
+		}
+		if (usable[i] && (args->instance == 0))
+			pr_inf("%s: %13.13s%s\n", args->name, hash_bulk_methods[i].name, line);
+	}
+	if (args->instance == 0)
+		pr_block_end();
+tidy:
+	(void)munmap((void *)buf, STRESS_HASH_BULK_BUF_SIZE);
+
+	return rc;
+}
 
 /*
  *  stress_hash()
@@ -648,18 +860,28 @@ static int OPTIMIZE3 stress_hash(stress_args_t *args)
 	size_t i;
 	const stress_hash_method_info_t *hm;
 	size_t hash_method = 0;
+	stress_hash_stats_t stats[NUM_HASH_METHODS];
 	stress_bucket_t bucket;
 	int rc = EXIT_SUCCESS;
+	bool hash_bulk = false;
+
+	(void)stress_get_setting("hash-bulk", &hash_bulk);
+	if (hash_bulk) {
+		rc = stress_hash_bulk(args);
+		stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
+
+		return rc;
+	}
 
 	(void)stress_get_setting("hash-method", &hash_method);
 	hm = &hash_methods[hash_method];
 
 	for (i = 0; i < NUM_HASH_METHODS; i++) {
-		hash_stats[i].duration = 0.0;
-		hash_stats[i].total = false;
-		hash_stats[i].chi_squared = 0.0;
-		hash_methods[i].stats = &hash_stats[i];
+		stats[i].duration = 0.0;
+		stats[i].total = false;
+		stats[i].chi_squared = 0.0;
 	}
+	hash_stats = stats;
 
 	if (args->instance == 0)
 		pr_dbg("%s: using method '%s'\n", args->name, hm->name);
@@ -680,19 +902,20 @@ static int OPTIMIZE3 stress_hash(stress_args_t *args)
 		pr_block_begin();
 		pr_inf("%s: %12.12s %15s %10s\n", args->name, "hash", "hashes/sec", "chi squared");
 		for (i = 1; i < NUM_HASH_METHODS; i++) {
-			const stress_hash_stats_t *stats = hash_methods[i].stats;
+			const stress_hash_stats_t *st = &stats[i];
 
-			if ((stats->duration > 0.0) && (stats->total > 0)) {
-				const double rate = (double)((stats->duration > 0.0) ?
-					(double)stats->total / stats->duration : (double)0.0);
+			if ((st->duration > 0.0) && (st->total > 0)) {
+				const double rate = (double)((st->duration > 0.0) ?
+					(double)st->total / st->duration : (double)0.0);
 
 				pr_inf("%s: %12.12s %15.2f %10.2f\n",
-					args->name, hash_methods[i].name, rate, stats->chi_squared);
+					args->name, hash_methods[i].name, rate, st->chi_squared);
 			}
 		}
 		pr_block_end();
 	}
 
+	hash_stats = NULL;
 	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
 
 	return rc;
@@ -704,6 +927,7 @@ static const char *stress_hash_method(const size_t i)
 }
 
 static const stress_opt_t opts[] = {
+	{ OPT_hash_bulk,   "hash-bulk",   TYPE_ID_BOOL, 0, 1, NULL },
 	{ OPT_hash_method, "hash-method", TYPE_ID_SIZE_T_METHOD, 0, 0, stress_hash_method },
 	END_OPT,
 };
@@ -713,5 +937,7 @@ const stressor_info_t stress_hash_info = {
 	.class = CLASS_CPU | CLASS_INTEGER | CLASS_COMPUTE | CLASS_SEARCH,
 	.opts = opts,
 	.verify = VERIFY_OPTIONAL,
+	.metrics_max = NUM_HASH_BULK_METHODS * STRESS_HASH_BULK_SIZES,
+	.instance_threads = true,
 	.help = help
 };
@@ -0,0 +1,824 @@
+/*
+ * Copyright (C) 2025      Colin Ian King.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+#include "stress-ng.h"
+#include "core-builtin.h"
+#include "core-ebr.h"
+#include "core-latency.h"
+#include "core-pthread.h"
+
+#include <math.h>
+
+#define MIN_HASHMAP_SIZE	(1 * KB)
+#define MAX_HASHMAP_SIZE	(1 * MB)
+#define DEFAULT_HASHMAP_SIZE	(64 * KB)
+
+#define MIN_HASHMAP_THREADS	(1)
+#define MAX_HASHMAP_THREADS	(256)
+#define DEFAULT_HASHMAP_THREADS	(4)
+
+#define MIN_HASHMAP_RWMIX	(0)
+#define MAX_HASHMAP_RWMIX	(100)
+#define DEFAULT_HASHMAP_RWMIX	(90)
+
+#define MIN_HASHMAP_ZIPF	(0)
+#define MAX_HASHMAP_ZIPF	(99)
+#define DEFAULT_HASHMAP_ZIPF	(99)
+
+static const stress_help_t help[] = {
+	{ NULL,	"hashmap N",		"start N workers exercising a hash map shared by threads" },
+	{ NULL,	"hashmap-method M",	"select hash map design: all, global, striped, rcu, lockfree" },
+	{ NULL,	"hashmap-ops N",	"stop after N hash map bogo operations" },
+	{ NULL,	"hashmap-rwmix N",	"percentage of hash map ops that are lookups" },
+	{ NULL,	"hashmap-size N",	"number of keys in the hash map key range" },
+	{ NULL,	"hashmap-threads N",	"number of threads sharing the hash map" },
+	{ NULL,	"hashmap-zipf N",	"Zipfian key skew N / 100, 0 is uniform" },
+	{ NULL,	NULL,			NULL }
+};
+
+#if defined(HAVE_LIB_PTHREAD) &&		\
+    defined(STRESS_EBR)
+
+/*
+ *  N threads share one hash map of keys 1..size and perform a mix of
+ *  lookups, inserts and deletes on keys drawn from a Zipfian distribution.
+ *  The designs are:
+ *    global   chained buckets protected by one mutex
+ *    striped  chained buckets protected by HM_STRIPES mutexes
+ *    rcu      chained buckets, lock-less readers, striped writers publish
+ *	       with release stores and unlinked nodes are freed with epoch
+ *	       based reclamation once no reader can reference them
+ *    lockfree open addressing with linear probing, a slot holds the key
+ *	       and a present bit in one word and is updated with CAS, keys
+ *	       are never removed from slots so no reclamation is required
+ */
+#define HM_STRIPES		(64)		/* locks for striped and rcu */
+#define HM_KEYS			(64 * 1024)	/* precomputed key sequence */
+#define HM_PHASE_OPS		(128 * 1024)	/* ops in each timed phase */
+#define HM_EPOCH_OPS		(64)		/* ops between epoch advance attempts */
+#define HM_LATENCY_SAMPLE	(16)		/* time 1 in N ops */
+#define HM_PRESENT		((uint64_t)1)	/* lockfree slot present bit */
+
+typedef struct hm_node {
+	stress_ebr_node_t ebr;		/* retired list link, must be first */
+	uint64_t key;
+	struct hm_node *next;		/* next node in bucket */
+} hm_node_t;
+
+typedef struct {
+	pthread_mutex_t mutex;
+} ALIGN64 hm_lock_t;
+
+struct hm_map;
+
+typedef struct {
+	stress_pthread_work_t work;	/* thread work, must be first */
+	struct hm_map *map;		/* shared hash map */
+	uint64_t rnd;			/* per thread xorshift state */
+	stress_ebr_thread_t *ebr;	/* per thread epoch state */
+	hm_node_t *spare;		/* preallocated node for inserts */
+	size_t ops;			/* ops to perform */
+	size_t done;			/* ops performed */
+	int64_t net;			/* inserts - deletes */
+	bool nomem;			/* node allocation failed */
+	stress_latency_hist_t hist;	/* sampled op latencies */
+} ALIGN64 hm_thread_t;
+
+typedef int (*hm_func_t)(hm_thread_t *t, const uint64_t key);
+
+typedef struct {
+	const char *name;		/* design name */
+	const hm_func_t lookup;		/* 1 if found, 0 if not */
+	const hm_func_t insert;		/* 1 if inserted, 0 if present, -1 no memory */
+	const hm_func_t remove;		/* 1 if deleted, 0 if not present */
+	const size_t stripes;		/* number of locks */
+	const bool epoch;		/* ops need epoch enter/exit */
+	const bool chained;		/* chained buckets or open addressing */
+} hm_method_t;
+
+typedef struct hm_map {
+	const hm_method_t *method;	/* hash map design */
+	hm_node_t **buckets;		/* chained buckets */
+	uint64_t *slots;		/* open addressing slots */
+	size_t mask;			/* buckets or slots - 1 */
+	hm_lock_t *locks;		/* bucket locks */
+	size_t stripe_mask;		/* stripes - 1 */
+	stress_ebr_t ebr;		/* epoch reclamation */
+	hm_thread_t *threads;		/* per thread state */
+	size_t threads_n;		/* number of threads */
+	const uint32_t *keys;		/* Zipfian key sequence */
+	uint32_t rwmix;			/* percentage of lookups */
+	int64_t expected;		/* expected number of keys */
+} hm_map_t;
+
+static inline uint64_t hm_rand(hm_thread_t *t)
+{
+	register uint64_t x = t->rnd;
+
+	x ^= x << 13;
+	x ^= x >> 7;
+	x ^= x << 17;
+	t->rnd = x;
+	return x;
+}
+
+static inline size_t hm_hash(const uint64_t key)
+{
+	return (size_t)((key * 0x9e3779b97f4a7c15ULL) >> 24);
+}
+
+/*
+ *  hm_spare()
+ *	ensure a node is available for an insert, allocated
+ *	outside of any lock
+ */
+static inline bool hm_spare(hm_thread_t *t)
+{
+	if (LIKELY(t->spare != NULL))
+		return true;
+	t->spare = (hm_node_t *)malloc(sizeof(*t->spare));
+	return t->spare != NULL;
+}
+
+/*
+ *  Chained buckets with global or striped locks
+ */
+static int OPTIMIZE3 hm_locked_lookup(hm_thread_t *t, const uint64_t key)
+{
+	hm_map_t *map = t->map;
+	const size_t h = hm_hash(key);
+	pthread_mutex_t *mutex = &map->locks[h & map->stripe_mask].mutex;
+	const hm_node_t *node;
+	int found = 0;
+
+	(void)pthread_mutex_lock(mutex);
+	for (node = map->buckets[h & map->mask]; node; node = node->next) {
+		if (node->key == key) {
+			found = 1;
+			break;
+		}
+	}
+	(void)pthread_mutex_unlock(mutex);
+	return found;
+}
+
+static int OPTIMIZE3 hm_locked_insert(hm_thread_t *t, const uint64_t key)
+{
+	hm_map_t *map = t->map;
+	const size_t h = hm_hash(key);
+	pthread_mutex_t *mutex = &map->locks[h & map->stripe_mask].mutex;
+	hm_node_t **head = &map->buckets[h & map->mask];
+	hm_node_t *node;
+
+	if (UNLIKELY(!hm_spare(t)))
+		return -1;
+	(void)pthread_mutex_lock(mutex);
+	for (node = *head; node; node = node->next) {
+		if (node->key == key) {
+			(void)pthread_mutex_unlock(mutex);
+			return 0;
+		}
+	}
+	node = t->spare;
+	t->spare = NULL;
+	node->key = key;
+	node->next = *head;
+	*head = node;
+	(void)pthread_mutex_unlock(mutex);
+	return 1;
+}
+
+static int OPTIMIZE3 hm_locked_remove(hm_thread_t *t, const uint64_t key)
+{
+	hm_map_t *map = t->map;
+	const size_t h = hm_hash(key);
+	pthread_mutex_t *mutex = &map->locks[h & map->stripe_mask].mutex;
+	hm_node_t **prev, *node;
+
+	(void)pthread_mutex_lock(mutex);
+	for (prev = &map->buckets[h & map->mask]; (node = *prev) != NULL; prev = &node->next) {
+		if (node->key == key) {
+			*prev = node->next;
+			(void)pthread_mutex_unlock(mutex);
+			free(node);
+			return 1;
+		}
+	}
+	(void)pthread_mutex_unlock(mutex);
+	return 0;
+}
+
+/*
+ *  Chained buckets with lock-less RCU style readers, writers are
+ *  serialized per stripe and publish with release stores
+ */
+static int OPTIMIZE3 hm_rcu_lookup(hm_thread_t *t, const uint64_t key)
+{
+	hm_map_t *map = t->map;
+	const hm_node_t *node;
+
+	node = __atomic_load_n(&map->buckets[hm_hash(key) & map->mask], __ATOMIC_ACQUIRE);
+	while (node) {
+		if (node->key == key)
+			return 1;
+		node = __atomic_load_n(&node->next, __ATOMIC_ACQUIRE);
+	}
+	return 0;
+}
+
+static int OPTIMIZE3 hm_rcu_insert(hm_thread_t *t, const uint64_t key)
+{
+	hm_map_t *map = t->map;
+	const size_t h = hm_hash(key);
+	pthread_mutex_t *mutex = &map->locks[h & map->stripe_mask].mutex;
+	hm_node_t **head = &map->buckets[h & map->mask];
+	hm_node_t *node;
+
+	if (UNLIKELY(!hm_spare(t)))
+		return -1;
+	(void)pthread_mutex_lock(mutex);
+	for (node = *head; node; node = node->next) {
+		if (node->key == key) {
+			(void)pthread_mutex_unlock(mutex);
+			return 0;
+		}
+	}
+	node = t->spare;
+	t->spare = NULL;
+	node->key = key;
+	node->next = *head;
+	__atomic_store_n(head, node, __ATOMIC_RELEASE);
+	(void)pthread_mutex_unlock(mutex);
+	return 1;
+}
+
+static int OPTIMIZE3 hm_rcu_remove(hm_thread_t *t, const uint64_t key)
+{
+	hm_map_t *map = t->map;
+	const size_t h = hm_hash(key);
+	pthread_mutex_t *mutex = &map->locks[h & map->stripe_mask].mutex;
+	hm_node_t **prev, *node;
+
+	(void)pthread_mutex_lock(mutex);
+	for (prev = &map->buckets[h & map->mask]; (node = *prev) != NULL; prev = &node->next) {
+		if (node->key == key) {
+			/* readers on node still see a valid next pointer */
+			__atomic_store_n(prev, node->next, __ATOMIC_RELEASE);
+			(void)pthread_mutex_unlock(mutex);
+			stress_ebr_retire(&map->ebr, t->ebr, node);
+			return 1;
+		}
+	}
+	(void)pthread_mutex_unlock(mutex);
+	return 0;
+}
+
+/*
+ *  Lock-free open addressing, slot = key << 1 | present
+ */
+static int OPTIMIZE3 hm_lockfree_lookup(hm_thread_t *t, const uint64_t key)
+{
+	hm_map_t *map = t->map;
+	size_t i = hm_hash(key) & map->mask;
+
+	for (;;) {
+		const uint64_t slot = __atomic_load_n(&map->slots[i], __ATOMIC_ACQUIRE);
+
+		if (slot == 0)
+			return 0;
+		if ((slot >> 1) == key)
+			return (int)(slot & HM_PRESENT);
+		i = (i + 1) & map->mask;
+	}
+}
+
+static int OPTIMIZE3 hm_lockfree_insert(hm_thread_t *t, const uint64_t key)
+{
+	hm_map_t *map = t->map;
+	size_t i = hm_hash(key) & map->mask;
+	uint64_t slot = __atomic_load_n(&map->slots[i], __ATOMIC_ACQUIRE);
+
+	for (;;) {
+		if (slot == 0) {
+			if (__atomic_compare_exchange_n(&map->slots[i], &slot,
+					(key << 1) | HM_PRESENT, false,
+					__ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+				return 1;
+			/* slot now holds a key, re-examine it */
+			continue;
+		}
+		if ((slot >> 1) == key) {
+			if (slot & HM_PRESENT)
+				return 0;
+			if (__atomic_compare_exchange_n(&map->slots[i], &slot,
+					slot | HM_PRESENT, false,
+					__ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+				return 1;
+			continue;
+		}
+		i = (i + 1) & map->mask;
+		slot = __atomic_load_n(&map->slots[i], __ATOMIC_ACQUIRE);
+	}
+}
+
+static int OPTIMIZE3 hm_lockfree_remove(hm_thread_t *t, const uint64_t key)
+{
+	hm_map_t *map = t->map;
+	size_t i = hm_hash(key) & map->mask;
+	uint64_t slot = __atomic_load_n(&map->slots[i], __ATOMIC_ACQUIRE);
+
+	for (;;) {
+		if (slot == 0)
+			return 0;
+		if ((slot >> 1) == key) {
+			if (!(slot & HM_PRESENT))
+				return 0;
+			if (__atomic_compare_exchange_n(&map->slots[i], &slot,
+					slot & ~HM_PRESENT, false,
+					__ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+				return 1;
+			continue;
+		}
+		i = (i + 1) & map->mask;
+		slot = __atomic_load_n(&map->slots[i], __ATOMIC_ACQUIRE);
+	}
+}
+
+static const hm_method_t hm_methods[] = {
+	{ "all",	NULL, NULL, NULL, 0, false, false },
+	{ "global",	hm_locked_lookup, hm_locked_insert, hm_locked_remove, 1, false, true },
+	{ "striped",	hm_locked_lookup, hm_locked_insert, hm_locked_remove, HM_STRIPES, false, true },
+	{ "rcu",	hm_rcu_lookup, hm_rcu_insert, hm_rcu_remove, HM_STRIPES, true, true },
+	{ "lockfree",	hm_lockfree_lookup, hm_lockfree_insert, hm_lockfree_remove, 0, false, false },
+};
+
+static const char *stress_hashmap_method(const size_t i)
+{
+	return (i < SIZEOF_ARRAY(hm_methods)) ? hm_methods[i].name : NULL;
+}
+
+/*
+ *  hm_keys_init()
+ *	fill keys with HM_KEYS keys in the range 1..n, key k has a
+ *	probability proportional to 1 / k^theta using the Gray et al.
+ *	"Quickly generating billion-record synthetic databases" method
+ */
+static void hm_keys_init(uint32_t *keys, const uint32_t n, const double theta)
+{
+	double zetan = 0.0, zeta2, alpha, eta;
+	uint32_t i;
+
+	if (theta <= 0.0) {
+		for (i = 0; i < HM_KEYS; i++)
+			keys[i] = 1 + stress_mwc32modn(n);
+		return;
+	}
+	for (i = 1; i <= n; i++)
+		zetan += 1.0 / pow((double)i, theta);
+	zeta2 = 1.0 + 1.0 / pow(2.0, theta);
+	alpha = 1.0 / (1.0 - theta);
+	eta = (1.0 - pow(2.0 / (double)n, 1.0 - theta)) / (1.0 - (zeta2 / zetan));
+
+	for (i = 0; i < HM_KEYS; i++) {
+		const double u = (double)stress_mwc32() / 4294967296.0;
+		const double uz = u * zetan;
+		uint32_t rank;
+
+		if (uz < 1.0)
+			rank = 0;
+		else if (uz < zeta2)
+			rank = 1;
+		else
+			rank = (uint32_t)((double)n * pow((eta * u) - eta + 1.0, alpha));
+		keys[i] = 1 + ((rank < n) ? rank : n - 1);
+	}
+}
+
+/*
+ *  hm_thread()
+ *	perform a mix of lookups, inserts and deletes of Zipfian keys,
+ *	sampling the latency of 1 in HM_LATENCY_SAMPLE ops
+ */
+static void *hm_thread(void *arg)
+{
+	hm_thread_t *t = (hm_thread_t *)arg;
+	hm_map_t *map = t->map;
+	const hm_method_t *method = map->method;
+	size_t i, idx = (size_t)(hm_rand(t) % HM_KEYS);
+	const size_t stride = (size_t)(hm_rand(t) | 1);
+
+	for (i = 0; i < t->ops; i++) {
+		const uint64_t r = hm_rand(t);
+		const uint64_t key = map->keys[idx];
+		const uint32_t pct = (uint32_t)((r >> 8) % 100);
+		const bool sample = ((i % HM_LATENCY_SAMPLE) == 0);
+		uint64_t t_begin = 0;
+
+		idx = (idx + stride) & (HM_KEYS - 1);
+		if ((i & (HM_EPOCH_OPS - 1)) == 0) {
+			if (UNLIKELY(!stress_continue_flag()))
+				break;
+			if (method->epoch)
+				stress_ebr_try_advance(&map->ebr);
+		}
+		if (sample)
+			t_begin = stress_latency_now();
+		if (method->epoch)
+			stress_ebr_enter(&map->ebr, t->ebr);
+		if (pct < map->rwmix) {
+			(void)method->lookup(t, key);
+		} else if (r & 1) {
+			const int ret = method->insert(t, key);
+
+			if (UNLIKELY(ret < 0)) {
+				t->nomem = true;
+				if (method->epoch)
+					stress_ebr_exit(t->ebr);
+				break;
+			}
+			t->net += ret;
+		} else {
+			t->net -= method->remove(t, key);
+		}
+		if (method->epoch)
+			stress_ebr_exit(t->ebr);
+		if (sample)
+			stress_latency_hist_record(&t->hist, stress_latency_now() - t_begin);
+	}
+	t->done = i;
+	return &g_nowt;
+}
+
+/*
+ *  hm_run()
+ *	run ops random ops over threads_n threads
+ */
+static void hm_run(hm_map_t *map, const size_t threads_n, const size_t ops)
+{
+	size_t i;
+
+	for (i = 0; i < threads_n; i++) {
+		hm_thread_t *t = &map->threads[i];
+
+		t->ops = (ops / threads_n) + ((i < (ops % threads_n)) ? 1 : 0);
+		t->done = 0;
+	}
+	stress_pthread_work_run(map->threads, sizeof(*map->threads), threads_n, hm_thread);
+}
+
+/*
+ *  hm_check()
+ *	check each key is in the bucket or probe chain its hash maps to
+ *	and appears once, returns the number of keys or -1 on error
+ */
+static int64_t hm_check(const hm_map_t *map)
+{
+	int64_t count = 0;
+	size_t i;
+
+	if (map->method->chained) {
+		for (i = 0; i <= map->mask; i++) {
+			const hm_node_t *node, *dup;
+
+			for (node = map->buckets[i]; node; node = node->next) {
+				if ((hm_hash(node->key) & map->mask) != i)
+					return -1;
+				for (dup = node->next; dup; dup = dup->next) {
+					if (dup->key == node->key)
+						return -1;
+				}
+				count++;
+			}
+		}
+		return count;
+	}
+
+	for (i = 0; i <= map->mask; i++) {
+		const uint64_t slot = map->slots[i];
+		size_t j;
+
+		if (slot == 0)
+			continue;
+		/* no empty slot or duplicate key between the home slot and i */
+		for (j = hm_hash(slot >> 1) & map->mask; j != i; j = (j + 1) & map->mask) {
+			if ((map->slots[j] == 0) || ((map->slots[j] >> 1) == (slot >> 1)))
+				return -1;
+		}
+		count += (int64_t)(slot & HM_PRESENT);
+	}
+	return count;
+}
+
+static void hm_map_free(hm_map_t *map)
+{
+	size_t i;
+
+	if (map->threads) {
+		for (i = 0; i < map->threads_n; i++)
+			free(map->threads[i].spare);
+	}
+	stress_ebr_free(&map->ebr);
+	if (map->buckets) {
+		for (i = 0; i <= map->mask; i++) {
+			hm_node_t *node = map->buckets[i];
+
+			while (node) {
+				hm_node_t *next = node->next;
+
+				free(node);
+				node = next;
+			}
+		}
+	}
+	if (map->locks) {
+		for (i = 0; i <= map->stripe_mask; i++)
+			(void)pthread_mutex_destroy(&map->locks[i].mutex);
+	}
+	free(map->locks);
+	free(map->slots);
+	free(map->buckets);
+	free(map->threads);
+	(void)shim_memset(map, 0, sizeof(*map));
+}
+
+/*
+ *  hm_map_init()
+ *	create a hash map for method, half fill the key range
+ */
+static int hm_map_init(
+	hm_map_t *map,
+	const hm_method_t *method,
+	const uint32_t size,
+	const uint32_t threads_n,
+	const uint32_t rwmix,
+	const uint32_t *keys)
+{
+	size_t i, n = 1;
+	hm_thread_t *t;
+
+	(void)shim_memset(map, 0, sizeof(*map));
+	map->method = method;
+	map->threads_n = (size_t)threads_n;
+	map->rwmix = rwmix;
+	map->keys = keys;
+
+	/* at most size keys, load factor <= 0.5 */
+	while (n < (size_t)size * 2)
+		n <<= 1;
+	map->mask = n - 1;
+	if (method->chained)
+		map->buckets = (hm_node_t **)calloc(n, sizeof(*map->buckets));
+	else
+		map->slots = (uint64_t *)calloc(n, sizeof(*map->slots));
+	map->threads = (hm_thread_t *)calloc(map->threads_n, sizeof(*map->threads));
+	if (!map->threads || (!map->buckets && !map->slots))
+		goto err;
+	if (stress_ebr_init(&map->ebr, map->threads_n) < 0)
+		goto err;
+	if (method->stripes) {
+		map->locks = (hm_lock_t *)calloc(method->stripes, sizeof(*map->locks));
+		if (!map->locks)
+			goto err;
+		map->stripe_mask = method->stripes - 1;
+		for (i = 0; i < method->stripes; i++)
+			(void)pthread_mutex_init(&map->locks[i].mutex, NULL);
+	}
+	for (i = 0; i < map->threads_n; i++) {
+		map->threads[i].map = map;
+		map->threads[i].ebr = &map->ebr.threads[i];
+		map->threads[i].rnd = stress_mwc64() | 1;
+		stress_latency_hist_init(&map->threads[i].hist);
+	}
+
+	t = &map->threads[0];
+	for (i = 1; i <= size; i++) {
+		int ret;
+
+		if (hm_rand(t) & 1)
+			continue;
+		ret = method->insert(t, (uint64_t)i);
+		if (ret < 0)
+			goto err;
+		map->expected += ret;
+	}
+	return 0;
+err:
+	hm_map_free(map);
+	return -1;
+}
+
+/*
+ *  stress_hashmap()
+ *	stress concurrent hash maps
+ */
+static int stress_hashmap(stress_args_t *args)
+{
+	uint32_t hashmap_size = DEFAULT_HASHMAP_SIZE;
+	uint32_t hashmap_threads = DEFAULT_HASHMAP_THREADS;
+	uint32_t hashmap_rwmix = DEFAULT_HASHMAP_RWMIX;
+	uint32_t hashmap_zipf = DEFAULT_HASHMAP_ZIPF;
+	size_t hashmap_method = 0;	/* All methods */
+	size_t m, begin, end, phases;
+	uint32_t *keys;
+	hm_map_t maps[SIZEOF_ARRAY(hm_methods)];
+	double duration[SIZEOF_ARRAY(hm_methods)][2];
+	double ops[SIZEOF_ARRAY(hm_methods)][2];
+	stress_latency_hist_t *hists;
+	int rc = EXIT_SUCCESS;
+
+	(void)stress_get_setting("hashmap-method", &hashmap_method);
+	(void)stress_get_setting("hashmap-rwmix", &hashmap_rwmix);
+	(void)stress_get_setting("hashmap-threads", &hashmap_threads);
+	(void)stress_get_setting("hashmap-zipf", &hashmap_zipf);
+	if (!stress_get_setting("hashmap-size", &hashmap_size)) {
+		if (g_opt_flags & OPT_FLAGS_MAXIMIZE)
+			hashmap_size = MAX_HASHMAP_SIZE;
+		if (g_opt_flags & OPT_FLAGS_MINIMIZE)
+			hashmap_size = MIN_HASHMAP_SIZE;
+	}
+
+	if (hashmap_method == 0) {
+		begin = 1;
+		end = SIZEOF_ARRAY(hm_methods);
+	} else {
+		begin = hashmap_method;
+		end = hashmap_method + 1;
+	}
+	/* N thread phase and a 1 thread baseline phase */
+	phases = (hashmap_threads > 1) ? 2 : 1;
+
+	(void)shim_memset(maps, 0, sizeof(maps));
+	(void)shim_memset(duration, 0, sizeof(duration));
+	(void)shim_memset(ops, 0, sizeof(ops));
+	hists = (stress_latency_hist_t *)calloc(SIZEOF_ARRAY(hm_methods) * 2, sizeof(*hists));
+	keys = (uint32_t *)calloc(HM_KEYS, sizeof(*keys));
+	if (!hists || !keys) {
+		pr_inf_skip("%s: cannot allocate hash map keys and histograms, "
+			"skipping stressor\n", args->name);
+		rc = EXIT_NO_RESOURCE;
+		goto free_keys;
+	}
+	for (m = 0; m < SIZEOF_ARRAY(hm_methods) * 2; m++)
+		stress_latency_hist_init(&hists[m]);
+	hm_keys_init(keys, hashmap_size, (double)hashmap_zipf / 100.0);
+
+	for (m = begin; m < end; m++) {
+		if (hm_map_init(&maps[m], &hm_methods[m], hashmap_size,
+				hashmap_threads, hashmap_rwmix, keys) < 0) {
+			pr_inf_skip("%s: cannot allocate %s hash map with %" PRIu32
+				" keys, skipping stressor\n", args->name,
+				hm_methods[m].name, hashmap_size);
+			rc = EXIT_NO_RESOURCE;
+			goto free_maps;
+		}
+	}
+
+	if (args->instance == 0)
+		pr_inf("%s: %" PRIu32 " threads, %" PRIu32 " keys, %" PRIu32
+			"%% lookups, Zipfian skew %.2f\n", args->name,
+			hashmap_threads, hashmap_size, hashmap_rwmix,
+			(double)hashmap_zipf / 100.0);
+
+	stress_set_proc_state(args->name, STRESS_STATE_SYNC_WAIT);
+	stress_sync_start_wait(args);
+	stress_set_proc_state(args->name, STRESS_STATE_RUN);
+
+	do {
+		for (m = begin; (m < end) && (rc == EXIT_SUCCESS); m++) {
+			hm_map_t *map = &maps[m];
+			size_t j;
+
+			for (j = 0; j < phases; j++) {
+				const size_t nthreads = (j == 0) ? map->threads_n : 1;
+				int64_t count;
+				double t;
+				size_t i;
+
+				t = stress_time_now();
+				hm_run(map, nthreads, HM_PHASE_OPS);
+				duration[m][j] += stress_time_now() - t;
+				for (i = 0; i < nthreads; i++) {
+					hm_thread_t *ht = &map->threads[i];
+
+					if (ht->nomem) {
+						pr_inf("%s: out of memory inserting into the %s hash map\n",
+							args->name, hm_methods[m].name);
+						rc = EXIT_NO_RESOURCE;
+					}
+					map->expected += ht->net;
+					ht->net = 0;
+					ops[m][j] += (double)ht->done;
+					stress_latency_hist_merge(&hists[(m * 2) + j], &ht->hist);
+					stress_latency_hist_init(&ht->hist);
+				}
+
+				count = hm_check(map);
+				if (count < 0) {
+					pr_fail("%s: %s hash map is corrupt, found a misplaced "
+						"or duplicate key\n", args->name, hm_methods[m].name);
+					rc = EXIT_FAILURE;
+				} else if (count != map->expected) {
+					pr_fail("%s: %s hash map has %" PRId64 " keys, "
+						"expected %" PRId64 "\n", args->name,
+						hm_methods[m].name, count, map->expected);
+					rc = EXIT_FAILURE;
+				}
+				if ((rc != EXIT_SUCCESS) || !stress_continue_flag())
+					break;
+			}
+		}
+		if (rc != EXIT_SUCCESS)
+			break;
+		stress_bogo_inc(args);
+	} while (stress_continue(args));
+
+	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
+
+	for (m = begin; m < end; m++) {
+		const size_t idx = (m - begin) * phases * 2;
+		size_t j;
+
+		for (j = 0; j < phases; j++) {
+			const size_t nthreads = (j == 0) ? (size_t)hashmap_threads : 1;
+			const stress_latency_hist_t *hist = &hists[(m * 2) + j];
+			char msg[64];
+
+			(void)snprintf(msg, sizeof(msg), "%s ops per sec, %zu thread%s",
+				hm_methods[m].name, nthreads, (nthreads == 1) ? "" : "s");
+			stress_metrics_set(args, idx + j, msg,
+				(duration[m][j] > 0.0) ? ops[m][j] / duration[m][j] : 0.0,
+				STRESS_METRIC_HARMONIC_MEAN);
+			(void)snprintf(msg, sizeof(msg), "%s p99 nanosecs per op, %zu thread%s",
+				hm_methods[m].name, nthreads, (nthreads == 1) ? "" : "s");
+			stress_metrics_set(args, idx + phases + j, msg,
+				(hist->count > 0) ? (double)stress_latency_hist_percentile(hist, 99.0) : 0.0,
+				STRESS_METRIC_GEOMETRIC_MEAN);
+		}
+	}
+
+free_maps:
+	for (m = begin; m < end; m++)
+		hm_map_free(&maps[m]);
+free_keys:
+	free(keys);
+	free(hists);
+
+	return rc;
+}
+
+static const stress_opt_t opts[] = {
+	{ OPT_hashmap_method,  "hashmap-method",  TYPE_ID_SIZE_T_METHOD, 0, 1, stress_hashmap_method },
+	{ OPT_hashmap_rwmix,   "hashmap-rwmix",   TYPE_ID_UINT32, MIN_HASHMAP_RWMIX, MAX_HASHMAP_RWMIX, NULL },
+	{ OPT_hashmap_size,    "hashmap-size",    TYPE_ID_UINT32, MIN_HASHMAP_SIZE, MAX_HASHMAP_SIZE, NULL },
+	{ OPT_hashmap_threads, "hashmap-threads", TYPE_ID_UINT32, MIN_HASHMAP_THREADS, MAX_HASHMAP_THREADS, NULL },
+	{ OPT_hashmap_zipf,    "hashmap-zipf",    TYPE_ID_UINT32, MIN_HASHMAP_ZIPF, MAX_HASHMAP_ZIPF, NULL },
+	END_OPT,
+};
+
+const stressor_info_t stress_hashmap_info = {
+	.stressor = stress_hashmap,
+	.class = CLASS_CPU_CACHE | CLASS_CPU | CLASS_MEMORY | CLASS_SEARCH,
+	.opts = opts,
+	.verify = VERIFY_ALWAYS,
+	.help = help
+};
+#else
+
+static const char *stress_hashmap_method(const size_t i)
+{
+	return (i == 0) ? "all" : NULL;
+}
+
+static const stress_opt_t opts[] = {
+	{ OPT_hashmap_method,  "hashmap-method",  TYPE_ID_SIZE_T_METHOD, 0, 1, stress_hashmap_method },
+	{ OPT_hashmap_rwmix,   "hashmap-rwmix",   TYPE_ID_UINT32, MIN_HASHMAP_RWMIX, MAX_HASHMAP_RWMIX, NULL },
+	{ OPT_hashmap_size,    "hashmap-size",    TYPE_ID_UINT32, MIN_HASHMAP_SIZE, MAX_HASHMAP_SIZE, NULL },
+	{ OPT_hashmap_threads, "hashmap-threads", TYPE_ID_UINT32, MIN_HASHMAP_THREADS, MAX_HASHMAP_THREADS, NULL },
+	{ OPT_hashmap_zipf,    "hashmap-zipf",    TYPE_ID_UINT32, MIN_HASHMAP_ZIPF, MAX_HASHMAP_ZIPF, NULL },
+	END_OPT,
+};
+
+const stressor_info_t stress_hashmap_info = {
+	.stressor = stress_unimplemented,
+	.class = CLASS_CPU_CACHE | CLASS_CPU | CLASS_MEMORY | CLASS_SEARCH,
+	.opts = opts,
+	.verify = VERIFY_ALWAYS,
+	.help = help,
+	.unimplemented_reason = "built without pthread or atomic builtin support"
+};
+#endif
@@ -20,8 +20,15 @@
 #include "stress-ng.h"
 #include "core-attribute.h"
 #include "core-builtin.h"
+#include "core-io-uring.h"
+#include "core-latency.h"
 #include "core-pragma.h"
 #include "core-target-clones.h"
+#include "io-uring.h"
+
+#if defined(HAVE_LIBAIO_H)
+#include <libaio.h>
+#endif
 
 #if defined(HAVE_SYS_UIO_H)
 #include <sys/uio.h>
@@ -39,6 +46,22 @@
 #define MAX_HDD_WRITE_SIZE	(4 * MB)
 #define DEFAULT_HDD_WRITE_SIZE	(64 * 1024)
 
+#define MIN_HDD_IODEPTH		(0)
+#define MAX_HDD_IODEPTH		(1024)
+#define DEFAULT_HDD_IODEPTH	(0)		/* 0 = synchronous I/O */
+
+#define MIN_HDD_RWMIX		(0)
+#define MAX_HDD_RWMIX		(100)
+#define DEFAULT_HDD_RWMIX	(50)
+
+#define HDD_ENGINE_AUTO		(0)
+#define HDD_ENGINE_IO_URING	(1)
+#define HDD_ENGINE_LIBAIO	(2)
+
+#define HDD_BS_SWEEP_MIN	(4 * KB)
+#define HDD_BS_SWEEP_MAX	(1 * MB)
+#define HDD_BS_SWEEP_SLICE	(1.0)		/* seconds per block size */
+
 #define BUF_ALIGNMENT		(4096)
 #define HDD_IO_VEC_MAX		(16)		/* Must be power of 2 */
 
@@ -82,9 +105,13 @@ typedef struct {
 
 static const stress_help_t help[] = {
 	{ "d N","hdd N",		"start N workers spinning on write()/unlink()" },
+	{ NULL,	"hdd-bs-sweep",		"sweep block sizes from 4K to 1M with --hdd-iodepth" },
 	{ NULL,	"hdd-bytes N",		"write N bytes per hdd worker (default is 1GB)" },
+	{ NULL,	"hdd-engine E",		"select asynchronous I/O engine: auto, io-uring or libaio" },
+	{ NULL,	"hdd-iodepth N",	"keep N asynchronous I/O requests in flight" },
 	{ NULL,	"hdd-ops N",		"stop after N hdd bogo operations" },
 	{ NULL,	"hdd-opts list",	"specify list of various stressor options" },
+	{ NULL,	"hdd-rwmix N",		"percentage of reads with --hdd-iodepth (default 50)" },
 	{ NULL,	"hdd-write-size N",	"set the default write size to N bytes" },
 	{ NULL, NULL,			NULL }
 };
@@ -159,6 +186,17 @@ static const stress_hdd_opts_t hdd_opts[] = {
 	{ "utimes",	HDD_OPT_UTIMES, 0, 0, 0 },
 };
 
+static const char * const hdd_engines[] = {
+	"auto",
+	"io-uring",
+	"libaio",
+};
+
+static const char *stress_hdd_engine(const size_t i)
+{
+	return (i < SIZEOF_ARRAY(hdd_engines)) ? hdd_engines[i] : NULL;
+}
+
 #if defined(HAVE_FUTIMES)
 static void stress_hdd_utimes(const int fd)
 {
@@ -641,6 +679,619 @@ static void OPTIMIZE3 TARGET_CLONES hdd_fill_buf(
 	}
 }
 
+#if defined(STRESS_IO_URING) &&		\
+    defined(HAVE_IORING_OP_READ) &&	\
+    defined(HAVE_IORING_OP_WRITE)
+#define STRESS_HDD_IO_URING
+#endif
+
+#if defined(HAVE_LIB_AIO) &&		\
+    defined(HAVE_LIBAIO_H) &&		\
+    defined(HAVE_SYSCALL) &&		\
+    defined(__NR_io_setup) &&		\
+    defined(__NR_io_destroy) &&		\
+    defined(__NR_io_submit) &&		\
+    defined(__NR_io_getevents)
+#define STRESS_HDD_LIBAIO
+#endif
+
+#if (defined(STRESS_HDD_IO_URING) ||	\
+     defined(STRESS_HDD_LIBAIO)) &&	\
+    defined(HAVE_POSIX_MEMALIGN)
+#define STRESS_HDD_ASYNC
+
+/*
+ *  asynchronous I/O engine state, requests are identified
+ *  by a slot index 0..depth-1 that maps to a per-request buffer
+ */
+typedef struct {
+	size_t engine;			/* HDD_ENGINE_IO_URING or HDD_ENGINE_LIBAIO */
+	uint32_t depth;			/* maximum requests in flight */
+	uint32_t queued;		/* requests queued but not yet submitted */
+#if defined(STRESS_HDD_IO_URING)
+	stress_io_uring_t ring;		/* io_uring rings */
+#endif
+#if defined(STRESS_HDD_LIBAIO)
+	io_context_t ctx;		/* libaio context */
+	struct iocb *cbs;		/* one iocb per slot */
+	struct iocb **cbps;		/* iocbs queued for io_submit */
+	struct io_event *events;	/* completion events */
+#endif
+} stress_hdd_aio_t;
+
+/*
+ *  per block size statistics
+ */
+typedef struct {
+	size_t block_size;		/* block size in bytes */
+	uint64_t ops;			/* completed requests */
+	uint64_t rd_bytes;		/* bytes read */
+	uint64_t wr_bytes;		/* bytes written */
+	double duration;		/* time spent at this block size */
+	stress_latency_hist_t hist;	/* submit to completion latencies */
+} stress_hdd_bs_stats_t;
+
+#if defined(STRESS_HDD_LIBAIO)
+/*
+ *  shim_io_setup
+ * 	wrapper for io_setup system call
+ */
+static inline int shim_io_setup(unsigned nr_events, io_context_t *ctx_id)
+{
+	return (int)syscall(__NR_io_setup, nr_events, ctx_id);
+}
+
+/*
+ *  shim_io_destroy
+ * 	wrapper for io_destroy system call
+ */
+static inline int shim_io_destroy(io_context_t ctx_id)
+{
+	return (int)syscall(__NR_io_destroy, ctx_id);
+}
+
+/*
+ *  shim_io_submit
+ * 	wrapper for io_submit system call
+ */
+static inline int shim_io_submit(io_context_t ctx_id, long int nr, struct iocb **iocbpp)
+{
+	return (int)syscall(__NR_io_submit, ctx_id, nr, iocbpp);
+}
+
+/*
+ *  shim_io_getevents
+ * 	wrapper for io_getevents system call
+ */
+static inline int shim_io_getevents(
+	io_context_t ctx_id,
+	long int min_nr,
+	long int nr,
+	struct io_event *events,
+	struct timespec *timeout)
+{
+	return (int)syscall(__NR_io_getevents, ctx_id, min_nr, nr, events, timeout);
+}
+
+/*
+ *  stress_hdd_libaio_deinit()
+ *	destroy the libaio context and free the iocbs
+ */
+static void stress_hdd_libaio_deinit(stress_hdd_aio_t *aio)
+{
+	if (aio->ctx)
+		(void)shim_io_destroy(aio->ctx);
+	free(aio->events);
+	free(aio->cbps);
+	free(aio->cbs);
+	aio->ctx = 0;
+	aio->events = NULL;
+	aio->cbps = NULL;
+	aio->cbs = NULL;
+}
+
+/*
+ *  stress_hdd_libaio_init()
+ *	create a libaio context for depth requests,
+ *	returns 0 on success, -1 on failure
+ */
+static int stress_hdd_libaio_init(stress_hdd_aio_t *aio)
+{
+	(void)shim_memset(&aio->ctx, 0, sizeof(aio->ctx));
+	if (shim_io_setup(aio->depth, &aio->ctx) < 0) {
+		aio->ctx = 0;
+		return -1;
+	}
+	aio->cbs = (struct iocb *)calloc(aio->depth, sizeof(*aio->cbs));
+	aio->cbps = (struct iocb **)calloc(aio->depth, sizeof(*aio->cbps));
+	aio->events = (struct io_event *)calloc(aio->depth, sizeof(*aio->events));
+	if (!aio->cbs || !aio->cbps || !aio->events) {
+		stress_hdd_libaio_deinit(aio);
+		return -1;
+	}
+	return 0;
+}
+#endif
+
+/*
+ *  stress_hdd_aio_init()
+ *	initialize the requested engine, the auto engine tries
+ *	io_uring first and falls back to libaio, returns 0 on
+ *	success, -1 if no engine can be used
+ */
+static int stress_hdd_aio_init(
+	stress_args_t *args,
+	stress_hdd_aio_t *aio,
+	const size_t engine,
+	const uint32_t depth)
+{
+	(void)shim_memset(aio, 0, sizeof(*aio));
+	aio->depth = depth;
+#if defined(STRESS_HDD_IO_URING)
+	aio->ring.fd = -1;
+	if (engine != HDD_ENGINE_LIBAIO) {
+		if (stress_io_uring_init(&aio->ring, aio->depth) == 0) {
+			aio->engine = HDD_ENGINE_IO_URING;
+			return 0;
+		}
+		if (engine == HDD_ENGINE_IO_URING) {
+			pr_inf("%s: cannot create io-uring, errno=%d (%s)\n",
+				args->name, errno, strerror(errno));
+			return -1;
+		}
+		pr_dbg("%s: cannot create io-uring, errno=%d (%s), trying libaio\n",
+			args->name, errno, strerror(errno));
+	}
+#else
+	if (engine == HDD_ENGINE_IO_URING) {
+		pr_inf("%s: io-uring engine not supported\n", args->name);
+		return -1;
+	}
+#endif
+#if defined(STRESS_HDD_LIBAIO)
+	if (stress_hdd_libaio_init(aio) == 0) {
+		aio->engine = HDD_ENGINE_LIBAIO;
+		return 0;
+	}
+	pr_inf("%s: cannot create libaio context, errno=%d (%s)\n",
+		args->name, errno, strerror(errno));
+#else
+	pr_inf("%s: libaio engine not supported\n", args->name);
+#endif
+	return -1;
+}
+
+/*
+ *  stress_hdd_aio_deinit()
+ *	tear down the engine
+ */
+static void stress_hdd_aio_deinit(stress_hdd_aio_t *aio)
+{
+#if defined(STRESS_HDD_IO_URING)
+	if (aio->engine == HDD_ENGINE_IO_URING)
+		stress_io_uring_deinit(&aio->ring);
+#endif
+#if defined(STRESS_HDD_LIBAIO)
+	if (aio->engine == HDD_ENGINE_LIBAIO)
+		stress_hdd_libaio_deinit(aio);
+#endif
+	(void)aio;
+}
+
+/*
+ *  stress_hdd_aio_queue()
+ *	queue a read or write request for slot, it is not
+ *	submitted until the next stress_hdd_aio_wait() call
+ */
+static void stress_hdd_aio_queue(
+	stress_hdd_aio_t *aio,
+	const uint32_t slot,
+	const int fd,
+	const bool rd,
+	uint8_t *buf,
+	const size_t len,
+	const off_t offset)
+{
+#if defined(STRESS_HDD_IO_URING)
+	if (aio->engine == HDD_ENGINE_IO_URING) {
+		const unsigned int tail = *aio->ring.sq_tail;
+		const unsigned int idx = tail & *aio->ring.sq_mask;
+		struct io_uring_sqe *sqe = &aio->ring.sqes[idx];
+
+		(void)shim_memset(sqe, 0, sizeof(*sqe));
+		sqe->opcode = rd ? IORING_OP_READ : IORING_OP_WRITE;
+		sqe->fd = fd;
+		sqe->addr = (uintptr_t)buf;
+		sqe->len = (uint32_t)len;
+		sqe->off = (uint64_t)offset;
+		sqe->user_data = (uint64_t)slot;
+		aio->ring.sq_array[idx] = idx;
+		stress_asm_mb();
+		*aio->ring.sq_tail = tail + 1;
+		stress_asm_mb();
+		aio->queued++;
+		return;
+	}
+#endif
+#if defined(STRESS_HDD_LIBAIO)
+	{
+		struct iocb *cb = &aio->cbs[slot];
+
+		if (rd)
+			io_prep_pread(cb, fd, buf, len, (long long int)offset);
+		else
+			io_prep_pwrite(cb, fd, buf, len, (long long int)offset);
+		aio->cbps[aio->queued++] = cb;
+	}
+#else
+	(void)slot;
+	(void)fd;
+	(void)rd;
+	(void)buf;
+	(void)len;
+	(void)offset;
+#endif
+}
+
+/*
+ *  stress_hdd_aio_wait()
+ *	submit queued requests and wait for at least min_complete
+ *	completions, the completed slots and results are returned in
+ *	slots and res (both depth in size). Returns the number of
+ *	completions or -1 on error
+ */
+static int stress_hdd_aio_wait(
+	stress_hdd_aio_t *aio,
+	const uint32_t min_complete,
+	uint32_t *slots,
+	int64_t *res)
+{
+	int n = 0;
+
+#if defined(STRESS_HDD_IO_URING)
+	if (aio->engine == HDD_ENGINE_IO_URING) {
+		unsigned int head;
+
+		if ((aio->queued > 0) || (min_complete > 0)) {
+			const int ret = shim_io_uring_enter(aio->ring.fd, aio->queued,
+				min_complete, IORING_ENTER_GETEVENTS, NULL, 0);
+
+			if (ret < 0)
+				return -1;
+			/* unconsumed entries stay on the ring for the next enter */
+			aio->queued -= ((uint32_t)ret > aio->queued) ? aio->queued : (uint32_t)ret;
+		}
+		head = *aio->ring.cq_head;
+		for (;;) {
+			const struct io_uring_cqe *cqe;
+
+			stress_asm_mb();
+			if ((head == *aio->ring.cq_tail) || ((uint32_t)n >= aio->depth))
+				break;
+			cqe = &aio->ring.cqes[head & *aio->ring.cq_mask];
+			slots[n] = (uint32_t)cqe->user_data;
+			res[n] = (int64_t)cqe->res;
+			n++;
+			head++;
+		}
+		*aio->ring.cq_head = head;
+		stress_asm_mb();
+		return n;
+	}
+#endif
+#if defined(STRESS_HDD_LIBAIO)
+	{
+		int i;
+
+		while (aio->queued > 0) {
+			const int ret = shim_io_submit(aio->ctx, (long int)aio->queued, aio->cbps);
+
+			if (ret < 0)
+				return -1;
+			if (ret == 0)
+				break;
+			aio->queued -= (uint32_t)ret;
+			if (aio->queued > 0)
+				(void)shim_memmove(aio->cbps, aio->cbps + ret,
+					aio->queued * sizeof(*aio->cbps));
+		}
+		n = shim_io_getevents(aio->ctx, (long int)min_complete,
+			(long int)aio->depth, aio->events, NULL);
+		if (n < 0)
+			return -1;
+		for (i = 0; i < n; i++) {
+			const struct iocb *cb = (const struct iocb *)aio->events[i].obj;
+
+			slots[i] = (uint32_t)(cb - aio->cbs);
+			res[i] = (int64_t)(long int)aio->events[i].res;
+		}
+	}
+#else
+	(void)min_complete;
+	(void)slots;
+	(void)res;
+#endif
+	return n;
+}
+
+/*
+ *  stress_hdd_bs_str()
+ *	human readable block size for metrics descriptions
+ */
+static void stress_hdd_bs_str(char *str, const size_t len, const size_t block_size)
+{
+	if ((block_size >= KB) && ((block_size & (KB - 1)) == 0))
+		(void)snprintf(str, len, "%zuK", block_size / (size_t)KB);
+	else
+		(void)snprintf(str, len, "%zu byte", block_size);
+}
+
+/*
+ *  stress_hdd_async()
+ *	keep iodepth read/write requests in flight on the hdd file
+ *	using io_uring or libaio, rwmix percent of requests are reads.
+ *	With bs_sweep the block size is stepped from 4K to 1M, spending
+ *	HDD_BS_SWEEP_SLICE seconds on each size; IOPS, MB/s and latency
+ *	percentiles are reported per block size
+ */
+static int stress_hdd_async(
+	stress_args_t *args,
+	const char *filename,
+	const int flags,
+	const int hdd_flags,
+	const uint64_t hdd_bytes,
+	const uint64_t hdd_write_size,
+	const uint32_t iodepth,
+	const size_t engine,
+	const uint32_t rwmix,
+	const bool bs_sweep,
+	double *rd_bytes,
+	double *rd_duration,
+	double *wr_bytes,
+	double *wr_duration)
+{
+	const bool rnd = !!(hdd_flags & (HDD_OPT_WR_RND | HDD_OPT_RD_RND));
+	stress_hdd_aio_t aio;
+	stress_hdd_bs_stats_t *stats = NULL;
+	size_t n_stats = 0, step = 0, max_bs = 0, i;
+	uint8_t *bufs = NULL;
+	uint64_t *t_submit = NULL, block = 0, blocks;
+	uint64_t total_rd = 0, total_wr = 0;
+	uint32_t *free_slots = NULL, *slots = NULL, n_free;
+	bool *slot_rd = NULL;
+	int64_t *res = NULL;
+	int fd, rc = EXIT_NO_RESOURCE;
+	bool draining = false;
+	double t_start, t_step, t_end, total_duration = 0.0;
+
+	/* block sizes to exercise */
+	if (bs_sweep) {
+		size_t bs;
+
+		for (bs = HDD_BS_SWEEP_MIN; (bs <= HDD_BS_SWEEP_MAX) && (bs <= hdd_bytes); bs <<= 1)
+			n_stats++;
+		if (n_stats == 0)
+			n_stats = 1;
+	} else {
+		n_stats = 1;
+	}
+	stats = (stress_hdd_bs_stats_t *)calloc(n_stats, sizeof(*stats));
+	if (!stats) {
+		pr_inf_skip("%s: cannot allocate block size statistics, skipping stressor\n",
+			args->name);
+		return EXIT_NO_RESOURCE;
+	}
+	for (i = 0; i < n_stats; i++) {
+		size_t bs = bs_sweep ? (size_t)HDD_BS_SWEEP_MIN << i : (size_t)hdd_write_size;
+
+		/* O_DIRECT needs block aligned I/O sizes */
+		if (hdd_flags & HDD_OPT_O_DIRECT)
+			bs = (bs + BUF_ALIGNMENT - 1) & ~(size_t)(BUF_ALIGNMENT - 1);
+		stats[i].block_size = bs;
+		stress_latency_hist_init(&stats[i].hist);
+		if (bs > max_bs)
+			max_bs = bs;
+	}
+
+	if (stress_hdd_aio_init(args, &aio, engine, iodepth) < 0) {
+		pr_inf_skip("%s: no asynchronous I/O engine available, skipping stressor\n",
+			args->name);
+		free(stats);
+		return EXIT_NOT_IMPLEMENTED;
+	}
+	if (args->instance == 0)
+		pr_dbg("%s: using %s engine, %" PRIu32 " requests in flight, %" PRIu32 "%% reads\n",
+			args->name, hdd_engines[aio.engine], iodepth, rwmix);
+
+	if (posix_memalign((void **)&bufs, BUF_ALIGNMENT, (size_t)iodepth * max_bs) || !bufs) {
+		bufs = NULL;
+		pr_inf_skip("%s: cannot allocate %" PRIu32 " x %zu byte buffers, skipping stressor\n",
+			args->name, iodepth, max_bs);
+		goto tidy_aio;
+	}
+	stress_rndbuf(bufs, (size_t)iodepth * max_bs);
+
+	t_submit = (uint64_t *)calloc(iodepth, sizeof(*t_submit));
+	free_slots = (uint32_t *)calloc(iodepth, sizeof(*free_slots));
+	slots = (uint32_t *)calloc(iodepth, sizeof(*slots));
+	res = (int64_t *)calloc(iodepth, sizeof(*res));
+	slot_rd = (bool *)calloc(iodepth, sizeof(*slot_rd));
+	if (!t_submit || !free_slots || !slots || !res || !slot_rd) {
+		pr_inf_skip("%s: cannot allocate %" PRIu32 " request slots, skipping stressor\n",
+			args->name, iodepth);
+		goto tidy_bufs;
+	}
+
+	if ((fd = open(filename, flags, S_IRUSR | S_IWUSR)) < 0) {
+		rc = stress_exit_status(errno);
+		pr_fail("%s: open %s failed, errno=%d (%s)\n",
+			args->name, filename, errno, strerror(errno));
+		(void)shim_unlink(filename);
+		goto tidy_bufs;
+	}
+	(void)shim_unlink(filename);
+	(void)stress_hdd_advise(args, fd, hdd_flags);
+
+	/* lay the file out so reads are not satisfied from holes */
+	rc = EXIT_SUCCESS;
+	for (block = 0; block < hdd_bytes; block += max_bs) {
+		size_t len = (size_t)STRESS_MINIMUM(hdd_bytes - block, (uint64_t)max_bs);
+
+		if (hdd_flags & HDD_OPT_O_DIRECT)
+			len = (len + BUF_ALIGNMENT - 1) & ~(size_t)(BUF_ALIGNMENT - 1);
+		if (pwrite(fd, bufs, len, (off_t)block) < 0) {
+			if ((errno == ENOSPC) || (errno == EDQUOT)) {
+				pr_inf_skip("%s: out of space laying out %s, skipping stressor\n",
+					args->name, filename);
+				rc = EXIT_NO_RESOURCE;
+			} else {
+				rc = stress_exit_status(errno);
+				pr_fail("%s: pwrite on %s failed, errno=%d (%s)\n",
+					args->name, filename, errno, strerror(errno));
+			}
+			goto tidy_fd;
+		}
+		if (UNLIKELY(!stress_continue_flag()))
+			goto tidy_fd;
+	}
+
+	for (n_free = 0; n_free < iodepth; n_free++)
+		free_slots[n_free] = n_free;
+
+	block = 0;
+	blocks = STRESS_MAXIMUM(hdd_bytes / stats[0].block_size, 1);
+	t_start = stress_time_now();
+	t_step = t_start;
+	do {
+		stress_hdd_bs_stats_t *stat = &stats[step];
+		const size_t bs = stat->block_size;
+		uint32_t min_complete;
+		uint64_t t_now;
+		int n, j;
+
+		/* move to the next block size once the in-flight requests drain */
+		if (bs_sweep && !draining && (n_stats > 1) &&
+		    ((stress_time_now() - t_step) >= HDD_BS_SWEEP_SLICE))
+			draining = true;
+		if (draining && (n_free == iodepth)) {
+			t_end = stress_time_now();
+			stat->duration += t_end - t_step;
+			t_step = t_end;
+			step = (step + 1) % n_stats;
+			blocks = STRESS_MAXIMUM(hdd_bytes / stats[step].block_size, 1);
+			block = 0;
+			draining = false;
+			continue;
+		}
+
+		while (!draining && (n_free > 0)) {
+			const uint32_t slot = free_slots[--n_free];
+			const bool rd = stress_mwc8modn(100) < rwmix;
+			const uint64_t blk = rnd ? stress_mwc64modn(blocks) : (block++ % blocks);
+
+			slot_rd[slot] = rd;
+			t_submit[slot] = stress_latency_now();
+			stress_hdd_aio_queue(&aio, slot, fd, rd, bufs + ((size_t)slot * max_bs),
+				bs, (off_t)(blk * bs));
+		}
+
+		/* wait for a completion when all the request slots are in flight */
+		min_complete = ((n_free == 0) || draining) ? 1 : 0;
+		n = stress_hdd_aio_wait(&aio, min_complete, slots, res);
+		if (n < 0) {
+			if ((errno == EINTR) || (errno == EAGAIN) || (errno == EBUSY))
+				continue;
+			rc = stress_exit_status(errno);
+			pr_fail("%s: %s submit/wait failed, errno=%d (%s)\n",
+				args->name, hdd_engines[aio.engine], errno, strerror(errno));
+			break;
+		}
+		t_now = stress_latency_now();
+		for (j = 0; j < n; j++) {
+			const uint32_t slot = slots[j];
+			const uint64_t ns = t_now - t_submit[slot];
+			if (UNLIKELY(slot >= iodepth))
+				continue;
+			free_slots[n_free++] = slot;
+			stress_latency_hist_record(&stat->hist, ns);
+			stress_latency_record(args, 0, ns);
+			if (UNLIKELY(res[j] < 0)) {
+				if ((res[j] == -ENOSPC) || (res[j] == -EDQUOT) || (res[j] == -EINTR))
+					continue;
+				rc = EXIT_FAILURE;
+				pr_fail("%s: asynchronous %zu byte I/O failed, errno=%d (%s)\n",
+					args->name, bs, (int)-res[j], strerror((int)-res[j]));
+				goto drain;
+			}
+			if (slot_rd[slot])
+				stat->rd_bytes += (uint64_t)res[j];
+			else
+				stat->wr_bytes += (uint64_t)res[j];
+			stat->ops++;
+			stress_bogo_inc(args);
+		}
+	} while (stress_continue(args));
+drain:
+	t_end = stress_time_now();
+	stats[step].duration += t_end - t_step;
+	total_duration = t_end - t_start;
+
+	/* reap any requests still in flight */
+	while (n_free < iodepth) {
+		const int n = stress_hdd_aio_wait(&aio, 1, slots, res);
+
+		if (n < 0) {
+			if (errno == EINTR)
+				continue;
+			break;
+		}
+		n_free += (uint32_t)n;
+	}
+tidy_fd:
+	(void)close(fd);
+tidy_bufs:
+	free(slot_rd);
+	free(res);
+	free(slots);
+	free(free_slots);
+	free(t_submit);
+	free(bufs);
+tidy_aio:
+	stress_hdd_aio_deinit(&aio);
+
+	for (i = 0; i < n_stats; i++) {
+		const stress_hdd_bs_stats_t *stat = &stats[i];
+		const size_t idx = 3 + (i * 3);
+		char bs_str[32], desc[64];
+		double iops, rate;
+
+		total_rd += stat->rd_bytes;
+		total_wr += stat->wr_bytes;
+
+		stress_hdd_bs_str(bs_str, sizeof(bs_str), stat->block_size);
+		iops = (stat->duration > 0.0) ? (double)stat->ops / stat->duration : 0.0;
+		rate = (stat->duration > 0.0) ?
+			(double)(stat->rd_bytes + stat->wr_bytes) / stat->duration : 0.0;
+		(void)snprintf(desc, sizeof(desc), "IOPS at %s blocks", bs_str);
+		stress_metrics_set(args, idx, desc, iops, STRESS_METRIC_HARMONIC_MEAN);
+		(void)snprintf(desc, sizeof(desc), "MB per sec at %s blocks", bs_str);
+		stress_metrics_set(args, idx + 1, desc, rate / (double)MB, STRESS_METRIC_HARMONIC_MEAN);
+		(void)snprintf(desc, sizeof(desc), "usec p99 latency at %s blocks", bs_str);
+		stress_metrics_set(args, idx + 2, desc,
+			(double)stress_latency_hist_percentile(&stat->hist, 99.0) / 1000.0,
+			STRESS_METRIC_MAXIMUM);
+	}
+
+	/* reads and writes are concurrent, so both ran for the whole duration */
+	*rd_bytes += (double)total_rd;
+	*wr_bytes += (double)total_wr;
+	*rd_duration += total_duration;
+	*wr_duration += total_duration;
+	free(stats);
+	return rc;
+}
+#endif
+
 /*
  *  stress_hdd
  *	stress I/O via writes
@@ -664,10 +1315,18 @@ static int stress_hdd(stress_args_t *args)
 	double hdd_write_bytes = 0.0, hdd_write_duration = 0.0;
 	double hdd_rdwr_bytes, hdd_rdwr_duration;
 	double rate;
+	uint32_t hdd_iodepth = DEFAULT_HDD_IODEPTH;
+	uint32_t hdd_rwmix = DEFAULT_HDD_RWMIX;
+	size_t hdd_engine = HDD_ENGINE_AUTO;
+	bool hdd_bs_sweep = false, hdd_async = false;
 
 	(void)stress_get_setting("hdd-flags", &hdd_flags);
 	(void)stress_get_setting("hdd-oflags", &hdd_oflags);
 	(void)stress_get_setting("hdd-opts-set", &opts_set);
+	(void)stress_get_setting("hdd-iodepth", &hdd_iodepth);
+	(void)stress_get_setting("hdd-rwmix", &hdd_rwmix);
+	(void)stress_get_setting("hdd-engine", &hdd_engine);
+	(void)stress_get_setting("hdd-bs-sweep", &hdd_bs_sweep);
 
 	flags = O_CREAT | O_RDWR | O_TRUNC | hdd_oflags;
 	fadvise_flags = hdd_flags & HDD_OPT_FADV_MASK;
@@ -759,6 +1418,25 @@ static int stress_hdd(stress_args_t *args)
 	stress_sync_start_wait(args);
 	stress_set_proc_state(args->name, STRESS_STATE_RUN);
 
+	if (hdd_iodepth > 0) {
+#if defined(STRESS_HDD_ASYNC)
+		rc = stress_hdd_async(args, filename, flags, hdd_flags,
+			hdd_bytes, hdd_write_size, hdd_iodepth, hdd_engine,
+			hdd_rwmix, hdd_bs_sweep,
+			&hdd_read_bytes, &hdd_read_duration,
+			&hdd_write_bytes, &hdd_write_duration);
+		hdd_async = true;
+		goto finish;
+#else
+		if (args->instance == 0)
+			pr_inf("%s: --hdd-iodepth requires io-uring or libaio support, "
+				"using synchronous I/O\n", args->name);
+#endif
+	} else if ((hdd_bs_sweep || (hdd_engine != HDD_ENGINE_AUTO)) && (args->instance == 0)) {
+		pr_inf("%s: --hdd-bs-sweep and --hdd-engine are only used with --hdd-iodepth\n",
+			args->name);
+	}
+
 	do {
 		int fd;
 		struct stat statbuf;
@@ -1069,7 +1747,7 @@ finish:
 	stress_metrics_set(args, 1, "MB/sec write rate",
 		rate / (double)MB, STRESS_METRIC_HARMONIC_MEAN);
 
-	hdd_rdwr_duration = hdd_read_duration + hdd_write_duration;
+	hdd_rdwr_duration = hdd_async ? hdd_read_duration : hdd_read_duration + hdd_write_duration;
 	hdd_rdwr_bytes = hdd_read_bytes + hdd_write_bytes;
 
 	rate = (hdd_rdwr_duration > 0.0) ? hdd_rdwr_bytes / hdd_rdwr_duration : 0.0;
@@ -1082,8 +1760,12 @@ finish:
 }
 
 static const stress_opt_t opts[] = {
+	{ OPT_hdd_bs_sweep,   "hdd-bs-sweep",   TYPE_ID_BOOL, 0, 1, NULL },
 	{ OPT_hdd_bytes,      "hdd-bytes",      TYPE_ID_UINT64_BYTES_FS, MIN_HDD_BYTES, MAX_HDD_BYTES, NULL },
+	{ OPT_hdd_engine,     "hdd-engine",     TYPE_ID_SIZE_T_METHOD, 0, 0, stress_hdd_engine },
+	{ OPT_hdd_iodepth,    "hdd-iodepth",    TYPE_ID_UINT32, MIN_HDD_IODEPTH, MAX_HDD_IODEPTH, NULL },
 	{ OPT_hdd_opts,       "hdd-opts",       TYPE_ID_CALLBACK, 0, 0, stress_hdd_opts },
+	{ OPT_hdd_rwmix,      "hdd-rwmix",      TYPE_ID_UINT32, MIN_HDD_RWMIX, MAX_HDD_RWMIX, NULL },
 	{ OPT_hdd_write_size, "hdd-write-size", TYPE_ID_UINT64_BYTES_FS, MIN_HDD_WRITE_SIZE, MAX_HDD_WRITE_SIZE, NULL },
 	END_OPT,
 };
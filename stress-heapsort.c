@@ -25,6 +25,9 @@
 #define MAX_HEAPSORT_SIZE	(4 * MB)
 #define DEFAULT_HEAPSORT_SIZE	(256 * KB)
 
+#define MIN_HEAPSORT_THREADS	(0)
+#define MAX_HEAPSORT_THREADS	(256)
+
 static volatile bool do_jmp = true;
 static sigjmp_buf jmp_env;
 
@@ -33,6 +36,7 @@ static const stress_help_t help[] = {
 	{ NULL, "heapsort-method M",	"select sort method [ heapsort-libc | heapsort-nonlibc" },
 	{ NULL,	"heapsort-ops N",	"stop after N heap sort bogo operations" },
 	{ NULL,	"heapsort-size N",	"number of 32 bit integers to sort" },
+	{ NULL,	"heapsort-threads N",	"sort in parallel using a sample sort over N threads" },
 	{ NULL,	NULL,		   NULL }
 };
 
@@ -136,8 +140,9 @@ static const char *stress_heapsort_method(const size_t i)
 }
 
 static const stress_opt_t opts[] = {
-	{ OPT_heapsort_size,   "heapsort-size",   TYPE_ID_UINT64, MIN_HEAPSORT_SIZE, MAX_HEAPSORT_SIZE, NULL },
-	{ OPT_heapsort_method, "heapsort-method", TYPE_ID_SIZE_T_METHOD, 0, 0, stress_heapsort_method },
+	{ OPT_heapsort_size,    "heapsort-size",    TYPE_ID_UINT64, MIN_HEAPSORT_SIZE, MAX_HEAPSORT_SIZE, NULL },
+	{ OPT_heapsort_method,  "heapsort-method",  TYPE_ID_SIZE_T_METHOD, 0, 0, stress_heapsort_method },
+	{ OPT_heapsort_threads, "heapsort-threads", TYPE_ID_UINT32, MIN_HEAPSORT_THREADS, MAX_HEAPSORT_THREADS, NULL },
 	END_OPT,
 };
 
@@ -155,6 +160,18 @@ static void MLOCKED_TEXT stress_heapsort_handler(int signum)
 	}
 }
 
+static heapsort_func_t stress_heapsort_par_func;
+
+/*
+ *  stress_heapsort_par_sort()
+ *	sort a bucket of the parallel sort with the selected method
+ */
+static int stress_heapsort_par_sort(int32_t *data, const size_t n, const bool reverse)
+{
+	return stress_heapsort_par_func(data, n, sizeof(*data),
+		reverse ? stress_sort_cmp_rev_int32 : stress_sort_cmp_fwd_int32);
+}
+
 /*
  *  stress_heapsort()
  *	stress heapsort
@@ -162,6 +179,7 @@ static void MLOCKED_TEXT stress_heapsort_handler(int signum)
 static int stress_heapsort(stress_args_t *args)
 {
 	uint64_t heapsort_size = DEFAULT_HEAPSORT_SIZE;
+	uint32_t heapsort_threads = 0;
 	int32_t *data, *ptr;
 	size_t n, i, data_size, heapsort_method = 0;
 	struct sigaction old_action;
@@ -172,6 +190,7 @@ static int stress_heapsort(stress_args_t *args)
 	heapsort_func_t heapsort_func;
 
 	(void)stress_get_setting("heapsort-method", &heapsort_method);
+	(void)stress_get_setting("heapsort-threads", &heapsort_threads);
 
 	heapsort_func = stress_heapsort_methods[heapsort_method].heapsort_func;
 	if (args->instance == 0)
@@ -198,6 +217,14 @@ static int stress_heapsort(stress_args_t *args)
 	(void)stress_madvise_collapse(data, data_size);
 	stress_set_vma_anon_name(data, data_size, "heapsort-data");
 
+	if (heapsort_threads > 0) {
+		stress_heapsort_par_func = heapsort_func;
+		stress_sort_data_int32_init(data, n);
+		rc = stress_sort_int32_parallel(args, data, n, heapsort_threads, stress_heapsort_par_sort);
+		(void)munmap((void *)data, data_size);
+		return rc;
+	}
+
 	ret = sigsetjmp(jmp_env, 1);
 	if (ret) {
 		/*
@@ -327,5 +354,6 @@ const stressor_info_t stress_heapsort_info = {
 	.class = CLASS_CPU_CACHE | CLASS_CPU | CLASS_MEMORY | CLASS_SORT,
 	.opts = opts,
 	.verify = VERIFY_OPTIONAL,
+	.metrics_max = 3,
 	.help = help
 };
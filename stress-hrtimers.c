@@ -20,6 +20,7 @@
 #include "stress-ng.h"
 #include "core-builtin.h"
 #include "core-killpid.h"
+#include "core-latency.h"
 #include "core-out-of-memory.h"
 
 #include <sched.h>
@@ -47,6 +48,9 @@ static timer_t timerid;
 static double time_end;
 static long int ns_delay;
 static int overrun;
+static stress_latency_hist_t *hist;
+static uint64_t next_ns;	/* CLOCK_REALTIME of the next programmed expiry */
+static uint64_t interval_ns;	/* timer interval */
 void *lock;
 
 #define PROCS_MAX	(8)
@@ -63,6 +67,31 @@ static void stress_hrtimers_set(struct itimerspec *timer)
 	timer->it_interval.tv_nsec = timer->it_value.tv_nsec;
 }
 
+/*
+ *  stress_hrtimers_now()
+ *	CLOCK_REALTIME in nanoseconds, the clock the timer runs on
+ */
+static inline uint64_t OPTIMIZE3 stress_hrtimers_now(void)
+{
+	struct timespec ts;
+
+	if (UNLIKELY(clock_gettime(CLOCK_REALTIME, &ts) < 0))
+		return 0;
+	return ((uint64_t)ts.tv_sec * STRESS_NANOSECOND) + (uint64_t)ts.tv_nsec;
+}
+
+/*
+ *  stress_hrtimers_expiry_set()
+ *	note the schedule of the timer just armed with timer
+ */
+static inline void OPTIMIZE3 stress_hrtimers_expiry_set(
+	const struct itimerspec *timer,
+	const uint64_t now_ns)
+{
+	interval_ns = (uint64_t)timer->it_interval.tv_nsec;
+	next_ns = now_ns + (uint64_t)timer->it_value.tv_nsec;
+}
+
 /*
  *  stress_hrtimers_stress_continue(args)
  *      returns true if we can keep on running a stressor
@@ -81,10 +110,17 @@ static void MLOCKED_TEXT OPTIMIZE3 stress_hrtimers_handler(int sig)
 {
 	struct itimerspec timer;
 	sigset_t mask;
+	const uint64_t now_ns = stress_hrtimers_now();
+	int overruns;
 
 	(void)sig;
 
 	timer_counter++;
+
+	/* lateness of the expiry this signal was queued for */
+	stress_latency_hist_record(hist, (now_ns > next_ns) ? now_ns - next_ns : 0);
+	overruns = timer_getoverrun(timerid);
+	next_ns += (uint64_t)(1 + ((overruns > 0) ? overruns : 0)) * interval_ns;
 	if (UNLIKELY(!stress_hrtimers_stress_continue()))
 		goto cancel;
 
@@ -92,13 +128,14 @@ static void MLOCKED_TEXT OPTIMIZE3 stress_hrtimers_handler(int sig)
 		if (ns_delay >= 0) {
 			const long int ns_adjust = ns_delay >> 2;
 
-			if (timer_getoverrun(timerid)) {
+			if (overruns) {
 				ns_delay += ns_adjust;
 			} else {
 				ns_delay -= ns_adjust;
 			}
 		}
 		stress_hrtimers_set(&timer);
+		stress_hrtimers_expiry_set(&timer, stress_hrtimers_now());
 		(void)timer_settime(timerid, 0, &timer, NULL);
 
 		/* check periodically for timeout */
@@ -165,6 +202,7 @@ static int stress_hrtimer_process(stress_args_t *args)
 	}
 
 	stress_hrtimers_set(&timer);
+	stress_hrtimers_expiry_set(&timer, stress_hrtimers_now());
 	if (timer_settime(timerid, 0, &timer, NULL) < 0) {
 		pr_fail("%s: timer_settime failed, errno=%d (%s)\n",
 			args->name, errno, strerror(errno));
@@ -185,9 +223,48 @@ static int stress_hrtimer_process(stress_args_t *args)
 	return EXIT_SUCCESS;
 }
 
+/*
+ *  stress_hrtimers_lateness_metrics()
+ *	merge the per process expiry lateness histograms and report
+ *	percentiles labelled with the number of timers
+ */
+static void stress_hrtimers_lateness_metrics(
+	stress_args_t *args,
+	const stress_latency_hist_t *hists)
+{
+	static const double percentiles[] = { 50.0, 99.0, 99.9 };
+	stress_latency_hist_t *merged;
+	const uint32_t timers = PROCS_MAX * args->instances;
+	char msg[80];
+	size_t i;
+
+	merged = (stress_latency_hist_t *)malloc(sizeof(*merged));
+	if (!merged)
+		return;
+	stress_latency_hist_init(merged);
+	for (i = 0; i < PROCS_MAX; i++)
+		stress_latency_hist_merge(merged, &hists[i]);
+
+	if (args->latency) {
+		stress_latency_set_description(args, 0, "hrtimer expiry lateness");
+		stress_latency_hist_merge(&args->latency[0].hist, merged);
+	}
+	for (i = 0; i < SIZEOF_ARRAY(percentiles); i++) {
+		(void)snprintf(msg, sizeof(msg), "usec p%g expiry lateness (%" PRIu32 " timers)",
+			percentiles[i], timers);
+		stress_metrics_set(args, 1 + i, msg,
+			(double)stress_latency_hist_percentile(merged, percentiles[i]) / 1000.0,
+			STRESS_METRIC_MAXIMUM);
+	}
+	(void)snprintf(msg, sizeof(msg), "usec max expiry lateness (%" PRIu32 " timers)", timers);
+	stress_metrics_set(args, 1 + i, msg, (double)merged->max_ns / 1000.0, STRESS_METRIC_MAXIMUM);
+	free(merged);
+}
+
 static int stress_hrtimers(stress_args_t *args)
 {
 	stress_pid_t *s_pids, *s_pids_head = NULL;
+	stress_latency_hist_t *hists;
 	size_t i;
 	bool hrtimers_adjust = false;
 	double start_time = -1.0, end_time;
@@ -203,11 +280,24 @@ static int stress_hrtimers(stress_args_t *args)
 		return EXIT_NO_RESOURCE;
 	}
 
+	/* one expiry lateness histogram per timer process */
+	hists = (stress_latency_hist_t *)stress_mmap_populate(NULL, PROCS_MAX * sizeof(*hists),
+		PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+	if (hists == MAP_FAILED) {
+		pr_inf_skip("%s: failed to mmap %d latency histograms, skipping stressor\n",
+			args->name, PROCS_MAX);
+		rc = EXIT_NO_RESOURCE;
+		goto tidy_s_pids;
+	}
+	stress_set_vma_anon_name(hists, PROCS_MAX * sizeof(*hists), "hrtimer-lateness");
+	for (i = 0; i < PROCS_MAX; i++)
+		stress_latency_hist_init(&hists[i]);
+
 	lock = stress_lock_create("counter");
 	if (!lock) {
 		pr_inf("%s: cannot create lock, skipping stressor\n", args->name);
 		rc = EXIT_NO_RESOURCE;
-		goto tidy_s_pids;
+		goto tidy_hists;
 	}
 
         (void)stress_get_setting("hrtimers-adjust", &hrtimers_adjust);
@@ -230,6 +320,7 @@ static int stress_hrtimers(stress_args_t *args)
 			stress_parent_died_alarm();
 			stress_set_oom_adjustment(args, true);
 			(void)sched_settings_apply(true);
+			hist = &hists[i];
 			stress_hrtimer_process(args);
 			_exit(EXIT_SUCCESS);
 		} else if (s_pids[i].pid > 0) {
@@ -268,7 +359,10 @@ reap:
 				rate, STRESS_METRIC_HARMONIC_MEAN);
 		}
 	}
+	stress_hrtimers_lateness_metrics(args, hists);
 	stress_lock_destroy(lock);
+tidy_hists:
+	(void)munmap((void *)hists, PROCS_MAX * sizeof(*hists));
 tidy_s_pids:
 	(void)stress_s_pids_munmap(s_pids, PROCS_MAX);
 
@@ -280,6 +374,7 @@ const stressor_info_t stress_hrtimers_info = {
 	.class = CLASS_SCHEDULER,
 	.opts = opts,
 	.verify = VERIFY_ALWAYS,
+	.metrics_max = 5,
 	.help = help
 };
 #else
@@ -18,7 +18,9 @@
  *
  */
 #include "stress-ng.h"
+#include "core-arch.h"
 #include "core-builtin.h"
+#include "core-hash.h"
 
 #if defined(HAVE_SEARCH_H) && 	\
      defined(HAVE_HSEARCH)
@@ -42,19 +44,22 @@ typedef struct {
 typedef int (*hcreate_func_t)(size_t nel);
 typedef ENTRY *(*hsearch_func_t)(ENTRY item, ACTION action);
 typedef void (*hdestroy_func_t)(void);
+typedef bool (*hdelete_func_t)(const char *key);
 
 typedef struct {
 	const char *name;
 	hcreate_func_t hcreate;
 	hsearch_func_t hsearch;
 	hdestroy_func_t hdestroy;
+	hdelete_func_t hdelete;	/* optional, NULL if not supported */
 } stress_hsearch_method_t;
 
 static const stress_help_t help[] = {
-	{ NULL,	"hsearch N",	  "start N workers that exercise a hash table search" },
-	{ NULL,	"hsearch-ops N",  "stop after N hash search bogo operations" },
-	{ NULL,	"hsearch-size N", "number of integers to insert into hash table" },
-	{ NULL,	NULL,		  NULL }
+	{ NULL,	"hsearch N",	    "start N workers that exercise a hash table search" },
+	{ NULL,	"hsearch-method M", "select hash table method: hsearch-libc, hsearch-nonlibc, hsearch-swiss" },
+	{ NULL,	"hsearch-ops N",    "stop after N hash search bogo operations" },
+	{ NULL,	"hsearch-size N",   "number of integers to insert into hash table" },
+	{ NULL,	NULL,		    NULL }
 };
 
 typedef struct {
@@ -106,6 +111,8 @@ static ENTRY OPTIMIZE3 *hsearch_nonlibc(ENTRY entry, ACTION action)
 
 	if (action == FIND) {
 		do {
+			if (htable[idx].hash == 0)
+				return NULL;
 			if ((htable[idx].hash == idx) && (strcmp(htable[idx].entry.key, entry.key) == 0))
 				return &htable[idx].entry;
 			idx++;
@@ -134,12 +141,257 @@ static ENTRY OPTIMIZE3 *hsearch_nonlibc(ENTRY entry, ACTION action)
 	return NULL;
 }
 
+/*
+ *  SwissTable style open addressing hash table, a byte of control
+ *  metadata per slot holds either SWISS_EMPTY or the top 7 bits of
+ *  the key hash so a group of slots can be probed with one vector
+ *  compare. Groups are unaligned windows over the control bytes, the
+ *  first group width control bytes are cloned after the end of the
+ *  table so that windows can wrap. Probing is linear at slot
+ *  granularity, so deletion backward shifts the following cluster
+ *  rather than leaving tombstones.
+ */
+#define SWISS_EMPTY		(0x80)
+
+#if defined(STRESS_ARCH_X86) &&		\
+    defined(HAVE_IMMINTRIN_H) &&	\
+    defined(__SSE2__) &&		\
+    !defined(HAVE_COMPILER_MUSL) &&	\
+    !defined(HAVE_COMPILER_ICC)
+#include <immintrin.h>
+#define SWISS_GROUP_SSE2
+#define SWISS_GROUP_WIDTH	(16)
+#define SWISS_MASK_SHIFT	(0)
+#elif defined(STRESS_ARCH_ARM) &&	\
+    defined(__aarch64__) &&		\
+    defined(__ARM_NEON)
+#include <arm_neon.h>
+#define SWISS_GROUP_NEON
+#define SWISS_GROUP_WIDTH	(16)
+#define SWISS_MASK_SHIFT	(2)
+#else
+#define SWISS_GROUP_WIDTH	(8)
+#define SWISS_MASK_SHIFT	(3)
+#endif
+
+typedef struct {
+	uint32_t hash;
+	ENTRY entry;
+} swiss_slot_t;
+
+static uint8_t *swiss_ctrl;
+static swiss_slot_t *swiss_slots;
+static size_t swiss_capacity;
+static size_t swiss_count;
+
+/*
+ *  swiss_group_match()
+ *	bit mask of slots in the group at ctrl with control byte h2,
+ *	the slot index of a set bit is its bit number >> SWISS_MASK_SHIFT
+ */
+static inline uint64_t OPTIMIZE3 swiss_group_match(const uint8_t *ctrl, const uint8_t h2)
+{
+#if defined(SWISS_GROUP_SSE2)
+	const __m128i group = _mm_loadu_si128((const __m128i *)(const void *)ctrl);
+
+	return (uint64_t)(uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(group, _mm_set1_epi8((char)h2)));
+#elif defined(SWISS_GROUP_NEON)
+	const uint8x16_t eq = vceqq_u8(vld1q_u8(ctrl), vdupq_n_u8(h2));
+
+	return vget_lane_u64(vreinterpret_u64_u8(vshrn_n_u16(vreinterpretq_u16_u8(eq), 4)), 0) &
+		0x8888888888888888ULL;
+#else
+	uint64_t group, x;
+
+	(void)shim_memcpy(&group, ctrl, sizeof(group));
+	x = group ^ (0x0101010101010101ULL * h2);
+	/* may give false positives after a true match, keys are compared anyway */
+	return (x - 0x0101010101010101ULL) & ~x & 0x8080808080808080ULL;
+#endif
+}
+
+/*
+ *  swiss_group_empty()
+ *	bit mask of empty slots in the group at ctrl
+ */
+static inline uint64_t OPTIMIZE3 swiss_group_empty(const uint8_t *ctrl)
+{
+#if defined(SWISS_GROUP_SSE2)
+	return (uint64_t)(uint32_t)_mm_movemask_epi8(_mm_loadu_si128((const __m128i *)(const void *)ctrl));
+#elif defined(SWISS_GROUP_NEON)
+	const uint8x16_t empty = vcltzq_s8(vreinterpretq_s8_u8(vld1q_u8(ctrl)));
+
+	return vget_lane_u64(vreinterpret_u64_u8(vshrn_n_u16(vreinterpretq_u16_u8(empty), 4)), 0) &
+		0x8888888888888888ULL;
+#else
+	uint64_t group;
+
+	(void)shim_memcpy(&group, ctrl, sizeof(group));
+	return group & 0x8080808080808080ULL;
+#endif
+}
+
+/*
+ *  swiss_ctz64()
+ *	count trailing zeros of a non-zero group mask
+ */
+static inline int swiss_ctz64(const uint64_t mask)
+{
+#if defined(HAVE_BUILTIN_CTZ)
+	return __builtin_ctzll(mask);
+#else
+	register int n = 0;
+	register uint64_t m = mask;
+
+	while (!(m & 1)) {
+		m >>= 1;
+		n++;
+	}
+	return n;
+#endif
+}
+
+static inline uint32_t swiss_hash(const char *key)
+{
+	return stress_hash_fnv1a(key) * 0x9e3779b1U;
+}
+
+static inline void swiss_set_ctrl(const size_t idx, const uint8_t h2)
+{
+	swiss_ctrl[idx] = h2;
+	if (idx < SWISS_GROUP_WIDTH)
+		swiss_ctrl[swiss_capacity + idx] = h2;
+}
+
+static int hcreate_swiss(size_t nel)
+{
+	size_t capacity;
+
+	for (capacity = SWISS_GROUP_WIDTH; capacity < nel; capacity <<= 1)
+		;
+	swiss_ctrl = (uint8_t *)malloc(capacity + SWISS_GROUP_WIDTH);
+	if (!swiss_ctrl) {
+		errno = ENOMEM;
+		return 0;
+	}
+	swiss_slots = (swiss_slot_t *)calloc(capacity, sizeof(*swiss_slots));
+	if (!swiss_slots) {
+		free(swiss_ctrl);
+		swiss_ctrl = NULL;
+		errno = ENOMEM;
+		return 0;
+	}
+	(void)shim_memset(swiss_ctrl, SWISS_EMPTY, capacity + SWISS_GROUP_WIDTH);
+	swiss_capacity = capacity;
+	swiss_count = 0;
+	return 1;
+}
+
+static void hdestroy_swiss(void)
+{
+	free(swiss_slots);
+	free(swiss_ctrl);
+	swiss_slots = NULL;
+	swiss_ctrl = NULL;
+	swiss_capacity = 0;
+	swiss_count = 0;
+}
+
+/*
+ *  swiss_find_slot()
+ *	find the slot holding key, returns capacity if not found, *empty
+ *	is set to the first empty slot at or after the key's home slot
+ */
+static inline size_t OPTIMIZE3 swiss_find_slot(const char *key, const uint32_t hash, size_t *empty)
+{
+	const size_t mask = swiss_capacity - 1;
+	const uint8_t h2 = (uint8_t)(hash >> 25);
+	size_t pos = (size_t)hash & mask;
+	size_t n;
+
+	for (n = 0; n < swiss_capacity; n += SWISS_GROUP_WIDTH) {
+		const uint8_t *ctrl = swiss_ctrl + pos;
+		uint64_t match = swiss_group_match(ctrl, h2);
+		uint64_t empties;
+
+		while (match) {
+			const size_t idx = (pos + (size_t)(swiss_ctz64(match) >> SWISS_MASK_SHIFT)) & mask;
+
+			if (LIKELY(swiss_slots[idx].hash == hash) &&
+			    (strcmp(swiss_slots[idx].entry.key, key) == 0))
+				return idx;
+			match &= match - 1;
+		}
+		empties = swiss_group_empty(ctrl);
+		if (LIKELY(empties)) {
+			*empty = (pos + (size_t)(swiss_ctz64(empties) >> SWISS_MASK_SHIFT)) & mask;
+			return swiss_capacity;
+		}
+		pos = (pos + SWISS_GROUP_WIDTH) & mask;
+	}
+	*empty = swiss_capacity;
+	return swiss_capacity;
+}
+
+static ENTRY OPTIMIZE3 *hsearch_swiss(ENTRY entry, ACTION action)
+{
+	const uint32_t hash = swiss_hash(entry.key);
+	size_t empty = 0, idx;
+
+	idx = swiss_find_slot(entry.key, hash, &empty);
+	if (idx < swiss_capacity)
+		return &swiss_slots[idx].entry;
+	if (action == FIND)
+		return NULL;
+	/* always keep one empty slot so probing terminates */
+	if (UNLIKELY((empty >= swiss_capacity) || (swiss_count + 1 >= swiss_capacity))) {
+		errno = ENOMEM;
+		return NULL;
+	}
+	swiss_slots[empty].hash = hash;
+	swiss_slots[empty].entry = entry;
+	swiss_set_ctrl(empty, (uint8_t)(hash >> 25));
+	swiss_count++;
+	return &swiss_slots[empty].entry;
+}
+
+/*
+ *  hdelete_swiss()
+ *	remove key, the slots after it in the probe cluster that do not
+ *	sit between their home slot and the hole are shifted back so no
+ *	tombstones are required
+ */
+static bool OPTIMIZE3 hdelete_swiss(const char *key)
+{
+	const size_t mask = swiss_capacity - 1;
+	size_t empty = 0, i, j;
+
+	i = swiss_find_slot(key, swiss_hash(key), &empty);
+	if (i >= swiss_capacity)
+		return false;
+
+	for (j = (i + 1) & mask; swiss_ctrl[j] != SWISS_EMPTY; j = (j + 1) & mask) {
+		const size_t home = (size_t)swiss_slots[j].hash & mask;
+
+		/* leave slot j if its home is cyclically within (i, j] */
+		if ((i <= j) ? ((i < home) && (home <= j)) : ((i < home) || (home <= j)))
+			continue;
+		swiss_slots[i] = swiss_slots[j];
+		swiss_set_ctrl(i, swiss_ctrl[j]);
+		i = j;
+	}
+	swiss_set_ctrl(i, SWISS_EMPTY);
+	swiss_count--;
+	return true;
+}
+
 static const stress_hsearch_method_t stress_hsearch_methods[] = {
 #if defined(HAVE_SEARCH_H) &&	\
     defined(HAVE_HSEARCH)
-	{ "hsearch-libc",	hcreate,	 hsearch,	hdestroy },
+	{ "hsearch-libc",	hcreate,	 hsearch,	  hdestroy,	    NULL },
 #endif
-	{ "hsearch-nonlibc",	hcreate_nonlibc, hsearch_nonlibc, hdestroy_nonlibc },
+	{ "hsearch-nonlibc",	hcreate_nonlibc, hsearch_nonlibc, hdestroy_nonlibc, NULL },
+	{ "hsearch-swiss",	hcreate_swiss,	 hsearch_swiss,	  hdestroy_swiss,   hdelete_swiss },
 };
 
 static const char *stress_hsearch_method(const size_t i)
@@ -167,12 +419,18 @@ static int OPTIMIZE3 stress_hsearch(stress_args_t *args)
 	hsearch_func_t hsearch_func;
 	hcreate_func_t hcreate_func;
 	hdestroy_func_t hdestroy_func;
+	hdelete_func_t hdelete_func;
 	size_t hsearch_method = 0;
+	double hit_duration = 0.0, hit_count = 0.0;
+	double miss_duration = 0.0, miss_count = 0.0;
+	double delete_duration = 0.0, delete_count = 0.0;
+	double rate;
 
 	(void)stress_get_setting("hsearch-method", &hsearch_method);
 	hcreate_func = stress_hsearch_methods[hsearch_method].hcreate;
 	hsearch_func = stress_hsearch_methods[hsearch_method].hsearch;
 	hdestroy_func = stress_hsearch_methods[hsearch_method].hdestroy;
+	hdelete_func = stress_hsearch_methods[hsearch_method].hdelete;
 	if (!stress_get_setting("hsearch-size", &hsearch_size)) {
 		if (g_opt_flags & OPT_FLAGS_MAXIMIZE)
 			hsearch_size = MAX_HSEARCH_SIZE;
@@ -188,7 +446,8 @@ static int OPTIMIZE3 stress_hsearch(stress_args_t *args)
 		return EXIT_FAILURE;
 	}
 
-	keys = (char **)calloc(max, sizeof(*keys));
+	/* keys [0..max-1] are inserted, keys [max..max * 2 - 1] always miss */
+	keys = (char **)calloc(max * 2, sizeof(*keys));
 	if (!keys) {
 		pr_err("%s: cannot allocate keys\n", args->name);
 		goto free_hash;
@@ -214,6 +473,16 @@ static int OPTIMIZE3 stress_hsearch(stress_args_t *args)
 			goto free_all;
 		}
 	}
+	for (i = max; i < max * 2; i++) {
+		char buffer[32];
+
+		(void)snprintf(buffer, sizeof(buffer), "%zu", i);
+		keys[i] = strdup(buffer);
+		if (!keys[i]) {
+			pr_err("%s: cannot allocate key\n", args->name);
+			goto free_all;
+		}
+	}
 
 	stress_set_proc_state(args->name, STRESS_STATE_SYNC_WAIT);
 	stress_sync_start_wait(args);
@@ -221,6 +490,9 @@ static int OPTIMIZE3 stress_hsearch(stress_args_t *args)
 
 	rc = EXIT_SUCCESS;
 	do {
+		double t;
+
+		t = stress_time_now();
 		for (i = 0; LIKELY(stress_continue_flag() && (i < max)); i++) {
 			ENTRY e;
 			const ENTRY *ep;
@@ -240,9 +512,68 @@ static int OPTIMIZE3 stress_hsearch(stress_args_t *args)
 				}
 			}
 		}
+		hit_duration += stress_time_now() - t;
+		hit_count += (double)i;
+
+		t = stress_time_now();
+		for (i = max; LIKELY(stress_continue_flag() && (i < max * 2)); i++) {
+			ENTRY e;
+			const ENTRY *ep;
+
+			e.key = keys[i];
+			e.data = NULL;	/* Keep Coverity quiet */
+			ep = hsearch_func(e, FIND);
+			if (verify && UNLIKELY(ep != NULL)) {
+				pr_fail("%s: found key %s that was never inserted\n", args->name, keys[i]);
+				rc = EXIT_FAILURE;
+			}
+		}
+		miss_duration += stress_time_now() - t;
+		miss_count += (double)(i - max);
+
+		/* delete and re-insert every 16th key, offset by bogo-op count */
+		if (hdelete_func) {
+			size_t n = 0;
+
+			t = stress_time_now();
+			for (i = (size_t)(stress_bogo_get(args) & 15); LIKELY(stress_continue_flag() && (i < max)); i += 16, n++) {
+				ENTRY e;
+
+				if (UNLIKELY(!hdelete_func(keys[i]))) {
+					pr_fail("%s: cannot delete key %s\n", args->name, keys[i]);
+					rc = EXIT_FAILURE;
+				}
+				e.key = keys[i];
+				e.data = NULL;	/* Keep Coverity quiet */
+				if (verify && UNLIKELY(hsearch_func(e, FIND) != NULL)) {
+					pr_fail("%s: found key %s after it was deleted\n", args->name, keys[i]);
+					rc = EXIT_FAILURE;
+				}
+				e.data = (void *)i;
+				if (UNLIKELY(hsearch_func(e, ENTER) == NULL)) {
+					pr_fail("%s: cannot re-insert key %s\n", args->name, keys[i]);
+					rc = EXIT_FAILURE;
+					break;
+				}
+			}
+			delete_duration += stress_time_now() - t;
+			delete_count += (double)n;
+		}
 		stress_bogo_inc(args);
 	} while (stress_continue(args));
 
+	rate = (hit_duration > 0.0) ? hit_count / hit_duration : 0.0;
+	stress_metrics_set(args, 0, "hit lookups per sec",
+		rate, STRESS_METRIC_HARMONIC_MEAN);
+	rate = (miss_duration > 0.0) ? miss_count / miss_duration : 0.0;
+	stress_metrics_set(args, 1, "miss lookups per sec",
+		rate, STRESS_METRIC_HARMONIC_MEAN);
+	if (hdelete_func) {
+		rate = (delete_duration > 0.0) ? delete_count / delete_duration : 0.0;
+		stress_metrics_set(args, 2, "delete + re-inserts per sec",
+			rate, STRESS_METRIC_HARMONIC_MEAN);
+	}
+
 free_all:
 	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
 
@@ -261,6 +592,9 @@ free_all:
 	for (i = 0; i < max; i++)
 		free(keys[i]);
 #endif
+	/* keys that were never inserted can always be freed */
+	for (i = max; i < max * 2; i++)
+		free(keys[i]);
 	free(keys);
 free_hash:
 	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
@@ -274,5 +608,6 @@ const stressor_info_t stress_hsearch_info = {
 	.class = CLASS_CPU_CACHE | CLASS_CPU | CLASS_MEMORY | CLASS_SEARCH,
 	.opts = opts,
 	.verify = VERIFY_OPTIONAL,
+	.metrics_max = 3,
 	.help = help
 };
@@ -198,6 +198,7 @@ const stressor_info_t stress_icmp_flood_info = {
 	.supported = stress_icmp_flood_supported,
 	.class = CLASS_OS | CLASS_NETWORK,
 	.verify = VERIFY_ALWAYS,
+	.metrics_max = 3,
 	.opts = opts,
 	.help = help
 };
@@ -21,14 +21,26 @@
 #include "core-builtin.h"
 #include "core-capabilities.h"
 
+#include <ctype.h>
+
 static const char bitmap_file[] = "/sys/kernel/mm/page_idle/bitmap";
 
 static const stress_help_t help[] = {
 	{ NULL,	"idle-page N",	   "start N idle page scanning workers" },
 	{ NULL,	"idle-page-ops N", "stop after N idle page scan bogo operations" },
+	{ NULL,	"idle-page-wss",   "report working set size of the other stressors" },
+	{ NULL,	"idle-page-wss-interval N", "working set size sampling interval in milliseconds" },
+	{ NULL,	"idle-page-wss-pid P", "report working set size of process P" },
 	{ NULL, NULL,		   NULL }
 };
 
+static const stress_opt_t opts[] = {
+	{ OPT_idle_page_wss,	      "idle-page-wss",		TYPE_ID_BOOL,	0, 1, NULL },
+	{ OPT_idle_page_wss_interval, "idle-page-wss-interval",	TYPE_ID_UINT32,	10, 3600000, NULL },
+	{ OPT_idle_page_wss_pid,      "idle-page-wss-pid",	TYPE_ID_INT32,	1, INT32_MAX, NULL },
+	END_OPT,
+};
+
 /*
  *  stress_idle_page_supported()
  *      check if we can run this as root
@@ -61,6 +73,447 @@ static int stress_idle_page_supported(const char *name)
 #define BITMAP_BYTES	(8)
 #define PAGES_TO_SCAN	(64)
 
+#define WSS_CHUNK_BYTES		(4096)
+#define WSS_COMM_LEN		(32)
+#define WSS_COMMS_MAX		(64)
+#define WSS_DEPTH_MAX		(64)
+#define WSS_PM_PRESENT		(1ULL << 63)
+#define WSS_PM_PFN_MASK		((1ULL << 55) - 1)
+#define WSS_KPF_COMPOUND_HEAD	(1ULL << 15)
+#define WSS_KPF_COMPOUND_TAIL	(1ULL << 16)
+
+static const char kpageflags_file[] = "/proc/kpageflags";
+
+typedef struct {
+	pid_t pid;			/* process id */
+	pid_t ppid;			/* parent process id */
+	char comm[WSS_COMM_LEN];	/* process name */
+} stress_idle_page_proc_t;
+
+typedef struct {
+	char comm[WSS_COMM_LEN];	/* process name, all processes of same name are summed */
+	size_t procs;			/* processes in current sample */
+	uint64_t rss_pages;		/* resident pages in current sample */
+	uint64_t wss_pages;		/* referenced pages in current sample */
+	uint64_t rss_max_pages;		/* maximum resident pages over all samples */
+	uint64_t wss_max_pages;		/* maximum referenced pages over all samples */
+	double wss_total_pages;		/* sum of referenced pages over all samples */
+	uint64_t samples;		/* number of samples with processes */
+} stress_idle_page_wss_t;
+
+typedef struct {
+	int fd;				/* file being cached */
+	off_t base;			/* file offset of cached chunk, -1 if none */
+	ssize_t len;			/* valid bytes in cached chunk */
+	uint64_t buf[WSS_CHUNK_BYTES / sizeof(uint64_t)];
+} stress_idle_page_cache_t;
+
+/*
+ *  stress_idle_page_cache_get()
+ *	fetch 64 bit word at file offset off via a chunk cache,
+ *	returns false if offset is out of range
+ */
+static bool stress_idle_page_cache_get(
+	stress_idle_page_cache_t *cache,
+	const off_t off,
+	uint64_t *val)
+{
+	const off_t base = off & ~(off_t)(WSS_CHUNK_BYTES - 1);
+
+	if (base != cache->base) {
+		cache->len = pread(cache->fd, cache->buf, sizeof(cache->buf), base);
+		if (cache->len < 0)
+			cache->len = 0;
+		cache->base = base;
+	}
+	if ((off - base) + (off_t)sizeof(*val) > (off_t)cache->len)
+		return false;
+	*val = cache->buf[(off - base) / sizeof(*val)];
+	return true;
+}
+
+/*
+ *  stress_idle_page_mark_all()
+ *	set the idle bit on all pages
+ */
+static void stress_idle_page_mark_all(const int fd)
+{
+	uint64_t bitmap_set[WSS_CHUNK_BYTES / sizeof(uint64_t)] ALIGNED(8);
+	off_t posn = 0;
+
+	(void)shim_memset(bitmap_set, 0xff, sizeof(bitmap_set));
+	while (stress_continue_flag()) {
+		const ssize_t ret = pwrite(fd, bitmap_set, sizeof(bitmap_set), posn);
+
+		if (ret <= 0)
+			break;
+		posn += ret;
+	}
+}
+
+static int stress_idle_page_pfn_cmp(const void *p1, const void *p2)
+{
+	const uint64_t pfn1 = *(const uint64_t *)p1;
+	const uint64_t pfn2 = *(const uint64_t *)p2;
+
+	if (pfn1 < pfn2)
+		return -1;
+	return (pfn1 > pfn2) ? 1 : 0;
+}
+
+/*
+ *  stress_idle_page_pfns()
+ *	gather the PFNs of all resident pages of process pid,
+ *	returns number of PFNs in *pfns (which is realloc'd)
+ */
+static size_t stress_idle_page_pfns(
+	const pid_t pid,
+	uint64_t **pfns,
+	size_t *pfns_size)
+{
+	char path[PATH_MAX], buf[512];
+	uint64_t entries[WSS_CHUNK_BYTES / sizeof(uint64_t)];
+	const size_t page_size = stress_get_page_size();
+	size_t n = 0;
+	FILE *fp;
+	int fd;
+
+	(void)snprintf(path, sizeof(path), "/proc/%" PRIdMAX "/maps", (intmax_t)pid);
+	fp = fopen(path, "r");
+	if (!fp)
+		return 0;
+	(void)snprintf(path, sizeof(path), "/proc/%" PRIdMAX "/pagemap", (intmax_t)pid);
+	fd = open(path, O_RDONLY);
+	if (fd < 0) {
+		(void)fclose(fp);
+		return 0;
+	}
+
+	while (fgets(buf, sizeof(buf), fp)) {
+		uintptr_t begin, end, addr;
+
+		if (sscanf(buf, "%" SCNxPTR "-%" SCNxPTR, &begin, &end) != 2)
+			continue;
+		if (strstr(buf, "[vsyscall]"))
+			continue;
+
+		for (addr = begin; addr < end; ) {
+			const size_t pages = STRESS_MINIMUM((end - addr) / page_size, SIZEOF_ARRAY(entries));
+			const off_t off = (off_t)((addr / page_size) * sizeof(uint64_t));
+			const ssize_t ret = pread(fd, entries, pages * sizeof(uint64_t), off);
+			size_t i, got;
+
+			if (ret <= 0)
+				break;
+			got = (size_t)ret / sizeof(uint64_t);
+			for (i = 0; i < got; i++) {
+				const uint64_t pfn = entries[i] & WSS_PM_PFN_MASK;
+
+				if (!(entries[i] & WSS_PM_PRESENT) || (pfn == 0))
+					continue;
+				if (n >= *pfns_size) {
+					const size_t new_size = *pfns_size ? *pfns_size * 2 : 65536;
+					uint64_t *tmp;
+
+					tmp = (uint64_t *)realloc(*pfns, new_size * sizeof(**pfns));
+					if (!tmp)
+						goto done;
+					*pfns = tmp;
+					*pfns_size = new_size;
+				}
+				(*pfns)[n++] = pfn;
+			}
+			addr += got * page_size;
+		}
+	}
+done:
+	(void)close(fd);
+	(void)fclose(fp);
+
+	return n;
+}
+
+/*
+ *  stress_idle_page_referenced()
+ *	count pages in the sorted PFN list that are no longer idle, THP
+ *	tail pages carry no idle state so use the idle state of their head
+ */
+static uint64_t stress_idle_page_referenced(
+	stress_idle_page_cache_t *bitmap,
+	stress_idle_page_cache_t *kflags,
+	const uint64_t *pfns,
+	const size_t n)
+{
+	uint64_t referenced = 0;
+	size_t i;
+
+	for (i = 0; i < n; i++) {
+		uint64_t pfn = pfns[i], word, flags;
+
+		if ((kflags->fd >= 0) &&
+		    stress_idle_page_cache_get(kflags, (off_t)(pfn * sizeof(uint64_t)), &flags) &&
+		    (flags & WSS_KPF_COMPOUND_TAIL)) {
+			const uint64_t pfn_min = pfn & ~(uint64_t)((WSS_CHUNK_BYTES / sizeof(uint64_t)) - 1);
+			uint64_t head;
+
+			for (head = pfn; head > pfn_min; head--) {
+				if (!stress_idle_page_cache_get(kflags, (off_t)((head - 1) * sizeof(uint64_t)), &flags))
+					break;
+				if (flags & WSS_KPF_COMPOUND_HEAD) {
+					pfn = head - 1;
+					break;
+				}
+			}
+		}
+		if (!stress_idle_page_cache_get(bitmap, (off_t)((pfn / 64) * sizeof(uint64_t)), &word))
+			continue;
+		if (!(word & (1ULL << (pfn & 63))))
+			referenced++;
+	}
+	return referenced;
+}
+
+/*
+ *  stress_idle_page_procs()
+ *	read pid, parent pid and name of all processes
+ */
+static size_t stress_idle_page_procs(stress_idle_page_proc_t **procs, size_t *procs_size)
+{
+	DIR *dir;
+	const struct dirent *d;
+	size_t n = 0;
+
+	dir = opendir("/proc");
+	if (!dir)
+		return 0;
+	while ((d = readdir(dir)) != NULL) {
+		char path[PATH_MAX], buf[512];
+		const char *open_paren, *close_paren;
+		intmax_t ppid;
+		size_t len;
+		FILE *fp;
+
+		if (!isdigit((unsigned char)d->d_name[0]))
+			continue;
+		(void)snprintf(path, sizeof(path), "/proc/%s/stat", d->d_name);
+		fp = fopen(path, "r");
+		if (!fp)
+			continue;
+		if (!fgets(buf, sizeof(buf), fp)) {
+			(void)fclose(fp);
+			continue;
+		}
+		(void)fclose(fp);
+
+		open_paren = strchr(buf, '(');
+		close_paren = strrchr(buf, ')');
+		if (!open_paren || !close_paren || (close_paren < open_paren))
+			continue;
+		if (sscanf(close_paren + 1, " %*c %" SCNdMAX, &ppid) != 1)
+			continue;
+
+		if (n >= *procs_size) {
+			const size_t new_size = *procs_size ? *procs_size * 2 : 256;
+			stress_idle_page_proc_t *tmp;
+
+			tmp = (stress_idle_page_proc_t *)realloc(*procs, new_size * sizeof(**procs));
+			if (!tmp)
+				break;
+			*procs = tmp;
+			*procs_size = new_size;
+		}
+		len = STRESS_MINIMUM((size_t)(close_paren - open_paren - 1), (size_t)WSS_COMM_LEN - 1);
+		(void)shim_memcpy((*procs)[n].comm, open_paren + 1, len);
+		(*procs)[n].comm[len] = '\0';
+		(*procs)[n].pid = (pid_t)atoi(d->d_name);
+		(*procs)[n].ppid = (pid_t)ppid;
+		n++;
+	}
+	(void)closedir(dir);
+
+	return n;
+}
+
+/*
+ *  stress_idle_page_descendant()
+ *	is pid a descendant of ancestor
+ */
+static bool stress_idle_page_descendant(
+	const stress_idle_page_proc_t *procs,
+	const size_t n,
+	pid_t pid,
+	const pid_t ancestor)
+{
+	int depth;
+
+	for (depth = 0; depth < WSS_DEPTH_MAX; depth++) {
+		size_t i;
+
+		for (i = 0; i < n; i++)
+			if (procs[i].pid == pid)
+				break;
+		if (i == n)
+			return false;
+		pid = procs[i].ppid;
+		if (pid == ancestor)
+			return true;
+		if (pid <= 1)
+			return false;
+	}
+	return false;
+}
+
+/*
+ *  stress_idle_page_wss_find()
+ *	find or add a per process name working set entry
+ */
+static stress_idle_page_wss_t *stress_idle_page_wss_find(
+	stress_idle_page_wss_t *wss,
+	size_t *n_wss,
+	const char *comm)
+{
+	size_t i;
+
+	for (i = 0; i < *n_wss; i++)
+		if (!strcmp(wss[i].comm, comm))
+			return &wss[i];
+	if (*n_wss >= WSS_COMMS_MAX)
+		return NULL;
+	wss = &wss[(*n_wss)++];
+	(void)shim_memset(wss, 0, sizeof(*wss));
+	(void)shim_strscpy(wss->comm, comm, sizeof(wss->comm));
+	return wss;
+}
+
+/*
+ *  stress_idle_page_wss()
+ *	estimate the working set size of the other stressors (or a
+ *	given pid) by marking all pages idle, waiting and then
+ *	counting the resident pages that were referenced again
+ */
+static int stress_idle_page_wss(
+	stress_args_t *args,
+	const int fd,
+	const pid_t wss_pid,
+	const uint32_t wss_interval_ms)
+{
+	const pid_t self = getpid();
+	const pid_t parent = getppid();
+	const double page_mb = (double)args->page_size / (double)MB;
+	stress_idle_page_wss_t wss[WSS_COMMS_MAX];
+	stress_idle_page_proc_t *procs = NULL;
+	stress_idle_page_cache_t *bitmap, *kflags;
+	uint64_t *pfns = NULL;
+	size_t procs_size = 0, pfns_size = 0, n_wss = 0, i;
+	double t_start;
+
+	bitmap = (stress_idle_page_cache_t *)malloc(sizeof(*bitmap));
+	kflags = (stress_idle_page_cache_t *)malloc(sizeof(*kflags));
+	if (!bitmap || !kflags) {
+		pr_inf_skip("%s: cannot allocate working set size buffers, "
+			"skipping stressor\n", args->name);
+		free(kflags);
+		free(bitmap);
+		return EXIT_NO_RESOURCE;
+	}
+	bitmap->fd = fd;
+	kflags->fd = open(kpageflags_file, O_RDONLY);
+	if (kflags->fd < 0)
+		pr_inf("%s: cannot open %s, transparent huge pages will be "
+			"counted as referenced\n", args->name, kpageflags_file);
+
+	pr_inf("%s: sampling working set size of %s every %" PRIu32 " ms\n",
+		args->name, wss_pid ? "the given process" : "all stressors",
+		wss_interval_ms);
+
+	t_start = stress_time_now();
+	do {
+		size_t n_procs;
+
+		stress_idle_page_mark_all(fd);
+		(void)shim_usleep_interruptible((uint64_t)wss_interval_ms * 1000);
+		if (!stress_continue_flag())
+			break;
+
+		for (i = 0; i < n_wss; i++) {
+			wss[i].procs = 0;
+			wss[i].rss_pages = 0;
+			wss[i].wss_pages = 0;
+		}
+		bitmap->base = -1;
+		kflags->base = -1;
+
+		n_procs = stress_idle_page_procs(&procs, &procs_size);
+		for (i = 0; i < n_procs; i++) {
+			stress_idle_page_wss_t *w;
+			size_t n_pfns;
+
+			if (wss_pid) {
+				if (procs[i].pid != wss_pid)
+					continue;
+			} else if ((procs[i].pid == self) ||
+				   !stress_idle_page_descendant(procs, n_procs, procs[i].pid, parent)) {
+				continue;
+			}
+			w = stress_idle_page_wss_find(wss, &n_wss, procs[i].comm);
+			if (!w)
+				continue;
+
+			n_pfns = stress_idle_page_pfns(procs[i].pid, &pfns, &pfns_size);
+			qsort(pfns, n_pfns, sizeof(*pfns), stress_idle_page_pfn_cmp);
+			w->procs++;
+			w->rss_pages += n_pfns;
+			w->wss_pages += stress_idle_page_referenced(bitmap, kflags, pfns, n_pfns);
+		}
+
+		for (i = 0; i < n_wss; i++) {
+			stress_idle_page_wss_t *w = &wss[i];
+
+			if (!w->procs)
+				continue;
+			w->samples++;
+			w->wss_total_pages += (double)w->wss_pages;
+			if (w->rss_max_pages < w->rss_pages)
+				w->rss_max_pages = w->rss_pages;
+			if (w->wss_max_pages < w->wss_pages)
+				w->wss_max_pages = w->wss_pages;
+			pr_inf("%s: %8.2fs %-24s %3zu procs, rss %10.2f MB, wss %10.2f MB\n",
+				args->name, stress_time_now() - t_start, w->comm, w->procs,
+				(double)w->rss_pages * page_mb, (double)w->wss_pages * page_mb);
+		}
+		stress_bogo_inc(args);
+	} while (stress_continue(args));
+
+	if (n_wss) {
+		pr_block_begin();
+		pr_inf("%s: working set size summary:\n", args->name);
+		pr_inf("%s: %-24s %8s %14s %14s %14s\n", args->name,
+			"process", "samples", "max rss MB", "mean wss MB", "max wss MB");
+		for (i = 0; i < n_wss; i++) {
+			const stress_idle_page_wss_t *w = &wss[i];
+
+			if (!w->samples)
+				continue;
+			pr_inf("%s: %-24s %8" PRIu64 " %14.2f %14.2f %14.2f\n", args->name,
+				w->comm, w->samples, (double)w->rss_max_pages * page_mb,
+				(w->wss_total_pages / (double)w->samples) * page_mb,
+				(double)w->wss_max_pages * page_mb);
+		}
+		pr_block_end();
+	} else {
+		pr_inf("%s: no processes found to sample\n", args->name);
+	}
+
+	if (kflags->fd >= 0)
+		(void)close(kflags->fd);
+	free(pfns);
+	free(procs);
+	free(kflags);
+	free(bitmap);
+
+	return EXIT_SUCCESS;
+}
+
 /*
  *  stress_idle_page
  *	stress page scanning
@@ -70,6 +523,14 @@ static int stress_idle_page(stress_args_t *args)
 	int fd;
 	off_t posn = 0, last_posn = ~(off_t)7;
 	uint64_t bitmap_set[PAGES_TO_SCAN] ALIGNED(8);
+	bool idle_page_wss = false;
+	int32_t wss_pid = 0;
+	uint32_t wss_interval_ms = 1000;
+
+	(void)stress_get_setting("idle-page-wss", &idle_page_wss);
+	(void)stress_get_setting("idle-page-wss-interval", &wss_interval_ms);
+	if (stress_get_setting("idle-page-wss-pid", &wss_pid))
+		idle_page_wss = true;
 
 	fd = open(bitmap_file, O_RDWR);
 	if (fd < 0) {
@@ -85,6 +546,14 @@ static int stress_idle_page(stress_args_t *args)
 	stress_sync_start_wait(args);
 	stress_set_proc_state(args->name, STRESS_STATE_RUN);
 
+	if (idle_page_wss && (args->instance == 0)) {
+		const int rc = stress_idle_page_wss(args, fd, (pid_t)wss_pid, wss_interval_ms);
+
+		stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
+		(void)close(fd);
+		return rc;
+	}
+
 	do {
 		off_t oret;
 		ssize_t ret;
@@ -132,6 +601,7 @@ const stressor_info_t stress_idle_page_info = {
 	.stressor = stress_idle_page,
 	.supported = stress_idle_page_supported,
 	.class = CLASS_OS,
+	.opts = opts,
 	.help = help
 };
 #else
@@ -139,6 +609,7 @@ const stressor_info_t stress_idle_page_info = {
 	.stressor = stress_unimplemented,
 	.supported = stress_idle_page_supported,
 	.class = CLASS_OS,
+	.opts = opts,
 	.help = help,
 	.unimplemented_reason = "only supported on Linux"
 };
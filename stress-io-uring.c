@@ -19,6 +19,7 @@
  */
 #include "stress-ng.h"
 #include "core-builtin.h"
+#include "core-latency.h"
 #include "core-out-of-memory.h"
 #include "io-uring.h"
 
@@ -37,17 +38,46 @@
 #define MIN_IO_URING_ENTRIES	(1)
 #define MAX_IO_URING_ENTRIES	(16384)
 
+#define MIN_IO_URING_DEPTH	(0)
+#define MAX_IO_URING_DEPTH	(4096)
+
+#define MIN_IO_URING_BATCH	(1)
+#define MAX_IO_URING_BATCH	(4096)
+
+#define IO_URING_TASKRUN_DEFER	(0)
+#define IO_URING_TASKRUN_COOP	(1)
+#define IO_URING_TASKRUN_NONE	(2)
+
 static const stress_help_t help[] = {
 	{ NULL,	"io-uring N",		"start N workers that issue io-uring I/O requests" },
+	{ NULL,	"io-uring-batch N",	"submit N read/write requests per io_uring_enter call" },
+	{ NULL,	"io-uring-depth N",	"benchmark random read/write IOPS with N requests in flight" },
 	{ NULL, "io-uring-entries N",	"specify number if io-uring ring entries" },
+	{ NULL,	"io-uring-fixed",	"use registered buffers and files for read/write requests" },
 	{ NULL,	"io-uring-ops N",	"stop after N bogo io-uring I/O requests" },
 	{ NULL,	"io-uring-rand",	"enable randomized io-uring I/O request ordering" },
+	{ NULL,	"io-uring-sqpoll",	"use a kernel submission queue polling thread" },
+	{ NULL,	"io-uring-sqpoll-cpu N","bind the submission queue polling thread to CPU N" },
+	{ NULL,	"io-uring-taskrun M",	"completion task work mode, M = defer, coop or none" },
 	{ NULL,	NULL,			NULL }
 };
 
+static const char *stress_io_uring_taskrun(const size_t i)
+{
+	static const char * const modes[] = { "defer", "coop", "none" };
+
+	return (i < SIZEOF_ARRAY(modes)) ? modes[i] : NULL;
+}
+
 static const stress_opt_t opts[] = {
-	{ OPT_io_uring_entries, "io-uring-entries", TYPE_ID_UINT32, MIN_IO_URING_ENTRIES, MAX_IO_URING_ENTRIES, NULL },
-	{ OPT_io_uring_rand,    "io-uring-rand",    TYPE_ID_BOOL,   0, 1, NULL },
+	{ OPT_io_uring_batch,	   "io-uring-batch",	   TYPE_ID_UINT32, MIN_IO_URING_BATCH, MAX_IO_URING_BATCH, NULL },
+	{ OPT_io_uring_depth,	   "io-uring-depth",	   TYPE_ID_UINT32, MIN_IO_URING_DEPTH, MAX_IO_URING_DEPTH, NULL },
+	{ OPT_io_uring_entries,	   "io-uring-entries",	   TYPE_ID_UINT32, MIN_IO_URING_ENTRIES, MAX_IO_URING_ENTRIES, NULL },
+	{ OPT_io_uring_fixed,	   "io-uring-fixed",	   TYPE_ID_BOOL,   0, 1, NULL },
+	{ OPT_io_uring_rand,	   "io-uring-rand",	   TYPE_ID_BOOL,   0, 1, NULL },
+	{ OPT_io_uring_sqpoll,	   "io-uring-sqpoll",	   TYPE_ID_BOOL,   0, 1, NULL },
+	{ OPT_io_uring_sqpoll_cpu, "io-uring-sqpoll-cpu",  TYPE_ID_INT32,  0, INT32_MAX, NULL },
+	{ OPT_io_uring_taskrun,	   "io-uring-taskrun",	   TYPE_ID_SIZE_T_METHOD, 0, 0, stress_io_uring_taskrun },
 	END_OPT,
 };
 
@@ -126,6 +156,7 @@ typedef struct {
 	size_t cq_size;
 	size_t sqes_size;
 	size_t sqes_entries;
+	bool sqpoll;		/* kernel SQ polling thread submits */
 } stress_io_uring_submit_t;
 
 typedef struct {
@@ -172,6 +203,52 @@ static inline int shim_io_uring_enter(
 		min_complete, flags, NULL, 0);
 }
 
+#if defined(__NR_io_uring_register) &&		\
+    defined(HAVE_IORING_OP_READ_FIXED) &&	\
+    defined(HAVE_IORING_OP_WRITE_FIXED) &&	\
+    defined(IOSQE_FIXED_FILE)
+#define STRESS_IO_URING_FIXED
+
+/* register opcodes are enums in newer headers, so use the ABI values */
+#define STRESS_IORING_REGISTER_BUFFERS	(0)
+#define STRESS_IORING_REGISTER_FILES	(2)
+
+/*
+ *  shim_io_uring_register
+ *	wrapper for io_uring_register()
+ */
+static inline int shim_io_uring_register(
+	int fd,
+	unsigned int opcode,
+	void *arg,
+	unsigned int nr_args)
+{
+	return (int)syscall(__NR_io_uring_register, fd, opcode, arg, nr_args);
+}
+#endif
+
+/*
+ *  stress_io_uring_enter_flags()
+ *	add IORING_ENTER_SQ_WAKEUP to flags if the kernel
+ *	SQ polling thread has gone idle and needs waking
+ */
+static inline unsigned int stress_io_uring_enter_flags(
+	const stress_io_uring_submit_t *submit,
+	unsigned int flags)
+{
+#if defined(IORING_SQ_NEED_WAKEUP) &&	\
+    defined(IORING_ENTER_SQ_WAKEUP)
+	if (submit->sqpoll) {
+		stress_asm_mb();
+		if (*submit->sq_ring.flags & IORING_SQ_NEED_WAKEUP)
+			flags |= IORING_ENTER_SQ_WAKEUP;
+	}
+#else
+	(void)submit;
+#endif
+	return flags;
+}
+
 /*
  *  stress_io_uring_unmap_iovecs()
  *	free uring file iovecs
@@ -206,6 +283,9 @@ static void stress_io_uring_unmap_iovecs(stress_io_uring_file_t *io_uring_file)
 static int stress_setup_io_uring(
 	stress_args_t *args,
 	const uint32_t io_uring_entries,
+	const size_t io_uring_taskrun,
+	const bool io_uring_sqpoll,
+	const int32_t io_uring_sqpoll_cpu,
 	stress_io_uring_submit_t *submit)
 {
 	stress_uring_io_sq_ring_t *sring = &submit->sq_ring;
@@ -213,11 +293,44 @@ static int stress_setup_io_uring(
 	struct io_uring_params p;
 
 	(void)shim_memset(&p, 0, sizeof(p));
+	if (io_uring_sqpoll) {
+#if defined(IORING_SETUP_SQPOLL)
+		/* task run flags are not valid with SQPOLL */
+		p.flags = IORING_SETUP_SQPOLL;
+		p.sq_thread_idle = 1000;	/* ms */
+#if defined(IORING_SETUP_SQ_AFF)
+		if (io_uring_sqpoll_cpu >= 0) {
+			p.flags |= IORING_SETUP_SQ_AFF;
+			p.sq_thread_cpu = (uint32_t)io_uring_sqpoll_cpu;
+		}
+#else
+		(void)io_uring_sqpoll_cpu;
+#endif
+		submit->sqpoll = true;
+#else
+		pr_inf_skip("%s: io-uring SQPOLL not supported, skipping stressor\n", args->name);
+		return EXIT_NOT_IMPLEMENTED;
+#endif
+	} else {
+		(void)io_uring_sqpoll_cpu;
+
+		switch (io_uring_taskrun) {
+		case IO_URING_TASKRUN_NONE:
+			break;
+		case IO_URING_TASKRUN_COOP:
+#if defined(IORING_SETUP_COOP_TASKRUN)
+			p.flags = IORING_SETUP_COOP_TASKRUN;
+#endif
+			break;
+		default:
 #if defined(IORING_SETUP_COOP_TASKRUN) && 	\
     defined(IORING_SETUP_DEFER_TASKRUN) &&	\
     defined(IORING_SETUP_SINGLE_ISSUER)
-	p.flags = IORING_SETUP_COOP_TASKRUN | IORING_SETUP_DEFER_TASKRUN | IORING_SETUP_SINGLE_ISSUER;
+			p.flags = IORING_SETUP_COOP_TASKRUN | IORING_SETUP_DEFER_TASKRUN | IORING_SETUP_SINGLE_ISSUER;
 #endif
+			break;
+		}
+	}
 
 	/*
 	 *  16 is plenty, with too many we end up with lots of cache
@@ -229,7 +342,8 @@ static int stress_setup_io_uring(
 	if (submit->io_uring_fd < 0) {
 		switch (errno) {
 		case EPERM:
-			pr_inf_skip("%s: io-uring not permitted, skipping stressor\n", args->name);
+			pr_inf_skip("%s: io-uring%s not permitted, skipping stressor\n",
+				args->name, io_uring_sqpoll ? " SQPOLL" : "");
 			return EXIT_NOT_IMPLEMENTED;
 		case ENOSYS:
 			pr_inf_skip("%s: io-uring not supported by the kernel, skipping stressor\n", args->name);
@@ -239,9 +353,9 @@ static int stress_setup_io_uring(
 			return EXIT_NO_RESOURCE;
 		case EINVAL:
 			pr_inf_skip("%s: io-uring failed, EINVAL, possibly %"
-				PRIu32 " io-uring-entries too large, "
-				"skipping stressor\n",
-				args->name, io_uring_entries);
+				PRIu32 " io-uring-entries too large or setup "
+				"flags 0x%x not supported, skipping stressor\n",
+				args->name, io_uring_entries, p.flags);
 			return EXIT_NO_RESOURCE;
 		default:
 			break;
@@ -434,6 +548,7 @@ static int stress_io_uring_submit(
 	unsigned idx = 0, tail = 0, next_tail = 0;
 	struct io_uring_sqe *sqe;
 	int ret;
+	uint64_t t_lat;
 
 	next_tail = tail = *sring->tail;
 	next_tail++;
@@ -458,11 +573,13 @@ static int stress_io_uring_submit(
 		return EXIT_FAILURE;
 	}
 
+	/* enter waits for the completion, so this is submit to complete latency */
+	t_lat = stress_latency_begin(args);
 retry:
 	if (UNLIKELY(!stress_continue(args)))
 		return EXIT_NO_RESOURCE;
 	ret = shim_io_uring_enter(submit->io_uring_fd, 1,
-		1, IORING_ENTER_GETEVENTS);
+		1, stress_io_uring_enter_flags(submit, IORING_ENTER_GETEVENTS));
 	if (UNLIKELY(ret < 0)) {
 		if (errno == EBUSY) {
 			stress_io_uring_complete(args, submit);
@@ -479,6 +596,7 @@ retry:
 			user_data->supported = false;
 		return EXIT_FAILURE;
 	}
+	stress_latency_end(args, 0, t_lat);
 	stress_bogo_inc(args);
 	return EXIT_SUCCESS;
 }
@@ -1071,6 +1189,273 @@ static const char *stress_io_uring_opcode_name(const uint8_t opcode)
 	return "unknown";
 }
 
+#if defined(HAVE_IORING_OP_READ) &&	\
+    defined(HAVE_IORING_OP_WRITE)
+#define STRESS_IO_URING_BENCH
+
+#define STRESS_IO_URING_BENCH_BLOCK	(4096)
+#define STRESS_IO_URING_BENCH_FILE	(16 * MB)
+
+/*
+ *  stress_io_uring_reap()
+ *	reap read/write completions, freeing their request slots
+ *	and recording submit to completion latencies
+ */
+static int stress_io_uring_reap(
+	stress_args_t *args,
+	stress_io_uring_submit_t *submit,
+	const uint64_t *t_submit,
+	uint32_t *free_slots,
+	uint32_t *n_free,
+	stress_latency_hist_t *hist,
+	uint64_t *bytes)
+{
+	stress_uring_io_cq_ring_t *cring = &submit->cq_ring;
+	unsigned head = *cring->head;
+	int rc = EXIT_SUCCESS;
+
+	for (;;) {
+		const struct io_uring_cqe *cqe;
+		uint32_t slot;
+		uint64_t ns;
+
+		stress_asm_mb();
+		if (head == *cring->tail)
+			break;
+
+		cqe = &cring->cqes[head & *cring->ring_mask];
+		slot = (uint32_t)cqe->user_data;
+		ns = stress_latency_now() - t_submit[slot];
+		if (UNLIKELY(cqe->res < 0)) {
+			pr_fail("%s: read/write completion failed, error=%d (%s)\n",
+				args->name, -cqe->res, strerror(-cqe->res));
+			rc = EXIT_FAILURE;
+		} else {
+			*bytes += (uint64_t)cqe->res;
+		}
+		stress_latency_hist_record(hist, ns);
+		stress_latency_record(args, 0, ns);
+		free_slots[(*n_free)++] = slot;
+		stress_bogo_inc(args);
+		head++;
+	}
+	*cring->head = head;
+	stress_asm_mb();
+
+	return rc;
+}
+
+/*
+ *  stress_io_uring_bench()
+ *	keep depth 4K read/write requests in flight on a file, submitting
+ *	up to batch requests per io_uring_enter call, and report IOPS
+ *	and submit to completion latency percentiles
+ */
+static int stress_io_uring_bench(
+	stress_args_t *args,
+	stress_io_uring_submit_t *submit,
+	const char *filename,
+	const uint32_t depth,
+	const uint32_t batch,
+	const bool io_uring_fixed)
+{
+	stress_uring_io_sq_ring_t *sring = &submit->sq_ring;
+	const size_t block_size = STRESS_IO_URING_BENCH_BLOCK;
+	const uint64_t blocks = STRESS_IO_URING_BENCH_FILE / block_size;
+	const size_t bufs_size = (size_t)depth * block_size;
+	uint8_t *bufs;
+	uint64_t *t_submit = NULL, i, block = 0, bytes = 0, completions;
+	uint32_t *free_slots = NULL, n_free;
+	stress_latency_hist_t *hist = NULL;
+	int fd, rc = EXIT_SUCCESS;
+	uint8_t sqe_flags = 0;
+	bool fixed_buffers = false, fixed_files = false;
+	double t_start, duration, rate;
+
+#if defined(O_DIRECT)
+	fd = open(filename, O_CREAT | O_RDWR | O_TRUNC | O_DIRECT, S_IRUSR | S_IWUSR);
+	if ((fd < 0) && (errno == EINVAL))
+#endif
+		fd = open(filename, O_CREAT | O_RDWR | O_TRUNC, S_IRUSR | S_IWUSR);
+	if (fd < 0) {
+		rc = stress_exit_status(errno);
+		pr_fail("%s: open on %s failed, errno=%d (%s)\n",
+			args->name, filename, errno, strerror(errno));
+		return rc;
+	}
+
+	bufs = (uint8_t *)stress_mmap_populate(NULL, bufs_size, PROT_READ | PROT_WRITE,
+		MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (bufs == MAP_FAILED) {
+		pr_inf_skip("%s: cannot mmap %zu bytes of I/O buffers, errno=%d (%s), "
+			"skipping stressor\n", args->name, bufs_size,
+			errno, strerror(errno));
+		(void)close(fd);
+		return EXIT_NO_RESOURCE;
+	}
+	stress_set_vma_anon_name(bufs, bufs_size, "io-uring-buffers");
+	stress_rndbuf(bufs, bufs_size);
+
+	t_submit = (uint64_t *)calloc(depth, sizeof(*t_submit));
+	free_slots = (uint32_t *)calloc(depth, sizeof(*free_slots));
+	hist = (stress_latency_hist_t *)malloc(sizeof(*hist));
+	if (!t_submit || !free_slots || !hist) {
+		pr_inf_skip("%s: cannot allocate %" PRIu32 " request slots, "
+			"skipping stressor\n", args->name, depth);
+		rc = EXIT_NO_RESOURCE;
+		goto tidy;
+	}
+	stress_latency_hist_init(hist);
+
+	/* lay the file out so reads are not satisfied from holes */
+	for (i = 0; i < blocks; i++) {
+		if (pwrite(fd, bufs, block_size, (off_t)(i * block_size)) < 0) {
+			if ((errno == ENOSPC) || (errno == EDQUOT)) {
+				pr_inf_skip("%s: out of space writing %s, skipping stressor\n",
+					args->name, filename);
+				rc = EXIT_NO_RESOURCE;
+			} else {
+				rc = stress_exit_status(errno);
+				pr_fail("%s: pwrite on %s failed, errno=%d (%s)\n",
+					args->name, filename, errno, strerror(errno));
+			}
+			goto tidy;
+		}
+		if (UNLIKELY(!stress_continue_flag()))
+			goto tidy;
+	}
+
+#if defined(STRESS_IO_URING_FIXED)
+	if (io_uring_fixed) {
+		struct iovec *iovecs;
+		int fds[1];
+
+		iovecs = (struct iovec *)calloc(depth, sizeof(*iovecs));
+		if (iovecs) {
+			for (i = 0; i < depth; i++) {
+				iovecs[i].iov_base = bufs + (i * block_size);
+				iovecs[i].iov_len = block_size;
+			}
+			fixed_buffers = (shim_io_uring_register(submit->io_uring_fd,
+				STRESS_IORING_REGISTER_BUFFERS, iovecs, depth) == 0);
+			free(iovecs);
+		}
+		fds[0] = fd;
+		fixed_files = (shim_io_uring_register(submit->io_uring_fd,
+			STRESS_IORING_REGISTER_FILES, fds, 1) == 0);
+		if (fixed_files)
+			sqe_flags = IOSQE_FIXED_FILE;
+		if ((args->instance == 0) && (!fixed_buffers || !fixed_files))
+			pr_inf("%s: cannot register %s%s%s, using unregistered I/O\n",
+				args->name, fixed_buffers ? "" : "buffers",
+				(fixed_buffers || fixed_files) ? "" : " and ",
+				fixed_files ? "" : "files");
+	}
+#else
+	if (io_uring_fixed && (args->instance == 0))
+		pr_inf("%s: registered buffers and files not supported, "
+			"using unregistered I/O\n", args->name);
+#endif
+	for (n_free = 0; n_free < depth; n_free++)
+		free_slots[n_free] = n_free;
+
+	completions = stress_bogo_get(args);
+	t_start = stress_time_now();
+	do {
+		unsigned int tail = *sring->tail, head, to_submit = 0, min_complete, flags;
+		int ret;
+
+		stress_asm_mb();
+		head = *sring->head;
+		while ((n_free > 0) && (to_submit < batch) &&
+		       ((tail - head) < *sring->ring_entries)) {
+			const uint32_t slot = free_slots[--n_free];
+			const unsigned int idx = tail & *sring->ring_mask;
+			struct io_uring_sqe *sqe = &submit->sqes_mmap[idx];
+			const bool rd = stress_mwc1();
+
+			(void)shim_memset(sqe, 0, sizeof(*sqe));
+#if defined(STRESS_IO_URING_FIXED)
+			if (fixed_buffers) {
+				sqe->opcode = rd ? IORING_OP_READ_FIXED : IORING_OP_WRITE_FIXED;
+				sqe->buf_index = (uint16_t)slot;
+			} else
+#endif
+			{
+				sqe->opcode = rd ? IORING_OP_READ : IORING_OP_WRITE;
+			}
+			sqe->fd = fixed_files ? 0 : fd;
+			sqe->flags = sqe_flags;
+			sqe->addr = (uintptr_t)(bufs + ((size_t)slot * block_size));
+			sqe->len = (uint32_t)block_size;
+			sqe->off = (io_uring_rand ? stress_mwc64modn(blocks) : (block++ % blocks)) * block_size;
+			sqe->user_data = (uint64_t)slot;
+			sring->array[idx] = idx;
+			t_submit[slot] = stress_latency_now();
+			tail++;
+			to_submit++;
+		}
+		stress_asm_mb();
+		*sring->tail = tail;
+		stress_asm_mb();
+
+		/* wait for a completion when all the request slots are in flight */
+		min_complete = (n_free == 0) ? 1 : 0;
+		flags = stress_io_uring_enter_flags(submit, IORING_ENTER_GETEVENTS);
+		if (submit->sqpoll && !min_complete && !(flags & ~IORING_ENTER_GETEVENTS)) {
+			/* SQ thread is busy submitting, just poll for completions */
+			ret = 0;
+		} else {
+			ret = shim_io_uring_enter(submit->io_uring_fd,
+				submit->sqpoll ? 0 : to_submit, min_complete, flags);
+		}
+		if (UNLIKELY(ret < 0)) {
+			if ((errno != EINTR) && (errno != EAGAIN) && (errno != EBUSY)) {
+				pr_fail("%s: io_uring_enter failed, errno=%d (%s)\n",
+					args->name, errno, strerror(errno));
+				rc = EXIT_FAILURE;
+				break;
+			}
+		}
+		if (stress_io_uring_reap(args, submit, t_submit, free_slots, &n_free, hist, &bytes) != EXIT_SUCCESS) {
+			rc = EXIT_FAILURE;
+			break;
+		}
+	} while (stress_continue(args));
+	duration = stress_time_now() - t_start;
+	completions = stress_bogo_get(args) - completions;
+
+	/* drain in flight requests before the buffers are unmapped */
+	for (i = 0; (n_free < depth) && (i < 1000); i++) {
+		if (shim_io_uring_enter(submit->io_uring_fd, 0, 1,
+			stress_io_uring_enter_flags(submit, IORING_ENTER_GETEVENTS)) < 0) {
+			if ((errno != EINTR) && (errno != EAGAIN) && (errno != EBUSY))
+				break;
+		}
+		(void)stress_io_uring_reap(args, submit, t_submit, free_slots, &n_free, hist, &bytes);
+	}
+
+	rate = (duration > 0.0) ? (double)completions / duration : 0.0;
+	stress_metrics_set(args, 0, "IOPS", rate, STRESS_METRIC_HARMONIC_MEAN);
+	rate = (duration > 0.0) ? (double)bytes / (duration * (double)MB) : 0.0;
+	stress_metrics_set(args, 1, "MB per sec", rate, STRESS_METRIC_HARMONIC_MEAN);
+	stress_metrics_set(args, 2, "usec p50 completion latency",
+		(double)stress_latency_hist_percentile(hist, 50.0) / 1000.0, STRESS_METRIC_GEOMETRIC_MEAN);
+	stress_metrics_set(args, 3, "usec p99 completion latency",
+		(double)stress_latency_hist_percentile(hist, 99.0) / 1000.0, STRESS_METRIC_GEOMETRIC_MEAN);
+	stress_metrics_set(args, 4, "usec p99.9 completion latency",
+		(double)stress_latency_hist_percentile(hist, 99.9) / 1000.0, STRESS_METRIC_GEOMETRIC_MEAN);
+tidy:
+	free(hist);
+	free(free_slots);
+	free(t_submit);
+	(void)munmap((void *)bufs, bufs_size);
+	(void)close(fd);
+
+	return rc;
+}
+#endif
+
 /*
  *  stress_io_uring
  *	stress asynchronous I/O
@@ -1090,6 +1475,10 @@ static int stress_io_uring_child(stress_args_t *args, void *context)
 	stress_io_uring_user_data_t user_data[SIZEOF_ARRAY(stress_io_uring_setups)];
 	const int32_t cpus = stress_get_processors_online();
 	int flags;
+	uint32_t io_uring_depth = 0, io_uring_batch = 0;
+	int32_t io_uring_sqpoll_cpu = -1;
+	size_t io_uring_taskrun = IO_URING_TASKRUN_DEFER;
+	bool io_uring_fixed = false, io_uring_sqpoll = false;
 
 	(void)context;
 
@@ -1112,6 +1501,37 @@ static int stress_io_uring_child(stress_args_t *args, void *context)
 			io_uring_entries = MIN_IO_URING_ENTRIES;
 	}
 	(void)stress_get_setting("io-uring-rand", &io_uring_rand);
+	(void)stress_get_setting("io-uring-depth", &io_uring_depth);
+	(void)stress_get_setting("io-uring-batch", &io_uring_batch);
+	(void)stress_get_setting("io-uring-fixed", &io_uring_fixed);
+	(void)stress_get_setting("io-uring-sqpoll", &io_uring_sqpoll);
+	(void)stress_get_setting("io-uring-sqpoll-cpu", &io_uring_sqpoll_cpu);
+	if (stress_get_setting("io-uring-taskrun", &io_uring_taskrun) &&
+	    io_uring_sqpoll && (args->instance == 0))
+		pr_inf("%s: --io-uring-taskrun is ignored with --io-uring-sqpoll\n",
+			args->name);
+	if ((io_uring_sqpoll_cpu >= 0) && !io_uring_sqpoll && (args->instance == 0))
+		pr_inf("%s: --io-uring-sqpoll-cpu is ignored without --io-uring-sqpoll\n",
+			args->name);
+
+#if defined(STRESS_IO_URING_BENCH)
+	if (io_uring_depth > 0) {
+		/* the submission queue must hold all the requests in flight */
+		if (io_uring_entries < io_uring_depth)
+			io_uring_entries = io_uring_depth;
+		if ((io_uring_batch == 0) || (io_uring_batch > io_uring_depth))
+			io_uring_batch = io_uring_depth;
+		stress_latency_set_description(args, 0, "io-uring completion");
+	} else
+#else
+	if ((io_uring_depth > 0) && (args->instance == 0))
+		pr_inf("%s: --io-uring-depth requires IORING_OP_READ and "
+			"IORING_OP_WRITE, ignoring option\n", args->name);
+	io_uring_depth = 0;
+#endif
+	{
+		stress_latency_set_description(args, 0, "io-uring round-trip");
+	}
 
 	(void)shim_memset(&submit, 0, sizeof(submit));
 	(void)shim_memset(&io_uring_file, 0, sizeof(io_uring_file));
@@ -1165,7 +1585,8 @@ static int stress_io_uring_child(stress_args_t *args, void *context)
 
 	io_uring_file.filename = filename;
 
-	rc = stress_setup_io_uring(args, io_uring_entries, &submit);
+	rc = stress_setup_io_uring(args, io_uring_entries, io_uring_taskrun,
+		io_uring_sqpoll, io_uring_sqpoll_cpu, &submit);
 	if (rc != EXIT_SUCCESS)
 		goto clean;
 
@@ -1176,6 +1597,17 @@ static int stress_io_uring_child(stress_args_t *args, void *context)
 	stress_sync_start_wait(args);
 	stress_set_proc_state(args->name, STRESS_STATE_RUN);
 
+#if defined(STRESS_IO_URING_BENCH)
+	if (io_uring_depth > 0) {
+		rc = stress_io_uring_bench(args, &submit, filename, io_uring_depth,
+			io_uring_batch, io_uring_fixed);
+		goto clean;
+	}
+#endif
+	if (io_uring_fixed && (args->instance == 0))
+		pr_inf("%s: --io-uring-fixed is only used with --io-uring-depth\n",
+			args->name);
+
 	/*
 	 *  Assume all opcodes are supported
 	 */
@@ -1251,6 +1683,7 @@ const stressor_info_t stress_io_uring_info = {
 	.class = CLASS_IO | CLASS_OS,
 	.opts = opts,
 	.verify = VERIFY_ALWAYS,
+	.metrics_max = 5,
 	.help = help
 };
 #else
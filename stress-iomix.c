@@ -20,6 +20,7 @@
 #include "stress-ng.h"
 #include "core-builtin.h"
 #include "core-killpid.h"
+#include "core-latency.h"
 #include "core-put.h"
 
 #include <sys/ioctl.h>
@@ -41,6 +42,7 @@ static const stress_help_t help[] = {
 	{ NULL,	"iomix N",	 "start N workers that have a mix of I/O operations" },
 	{ NULL,	"iomix-bytes N", "write N bytes per iomix worker (default is 1GB)" },
 	{ NULL,	"iomix-ops N",	 "stop iomix workers after N iomix bogo operations" },
+	{ NULL,	"iomix-profile P", "run weighted op:weight[:size] profile, e.g. read:60,write:30,fsync:10" },
 	{ NULL, NULL,		 NULL }
 };
 
@@ -1028,6 +1030,274 @@ static void stress_iomix_cachestat(
 }
 #endif
 
+/*
+ *  --iomix-profile weighted I/O operations
+ */
+#define IOMIX_PROFILE_BLOCK_DEFAULT	(4 * KB)
+#define IOMIX_PROFILE_BLOCK_MAX		(MIN_IOMIX_BYTES)
+
+typedef enum {
+	IOMIX_OP_READ,		/* random pread */
+	IOMIX_OP_WRITE,		/* random pwrite */
+	IOMIX_OP_SEQREAD,	/* sequential pread */
+	IOMIX_OP_SEQWRITE,	/* sequential pwrite */
+	IOMIX_OP_FSYNC,		/* fsync */
+	IOMIX_OP_FDATASYNC,	/* fdatasync */
+	IOMIX_OP_READAHEAD,	/* random posix_fadvise WILLNEED */
+	IOMIX_OP_MAX,
+} stress_iomix_op_t;
+
+static const char * const iomix_op_names[IOMIX_OP_MAX] = {
+	"read",
+	"write",
+	"seqread",
+	"seqwrite",
+	"fsync",
+	"fdatasync",
+	"readahead",
+};
+
+typedef struct {
+	uint32_t weight[IOMIX_OP_MAX];	/* relative weight of each op */
+	size_t block[IOMIX_OP_MAX];	/* I/O size of each op */
+	uint32_t total;			/* sum of weights */
+} stress_iomix_profile_t;
+
+/*
+ *  stress_iomix_profile_parse()
+ *	parse a op:weight[:block size] comma separated profile,
+ *	returns -1 and reports why if it is invalid
+ */
+static int stress_iomix_profile_parse(
+	const char *opt_name,
+	const char *opt_arg,
+	stress_iomix_profile_t *profile)
+{
+	char *str, *ptr, *token, *saveptr = NULL;
+	int ret = -1;
+
+	(void)shim_memset(profile, 0, sizeof(*profile));
+	str = strdup(opt_arg);
+	if (!str) {
+		(void)fprintf(stderr, "%s option: cannot dup string '%s'\n", opt_name, opt_arg);
+		return -1;
+	}
+
+	for (ptr = str; (token = strtok_r(ptr, ",", &saveptr)) != NULL; ptr = NULL) {
+		char *weight_str, *block_str, *end;
+		unsigned long int weight;
+		uint64_t block = IOMIX_PROFILE_BLOCK_DEFAULT;
+		size_t i;
+
+		weight_str = strchr(token, ':');
+		if (!weight_str) {
+			(void)fprintf(stderr, "%s option '%s' needs a weight, e.g. %s:10\n",
+				opt_name, token, token);
+			goto err;
+		}
+		*weight_str++ = '\0';
+		block_str = strchr(weight_str, ':');
+		if (block_str) {
+			*block_str++ = '\0';
+			block = stress_get_uint64_byte(block_str);
+			if ((block < 1) || (block > IOMIX_PROFILE_BLOCK_MAX)) {
+				(void)fprintf(stderr, "%s option '%s' block size must be 1 to %d bytes\n",
+					opt_name, token, (int)IOMIX_PROFILE_BLOCK_MAX);
+				goto err;
+			}
+		}
+		errno = 0;
+		weight = strtoul(weight_str, &end, 10);
+		if (errno || (*end != '\0') || (weight < 1) || (weight > 1000000)) {
+			(void)fprintf(stderr, "%s option '%s' weight '%s' must be 1 to 1000000\n",
+				opt_name, token, weight_str);
+			goto err;
+		}
+		for (i = 0; i < IOMIX_OP_MAX; i++) {
+			if (!strcmp(token, iomix_op_names[i]))
+				break;
+		}
+		if (i == IOMIX_OP_MAX) {
+			(void)fprintf(stderr, "%s option '%s' not known, operations are:", opt_name, token);
+			for (i = 0; i < IOMIX_OP_MAX; i++)
+				(void)fprintf(stderr, " %s", iomix_op_names[i]);
+			(void)fprintf(stderr, "\n");
+			goto err;
+		}
+		profile->total -= profile->weight[i];
+		profile->weight[i] = (uint32_t)weight;
+		profile->block[i] = (size_t)block;
+		profile->total += (uint32_t)weight;
+	}
+	if (profile->total == 0) {
+		(void)fprintf(stderr, "%s option '%s' has no operations\n", opt_name, opt_arg);
+		goto err;
+	}
+	ret = 0;
+err:
+	free(str);
+	return ret;
+}
+
+/*
+ *  stress_iomix_profile()
+ *	validate and save the --iomix-profile option
+ */
+static void stress_iomix_profile(const char *opt_name, const char *opt_arg, stress_type_id_t *type_id, void *value)
+{
+	stress_iomix_profile_t profile;
+
+	(void)type_id;
+	(void)value;
+
+	if (stress_iomix_profile_parse(opt_name, opt_arg, &profile) < 0)
+		longjmp(g_error_env, 1);
+	stress_set_setting("iomix", "iomix-profile", TYPE_ID_STR, opt_arg);
+}
+
+/*
+ *  stress_iomix_profile_op()
+ *	perform one profile operation, returns -1 on failure
+ */
+static int stress_iomix_profile_op(
+	const int fd,
+	const stress_iomix_op_t op,
+	const size_t block,
+	uint8_t *buffer,
+	off_t *seq_posn,
+	const off_t iomix_bytes)
+{
+	const off_t range = iomix_bytes - (off_t)block;
+	off_t posn;
+
+	switch (op) {
+	case IOMIX_OP_READ:
+		posn = stress_iomix_rnd_offset(range + 1);
+		return (pread(fd, buffer, block, posn) < 0) ? -1 : 0;
+	case IOMIX_OP_WRITE:
+		posn = stress_iomix_rnd_offset(range + 1);
+		return (pwrite(fd, buffer, block, posn) < 0) ? -1 : 0;
+	case IOMIX_OP_SEQREAD:
+	case IOMIX_OP_SEQWRITE:
+		posn = seq_posn[op];
+		if (posn > range)
+			posn = 0;
+		seq_posn[op] = posn + (off_t)block;
+		if (op == IOMIX_OP_SEQREAD)
+			return (pread(fd, buffer, block, posn) < 0) ? -1 : 0;
+		return (pwrite(fd, buffer, block, posn) < 0) ? -1 : 0;
+	case IOMIX_OP_FSYNC:
+		return shim_fsync(fd);
+	case IOMIX_OP_FDATASYNC:
+		return shim_fdatasync(fd);
+	case IOMIX_OP_READAHEAD:
+#if defined(HAVE_POSIX_FADVISE) &&	\
+    defined(POSIX_FADV_WILLNEED)
+		posn = stress_iomix_rnd_offset(range + 1);
+		return (posix_fadvise(fd, posn, (off_t)block, POSIX_FADV_WILLNEED) != 0) ? -1 : 0;
+#else
+		return 0;
+#endif
+	default:
+		break;
+	}
+	return 0;
+}
+
+/*
+ *  stress_iomix_profile_run()
+ *	run the weighted profile of I/O operations on fd, timing each
+ *	operation into a per operation latency histogram
+ */
+static int stress_iomix_profile_run(
+	stress_args_t *args,
+	const int fd,
+	const stress_iomix_profile_t *profile,
+	const off_t iomix_bytes)
+{
+	stress_latency_hist_t *hists;
+	uint8_t *buffer;
+	size_t i, block_max = 1;
+	off_t seq_posn[IOMIX_OP_MAX];
+	double t_start, duration;
+	int rc = EXIT_SUCCESS;
+
+	for (i = 0; i < IOMIX_OP_MAX; i++) {
+		seq_posn[i] = 0;
+		if (profile->weight[i] && (profile->block[i] > block_max))
+			block_max = profile->block[i];
+	}
+	hists = (stress_latency_hist_t *)malloc(IOMIX_OP_MAX * sizeof(*hists));
+	buffer = (uint8_t *)malloc(block_max);
+	if (!hists || !buffer) {
+		pr_inf_skip("%s: cannot allocate I/O profile buffers, skipping stressor\n",
+			args->name);
+		free(buffer);
+		free(hists);
+		return EXIT_NO_RESOURCE;
+	}
+	for (i = 0; i < IOMIX_OP_MAX; i++)
+		stress_latency_hist_init(&hists[i]);
+	for (i = 0; i < block_max; i++)
+		buffer[i] = stress_mwc8();
+	stress_latency_set_description(args, 0, "iomix profile op");
+
+	stress_set_proc_state(args->name, STRESS_STATE_SYNC_WAIT);
+	stress_sync_start_wait(args);
+	stress_set_proc_state(args->name, STRESS_STATE_RUN);
+
+	t_start = stress_time_now();
+	do {
+		uint32_t r = stress_mwc32modn(profile->total);
+		stress_iomix_op_t op;
+		uint64_t t0, ns;
+
+		for (op = IOMIX_OP_READ; op < IOMIX_OP_MAX - 1; op++) {
+			if (r < profile->weight[op])
+				break;
+			r -= profile->weight[op];
+		}
+		t0 = stress_latency_now();
+		if (UNLIKELY(stress_iomix_profile_op(fd, op, profile->block[op],
+				buffer, seq_posn, iomix_bytes) < 0)) {
+			if ((errno == EINTR) || (errno == ENOSPC))
+				continue;
+			pr_fail("%s: %s failed, errno=%d (%s)\n",
+				args->name, iomix_op_names[op], errno, strerror(errno));
+			rc = EXIT_FAILURE;
+			break;
+		}
+		ns = stress_latency_now() - t0;
+		stress_latency_hist_record(&hists[op], ns);
+		stress_latency_record(args, 0, ns);
+		stress_bogo_inc(args);
+	} while (stress_continue(args));
+	duration = stress_time_now() - t_start;
+
+	for (i = 0; i < IOMIX_OP_MAX; i++) {
+		char msg[64];
+
+		if (!hists[i].count)
+			continue;
+		(void)snprintf(msg, sizeof(msg), "%s ops per sec", iomix_op_names[i]);
+		stress_metrics_set(args, (3 * i), msg,
+			(duration > 0.0) ? (double)hists[i].count / duration : 0.0,
+			STRESS_METRIC_HARMONIC_MEAN);
+		(void)snprintf(msg, sizeof(msg), "usec p50 %s latency", iomix_op_names[i]);
+		stress_metrics_set(args, (3 * i) + 1, msg,
+			(double)stress_latency_hist_percentile(&hists[i], 50.0) / 1000.0,
+			STRESS_METRIC_HARMONIC_MEAN);
+		(void)snprintf(msg, sizeof(msg), "usec p99 %s latency", iomix_op_names[i]);
+		stress_metrics_set(args, (3 * i) + 2, msg,
+			(double)stress_latency_hist_percentile(&hists[i], 99.0) / 1000.0,
+			STRESS_METRIC_MAXIMUM);
+	}
+	free(buffer);
+	free(hists);
+
+	return rc;
+}
+
 static stress_iomix_func iomix_funcs[] = {
 	stress_iomix_wr_seq_bursts,
 	stress_iomix_wr_rnd_bursts,
@@ -1081,6 +1351,8 @@ static int stress_iomix(stress_args_t *args)
 	const char *fs_type;
 	int oflags = O_CREAT | O_RDWR;
 	bool iomix_bytes_shrunk = false;
+	char *iomix_profile = NULL;
+	stress_iomix_profile_t profile;
 
 	if (stress_sigchld_set_handler(args) < 0)
 		return EXIT_NO_RESOURCE;
@@ -1091,8 +1363,15 @@ static int stress_iomix(stress_args_t *args)
 		return EXIT_NO_RESOURCE;
 	}
 
+	(void)stress_get_setting("iomix-profile", &iomix_profile);
+	if (iomix_profile &&
+	    (stress_iomix_profile_parse("iomix-profile", iomix_profile, &profile) < 0))
+		iomix_profile = NULL;
+
 #if defined(O_SYNC)
-	oflags |= O_SYNC;
+	/* a profile syncs explicitly with its fsync and fdatasync weights */
+	if (!iomix_profile)
+		oflags |= O_SYNC;
 #endif
 
 	counter_lock = stress_lock_create("counter");
@@ -1166,6 +1445,11 @@ static int stress_iomix(stress_args_t *args)
 
 	stress_file_rw_hint_short(fd);
 
+	if (iomix_profile) {
+		ret = stress_iomix_profile_run(args, fd, &profile, iomix_bytes);
+		goto tidy;
+	}
+
 	for (i = 0; i < MAX_IOMIX_PROCS; i++) {
 		stress_sync_start_init(&s_pids[i]);
 
@@ -1212,6 +1496,7 @@ tidy_s_pids:
 
 static const stress_opt_t opts[] = {
 	{ OPT_iomix_bytes, "iomix-bytes", TYPE_ID_OFF_T, MIN_IOMIX_BYTES, MAX_IOMIX_BYTES, NULL },
+	{ OPT_iomix_profile, "iomix-profile", TYPE_ID_CALLBACK, 0, 0, stress_iomix_profile },
 	END_OPT,
 };
 
@@ -1220,5 +1505,6 @@ const stressor_info_t stress_iomix_info = {
 	.class = CLASS_FILESYSTEM | CLASS_OS,
 	.opts = opts,
 	.verify = VERIFY_ALWAYS,
+	.metrics_max = 3 * IOMIX_OP_MAX,
 	.help = help
 };
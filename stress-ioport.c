@@ -319,6 +319,7 @@ const stressor_info_t stress_ioport_info = {
 	.class = CLASS_CPU,
 	.opts = opts,
 	.verify = VERIFY_ALWAYS,
+	.metrics_max = 2,
 	.help = help
 };
 #else
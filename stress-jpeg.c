@@ -19,6 +19,8 @@
 #include "stress-ng.h"
 #include "core-builtin.h"
 #include "core-pragma.h"
+#include "core-latency.h"
+#include "core-pthread.h"
 
 #include <math.h>
 
@@ -42,6 +44,13 @@
 #define MIN_JPEG_QUALITY	(1)
 #define MAX_JPEG_QUALITY	(100)
 
+#define MIN_JPEG_PIPELINE	(0)
+#define MAX_JPEG_PIPELINE	(256)
+
+#define MIN_JPEG_PRODUCERS	(1)
+#define MAX_JPEG_PRODUCERS	(64)
+#define DEFAULT_JPEG_PRODUCERS	(2)
+
 typedef struct {
 	const char *name;
 	const int  type;
@@ -52,6 +61,8 @@ static const stress_help_t help[] = {
 	{ NULL,	"jpeg-height N",	"image height in pixels "},
 	{ NULL,	"jpeg-image type",	"image type: one of brown, flat, gradient, noise, plasma or xstripes" },
 	{ NULL,	"jpeg-ops N",		"stop after N jpeg bogo no-op operations" },
+	{ NULL,	"jpeg-pipeline N",	"encode frames on N threads fed by image producer threads" },
+	{ NULL,	"jpeg-producers N",	"number of image producer threads in pipeline mode" },
 	{ NULL,	"jpeg-quality Q",	"compression quality 1 (low) .. 100 (high)" },
 	{ NULL,	"jpeg-width N",		"image width in pixels "},
 	{ NULL,	NULL,			NULL }
@@ -72,10 +83,12 @@ static const char *stress_jpeg_image(const size_t i)
 }
 
 static const stress_opt_t opts[] = {
-	{ OPT_jpeg_height,  "jpeg-height",   TYPE_ID_INT32, MIN_JPEG_HEIGHT, MAX_JPEG_HEIGHT, NULL },
-	{ OPT_jpeg_image,   "jpeg-image",    TYPE_ID_SIZE_T_METHOD, 0, 0, stress_jpeg_image },
-	{ OPT_jpeg_width,   "jpeg-width",    TYPE_ID_INT32, MIN_JPEG_WIDTH, MAX_JPEG_WIDTH, NULL },
-	{ OPT_jpeg_quality, "jpeg-quality",  TYPE_ID_INT32, MIN_JPEG_QUALITY, MAX_JPEG_QUALITY, NULL },
+	{ OPT_jpeg_height,    "jpeg-height",    TYPE_ID_INT32, MIN_JPEG_HEIGHT, MAX_JPEG_HEIGHT, NULL },
+	{ OPT_jpeg_image,     "jpeg-image",     TYPE_ID_SIZE_T_METHOD, 0, 0, stress_jpeg_image },
+	{ OPT_jpeg_pipeline,  "jpeg-pipeline",  TYPE_ID_UINT32, MIN_JPEG_PIPELINE, MAX_JPEG_PIPELINE, NULL },
+	{ OPT_jpeg_producers, "jpeg-producers", TYPE_ID_UINT32, MIN_JPEG_PRODUCERS, MAX_JPEG_PRODUCERS, NULL },
+	{ OPT_jpeg_width,     "jpeg-width",     TYPE_ID_INT32, MIN_JPEG_WIDTH, MAX_JPEG_WIDTH, NULL },
+	{ OPT_jpeg_quality,   "jpeg-quality",   TYPE_ID_INT32, MIN_JPEG_QUALITY, MAX_JPEG_QUALITY, NULL },
 	END_OPT,
 };
 
@@ -244,6 +257,39 @@ static void OPTIMIZE3 stress_rgb_flat(
 	}
 }
 
+/*
+ *  stress_rgb_generate()
+ *	generate an RGB image of the given jpeg image type
+ */
+static void stress_rgb_generate(
+	uint8_t		*rgb,
+	const int32_t	x_max,
+	const int32_t	y_max,
+	const size_t	jpeg_image)
+{
+	switch (jpeg_image_types[jpeg_image].type) {
+	default:
+	case JPEG_IMAGE_PLASMA:
+		stress_rgb_plasma(rgb, x_max, y_max);
+		break;
+	case JPEG_IMAGE_NOISE:
+		stress_rgb_noise(rgb, x_max, y_max);
+		break;
+	case JPEG_IMAGE_GRADIENT:
+		stress_rgb_gradient(rgb, x_max, y_max);
+		break;
+	case JPEG_IMAGE_XSTRIPES:
+		stress_rgb_xstripes(rgb, x_max, y_max);
+		break;
+	case JPEG_IMAGE_FLAT:
+		stress_rgb_flat(rgb, x_max, y_max);
+		break;
+	case JPEG_IMAGE_BROWN:
+		stress_rgb_brown(rgb, x_max, y_max);
+		break;
+	}
+}
+
 #if defined(HAVE_OPEN_MEMSTREAM)
 /*
  *  stress_jpeg_checksum_data()
@@ -342,6 +388,450 @@ PRAGMA_UNROLL_N(8)
 	return (int)size;
 }
 
+#if defined(HAVE_LIB_PTHREAD)
+/*
+ *  Pipeline mode, jpeg_producers threads generate frames into a fixed
+ *  pool of preallocated frame slots and jpeg_pipeline encoder threads
+ *  compress them into per-slot preallocated output buffers. Slots are
+ *  passed between the threads through two bounded index rings, the
+ *  free ring and the ready ring, so there are no per-frame allocations.
+ */
+typedef struct {
+	uint8_t		*rgb;		/* RGB frame data */
+	uint8_t		*jpeg;		/* compressed output buffer */
+	size_t		jpeg_len;	/* compressed size */
+	uint64_t	t_ready;	/* time frame was queued, ns */
+} stress_jpeg_frame_t;
+
+typedef struct {
+	size_t		*idx;		/* ring of frame slot indices */
+	size_t		head;		/* index of oldest entry */
+	size_t		count;		/* entries in the ring */
+} stress_jpeg_ring_t;
+
+typedef struct {
+	pthread_mutex_t	lock;		/* protects rings, stop and frames */
+	pthread_cond_t	ready_cond;	/* signalled when a frame is ready */
+	pthread_cond_t	free_cond;	/* signalled when a slot is free */
+	stress_jpeg_ring_t ready;	/* frames waiting to be encoded */
+	stress_jpeg_ring_t free;	/* slots waiting to be filled */
+	stress_jpeg_frame_t *frames;	/* frame slots */
+	size_t		slots;		/* number of frame slots */
+	size_t		out_size;	/* size of each output buffer */
+	size_t		jpeg_image;	/* image type */
+	int32_t		x_max;		/* image width */
+	int32_t		y_max;		/* image height */
+	int32_t		quality;	/* jpeg quality */
+	uint64_t	frames_done;	/* total frames encoded */
+	bool		stop;		/* true to terminate threads */
+	bool		verify;		/* true to sanity check output */
+} stress_jpeg_pipe_t;
+
+typedef struct {
+	stress_jpeg_pipe_t *pipe;	/* shared pipeline state */
+	pthread_t	pthread;	/* thread handle */
+	int		ret;		/* pthread_create return */
+	uint32_t	id;		/* thread number */
+	JSAMPROW	*row_pointer;	/* encoder row pointers */
+	stress_latency_hist_t latency;	/* ready to encoded latency */
+	uint64_t	encode_ns;	/* time spent encoding */
+	uint64_t	frames;		/* frames encoded */
+	double		size_compressed; /* total compressed bytes */
+	uint64_t	overflows;	/* output buffer overflows */
+	uint64_t	bad_frames;	/* frames failing verification */
+} stress_jpeg_worker_t;
+
+typedef struct {
+	struct jpeg_destination_mgr pub; /* libjpeg destination manager */
+	uint8_t		*buf;		/* preallocated output buffer */
+	size_t		size;		/* size of buf */
+	uint64_t	overflows;	/* times buf was too small */
+} stress_jpeg_dest_t;
+
+static void stress_jpeg_dest_init(j_compress_ptr cinfo)
+{
+	stress_jpeg_dest_t *dest = (stress_jpeg_dest_t *)cinfo->dest;
+
+	dest->pub.next_output_byte = dest->buf;
+	dest->pub.free_in_buffer = dest->size;
+}
+
+/*
+ *  stress_jpeg_dest_empty()
+ *	output buffer is full, this should not happen as the buffer
+ *	is larger than the raw image, so count it and discard the data
+ */
+static boolean stress_jpeg_dest_empty(j_compress_ptr cinfo)
+{
+	stress_jpeg_dest_t *dest = (stress_jpeg_dest_t *)cinfo->dest;
+
+	dest->overflows++;
+	dest->pub.next_output_byte = dest->buf;
+	dest->pub.free_in_buffer = dest->size;
+	return TRUE;
+}
+
+static void stress_jpeg_dest_term(j_compress_ptr cinfo)
+{
+	(void)cinfo;
+}
+
+static inline void stress_jpeg_ring_push(
+	stress_jpeg_ring_t *ring,
+	const size_t slots,
+	const size_t idx)
+{
+	ring->idx[(ring->head + ring->count) % slots] = idx;
+	ring->count++;
+}
+
+static inline size_t stress_jpeg_ring_pop(
+	stress_jpeg_ring_t *ring,
+	const size_t slots)
+{
+	const size_t idx = ring->idx[ring->head];
+
+	ring->head = (ring->head + 1) % slots;
+	ring->count--;
+	return idx;
+}
+
+/*
+ *  stress_jpeg_producer()
+ *	fill free frame slots with generated images
+ */
+static void *stress_jpeg_producer(void *arg)
+{
+	stress_jpeg_worker_t *w = (stress_jpeg_worker_t *)arg;
+	stress_jpeg_pipe_t *pipe = w->pipe;
+
+	/* mwc state is per thread, give each producer different frames */
+	stress_mwc_set_seed(0xf1379ab2 + w->id, 0x679ce25d);
+
+	for (;;) {
+		size_t idx;
+		stress_jpeg_frame_t *frame;
+
+		(void)pthread_mutex_lock(&pipe->lock);
+		while (!pipe->stop && (pipe->free.count == 0))
+			(void)pthread_cond_wait(&pipe->free_cond, &pipe->lock);
+		if (pipe->stop) {
+			(void)pthread_mutex_unlock(&pipe->lock);
+			break;
+		}
+		idx = stress_jpeg_ring_pop(&pipe->free, pipe->slots);
+		(void)pthread_mutex_unlock(&pipe->lock);
+
+		frame = &pipe->frames[idx];
+		stress_rgb_generate(frame->rgb, pipe->x_max, pipe->y_max, pipe->jpeg_image);
+		frame->t_ready = stress_latency_now();
+
+		(void)pthread_mutex_lock(&pipe->lock);
+		stress_jpeg_ring_push(&pipe->ready, pipe->slots, idx);
+		(void)pthread_cond_signal(&pipe->ready_cond);
+		(void)pthread_mutex_unlock(&pipe->lock);
+	}
+	return &g_nowt;
+}
+
+/*
+ *  stress_jpeg_encoder()
+ *	compress ready frames into their output buffers, the
+ *	compressor and destination manager are reused for all frames
+ */
+static void *stress_jpeg_encoder(void *arg)
+{
+	stress_jpeg_worker_t *w = (stress_jpeg_worker_t *)arg;
+	stress_jpeg_pipe_t *pipe = w->pipe;
+	struct jpeg_compress_struct cinfo;
+	struct jpeg_error_mgr jerr;
+	stress_jpeg_dest_t dest;
+	const int row_stride = pipe->x_max * 3;
+
+	cinfo.err = jpeg_std_error(&jerr);
+	jpeg_create_compress(&cinfo);
+	(void)shim_memset(&dest, 0, sizeof(dest));
+	dest.pub.init_destination = stress_jpeg_dest_init;
+	dest.pub.empty_output_buffer = stress_jpeg_dest_empty;
+	dest.pub.term_destination = stress_jpeg_dest_term;
+	dest.size = pipe->out_size;
+	cinfo.dest = &dest.pub;
+
+	cinfo.image_width = (JDIMENSION)pipe->x_max;
+	cinfo.image_height = (JDIMENSION)pipe->y_max;
+	cinfo.input_components = 3;
+	cinfo.in_color_space = JCS_RGB;
+	jpeg_set_defaults(&cinfo);
+	jpeg_set_quality(&cinfo, (int)pipe->quality, TRUE);
+
+	for (;;) {
+		size_t idx;
+		int32_t y;
+		uint64_t t_begin, t_end, overflows;
+		stress_jpeg_frame_t *frame;
+		uint8_t *rgb;
+
+		(void)pthread_mutex_lock(&pipe->lock);
+		while (!pipe->stop && (pipe->ready.count == 0))
+			(void)pthread_cond_wait(&pipe->ready_cond, &pipe->lock);
+		if (pipe->stop) {
+			(void)pthread_mutex_unlock(&pipe->lock);
+			break;
+		}
+		idx = stress_jpeg_ring_pop(&pipe->ready, pipe->slots);
+		(void)pthread_mutex_unlock(&pipe->lock);
+
+		frame = &pipe->frames[idx];
+		t_begin = stress_latency_now();
+		for (rgb = frame->rgb, y = 0; y < pipe->y_max; y++, rgb += row_stride)
+			w->row_pointer[y] = rgb;
+		dest.buf = frame->jpeg;
+		overflows = dest.overflows;
+		jpeg_start_compress(&cinfo, TRUE);
+		(void)jpeg_write_scanlines(&cinfo, w->row_pointer, (JDIMENSION)pipe->y_max);
+		jpeg_finish_compress(&cinfo);
+		frame->jpeg_len = pipe->out_size - dest.pub.free_in_buffer;
+		t_end = stress_latency_now();
+
+		stress_latency_hist_record(&w->latency, t_end - frame->t_ready);
+		w->encode_ns += t_end - t_begin;
+		w->frames++;
+		w->size_compressed += (double)frame->jpeg_len;
+		if (dest.overflows != overflows) {
+			w->overflows++;
+		} else if (pipe->verify) {
+			/* must start with SOI and end with EOI markers */
+			if ((frame->jpeg_len < 4) ||
+			    (frame->jpeg[0] != 0xff) || (frame->jpeg[1] != 0xd8) ||
+			    (frame->jpeg[frame->jpeg_len - 2] != 0xff) ||
+			    (frame->jpeg[frame->jpeg_len - 1] != 0xd9))
+				w->bad_frames++;
+		}
+
+		(void)pthread_mutex_lock(&pipe->lock);
+		stress_jpeg_ring_push(&pipe->free, pipe->slots, idx);
+		pipe->frames_done++;
+		(void)pthread_cond_signal(&pipe->free_cond);
+		(void)pthread_mutex_unlock(&pipe->lock);
+	}
+	jpeg_destroy_compress(&cinfo);
+	return &g_nowt;
+}
+
+/*
+ *  stress_jpeg_pipeline()
+ *	producer/consumer encode pipeline, jpeg_producers image
+ *	generator threads feed jpeg_pipeline encoder threads through
+ *	a bounded queue, reports throughput and per-frame latency
+ *	from the time a frame is queued to when it is encoded
+ */
+static int stress_jpeg_pipeline(
+	stress_args_t *args,
+	const uint32_t jpeg_pipeline,
+	const int32_t x_max,
+	const int32_t y_max,
+	const int32_t quality,
+	const size_t jpeg_image)
+{
+	stress_jpeg_pipe_t pipe;
+	stress_jpeg_worker_t *workers;
+	stress_latency_hist_t *latency;
+	uint32_t jpeg_producers = DEFAULT_JPEG_PRODUCERS;
+	size_t i, num_workers, buf_size, row_pointer_size;
+	const size_t rgb_size = (size_t)x_max * (size_t)y_max * 3;
+	uint8_t *buf;
+	JSAMPROW *row_pointers;
+	uint64_t frames = 0, overflows = 0, bad_frames = 0, encode_ns = 0;
+	double t_start, duration, rate, size_compressed = 0.0, ratio;
+	int rc = EXIT_SUCCESS;
+
+	(void)stress_get_setting("jpeg-producers", &jpeg_producers);
+	num_workers = (size_t)jpeg_producers + (size_t)jpeg_pipeline;
+
+	(void)shim_memset(&pipe, 0, sizeof(pipe));
+	pipe.x_max = x_max;
+	pipe.y_max = y_max;
+	pipe.quality = quality;
+	pipe.jpeg_image = jpeg_image;
+	pipe.verify = !!(g_opt_flags & OPT_FLAGS_VERIFY);
+	/* one slot per producer and up to two queued frames per encoder */
+	pipe.slots = (size_t)jpeg_producers + (2 * (size_t)jpeg_pipeline);
+	/* room for the worst case of incompressible data plus headers */
+	pipe.out_size = rgb_size + (rgb_size >> 3) + 65536;
+
+	workers = (stress_jpeg_worker_t *)calloc(num_workers, sizeof(*workers));
+	if (!workers) {
+		pr_inf_skip("%s: cannot allocate %zu thread states, skipping stressor\n",
+			args->name, num_workers);
+		return EXIT_NO_RESOURCE;
+	}
+	pipe.frames = (stress_jpeg_frame_t *)calloc(pipe.slots, sizeof(*pipe.frames));
+	pipe.ready.idx = (size_t *)calloc(pipe.slots, sizeof(*pipe.ready.idx));
+	pipe.free.idx = (size_t *)calloc(pipe.slots, sizeof(*pipe.free.idx));
+	latency = (stress_latency_hist_t *)malloc(sizeof(*latency));
+	if (!pipe.frames || !pipe.ready.idx || !pipe.free.idx || !latency) {
+		pr_inf_skip("%s: cannot allocate %zu frame slots, skipping stressor\n",
+			args->name, pipe.slots);
+		rc = EXIT_NO_RESOURCE;
+		goto free_slots;
+	}
+
+	buf_size = pipe.slots * (rgb_size + pipe.out_size);
+	buf = (uint8_t *)stress_mmap_populate(NULL, buf_size,
+			PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (buf == MAP_FAILED) {
+		pr_inf_skip("%s: cannot mmap %zu bytes for %zu frame slots, "
+			"skipping stressor\n", args->name, buf_size, pipe.slots);
+		rc = EXIT_NO_RESOURCE;
+		goto free_slots;
+	}
+	stress_set_vma_anon_name(buf, buf_size, "jpeg-frames");
+	row_pointer_size = (size_t)jpeg_pipeline * (size_t)y_max * sizeof(*row_pointers);
+	row_pointers = (JSAMPROW *)stress_mmap_populate(NULL, row_pointer_size,
+			PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (row_pointers == MAP_FAILED) {
+		pr_inf_skip("%s: cannot mmap %zu bytes for row pointers, "
+			"skipping stressor\n", args->name, row_pointer_size);
+		rc = EXIT_NO_RESOURCE;
+		goto unmap_buf;
+	}
+	stress_set_vma_anon_name(row_pointers, row_pointer_size, "row-pointers");
+
+	for (i = 0; i < pipe.slots; i++) {
+		pipe.frames[i].rgb = buf + (i * rgb_size);
+		pipe.frames[i].jpeg = buf + (pipe.slots * rgb_size) + (i * pipe.out_size);
+		stress_jpeg_ring_push(&pipe.free, pipe.slots, i);
+	}
+	for (i = 0; i < num_workers; i++) {
+		workers[i].pipe = &pipe;
+		workers[i].ret = -1;
+		stress_latency_hist_init(&workers[i].latency);
+		if (i < jpeg_pipeline) {
+			workers[i].id = (uint32_t)i;
+			workers[i].row_pointer = row_pointers + (i * (size_t)y_max);
+		} else {
+			workers[i].id = (uint32_t)(i - jpeg_pipeline);
+		}
+	}
+
+	if ((pthread_mutex_init(&pipe.lock, NULL) != 0) ||
+	    (pthread_cond_init(&pipe.ready_cond, NULL) != 0) ||
+	    (pthread_cond_init(&pipe.free_cond, NULL) != 0)) {
+		pr_inf_skip("%s: cannot initialize pipeline mutex and condition "
+			"variables, skipping stressor\n", args->name);
+		rc = EXIT_NO_RESOURCE;
+		goto unmap_row_pointers;
+	}
+
+	stress_set_proc_state(args->name, STRESS_STATE_SYNC_WAIT);
+	stress_sync_start_wait(args);
+	stress_set_proc_state(args->name, STRESS_STATE_RUN);
+
+	if (args->instance == 0)
+		pr_dbg("%s: pipeline of %" PRIu32 " producer and %" PRIu32
+			" encoder threads, %zu frame slots of %" PRId32 " x %" PRId32 "\n",
+			args->name, jpeg_producers, jpeg_pipeline, pipe.slots, x_max, y_max);
+
+	t_start = stress_time_now();
+	for (i = 0; i < num_workers; i++) {
+		workers[i].ret = pthread_create(&workers[i].pthread, NULL,
+			(i < jpeg_pipeline) ? stress_jpeg_encoder : stress_jpeg_producer,
+			(void *)&workers[i]);
+		if (workers[i].ret != 0) {
+			pr_inf_skip("%s: cannot create pipeline thread, errno=%d (%s), "
+				"skipping stressor\n", args->name,
+				workers[i].ret, strerror(workers[i].ret));
+			rc = EXIT_NO_RESOURCE;
+			break;
+		}
+	}
+
+	while ((rc == EXIT_SUCCESS) && stress_continue(args)) {
+		(void)shim_usleep(10000);
+		(void)pthread_mutex_lock(&pipe.lock);
+		frames = pipe.frames_done;
+		(void)pthread_mutex_unlock(&pipe.lock);
+		stress_bogo_set(args, frames);
+	}
+
+	(void)pthread_mutex_lock(&pipe.lock);
+	pipe.stop = true;
+	(void)pthread_cond_broadcast(&pipe.ready_cond);
+	(void)pthread_cond_broadcast(&pipe.free_cond);
+	(void)pthread_mutex_unlock(&pipe.lock);
+	for (i = 0; i < num_workers; i++) {
+		if (workers[i].ret == 0)
+			(void)pthread_join(workers[i].pthread, NULL);
+	}
+	duration = stress_time_now() - t_start;
+
+	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
+
+	stress_latency_hist_init(latency);
+	frames = 0;
+	for (i = 0; i < jpeg_pipeline; i++) {
+		stress_latency_hist_merge(latency, &workers[i].latency);
+		frames += workers[i].frames;
+		encode_ns += workers[i].encode_ns;
+		size_compressed += workers[i].size_compressed;
+		overflows += workers[i].overflows;
+		bad_frames += workers[i].bad_frames;
+	}
+	stress_bogo_set(args, frames);
+
+	if (overflows)
+		pr_dbg("%s: %" PRIu64 " frames overflowed the %zu byte output buffer\n",
+			args->name, overflows, pipe.out_size);
+	if (bad_frames) {
+		pr_fail("%s: %" PRIu64 " of %" PRIu64 " compressed frames did not "
+			"start with a SOI marker and end with an EOI marker\n",
+			args->name, bad_frames, frames);
+		rc = EXIT_FAILURE;
+	}
+
+	rate = (duration > 0.0) ? (double)frames * (double)x_max * (double)y_max / duration : 0.0;
+	stress_metrics_set(args, 0, "megapixels compressed per sec",
+		rate / 1000000.0, STRESS_METRIC_HARMONIC_MEAN);
+	rate = (duration > 0.0) ? (double)frames / duration : 0.0;
+	stress_metrics_set(args, 1, "frames compressed per sec",
+		rate, STRESS_METRIC_HARMONIC_MEAN);
+	ratio = (frames > 0) ? 100.0 * size_compressed / ((double)frames * (double)rgb_size) : 0.0;
+	stress_metrics_set(args, 2, "% compression ratio",
+		ratio, STRESS_METRIC_HARMONIC_MEAN);
+	stress_metrics_set(args, 3, "frame encode time mean (msec)",
+		(frames > 0) ? (double)encode_ns / (double)frames / 1000000.0 : 0.0,
+		STRESS_METRIC_GEOMETRIC_MEAN);
+	stress_metrics_set(args, 4, "frame latency mean (msec)",
+		stress_latency_hist_mean(latency) / 1000000.0,
+		STRESS_METRIC_GEOMETRIC_MEAN);
+	stress_metrics_set(args, 5, "frame latency p50 (msec)",
+		(double)stress_latency_hist_percentile(latency, 50.0) / 1000000.0,
+		STRESS_METRIC_GEOMETRIC_MEAN);
+	stress_metrics_set(args, 6, "frame latency p99 (msec)",
+		(double)stress_latency_hist_percentile(latency, 99.0) / 1000000.0,
+		STRESS_METRIC_GEOMETRIC_MEAN);
+	stress_metrics_set(args, 7, "frame latency max (msec)",
+		(latency->count > 0) ? (double)latency->max_ns / 1000000.0 : 0.0,
+		STRESS_METRIC_MAXIMUM);
+
+	(void)pthread_cond_destroy(&pipe.free_cond);
+	(void)pthread_cond_destroy(&pipe.ready_cond);
+	(void)pthread_mutex_destroy(&pipe.lock);
+unmap_row_pointers:
+	(void)munmap((void *)row_pointers, row_pointer_size);
+unmap_buf:
+	(void)munmap((void *)buf, buf_size);
+free_slots:
+	free(latency);
+	free(pipe.free.idx);
+	free(pipe.ready.idx);
+	free(pipe.frames);
+	free(workers);
+
+	return rc;
+}
+#endif
+
 /*
  *  stress_jpeg()
  *	stress jpeg compression
@@ -360,6 +850,7 @@ static int stress_jpeg(stress_args_t *args)
 	int32_t yy = 0;
 	size_t rgb_size, row_pointer_size;
 	size_t jpeg_image = 0; /* plasma */
+	uint32_t jpeg_pipeline = 0;
 	double total_pixels = 0.0, t_start, duration, rate, ratio;
 	const bool verify = !!(g_opt_flags & OPT_FLAGS_VERIFY);
 
@@ -382,6 +873,17 @@ static int stress_jpeg(stress_args_t *args)
 			jpeg_quality = MIN_JPEG_QUALITY;
 	}
 	(void)stress_get_setting("jpeg-image", &jpeg_image);
+	(void)stress_get_setting("jpeg-pipeline", &jpeg_pipeline);
+
+#if defined(HAVE_LIB_PTHREAD)
+	if (jpeg_pipeline > 0)
+		return stress_jpeg_pipeline(args, jpeg_pipeline, x_max, y_max,
+			jpeg_quality, jpeg_image);
+#else
+	if ((jpeg_pipeline > 0) && (args->instance == 0))
+		pr_inf("%s: --jpeg-pipeline requires pthread support, "
+			"using single threaded compression\n", args->name);
+#endif
 
 	rgb_size = (size_t)x_max * (size_t)y_max * 3;
 
@@ -408,27 +910,7 @@ static int stress_jpeg(stress_args_t *args)
 
 	stress_mwc_set_seed(0xf1379ab2, 0x679ce25d);
 
-	switch (jpeg_image_types[jpeg_image].type) {
-	default:
-	case JPEG_IMAGE_PLASMA:
-		stress_rgb_plasma(rgb, x_max, y_max);
-		break;
-	case JPEG_IMAGE_NOISE:
-		stress_rgb_noise(rgb, x_max, y_max);
-		break;
-	case JPEG_IMAGE_GRADIENT:
-		stress_rgb_gradient(rgb, x_max, y_max);
-		break;
-	case JPEG_IMAGE_XSTRIPES:
-		stress_rgb_xstripes(rgb, x_max, y_max);
-		break;
-	case JPEG_IMAGE_FLAT:
-		stress_rgb_flat(rgb, x_max, y_max);
-		break;
-	case JPEG_IMAGE_BROWN:
-		stress_rgb_brown(rgb, x_max, y_max);
-		break;
-	}
+	stress_rgb_generate(rgb, x_max, y_max, jpeg_image);
 
 	stress_set_proc_state(args->name, STRESS_STATE_SYNC_WAIT);
 	stress_sync_start_wait(args);
@@ -491,6 +973,7 @@ const stressor_info_t stress_jpeg_info = {
 	.class = CLASS_CPU | CLASS_COMPUTE,
 	.opts = opts,
 	.verify = VERIFY_OPTIONAL,
+	.metrics_max = 8,
 	.help = help
 };
 #else
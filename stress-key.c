@@ -415,6 +415,7 @@ const stressor_info_t stress_key_info = {
 	.stressor = stress_key,
 	.class = CLASS_OS,
 	.verify = VERIFY_ALWAYS,
+	.metrics_max = 1,
 	.help = help
 };
 #else
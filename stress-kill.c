@@ -180,5 +180,6 @@ const stressor_info_t stress_kill_info = {
 	.stressor = stress_kill,
 	.class = CLASS_INTERRUPT | CLASS_SCHEDULER | CLASS_OS,
 	.verify = VERIFY_OPTIONAL,
+	.metrics_max = 1,
 	.help = help
 };
@@ -20,7 +20,9 @@
 #include "core-arch.h"
 #include "core-builtin.h"
 #include "core-capabilities.h"
+#include "core-latency.h"
 #include "core-madvise.h"
+#include "core-pthread.h"
 
 #include <sys/ioctl.h>
 
@@ -28,12 +30,44 @@
 #include <linux/kvm.h>
 #endif
 
+#define KVM_VCPUS_MAX		(64)
+#define KVM_EXITS_MAX		(1000)		/* exits per vCPU per VM */
+#define KVM_MMIO_ADDR		(0xf0000)	/* unbacked guest physical MMIO address */
+
+#define KVM_EXIT_TYPE_ALL	(0)
+#define KVM_EXIT_TYPE_CPUID	(1)
+#define KVM_EXIT_TYPE_HLT	(2)
+#define KVM_EXIT_TYPE_MMIO	(3)
+#define KVM_EXIT_TYPE_PIO	(4)
+#define KVM_EXIT_TYPES		(4)
+
 static const stress_help_t help[] = {
 	{ NULL,	"kvm N",	"start N workers exercising /dev/kvm" },
+	{ NULL,	"kvm-exit type", "select guest exit type: all, cpuid, hlt, mmio or pio" },
 	{ NULL, "kvm-ops N",	"stop after N kvm create/run/destroy operations" },
+	{ NULL,	"kvm-vcpus N",	"specify number of vCPUs per VM" },
 	{ NULL,	NULL,		NULL }
 };
 
+static const char *stress_kvm_exits[] = {
+	"all",
+	"cpuid",
+	"hlt",
+	"mmio",
+	"pio",
+};
+
+static const char *stress_kvm_exit(const size_t i)
+{
+	return (i < SIZEOF_ARRAY(stress_kvm_exits)) ? stress_kvm_exits[i] : NULL;
+}
+
+static const stress_opt_t opts[] = {
+	{ OPT_kvm_exit,  "kvm-exit",  TYPE_ID_SIZE_T_METHOD, 0, 0, stress_kvm_exit },
+	{ OPT_kvm_vcpus, "kvm-vcpus", TYPE_ID_UINT32, 1, KVM_VCPUS_MAX, NULL },
+	END_OPT,
+};
+
 #if defined(__linux__)	&&			\
     defined(HAVE_LINUX_KVM_H) && 		\
     defined(KVM_CREATE_VM) &&			\
@@ -45,11 +79,30 @@ static const stress_help_t help[] = {
     defined(KVM_GET_VCPU_MMAP_SIZE) &&		\
     defined(KVM_RUN) &&				\
     defined(KVM_EXIT_IO) &&			\
+    defined(KVM_EXIT_HLT) &&			\
+    defined(KVM_EXIT_MMIO) &&			\
     defined(KVM_EXIT_SHUTDOWN) &&		\
     defined(STRESS_ARCH_X86) &&			\
     !defined(__i386__) &&			\
     !defined(__i386)
 
+/* per vCPU state, vCPUs other than the first are run in pthreads */
+typedef struct {
+	stress_args_t *args;		/* stressor args */
+	int vcpu_fd;			/* vCPU file descriptor */
+	struct kvm_run *run;		/* mmap'd vCPU run state */
+	size_t type;			/* KVM_EXIT_TYPE_* exit type */
+	double tsc_ns;			/* nanoseconds per guest TSC cycle, 0 if unknown */
+	stress_latency_hist_t *hist;	/* exit latencies */
+	uint64_t exits;			/* exits completed */
+	bool ok;			/* true if all exits completed */
+	bool failed;			/* true on a verification failure */
+#if defined(HAVE_LIB_PTHREAD)
+	pthread_t pthread;		/* vCPU pthread */
+	int pthread_ret;		/* pthread_create return */
+#endif
+} stress_kvm_vcpu_t;
+
 static int stress_kvm_open(const char *name, const bool report)
 {
 	int kvm_fd;
@@ -92,19 +145,252 @@ static int stress_kvm_supported(const char *name)
 }
 
 /*
- *  Minimal x86 kernel, read/increment/write port $80 loop
+ *  Minimal 16 bit real mode x86 kernels, each loops forever
+ *  performing one exit per loop of the given exit type
  */
-static const uint8_t kvm_x86_kernel[] = {
-	0x31, 0xc0,  /* xor    %eax,%eax */
-	0x0f, 0xa2,  /* cpuid */
-	0x0f, 0x31,  /* rdtsc */
-	0x0f, 0x08,  /* inv */
-	0xe5, 0x80,  /* in     $0x80,%eax */
-	0x40,        /* inc    %eax       */
-	0xe7, 0x80,  /* out    %eax,$0x80 */
-	0xeb, 0xf1,  /* jmp    0 <_start> */
+static const uint8_t kvm_x86_kernel_cpuid[] = {
+	0x0f, 0x31,		/* rdtsc */
+	0x66, 0x89, 0xc6,	/* mov    %eax,%esi */
+	0x66, 0x31, 0xc0,	/* xor    %eax,%eax */
+	0x0f, 0xa2,		/* cpuid */
+	0x0f, 0x31,		/* rdtsc */
+	0x66, 0x29, 0xf0,	/* sub    %esi,%eax */
+	0x66, 0xe7, 0x81,	/* out    %eax,$0x81 */
+	0xeb, 0xec,		/* jmp    0 <_start> */
+};
+
+static const uint8_t kvm_x86_kernel_hlt[] = {
+	0xf4,			/* hlt */
+	0xeb, 0xfd,		/* jmp    0 <_start> */
+};
+
+static const uint8_t kvm_x86_kernel_mmio[] = {
+	0x40,			/* inc    %ax */
+	0x26, 0x88, 0x06,	/* mov    %al,%es:0x0 */
+	0x00, 0x00,
+	0xeb, 0xf8,		/* jmp    0 <_start> */
+};
+
+static const uint8_t kvm_x86_kernel_pio[] = {
+	0x40,			/* inc    %ax */
+	0xe6, 0x80,		/* out    %al,$0x80 */
+	0xeb, 0xfb,		/* jmp    0 <_start> */
+};
+
+typedef struct {
+	const uint8_t *code;	/* guest kernel */
+	const size_t code_len;	/* size of kernel in bytes */
+} stress_kvm_kernel_t;
+
+/* kernels indexed by KVM_EXIT_TYPE_* - 1 */
+static const stress_kvm_kernel_t kvm_x86_kernels[KVM_EXIT_TYPES] = {
+	{ kvm_x86_kernel_cpuid,	sizeof(kvm_x86_kernel_cpuid) },
+	{ kvm_x86_kernel_hlt,	sizeof(kvm_x86_kernel_hlt) },
+	{ kvm_x86_kernel_mmio,	sizeof(kvm_x86_kernel_mmio) },
+	{ kvm_x86_kernel_pio,	sizeof(kvm_x86_kernel_pio) },
 };
 
+/*
+ *  stress_kvm_vcpu_run()
+ *	run a vCPU for KVM_EXITS_MAX exits, each KVM_RUN round trip
+ *	is timed, cpuid exits are handled in the kernel so these are
+ *	timed by the guest using the TSC and reported via port $0x81
+ */
+static void stress_kvm_vcpu_run(stress_kvm_vcpu_t *vcpu)
+{
+	stress_args_t *args = vcpu->args;
+	struct kvm_run *run = vcpu->run;
+	uint8_t value = 0;
+	int i;
+
+	for (i = 0; LIKELY((i < KVM_EXITS_MAX) && stress_continue(args)); i++) {
+		const uint64_t t_begin = stress_latency_now();
+		const uint8_t *data;
+		uint64_t ns;
+		uint32_t cycles;
+		int ret;
+
+		ret = ioctl(vcpu->vcpu_fd, KVM_RUN, 0);
+		ns = stress_latency_now() - t_begin;
+		if (ret < 0) {
+			if (errno != EINTR) {
+				pr_fail("%s: ioctl KVM_RUN failed, errno=%d (%s)\n",
+					args->name, errno, strerror(errno));
+				vcpu->failed = true;
+			}
+			return;
+		}
+		switch (run->exit_reason) {
+		case KVM_EXIT_IO:
+			data = (uint8_t *)run + run->io.data_offset;
+			if ((vcpu->type == KVM_EXIT_TYPE_PIO) &&
+			    (run->io.port == 0x80) && (run->io.size == 1) &&
+			    (run->io.direction == KVM_EXIT_IO_OUT)) {
+				value++;
+				if (*data != value) {
+					pr_fail("%s: pio exit value 0x%2.2x, expected 0x%2.2x\n",
+						args->name, *data, value);
+					vcpu->failed = true;
+					return;
+				}
+			} else if ((vcpu->type == KVM_EXIT_TYPE_CPUID) &&
+				   (run->io.port == 0x81) && (run->io.size == 4)) {
+				(void)shim_memcpy(&cycles, data, sizeof(cycles));
+				if (vcpu->tsc_ns > 0.0)
+					ns = (uint64_t)((double)cycles * vcpu->tsc_ns);
+			} else {
+				goto unexpected;
+			}
+			break;
+		case KVM_EXIT_MMIO:
+			if ((vcpu->type != KVM_EXIT_TYPE_MMIO) ||
+			    (run->mmio.phys_addr != KVM_MMIO_ADDR) ||
+			    (run->mmio.len != 1) || !run->mmio.is_write)
+				goto unexpected;
+			value++;
+			if (run->mmio.data[0] != value) {
+				pr_fail("%s: mmio exit value 0x%2.2x, expected 0x%2.2x\n",
+					args->name, run->mmio.data[0], value);
+				vcpu->failed = true;
+				return;
+			}
+			break;
+		case KVM_EXIT_HLT:
+			if (vcpu->type != KVM_EXIT_TYPE_HLT)
+				goto unexpected;
+			break;
+		case KVM_EXIT_SHUTDOWN:
+			return;
+		default:
+unexpected:
+			pr_fail("%s: unexpected vCPU exit reason %" PRIu32 " running %s exits\n",
+				args->name, (uint32_t)run->exit_reason, stress_kvm_exits[vcpu->type]);
+			vcpu->failed = true;
+			return;
+		}
+		stress_latency_hist_record(vcpu->hist, ns);
+		vcpu->exits++;
+
+#if defined(KVM_GET_REGS)
+		{
+			struct kvm_regs kregs;
+
+			VOID_RET(int, ioctl(vcpu->vcpu_fd, KVM_GET_REGS, &kregs));
+		}
+#endif
+#if defined(KVM_GET_FPU)
+		{
+			struct kvm_fpu fpu;
+
+			VOID_RET(int, ioctl(vcpu->vcpu_fd, KVM_GET_FPU, &fpu));
+		}
+#endif
+#if defined(KVM_GET_MP_STATE)
+		{
+			struct kvm_mp_state state;
+
+			VOID_RET(int, ioctl(vcpu->vcpu_fd, KVM_GET_MP_STATE, &state));
+		}
+#endif
+#if defined(KVM_GET_XSAVE)
+		{
+			struct kvm_xsave xsave;
+
+			VOID_RET(int, ioctl(vcpu->vcpu_fd, KVM_GET_XSAVE, &xsave));
+		}
+#endif
+	}
+	vcpu->ok = true;
+}
+
+#if defined(HAVE_LIB_PTHREAD)
+/*
+ *  stress_kvm_vcpu_pthread()
+ *	run a vCPU in a pthread
+ */
+static void *stress_kvm_vcpu_pthread(void *arg)
+{
+	stress_kvm_vcpu_run((stress_kvm_vcpu_t *)arg);
+	return &g_nowt;
+}
+#endif
+
+/*
+ *  stress_kvm_vcpu_init()
+ *	create a vCPU and set it up to run the guest kernel at
+ *	address 0 in 16 bit real mode
+ */
+static int stress_kvm_vcpu_init(
+	stress_args_t *args,
+	const int vm_fd,
+	const int id,
+	const size_t run_size,
+	stress_kvm_vcpu_t *vcpu)
+{
+	struct kvm_sregs sregs;
+	struct kvm_regs regs;
+
+	vcpu->vcpu_fd = ioctl(vm_fd, KVM_CREATE_VCPU, id);
+	if (vcpu->vcpu_fd < 0) {
+		if (errno != EINTR)
+			pr_fail("%s: ioctl KVM_CREATE_VCPU failed, errno=%d (%s)\n",
+				args->name, errno, strerror(errno));
+		return -1;
+	}
+
+	if (ioctl(vcpu->vcpu_fd, KVM_GET_SREGS, &sregs) < 0) {
+		if (errno != EINTR)
+			pr_fail("%s: ioctl KVM_GET_SREGS failed, errno=%d (%s)\n",
+				args->name, errno, strerror(errno));
+		goto close_vcpu_fd;
+	}
+
+	sregs.cs.selector = 0;
+	sregs.cs.base = 0;
+	sregs.ds.selector = 0;
+	sregs.ds.base = 0;
+	/* %es addresses the unbacked MMIO page */
+	sregs.es.selector = KVM_MMIO_ADDR >> 4;
+	sregs.es.base = KVM_MMIO_ADDR;
+	sregs.fs.selector = 0;
+	sregs.fs.base = 0;
+	sregs.gs.selector = 0;
+	sregs.gs.base = 0;
+	sregs.ss.selector = 0;
+	sregs.ss.base = 0;
+
+	if (ioctl(vcpu->vcpu_fd, KVM_SET_SREGS, &sregs) < 0) {
+		pr_fail("%s: ioctl KVM_SET_SREGS failed, errno=%d (%s)\n",
+			args->name, errno, strerror(errno));
+		goto close_vcpu_fd;
+	}
+
+	(void)shim_memset(&regs, 0, sizeof(regs));
+	regs.rflags = 2;
+	regs.rip = 0;
+	if (ioctl(vcpu->vcpu_fd, KVM_SET_REGS, &regs) < 0) {
+		if (errno != EINTR)
+			pr_fail("%s: ioctl KVM_SET_REGS failed, errno=%d (%s)\n",
+				args->name, errno, strerror(errno));
+		goto close_vcpu_fd;
+	}
+
+	vcpu->run = (struct kvm_run *)stress_mmap_populate(NULL, run_size,
+		PROT_READ | PROT_WRITE, MAP_SHARED, vcpu->vcpu_fd, 0);
+	if (vcpu->run == MAP_FAILED) {
+		pr_fail("%s: mmap on vcpu_fd failed, errno=%d (%s)\n",
+			args->name, errno, strerror(errno));
+		goto close_vcpu_fd;
+	}
+	stress_set_vma_anon_name(vcpu->run, run_size, "kvm-run");
+	return 0;
+
+close_vcpu_fd:
+	(void)close(vcpu->vcpu_fd);
+	vcpu->vcpu_fd = -1;
+	return -1;
+}
+
 /*
  *  stress_kvm
  *	stress /dev/kvm
@@ -112,26 +398,69 @@ static const uint8_t kvm_x86_kernel[] = {
 static int stress_kvm(stress_args_t *args)
 {
 	bool pr_version = false;
+	size_t kvm_exit = KVM_EXIT_TYPE_ALL, type, i;
+	uint32_t kvm_vcpus = 1;
+	stress_kvm_vcpu_t *vcpus;
+	stress_latency_hist_t *hists;
+	double duration[KVM_EXIT_TYPES];
+	uint64_t exits[KVM_EXIT_TYPES];
+	int rc = EXIT_SUCCESS;
+
+	(void)stress_get_setting("kvm-exit", &kvm_exit);
+	(void)stress_get_setting("kvm-vcpus", &kvm_vcpus);
+#if !defined(HAVE_LIB_PTHREAD)
+	if (kvm_vcpus > 1) {
+		if (args->instance == 0)
+			pr_inf("%s: pthreads not supported, using 1 vCPU\n", args->name);
+		kvm_vcpus = 1;
+	}
+#endif
+
+	vcpus = (stress_kvm_vcpu_t *)calloc(kvm_vcpus, sizeof(*vcpus));
+	hists = (stress_latency_hist_t *)calloc(kvm_vcpus + KVM_EXIT_TYPES, sizeof(*hists));
+	if (!vcpus || !hists) {
+		pr_inf_skip("%s: failed to allocate %" PRIu32 " vCPU states, skipping stressor\n",
+			args->name, kvm_vcpus);
+		free(hists);
+		free(vcpus);
+		return EXIT_NO_RESOURCE;
+	}
+	for (i = 0; i < KVM_EXIT_TYPES; i++) {
+		char description[STRESS_LATENCY_DESC_LEN];
+
+		stress_latency_hist_init(&hists[kvm_vcpus + i]);
+		duration[i] = 0.0;
+		exits[i] = 0;
+		(void)snprintf(description, sizeof(description), "kvm %s exit", stress_kvm_exits[i + 1]);
+		stress_latency_set_description(args, i, description);
+	}
+	type = (kvm_exit == KVM_EXIT_TYPE_ALL) ? KVM_EXIT_TYPE_CPUID : kvm_exit;
 
 	stress_set_proc_state(args->name, STRESS_STATE_SYNC_WAIT);
 	stress_sync_start_wait(args);
 	stress_set_proc_state(args->name, STRESS_STATE_RUN);
 
 	do {
-		int kvm_fd, vm_fd, vcpu_fd, version, ret, i;
+		int kvm_fd, vm_fd, version, ret;
 		void *vm_mem;
-		const size_t vm_mem_size = (stress_mwc16() + 2) * args->page_size;
+		size_t vm_mem_size = (stress_mwc16() + 2) * args->page_size;
 		ssize_t run_size;
 		struct kvm_userspace_memory_region kvm_mem;
-		struct kvm_sregs sregs;
-		struct kvm_regs regs;
-		struct kvm_run *run;
+		const stress_kvm_kernel_t *kernel = &kvm_x86_kernels[type - 1];
+		stress_latency_hist_t *hist = &hists[kvm_vcpus + type - 1];
+		uint32_t n_vcpus = 0;
+		double tsc_ns = 0.0, t;
 		bool run_ok = false;
-		uint8_t value = 0;
+
+		/* the MMIO page must not be backed by guest memory */
+		if ((type == KVM_EXIT_TYPE_MMIO) && (vm_mem_size > KVM_MMIO_ADDR))
+			vm_mem_size = KVM_MMIO_ADDR;
 
 		kvm_fd = stress_kvm_open(args->name, args->instance == 0);
-		if (kvm_fd < 0)
-			return EXIT_NOT_IMPLEMENTED;
+		if (kvm_fd < 0) {
+			rc = EXIT_NOT_IMPLEMENTED;
+			break;
+		}
 
 #if defined(KVM_GET_API_VERSION)
 		version = ioctl(kvm_fd, KVM_GET_API_VERSION, 0);
@@ -148,7 +477,8 @@ static int stress_kvm(stress_args_t *args)
 			if (errno == EBUSY) {
 				pr_inf_skip("%s: KVM device busy, skipping stressor\n", args->name);
 				(void)close(kvm_fd);
-				return EXIT_NO_RESOURCE;
+				rc = EXIT_NO_RESOURCE;
+				break;
 			}
 			pr_fail("%s: ioctl KVM_CREATE_VM failed, errno=%d (%s)\n",
 				args->name, errno, strerror(errno));
@@ -177,140 +507,70 @@ static int stress_kvm(stress_args_t *args)
 				args->name, errno, strerror(errno));
 			goto tidy_vm_mmap;
 		}
-
-		vcpu_fd = ioctl(vm_fd, KVM_CREATE_VCPU, 0);
-		if (vcpu_fd < 0) {
-			if (errno == EINTR)
-				goto tidy_vm_mmap;
-			pr_fail("%s: ioctl KVM_CREATE_VCPU failed, errno=%d (%s)\n",
-				args->name, errno, strerror(errno));
-			goto tidy_vm_mmap;
-		}
-
-		(void)shim_memcpy(vm_mem, &kvm_x86_kernel, sizeof(kvm_x86_kernel));
-		if (ioctl(vcpu_fd, KVM_GET_SREGS, &sregs) < 0) {
-			if (errno == EINTR)
-				goto tidy_vcpu_fd;
-			pr_fail("%s: ioctl KVM_GET_SREGS failed, errno=%d (%s)\n",
-				args->name, errno, strerror(errno));
-			goto tidy_vcpu_fd;
-		}
-
-		sregs.cs.selector = 0;
-		sregs.cs.base = 0;
-		sregs.ds.selector = 0;
-		sregs.ds.base = 0;
-		sregs.es.selector = 0;
-		sregs.es.base = 0;
-		sregs.fs.selector = 0;
-		sregs.fs.base = 0;
-		sregs.gs.selector = 0;
-		sregs.gs.base = 0;
-		sregs.ss.selector = 0;
-		sregs.ss.base = 0;
-
-		if (ioctl(vcpu_fd, KVM_SET_SREGS, &sregs) < 0) {
-			pr_fail("%s: ioctl KVM_SET_SREGS failed, errno=%d (%s)\n",
-				args->name, errno, strerror(errno));
-			goto tidy_vcpu_fd;
-		}
-
-		(void)shim_memset(&regs, 0, sizeof(regs));
-		regs.rflags = 2;
-		regs.rip = 0;
-		if (ioctl(vcpu_fd, KVM_SET_REGS, &regs) < 0) {
-			if (errno == EINTR)
-				goto tidy_vcpu_fd;
-			pr_fail("%s: ioctl KVM_SET_REGS failed, errno=%d (%s)\n",
-				args->name, errno, strerror(errno));
-			goto tidy_vcpu_fd;
-		}
+		(void)shim_memcpy(vm_mem, kernel->code, kernel->code_len);
 
 		run_size = (ssize_t)ioctl(kvm_fd, KVM_GET_VCPU_MMAP_SIZE, 0);
 		if (run_size < 0) {
 			if (errno == EINTR)
-				goto tidy_vcpu_fd;
+				goto tidy_vm_mmap;
 			pr_fail("%s: ioctl KVM_GET_VCPU_MMAP_SIZE failed, errno=%d (%s)\n",
 				args->name, errno, strerror(errno));
-			goto tidy_vcpu_fd;
-		}
-
-		run = (struct kvm_run *)stress_mmap_populate(NULL, (size_t)run_size,
-			PROT_READ | PROT_WRITE, MAP_SHARED, vcpu_fd, 0);
-		if (run == MAP_FAILED) {
-			pr_fail("%s: mmap on vcpu_fd failed, errno=%d (%s)\n",
-				args->name, errno, strerror(errno));
-			goto tidy_vcpu_fd;
+			goto tidy_vm_mmap;
 		}
-		stress_set_vma_anon_name(run, (size_t)run_size, "kvm-run");
-
-		for (i = 0; LIKELY((i < 1000) && stress_continue(args)); i++) {
-			uint8_t *port;
-
-			ret = ioctl(vcpu_fd, KVM_RUN, 0);
-			if (ret < 0) {
-				if (errno != EINTR) {
-					pr_fail("%s: ioctl KVM_RUN failed, errno=%d (%s)\n",
-						args->name, errno, strerror(errno));
-				}
-				goto tidy_run;
-			}
-			switch (run->exit_reason) {
-			case KVM_EXIT_IO:
-				port = (uint8_t *)run + run->io.data_offset;
-				if (run->io.direction == 0) {
-					/* Read */
-					*port = value;
-				} else {
-					/* Write */
-					value = *port;
-				}
-				if (*port == 0xff) {
-					run_ok = true;
-					goto tidy_run;
-				}
-				break;
-			case KVM_EXIT_SHUTDOWN:
-				goto tidy_run;
-			default:
-				break;
-			}
-#if defined(KVM_GET_REGS)
-			{
-				struct kvm_regs kregs;
 
-				VOID_RET(int, ioctl(vcpu_fd, KVM_GET_REGS, &kregs));
-			}
-#endif
-#if defined(KVM_GET_FPU)
-			{
-				struct kvm_fpu fpu;
+		for (n_vcpus = 0; n_vcpus < kvm_vcpus; n_vcpus++) {
+			stress_kvm_vcpu_t *vcpu = &vcpus[n_vcpus];
 
-				VOID_RET(int, ioctl(vcpu_fd, KVM_GET_FPU, &fpu));
-			}
-#endif
-#if defined(KVM_GET_MP_STATE)
-			{
-				struct kvm_mp_state state;
+			(void)shim_memset(vcpu, 0, sizeof(*vcpu));
+			if (stress_kvm_vcpu_init(args, vm_fd, (int)n_vcpus, (size_t)run_size, vcpu) < 0)
+				goto tidy_vcpus;
+			vcpu->args = args;
+			vcpu->type = type;
+			vcpu->hist = &hists[n_vcpus];
+			stress_latency_hist_init(vcpu->hist);
+		}
 
-				VOID_RET(int, ioctl(vcpu_fd, KVM_GET_MP_STATE, &state));
-			}
+#if defined(KVM_GET_TSC_KHZ)
+		ret = ioctl(vcpus[0].vcpu_fd, KVM_GET_TSC_KHZ, 0);
+		if (ret > 0)
+			tsc_ns = 1000000.0 / (double)ret;
 #endif
-#if defined(KVM_GET_XSAVE)
-			{
-				struct kvm_xsave xsave;
-
-				VOID_RET(int, ioctl(vcpu_fd, KVM_GET_XSAVE, &xsave));
-			}
+		for (i = 0; i < n_vcpus; i++)
+			vcpus[i].tsc_ns = tsc_ns;
+
+		t = stress_time_now();
+#if defined(HAVE_LIB_PTHREAD)
+		for (i = 1; i < n_vcpus; i++)
+			vcpus[i].pthread_ret = pthread_create(&vcpus[i].pthread, NULL,
+				stress_kvm_vcpu_pthread, (void *)&vcpus[i]);
 #endif
-#if defined(KVM_GET_TSC_KHZ)
-			VOID_RET(int, ioctl(vcpu_fd, KVM_GET_TSC_KHZ, 0));
+		stress_kvm_vcpu_run(&vcpus[0]);
+#if defined(HAVE_LIB_PTHREAD)
+		for (i = 1; i < n_vcpus; i++) {
+			if (vcpus[i].pthread_ret == 0)
+				(void)pthread_join(vcpus[i].pthread, NULL);
+			else
+				stress_kvm_vcpu_run(&vcpus[i]);
+		}
 #endif
+		duration[type - 1] += stress_time_now() - t;
+
+		run_ok = true;
+		for (i = 0; i < n_vcpus; i++) {
+			stress_latency_hist_merge(hist, vcpus[i].hist);
+			if (args->latency)
+				stress_latency_hist_merge(&args->latency[type - 1].hist, vcpus[i].hist);
+			exits[type - 1] += vcpus[i].exits;
+			if (vcpus[i].failed)
+				rc = EXIT_FAILURE;
+			if (!vcpus[i].ok)
+				run_ok = false;
+		}
+tidy_vcpus:
+		for (i = 0; i < n_vcpus; i++) {
+			(void)munmap((void *)vcpus[i].run, (size_t)run_size);
+			(void)close(vcpus[i].vcpu_fd);
 		}
-tidy_run:
-		(void)munmap((void *)run, (size_t)run_size);
-tidy_vcpu_fd:
-		(void)close(vcpu_fd);
 tidy_vm_mmap:
 		(void)munmap((void *)vm_mem, vm_mem_size);
 tidy_vm_fd:
@@ -319,24 +579,49 @@ tidy_kvm_fd:
 		(void)close(kvm_fd);
 		if (run_ok)
 			stress_bogo_inc(args);
-	} while (stress_continue(args));
+		if (kvm_exit == KVM_EXIT_TYPE_ALL)
+			type = (type >= KVM_EXIT_TYPES) ? KVM_EXIT_TYPE_CPUID : type + 1;
+	} while ((rc == EXIT_SUCCESS) && stress_continue(args));
 
 	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
 
-	return EXIT_SUCCESS;
+	for (i = 0; i < KVM_EXIT_TYPES; i++) {
+		const stress_latency_hist_t *hist = &hists[kvm_vcpus + i];
+		const char *name = stress_kvm_exits[i + 1];
+		char msg[64];
+
+		if (!exits[i] || (duration[i] <= 0.0))
+			continue;
+		(void)snprintf(msg, sizeof(msg), "%s exits per sec", name);
+		stress_metrics_set(args, (i * 3), msg,
+			(double)exits[i] / duration[i], STRESS_METRIC_HARMONIC_MEAN);
+		(void)snprintf(msg, sizeof(msg), "%s exit latency p50 (nsec)", name);
+		stress_metrics_set(args, (i * 3) + 1, msg,
+			(double)stress_latency_hist_percentile(hist, 50.0), STRESS_METRIC_GEOMETRIC_MEAN);
+		(void)snprintf(msg, sizeof(msg), "%s exit latency p99 (nsec)", name);
+		stress_metrics_set(args, (i * 3) + 2, msg,
+			(double)stress_latency_hist_percentile(hist, 99.0), STRESS_METRIC_GEOMETRIC_MEAN);
+	}
+	free(hists);
+	free(vcpus);
+
+	return rc;
 }
 
 const stressor_info_t stress_kvm_info = {
 	.stressor = stress_kvm,
 	.class = CLASS_DEV | CLASS_OS,
+	.opts = opts,
 	.supported = stress_kvm_supported,
 	.verify = VERIFY_ALWAYS,
+	.metrics_max = KVM_EXIT_TYPES * 3,
 	.help = help
 };
 #else
 const stressor_info_t stress_kvm_info = {
 	.stressor = stress_unimplemented,
 	.class = CLASS_DEV | CLASS_OS,
+	.opts = opts,
 	.verify = VERIFY_ALWAYS,
 	.help = help,
 	.unimplemented_reason = "built on non-x86-64 without linux/kvm.h"
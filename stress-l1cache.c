@@ -19,14 +19,47 @@
  */
 #include "stress-ng.h"
 #include "core-attribute.h"
+#include "core-builtin.h"
+#include "core-cpu.h"
 #include "core-cpu-cache.h"
 #include "core-madvise.h"
+#include "core-perf.h"
 #include "core-pragma.h"
+#include "core-put.h"
+#include "core-vecmath.h"
 
 #define DEBUG_TAG_INFO		(0)
 
+#define L1CACHE_BW_DURATION	(0.05)	/* seconds per bandwidth kernel */
+
+#if defined(STRESS_ARCH_X86) &&			\
+    (defined(HAVE_COMPILER_GCC) ||		\
+     defined(HAVE_COMPILER_CLANG) ||		\
+     defined(HAVE_COMPILER_ICX)) &&		\
+    !defined(HAVE_COMPILER_ICC)
+#define TARGET_AVX2		__attribute__ ((target("avx2")))
+#define TARGET_AVX512F		__attribute__ ((target("avx512f")))
+#define STRESS_L1CACHE_BW_X86
+#else
+#define TARGET_AVX2
+#define TARGET_AVX512F
+#endif
+
+/*
+ *  stop the bandwidth kernels being vectorized to a wider width than
+ *  intended or being replaced by memcpy/memset library calls
+ */
+#if defined(HAVE_COMPILER_GCC_OR_MUSL) &&	\
+    !defined(HAVE_COMPILER_CLANG) &&		\
+    !defined(HAVE_COMPILER_ICC)
+#define OPTIMIZE3_L1CACHE_BW	__attribute__((optimize("-O3", "no-tree-vectorize", "no-tree-loop-distribute-patterns")))
+#else
+#define OPTIMIZE3_L1CACHE_BW	OPTIMIZE3
+#endif
+
 static const stress_help_t help[] = {
 	{ NULL,	"l1cache N",	 	"start N CPU level 1 cache thrashing workers" },
+	{ NULL,	"l1cache-bandwidth",	"report L1 load, store and mixed bandwidth per vector width" },
 	{ NULL, "l1cache-line-size N",	"specify level 1 cache line size" },
 	{ NULL,	"l1cache-method M",	"l1 cache thrashing method: forward, reverse, random" },
 	{ NULL,	"l1cache-mlock",	"attempt to mlock memory" },
@@ -479,12 +512,256 @@ static const stress_l1cache_method_t stress_l1cache_methods[] = {
 	{ "reverse",	{ stress_l1cache_reverse,	stress_l1cache_reverse_and_verify } },
 };
 
+/*
+ *  L1 cache load/store bandwidth kernels, each kernel works on
+ *  an L1 cache resident buffer of n vectors of a given width,
+ *  load uses 4 independent accumulators to avoid a dependency
+ *  chain, mixed loads the first half and stores to the second
+ */
+typedef uint64_t (*l1cache_bw_func_t)(void *buf, const size_t n, const size_t loops);
+
+#define STRESS_L1CACHE_BW(width, type, target)				\
+static uint64_t target OPTIMIZE3_L1CACHE_BW NOINLINE			\
+stress_l1cache_bw_load_ ## width(void *buf, const size_t n, const size_t loops) \
+{									\
+	const type *vbuf = (const type *)buf;				\
+	type a0, a1, a2, a3;						\
+	size_t i, j;							\
+	uint64_t sum = 0;						\
+									\
+	(void)shim_memset(&a0, 0, sizeof(a0));				\
+	a1 = a0;							\
+	a2 = a0;							\
+	a3 = a0;							\
+	for (j = 0; j < loops; j++) {					\
+		for (i = 0; i < n; i += 4) {				\
+			a0 ^= vbuf[i + 0];				\
+			a1 ^= vbuf[i + 1];				\
+			a2 ^= vbuf[i + 2];				\
+			a3 ^= vbuf[i + 3];				\
+		}							\
+		stress_asm_mb();					\
+	}								\
+	a0 ^= a1 ^ a2 ^ a3;						\
+	for (i = 0; i < sizeof(a0) / sizeof(uint64_t); i++)		\
+		sum += ((uint64_t *)&a0)[i];				\
+	return sum;							\
+}									\
+									\
+static uint64_t target OPTIMIZE3_L1CACHE_BW NOINLINE			\
+stress_l1cache_bw_store_ ## width(void *buf, const size_t n, const size_t loops) \
+{									\
+	type *vbuf = (type *)buf;					\
+	type v;								\
+	size_t i, j;							\
+									\
+	(void)shim_memset(&v, 0xa5, sizeof(v));				\
+	for (j = 0; j < loops; j++) {					\
+		for (i = 0; i < n; i += 4) {				\
+			vbuf[i + 0] = v;				\
+			vbuf[i + 1] = v;				\
+			vbuf[i + 2] = v;				\
+			vbuf[i + 3] = v;				\
+		}							\
+		stress_asm_mb();					\
+	}								\
+	return 0;							\
+}									\
+									\
+static uint64_t target OPTIMIZE3_L1CACHE_BW NOINLINE			\
+stress_l1cache_bw_mixed_ ## width(void *buf, const size_t n, const size_t loops) \
+{									\
+	type *src = (type *)buf;					\
+	type *dst = src + (n / 2);					\
+	size_t i, j;							\
+									\
+	for (j = 0; j < loops; j++) {					\
+		for (i = 0; i < n / 2; i += 4) {			\
+			dst[i + 0] = src[i + 0];			\
+			dst[i + 1] = src[i + 1];			\
+			dst[i + 2] = src[i + 2];			\
+			dst[i + 3] = src[i + 3];			\
+		}							\
+		stress_asm_mb();					\
+	}								\
+	return 0;							\
+}
+
+STRESS_L1CACHE_BW(64, uint64_t, )
+#if defined(HAVE_VECMATH)
+typedef uint64_t stress_l1cache_v128_t __attribute__ ((vector_size(128 / 8)));
+STRESS_L1CACHE_BW(128, stress_l1cache_v128_t, )
+#if defined(STRESS_L1CACHE_BW_X86)
+typedef uint64_t stress_l1cache_v256_t __attribute__ ((vector_size(256 / 8)));
+STRESS_L1CACHE_BW(256, stress_l1cache_v256_t, TARGET_AVX2)
+#if defined(HAVE_TARGET_CLONES_SKYLAKE_AVX512)
+typedef uint64_t stress_l1cache_v512_t __attribute__ ((vector_size(512 / 8)));
+STRESS_L1CACHE_BW(512, stress_l1cache_v512_t, TARGET_AVX512F)
+#endif
+#endif
+#endif
+
+static bool stress_l1cache_bw_true(void)
+{
+	return true;
+}
+
+#if defined(HAVE_VECMATH) &&		\
+    defined(STRESS_L1CACHE_BW_X86)
+static bool stress_l1cache_bw_avx2(void)
+{
+	return stress_cpu_x86_has_avx2();
+}
+
+#if defined(HAVE_TARGET_CLONES_SKYLAKE_AVX512)
+static bool stress_l1cache_bw_avx512(void)
+{
+	return stress_cpu_x86_has_avx512_f();
+}
+#endif
+#endif
+
+typedef struct {
+	const char *name;		/* kernel name */
+	const size_t width;		/* vector width in bits */
+	const l1cache_bw_func_t func;	/* kernel */
+	bool (*supported)(void);	/* true if CPU can run it */
+} stress_l1cache_bw_kernel_t;
+
+static const stress_l1cache_bw_kernel_t stress_l1cache_bw_kernels[] = {
+	{ "load",	64,	stress_l1cache_bw_load_64,	stress_l1cache_bw_true },
+	{ "store",	64,	stress_l1cache_bw_store_64,	stress_l1cache_bw_true },
+	{ "mixed",	64,	stress_l1cache_bw_mixed_64,	stress_l1cache_bw_true },
+#if defined(HAVE_VECMATH)
+	{ "load",	128,	stress_l1cache_bw_load_128,	stress_l1cache_bw_true },
+	{ "store",	128,	stress_l1cache_bw_store_128,	stress_l1cache_bw_true },
+	{ "mixed",	128,	stress_l1cache_bw_mixed_128,	stress_l1cache_bw_true },
+#if defined(STRESS_L1CACHE_BW_X86)
+	{ "load",	256,	stress_l1cache_bw_load_256,	stress_l1cache_bw_avx2 },
+	{ "store",	256,	stress_l1cache_bw_store_256,	stress_l1cache_bw_avx2 },
+	{ "mixed",	256,	stress_l1cache_bw_mixed_256,	stress_l1cache_bw_avx2 },
+#if defined(HAVE_TARGET_CLONES_SKYLAKE_AVX512)
+	{ "load",	512,	stress_l1cache_bw_load_512,	stress_l1cache_bw_avx512 },
+	{ "store",	512,	stress_l1cache_bw_store_512,	stress_l1cache_bw_avx512 },
+	{ "mixed",	512,	stress_l1cache_bw_mixed_512,	stress_l1cache_bw_avx512 },
+#endif
+#endif
+#endif
+};
+
+/*
+ *  stress_l1cache_bandwidth()
+ *	run load, store and mixed load/store kernels at each vector
+ *	width over a buffer half the L1 cache size and report the
+ *	bandwidth in GB per sec and, if the perf core cycle counter
+ *	is available, in bytes per cycle
+ */
+static void stress_l1cache_bandwidth(stress_args_t *args, const uint32_t l1cache_size)
+{
+	const size_t buf_size = (l1cache_size / 2) & ~(size_t)255;
+	void *buf;
+	size_t i;
+	uint64_t sum = 0;
+#if defined(STRESS_PERF_STATS)
+	stress_perf_cycles_t pc;
+	const bool have_cycles = (stress_perf_cycles_open(&pc) == 0);
+#else
+	const bool have_cycles = false;
+#endif
+
+	if (buf_size < 1024) {
+		pr_inf("%s: L1 cache too small for bandwidth measurements\n", args->name);
+		goto close_cycles;
+	}
+	buf = stress_mmap_populate(NULL, buf_size, PROT_READ | PROT_WRITE,
+				MAP_ANONYMOUS | MAP_PRIVATE, -1, 0);
+	if (buf == MAP_FAILED) {
+		pr_inf("%s: cannot mmap bandwidth test buffer, errno=%d (%s)\n",
+			args->name, errno, strerror(errno));
+		goto close_cycles;
+	}
+	stress_set_vma_anon_name(buf, buf_size, "l1cache-bandwidth");
+	(void)shim_memset(buf, 0x5a, buf_size);
+
+	if (args->instance == 0) {
+		if (!have_cycles)
+			pr_inf("%s: cannot open perf cycle counters, "
+				"bytes per cycle will not be reported\n", args->name);
+		pr_block_begin();
+		pr_inf("%s: L1 bandwidth over a %zu byte buffer:\n", args->name, buf_size);
+		pr_inf("%s: %-6s %6s %12s %12s\n", args->name,
+			"kernel", "bits", "GB per sec", "bytes/cycle");
+	}
+
+	for (i = 0; (i < SIZEOF_ARRAY(stress_l1cache_bw_kernels)) && stress_continue(args); i++) {
+		const stress_l1cache_bw_kernel_t *kernel = &stress_l1cache_bw_kernels[i];
+		const size_t n = buf_size / (kernel->width / 8);
+		double t, duration, bytes = 0.0, rate, bytes_per_cycle = 0.0;
+		uint64_t c1 = 0, c2 = 0, r;
+		char buf_desc[64];
+
+		if (!kernel->supported())
+			continue;
+		/* warm up */
+		sum += kernel->func(buf, n, 16);
+#if defined(STRESS_PERF_STATS)
+		if (have_cycles)
+			(void)stress_perf_cycles_read(&pc, &c1, &r);
+#endif
+		t = stress_time_now();
+		do {
+			sum += kernel->func(buf, n, 256);
+			bytes += 256.0 * (double)buf_size;
+			duration = stress_time_now() - t;
+		} while (duration < L1CACHE_BW_DURATION);
+#if defined(STRESS_PERF_STATS)
+		if (have_cycles)
+			(void)stress_perf_cycles_read(&pc, &c2, &r);
+#endif
+		rate = bytes / (duration * (double)GB);
+		if (c2 > c1)
+			bytes_per_cycle = bytes / (double)(c2 - c1);
+
+		if (args->instance == 0) {
+			if (bytes_per_cycle > 0.0)
+				pr_inf("%s: %-6s %6zu %12.2f %12.2f\n", args->name,
+					kernel->name, kernel->width, rate, bytes_per_cycle);
+			else
+				pr_inf("%s: %-6s %6zu %12.2f %12s\n", args->name,
+					kernel->name, kernel->width, rate, "n/a");
+		}
+		if (bytes_per_cycle > 0.0) {
+			(void)snprintf(buf_desc, sizeof(buf_desc), "bytes per cycle %s %zu bit",
+				kernel->name, kernel->width);
+			stress_metrics_set(args, i, buf_desc,
+				bytes_per_cycle, STRESS_METRIC_GEOMETRIC_MEAN);
+		} else {
+			(void)snprintf(buf_desc, sizeof(buf_desc), "GB per sec %s %zu bit",
+				kernel->name, kernel->width);
+			stress_metrics_set(args, i, buf_desc,
+				rate, STRESS_METRIC_GEOMETRIC_MEAN);
+		}
+	}
+	if (args->instance == 0)
+		pr_block_end();
+
+	stress_uint64_put(sum);
+	(void)munmap(buf, buf_size);
+close_cycles:
+#if defined(STRESS_PERF_STATS)
+	if (have_cycles)
+		stress_perf_cycles_close(&pc);
+#endif
+	return;
+}
+
 static const char *stress_l1cache_method(const size_t i)
 {
 	return (i < SIZEOF_ARRAY(stress_l1cache_methods)) ? stress_l1cache_methods[i].name : NULL;
 }
 
 static const stress_opt_t opts[] = {
+	{ OPT_l1cache_bandwidth, "l1cache-bandwidth", TYPE_ID_BOOL, 0, 1, NULL },
 	{ OPT_l1cache_sets,      "l1cache-sets",      TYPE_ID_UINT32, 1, 65536, NULL },
 	{ OPT_l1cache_size,      "l1cache-size",      TYPE_ID_UINT32, 1, INT_MAX, NULL },
 	{ OPT_l1cache_line_size, "l1cache-line-size", TYPE_ID_UINT32, 1, INT_MAX, NULL },
@@ -509,7 +786,9 @@ static int stress_l1cache(stress_args_t *args)
 	const size_t verify = (g_opt_flags & OPT_FLAGS_VERIFY) ? 1 : 0;
 	l1cache_func_t stress_l1cache_func;
 	bool l1cache_mlock = false;
+	bool l1cache_bandwidth = false;
 
+	(void)stress_get_setting("l1cache-bandwidth", &l1cache_bandwidth);
 	(void)stress_get_setting("l1cache-ways", &l1cache_ways);
 	(void)stress_get_setting("l1cache-size", &l1cache_size);
 	(void)stress_get_setting("l1cache-sets", &l1cache_sets);
@@ -558,6 +837,9 @@ static int stress_l1cache(stress_args_t *args)
 	stress_sync_start_wait(args);
 	stress_set_proc_state(args->name, STRESS_STATE_RUN);
 
+	if (l1cache_bandwidth)
+		stress_l1cache_bandwidth(args, l1cache_size);
+
 	do {
 		if (UNLIKELY(stress_l1cache_func(args, cache_aligned, l1cache_size, l1cache_sets, l1cache_set_size) == EXIT_FAILURE)) {
 			rc = EXIT_FAILURE;
@@ -579,5 +861,6 @@ const stressor_info_t stress_l1cache_info = {
 	.class = CLASS_CPU_CACHE,
 	.opts = opts,
 	.verify = VERIFY_OPTIONAL,
+	.metrics_max = SIZEOF_ARRAY(stress_l1cache_bw_kernels),
 	.help = help
 };
@@ -0,0 +1,679 @@
+/*
+ * Copyright (C) 2025      Colin Ian King.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+#include "stress-ng.h"
+#include "core-affinity.h"
+#include "core-bitops.h"
+#include "core-builtin.h"
+#include "core-latency.h"
+#include "core-pthread.h"
+
+#define MIN_LFQUEUE_THREADS	(1)
+#define MAX_LFQUEUE_THREADS	(32)
+#define DEFAULT_LFQUEUE_THREADS	(2)
+
+#define MIN_LFQUEUE_SIZE	(16)
+#define MAX_LFQUEUE_SIZE	(1024 * 1024)
+#define DEFAULT_LFQUEUE_SIZE	(1024)
+
+#define LFQUEUE_METHOD_ALL	(0)
+#define LFQUEUE_METHOD_LAMPORT	(1)
+#define LFQUEUE_METHOD_FF	(2)
+#define LFQUEUE_METHOD_MPSC	(3)
+#define LFQUEUE_METHOD_MPMC	(4)
+#define LFQUEUE_METHODS		(5)
+
+#define LFQUEUE_SPINS		(64)	/* busy spins before yielding */
+#define LFQUEUE_SAMPLE_MASK	(63)	/* timestamp 1 in 64 items */
+#define LFQUEUE_SLICE_USEC	(100000)/* run time per method and batch size */
+
+static const uint32_t stress_lfqueue_batches[] = { 1, 4, 16, 64 };
+
+#define LFQUEUE_BATCHES		(SIZEOF_ARRAY(stress_lfqueue_batches))
+
+static const stress_help_t help[] = {
+	{ NULL,	"lfqueue N",		"start N workers moving items through lock-free queues" },
+	{ NULL,	"lfqueue-consumers N",	"number of consumer threads for the mpmc queue" },
+	{ NULL,	"lfqueue-method M",	"select queue: all, spsc-lamport, spsc-ff, mpsc, mpmc" },
+	{ NULL,	"lfqueue-ops N",	"stop after N method and batch size rounds" },
+	{ NULL,	"lfqueue-placement P",	"pin threads by topology: none, spread, compact, smt, l3, numa" },
+	{ NULL,	"lfqueue-producers N",	"number of producer threads for the mpsc and mpmc queues" },
+	{ NULL,	"lfqueue-size N",	"queue capacity in items, rounded up to a power of 2" },
+	{ NULL,	NULL,			NULL }
+};
+
+static const char * const stress_lfqueue_methods[] = {
+	"all",
+	"spsc-lamport",
+	"spsc-ff",
+	"mpsc",
+	"mpmc",
+};
+
+static const char *stress_lfqueue_method(const size_t i)
+{
+	return (i < SIZEOF_ARRAY(stress_lfqueue_methods)) ? stress_lfqueue_methods[i] : NULL;
+}
+
+static const char *stress_lfqueue_placement(const size_t i)
+{
+	return (i < (size_t)STRESS_PLACEMENT_MAX) ?
+		stress_placement_name((stress_placement_policy_t)i) : NULL;
+}
+
+static const stress_opt_t opts[] = {
+	{ OPT_lfqueue_consumers, "lfqueue-consumers", TYPE_ID_UINT32, MIN_LFQUEUE_THREADS, MAX_LFQUEUE_THREADS, NULL },
+	{ OPT_lfqueue_method,	 "lfqueue-method",    TYPE_ID_SIZE_T_METHOD, 0, 0, stress_lfqueue_method },
+	{ OPT_lfqueue_placement, "lfqueue-placement", TYPE_ID_SIZE_T_METHOD, 0, 0, stress_lfqueue_placement },
+	{ OPT_lfqueue_producers, "lfqueue-producers", TYPE_ID_UINT32, MIN_LFQUEUE_THREADS, MAX_LFQUEUE_THREADS, NULL },
+	{ OPT_lfqueue_size,	 "lfqueue-size",      TYPE_ID_UINT32, MIN_LFQUEUE_SIZE, MAX_LFQUEUE_SIZE, NULL },
+	END_OPT,
+};
+
+#if defined(HAVE_LIB_PTHREAD) &&		\
+    defined(HAVE_ATOMIC_LOAD) &&		\
+    defined(HAVE_ATOMIC_STORE) &&		\
+    defined(HAVE_ATOMIC_FETCH_ADD) &&		\
+    defined(HAVE_ATOMIC_COMPARE_EXCHANGE)
+
+typedef struct {
+	uint64_t seq;			/* vyukov cell sequence, fastforward full flag */
+	uint64_t t_enq;			/* enqueue time, 0 = not sampled */
+} stress_lfqueue_cell_t;
+
+/*
+ *  queue state, the enqueue and dequeue positions and the
+ *  run control counters each have their own cacheline
+ */
+typedef struct {
+	stress_lfqueue_cell_t *cells;	/* size cells */
+	uint64_t size;			/* capacity, power of 2 */
+	uint64_t mask;			/* size - 1 */
+	uint64_t head ALIGN64;		/* enqueue position */
+	uint64_t tail ALIGN64;		/* dequeue position */
+	uint64_t produced ALIGN64;	/* items enqueued by finished producers */
+	uint64_t consumed ALIGN64;	/* items dequeued */
+	uint32_t producers_done ALIGN64;/* producers that have finished */
+	uint32_t producers;		/* number of producers */
+	bool start;			/* all threads may start */
+	bool stop;			/* producers should finish */
+} stress_lfqueue_t;
+
+typedef struct {
+	stress_lfqueue_t *q;		/* shared queue */
+	stress_latency_hist_t hist;	/* enqueue to dequeue latency, consumers */
+	pthread_t pthread;		/* thread handle */
+	uint64_t pos;			/* private position, single producer/consumer */
+	uint64_t items;			/* items enqueued or dequeued */
+	uint64_t stamp;			/* items since the last timestamp */
+	size_t method;			/* queue method */
+	uint32_t batch;			/* items per enqueue or dequeue call */
+	int32_t cpu;			/* CPU to pin to, -1 = not pinned */
+	int ret;			/* pthread_create return */
+} stress_lfqueue_thread_t;
+
+typedef struct {
+	uint64_t items;			/* items dequeued */
+	double duration;		/* time spent */
+	stress_latency_hist_t hist;	/* merged consumer latencies */
+} stress_lfqueue_stat_t;
+
+static inline void stress_lfqueue_backoff(uint32_t *spins)
+{
+	if (++(*spins) >= LFQUEUE_SPINS) {
+		*spins = 0;
+		(void)shim_sched_yield();
+	}
+}
+
+static inline uint64_t stress_lfqueue_stamp(stress_lfqueue_thread_t *t)
+{
+	return ((t->stamp++ & LFQUEUE_SAMPLE_MASK) == 0) ? stress_latency_now() : 0;
+}
+
+static inline void stress_lfqueue_record(stress_lfqueue_thread_t *t, const uint64_t t_enq)
+{
+	if (t_enq) {
+		const uint64_t now = stress_latency_now();
+
+		stress_latency_hist_record(&t->hist, (now > t_enq) ? now - t_enq : 0);
+	}
+}
+
+/*
+ *  Lamport single producer single consumer ring, the producer
+ *  publishes the head index and the consumer the tail index,
+ *  each side reads the other side's index once per batch
+ */
+static uint32_t stress_lfqueue_lamport_enqueue(stress_lfqueue_thread_t *t, const uint32_t n)
+{
+	stress_lfqueue_t *q = t->q;
+	const uint64_t tail = __atomic_load_n(&q->tail, __ATOMIC_ACQUIRE);
+	const uint64_t space = q->size - (t->pos - tail);
+	const uint32_t k = (space < n) ? (uint32_t)space : n;
+	uint32_t i;
+
+	for (i = 0; i < k; i++)
+		q->cells[(t->pos + i) & q->mask].t_enq = stress_lfqueue_stamp(t);
+	t->pos += k;
+	__atomic_store_n(&q->head, t->pos, __ATOMIC_RELEASE);
+	return k;
+}
+
+static uint32_t stress_lfqueue_lamport_dequeue(stress_lfqueue_thread_t *t, const uint32_t n)
+{
+	stress_lfqueue_t *q = t->q;
+	const uint64_t head = __atomic_load_n(&q->head, __ATOMIC_ACQUIRE);
+	const uint64_t avail = head - t->pos;
+	const uint32_t k = (avail < n) ? (uint32_t)avail : n;
+	uint32_t i;
+
+	for (i = 0; i < k; i++)
+		stress_lfqueue_record(t, q->cells[(t->pos + i) & q->mask].t_enq);
+	t->pos += k;
+	__atomic_store_n(&q->tail, t->pos, __ATOMIC_RELEASE);
+	return k;
+}
+
+/*
+ *  FastForward single producer single consumer ring, there are
+ *  no shared indices, a cell's full flag is the only handshake
+ */
+static uint32_t stress_lfqueue_ff_enqueue(stress_lfqueue_thread_t *t, const uint32_t n)
+{
+	stress_lfqueue_t *q = t->q;
+	uint32_t i;
+
+	for (i = 0; i < n; i++) {
+		stress_lfqueue_cell_t *cell = &q->cells[t->pos & q->mask];
+
+		if (__atomic_load_n(&cell->seq, __ATOMIC_ACQUIRE))
+			break;
+		cell->t_enq = stress_lfqueue_stamp(t);
+		__atomic_store_n(&cell->seq, 1, __ATOMIC_RELEASE);
+		t->pos++;
+	}
+	return i;
+}
+
+static uint32_t stress_lfqueue_ff_dequeue(stress_lfqueue_thread_t *t, const uint32_t n)
+{
+	stress_lfqueue_t *q = t->q;
+	uint32_t i;
+
+	for (i = 0; i < n; i++) {
+		stress_lfqueue_cell_t *cell = &q->cells[t->pos & q->mask];
+
+		if (!__atomic_load_n(&cell->seq, __ATOMIC_ACQUIRE))
+			break;
+		stress_lfqueue_record(t, cell->t_enq);
+		__atomic_store_n(&cell->seq, 0, __ATOMIC_RELEASE);
+		t->pos++;
+	}
+	return i;
+}
+
+/*
+ *  Multiple producer single consumer ring, producers take a ticket
+ *  with an atomic add and wait for their cell to be free, the single
+ *  consumer needs no atomic read-modify-write operations
+ */
+static uint32_t stress_lfqueue_mpsc_enqueue(stress_lfqueue_thread_t *t, const uint32_t n)
+{
+	stress_lfqueue_t *q = t->q;
+	uint32_t i;
+
+	for (i = 0; i < n; i++) {
+		const uint64_t pos = __atomic_fetch_add(&q->head, 1, __ATOMIC_RELAXED);
+		stress_lfqueue_cell_t *cell = &q->cells[pos & q->mask];
+		uint32_t spins = 0;
+
+		/* a ticket has been taken so the cell must be filled */
+		while (__atomic_load_n(&cell->seq, __ATOMIC_ACQUIRE) != pos)
+			stress_lfqueue_backoff(&spins);
+		cell->t_enq = stress_lfqueue_stamp(t);
+		__atomic_store_n(&cell->seq, pos + 1, __ATOMIC_RELEASE);
+	}
+	return n;
+}
+
+static uint32_t stress_lfqueue_mpsc_dequeue(stress_lfqueue_thread_t *t, const uint32_t n)
+{
+	stress_lfqueue_t *q = t->q;
+	uint32_t i;
+
+	for (i = 0; i < n; i++) {
+		stress_lfqueue_cell_t *cell = &q->cells[t->pos & q->mask];
+
+		if (__atomic_load_n(&cell->seq, __ATOMIC_ACQUIRE) != t->pos + 1)
+			break;
+		stress_lfqueue_record(t, cell->t_enq);
+		__atomic_store_n(&cell->seq, t->pos + q->size, __ATOMIC_RELEASE);
+		t->pos++;
+	}
+	return i;
+}
+
+/*
+ *  Vyukov bounded multiple producer multiple consumer ring, each
+ *  cell's sequence tells whether it is free for the enqueue position
+ *  or full for the dequeue position, positions are claimed with CAS
+ */
+static uint32_t stress_lfqueue_mpmc_enqueue(stress_lfqueue_thread_t *t, const uint32_t n)
+{
+	stress_lfqueue_t *q = t->q;
+	uint32_t i;
+
+	for (i = 0; i < n; i++) {
+		uint64_t pos = __atomic_load_n(&q->head, __ATOMIC_RELAXED);
+		stress_lfqueue_cell_t *cell;
+
+		for (;;) {
+			int64_t diff;
+
+			cell = &q->cells[pos & q->mask];
+			diff = (int64_t)(__atomic_load_n(&cell->seq, __ATOMIC_ACQUIRE) - pos);
+			if (diff == 0) {
+				if (__atomic_compare_exchange_n(&q->head, &pos, pos + 1, true,
+								__ATOMIC_RELAXED, __ATOMIC_RELAXED))
+					break;
+			} else if (diff < 0) {
+				return i;	/* full */
+			} else {
+				pos = __atomic_load_n(&q->head, __ATOMIC_RELAXED);
+			}
+		}
+		cell->t_enq = stress_lfqueue_stamp(t);
+		__atomic_store_n(&cell->seq, pos + 1, __ATOMIC_RELEASE);
+	}
+	return i;
+}
+
+static uint32_t stress_lfqueue_mpmc_dequeue(stress_lfqueue_thread_t *t, const uint32_t n)
+{
+	stress_lfqueue_t *q = t->q;
+	uint32_t i;
+
+	for (i = 0; i < n; i++) {
+		uint64_t pos = __atomic_load_n(&q->tail, __ATOMIC_RELAXED);
+		stress_lfqueue_cell_t *cell;
+
+		for (;;) {
+			int64_t diff;
+
+			cell = &q->cells[pos & q->mask];
+			diff = (int64_t)(__atomic_load_n(&cell->seq, __ATOMIC_ACQUIRE) - (pos + 1));
+			if (diff == 0) {
+				if (__atomic_compare_exchange_n(&q->tail, &pos, pos + 1, true,
+								__ATOMIC_RELAXED, __ATOMIC_RELAXED))
+					break;
+			} else if (diff < 0) {
+				return i;	/* empty */
+			} else {
+				pos = __atomic_load_n(&q->tail, __ATOMIC_RELAXED);
+			}
+		}
+		stress_lfqueue_record(t, cell->t_enq);
+		__atomic_store_n(&cell->seq, pos + q->mask + 1, __ATOMIC_RELEASE);
+	}
+	return i;
+}
+
+typedef uint32_t (*stress_lfqueue_func_t)(stress_lfqueue_thread_t *t, const uint32_t n);
+
+static const stress_lfqueue_func_t stress_lfqueue_enqueue[LFQUEUE_METHODS] = {
+	NULL,
+	stress_lfqueue_lamport_enqueue,
+	stress_lfqueue_ff_enqueue,
+	stress_lfqueue_mpsc_enqueue,
+	stress_lfqueue_mpmc_enqueue,
+};
+
+static const stress_lfqueue_func_t stress_lfqueue_dequeue[LFQUEUE_METHODS] = {
+	NULL,
+	stress_lfqueue_lamport_dequeue,
+	stress_lfqueue_ff_dequeue,
+	stress_lfqueue_mpsc_dequeue,
+	stress_lfqueue_mpmc_dequeue,
+};
+
+/*
+ *  stress_lfqueue_wait_start()
+ *	wait for the coordinator to start the round
+ */
+static void stress_lfqueue_wait_start(stress_lfqueue_thread_t *t)
+{
+	uint32_t spins = 0;
+
+	stress_placement_set(t->cpu);
+	while (!__atomic_load_n(&t->q->start, __ATOMIC_ACQUIRE))
+		stress_lfqueue_backoff(&spins);
+}
+
+static void *stress_lfqueue_producer(void *arg)
+{
+	stress_lfqueue_thread_t *t = (stress_lfqueue_thread_t *)arg;
+	stress_lfqueue_t *q = t->q;
+	const stress_lfqueue_func_t enqueue = stress_lfqueue_enqueue[t->method];
+	uint32_t spins = 0;
+
+	stress_lfqueue_wait_start(t);
+	while (!__atomic_load_n(&q->stop, __ATOMIC_RELAXED)) {
+		const uint32_t k = enqueue(t, t->batch);
+
+		if (k)
+			t->items += k;
+		else
+			stress_lfqueue_backoff(&spins);
+	}
+	(void)__atomic_fetch_add(&q->produced, t->items, __ATOMIC_RELEASE);
+	(void)__atomic_fetch_add(&q->producers_done, 1, __ATOMIC_RELEASE);
+	return &g_nowt;
+}
+
+static void *stress_lfqueue_consumer(void *arg)
+{
+	stress_lfqueue_thread_t *t = (stress_lfqueue_thread_t *)arg;
+	stress_lfqueue_t *q = t->q;
+	const stress_lfqueue_func_t dequeue = stress_lfqueue_dequeue[t->method];
+	uint64_t unflushed = 0;
+	uint32_t spins = 0;
+
+	stress_lfqueue_wait_start(t);
+	for (;;) {
+		const uint32_t k = dequeue(t, t->batch);
+
+		if (k) {
+			t->items += k;
+			unflushed += k;
+			continue;
+		}
+		/* empty, finish once all producers are done and drained */
+		if (unflushed) {
+			(void)__atomic_fetch_add(&q->consumed, unflushed, __ATOMIC_RELEASE);
+			unflushed = 0;
+		}
+		if ((__atomic_load_n(&q->producers_done, __ATOMIC_ACQUIRE) == q->producers) &&
+		    (__atomic_load_n(&q->consumed, __ATOMIC_ACQUIRE) ==
+		     __atomic_load_n(&q->produced, __ATOMIC_ACQUIRE)))
+			break;
+		stress_lfqueue_backoff(&spins);
+	}
+	return &g_nowt;
+}
+
+/*
+ *  stress_lfqueue_round()
+ *	run producers and consumers through one queue method with
+ *	one batch size for a time slice, returns 0 if ok, -EAGAIN
+ *	if threads could not be created or -1 on a lost item
+ */
+static int stress_lfqueue_round(
+	stress_args_t *args,
+	stress_lfqueue_t *q,
+	stress_lfqueue_thread_t *threads,
+	const size_t method,
+	const uint32_t batch,
+	const uint32_t producers,
+	const uint32_t consumers,
+	stress_lfqueue_stat_t *stat)
+{
+	const uint32_t n_threads = producers + consumers;
+	uint64_t i, consumed = 0;
+	uint32_t j, created = 0;
+	double t_start, t_end;
+	int rc = 0;
+
+	q->head = 0;
+	q->tail = 0;
+	q->produced = 0;
+	q->consumed = 0;
+	q->producers_done = 0;
+	q->producers = producers;
+	q->start = false;
+	q->stop = false;
+	for (i = 0; i < q->size; i++) {
+		q->cells[i].seq = (method == LFQUEUE_METHOD_FF) ? 0 : i;
+		q->cells[i].t_enq = 0;
+	}
+
+	for (j = 0; j < n_threads; j++) {
+		stress_lfqueue_thread_t *t = &threads[j];
+		const bool producer = (j < producers);
+
+		t->q = q;
+		t->pos = 0;
+		t->items = 0;
+		t->stamp = 0;
+		t->method = method;
+		t->batch = batch;
+		t->cpu = stress_placement_cpu(j);
+		stress_latency_hist_init(&t->hist);
+		t->ret = pthread_create(&t->pthread, NULL,
+			producer ? stress_lfqueue_producer : stress_lfqueue_consumer, t);
+		if (t->ret)
+			break;
+		created++;
+	}
+	if (created < n_threads) {
+		/* stop and reap the threads that did start */
+		q->producers = (created < producers) ? created : producers;
+		__atomic_store_n(&q->stop, true, __ATOMIC_RELAXED);
+		__atomic_store_n(&q->start, true, __ATOMIC_RELEASE);
+		for (j = 0; j < created; j++)
+			(void)pthread_join(threads[j].pthread, NULL);
+		if (args->instance == 0)
+			pr_inf_skip("%s: cannot create %" PRIu32 " threads, errno=%d (%s), "
+				"skipping stressor\n", args->name, n_threads,
+				threads[created].ret, strerror(threads[created].ret));
+		return -EAGAIN;
+	}
+
+	t_start = stress_time_now();
+	__atomic_store_n(&q->start, true, __ATOMIC_RELEASE);
+	for (i = 0; (i < LFQUEUE_SLICE_USEC / 10000) && stress_continue_flag(); i++)
+		(void)shim_usleep(10000);
+	__atomic_store_n(&q->stop, true, __ATOMIC_RELAXED);
+	for (j = 0; j < created; j++) {
+		(void)pthread_join(threads[j].pthread, NULL);
+		if (j >= producers) {
+			consumed += threads[j].items;
+			stress_latency_hist_merge(&stat->hist, &threads[j].hist);
+		}
+	}
+	t_end = stress_time_now();
+
+	if (consumed != q->produced) {
+		pr_fail("%s: %s queue enqueued %" PRIu64 " items but dequeued %" PRIu64 "\n",
+			args->name, stress_lfqueue_methods[method], q->produced, consumed);
+		rc = -1;
+	}
+	stat->items += consumed;
+	stat->duration += t_end - t_start;
+	stress_bogo_inc(args);
+
+	return rc;
+}
+
+/*
+ *  stress_lfqueue()
+ *	stress userspace lock-free queues between threads
+ */
+static int stress_lfqueue(stress_args_t *args)
+{
+	stress_lfqueue_t *q;
+	stress_lfqueue_thread_t *threads;
+	stress_lfqueue_stat_t *stats;
+	size_t lfqueue_method = LFQUEUE_METHOD_ALL;
+	size_t lfqueue_placement = STRESS_PLACEMENT_NONE;
+	uint32_t lfqueue_producers = DEFAULT_LFQUEUE_THREADS;
+	uint32_t lfqueue_consumers = DEFAULT_LFQUEUE_THREADS;
+	uint32_t lfqueue_size = DEFAULT_LFQUEUE_SIZE;
+	uint32_t n_cpus;
+	size_t method, i, idx;
+	size_t cells_size;
+	int rc = EXIT_SUCCESS;
+
+	(void)stress_get_setting("lfqueue-method", &lfqueue_method);
+	(void)stress_get_setting("lfqueue-placement", &lfqueue_placement);
+	if (!stress_get_setting("lfqueue-producers", &lfqueue_producers)) {
+		if (g_opt_flags & OPT_FLAGS_MAXIMIZE)
+			lfqueue_producers = MAX_LFQUEUE_THREADS;
+		if (g_opt_flags & OPT_FLAGS_MINIMIZE)
+			lfqueue_producers = MIN_LFQUEUE_THREADS;
+	}
+	if (!stress_get_setting("lfqueue-consumers", &lfqueue_consumers)) {
+		if (g_opt_flags & OPT_FLAGS_MAXIMIZE)
+			lfqueue_consumers = MAX_LFQUEUE_THREADS;
+		if (g_opt_flags & OPT_FLAGS_MINIMIZE)
+			lfqueue_consumers = MIN_LFQUEUE_THREADS;
+	}
+	(void)stress_get_setting("lfqueue-size", &lfqueue_size);
+	lfqueue_size = stress_nextpwr2(lfqueue_size);
+
+	q = (stress_lfqueue_t *)stress_mmap_populate(NULL, sizeof(*q),
+		PROT_READ | PROT_WRITE, MAP_ANONYMOUS | MAP_PRIVATE, -1, 0);
+	if (q == MAP_FAILED) {
+		pr_inf_skip("%s: cannot mmap %zu bytes, errno=%d (%s), skipping stressor\n",
+			args->name, sizeof(*q), errno, strerror(errno));
+		return EXIT_NO_RESOURCE;
+	}
+	stress_set_vma_anon_name(q, sizeof(*q), "lfqueue-state");
+	cells_size = (size_t)lfqueue_size * sizeof(*q->cells);
+	q->cells = (stress_lfqueue_cell_t *)stress_mmap_populate(NULL, cells_size,
+		PROT_READ | PROT_WRITE, MAP_ANONYMOUS | MAP_PRIVATE, -1, 0);
+	if (q->cells == MAP_FAILED) {
+		pr_inf_skip("%s: cannot mmap %zu byte queue, errno=%d (%s), skipping stressor\n",
+			args->name, cells_size, errno, strerror(errno));
+		(void)munmap((void *)q, sizeof(*q));
+		return EXIT_NO_RESOURCE;
+	}
+	stress_set_vma_anon_name(q->cells, cells_size, "lfqueue-cells");
+	q->size = lfqueue_size;
+	q->mask = lfqueue_size - 1;
+
+	threads = (stress_lfqueue_thread_t *)calloc(MAX_LFQUEUE_THREADS * 2, sizeof(*threads));
+	stats = (stress_lfqueue_stat_t *)calloc(LFQUEUE_METHODS * LFQUEUE_BATCHES, sizeof(*stats));
+	if (!threads || !stats) {
+		pr_inf_skip("%s: cannot allocate thread and statistics data, skipping stressor\n",
+			args->name);
+		rc = EXIT_NO_RESOURCE;
+		goto tidy;
+	}
+	for (i = 0; i < LFQUEUE_METHODS * LFQUEUE_BATCHES; i++)
+		stress_latency_hist_init(&stats[i].hist);
+
+	n_cpus = stress_placement_init((stress_placement_policy_t)lfqueue_placement);
+	if (args->instance == 0) {
+		if (n_cpus)
+			pr_inf("%s: %s placement over %" PRIu32 " CPUs, first producer to "
+				"first consumer distance %s\n", args->name,
+				stress_placement_name((stress_placement_policy_t)lfqueue_placement), n_cpus,
+				stress_cpu_distance_name(stress_cpu_distance(stress_placement_cpu(0),
+					stress_placement_cpu(lfqueue_producers))));
+		else
+			pr_inf("%s: threads not pinned, use --lfqueue-placement to place "
+				"producers and consumers by topology\n", args->name);
+	}
+
+	stress_set_proc_state(args->name, STRESS_STATE_SYNC_WAIT);
+	stress_sync_start_wait(args);
+	stress_set_proc_state(args->name, STRESS_STATE_RUN);
+
+	method = LFQUEUE_METHOD_ALL;
+	do {
+		if (lfqueue_method == LFQUEUE_METHOD_ALL)
+			method = (method % (LFQUEUE_METHODS - 1)) + 1;
+		else
+			method = lfqueue_method;
+
+		for (i = 0; (i < LFQUEUE_BATCHES) && stress_continue(args); i++) {
+			const uint32_t producers = (method <= LFQUEUE_METHOD_FF) ? 1 : lfqueue_producers;
+			const uint32_t consumers = (method <= LFQUEUE_METHOD_MPSC) ? 1 : lfqueue_consumers;
+
+			const int ret = stress_lfqueue_round(args, q, threads, method,
+				stress_lfqueue_batches[i], producers, consumers,
+				&stats[(method * LFQUEUE_BATCHES) + i]);
+
+			if (ret < 0) {
+				rc = (ret == -EAGAIN) ? EXIT_NO_RESOURCE : EXIT_FAILURE;
+				goto done;
+			}
+		}
+	} while (stress_continue(args));
+done:
+	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
+	stress_placement_deinit();
+
+	if (args->instance == 0)
+		pr_inf("%s: %-12s %5s %14s %10s %10s\n", args->name,
+			"queue", "batch", "items/sec", "lat p50ns", "lat p99ns");
+	for (idx = 0, method = 1; method < LFQUEUE_METHODS; method++) {
+		for (i = 0; i < LFQUEUE_BATCHES; i++) {
+			const stress_lfqueue_stat_t *stat = &stats[(method * LFQUEUE_BATCHES) + i];
+			const double rate = (stat->duration > 0.0) ? (double)stat->items / stat->duration : 0.0;
+			const double p50 = (double)stress_latency_hist_percentile(&stat->hist, 50.0);
+			const double p99 = (double)stress_latency_hist_percentile(&stat->hist, 99.0);
+			char desc[64];
+
+			if (!stat->items)
+				continue;
+			if (args->instance == 0)
+				pr_inf("%s: %-12s %5" PRIu32 " %14.0f %10.0f %10.0f\n", args->name,
+					stress_lfqueue_methods[method], stress_lfqueue_batches[i],
+					rate, p50, p99);
+			if ((i != 0) && (i != LFQUEUE_BATCHES - 1))
+				continue;
+			(void)snprintf(desc, sizeof(desc), "%s batch %" PRIu32 " items per sec",
+				stress_lfqueue_methods[method], stress_lfqueue_batches[i]);
+			stress_metrics_set(args, idx++, desc, rate, STRESS_METRIC_HARMONIC_MEAN);
+			if (i == 0) {
+				(void)snprintf(desc, sizeof(desc), "%s batch %" PRIu32 " latency p50 nsec",
+					stress_lfqueue_methods[method], stress_lfqueue_batches[i]);
+				stress_metrics_set(args, idx++, desc, p50, STRESS_METRIC_GEOMETRIC_MEAN);
+			}
+		}
+	}
+
+tidy:
+	free(stats);
+	free(threads);
+	(void)munmap((void *)q->cells, cells_size);
+	(void)munmap((void *)q, sizeof(*q));
+
+	return rc;
+}
+
+const stressor_info_t stress_lfqueue_info = {
+	.stressor = stress_lfqueue,
+	.class = CLASS_CPU_CACHE | CLASS_IPC,
+	.opts = opts,
+	.verify = VERIFY_ALWAYS,
+	.metrics_max = (LFQUEUE_METHODS - 1) * 3,
+	.help = help
+};
+#else
+const stressor_info_t stress_lfqueue_info = {
+	.stressor = stress_unimplemented,
+	.class = CLASS_CPU_CACHE | CLASS_IPC,
+	.opts = opts,
+	.verify = VERIFY_ALWAYS,
+	.help = help,
+	.unimplemented_reason = "built without pthread or atomic load, store, add or compare exchange support"
+};
+#endif
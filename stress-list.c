@@ -28,8 +28,24 @@
 #define MAX_LIST_SIZE		(1000000)
 #define DEFAULT_LIST_SIZE	(5000)
 
+#define LIST_LAYOUT_ARENA		(0)
+#define LIST_LAYOUT_ARENA_SHUFFLED	(1)
+#define LIST_LAYOUT_HEAP		(2)
+
+/*
+ *  Node layouts, arena places the nodes contiguously in insertion order,
+ *  arena-shuffled places them contiguously in random insertion order and
+ *  heap allocates each node individually
+ */
+static const char * const list_layouts[] = {
+	"arena",
+	"arena-shuffled",
+	"heap",
+};
+
 static const stress_help_t help[] = {
 	{ NULL,	"list N",	 "start N workers that exercise list structures" },
+	{ NULL,	"list-layout L", "select node layout: arena, arena-shuffled, heap" },
 	{ NULL,	"list-method M", "select list method: all, circleq, list, slist, slistt, stailq, tailq" },
 	{ NULL,	"list-ops N",	 "stop after N bogo list operations" },
 	{ NULL,	"list-size N",	 "N is the number of items in the list" },
@@ -127,8 +143,8 @@ typedef struct list_entry {
 } list_entry_t;
 
 typedef int (*stress_list_func)(stress_args_t *args,
-				list_entry_t *entries,
-				const list_entry_t *entries_end,
+				list_entry_t **order,
+				const size_t n,
 				stress_metrics_t *metrics);
 
 typedef struct {
@@ -154,26 +170,30 @@ static void MLOCKED_TEXT stress_list_handler(int signum)
 
 static int OPTIMIZE3 stress_list_slistt(
 	stress_args_t *args,
-	list_entry_t *entries,
-	const list_entry_t *entries_end,
+	list_entry_t **order,
+	const size_t n,
 	stress_metrics_t *metrics)
 {
 	register list_entry_t *entry, *head, *tail;
+	size_t i;
 	bool found = false;
 	double t;
 	int rc = EXIT_SUCCESS;
 
-	head = entries;
-	tail = entries;
-	for (entry = entries + 1; entry < entries_end; entry++) {
-		tail->u.next = entry;
-		tail = entry;
+	head = order[0];
+	tail = head;
+	for (i = 1; i < n; i++) {
+		tail->u.next = order[i];
+		tail = order[i];
 	}
+	tail->u.next = NULL;
 
 	t = stress_time_now();
-	for (entry = head; entry < entries_end; entry++) {
+	for (i = 0; i < n; i++) {
 		register list_entry_t *find;
 
+		entry = order[i];
+
 		for (find = head; find; find = find->u.next) {
 			if (UNLIKELY(find == entry)) {
 				found = true;
@@ -183,13 +203,13 @@ static int OPTIMIZE3 stress_list_slistt(
 
 		if (UNLIKELY(!found)) {
 			pr_fail("%s: slistt entry #%zd not found\n",
-				args->name, entry - entries);
+				args->name, i);
 			rc = EXIT_FAILURE;
 			break;
 		}
 	}
 	metrics->duration += stress_time_now() - t;
-	metrics->count += (double)(entry - entries);
+	metrics->count += (double)i;
 
 	while (head) {
 		register list_entry_t *next = head->u.next;
@@ -203,11 +223,12 @@ static int OPTIMIZE3 stress_list_slistt(
 #if defined(HAVE_SYS_QUEUE_LIST)
 static int OPTIMIZE3 stress_list_list(
 	stress_args_t *args,
-	list_entry_t *entries,
-	const list_entry_t *entries_end,
+	list_entry_t **order,
+	const size_t n,
 	stress_metrics_t *metrics)
 {
 	register list_entry_t *entry;
+	size_t i;
 	struct listhead head;
 	bool found = false;
 	double t;
@@ -216,14 +237,16 @@ static int OPTIMIZE3 stress_list_list(
 	(void)shim_memset(&head, 0, sizeof(head));
 	LIST_INIT(&head);
 
-	for (entry = entries; entry < entries_end; entry++) {
-		LIST_INSERT_HEAD(&head, entry, u.list_entries);
+	for (i = 0; i < n; i++) {
+		LIST_INSERT_HEAD(&head, order[i], u.list_entries);
 	}
 
 	t = stress_time_now();
-	for (entry = entries; entry < entries_end; entry++) {
+	for (i = 0; i < n; i++) {
 		register list_entry_t *find;
 
+		entry = order[i];
+
 		LIST_FOREACH(find, &head, u.list_entries) {
 			if (UNLIKELY(find == entry)) {
 				found = true;
@@ -233,13 +256,13 @@ static int OPTIMIZE3 stress_list_list(
 
 		if (UNLIKELY(!found)) {
 			pr_fail("%s: list entry #%zd not found\n",
-				args->name, entry - entries);
+				args->name, i);
 			rc = EXIT_FAILURE;
 			break;
 		}
 	}
 	metrics->duration += stress_time_now() - t;
-	metrics->count += (double)(entry - entries);
+	metrics->count += (double)i;
 
 	while (!LIST_EMPTY(&head)) {
 		entry = (list_entry_t *)LIST_FIRST(&head);
@@ -254,11 +277,12 @@ static int OPTIMIZE3 stress_list_list(
 #if defined(HAVE_SYS_QUEUE_SLIST)
 static int OPTIMIZE3 stress_list_slist(
 	stress_args_t *args,
-	list_entry_t *entries,
-	const list_entry_t *entries_end,
+	list_entry_t **order,
+	const size_t n,
 	stress_metrics_t *metrics)
 {
 	register list_entry_t *entry;
+	size_t i;
 	struct slisthead head;
 	bool found = false;
 	double t;
@@ -267,14 +291,16 @@ static int OPTIMIZE3 stress_list_slist(
 	(void)shim_memset(&head, 0, sizeof(head));
 	SLIST_INIT(&head);
 
-	for (entry = entries; entry < entries_end; entry++) {
-		SLIST_INSERT_HEAD(&head, entry, u.slist_entries);
+	for (i = 0; i < n; i++) {
+		SLIST_INSERT_HEAD(&head, order[i], u.slist_entries);
 	}
 
 	t = stress_time_now();
-	for (entry = entries; entry < entries_end; entry++) {
+	for (i = 0; i < n; i++) {
 		register list_entry_t *find;
 
+		entry = order[i];
+
 		SLIST_FOREACH(find, &head, u.slist_entries) {
 			if (UNLIKELY(find == entry)) {
 				found = true;
@@ -284,13 +310,13 @@ static int OPTIMIZE3 stress_list_slist(
 
 		if (UNLIKELY(!found)) {
 			pr_fail("%s: slist entry #%zd not found\n",
-				args->name, entry - entries);
+				args->name, i);
 			rc = EXIT_FAILURE;
 			break;
 		}
 	}
 	metrics->duration += stress_time_now() - t;
-	metrics->count += (double)(entry - entries);
+	metrics->count += (double)i;
 
 	while (!SLIST_EMPTY(&head)) {
 		SLIST_REMOVE_HEAD(&head, u.slist_entries);
@@ -304,11 +330,12 @@ static int OPTIMIZE3 stress_list_slist(
 #if defined(HAVE_SYS_QUEUE_CIRCLEQ)
 static int OPTIMIZE3 stress_list_circleq(
 	stress_args_t *args,
-	list_entry_t *entries,
-	const list_entry_t *entries_end,
+	list_entry_t **order,
+	const size_t n,
 	stress_metrics_t *metrics)
 {
 	register list_entry_t *entry;
+	size_t i;
 	struct circleqhead head;
 	bool found = false;
 	double t;
@@ -317,14 +344,16 @@ static int OPTIMIZE3 stress_list_circleq(
 	(void)shim_memset(&head, 0, sizeof(head));
 	CIRCLEQ_INIT(&head);
 
-	for (entry = entries; entry < entries_end; entry++) {
-		CIRCLEQ_INSERT_TAIL(&head, entry, u.circleq_entries);
+	for (i = 0; i < n; i++) {
+		CIRCLEQ_INSERT_TAIL(&head, order[i], u.circleq_entries);
 	}
 
 	t = stress_time_now();
-	for (entry = entries; entry < entries_end; entry++) {
+	for (i = 0; i < n; i++) {
 		register const list_entry_t *find;
 
+		entry = order[i];
+
 		CIRCLEQ_FOREACH(find, &head, u.circleq_entries) {
 			if (UNLIKELY(find == entry)) {
 				found = true;
@@ -334,13 +363,13 @@ static int OPTIMIZE3 stress_list_circleq(
 
 		if (UNLIKELY(!found)) {
 			pr_fail("%s: circleq entry #%zd not found\n",
-				args->name, entry - entries);
+				args->name, i);
 			rc = EXIT_FAILURE;
 			break;
 		}
 	}
 	metrics->duration += stress_time_now() - t;
-	metrics->count += (double)(entry - entries);
+	metrics->count += (double)i;
 
 	while ((entry = (list_entry_t *)CIRCLEQ_FIRST(&head)) != (list_entry_t *)&head) {
 		CIRCLEQ_REMOVE(&head, entry, u.circleq_entries);
@@ -354,11 +383,12 @@ static int OPTIMIZE3 stress_list_circleq(
 #if defined(HAVE_SYS_QUEUE_STAILQ)
 static int OPTIMIZE3 stress_list_stailq(
 	stress_args_t *args,
-	list_entry_t *entries,
-	const list_entry_t *entries_end,
+	list_entry_t **order,
+	const size_t n,
 	stress_metrics_t *metrics)
 {
 	register list_entry_t *entry;
+	size_t i;
 	struct stailhead head;
 	bool found = false;
 	double t;
@@ -367,14 +397,16 @@ static int OPTIMIZE3 stress_list_stailq(
 	(void)shim_memset(&head, 0, sizeof(head));
 	STAILQ_INIT(&head);
 
-	for (entry = entries; entry < entries_end; entry++) {
-		STAILQ_INSERT_TAIL(&head, entry, u.stailq_entries);
+	for (i = 0; i < n; i++) {
+		STAILQ_INSERT_TAIL(&head, order[i], u.stailq_entries);
 	}
 
 	t = stress_time_now();
-	for (entry = entries; entry < entries_end; entry++) {
+	for (i = 0; i < n; i++) {
 		register list_entry_t *find;
 
+		entry = order[i];
+
 		STAILQ_FOREACH(find, &head, u.stailq_entries) {
 			if (UNLIKELY(find == entry)) {
 				found = true;
@@ -384,13 +416,13 @@ static int OPTIMIZE3 stress_list_stailq(
 
 		if (UNLIKELY(!found)) {
 			pr_fail("%s: stailq entry #%zd not found\n",
-				args->name, entry - entries);
+				args->name, i);
 			rc = EXIT_FAILURE;
 			break;
 		}
 	}
 	metrics->duration += stress_time_now() - t;
-	metrics->count += (double)(entry - entries);
+	metrics->count += (double)i;
 
 	while ((entry = (list_entry_t *)STAILQ_FIRST(&head)) != NULL) {
 		STAILQ_REMOVE(&head, entry, list_entry, u.stailq_entries);
@@ -404,11 +436,12 @@ static int OPTIMIZE3 stress_list_stailq(
 #if defined(HAVE_SYS_QUEUE_TAILQ)
 static int OPTIMIZE3 stress_list_tailq(
 	stress_args_t *args,
-	list_entry_t *entries,
-	const list_entry_t *entries_end,
+	list_entry_t **order,
+	const size_t n,
 	stress_metrics_t *metrics)
 {
 	register list_entry_t *entry;
+	size_t i;
 	struct tailhead head;
 	bool found = false;
 	double t;
@@ -417,14 +450,16 @@ static int OPTIMIZE3 stress_list_tailq(
 	(void)shim_memset(&head, 0, sizeof(head));
 	TAILQ_INIT(&head);
 
-	for (entry = entries; entry < entries_end; entry++) {
-		TAILQ_INSERT_TAIL(&head, entry, u.tailq_entries);
+	for (i = 0; i < n; i++) {
+		TAILQ_INSERT_TAIL(&head, order[i], u.tailq_entries);
 	}
 
 	t = stress_time_now();
-	for (entry = entries; entry < entries_end; entry++) {
+	for (i = 0; i < n; i++) {
 		register list_entry_t *find;
 
+		entry = order[i];
+
 		TAILQ_FOREACH(find, &head, u.tailq_entries) {
 			if (UNLIKELY(find == entry)) {
 				found = true;
@@ -434,13 +469,13 @@ static int OPTIMIZE3 stress_list_tailq(
 
 		if (UNLIKELY(!found)) {
 			pr_fail("%s: tailq entry #%zd not found\n",
-				args->name, entry - entries);
+				args->name, i);
 			rc = EXIT_FAILURE;
 			break;
 		}
 	}
 	metrics->duration += stress_time_now() - t;
-	metrics->count += (double)(entry - entries);
+	metrics->count += (double)i;
 
 	while ((entry = (list_entry_t *)TAILQ_FIRST(&head)) != NULL) {
 		TAILQ_REMOVE(&head, entry, u.tailq_entries);
@@ -453,8 +488,8 @@ static int OPTIMIZE3 stress_list_tailq(
 
 static int stress_list_all(
 	stress_args_t *args,
-	list_entry_t *entries,
-	const list_entry_t *entries_end,
+	list_entry_t **order,
+	const size_t n,
 	stress_metrics_t *metrics);
 
 
@@ -483,14 +518,14 @@ static const stress_list_method_info_t list_methods[] = {
 
 static int stress_list_all(
 	stress_args_t *args,
-	list_entry_t *entries,
-	const list_entry_t *entries_end,
+	list_entry_t **order,
+	const size_t n,
 	stress_metrics_t *metrics)
 {
 	static size_t idx = 1;
 	int rc;
 
-	rc = list_methods[idx].func(args, entries, entries_end, &metrics[idx]);
+	rc = list_methods[idx].func(args, order, n, &metrics[idx]);
 	idx++;
 	if (UNLIKELY(idx >= SIZEOF_ARRAY(list_methods)))
 		idx = 1;
@@ -503,12 +538,35 @@ static const char *stress_list_method(const size_t i)
 	return (i < SIZEOF_ARRAY(list_methods)) ? list_methods[i].name : NULL;
 }
 
+static const char *stress_list_layout(const size_t i)
+{
+	return (i < SIZEOF_ARRAY(list_layouts)) ? list_layouts[i] : NULL;
+}
+
 static const stress_opt_t opts[] = {
+	{ OPT_list_layout, "list-layout", TYPE_ID_SIZE_T_METHOD, 0, 0, stress_list_layout },
 	{ OPT_list_method, "list-method", TYPE_ID_SIZE_T_METHOD, 0, 0, stress_list_method },
 	{ OPT_list_size,   "list-size",   TYPE_ID_UINT64, MIN_LIST_SIZE, MAX_LIST_SIZE, NULL },
 	END_OPT,
 };
 
+/*
+ *  stress_list_free()
+ *	free list nodes, either the arena or the individual heap nodes
+ */
+static void stress_list_free(list_entry_t *arena, list_entry_t **order, const size_t n)
+{
+	if (arena) {
+		free(arena);
+	} else {
+		size_t i;
+
+		for (i = 0; i < n; i++)
+			free(order[i]);
+	}
+	free(order);
+}
+
 /*
  *  stress_list()
  *	stress list
@@ -516,8 +574,9 @@ static const stress_opt_t opts[] = {
 static int stress_list(stress_args_t *args)
 {
 	uint64_t v, list_size = DEFAULT_LIST_SIZE;
-	list_entry_t *entries, *entry, *entries_end;
-	size_t n, i, j, bit, list_method = 0;
+	NOCLOBBER list_entry_t *arena;
+	list_entry_t **order;
+	size_t n, i, j, bit, list_method = 0, list_layout = LIST_LAYOUT_ARENA;
 	struct sigaction old_action;
 	int ret;
 	NOCLOBBER int rc = EXIT_SUCCESS;
@@ -526,6 +585,8 @@ static int stress_list(stress_args_t *args)
 
 	stress_zero_metrics(list_metrics, SIZEOF_ARRAY(list_metrics));
 
+	arena = NULL;
+	(void)stress_get_setting("list-layout", &list_layout);
 	(void)stress_get_setting("list-method", &list_method);
 	func = list_methods[list_method].func;
 	metrics = &list_metrics[list_method];
@@ -538,13 +599,42 @@ static int stress_list(stress_args_t *args)
 	}
 	n = (size_t)list_size;
 
-	entries = (list_entry_t *)calloc(n, sizeof(*entries));
-	if (!entries) {
-		pr_inf_skip("%s: malloc failed allocating %zu list entries, "
+	order = (list_entry_t **)calloc(n, sizeof(*order));
+	if (!order) {
+		pr_inf_skip("%s: malloc failed allocating %zu list entry pointers, "
 			"out of memory, skipping stressor\n", args->name, n);
 		return EXIT_NO_RESOURCE;
 	}
-	entries_end = entries + n;
+	if (list_layout == LIST_LAYOUT_HEAP) {
+		for (i = 0; i < n; i++) {
+			order[i] = (list_entry_t *)calloc(1, sizeof(*order[i]));
+			if (!order[i]) {
+				pr_inf_skip("%s: malloc failed allocating %zu list entries, "
+					"out of memory, skipping stressor\n", args->name, n);
+				stress_list_free(NULL, order, i);
+				return EXIT_NO_RESOURCE;
+			}
+		}
+	} else {
+		arena = (list_entry_t *)calloc(n, sizeof(*arena));
+		if (!arena) {
+			pr_inf_skip("%s: malloc failed allocating %zu list entries, "
+				"out of memory, skipping stressor\n", args->name, n);
+			free(order);
+			return EXIT_NO_RESOURCE;
+		}
+		for (i = 0; i < n; i++)
+			order[i] = &arena[i];
+		if (list_layout == LIST_LAYOUT_ARENA_SHUFFLED) {
+			for (i = n - 1; i > 0; i--) {
+				const size_t k = (size_t)stress_mwc32modn((uint32_t)(i + 1));
+				list_entry_t *tmp = order[i];
+
+				order[i] = order[k];
+				order[k] = tmp;
+			}
+		}
+	}
 
 	ret = sigsetjmp(jmp_env, 1);
 	if (ret) {
@@ -555,12 +645,14 @@ static int stress_list(stress_args_t *args)
 		goto tidy;
 	}
 	if (stress_sighandler(args->name, SIGALRM, stress_list_handler, &old_action) < 0) {
-		free(entries);
+		stress_list_free(arena, order, n);
 		return EXIT_FAILURE;
 	}
 
 	v = 0;
-	for (entry = entries, bit = 0; entry < entries_end; entry++) {
+	for (i = 0, bit = 0; i < n; i++) {
+		list_entry_t *entry = order[i];
+
 		if (!bit) {
 			v = stress_mwc64();
 			bit = 1;
@@ -579,13 +671,14 @@ static int stress_list(stress_args_t *args)
 	do {
 		uint64_t rnd;
 
-		if (func(args, entries, entries_end, metrics) == EXIT_FAILURE) {
+		if (func(args, order, n, metrics) == EXIT_FAILURE) {
 			rc = EXIT_FAILURE;
 			break;
 		}
 
 		rnd = stress_mwc64();
-		for (entry = entries; entry < entries_end; entry++) {
+		for (i = 0; i < n; i++) {
+			register list_entry_t *entry = order[i];
 			register uint64_t value = entry->value ^ rnd;
 
 			entry->value = shim_ror64(value);
@@ -602,15 +695,23 @@ tidy:
 			char msg[64];
 			const double rate = list_metrics[i].count / list_metrics[i].duration;
 
+			/* each full pass of n searches visits n * (n + 1) / 2 nodes */
+			const double nodes = list_metrics[i].count * ((double)n + 1.0) / 2.0;
+
 			(void)snprintf(msg, sizeof(msg), "%s searches per second", list_methods[i].name);
 			stress_metrics_set(args, j, msg,
 				rate, STRESS_METRIC_HARMONIC_MEAN);
 			j++;
+			(void)snprintf(msg, sizeof(msg), "%s nanosecs per node traversed", list_methods[i].name);
+			stress_metrics_set(args, j, msg,
+				(list_metrics[i].duration * STRESS_DBL_NANOSECOND) / nodes,
+				STRESS_METRIC_GEOMETRIC_MEAN);
+			j++;
 		}
 	}
 
 	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
-	free(entries);
+	stress_list_free(arena, order, n);
 
 	return rc;
 }
@@ -524,6 +524,7 @@ const stressor_info_t stress_llc_affinity_info = {
 	.class = CLASS_CPU_CACHE,
 	.opts = opts,
 	.verify = VERIFY_ALWAYS,
+	.metrics_max = 3,
 	.help = help
 };
 
@@ -18,7 +18,10 @@
  *
  */
 #include "stress-ng.h"
+#include "core-affinity.h"
 #include "core-arch.h"
+#include "core-builtin.h"
+#include "core-killpid.h"
 #include "core-numa.h"
 
 #if defined(HAVE_LINUX_MEMPOLICY_H) &&  \
@@ -31,11 +34,13 @@ static const stress_help_t help[] = {
 	{ NULL,	"lockbus N",	 	"start N workers locking a memory increment" },
 	{ NULL, "lockbus-nosplit",	"disable split locks" },
 	{ NULL,	"lockbus-ops N", 	"stop after N lockbus bogo operations" },
+	{ NULL, "lockbus-victim",	"measure memory bandwidth of a victim on another CPU" },
 	{ NULL, NULL,			NULL }
 };
 
 static const stress_opt_t opts[] = {
 	{ OPT_lockbus_nosplit, "lockbus-nosplit", TYPE_ID_BOOL, 0, 1, NULL },
+	{ OPT_lockbus_victim,  "lockbus-victim",  TYPE_ID_BOOL, 0, 1, NULL },
 	END_OPT,
 };
 
@@ -84,6 +89,21 @@ do {							\
 #define BUFFER_SIZE	(1024 * 1024 * 16)
 #define CHUNK_SIZE	(64 * 4)
 
+#define VICTIM_SIZE	(16 * MB)	/* victim copy source and destination size */
+#define VICTIM_CHUNK	(256 * KB)	/* victim copy size */
+#define VICTIM_PHASE	(0.25)		/* secs of each aggressor idle/active phase */
+
+#define VICTIM_IDLE	(0)		/* aggressor not locking */
+#define VICTIM_ACTIVE	(1)		/* aggressor locking */
+
+/* --lockbus-victim state shared between aggressor and victim */
+typedef struct {
+	uint32_t phase;			/* VICTIM_IDLE or VICTIM_ACTIVE */
+	bool stop;			/* set to stop the victim */
+	double bytes[2];		/* bytes copied per phase */
+	double duration[2];		/* copy time per phase */
+} stress_lockbus_victim_t;
+
 #if defined(HAVE_SYNC_BOOL_COMPARE_AND_SWAP)
 /* basically locked cmpxchg */
 #define SYNC_BOOL_COMPARE_AND_SWAP(ptr, old_val, new_val) 	\
@@ -156,6 +176,89 @@ static void NORETURN MLOCKED_TEXT stress_sigbus_splitlock_handler(int signum)
 }
 #endif
 
+/*
+ *  stress_lockbus_victim()
+ *	memory bandwidth probe, copy through a buffer larger than most
+ *	caches and account the throughput to the aggressor phase that
+ *	was in effect for the whole of each copy
+ */
+static void stress_lockbus_victim(stress_lockbus_victim_t *victim)
+{
+	uint8_t *buf;
+	size_t offset = 0;
+
+	buf = (uint8_t *)stress_mmap_populate(NULL, VICTIM_SIZE * 2,
+			PROT_READ | PROT_WRITE, MAP_ANONYMOUS | MAP_PRIVATE, -1, 0);
+	if (buf == MAP_FAILED)
+		return;
+	(void)shim_memset(buf, 0xaa, VICTIM_SIZE * 2);
+
+	while (!__atomic_load_n(&victim->stop, __ATOMIC_ACQUIRE)) {
+		const uint32_t phase = __atomic_load_n(&victim->phase, __ATOMIC_ACQUIRE);
+		double t;
+
+		t = stress_time_now();
+		(void)shim_memcpy(buf + VICTIM_SIZE + offset, buf + offset, VICTIM_CHUNK);
+		t = stress_time_now() - t;
+		if (__atomic_load_n(&victim->phase, __ATOMIC_ACQUIRE) == phase) {
+			victim->bytes[phase] += (double)VICTIM_CHUNK * 2.0;
+			victim->duration[phase] += t;
+		}
+		offset += VICTIM_CHUNK;
+		if (offset >= VICTIM_SIZE)
+			offset = 0;
+	}
+	(void)munmap((void *)buf, VICTIM_SIZE * 2);
+}
+
+/*
+ *  stress_lockbus_split_lock_state()
+ *	report the split lock detection and mitigation state
+ */
+static void stress_lockbus_split_lock_state(stress_args_t *args)
+{
+#if defined(__linux__) &&	\
+    defined(STRESS_ARCH_X86)
+	char buf[4096], mitigate[16];
+	const char *mode = "default";
+	const char *ptr;
+	bool detect = false;
+	FILE *fp;
+
+	fp = fopen("/proc/cpuinfo", "r");
+	if (fp) {
+		while (fgets(buf, sizeof(buf), fp)) {
+			if (strncmp(buf, "flags", 5))
+				continue;
+			detect = (strstr(buf, " split_lock_detect") != NULL);
+			break;
+		}
+		(void)fclose(fp);
+	}
+	if (stress_system_read("/proc/cmdline", buf, sizeof(buf)) > 0) {
+		ptr = strstr(buf, "split_lock_detect=");
+		if (ptr) {
+			char *end;
+
+			mode = ptr + 18;
+			end = strpbrk((char *)mode, " \n");
+			if (end)
+				*end = '\0';
+		}
+	}
+	if (stress_system_read("/proc/sys/kernel/split_lock_mitigate", mitigate, sizeof(mitigate)) > 0)
+		mitigate[strcspn(mitigate, "\n")] = '\0';
+	else
+		(void)shim_strscpy(mitigate, "n/a", sizeof(mitigate));
+
+	pr_inf("%s: split lock detect %s, boot mode %s, split_lock_mitigate (ratelimit) %s\n",
+		args->name, detect ? "supported" : "not supported", mode, mitigate);
+#else
+	pr_inf("%s: split lock detection is only available on x86 Linux systems\n",
+		args->name);
+#endif
+}
+
 /*
  *  stress_lockbus()
  *      stress memory with lock and increment
@@ -166,6 +269,10 @@ static int stress_lockbus(stress_args_t *args)
 	double t, rate;
 	NOCLOBBER double duration, count;
 	uint32_t *misaligned_ptr1, *misaligned_ptr2;
+	NOCLOBBER stress_lockbus_victim_t *victim = MAP_FAILED;
+	NOCLOBBER double phase_end = 0.0;
+	NOCLOBBER pid_t victim_pid = -1;
+	bool lockbus_victim = false;
 #if defined(STRESS_ARCH_X86)
 	uint32_t *splitlock_ptr1, *splitlock_ptr2;
 	bool lockbus_nosplit = false;
@@ -189,6 +296,50 @@ static int stress_lockbus(stress_args_t *args)
 	}
 	stress_set_vma_anon_name(buffer, BUFFER_SIZE, "lockbus-data");
 
+	(void)stress_get_setting("lockbus-victim", &lockbus_victim);
+	if (lockbus_victim) {
+		uint32_t *cpus = NULL, n_cpus;
+
+		n_cpus = stress_get_usable_cpus(&cpus, true);
+		if (n_cpus < 2) {
+			if (args->instance == 0)
+				pr_inf_skip("%s: --lockbus-victim needs at least 2 usable CPUs, "
+					"skipping stressor\n", args->name);
+			stress_free_usable_cpus(&cpus);
+			(void)munmap((void *)buffer, BUFFER_SIZE);
+			return EXIT_NO_RESOURCE;
+		}
+		victim = (stress_lockbus_victim_t *)stress_mmap_populate(NULL, sizeof(*victim),
+			PROT_READ | PROT_WRITE, MAP_ANONYMOUS | MAP_SHARED, -1, 0);
+		if (victim == MAP_FAILED) {
+			pr_inf_skip("%s: cannot mmap victim state, skipping stressor\n",
+				args->name);
+			stress_free_usable_cpus(&cpus);
+			(void)munmap((void *)buffer, BUFFER_SIZE);
+			return EXIT_NO_RESOURCE;
+		}
+		(void)shim_memset((void *)victim, 0, sizeof(*victim));
+		if (args->instance == 0)
+			stress_lockbus_split_lock_state(args);
+
+		/* aggressor and victim on different CPUs */
+		victim_pid = fork();
+		if (victim_pid == 0) {
+			stress_placement_set((int32_t)cpus[((args->instance * 2) + 1) % n_cpus]);
+			stress_lockbus_victim(victim);
+			_exit(EXIT_SUCCESS);
+		} else if (victim_pid < 0) {
+			pr_inf_skip("%s: fork of victim failed, errno=%d (%s), skipping stressor\n",
+				args->name, errno, strerror(errno));
+			stress_free_usable_cpus(&cpus);
+			(void)munmap((void *)victim, sizeof(*victim));
+			(void)munmap((void *)buffer, BUFFER_SIZE);
+			return EXIT_NO_RESOURCE;
+		}
+		stress_placement_set((int32_t)cpus[(args->instance * 2) % n_cpus]);
+		stress_free_usable_cpus(&cpus);
+	}
+
 	do_misaligned = true;
 	misaligned_ptr1 = (uint32_t *)(uintptr_t)((uint8_t *)buffer + 1);
 	misaligned_ptr2 = (uint32_t *)(uintptr_t)((uint8_t *)buffer + 10);
@@ -234,6 +385,22 @@ misaligned_done:
 	duration = 0;
 	count = 0;
 	do {
+		if (victim != MAP_FAILED) {
+			const double now = stress_time_now();
+
+			/* alternate idle and active phases for the victim */
+			if (now >= phase_end) {
+				const uint32_t phase = (victim->phase == VICTIM_IDLE) ?
+					VICTIM_ACTIVE : VICTIM_IDLE;
+
+				__atomic_store_n(&victim->phase, phase, __ATOMIC_RELEASE);
+				phase_end = now + VICTIM_PHASE;
+			}
+			if (victim->phase == VICTIM_IDLE) {
+				(void)shim_usleep(1000);
+				continue;
+			}
+		}
 		uint32_t *ptr0 = buffer + (stress_mwc32modn(BUFFER_SIZE - CHUNK_SIZE) >> 2);
 #if defined(STRESS_ARCH_X86)
 		uint32_t *ptr1 = do_splitlock ? splitlock_ptr1 : ptr0;
@@ -301,6 +468,28 @@ done:
 	stress_metrics_set(args, 0, "nanosecs per memory lock operation",
 		rate * STRESS_DBL_NANOSECOND, STRESS_METRIC_HARMONIC_MEAN);
 
+	if (victim != MAP_FAILED) {
+		double idle = 0.0, active = 0.0;
+
+		__atomic_store_n(&victim->stop, true, __ATOMIC_RELEASE);
+		(void)stress_kill_and_wait(args, victim_pid, SIGALRM, false);
+
+		if (victim->duration[VICTIM_IDLE] > 0.0)
+			idle = victim->bytes[VICTIM_IDLE] / (victim->duration[VICTIM_IDLE] * (double)MB);
+		if (victim->duration[VICTIM_ACTIVE] > 0.0)
+			active = victim->bytes[VICTIM_ACTIVE] / (victim->duration[VICTIM_ACTIVE] * (double)MB);
+		if (idle > 0.0)
+			stress_metrics_set(args, 1, "victim MB per sec, aggressor idle",
+				idle, STRESS_METRIC_HARMONIC_MEAN);
+		if (active > 0.0)
+			stress_metrics_set(args, 2, "victim MB per sec, aggressor active",
+				active, STRESS_METRIC_HARMONIC_MEAN);
+		if ((idle > 0.0) && (active > 0.0))
+			stress_metrics_set(args, 3, "% of idle victim throughput",
+				100.0 * active / idle, STRESS_METRIC_GEOMETRIC_MEAN);
+		(void)munmap((void *)victim, sizeof(*victim));
+	}
+
 	(void)munmap((void *)buffer, BUFFER_SIZE);
 
 	return EXIT_SUCCESS;
@@ -310,6 +499,7 @@ const stressor_info_t stress_lockbus_info = {
 	.stressor = stress_lockbus,
 	.class = CLASS_CPU_CACHE | CLASS_MEMORY,
 	.opts = opts,
+	.metrics_max = 4,
 	.help = help
 };
 #else
@@ -133,5 +133,6 @@ const stressor_info_t stress_longjmp_info = {
 	.stressor = stress_longjmp,
 	.class = CLASS_CPU,
 	.verify = VERIFY_ALWAYS,
+	.metrics_max = 1,
 	.help = help
 };
@@ -254,5 +254,6 @@ const stressor_info_t stress_lsearch_info = {
 	.class = CLASS_CPU_CACHE | CLASS_CPU | CLASS_MEMORY | CLASS_SEARCH,
 	.opts = opts,
 	.verify = VERIFY_OPTIONAL,
+	.metrics_max = 2,
 	.help = help
 };
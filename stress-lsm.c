@@ -238,6 +238,7 @@ err:
 const stressor_info_t stress_lsm_info = {
 	.stressor = stress_lsm,
 	.class = CLASS_OS | CLASS_SECURITY,
+	.metrics_max = 2,
 	.help = help
 };
 #else
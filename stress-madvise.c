@@ -19,6 +19,7 @@
  */
 #include "stress-ng.h"
 #include "core-builtin.h"
+#include "core-killpid.h"
 #include "core-madvise.h"
 #include "core-mincore.h"
 #include "core-out-of-memory.h"
@@ -28,11 +29,19 @@ static const stress_help_t help[] = {
 	{ NULL,	"madvise N",	 	"start N workers exercising madvise on memory" },
 	{ NULL,	"madvise-ops N",	"stop after N bogo madvise operations" },
 	{ NULL,	"madvise-hwpoison",	"enable hardware page poisoning (disabled by default)" },
+	{ NULL,	"madvise-prefault",	"measure prefault throughput of touch, MAP_POPULATE and madvise strategies" },
+	{ NULL,	"madvise-prefault-bytes N", "size of the region prefaulted by each strategy" },
 	{ NULL,	NULL,			NULL }
 };
 
+#define MIN_MADVISE_PREFAULT_BYTES	(4 * MB)
+#define MAX_MADVISE_PREFAULT_BYTES	(MAX_MEM_LIMIT)
+#define DEFAULT_MADVISE_PREFAULT_BYTES	(256 * MB)
+
 static const stress_opt_t opts[] = {
 	{ OPT_madvise_hwpoison,	"madvise-hwpoison", TYPE_ID_BOOL, 0, 1, NULL },
+	{ OPT_madvise_prefault,	"madvise-prefault", TYPE_ID_BOOL, 0, 1, NULL },
+	{ OPT_madvise_prefault_bytes, "madvise-prefault-bytes", TYPE_ID_SIZE_T_BYTES_VM, MIN_MADVISE_PREFAULT_BYTES, MAX_MADVISE_PREFAULT_BYTES, NULL },
 	END_OPT,
 };
 
@@ -54,6 +63,36 @@ typedef struct madvise_ctxt {
 	bool  hwpoison;
 } madvise_ctxt_t;
 
+#define PREFAULT_TOUCH		(0)	/* anon, write one byte per page */
+#define PREFAULT_MAP_POPULATE	(1)	/* anon, mmap with MAP_POPULATE */
+#define PREFAULT_POPULATE_WRITE	(2)	/* anon, MADV_POPULATE_WRITE */
+#define PREFAULT_FILE_TOUCH	(3)	/* file, read one byte per page */
+#define PREFAULT_FILE_POPULATE	(4)	/* file, MADV_POPULATE_READ */
+#define PREFAULT_FILE_WILLNEED	(5)	/* file, MADV_WILLNEED then touch */
+#define PREFAULT_PROCESS_MADVISE (6)	/* file, process_madvise WILLNEED then touch */
+#define PREFAULT_METHODS	(7)
+
+#define PREFAULT_IOV_SIZE	(1 * MB)/* process_madvise iovec size */
+#define PREFAULT_IOV_BATCH	(64)	/* iovecs per process_madvise call */
+
+static const char * const stress_madvise_prefault_methods[PREFAULT_METHODS] = {
+	"touch",
+	"map-populate",
+	"populate-write",
+	"file-touch",
+	"file-populate-read",
+	"file-willneed",
+	"process-madvise",
+};
+
+typedef struct {
+	uint8_t *fbuf;		/* shared file mapping, also mapped in the helper */
+	size_t sz;		/* region size */
+	int fd;			/* backing file */
+	int pidfd;		/* pidfd of the helper, -1 if not available */
+	pid_t pid;		/* helper process */
+} stress_madvise_prefault_t;
+
 static sigjmp_buf jmp_env;
 static uint64_t sigbus_count;
 
@@ -490,6 +529,298 @@ static void stress_process_madvise(const pid_t pid, void *buf, const size_t sz)
 #endif
 }
 
+/*
+ *  stress_madvise_prefault_touch()
+ *	fault in a region one page at a time, by writing or reading
+ */
+static void OPTIMIZE3 stress_madvise_prefault_touch(
+	uint8_t *buf,
+	const size_t sz,
+	const size_t page_size,
+	const bool write)
+{
+	volatile uint8_t *ptr;
+	const uint8_t *end = buf + sz;
+
+	if (write) {
+		for (ptr = buf; ptr < end; ptr += page_size)
+			*ptr = 1;
+	} else {
+		for (ptr = buf; ptr < end; ptr += page_size)
+			(void)*ptr;
+	}
+}
+
+/*
+ *  stress_madvise_prefault_evict()
+ *	unmap the file pages from the worker and drop them from
+ *	the page cache so the file strategies start cold
+ */
+static void stress_madvise_prefault_evict(stress_madvise_prefault_t *pf)
+{
+#if defined(MADV_DONTNEED)
+	(void)shim_madvise(pf->fbuf, pf->sz, MADV_DONTNEED);
+#endif
+	(void)shim_fdatasync(pf->fd);
+#if defined(HAVE_POSIX_FADVISE) &&	\
+    defined(POSIX_FADV_DONTNEED)
+	(void)posix_fadvise(pf->fd, 0, (off_t)pf->sz, POSIX_FADV_DONTNEED);
+#endif
+}
+
+/*
+ *  stress_madvise_prefault_method()
+ *	prefault the region using a strategy, returns the time taken
+ *	in seconds or a negative value if the strategy failed
+ */
+static double stress_madvise_prefault_method(
+	stress_args_t *args,
+	stress_madvise_prefault_t *pf,
+	const size_t method)
+{
+	const size_t page_size = args->page_size;
+	struct iovec iov[PREFAULT_IOV_BATCH];
+	uint8_t *buf = MAP_FAILED;
+	double t_start, t_end;
+	size_t offset, n;
+	int ret = 0;
+
+	if (method >= PREFAULT_FILE_TOUCH)
+		stress_madvise_prefault_evict(pf);
+
+	t_start = stress_time_now();
+	switch (method) {
+	case PREFAULT_TOUCH:
+		buf = (uint8_t *)mmap(NULL, pf->sz, PROT_READ | PROT_WRITE,
+				MAP_ANONYMOUS | MAP_PRIVATE, -1, 0);
+		if (buf == MAP_FAILED)
+			return -1.0;
+		stress_madvise_prefault_touch(buf, pf->sz, page_size, true);
+		break;
+	case PREFAULT_MAP_POPULATE:
+#if defined(MAP_POPULATE)
+		buf = (uint8_t *)mmap(NULL, pf->sz, PROT_READ | PROT_WRITE,
+				MAP_ANONYMOUS | MAP_PRIVATE | MAP_POPULATE, -1, 0);
+		if (buf == MAP_FAILED)
+			return -1.0;
+		break;
+#else
+		errno = ENOSYS;
+		return -1.0;
+#endif
+	case PREFAULT_POPULATE_WRITE:
+#if defined(SHIM_MADV_POPULATE_WRITE)
+		buf = (uint8_t *)mmap(NULL, pf->sz, PROT_READ | PROT_WRITE,
+				MAP_ANONYMOUS | MAP_PRIVATE, -1, 0);
+		if (buf == MAP_FAILED)
+			return -1.0;
+		ret = shim_madvise(buf, pf->sz, SHIM_MADV_POPULATE_WRITE);
+		break;
+#else
+		errno = ENOSYS;
+		return -1.0;
+#endif
+	case PREFAULT_FILE_TOUCH:
+		stress_madvise_prefault_touch(pf->fbuf, pf->sz, page_size, false);
+		break;
+	case PREFAULT_FILE_POPULATE:
+#if defined(SHIM_MADV_POPULATE_READ)
+		ret = shim_madvise(pf->fbuf, pf->sz, SHIM_MADV_POPULATE_READ);
+		break;
+#else
+		errno = ENOSYS;
+		return -1.0;
+#endif
+	case PREFAULT_FILE_WILLNEED:
+#if defined(MADV_WILLNEED)
+		ret = shim_madvise(pf->fbuf, pf->sz, MADV_WILLNEED);
+		if (ret == 0)
+			stress_madvise_prefault_touch(pf->fbuf, pf->sz, page_size, false);
+		break;
+#else
+		errno = ENOSYS;
+		return -1.0;
+#endif
+	case PREFAULT_PROCESS_MADVISE:
+#if defined(MADV_WILLNEED)
+		/* the helper maps the file at the same address */
+		if (pf->pidfd < 0) {
+			errno = ENOSYS;
+			return -1.0;
+		}
+		for (offset = 0; (offset < pf->sz) && (ret >= 0); ) {
+			for (n = 0; (n < PREFAULT_IOV_BATCH) && (offset < pf->sz); n++) {
+				iov[n].iov_base = pf->fbuf + offset;
+				iov[n].iov_len = STRESS_MINIMUM(PREFAULT_IOV_SIZE, pf->sz - offset);
+				offset += iov[n].iov_len;
+			}
+			ret = (int)shim_process_madvise(pf->pidfd, iov, n, MADV_WILLNEED, 0);
+		}
+		if (ret >= 0)
+			stress_madvise_prefault_touch(pf->fbuf, pf->sz, page_size, false);
+		break;
+#else
+		errno = ENOSYS;
+		return -1.0;
+#endif
+	default:
+		errno = EINVAL;
+		return -1.0;
+	}
+	t_end = stress_time_now();
+
+	if (buf != MAP_FAILED)
+		(void)munmap((void *)buf, pf->sz);
+	return (ret < 0) ? -1.0 : t_end - t_start;
+}
+
+/*
+ *  stress_madvise_prefault()
+ *	measure the throughput of different ways of populating
+ *	large anonymous and file backed regions
+ */
+static int stress_madvise_prefault(stress_args_t *args)
+{
+	stress_madvise_prefault_t pf;
+	size_t madvise_prefault_bytes = DEFAULT_MADVISE_PREFAULT_BYTES;
+	double bytes[PREFAULT_METHODS], duration[PREFAULT_METHODS];
+	bool supported[PREFAULT_METHODS];
+	char filename[PATH_MAX];
+	uint8_t *chunk;
+	size_t i, method, idx, resident;
+	int ret, rc = EXIT_SUCCESS;
+
+	if (!stress_get_setting("madvise-prefault-bytes", &madvise_prefault_bytes)) {
+		if (g_opt_flags & OPT_FLAGS_MAXIMIZE)
+			madvise_prefault_bytes = MAX_32;
+		if (g_opt_flags & OPT_FLAGS_MINIMIZE)
+			madvise_prefault_bytes = MIN_MADVISE_PREFAULT_BYTES;
+	}
+	madvise_prefault_bytes /= args->instances;
+	if (madvise_prefault_bytes < MIN_MADVISE_PREFAULT_BYTES)
+		madvise_prefault_bytes = MIN_MADVISE_PREFAULT_BYTES;
+	pf.sz = madvise_prefault_bytes & ~(args->page_size - 1);
+	pf.pidfd = -1;
+	pf.pid = -1;
+
+	chunk = (uint8_t *)malloc(MB);
+	if (!chunk) {
+		pr_inf_skip("%s: cannot allocate file write buffer, skipping stressor\n", args->name);
+		return EXIT_NO_RESOURCE;
+	}
+	(void)shim_memset(chunk, 0x5a, MB);
+
+	ret = stress_temp_dir_mk_args(args);
+	if (ret < 0) {
+		free(chunk);
+		return stress_exit_status(-ret);
+	}
+	(void)stress_temp_filename_args(args, filename, sizeof(filename), stress_mwc32());
+	pf.fd = open(filename, O_CREAT | O_RDWR, S_IRUSR | S_IWUSR);
+	if (pf.fd < 0) {
+		rc = stress_exit_status(errno);
+		pr_fail("%s: open %s failed, errno=%d (%s)\n",
+			args->name, filename, errno, strerror(errno));
+		goto tidy_dir;
+	}
+	(void)shim_unlink(filename);
+	for (i = 0; i < pf.sz; i += MB) {
+		const size_t len = STRESS_MINIMUM(MB, pf.sz - i);
+
+		if (write(pf.fd, chunk, len) != (ssize_t)len) {
+			pr_inf_skip("%s: cannot write %zu byte file, errno=%d (%s), skipping stressor\n",
+				args->name, pf.sz, errno, strerror(errno));
+			rc = EXIT_NO_RESOURCE;
+			goto tidy_fd;
+		}
+	}
+	pf.fbuf = (uint8_t *)mmap(NULL, pf.sz, PROT_READ, MAP_SHARED, pf.fd, 0);
+	if (pf.fbuf == MAP_FAILED) {
+		pr_inf_skip("%s: cannot mmap %zu byte file, errno=%d (%s), skipping stressor\n",
+			args->name, pf.sz, errno, strerror(errno));
+		rc = EXIT_NO_RESOURCE;
+		goto tidy_fd;
+	}
+
+	/* helper inherits the file mapping, process_madvise targets it */
+	pf.pid = fork();
+	if (pf.pid == 0) {
+		stress_parent_died_alarm();
+		for (;;)
+			(void)pause();
+	}
+	if (pf.pid > 0)
+		pf.pidfd = shim_pidfd_open(pf.pid, 0);
+
+	for (method = 0; method < PREFAULT_METHODS; method++) {
+		bytes[method] = 0.0;
+		duration[method] = 0.0;
+		supported[method] = (stress_madvise_prefault_method(args, &pf, method) >= 0.0);
+		if (!supported[method] && (args->instance == 0))
+			pr_inf("%s: %s not supported, errno=%d (%s)\n", args->name,
+				stress_madvise_prefault_methods[method], errno, strerror(errno));
+	}
+	/* tmpfs and similar file systems cannot drop file pages */
+	stress_madvise_prefault_evict(&pf);
+	if ((stress_mincore_resident(pf.fbuf, pf.sz, &resident) == 0) &&
+	    (resident > (pf.sz / args->page_size) / 2) && (args->instance == 0))
+		pr_inf("%s: file pages cannot be evicted, file strategies populate "
+			"from the page cache\n", args->name);
+
+	stress_set_proc_state(args->name, STRESS_STATE_SYNC_WAIT);
+	stress_sync_start_wait(args);
+	stress_set_proc_state(args->name, STRESS_STATE_RUN);
+
+	do {
+		for (method = 0; (method < PREFAULT_METHODS) && stress_continue(args); method++) {
+			double t;
+
+			if (!supported[method])
+				continue;
+			t = stress_madvise_prefault_method(args, &pf, method);
+			if (UNLIKELY(t < 0.0)) {
+				pr_fail("%s: %s prefault failed, errno=%d (%s)\n", args->name,
+					stress_madvise_prefault_methods[method], errno, strerror(errno));
+				rc = EXIT_FAILURE;
+				goto done;
+			}
+			bytes[method] += (double)pf.sz;
+			duration[method] += t;
+		}
+		stress_bogo_inc(args);
+	} while (stress_continue(args));
+done:
+	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
+
+	for (idx = 0, method = 0; method < PREFAULT_METHODS; method++) {
+		char desc[64];
+		double rate;
+
+		if (duration[method] <= 0.0)
+			continue;
+		rate = bytes[method] / (duration[method] * (double)GB);
+		if (args->instance == 0)
+			pr_inf("%s: %-18s %8.3f GB/sec\n", args->name,
+				stress_madvise_prefault_methods[method], rate);
+		(void)snprintf(desc, sizeof(desc), "%s GB per sec",
+			stress_madvise_prefault_methods[method]);
+		stress_metrics_set(args, idx++, desc, rate, STRESS_METRIC_HARMONIC_MEAN);
+	}
+
+	if (pf.pidfd >= 0)
+		(void)close(pf.pidfd);
+	if (pf.pid > 0)
+		(void)stress_kill_pid_wait(pf.pid, NULL);
+	(void)munmap((void *)pf.fbuf, pf.sz);
+tidy_fd:
+	(void)close(pf.fd);
+tidy_dir:
+	(void)stress_temp_dir_rm_args(args);
+	free(chunk);
+
+	return rc;
+}
+
 /*
  *  stress_madvise()
  *	stress madvise
@@ -508,6 +839,7 @@ static int stress_madvise(stress_args_t *args)
 	char *page;
 	size_t n;
 	madvise_ctxt_t ctxt;
+	bool madvise_prefault = false;
 #if defined(MADV_FREE)
 	NOCLOBBER uint64_t madv_frees_raced;
 	NOCLOBBER uint64_t madv_frees;
@@ -516,6 +848,9 @@ static int stress_madvise(stress_args_t *args)
 
 	(void)shim_memset(&ctxt, 0, sizeof(ctxt));
 	(void)stress_get_setting("madvise-hwpoison", &ctxt.hwpoison);
+	(void)stress_get_setting("madvise-prefault", &madvise_prefault);
+	if (madvise_prefault)
+		return stress_madvise_prefault(args);
 
 	num_mem_retries = 0;
 #if defined(MADV_FREE)
@@ -744,6 +1079,7 @@ const stressor_info_t stress_madvise_info = {
 	.stressor = stress_madvise,
 	.class = CLASS_VM | CLASS_OS,
 	.opts = opts,
+	.metrics_max = PREFAULT_METHODS,
 	.help = help
 };
 #else
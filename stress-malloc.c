@@ -28,6 +28,12 @@
 #include <malloc.h>
 #endif
 
+#if defined(HAVE_LIB_DL) &&	\
+    !defined(BUILD_STATIC)
+#include <dlfcn.h>
+#define STRESS_MALLOC_ALLOCATOR	(1)
+#endif
+
 #define MIN_MALLOC_BYTES	(1 * KB)
 #define MAX_MALLOC_BYTES	(MAX_MEM_LIMIT)
 #define DEFAULT_MALLOC_BYTES	(64 * KB)
@@ -44,6 +50,13 @@
 #define MAX_MALLOC_PTHREADS	(32)
 #define DEFAULT_MALLOC_PTHREADS	(0)
 
+#define MALLOC_SIZES_UNIFORM	(0)
+#define MALLOC_SIZES_LOG2	(1)
+#define MALLOC_SIZES_SMALL	(2)
+#define MALLOC_SIZES_SMALL_MAX	(256)
+
+#define MALLOC_SAMPLE_MASK	(0xfff)	/* fragmentation sample every 4096 loops */
+
 #define MK_ALIGN(x)	(1U << (3 + ((x) & 7)))
 
 typedef struct {
@@ -51,11 +64,28 @@ typedef struct {
 	size_t len;			/* Allocation length */
 } stress_malloc_info_t;
 
+/* allocator functions, libc or from a --malloc-allocator library */
+typedef struct {
+	void *(*fn_malloc)(size_t size);
+	void *(*fn_calloc)(size_t nmemb, size_t size);
+	void *(*fn_realloc)(void *ptr, size_t size);
+	void (*fn_free)(void *ptr);
+	int (*fn_posix_memalign)(void **memptr, size_t alignment, size_t size);
+	void *(*fn_aligned_alloc)(size_t alignment, size_t size);
+	void *(*fn_memalign)(size_t alignment, size_t size);
+	void *(*fn_valloc)(size_t size);
+	size_t (*fn_malloc_usable_size)(void *ptr);
+} stress_malloc_funcs_t;
+
 static bool malloc_mlock;		/* True = mlock all future allocs */
 static bool malloc_touch;		/* True = will touch allocate pages */
 static bool malloc_trim_opt;		/* True = periodically trim malloc arena */
 static size_t malloc_max;		/* Maximum number of allocations */
 static size_t malloc_bytes;		/* Maximum per-allocation size */
+static size_t malloc_bytes_shift;	/* log2 of malloc_bytes */
+static size_t malloc_sizes;		/* Allocation size distribution */
+static stress_malloc_funcs_t malloc_funcs; /* Allocator functions */
+static bool malloc_libc;		/* True = using libc allocator */
 static void *counter_lock;		/* Counter lock */
 static const char *alloc_action = NULL;
 static size_t alloc_size = 0;
@@ -79,15 +109,29 @@ typedef struct {
 	stress_args_t *args;		/* args info */
 	size_t instance;		/* per thread instance number */
 	int rc;				/* return status */
+	size_t live;			/* bytes currently allocated */
 } stress_malloc_args_t;
 
+/* fragmentation sampling, written only by the instance 0 thread */
+typedef struct {
+	stress_malloc_args_t *malloc_args; /* all the thread args */
+	size_t n;			/* number of threads including instance 0 */
+	size_t rss_base;		/* RSS before any allocations */
+	double total;			/* sum of heap RSS / live bytes samples */
+	uint64_t samples;		/* number of samples */
+} stress_malloc_frag_t;
+
+static stress_malloc_frag_t malloc_frag;
+
 static const stress_help_t help[] = {
 	{ NULL,	"malloc N",		"start N workers exercising malloc/realloc/free" },
+	{ NULL,	"malloc-allocator file","use allocator shared library file instead of libc" },
 	{ NULL,	"malloc-bytes N",	"allocate up to N bytes per allocation" },
 	{ NULL,	"malloc-max N",		"keep up to N allocations at a time" },
 	{ NULL,	"malloc-mlock",		"attempt to mlock pages into memory" },
 	{ NULL,	"malloc-ops N",		"stop after N malloc bogo operations" },
 	{ NULL, "malloc-pthreads N",	"number of pthreads to run concurrently" },
+	{ NULL,	"malloc-sizes D",	"allocation size distribution (uniform, log2, small)" },
 	{ NULL,	"malloc-thresh N",	"threshold where malloc uses mmap instead of sbrk" },
 	{ NULL, "malloc-touch",		"touch pages force pages to be populated" },
 	{ NULL,	"malloc-zerofree",	"zero free'd memory" },
@@ -109,7 +153,7 @@ static void stress_malloc_free(void *ptr, size_t len)
 {
 	(void)len;
 
-	free(ptr);
+	malloc_funcs.fn_free(ptr);
 }
 
 /*
@@ -120,22 +164,88 @@ static void stress_malloc_zerofree(void *ptr, size_t len)
 {
 	if (LIKELY(len))
 		(void)shim_memset(ptr, 0, len);
-	free(ptr);
+	malloc_funcs.fn_free(ptr);
 }
 
 /*
  *  stress_alloc_size()
- *	get a new allocation size, ensuring
- *	it is never zero bytes.
+ *	get a new allocation size from the --malloc-sizes
+ *	distribution, ensuring it is never zero bytes.
  */
 static inline size_t stress_alloc_size(const size_t size)
 {
-	const size_t len = stress_mwc64modn(size);
+	size_t len;
 	const size_t min_size = sizeof(uintptr_t);
 
+	switch (malloc_sizes) {
+	case MALLOC_SIZES_LOG2:
+		/* pick a power of 2 size class uniformly, then a size in the class */
+		len = (size_t)1 << (3 + stress_mwc64modn(malloc_bytes_shift - 2));
+		len += stress_mwc64modn(len);
+		if (len > size)
+			len = size;
+		break;
+	case MALLOC_SIZES_SMALL:
+		len = stress_mwc64modn(size < MALLOC_SIZES_SMALL_MAX ? size : MALLOC_SIZES_SMALL_MAX);
+		break;
+	case MALLOC_SIZES_UNIFORM:
+	default:
+		len = stress_mwc64modn(size);
+		break;
+	}
 	return (len >= min_size) ? len : min_size;
 }
 
+/*
+ *  stress_malloc_alloc()
+ *	default malloc allocation
+ */
+static inline void *stress_malloc_alloc(const size_t len)
+{
+	stress_alloc_action("malloc", len);
+	return malloc_funcs.fn_malloc(len);
+}
+
+/*
+ *  stress_malloc_rss()
+ *	get current resident set size in bytes, 0 if not known
+ */
+static size_t stress_malloc_rss(const size_t page_size)
+{
+#if defined(__linux__)
+	char buf[64];
+	unsigned long int size, resident;
+
+	if (stress_system_read("/proc/self/statm", buf, sizeof(buf)) <= 0)
+		return 0;
+	if (sscanf(buf, "%lu %lu", &size, &resident) != 2)
+		return 0;
+	return (size_t)resident * page_size;
+#else
+	(void)page_size;
+
+	return 0;
+#endif
+}
+
+/*
+ *  stress_malloc_frag_sample()
+ *	sample heap RSS against the live allocated bytes of
+ *	all the threads, 1.0 is no overhead or fragmentation
+ */
+static void stress_malloc_frag_sample(const size_t page_size)
+{
+	size_t i, live = 0, rss;
+
+	for (i = 0; i < malloc_frag.n; i++)
+		live += malloc_frag.malloc_args[i].live;
+	rss = stress_malloc_rss(page_size);
+	if ((live < MB) || (rss <= malloc_frag.rss_base))
+		return;
+	malloc_frag.total += (double)(rss - malloc_frag.rss_base) / (double)live;
+	malloc_frag.samples++;
+}
+
 static void stress_malloc_page_touch(
 	uint8_t *buffer,
 	const size_t size,
@@ -165,6 +275,7 @@ static void *stress_malloc_loop(void *ptr)
 #if defined(HAVE_MALLOC_TRIM)
 	register uint16_t trim_counter = 0;
 #endif
+	uint32_t loops = 0;
 
 #if defined(MCL_FUTURE)
 	if (malloc_mlock) {
@@ -215,6 +326,7 @@ static void *stress_malloc_loop(void *ptr)
 				}
 				stress_alloc_action("free", info[i].len);
 				free_func(info[i].addr, info[i].len);
+				malloc_args->live -= info[i].len;
 				info[i].addr = NULL;
 				info[i].len = 0;
 				if (UNLIKELY(!stress_bogo_inc_lock(args, counter_lock, true)))
@@ -224,8 +336,9 @@ static void *stress_malloc_loop(void *ptr)
 				const size_t len = stress_alloc_size(malloc_bytes);
 
 				stress_alloc_action("realloc", len);
-				tmp = realloc(info[i].addr, len);
+				tmp = malloc_funcs.fn_realloc(info[i].addr, len);
 				if (tmp) {
+					malloc_args->live += len - info[i].len;
 					info[i].addr = tmp;
 					info[i].len = len;
 
@@ -252,50 +365,53 @@ static void *stress_malloc_loop(void *ptr)
 					if (len < (n * sizeof(uintptr_t)))
 						len = n * sizeof(uintptr_t);
 					stress_alloc_action("calloc", len);
-					info[i].addr = (void *)calloc(n, len / n);
+					info[i].addr = (void *)malloc_funcs.fn_calloc(n, len / n);
 					len = n * (len / n);
 					break;
-#if defined(HAVE_POSIX_MEMALIGN)
 				case 1:
 					/* POSIX.1-2001 and POSIX.1-2008 */
+					if (UNLIKELY(!malloc_funcs.fn_posix_memalign)) {
+						info[i].addr = (uintptr_t *)stress_malloc_alloc(len);
+						break;
+					}
 					stress_alloc_action("posix_memalign", len);
-					if (UNLIKELY(posix_memalign((void **)&info[i].addr, MK_ALIGN(i), len) != 0))
+					if (UNLIKELY(malloc_funcs.fn_posix_memalign((void **)&info[i].addr, MK_ALIGN(i), len) != 0))
 						info[i].addr = NULL;
 					break;
-#endif
-#if defined(HAVE_ALIGNED_ALLOC) &&	\
-    !defined(__OpenBSD__)
 				case 2:
 					/* C11 aligned allocation */
+					if (UNLIKELY(!malloc_funcs.fn_aligned_alloc)) {
+						info[i].addr = (uintptr_t *)stress_malloc_alloc(len);
+						break;
+					}
 					tmp_align = MK_ALIGN(i);
 					/* round len to multiple of alignment */
 					len = (len + tmp_align - 1) & ~(tmp_align - 1);
 					stress_alloc_action("aligned_alloc", len);
-					info[i].addr = aligned_alloc(tmp_align, len);
+					info[i].addr = malloc_funcs.fn_aligned_alloc(tmp_align, len);
 					break;
-#endif
-#if defined(HAVE_MEMALIGN)
 				case 3:
 					/* SunOS 4.1.3 */
+					if (UNLIKELY(!malloc_funcs.fn_memalign)) {
+						info[i].addr = (uintptr_t *)stress_malloc_alloc(len);
+						break;
+					}
 					stress_alloc_action("memalign", len);
-					info[i].addr = memalign(MK_ALIGN(i), len);
+					info[i].addr = malloc_funcs.fn_memalign(MK_ALIGN(i), len);
 					break;
-#endif
-#if defined(HAVE_VALLOC) &&	\
-    !defined(HAVE_LIB_PTHREAD)
 				case 4:
-					stress_alloc_action("valloc", len);
-					info[i].addr = valloc(len);
-					break;
-#elif defined(HAVE_MEMALIGN)
-				case 4:
-					stress_alloc_action("memalign", len);
-					info[i].addr = memalign(page_size, len);
+					if (malloc_funcs.fn_valloc) {
+						stress_alloc_action("valloc", len);
+						info[i].addr = malloc_funcs.fn_valloc(len);
+					} else if (malloc_funcs.fn_memalign) {
+						stress_alloc_action("memalign", len);
+						info[i].addr = malloc_funcs.fn_memalign(page_size, len);
+					} else {
+						info[i].addr = (uintptr_t *)stress_malloc_alloc(len);
+					}
 					break;
-#endif
 				default:
-					stress_alloc_action("malloc", len);
-					info[i].addr = (uintptr_t *)malloc(len);
+					info[i].addr = (uintptr_t *)stress_malloc_alloc(len);
 					break;
 				}
 				if (LIKELY(info[i].addr != NULL)) {
@@ -303,6 +419,7 @@ static void *stress_malloc_loop(void *ptr)
 					stress_malloc_page_touch((void *)info[i].addr, len, page_size);
 					*info[i].addr = (uintptr_t)info[i].addr;	/* stash address */
 					info[i].len = len;
+					malloc_args->live += len;
 
 					if (g_opt_flags & OPT_FLAGS_AGGRESSIVE)
 						stress_cpu_data_cache_flush((void *)info[i].addr, len);
@@ -310,10 +427,9 @@ static void *stress_malloc_loop(void *ptr)
 					if (UNLIKELY(!stress_bogo_inc_lock(args, counter_lock, true)))
 						break;
 
-#if defined(HAVE_MALLOC_USABLE_SIZE)
 					/* add some sanity checking */
-					if (UNLIKELY(verify)) {
-						const size_t usable_size = malloc_usable_size(info[i].addr);
+					if (UNLIKELY(verify && malloc_funcs.fn_malloc_usable_size)) {
+						const size_t usable_size = malloc_funcs.fn_malloc_usable_size(info[i].addr);
 
 						if (UNLIKELY(usable_size < len)) {
 							pr_fail("%s: malloc_usable_size on %p returned a "
@@ -323,18 +439,19 @@ static void *stress_malloc_loop(void *ptr)
 							break;
 						}
 					}
-#endif
 				} else {
 					info[i].len = 0;
 				}
 			}
 		}
 #if defined(HAVE_MALLOC_TRIM)
-		if (malloc_trim_opt && (trim_counter++ == 0)) {
+		if (malloc_trim_opt && malloc_libc && (trim_counter++ == 0)) {
 			stress_alloc_action("malloc_trim", 0);
 			(void)malloc_trim(0);
 		}
 #endif
+		if ((malloc_args->instance == 0) && ((++loops & MALLOC_SAMPLE_MASK) == 0))
+			stress_malloc_frag_sample(page_size);
 	}
 
 	for (j = 0; j < malloc_max; j++) {
@@ -372,6 +489,10 @@ static int stress_malloc_child(stress_args_t *args, void *context)
 	 */
 	stress_malloc_args_t malloc_args[MAX_MALLOC_PTHREADS + 1];
 	size_t malloc_pthreads = DEFAULT_MALLOC_PTHREADS;
+	const size_t page_size = args->page_size;
+	double t_start, duration;
+	uint64_t ops;
+	struct rusage usage;
 #if defined(HAVE_LIB_PTHREAD)
 	stress_pthread_info_t pthreads[MAX_MALLOC_PTHREADS];
 	size_t j;
@@ -413,7 +534,14 @@ static int stress_malloc_child(stress_args_t *args, void *context)
 	stress_sync_start_wait(args);
 	stress_set_proc_state(args->name, STRESS_STATE_RUN);
 
+	(void)shim_memset(&malloc_frag, 0, sizeof(malloc_frag));
+	malloc_frag.malloc_args = malloc_args;
+	malloc_frag.n = 1;
+	malloc_frag.rss_base = stress_malloc_rss(page_size);
+	t_start = stress_time_now();
+
 #if defined(HAVE_LIB_PTHREAD)
+	malloc_frag.n += malloc_pthreads;
 	keep_thread_running_flag = true;
 	(void)shim_memset(pthreads, 0, sizeof(pthreads));
 	for (j = 0; j < malloc_pthreads; j++) {
@@ -450,9 +578,134 @@ static int stress_malloc_child(stress_args_t *args, void *context)
 			rc = EXIT_FAILURE;
 	}
 #endif
+	duration = stress_time_now() - t_start;
+	ops = stress_bogo_get(args);
+	if (duration > 0.0) {
+		stress_metrics_set(args, 0, "allocator ops per sec",
+			(double)ops / duration, STRESS_METRIC_HARMONIC_MEAN);
+		stress_metrics_set(args, 1, "allocator ops per sec per thread",
+			(double)ops / duration / (double)malloc_frag.n, STRESS_METRIC_HARMONIC_MEAN);
+	}
+	if (shim_getrusage(RUSAGE_SELF, &usage) == 0)
+		stress_metrics_set(args, 2, "MB peak RSS",
+			(double)usage.ru_maxrss / 1024.0, STRESS_METRIC_GEOMETRIC_MEAN);
+	if (malloc_frag.samples > 0)
+		stress_metrics_set(args, 3, "heap RSS to live bytes ratio",
+			malloc_frag.total / (double)malloc_frag.samples, STRESS_METRIC_GEOMETRIC_MEAN);
 	return rc;
 }
 
+/*
+ *  stress_malloc_funcs_libc()
+ *	use the libc allocator
+ */
+static void stress_malloc_funcs_libc(stress_malloc_funcs_t *funcs)
+{
+	(void)shim_memset(funcs, 0, sizeof(*funcs));
+	funcs->fn_malloc = malloc;
+	funcs->fn_calloc = calloc;
+	funcs->fn_realloc = realloc;
+	funcs->fn_free = free;
+#if defined(HAVE_POSIX_MEMALIGN)
+	funcs->fn_posix_memalign = posix_memalign;
+#endif
+#if defined(HAVE_ALIGNED_ALLOC) &&	\
+    !defined(__OpenBSD__)
+	funcs->fn_aligned_alloc = aligned_alloc;
+#endif
+#if defined(HAVE_MEMALIGN)
+	funcs->fn_memalign = memalign;
+#endif
+#if defined(HAVE_VALLOC) &&	\
+    !defined(HAVE_LIB_PTHREAD)
+	funcs->fn_valloc = valloc;
+#endif
+#if defined(HAVE_MALLOC_USABLE_SIZE)
+	funcs->fn_malloc_usable_size = malloc_usable_size;
+#endif
+}
+
+#if defined(STRESS_MALLOC_ALLOCATOR)
+/*
+ *  stress_malloc_dlsym()
+ *	lookup allocator function prefix + name
+ */
+static void *stress_malloc_dlsym(void *handle, const char *prefix, const char *name)
+{
+	char sym[64];
+
+	(void)snprintf(sym, sizeof(sym), "%s%s", prefix, name);
+	return dlsym(handle, sym);
+}
+
+/*
+ *  stress_malloc_funcs_dlopen()
+ *	load allocator from shared library file, the library
+ *	may export plain malloc et al or a prefixed API such
+ *	as je_malloc, mi_malloc or tc_malloc. Optional aligned
+ *	allocation functions that are not provided fall back
+ *	to the library's own malloc so allocators never mix.
+ *	Returns the dlopen handle or NULL on failure.
+ */
+static void *stress_malloc_funcs_dlopen(
+	stress_args_t *args,
+	const char *filename,
+	stress_malloc_funcs_t *funcs)
+{
+	static const char * const prefixes[] = { "", "je_", "mi_", "tc_" };
+	const char *prefix = NULL;
+	void *handle;
+	size_t i;
+
+	handle = dlopen(filename, RTLD_NOW | RTLD_LOCAL);
+	if (!handle) {
+		pr_inf_skip("%s: cannot load allocator %s: %s, skipping stressor\n",
+			args->name, filename, dlerror());
+		return NULL;
+	}
+
+	/*
+	 *  dlsym also searches the library dependencies, so a plain
+	 *  "malloc" that resolves to libc means this prefix is not
+	 *  provided by the allocator
+	 */
+	for (i = 0; i < SIZEOF_ARRAY(prefixes); i++) {
+		const void *sym = stress_malloc_dlsym(handle, prefixes[i], "malloc");
+
+		if (sym && (sym != (void *)malloc)) {
+			prefix = prefixes[i];
+			break;
+		}
+	}
+	if (!prefix) {
+		pr_inf_skip("%s: %s does not provide a malloc allocator, skipping stressor\n",
+			args->name, filename);
+		(void)dlclose(handle);
+		return NULL;
+	}
+
+	(void)shim_memset(funcs, 0, sizeof(*funcs));
+	funcs->fn_malloc = (void *(*)(size_t))stress_malloc_dlsym(handle, prefix, "malloc");
+	funcs->fn_calloc = (void *(*)(size_t, size_t))stress_malloc_dlsym(handle, prefix, "calloc");
+	funcs->fn_realloc = (void *(*)(void *, size_t))stress_malloc_dlsym(handle, prefix, "realloc");
+	funcs->fn_free = (void (*)(void *))stress_malloc_dlsym(handle, prefix, "free");
+	if (!funcs->fn_calloc || !funcs->fn_realloc || !funcs->fn_free) {
+		pr_inf_skip("%s: %s does not provide %scalloc, %srealloc and %sfree, skipping stressor\n",
+			args->name, filename, prefix, prefix, prefix);
+		(void)dlclose(handle);
+		return NULL;
+	}
+	funcs->fn_posix_memalign = (int (*)(void **, size_t, size_t))stress_malloc_dlsym(handle, prefix, "posix_memalign");
+	funcs->fn_aligned_alloc = (void *(*)(size_t, size_t))stress_malloc_dlsym(handle, prefix, "aligned_alloc");
+	funcs->fn_memalign = (void *(*)(size_t, size_t))stress_malloc_dlsym(handle, prefix, "memalign");
+	funcs->fn_malloc_usable_size = (size_t (*)(void *))stress_malloc_dlsym(handle, prefix, "malloc_usable_size");
+
+	if (args->instance == 0)
+		pr_inf("%s: using allocator %s (%smalloc)\n", args->name, filename, prefix);
+	return handle;
+}
+#endif
+
 /*
  *  stress_malloc()
  *	stress malloc by performing a mix of
@@ -462,12 +715,36 @@ static int stress_malloc(stress_args_t *args)
 {
 	int ret;
 	bool malloc_zerofree = false;
+	char *malloc_allocator = NULL;
+#if defined(STRESS_MALLOC_ALLOCATOR)
+	void *handle = NULL;
+#endif
 
 	stress_alloc_action("<unknown>", 0);
 
+	stress_malloc_funcs_libc(&malloc_funcs);
+	malloc_libc = true;
+	(void)stress_get_setting("malloc-allocator", &malloc_allocator);
+	if (malloc_allocator) {
+#if defined(STRESS_MALLOC_ALLOCATOR)
+		handle = stress_malloc_funcs_dlopen(args, malloc_allocator, &malloc_funcs);
+		if (!handle)
+			return EXIT_NO_RESOURCE;
+		malloc_libc = false;
+#else
+		if (args->instance == 0)
+			pr_inf("%s: --malloc-allocator requires dynamic loading support, "
+				"using the libc allocator\n", args->name);
+#endif
+	}
+
 	counter_lock = stress_lock_create("counter");
 	if (!counter_lock) {
 		pr_inf_skip("%s: failed to create counter lock. skipping stressor\n", args->name);
+#if defined(STRESS_MALLOC_ALLOCATOR)
+		if (handle)
+			(void)dlclose(handle);
+#endif
 		return EXIT_NO_RESOURCE;
 	}
 
@@ -481,6 +758,11 @@ static int stress_malloc(stress_args_t *args)
 	malloc_bytes /= args->instances;
 	if (malloc_bytes < MIN_MALLOC_BYTES)
 		malloc_bytes = MIN_MALLOC_BYTES;
+	for (malloc_bytes_shift = 3; ((size_t)2 << malloc_bytes_shift) <= malloc_bytes; malloc_bytes_shift++)
+		;
+
+	malloc_sizes = MALLOC_SIZES_UNIFORM;
+	(void)stress_get_setting("malloc-sizes", &malloc_sizes);
 
 	malloc_max = DEFAULT_MALLOC_MAX;
 	if (!stress_get_setting("malloc-max", &malloc_max)) {
@@ -493,7 +775,7 @@ static int stress_malloc(stress_args_t *args)
 #if defined(HAVE_COMPILER_GCC_OR_MUSL) && 	\
     defined(HAVE_MALLOPT) &&			\
     defined(M_MMAP_THRESHOLD)
-	{
+	if (malloc_libc) {
 		size_t malloc_threshold = DEFAULT_MALLOC_THRESHOLD;
 
 		if (stress_get_setting("malloc-threshold", &malloc_threshold))
@@ -513,15 +795,28 @@ static int stress_malloc(stress_args_t *args)
 	ret = stress_oomable_child(args, NULL, stress_malloc_child, STRESS_OOMABLE_NORMAL);
 
 	(void)stress_lock_destroy(counter_lock);
+#if defined(STRESS_MALLOC_ALLOCATOR)
+	if (handle)
+		(void)dlclose(handle);
+#endif
 
 	return ret;
 }
 
+static const char *stress_malloc_sizes(const size_t i)
+{
+	static const char * const sizes[] = { "uniform", "log2", "small" };
+
+	return (i < SIZEOF_ARRAY(sizes)) ? sizes[i] : NULL;
+}
+
 static const stress_opt_t opts[] = {
+	{ OPT_malloc_allocator,	"malloc-allocator", TYPE_ID_STR, 0, 0, NULL },
 	{ OPT_malloc_bytes,	"malloc-bytes",     TYPE_ID_SIZE_T_BYTES_VM, MIN_MALLOC_BYTES, MAX_MALLOC_BYTES, NULL },
 	{ OPT_malloc_max,	"malloc-max",       TYPE_ID_SIZE_T_BYTES_VM, MIN_MALLOC_MAX, MAX_MALLOC_MAX, NULL },
 	{ OPT_malloc_mlock,	"malloc-mlock",     TYPE_ID_BOOL, 0, 1, NULL },
 	{ OPT_malloc_pthreads,	"malloc-pthreads",  TYPE_ID_SIZE_T, MIN_MALLOC_PTHREADS, MAX_MALLOC_PTHREADS, NULL },
+	{ OPT_malloc_sizes,	"malloc-sizes",     TYPE_ID_SIZE_T_METHOD, 0, 0, stress_malloc_sizes },
 	{ OPT_malloc_threshold,	"malloc-thresh",    TYPE_ID_SIZE_T_BYTES_VM, MIN_MALLOC_THRESHOLD, MAX_MALLOC_THRESHOLD, NULL },
 	{ OPT_malloc_touch,	"malloc-touch",     TYPE_ID_BOOL, 0, 1, NULL },
 	{ OPT_malloc_trim,	"malloc-trim",      TYPE_ID_BOOL, 0, 1, NULL },
@@ -534,5 +829,6 @@ const stressor_info_t stress_malloc_info = {
 	.class = CLASS_CPU_CACHE | CLASS_MEMORY | CLASS_VM | CLASS_OS,
 	.opts = opts,
 	.verify = VERIFY_OPTIONAL,
+	.metrics_max = 4,
 	.help = help
 };
@@ -54,6 +54,8 @@ typedef void (*stress_matrix_3d_func_t)(
 typedef struct {
 	const char			*name;		/* human readable form of stressor */
 	const stress_matrix_3d_func_t	func[2];	/* method functions, x by y by z, z by y by x */
+	const double			flops;		/* floating point ops per element */
+	const double			accesses;	/* minimum element loads and stores per element */
 } stress_matrix_3d_method_info_t;
 
 static const char *current_method = NULL;		/* current matrix method */
@@ -724,6 +726,178 @@ static void OPTIMIZE3 TARGET_CLONES stress_matrix_3d_zyx_identity(
 	}
 }
 
+#define MATRIX3D_STENCIL_C0	((stress_matrix_3d_type_t)0.5)
+#define MATRIX3D_STENCIL_C1	((stress_matrix_3d_type_t)(1.0 / 12.0))
+#define MATRIX3D_TILE_J		(32)	/* stencil tile rows */
+#define MATRIX3D_TILE_K		(MAX_MATRIX3D_SIZE)	/* whole rows, prefetchers like long runs */
+
+/*
+ *  stress_matrix_3d_stencil7_point()
+ *	7 point Jacobi stencil of a at interior point i, j, k
+ */
+#define stress_matrix_3d_stencil7_point(a, i, j, k)		\
+	((MATRIX3D_STENCIL_C0 * a[i][j][k]) +			\
+	 (MATRIX3D_STENCIL_C1 * (a[i - 1][j][k] + a[i + 1][j][k] +	\
+				 a[i][j - 1][k] + a[i][j + 1][k] +	\
+				 a[i][j][k - 1] + a[i][j][k + 1])))
+
+/*
+ *  stress_matrix_3d_stencil7_faces()
+ *	the stencil leaves the outer faces unchanged, r = a
+ */
+static void OPTIMIZE3 stress_matrix_3d_stencil7_faces(
+	const size_t n,
+	stress_matrix_3d_type_t a[RESTRICT n][n][n],
+	stress_matrix_3d_type_t r[RESTRICT n][n][n])
+{
+	const size_t row_size = sizeof(stress_matrix_3d_type_t) * n;
+	register size_t i;
+
+	(void)shim_memcpy(r[0], a[0], row_size * n);
+	(void)shim_memcpy(r[n - 1], a[n - 1], row_size * n);
+	for (i = 1; i < n - 1; i++) {
+		register size_t j;
+
+		(void)shim_memcpy(r[i][0], a[i][0], row_size);
+		(void)shim_memcpy(r[i][n - 1], a[i][n - 1], row_size);
+		for (j = 1; j < n - 1; j++) {
+			r[i][j][0] = a[i][j][0];
+			r[i][j][n - 1] = a[i][j][n - 1];
+		}
+	}
+}
+
+/*
+ *  stress_matrix_3d_xyz_stencil7()
+ *	7 point stencil, naive loops
+ */
+static void OPTIMIZE3 TARGET_CLONES stress_matrix_3d_xyz_stencil7(
+	const size_t n,
+	stress_matrix_3d_type_t a[RESTRICT n][n][n],
+	stress_matrix_3d_type_t b[RESTRICT n][n][n],
+	stress_matrix_3d_type_t r[RESTRICT n][n][n])
+{
+	register size_t i;
+
+	(void)b;
+
+	stress_matrix_3d_stencil7_faces(n, a, r);
+	for (i = 1; i < n - 1; i++) {
+		register size_t j;
+
+		for (j = 1; j < n - 1; j++) {
+			register size_t k;
+
+			for (k = 1; k < n - 1; k++) {
+				r[i][j][k] = stress_matrix_3d_stencil7_point(a, i, j, k);
+			}
+		}
+	}
+}
+
+/*
+ *  stress_matrix_3d_zyx_stencil7()
+ *	7 point stencil, naive loops
+ */
+static void OPTIMIZE3 TARGET_CLONES stress_matrix_3d_zyx_stencil7(
+	const size_t n,
+	stress_matrix_3d_type_t a[RESTRICT n][n][n],
+	stress_matrix_3d_type_t b[RESTRICT n][n][n],
+	stress_matrix_3d_type_t r[RESTRICT n][n][n])
+{
+	register size_t k;
+
+	(void)b;
+
+	stress_matrix_3d_stencil7_faces(n, a, r);
+	for (k = 1; k < n - 1; k++) {
+		register size_t j;
+
+		for (j = 1; j < n - 1; j++) {
+			register size_t i;
+
+			for (i = 1; i < n - 1; i++) {
+				r[i][j][k] = stress_matrix_3d_stencil7_point(a, i, j, k);
+			}
+		}
+	}
+}
+
+/*
+ *  stress_matrix_3d_stencil7_tile()
+ *	stencil over one j, k tile, streaming through i so that
+ *	only three planes of the tile need to stay in cache
+ */
+static inline void ALWAYS_INLINE stress_matrix_3d_stencil7_tile(
+	const size_t n,
+	stress_matrix_3d_type_t a[RESTRICT n][n][n],
+	stress_matrix_3d_type_t r[RESTRICT n][n][n],
+	const size_t jj,
+	const size_t kk)
+{
+	const size_t j_end = STRESS_MINIMUM(jj + MATRIX3D_TILE_J, n - 1);
+	const size_t k_end = STRESS_MINIMUM(kk + MATRIX3D_TILE_K, n - 1);
+	register size_t i;
+
+	for (i = 1; i < n - 1; i++) {
+		register size_t j;
+
+		for (j = jj; j < j_end; j++) {
+			register size_t k;
+
+			for (k = kk; k < k_end; k++) {
+				r[i][j][k] = stress_matrix_3d_stencil7_point(a, i, j, k);
+			}
+		}
+	}
+}
+
+/*
+ *  stress_matrix_3d_xyz_stencil7_tiled()
+ *	7 point stencil, cache blocked in y and x (2.5D blocking)
+ */
+static void OPTIMIZE3 TARGET_CLONES stress_matrix_3d_xyz_stencil7_tiled(
+	const size_t n,
+	stress_matrix_3d_type_t a[RESTRICT n][n][n],
+	stress_matrix_3d_type_t b[RESTRICT n][n][n],
+	stress_matrix_3d_type_t r[RESTRICT n][n][n])
+{
+	register size_t jj;
+
+	(void)b;
+
+	stress_matrix_3d_stencil7_faces(n, a, r);
+	for (jj = 1; jj < n - 1; jj += MATRIX3D_TILE_J) {
+		register size_t kk;
+
+		for (kk = 1; kk < n - 1; kk += MATRIX3D_TILE_K)
+			stress_matrix_3d_stencil7_tile(n, a, r, jj, kk);
+	}
+}
+
+/*
+ *  stress_matrix_3d_zyx_stencil7_tiled()
+ *	7 point stencil, cache blocked, tiles visited x then y
+ */
+static void OPTIMIZE3 TARGET_CLONES stress_matrix_3d_zyx_stencil7_tiled(
+	const size_t n,
+	stress_matrix_3d_type_t a[RESTRICT n][n][n],
+	stress_matrix_3d_type_t b[RESTRICT n][n][n],
+	stress_matrix_3d_type_t r[RESTRICT n][n][n])
+{
+	register size_t kk;
+
+	(void)b;
+
+	stress_matrix_3d_stencil7_faces(n, a, r);
+	for (kk = 1; kk < n - 1; kk += MATRIX3D_TILE_K) {
+		register size_t jj;
+
+		for (jj = 1; jj < n - 1; jj += MATRIX3D_TILE_J)
+			stress_matrix_3d_stencil7_tile(n, a, r, jj, kk);
+	}
+}
+
 static void stress_matrix_3d_xyz_all(
 	const size_t n,
 	stress_matrix_3d_type_t a[RESTRICT n][n][n],
@@ -740,19 +914,21 @@ static void stress_matrix_3d_zyx_all(
  * Table of matrix_3 stress methods, ordered x by y by z and z by y by x
  */
 static const stress_matrix_3d_method_info_t matrix_3d_methods[] = {
-	{ "all",		{ stress_matrix_3d_xyz_all,		stress_matrix_3d_zyx_all } },/* Special "all" test */
-	{ "add",		{ stress_matrix_3d_xyz_add,		stress_matrix_3d_zyx_add } },
-	{ "copy",		{ stress_matrix_3d_xyz_copy,		stress_matrix_3d_zyx_copy } },
-	{ "div",		{ stress_matrix_3d_xyz_div,		stress_matrix_3d_zyx_div } },
-	{ "frobenius",		{ stress_matrix_3d_xyz_frobenius,	stress_matrix_3d_zyx_frobenius } },
-	{ "hadamard",		{ stress_matrix_3d_xyz_hadamard,	stress_matrix_3d_zyx_hadamard } },
-	{ "identity",		{ stress_matrix_3d_xyz_identity,	stress_matrix_3d_zyx_identity } },
-	{ "mean",		{ stress_matrix_3d_xyz_mean,		stress_matrix_3d_zyx_mean } },
-	{ "mult",		{ stress_matrix_3d_xyz_mult,		stress_matrix_3d_zyx_mult } },
-	{ "negate",		{ stress_matrix_3d_xyz_negate,		stress_matrix_3d_zyx_negate } },
-	{ "sub",		{ stress_matrix_3d_xyz_sub,		stress_matrix_3d_zyx_sub } },
-	{ "trans",		{ stress_matrix_3d_xyz_trans,		stress_matrix_3d_zyx_trans } },
-	{ "zero",		{ stress_matrix_3d_xyz_zero,		stress_matrix_3d_zyx_zero } },
+	{ "all",		{ stress_matrix_3d_xyz_all,		stress_matrix_3d_zyx_all },		0, 0 },/* Special "all" test */
+	{ "add",		{ stress_matrix_3d_xyz_add,		stress_matrix_3d_zyx_add },		1, 3 },
+	{ "copy",		{ stress_matrix_3d_xyz_copy,		stress_matrix_3d_zyx_copy },		0, 2 },
+	{ "div",		{ stress_matrix_3d_xyz_div,		stress_matrix_3d_zyx_div },		1, 2 },
+	{ "frobenius",		{ stress_matrix_3d_xyz_frobenius,	stress_matrix_3d_zyx_frobenius },	2, 2 },
+	{ "hadamard",		{ stress_matrix_3d_xyz_hadamard,	stress_matrix_3d_zyx_hadamard },	1, 3 },
+	{ "identity",		{ stress_matrix_3d_xyz_identity,	stress_matrix_3d_zyx_identity },	0, 1 },
+	{ "mean",		{ stress_matrix_3d_xyz_mean,		stress_matrix_3d_zyx_mean },		2, 3 },
+	{ "mult",		{ stress_matrix_3d_xyz_mult,		stress_matrix_3d_zyx_mult },		1, 2 },
+	{ "negate",		{ stress_matrix_3d_xyz_negate,		stress_matrix_3d_zyx_negate },		1, 2 },
+	{ "stencil7",		{ stress_matrix_3d_xyz_stencil7,	stress_matrix_3d_zyx_stencil7 },	8, 2 },
+	{ "stencil7-tiled",	{ stress_matrix_3d_xyz_stencil7_tiled,	stress_matrix_3d_zyx_stencil7_tiled },	8, 2 },
+	{ "sub",		{ stress_matrix_3d_xyz_sub,		stress_matrix_3d_zyx_sub },		1, 3 },
+	{ "trans",		{ stress_matrix_3d_xyz_trans,		stress_matrix_3d_zyx_trans },		0, 2 },
+	{ "zero",		{ stress_matrix_3d_xyz_zero,		stress_matrix_3d_zyx_zero },		0, 1 },
 };
 
 static stress_metrics_t matrix_3d_metrics[SIZEOF_ARRAY(matrix_3d_methods)];
@@ -933,11 +1109,25 @@ static inline int stress_matrix_3d_exercise(
 		if (matrix_3d_metrics[i].duration > 0.0) {
 			char msg[64];
 			const double rate = matrix_3d_metrics[i].count / matrix_3d_metrics[i].duration;
+			const double elements = (double)n * (double)n * (double)n;
 
 			(void)snprintf(msg, sizeof(msg), "%s matrix-3d ops per sec", matrix_3d_methods[i].name);
 			stress_metrics_set(args, j, msg,
 				rate, STRESS_METRIC_HARMONIC_MEAN);
 			j++;
+			if (matrix_3d_methods[i].flops > 0.0) {
+				(void)snprintf(msg, sizeof(msg), "%s matrix-3d GFLOPS", matrix_3d_methods[i].name);
+				stress_metrics_set(args, j, msg,
+					rate * elements * matrix_3d_methods[i].flops / 1.0E9,
+					STRESS_METRIC_HARMONIC_MEAN);
+				j++;
+			}
+			(void)snprintf(msg, sizeof(msg), "%s matrix-3d GB per sec", matrix_3d_methods[i].name);
+			stress_metrics_set(args, j, msg,
+				rate * elements * matrix_3d_methods[i].accesses *
+				(double)sizeof(stress_matrix_3d_type_t) / (double)GB,
+				STRESS_METRIC_HARMONIC_MEAN);
+			j++;
 		}
 	}
 
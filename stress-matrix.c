@@ -22,14 +22,20 @@
 #include "core-madvise.h"
 #include "core-pragma.h"
 #include "core-put.h"
+#include "core-pthread.h"
 #include "core-target-clones.h"
 
 #define MIN_MATRIX_SIZE		(16)
 #define MAX_MATRIX_SIZE		(8192)
 #define DEFAULT_MATRIX_SIZE	(128)
 
+#define MIN_MATRIX_GEMM_THREADS	(1)
+#define MAX_MATRIX_GEMM_THREADS	(256)
+#define DEFAULT_MATRIX_GEMM_THREADS (1)
+
 static const stress_help_t help[] = {
 	{ NULL,	"matrix N",		"start N workers exercising matrix operations" },
+	{ NULL,	"matrix-gemm-threads N", "use N threads for the gemm matrix method" },
 	{ NULL,	"matrix-method M",	"specify matrix stress method M, default is all" },
 	{ NULL,	"matrix-ops N",		"stop after N maxtrix bogo operations" },
 	{ NULL,	"matrix-size N",	"specify the size of the N x N matrix" },
@@ -55,8 +61,20 @@ typedef struct {
 	const stress_matrix_func_t	func[2];	/* method functions, x by y, y by x */
 } stress_matrix_method_info_t;
 
-static const char *current_method = NULL;		/* current matrix method */
-static size_t method_all_index;				/* all method index */
+static STRESS_THREAD_LOCAL const char *current_method = NULL;	/* current matrix method */
+static STRESS_THREAD_LOCAL size_t method_all_index;		/* all method index */
+static size_t matrix_gemm_threads = DEFAULT_MATRIX_GEMM_THREADS; /* gemm method threads */
+
+#define MATRIX_GEMM_VL		(8)	/* elements per SIMD vector */
+#define MATRIX_GEMM_NV		(2)	/* SIMD vectors per micro-kernel row */
+#define MATRIX_GEMM_MR		(4)	/* micro-kernel tile rows */
+#define MATRIX_GEMM_NR		(MATRIX_GEMM_VL * MATRIX_GEMM_NV) /* micro-kernel tile columns */
+#define MATRIX_GEMM_KC		(256)	/* k dimension cache block size */
+
+#if defined(HAVE_VECMATH)
+typedef stress_matrix_type_t stress_matrix_gemm_vec_t
+	__attribute__ ((vector_size(sizeof(stress_matrix_type_t) * MATRIX_GEMM_VL)));
+#endif
 
 static const stress_matrix_method_info_t matrix_methods[];
 
@@ -734,6 +752,245 @@ static void OPTIMIZE3 TARGET_CLONES stress_matrix_yx_square(
 	}
 }
 
+/*
+ *  stress_matrix_gemm_edge()
+ *	scalar product of the rows i0..i1-1 and columns j0..j1-1 of a and b
+ *	over the k block k0..k1-1, accumulated into r, used for the edges
+ *	of the matrix that do not fill a whole micro-kernel tile
+ */
+static inline void ALWAYS_INLINE stress_matrix_gemm_edge(
+	const size_t n,
+	stress_matrix_type_t a[RESTRICT n][n],
+	stress_matrix_type_t b[RESTRICT n][n],
+	stress_matrix_type_t r[RESTRICT n][n],
+	const size_t i0,
+	const size_t i1,
+	const size_t j0,
+	const size_t j1,
+	const size_t k0,
+	const size_t k1)
+{
+	register size_t i;
+
+	for (i = i0; i < i1; i++) {
+		register size_t j;
+
+		for (j = j0; j < j1; j++) {
+			register size_t k;
+			register stress_matrix_type_t sum = r[i][j];
+
+			for (k = k0; k < k1; k++)
+				sum += a[i][k] * b[k][j];
+			r[i][j] = sum;
+		}
+	}
+}
+
+/*
+ *  stress_matrix_gemm_kernel()
+ *	register blocked micro-kernel, accumulates a MATRIX_GEMM_MR x
+ *	MATRIX_GEMM_NR tile of r at (i, j) over the k block k0..k1-1,
+ *	the tile is held in registers for the entire k block
+ */
+static inline void ALWAYS_INLINE stress_matrix_gemm_kernel(
+	const size_t n,
+	stress_matrix_type_t a[RESTRICT n][n],
+	stress_matrix_type_t b[RESTRICT n][n],
+	stress_matrix_type_t r[RESTRICT n][n],
+	const size_t i,
+	const size_t j,
+	const size_t k0,
+	const size_t k1)
+{
+	register size_t k, m;
+#if defined(HAVE_VECMATH)
+	stress_matrix_gemm_vec_t c[MATRIX_GEMM_MR][MATRIX_GEMM_NV];
+
+	for (m = 0; m < MATRIX_GEMM_MR; m++) {
+		shim_memcpy(&c[m][0], &r[i + m][j], sizeof(c[m][0]));
+		shim_memcpy(&c[m][1], &r[i + m][j + MATRIX_GEMM_VL], sizeof(c[m][1]));
+	}
+	for (k = k0; k < k1; k++) {
+		stress_matrix_gemm_vec_t b0, b1;
+
+		shim_memcpy(&b0, &b[k][j], sizeof(b0));
+		shim_memcpy(&b1, &b[k][j + MATRIX_GEMM_VL], sizeof(b1));
+		for (m = 0; m < MATRIX_GEMM_MR; m++) {
+			const stress_matrix_type_t av = a[i + m][k];
+
+			c[m][0] += av * b0;
+			c[m][1] += av * b1;
+		}
+	}
+	for (m = 0; m < MATRIX_GEMM_MR; m++) {
+		shim_memcpy(&r[i + m][j], &c[m][0], sizeof(c[m][0]));
+		shim_memcpy(&r[i + m][j + MATRIX_GEMM_VL], &c[m][1], sizeof(c[m][1]));
+	}
+#else
+	stress_matrix_type_t c[MATRIX_GEMM_MR][MATRIX_GEMM_NR];
+	register size_t l;
+
+	for (m = 0; m < MATRIX_GEMM_MR; m++)
+		for (l = 0; l < MATRIX_GEMM_NR; l++)
+			c[m][l] = r[i + m][j + l];
+	for (k = k0; k < k1; k++) {
+		for (m = 0; m < MATRIX_GEMM_MR; m++) {
+			const stress_matrix_type_t av = a[i + m][k];
+
+PRAGMA_UNROLL_N(8)
+			for (l = 0; l < MATRIX_GEMM_NR; l++)
+				c[m][l] += av * b[k][j + l];
+		}
+	}
+	for (m = 0; m < MATRIX_GEMM_MR; m++)
+		for (l = 0; l < MATRIX_GEMM_NR; l++)
+			r[i + m][j + l] = c[m][l];
+#endif
+}
+
+/*
+ *  stress_matrix_gemm_rows()
+ *	cache and register blocked matrix product of rows i0..i1-1,
+ *	the k dimension is split into MATRIX_GEMM_KC blocks so that the
+ *	rows of b being used stay cache resident, yx selects column
+ *	tiles as the outer loop rather than row tiles
+ */
+static void OPTIMIZE3 TARGET_CLONES stress_matrix_gemm_rows(
+	const size_t n,
+	stress_matrix_type_t a[RESTRICT n][n],
+	stress_matrix_type_t b[RESTRICT n][n],
+	stress_matrix_type_t r[RESTRICT n][n],
+	const size_t i0,
+	const size_t i1,
+	const bool yx)
+{
+	register size_t i, j, k0;
+	const size_t i_tiles = i0 + (((i1 - i0) / MATRIX_GEMM_MR) * MATRIX_GEMM_MR);
+	const size_t j_tiles = (n / MATRIX_GEMM_NR) * MATRIX_GEMM_NR;
+
+	for (i = i0; i < i1; i++)
+		(void)shim_memset(r[i], 0, n * sizeof(r[i][0]));
+
+	for (k0 = 0; k0 < n; k0 += MATRIX_GEMM_KC) {
+		const size_t k1 = STRESS_MINIMUM(k0 + MATRIX_GEMM_KC, n);
+
+		if (yx) {
+			for (j = 0; j < j_tiles; j += MATRIX_GEMM_NR)
+				for (i = i0; i < i_tiles; i += MATRIX_GEMM_MR)
+					stress_matrix_gemm_kernel(n, a, b, r, i, j, k0, k1);
+		} else {
+			for (i = i0; i < i_tiles; i += MATRIX_GEMM_MR)
+				for (j = 0; j < j_tiles; j += MATRIX_GEMM_NR)
+					stress_matrix_gemm_kernel(n, a, b, r, i, j, k0, k1);
+		}
+		stress_matrix_gemm_edge(n, a, b, r, i0, i_tiles, j_tiles, n, k0, k1);
+		stress_matrix_gemm_edge(n, a, b, r, i_tiles, i1, 0, n, k0, k1);
+	}
+}
+
+#if defined(HAVE_LIB_PTHREAD)
+typedef struct {
+	size_t n;			/* matrix size */
+	stress_matrix_type_t *a;	/* n x n matrices */
+	stress_matrix_type_t *b;
+	stress_matrix_type_t *r;
+	size_t i0;			/* first row */
+	size_t i1;			/* last row + 1 */
+	bool yx;			/* y by x tile order */
+	pthread_t pthread;		/* thread handle */
+	int ret;			/* pthread_create return */
+} stress_matrix_gemm_thread_t;
+
+/*
+ *  stress_matrix_gemm_thread()
+ *	compute a range of rows of the matrix product
+ */
+static void *stress_matrix_gemm_thread(void *arg)
+{
+	const stress_matrix_gemm_thread_t *t = (stress_matrix_gemm_thread_t *)arg;
+	const size_t n = t->n;
+	typedef stress_matrix_type_t (*matrix_ptr_t)[n];
+
+	stress_matrix_gemm_rows(n, (matrix_ptr_t)t->a, (matrix_ptr_t)t->b,
+		(matrix_ptr_t)t->r, t->i0, t->i1, t->yx);
+	return &g_nowt;
+}
+#endif
+
+/*
+ *  stress_matrix_gemm()
+ *	matrix product, the rows are split into MATRIX_GEMM_MR aligned
+ *	ranges, one per --matrix-gemm-threads thread
+ */
+static void stress_matrix_gemm(
+	const size_t n,
+	stress_matrix_type_t a[RESTRICT n][n],
+	stress_matrix_type_t b[RESTRICT n][n],
+	stress_matrix_type_t r[RESTRICT n][n],
+	const bool yx)
+{
+#if defined(HAVE_LIB_PTHREAD)
+	stress_matrix_gemm_thread_t threads[MAX_MATRIX_GEMM_THREADS];
+	const size_t tiles = (n + MATRIX_GEMM_MR - 1) / MATRIX_GEMM_MR;
+	const size_t num_threads = STRESS_MINIMUM(matrix_gemm_threads, tiles);
+	size_t i;
+
+	if (num_threads > 1) {
+		for (i = 0; i < num_threads; i++) {
+			stress_matrix_gemm_thread_t *t = &threads[i];
+
+			t->n = n;
+			t->a = &a[0][0];
+			t->b = &b[0][0];
+			t->r = &r[0][0];
+			t->i0 = STRESS_MINIMUM(((tiles * i) / num_threads) * MATRIX_GEMM_MR, n);
+			t->i1 = STRESS_MINIMUM(((tiles * (i + 1)) / num_threads) * MATRIX_GEMM_MR, n);
+			t->yx = yx;
+			/* the first range is computed by the calling thread */
+			t->ret = (i == 0) ? -1 :
+				pthread_create(&t->pthread, NULL, stress_matrix_gemm_thread, (void *)t);
+		}
+		/* compute ranges where threads could not be created */
+		for (i = 0; i < num_threads; i++) {
+			if (threads[i].ret != 0)
+				(void)stress_matrix_gemm_thread((void *)&threads[i]);
+		}
+		for (i = 1; i < num_threads; i++) {
+			if (threads[i].ret == 0)
+				(void)pthread_join(threads[i].pthread, NULL);
+		}
+		return;
+	}
+#endif
+	stress_matrix_gemm_rows(n, a, b, r, 0, n, yx);
+}
+
+/*
+ *  stress_matrix_xy_gemm()
+ *	cache and register blocked matrix product
+ */
+static void stress_matrix_xy_gemm(
+	const size_t n,
+	stress_matrix_type_t a[RESTRICT n][n],
+	stress_matrix_type_t b[RESTRICT n][n],
+	stress_matrix_type_t r[RESTRICT n][n])
+{
+	stress_matrix_gemm(n, a, b, r, false);
+}
+
+/*
+ *  stress_matrix_yx_gemm()
+ *	cache and register blocked matrix product, column tiles outermost
+ */
+static void stress_matrix_yx_gemm(
+	const size_t n,
+	stress_matrix_type_t a[RESTRICT n][n],
+	stress_matrix_type_t b[RESTRICT n][n],
+	stress_matrix_type_t r[RESTRICT n][n])
+{
+	stress_matrix_gemm(n, a, b, r, true);
+}
+
 /*
  *  stress_matrix_xy_all()
  *	iterate over all matrix stressors
@@ -764,6 +1021,7 @@ static const stress_matrix_method_info_t matrix_methods[] = {
 	{ "copy",		{ stress_matrix_xy_copy,	stress_matrix_yx_copy } },
 	{ "div",		{ stress_matrix_xy_div,		stress_matrix_yx_div } },
 	{ "frobenius",		{ stress_matrix_xy_frobenius,	stress_matrix_yx_frobenius } },
+	{ "gemm",		{ stress_matrix_xy_gemm,	stress_matrix_yx_gemm } },
 	{ "hadamard",		{ stress_matrix_xy_hadamard,	stress_matrix_yx_hadamard } },
 	{ "identity",		{ stress_matrix_xy_identity,	stress_matrix_yx_identity } },
 	{ "mean",		{ stress_matrix_xy_mean,	stress_matrix_yx_mean } },
@@ -776,7 +1034,7 @@ static const stress_matrix_method_info_t matrix_methods[] = {
 	{ "zero",		{ stress_matrix_xy_zero,	stress_matrix_yx_zero } },
 };
 
-static stress_metrics_t matrix_metrics[SIZEOF_ARRAY(matrix_methods)];
+static STRESS_THREAD_LOCAL stress_metrics_t matrix_metrics[SIZEOF_ARRAY(matrix_methods)];
 
 /*
  *  stress_matrix_xy_all()
@@ -957,10 +1215,18 @@ static inline int stress_matrix_exercise(
 			stress_metrics_set(args, j, msg,
 				rate, STRESS_METRIC_HARMONIC_MEAN);
 			j++;
+
+			/* gemm is 2 x n^3 floating point operations per product */
+			if (matrix_methods[i].func[0] == stress_matrix_xy_gemm) {
+				const double flops = 2.0 * (double)n * (double)n * (double)n;
+
+				stress_metrics_set(args, j, "gemm GFLOPS",
+					(rate * flops) / 1.0E9, STRESS_METRIC_HARMONIC_MEAN);
+				j++;
+			}
 		}
 	}
 
-
 	if (verify)
 		(void)munmap((void *)s, matrix_mmap_size);
 tidy_r:
@@ -988,6 +1254,7 @@ static int stress_matrix(stress_args_t *args)
 
 	(void)stress_get_setting("matrix-method", &matrix_method);
 	(void)stress_get_setting("matrix-yx", &matrix_yx);
+	(void)stress_get_setting("matrix-gemm-threads", &matrix_gemm_threads);
 
 	if (args->instance == 0)
 		pr_dbg("%s: using method '%s' (%s)\n", args->name, matrix_methods[matrix_method].name,
@@ -1017,6 +1284,7 @@ static const char *stress_matrix_method(const size_t i)
 }
 
 static const stress_opt_t opts[] = {
+	{ OPT_matrix_gemm_threads, "matrix-gemm-threads", TYPE_ID_SIZE_T, MIN_MATRIX_GEMM_THREADS, MAX_MATRIX_GEMM_THREADS, NULL },
 	{ OPT_matrix_method, "matrix-method", TYPE_ID_SIZE_T_METHOD, 0, 0, stress_matrix_method },
 	{ OPT_matrix_size,   "matrix-size",   TYPE_ID_SIZE_T, MIN_MATRIX_SIZE, MAX_MATRIX_SIZE, NULL },
 	{ OPT_matrix_yx,     "matrix-yx",     TYPE_ID_BOOL, 0, 1, NULL },
@@ -1028,12 +1296,14 @@ const stressor_info_t stress_matrix_info = {
 	.class = CLASS_CPU | CLASS_FP | CLASS_CPU_CACHE | CLASS_MEMORY | CLASS_COMPUTE,
 	.opts = opts,
 	.verify = VERIFY_OPTIONAL,
+	.instance_threads = true,
 	.help = help
 };
 
 #else
 
 static const stress_opt_t opts[] = {
+	{ OPT_matrix_gemm_threads, "matrix-gemm-threads", TYPE_ID_SIZE_T, MIN_MATRIX_GEMM_THREADS, MAX_MATRIX_GEMM_THREADS, NULL },
 	{ OPT_matrix_method, "matrix-method", TYPE_ID_SIZE_T_METHOD, 0, 0, stress_unimplemented_method },
 	{ OPT_matrix_size,   "matrix-size",   TYPE_ID_SIZE_T, MIN_MATRIX_SIZE, MAX_MATRIX_SIZE, NULL },
 	{ OPT_matrix_yx,     "matrix-yx",     TYPE_ID_BOOL, 0, 1, NULL },
@@ -19,6 +19,7 @@
  */
 #include "stress-ng.h"
 #include "core-builtin.h"
+#include "core-latency.h"
 #include "core-pthread.h"
 
 #if defined(HAVE_LINUX_MEMBARRIER_H)
@@ -29,12 +30,24 @@
 #define HAVE_MEMBARRIER
 #endif
 
+#define MIN_MEMBARRIER_SWEEP_THREADS	(1)
+#define MAX_MEMBARRIER_SWEEP_THREADS	(1024)
+
 static const stress_help_t help[] = {
 	{ NULL,	"membarrier N",		"start N workers performing membarrier system calls" },
 	{ NULL,	"membarrier-ops N",	"stop after N membarrier bogo operations" },
+	{ NULL,	"membarrier-sweep",	"measure expedited membarrier latency over a sweep of thread counts" },
+	{ NULL,	"membarrier-sweep-threads N", "maximum number of threads in membarrier-sweep" },
 	{ NULL,	NULL,			NULL }
 };
 
+static const stress_opt_t opts[] = {
+	{ OPT_membarrier_sweep,         "membarrier-sweep",         TYPE_ID_BOOL, 0, 1, NULL },
+	{ OPT_membarrier_sweep_threads, "membarrier-sweep-threads", TYPE_ID_UINT32,
+	  MIN_MEMBARRIER_SWEEP_THREADS, MAX_MEMBARRIER_SWEEP_THREADS, NULL },
+	END_OPT,
+};
+
 #if defined(HAVE_LIB_PTHREAD) && \
     defined(HAVE_MEMBARRIER)
 
@@ -143,6 +156,215 @@ static void *stress_membarrier_thread(void *arg)
 	return &g_nowt;
 }
 
+#define MEMBARRIER_SWEEP_CELL_NS	(50000000ULL)	/* duration of each sweep cell */
+#define MEMBARRIER_SWEEP_STEPS		(12)		/* max thread count steps */
+
+typedef struct {
+	const char *name;	/* short name for metrics */
+	int cmd;		/* membarrier command */
+	int register_cmd;	/* registration command */
+} stress_membarrier_sweep_cmd_t;
+
+static const stress_membarrier_sweep_cmd_t membarrier_sweep_cmds[] = {
+	{ "priv-exp",		MEMBARRIER_CMD_PRIVATE_EXPEDITED,
+				MEMBARRIER_CMD_REGISTER_PRIVATE_EXPEDITED },
+	{ "priv-exp-sync-core",	MEMBARRIER_CMD_PRIVATE_EXPEDITED_SYNC_CORE,
+				MEMBARRIER_CMD_REGISTER_PRIVATE_EXPEDITED_SYNC_CORE },
+	{ "priv-exp-rseq",	MEMBARRIER_CMD_PRIVATE_EXPEDITED_RSEQ,
+				MEMBARRIER_CMD_REGISTER_PRIVATE_EXPEDITED_RSEQ },
+	{ "global-exp",		MEMBARRIER_CMD_GLOBAL_EXPEDITED,
+				MEMBARRIER_CMD_REGISTER_GLOBAL_EXPEDITED },
+};
+
+#define MEMBARRIER_SWEEP_CMDS	(SIZEOF_ARRAY(membarrier_sweep_cmds))
+
+typedef struct {
+	pthread_t pthread;	/* spinner thread handle */
+	volatile bool running;	/* set once the spinner is running */
+} stress_membarrier_spinner_t;
+
+static volatile bool membarrier_sweep_stop;
+
+/*
+ *  stress_membarrier_sweep_spinner()
+ *	busy thread keeping a CPU running in this mm so that
+ *	expedited membarriers have to IPI it
+ */
+static void *stress_membarrier_sweep_spinner(void *arg)
+{
+	stress_membarrier_spinner_t *spinner = (stress_membarrier_spinner_t *)arg;
+
+	(void)sigprocmask(SIG_BLOCK, &set, NULL);
+	spinner->running = true;
+	while (!membarrier_sweep_stop)
+		stress_asm_nop();
+
+	return &g_nowt;
+}
+
+/*
+ *  stress_membarrier_sweep_cell()
+ *	run n_threads spinners and time the registered membarrier
+ *	commands round-robin for MEMBARRIER_SWEEP_CELL_NS
+ */
+static int stress_membarrier_sweep_cell(
+	stress_args_t *args,
+	const bool *cmd_ok,
+	stress_membarrier_spinner_t *spinners,
+	const uint32_t n_threads,
+	stress_latency_hist_t *hists)
+{
+	uint32_t i, created = 0;
+	uint64_t t_end;
+	int rc = EXIT_SUCCESS;
+
+	membarrier_sweep_stop = false;
+	for (i = 0; i < n_threads; i++) {
+		spinners[i].running = false;
+		if (pthread_create(&spinners[i].pthread, NULL,
+				stress_membarrier_sweep_spinner, (void *)&spinners[i]))
+			break;
+		created++;
+	}
+	if (created < n_threads) {
+		pr_inf_skip("%s: cannot create %" PRIu32 " threads, skipping stressor\n",
+			args->name, n_threads);
+		rc = EXIT_NO_RESOURCE;
+		goto stop;
+	}
+	for (i = 0; (i < n_threads) && stress_continue(args); i++) {
+		while (!spinners[i].running && stress_continue(args))
+			(void)shim_sched_yield();
+	}
+
+	t_end = stress_latency_now() + MEMBARRIER_SWEEP_CELL_NS;
+	do {
+		size_t c;
+
+		for (c = 0; c < MEMBARRIER_SWEEP_CMDS; c++) {
+			uint64_t t;
+
+			if (!cmd_ok[c])
+				continue;
+			t = stress_latency_now();
+			if (UNLIKELY(shim_membarrier(membarrier_sweep_cmds[c].cmd, 0, 0) < 0)) {
+				pr_fail("%s: membarrier %s failed, errno=%d (%s)\n",
+					args->name, membarrier_sweep_cmds[c].name,
+					errno, strerror(errno));
+				rc = EXIT_FAILURE;
+				goto stop;
+			}
+			stress_latency_hist_record(&hists[c], stress_latency_now() - t);
+			stress_bogo_inc(args);
+		}
+	} while ((stress_latency_now() < t_end) && stress_continue(args));
+
+stop:
+	membarrier_sweep_stop = true;
+	for (i = 0; i < created; i++)
+		(void)pthread_join(spinners[i].pthread, NULL);
+
+	return rc;
+}
+
+/*
+ *  stress_membarrier_sweep()
+ *	measure expedited membarrier latency with 0, 1, 2, 4..
+ *	other running threads to show the IPI cost as the number
+ *	of CPUs running the process grows
+ */
+static int stress_membarrier_sweep(stress_args_t *args, const unsigned int mask)
+{
+	const int32_t cpus = stress_get_processors_online();
+	uint32_t sweep_threads, steps[MEMBARRIER_SWEEP_STEPS], n;
+	size_t n_steps = 0, s, c, metric = 0;
+	bool cmd_ok[MEMBARRIER_SWEEP_CMDS];
+	bool any_ok = false;
+	stress_latency_hist_t *hists;
+	stress_membarrier_spinner_t *spinners;
+	int rc = EXIT_SUCCESS;
+
+	if (!stress_get_setting("membarrier-sweep-threads", &sweep_threads))
+		sweep_threads = (cpus < 1) ? 1 : (uint32_t)cpus;
+
+	/* thread counts 0, 1, 2, 4.. up to and including sweep_threads */
+	steps[n_steps++] = 0;
+	for (n = 1; (n < sweep_threads) && (n_steps < MEMBARRIER_SWEEP_STEPS - 1); n <<= 1)
+		steps[n_steps++] = n;
+	steps[n_steps++] = sweep_threads;
+
+	for (c = 0; c < MEMBARRIER_SWEEP_CMDS; c++) {
+		const stress_membarrier_sweep_cmd_t *cmd = &membarrier_sweep_cmds[c];
+
+		cmd_ok[c] = ((mask & (unsigned int)cmd->cmd) &&
+			     (mask & (unsigned int)cmd->register_cmd) &&
+			     (shim_membarrier(cmd->register_cmd, 0, 0) == 0));
+		if (cmd_ok[c])
+			any_ok = true;
+		else if (args->instance == 0)
+			pr_inf("%s: membarrier %s not available, skipping it\n",
+				args->name, cmd->name);
+	}
+	if (!any_ok) {
+		if (args->instance == 0)
+			pr_inf_skip("%s: no expedited membarrier commands available, "
+				"skipping stressor\n", args->name);
+		return EXIT_NOT_IMPLEMENTED;
+	}
+
+	hists = (stress_latency_hist_t *)calloc(n_steps * MEMBARRIER_SWEEP_CMDS, sizeof(*hists));
+	spinners = (stress_membarrier_spinner_t *)calloc(sweep_threads, sizeof(*spinners));
+	if (!hists || !spinners) {
+		pr_inf_skip("%s: cannot allocate latency histograms and thread "
+			"handles, skipping stressor\n", args->name);
+		free(spinners);
+		free(hists);
+		return EXIT_NO_RESOURCE;
+	}
+	for (c = 0; c < n_steps * MEMBARRIER_SWEEP_CMDS; c++)
+		stress_latency_hist_init(&hists[c]);
+
+	stress_set_proc_state(args->name, STRESS_STATE_SYNC_WAIT);
+	stress_sync_start_wait(args);
+	stress_set_proc_state(args->name, STRESS_STATE_RUN);
+
+	do {
+		for (s = 0; s < n_steps; s++) {
+			rc = stress_membarrier_sweep_cell(args, cmd_ok, spinners, steps[s],
+				&hists[s * MEMBARRIER_SWEEP_CMDS]);
+			if ((rc != EXIT_SUCCESS) || !stress_continue(args))
+				goto done;
+		}
+	} while (stress_continue(args));
+done:
+	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
+
+	for (c = 0; c < MEMBARRIER_SWEEP_CMDS; c++) {
+		for (s = 0; s < n_steps; s++) {
+			const stress_latency_hist_t *hist = &hists[s * MEMBARRIER_SWEEP_CMDS + c];
+			char msg[64];
+
+			if (hist->count == 0)
+				continue;
+			(void)snprintf(msg, sizeof(msg), "%s %" PRIu32 " threads mean usec",
+				membarrier_sweep_cmds[c].name, steps[s]);
+			stress_metrics_set(args, metric++, msg,
+				stress_latency_hist_mean(hist) / 1000.0,
+				STRESS_METRIC_GEOMETRIC_MEAN);
+			(void)snprintf(msg, sizeof(msg), "%s %" PRIu32 " threads p99 usec",
+				membarrier_sweep_cmds[c].name, steps[s]);
+			stress_metrics_set(args, metric++, msg,
+				(double)stress_latency_hist_percentile(hist, 99.0) / 1000.0,
+				STRESS_METRIC_GEOMETRIC_MEAN);
+		}
+	}
+
+	free(spinners);
+	free(hists);
+
+	return rc;
+}
+
 /*
  *  stress on membarrier()
  *	stress system by IO sync calls
@@ -155,6 +377,7 @@ static int stress_membarrier(stress_args_t *args)
 	size_t i;
 	stress_pthread_args_t pargs = { args, NULL, 0 };
 	double duration = 0.0, count = 0.0, rate;
+	bool membarrier_sweep = false;
 
 	ret = shim_membarrier(MEMBARRIER_CMD_QUERY, 0, 0);
 	if (UNLIKELY(ret < 0)) {
@@ -176,6 +399,10 @@ static int stress_membarrier(stress_args_t *args)
 	}
 
 	(void)sigfillset(&set);
+	(void)stress_get_setting("membarrier-sweep", &membarrier_sweep);
+	if (membarrier_sweep)
+		return stress_membarrier_sweep(args, (unsigned int)ret);
+
 	for (i = 0; i < MAX_MEMBARRIER_THREADS + 1; i++) {
 		info[i].pthread_ret = -1;
 		info[i].rc = EXIT_SUCCESS;
@@ -230,12 +457,14 @@ static int stress_membarrier(stress_args_t *args)
 const stressor_info_t stress_membarrier_info = {
 	.stressor = stress_membarrier,
 	.class = CLASS_CPU_CACHE | CLASS_MEMORY,
+	.opts = opts,
 	.help = help
 };
 #else
 const stressor_info_t stress_membarrier_info = {
 	.stressor = stress_unimplemented,
 	.class = CLASS_CPU_CACHE | CLASS_MEMORY,
+	.opts = opts,
 	.help = help,
 	.unimplemented_reason = "built without pthread support or membarrier() system call"
 };
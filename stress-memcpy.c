@@ -18,18 +18,30 @@
  *
  */
 #include "stress-ng.h"
+#include "core-arch.h"
+#include "core-asm-x86.h"
 #include "core-builtin.h"
+#include "core-cpu.h"
+#include "core-nt-store.h"
+#include "core-put.h"
+#include "core-simd.h"
 #include "core-target-clones.h"
 
 #define ALIGN_SIZE	(64)
 #define MEMCPY_MEMSIZE	(2048)
 #define MEMCPY_LOOPS	(1024)
 
+#define MEMCPY_SWEEP_SIZES	(24)		/* 8B .. 64MB, powers of 2 */
+#define MEMCPY_SWEEP_MIN	(8)
+#define MEMCPY_SWEEP_MAX	((size_t)MEMCPY_SWEEP_MIN << (MEMCPY_SWEEP_SIZES - 1))
+#define MEMCPY_SWEEP_BYTES	(1 * MB)	/* minimum bytes copied per sweep point */
+#define MEMCPY_SWEEP_LARGE	(1 * MB)	/* larger copies sample fewer misalignments */
 
 static const stress_help_t help[] = {
 	{ NULL,	"memcpy N",	   "start N workers performing memory copies" },
 	{ NULL,	"memcpy-method M", "set memcpy method (M = all, libc, builtin, naive..)" },
 	{ NULL,	"memcpy-ops N",	   "stop after N memcpy bogo operations" },
+	{ NULL,	"memcpy-sweep",	   "benchmark copy sizes 8B..64MB with src/dst misalignments 0..63" },
 	{ NULL,	NULL,		   NULL }
 };
 
@@ -38,12 +50,24 @@ static char *s_method_name = "";
 
 typedef void (*stress_memcpy_func)(uint8_t *str1, uint8_t *str2, uint8_t *str3);
 
+typedef void * (*memcpy_func_t)(void *dest, const void *src, size_t n);
+
 typedef struct {
 	const char *name;
 	const stress_memcpy_func func;
+	const memcpy_func_t cpy;	/* copy function used by --memcpy-sweep */
+	const bool sweep_all;		/* swept by --memcpy-sweep with method all */
 } stress_memcpy_method_info_t;
 
-typedef void * (*memcpy_func_t)(void *dest, const void *src, size_t n);
+typedef struct {
+	double bytes;			/* bytes copied */
+	double duration;		/* time taken in seconds */
+} stress_memcpy_rate_t;
+
+/* --memcpy-sweep rates, indexed by copy size and misalignment */
+typedef struct {
+	stress_memcpy_rate_t rate[MEMCPY_SWEEP_SIZES][ALIGN_SIZE];
+} stress_memcpy_sweep_t;
 typedef void * (*memmove_func_t)(void *dest, const void *src, size_t n);
 
 typedef void * (*memcpy_check_func_t)(memcpy_func_t func, void *dest, const void *src, size_t n);
@@ -52,6 +76,7 @@ typedef void * (*memmove_check_func_t)(memmove_func_t func, void *dest, const vo
 static memcpy_check_func_t memcpy_check;
 static memmove_check_func_t memmove_check;
 static bool memcpy_okay;
+static const stress_simd_method_t *memcpy_simd[STRESS_SIMD_MAX];
 
 static OPTIMIZE3 void *memcpy_check_func(memcpy_func_t func, void *dest, const void *src, size_t n)
 {
@@ -137,6 +162,85 @@ TEST_NAIVE_MEMMOVE(test_naive_memmove_o1, NOINLINE OPTIMIZE1)
 TEST_NAIVE_MEMMOVE(test_naive_memmove_o2, NOINLINE OPTIMIZE2)
 TEST_NAIVE_MEMMOVE(test_naive_memmove_o3, NOINLINE OPTIMIZE3)
 
+#if defined(HAVE_ASM_X86_REP_MOVSB) &&	\
+    defined(STRESS_ARCH_X86_64)
+/*
+ *  test_rep_movsb_memcpy()
+ *	copy using rep movsb, fast on CPUs with ERMS and FSRM
+ */
+static NOINLINE void *test_rep_movsb_memcpy(void *dest, const void *src, size_t n)
+{
+	void *d = dest;
+
+	__asm__ __volatile__(
+		"rep movsb\n;"
+		: "+D" (d),
+		  "+S" (src),
+		  "+c" (n)
+		:
+		: "memory");
+	return dest;
+}
+#else
+#define test_rep_movsb_memcpy	memcpy
+#endif
+
+#if defined(HAVE_NT_STORE64)
+/*
+ *  test_nt_memcpy()
+ *	copy using 64 bit non-temporal stores to bypass the cache,
+ *	the head is copied bytewise until the destination is aligned
+ */
+static NOINLINE void *test_nt_memcpy(void *dest, const void *src, size_t n)
+{
+	register uint8_t *d = (uint8_t *)dest;
+	register const uint8_t *s = (const uint8_t *)src;
+
+	for (; n && ((uintptr_t)d & 7); n--)
+		*(d++) = *(s++);
+	for (; n >= sizeof(uint64_t); n -= sizeof(uint64_t)) {
+		uint64_t v;
+
+		(void)memcpy(&v, s, sizeof(v));
+		stress_nt_store64((uint64_t *)(void *)d, v);
+		d += sizeof(uint64_t);
+		s += sizeof(uint64_t);
+	}
+	for (; n; n--)
+		*(d++) = *(s++);
+#if defined(HAVE_ASM_X86_SFENCE)
+	stress_asm_x86_sfence();
+#endif
+	return dest;
+}
+#else
+#define test_nt_memcpy		memcpy
+#endif
+
+/*
+ *  copy using explicit SIMD kernels, falls back to libc
+ *  memcpy if the kernels are not supported by the CPU
+ */
+#define TEST_SIMD_MEMCPY(name, type)					\
+static NOINLINE void *name(void *dest, const void *src, size_t n)	\
+{									\
+	const stress_simd_method_t *simd = memcpy_simd[type];		\
+									\
+	if (UNLIKELY(!simd))						\
+		return memcpy(dest, src, n);				\
+	simd->copy(dest, src, n);					\
+	return dest;							\
+}
+
+#if defined(STRESS_ARCH_X86)
+TEST_SIMD_MEMCPY(test_avx2_memcpy, STRESS_SIMD_AVX2)
+TEST_SIMD_MEMCPY(test_avx512_memcpy, STRESS_SIMD_AVX512)
+#endif
+#if defined(STRESS_ARCH_ARM)
+TEST_SIMD_MEMCPY(test_neon_memcpy, STRESS_SIMD_NEON)
+TEST_SIMD_MEMCPY(test_sve_memcpy, STRESS_SIMD_SVE)
+#endif
+
 static NOINLINE void stress_memcpy_libc(
 	uint8_t *str1,
 	uint8_t *str2,
@@ -240,6 +344,16 @@ STRESS_MEMCPY_NAIVE("naive_o0", stress_memcpy_naive_o0, test_naive_memcpy_o0, te
 STRESS_MEMCPY_NAIVE("naive_o1", stress_memcpy_naive_o1, test_naive_memcpy_o1, test_naive_memmove_o1)
 STRESS_MEMCPY_NAIVE("naive_o2", stress_memcpy_naive_o2, test_naive_memcpy_o2, test_naive_memmove_o2)
 STRESS_MEMCPY_NAIVE("naive_o3", stress_memcpy_naive_o3, test_naive_memcpy_o3, test_naive_memmove_o3)
+STRESS_MEMCPY_NAIVE("rep_movsb", stress_memcpy_rep_movsb, test_rep_movsb_memcpy, memmove)
+STRESS_MEMCPY_NAIVE("nt", stress_memcpy_nt, test_nt_memcpy, memmove)
+#if defined(STRESS_ARCH_X86)
+STRESS_MEMCPY_NAIVE("avx2", stress_memcpy_avx2, test_avx2_memcpy, memmove)
+STRESS_MEMCPY_NAIVE("avx512", stress_memcpy_avx512, test_avx512_memcpy, memmove)
+#endif
+#if defined(STRESS_ARCH_ARM)
+STRESS_MEMCPY_NAIVE("neon", stress_memcpy_neon, test_neon_memcpy, memmove)
+STRESS_MEMCPY_NAIVE("sve", stress_memcpy_sve, test_sve_memcpy, memmove)
+#endif
 
 static NOINLINE void stress_memcpy_all(
 	uint8_t *str1,
@@ -273,24 +387,319 @@ static NOINLINE void stress_memcpy_all(
 		whence++;
 		stress_memcpy_naive_o2(str1, str2, str3);
 		return;
-	default:
+	case 6:
+		whence++;
 		stress_memcpy_naive_o3(str1, str2, str3);
+		return;
+	case 7:
+		whence++;
+		stress_memcpy_rep_movsb(str1, str2, str3);
+		return;
+#if defined(STRESS_ARCH_X86)
+	case 8:
+		whence++;
+		stress_memcpy_avx2(str1, str2, str3);
+		return;
+	case 9:
+		whence++;
+		stress_memcpy_avx512(str1, str2, str3);
+		return;
+#endif
+#if defined(STRESS_ARCH_ARM)
+	case 8:
+		whence++;
+		stress_memcpy_neon(str1, str2, str3);
+		return;
+	case 9:
+		whence++;
+		stress_memcpy_sve(str1, str2, str3);
+		return;
+#endif
+	default:
+		stress_memcpy_nt(str1, str2, str3);
 		whence = 0;
 		return;
 	}
 }
 
+#if defined(HAVE_BUILTIN_MEMCPY) &&	\
+    defined(HAVE_BUILTIN_MEMMOVE)
+#define test_builtin_memcpy	stress_builtin_memcpy_wrapper
+#else
+#define test_builtin_memcpy	memcpy
+#endif
+
 static const stress_memcpy_method_info_t stress_memcpy_methods[] = {
-	{ "all",	stress_memcpy_all },
-	{ "libc",	stress_memcpy_libc },
-	{ "builtin",	stress_memcpy_builtin },
-	{ "naive",      stress_memcpy_naive },
-	{ "naive_o0",	stress_memcpy_naive_o0 },
-	{ "naive_o1",	stress_memcpy_naive_o1 },
-	{ "naive_o2",	stress_memcpy_naive_o2 },
-	{ "naive_o3",	stress_memcpy_naive_o3 },
+	{ "all",	stress_memcpy_all,	NULL,			false },
+	{ "libc",	stress_memcpy_libc,	memcpy,			true },
+	{ "builtin",	stress_memcpy_builtin,	test_builtin_memcpy,	true },
+	{ "naive",      stress_memcpy_naive,	test_naive_memcpy,	false },
+	{ "naive_o0",	stress_memcpy_naive_o0,	test_naive_memcpy_o0,	false },
+	{ "naive_o1",	stress_memcpy_naive_o1,	test_naive_memcpy_o1,	false },
+	{ "naive_o2",	stress_memcpy_naive_o2,	test_naive_memcpy_o2,	false },
+	{ "naive_o3",	stress_memcpy_naive_o3,	test_naive_memcpy_o3,	false },
+	{ "rep_movsb",	stress_memcpy_rep_movsb, test_rep_movsb_memcpy,	true },
+	{ "nt",		stress_memcpy_nt,	test_nt_memcpy,		true },
+#if defined(STRESS_ARCH_X86)
+	{ "avx2",	stress_memcpy_avx2,	test_avx2_memcpy,	true },
+	{ "avx512",	stress_memcpy_avx512,	test_avx512_memcpy,	true },
+#endif
+#if defined(STRESS_ARCH_ARM)
+	{ "neon",	stress_memcpy_neon,	test_neon_memcpy,	true },
+	{ "sve",	stress_memcpy_sve,	test_sve_memcpy,	true },
+#endif
 };
 
+/*
+ *  stress_memcpy_sweep_method()
+ *	sweep copy sizes and misalignments for one copy method, the
+ *	source is offset by the misalignment and the destination by
+ *	64 - misalignment so both are misaligned relative to each other.
+ *	Sizes above MEMCPY_SWEEP_LARGE are bandwidth bound so only
+ *	every 9th misalignment is sampled. Returns false if the run
+ *	should stop.
+ */
+static bool stress_memcpy_sweep_method(
+	stress_args_t *args,
+	const stress_memcpy_method_info_t *method,
+	uint8_t *src,
+	uint8_t *dst,
+	const size_t max_size,
+	stress_memcpy_sweep_t *sweep)
+{
+	const bool verify = !!(g_opt_flags & OPT_FLAGS_VERIFY);
+	const memcpy_func_t cpy = method->cpy;
+	size_t i;
+
+	s_method_name = (char *)method->name;
+
+	for (i = 0; i < MEMCPY_SWEEP_SIZES; i++) {
+		const size_t size = (size_t)MEMCPY_SWEEP_MIN << i;
+		const size_t loops = (size < MEMCPY_SWEEP_BYTES) ? MEMCPY_SWEEP_BYTES / size : 1;
+		const size_t stride = (size > MEMCPY_SWEEP_LARGE) ? 9 : 1;
+		size_t offset;
+
+		if (size > max_size)
+			break;
+
+		for (offset = 0; offset < ALIGN_SIZE; offset += stride) {
+			uint8_t *s = src + offset;
+			uint8_t *d = dst + ((ALIGN_SIZE - offset) & (ALIGN_SIZE - 1));
+			double t;
+			size_t j;
+
+			t = stress_time_now();
+			for (j = 0; j < loops; j++)
+				(void)cpy(d, s, size);
+			t = stress_time_now() - t;
+			stress_void_ptr_put(d);
+
+			sweep->rate[i][offset].bytes += (double)size * (double)loops;
+			sweep->rate[i][offset].duration += t;
+
+			if (verify && shim_memcmp(d, s, size)) {
+				pr_fail("%s: %s: %zu byte copy at misalignment %zu is different than expected\n",
+					args->name, method->name, size, offset);
+				memcpy_okay = false;
+				return false;
+			}
+			stress_bogo_inc(args);
+			if (UNLIKELY(!stress_continue(args)))
+				return false;
+		}
+	}
+	return true;
+}
+
+/*
+ *  stress_memcpy_sweep_rate()
+ *	get the aligned or the misaligned (harmonic mean of all the
+ *	misalignments) copy rate in GB per sec and the slowest
+ *	misaligned rate and its misalignment
+ */
+static double stress_memcpy_sweep_rate(
+	const stress_memcpy_rate_t *rate,
+	const bool aligned,
+	double *worst,
+	size_t *worst_offset)
+{
+	double bytes = 0.0, duration = 0.0;
+	size_t offset;
+
+	if (aligned)
+		return (rate[0].duration > 0.0) ? rate[0].bytes / (rate[0].duration * (double)GB) : 0.0;
+
+	*worst = 0.0;
+	*worst_offset = 0;
+	for (offset = 1; offset < ALIGN_SIZE; offset++) {
+		double r;
+
+		if (rate[offset].duration <= 0.0)
+			continue;
+		bytes += rate[offset].bytes;
+		duration += rate[offset].duration;
+		r = rate[offset].bytes / (rate[offset].duration * (double)GB);
+		if ((*worst <= 0.0) || (r < *worst)) {
+			*worst = r;
+			*worst_offset = offset;
+		}
+	}
+	return (duration > 0.0) ? bytes / (duration * (double)GB) : 0.0;
+}
+
+/*
+ *  stress_memcpy_size_str()
+ *	sweep sizes are powers of 2, format as B, K or M without
+ *	fractions so the sizes are readable as YAML metric keys
+ */
+static void stress_memcpy_size_str(char *str, const size_t len, const size_t size)
+{
+	if (size >= MB)
+		(void)snprintf(str, len, "%zuM", (size_t)(size / MB));
+	else if (size >= KB)
+		(void)snprintf(str, len, "%zuK", (size_t)(size / KB));
+	else
+		(void)snprintf(str, len, "%zuB", size);
+}
+
+/*
+ *  stress_memcpy_sweep_report()
+ *	report the GB per sec size vs misalignment results, all sizes are
+ *	logged and every 4th size (plus the largest) is reported as metrics
+ */
+static void stress_memcpy_sweep_report(
+	stress_args_t *args,
+	const size_t *methods,
+	const size_t n_methods,
+	const stress_memcpy_sweep_t *sweeps)
+{
+	size_t i, j, metric = 0;
+
+	pr_block_begin();
+	for (i = 0; i < n_methods; i++) {
+		const char *name = stress_memcpy_methods[methods[i]].name;
+
+		if (args->instance == 0)
+			pr_inf("%s: %s: %10s %10s %10s %10s\n", args->name, name,
+				"size", "aligned", "misaligned", "worst");
+		for (j = 0; j < MEMCPY_SWEEP_SIZES; j++) {
+			const stress_memcpy_rate_t *rate = sweeps[i].rate[j];
+			const size_t size = (size_t)MEMCPY_SWEEP_MIN << j;
+			double aligned, misaligned, worst;
+			size_t worst_offset;
+			char str[32], desc[64];
+
+			aligned = stress_memcpy_sweep_rate(rate, true, &worst, &worst_offset);
+			misaligned = stress_memcpy_sweep_rate(rate, false, &worst, &worst_offset);
+			if (aligned <= 0.0)
+				continue;
+
+			stress_memcpy_size_str(str, sizeof(str), size);
+			if (args->instance == 0)
+				pr_inf("%s: %s: %10s %7.2f GB/s %7.2f GB/s %7.2f GB/s (misalignment %zu)\n",
+					args->name, name, str, aligned, misaligned, worst, worst_offset);
+
+			if (((j & 3) != 0) && (j != MEMCPY_SWEEP_SIZES - 1))
+				continue;
+			(void)snprintf(desc, sizeof(desc), "GB per sec %s %s aligned", name, str);
+			stress_metrics_set(args, metric++, desc, aligned, STRESS_METRIC_HARMONIC_MEAN);
+			if (misaligned <= 0.0)
+				continue;
+			(void)snprintf(desc, sizeof(desc), "GB per sec %s %s misaligned", name, str);
+			stress_metrics_set(args, metric++, desc, misaligned, STRESS_METRIC_HARMONIC_MEAN);
+		}
+	}
+	pr_block_end();
+}
+
+/*
+ *  stress_memcpy_sweep()
+ *	benchmark the copy methods over sizes and misalignments
+ */
+static int stress_memcpy_sweep(stress_args_t *args, const size_t memcpy_method)
+{
+	size_t methods[SIZEOF_ARRAY(stress_memcpy_methods)];
+	size_t i, n_methods = 0, max_size, buf_size;
+	stress_memcpy_sweep_t *sweeps;
+	uint8_t *src, *dst;
+	int rc = EXIT_SUCCESS;
+
+	if (memcpy_method == 0) {
+		for (i = 1; i < SIZEOF_ARRAY(stress_memcpy_methods); i++)
+			if (stress_memcpy_methods[i].sweep_all)
+				methods[n_methods++] = i;
+	} else {
+		methods[n_methods++] = memcpy_method;
+	}
+
+	sweeps = (stress_memcpy_sweep_t *)calloc(n_methods, sizeof(*sweeps));
+	if (!sweeps) {
+		pr_inf_skip("%s: cannot allocate sweep results, skipping stressor\n", args->name);
+		return EXIT_NO_RESOURCE;
+	}
+
+	/* halve the largest copy size until the buffers can be allocated */
+	for (max_size = MEMCPY_SWEEP_MAX; ; max_size >>= 1) {
+		buf_size = max_size + ALIGN_SIZE;
+		src = (uint8_t *)stress_mmap_populate(NULL, buf_size,
+				PROT_READ | PROT_WRITE,
+				MAP_ANONYMOUS | MAP_PRIVATE, -1, 0);
+		if (src != MAP_FAILED) {
+			dst = (uint8_t *)stress_mmap_populate(NULL, buf_size,
+				PROT_READ | PROT_WRITE,
+				MAP_ANONYMOUS | MAP_PRIVATE, -1, 0);
+			if (dst != MAP_FAILED)
+				break;
+			(void)munmap((void *)src, buf_size);
+		}
+		if (max_size <= MEMCPY_SWEEP_LARGE) {
+			pr_inf_skip("%s: cannot allocate %zu byte sweep buffers, skipping stressor\n",
+				args->name, buf_size);
+			free(sweeps);
+			return EXIT_NO_RESOURCE;
+		}
+	}
+	stress_set_vma_anon_name(src, buf_size, "memcpy-sweep-src");
+	stress_set_vma_anon_name(dst, buf_size, "memcpy-sweep-dst");
+	stress_rndbuf(src, buf_size);
+
+	if (args->instance == 0) {
+		char str[32];
+
+		stress_memcpy_size_str(str, sizeof(str), max_size);
+		pr_inf("%s: sweeping copy sizes %d bytes to %s with 0..%d byte misalignments\n",
+			args->name, MEMCPY_SWEEP_MIN, str, ALIGN_SIZE - 1);
+		if (stress_cpu_is_x86())
+			pr_inf("%s: CPU %s ERMS, %s FSRM for rep movsb\n", args->name,
+				stress_cpu_x86_has_erms() ? "has" : "does not have",
+				stress_cpu_x86_has_fsrm() ? "has" : "does not have");
+	}
+
+	stress_set_proc_state(args->name, STRESS_STATE_SYNC_WAIT);
+	stress_sync_start_wait(args);
+	stress_set_proc_state(args->name, STRESS_STATE_RUN);
+
+	do {
+		for (i = 0; i < n_methods; i++) {
+			if (!stress_memcpy_sweep_method(args, &stress_memcpy_methods[methods[i]],
+							src, dst, max_size, &sweeps[i]))
+				break;
+		}
+	} while (memcpy_okay && stress_continue(args));
+
+	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
+	if (memcpy_okay)
+		stress_memcpy_sweep_report(args, methods, n_methods, sweeps);
+	else
+		rc = EXIT_FAILURE;
+
+	(void)munmap((void *)dst, buf_size);
+	(void)munmap((void *)src, buf_size);
+	free(sweeps);
+
+	return rc;
+}
+
 /*
  *  stress_memcpy()
  *	stress memory copies
@@ -300,8 +709,23 @@ static int stress_memcpy(stress_args_t *args)
 	uint8_t *buf, *str1, *str2, *str3;
 	size_t memcpy_method = 0;
 	stress_memcpy_func func;
+	bool memcpy_sweep = false;
 
 	memcpy_okay = true;
+	s_args_name = args->name;
+#if defined(STRESS_ARCH_X86)
+	memcpy_simd[STRESS_SIMD_AVX2] = stress_simd_method(STRESS_SIMD_AVX2);
+	memcpy_simd[STRESS_SIMD_AVX512] = stress_simd_method(STRESS_SIMD_AVX512);
+#endif
+#if defined(STRESS_ARCH_ARM)
+	memcpy_simd[STRESS_SIMD_NEON] = stress_simd_method(STRESS_SIMD_NEON);
+	memcpy_simd[STRESS_SIMD_SVE] = stress_simd_method(STRESS_SIMD_SVE);
+#endif
+
+	(void)stress_get_setting("memcpy-method", &memcpy_method);
+	(void)stress_get_setting("memcpy-sweep", &memcpy_sweep);
+	if (memcpy_sweep)
+		return stress_memcpy_sweep(args, memcpy_method);
 	buf = (uint8_t *)stress_mmap_populate(NULL, 3 * MEMCPY_MEMSIZE,
 				PROT_READ | PROT_WRITE,
 				MAP_ANONYMOUS | MAP_PRIVATE, -1 , 0);
@@ -316,8 +740,6 @@ static int stress_memcpy(stress_args_t *args)
 	str2 = str1 + MEMCPY_MEMSIZE;
 	str3 = str2 + MEMCPY_MEMSIZE;
 
-	s_args_name = args->name;
-
 	if (g_opt_flags & OPT_FLAGS_VERIFY) {
 		memcpy_check = memcpy_check_func;
 		memmove_check = memmove_check_func;
@@ -326,7 +748,6 @@ static int stress_memcpy(stress_args_t *args)
 		memmove_check = memmove_no_check_func;
 	}
 
-	(void)stress_get_setting("memcpy-method", &memcpy_method);
 	func = stress_memcpy_methods[memcpy_method].func;
 	stress_rndbuf(str3, ALIGN_SIZE);
 
@@ -353,6 +774,7 @@ static const char *stress_memcpy_method(const size_t i)
 
 static const stress_opt_t opts[] = {
 	{ OPT_memcpy_method, "memcpy-method", TYPE_ID_SIZE_T_METHOD, 0, 0, stress_memcpy_method },
+	{ OPT_memcpy_sweep,  "memcpy-sweep",  TYPE_ID_BOOL, 0, 1, NULL },
 	END_OPT,
 };
 
@@ -365,6 +365,7 @@ const stressor_info_t stress_memhotplug_info = {
 	.class = CLASS_OS,
 	.opts = opts,
 	.supported = stress_memhotplug_supported,
+	.metrics_max = 2,
 	.help = help
 };
 #else
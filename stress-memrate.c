@@ -18,11 +18,15 @@
  *
  */
 #include "stress-ng.h"
+#include "core-arch.h"
 #include "core-builtin.h"
 #include "core-cpu-cache.h"
 #include "core-madvise.h"
+#include "core-mmap.h"
 #include "core-nt-store.h"
 #include "core-out-of-memory.h"
+#include "core-put.h"
+#include "core-simd.h"
 #include "core-target-clones.h"
 #include "core-vecmath.h"
 
@@ -37,6 +41,11 @@
 #define DEFAULT_MEMRATE_BYTES   (256 * MB)
 #define STRESS_MEMRATE_PF_OFFSET (2 * KB)
 
+#define MR_SIMD_READ		(0)
+#define MR_SIMD_WRITE		(1)
+#define MR_SIMD_COPY		(2)
+#define MR_SIMD_TRIAD		(3)
+
 #define STRESS_PTR_MINIMUM(a, b)	STRESS_MINIMUM((uintptr_t)a, (uintptr_t)b)
 
 static const stress_help_t help[] = {
@@ -849,6 +858,181 @@ STRESS_MEMRATE_WRITE_RATE(16, uint16_t)
 STRESS_MEMRATE_WRITE(8, uint8_t)
 STRESS_MEMRATE_WRITE_RATE(8, uint8_t)
 
+#if defined(STRESS_ARCH_X86) ||	\
+    defined(STRESS_ARCH_ARM)
+/*
+ *  stress_memrate_simd()
+ *	exercise memory using explicit SIMD read, write, copy or
+ *	triad kernels in 1 MB chunks, copy uses the buffer as two
+ *	halves, triad as three arrays of doubles. If mbs is non-zero
+ *	the rate is limited to mbs MB per second. Returns the number
+ *	of KB of memory read and written.
+ */
+static uint64_t OPTIMIZE3 stress_memrate_simd(
+	const stress_memrate_context_t *context,
+	bool *valid,
+	const stress_simd_type_t type,
+	const int op,
+	const uint64_t mbs)
+{
+	const stress_simd_method_t *simd = stress_simd_method(type);
+	uint8_t *a = (uint8_t *)context->start;
+	const size_t size = (size_t)((uint8_t *)context->end - a);
+	uint8_t *b, *c;
+	size_t len, chunk, offset;
+	uint64_t bytes = 0;
+	double t1, total_dur = 0.0;
+
+	if (!simd) {
+		*valid = false;
+		return 0;
+	}
+
+	switch (op) {
+	case MR_SIMD_COPY:
+		len = size / 2;
+		break;
+	case MR_SIMD_TRIAD:
+		len = (size / 3) & ~(sizeof(double) - 1);
+		break;
+	default:
+		len = size;
+		break;
+	}
+	b = a + len;
+	c = b + len;
+	chunk = STRESS_MINIMUM(len, MB);
+
+	t1 = stress_time_now();
+	for (offset = 0; offset < len; offset += chunk) {
+		const size_t n = STRESS_MINIMUM(chunk, len - offset);
+		size_t traffic;
+
+		switch (op) {
+		case MR_SIMD_READ:
+			stress_uint64_put(simd->read(a + offset, n));
+			traffic = n;
+			break;
+		case MR_SIMD_WRITE:
+			simd->write(a + offset, n, 0xaaaaaaaaaaaaaaaaULL);
+			traffic = n;
+			break;
+		case MR_SIMD_COPY:
+			simd->copy(b + offset, a + offset, n);
+			traffic = n * 2;
+			break;
+		case MR_SIMD_TRIAD:
+		default:
+			simd->triad((double *)(void *)(a + offset),
+				(const double *)(void *)(b + offset),
+				(const double *)(void *)(c + offset),
+				3.0, n / sizeof(double));
+			traffic = n * 3;
+			break;
+		}
+		bytes += traffic;
+
+		if (mbs) {
+			const double t2 = stress_time_now();
+			double dur_remainder;
+
+			total_dur += (double)traffic / (MB * (double)mbs);
+			dur_remainder = total_dur - (t2 - t1);
+
+			if (dur_remainder >= 0.0) {
+				struct timespec t;
+				time_t sec = (time_t)dur_remainder;
+
+				t.tv_sec = sec;
+				t.tv_nsec = (long int)((dur_remainder -
+					(double)sec) *
+					STRESS_NANOSECOND);
+				(void)nanosleep(&t, NULL);
+			}
+		}
+	}
+	*valid = true;
+	return bytes / KB;
+}
+
+#define STRESS_MEMRATE_SIMD(isa, type)				\
+static uint64_t stress_memrate_read_##isa(			\
+	const stress_memrate_context_t *context,		\
+	bool *valid)						\
+{								\
+	return stress_memrate_simd(context, valid, type,	\
+		MR_SIMD_READ, 0);				\
+}								\
+								\
+static uint64_t stress_memrate_read_rate_##isa(			\
+	const stress_memrate_context_t *context,		\
+	bool *valid)						\
+{								\
+	return stress_memrate_simd(context, valid, type,	\
+		MR_SIMD_READ, context->memrate_rd_mbs);		\
+}								\
+								\
+static uint64_t stress_memrate_write_##isa(			\
+	const stress_memrate_context_t *context,		\
+	bool *valid)						\
+{								\
+	return stress_memrate_simd(context, valid, type,	\
+		MR_SIMD_WRITE, 0);				\
+}								\
+								\
+static uint64_t stress_memrate_write_rate_##isa(		\
+	const stress_memrate_context_t *context,		\
+	bool *valid)						\
+{								\
+	return stress_memrate_simd(context, valid, type,	\
+		MR_SIMD_WRITE, context->memrate_wr_mbs);	\
+}								\
+								\
+static uint64_t stress_memrate_copy_##isa(			\
+	const stress_memrate_context_t *context,		\
+	bool *valid)						\
+{								\
+	return stress_memrate_simd(context, valid, type,	\
+		MR_SIMD_COPY, 0);				\
+}								\
+								\
+static uint64_t stress_memrate_copy_rate_##isa(			\
+	const stress_memrate_context_t *context,		\
+	bool *valid)						\
+{								\
+	return stress_memrate_simd(context, valid, type,	\
+		MR_SIMD_COPY, STRESS_MINIMUM(context->memrate_rd_mbs,	\
+		context->memrate_wr_mbs));			\
+}								\
+								\
+static uint64_t stress_memrate_triad_##isa(			\
+	const stress_memrate_context_t *context,		\
+	bool *valid)						\
+{								\
+	return stress_memrate_simd(context, valid, type,	\
+		MR_SIMD_TRIAD, 0);				\
+}								\
+								\
+static uint64_t stress_memrate_triad_rate_##isa(		\
+	const stress_memrate_context_t *context,		\
+	bool *valid)						\
+{								\
+	return stress_memrate_simd(context, valid, type,	\
+		MR_SIMD_TRIAD, STRESS_MINIMUM(context->memrate_rd_mbs,	\
+		context->memrate_wr_mbs));			\
+}
+#endif
+
+#if defined(STRESS_ARCH_X86)
+STRESS_MEMRATE_SIMD(avx512, STRESS_SIMD_AVX512)
+STRESS_MEMRATE_SIMD(avx2, STRESS_SIMD_AVX2)
+STRESS_MEMRATE_SIMD(sse2, STRESS_SIMD_SSE2)
+#endif
+#if defined(STRESS_ARCH_ARM)
+STRESS_MEMRATE_SIMD(sve, STRESS_SIMD_SVE)
+STRESS_MEMRATE_SIMD(neon, STRESS_SIMD_NEON)
+#endif
+
 static stress_memrate_info_t memrate_info[] = {
 	{ "all",	MR_RW,  NULL,				NULL },
 #if defined(HAVE_ASM_X86_REP_STOSQ) &&	\
@@ -876,6 +1060,15 @@ static stress_memrate_info_t memrate_info[] = {
 #if defined(HAVE_NT_STORE32)
 	{ "write32nt",	MR_WR, stress_memrate_write_nt32,	stress_memrate_write_nt_rate32 },
 #endif
+#if defined(STRESS_ARCH_X86)
+	{ "writeavx512", MR_WR, stress_memrate_write_avx512,	stress_memrate_write_rate_avx512 },
+	{ "writeavx2",	MR_WR, stress_memrate_write_avx2,	stress_memrate_write_rate_avx2 },
+	{ "writesse2",	MR_WR, stress_memrate_write_sse2,	stress_memrate_write_rate_sse2 },
+#endif
+#if defined(STRESS_ARCH_ARM)
+	{ "writesve",	MR_WR, stress_memrate_write_sve,	stress_memrate_write_rate_sve },
+	{ "writeneon",	MR_WR, stress_memrate_write_neon,	stress_memrate_write_rate_neon },
+#endif
 #if defined(HAVE_VECMATH)
 	{ "write1024",	MR_WR, stress_memrate_write1024,	stress_memrate_write_rate1024 },
 	{ "write512",	MR_WR, stress_memrate_write512,		stress_memrate_write_rate512 },
@@ -896,6 +1089,15 @@ static stress_memrate_info_t memrate_info[] = {
 #endif
 	{ "read64pf",	MR_RD, stress_memrate_read64pf,		stress_memrate_read_rate64pf },
 #endif
+#if defined(STRESS_ARCH_X86)
+	{ "readavx512",	MR_RD, stress_memrate_read_avx512,	stress_memrate_read_rate_avx512 },
+	{ "readavx2",	MR_RD, stress_memrate_read_avx2,	stress_memrate_read_rate_avx2 },
+	{ "readsse2",	MR_RD, stress_memrate_read_sse2,	stress_memrate_read_rate_sse2 },
+#endif
+#if defined(STRESS_ARCH_ARM)
+	{ "readsve",	MR_RD, stress_memrate_read_sve,		stress_memrate_read_rate_sve },
+	{ "readneon",	MR_RD, stress_memrate_read_neon,	stress_memrate_read_rate_neon },
+#endif
 #if defined(HAVE_VECMATH)
 	{ "read1024",	MR_RD, stress_memrate_read1024,		stress_memrate_read_rate1024 },
 	{ "read512",	MR_RD, stress_memrate_read512,		stress_memrate_read_rate512 },
@@ -909,6 +1111,24 @@ static stress_memrate_info_t memrate_info[] = {
 	{ "read32",	MR_RD, stress_memrate_read32,		stress_memrate_read_rate32 },
 	{ "read16",	MR_RD, stress_memrate_read16,		stress_memrate_read_rate16 },
 	{ "read8",	MR_RD, stress_memrate_read8,		stress_memrate_read_rate8 },
+#if defined(STRESS_ARCH_X86)
+	{ "copyavx512",	MR_RW, stress_memrate_copy_avx512,	stress_memrate_copy_rate_avx512 },
+	{ "copyavx2",	MR_RW, stress_memrate_copy_avx2,	stress_memrate_copy_rate_avx2 },
+	{ "copysse2",	MR_RW, stress_memrate_copy_sse2,	stress_memrate_copy_rate_sse2 },
+#endif
+#if defined(STRESS_ARCH_ARM)
+	{ "copysve",	MR_RW, stress_memrate_copy_sve,		stress_memrate_copy_rate_sve },
+	{ "copyneon",	MR_RW, stress_memrate_copy_neon,	stress_memrate_copy_rate_neon },
+#endif
+#if defined(STRESS_ARCH_X86)
+	{ "triadavx512", MR_RW, stress_memrate_triad_avx512,	stress_memrate_triad_rate_avx512 },
+	{ "triadavx2",	MR_RW, stress_memrate_triad_avx2,	stress_memrate_triad_rate_avx2 },
+	{ "triadsse2",	MR_RW, stress_memrate_triad_sse2,	stress_memrate_triad_rate_sse2 },
+#endif
+#if defined(STRESS_ARCH_ARM)
+	{ "triadsve",	MR_RW, stress_memrate_triad_sve,	stress_memrate_triad_rate_sve },
+	{ "triadneon",	MR_RW, stress_memrate_triad_neon,	stress_memrate_triad_rate_neon },
+#endif
 };
 
 static const size_t memrate_items = SIZEOF_ARRAY(memrate_info);
@@ -923,17 +1143,17 @@ static void OPTIMIZE3 stress_memrate_init_data(
 		*ptr = stress_mwc32();
 }
 
-static inline void *stress_memrate_mmap(stress_args_t *args, uint64_t sz)
+static inline void *stress_memrate_mmap(stress_args_t *args, uint64_t sz, size_t *mapped_sz)
 {
 	void *ptr;
 
-	ptr = stress_mmap_populate(NULL, (size_t)sz, PROT_READ | PROT_WRITE,
+	ptr = stress_mmap_hugetlb(args, (size_t)sz, PROT_READ | PROT_WRITE,
 #if defined(HAVE_MADVISE)
 		MAP_PRIVATE |
 #else
 		MAP_SHARED |
 #endif
-		MAP_ANONYMOUS, -1, 0);
+		MAP_ANONYMOUS, true, mapped_sz);
 	/* Coverity Scan believes NULL can be returned, doh */
 	if (!ptr || (ptr == MAP_FAILED)) {
 		pr_err("%s: cannot allocate %" PRIu64 " K\n",
@@ -955,11 +1175,11 @@ static inline uint64_t stress_memrate_dispatch(
 	const stress_memrate_context_t *context,
 	bool *valid)
 {
-	if (((info->rdwr == MR_RD) && (context->memrate_rd_mbs == 0ULL)) ||
-	    ((info->rdwr == MR_WR) && (context->memrate_wr_mbs == 0ULL))) {
+	if (((info->rdwr & MR_RD) && (context->memrate_rd_mbs == 0ULL)) ||
+	    ((info->rdwr & MR_WR) && (context->memrate_wr_mbs == 0ULL))) {
 		return 0;
-	} else if (((info->rdwr == MR_RD) && (context->memrate_rd_mbs == ~0ULL)) ||
-		 ((info->rdwr == MR_WR) && (context->memrate_wr_mbs == ~0ULL))) {
+	} else if (((info->rdwr & MR_RD) == 0 || (context->memrate_rd_mbs == ~0ULL)) &&
+		   ((info->rdwr & MR_WR) == 0 || (context->memrate_wr_mbs == ~0ULL))) {
 		return info->func(context, valid);
 	} else {
 		return info->func_rate(context, valid);
@@ -989,10 +1209,11 @@ static int stress_memrate_child(stress_args_t *args, void *ctxt)
 {
 	stress_memrate_context_t *context = (stress_memrate_context_t *)ctxt;
 	void *buffer, *buffer_end;
+	size_t buffer_sz;
 
 	stress_catch_sigill();
 
-	buffer = stress_memrate_mmap(args, context->memrate_bytes);
+	buffer = stress_memrate_mmap(args, context->memrate_bytes, &buffer_sz);
 	if (buffer == MAP_FAILED)
 		return EXIT_NO_RESOURCE;
 
@@ -1026,7 +1247,7 @@ static int stress_memrate_child(stress_args_t *args, void *ctxt)
 	} while (stress_continue(args));
 
 tidy:
-	(void)munmap((void *)buffer, context->memrate_bytes);
+	(void)munmap((void *)buffer, buffer_sz);
 	return EXIT_SUCCESS;
 }
 
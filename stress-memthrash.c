@@ -40,10 +40,14 @@
 #define BITS_PER_BYTE		(8)
 #define NUMA_LONG_BITS		(sizeof(unsigned long int) * BITS_PER_BYTE)
 
+#define MIN_MEMTHRASH_THREADS	(1)
+#define MAX_MEMTHRASH_THREADS	(1024)
+
 static const stress_help_t help[] = {
 	{ NULL,	"memthrash N",		"start N workers thrashing a 16MB memory buffer" },
 	{ NULL,	"memthrash-method M",	"specify memthrash method M, default is all" },
 	{ NULL,	"memthrash-ops N",	"stop after N memthrash bogo operations" },
+	{ NULL,	"memthrash-threads N",	"use N threads per memthrash worker" },
 	{ NULL,	NULL,			NULL }
 };
 
@@ -57,18 +61,26 @@ static const stress_help_t help[] = {
 #define STRESS_CACHE_LINE_SHIFT	(6)	/* Typical 64 byte size */
 #define STRESS_CACHE_LINE_SIZE	(1 << STRESS_CACHE_LINE_SHIFT)
 
+/* Per-thread per-method statistics */
+typedef struct {
+	uint64_t bytes;		/* bytes loaded and stored */
+	uint64_t calls;		/* method invocations */
+	double duration;	/* time spent in the method */
+} stress_memthrash_stats_t;
 
 typedef struct {
 	stress_args_t *args;
 	const struct stress_memthrash_method_info *memthrash_method;
 	uint32_t total_cpus;
 	uint32_t max_threads;
+	stress_memthrash_stats_t *stats;	/* per method stats, one set per thread */
 #if defined(HAVE_MEMTHRASH_NUMA)
 	stress_numa_mask_t *numa_mask;
 #endif
 } stress_memthrash_context_t;
 
-typedef void (*stress_memthrash_func_t)(const stress_memthrash_context_t *context, size_t mem_size);
+/* methods return the number of bytes loaded and stored */
+typedef size_t (*stress_memthrash_func_t)(const stress_memthrash_context_t *context, size_t mem_size);
 
 typedef struct stress_memthrash_method_info {
 	const char		*name;		/* human readable form of stressor */
@@ -79,6 +91,7 @@ typedef struct stress_memthrash_method_info {
 typedef struct {
 	pthread_t pthread;	/* pthread handle */
 	int ret;		/* pthread create return value */
+	stress_memthrash_context_t context;	/* per-thread context */
 } stress_pthread_info_t;
 
 typedef struct {
@@ -108,7 +121,7 @@ static stress_memthrash_primes_t stress_memthrash_primes[MEM_SIZE_PRIMES];
 #endif
 #endif
 
-static inline OPTIMIZE3 void stress_memthrash_random_chunk(
+static inline OPTIMIZE3 size_t stress_memthrash_random_chunk(
 	const size_t chunk_size,
 	const size_t mem_size)
 {
@@ -126,63 +139,65 @@ static inline OPTIMIZE3 void stress_memthrash_random_chunk(
 
 		(void)shim_memset(ptr, stress_mwc8(), chunk_size);
 	}
+	return (size_t)i * chunk_size;
 }
 
-static void OPTIMIZE3 stress_memthrash_random_chunkpage(
+static size_t OPTIMIZE3 stress_memthrash_random_chunkpage(
 	const stress_memthrash_context_t *context,
 	const size_t mem_size)
 {
-	stress_memthrash_random_chunk(context->args->page_size, mem_size);
+	return stress_memthrash_random_chunk(context->args->page_size, mem_size);
 }
 
-static void OPTIMIZE3 stress_memthrash_random_chunk256(
+static size_t OPTIMIZE3 stress_memthrash_random_chunk256(
 	const stress_memthrash_context_t *context,
 	const size_t mem_size)
 {
 	(void)context;
 
-	stress_memthrash_random_chunk(256, mem_size);
+	return stress_memthrash_random_chunk(256, mem_size);
 }
 
-static void OPTIMIZE3 stress_memthrash_random_chunk64(
+static size_t OPTIMIZE3 stress_memthrash_random_chunk64(
 	const stress_memthrash_context_t *context,
 	const size_t mem_size)
 {
 	(void)context;
 
-	stress_memthrash_random_chunk(64, mem_size);
+	return stress_memthrash_random_chunk(64, mem_size);
 }
 
-static void OPTIMIZE3 stress_memthrash_random_chunk8(
+static size_t OPTIMIZE3 stress_memthrash_random_chunk8(
 	const stress_memthrash_context_t *context,
 	const size_t mem_size)
 {
 	(void)context;
 
-	stress_memthrash_random_chunk(8, mem_size);
+	return stress_memthrash_random_chunk(8, mem_size);
 }
 
-static void OPTIMIZE3 stress_memthrash_random_chunk1(
+static size_t OPTIMIZE3 stress_memthrash_random_chunk1(
 	const stress_memthrash_context_t *context,
 	const size_t mem_size)
 {
 	(void)context;
 
-	stress_memthrash_random_chunk(1, mem_size);
+	return stress_memthrash_random_chunk(1, mem_size);
 }
 
-static void stress_memthrash_memset(
+static size_t stress_memthrash_memset(
 	const stress_memthrash_context_t *context,
 	const size_t mem_size)
 {
 	(void)context;
 
 	(void)shim_memset((void *)mem, stress_mwc8(), mem_size);
+	return mem_size;
 }
 
 #if defined(HAVE_ASM_X86_REP_STOSD) &&	\
     !defined(__ILP32__)
-static inline void OPTIMIZE3 stress_memtrash_memsetstosd(
+static inline size_t OPTIMIZE3 stress_memtrash_memsetstosd(
 	const stress_memthrash_context_t *context,
 	const size_t mem_size)
 {
@@ -200,10 +215,11 @@ static inline void OPTIMIZE3 stress_memtrash_memsetstosd(
 		: "r" (p),
 		  "r" (l)
 		: "ecx","rdi","eax");
+	return (size_t)l * sizeof(uint32_t);
 }
 #endif
 
-static void stress_memthrash_memmove(
+static size_t stress_memthrash_memmove(
 	const stress_memthrash_context_t *context,
 	const size_t mem_size)
 {
@@ -211,9 +227,10 @@ static void stress_memthrash_memmove(
 
 	(void)context;
 	(void)shim_memmove((void *)dst, mem, mem_size - 1);
+	return 2 * (mem_size - 1);
 }
 
-static void OPTIMIZE3 stress_memthrash_memset64(
+static size_t OPTIMIZE3 stress_memthrash_memset64(
 	const stress_memthrash_context_t *context,
 	const size_t mem_size)
 {
@@ -236,7 +253,7 @@ static void OPTIMIZE3 stress_memthrash_memset64(
 			stress_nt_store64(ptr + 7, val);
 			ptr += 8;
 		}
-		return;
+		return mem_size;
 	}
 #endif
 	/* normal temporal stores, non-SSE fallback */
@@ -252,9 +269,10 @@ PRAGMA_UNROLL_N(4)
 		*ptr++ = val;
 		*ptr++ = val;
 	}
+	return mem_size;
 }
 
-static void OPTIMIZE3 TARGET_CLONES stress_memthrash_swap64(
+static size_t OPTIMIZE3 TARGET_CLONES stress_memthrash_swap64(
 	const stress_memthrash_context_t *context,
 	const size_t mem_size)
 {
@@ -308,10 +326,11 @@ static void OPTIMIZE3 TARGET_CLONES stress_memthrash_swap64(
 		stress_asm_mb();
 		ptr += 8;
 	}
+	return 2 * mem_size;
 }
 
 #if defined(HAVE_INT128_T)
-static void OPTIMIZE3 TARGET_CLONES stress_memthrash_copy128(
+static size_t OPTIMIZE3 TARGET_CLONES stress_memthrash_copy128(
 	const stress_memthrash_context_t *context,
 	const size_t mem_size)
 {
@@ -344,10 +363,11 @@ static void OPTIMIZE3 TARGET_CLONES stress_memthrash_copy128(
 
 		ptr += 8;
 	}
+	return 2 * (size_t)((uintptr_t)ptr - (uintptr_t)mem);
 }
 #endif
 
-static void OPTIMIZE3 stress_memthrash_flip_mem(
+static size_t OPTIMIZE3 stress_memthrash_flip_mem(
 	const stress_memthrash_context_t *context,
 	const size_t mem_size)
 {
@@ -360,9 +380,10 @@ static void OPTIMIZE3 stress_memthrash_flip_mem(
 		*ptr = *ptr ^ ~0ULL;
 		ptr++;
 	}
+	return 2 * mem_size;
 }
 
-static void OPTIMIZE3 stress_memthrash_swap(
+static size_t OPTIMIZE3 stress_memthrash_swap(
 	const stress_memthrash_context_t *context,
 	const size_t mem_size)
 {
@@ -387,13 +408,14 @@ static void OPTIMIZE3 stress_memthrash_swap(
 		if (offset2 >= mem_size)
 			offset2 -= mem_size;
 	}
+	return (size_t)i * 4;
 }
 
-static void OPTIMIZE3 stress_memthrash_matrix(
+static size_t OPTIMIZE3 stress_memthrash_matrix(
 	const stress_memthrash_context_t *context,
 	const size_t mem_size)
 {
-	size_t i, j;
+	size_t i, j, n = 0;
 	volatile uint8_t *vmem = mem;
 
 	(void)context;
@@ -409,10 +431,12 @@ static void OPTIMIZE3 stress_memthrash_matrix(
 			vmem[i1] = vmem[i2];
 			vmem[i2] = tmp;
 		}
+		n += MATRIX_SIZE / 16;
 	}
+	return n * 4;
 }
 
-static void OPTIMIZE3 stress_memthrash_prefetch(
+static size_t OPTIMIZE3 stress_memthrash_prefetch(
 	const stress_memthrash_context_t *context,
 	const size_t mem_size)
 {
@@ -430,10 +454,11 @@ static void OPTIMIZE3 stress_memthrash_prefetch(
 		shim_builtin_prefetch(ptr, 1, 1);
 		*vptr = i & 0xff;
 	}
+	return (size_t)i;
 }
 
 #if defined(HAVE_ASM_X86_CLFLUSH)
-static void OPTIMIZE3 stress_memthrash_flush(
+static size_t OPTIMIZE3 stress_memthrash_flush(
 	const stress_memthrash_context_t *context,
 	const size_t mem_size)
 {
@@ -450,10 +475,11 @@ static void OPTIMIZE3 stress_memthrash_flush(
 		*vptr = i & 0xff;
 		shim_clflush(ptr);
 	}
+	return (size_t)i;
 }
 #endif
 
-static void OPTIMIZE3 stress_memthrash_mfence(
+static size_t OPTIMIZE3 stress_memthrash_mfence(
 	const stress_memthrash_context_t *context,
 	const size_t mem_size)
 {
@@ -469,10 +495,11 @@ static void OPTIMIZE3 stress_memthrash_mfence(
 		*ptr = i & 0xff;
 		shim_mfence();
 	}
+	return (size_t)i;
 }
 
 #if defined(MEM_LOCK)
-static void OPTIMIZE3 stress_memthrash_lock(
+static size_t OPTIMIZE3 stress_memthrash_lock(
 	const stress_memthrash_context_t *context,
 	const size_t mem_size)
 {
@@ -486,10 +513,11 @@ static void OPTIMIZE3 stress_memthrash_lock(
 
 		MEM_LOCK(ptr, 1);
 	}
+	return (size_t)i * 2;
 }
 #endif
 
-static void OPTIMIZE3 stress_memthrash_spinread(
+static size_t OPTIMIZE3 stress_memthrash_spinread(
 	const stress_memthrash_context_t *context,
 	const size_t mem_size)
 {
@@ -523,7 +551,7 @@ static void OPTIMIZE3 stress_memthrash_spinread(
 			(void)stress_nt_load32(nt_ptr);
 			stress_asm_mb();
 		}
-		return;
+		return (size_t)i * 8 * sizeof(*nt_ptr);
 	}
 #endif
 	ptr = (uint32_t *)(((uintptr_t)mem) + offset);
@@ -539,9 +567,10 @@ static void OPTIMIZE3 stress_memthrash_spinread(
 		(void)*ptr;
 		(void)*ptr;
 	}
+	return (size_t)i * 8 * sizeof(*ptr);
 }
 
-static void OPTIMIZE3 stress_memthrash_spinwrite(
+static size_t OPTIMIZE3 stress_memthrash_spinwrite(
 	const stress_memthrash_context_t *context,
 	const size_t mem_size)
 {
@@ -575,7 +604,7 @@ static void OPTIMIZE3 stress_memthrash_spinwrite(
 			stress_nt_store32(nt_ptr, i);
 			stress_asm_mb();
 		}
-		return;
+		return (size_t)i * 8 * sizeof(*nt_ptr);
 	}
 #endif
 	ptr = (uint32_t *)(((uintptr_t)mem) + offset);
@@ -591,9 +620,10 @@ static void OPTIMIZE3 stress_memthrash_spinwrite(
 		*ptr = i;
 		*ptr = i;
 	}
+	return (size_t)i * 8 * sizeof(*ptr);
 }
 
-static void OPTIMIZE3 stress_memthrash_tlb(
+static size_t OPTIMIZE3 stress_memthrash_tlb(
 	const stress_memthrash_context_t *context,
 	const size_t mem_size)
 {
@@ -627,9 +657,10 @@ static void OPTIMIZE3 stress_memthrash_tlb(
 		*ptr = j;
 		k = (k + prime_stride) & mask;
 	}
+	return 2 * cache_lines;
 }
 
-static void OPTIMIZE3 TARGET_CLONES stress_memthrash_swapfwdrev(
+static size_t OPTIMIZE3 TARGET_CLONES stress_memthrash_swapfwdrev(
 	const stress_memthrash_context_t *context,
 	const size_t mem_size)
 {
@@ -651,9 +682,10 @@ static void OPTIMIZE3 TARGET_CLONES stress_memthrash_swapfwdrev(
 		*rev = *fwd;
 		*fwd = tmp;
 	}
+	return 4 * mem_size;
 }
 
-static void OPTIMIZE3 TARGET_CLONES stress_memthrash_reverse(
+static size_t OPTIMIZE3 TARGET_CLONES stress_memthrash_reverse(
 	const stress_memthrash_context_t *context,
 	const size_t mem_size)
 {
@@ -669,10 +701,11 @@ static void OPTIMIZE3 TARGET_CLONES stress_memthrash_reverse(
 		*(fwd++) = *(--rev);
 		*rev = tmp;
 	}
+	return 2 * mem_size;
 }
 
 #if defined(HAVE_MEMTHRASH_NUMA)
-static void OPTIMIZE3 TARGET_CLONES stress_memthrash_numa(
+static size_t OPTIMIZE3 TARGET_CLONES stress_memthrash_numa(
 	const stress_memthrash_context_t *context,
 	const size_t mem_size)
 {
@@ -683,7 +716,7 @@ static void OPTIMIZE3 TARGET_CLONES stress_memthrash_numa(
 	unsigned long int node;
 
 	if (!numa_mask)
-		return;
+		return 0;
 
 	node = (unsigned long int)stress_mwc32modn((uint32_t)numa_mask->nodes);
 	(void)shim_memset(numa_mask->mask, 0, numa_mask->mask_size);
@@ -700,11 +733,13 @@ static void OPTIMIZE3 TARGET_CLONES stress_memthrash_numa(
 		if (node >= numa_mask->nodes)
 			node = 0;
 	}
+	/* page migrations only, no data is touched */
+	return 0;
 }
 #endif
 
-static void stress_memthrash_all(const stress_memthrash_context_t *context, size_t mem_size);
-static void stress_memthrash_random(const stress_memthrash_context_t *context, size_t mem_size);
+static size_t stress_memthrash_all(const stress_memthrash_context_t *context, size_t mem_size);
+static size_t stress_memthrash_random(const stress_memthrash_context_t *context, size_t mem_size);
 
 static const stress_memthrash_method_info_t memthrash_methods[] = {
 	{ "all",	stress_memthrash_all },		/* MUST always be first! */
@@ -747,21 +782,48 @@ static const stress_memthrash_method_info_t memthrash_methods[] = {
 	{ "tlb",	stress_memthrash_tlb },
 };
 
-static void stress_memthrash_all(const stress_memthrash_context_t *context, size_t mem_size)
+/*
+ *  stress_memthrash_method_run()
+ *	run method i and account the bytes touched and time
+ *	taken to the method in the thread's stats
+ */
+static size_t stress_memthrash_method_run(
+	const stress_memthrash_context_t *context,
+	const size_t i,
+	const size_t mem_size)
+{
+	stress_memthrash_stats_t *stats = &context->stats[i];
+	const double t = stress_time_now();
+	const size_t bytes = memthrash_methods[i].func(context, mem_size);
+
+	stats->duration += stress_time_now() - t;
+	stats->bytes += bytes;
+	stats->calls++;
+	return bytes;
+}
+
+static size_t stress_memthrash_all(const stress_memthrash_context_t *context, size_t mem_size)
 {
 	static size_t i = 1;
 	const double t = stress_time_now();
+	const size_t method = i;
+	size_t bytes = 0;
 
 	do {
-		memthrash_methods[i].func(context, mem_size);
+		/* random accounts to the methods it runs */
+		if (memthrash_methods[method].func == stress_memthrash_random)
+			bytes += stress_memthrash_random(context, mem_size);
+		else
+			bytes += stress_memthrash_method_run(context, method, mem_size);
 	} while (!thread_terminate && (stress_time_now() - t < 0.01));
 
 	i++;
 	if (UNLIKELY(i >= SIZEOF_ARRAY(memthrash_methods)))
 		i = 1;
+	return bytes;
 }
 
-static void stress_memthrash_random(const stress_memthrash_context_t *context, size_t mem_size)
+static size_t stress_memthrash_random(const stress_memthrash_context_t *context, size_t mem_size)
 {
 	/* loop until we find a good candidate */
 	for (;;) {
@@ -770,10 +832,8 @@ static void stress_memthrash_random(const stress_memthrash_context_t *context, s
 
 		/* Don't run stress_memthrash_random/all to avoid recursion */
 		if ((func != stress_memthrash_random) &&
-		    (func != stress_memthrash_all)) {
-			func(context, mem_size);
-			return;
-		}
+		    (func != stress_memthrash_all))
+			return stress_memthrash_method_run(context, i, mem_size);
 	}
 }
 
@@ -798,6 +858,7 @@ static void *stress_memthrash_func(void *ctxt)
 {
 	const stress_memthrash_context_t *context = (stress_memthrash_context_t *)ctxt;
 	const stress_memthrash_func_t func = context->memthrash_method->func;
+	const size_t method = (size_t)(context->memthrash_method - memthrash_methods);
 	stress_args_t *args = context->args;
 
 	/*
@@ -814,12 +875,12 @@ static void *stress_memthrash_func(void *ctxt)
 		for (j = MATRIX_SIZE_MIN_SHIFT; LIKELY(j <= MATRIX_SIZE_MAX_SHIFT &&
 		     !thread_terminate && stress_continue(args)); j++) {
 			size_t mem_size = 1 << (2 * j);
-			size_t i;
 
-			for (i = 0; i < SIZEOF_ARRAY(memthrash_methods); i++)
-				if (func == memthrash_methods[i].func)
-					break;
-			func(context, mem_size);
+			/* all and random account to the methods they run */
+			if ((func == stress_memthrash_all) || (func == stress_memthrash_random))
+				(void)func(context, mem_size);
+			else
+				(void)stress_memthrash_method_run(context, method, mem_size);
 			stress_bogo_inc(args);
 			(void)shim_sched_yield();
 		}
@@ -859,6 +920,42 @@ static inline char *plural(uint32_t n)
 	return n > 1 ? "s" : "";
 }
 
+/*
+ *  stress_memthrash_metrics()
+ *	report aggregate per-method bandwidth and call rate, the rates
+ *	of the threads are summed as the threads run concurrently
+ */
+static void stress_memthrash_metrics(
+	stress_args_t *args,
+	const stress_pthread_info_t *pthread_info,
+	const uint32_t max_threads)
+{
+	size_t i, idx = 0;
+
+	for (i = 1; i < SIZEOF_ARRAY(memthrash_methods); i++) {
+		double bw = 0.0, rate = 0.0;
+		uint32_t j;
+		char str[64];
+
+		for (j = 0; j < max_threads; j++) {
+			const stress_memthrash_stats_t *stats = &pthread_info[j].context.stats[i];
+
+			if (stats->duration <= 0.0)
+				continue;
+			bw += (double)stats->bytes / stats->duration;
+			rate += (double)stats->calls / stats->duration;
+		}
+		if (rate <= 0.0)
+			continue;
+		if (bw > 0.0) {
+			(void)snprintf(str, sizeof(str), "GB per sec %s", memthrash_methods[i].name);
+			stress_metrics_set(args, idx++, str, bw / (double)GB, STRESS_METRIC_HARMONIC_MEAN);
+		}
+		(void)snprintf(str, sizeof(str), "ops per sec %s", memthrash_methods[i].name);
+		stress_metrics_set(args, idx++, str, rate, STRESS_METRIC_HARMONIC_MEAN);
+	}
+}
+
 static void stress_memthrash_sigalrm_handler(int signum)
 {
 	(void)signum;
@@ -873,6 +970,8 @@ static int stress_memthrash_child(stress_args_t *args, void *ctxt)
 	uint32_t i;
 	int ret;
 	stress_pthread_info_t *pthread_info;
+	stress_memthrash_stats_t *stats;
+	const size_t n_methods = SIZEOF_ARRAY(memthrash_methods);
 
 	pthread_info = (stress_pthread_info_t *)calloc(max_threads, sizeof(*pthread_info));
 	if (!pthread_info) {
@@ -880,6 +979,17 @@ static int stress_memthrash_child(stress_args_t *args, void *ctxt)
 			args->name);
 		return EXIT_NO_RESOURCE;
 	}
+	stats = (stress_memthrash_stats_t *)calloc((size_t)max_threads * n_methods, sizeof(*stats));
+	if (!stats) {
+		pr_inf_skip("%s: failed to allocate method statistics array, skipping stressor\n",
+			args->name);
+		free(pthread_info);
+		return EXIT_NO_RESOURCE;
+	}
+	for (i = 0; i < max_threads; i++) {
+		pthread_info[i].context = *context;
+		pthread_info[i].context.stats = &stats[i * n_methods];
+	}
 
 	VOID_RET(int, stress_sighandler(args->name, SIGALRM, stress_memthrash_sigalrm_handler, NULL));
 
@@ -891,6 +1001,7 @@ mmap_retry:
 		if (UNLIKELY(!stress_continue_flag())) {
 			pr_dbg("%s: mmap failed: %d %s\n",
 				args->name, errno, strerror(errno));
+			free(stats);
 			free(pthread_info);
 			return EXIT_NO_RESOURCE;
 		}
@@ -906,7 +1017,7 @@ mmap_retry:
 	for (i = 0; i < max_threads; i++) {
 		pthread_info[i].ret = pthread_create(&pthread_info[i].pthread,
 						NULL, stress_memthrash_func,
-						(void *)context);
+						(void *)&pthread_info[i].context);
 		if (pthread_info[i].ret) {
 			ret = pthread_info[i].ret;
 
@@ -935,8 +1046,10 @@ reap:
 			}
 		}
 	}
+	stress_memthrash_metrics(args, pthread_info, max_threads);
 reap_mem:
 	(void)munmap(mem, MEM_SIZE);
+	free(stats);
 	free(pthread_info);
 
 	return EXIT_SUCCESS;
@@ -960,7 +1073,9 @@ static int stress_memthrash(stress_args_t *args)
 
 	context.args = args;
 	context.total_cpus = (uint32_t)stress_get_processors_online();
-	context.max_threads = stress_memthrash_max(args->instances, context.total_cpus);
+	if (!stress_get_setting("memthrash-threads", &context.max_threads))
+		context.max_threads = stress_memthrash_max(args->instances, context.total_cpus);
+	context.stats = NULL;
 #if defined(HAVE_MEMTHRASH_NUMA)
 	{
 		context.numa_mask = stress_numa_mask_alloc();
@@ -1012,6 +1127,7 @@ static const char *stress_memthrash_method(const size_t i)
 
 static const stress_opt_t opts[] = {
 	{ OPT_memthrash_method, "memthrash-method", TYPE_ID_SIZE_T_METHOD, 0, 0, stress_memthrash_method },
+	{ OPT_memthrash_threads, "memthrash-threads", TYPE_ID_UINT32, MIN_MEMTHRASH_THREADS, MAX_MEMTHRASH_THREADS, NULL },
 	END_OPT,
 };
 
@@ -1025,6 +1141,7 @@ const stressor_info_t stress_memthrash_info = {
 
 static const stress_opt_t opts[] = {
 	{ OPT_memthrash_method, "memthrash-method", TYPE_ID_SIZE_T_METHOD, 0, 0, stress_unimplemented_method },
+	{ OPT_memthrash_threads, "memthrash-threads", TYPE_ID_UINT32, MIN_MEMTHRASH_THREADS, MAX_MEMTHRASH_THREADS, NULL },
 	END_OPT,
 };
 
@@ -0,0 +1,623 @@
+/*
+ * Copyright (C) 2025      Colin Ian King.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+#include "stress-ng.h"
+#include "core-builtin.h"
+#include "core-numa.h"
+#include "core-put.h"
+
+#define MIN_MEMTIER_BYTES	(1 * MB)
+#define MAX_MEMTIER_BYTES	(MAX_MEM_LIMIT)
+#define DEFAULT_MEMTIER_BYTES	(64 * MB)
+
+#define MIN_MEMTIER_HOT		(1)
+#define MAX_MEMTIER_HOT		(90)
+#define DEFAULT_MEMTIER_HOT	(10)
+
+#define MIN_MEMTIER_WAIT	(0)
+#define MAX_MEMTIER_WAIT	(60000)
+#define DEFAULT_MEMTIER_WAIT	(2000)
+
+static const stress_help_t help[] = {
+	{ NULL,	"memtier N",		"start N workers measuring memory tier page promotion and demotion" },
+	{ NULL,	"memtier-bytes N",	"size of the hot and cold working set" },
+	{ NULL,	"memtier-hot P",	"percentage of the working set that is hot" },
+	{ NULL,	"memtier-ops N",	"stop after N demote and promote rounds" },
+	{ NULL,	"memtier-wait N",	"wait up to N milliseconds for the kernel to promote hot pages" },
+	{ NULL,	NULL,			NULL }
+};
+
+static const stress_opt_t opts[] = {
+	{ OPT_memtier_bytes, "memtier-bytes", TYPE_ID_SIZE_T_BYTES_VM, MIN_MEMTIER_BYTES, MAX_MEMTIER_BYTES, NULL },
+	{ OPT_memtier_hot,   "memtier-hot",   TYPE_ID_UINT32, MIN_MEMTIER_HOT, MAX_MEMTIER_HOT, NULL },
+	{ OPT_memtier_wait,  "memtier-wait",  TYPE_ID_UINT32, MIN_MEMTIER_WAIT, MAX_MEMTIER_WAIT, NULL },
+	END_OPT,
+};
+
+#if defined(__linux__) &&		\
+    defined(__NR_move_pages)
+
+#define STRESS_MEMTIER_NODES_MAX	(64)		/* nodes in a node list bitmap */
+#define STRESS_MEMTIER_LINE		(64)		/* pointer chase stride */
+#define STRESS_MEMTIER_LOADS		(1U << 16)	/* dependent loads per latency sample */
+#define STRESS_MEMTIER_SAMPLE		(0.05)		/* seconds between promotion samples */
+#define STRESS_MEMTIER_TIMELINE_MAX	(64)		/* latency timeline samples logged */
+
+/* /proc/sys/kernel/numa_balancing memory tiering mode */
+#define STRESS_NUMA_BALANCING_MEMORY_TIERING	(0x2)
+
+static const char idle_bitmap[] = "/sys/kernel/mm/page_idle/bitmap";
+
+typedef struct {
+	double t;			/* time since start of hot phase */
+	double latency;			/* hot set dependent load latency, ns */
+	double promoted;		/* percentage of hot pages on fast tier */
+} stress_memtier_sample_t;
+
+typedef struct {
+	double demote_bytes;		/* bytes demoted by move_pages */
+	double demote_duration;		/* time taken demoting */
+	double promote_bytes;		/* bytes promoted by move_pages */
+	double promote_duration;	/* time taken promoting */
+	double slow_latency;		/* sum of hot latencies on slow tier */
+	double fast_latency;		/* sum of hot latencies on fast tier */
+	double rounds;			/* number of latency rounds */
+	double promote_time;		/* sum of kernel time to promote half the hot set */
+	double promote_time_rounds;	/* rounds where half the hot set was promoted */
+	double kernel_promoted;		/* sum of percent of hot set kernel promoted */
+	double cold_idle;		/* sum of percent of cold pages that stayed idle */
+	double cold_idle_rounds;	/* rounds where idle pages were checked */
+} stress_memtier_stats_t;
+
+/*
+ *  stress_memtier_node_list()
+ *	parse a sysfs node list such as 0-1,4 into a node bitmap,
+ *	returns number of nodes in the list or -1 on failure
+ */
+static int stress_memtier_node_list(const char *filename, uint64_t *nodes)
+{
+	char buf[4096], *ptr;
+	int n = 0;
+
+	*nodes = 0;
+	if (stress_system_read(filename, buf, sizeof(buf)) <= 0)
+		return -1;
+
+	for (ptr = buf; *ptr && (*ptr != '\n'); ) {
+		unsigned long int lo, hi, i;
+		char *end;
+
+		lo = strtoul(ptr, &end, 10);
+		if (end == ptr)
+			return -1;
+		hi = lo;
+		if (*end == '-') {
+			ptr = end + 1;
+			hi = strtoul(ptr, &end, 10);
+			if (end == ptr)
+				return -1;
+		}
+		for (i = lo; (i <= hi) && (i < STRESS_MEMTIER_NODES_MAX); i++) {
+			if (!(*nodes & (1ULL << i)))
+				n++;
+			*nodes |= (1ULL << i);
+		}
+		ptr = end;
+		if (*ptr == ',')
+			ptr++;
+	}
+	return n;
+}
+
+/*
+ *  stress_memtier_find_nodes()
+ *	select the fast (DRAM) and slow tier memory nodes. The slow
+ *	tier is a CPU-less memory node such as CXL attached memory,
+ *	if there are none a remote DRAM node is used instead.
+ *	Returns -1 if there are less than 2 memory nodes.
+ */
+static int stress_memtier_find_nodes(int *fast_node, int *slow_node, bool *cpuless)
+{
+	uint64_t mem_nodes, cpu_nodes;
+	unsigned int cpu = 0, node = 0;
+	int i;
+
+	*fast_node = -1;
+	*slow_node = -1;
+	*cpuless = false;
+
+	if (stress_memtier_node_list("/sys/devices/system/node/has_memory", &mem_nodes) < 2)
+		return -1;
+	if (stress_memtier_node_list("/sys/devices/system/node/has_cpu", &cpu_nodes) < 1)
+		return -1;
+
+	/* fast tier, preferably the node we are running on */
+	if ((shim_getcpu(&cpu, &node, NULL) == 0) &&
+	    (node < STRESS_MEMTIER_NODES_MAX) &&
+	    (mem_nodes & cpu_nodes & (1ULL << node))) {
+		*fast_node = (int)node;
+	} else {
+		for (i = 0; i < STRESS_MEMTIER_NODES_MAX; i++) {
+			if (mem_nodes & cpu_nodes & (1ULL << i)) {
+				*fast_node = i;
+				break;
+			}
+		}
+	}
+	if (*fast_node < 0)
+		return -1;
+
+	/* slow tier, CPU-less memory nodes first */
+	for (i = 0; i < STRESS_MEMTIER_NODES_MAX; i++) {
+		if ((mem_nodes & (1ULL << i)) && !(cpu_nodes & (1ULL << i))) {
+			*slow_node = i;
+			*cpuless = true;
+			return 0;
+		}
+	}
+	for (i = 0; i < STRESS_MEMTIER_NODES_MAX; i++) {
+		if ((mem_nodes & (1ULL << i)) && (i != *fast_node)) {
+			*slow_node = i;
+			return 0;
+		}
+	}
+	return -1;
+}
+
+/*
+ *  stress_memtier_supported()
+ *	check there are at least two memory nodes to tier across
+ */
+static int stress_memtier_supported(const char *name)
+{
+	int fast_node, slow_node;
+	bool cpuless;
+
+	if (stress_memtier_find_nodes(&fast_node, &slow_node, &cpuless) < 0) {
+		pr_inf_skip("%s stressor will be skipped, "
+			"need at least two NUMA memory nodes\n", name);
+		return -1;
+	}
+	return 0;
+}
+
+/*
+ *  stress_memtier_chain()
+ *	link the cache lines of the hot set into a single random
+ *	cycle for dependent load latency measurements
+ */
+static void stress_memtier_chain(uintptr_t *buf, const size_t lines)
+{
+	const size_t stride = STRESS_MEMTIER_LINE / sizeof(*buf);
+	size_t i;
+
+	for (i = 0; i < lines; i++)
+		buf[(i * stride) + 1] = (uintptr_t)i;
+	for (i = lines - 1; i > 0; i--) {
+		const size_t j = (size_t)stress_mwc64modn((uint64_t)i + 1);
+		const uintptr_t tmp = buf[(i * stride) + 1];
+
+		buf[(i * stride) + 1] = buf[(j * stride) + 1];
+		buf[(j * stride) + 1] = tmp;
+	}
+	for (i = 0; i < lines; i++) {
+		const size_t from = (size_t)buf[(i * stride) + 1];
+		const size_t to = (size_t)buf[(((i + 1) % lines) * stride) + 1];
+
+		buf[from * stride] = (uintptr_t)&buf[to * stride];
+	}
+}
+
+/*
+ *  stress_memtier_latency()
+ *	dependent load latency in ns chasing the hot set chain
+ */
+static double stress_memtier_latency(uintptr_t *buf)
+{
+	register void **ptr = (void **)buf;
+	register uint32_t i;
+	double t_start, duration;
+
+	t_start = stress_time_now();
+	for (i = 0; i < STRESS_MEMTIER_LOADS; i++)
+		ptr = (void **)*ptr;
+	duration = stress_time_now() - t_start;
+	stress_void_ptr_put((void *)ptr);
+
+	return (duration * STRESS_DBL_NANOSECOND) / (double)STRESS_MEMTIER_LOADS;
+}
+
+/*
+ *  stress_memtier_move()
+ *	move n pages to node, returns number of pages that
+ *	ended up on node or -1 on failure
+ */
+static ssize_t stress_memtier_move(
+	void **pages,
+	int *nodes,
+	int *status,
+	const size_t n,
+	const int node)
+{
+	size_t i;
+	ssize_t moved = 0;
+
+	for (i = 0; i < n; i++) {
+		nodes[i] = node;
+		status[i] = -1;
+	}
+	if (shim_move_pages(0, (unsigned long int)n, pages, nodes, status, MPOL_MF_MOVE) < 0)
+		return -1;
+	for (i = 0; i < n; i++) {
+		if (status[i] == node)
+			moved++;
+	}
+	return moved;
+}
+
+/*
+ *  stress_memtier_on_node()
+ *	count the pages currently on node
+ */
+static size_t stress_memtier_on_node(
+	void **pages,
+	int *status,
+	const size_t n,
+	const int node)
+{
+	size_t i, count = 0;
+
+	if (shim_move_pages(0, (unsigned long int)n, pages, NULL, status, 0) < 0)
+		return 0;
+	for (i = 0; i < n; i++) {
+		if (status[i] == node)
+			count++;
+	}
+	return count;
+}
+
+/*
+ *  stress_memtier_pfn()
+ *	get page frame number of a present page from pagemap,
+ *	returns 0 if not known
+ */
+static uint64_t stress_memtier_pfn(const int fd, const void *addr, const size_t page_size)
+{
+	uint64_t entry;
+	const off_t offset = (off_t)(((uintptr_t)addr / page_size) * sizeof(entry));
+
+	if (pread(fd, &entry, sizeof(entry), offset) != (ssize_t)sizeof(entry))
+		return 0;
+	if (!(entry & (1ULL << 63)))
+		return 0;
+	return entry & ((1ULL << 55) - 1);
+}
+
+/*
+ *  stress_memtier_idle()
+ *	mark cold pages as idle if mark is true, otherwise return
+ *	the number of cold pages that are still idle, returns -1
+ *	if page frame numbers or the idle bitmap are not accessible
+ */
+static ssize_t stress_memtier_idle(
+	const int pagemap_fd,
+	const int idle_fd,
+	uint8_t *cold,
+	const size_t cold_pages,
+	const size_t page_size,
+	const bool mark)
+{
+	size_t i;
+	ssize_t idle = 0;
+
+	for (i = 0; i < cold_pages; i++) {
+		const uint64_t pfn = stress_memtier_pfn(pagemap_fd, cold + (i * page_size), page_size);
+		const off_t offset = (off_t)((pfn / 64) * sizeof(uint64_t));
+		uint64_t bits;
+
+		if (!pfn)
+			return -1;
+		if (mark) {
+			bits = 1ULL << (pfn & 63);
+			if (pwrite(idle_fd, &bits, sizeof(bits), offset) != (ssize_t)sizeof(bits))
+				return -1;
+		} else {
+			if (pread(idle_fd, &bits, sizeof(bits), offset) != (ssize_t)sizeof(bits))
+				return -1;
+			if (bits & (1ULL << (pfn & 63)))
+				idle++;
+		}
+	}
+	return idle;
+}
+
+/*
+ *  stress_memtier_numa_balancing()
+ *	return true if the kernel NUMA balancing memory tiering
+ *	mode is enabled, this promotes hot pages from slow tiers
+ */
+static bool stress_memtier_numa_balancing(void)
+{
+	char buf[32];
+	int mode;
+
+	if (stress_system_read("/proc/sys/kernel/numa_balancing", buf, sizeof(buf)) <= 0)
+		return false;
+	if (sscanf(buf, "%d", &mode) != 1)
+		return false;
+	return !!(mode & STRESS_NUMA_BALANCING_MEMORY_TIERING);
+}
+
+/*
+ *  stress_memtier
+ *	demote a hot and cold working set to the slow memory tier,
+ *	access the hot set and measure how long the kernel takes to
+ *	promote it and the access latency over time, then promote
+ *	any remaining hot pages with move_pages
+ */
+static int stress_memtier(stress_args_t *args)
+{
+	const size_t page_size = args->page_size;
+	size_t memtier_bytes = DEFAULT_MEMTIER_BYTES;
+	uint32_t memtier_hot = DEFAULT_MEMTIER_HOT;
+	uint32_t memtier_wait = DEFAULT_MEMTIER_WAIT;
+	size_t n_pages, hot_pages, cold_pages, i;
+	uint8_t *buf;
+	void **pages;
+	int *nodes, *status;
+	int fast_node, slow_node, pagemap_fd = -1, idle_fd = -1;
+	int rc = EXIT_SUCCESS;
+	bool cpuless, tiering, idle_tracking = false, timeline = (args->instance == 0);
+	stress_memtier_stats_t stats;
+	stress_memtier_sample_t *samples;
+	double rate;
+
+	if (stress_memtier_find_nodes(&fast_node, &slow_node, &cpuless) < 0) {
+		if (args->instance == 0)
+			pr_inf_skip("%s: need at least two NUMA memory nodes, "
+				"skipping stressor\n", args->name);
+		return EXIT_NO_RESOURCE;
+	}
+	tiering = stress_memtier_numa_balancing();
+
+	if (!stress_get_setting("memtier-bytes", &memtier_bytes)) {
+		if (g_opt_flags & OPT_FLAGS_MAXIMIZE)
+			memtier_bytes = MAX_32;
+		if (g_opt_flags & OPT_FLAGS_MINIMIZE)
+			memtier_bytes = MIN_MEMTIER_BYTES;
+	}
+	(void)stress_get_setting("memtier-hot", &memtier_hot);
+	(void)stress_get_setting("memtier-wait", &memtier_wait);
+
+	memtier_bytes /= args->instances;
+	if (memtier_bytes < MIN_MEMTIER_BYTES)
+		memtier_bytes = MIN_MEMTIER_BYTES;
+	n_pages = memtier_bytes / page_size;
+	hot_pages = (n_pages * memtier_hot) / 100;
+	if (hot_pages < 1)
+		hot_pages = 1;
+	cold_pages = n_pages - hot_pages;
+	memtier_bytes = n_pages * page_size;
+
+	if (args->instance == 0) {
+		pr_inf("%s: fast tier node %d, slow tier node %d%s\n",
+			args->name, fast_node, slow_node,
+			cpuless ? " (CPU-less)" : " (remote DRAM, no CPU-less memory nodes found)");
+		if (!tiering)
+			pr_inf("%s: NUMA balancing memory tiering mode is not enabled, "
+				"hot pages will only be promoted with move_pages\n", args->name);
+	}
+
+	buf = (uint8_t *)stress_mmap_populate(NULL, memtier_bytes,
+		PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (buf == MAP_FAILED) {
+		pr_inf_skip("%s: failed to mmap %zu bytes, errno=%d (%s), "
+			"skipping stressor\n", args->name, memtier_bytes,
+			errno, strerror(errno));
+		return EXIT_NO_RESOURCE;
+	}
+	stress_set_vma_anon_name(buf, memtier_bytes, "memtier-working-set");
+	(void)shim_memset(buf, 0, memtier_bytes);
+
+	pages = (void **)calloc(n_pages, sizeof(*pages));
+	nodes = (int *)calloc(n_pages, sizeof(*nodes));
+	status = (int *)calloc(n_pages, sizeof(*status));
+	samples = (stress_memtier_sample_t *)calloc(STRESS_MEMTIER_TIMELINE_MAX, sizeof(*samples));
+	if (!pages || !nodes || !status || !samples) {
+		pr_inf_skip("%s: failed to allocate %zu page migration entries, "
+			"skipping stressor\n", args->name, n_pages);
+		rc = EXIT_NO_RESOURCE;
+		goto tidy;
+	}
+	for (i = 0; i < n_pages; i++)
+		pages[i] = (void *)(buf + (i * page_size));
+
+	/* hot set is at the start of the buffer, cold set is the rest */
+	stress_memtier_chain((uintptr_t *)buf, (hot_pages * page_size) / STRESS_MEMTIER_LINE);
+
+	/* idle page tracking verifies the cold set stays cold */
+	if (cold_pages > 0) {
+		pagemap_fd = open("/proc/self/pagemap", O_RDONLY);
+		idle_fd = open(idle_bitmap, O_RDWR);
+		idle_tracking = (pagemap_fd >= 0) && (idle_fd >= 0) &&
+			(stress_memtier_pfn(pagemap_fd, buf + (hot_pages * page_size), page_size) != 0);
+	}
+
+	(void)shim_memset(&stats, 0, sizeof(stats));
+
+	stress_set_proc_state(args->name, STRESS_STATE_SYNC_WAIT);
+	stress_sync_start_wait(args);
+	stress_set_proc_state(args->name, STRESS_STATE_RUN);
+
+	do {
+		double t, t_start, duration, half_time = -1.0;
+		ssize_t moved, idle;
+		size_t promoted, n_samples = 0;
+
+		/* demote the entire working set to the slow tier */
+		t = stress_time_now();
+		moved = stress_memtier_move(pages, nodes, status, n_pages, slow_node);
+		duration = stress_time_now() - t;
+		if (moved <= 0) {
+			if (args->instance == 0)
+				pr_inf_skip("%s: cannot move pages to node %d, errno=%d (%s), "
+					"skipping stressor\n", args->name, slow_node,
+					errno, strerror(errno));
+			rc = EXIT_NO_RESOURCE;
+			break;
+		}
+		stats.demote_bytes += (double)moved * (double)page_size;
+		stats.demote_duration += duration;
+
+		if (idle_tracking &&
+		    (stress_memtier_idle(pagemap_fd, idle_fd, buf + (hot_pages * page_size),
+					 cold_pages, page_size, true) < 0))
+			idle_tracking = false;
+
+		stats.slow_latency += stress_memtier_latency((uintptr_t *)buf);
+
+		/*
+		 *  keep the hot set hot and sample how much of
+		 *  it the kernel has promoted to the fast tier
+		 */
+		promoted = 0;
+		if (tiering && (memtier_wait > 0)) {
+			double t_sample;
+
+			t_start = stress_time_now();
+			t_sample = t_start + STRESS_MEMTIER_SAMPLE;
+			do {
+				const double latency = stress_memtier_latency((uintptr_t *)buf);
+
+				t = stress_time_now();
+				if (t < t_sample)
+					continue;
+				t_sample = t + STRESS_MEMTIER_SAMPLE;
+
+				promoted = stress_memtier_on_node(pages, status, hot_pages, fast_node);
+				if ((half_time < 0.0) && (promoted * 2 >= hot_pages))
+					half_time = t - t_start;
+				if (timeline && (n_samples < STRESS_MEMTIER_TIMELINE_MAX)) {
+					samples[n_samples].t = t - t_start;
+					samples[n_samples].latency = latency;
+					samples[n_samples].promoted = 100.0 * (double)promoted / (double)hot_pages;
+					n_samples++;
+				}
+				if (promoted >= hot_pages)
+					break;
+			} while (stress_continue_flag() &&
+				 ((t - t_start) * 1000.0 < (double)memtier_wait));
+
+			stats.kernel_promoted += 100.0 * (double)promoted / (double)hot_pages;
+			if (half_time >= 0.0) {
+				stats.promote_time += half_time;
+				stats.promote_time_rounds += 1.0;
+			}
+		}
+
+		if (timeline && (n_samples > 0)) {
+			pr_dbg("%s: hot set latency and promotion over time:\n", args->name);
+			for (i = 0; i < n_samples; i++)
+				pr_dbg("%s: %8.3fs %9.2f ns %6.2f%% promoted\n", args->name,
+					samples[i].t, samples[i].latency, samples[i].promoted);
+			timeline = false;
+		}
+
+		/* promote whatever hot pages the kernel has not */
+		if (promoted < hot_pages) {
+			t = stress_time_now();
+			moved = stress_memtier_move(pages, nodes, status, hot_pages, fast_node);
+			duration = stress_time_now() - t;
+			if (moved > 0) {
+				stats.promote_bytes += (double)((size_t)moved - promoted) * (double)page_size;
+				stats.promote_duration += duration;
+			}
+		}
+		stats.fast_latency += stress_memtier_latency((uintptr_t *)buf);
+		stats.rounds += 1.0;
+
+		if (idle_tracking) {
+			idle = stress_memtier_idle(pagemap_fd, idle_fd, buf + (hot_pages * page_size),
+				cold_pages, page_size, false);
+			if (idle < 0) {
+				idle_tracking = false;
+			} else {
+				stats.cold_idle += 100.0 * (double)idle / (double)cold_pages;
+				stats.cold_idle_rounds += 1.0;
+			}
+		}
+		stress_bogo_inc(args);
+	} while (stress_continue(args));
+
+	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
+
+	rate = (stats.demote_duration > 0.0) ? stats.demote_bytes / (stats.demote_duration * (double)MB) : 0.0;
+	stress_metrics_set(args, 0, "MB per sec demotion rate",
+		rate, STRESS_METRIC_HARMONIC_MEAN);
+	rate = (stats.promote_duration > 0.0) ? stats.promote_bytes / (stats.promote_duration * (double)MB) : 0.0;
+	stress_metrics_set(args, 1, "MB per sec promotion rate",
+		rate, STRESS_METRIC_HARMONIC_MEAN);
+	rate = (stats.rounds > 0.0) ? stats.slow_latency / stats.rounds : 0.0;
+	stress_metrics_set(args, 2, "ns hot latency on slow tier",
+		rate, STRESS_METRIC_GEOMETRIC_MEAN);
+	rate = (stats.rounds > 0.0) ? stats.fast_latency / stats.rounds : 0.0;
+	stress_metrics_set(args, 3, "ns hot latency on fast tier",
+		rate, STRESS_METRIC_GEOMETRIC_MEAN);
+	if (tiering && (stats.rounds > 0.0)) {
+		stress_metrics_set(args, 4, "percent hot set kernel promoted",
+			stats.kernel_promoted / stats.rounds, STRESS_METRIC_GEOMETRIC_MEAN);
+		if (stats.promote_time_rounds > 0.0)
+			stress_metrics_set(args, 5, "ms to promote half hot set",
+				stats.promote_time * 1000.0 / stats.promote_time_rounds,
+				STRESS_METRIC_GEOMETRIC_MEAN);
+	}
+	if (stats.cold_idle_rounds > 0.0)
+		stress_metrics_set(args, 6, "percent cold set left idle",
+			stats.cold_idle / stats.cold_idle_rounds, STRESS_METRIC_GEOMETRIC_MEAN);
+
+tidy:
+	if (idle_fd >= 0)
+		(void)close(idle_fd);
+	if (pagemap_fd >= 0)
+		(void)close(pagemap_fd);
+	free(samples);
+	free(status);
+	free(nodes);
+	free(pages);
+	(void)munmap((void *)buf, memtier_bytes);
+
+	return rc;
+}
+
+const stressor_info_t stress_memtier_info = {
+	.stressor = stress_memtier,
+	.supported = stress_memtier_supported,
+	.class = CLASS_VM | CLASS_MEMORY | CLASS_OS,
+	.opts = opts,
+	.metrics_max = 7,
+	.help = help
+};
+#else
+const stressor_info_t stress_memtier_info = {
+	.stressor = stress_unimplemented,
+	.class = CLASS_VM | CLASS_MEMORY | CLASS_OS,
+	.opts = opts,
+	.help = help,
+	.unimplemented_reason = "only supported on Linux with move_pages() system call"
+};
+#endif
@@ -27,11 +27,15 @@
 #define MAX_MERGESORT_SIZE	(4 * MB)
 #define DEFAULT_MERGESORT_SIZE	(256 * KB)
 
+#define MIN_MERGESORT_THREADS	(0)
+#define MAX_MERGESORT_THREADS	(256)
+
 static const stress_help_t help[] = {
 	{ NULL,	"mergesort N",		"start N workers merge sorting 32 bit random integers" },
 	{ NULL,	"mergesort-method M",	"select sort method [ method-libc | method-nonlibc" },
 	{ NULL,	"mergesort-ops N",	"stop after N merge sort bogo operations" },
 	{ NULL,	"mergesort-size N",	"number of 32 bit integers to sort" },
+	{ NULL,	"mergesort-threads N",	"sort in parallel using a sample sort over N threads" },
 	{ NULL,	NULL,			NULL }
 };
 
@@ -216,8 +220,9 @@ static const char *stress_mergesort_method(const size_t i)
 }
 
 static const stress_opt_t opts[] = {
-	{ OPT_mergesort_size,   "mergesort-size",   TYPE_ID_UINT64, MIN_MERGESORT_SIZE, MAX_MERGESORT_SIZE, NULL },
-	{ OPT_mergesort_method, "mergesort-method", TYPE_ID_SIZE_T_METHOD, 0, 0, stress_mergesort_method },
+	{ OPT_mergesort_size,    "mergesort-size",    TYPE_ID_UINT64, MIN_MERGESORT_SIZE, MAX_MERGESORT_SIZE, NULL },
+	{ OPT_mergesort_method,  "mergesort-method",  TYPE_ID_SIZE_T_METHOD, 0, 0, stress_mergesort_method },
+	{ OPT_mergesort_threads, "mergesort-threads", TYPE_ID_UINT32, MIN_MERGESORT_THREADS, MAX_MERGESORT_THREADS, NULL },
 	END_OPT,
 };
 
@@ -238,6 +243,18 @@ static void MLOCKED_TEXT stress_mergesort_handler(int signum)
 }
 #endif
 
+static mergesort_func_t stress_mergesort_par_func;
+
+/*
+ *  stress_mergesort_par_sort()
+ *	sort a bucket of the parallel sort with the selected method
+ */
+static int stress_mergesort_par_sort(int32_t *data, const size_t n, const bool reverse)
+{
+	return stress_mergesort_par_func(data, n, sizeof(*data),
+		reverse ? stress_sort_cmp_rev_int32 : stress_sort_cmp_fwd_int32);
+}
+
 /*
  *  stress_mergesort()
  *	stress mergesort
@@ -245,6 +262,7 @@ static void MLOCKED_TEXT stress_mergesort_handler(int signum)
 static int stress_mergesort(stress_args_t *args)
 {
 	uint64_t mergesort_size = DEFAULT_MERGESORT_SIZE;
+	uint32_t mergesort_threads = 0;
 	int32_t *data, *ptr;
 	size_t n, i, mergesort_method = 0, data_size;
 	struct sigaction old_action;
@@ -255,6 +273,7 @@ static int stress_mergesort(stress_args_t *args)
 	mergesort_func_t mergesort_func;
 
 	(void)stress_get_setting("mergesort-method", &mergesort_method);
+	(void)stress_get_setting("mergesort-threads", &mergesort_threads);
 
 	mergesort_func = stress_mergesort_methods[mergesort_method].mergesort_func;
 	if (args->instance == 0)
@@ -282,6 +301,14 @@ static int stress_mergesort(stress_args_t *args)
 	(void)stress_madvise_collapse(data, data_size);
 	stress_set_vma_anon_name(data, data_size, "mergesort-data");
 
+	if (mergesort_threads > 0) {
+		stress_mergesort_par_func = mergesort_func;
+		stress_sort_data_int32_init(data, n);
+		rc = stress_sort_int32_parallel(args, data, n, mergesort_threads, stress_mergesort_par_sort);
+		(void)munmap((void *)data, data_size);
+		return rc;
+	}
+
 	ret = sigsetjmp(jmp_env, 1);
 	if (ret) {
 		/*
@@ -419,5 +446,6 @@ const stressor_info_t stress_mergesort_info = {
 	.class = CLASS_CPU_CACHE | CLASS_CPU | CLASS_MEMORY | CLASS_SORT,
 	.opts = opts,
 	.verify = VERIFY_OPTIONAL,
+	.metrics_max = 3,
 	.help = help
 };
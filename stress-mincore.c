@@ -308,6 +308,7 @@ const stressor_info_t stress_mincore_info = {
 	.class = CLASS_OS | CLASS_MEMORY,
 	.opts = opts,
 	.verify = VERIFY_ALWAYS,
+	.metrics_max = 1,
 	.help = help
 };
 #else
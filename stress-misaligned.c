@@ -62,6 +62,7 @@
 
 static const stress_help_t help[] = {
 	{ NULL,	"misaligned N",	   	"start N workers performing misaligned read/writes" },
+	{ NULL,	"misaligned-matrix",	"report ns per access for access width x offset class" },
 	{ NULL,	"misaligned-method M",	"use misaligned memory read/write method" },
 	{ NULL,	"misaligned-ops N",	"stop after N misaligned bogo operations" },
 	{ NULL,	NULL,			NULL }
@@ -86,6 +87,22 @@ typedef struct {
 
 static stress_misaligned_method_info_t *current_method;
 
+#define MISALIGNED_MATRIX_CLASSES	(4)
+#define MISALIGNED_MATRIX_RUN_NS	(10000000.0)
+
+typedef void (*stress_misaligned_matrix_func)(const uintptr_t addr, const size_t n);
+
+typedef struct {
+	const char *name;
+	const size_t size;
+	const size_t batch;
+	const stress_misaligned_matrix_func func;
+} stress_misaligned_matrix_t;
+
+static sigjmp_buf matrix_jmp_env;
+static volatile bool matrix_active = false;
+static volatile uint64_t matrix_sink;
+
 #if defined(__SSE__) &&         \
     defined(STRESS_ARCH_X86) && \
     defined(HAVE_TARGET_CLONES)
@@ -1092,6 +1109,8 @@ static MLOCKED_TEXT NORETURN void stress_misaligned_handler(int signum)
 {
 	handled_signum = signum;
 
+	if (matrix_active)
+		siglongjmp(matrix_jmp_env, STRESS_MISALIGNED_ERROR);
 	if (current_method)
 		current_method->disabled = true;
 
@@ -1130,6 +1149,210 @@ static void stress_misaligned_enable_all(void)
 	}
 }
 
+/*
+ *  matrix access kernels, each performs n accesses of the
+ *  given width at addr, the caller picks the offset class
+ */
+#define STRESS_MISALIGNED_MATRIX_RW(name, type, attr)			\
+static void attr stress_misaligned_matrix_ ## name ## rd(		\
+	const uintptr_t addr,						\
+	const size_t n)							\
+{									\
+	volatile type *ptr = (volatile type *)addr;			\
+	register type sum = 0;						\
+	register size_t i;						\
+									\
+	for (i = 0; i < n; i++)						\
+		sum += *ptr;						\
+	matrix_sink = (uint64_t)sum;					\
+}									\
+									\
+static void attr stress_misaligned_matrix_ ## name ## wr(		\
+	const uintptr_t addr,						\
+	const size_t n)							\
+{									\
+	volatile type *ptr = (volatile type *)addr;			\
+	register size_t i;						\
+									\
+	for (i = 0; i < n; i++)						\
+		*ptr = (type)i;						\
+}
+
+#define STRESS_MISALIGNED_MATRIX_ATOMIC(name, type)			\
+static void stress_misaligned_matrix_ ## name ## atomic(		\
+	const uintptr_t addr,						\
+	const size_t n)							\
+{									\
+	volatile type *ptr = (volatile type *)addr;			\
+	register size_t i;						\
+									\
+	for (i = 0; i < n; i++)						\
+		__atomic_fetch_add(ptr, 1, __ATOMIC_SEQ_CST);		\
+}
+
+STRESS_MISALIGNED_MATRIX_RW(int16, uint16_t, )
+STRESS_MISALIGNED_MATRIX_RW(int32, uint32_t, )
+STRESS_MISALIGNED_MATRIX_RW(int64, uint64_t, )
+#if defined(HAVE_INT128_T)
+STRESS_MISALIGNED_MATRIX_RW(int128, __uint128_t, TARGET_CLONE_NO_SSE)
+#endif
+#if defined(HAVE_ATOMIC_FETCH_ADD_2) &&	\
+    defined(HAVE_ATOMIC) &&		\
+    defined(__ATOMIC_SEQ_CST)
+STRESS_MISALIGNED_MATRIX_ATOMIC(int16, uint16_t)
+#endif
+#if defined(HAVE_ATOMIC_FETCH_ADD_4) &&	\
+    defined(HAVE_ATOMIC) &&		\
+    defined(__ATOMIC_SEQ_CST)
+STRESS_MISALIGNED_MATRIX_ATOMIC(int32, uint32_t)
+#endif
+#if defined(HAVE_ATOMIC_FETCH_ADD_8) &&	\
+    defined(HAVE_ATOMIC) &&		\
+    defined(__ATOMIC_SEQ_CST)
+STRESS_MISALIGNED_MATRIX_ATOMIC(int64, uint64_t)
+#endif
+
+/*
+ *  atomics that straddle a cache line are split locks, these
+ *  can be trapped and throttled by the kernel so use small batches
+ */
+static const stress_misaligned_matrix_t stress_misaligned_matrix[] = {
+	{ "int16rd",	2,	1024,	stress_misaligned_matrix_int16rd },
+	{ "int16wr",	2,	1024,	stress_misaligned_matrix_int16wr },
+#if defined(HAVE_ATOMIC_FETCH_ADD_2) &&	\
+    defined(HAVE_ATOMIC) &&		\
+    defined(__ATOMIC_SEQ_CST)
+	{ "int16atomic",2,	16,	stress_misaligned_matrix_int16atomic },
+#endif
+	{ "int32rd",	4,	1024,	stress_misaligned_matrix_int32rd },
+	{ "int32wr",	4,	1024,	stress_misaligned_matrix_int32wr },
+#if defined(HAVE_ATOMIC_FETCH_ADD_4) &&	\
+    defined(HAVE_ATOMIC) &&		\
+    defined(__ATOMIC_SEQ_CST)
+	{ "int32atomic",4,	16,	stress_misaligned_matrix_int32atomic },
+#endif
+	{ "int64rd",	8,	1024,	stress_misaligned_matrix_int64rd },
+	{ "int64wr",	8,	1024,	stress_misaligned_matrix_int64wr },
+#if defined(HAVE_ATOMIC_FETCH_ADD_8) &&	\
+    defined(HAVE_ATOMIC) &&		\
+    defined(__ATOMIC_SEQ_CST)
+	{ "int64atomic",8,	16,	stress_misaligned_matrix_int64atomic },
+#endif
+#if defined(HAVE_INT128_T)
+	{ "int128rd",	16,	1024,	stress_misaligned_matrix_int128rd },
+	{ "int128wr",	16,	1024,	stress_misaligned_matrix_int128wr },
+#endif
+};
+
+static const char * const stress_misaligned_matrix_classes[MISALIGNED_MATRIX_CLASSES] = {
+	"aligned",
+	"in-line",
+	"line-split",
+	"page-split",
+};
+
+/*
+ *  stress_misaligned_matrix_offset()
+ *	buffer offset for an access of size bytes in offset class cls,
+ *	splits straddle the boundary by half the access width
+ */
+static size_t stress_misaligned_matrix_offset(
+	const size_t cls,
+	const size_t size,
+	const size_t page_size)
+{
+	switch (cls) {
+	default:
+	case 0:
+		return 0;
+	case 1:
+		return 1;
+	case 2:
+		return 64 - (size >> 1);
+	case 3:
+		return page_size - (size >> 1);
+	}
+}
+
+/*
+ *  stress_misaligned_matrix_cell()
+ *	time accesses for one width and offset class, returns ns
+ *	per access, -1.0 if the access faulted
+ */
+static double stress_misaligned_matrix_cell(
+	const stress_misaligned_matrix_t *m,
+	const uintptr_t addr)
+{
+	double t_start, t_end;
+	volatile size_t count = 0;
+
+	handled_signum = -1;
+	matrix_active = true;
+	if (sigsetjmp(matrix_jmp_env, 1) != 0) {
+		matrix_active = false;
+		return -1.0;
+	}
+
+	/* warm the line(s) and TLB entries */
+	m->func(addr, 1);
+
+	t_start = stress_time_now();
+	do {
+		m->func(addr, m->batch);
+		count += m->batch;
+		t_end = stress_time_now();
+	} while (((t_end - t_start) * STRESS_DBL_NANOSECOND < MISALIGNED_MATRIX_RUN_NS) &&
+		 stress_continue_flag());
+	matrix_active = false;
+
+	return ((t_end - t_start) * STRESS_DBL_NANOSECOND) / (double)count;
+}
+
+/*
+ *  stress_misaligned_matrix_report()
+ *	report ns per access for each access width and method
+ *	against aligned, in-line misaligned, cache line split
+ *	and page split offsets
+ */
+static void stress_misaligned_matrix_report(
+	stress_args_t *args,
+	uint8_t *buffer,
+	const size_t page_size)
+{
+	size_t i, j;
+	char line[128];
+	int len;
+
+	pr_block_begin();
+	pr_inf("%s: misaligned access matrix, ns per access (trap = access faulted):\n",
+		args->name);
+	len = snprintf(line, sizeof(line), "%-12s", "access");
+	for (j = 0; j < MISALIGNED_MATRIX_CLASSES; j++)
+		len += snprintf(line + len, sizeof(line) - (size_t)len, " %10s",
+			stress_misaligned_matrix_classes[j]);
+	pr_inf("%s: %s\n", args->name, line);
+
+	for (i = 0; i < SIZEOF_ARRAY(stress_misaligned_matrix); i++) {
+		const stress_misaligned_matrix_t *m = &stress_misaligned_matrix[i];
+
+		len = snprintf(line, sizeof(line), "%-12s", m->name);
+		for (j = 0; j < MISALIGNED_MATRIX_CLASSES; j++) {
+			const size_t offset = stress_misaligned_matrix_offset(j, m->size, page_size);
+			double ns;
+
+			if (!stress_continue_flag())
+				break;
+			ns = stress_misaligned_matrix_cell(m, (uintptr_t)(buffer + offset));
+			if (ns < 0.0)
+				len += snprintf(line + len, sizeof(line) - (size_t)len, " %10s", "trap");
+			else
+				len += snprintf(line + len, sizeof(line) - (size_t)len, " %10.3f", ns);
+		}
+		pr_inf("%s: %s\n", args->name, line);
+	}
+	pr_block_end();
+}
+
 /*
  *  stress_misaligned_exercised()
  *	report the methods that were successfully exercised
@@ -1186,6 +1409,7 @@ static int stress_misaligned(stress_args_t *args)
 	const size_t page_size = args->page_size;
 	const size_t buffer_size = page_size << 1;
 	bool succeeded = true;
+	bool misaligned_matrix = false;
 #if defined(HAVE_TIMER_FUNCTIONALITY)
 	struct sigevent sev;
 #if defined(CLOCK_PROCESS_CPUTIME_ID)
@@ -1198,6 +1422,7 @@ static int stress_misaligned(stress_args_t *args)
 	stress_numa_mask_t *numa_mask;
 	int numa_loop;
 #endif
+	(void)stress_get_setting("misaligned-matrix", &misaligned_matrix);
 	(void)stress_get_setting("misaligned-method", &misaligned_method);
 
 	if (stress_sighandler(args->name, SIGBUS, stress_misaligned_handler, NULL) < 0)
@@ -1246,6 +1471,21 @@ static int stress_misaligned(stress_args_t *args)
 	stress_sync_start_wait(args);
 	stress_set_proc_state(args->name, STRESS_STATE_RUN);
 
+	if (misaligned_matrix && (args->instance == 0)) {
+#if defined(HAVE_TIMER_FUNCTIONALITY)
+		/* matrix cells are time bounded, disarm the method timeout */
+		if (use_timer) {
+			(void)shim_memset(&timer, 0, sizeof(timer));
+			VOID_RET(int, timer_settime(timer_id, 0, &timer, NULL));
+		}
+#endif
+		stress_misaligned_matrix_report(args, buffer, page_size);
+#if defined(HAVE_TIMER_FUNCTIONALITY)
+		if (use_timer)
+			stress_misaligned_reset_timer();
+#endif
+	}
+
 	method = &stress_misaligned_methods[misaligned_method];
 	current_method = method;
 	ret = sigsetjmp(jmp_env, 1);
@@ -1334,6 +1574,7 @@ static const char *stress_misaligned_method(const size_t i)
 }
 
 static const stress_opt_t opts[] = {
+	{ OPT_misaligned_matrix, "misaligned-matrix", TYPE_ID_BOOL, 0, 1, NULL },
 	{ OPT_misaligned_method, "misaligned-method", TYPE_ID_SIZE_T_METHOD, 0, 0, stress_misaligned_method },
 	END_OPT,
 };
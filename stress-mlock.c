@@ -18,13 +18,39 @@
  *
  */
 #include "stress-ng.h"
+#include "core-builtin.h"
+#include "core-capabilities.h"
 #include "core-madvise.h"
 #include "core-out-of-memory.h"
 
+#define MIN_MLOCK_BYTES		(1 * MB)
+#define MAX_MLOCK_BYTES		(MAX_MEM_LIMIT)
+
 static const stress_help_t help[] = {
-	{ NULL,	"mlock N",	"start N workers exercising mlock/munlock" },
-	{ NULL,	"mlock-ops N",	"stop after N mlock bogo operations" },
-	{ NULL,	NULL,		NULL }
+	{ NULL,	"mlock N",		"start N workers exercising mlock/munlock" },
+	{ NULL,	"mlock-bytes N",	"benchmark locking regions from 1MB up to N bytes" },
+	{ NULL,	"mlock-method M",	"select mlock benchmark method [ all | hugetlb | mlock | mlock2-onfault | mlockall ]" },
+	{ NULL,	"mlock-ops N",		"stop after N mlock bogo operations" },
+	{ NULL,	NULL,			NULL }
+};
+
+static const char * const mlock_methods[] = {
+	"all",
+	"hugetlb",
+	"mlock",
+	"mlock2-onfault",
+	"mlockall",
+};
+
+static const char *stress_mlock_method(const size_t i)
+{
+	return (i < SIZEOF_ARRAY(mlock_methods)) ? mlock_methods[i] : NULL;
+}
+
+static const stress_opt_t opts[] = {
+	{ OPT_mlock_bytes,  "mlock-bytes",  TYPE_ID_SIZE_T_BYTES_VM, MIN_MLOCK_BYTES, MAX_MLOCK_BYTES, NULL },
+	{ OPT_mlock_method, "mlock-method", TYPE_ID_SIZE_T_METHOD, 0, 0, stress_mlock_method },
+	END_OPT,
 };
 
 #if defined(_POSIX_MEMLOCK_RANGE) &&	\
@@ -290,6 +316,390 @@ static void stress_mlock_misc(stress_args_t *args, const size_t page_size, const
 #endif
 }
 
+#define MLOCK_BENCH_SIZES	(16)
+
+enum {
+	STRESS_MLOCK_BENCH_OK = 0,		/* region locked and unlocked */
+	STRESS_MLOCK_BENCH_UNSUPPORTED,		/* method not supported */
+	STRESS_MLOCK_BENCH_NO_RESOURCE,		/* size too large to lock */
+	STRESS_MLOCK_BENCH_FAILED,		/* unexpected failure */
+};
+
+typedef int (*stress_mlock_bench_func_t)(stress_args_t *args, const size_t len,
+	double *lock_time, double *unlock_time);
+
+/*
+ *  stress_mlock_bench_errno()
+ *	map a failed lock errno to a bench result
+ */
+static int stress_mlock_bench_errno(const int err)
+{
+	switch (err) {
+	case ENOSYS:
+	case EINVAL:
+		return STRESS_MLOCK_BENCH_UNSUPPORTED;
+	case ENOMEM:
+	case EAGAIN:
+	case EPERM:
+		return STRESS_MLOCK_BENCH_NO_RESOURCE;
+	default:
+		return STRESS_MLOCK_BENCH_FAILED;
+	}
+}
+
+/*
+ *  stress_mlock_bench_check()
+ *	check at least len bytes are now accounted as mlocked
+ */
+static int stress_mlock_bench_check(stress_args_t *args, const char *method, const size_t len)
+{
+#if defined(__linux__)
+	const uint64_t pages = stress_mlock_pages(args->page_size);
+
+	/* VmLck of zero means it could not be read */
+	if ((pages > 0) && (pages < (uint64_t)(len / args->page_size))) {
+		pr_fail("%s: %s locked %" PRIu64 " pages, expected at least %zu pages\n",
+			args->name, method, pages, len / args->page_size);
+		return STRESS_MLOCK_BENCH_FAILED;
+	}
+#else
+	(void)args;
+	(void)method;
+	(void)len;
+#endif
+	return STRESS_MLOCK_BENCH_OK;
+}
+
+/*
+ *  stress_mlock_bench_mmap()
+ *	map an anonymous region, not populated
+ */
+static uint8_t *stress_mlock_bench_mmap(const size_t len, const int flags)
+{
+	uint8_t *buf;
+
+	buf = (uint8_t *)mmap(NULL, len, PROT_READ | PROT_WRITE,
+		MAP_PRIVATE | MAP_ANONYMOUS | flags, -1, 0);
+	if (buf != MAP_FAILED)
+		stress_set_vma_anon_name(buf, len, "mlock-bench");
+	return buf;
+}
+
+/*
+ *  stress_mlock_bench_mlock()
+ *	mlock faults in and locks the whole region
+ */
+static int stress_mlock_bench_mlock(
+	stress_args_t *args,
+	const size_t len,
+	double *lock_time,
+	double *unlock_time)
+{
+	uint8_t *buf;
+	double t;
+	int ret;
+
+	buf = stress_mlock_bench_mmap(len, 0);
+	if (buf == MAP_FAILED)
+		return STRESS_MLOCK_BENCH_NO_RESOURCE;
+	t = stress_time_now();
+	if (shim_mlock(buf, len) < 0) {
+		ret = stress_mlock_bench_errno(errno);
+		(void)munmap((void *)buf, len);
+		return ret;
+	}
+	*lock_time = stress_time_now() - t;
+	ret = stress_mlock_bench_check(args, "mlock", len);
+
+	t = stress_time_now();
+	(void)shim_munlock(buf, len);
+	*unlock_time = stress_time_now() - t;
+	(void)munmap((void *)buf, len);
+	return ret;
+}
+
+#if defined(HAVE_MLOCK2)
+/*
+ *  stress_mlock_bench_mlock2_onfault()
+ *	mlock2 MLOCK_ONFAULT only locks pages as they are faulted
+ *	in, so touch each page to lock the whole region
+ */
+static int stress_mlock_bench_mlock2_onfault(
+	stress_args_t *args,
+	const size_t len,
+	double *lock_time,
+	double *unlock_time)
+{
+	const size_t page_size = args->page_size;
+	uint8_t *buf;
+	volatile uint8_t *ptr;
+	const uint8_t *end;
+	double t;
+	int ret;
+
+	buf = stress_mlock_bench_mmap(len, 0);
+	if (buf == MAP_FAILED)
+		return STRESS_MLOCK_BENCH_NO_RESOURCE;
+	end = buf + len;
+	t = stress_time_now();
+	if (shim_mlock2(buf, len, MLOCK_ONFAULT) < 0) {
+		ret = stress_mlock_bench_errno(errno);
+		(void)munmap((void *)buf, len);
+		return ret;
+	}
+	for (ptr = buf; ptr < end; ptr += page_size)
+		*ptr = 1;
+	*lock_time = stress_time_now() - t;
+	ret = stress_mlock_bench_check(args, "mlock2-onfault", len);
+
+	t = stress_time_now();
+	(void)shim_munlock(buf, len);
+	*unlock_time = stress_time_now() - t;
+	(void)munmap((void *)buf, len);
+	return ret;
+}
+#endif
+
+#if defined(HAVE_MLOCKALL) &&	\
+    defined(HAVE_MUNLOCKALL) &&	\
+    defined(MCL_CURRENT) &&	\
+    defined(MCL_FUTURE)
+/*
+ *  stress_mlock_bench_mlockall()
+ *	mlockall MCL_CURRENT | MCL_FUTURE then map the region, the
+ *	mapping is populated and locked by mmap. This includes the
+ *	cost of locking all the existing mappings of the process
+ */
+static int stress_mlock_bench_mlockall(
+	stress_args_t *args,
+	const size_t len,
+	double *lock_time,
+	double *unlock_time)
+{
+	uint8_t *buf;
+	double t;
+	int ret;
+
+	t = stress_time_now();
+	if (shim_mlockall(MCL_CURRENT | MCL_FUTURE) < 0) {
+		ret = stress_mlock_bench_errno(errno);
+		(void)shim_munlockall();
+		return ret;
+	}
+	buf = stress_mlock_bench_mmap(len, 0);
+	if (buf == MAP_FAILED) {
+		(void)shim_munlockall();
+		return STRESS_MLOCK_BENCH_NO_RESOURCE;
+	}
+	*lock_time = stress_time_now() - t;
+	ret = stress_mlock_bench_check(args, "mlockall", len);
+
+	t = stress_time_now();
+	(void)shim_munlockall();
+	*unlock_time = stress_time_now() - t;
+	(void)munmap((void *)buf, len);
+	return ret;
+}
+#endif
+
+#if defined(MAP_HUGETLB)
+/*
+ *  stress_mlock_bench_hugetlb()
+ *	mlock a hugetlb backed region, needs huge pages to be
+ *	reserved, e.g. via /proc/sys/vm/nr_hugepages
+ */
+static int stress_mlock_bench_hugetlb(
+	stress_args_t *args,
+	const size_t len,
+	double *lock_time,
+	double *unlock_time)
+{
+	uint8_t *buf;
+	double t;
+	int ret;
+
+	buf = stress_mlock_bench_mmap(len, MAP_HUGETLB);
+	if (buf == MAP_FAILED)
+		return STRESS_MLOCK_BENCH_NO_RESOURCE;
+	t = stress_time_now();
+	if (shim_mlock(buf, len) < 0) {
+		ret = stress_mlock_bench_errno(errno);
+		(void)munmap((void *)buf, len);
+		return ret;
+	}
+	*lock_time = stress_time_now() - t;
+	(void)args;
+
+	t = stress_time_now();
+	(void)shim_munlock(buf, len);
+	*unlock_time = stress_time_now() - t;
+	(void)munmap((void *)buf, len);
+	return STRESS_MLOCK_BENCH_OK;
+}
+#endif
+
+/* same order as mlock_methods[], NULL if not available */
+static const stress_mlock_bench_func_t stress_mlock_bench_funcs[] = {
+	NULL,					/* all */
+#if defined(MAP_HUGETLB)
+	stress_mlock_bench_hugetlb,
+#else
+	NULL,
+#endif
+	stress_mlock_bench_mlock,
+#if defined(HAVE_MLOCK2)
+	stress_mlock_bench_mlock2_onfault,
+#else
+	NULL,
+#endif
+#if defined(HAVE_MLOCKALL) &&	\
+    defined(HAVE_MUNLOCKALL) &&	\
+    defined(MCL_CURRENT) &&	\
+    defined(MCL_FUTURE)
+	stress_mlock_bench_mlockall,
+#else
+	NULL,
+#endif
+};
+
+#define MLOCK_METHODS_MAX	(SIZEOF_ARRAY(stress_mlock_bench_funcs))
+
+typedef struct {
+	double bytes;		/* bytes locked */
+	double lock_time;	/* total lock time */
+	double unlock_time;	/* total unlock time */
+} stress_mlock_bench_t;
+
+/*
+ *  stress_mlock_bench()
+ *	lock and unlock regions from 1MB to mlock_bytes in size
+ *	in x4 steps, report GB/s locked and munlocked for the
+ *	largest size each method could lock
+ */
+static int stress_mlock_bench(stress_args_t *args, size_t mlock_bytes)
+{
+	static stress_mlock_bench_t bench[MLOCK_METHODS_MAX][MLOCK_BENCH_SIZES];
+	size_t sizes[MLOCK_BENCH_SIZES];
+	size_t limit[MLOCK_METHODS_MAX];
+	size_t mlock_method = 0;
+	size_t i, j, nsizes, freemem, totalmem, freeswap, totalswap, shmall;
+	bool unsupported[MLOCK_METHODS_MAX];
+	int rc = EXIT_SUCCESS, idx = 0;
+#if defined(RLIMIT_MEMLOCK)
+	struct rlimit rlim;
+#endif
+
+	(void)stress_get_setting("mlock-method", &mlock_method);
+
+	/* keep the regions within free memory and the lock limit if not privileged */
+	stress_get_memlimits(&shmall, &freemem, &totalmem, &freeswap, &totalswap);
+	if ((freemem > 0) && (mlock_bytes > freemem / (2 * args->instances)))
+		mlock_bytes = freemem / (2 * args->instances);
+#if defined(RLIMIT_MEMLOCK)
+	if (!stress_check_capability(SHIM_CAP_IPC_LOCK) &&
+	    (getrlimit(RLIMIT_MEMLOCK, &rlim) == 0) &&
+	    (rlim.rlim_cur != RLIM_INFINITY) &&
+	    (mlock_bytes > (size_t)rlim.rlim_cur))
+		mlock_bytes = (size_t)rlim.rlim_cur;
+#endif
+	mlock_bytes &= ~(size_t)(2 * MB - 1);
+	if (mlock_bytes < MIN_MLOCK_BYTES) {
+		if (args->instance == 0)
+			pr_inf_skip("%s: cannot lock at least %zu bytes, "
+				"skipping stressor\n", args->name, (size_t)MIN_MLOCK_BYTES);
+		return EXIT_NO_RESOURCE;
+	}
+	for (nsizes = 0, i = MIN_MLOCK_BYTES; (i < mlock_bytes) && (nsizes < MLOCK_BENCH_SIZES - 1); i *= 4)
+		sizes[nsizes++] = i;
+	sizes[nsizes++] = mlock_bytes;
+
+	for (i = 0; i < MLOCK_METHODS_MAX; i++) {
+		unsupported[i] = (stress_mlock_bench_funcs[i] == NULL);
+		limit[i] = unsupported[i] ? 0 : nsizes;
+	}
+	(void)shim_memset(bench, 0, sizeof(bench));
+
+	stress_set_proc_state(args->name, STRESS_STATE_SYNC_WAIT);
+	stress_sync_start_wait(args);
+	stress_set_proc_state(args->name, STRESS_STATE_RUN);
+
+	do {
+		for (i = 1; i < MLOCK_METHODS_MAX; i++) {
+			if ((mlock_method != 0) && (mlock_method != i))
+				continue;
+			for (j = 0; j < limit[i]; j++) {
+				double lock_time = 0.0, unlock_time = 0.0;
+				int ret;
+
+				if (UNLIKELY(!stress_continue(args)))
+					goto finish;
+				ret = stress_mlock_bench_funcs[i](args, sizes[j], &lock_time, &unlock_time);
+				switch (ret) {
+				case STRESS_MLOCK_BENCH_OK:
+					bench[i][j].bytes += (double)sizes[j];
+					bench[i][j].lock_time += lock_time;
+					bench[i][j].unlock_time += unlock_time;
+					stress_bogo_inc(args);
+					break;
+				case STRESS_MLOCK_BENCH_UNSUPPORTED:
+					unsupported[i] = true;
+					limit[i] = 0;
+					break;
+				case STRESS_MLOCK_BENCH_NO_RESOURCE:
+					/* don't try this size or larger again */
+					limit[i] = j;
+					break;
+				default:
+					rc = EXIT_FAILURE;
+					goto finish;
+				}
+			}
+		}
+	} while (stress_continue(args));
+
+finish:
+	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
+
+	for (i = 1; i < MLOCK_METHODS_MAX; i++) {
+		const char *name = mlock_methods[i];
+		const stress_mlock_bench_t *largest = NULL;
+		char buf[64];
+
+		if ((mlock_method != 0) && (mlock_method != i))
+			continue;
+		for (j = 0; j < nsizes; j++) {
+			const stress_mlock_bench_t *b = &bench[i][j];
+			char size[32];
+
+			if ((b->lock_time <= 0.0) || (b->unlock_time <= 0.0))
+				continue;
+			largest = b;
+			if (args->instance == 0)
+				pr_dbg("%s: %-14.14s %6s %10.3f GB/s mlocked %10.3f GB/s munlocked\n",
+					args->name, name,
+					stress_uint64_to_str(size, sizeof(size), (uint64_t)sizes[j]),
+					(b->bytes / b->lock_time) / (double)GB,
+					(b->bytes / b->unlock_time) / (double)GB);
+		}
+		if (!largest) {
+			if (args->instance == 0)
+				pr_dbg("%s: %s %s\n", args->name, name,
+					unsupported[i] ? "not supported" :
+					"could not lock any regions");
+			continue;
+		}
+		(void)snprintf(buf, sizeof(buf), "GB per sec mlocked, %s", name);
+		stress_metrics_set(args, idx++, buf,
+			(largest->bytes / largest->lock_time) / (double)GB,
+			STRESS_METRIC_HARMONIC_MEAN);
+		(void)snprintf(buf, sizeof(buf), "GB per sec munlocked, %s", name);
+		stress_metrics_set(args, idx++, buf,
+			(largest->bytes / largest->unlock_time) / (double)GB,
+			STRESS_METRIC_HARMONIC_MEAN);
+	}
+	return rc;
+}
+
 static int stress_mlock_child(stress_args_t *args, void *context)
 {
 	size_t i, n;
@@ -307,11 +717,15 @@ static int stress_mlock_child(stress_args_t *args, void *context)
 #endif
 	const size_t mappings_per_page = page_size / sizeof(*mappings);
 	const bool oom_avoid = !!(g_opt_flags & OPT_FLAGS_OOM_AVOID);
-
-	stress_get_memlimits(&shmall, &freemem, &totalmem, &freeswap, &totalswap);
+	size_t mlock_bytes;
 
 	(void)context;
 
+	if (stress_get_setting("mlock-bytes", &mlock_bytes))
+		return stress_mlock_bench(args, mlock_bytes);
+
+	stress_get_memlimits(&shmall, &freemem, &totalmem, &freeswap, &totalswap);
+
 	/*
 	 *  In low-memory scenarios we should check if we should
 	 *  keep stressing before attempting a calloc that can
@@ -520,13 +934,16 @@ static int stress_mlock(stress_args_t *args)
 const stressor_info_t stress_mlock_info = {
 	.stressor = stress_mlock,
 	.class = CLASS_VM | CLASS_OS,
+	.opts = opts,
 	.verify = VERIFY_ALWAYS,
+	.metrics_max = 2 * MLOCK_METHODS_MAX,
 	.help = help
 };
 #else
 const stressor_info_t stress_mlock_info = {
 	.stressor = stress_unimplemented,
 	.class = CLASS_VM | CLASS_OS,
+	.opts = opts,
 	.verify = VERIFY_ALWAYS,
 	.help = help,
 	.unimplemented_reason = "built without mlock() support or _POSIX_MEMLOCK_RANGE defined"
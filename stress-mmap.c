@@ -21,6 +21,7 @@
 
 #include "core-arch.h"
 #include "core-builtin.h"
+#include "core-latency.h"
 #include "core-madvise.h"
 #include "core-mincore.h"
 #include "core-mmap.h"
@@ -464,9 +465,14 @@ static int stress_mmap_child(stress_args_t *args, void *ctxt)
 	NOCLOBBER int mask = ~0;
 	static const char mmap_name[] = "stress-mmap";
 	NOCLOBBER int rc = EXIT_SUCCESS;
+	const bool fault_latency = stress_latency_enabled(args);
+	stress_latency_fault_t fault;
 
 	VOID_RET(int, stress_sighandler(args->name, SIGBUS, stress_mmap_sighandler, NULL));
 
+	if (fault_latency)
+		stress_latency_fault_init(args, &fault);
+
 	mapped = (uint8_t *)mmap(NULL, pages * sizeof(*mapped),
 				PROT_READ | PROT_WRITE,
 				MAP_ANONYMOUS | MAP_PRIVATE, -1, 0);
@@ -591,6 +597,8 @@ retry:
 		if (context->mmap_mlock)
 			(void)shim_mlock(buf, sz);
 		no_mem_retries = 0;
+		if (fault_latency)
+			stress_latency_fault_touch_pages(args, &fault, buf, sz, page_size);
 		if (mmap_file) {
 			(void)shim_memset(buf, 0xff, sz);
 			(void)shim_msync((void *)buf, sz, ms_flags);
@@ -930,7 +938,9 @@ static int stress_mmap(stress_args_t *args)
 	context.mmap_numa = false;
 	context.flags = MAP_PRIVATE | MAP_ANONYMOUS;
 #if defined(MAP_POPULATE)
-	context.flags |= MAP_POPULATE;
+	/* first touch fault latencies need the pages to be faulted in on touch */
+	if (!stress_latency_enabled(args))
+		context.flags |= MAP_POPULATE;
 #endif
 #if defined(HAVE_LINUX_MEMPOLICY_H)
 	context.numa_mask = NULL;
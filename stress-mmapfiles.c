@@ -21,17 +21,49 @@
 #include "core-out-of-memory.h"
 #include "core-put.h"
 
+#if defined(HAVE_SYS_RESOURCE_H)
+#include <sys/resource.h>
+#endif
+
 static const stress_help_t help[] = {
 	{ NULL,	"mmapfiles N",		"start N workers stressing many mmaps and munmaps" },
 	{ NULL, "mmapfiles-numa",	"bind memory mappings to randomly selected NUMA nodes" },
 	{ NULL,	"mmapfiles-ops N",	"stop after N mmapfiles bogo operations" },
 	{ NULL, "mmapfiles-populate",	"populate memory mappings" },
+	{ NULL, "mmapfiles-scan",	"compare read() and mmap page cache data scan throughput" },
+	{ NULL, "mmapfiles-scan-bytes N", "size of the file set to scan (default 256MB)" },
 	{ NULL, "mmapfiles-shared",	"enable shared mappings instead of private mappings" },
 	{ NULL,	NULL,		  	NULL }
 };
 
 #define MMAP_MAX	(512 * 1024)
 
+#define MIN_MMAPFILES_SCAN_BYTES	(16 * MB)
+#define MAX_MMAPFILES_SCAN_BYTES	(MAX_FILE_LIMIT)
+#define DEFAULT_MMAPFILES_SCAN_BYTES	(256 * MB)
+
+#define MMAPFILES_SCAN_FILES		(16)		/* files in the scan file set */
+#define MMAPFILES_SCAN_BUF		(128 * KB)	/* read() buffer size */
+
+#define MMAPFILES_SCAN_READ		(0)
+#define MMAPFILES_SCAN_POPULATE		(1)
+#define MMAPFILES_SCAN_SEQUENTIAL	(2)
+#define MMAPFILES_SCAN_FAULTAROUND	(3)
+#define MMAPFILES_SCAN_METHODS		(4)
+
+static const char * const stress_mmapfiles_scan_names[MMAPFILES_SCAN_METHODS] = {
+	"read",
+	"mmap-populate",
+	"mmap-sequential",
+	"mmap-faultaround",
+};
+
+typedef struct {
+	double bytes;			/* bytes scanned */
+	double duration;		/* time scanning */
+	double faults;			/* minor + major page faults */
+} stress_mmapfiles_scan_t;
+
 typedef struct {
 	void *addr;
 	size_t len;
@@ -47,7 +79,11 @@ typedef struct {
 	bool mmapfiles_numa;
 	bool mmapfiles_populate;
 	bool mmapfiles_shared;
+	bool mmapfiles_scan;
 	bool enomem;
+	size_t scan_file_size;		/* size of each scan file */
+	char scan_dir[PATH_MAX];	/* scan file set directory */
+	stress_mmapfiles_scan_t scan[MMAPFILES_SCAN_METHODS];
 	stress_mapping_t *mappings;
 #if defined(HAVE_LINUX_MEMPOLICY_H)
 	stress_numa_mask_t *numa_mask;
@@ -57,6 +93,8 @@ typedef struct {
 static const stress_opt_t opts[] = {
 	{ OPT_mmapfiles_numa,     "mmapfiles-numa",     TYPE_ID_BOOL, 0, 1, NULL },
 	{ OPT_mmapfiles_populate, "mmapfiles-populate", TYPE_ID_BOOL, 0, 1, NULL },
+	{ OPT_mmapfiles_scan,     "mmapfiles-scan",     TYPE_ID_BOOL, 0, 1, NULL },
+	{ OPT_mmapfiles_scan_bytes, "mmapfiles-scan-bytes", TYPE_ID_UINT64_BYTES_FS, MIN_MMAPFILES_SCAN_BYTES, MAX_MMAPFILES_SCAN_BYTES, NULL },
 	{ OPT_mmapfiles_shared,   "mmapfiles-shared",   TYPE_ID_BOOL, 0, 1, NULL },
 	END_OPT,
 };
@@ -157,6 +195,240 @@ static size_t stress_mmapfiles_dir(
 	return n_mappings;
 }
 
+/*
+ *  stress_mmapfiles_scan_filename()
+ *	name of scan file i
+ */
+static inline void stress_mmapfiles_scan_filename(
+	const stress_mmapfile_info_t *mmapfile_info,
+	char *filename,
+	const size_t len,
+	const size_t i)
+{
+	(void)snprintf(filename, len, "%s/scan-%zu", mmapfile_info->scan_dir, i);
+}
+
+/*
+ *  stress_mmapfiles_faults()
+ *	number of minor and major page faults of this process
+ */
+static double stress_mmapfiles_faults(void)
+{
+#if defined(HAVE_GETRUSAGE) &&	\
+    defined(RUSAGE_SELF)
+	struct rusage usage;
+
+	if (shim_getrusage(RUSAGE_SELF, &usage) == 0)
+		return (double)usage.ru_minflt + (double)usage.ru_majflt;
+#endif
+	return 0.0;
+}
+
+/*
+ *  stress_mmapfiles_sum()
+ *	sum the data, touches every cache line of the data
+ */
+static uint64_t OPTIMIZE3 stress_mmapfiles_sum(const uint64_t *data, const size_t len)
+{
+	register const uint64_t *ptr = data;
+	const uint64_t *end = data + (len / sizeof(*data));
+	register uint64_t sum = 0;
+
+	while (ptr < end) {
+		sum += ptr[0] + ptr[1] + ptr[2] + ptr[3] +
+		       ptr[4] + ptr[5] + ptr[6] + ptr[7];
+		ptr += 8;
+	}
+	return sum;
+}
+
+/*
+ *  stress_mmapfiles_scan_file()
+ *	scan the whole of file fd using the given method,
+ *	returns bytes scanned or -1 on error
+ */
+static ssize_t stress_mmapfiles_scan_file(
+	stress_args_t *args,
+	const size_t method,
+	const int fd,
+	const size_t len,
+	uint64_t *buf,
+	uint64_t *sum)
+{
+	uint8_t *ptr;
+	int flags = MAP_SHARED;
+	size_t off;
+
+	if (method == MMAPFILES_SCAN_READ) {
+		for (off = 0; off < len; ) {
+			const ssize_t ret = pread(fd, buf, MMAPFILES_SCAN_BUF, (off_t)off);
+
+			if (UNLIKELY(ret <= 0)) {
+				if ((ret < 0) && (errno == EINTR))
+					break;
+				return (ret == 0) ? (ssize_t)off : -1;
+			}
+			*sum += stress_mmapfiles_sum(buf, (size_t)ret);
+			off += (size_t)ret;
+		}
+		return (ssize_t)off;
+	}
+
+#if defined(MAP_POPULATE)
+	if (method == MMAPFILES_SCAN_POPULATE)
+		flags |= MAP_POPULATE;
+#endif
+	ptr = (uint8_t *)mmap(NULL, len, PROT_READ, flags, fd, 0);
+	if (UNLIKELY(ptr == MAP_FAILED)) {
+		pr_fail("%s: mmap of %zu bytes failed, errno=%d (%s)\n",
+			args->name, len, errno, strerror(errno));
+		return -1;
+	}
+#if defined(HAVE_MADVISE)
+	if (method == MMAPFILES_SCAN_SEQUENTIAL) {
+#if defined(MADV_SEQUENTIAL)
+		(void)madvise((void *)ptr, len, MADV_SEQUENTIAL);
+#endif
+#if defined(MADV_WILLNEED)
+		(void)madvise((void *)ptr, len, MADV_WILLNEED);
+#endif
+	}
+#endif
+	/* mmap-faultaround relies on the kernel mapping pages around each fault */
+	*sum += stress_mmapfiles_sum((uint64_t *)ptr, len);
+	(void)munmap((void *)ptr, len);
+	return (ssize_t)len;
+}
+
+/*
+ *  stress_mmapfiles_scan_create()
+ *	create the page cache resident scan file set, returns 0 on success
+ */
+static int stress_mmapfiles_scan_create(stress_args_t *args, stress_mmapfile_info_t *mmapfile_info)
+{
+	uint8_t *buf;
+	size_t i;
+
+	buf = (uint8_t *)malloc(MMAPFILES_SCAN_BUF);
+	if (!buf) {
+		pr_inf_skip("%s: cannot allocate %zu byte buffer, skipping stressor\n",
+			args->name, (size_t)MMAPFILES_SCAN_BUF);
+		return -1;
+	}
+	stress_rndbuf(buf, MMAPFILES_SCAN_BUF);
+
+	for (i = 0; i < MMAPFILES_SCAN_FILES; i++) {
+		char filename[PATH_MAX + 32];
+		size_t off;
+		int fd;
+
+		stress_mmapfiles_scan_filename(mmapfile_info, filename, sizeof(filename), i);
+		fd = open(filename, O_CREAT | O_RDWR | O_TRUNC, S_IRUSR | S_IWUSR);
+		if (fd < 0) {
+			pr_inf_skip("%s: cannot create scan file %s, errno=%d (%s), skipping stressor\n",
+				args->name, filename, errno, strerror(errno));
+			free(buf);
+			return -1;
+		}
+		for (off = 0; off < mmapfile_info->scan_file_size; off += MMAPFILES_SCAN_BUF) {
+			if (pwrite(fd, buf, MMAPFILES_SCAN_BUF, (off_t)off) != MMAPFILES_SCAN_BUF) {
+				pr_inf_skip("%s: cannot write scan file %s, errno=%d (%s), skipping stressor\n",
+					args->name, filename, errno, strerror(errno));
+				(void)close(fd);
+				free(buf);
+				return -1;
+			}
+			if (UNLIKELY(!stress_continue_flag()))
+				break;
+		}
+		(void)close(fd);
+	}
+	free(buf);
+	return 0;
+}
+
+/*
+ *  stress_mmapfiles_scan_remove()
+ *	remove the scan file set
+ */
+static void stress_mmapfiles_scan_remove(stress_mmapfile_info_t *mmapfile_info)
+{
+	size_t i;
+
+	for (i = 0; i < MMAPFILES_SCAN_FILES; i++) {
+		char filename[PATH_MAX + 32];
+
+		stress_mmapfiles_scan_filename(mmapfile_info, filename, sizeof(filename), i);
+		(void)shim_unlink(filename);
+	}
+}
+
+/*
+ *  stress_mmapfiles_scan_child()
+ *	scan the file set with each method in turn, one bogo-op per
+ *	whole file set scan
+ */
+static int stress_mmapfiles_scan_child(stress_args_t *args, stress_mmapfile_info_t *mmapfile_info)
+{
+	uint64_t *buf, sum = 0;
+	size_t method = 0;
+	int rc = EXIT_SUCCESS;
+
+	buf = (uint64_t *)stress_mmap_populate(NULL, MMAPFILES_SCAN_BUF,
+			PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (buf == MAP_FAILED) {
+		pr_inf_skip("%s: cannot mmap %zu byte read buffer, skipping stressor\n",
+			args->name, (size_t)MMAPFILES_SCAN_BUF);
+		return EXIT_NO_RESOURCE;
+	}
+	stress_set_vma_anon_name(buf, MMAPFILES_SCAN_BUF, "read-buffer");
+
+	stress_set_proc_state(args->name, STRESS_STATE_SYNC_WAIT);
+	stress_sync_start_wait(args);
+	stress_set_proc_state(args->name, STRESS_STATE_RUN);
+
+	do {
+		stress_mmapfiles_scan_t *scan = &mmapfile_info->scan[method];
+		size_t i;
+
+		for (i = 0; LIKELY((i < MMAPFILES_SCAN_FILES) && stress_continue_flag()); i++) {
+			char filename[PATH_MAX + 32];
+			double t, faults;
+			ssize_t n;
+			int fd;
+
+			stress_mmapfiles_scan_filename(mmapfile_info, filename, sizeof(filename), i);
+			fd = open(filename, O_RDONLY);
+			if (UNLIKELY(fd < 0)) {
+				pr_fail("%s: open %s failed, errno=%d (%s)\n",
+					args->name, filename, errno, strerror(errno));
+				rc = EXIT_FAILURE;
+				goto done;
+			}
+			faults = stress_mmapfiles_faults();
+			t = stress_time_now();
+			n = stress_mmapfiles_scan_file(args, method, fd,
+				mmapfile_info->scan_file_size, buf, &sum);
+			scan->duration += stress_time_now() - t;
+			scan->faults += stress_mmapfiles_faults() - faults;
+			(void)close(fd);
+			if (UNLIKELY(n < 0)) {
+				rc = EXIT_FAILURE;
+				goto done;
+			}
+			scan->bytes += (double)n;
+		}
+		stress_bogo_inc(args);
+		method = (method + 1) % MMAPFILES_SCAN_METHODS;
+	} while (stress_continue(args));
+done:
+	stress_uint64_put(sum);
+	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
+	(void)munmap((void *)buf, MMAPFILES_SCAN_BUF);
+
+	return rc;
+}
+
 static int stress_mmapfiles_child(stress_args_t *args, void *context)
 {
 	size_t idx = 0;
@@ -175,6 +447,9 @@ static int stress_mmapfiles_child(stress_args_t *args, void *context)
 		"/proc",
 	};
 
+	if (mmapfile_info->mmapfiles_scan)
+		return stress_mmapfiles_scan_child(args, mmapfile_info);
+
 	mmapfile_info->mappings = (stress_mapping_t *)calloc((size_t)MMAP_MAX, sizeof(*mmapfile_info->mappings));
 	if (UNLIKELY(!mmapfile_info->mappings)) {
 		pr_fail("%s: malloc failed, out of memory\n", args->name);
@@ -233,6 +508,7 @@ static int stress_mmapfiles(stress_args_t *args)
 	stress_mmapfile_info_t *mmapfile_info;
 	int ret;
 	double metric;
+	uint64_t mmapfiles_scan_bytes = DEFAULT_MMAPFILES_SCAN_BYTES;
 
 	mmapfile_info = (stress_mmapfile_info_t *)stress_mmap_populate(NULL, sizeof(*mmapfile_info),
 				PROT_READ | PROT_WRITE,
@@ -254,6 +530,7 @@ static int stress_mmapfiles(stress_args_t *args)
 	mmapfile_info->mmapfiles_numa = false;
 	mmapfile_info->mmapfiles_populate = false;
 	mmapfile_info->mmapfiles_shared = false;
+	mmapfile_info->mmapfiles_scan = false;
 	mmapfile_info->mappings = NULL;
 #if defined(HAVE_LINUX_MEMPOLICY_H)
 	mmapfile_info->numa_mask = NULL;
@@ -262,6 +539,56 @@ static int stress_mmapfiles(stress_args_t *args)
 	(void)stress_get_setting("mmapfiles-numa", &mmapfile_info->mmapfiles_numa);
 	(void)stress_get_setting("mmapfiles-populate", &mmapfile_info->mmapfiles_populate);
 	(void)stress_get_setting("mmapfiles-shared", &mmapfile_info->mmapfiles_shared);
+	(void)stress_get_setting("mmapfiles-scan", &mmapfile_info->mmapfiles_scan);
+	if (!stress_get_setting("mmapfiles-scan-bytes", &mmapfiles_scan_bytes)) {
+		if (g_opt_flags & OPT_FLAGS_MAXIMIZE)
+			mmapfiles_scan_bytes = MAXIMIZED_FILE_SIZE;
+		if (g_opt_flags & OPT_FLAGS_MINIMIZE)
+			mmapfiles_scan_bytes = MIN_MMAPFILES_SCAN_BYTES;
+	}
+
+	if (mmapfile_info->mmapfiles_scan) {
+		size_t i;
+		double gb_per_sec, faults;
+
+		mmapfiles_scan_bytes /= args->instances;
+		if (mmapfiles_scan_bytes < MIN_MMAPFILES_SCAN_BYTES)
+			mmapfiles_scan_bytes = MIN_MMAPFILES_SCAN_BYTES;
+		/* whole read buffers per file */
+		mmapfile_info->scan_file_size = (size_t)(mmapfiles_scan_bytes / MMAPFILES_SCAN_FILES) &
+			~((size_t)MMAPFILES_SCAN_BUF - 1);
+
+		ret = stress_temp_dir_mk_args(args);
+		if (ret < 0) {
+			(void)munmap((void *)mmapfile_info, sizeof(*mmapfile_info));
+			return stress_exit_status(-ret);
+		}
+		(void)stress_temp_dir_args(args, mmapfile_info->scan_dir, sizeof(mmapfile_info->scan_dir));
+		if (stress_mmapfiles_scan_create(args, mmapfile_info) < 0) {
+			ret = EXIT_NO_RESOURCE;
+		} else {
+			ret = stress_oomable_child(args, (void *)mmapfile_info,
+				stress_mmapfiles_child, STRESS_OOMABLE_NORMAL);
+		}
+		stress_mmapfiles_scan_remove(mmapfile_info);
+		(void)stress_temp_dir_rm_args(args);
+
+		for (i = 0; i < MMAPFILES_SCAN_METHODS; i++) {
+			const stress_mmapfiles_scan_t *scan = &mmapfile_info->scan[i];
+			char str[64];
+
+			if ((scan->duration <= 0.0) || (scan->bytes <= 0.0))
+				continue;
+			gb_per_sec = scan->bytes / (scan->duration * (double)GB);
+			faults = scan->faults * (double)GB / scan->bytes;
+			(void)snprintf(str, sizeof(str), "GB per sec %s", stress_mmapfiles_scan_names[i]);
+			stress_metrics_set(args, i * 2, str, gb_per_sec, STRESS_METRIC_HARMONIC_MEAN);
+			(void)snprintf(str, sizeof(str), "page faults per GB %s", stress_mmapfiles_scan_names[i]);
+			stress_metrics_set(args, (i * 2) + 1, str, faults, STRESS_METRIC_GEOMETRIC_MEAN);
+		}
+		(void)munmap((void *)mmapfile_info, sizeof(*mmapfile_info));
+		return ret;
+	}
 
 	if (mmapfile_info->mmapfiles_numa) {
 #if defined(HAVE_LINUX_MEMPOLICY_H)
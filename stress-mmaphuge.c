@@ -18,6 +18,8 @@
  *
  */
 #include "stress-ng.h"
+#include "core-builtin.h"
+#include "core-madvise.h"
 #include "core-mmap.h"
 #include "core-numa.h"
 #include "core-out-of-memory.h"
@@ -25,8 +27,14 @@
 #define MIN_MMAPHUGE_MMAPS	(1)
 #define MAX_MMAPHUGE_MMAPS	(65536)
 
+#define MMAPHUGE_COLLAPSE_SIZE	(32 * MB)	/* size of --mmaphuge-collapse regions */
+#define MMAPHUGE_THP_SIZE	(2 * MB)	/* default THP size */
+#define MMAPHUGE_KHUGEPAGED_WAIT (60.0)		/* max secs to wait for khugepaged */
+#define MMAPHUGE_ACCESS_PASSES	(64)		/* passes over pages in access test */
+
 static const stress_help_t help[] = {
 	{ NULL,	"mmaphuge N",		"start N workers stressing mmap with huge mappings" },
+	{ NULL, "mmaphuge-collapse",	"measure MADV_COLLAPSE and khugepaged THP collapse times" },
 	{ NULL, "mmaphuge-file",	"perform mappings on a temporary file" },
 	{ NULL,	"mmaphuge-mlock",	"attempt to mlock pages into memory" },
 	{ NULL, "mmaphuge-mmaps N",	"select number of memory mappings per iteration" },
@@ -36,6 +44,7 @@ static const stress_help_t help[] = {
 };
 
 static const stress_opt_t opts[] = {
+	{ OPT_mmaphuge_collapse, "mmaphuge-collapse", TYPE_ID_BOOL, 0, 1, NULL },
 	{ OPT_mmaphuge_file,  "mmaphuge-file",  TYPE_ID_BOOL, 0, 1, NULL },
 	{ OPT_mmaphuge_mlock, "mmaphuge-mlock", TYPE_ID_BOOL, 0, 1, NULL },
 	{ OPT_mmaphuge_mmaps, "mmaphuge-mmaps", TYPE_ID_SIZE_T, MIN_MMAPHUGE_MMAPS, MAX_MMAPHUGE_MMAPS, NULL },
@@ -239,6 +248,255 @@ static int stress_mmaphuge_child(stress_args_t *args, void *v_context)
 	return rc;
 }
 
+#if defined(__linux__) &&	\
+    defined(MADV_HUGEPAGE) &&	\
+    defined(MADV_NOHUGEPAGE)
+#define STRESS_MMAPHUGE_COLLAPSE
+
+typedef struct {
+	double small_accesses;	/* accesses on small pages */
+	double small_duration;	/* time of small page accesses */
+	double thp_accesses;	/* accesses after MADV_COLLAPSE */
+	double thp_duration;	/* time of accesses after MADV_COLLAPSE */
+	double collapse_duration; /* time of successful MADV_COLLAPSE calls */
+	double collapses;	/* number of successful MADV_COLLAPSE calls */
+	double khugepaged_duration; /* time for khugepaged to collapse a region */
+	double khugepaged_count; /* regions fully collapsed by khugepaged */
+	double khugepaged_percent; /* sum of % collapsed per khugepaged wait */
+	double khugepaged_waits; /* number of khugepaged waits */
+} stress_mmaphuge_collapse_t;
+
+/*
+ *  stress_mmaphuge_thp_size()
+ *	get the PMD THP size
+ */
+static size_t stress_mmaphuge_thp_size(void)
+{
+	char buf[64];
+
+	if (stress_system_read("/sys/kernel/mm/transparent_hugepage/hpage_pmd_size",
+			       buf, sizeof(buf)) > 0) {
+		unsigned long int val;
+
+		if ((sscanf(buf, "%lu", &val) == 1) && (val > 0) && !(val & (val - 1)))
+			return (size_t)val;
+	}
+	return MMAPHUGE_THP_SIZE;
+}
+
+/*
+ *  stress_mmaphuge_anon_huge()
+ *	find the AnonHugePages size in bytes of the mapping at addr
+ *	from /proc/self/smaps, 0 if not found
+ */
+static size_t stress_mmaphuge_anon_huge(const void *addr)
+{
+	FILE *fp;
+	char buf[256];
+	bool found = false;
+	size_t kb = 0;
+
+	fp = fopen("/proc/self/smaps", "r");
+	if (!fp)
+		return 0;
+	while (fgets(buf, sizeof(buf), fp)) {
+		if (!found) {
+			uintptr_t start;
+
+			if ((sscanf(buf, "%" SCNxPTR "-", &start) == 1) &&
+			    (start == (uintptr_t)addr))
+				found = true;
+		} else if (!strncmp(buf, "AnonHugePages:", 14)) {
+			if (sscanf(buf + 14, "%zu", &kb) != 1)
+				kb = 0;
+			break;
+		}
+	}
+	(void)fclose(fp);
+	return kb * KB;
+}
+
+/*
+ *  stress_mmaphuge_access()
+ *	write one word on each page in a scattered page order,
+ *	this is dominated by TLB misses when small pages are used,
+ *	adds the number of accesses and time taken
+ */
+static void OPTIMIZE3 stress_mmaphuge_access(
+	uint8_t *buf,
+	const size_t sz,
+	const size_t page_size,
+	double *accesses,
+	double *duration)
+{
+	const size_t n_pages = sz / page_size;
+	const size_t mask = n_pages - 1;	/* n_pages is a power of 2 */
+	size_t i, pass;
+	double t;
+
+	t = stress_time_now();
+	for (pass = 0; pass < MMAPHUGE_ACCESS_PASSES; pass++) {
+		for (i = 0; i < n_pages; i++) {
+			/* odd multiplier gives a permutation of the pages */
+			const size_t page = ((i * 2053) + pass) & mask;
+			volatile uint64_t *ptr = (volatile uint64_t *)(buf + (page * page_size));
+
+			(*ptr)++;
+		}
+	}
+	*duration += stress_time_now() - t;
+	*accesses += (double)n_pages * MMAPHUGE_ACCESS_PASSES;
+}
+
+/*
+ *  stress_mmaphuge_populate()
+ *	map a THP aligned region and populate it with small pages
+ */
+static uint8_t *stress_mmaphuge_populate(
+	const size_t sz,
+	const size_t thp_size,
+	uint8_t **mapping,
+	size_t *mapping_sz)
+{
+	uint8_t *buf;
+
+	*mapping_sz = sz + thp_size;
+	*mapping = (uint8_t *)mmap(NULL, *mapping_sz, PROT_READ | PROT_WRITE,
+				MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (*mapping == MAP_FAILED)
+		return NULL;
+	buf = (uint8_t *)(((uintptr_t)*mapping + thp_size - 1) & ~(uintptr_t)(thp_size - 1));
+	/* split off the unaligned ends so buf is a VMA of its own in smaps */
+	if (buf > *mapping)
+		(void)munmap((void *)*mapping, (size_t)(buf - *mapping));
+	if (buf + sz < *mapping + *mapping_sz)
+		(void)munmap((void *)(buf + sz), (size_t)((*mapping + *mapping_sz) - (buf + sz)));
+	*mapping = buf;
+	*mapping_sz = sz;
+
+	(void)stress_madvise_nohugepage(buf, sz);
+	(void)shim_memset(buf, 0x5a, sz);
+	return buf;
+}
+
+/*
+ *  stress_mmaphuge_collapse_child()
+ *	populate regions with small pages, measure page access rates,
+ *	the latency of synchronous MADV_COLLAPSE per THP and the access
+ *	rate after the collapse, then populate another region with small
+ *	pages and time how long khugepaged takes to collapse it
+ */
+static int stress_mmaphuge_collapse_child(stress_args_t *args, void *context)
+{
+	const size_t page_size = args->page_size;
+	const size_t thp_size = stress_mmaphuge_thp_size();
+	const size_t sz = (MMAPHUGE_COLLAPSE_SIZE + thp_size - 1) & ~(thp_size - 1);
+	stress_mmaphuge_collapse_t c;
+	bool collapse_ok = true;
+	char str[64];
+
+	(void)context;
+	(void)shim_memset(&c, 0, sizeof(c));
+
+	if (args->instance == 0) {
+		stress_uint64_to_str(str, sizeof(str), (uint64_t)thp_size);
+		pr_dbg("%s: collapsing %zu regions of %s THP size\n",
+			args->name, sz / thp_size, str);
+	}
+
+	stress_set_proc_state(args->name, STRESS_STATE_SYNC_WAIT);
+	stress_sync_start_wait(args);
+	stress_set_proc_state(args->name, STRESS_STATE_RUN);
+
+	do {
+		uint8_t *buf, *mapping;
+		size_t mapping_sz, off, huge;
+		double t, t_end;
+
+		/* (a) synchronous MADV_COLLAPSE */
+		buf = stress_mmaphuge_populate(sz, thp_size, &mapping, &mapping_sz);
+		if (UNLIKELY(!buf)) {
+			pr_inf_skip("%s: cannot mmap %zu bytes, skipping stressor\n",
+				args->name, sz);
+			return EXIT_NO_RESOURCE;
+		}
+		stress_mmaphuge_access(buf, sz, page_size, &c.small_accesses, &c.small_duration);
+		(void)shim_madvise(buf, sz, MADV_HUGEPAGE);
+#if defined(SHIM_MADV_COLLAPSE)
+		for (off = 0; collapse_ok && (off < sz); off += thp_size) {
+			t = stress_time_now();
+			if (shim_madvise(buf + off, thp_size, SHIM_MADV_COLLAPSE) < 0) {
+				if ((errno == EINVAL) || (errno == ENOSYS)) {
+					if (args->instance == 0)
+						pr_inf("%s: MADV_COLLAPSE not supported, "
+							"not measuring it\n", args->name);
+					collapse_ok = false;
+				}
+				continue;
+			}
+			c.collapse_duration += stress_time_now() - t;
+			c.collapses += 1.0;
+		}
+		if (collapse_ok)
+			stress_mmaphuge_access(buf, sz, page_size, &c.thp_accesses, &c.thp_duration);
+#else
+		(void)off;
+		(void)collapse_ok;
+#endif
+		(void)munmap((void *)mapping, mapping_sz);
+		if (UNLIKELY(!stress_continue(args)))
+			break;
+
+		/* (b) asynchronous collapse by khugepaged */
+		buf = stress_mmaphuge_populate(sz, thp_size, &mapping, &mapping_sz);
+		if (UNLIKELY(!buf))
+			continue;
+		(void)shim_madvise(buf, sz, MADV_HUGEPAGE);
+		t = stress_time_now();
+		t_end = t + MMAPHUGE_KHUGEPAGED_WAIT;
+		huge = 0;
+		do {
+			huge = stress_mmaphuge_anon_huge(buf);
+			if (huge >= sz) {
+				c.khugepaged_duration += stress_time_now() - t;
+				c.khugepaged_count += 1.0;
+				break;
+			}
+			(void)shim_usleep(100000);
+		} while (stress_continue(args) && (stress_time_now() < t_end));
+		c.khugepaged_percent += 100.0 * (double)huge / (double)sz;
+		c.khugepaged_waits += 1.0;
+		(void)munmap((void *)mapping, mapping_sz);
+
+		stress_bogo_inc(args);
+	} while (stress_continue(args));
+
+	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
+
+	if (c.small_duration > 0.0)
+		stress_metrics_set(args, 0, "small page accesses per sec",
+			c.small_accesses / c.small_duration, STRESS_METRIC_HARMONIC_MEAN);
+	if (c.thp_duration > 0.0)
+		stress_metrics_set(args, 1, "collapsed THP accesses per sec",
+			c.thp_accesses / c.thp_duration, STRESS_METRIC_HARMONIC_MEAN);
+	if (c.collapses > 0.0) {
+		(void)snprintf(str, sizeof(str), "MADV_COLLAPSE usec per %zuMB",
+			(size_t)(thp_size / MB));
+		stress_metrics_set(args, 2, str,
+			(c.collapse_duration / c.collapses) * STRESS_DBL_MICROSECOND,
+			STRESS_METRIC_GEOMETRIC_MEAN);
+	}
+	if (c.khugepaged_count > 0.0)
+		stress_metrics_set(args, 3, "khugepaged secs to collapse region",
+			c.khugepaged_duration / c.khugepaged_count, STRESS_METRIC_GEOMETRIC_MEAN);
+	if (c.khugepaged_waits > 0.0)
+		stress_metrics_set(args, 4, "% of region collapsed by khugepaged",
+			c.khugepaged_percent / c.khugepaged_waits, STRESS_METRIC_MAXIMUM);
+
+	return EXIT_SUCCESS;
+}
+#endif
+
 /*
  *  stress_mmaphuge()
  *	stress huge page mmappings and unmappings
@@ -246,9 +504,20 @@ static int stress_mmaphuge_child(stress_args_t *args, void *v_context)
 static int stress_mmaphuge(stress_args_t *args)
 {
 	stress_mmaphuge_context_t context;
-
+	bool mmaphuge_collapse = false;
 	int ret;
 
+	(void)stress_get_setting("mmaphuge-collapse", &mmaphuge_collapse);
+	if (mmaphuge_collapse) {
+#if defined(STRESS_MMAPHUGE_COLLAPSE)
+		return stress_oomable_child(args, NULL, stress_mmaphuge_collapse_child, STRESS_OOMABLE_QUIET);
+#else
+		if (args->instance == 0)
+			pr_inf("%s: --mmaphuge-collapse requires Linux transparent huge page "
+				"support, ignoring option\n", args->name);
+#endif
+	}
+
 #if defined(HAVE_LINUX_MEMPOLICY_H)
 	context.numa_mask = NULL;
 #endif
@@ -367,6 +636,7 @@ const stressor_info_t stress_mmaphuge_info = {
 	.class = CLASS_VM | CLASS_OS,
 	.opts = opts,
 	.verify = VERIFY_ALWAYS,
+	.metrics_max = 5,
 	.help = help
 };
 
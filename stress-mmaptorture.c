@@ -902,6 +902,7 @@ const stressor_info_t stress_mmaptorture_info = {
 	.stressor = stress_mmaptorture,
 	.class = CLASS_VM | CLASS_OS,
 	.verify = VERIFY_NONE,
+	.metrics_max = 9,
 	.init = stress_mmaptorture_init,
 	.deinit = stress_mmaptorture_deinit,
 	.opts = opts,
@@ -25,23 +25,57 @@
 
 #include <math.h>
 
+#if defined(HAVE_LIB_PTHREAD)
+#include <pthread.h>
+#endif
+
 #define MIN_MONTE_CARLO_SAMPLES	(1)
 #define MAX_MONTE_CARLO_SAMPLES	(0xffffffffULL)
 
 /* Don't use HAVE_ASM_X86_RDRAND for now, it is too slow */
 #undef HAVE_ASM_X86_RDRAND
 
+/*
+ *  --monte-carlo-batch, random numbers are generated a block at a
+ *  time into a buffer and each thread has its own generator state so
+ *  threads draw from independent streams. The simple generators are
+ *  run as MC_BATCH_LANES interleaved generators with no dependency
+ *  between lanes so the compiler can vectorize them
+ */
+#define MC_BATCH_LANES		(8)		/* interleaved generators */
+#define MC_BATCH_BLOCK		(1024)		/* doubles per generated block */
+#define MC_THREADS_MAX		(256)
+
 typedef struct {
+	uint64_t xorshift[MC_BATCH_LANES];	/* xorshift64* lane states */
+	uint64_t pcg32[MC_BATCH_LANES];		/* pcg32 lane states */
+	uint32_t lcg[MC_BATCH_LANES];		/* Park-Miller lane states */
+	unsigned short int xsubi[3];		/* erand48 state */
+	uint32_t mwc_w;				/* thread local mwc seeds */
+	uint32_t mwc_z;
+} stress_mc_stream_t;
+
+typedef struct stress_monte_carlo_rand_info {
 	const char *name;
 	double	(*rand)(void);
 	void	(*seed)(void);
 	bool	(*supported)(void);
+	void	(*fill)(const struct stress_monte_carlo_rand_info *info,
+			stress_mc_stream_t *stream, double *buf, const size_t n);
 } stress_monte_carlo_rand_info_t;
 
+typedef struct {
+	double	sum;		/* hits, function sum or draws */
+	double	samples;	/* samples computed */
+	double	partial;	/* e method running sum */
+} stress_mc_acc_t;
+
 typedef struct {
 	const char *name;
 	double expected;
 	double (*method)(const stress_monte_carlo_rand_info_t *info, const uint32_t samples);
+	void (*batch)(const double *buf, const size_t n, stress_mc_acc_t *acc);
+	double scale;		/* batch estimate is scale * sum / samples */
 } stress_monte_carlo_method_t;
 
 typedef struct {
@@ -51,10 +85,12 @@ typedef struct {
 
 static const stress_help_t help[] = {
 	{ NULL,	"monte-carlo N",	"start N workers performing monte-carlo computations" },
+	{ NULL,	"monte-carlo-batch",	"generate random numbers in blocks with per thread streams" },
 	{ NULL,	"monte-carlo-ops N",	"stop after N monte-carlo operations" },
 	{ NULL, "monte-carlo-rand R",	"select random number generator [ all | drand48 | getrandom | lcg | pcg32 | mwc32 | mwc64 | random | xorshift ]" },
 	{ NULL,	"monte-carlo-samples N","specify number of samples for each computation" },
 	{ NULL,	"monte-carlo-method M",	"select computation method [ pi | e | exp | sin | sqrt | squircle ]" },
+	{ NULL,	"monte-carlo-threads N","use N threads in batch mode, implies --monte-carlo-batch" },
 	{ NULL,	NULL,			NULL }
 };
 
@@ -270,32 +306,216 @@ static bool stress_mc_supported(void)
 	return true;
 }
 
+static inline double ALWAYS_INLINE stress_mc_u64_to_double(const uint64_t v)
+{
+	/* top 53 bits to [0, 1) */
+	return (double)(int64_t)(v >> 11) * (1.0 / 9007199254740992.0);
+}
+
+static void OPTIMIZE3 stress_mc_fill_xorshift(
+	const stress_monte_carlo_rand_info_t *info,
+	stress_mc_stream_t *stream,
+	double *buf,
+	const size_t n)
+{
+	uint64_t x[MC_BATCH_LANES];
+	register size_t i, l;
+
+	(void)info;
+
+	(void)shim_memcpy(x, stream->xorshift, sizeof(x));
+	for (i = 0; i < n; i += MC_BATCH_LANES) {
+		for (l = 0; l < MC_BATCH_LANES; l++) {
+			x[l] ^= x[l] >> 12;
+			x[l] ^= x[l] << 25;
+			x[l] ^= x[l] >> 27;
+			buf[i + l] = stress_mc_u64_to_double(x[l] * 0x2545f4914f6cdd1dULL);
+		}
+	}
+	(void)shim_memcpy(stream->xorshift, x, sizeof(x));
+}
+
+static void OPTIMIZE3 stress_mc_fill_pcg32(
+	const stress_monte_carlo_rand_info_t *info,
+	stress_mc_stream_t *stream,
+	double *buf,
+	const size_t n)
+{
+	static uint64_t const multiplier = 6364136223846793005u;
+	register const double scale_u32 = 1.0 / 4294967296.0;
+	uint64_t s[MC_BATCH_LANES];
+	register size_t i, l;
+
+	(void)info;
+
+	(void)shim_memcpy(s, stream->pcg32, sizeof(s));
+	for (i = 0; i < n; i += MC_BATCH_LANES) {
+		for (l = 0; l < MC_BATCH_LANES; l++) {
+			uint64_t x = s[l];
+			const unsigned int count = (unsigned int)(x >> 59);
+
+			s[l] = x * multiplier + stress_mc_pcg32_increment;
+			x ^= x >> 18;
+			buf[i + l] = scale_u32 * (double)stress_mc_rotr32((uint32_t)(x >> 27), count);
+		}
+	}
+	(void)shim_memcpy(stream->pcg32, s, sizeof(s));
+}
+
+static void OPTIMIZE3 stress_mc_fill_lcg(
+	const stress_monte_carlo_rand_info_t *info,
+	stress_mc_stream_t *stream,
+	double *buf,
+	const size_t n)
+{
+	register const double scale_u32 = 1.0 / (double)0x7fffffff;
+	uint32_t s[MC_BATCH_LANES];
+	register size_t i, l;
+
+	(void)info;
+
+	(void)shim_memcpy(s, stream->lcg, sizeof(s));
+	for (i = 0; i < n; i += MC_BATCH_LANES) {
+		for (l = 0; l < MC_BATCH_LANES; l++) {
+			const uint64_t product = (uint64_t)s[l] * 48271;
+			uint32_t r = (uint32_t)((product & 0x7fffffff) + (product >> 31));
+
+			r = (r & 0x7fffffff) + (r >> 31);
+			s[l] = r;
+			buf[i + l] = scale_u32 * (double)r;
+		}
+	}
+	(void)shim_memcpy(stream->lcg, s, sizeof(s));
+}
+
+#if defined(HAVE_STRESS_THREAD_LOCAL)
+/*
+ *  mwc state is thread local, stress_mwc_fill() already runs
+ *  STRESS_MWC_FILL_LANES interleaved generators
+ */
+static void OPTIMIZE3 stress_mc_fill_mwc32(
+	const stress_monte_carlo_rand_info_t *info,
+	stress_mc_stream_t *stream,
+	double *buf,
+	const size_t n)
+{
+	register const double scale_u32 = 1.0 / (double)0xffffffffUL;
+	uint32_t r[MC_BATCH_BLOCK];
+	register size_t i;
+
+	(void)info;
+	(void)stream;
+
+	stress_mwc_fill(r, n * sizeof(*r));
+	for (i = 0; i < n; i++)
+		buf[i] = scale_u32 * (double)r[i];
+}
+
+static void OPTIMIZE3 stress_mc_fill_mwc64(
+	const stress_monte_carlo_rand_info_t *info,
+	stress_mc_stream_t *stream,
+	double *buf,
+	const size_t n)
+{
+	uint64_t r[MC_BATCH_BLOCK];
+	register size_t i;
+
+	(void)info;
+	(void)stream;
+
+	stress_mwc_fill(r, n * sizeof(*r));
+	for (i = 0; i < n; i++)
+		buf[i] = stress_mc_u64_to_double(r[i]);
+}
+#endif
+
+#if defined(HAVE_DRAND48)
+static void OPTIMIZE3 stress_mc_fill_erand48(
+	const stress_monte_carlo_rand_info_t *info,
+	stress_mc_stream_t *stream,
+	double *buf,
+	const size_t n)
+{
+	register size_t i;
+
+	(void)info;
+
+	for (i = 0; i < n; i++)
+		buf[i] = erand48(stream->xsubi);
+}
+#endif
+
+#if defined(HAVE_GETRANDOM) &&	\
+    !defined(__sun__)
+static void OPTIMIZE3 stress_mc_fill_getrandom(
+	const stress_monte_carlo_rand_info_t *info,
+	stress_mc_stream_t *stream,
+	double *buf,
+	const size_t n)
+{
+	uint64_t r[MC_BATCH_BLOCK];
+	register size_t i;
+
+	(void)info;
+	(void)stream;
+
+	if (shim_getrandom((void *)r, n * sizeof(*r), 0) < 0)
+		(void)shim_memset(r, 0, n * sizeof(*r));
+	for (i = 0; i < n; i++)
+		buf[i] = stress_mc_u64_to_double(r[i]);
+}
+#endif
+
+/*
+ *  stress_mc_fill_rand()
+ *	sources with no per thread state, arc4random and the hardware
+ *	generators are thread safe, random() serializes on a libc lock
+ */
+static void OPTIMIZE3 stress_mc_fill_rand(
+	const stress_monte_carlo_rand_info_t *info,
+	stress_mc_stream_t *stream,
+	double *buf,
+	const size_t n)
+{
+	register size_t i;
+
+	(void)stream;
+
+	for (i = 0; i < n; i++)
+		buf[i] = info->rand();
+}
+
 static const stress_monte_carlo_rand_info_t rand_info[] = {
-	{ "all",	NULL,				NULL,				stress_mc_supported },
+	{ "all",	NULL,				NULL,				stress_mc_supported,		NULL },
 #if defined(HAVE_ARC4RANDOM)
-	{ "arc4",	stress_mc_arc4_rand,		stress_mc_no_seed,		stress_mc_supported },
+	{ "arc4",	stress_mc_arc4_rand,		stress_mc_no_seed,		stress_mc_supported,		stress_mc_fill_rand },
 #endif
 #if defined(STRESS_ARCH_PPC64) &&	\
     defined(HAVE_ASM_PPC64_DARN)
-	{ "darn",	stress_mc_darn_rand,		stress_mc_no_seed,		stress_mc_darn_supported },
+	{ "darn",	stress_mc_darn_rand,		stress_mc_no_seed,		stress_mc_darn_supported,	stress_mc_fill_rand },
 #endif
 #if defined(HAVE_DRAND48)
-	{ "drand48",	stress_mc_drand48_rand,		stress_mc_drand48_seed,		stress_mc_supported },
+	{ "drand48",	stress_mc_drand48_rand,		stress_mc_drand48_seed,		stress_mc_supported,		stress_mc_fill_erand48 },
 #endif
 #if defined(HAVE_GETRANDOM) &&	\
     !defined(__sun__)
-	{ "getrandom",	stress_mc_getrandom_rand,	stress_mc_no_seed,		stress_mc_supported },
+	{ "getrandom",	stress_mc_getrandom_rand,	stress_mc_no_seed,		stress_mc_supported,		stress_mc_fill_getrandom },
+#endif
+	{ "lcg",	stress_mc_lcg_rand,		stress_mc_lcg_seed,		stress_mc_supported,		stress_mc_fill_lcg },
+	{ "pcg32",	stress_mc_pcg32_rand,		stress_mc_pcg32_seed,		stress_mc_supported,		stress_mc_fill_pcg32 },
+#if defined(HAVE_STRESS_THREAD_LOCAL)
+	{ "mwc32",	stress_mc_mwc32_rand,		stress_mc_mwc_seed,		stress_mc_supported,		stress_mc_fill_mwc32 },
+	{ "mwc64",	stress_mc_mwc64_rand,		stress_mc_mwc_seed,		stress_mc_supported,		stress_mc_fill_mwc64 },
+#else
+	{ "mwc32",	stress_mc_mwc32_rand,		stress_mc_mwc_seed,		stress_mc_supported,		NULL },
+	{ "mwc64",	stress_mc_mwc64_rand,		stress_mc_mwc_seed,		stress_mc_supported,		NULL },
 #endif
-	{ "lcg",	stress_mc_lcg_rand,		stress_mc_lcg_seed,		stress_mc_supported },
-	{ "pcg32",	stress_mc_pcg32_rand,		stress_mc_pcg32_seed,		stress_mc_supported },
-	{ "mwc32",	stress_mc_mwc32_rand,		stress_mc_mwc_seed,		stress_mc_supported },
-	{ "mwc64",	stress_mc_mwc64_rand,		stress_mc_mwc_seed,		stress_mc_supported },
-	{ "random",	stress_mc_random_rand,		stress_mc_random_seed,		stress_mc_supported },
+	{ "random",	stress_mc_random_rand,		stress_mc_random_seed,		stress_mc_supported,		stress_mc_fill_rand },
 #if defined(STRESS_ARCH_X86) &&	\
     defined(HAVE_ASM_X86_RDRAND)
-	{ "rdrand",	stress_mc_rdrand_rand,		stress_mc_no_seed,		stress_mc_rdrand_supported },
+	{ "rdrand",	stress_mc_rdrand_rand,		stress_mc_no_seed,		stress_mc_rdrand_supported,	stress_mc_fill_rand },
 #endif
-	{ "xorshift",	stress_mc_xorshift_rand,	stress_mc_xorshift_seed,	stress_mc_supported },
+	{ "xorshift",	stress_mc_xorshift_rand,	stress_mc_xorshift_seed,	stress_mc_supported,		stress_mc_fill_xorshift },
 };
 
 /*
@@ -471,15 +691,102 @@ static double OPTIMIZE3 stress_monte_carlo_squircle(
 }
 
 
-static const stress_monte_carlo_method_t stress_monte_carlo_methods[] = {
-	{ "all",	0,			NULL },
-	{ "e",		M_E,			stress_monte_carlo_e },
-	{ "exp",	1.46265174590718160880,	stress_monte_carlo_exp },
-	{ "pi",		M_PI,			stress_monte_carlo_pi },
-	{ "sin",	2.0,			stress_monte_carlo_sin },
-	{ "sqrt",	1.08942941322482232241,	stress_monte_carlo_sqrt },
-	{ "squircle",	3.7081493546,		stress_monte_carlo_squircle },
+/*
+ *  batch kernels, each consumes a block of n random doubles and
+ *  accumulates into acc, the estimate is scale * sum / samples
+ */
+static void OPTIMIZE3 stress_mc_batch_pi(const double *buf, const size_t n, stress_mc_acc_t *acc)
+{
+	register size_t i;
+	register uint64_t count = 0;
 
+	for (i = 0; i < n; i += 2) {
+		const double h = (buf[i] * buf[i]) + (buf[i + 1] * buf[i + 1]);
+
+		count += (h <= 1.0);
+	}
+	acc->sum += (double)count;
+	acc->samples += (double)(n / 2);
+}
+
+static void OPTIMIZE3 stress_mc_batch_e(const double *buf, const size_t n, stress_mc_acc_t *acc)
+{
+	register size_t i;
+	register double partial = acc->partial;
+	register uint64_t samples = 0;
+
+	/* draws until the running sum reaches 1, averages to e */
+	for (i = 0; i < n; i++) {
+		partial += buf[i];
+		if (partial >= 1.0) {
+			samples++;
+			partial = 0.0;
+		}
+	}
+	acc->partial = partial;
+	acc->sum += (double)n;
+	acc->samples += (double)samples;
+}
+
+static void OPTIMIZE3 stress_mc_batch_sin(const double *buf, const size_t n, stress_mc_acc_t *acc)
+{
+	register size_t i;
+	register double sum = 0.0;
+
+	for (i = 0; i < n; i++)
+		sum += shim_sin(buf[i] * M_PI);
+	acc->sum += sum;
+	acc->samples += (double)n;
+}
+
+static void OPTIMIZE3 stress_mc_batch_exp(const double *buf, const size_t n, stress_mc_acc_t *acc)
+{
+	register size_t i;
+	register double sum = 0.0;
+
+	for (i = 0; i < n; i++)
+		sum += shim_exp(buf[i] * buf[i]);
+	acc->sum += sum;
+	acc->samples += (double)n;
+}
+
+static void OPTIMIZE3 stress_mc_batch_sqrt(const double *buf, const size_t n, stress_mc_acc_t *acc)
+{
+	register size_t i;
+	register double sum = 0.0;
+
+	for (i = 0; i < n; i++) {
+		const double x = buf[i];
+
+		sum += shim_sqrt(1.0 + (x * x * x * x));
+	}
+	acc->sum += sum;
+	acc->samples += (double)n;
+}
+
+static void OPTIMIZE3 stress_mc_batch_squircle(const double *buf, const size_t n, stress_mc_acc_t *acc)
+{
+	register size_t i;
+	register uint64_t count = 0;
+
+	for (i = 0; i < n; i += 2) {
+		const double x2 = buf[i] * buf[i];
+		const double y2 = buf[i + 1] * buf[i + 1];
+
+		count += (((x2 * x2) + (y2 * y2)) <= 1.0);
+	}
+	acc->sum += (double)count;
+	acc->samples += (double)(n / 2);
+}
+
+static const stress_monte_carlo_method_t stress_monte_carlo_methods[] = {
+	{ "all",	0,			NULL,				NULL,			0.0 },
+	{ "e",		M_E,			stress_monte_carlo_e,		stress_mc_batch_e,	1.0 },
+	{ "exp",	1.46265174590718160880,	stress_monte_carlo_exp,		stress_mc_batch_exp,	1.0 },
+	{ "pi",		M_PI,			stress_monte_carlo_pi,		stress_mc_batch_pi,	4.0 },
+	{ "sin",	2.0,			stress_monte_carlo_sin,		stress_mc_batch_sin,	M_PI },
+	{ "sqrt",	1.08942941322482232241,	stress_monte_carlo_sqrt,	stress_mc_batch_sqrt,	1.0 },
+	{ "squircle",	3.7081493546,		stress_monte_carlo_squircle,	stress_mc_batch_squircle, 4.0 },
 };
 
 static const char *stress_monte_carlo_method(const size_t i)
@@ -493,9 +800,11 @@ static const char *stress_monte_carlo_rand(const size_t i)
 }
 
 static const stress_opt_t opts[] = {
+	{ OPT_monte_carlo_batch,   "monte-carlo-batch",   TYPE_ID_BOOL, 0, 1, NULL },
 	{ OPT_monte_carlo_method,  "monte-carlo-method",  TYPE_ID_SIZE_T_METHOD, 0, 0, stress_monte_carlo_method },
 	{ OPT_monte_carlo_rand,    "monte-carlo-rand",    TYPE_ID_SIZE_T_METHOD, 0, 0, stress_monte_carlo_rand },
 	{ OPT_monte_carlo_samples, "monte-carlo-samples", TYPE_ID_UINT32, MIN_MONTE_CARLO_SAMPLES, MAX_MONTE_CARLO_SAMPLES, NULL },
+	{ OPT_monte_carlo_threads, "monte-carlo-threads", TYPE_ID_SIZE_T, 1, MC_THREADS_MAX, NULL },
 	END_OPT,
 };
 
@@ -559,6 +868,202 @@ static void stress_monte_carlo_by_method(
 	}
 }
 
+typedef struct {
+	const stress_monte_carlo_rand_info_t *info;	/* random source */
+	const stress_monte_carlo_method_t *method;	/* computation */
+	stress_mc_stream_t stream;			/* this thread's generators */
+	double samples;					/* samples to compute */
+	stress_mc_acc_t acc;				/* results */
+} stress_mc_batch_t;
+
+/*
+ *  stress_mc_batch_stream_init()
+ *	seed each thread's generators from the instance's mwc
+ */
+static void stress_mc_batch_stream_init(stress_mc_stream_t *stream)
+{
+	size_t l;
+
+	for (l = 0; l < MC_BATCH_LANES; l++) {
+		stream->xorshift[l] = stress_mwc64() | 1;
+		stream->pcg32[l] = stress_mwc64() + stress_mc_pcg32_increment;
+		stream->lcg[l] = (stress_mwc32() % 0x7ffffffe) + 1;
+	}
+	stream->xsubi[0] = stress_mwc16();
+	stream->xsubi[1] = stress_mwc16();
+	stream->xsubi[2] = stress_mwc16();
+	do {
+		stream->mwc_w = stress_mwc32();
+	} while ((stream->mwc_w & 0xffff) == 0);
+	do {
+		stream->mwc_z = stress_mwc32();
+	} while ((stream->mwc_z & 0xffff) == 0);
+}
+
+/*
+ *  stress_mc_batch_worker()
+ *	generate and consume blocks until the thread's share of samples
+ *	is done, the mwc seeds are saved so the stream continues next time
+ */
+static void *stress_mc_batch_worker(void *arg)
+{
+	stress_mc_batch_t *batch = (stress_mc_batch_t *)arg;
+	double buf[MC_BATCH_BLOCK];
+
+	stress_mwc_set_seed(batch->stream.mwc_w, batch->stream.mwc_z);
+	while ((batch->acc.samples < batch->samples) && stress_continue_flag()) {
+		batch->info->fill(batch->info, &batch->stream, buf, MC_BATCH_BLOCK);
+		batch->method->batch(buf, MC_BATCH_BLOCK, &batch->acc);
+	}
+	stress_mwc_get_seed(&batch->stream.mwc_w, &batch->stream.mwc_z);
+	return NULL;
+}
+
+/*
+ *  stress_mc_batch_run()
+ *	split samples over threads, thread 0 is the caller
+ */
+static void stress_mc_batch_run(
+	stress_mc_batch_t *batches,
+	const size_t threads,
+	const stress_monte_carlo_rand_info_t *info,
+	const stress_monte_carlo_method_t *method,
+	const uint32_t samples,
+	stress_mc_acc_t *acc)
+{
+	size_t i;
+#if defined(HAVE_LIB_PTHREAD)
+	pthread_t pthreads[MC_THREADS_MAX];
+	bool created[MC_THREADS_MAX];
+#endif
+
+	for (i = 0; i < threads; i++) {
+		batches[i].info = info;
+		batches[i].method = method;
+		batches[i].samples = ceil((double)samples / (double)threads);
+		(void)shim_memset(&batches[i].acc, 0, sizeof(batches[i].acc));
+	}
+#if defined(HAVE_LIB_PTHREAD)
+	for (i = 1; i < threads; i++)
+		created[i] = (pthread_create(&pthreads[i], NULL,
+				stress_mc_batch_worker, &batches[i]) == 0);
+	(void)stress_mc_batch_worker(&batches[0]);
+	for (i = 1; i < threads; i++) {
+		if (created[i])
+			(void)pthread_join(pthreads[i], NULL);
+		else
+			(void)stress_mc_batch_worker(&batches[i]);
+	}
+#else
+	for (i = 0; i < threads; i++)
+		(void)stress_mc_batch_worker(&batches[i]);
+#endif
+	for (i = 0; i < threads; i++) {
+		acc->sum += batches[i].acc.sum;
+		acc->samples += batches[i].acc.samples;
+	}
+}
+
+/*
+ *  stress_monte_carlo_batch()
+ *	block generated, multi-threaded monte carlo, reports the
+ *	throughput and the estimation error of each random source
+ */
+static int stress_monte_carlo_batch(
+	stress_args_t *args,
+	const uint32_t monte_carlo_samples,
+	const size_t monte_carlo_method,
+	const size_t monte_carlo_rand,
+	const size_t monte_carlo_threads,
+	const bool rands_supported[RANDS_MAX])
+{
+	stress_mc_batch_t *batches;
+	stress_mc_acc_t acc[METHODS_MAX][RANDS_MAX];
+	double duration[METHODS_MAX][RANDS_MAX];
+	size_t i, j, idx;
+	bool ran = false;
+
+	batches = (stress_mc_batch_t *)calloc(monte_carlo_threads, sizeof(*batches));
+	if (!batches) {
+		pr_inf_skip("%s: cannot allocate %zu batch threads, skipping stressor\n",
+			args->name, monte_carlo_threads);
+		return EXIT_NO_RESOURCE;
+	}
+	for (i = 0; i < monte_carlo_threads; i++)
+		stress_mc_batch_stream_init(&batches[i].stream);
+	(void)shim_memset(acc, 0, sizeof(acc));
+	(void)shim_memset(duration, 0, sizeof(duration));
+
+	stress_set_proc_state(args->name, STRESS_STATE_SYNC_WAIT);
+	stress_sync_start_wait(args);
+	stress_set_proc_state(args->name, STRESS_STATE_RUN);
+
+	do {
+		for (i = 1; i < METHODS_MAX; i++) {
+			if ((monte_carlo_method != 0) && (monte_carlo_method != i))
+				continue;
+			for (j = 1; j < RANDS_MAX; j++) {
+				double t;
+
+				if ((monte_carlo_rand != 0) && (monte_carlo_rand != j))
+					continue;
+				if (!rands_supported[j] || !rand_info[j].fill)
+					continue;
+
+				t = stress_time_now();
+				stress_mc_batch_run(batches, monte_carlo_threads, &rand_info[j],
+					&stress_monte_carlo_methods[i], monte_carlo_samples, &acc[i][j]);
+				duration[i][j] += stress_time_now() - t;
+				stress_bogo_inc(args);
+				ran = true;
+				if (UNLIKELY(!stress_continue(args)))
+					break;
+			}
+		}
+	} while (ran && stress_continue(args));
+
+	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
+
+	if (!ran && (args->instance == 0))
+		pr_inf("%s: random source %s has no batch generator\n",
+			args->name, rand_info[monte_carlo_rand].name);
+
+	if (args->instance == 0)
+		pr_block_begin();
+	for (idx = 0, i = 1; i < METHODS_MAX; i++) {
+		for (j = 1; j < RANDS_MAX; j++) {
+			const stress_monte_carlo_method_t *method = &stress_monte_carlo_methods[i];
+			char buf[64];
+			double rate, estimate, error;
+
+			if ((duration[i][j] <= 0.0) || (acc[i][j].samples <= 0.0))
+				continue;
+			rate = acc[i][j].samples / duration[i][j];
+			estimate = method->scale * acc[i][j].sum / acc[i][j].samples;
+			error = fabs(estimate - method->expected) / method->expected;
+
+			(void)snprintf(buf, sizeof(buf), "samples/sec, %s using %s",
+				method->name, rand_info[j].name);
+			stress_metrics_set(args, idx++, buf, rate, STRESS_METRIC_GEOMETRIC_MEAN);
+			(void)snprintf(buf, sizeof(buf), "relative error (ppm), %s using %s",
+				method->name, rand_info[j].name);
+			stress_metrics_set(args, idx++, buf, error * 1.0E6, STRESS_METRIC_MAXIMUM);
+
+			if (args->instance == 0)
+				pr_dbg("%s: %-8.8s %-9.9s %14.0f samples/sec, ~ %.13f vs %.13f, "
+					"relative error %.3e (%.0f samples, %zu threads)\n",
+					args->name, method->name, rand_info[j].name, rate,
+					estimate, method->expected, error, acc[i][j].samples,
+					monte_carlo_threads);
+		}
+	}
+	if (args->instance == 0)
+		pr_block_end();
+
+	free(batches);
+	return EXIT_SUCCESS;
+}
+
 /*
  *  stress_monte_carlo()
  *      stress Intel rdrand instruction
@@ -568,6 +1073,8 @@ static int stress_monte_carlo(stress_args_t *args)
 	uint32_t monte_carlo_samples;
 	size_t monte_carlo_method,
 	monte_carlo_rand = 0;
+	size_t monte_carlo_threads = 1;
+	bool monte_carlo_batch = false;
 	stress_metrics_t metrics[METHODS_MAX][RANDS_MAX];
 	stress_monte_carlo_result_t results[METHODS_MAX][RANDS_MAX];
 	bool rands_supported[RANDS_MAX];
@@ -596,6 +1103,12 @@ static int stress_monte_carlo(stress_args_t *args)
 		if (g_opt_flags & OPT_FLAGS_MINIMIZE)
 			monte_carlo_samples = MIN_MONTE_CARLO_SAMPLES;
 	}
+	(void)stress_get_setting("monte-carlo-batch", &monte_carlo_batch);
+	if (stress_get_setting("monte-carlo-threads", &monte_carlo_threads))
+		monte_carlo_batch = true;
+	if (monte_carlo_batch)
+		return stress_monte_carlo_batch(args, monte_carlo_samples, monte_carlo_method,
+			monte_carlo_rand, monte_carlo_threads, rands_supported);
 
 	stress_set_proc_state(args->name, STRESS_STATE_SYNC_WAIT);
 	stress_sync_start_wait(args);
@@ -648,5 +1161,6 @@ const stressor_info_t stress_monte_carlo_info = {
 	.opts = opts,
 	.class = CLASS_CPU | CLASS_COMPUTE,
 	.verify = VERIFY_NONE,
+	.metrics_max = METHODS_MAX * RANDS_MAX * 2,
 	.help = help
 };
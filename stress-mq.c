@@ -20,7 +20,9 @@
 #include "stress-ng.h"
 #include "core-affinity.h"
 #include "core-builtin.h"
+#include "core-ipcsweep.h"
 #include "core-killpid.h"
+#include "core-latency.h"
 
 #include <time.h>
 
@@ -40,11 +42,13 @@ static const stress_help_t help[] = {
 	{ NULL,	"mq N",		"start N workers passing messages using POSIX messages" },
 	{ NULL,	"mq-ops N",	"stop mq workers after N bogo messages" },
 	{ NULL,	"mq-size N",	"specify the size of the POSIX message queue" },
+	{ NULL,	"mq-sweep",	"sweep message sizes, report throughput and round trip latency" },
 	{ NULL,	NULL,		NULL }
 };
 
 static const stress_opt_t opts[] = {
 	{ OPT_mq_size, "mq-size", TYPE_ID_INT, MIN_MQ_SIZE, MAX_MQ_SIZE, NULL },
+	{ OPT_mq_sweep, "mq-sweep", TYPE_ID_BOOL, 0, 1, NULL },
 	END_OPT,
 };
 
@@ -83,6 +87,117 @@ static void stress_mq_invalid_open(
 	}
 }
 
+typedef struct {
+	mqd_t mq[2];		/* per direction message queues */
+	size_t msgsize;		/* maximum message size */
+} stress_mq_sweep_t;
+
+static int stress_mq_sweep_send(void *priv, const int dir, const void *buf, const size_t len)
+{
+	const stress_mq_sweep_t *sweep = (const stress_mq_sweep_t *)priv;
+
+	return mq_send(sweep->mq[dir], (const char *)buf, len, 0);
+}
+
+static int stress_mq_sweep_recv(void *priv, const int dir, void *buf, const size_t len)
+{
+	const stress_mq_sweep_t *sweep = (const stress_mq_sweep_t *)priv;
+	const ssize_t ret = mq_receive(sweep->mq[dir], (char *)buf, sweep->msgsize, NULL);
+
+	if (ret < 0)
+		return -1;
+	if ((size_t)ret != len) {
+		errno = EMSGSIZE;
+		return -1;
+	}
+	return 0;
+}
+
+/*
+ *  stress_mq_sweep_open()
+ *	open a message queue with the largest message size allowed,
+ *	the size is halved until the queue can be created
+ */
+static mqd_t stress_mq_sweep_open(const char *name, const long int maxmsg, long int *msgsize)
+{
+	for (;;) {
+		struct mq_attr attr;
+		mqd_t mq;
+
+		attr.mq_flags = 0;
+		attr.mq_maxmsg = maxmsg;
+		attr.mq_msgsize = *msgsize;
+		attr.mq_curmsgs = 0;
+
+		mq = mq_open(name, O_CREAT | O_RDWR, S_IRUSR | S_IWUSR, &attr);
+		if ((mq >= 0) || (errno != EINVAL) || (*msgsize <= STRESS_IPC_SWEEP_MIN_SIZE))
+			return mq;
+		*msgsize /= 2;
+	}
+}
+
+/*
+ *  stress_mq_sweep()
+ *	message size sweep, one POSIX message queue per direction
+ */
+static int stress_mq_sweep(stress_args_t *args, const int mq_size)
+{
+	stress_mq_sweep_t sweep;
+	stress_ipc_sweep_ops_t ops;
+	char mq_names[2][64];
+	long int maxmsg = mq_size, msgsize = 8192;
+	int i, rc;
+	FILE *fp;
+
+	fp = fopen("/proc/sys/fs/mqueue/msgsize_max", "r");
+	if (fp) {
+		if ((fscanf(fp, "%20ld", &msgsize) != 1) || (msgsize < STRESS_IPC_SWEEP_MIN_SIZE))
+			msgsize = 8192;
+		(void)fclose(fp);
+	}
+	fp = fopen("/proc/sys/fs/mqueue/msg_max", "r");
+	if (fp) {
+		long int msg_max;
+
+		if ((fscanf(fp, "%20ld", &msg_max) == 1) && (msg_max > 0) && (maxmsg > msg_max))
+			maxmsg = msg_max;
+		(void)fclose(fp);
+	}
+
+	for (i = 0; i < 2; i++) {
+		(void)snprintf(mq_names[i], sizeof(mq_names[i]), "/%s-%" PRIdMAX "-%" PRIu32 "-%d",
+			args->name, (intmax_t)args->pid, args->instance, i);
+		sweep.mq[i] = stress_mq_sweep_open(mq_names[i], maxmsg, &msgsize);
+		if (sweep.mq[i] < 0) {
+			rc = stress_exit_status(errno);
+			if (rc == EXIT_FAILURE)
+				pr_fail("%s: mq_open failed, errno=%d (%s)\n",
+					args->name, errno, strerror(errno));
+			else
+				pr_inf_skip("%s: mq_open failed, errno=%d (%s), skipping stressor\n",
+					args->name, errno, strerror(errno));
+			if (i > 0) {
+				(void)mq_close(sweep.mq[0]);
+				(void)mq_unlink(mq_names[0]);
+			}
+			return rc;
+		}
+	}
+	sweep.msgsize = (size_t)msgsize;
+
+	ops.name = "mq";
+	ops.priv = &sweep;
+	ops.send = stress_mq_sweep_send;
+	ops.recv = stress_mq_sweep_recv;
+	rc = stress_ipc_sweep(args, &ops, (size_t)msgsize);
+
+	for (i = 0; i < 2; i++) {
+		(void)mq_close(sweep.mq[i]);
+		(void)mq_unlink(mq_names[i]);
+	}
+	return rc;
+}
+
 /*
  *  stress_mq
  *	stress POSIX message queues
@@ -100,6 +215,7 @@ static int stress_mq(stress_args_t *args)
 	struct timespec abs_timeout;
 	unsigned int max_prio = UINT_MAX;
 	int rc = EXIT_SUCCESS;
+	bool mq_sweep = false;
 
 #if defined(SIGUSR2)
 	if (stress_sighandler(args->name, SIGUSR2, stress_sighandler_nop, NULL) < 0)
@@ -124,6 +240,10 @@ static int stress_mq(stress_args_t *args)
 	}
 	sz = mq_size;
 
+	(void)stress_get_setting("mq-sweep", &mq_sweep);
+	if (mq_sweep)
+		return stress_mq_sweep(args, mq_size);
+
 	(void)snprintf(mq_tmp_name, sizeof(mq_tmp_name), "/%s-%" PRIdMAX "-%" PRIu32,
 		args->name, (intmax_t)args->pid, args->instance + 10000);
 
@@ -209,6 +329,10 @@ static int stress_mq(stress_args_t *args)
 		abs_timeout.tv_nsec = 0;
 	}
 
+	/* sender and receiver record into separate histograms */
+	stress_latency_set_description(args, 0, "mq send");
+	stress_latency_set_description(args, 1, "mq receive");
+
 	stress_set_proc_state(args->name, STRESS_STATE_SYNC_WAIT);
 	stress_sync_start_wait(args);
 	stress_set_proc_state(args->name, STRESS_STATE_RUN);
@@ -243,6 +367,7 @@ again:
 				ssize_t sret;
 				const uint64_t timed = (i & 1);
 				unsigned int prio;
+				uint64_t t_lat;
 
 				if (!(i & 1023)) {
 #if defined(__linux__)
@@ -369,10 +494,13 @@ again:
 				/*
 				 * toggle between timedreceive and receive
 				 */
+				t_lat = stress_latency_begin(args);
 				if (do_timed && (timed))
 					sret = mq_timedreceive(mq, (char *)&msg, sizeof(msg), &prio, &abs_timeout);
 				else
 					sret = mq_receive(mq, (char *)&msg, sizeof(msg), &prio);
+				if (LIKELY(sret >= 0))
+					stress_latency_end(args, 1, t_lat);
 				if (UNLIKELY(sret < 0)) {
 					if ((errno != EINTR) && (errno != ETIMEDOUT)) {
 						pr_fail("%s: %s failed, errno=%d (%s)\n",
@@ -432,6 +560,7 @@ again:
 			int ret;
 			const unsigned int prio = stress_mwc8modn(PRIOS_MAX);
 			const uint64_t timed = (msg.value & 1);
+			uint64_t t_lat;
 
 			if (UNLIKELY((attr_count++ & 31) == 0)) {
 				struct mq_attr old_attr;
@@ -458,10 +587,13 @@ again:
 			/*
 			 * toggle between timedsend and send
 			 */
+			t_lat = stress_latency_begin(args);
 			if (do_timed && (timed))
 				ret = mq_timedsend(mq, (char *)&msg, sizeof(msg), prio, &abs_timeout);
 			else
 				ret = mq_send(mq, (char *)&msg, sizeof(msg), prio);
+			if (LIKELY(ret >= 0))
+				stress_latency_end(args, 0, t_lat);
 			if (ret < 0) {
 				if (UNLIKELY((errno != EINTR) && (errno != ETIMEDOUT))) {
 					pr_fail("%s: %s failed, errno=%d (%s)\n",
@@ -531,6 +663,7 @@ const stressor_info_t stress_mq_info = {
 	.class = CLASS_SCHEDULER | CLASS_OS | CLASS_IPC,
 	.opts = opts,
 	.verify = VERIFY_OPTIONAL,
+	.metrics_max = STRESS_IPC_SWEEP_METRICS,
 	.help = help
 };
 #else
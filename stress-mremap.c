@@ -27,20 +27,25 @@
 #define DEFAULT_MREMAP_BYTES	(256 * MB)
 #define MIN_MREMAP_BYTES	(4 * KB)
 #define MAX_MREMAP_BYTES	(MAX_MEM_LIMIT)
+#define MREMAP_THP_SIZE		(2 * MB)	/* transparent huge page size */
 
 static const stress_help_t help[] = {
 	{ NULL,	"mremap N",	  "start N workers stressing mremap" },
+	{ NULL, "mremap-bench",	  "measure move throughput of mremap against copy and munmap" },
 	{ NULL,	"mremap-bytes N", "mremap N bytes maximum for each stress iteration" },
 	{ NULL, "mremap-mlock",	  "mlock remap pages, force pages to be unswappable" },
 	{ NULL, "mremap-numa",	  "bind memory mappings to randomly selected NUMA nodes" },
 	{ NULL,	"mremap-ops N",	  "stop after N mremap bogo operations" },
+	{ NULL, "mremap-thp",	  "use transparent huge page aligned regions with --mremap-bench" },
 	{ NULL,	NULL,		  NULL }
 };
 
 static const stress_opt_t opts[] = {
+	{ OPT_mremap_bench, "mremap-bench", TYPE_ID_BOOL, 0, 1, NULL },
 	{ OPT_mremap_bytes, "mremap-bytes", TYPE_ID_SIZE_T_BYTES_VM, MIN_MREMAP_BYTES, MAX_MREMAP_BYTES, NULL },
 	{ OPT_mremap_mlock, "mremap-mlock", TYPE_ID_BOOL, 0, 1, NULL },
 	{ OPT_mremap_numa,  "mremap-numa",  TYPE_ID_BOOL, 0, 1, NULL },
+	{ OPT_mremap_thp,   "mremap-thp",   TYPE_ID_BOOL, 0, 1, NULL },
 	END_OPT,
 };
 
@@ -195,6 +200,209 @@ static int try_remap(
 	return -1;
 }
 
+#if defined(MREMAP_FIXED) &&	\
+    defined(MREMAP_MAYMOVE)
+#define STRESS_MREMAP_BENCH
+
+#define MREMAP_BENCH_MOVE	(0)	/* mremap move */
+#define MREMAP_BENCH_DONTUNMAP	(1)	/* mremap move, MREMAP_DONTUNMAP */
+#define MREMAP_BENCH_COPY	(2)	/* mmap, memcpy and munmap */
+#define MREMAP_BENCH_MAX	(3)
+
+typedef struct {
+	const char *name;	/* metrics name of move method */
+	bool enabled;		/* false if not supported */
+	double duration;	/* total time of moves */
+	double count;		/* number of moves */
+} stress_mremap_bench_t;
+
+/*
+ *  stress_mremap_bench_advise()
+ *	advise the kernel to use or not use transparent huge pages
+ */
+static void stress_mremap_bench_advise(void *addr, const size_t sz, const bool mremap_thp)
+{
+#if defined(MADV_HUGEPAGE) &&	\
+    defined(MADV_NOHUGEPAGE)
+	(void)shim_madvise(addr, sz, mremap_thp ? MADV_HUGEPAGE : MADV_NOHUGEPAGE);
+#else
+	(void)addr;
+	(void)sz;
+	(void)mremap_thp;
+#endif
+}
+
+/*
+ *  stress_mremap_bench_move()
+ *	move sz bytes of populated memory from src to dst using
+ *	the given method, returns dst or MAP_FAILED on failure
+ */
+static void *stress_mremap_bench_move(
+	const int method,
+	void *src,
+	void *dst,
+	const size_t sz,
+	const bool mremap_thp)
+{
+	void *ptr;
+
+	switch (method) {
+	case MREMAP_BENCH_MOVE:
+		return mremap(src, sz, sz, MREMAP_MAYMOVE | MREMAP_FIXED, dst);
+#if defined(MREMAP_DONTUNMAP)
+	case MREMAP_BENCH_DONTUNMAP:
+		return mremap(src, sz, sz, MREMAP_MAYMOVE | MREMAP_FIXED | MREMAP_DONTUNMAP, dst);
+#endif
+	case MREMAP_BENCH_COPY:
+		ptr = mmap(dst, sz, PROT_READ | PROT_WRITE,
+			MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED, -1, 0);
+		if (ptr == MAP_FAILED)
+			return MAP_FAILED;
+		stress_mremap_bench_advise(ptr, sz, mremap_thp);
+		(void)memcpy(ptr, src, sz);
+		(void)munmap(src, sz);
+		return ptr;
+	default:
+		break;
+	}
+	errno = ENOSYS;
+	return MAP_FAILED;
+}
+
+/*
+ *  stress_mremap_bench()
+ *	move a populated region of sz bytes back and forth between two
+ *	halves of a reserved address range, rotating between mremap,
+ *	mremap with MREMAP_DONTUNMAP and copy and unmap, and report the
+ *	move throughput and per call latency of each method
+ */
+static int stress_mremap_bench(stress_args_t *args, size_t sz, const bool mremap_thp)
+{
+	const size_t page_size = args->page_size;
+	const size_t align = mremap_thp ? MREMAP_THP_SIZE : page_size;
+	const int reserve_flags = MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE;
+	stress_mremap_bench_t bench[MREMAP_BENCH_MAX];
+	uint8_t *reserve, *cur, *other, *ptr;
+	size_t reserve_sz, i;
+	int method = MREMAP_BENCH_MOVE, ret = EXIT_SUCCESS;
+
+	(void)memset(bench, 0, sizeof(bench));
+	bench[MREMAP_BENCH_MOVE].name = "mremap";
+	bench[MREMAP_BENCH_MOVE].enabled = true;
+	bench[MREMAP_BENCH_DONTUNMAP].name = "mremap dontunmap";
+#if defined(MREMAP_DONTUNMAP)
+	bench[MREMAP_BENCH_DONTUNMAP].enabled = true;
+#endif
+	bench[MREMAP_BENCH_COPY].name = "copy and munmap";
+	bench[MREMAP_BENCH_COPY].enabled = true;
+
+	sz &= ~(align - 1);
+	if (sz < align)
+		sz = align;
+
+	/* reserve two halves, aligned so THP moves can be done at PMD level */
+	reserve_sz = (sz * 2) + align;
+	reserve = (uint8_t *)mmap(NULL, reserve_sz, PROT_NONE, reserve_flags, -1, 0);
+	if (reserve == MAP_FAILED) {
+		pr_inf_skip("%s: cannot reserve %zu bytes for benchmark, errno=%d (%s), "
+			"skipping stressor\n", args->name, reserve_sz, errno, strerror(errno));
+		return EXIT_NO_RESOURCE;
+	}
+	cur = (uint8_t *)(((uintptr_t)reserve + align - 1) & ~(uintptr_t)(align - 1));
+	other = cur + sz;
+
+	ptr = (uint8_t *)mmap(cur, sz, PROT_READ | PROT_WRITE,
+		MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED, -1, 0);
+	if (ptr == MAP_FAILED) {
+		pr_inf_skip("%s: cannot mmap %zu bytes for benchmark, errno=%d (%s), "
+			"skipping stressor\n", args->name, sz, errno, strerror(errno));
+		(void)munmap((void *)reserve, reserve_sz);
+		return EXIT_NO_RESOURCE;
+	}
+	stress_mremap_bench_advise(cur, sz, mremap_thp);
+	stress_mmap_set_light(cur, sz, page_size);
+
+	if (args->instance == 0)
+		pr_dbg("%s: benchmarking moves of %zu bytes%s\n", args->name, sz,
+			mremap_thp ? ", THP aligned" : "");
+
+	stress_set_proc_state(args->name, STRESS_STATE_SYNC_WAIT);
+	stress_sync_start_wait(args);
+	stress_set_proc_state(args->name, STRESS_STATE_RUN);
+
+	do {
+		double t;
+
+		t = stress_time_now();
+		ptr = (uint8_t *)stress_mremap_bench_move(method, cur, other, sz, mremap_thp);
+		t = stress_time_now() - t;
+
+		if (UNLIKELY(ptr == MAP_FAILED)) {
+			/* MREMAP_DONTUNMAP on anonymous memory needs Linux 5.7 */
+			if ((method == MREMAP_BENCH_DONTUNMAP) && (errno == EINVAL)) {
+				if (args->instance == 0)
+					pr_inf("%s: MREMAP_DONTUNMAP not supported, "
+						"not benchmarking it\n", args->name);
+				bench[method].enabled = false;
+				goto next;
+			}
+			pr_fail("%s: %s move of %zu bytes failed, errno=%d (%s)\n",
+				args->name, bench[method].name, sz, errno, strerror(errno));
+			ret = EXIT_FAILURE;
+			break;
+		}
+		bench[method].duration += t;
+		bench[method].count += 1.0;
+
+		/* keep the vacated half reserved so nothing else is mapped there */
+		if (UNLIKELY(mmap(cur, sz, PROT_NONE, reserve_flags | MAP_FIXED, -1, 0) == MAP_FAILED)) {
+			pr_fail("%s: cannot re-reserve %zu bytes, errno=%d (%s)\n",
+				args->name, sz, errno, strerror(errno));
+			ret = EXIT_FAILURE;
+			break;
+		}
+		other = cur;
+		cur = ptr;
+
+		if (g_opt_flags & OPT_FLAGS_VERIFY) {
+			if (UNLIKELY(stress_mmap_check_light(cur, sz, page_size) < 0)) {
+				pr_fail("%s: %s moved region of %zu bytes does not "
+					"contain expected data\n",
+					args->name, bench[method].name, sz);
+				ret = EXIT_FAILURE;
+				break;
+			}
+		}
+		stress_bogo_inc(args);
+next:
+		do {
+			method++;
+			if (method >= MREMAP_BENCH_MAX)
+				method = MREMAP_BENCH_MOVE;
+		} while (!bench[method].enabled);
+	} while (stress_continue(args));
+
+	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
+
+	for (i = 0; i < MREMAP_BENCH_MAX; i++) {
+		char msg[64];
+		double rate, latency;
+
+		if (bench[i].duration <= 0.0)
+			continue;
+		rate = ((double)sz * bench[i].count) / (bench[i].duration * (double)GB);
+		latency = (bench[i].duration / bench[i].count) * STRESS_DBL_MICROSECOND;
+		(void)snprintf(msg, sizeof(msg), "%s GB per sec", bench[i].name);
+		stress_metrics_set(args, i * 2, msg, rate, STRESS_METRIC_HARMONIC_MEAN);
+		(void)snprintf(msg, sizeof(msg), "%s usec per call", bench[i].name);
+		stress_metrics_set(args, (i * 2) + 1, msg, latency, STRESS_METRIC_GEOMETRIC_MEAN);
+	}
+	(void)munmap((void *)reserve, reserve_sz);
+
+	return ret;
+}
+#endif
+
 static int stress_mremap_child(stress_args_t *args, void *context)
 {
 	size_t new_sz, sz, mremap_bytes = DEFAULT_MREMAP_BYTES;
@@ -202,6 +410,8 @@ static int stress_mremap_child(stress_args_t *args, void *context)
 	const size_t page_size = args->page_size;
 	bool mremap_mlock = false;
 	bool mremap_numa = false;
+	bool mremap_bench = false;
+	bool mremap_thp = false;
 	double duration = 0.0, count = 0.0, rate;
 	int ret = EXIT_SUCCESS;
 #if defined(HAVE_LINUX_MEMPOLICY_H)
@@ -219,6 +429,20 @@ static int stress_mremap_child(stress_args_t *args, void *context)
 		if (g_opt_flags & OPT_FLAGS_MINIMIZE)
 			mremap_bytes = MIN_MREMAP_BYTES;
 	}
+
+	(void)stress_get_setting("mremap-bench", &mremap_bench);
+	(void)stress_get_setting("mremap-thp", &mremap_thp);
+	if (mremap_bench) {
+#if defined(STRESS_MREMAP_BENCH)
+		/* benchmark moves the size given, it is not shared between instances */
+		return stress_mremap_bench(args, mremap_bytes, mremap_thp);
+#else
+		if (args->instance == 0)
+			pr_inf("%s: --mremap-bench requires MREMAP_FIXED and MREMAP_MAYMOVE, "
+				"ignoring option\n", args->name);
+#endif
+	}
+
 	mremap_bytes /= args->instances;
 	if (mremap_bytes < MIN_MREMAP_BYTES)
 		mremap_bytes = MIN_MREMAP_BYTES;
@@ -388,6 +612,7 @@ const stressor_info_t stress_mremap_info = {
 	.class = CLASS_VM | CLASS_OS,
 	.opts = opts,
 	.verify = VERIFY_OPTIONAL,
+	.metrics_max = 6,
 	.help = help
 };
 #else
@@ -359,5 +359,6 @@ const stressor_info_t stress_mseal_info = {
 	.supported = stress_mseal_supported,
 	.class = CLASS_VM | CLASS_OS,
 	.verify = VERIFY_ALWAYS,
+	.metrics_max = 1,
 	.help = help
 };
@@ -20,6 +20,7 @@
 #include "stress-ng.h"
 #include "core-affinity.h"
 #include "core-builtin.h"
+#include "core-ipcsweep.h"
 #include "core-killpid.h"
 
 #if defined(HAVE_SYS_IPC_H)
@@ -40,12 +41,14 @@ static const stress_help_t help[] = {
 	{ NULL,	"msg-ops N",	"stop msg workers after N bogo messages" },
 	{ NULL, "msg-types N",	"enable N different message types" },
 	{ NULL, "msg-bytes N",	"set the message size 4..8192" },
+	{ NULL,	"msg-sweep",	"sweep message sizes, report throughput and round trip latency" },
 	{ NULL,	NULL,		NULL }
 };
 
 static const stress_opt_t opts[] = {
 	{ OPT_msg_types, "msg-types", TYPE_ID_INT32, 0, 100, NULL },
 	{ OPT_msg_bytes, "msg-bytes", TYPE_ID_SIZE_T_BYTES_VM, MIN_MSG_BYTES, MAX_MSG_BYTES, NULL },
+	{ OPT_msg_sweep, "msg-sweep", TYPE_ID_BOOL, 0, 1, NULL },
 	END_OPT,
 };
 
@@ -203,6 +206,86 @@ static void stress_msg_get_procinfo(bool *get_procinfo)
 }
 #endif
 
+typedef struct {
+	int msgq_id;		/* message queue, direction is the message type */
+	stress_msg_t msg;	/* send and receive message buffer */
+} stress_msg_sweep_t;
+
+static int stress_msg_sweep_send(void *priv, const int dir, const void *buf, const size_t len)
+{
+	stress_msg_sweep_t *sweep = (stress_msg_sweep_t *)priv;
+
+	sweep->msg.mtype = (long int)dir + 1;
+	(void)shim_memcpy(sweep->msg.u.data, buf, len);
+	return msgsnd(sweep->msgq_id, &sweep->msg, len, 0);
+}
+
+static int stress_msg_sweep_recv(void *priv, const int dir, void *buf, const size_t len)
+{
+	stress_msg_sweep_t *sweep = (stress_msg_sweep_t *)priv;
+	const ssize_t ret = msgrcv(sweep->msgq_id, &sweep->msg,
+		sizeof(sweep->msg.u.data), (long int)dir + 1, 0);
+
+	if (ret < 0)
+		return -1;
+	if ((size_t)ret != len) {
+		errno = EMSGSIZE;
+		return -1;
+	}
+	(void)shim_memcpy(buf, sweep->msg.u.data, len);
+	return 0;
+}
+
+/*
+ *  stress_msg_sweep()
+ *	message size sweep, one System V message queue with a message
+ *	type per direction
+ */
+static int stress_msg_sweep(stress_args_t *args)
+{
+	stress_msg_sweep_t *sweep;
+	stress_ipc_sweep_ops_t ops;
+	size_t msgmax = MAX_MSG_BYTES;
+	char buf[32];
+	int rc;
+
+	/* largest message allowed by the kernel, capped by the message buffer */
+	if (stress_system_read("/proc/sys/kernel/msgmax", buf, sizeof(buf)) > 0) {
+		const long int val = atol(buf);
+
+		if ((val >= STRESS_IPC_SWEEP_MIN_SIZE) && ((size_t)val < msgmax))
+			msgmax = (size_t)val;
+	}
+
+	sweep = (stress_msg_sweep_t *)malloc(sizeof(*sweep));
+	if (!sweep) {
+		pr_inf_skip("%s: cannot allocate message buffer, skipping stressor\n", args->name);
+		return EXIT_NO_RESOURCE;
+	}
+	sweep->msgq_id = msgget(IPC_PRIVATE, S_IRUSR | S_IWUSR | IPC_CREAT | IPC_EXCL);
+	if (sweep->msgq_id < 0) {
+		rc = stress_exit_status(errno);
+		if (rc == EXIT_FAILURE)
+			pr_fail("%s: msgget failed, errno=%d (%s)\n",
+				args->name, errno, strerror(errno));
+		else
+			pr_inf_skip("%s: msgget out of resources or not implemented, skipping stressor\n", args->name);
+		free(sweep);
+		return rc;
+	}
+
+	ops.name = "msg";
+	ops.priv = sweep;
+	ops.send = stress_msg_sweep_send;
+	ops.recv = stress_msg_sweep_recv;
+	rc = stress_ipc_sweep(args, &ops, msgmax);
+
+	(void)msgctl(sweep->msgq_id, IPC_RMID, NULL);
+	free(sweep);
+
+	return rc;
+}
+
 /*
  *  Set upper/lower limits on maximum msgq ids to be allocated
  */
@@ -380,6 +463,11 @@ static int stress_msg(stress_args_t *args)
 	int *msgq_ids;
 	stress_msg_t ALIGN64 msg;
 	size_t j, n, msg_bytes = sizeof(msg.u.value);
+	bool msg_sweep = false;
+
+	(void)stress_get_setting("msg-sweep", &msg_sweep);
+	if (msg_sweep)
+		return stress_msg_sweep(args);
 
 	(void)stress_get_setting("msg-types", &msg_types);
 	if (!stress_get_setting("msg-bytes", &msg_bytes)) {
@@ -473,6 +561,7 @@ const stressor_info_t stress_msg_info = {
 	.class = CLASS_SCHEDULER | CLASS_OS | CLASS_IPC,
 	.opts = opts,
 	.verify = VERIFY_ALWAYS,
+	.metrics_max = STRESS_IPC_SWEEP_METRICS,
 	.help = help
 };
 #else
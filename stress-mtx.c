@@ -180,6 +180,7 @@ const stressor_info_t stress_mtx_info = {
 	.stressor = stress_mtx,
 	.class = CLASS_OS | CLASS_SCHEDULER,
 	.verify = VERIFY_ALWAYS,
+	.metrics_max = 1,
 	.opts = opts,
 	.help = help
 };
@@ -294,6 +294,7 @@ const stressor_info_t stress_munmap_info = {
 	.stressor = stress_munmap,
 	.class = CLASS_VM | CLASS_OS,
 	.verify = VERIFY_ALWAYS,
+	.metrics_max = 1,
 	.help = help
 };
 
@@ -19,6 +19,7 @@
 #include "stress-ng.h"
 #include "core-affinity.h"
 #include "core-builtin.h"
+#include "core-lock.h"
 #include "core-pthread.h"
 
 #if defined(HAVE_PTHREAD_NP_H)
@@ -32,6 +33,7 @@
 static const stress_help_t help[] = {
 	{ NULL,	"mutex N",		"start N workers exercising mutex operations" },
 	{ NULL, "mutex-affinity",	"change CPU affinity randomly across locks" },
+	{ NULL, "mutex-bench",		"sweep lock primitives over thread counts and critical section lengths" },
 	{ NULL,	"mutex-ops N",		"stop after N mutex bogo operations" },
 	{ NULL, "mutex-procs N",	"select the number of concurrent processes" },
 	{ NULL,	NULL,			NULL }
@@ -39,6 +41,7 @@ static const stress_help_t help[] = {
 
 static const stress_opt_t opts[] = {
 	{ OPT_mutex_affinity, "mutex-affinity", TYPE_ID_BOOL, 0, 1, NULL },
+	{ OPT_mutex_bench,    "mutex-bench",    TYPE_ID_BOOL, 0, 1, NULL },
 	{ OPT_mutex_procs,    "mutex-procs",    TYPE_ID_UINT64, MIN_MUTEX_PROCS, MAX_MUTEX_PROCS, NULL },
 	END_OPT,
 };
@@ -171,6 +174,502 @@ static void OPTIMIZE3 *stress_mutex_exercise(void *arg)
 	return &g_nowt;
 }
 
+#define MUTEX_BENCH_CELL_NS	(50000000ULL)	/* duration of each sweep cell */
+#define MUTEX_BENCH_THREAD_STEPS (8)		/* max thread count steps */
+
+/*
+ *  critical section lengths, in loop iterations
+ *  spent whilst holding the lock
+ */
+static const uint32_t mutex_bench_cs[] = { 0, 100, 1000 };
+
+typedef struct {
+	const char *name;		/* lock primitive name */
+	int (*init)(void);		/* create lock */
+	void (*deinit)(void);		/* destroy lock */
+	int (*lock)(void);		/* acquire lock */
+	int (*unlock)(void);		/* release lock */
+} stress_mutex_bench_lock_t;
+
+typedef struct {
+	const stress_mutex_bench_lock_t *lock;
+	pthread_t pthread;
+	uint64_t count;			/* acquisitions in this cell */
+	uint32_t cs;			/* critical section length */
+	int ret;			/* pthread_create return */
+	bool failed;			/* lock or unlock failed */
+} ALIGN64 stress_mutex_bench_thread_t;
+
+typedef struct {
+	double duration;		/* total time spent in cell */
+	double count;			/* total acquisitions */
+	double thread_count[MAX_MUTEX_PROCS];	/* per-thread acquisitions */
+} stress_mutex_bench_result_t;
+
+static volatile bool mutex_bench_go;
+static volatile bool mutex_bench_stop;
+static uint64_t mutex_bench_shared;	/* protected by the lock under test */
+
+static pthread_mutex_t ALIGN64 mutex_bench_mutex;
+#if defined(HAVE_LIB_PTHREAD_SPINLOCK)
+static pthread_spinlock_t ALIGN64 mutex_bench_spinlock;
+#endif
+#if defined(PTHREAD_RWLOCK_INITIALIZER)
+static pthread_rwlock_t ALIGN64 mutex_bench_rwlock;
+#endif
+#if defined(HAVE_LINUX_FUTEX_H) &&		\
+    defined(__NR_futex) &&			\
+    defined(HAVE_ATOMIC_COMPARE_EXCHANGE) &&	\
+    defined(HAVE_ATOMIC_FETCH_SUB) &&		\
+    defined(HAVE_ATOMIC_STORE)
+#define HAVE_MUTEX_BENCH_FUTEX
+static uint32_t ALIGN64 mutex_bench_futex;
+#endif
+static void *mutex_bench_core_lock;
+static char mutex_bench_core_name[32];
+
+static int stress_mutex_bench_mutex_init(void)
+{
+	return pthread_mutex_init(&mutex_bench_mutex, NULL);
+}
+
+static void stress_mutex_bench_mutex_deinit(void)
+{
+	(void)pthread_mutex_destroy(&mutex_bench_mutex);
+}
+
+static int stress_mutex_bench_mutex_lock(void)
+{
+	return pthread_mutex_lock(&mutex_bench_mutex);
+}
+
+static int stress_mutex_bench_mutex_unlock(void)
+{
+	return pthread_mutex_unlock(&mutex_bench_mutex);
+}
+
+#if defined(__GLIBC__) &&		\
+    defined(_GNU_SOURCE) &&		\
+    defined(HAVE_PTHREAD_MUTEXATTR_T) &&	\
+    defined(HAVE_PTHREAD_MUTEXATTR_INIT) &&	\
+    defined(HAVE_PTHREAD_MUTEXATTR_DESTROY)
+/*
+ *  stress_mutex_bench_adaptive_init()
+ *	glibc adaptive mutex, spins briefly before sleeping
+ */
+static int stress_mutex_bench_adaptive_init(void)
+{
+	pthread_mutexattr_t attr;
+	int ret;
+
+	ret = pthread_mutexattr_init(&attr);
+	if (ret)
+		return ret;
+	ret = pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_ADAPTIVE_NP);
+	if (ret == 0)
+		ret = pthread_mutex_init(&mutex_bench_mutex, &attr);
+	(void)pthread_mutexattr_destroy(&attr);
+	return ret;
+}
+#define HAVE_MUTEX_BENCH_ADAPTIVE
+#endif
+
+#if defined(HAVE_LIB_PTHREAD_SPINLOCK)
+static int stress_mutex_bench_spin_init(void)
+{
+	return pthread_spin_init(&mutex_bench_spinlock, PTHREAD_PROCESS_PRIVATE);
+}
+
+static void stress_mutex_bench_spin_deinit(void)
+{
+	(void)pthread_spin_destroy(&mutex_bench_spinlock);
+}
+
+static int stress_mutex_bench_spin_lock(void)
+{
+	return pthread_spin_lock(&mutex_bench_spinlock);
+}
+
+static int stress_mutex_bench_spin_unlock(void)
+{
+	return pthread_spin_unlock(&mutex_bench_spinlock);
+}
+#endif
+
+#if defined(PTHREAD_RWLOCK_INITIALIZER)
+static int stress_mutex_bench_rwlock_init(void)
+{
+	return pthread_rwlock_init(&mutex_bench_rwlock, NULL);
+}
+
+static void stress_mutex_bench_rwlock_deinit(void)
+{
+	(void)pthread_rwlock_destroy(&mutex_bench_rwlock);
+}
+
+static int stress_mutex_bench_rwlock_lock(void)
+{
+	return pthread_rwlock_wrlock(&mutex_bench_rwlock);
+}
+
+static int stress_mutex_bench_rwlock_unlock(void)
+{
+	return pthread_rwlock_unlock(&mutex_bench_rwlock);
+}
+#endif
+
+#if defined(HAVE_MUTEX_BENCH_FUTEX)
+/*
+ *  futex lock, 0 = unlocked, 1 = locked, 2 = locked with waiters,
+ *  see Ulrich Drepper, "Futexes Are Tricky"
+ */
+static int stress_mutex_bench_futex_init(void)
+{
+	mutex_bench_futex = 0;
+	return 0;
+}
+
+static void stress_mutex_bench_futex_deinit(void)
+{
+}
+
+static int stress_mutex_bench_futex_lock(void)
+{
+	uint32_t c = 0;
+
+	if (__atomic_compare_exchange_n(&mutex_bench_futex, &c, 1, false,
+					__ATOMIC_ACQUIRE, __ATOMIC_RELAXED))
+		return 0;
+	if (c != 2)
+		c = __atomic_exchange_n(&mutex_bench_futex, 2, __ATOMIC_ACQUIRE);
+	while (c != 0) {
+		if ((shim_futex_wait(&mutex_bench_futex, 2, NULL) < 0) &&
+		    (errno != EAGAIN) && (errno != EINTR))
+			return -1;
+		c = __atomic_exchange_n(&mutex_bench_futex, 2, __ATOMIC_ACQUIRE);
+	}
+	return 0;
+}
+
+static int stress_mutex_bench_futex_unlock(void)
+{
+	if (__atomic_fetch_sub(&mutex_bench_futex, 1, __ATOMIC_RELEASE) != 1) {
+		__atomic_store_n(&mutex_bench_futex, 0, __ATOMIC_RELEASE);
+		if (shim_futex_wake(&mutex_bench_futex, 1) < 0)
+			return -1;
+	}
+	return 0;
+}
+#endif
+
+static int stress_mutex_bench_core_init(void)
+{
+	mutex_bench_core_lock = stress_lock_create("mutex-bench");
+	return mutex_bench_core_lock ? 0 : -1;
+}
+
+static void stress_mutex_bench_core_deinit(void)
+{
+	(void)stress_lock_destroy(mutex_bench_core_lock);
+	mutex_bench_core_lock = NULL;
+}
+
+static int stress_mutex_bench_core_lock(void)
+{
+	return stress_lock_acquire(mutex_bench_core_lock);
+}
+
+static int stress_mutex_bench_core_unlock(void)
+{
+	return stress_lock_release(mutex_bench_core_lock);
+}
+
+static stress_mutex_bench_lock_t mutex_bench_locks[] = {
+	{ "mutex",	stress_mutex_bench_mutex_init, stress_mutex_bench_mutex_deinit,
+			stress_mutex_bench_mutex_lock, stress_mutex_bench_mutex_unlock },
+#if defined(HAVE_MUTEX_BENCH_ADAPTIVE)
+	{ "adaptive",	stress_mutex_bench_adaptive_init, stress_mutex_bench_mutex_deinit,
+			stress_mutex_bench_mutex_lock, stress_mutex_bench_mutex_unlock },
+#endif
+#if defined(HAVE_LIB_PTHREAD_SPINLOCK)
+	{ "spinlock",	stress_mutex_bench_spin_init, stress_mutex_bench_spin_deinit,
+			stress_mutex_bench_spin_lock, stress_mutex_bench_spin_unlock },
+#endif
+#if defined(PTHREAD_RWLOCK_INITIALIZER)
+	{ "rwlock",	stress_mutex_bench_rwlock_init, stress_mutex_bench_rwlock_deinit,
+			stress_mutex_bench_rwlock_lock, stress_mutex_bench_rwlock_unlock },
+#endif
+#if defined(HAVE_MUTEX_BENCH_FUTEX)
+	{ "futex",	stress_mutex_bench_futex_init, stress_mutex_bench_futex_deinit,
+			stress_mutex_bench_futex_lock, stress_mutex_bench_futex_unlock },
+#endif
+	/* name filled in at run time with the --lock-type backend */
+	{ mutex_bench_core_name, stress_mutex_bench_core_init, stress_mutex_bench_core_deinit,
+			stress_mutex_bench_core_lock, stress_mutex_bench_core_unlock },
+};
+
+#define MUTEX_BENCH_LOCKS	(SIZEOF_ARRAY(mutex_bench_locks))
+#define MUTEX_BENCH_CS		(SIZEOF_ARRAY(mutex_bench_cs))
+
+/*
+ *  stress_mutex_bench_thread()
+ *	repeatedly acquire the lock under test, bump the shared
+ *	counter and spin for the critical section length
+ */
+static void OPTIMIZE3 *stress_mutex_bench_thread(void *arg)
+{
+	stress_mutex_bench_thread_t *thread = (stress_mutex_bench_thread_t *)arg;
+	const stress_mutex_bench_lock_t *lock = thread->lock;
+	const uint32_t cs = thread->cs;
+	volatile uint32_t sink = 0;
+
+	while (!mutex_bench_go && !mutex_bench_stop)
+		(void)shim_sched_yield();
+
+	while (LIKELY(!mutex_bench_stop)) {
+		register uint32_t i;
+
+		if (UNLIKELY(lock->lock() != 0)) {
+			thread->failed = true;
+			break;
+		}
+		mutex_bench_shared++;
+		for (i = 0; i < cs; i++)
+			sink += i;
+		if (UNLIKELY(lock->unlock() != 0)) {
+			thread->failed = true;
+			break;
+		}
+		thread->count++;
+	}
+	return &g_nowt;
+}
+
+/*
+ *  stress_mutex_bench_cell()
+ *	run n_threads contending on one lock primitive for
+ *	MUTEX_BENCH_CELL_NS nanoseconds and accumulate results
+ */
+static int stress_mutex_bench_cell(
+	stress_args_t *args,
+	const stress_mutex_bench_lock_t *lock,
+	stress_mutex_bench_thread_t *threads,
+	const uint32_t n_threads,
+	const uint32_t cs,
+	stress_mutex_bench_result_t *result)
+{
+	uint32_t i, created = 0;
+	uint64_t total = 0;
+	double t_start, t_end;
+	int rc = EXIT_SUCCESS;
+	int ret;
+
+	ret = lock->init();
+	if (ret) {
+		pr_inf_skip("%s: cannot initialize %s lock, errno=%d (%s), skipping\n",
+			args->name, lock->name, ret, strerror(ret));
+		return EXIT_NO_RESOURCE;
+	}
+
+	mutex_bench_go = false;
+	mutex_bench_stop = false;
+	mutex_bench_shared = 0;
+
+	for (i = 0; i < n_threads; i++) {
+		threads[i].lock = lock;
+		threads[i].count = 0;
+		threads[i].cs = cs;
+		threads[i].failed = false;
+		threads[i].ret = pthread_create(&threads[i].pthread, NULL,
+				stress_mutex_bench_thread, (void *)&threads[i]);
+		if (threads[i].ret)
+			break;
+		created++;
+	}
+	if (created < n_threads) {
+		mutex_bench_stop = true;
+		rc = EXIT_NO_RESOURCE;
+	} else {
+		t_start = stress_time_now();
+		mutex_bench_go = true;
+		(void)shim_nanosleep_uint64(MUTEX_BENCH_CELL_NS);
+		mutex_bench_stop = true;
+	}
+
+	for (i = 0; i < created; i++)
+		VOID_RET(int, pthread_join(threads[i].pthread, NULL));
+	t_end = stress_time_now();
+	lock->deinit();
+
+	if (rc != EXIT_SUCCESS)
+		return rc;
+
+	for (i = 0; i < n_threads; i++) {
+		if (threads[i].failed) {
+			pr_fail("%s: %s lock or unlock failed\n",
+				args->name, lock->name);
+			return EXIT_FAILURE;
+		}
+		total += threads[i].count;
+		result->thread_count[i] += (double)threads[i].count;
+	}
+	/* every acquisition bumps the shared counter under the lock */
+	if (mutex_bench_shared != total) {
+		pr_fail("%s: %s lock shared counter is %" PRIu64
+			", expected %" PRIu64 ", mutual exclusion failed\n",
+			args->name, lock->name, mutex_bench_shared, total);
+		return EXIT_FAILURE;
+	}
+	result->duration += t_end - t_start;
+	result->count += (double)total;
+	stress_bogo_add(args, total);
+
+	return EXIT_SUCCESS;
+}
+
+/*
+ *  stress_mutex_bench_fairness()
+ *	max/min per-thread share of acquisitions, a starved
+ *	thread is counted as one acquisition
+ */
+static double stress_mutex_bench_fairness(
+	const stress_mutex_bench_result_t *result,
+	const uint32_t n_threads)
+{
+	double max = 0.0, min = -1.0;
+	uint32_t i;
+
+	for (i = 0; i < n_threads; i++) {
+		const double c = result->thread_count[i];
+
+		if (c > max)
+			max = c;
+		if ((min < 0.0) || (c < min))
+			min = c;
+	}
+	if (min < 1.0)
+		min = 1.0;
+	return max / min;
+}
+
+/*
+ *  stress_mutex_bench()
+ *	sweep each lock primitive across thread counts and
+ *	critical section lengths, report acquisitions/sec and
+ *	fairness as the max/min per-thread acquisition share
+ */
+static int stress_mutex_bench(stress_args_t *args, const uint32_t max_threads)
+{
+	uint32_t thread_steps[MUTEX_BENCH_THREAD_STEPS];
+	size_t n_steps = 0, l, t, c, result_size;
+	uint32_t n;
+	stress_mutex_bench_thread_t *threads;
+	stress_mutex_bench_result_t *results;
+	size_t metric = 0;
+	int rc = EXIT_SUCCESS;
+
+	(void)snprintf(mutex_bench_core_name, sizeof(mutex_bench_core_name),
+		"core-%s", stress_lock_type_name());
+
+	/* thread counts 1, 2, 4.. up to and including max_threads */
+	for (n = 1; (n < max_threads) && (n_steps < MUTEX_BENCH_THREAD_STEPS - 1); n <<= 1)
+		thread_steps[n_steps++] = n;
+	thread_steps[n_steps++] = max_threads;
+
+	threads = (stress_mutex_bench_thread_t *)calloc(max_threads, sizeof(*threads));
+	if (!threads) {
+		pr_inf_skip("%s: calloc failed allocating %" PRIu32 " thread structures, "
+			"skipping stressor\n", args->name, max_threads);
+		return EXIT_NO_RESOURCE;
+	}
+	result_size = MUTEX_BENCH_LOCKS * MUTEX_BENCH_THREAD_STEPS * MUTEX_BENCH_CS;
+	results = (stress_mutex_bench_result_t *)calloc(result_size, sizeof(*results));
+	if (!results) {
+		pr_inf_skip("%s: calloc failed allocating %zu result structures, "
+			"skipping stressor\n", args->name, result_size);
+		free(threads);
+		return EXIT_NO_RESOURCE;
+	}
+#define MUTEX_BENCH_RESULT(l, t, c)	\
+	(&results[((l) * MUTEX_BENCH_THREAD_STEPS + (t)) * MUTEX_BENCH_CS + (c)])
+
+	stress_set_proc_state(args->name, STRESS_STATE_SYNC_WAIT);
+	stress_sync_start_wait(args);
+	stress_set_proc_state(args->name, STRESS_STATE_RUN);
+
+	do {
+		for (l = 0; l < MUTEX_BENCH_LOCKS; l++) {
+			for (t = 0; t < n_steps; t++) {
+				for (c = 0; c < MUTEX_BENCH_CS; c++) {
+					rc = stress_mutex_bench_cell(args, &mutex_bench_locks[l],
+						threads, thread_steps[t], mutex_bench_cs[c],
+						MUTEX_BENCH_RESULT(l, t, c));
+					if (rc != EXIT_SUCCESS)
+						goto done;
+					if (UNLIKELY(!stress_continue(args)))
+						goto done;
+				}
+			}
+		}
+	} while (stress_continue(args));
+done:
+	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
+
+	if ((rc == EXIT_SUCCESS) && (args->instance == 0)) {
+		char buf[32];
+
+		pr_inf("%s: acquisitions/sec (max/min thread share) over thread count:\n", args->name);
+		for (l = 0; l < MUTEX_BENCH_LOCKS; l++) {
+			for (c = 0; c < MUTEX_BENCH_CS; c++) {
+				char line[32 + MUTEX_BENCH_THREAD_STEPS * 24];
+				size_t len;
+
+				len = (size_t)snprintf(line, sizeof(line), "%-12s cs %-4" PRIu32,
+					mutex_bench_locks[l].name, mutex_bench_cs[c]);
+				for (t = 0; (t < n_steps) && (len < sizeof(line)); t++) {
+					const stress_mutex_bench_result_t *result = MUTEX_BENCH_RESULT(l, t, c);
+
+					if (result->duration > 0.0) {
+						(void)snprintf(buf, sizeof(buf), "%" PRIu32 ":%.3fM(%.2f)",
+							thread_steps[t], result->count / result->duration / 1.0E6,
+							stress_mutex_bench_fairness(result, thread_steps[t]));
+					} else {
+						(void)snprintf(buf, sizeof(buf), "%" PRIu32 ":?", thread_steps[t]);
+					}
+					len += (size_t)snprintf(line + len, sizeof(line) - len, " %-20s", buf);
+				}
+				pr_inf("%s: %s\n", args->name, line);
+			}
+		}
+	}
+
+	/* metrics for the highest thread count */
+	for (l = 0; l < MUTEX_BENCH_LOCKS; l++) {
+		for (c = 0; c < MUTEX_BENCH_CS; c++) {
+			const stress_mutex_bench_result_t *result = MUTEX_BENCH_RESULT(l, n_steps - 1, c);
+			char str[64];
+
+			if (result->duration <= 0.0)
+				continue;
+			(void)snprintf(str, sizeof(str), "%s cs %" PRIu32 " acquires per sec",
+				mutex_bench_locks[l].name, mutex_bench_cs[c]);
+			stress_metrics_set(args, metric++, str,
+				result->count / result->duration, STRESS_METRIC_HARMONIC_MEAN);
+			(void)snprintf(str, sizeof(str), "%s cs %" PRIu32 " fairness max/min",
+				mutex_bench_locks[l].name, mutex_bench_cs[c]);
+			stress_metrics_set(args, metric++, str,
+				stress_mutex_bench_fairness(result, max_threads),
+				STRESS_METRIC_GEOMETRIC_MEAN);
+		}
+	}
+#undef MUTEX_BENCH_RESULT
+
+	free(results);
+	free(threads);
+
+	return rc;
+}
+
 /*
  *  stress_mutex()
  *	stress system with priority changing mutex lock/unlocks
@@ -183,18 +682,22 @@ static int stress_mutex(stress_args_t *args)
 	pthread_info_t pthread_info[MAX_MUTEX_PROCS];
 	uint64_t mutex_procs = DEFAULT_MUTEX_PROCS;
 	bool mutex_affinity = false;
+	bool mutex_bench = false;
 	double duration = 0.0, count = 0.0, rate;
 
 	if (stress_sigchld_set_handler(args) < 0)
 		return EXIT_NO_RESOURCE;
 
 	(void)stress_get_setting("mutex-affinity", &mutex_affinity);
+	(void)stress_get_setting("mutex-bench", &mutex_bench);
 	if (!stress_get_setting("mutex-procs", &mutex_procs)) {
 		if (g_opt_flags & OPT_FLAGS_MAXIMIZE)
 			mutex_procs = MAX_MUTEX_PROCS;
 		if (g_opt_flags & OPT_FLAGS_MINIMIZE)
 			mutex_procs = MIN_MUTEX_PROCS;
 	}
+	if (mutex_bench)
+		return stress_mutex_bench(args, (uint32_t)mutex_procs);
 
 	(void)shim_memset(&pthread_info, 0, sizeof(pthread_info));
 
@@ -19,10 +19,14 @@
  */
 #include "stress-ng.h"
 #include "core-affinity.h"
+#include "core-asm-generic.h"
 #include "core-attribute.h"
 #include "core-bitops.h"
 #include "core-builtin.h"
+#include "core-cgroup.h"
 #include "core-clocksource.h"
+#include "core-cluster.h"
+#include "core-compare.h"
 #include "core-cpuidle.h"
 #include "core-config-check.h"
 #include "core-ftrace.h"
@@ -31,21 +35,34 @@
 #include "core-interrupts.h"
 #include "core-io-priority.h"
 #include "core-job.h"
+#include "core-json.h"
 #include "core-klog.h"
+#include "core-latency.h"
 #include "core-limit.h"
 #include "core-mlock.h"
 #include "core-numa.h"
+#include "core-ksm.h"
+#include "core-memfootprint.h"
+#include "core-mmap.h"
+#include "core-multiver.h"
+#include "core-offcpu.h"
+#include "core-psi.h"
+#include "core-openmetrics.h"
 #include "core-opts.h"
 #include "core-out-of-memory.h"
 #include "core-perf.h"
+#include "core-perf-sample.h"
 #include "core-pragma.h"
+#include "core-probe-cache.h"
 #include "core-rapl.h"
+#include "core-resctrl.h"
 #include "core-shared-heap.h"
 #include "core-smart.h"
 #include "core-stressors.h"
 #include "core-syslog.h"
 #include "core-thermal-zone.h"
 #include "core-thrash.h"
+#include "core-throttle.h"
 #include "core-vmstat.h"
 
 #include <ctype.h>
@@ -56,6 +73,18 @@
 
 #include <sys/times.h>
 
+#if defined(HAVE_SYS_EPOLL_H)
+#include <sys/epoll.h>
+#endif
+
+#if defined(HAVE_SYS_PRCTL_H)
+#include <sys/prctl.h>
+#endif
+
+#if defined(HAVE_PTHREAD_H)
+#include <pthread.h>
+#endif
+
 #if defined(HAVE_SYS_UTSNAME_H)
 #include <sys/utsname.h>
 #endif
@@ -75,6 +104,7 @@
 #define DEFAULT_TIMEOUT		(60 * 60 * 24)
 #define DEFAULT_BACKOFF		(0)
 #define DEFAULT_CACHE_LEVEL     (3)
+#define STRESS_LAUNCHERS_MAX	(256)	/* Max --launchers tree fan-out */
 
 #define STRESS_REPORT_EXIT_SIGNALED		(1)
 
@@ -88,6 +118,19 @@
 #define STRESS_SYNC_START_FLAG_RUNNING		(2)
 #define STRESS_SYNC_START_FLAG_FINISHED		(3)
 
+/* --scale-sweep knee, speedup gained per added instance below this */
+#define STRESS_SCALE_SWEEP_KNEE			(0.5)
+
+/*
+ *  --sync-start stressors park on a shared generation counter futex
+ *  and are released with a single futex wake broadcast, fall back
+ *  to SIGSTOP/SIGCONT if atomic loads and adds are not available
+ */
+#if defined(HAVE_ATOMIC_LOAD) &&	\
+    defined(HAVE_ATOMIC_ADD_FETCH)
+#define STRESS_SYNC_START_FUTEX
+#endif
+
 typedef void (*stress_sighandler_t)(int signum);
 
 typedef struct stress_signal_map {
@@ -113,6 +156,9 @@ static stress_stressor_t *stressors_head, *stressors_tail;
 static volatile bool wait_flag = true;		/* false = exit run wait loop */
 static pid_t main_pid;				/* stress-ng main pid */
 static bool *sigalarmed = NULL;			/* pointer to stressor stats->sigalarmed */
+static bool cpu_cycles_stats = false;		/* true = count stressor cycles */
+static double compare_threshold = STRESS_COMPARE_THRESHOLD_DEFAULT; /* --compare-threshold % */
+static double repeat_cov = 5.0;			/* --repeat-cov % */
 
 /* Globals */
 stress_stressor_t *g_stressor_current;		/* current stressor being invoked */
@@ -150,15 +196,19 @@ static const stress_opt_flag_t opt_flags[] = {
 	{ OPT_abort,		OPT_FLAGS_ABORT },
 	{ OPT_aggressive,	OPT_FLAGS_AGGRESSIVE_MASK },
 	{ OPT_c_states,		OPT_FLAGS_C_STATES },
+	{ OPT_c_states_affinity,OPT_FLAGS_C_STATES },
 	{ OPT_change_cpu,	OPT_FLAGS_CHANGE_CPU },
 	{ OPT_dry_run,		OPT_FLAGS_DRY_RUN },
 	{ OPT_ftrace,		OPT_FLAGS_FTRACE },
+	{ OPT_ftrace_raw,	OPT_FLAGS_FTRACE },
 	{ OPT_ignite_cpu,	OPT_FLAGS_IGNITE_CPU },
+	{ OPT_instance_threads,	OPT_FLAGS_INSTANCE_THREADS },
 	{ OPT_interrupts,	OPT_FLAGS_INTERRUPTS },
 	{ OPT_keep_files, 	OPT_FLAGS_KEEP_FILES },
 	{ OPT_keep_name, 	OPT_FLAGS_KEEP_NAME },
 	{ OPT_klog_check,	OPT_FLAGS_KLOG_CHECK },
 	{ OPT_ksm,		OPT_FLAGS_KSM },
+	{ OPT_latency,		OPT_FLAGS_LATENCY | OPT_FLAGS_METRICS | OPT_FLAGS_PR_METRICS },
 	{ OPT_log_brief,	OPT_FLAGS_LOG_BRIEF },
 	{ OPT_log_lockless,	OPT_FLAGS_LOG_LOCKLESS },
 	{ OPT_maximize,		OPT_FLAGS_MAXIMIZE },
@@ -177,6 +227,7 @@ static const stress_opt_flag_t opt_flags[] = {
 #endif
 	{ OPT_progress,		OPT_FLAGS_PROGRESS },
 	{ OPT_rapl,		OPT_FLAGS_RAPL | OPT_FLAGS_RAPL_REQUIRED },
+	{ OPT_scale_sweep,	OPT_FLAGS_SCALE_SWEEP },
 	{ OPT_settings,		OPT_FLAGS_SETTINGS },
 	{ OPT_skip_silent,	OPT_FLAGS_SKIP_SILENT },
 	{ OPT_smart,		OPT_FLAGS_SMART },
@@ -316,24 +367,39 @@ static const stress_class_info_t stress_classes[] = {
  */
 static const stress_help_t help_generic[] = {
 	{ NULL,		"abort",		"abort all stressors if any stressor fails" },
+	{ NULL,		"agent [A:]P",		"wait for --coordinate jobs on TCP port P, optionally bound to address A" },
 	{ NULL,		"aggressive",		"enable all aggressive options" },
 	{ "a N",	"all N",		"start N workers of each stress test" },
 	{ "b N",	"backoff N",		"wait of N microseconds before work starts" },
 	{ NULL,		"change-cpu",		"force child processes to use different CPU to that of parent" },
 	{ NULL,		"class name",		"specify a class of stressors, use with --sequential" },
+	{ NULL,		"cluster-token F",	"read the --agent/--coordinate shared secret from file F" },
+	{ NULL,		"compare file",		"compare metrics against a baseline YAML file, fail on regressions" },
+	{ NULL,		"compare-threshold P",	"flag metrics that regress by more than P percent (default 5)" },
+	{ NULL,		"coordinate H:P,...",	"send --job file to --agent hosts H:P, start together and merge results" },
 	{ "n",		"dry-run",		"do not run" },
 	{ NULL,		"ftrace",		"enable kernel function call tracing" },
+	{ NULL,		"ftrace-raw",		"trace kernel functions per stressor from the binary ring buffers" },
 	{ "h",		"help",			"show help" },
+	{ NULL,		"hugetlb",		"back anonymous stressor buffers with hugetlb pages" },
+	{ NULL,		"hugetlb-size N",	"back memory stressor buffers with N byte hugetlb pages" },
 	{ NULL,		"ignite-cpu",		"alter kernel controls to make CPU run hot" },
+	{ NULL,		"instance-threads",	"run instances of thread capable stressors as threads" },
+	{ NULL,		"interference S",	"run stressor S alone and then against each other stressor pinned nearby" },
 	{ NULL,		"interrupts",		"check for error interrupts" },
 	{ NULL,		"ionice-class C",	"specify ionice class (idle, besteffort, realtime)" },
 	{ NULL,		"ionice-level L",	"specify ionice level (0 max, 7 min)" },
 	{ NULL,		"iostat S",		"show I/O statistics every S seconds" },
+	{ NULL,		"iostat-yaml F",	"write the --iostat sample series as YAML to file F" },
 	{ "j",		"job jobfile",		"run the named jobfile" },
+	{ NULL,		"json F",		"stream results as JSON records to file F" },
 	{ NULL,		"keep-files",		"do not remove files or directories" },
 	{ "k",		"keep-name",		"keep stress worker names to be 'stress-ng'" },
 	{ "K",		"klog-check",		"check kernel message log for errors" },
 	{ NULL,		"ksm",			"enable kernel samepage merging" },
+	{ NULL,		"latency",		"record latency histograms in instrumented stressors" },
+	{ NULL,		"launchers N",		"fork stressors in parallel using a tree of N-way sub-launchers" },
+	{ NULL,		"lock-type T",		"select lock type (default, ticket, mcs)" },
 	{ NULL,		"log-brief",		"less verbose log messages" },
 	{ NULL,		"log-file filename",	"log messages to a log file" },
 	{ NULL,		"log-lockless",		"log messages without message locking" },
@@ -342,10 +408,15 @@ static const stress_help_t help_generic[] = {
 	{ NULL,		"mbind",		"set NUMA memory binding to specific nodes" },
 	{ "M",		"metrics",		"print pseudo metrics of activity" },
 	{ NULL,		"metrics-brief",	"enable metrics and only show non-zero results" },
+	{ NULL,		"metrics-interval S",	"sample live metrics every S seconds" },
+	{ NULL,		"metrics-interval-file F","stream --metrics-interval samples as JSON lines to file F" },
+	{ NULL,		"metrics-listen A:P",	"serve live OpenMetrics on http://A:P/metrics" },
+	{ NULL,		"mem-footprint",	"report per stressor PSS, USS, THP use and page fault rates" },
 	{ NULL,		"minimize",		"enable minimal stress options" },
 	{ NULL,		"no-madvise",		"don't use random madvise options for each mmap" },
 	{ NULL,		"no-oom-adjust",	"disable all forms of out-of-memory score adjustments" },
 	{ NULL,		"no-rand-seed",		"seed random numbers with the same constant" },
+	{ NULL,		"offcpu",		"report per stressor on-CPU, runqueue wait and blocked time" },
 	{ NULL,		"oom-avoid",		"Try to avoid stressors from being OOM'd" },
 	{ NULL,		"oom-avoid-bytes N",	"Number of bytes free to stop further memory allocations" },
 	{ NULL,		"oomable",		"Do not respawn a stressor if it gets OOM'd" },
@@ -355,12 +426,24 @@ static const stress_help_t help_generic[] = {
 #if defined(STRESS_PERF_STATS) &&	\
     defined(HAVE_LINUX_PERF_EVENT_H)
 	{ NULL,		"perf",			"display perf statistics" },
+#endif
+#if defined(STRESS_PERF_SAMPLE)
+	{ NULL,		"perf-sample N",	"sample stressors and report the top N hottest functions" },
 #endif
 	{ NULL,		"permute N",		"run permutations of stressors with N stressors per permutation" },
+	{ NULL,		"pipeline-seq",		"start the next sequential stressor while the current one winds down" },
+	{ NULL,		"placement P",		"pin instances to CPUs using policy spread, compact, smt, l3 or numa" },
+	{ NULL,		"probe-cache F",	"cache stressor supported probe results in file F" },
+	{ NULL,		"psi",			"report per stressor CPU, memory and I/O pressure stall information" },
 	{ "q",		"quiet",		"quiet output" },
 	{ "r",		"random N",		"start N random workers" },
 	{ NULL,		"rapl",			"report RAPL power domain measurements over entire run (Linux x86 only)" },
 	{ NULL,		"raplstat S",		"show RAPL power domain stats every S seconds (Linux x86 only)" },
+	{ NULL,		"repeat N",		"run each stressor N times and report the mean, stddev and 95% CI" },
+	{ NULL,		"repeat-cov P",		"warn if a --repeat metric coefficient of variation exceeds P percent" },
+	{ NULL,		"repeat-warmup N",	"discard the first N --repeat runs as warm-up runs (default 1)" },
+	{ NULL,		"resctrl S:R=V",	"run stressor S in a resctrl group with L2/L3 cache mask or MB percentage V" },
+	{ NULL,		"scale-sweep",		"run each stressor with 1, 2, 4.. N instances and report the scaling" },
 	{ NULL,		"sched type",		"set scheduler type" },
 	{ NULL,		"sched-prio N",		"set scheduler priority level N" },
 	{ NULL,		"sched-period N",	"set period for SCHED_DEADLINE to N nanosecs (Linux only)" },
@@ -375,14 +458,19 @@ static const stress_help_t help_generic[] = {
 	{ NULL,		"status S",		"show stress-ng progress status every S seconds" },
 	{ NULL,		"stderr",		"all output to stderr" },
 	{ NULL,		"stdout",		"all output to stdout (now the default)" },
+	{ NULL,		"stressor-cgroup S:C=V",	"run stressor S in a cgroup with cgroup v2 control C set to V" },
 	{ NULL,		"stressor-time",	"log start and end run times of each stressor" },
 	{ NULL,		"stressors",		"show available stress tests" },
+	{ NULL,		"sync-start-at T",	"start stressors together at wall clock time T (seconds since the epoch)" },
 #if defined(HAVE_SYSLOG_H)
 	{ NULL,		"syslog",		"log messages to the syslog" },
 #endif
+	{ NULL,		"target-power W",	"throttle stressors to hold RAPL package power at W Watts" },
+	{ NULL,		"target-util P",	"throttle stressors to hold host CPU utilization at P percent" },
 	{ NULL,		"taskset",		"use specific CPUs (set CPU affinity)" },
 	{ NULL,		"temp-path path",	"specify path for temporary directories and files" },
 	{ NULL,		"thermalstat S",	"show CPU and thermal load stats every S seconds" },
+	{ NULL,		"thp P",		"set transparent huge page policy P: default, always or never" },
 	{ NULL,		"thrash",		"force all pages in causing swap thrashing" },
 	{ "t N",	"timeout T",		"timeout after T seconds" },
 	{ NULL,		"timer-slack N",	"set slack slack to N nanoseconds, 0 for default" },
@@ -397,6 +485,7 @@ static const stress_help_t help_generic[] = {
 	{ "V",		"version",		"show version" },
 	{ NULL,		"vmstat S",		"show memory and process statistics every S seconds" },
 	{ NULL,		"vmstat-units U",	"vmstat memory units, one of k | m | g | t | p | e" },
+	{ NULL,		"warmup S",		"exclude the first S seconds (or auto) of each stressor from metrics" },
 	{ "x",		"exclude list",		"list of stressors to exclude (not run)" },
 	{ "w",		"with list",		"list of stressors to invoke (use with --seq or --all)" },
 	{ "Y",		"yaml file",		"output results to YAML formatted file" },
@@ -870,13 +959,20 @@ static const char PURE *stress_opt_name(const int opt_val)
  *	get number of processors, set count if <=0 as:
  *		count = 0 -> number of CPUs in system
  *		count < 0 -> number of CPUs online
+ *	and limit this to the CPUs of the cpuset stress-ng
+ *	is allowed to run on
  */
 static void stress_get_processors(int32_t *count)
 {
-	if (*count == 0)
-		*count = stress_get_processors_configured();
-	else if (*count < 0)
-		*count = stress_get_processors_online();
+	if (*count <= 0) {
+		const int32_t allowed = stress_get_processors_allowed();
+
+		*count = (*count == 0) ?
+			stress_get_processors_configured() :
+			stress_get_processors_online();
+		if (*count > allowed)
+			*count = allowed;
+	}
 }
 
 /*
@@ -909,6 +1005,7 @@ static const char * PURE stress_exit_status_to_string(const int status)
 		{ EXIT_SIGNALED,		"killed by signal" },
 		{ EXIT_BY_SYS_EXIT,		"stressor terminated using _exit()" },
 		{ EXIT_METRICS_UNTRUSTWORTHY,	"metrics may be untrustworthy" },
+		{ EXIT_PERF_REGRESSION,		"performance regression" },
 	};
 	size_t i;
 
@@ -1022,20 +1119,64 @@ void stress_sync_start_wait_s_pid(stress_pid_t *s_pid)
 	stress_start_timeout();
 }
 
+#if defined(STRESS_SYNC_START_FUTEX)
+/*
+ *  stress_sync_start_futex_wait()
+ *	park on the --sync-start barrier futex until the
+ *	barrier generation moves on from generation
+ */
+static void stress_sync_start_futex_wait(const uint32_t generation)
+{
+	for (;;) {
+		uint32_t current;
+		struct timespec timeout;
+
+		__atomic_load(&g_shared->sync_start.generation, &current, __ATOMIC_SEQ_CST);
+		if ((current != generation) || !stress_continue_flag())
+			break;
+
+		/* short timeout so that a missed wake or signal is not fatal */
+		timeout.tv_sec = 0;
+		timeout.tv_nsec = 100000000;
+		if ((shim_futex_wait(&g_shared->sync_start.generation,
+				     (int)generation, &timeout) < 0) && (errno == ENOSYS))
+			(void)shim_usleep(1000);
+	}
+}
+#endif
+
 /*
  *  stress_sync_start_wait()
- *	put stressor into a stop (waiting) state, will be
- *	woken up by a parent call to stress_sync_start_cont_s_pid()
+ *	put stressor into a waiting state on the shared barrier, will
+ *	be woken up by the parent call to stress_sync_start_release(),
+ *	with --sync-start-at the run time starts from the release
  */
 void stress_sync_start_wait(stress_args_t *args)
 {
 	pid_t pid;
 	stress_pid_t *s_pid;
+	uint64_t start_at;
 
 	if (!(g_opt_flags & OPT_FLAGS_SYNC_START))
 		return;
 
 	s_pid = &args->stats->s_pid;
+#if defined(STRESS_SYNC_START_FUTEX)
+	{
+		uint32_t generation;
+
+		/* fetch generation before flagging as waiting to avoid a lost release */
+		__atomic_load(&g_shared->sync_start.generation, &generation, __ATOMIC_SEQ_CST);
+		stress_sync_state_store(s_pid, STRESS_SYNC_START_FLAG_WAITING);
+		stress_sync_start_futex_wait(generation);
+		args->stats->sync_start = stress_time_now();
+		if (stress_get_setting("sync-start-at", &start_at))
+			args->stats->start = args->stats->sync_start;
+		stress_sync_state_store(s_pid, STRESS_SYNC_START_FLAG_RUNNING);
+		stress_start_timeout();
+		return;
+	}
+#endif
 	pid = s_pid->oomable_child ? s_pid->oomable_child : s_pid->pid;
 	if (pid <= 1)
 		return;
@@ -1046,9 +1187,22 @@ void stress_sync_start_wait(stress_args_t *args)
 			args->name, errno, strerror(errno));
 	}
 	stress_sync_state_store(s_pid, STRESS_SYNC_START_FLAG_RUNNING);
+	if (stress_get_setting("sync-start-at", &start_at))
+		args->stats->start = stress_time_now();
 	stress_start_timeout();
 }
 
+/*
+ *  stress_bogo_first_op()
+ *	note the time of the first bogo-op, called when the bogo-op
+ *	counter is first incremented, used by the --times phase breakdown
+ */
+void stress_bogo_first_op(stress_args_t *args)
+{
+	if (args->stats && (args->stats->phase.first_op <= 0.0))
+		args->stats->phase.first_op = stress_time_now();
+}
+
 /*
  *  stress_sync_start_cont_s_pid()
  *	wake up (continue) a stopped process
@@ -1067,6 +1221,79 @@ void stress_sync_start_cont_s_pid(stress_pid_t *s_pid)
 	(void)kill(pid, SIGCONT);
 }
 
+static void stress_json_stressor(const stress_stressor_t *ss);
+
+/*
+ *   stress_wait_exit_status()
+ *	account a stressor instance exit status, returns
+ *	true if the status should abort an --abort run
+ */
+static bool stress_wait_exit_status(
+	stress_stressor_t *ss,
+	const pid_t pid,
+	int *wexit_status,
+	bool *success,
+	bool *resource_success,
+	bool *metrics_success)
+{
+	const char *name = ss->stressor->name;
+	bool do_abort = false;
+
+	switch (*wexit_status) {
+	case EXIT_SUCCESS:
+		ss->status[STRESS_STRESSOR_STATUS_PASSED]++;
+		break;
+	case EXIT_NO_RESOURCE:
+		ss->status[STRESS_STRESSOR_STATUS_SKIPPED]++;
+		pr_warn_skip("%s: [%d] aborted early, out of system resources\n",
+			name, pid);
+		*resource_success = false;
+		do_abort = true;
+		break;
+	case EXIT_NOT_IMPLEMENTED:
+		ss->status[STRESS_STRESSOR_STATUS_SKIPPED]++;
+		do_abort = true;
+		break;
+	case EXIT_SIGNALED:
+		ss->status[STRESS_STRESSOR_STATUS_FAILED]++;
+		do_abort = true;
+		*success = false;
+#if defined(STRESS_REPORT_EXIT_SIGNALED)
+		pr_dbg("%s: [%d] aborted via a termination signal\n",
+			name, pid);
+#endif
+		break;
+	case EXIT_BY_SYS_EXIT:
+		ss->status[STRESS_STRESSOR_STATUS_FAILED]++;
+		pr_dbg("%s: [%d] aborted via exit() which was not expected\n",
+			name, pid);
+		do_abort = true;
+		break;
+	case EXIT_METRICS_UNTRUSTWORTHY:
+		ss->status[STRESS_STRESSOR_STATUS_BAD_METRICS]++;
+		*metrics_success = false;
+		break;
+	case EXIT_FAILURE:
+		ss->status[STRESS_STRESSOR_STATUS_FAILED]++;
+		/*
+		 *  Stressors should really return EXIT_NOT_SUCCESS
+		 *  as EXIT_FAILURE should indicate a core stress-ng
+		 *  problem.
+		 */
+		*wexit_status = EXIT_NOT_SUCCESS;
+		goto wexit_status_default;
+	default:
+wexit_status_default:
+		pr_err("%s: [%d] terminated with an error, exit status=%d (%s)\n",
+			name, pid, *wexit_status,
+			stress_exit_status_to_string(*wexit_status));
+		*success = false;
+		do_abort = true;
+		break;
+	}
+	return do_abort;
+}
+
 /*
  *   stress_wait_pid()
  *	wait for a stressor by their given pid
@@ -1092,6 +1319,7 @@ redo:
 		int wexit_status = WEXITSTATUS(status);
 
 		stats->s_pid.reaped = true;
+		stats->phase.reaped = stress_time_now();
 
 		if (WIFSIGNALED(status)) {
 #if defined(WTERMSIG)
@@ -1128,57 +1356,23 @@ redo:
 				*success = false;
 			}
 		}
-		switch (wexit_status) {
-		case EXIT_SUCCESS:
-			ss->status[STRESS_STRESSOR_STATUS_PASSED]++;
-			break;
-		case EXIT_NO_RESOURCE:
-			ss->status[STRESS_STRESSOR_STATUS_SKIPPED]++;
-			pr_warn_skip("%s: [%d] aborted early, out of system resources\n",
-				name, ret);
-			*resource_success = false;
-			do_abort = true;
-			break;
-		case EXIT_NOT_IMPLEMENTED:
-			ss->status[STRESS_STRESSOR_STATUS_SKIPPED]++;
-			do_abort = true;
-			break;
-		case EXIT_SIGNALED:
-			ss->status[STRESS_STRESSOR_STATUS_FAILED]++;
-			do_abort = true;
-			*success = false;
-#if defined(STRESS_REPORT_EXIT_SIGNALED)
-			pr_dbg("%s: [%d] aborted via a termination signal\n",
-				name, ret);
-#endif
-			break;
-		case EXIT_BY_SYS_EXIT:
-			ss->status[STRESS_STRESSOR_STATUS_FAILED]++;
-			pr_dbg("%s: [%d] aborted via exit() which was not expected\n",
-				name, ret);
-			do_abort = true;
-			break;
-		case EXIT_METRICS_UNTRUSTWORTHY:
-			ss->status[STRESS_STRESSOR_STATUS_BAD_METRICS]++;
-			*metrics_success = false;
-			break;
-		case EXIT_FAILURE:
-			ss->status[STRESS_STRESSOR_STATUS_FAILED]++;
-			/*
-			 *  Stressors should really return EXIT_NOT_SUCCESS
-			 *  as EXIT_FAILURE should indicate a core stress-ng
-			 *  problem.
-			 */
-			wexit_status = EXIT_NOT_SUCCESS;
-			goto wexit_status_default;
-		default:
-wexit_status_default:
-			pr_err("%s: [%d] terminated with an error, exit status=%d (%s)\n",
-				name, ret, wexit_status,
-				stress_exit_status_to_string(wexit_status));
-			*success = false;
-			do_abort = true;
-			break;
+		do_abort = stress_wait_exit_status(ss, ret, &wexit_status,
+				success, resource_success, metrics_success);
+		/* instance threads exit with instance 0 */
+		if (stats == ss->stats[0]) {
+			int32_t j;
+
+			for (j = 1; j < ss->instances; j++) {
+				int thread_status;
+
+				if (!ss->stats[j] || !ss->stats[j]->instance_thread)
+					continue;
+				thread_status = (ss->stats[j]->exit_status < 0) ?
+					WEXITSTATUS(status) : ss->stats[j]->exit_status;
+				if (stress_wait_exit_status(ss, ret, &thread_status,
+						success, resource_success, metrics_success))
+					do_abort = true;
+			}
 		}
 		if ((g_opt_flags & OPT_FLAGS_ABORT) && do_abort) {
 			stress_continue_set_flag(false);
@@ -1190,6 +1384,18 @@ wexit_status_default:
 		pr_dbg("%s: [%d] terminated (%s)\n",
 			name, ret,
 			stress_exit_status_to_string(wexit_status));
+
+		if (stress_json_enabled()) {
+			int32_t j;
+
+			/* stream the stressor results once its last instance is reaped */
+			for (j = 0; j < ss->instances; j++) {
+				if (ss->stats[j] && !ss->stats[j]->s_pid.reaped)
+					break;
+			}
+			if (j == ss->instances)
+				stress_json_stressor(ss);
+		}
 	} else if (ret == -1) {
 		/* Somebody interrupted the wait */
 		if (errno == EINTR)
@@ -1200,6 +1406,208 @@ wexit_status_default:
 	}
 }
 
+#if defined(HAVE_SYS_EPOLL_H) &&	\
+    defined(HAVE_EPOLL_CREATE1) &&	\
+    defined(EPOLL_CLOEXEC) &&		\
+    defined(__linux__)
+#define STRESS_PIDFD_REAPER
+#endif
+
+/* a stressor instance waited on by the pidfd reaper */
+typedef struct {
+	stress_stressor_t *ss;		/* stressor of the instance */
+	stress_stats_t *stats;		/* instance stats */
+	int32_t instance;		/* instance number */
+	int pidfd;			/* pidfd of the instance, -1 when reaped */
+} stress_reaper_pid_t;
+
+/*
+ *  pidfd reaper, the parent sleeps in epoll_wait until a stressor
+ *  exits and then only reaps the stressors with ready pidfds rather
+ *  than walking all the instances on every wakeup
+ */
+typedef struct {
+	int epfd;			/* epoll fd, -1 if the reaper is not used */
+	size_t n_pids;			/* number of pidfds opened */
+	size_t n_alive;			/* number of pidfds not yet ready */
+	stress_reaper_pid_t *pids;	/* instances being waited on */
+} stress_reaper_t;
+
+/*
+ *  stress_reaper_free()
+ *	close any pidfds left and the epoll fd
+ */
+static void stress_reaper_free(stress_reaper_t *reaper)
+{
+	size_t i;
+
+	if (reaper->pids) {
+		for (i = 0; i < reaper->n_pids; i++) {
+			if (reaper->pids[i].pidfd >= 0)
+				(void)close(reaper->pids[i].pidfd);
+		}
+		free(reaper->pids);
+		reaper->pids = NULL;
+	}
+	if (reaper->epfd >= 0)
+		(void)close(reaper->epfd);
+	reaper->epfd = -1;
+	reaper->n_pids = 0;
+	reaper->n_alive = 0;
+}
+
+/*
+ *  stress_reaper_init()
+ *	open a pidfd for each running stressor and add it to an
+ *	epoll set, returns false if pidfds or epoll are not available
+ *	and the waitpid reaping should be used instead
+ */
+static bool stress_reaper_init(stress_reaper_t *reaper, stress_stressor_t *stressors_list)
+{
+#if defined(STRESS_PIDFD_REAPER)
+	stress_stressor_t *ss;
+	size_t n_pids = 0;
+
+	reaper->epfd = -1;
+	reaper->n_pids = 0;
+	reaper->n_alive = 0;
+	reaper->pids = NULL;
+
+	for (ss = stressors_list; ss; ss = ss->next) {
+		if (!ss->ignore.run && !ss->ignore.permute)
+			n_pids += (size_t)ss->instances;
+	}
+	if (!n_pids)
+		return false;
+	reaper->pids = (stress_reaper_pid_t *)calloc(n_pids, sizeof(*reaper->pids));
+	if (!reaper->pids)
+		return false;
+	reaper->epfd = epoll_create1(EPOLL_CLOEXEC);
+	if (reaper->epfd < 0) {
+		stress_reaper_free(reaper);
+		return false;
+	}
+
+	for (ss = stressors_list; ss; ss = ss->next) {
+		int32_t j;
+
+		if (ss->ignore.run || ss->ignore.permute)
+			continue;
+
+		for (j = 0; j < ss->instances; j++) {
+			stress_stats_t *const stats = ss->stats[j];
+			stress_reaper_pid_t *rp = &reaper->pids[reaper->n_pids];
+			const pid_t pid = stats->s_pid.pid;
+			struct epoll_event ev;
+
+			if (!pid || stats->s_pid.reaped)
+				continue;
+			rp->pidfd = shim_pidfd_open(pid, 0);
+			if (rp->pidfd < 0) {
+				/* gone already, leave it to the waitpid reaping */
+				if (errno == ESRCH)
+					continue;
+				stress_reaper_free(reaper);
+				return false;
+			}
+			rp->ss = ss;
+			rp->stats = stats;
+			rp->instance = j;
+			(void)shim_memset(&ev, 0, sizeof(ev));
+			ev.events = EPOLLIN;
+			ev.data.ptr = (void *)rp;
+			reaper->n_pids++;
+			if (epoll_ctl(reaper->epfd, EPOLL_CTL_ADD, rp->pidfd, &ev) < 0) {
+				stress_reaper_free(reaper);
+				return false;
+			}
+		}
+	}
+	if (!reaper->n_pids) {
+		stress_reaper_free(reaper);
+		return false;
+	}
+	reaper->n_alive = reaper->n_pids;
+	pr_dbg("reaping %zu stressor%s using pidfds\n", reaper->n_pids,
+		(reaper->n_pids == 1) ? "" : "s");
+	return true;
+#else
+	(void)stressors_list;
+
+	reaper->epfd = -1;
+	reaper->n_pids = 0;
+	reaper->n_alive = 0;
+	reaper->pids = NULL;
+	return false;
+#endif
+}
+
+/*
+ *  stress_reaper_wait()
+ *	wait up to timeout_ms milliseconds (-1 = forever) for stressors
+ *	to exit and reap the ones with ready pidfds, returns -1 if
+ *	epoll_wait failed
+ */
+static int stress_reaper_wait(
+	stress_reaper_t *reaper,
+	const int timeout_ms,
+	bool *success,
+	bool *resource_success,
+	bool *metrics_success)
+{
+#if defined(STRESS_PIDFD_REAPER)
+	struct epoll_event events[64];
+	int i, n;
+
+	n = epoll_wait(reaper->epfd, events, (int)SIZEOF_ARRAY(events), timeout_ms);
+	if (n < 0)
+		return (errno == EINTR) ? 0 : -1;
+
+	for (i = 0; i < n; i++) {
+		stress_reaper_pid_t *rp = (stress_reaper_pid_t *)events[i].data.ptr;
+		const pid_t pid = rp->stats->s_pid.pid;
+
+		if (pid) {
+			stress_wait_pid(rp->ss, pid, rp->stats,
+				success, resource_success, metrics_success, 0);
+			stress_clean_dir(rp->ss->stressor->name, pid, (uint32_t)rp->instance);
+		}
+		(void)epoll_ctl(reaper->epfd, EPOLL_CTL_DEL, rp->pidfd, NULL);
+		(void)close(rp->pidfd);
+		rp->pidfd = -1;
+		reaper->n_alive--;
+	}
+	return n;
+#else
+	(void)reaper;
+	(void)timeout_ms;
+	(void)success;
+	(void)resource_success;
+	(void)metrics_success;
+
+	return -1;
+#endif
+}
+
+/*
+ *  --pipeline-seq state, the next stressor to run is forked
+ *  and parked on the sync-start barrier while the current stressor
+ *  winds down and is reaped
+ */
+typedef struct {
+	stress_stressor_t *ss;		/* next stressor to pre-start, NULL = none */
+	stress_stressor_t *started_ss;	/* stressor that has been pre-started */
+	stress_pid_t *s_pids_head;	/* sync-start list of pre-started stressor */
+	stress_checksum_t *checksum;	/* checksum of next stressor, then after it */
+	int32_t started_instances;	/* number of pre-started instances */
+	double deadline;		/* time to pre-start the next stressor */
+	bool started;			/* true = pre-started and not yet run */
+} stress_pipeline_t;
+
+static stress_pipeline_t pipeline;
+
+static void stress_pipeline_start(const int32_t ticks_per_sec);
+
 #if defined(HAVE_SCHED_GETAFFINITY) &&	\
     NEED_GLIBC(2,3,0)
 /*
@@ -1210,6 +1618,7 @@ wexit_status_default:
 static void stress_wait_aggressive(
 	const int32_t ticks_per_sec,
 	stress_stressor_t *stressors_list,
+	stress_reaper_t *reaper,
 	bool *success,
 	bool *resource_success,
 	bool *metrics_success)
@@ -1234,7 +1643,14 @@ static void stress_wait_aggressive(
 		if (!CPU_COUNT(&proc_mask))	/* Highly unlikely */
 			return;
 
-		(void)shim_usleep(usec_sleep);
+		if (reaper->epfd >= 0) {
+			/* sleep until a stressor exits or the next affinity change */
+			if (stress_reaper_wait(reaper, (int)((usec_sleep + 999) / 1000),
+					success, resource_success, metrics_success) < 0)
+				stress_reaper_free(reaper);
+		} else {
+			(void)shim_usleep(usec_sleep);
+		}
 
 		for (ss = stressors_list; ss; ss = ss->next) {
 			int32_t j;
@@ -1250,9 +1666,10 @@ static void stress_wait_aggressive(
 					cpu_set_t mask;
 					int32_t cpu_num;
 
-					stress_wait_pid(ss, pid, stats,
-						success, resource_success,
-						metrics_success, WNOHANG);
+					if (reaper->epfd < 0)
+						stress_wait_pid(ss, pid, stats,
+							success, resource_success,
+							metrics_success, WNOHANG);
 
 					/* PID not reaped by the WNOHANG waitpid? */
 					if (!stats->s_pid.reaped)
@@ -1270,19 +1687,25 @@ static void stress_wait_aggressive(
 				}
 			}
 		}
+		if (reaper->epfd >= 0)
+			procs_alive = (reaper->n_alive > 0);
 		if (!procs_alive)
 			break;
 	}
 }
 #endif
 
-void stress_sync_start_cont_list(stress_pid_t *s_pids_head)
+/*
+ *  stress_sync_start_release_list()
+ *	wait for all the processes in the s_pids_head list to be
+ *	waiting and then wake them up, broadcast = true wakes the
+ *	processes parked on the shared futex barrier, otherwise
+ *	stopped processes are continued with SIGCONT
+ */
+static void stress_sync_start_release_list(stress_pid_t *s_pids_head, const bool broadcast)
 {
 	int unready, n_pids;
 
-	if (!(g_opt_flags & OPT_FLAGS_SYNC_START))
-		return;
-
 	do {
 		stress_pid_t *s_pid;
 
@@ -1305,13 +1728,20 @@ void stress_sync_start_cont_list(stress_pid_t *s_pids_head)
 	} while (stress_continue_flag());
 
 	if (!unready) {
+#if defined(STRESS_SYNC_START_FUTEX)
+		if (broadcast) {
+			(void)__atomic_add_fetch(&g_shared->sync_start.generation, 1, __ATOMIC_SEQ_CST);
+			(void)shim_futex_wake(&g_shared->sync_start.generation, INT_MAX);
+		}
+#endif
 		do {
 			stress_pid_t *s_pid;
 			int running = 0, finished = 0;
 			uint8_t state;
 
 			for (s_pid = s_pids_head; s_pid; s_pid = s_pid->next) {
-				stress_sync_start_cont_s_pid(s_pid);
+				if (!broadcast)
+					stress_sync_start_cont_s_pid(s_pid);
 				stress_sync_state_load(s_pid, &state);
 				if (state == STRESS_SYNC_START_FLAG_FINISHED)
 					finished++;
@@ -1321,39 +1751,97 @@ void stress_sync_start_cont_list(stress_pid_t *s_pids_head)
 			if ((running + finished) == n_pids)
 				break;
 			(void)shim_usleep(10000);
+#if defined(STRESS_SYNC_START_FUTEX)
+			if (broadcast)
+				(void)shim_futex_wake(&g_shared->sync_start.generation, INT_MAX);
+#endif
 		} while (stress_continue_flag());
 	}
 }
 
 /*
- *  stress_wait_stressors()
- * 	wait for stressor child processes
+ *  stress_sync_start_cont_list()
+ *	wait for all the stopped processes in the s_pids_head list
+ *	to be waiting and then continue them
  */
-static void stress_wait_stressors(
+void stress_sync_start_cont_list(stress_pid_t *s_pids_head)
+{
+	if (!(g_opt_flags & OPT_FLAGS_SYNC_START))
+		return;
+
+	stress_sync_start_release_list(s_pids_head, false);
+}
+
+/*
+ *  stress_sync_start_at_delay()
+ *	seconds until the --sync-start-at start time, 0 if not set
+ *	or already passed, stressors waiting on the barrier until
+ *	then should not have this counted against their run time
+ */
+static double stress_sync_start_at_delay(void)
+{
+	uint64_t start_at = 0;
+	double delta;
+
+	if (!(g_opt_flags & OPT_FLAGS_SYNC_START) ||
+	    !stress_get_setting("sync-start-at", &start_at))
+		return 0.0;
+	delta = (double)start_at - stress_time_now();
+	return (delta > 0.0) ? delta : 0.0;
+}
+
+/*
+ *  stress_sync_start_at_wait()
+ *	wait until the --sync-start-at wall clock time before the
+ *	first release, hosts with synchronised clocks (e.g. NTP)
+ *	then start their stressors together
+ */
+static void stress_sync_start_at_wait(void)
+{
+	static bool waited = false;
+	uint64_t start_at = 0;
+	double delta;
+
+	if (waited || !stress_get_setting("sync-start-at", &start_at))
+		return;
+	waited = true;
+
+	delta = (double)start_at - stress_time_now();
+	if (delta < 0.0) {
+		pr_warn("sync-start-at: start time passed %.3f seconds ago, starting now\n", -delta);
+		return;
+	}
+	pr_dbg("sync-start-at: waiting %.3f seconds for start time %" PRIu64 "\n", delta, start_at);
+	while (stress_continue_flag()) {
+		delta = (double)start_at - stress_time_now();
+		if (delta <= 0.0)
+			break;
+		/* sleep in short chunks to respond to signals and clock steps */
+		(void)shim_nanosleep_uint64((uint64_t)(STRESS_MINIMUM(delta, 0.1) * STRESS_DBL_NANOSECOND));
+	}
+}
+
+/*
+ *  stress_sync_start_release()
+ *	release all the stressors waiting on the --sync-start
+ *	barrier and account for the spread of start times
+ */
+static void stress_sync_start_release(
 	stress_pid_t *s_pids_head,
-	const int32_t ticks_per_sec,
-	stress_stressor_t *stressors_list,
-	bool *success,
-	bool *resource_success,
-	bool *metrics_success)
+	stress_stressor_t *stressors_list)
 {
+#if defined(STRESS_SYNC_START_FUTEX)
 	stress_stressor_t *ss;
+	double first = DBL_MAX, last = 0.0, spread, t_release;
+	int32_t released = 0;
 
-	stress_sync_start_cont_list(s_pids_head);
+	if (!(g_opt_flags & OPT_FLAGS_SYNC_START))
+		return;
+
+	stress_sync_start_at_wait();
+	t_release = stress_time_now();
+	stress_sync_start_release_list(s_pids_head, true);
 
-#if defined(HAVE_SCHED_GETAFFINITY) &&	\
-    NEED_GLIBC(2,3,0)
-	/*
-	 *  On systems that support changing CPU affinity
-	 *  we keep on moving processes between processors
-	 *  to impact on memory locality (e.g. NUMA) to
-	 *  try to thrash the system when in aggressive mode
-	 */
-	if (g_opt_flags & (OPT_FLAGS_AGGRESSIVE | OPT_FLAGS_TASKSET_RANDOM))
-		stress_wait_aggressive(ticks_per_sec, stressors_list, success, resource_success, metrics_success);
-#else
-	(void)ticks_per_sec;
-#endif
 	for (ss = stressors_list; ss; ss = ss->next) {
 		int32_t j;
 
@@ -1361,40 +1849,273 @@ static void stress_wait_stressors(
 			continue;
 
 		for (j = 0; j < ss->instances; j++) {
-			stress_stats_t *const stats = ss->stats[j];
-			const pid_t pid = stats->s_pid.pid;
-
-			if (pid) {
-				const char *name = ss->stressor->name;
+			const double t = ss->stats[j]->sync_start;
 
-				stress_wait_pid(ss, pid, stats,
-					success, resource_success, metrics_success, 0);
-				stress_clean_dir(name, pid, (uint32_t)j);
-			}
+			if (t < t_release)
+				continue;
+			if (t < first)
+				first = t;
+			if (t > last)
+				last = t;
+			released++;
 		}
 	}
-	if (g_opt_flags & OPT_FLAGS_IGNITE_CPU)
-		stress_ignite_cpu_stop();
+	if (!released)
+		return;
+
+	spread = last - first;
+	g_shared->sync_start.releases++;
+	g_shared->sync_start.spread_total += spread;
+	if (spread > g_shared->sync_start.spread_max)
+		g_shared->sync_start.spread_max = spread;
+	pr_dbg("sync-start: released %" PRId32 " stressor%s, start spread %.3f usecs\n",
+		released, (released == 1) ? "" : "s", spread * STRESS_DBL_MICROSECOND);
+#else
+	(void)stressors_list;
+
+	if (g_opt_flags & OPT_FLAGS_SYNC_START)
+		stress_sync_start_at_wait();
+	stress_sync_start_cont_list(s_pids_head);
+#endif
 }
 
 /*
- *  stress_handle_terminate()
- *	catch terminating signals
+ *  stress_placement_dump()
+ *	output the --placement instance to CPU map
  */
-static void MLOCKED_TEXT stress_handle_terminate(int signum)
+static void stress_placement_dump(FILE *yaml, stress_stressor_t *stressors_list)
 {
-	static char buf[128];
-	const int fd = fileno(stderr);
-	stress_continue_set_flag(false);
+	int32_t placement = STRESS_PLACEMENT_NONE;
+	stress_stressor_t *ss;
 
-	switch (signum) {
-	case SIGILL:
-	case SIGSEGV:
-	case SIGFPE:
-	case SIGBUS:
-	case SIGABRT:
-		/*
-		 *  Critical failure, report and die ASAP
+	(void)stress_get_setting("placement", &placement);
+	if ((placement == STRESS_PLACEMENT_NONE) || (stress_placement_cpu(0) < 0))
+		return;
+
+	pr_yaml(yaml, "placement:\n");
+	pr_yaml(yaml, "      policy: %s\n", stress_placement_name((stress_placement_policy_t)placement));
+	pr_yaml(yaml, "      cpus:\n");
+	for (ss = stressors_list; ss; ss = ss->next) {
+		int32_t j;
+
+		if (ss->ignore.run)
+			continue;
+		for (j = 0; j < ss->instances; j++) {
+			const int32_t cpu = ss->stats[j]->placement_cpu;
+
+			if (cpu < 0)
+				continue;
+			pr_dbg("placement: %s instance %" PRId32 " on CPU %" PRId32 "\n",
+				ss->stressor->name, j, cpu);
+			pr_yaml(yaml, "        - stressor: %s\n", ss->stressor->name);
+			pr_yaml(yaml, "          instance: %" PRId32 "\n", j);
+			pr_yaml(yaml, "          cpu: %" PRId32 "\n", cpu);
+		}
+	}
+}
+
+/*
+ *  stress_scale_sweep_knee()
+ *	find the step where scaling flattens, this is the last
+ *	step before the speedup gained per added instance drops
+ *	below STRESS_SCALE_SWEEP_KNEE, returns -1 if there is none
+ */
+static ssize_t stress_scale_sweep_knee(const stress_stressor_t *ss)
+{
+	const stress_scale_sweep_step_t *steps = ss->scale_sweep.steps;
+	const double rate1 = steps[0].rate;
+	size_t i;
+
+	if (rate1 <= 0.0)
+		return -1;
+
+	for (i = 1; i < ss->scale_sweep.n_steps; i++) {
+		const double speedup_gain = (steps[i].rate - steps[i - 1].rate) / rate1;
+		const double instances_added = (double)(steps[i].instances - steps[i - 1].instances);
+
+		if (speedup_gain / instances_added < STRESS_SCALE_SWEEP_KNEE)
+			return (ssize_t)i - 1;
+	}
+	return -1;
+}
+
+/*
+ *  stress_scale_sweep_dump()
+ *	output the --scale-sweep throughput, speedup and
+ *	efficiency for each instance count
+ */
+static void stress_scale_sweep_dump(FILE *yaml, stress_stressor_t *stressors_list)
+{
+	stress_stressor_t *ss;
+	bool header = false;
+
+	if (!(g_opt_flags & OPT_FLAGS_SCALE_SWEEP))
+		return;
+
+	pr_block_begin();
+	for (ss = stressors_list; ss; ss = ss->next) {
+		const stress_scale_sweep_step_t *steps = ss->scale_sweep.steps;
+		const char *name = ss->stressor->name;
+		ssize_t knee;
+		size_t i;
+
+		if (!steps || !ss->scale_sweep.n_steps)
+			continue;
+
+		if (!header) {
+			pr_inf("scale-sweep: %-13s %9s %12s %12s %8s %10s\n",
+				"stressor", "instances", "bogo ops", "bogo ops/s",
+				"speedup", "efficiency");
+			pr_yaml(yaml, "scale-sweep:\n");
+			header = true;
+		}
+		knee = stress_scale_sweep_knee(ss);
+		pr_yaml(yaml, "    - stressor: %s\n", name);
+		pr_yaml(yaml, "      knee-instances: %" PRId32 "\n",
+			(knee < 0) ? 0 : steps[knee].instances);
+		pr_yaml(yaml, "      steps:\n");
+
+		for (i = 0; i < ss->scale_sweep.n_steps; i++) {
+			const double speedup = (steps[0].rate > 0.0) ?
+				steps[i].rate / steps[0].rate : 0.0;
+			const double efficiency = 100.0 * speedup / (double)steps[i].instances;
+
+			pr_inf("scale-sweep: %-13s %9" PRId32 " %12" PRIu64 " %12.2f %8.2f %9.2f%%\n",
+				name, steps[i].instances, steps[i].bogo_ops,
+				steps[i].rate, speedup, efficiency);
+			pr_yaml(yaml, "        - instances: %" PRId32 "\n", steps[i].instances);
+			pr_yaml(yaml, "          bogo-ops: %" PRIu64 "\n", steps[i].bogo_ops);
+			pr_yaml(yaml, "          bogo-ops-per-second: %f\n", steps[i].rate);
+			pr_yaml(yaml, "          speedup: %f\n", speedup);
+			pr_yaml(yaml, "          efficiency-percent: %f\n", efficiency);
+		}
+		if (knee < 0) {
+			pr_inf("scale-sweep: %s scales to %" PRId32 " instances\n",
+				name, steps[ss->scale_sweep.n_steps - 1].instances);
+		} else {
+			pr_inf("scale-sweep: %s scaling flattens after %" PRId32 " instance%s\n",
+				name, steps[knee].instances, steps[knee].instances == 1 ? "" : "s");
+		}
+	}
+	pr_block_end();
+}
+
+/*
+ *  stress_sync_start_dump()
+ *	output the --sync-start barrier start time spread
+ */
+static void stress_sync_start_dump(FILE *yaml)
+{
+	const uint32_t releases = g_shared->sync_start.releases;
+
+	if (!(g_opt_flags & OPT_FLAGS_SYNC_START) || !releases)
+		return;
+
+	pr_yaml(yaml, "sync-start:\n");
+	pr_yaml(yaml, "      releases: %" PRIu32 "\n", releases);
+	pr_yaml(yaml, "      start-spread-max-usecs: %f\n",
+		g_shared->sync_start.spread_max * STRESS_DBL_MICROSECOND);
+	pr_yaml(yaml, "      start-spread-mean-usecs: %f\n",
+		(g_shared->sync_start.spread_total / (double)releases) * STRESS_DBL_MICROSECOND);
+}
+
+/*
+ *  stress_wait_stressors()
+ * 	wait for stressor child processes
+ */
+static void stress_wait_stressors(
+	stress_pid_t *s_pids_head,
+	const int32_t ticks_per_sec,
+	stress_stressor_t *stressors_list,
+	bool *success,
+	bool *resource_success,
+	bool *metrics_success)
+{
+	stress_stressor_t *ss;
+	stress_reaper_t reaper;
+
+	stress_sync_start_release(s_pids_head, stressors_list);
+	(void)stress_reaper_init(&reaper, stressors_list);
+	if (pipeline.ss)
+		pipeline.deadline = stress_time_now() + (double)g_opt_timeout;
+
+#if defined(HAVE_SCHED_GETAFFINITY) &&	\
+    NEED_GLIBC(2,3,0)
+	/*
+	 *  On systems that support changing CPU affinity
+	 *  we keep on moving processes between processors
+	 *  to impact on memory locality (e.g. NUMA) to
+	 *  try to thrash the system when in aggressive mode
+	 */
+	if (g_opt_flags & (OPT_FLAGS_AGGRESSIVE | OPT_FLAGS_TASKSET_RANDOM))
+		stress_wait_aggressive(ticks_per_sec, stressors_list, &reaper,
+			success, resource_success, metrics_success);
+#else
+	(void)ticks_per_sec;
+#endif
+	while ((reaper.epfd >= 0) && (reaper.n_alive > 0)) {
+		int timeout_ms = -1;
+
+		if (pipeline.ss && !pipeline.started) {
+			const double delta = pipeline.deadline - stress_time_now();
+
+			if (delta <= 0.0) {
+				/* run time is up, set up the next stressor while this one winds down */
+				if (stress_continue_flag())
+					stress_pipeline_start(ticks_per_sec);
+				pipeline.ss = NULL;
+			} else {
+				timeout_ms = (int)(delta * 1000.0) + 1;
+			}
+		}
+		if (stress_reaper_wait(&reaper, timeout_ms, success, resource_success, metrics_success) < 0)
+			break;
+	}
+	pipeline.ss = NULL;
+	stress_reaper_free(&reaper);
+
+	/* reap any stressors not handled by the pidfd reaper */
+	for (ss = stressors_list; ss; ss = ss->next) {
+		int32_t j;
+
+		if (ss->ignore.run || ss->ignore.permute)
+			continue;
+
+		for (j = 0; j < ss->instances; j++) {
+			stress_stats_t *const stats = ss->stats[j];
+			const pid_t pid = stats->s_pid.pid;
+
+			if (pid) {
+				const char *name = ss->stressor->name;
+
+				stress_wait_pid(ss, pid, stats,
+					success, resource_success, metrics_success, 0);
+				stress_clean_dir(name, pid, (uint32_t)j);
+			}
+		}
+	}
+	if (g_opt_flags & OPT_FLAGS_IGNITE_CPU)
+		stress_ignite_cpu_stop();
+}
+
+/*
+ *  stress_handle_terminate()
+ *	catch terminating signals
+ */
+static void MLOCKED_TEXT stress_handle_terminate(int signum)
+{
+	static char buf[128];
+	const int fd = fileno(stderr);
+	stress_continue_set_flag(false);
+
+	switch (signum) {
+	case SIGILL:
+	case SIGSEGV:
+	case SIGFPE:
+	case SIGBUS:
+	case SIGABRT:
+		/*
+		 *  Critical failure, report and die ASAP
 		 */
 		(void)snprintf(buf, sizeof(buf), "%s: info:  [%" PRIdMAX "] stressor terminated with unexpected %s\n",
 			g_app_name, (intmax_t)getpid(), stress_strsignal(signum));
@@ -1456,6 +2177,8 @@ static void stress_stressors_free(void)
 	while (ss) {
 		stress_stressor_t *next = ss->next;
 
+		free(ss->scale_sweep.steps);
+		free(ss->repeat.samples);
 		free(ss->stats);
 		free(ss);
 		ss = next;
@@ -1489,6 +2212,202 @@ static void NORETURN stress_child_atexit(void)
 	_exit(EXIT_BY_SYS_EXIT);
 }
 
+/*
+ *  stress_metrics_items_alloc()
+ *	allocate the misc metrics items of a stressor instance on the
+ *	shared heap, sized by the number of metrics declared by the
+ *	stressor or STRESS_MISC_METRICS_MAX if undeclared. The heap is
+ *	zero'd and never re-used, so pages of unused items are never
+ *	faulted in. Grows if an index beyond the declared size is set,
+ *	the copy and publish is done under the shared heap lock so that
+ *	concurrent growth by instance threads does not lose items.
+ *	Returns false if out of heap.
+ */
+static bool stress_metrics_items_alloc(
+	const stress_args_t *args,
+	stress_metrics_data_t *metrics,
+	const size_t idx)
+{
+	stress_metrics_item_t *items;
+	size_t n = (args->info && args->info->metrics_max) ?
+		args->info->metrics_max : STRESS_MISC_METRICS_MAX;
+
+	while (n <= idx)
+		n <<= 1;
+	if (n > STRESS_MISC_METRICS_MAX)
+		n = STRESS_MISC_METRICS_MAX;
+
+	/* allocate before locking, the heap allocator may take the lock */
+	items = (stress_metrics_item_t *)stress_shared_heap_malloc(n * sizeof(*items));
+	if (UNLIKELY(!items))
+		return false;
+	if (UNLIKELY(stress_lock_acquire(g_shared->shared_heap.lock) < 0))
+		return false;
+	/* another thread may have grown the items while waiting for the lock */
+	if (metrics->n_items > idx) {
+		(void)stress_lock_release(g_shared->shared_heap.lock);
+		return true;
+	}
+	if (metrics->items)
+		(void)shim_memcpy(items, metrics->items, metrics->n_items * sizeof(*items));
+
+	/* publish items before the size, readers check the size first */
+	metrics->items = items;
+	stress_asm_mb();
+	metrics->n_items = n;
+	(void)stress_lock_release(g_shared->shared_heap.lock);
+	return true;
+}
+
+/*
+ *  stress_metrics_item()
+ *	return the idx'th misc metrics item of a stressor instance,
+ *	NULL if it has not been allocated
+ */
+static inline const stress_metrics_item_t *stress_metrics_item(
+	const stress_stats_t *stats,
+	const size_t idx)
+{
+	if (!stats || (idx >= stats->metrics.n_items))
+		return NULL;
+	return &stats->metrics.items[idx];
+}
+
+/*
+ *  stress_metrics_combine()
+ *	combine the idx'th misc metric of all the instances of a
+ *	stressor using the mean type the stressor set it with
+ */
+static double stress_metrics_combine(const stress_stressor_t *ss, const size_t idx)
+{
+	const stress_metrics_item_t *item;
+	double n = 0.0, sum = 0.0, maximum = 0.0, mantissa = 1.0;
+	int64_t exponent = 0;
+	int32_t j;
+
+	for (j = 0; j < ss->instances; j++) {
+		int e;
+
+		item = stress_metrics_item(ss->stats[j], idx);
+		if (!item || !((item->value > 0.0) || (item->value < 0.0)))
+			continue;
+		switch (ss->stats[0]->metrics.items[idx].mean_type) {
+		case STRESS_METRIC_GEOMETRIC_MEAN:
+			mantissa *= frexp(item->value, &e);
+			exponent += e;
+			n += 1.0;
+			break;
+		case STRESS_METRIC_HARMONIC_MEAN:
+			sum += 1.0 / item->value;
+			n += 1.0;
+			break;
+		case STRESS_METRIC_TOTAL:
+			if (item->value > 0.0)
+				sum += item->value;
+			break;
+		case STRESS_METRIC_MAXIMUM:
+			if (item->value > maximum)
+				maximum = item->value;
+			break;
+		}
+	}
+	switch (ss->stats[0]->metrics.items[idx].mean_type) {
+	case STRESS_METRIC_GEOMETRIC_MEAN:
+		return (n > 0.0) ? pow(mantissa, 1.0 / n) * pow(2.0, (double)exponent / n) : 0.0;
+	case STRESS_METRIC_HARMONIC_MEAN:
+		return (sum > 0.0) ? n / sum : 0.0;
+	case STRESS_METRIC_TOTAL:
+		return sum;
+	case STRESS_METRIC_MAXIMUM:
+		return maximum;
+	}
+	return 0.0;
+}
+
+/*
+ *  stress_json_stressor()
+ *	write a --json record of the results of a stressor, this is
+ *	called as soon as all the instances have been reaped so that
+ *	results are streamed out as each stressor completes
+ */
+static void stress_json_stressor(const stress_stressor_t *ss)
+{
+	stress_json_t json;
+	uint64_t c_total = 0;
+	double r_total = 0.0, u_total = 0.0, s_total = 0.0;
+	long int maxrss = 0;
+	int32_t j, completed = 0;
+	size_t i;
+
+	if (!ss->stats)
+		return;
+
+	for (j = 0; j < ss->instances; j++) {
+		const stress_stats_t *const stats = ss->stats[j];
+
+		if (stats->completed) {
+			r_total += stats->duration_total;
+			completed++;
+		}
+		c_total += stats->counter_total;
+		u_total += stats->rusage_utime_total;
+		s_total += stats->rusage_stime_total;
+#if defined(HAVE_RUSAGE_RU_MAXRSS)
+		if (maxrss < stats->rusage_maxrss)
+			maxrss = stats->rusage_maxrss;
+#endif
+	}
+	/* Real time in terms of average wall clock time of all procs */
+	r_total = completed ? r_total / (double)completed : 0.0;
+
+	stress_json_begin(&json, "stressor");
+	stress_json_double(&json, "run-time", stress_time_now() - g_shared->time_started);
+	stress_json_str(&json, "stressor", ss->stressor->name);
+	stress_json_int64(&json, "instances", (int64_t)ss->instances);
+	stress_json_int64(&json, "completed-instances", (int64_t)completed);
+	stress_json_uint64(&json, "passed", ss->status[STRESS_STRESSOR_STATUS_PASSED]);
+	stress_json_uint64(&json, "failed", ss->status[STRESS_STRESSOR_STATUS_FAILED]);
+	stress_json_uint64(&json, "skipped", ss->status[STRESS_STRESSOR_STATUS_SKIPPED]);
+	stress_json_uint64(&json, "metrics-untrustworthy", ss->status[STRESS_STRESSOR_STATUS_BAD_METRICS]);
+	stress_json_uint64(&json, "bogo-ops", c_total);
+	stress_json_double(&json, "bogo-ops-per-second-usr-sys-time",
+		(u_total + s_total > 0.0) ? (double)c_total / (u_total + s_total) : 0.0);
+	stress_json_double(&json, "bogo-ops-per-second-real-time",
+		(r_total > 0.0) ? (double)c_total / r_total : 0.0);
+	stress_json_double(&json, "wall-clock-time", r_total);
+	stress_json_double(&json, "user-time", u_total);
+	stress_json_double(&json, "system-time", s_total);
+	stress_json_double(&json, "cpu-usage-per-instance",
+		((r_total > 0.0) && completed) ?
+			100.0 * (u_total + s_total) / r_total / (double)completed : 0.0);
+	stress_json_int64(&json, "max-rss", (int64_t)maxrss);
+
+	/* misc metrics, combined across instances as for --metrics */
+	stress_json_object_begin(&json, "metrics");
+	for (i = 0; ss->stats[0] && (i < ss->stats[0]->metrics.n_items); i++) {
+		const char *description = ss->stats[0]->metrics.items[i].description;
+
+		if (description)
+			stress_json_double(&json, description, stress_metrics_combine(ss, i));
+	}
+	stress_json_object_end(&json);
+
+#if defined(STRESS_PERF_STATS) &&	\
+    defined(HAVE_LINUX_PERF_EVENT_H)
+	if (g_opt_flags & OPT_FLAGS_PERF_STATS)
+		stress_perf_stat_json(&json, ss, r_total);
+#endif
+#if defined(STRESS_RAPL)
+	if (g_opt_flags & OPT_FLAGS_RAPL_REQUIRED)
+		stress_rapl_json(&json, ss, g_shared->rapl_domains);
+#endif
+#if defined(STRESS_THERMAL_ZONES)
+	if (g_opt_flags & OPT_FLAGS_TZ_INFO)
+		stress_tz_json(&json, ss);
+#endif
+	stress_json_end(&json);
+}
+
 /*
  *  stress_metrics_set_const_check()
  *	set metrics with given description a value. If const_description is
@@ -1525,6 +2444,8 @@ void stress_metrics_set_const_check(
 
 	if (idx >= STRESS_MISC_METRICS_MAX)
 		return;
+	if ((idx >= metrics->n_items) && !stress_metrics_items_alloc(args, metrics, idx))
+		return;
 
 	item = &metrics->items[idx];
 	item->description = const_description ?
@@ -1532,7 +2453,7 @@ void stress_metrics_set_const_check(
 		stress_shared_heap_dup_const(description);
 	if (item->description)
 		item->value = value;
-	metrics->items[idx].mean_type = mean_type;
+	item->mean_type = mean_type;
 }
 
 #if defined(HAVE_GETRUSAGE)
@@ -1587,6 +2508,53 @@ static void stress_get_usage_stats(const int32_t ticks_per_sec, stress_stats_t *
 	stats->rusage_stime_total += stats->rusage_stime;
 }
 
+/*
+ *  stress_metrics_warmup_exclude()
+ *	remove the --warmup window from the instance totals, instances
+ *	that finish before the end of the warm-up are left unchanged
+ */
+static void stress_metrics_warmup_exclude(stress_stats_t *stats, const double finish)
+{
+	stress_warmup_t *w = &stats->warmup;
+
+	if (!w->valid)
+		return;
+	if ((w->time < stats->start) || (w->time > finish) ||
+	    (w->counter > stats->args.ci->counter)) {
+		w->valid = false;
+		return;
+	}
+	stats->counter_total -= w->counter;
+	stats->duration_total -= w->time - stats->start;
+	if (w->usage) {
+		stats->rusage_utime_total -= STRESS_MINIMUM(w->utime, stats->rusage_utime);
+		stats->rusage_stime_total -= STRESS_MINIMUM(w->stime, stats->rusage_stime);
+	}
+}
+
+#if defined(STRESS_PERF_STATS)
+/*
+ *  stress_thread_utime()
+ *	user time of the calling thread in seconds
+ */
+static double stress_thread_utime(void)
+{
+#if defined(HAVE_GETRUSAGE)
+	struct rusage usage;
+#if defined(RUSAGE_THREAD)
+	const int who = RUSAGE_THREAD;
+#else
+	const int who = RUSAGE_SELF;
+#endif
+
+	if (shim_getrusage(who, &usage) == 0)
+		return (double)usage.ru_utime.tv_sec +
+			((double)usage.ru_utime.tv_usec) / STRESS_DBL_MICROSECOND;
+#endif
+	return 0.0;
+}
+#endif
+
 /*
  *  stress_log_time()
  *	log start/end of stressor run, name is stressor, whence is the time and
@@ -1612,61 +2580,299 @@ static void stress_log_time(const char *name, const double whence, const char *t
 }
 
 /*
- *  stress_run_child()
- *	invoke a stressor in a child process
+ *  stress_run_args_init()
+ *	set up the stressor args for an instance
  */
-static int MLOCKED_TEXT stress_run_child(
-	stress_checksum_t **checksum,
+static void stress_run_args_init(
 	stress_stats_t *const stats,
-	const double fork_time_start,
-	const int64_t backoff,
-	const int32_t ticks_per_sec,
-	const int32_t ionice_class,
-	const int32_t ionice_level,
+	const char *name,
 	const int32_t instance,
-	const int32_t started_instances,
 	const size_t page_size,
-	const pid_t child_pid)
+	const pid_t pid)
 {
-	const char *name = g_stressor_current->stressor->name;
-	int rc = EXIT_SUCCESS;
-	bool ok;
-	double finish = 0.0, run_duration;
+	stats->args.stats = stats;
+	stats->args.name = name;
+	stats->args.max_ops = g_stressor_current->bogo_ops;
+	stats->args.instance = (uint32_t)instance;
+	stats->args.instances = (uint32_t)g_stressor_current->instances;
+	stats->args.pid = pid;
+	stats->args.page_size = page_size;
+	stats->args.time_end = stress_time_now() + (double)g_opt_timeout + stress_sync_start_at_delay();
+	stats->args.throttle_start = stress_time_now();
+	stats->args.mapped = &g_shared->mapped;
+	stats->args.metrics = &stats->metrics;
+	stats->args.info = g_stressor_current->stressor->info;
+	stats->args.ci->counter = 0;
+
+	/* allocate before the stressor forks any metrics setting children */
+	if (!stats->metrics.items)
+		(void)stress_metrics_items_alloc(&stats->args, &stats->metrics, 0);
+}
 
-	sigalarmed = &stats->sigalarmed;
+/*
+ *  stress_run_completed()
+ *	mark an instance as completed and checksum the
+ *	bogo-op counter, returns the updated return code
+ */
+static int stress_run_completed(
+	stress_stats_t *const stats,
+	stress_checksum_t *checksum,
+	const char *name,
+	int rc)
+{
+	const bool ok = (rc == EXIT_SUCCESS);
 
-	stress_set_proc_state(name, STRESS_STATE_START);
-	g_shared->instance_count.started++;
+	stats->completed = true;
+	stats->args.ci->run_ok = ok;
+	checksum->data.ci.run_ok = ok;
+	/* Ensure reserved padding is zero to not confuse checksum */
+	(void)shim_memset(checksum->data.pad, 0, sizeof(checksum->data.pad));
 
-	if (sched_settings_apply(true) < 0) {
-		rc = EXIT_NO_RESOURCE;
-		stress_block_signals();
-		goto child_exit;
-	}
-	(void)atexit(stress_child_atexit);
-	if (stress_set_handler(name, true) < 0) {
-		rc = EXIT_FAILURE;
-		stress_block_signals();
-		goto child_exit;
+	/*
+	 *  Bogo ops counter should be OK for reading,
+	 *  if not then flag up that the counter may
+	 *  be untrustyworthy
+	 */
+	if ((!stats->args.ci->counter_ready) && (!stats->args.ci->force_killed)) {
+		pr_warn("%s: WARNING: bogo-ops counter in non-ready state, "
+			"metrics are untrustworthy (process may have been "
+			"terminated prematurely)\n",
+			name);
+		rc = EXIT_METRICS_UNTRUSTWORTHY;
 	}
-	stress_parent_died_alarm();
-	stress_process_dumpable(false);
-	stress_set_timer_slack();
-
-	if (g_opt_flags & OPT_FLAGS_KSM)
-		stress_ksm_memory_merge(1);
+	checksum->data.ci.counter = stats->args.ci->counter;
+	stress_hash_checksum(checksum);
 
-	stress_set_proc_state(name, STRESS_STATE_INIT);
-	stress_mwc_reseed();
-	stress_set_max_limits();
-	stress_set_iopriority(ionice_class, ionice_level);
-	(void)umask(0077);
+	return rc;
+}
 
-	pr_dbg("%s: [%d] started (instance %" PRIu32 " on CPU %u)\n",
+/*
+ *  stress_instance_threads()
+ *	true if the instances of stressor ss are to be run as threads
+ *	by the instance 0 stressor process, --verify is excluded since
+ *	some stressors verify using per process random number sequences.
+ *	Stressors keep per instance state in thread local storage, so
+ *	this is only enabled if the toolchain supports it
+ */
+static bool stress_instance_threads(const stress_stressor_t *ss)
+{
+#if defined(HAVE_LIB_PTHREAD) &&	\
+    defined(HAVE_STRESS_THREAD_LOCAL)
+	return (g_opt_flags & OPT_FLAGS_INSTANCE_THREADS) &&
+	       !(g_opt_flags & OPT_FLAGS_VERIFY) &&
+	       ss->stressor->info->instance_threads &&
+	       (ss->instances > 1);
+#else
+	(void)ss;
+
+	return false;
+#endif
+}
+
+/*
+ *  stress_run_instance_threads_abandon()
+ *	instance threads were not started, flag them as finished
+ *	so that --sync-start does not wait for them and set their
+ *	exit status to rc
+ */
+static void stress_run_instance_threads_abandon(const int rc)
+{
+	int32_t j;
+
+	for (j = 1; j < g_stressor_current->instances; j++) {
+		g_stressor_current->stats[j]->exit_status = rc;
+		stress_sync_state_store(&g_stressor_current->stats[j]->s_pid,
+			STRESS_SYNC_START_FLAG_FINISHED);
+	}
+}
+
+#if defined(HAVE_LIB_PTHREAD)
+/* per instance thread state for --instance-threads */
+typedef struct {
+	pthread_t pthread;		/* instance thread */
+	stress_stats_t *stats;		/* instance stats */
+	const char *name;		/* stressor name */
+	int32_t instance;		/* instance number */
+	size_t page_size;		/* page size */
+	pid_t pid;			/* stressor process pid */
+	int ret;			/* pthread_create return */
+} stress_instance_thread_t;
+
+/*
+ *  stress_run_instance_thread()
+ *	run a stressor instance in a thread of the instance 0
+ *	stressor process
+ */
+static void *stress_run_instance_thread(void *arg)
+{
+	stress_instance_thread_t *it = (stress_instance_thread_t *)arg;
+	stress_stats_t *const stats = it->stats;
+	const struct stressor_info *info = g_stressor_current->stressor->info;
+	sigset_t set;
+	double finish;
+	bool psi = false;
+	int rc;
+
+	(void)stress_get_setting("psi", &psi);
+	/* process directed signals are handled by the instance 0 thread */
+	(void)sigfillset(&set);
+	(void)pthread_sigmask(SIG_BLOCK, &set, NULL);
+	stress_placement_set(stats->placement_cpu);
+
+	stress_run_args_init(stats, it->name, it->instance, it->page_size, it->pid);
+	(void)shim_memset(stats->checksum, 0, sizeof(*stats->checksum));
+	(void)shim_memset(&stats->warmup, 0, sizeof(stats->warmup));
+	if (psi)
+		stress_psi_snapshot(&stats->psi.start, it->name);
+	stats->start = stress_time_now();
+	stress_bogo_batch_begin(&stats->args);
+	rc = info->stressor(&stats->args);
+	stress_bogo_batch_flush(&stats->args);
+	stress_sync_state_store(&stats->s_pid, STRESS_SYNC_START_FLAG_FINISHED);
+	stats->exit_status = stress_run_completed(stats, stats->checksum, it->name, rc);
+
+	finish = stress_time_now();
+	if (psi)
+		stress_psi_snapshot(&stats->psi.stop, it->name);
+	stats->duration = finish - stats->start;
+	stats->counter_total += stats->args.ci->counter;
+	stats->duration_total += stats->duration;
+	stress_metrics_warmup_exclude(stats, finish);
+
+	return NULL;
+}
+
+/*
+ *  stress_run_instance_threads_start()
+ *	start threads for instances 1..N-1 of the current stressor,
+ *	returns NULL if the thread state cannot be allocated
+ */
+static stress_instance_thread_t *stress_run_instance_threads_start(
+	const char *name,
+	const size_t page_size,
+	const pid_t pid)
+{
+	const int32_t instances = g_stressor_current->instances;
+	stress_instance_thread_t *threads;
+	int32_t j;
+
+	threads = (stress_instance_thread_t *)calloc((size_t)instances, sizeof(*threads));
+	if (!threads) {
+		pr_inf("%s: cannot allocate instance thread state, "
+			"instances 1..%" PRId32 " will not be run\n",
+			name, instances - 1);
+		stress_run_instance_threads_abandon(EXIT_NO_RESOURCE);
+		return NULL;
+	}
+
+	for (j = 1; j < instances; j++) {
+		stress_instance_thread_t *it = &threads[j];
+
+		it->stats = g_stressor_current->stats[j];
+		it->name = name;
+		it->instance = j;
+		it->page_size = page_size;
+		it->pid = pid;
+		it->ret = pthread_create(&it->pthread, NULL, stress_run_instance_thread, (void *)it);
+		if (it->ret) {
+			pr_inf("%s: cannot create thread for instance %" PRId32 ", errno=%d (%s)\n",
+				name, j, it->ret, strerror(it->ret));
+			it->stats->exit_status = EXIT_NO_RESOURCE;
+			stress_sync_state_store(&it->stats->s_pid, STRESS_SYNC_START_FLAG_FINISHED);
+		}
+	}
+	return threads;
+}
+
+/*
+ *  stress_run_instance_threads_join()
+ *	wait for the instance threads to complete, each thread
+ *	leaves its exit status in its stats for the parent
+ */
+static void stress_run_instance_threads_join(stress_instance_thread_t *threads)
+{
+	const int32_t instances = g_stressor_current->instances;
+	int32_t j;
+
+	if (!threads)
+		return;
+
+	for (j = 1; j < instances; j++) {
+		const stress_instance_thread_t *it = &threads[j];
+
+		if (!it->ret)
+			(void)pthread_join(it->pthread, NULL);
+	}
+	free(threads);
+}
+#endif
+
+/*
+ *  stress_run_child()
+ *	invoke a stressor in a child process
+ */
+static int MLOCKED_TEXT stress_run_child(
+	stress_checksum_t **checksum,
+	stress_stats_t *const stats,
+	const double fork_time_start,
+	const int64_t backoff,
+	const int32_t ticks_per_sec,
+	const int32_t ionice_class,
+	const int32_t ionice_level,
+	const int32_t instance,
+	const int32_t started_instances,
+	const size_t page_size,
+	const pid_t child_pid,
+	const bool instance_threads,
+	const bool parent_died_alarm)
+{
+	const char *name = g_stressor_current->stressor->name;
+	int rc = EXIT_SUCCESS;
+	double finish = 0.0, run_duration;
+	bool instance_threads_started = false;
+	bool psi = false;
+
+	sigalarmed = &stats->sigalarmed;
+	(void)stress_get_setting("psi", &psi);
+	(void)shim_memset(&stats->phase, 0, sizeof(stats->phase));
+	stats->phase.fork = fork_time_start;
+
+	stress_set_proc_state(name, STRESS_STATE_START);
+	g_shared->instance_count.started++;
+
+	if (sched_settings_apply(true) < 0) {
+		rc = EXIT_NO_RESOURCE;
+		stress_block_signals();
+		goto child_exit;
+	}
+	(void)atexit(stress_child_atexit);
+	if (stress_set_handler(name, true) < 0) {
+		rc = EXIT_FAILURE;
+		stress_block_signals();
+		goto child_exit;
+	}
+	if (parent_died_alarm)
+		stress_parent_died_alarm();
+	stress_process_dumpable(false);
+	stress_set_timer_slack();
+
+	if (g_opt_flags & OPT_FLAGS_KSM)
+		stress_ksm_memory_merge(1);
+	stress_mmap_policy_init();
+
+	stress_set_proc_state(name, STRESS_STATE_INIT);
+	stress_mwc_reseed();
+	stress_set_max_limits();
+	stress_set_iopriority(ionice_class, ionice_level);
+	(void)umask(0077);
+
+	pr_dbg("%s: [%d] started (instance %" PRIu32 " on CPU %u)\n",
 		name, (int)child_pid, instance, stress_get_cpu());
 
-	if (g_opt_flags & OPT_FLAGS_INTERRUPTS)
+	if (g_opt_flags & OPT_FLAGS_INTERRUPTS) {
 		stress_interrupts_start(stats->interrupts);
+		stress_interrupts_dist_start();
+	}
 #if defined(STRESS_PERF_STATS) &&	\
     defined(HAVE_LINUX_PERF_EVENT_H)
 	if (g_opt_flags & OPT_FLAGS_PERF_STATS)
@@ -1679,48 +2885,96 @@ static int MLOCKED_TEXT stress_run_child(
 		(void)stress_perf_enable(&stats->sp);
 #endif
 	stress_yield_sleep_ms();
+	(void)shim_memset(&stats->warmup, 0, sizeof(stats->warmup));
 	stats->start = stress_time_now();
 	if (g_opt_timeout)
-		(void)alarm((unsigned int)g_opt_timeout);
+		(void)alarm((unsigned int)(g_opt_timeout + (uint64_t)ceil(stress_sync_start_at_delay())));
 	if (stress_continue_flag() && !(g_opt_flags & OPT_FLAGS_DRY_RUN)) {
 		const struct stressor_info *info = g_stressor_current->stressor->info;
+#if defined(HAVE_LIB_PTHREAD)
+		stress_instance_thread_t *threads = NULL;
+#endif
 
-		stats->args.stats = stats;
-		stats->args.name = name;
-		stats->args.max_ops = g_stressor_current->bogo_ops;
-		stats->args.instance = (uint32_t)instance;
-		stats->args.instances = (uint32_t)g_stressor_current->instances;
-		stats->args.pid = child_pid;
-		stats->args.page_size = page_size;
-		stats->args.time_end = stress_time_now() + (double)g_opt_timeout;
-		stats->args.mapped = &g_shared->mapped;
-		stats->args.metrics = &stats->metrics;
-		stats->args.info = info;
-		stats->args.ci.counter = 0;
+		stress_run_args_init(stats, name, instance, page_size, child_pid);
 
 		if (instance == 0)
 			stress_settings_dbg(&stats->args);
 		stress_set_oom_adjustment(&stats->args, false);
 
 		(void)shim_memset(*checksum, 0, sizeof(**checksum));
+#if defined(STRESS_THERMAL_ZONES)
+		if (g_opt_flags & OPT_FLAGS_THERMAL_ZONES)
+			stats->tz.throttle_valid =
+				(stress_tz_get_throttle(&stats->tz.throttle) == 0);
+#endif
+		if (psi)
+			stress_psi_snapshot(&stats->psi.start, name);
 		stats->start = stress_time_now();
 #if defined(STRESS_RAPL)
-		if (g_opt_flags & OPT_FLAGS_RAPL)
+		if (g_opt_flags & OPT_FLAGS_RAPL) {
+			stats->rapl.methods.n = 0;
+			stats->rapl.methods.current = 0;
 			(void)stress_rapl_get_power_stressor(g_shared->rapl_domains, NULL);
+		}
 #endif
 		if (g_opt_flags & OPT_FLAGS_STRESSOR_TIME)
 			stress_log_time(name, stats->start, "start");
+#if defined(HAVE_LIB_PTHREAD)
+		if (instance_threads) {
+			threads = stress_run_instance_threads_start(name, page_size, child_pid);
+			instance_threads_started = true;
+		}
+#endif
+		stress_bogo_batch_begin(&stats->args);
+		stats->phase.enter = stress_time_now();
+#if defined(STRESS_PERF_STATS)
+		/*
+		 *  count core and reference (APERF/MPERF equivalent) cycles
+		 *  of the stressor thread to report its effective frequency
+		 */
+		if (cpu_cycles_stats) {
+			stress_perf_cycles_t pc;
+			uint64_t c1 = 0, r1 = 0, c2 = 0, r2 = 0;
+			double utime;
+
+			if (stress_perf_cycles_open(&pc) < 0) {
+				rc = info->stressor(&stats->args);
+			} else {
+				utime = stress_thread_utime();
+				(void)stress_perf_cycles_read(&pc, &c1, &r1);
+				rc = info->stressor(&stats->args);
+				if (stress_perf_cycles_read(&pc, &c2, &r2) == 0) {
+					stats->cpu_cycles += c2 - c1;
+					stats->cpu_ref_cycles += r2 - r1;
+					stats->cpu_cycles_utime += stress_thread_utime() - utime;
+				}
+				stress_perf_cycles_close(&pc);
+			}
+		} else {
+			rc = info->stressor(&stats->args);
+		}
+#else
 		rc = info->stressor(&stats->args);
+#endif
+		stress_bogo_batch_flush(&stats->args);
+		stats->phase.leave = stress_time_now();
 		stress_sync_state_store(&stats->s_pid, STRESS_SYNC_START_FLAG_FINISHED);
+#if defined(HAVE_LIB_PTHREAD)
+		if (instance_threads)
+			stress_run_instance_threads_join(threads);
+#endif
 		stress_block_signals();
 		(void)alarm(0);
 		if (g_opt_flags & OPT_FLAGS_INTERRUPTS) {
 			stress_interrupts_stop(stats->interrupts);
+			stress_interrupts_dist_stop(stats->irq_dist);
 			stress_interrupts_check_failure(name, stats->interrupts, instance, &rc);
 		}
 #if defined(STRESS_RAPL)
-		if (g_opt_flags & OPT_FLAGS_RAPL)
+		if (g_opt_flags & OPT_FLAGS_RAPL) {
+			stress_rapl_method(&stats->args, NULL);
 			(void)stress_rapl_get_power_stressor(g_shared->rapl_domains, &stats->rapl);
+		}
 #endif
 		pr_fail_check(&rc);
 #if defined(SA_SIGINFO) &&	\
@@ -1745,29 +2999,11 @@ static int MLOCKED_TEXT stress_run_child(
 			}
 		}
 #endif
-		stats->completed = true;
-		ok = (rc == EXIT_SUCCESS);
-		stats->args.ci.run_ok = ok;
-		(*checksum)->data.ci.run_ok = ok;
-		/* Ensure reserved padding is zero to not confuse checksum */
-		(void)shim_memset((*checksum)->data.pad, 0, sizeof((*checksum)->data.pad));
-
 		stress_set_proc_state(name, STRESS_STATE_STOP);
-		/*
-		 *  Bogo ops counter should be OK for reading,
-		 *  if not then flag up that the counter may
-		 *  be untrustyworthy
-		 */
-		if ((!stats->args.ci.counter_ready) && (!stats->args.ci.force_killed)) {
-			pr_warn("%s: WARNING: bogo-ops counter in non-ready state, "
-				"metrics are untrustworthy (process may have been "
-				"terminated prematurely)\n",
-				name);
-			rc = EXIT_METRICS_UNTRUSTWORTHY;
-		}
-		(*checksum)->data.ci.counter = stats->args.ci.counter;
-		stress_hash_checksum(*checksum);
+		rc = stress_run_completed(stats, *checksum, name, rc);
 		finish = stress_time_now();
+		if (psi)
+			stress_psi_snapshot(&stats->psi.stop, name);
 		if (g_opt_flags & OPT_FLAGS_STRESSOR_TIME)
 			stress_log_time(name, finish, "finish");
 	}
@@ -1779,14 +3015,27 @@ static int MLOCKED_TEXT stress_run_child(
 	}
 #endif
 #if defined(STRESS_THERMAL_ZONES)
-	if (g_opt_flags & OPT_FLAGS_THERMAL_ZONES)
+	if (g_opt_flags & OPT_FLAGS_THERMAL_ZONES) {
 		(void)stress_tz_get_temperatures(&g_shared->tz_info, &stats->tz);
+		if (stats->tz.throttle_valid) {
+			stress_tz_throttle_t throttle;
+
+			/* convert start counts into throttle events during the run */
+			if (stress_tz_get_throttle(&throttle) == 0) {
+				stats->tz.throttle.core = throttle.core - stats->tz.throttle.core;
+				stats->tz.throttle.package = throttle.package - stats->tz.throttle.package;
+			} else {
+				stats->tz.throttle_valid = false;
+			}
+		}
+	}
 #endif
 	stats->duration = finish - stats->start;
-	stats->counter_total += stats->args.ci.counter;
+	stats->counter_total += stats->args.ci->counter;
 	stats->duration_total += stats->duration;
 
 	stress_get_usage_stats(ticks_per_sec, stats);
+	stress_metrics_warmup_exclude(stats, finish);
 	pr_dbg("%s: [%d] exited (instance %" PRIu32 " on CPU %d)\n",
 		name, (int)child_pid, instance, stress_get_cpu());
 
@@ -1797,14 +3046,16 @@ static int MLOCKED_TEXT stress_run_child(
 	 * Apparently succeeded but terminated early?
 	 * Could be a bug, so report a warning
 	 */
-	if (stats->args.ci.run_ok &&
+	if (stats->args.ci->run_ok &&
 	    (g_shared && !g_shared->caught_sigint) &&
 	    (run_duration < (double)g_opt_timeout) &&
-	    (!(g_stressor_current->bogo_ops && stats->args.ci.counter >= g_stressor_current->bogo_ops))) {
+	    (!(g_stressor_current->bogo_ops && stats->args.ci->counter >= g_stressor_current->bogo_ops))) {
 		pr_warn("%s: WARNING: finished prematurely after just %s\n",
 			name, stress_duration_to_str(run_duration, true, true));
 	}
 child_exit:
+	if (instance_threads && !instance_threads_started)
+		stress_run_instance_threads_abandon(rc);
 	/*
 	 *  We used to free allocations on the heap, but
 	 *  the child is going to _exit() soon so it's
@@ -1824,143 +3075,632 @@ child_exit:
 	return rc;
 }
 
+#if defined(HAVE_PRCTL) &&		\
+    defined(HAVE_SYS_PRCTL_H) &&	\
+    defined(PR_SET_CHILD_SUBREAPER)
+#define STRESS_RUN_LAUNCHERS
+#endif
+
+#if defined(STRESS_RUN_LAUNCHERS)
 /*
- *  stress_run()
- *	kick off and run stressors
+ *  stress_run_launcher_affinity()
+ *	pin a launcher to the share of the allowed CPUs of the
+ *	stressor instances lo..hi-1 out of total instances,
+ *	stressors forked by the launcher inherit this
  */
-static void MLOCKED_TEXT stress_run(
-	const int32_t ticks_per_sec,
-	stress_stressor_t *stressors_list,
-	double *duration,
-	bool *success,
-	bool *resource_success,
-	bool *metrics_success,
-	stress_checksum_t **checksum)
+static void stress_run_launcher_affinity(const int32_t lo, const int32_t hi, const int32_t total)
 {
-	double time_start, time_finish;
-	int32_t started_instances = 0;
-	const size_t page_size = stress_get_page_size();
-	int64_t backoff = DEFAULT_BACKOFF;
-	int32_t ionice_class = UNDEFINED;
-	int32_t ionice_level = UNDEFINED;
-	bool handler_set = false;
-	stress_pid_t *s_pids_head = NULL;
-
-	wait_flag = true;
-	time_start = stress_time_now();
+#if defined(HAVE_SCHED_GETAFFINITY) &&	\
+    defined(HAVE_SCHED_SETAFFINITY) &&	\
+    defined(CPU_SET)
+	cpu_set_t allowed, mask;
+	int cpu, n_allowed, idx = 0, first;
+	bool pinned = false;
 
-	(void)stress_get_setting("backoff", &backoff);
-	(void)stress_get_setting("ionice-class", &ionice_class);
-	(void)stress_get_setting("ionice-level", &ionice_level);
+	if (sched_getaffinity(0, sizeof(allowed), &allowed) < 0)
+		return;
+	n_allowed = CPU_COUNT(&allowed);
+	if (n_allowed < 1)
+		return;
+	/* fewer CPUs than instances, use the CPU the first instance maps to */
+	first = (int)(((int64_t)lo * n_allowed) / total);
 
-	if (g_opt_pause) {
-		static bool first_run = true;
+	CPU_ZERO(&mask);
+	for (cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+		int32_t instance;
 
-		if (first_run)
-			first_run = false;
-		else {
-			pr_dbg("pausing for %u second%s\n", g_opt_pause,
-				g_opt_pause == 1 ? "" : "s");
-			(void)sleep(g_opt_pause);
+		if (!CPU_ISSET(cpu, &allowed))
+			continue;
+		instance = (int32_t)(((int64_t)idx * total) / n_allowed);
+		if (((instance >= lo) && (instance < hi)) || (!pinned && (idx == first))) {
+			CPU_SET(cpu, &mask);
+			pinned = true;
 		}
+		idx++;
+	}
+	if (pinned)
+		(void)sched_setaffinity(0, sizeof(mask), &mask);
+#else
+	(void)lo;
+	(void)hi;
+	(void)total;
+#endif
+}
+
+static int stress_run_launcher_tree(stress_stressor_t *stressors_list,
+	const int32_t lo, const int32_t hi, const int32_t total,
+	const int32_t launchers, const pid_t parent_pid,
+	const int64_t backoff, const int32_t ticks_per_sec,
+	const int32_t ionice_class, const int32_t ionice_level,
+	const size_t page_size);
+
+/*
+ *  stress_run_launcher()
+ *	launcher process for the stressor instances lo..hi-1. If there
+ *	are more than launchers instances the range is split over
+ *	launchers sub-launchers, otherwise the stressors are forked.
+ *	The launcher then exits so that the stressors get reparented
+ *	to the stress-ng parent (the child subreaper). The stressor
+ *	pids are stored in the shared stats for the parent to wait on.
+ */
+static void NORETURN stress_run_launcher(
+	stress_stressor_t *stressors_list,
+	const int32_t lo,
+	const int32_t hi,
+	const int32_t total,
+	const int32_t launchers,
+	const pid_t parent_pid,
+	const int64_t backoff,
+	const int32_t ticks_per_sec,
+	const int32_t ionice_class,
+	const int32_t ionice_level,
+	const size_t page_size)
+{
+	int32_t n = 0;
+
+	stress_run_launcher_affinity(lo, hi, total);
+
+	if ((hi - lo) > launchers) {
+		const int ret = stress_run_launcher_tree(stressors_list, lo, hi, total,
+			launchers, parent_pid, backoff, ticks_per_sec,
+			ionice_class, ionice_level, page_size);
+
+		_exit((ret < 0) ? EXIT_FAILURE : EXIT_SUCCESS);
 	}
-	pr_dbg("starting stressors\n");
 
-	/*
-	 *  Work through the list of stressors to run
-	 */
 	for (g_stressor_current = stressors_list; g_stressor_current; g_stressor_current = g_stressor_current->next) {
 		int32_t j;
 
-		if (g_stressor_current->ignore.run || g_stressor_current->ignore.permute) {
-			*checksum += g_stressor_current->instances;
+		if (g_stressor_current->ignore.run || g_stressor_current->ignore.permute)
 			continue;
-		}
 
-		/*
-		 *  Each stressor has 1 or more instances to run
-		 */
-		for (j = 0; j < g_stressor_current->instances; j++, (*checksum)++) {
-			double fork_time_start;
-			pid_t pid, child_pid;
-			int rc;
+		for (j = 0; j < g_stressor_current->instances; j++, n++) {
 			stress_stats_t *const stats = g_stressor_current->stats[j];
+			double fork_time_start;
+			pid_t pid;
 
-#if defined(STRESS_TERMINATE_PREMATURELY)
-			if (g_opt_timeout && (stress_time_now() - time_start > (double)g_opt_timeout))
-				goto abort;
-#endif
-			stress_sync_start_init(&stats->s_pid);
-			stats->args.ci.counter_ready = true;
-			stats->args.ci.counter = 0;
-			stats->checksum = *checksum;
+			if ((n < lo) || (n >= hi))
+				continue;
 again:
 			if (!stress_continue_flag())
-				break;
+				_exit(EXIT_SUCCESS);
 			fork_time_start = stress_time_now();
 			pid = fork();
 			switch (pid) {
 			case -1:
-				stats->s_pid.reaped = true;
 				if (errno == EAGAIN) {
 					(void)shim_usleep(100000);
 					goto again;
 				}
+				stats->s_pid.reaped = true;
 				pr_err("Cannot fork: errno=%d (%s)\n",
 					errno, strerror(errno));
-				stress_kill_stressors(SIGALRM, false);
-				goto wait_for_stressors;
-			case 0:
-				/* Child */
-				child_pid = getpid();
-				stats->s_pid.reaped = false;
-				stats->s_pid.pid = child_pid;
-				if (g_opt_flags & OPT_FLAGS_C_STATES)
-					stress_cpuidle_read_cstates_begin(&stats->cstates);
-				rc = stress_run_child(checksum,
-						stats, fork_time_start,
-						backoff, ticks_per_sec,
-						ionice_class, ionice_level,
-						j, started_instances,
-						page_size, child_pid);
-				if (g_opt_flags & OPT_FLAGS_C_STATES)
-					stress_cpuidle_read_cstates_end(&stats->cstates);
-				_exit(rc);
-			default:
-				if (pid > -1) {
-					stats->s_pid.pid = pid;
-					stats->s_pid.reaped = false;
-					stats->signalled = false;
-					started_instances++;
-					stress_ftrace_add_pid(pid);
-
-					stress_sync_start_s_pid_list_add(&s_pids_head, &stats->s_pid);
-				}
+				_exit(EXIT_FAILURE);
+			case 0: {
+					stress_checksum_t *checksum = stats->checksum;
+					const pid_t child_pid = getpid();
+					bool reparented;
+					int rc, i;
 
-				/* Forced early abort during startup? */
-				if (!stress_continue_flag()) {
-					pr_dbg("abort signal during startup, cleaning up\n");
-					stress_kill_stressors(SIGALRM, true);
-					goto wait_for_stressors;
+					stats->s_pid.reaped = false;
+					stats->s_pid.pid = child_pid;
+
+					/*
+					 *  wait until reparented to the stress-ng parent, the
+					 *  parent death signal is only set once the parent is
+					 *  the stress-ng parent and not the exiting launcher
+					 */
+					for (i = 0; (i < 5000) && (getppid() != parent_pid); i++)
+						(void)shim_usleep(1000);
+					reparented = (getppid() == parent_pid);
+					if (!reparented)
+						pr_dbg("%s: not reparented to stress-ng parent, "
+							"parent death signal not set\n",
+							g_stressor_current->stressor->name);
+					stress_placement_set(stats->placement_cpu);
+					stress_stressor_cgroup_join(g_stressor_current->stressor->name);
+					stress_resctrl_join(g_stressor_current->stressor->name);
+
+					if (g_opt_flags & OPT_FLAGS_C_STATES) {
+						stress_cpuidle_read_cstates_begin(&stats->cstates);
+						stress_cpuidle_percpu_begin(g_stressor_current, (uint32_t)j);
+					}
+					rc = stress_run_child(&checksum,
+							stats, fork_time_start,
+							backoff, ticks_per_sec,
+							ionice_class, ionice_level,
+							j, n, page_size, child_pid, false,
+							reparented);
+					if (g_opt_flags & OPT_FLAGS_C_STATES) {
+						stress_cpuidle_read_cstates_end(&stats->cstates);
+						stress_cpuidle_percpu_end(g_stressor_current, (uint32_t)j);
+					}
+					stress_resctrl_sample(g_stressor_current->stressor->name,
+						&stats->resctrl_llc_occupancy);
+					_exit(rc);
 				}
+			default:
+				stats->s_pid.pid = pid;
+				stats->s_pid.reaped = false;
 				break;
 			}
 		}
 	}
-	if (!handler_set) {
-		(void)stress_set_handler("stress-ng", false);
-		handler_set = true;
-	}
-#if defined(STRESS_TERMINATE_PREMATURELY)
-abort:
-#endif
-	pr_dbg("%d stressor%s started\n", started_instances,
-		 started_instances == 1 ? "" : "s");
+	_exit(EXIT_SUCCESS);
+}
 
-wait_for_stressors:
-	if (!handler_set)
-		(void)stress_set_handler("stress-ng", false);
-	if (g_opt_flags & OPT_FLAGS_IGNITE_CPU)
+/*
+ *  stress_run_launcher_tree()
+ *	split the stressor instances lo..hi-1 over launchers
+ *	sub-launchers and wait for them to fork their stressors,
+ *	each level of the tree fans out by launchers so all the
+ *	stressors are started in O(log N) fork steps
+ */
+static int stress_run_launcher_tree(stress_stressor_t *stressors_list,
+	const int32_t lo, const int32_t hi, const int32_t total,
+	const int32_t launchers, const pid_t parent_pid,
+	const int64_t backoff, const int32_t ticks_per_sec,
+	const int32_t ionice_class, const int32_t ionice_level,
+	const size_t page_size)
+{
+	const int32_t n = hi - lo;
+	const int32_t fanout = STRESS_MINIMUM(launchers, n);
+	pid_t pids[STRESS_LAUNCHERS_MAX];
+	int32_t i;
+	int ret = 0;
+
+	for (i = 0; i < fanout; i++) {
+		const int32_t sub_lo = lo + (int32_t)(((int64_t)n * i) / fanout);
+		const int32_t sub_hi = lo + (int32_t)(((int64_t)n * (i + 1)) / fanout);
+
+		if (!stress_continue_flag())
+			break;
+		pids[i] = fork();
+		if (pids[i] < 0) {
+			pr_err("Cannot fork launcher: errno=%d (%s)\n",
+				errno, strerror(errno));
+			ret = -1;
+			break;
+		} else if (pids[i] == 0) {
+			stress_run_launcher(stressors_list, sub_lo, sub_hi, total,
+				launchers, parent_pid, backoff, ticks_per_sec,
+				ionice_class, ionice_level, page_size);
+		}
+	}
+	/* launchers exit once they have forked their stressors */
+	while (i-- > 0) {
+		int status;
+
+		if ((pids[i] > 0) &&
+		    ((shim_waitpid(pids[i], &status, 0) < 0) ||
+		     !WIFEXITED(status) || (WEXITSTATUS(status) != EXIT_SUCCESS)))
+			ret = -1;
+	}
+	return ret;
+}
+
+/*
+ *  stress_run_launchers()
+ *	fork stressors in parallel from a tree of launcher
+ *	processes, returns the number of stressors started or
+ *	-1 if a launcher failed before any stressor was started.
+ *	Instances not started by a failed launcher are failed
+ */
+static int32_t stress_run_launchers(
+	stress_stressor_t *stressors_list,
+	stress_pid_t **s_pids_head,
+	const int32_t launchers,
+	const int64_t backoff,
+	const int32_t ticks_per_sec,
+	const int32_t ionice_class,
+	const int32_t ionice_level,
+	const size_t page_size,
+	bool *success)
+{
+	int32_t started_instances = 0, total = 0, not_started = 0;
+	stress_stressor_t *ss;
+	int ret = 0;
+
+	for (ss = stressors_list; ss; ss = ss->next) {
+		if (ss->ignore.run || ss->ignore.permute)
+			continue;
+		total += ss->instances;
+	}
+	if (total > 0)
+		ret = stress_run_launcher_tree(stressors_list, 0, total, total,
+			launchers, getpid(), backoff, ticks_per_sec,
+			ionice_class, ionice_level, page_size);
+
+	for (ss = stressors_list; ss; ss = ss->next) {
+		int32_t j;
+
+		if (ss->ignore.run || ss->ignore.permute)
+			continue;
+		for (j = 0; j < ss->instances; j++) {
+			stress_stats_t *const stats = ss->stats[j];
+
+			if (stats->s_pid.pid <= 0) {
+				not_started++;
+				continue;
+			}
+			stats->signalled = false;
+			started_instances++;
+			stress_ftrace_add_pid(stats->s_pid.pid, ss->stressor->name);
+			stress_sync_start_s_pid_list_add(s_pids_head, &stats->s_pid);
+		}
+	}
+	if (ret < 0) {
+		if (started_instances == 0)
+			return -1;
+		pr_err("%" PRId32 " stressor instance%s not started by a failed launcher\n",
+			not_started, (not_started == 1) ? " was" : "s were");
+		for (ss = stressors_list; ss; ss = ss->next) {
+			int32_t j;
+
+			if (ss->ignore.run || ss->ignore.permute)
+				continue;
+			for (j = 0; j < ss->instances; j++) {
+				if (ss->stats[j]->s_pid.pid <= 0)
+					ss->status[STRESS_STRESSOR_STATUS_FAILED]++;
+			}
+		}
+		*success = false;
+	}
+	return started_instances;
+}
+#endif
+
+/*
+ *  stress_run_fork()
+ *	fork the instances of the stressors in stressors_list, each
+ *	instance is added to the s_pids_head sync-start list, returns
+ *	the number of instances started
+ */
+static int32_t MLOCKED_TEXT stress_run_fork(
+	const int32_t ticks_per_sec,
+	stress_stressor_t *stressors_list,
+	stress_checksum_t **checksum,
+	stress_pid_t **s_pids_head,
+	const double time_start,
+	const int64_t backoff,
+	const int32_t ionice_class,
+	const int32_t ionice_level,
+	const size_t page_size,
+	uint32_t *placement_index)
+{
+	int32_t started_instances = 0;
+
+#if !defined(STRESS_TERMINATE_PREMATURELY)
+	(void)time_start;
+#endif
+	for (g_stressor_current = stressors_list; g_stressor_current; g_stressor_current = g_stressor_current->next) {
+		int32_t j;
+		bool instance_threads;
+
+		if (g_stressor_current->ignore.run || g_stressor_current->ignore.permute) {
+			*checksum += g_stressor_current->instances;
+			continue;
+		}
+		instance_threads = stress_instance_threads(g_stressor_current);
+		if (instance_threads)
+			pr_dbg("%s: running %" PRId32 " instances as threads\n",
+				g_stressor_current->stressor->name, g_stressor_current->instances);
+
+		/*
+		 *  Each stressor has 1 or more instances to run
+		 */
+		for (j = 0; j < g_stressor_current->instances; j++, (*checksum)++) {
+			double fork_time_start;
+			pid_t pid, child_pid;
+			int rc;
+			stress_stats_t *const stats = g_stressor_current->stats[j];
+
+#if defined(STRESS_TERMINATE_PREMATURELY)
+			if (g_opt_timeout && (stress_time_now() - time_start > (double)g_opt_timeout))
+				return started_instances;
+#endif
+			stress_sync_start_init(&stats->s_pid);
+			stats->args.ci->counter_ready = true;
+			stats->args.ci->counter = 0;
+			stats->checksum = *checksum;
+			stats->placement_cpu = g_stressor_current->interference.pin ?
+				g_stressor_current->interference.cpu : stress_placement_cpu((*placement_index)++);
+			stats->instance_thread = false;
+			if ((j > 0) && instance_threads) {
+				/* run as a thread by the instance 0 stressor process */
+				stats->s_pid.pid = 0;
+				stats->s_pid.reaped = true;
+				stats->signalled = false;
+				stats->instance_thread = true;
+				stats->exit_status = -1;
+#if defined(STRESS_SYNC_START_FUTEX)
+				stress_sync_start_s_pid_list_add(s_pids_head, &stats->s_pid);
+#endif
+				continue;
+			}
+again:
+			if (!stress_continue_flag())
+				break;
+			fork_time_start = stress_time_now();
+			pid = fork();
+			switch (pid) {
+			case -1:
+				stats->s_pid.reaped = true;
+				if (errno == EAGAIN) {
+					(void)shim_usleep(100000);
+					goto again;
+				}
+				pr_err("Cannot fork: errno=%d (%s)\n",
+					errno, strerror(errno));
+				stress_kill_stressors(SIGALRM, false);
+				return started_instances;
+			case 0:
+				/* Child */
+				child_pid = getpid();
+				stats->s_pid.reaped = false;
+				stats->s_pid.pid = child_pid;
+				stress_placement_set(stats->placement_cpu);
+				stress_stressor_cgroup_join(g_stressor_current->stressor->name);
+				stress_resctrl_join(g_stressor_current->stressor->name);
+				if (g_opt_flags & OPT_FLAGS_C_STATES) {
+					stress_cpuidle_read_cstates_begin(&stats->cstates);
+					stress_cpuidle_percpu_begin(g_stressor_current, (uint32_t)j);
+				}
+				rc = stress_run_child(checksum,
+						stats, fork_time_start,
+						backoff, ticks_per_sec,
+						ionice_class, ionice_level,
+						j, started_instances,
+						page_size, child_pid, instance_threads, true);
+				if (g_opt_flags & OPT_FLAGS_C_STATES) {
+					stress_cpuidle_read_cstates_end(&stats->cstates);
+					stress_cpuidle_percpu_end(g_stressor_current, (uint32_t)j);
+				}
+				stress_resctrl_sample(g_stressor_current->stressor->name,
+					&stats->resctrl_llc_occupancy);
+				_exit(rc);
+			default:
+				if (pid > -1) {
+					stats->s_pid.pid = pid;
+					stats->s_pid.reaped = false;
+					stats->signalled = false;
+					started_instances++;
+					stress_ftrace_add_pid(pid, g_stressor_current->stressor->name);
+#if defined(STRESS_PERF_SAMPLE)
+					stress_perf_sample_attach(g_stressor_current, pid);
+#endif
+
+					stress_sync_start_s_pid_list_add(s_pids_head, &stats->s_pid);
+				}
+
+				/* Forced early abort during startup? */
+				if (!stress_continue_flag()) {
+					pr_dbg("abort signal during startup, cleaning up\n");
+					stress_kill_stressors(SIGALRM, true);
+					return started_instances;
+				}
+				break;
+			}
+		}
+	}
+	return started_instances;
+}
+
+/*
+ *  stress_pipeline_start()
+ *	fork the instances of the next stressor in the --pipeline-seq
+ *	so they initialise and park on the sync-start barrier, they are
+ *	released by the next stress_run() call
+ */
+static void stress_pipeline_start(const int32_t ticks_per_sec)
+{
+	stress_stressor_t *ss = pipeline.ss;
+	stress_stressor_t *next;
+	stress_checksum_t *checksum = pipeline.checksum;
+	int64_t backoff = DEFAULT_BACKOFF;
+	int32_t ionice_class = UNDEFINED;
+	int32_t ionice_level = UNDEFINED;
+	uint32_t placement_index = 0;
+
+	(void)stress_get_setting("backoff", &backoff);
+	(void)stress_get_setting("ionice-class", &ionice_class);
+	(void)stress_get_setting("ionice-level", &ionice_level);
+
+	pr_dbg("%s: pre-starting stressor\n", ss->stressor->name);
+	pipeline.s_pids_head = NULL;
+	next = ss->next;
+	ss->next = NULL;
+	pipeline.started_instances = stress_run_fork(ticks_per_sec, ss,
+		&checksum, &pipeline.s_pids_head, stress_time_now(), backoff,
+		ionice_class, ionice_level, stress_get_page_size(), &placement_index);
+	ss->next = next;
+	pipeline.checksum = checksum;
+	pipeline.started_ss = ss;
+	pipeline.started = true;
+}
+
+/*
+ *  stress_pipeline_stop()
+ *	stop and reap a pre-started stressor that was never run,
+ *	e.g. the run was aborted while it was parked on the barrier
+ */
+static void stress_pipeline_stop(bool *success, bool *resource_success, bool *metrics_success)
+{
+	stress_stressor_t *ss = pipeline.started_ss;
+	int32_t j;
+
+	if (!pipeline.started)
+		return;
+	pipeline.started = false;
+
+	for (j = 0; j < ss->instances; j++) {
+		const pid_t pid = ss->stats[j]->s_pid.pid;
+
+		if (pid > 1)
+			(void)kill(pid, SIGALRM);
+	}
+	for (j = 0; j < ss->instances; j++) {
+		stress_stats_t *const stats = ss->stats[j];
+		const pid_t pid = stats->s_pid.pid;
+
+		if (pid) {
+			stress_wait_pid(ss, pid, stats,
+				success, resource_success, metrics_success, 0);
+			stress_clean_dir(ss->stressor->name, pid, (uint32_t)j);
+		}
+	}
+}
+
+/*
+ *  stress_run()
+ *	kick off and run stressors
+ */
+static void MLOCKED_TEXT stress_run(
+	const int32_t ticks_per_sec,
+	stress_stressor_t *stressors_list,
+	double *duration,
+	bool *success,
+	bool *resource_success,
+	bool *metrics_success,
+	stress_checksum_t **checksum)
+{
+	double time_start, time_finish;
+	int32_t started_instances = 0;
+	const size_t page_size = stress_get_page_size();
+	int64_t backoff = DEFAULT_BACKOFF;
+	int32_t ionice_class = UNDEFINED;
+	int32_t ionice_level = UNDEFINED;
+	bool handler_set = false;
+	stress_pid_t *s_pids_head = NULL;
+	int32_t launchers = 0;
+	int32_t placement = STRESS_PLACEMENT_NONE;
+	uint32_t placement_index = 0;
+
+	wait_flag = true;
+	time_start = stress_time_now();
+
+	(void)stress_get_setting("backoff", &backoff);
+	(void)stress_get_setting("ionice-class", &ionice_class);
+	(void)stress_get_setting("ionice-level", &ionice_level);
+	(void)stress_get_setting("launchers", &launchers);
+	(void)stress_get_setting("placement", &placement);
+	if ((placement != STRESS_PLACEMENT_NONE) && (stress_placement_cpu(0) < 0)) {
+		if (stress_placement_init((stress_placement_policy_t)placement) > 0) {
+			pr_dbg("placement: using %s policy\n",
+				stress_placement_name((stress_placement_policy_t)placement));
+		} else {
+			pr_inf("placement: cannot determine CPUs to use, ignoring --placement option\n");
+			placement = STRESS_PLACEMENT_NONE;
+		}
+	}
+
+	if (g_opt_pause) {
+		static bool first_run = true;
+
+		if (first_run)
+			first_run = false;
+		else {
+			pr_dbg("pausing for %u second%s\n", g_opt_pause,
+				g_opt_pause == 1 ? "" : "s");
+			(void)sleep(g_opt_pause);
+		}
+	}
+	if (pipeline.started && (pipeline.started_ss == stressors_list)) {
+		/* already forked and waiting on the barrier by --pipeline-seq */
+		s_pids_head = pipeline.s_pids_head;
+		started_instances = pipeline.started_instances;
+		*checksum = pipeline.checksum;
+		pipeline.started = false;
+		goto started;
+	}
+	pr_dbg("starting stressors\n");
+
+#if defined(STRESS_RUN_LAUNCHERS)
+	if (launchers > 1) {
+		static bool subreaper = false;
+
+		if (!subreaper && (prctl(PR_SET_CHILD_SUBREAPER, 1) == 0))
+			subreaper = true;
+		if (subreaper) {
+			stress_stressor_t *ss;
+			stress_checksum_t *checksum_start = *checksum;
+
+			/* set up all the per-instance state before forking launchers */
+			for (ss = stressors_list; ss; ss = ss->next) {
+				int32_t j;
+
+				if (ss->ignore.run || ss->ignore.permute) {
+					*checksum += ss->instances;
+					continue;
+				}
+				for (j = 0; j < ss->instances; j++, (*checksum)++) {
+					stress_stats_t *const stats = ss->stats[j];
+
+					stress_sync_start_init(&stats->s_pid);
+					stats->s_pid.pid = 0;
+					stats->s_pid.reaped = true;
+					stats->args.ci->counter_ready = true;
+					stats->args.ci->counter = 0;
+					stats->checksum = *checksum;
+					stats->placement_cpu = ss->interference.pin ?
+						ss->interference.cpu : stress_placement_cpu(placement_index++);
+				}
+			}
+			started_instances = stress_run_launchers(stressors_list, &s_pids_head,
+				launchers, backoff, ticks_per_sec, ionice_class, ionice_level,
+				page_size, success);
+			if (started_instances >= 0) {
+				pr_dbg("stressors started by a launcher tree with a fan-out of %" PRId32 "\n", launchers);
+				goto started;
+			}
+			/* no launcher could fork any stressors, fall back to serial forking */
+			*checksum = checksum_start;
+			started_instances = 0;
+			placement_index = 0;
+		} else {
+			pr_inf("cannot set child subreaper, ignoring --launchers option\n");
+		}
+	}
+#else
+	if (launchers > 1)
+		pr_inf("--launchers option not supported on this system, ignoring option\n");
+#endif
+
+	/*
+	 *  Work through the list of stressors to run
+	 */
+	started_instances = stress_run_fork(ticks_per_sec, stressors_list,
+		checksum, &s_pids_head, time_start, backoff,
+		ionice_class, ionice_level, page_size, &placement_index);
+started:
+	if (!handler_set) {
+		(void)stress_set_handler("stress-ng", false);
+		handler_set = true;
+	}
+	pr_dbg("%d stressor%s started\n", started_instances,
+		 started_instances == 1 ? "" : "s");
+
+	if (g_opt_flags & OPT_FLAGS_IGNITE_CPU)
 		stress_ignite_cpu_start();
 #if STRESS_FORCE_TIMEOUT_ALL
 	if (!(g_opt_flags & OPT_FLAGS_SYNC_START))
@@ -1968,6 +3708,9 @@ wait_for_stressors:
 #endif
 	stress_wait_stressors(s_pids_head, ticks_per_sec, stressors_list, success, resource_success, metrics_success);
 	time_finish = stress_time_now();
+#if defined(STRESS_PERF_SAMPLE)
+	stress_perf_sample_detach_all();
+#endif
 
 	*duration += time_finish - time_start;
 }
@@ -2011,186 +3754,699 @@ static int stress_show_stressors(void)
 			len += buffer_len;
 		}
 	}
-	pr_inf("dispatching hogs:%s\n", str ? str : "");
-	free(str);
-
-	return 0;
+	pr_inf("dispatching hogs:%s\n", str ? str : "");
+	free(str);
+
+	return 0;
+}
+
+/*
+ *  stress_exit_status_type()
+ *	report exit status of all instances of a given status type
+ */
+static void stress_exit_status_type(const char *name, const size_t type)
+{
+	stress_stressor_t *ss;
+
+	char *str;
+	size_t str_len = 1;
+	uint32_t n = 0;
+
+	str = malloc(1);
+	if (!str)
+		return;
+	*str = '\0';
+
+	for (ss = stressors_head; ss; ss = ss->next) {
+		uint32_t count = ss->status[type];
+
+		if ((ss->ignore.run) && (type == STRESS_STRESSOR_STATUS_SKIPPED)) {
+			count = ss->instances;
+		}
+		if (count > 0) {
+			char buf[80];
+			char *new_str;
+			size_t buf_len;
+
+			(void)snprintf(buf, sizeof(buf), " %s (%" PRIu32")",
+				ss->stressor->name, count);
+			buf_len = strlen(buf);
+			new_str = realloc(str, str_len + buf_len);
+			if (!new_str) {
+				free(str);
+				return;
+			}
+			str = new_str;
+			str_len += buf_len;
+			(void)shim_strlcat(str, buf, str_len);
+			n += count;
+		}
+	}
+	if (n) {
+		pr_inf("%s: %" PRIu32 ":%s\n", name, n, str);
+	} else  {
+		pr_inf("%s: 0\n", name);
+	}
+	free(str);
+}
+
+/*
+ *  stress_exit_status_summary()
+ *	provide summary of exit status of all instances
+ */
+static void stress_exit_status_summary(void)
+{
+	stress_exit_status_type("skipped", STRESS_STRESSOR_STATUS_SKIPPED);
+	stress_exit_status_type("passed", STRESS_STRESSOR_STATUS_PASSED);
+	stress_exit_status_type("failed", STRESS_STRESSOR_STATUS_FAILED);
+	stress_exit_status_type("metrics untrustworthy", STRESS_STRESSOR_STATUS_BAD_METRICS);
+}
+
+/*
+ *  stress_metrics_check()
+ *	as per ELISA request, sanity check bogo ops and run flag
+ *	to see if corruption occurred and print failure messages
+ *	and set *success to false if hash and data is dubious.
+ */
+static void stress_metrics_check(bool *success)
+{
+	stress_stressor_t *ss;
+	bool ok = true;
+	uint64_t counter_check = 0;
+	uint32_t instances = 0;
+	double min_run_time = DBL_MAX;
+
+	for (ss = stressors_head; ss; ss = ss->next) {
+		int32_t j;
+
+		if (ss->ignore.run)
+			continue;
+
+		instances += ss->instances;
+
+		for (j = 0; j < ss->instances; j++) {
+			const stress_stats_t *const stats = ss->stats[j];
+			const stress_checksum_t *checksum = stats->checksum;
+			stress_checksum_t stats_checksum;
+
+			if (!stats->completed)
+				continue;
+
+			counter_check |= stats->args.ci->counter;
+			if (stats->duration < min_run_time)
+				min_run_time = stats->duration;
+
+			if (checksum == NULL) {
+				pr_fail("%s instance %d unexpected null checksum data\n",
+					ss->stressor->name, j);
+				ok = false;
+				continue;
+			}
+
+			(void)shim_memset(&stats_checksum, 0, sizeof(stats_checksum));
+			stats_checksum.data.ci.counter = stats->args.ci->counter;
+			stats_checksum.data.ci.run_ok = stats->args.ci->run_ok;
+			stress_hash_checksum(&stats_checksum);
+
+			if (stats->args.ci->counter != checksum->data.ci.counter) {
+				pr_fail("%s instance %d corrupted bogo-ops counter, %" PRIu64 " vs %" PRIu64 "\n",
+					ss->stressor->name, j,
+					stats->args.ci->counter, checksum->data.ci.counter);
+				ok = false;
+			}
+			if (stats->args.ci->run_ok != checksum->data.ci.run_ok) {
+				pr_fail("%s instance %d corrupted run flag, %d vs %d\n",
+					ss->stressor->name, j,
+					stats->args.ci->run_ok, checksum->data.ci.run_ok);
+				ok = false;
+			}
+			if (stats_checksum.hash != checksum->hash) {
+				pr_fail("%s instance %d hash error in bogo-ops counter and run flag, %" PRIu32 " vs %" PRIu32 "\n",
+					ss->stressor->name, j,
+					stats_checksum.hash, checksum->hash);
+				ok = false;
+			}
+		}
+	}
+
+	/*
+	 *  No point sanity checking metrics if nothing happened
+	 */
+	if (instances == 0) {
+		pr_dbg("metrics-check: no stressors run\n");
+		return;
+	}
+
+	/*
+	 *  Bogo ops counter should be not zero for the majority of
+	 *  stressors after 30 seconds of run time
+	 */
+	if (!counter_check && (min_run_time > 30.0))
+		pr_warn("metrics-check: all bogo-op counters are zero, data may be incorrect\n");
+
+	if (ok) {
+		pr_dbg("metrics-check: all stressor metrics validated and sane\n");
+	} else {
+		pr_fail("metrics-check: stressor metrics corrupted, data is compromised\n");
+		*success = false;
+	}
+}
+
+static char *stress_description_yamlify(const char *description)
+{
+	static char yamlified[40];
+	char *dst;
+	const char *src, *end = yamlified + sizeof(yamlified);
+
+	for (dst = yamlified, src = description; *src; src++) {
+		register int ch = (int)*src;
+
+		if (isalpha((unsigned char)ch)) {
+			*(dst++) = (char)tolower((unsigned char)ch);
+		} else if (isdigit((unsigned char)ch)) {
+			*(dst++) = (char)ch;
+		} else if (ch == ' ') {
+			*(dst++) = '-';
+		}
+		if (dst >= end - 1)
+			break;
+	}
+	*dst = '\0';
+
+	return yamlified;
+}
+
+/*
+ *  stress_metrics_interval_proc_usage()
+ *	get live user, system times and rss of a running stressor
+ *	instance, returns 0 if OK, -1 if not available
+ */
+static int stress_metrics_interval_proc_usage(
+	const pid_t pid,
+	double *utime,
+	double *stime,
+	long int *rss_kb)
+{
+#if defined(__linux__)
+	char path[64], buf[1024], *ptr;
+	unsigned long int u, s;
+	long int rss;
+	long int ticks_per_sec;
+	ssize_t ret;
+
+	(void)snprintf(path, sizeof(path), "/proc/%" PRIdMAX "/stat", (intmax_t)pid);
+	ret = stress_system_read(path, buf, sizeof(buf));
+	if (ret <= 0)
+		return -1;
+	/* skip over comm field, it may contain spaces */
+	ptr = strrchr(buf, ')');
+	if (!ptr)
+		return -1;
+	if (sscanf(ptr + 2, "%*c %*d %*d %*d %*d %*d %*u %*u %*u %*u %*u %lu %lu "
+			   "%*d %*d %*d %*d %*d %*d %*u %*u %ld", &u, &s, &rss) != 3)
+		return -1;
+	ticks_per_sec = sysconf(_SC_CLK_TCK);
+	if (ticks_per_sec <= 0)
+		return -1;
+	*utime += (double)u / (double)ticks_per_sec;
+	*stime += (double)s / (double)ticks_per_sec;
+	rss = rss * (long int)(stress_get_page_size() / KB);
+	if (*rss_kb < rss)
+		*rss_kb = rss;
+	return 0;
+#else
+	(void)pid;
+	(void)utime;
+	(void)stime;
+	(void)rss_kb;
+
+	return -1;
+#endif
+}
+
+/*
+ *  stress_metrics_interval_dump()
+ *	output a timestamped JSON line of live metrics per stressor,
+ *	this is called periodically by the --metrics-interval sampler
+ *	and it is flushed on each call so data is streamed out. The
+ *	hottest thermal zone temperature and thermal throttle events
+ *	since the previous sample are included so that throughput dips
+ *	can be correlated with thermal throttling
+ */
+void stress_metrics_interval_dump(FILE *fp, const double now)
+{
+	stress_stressor_t *ss;
+	double temperature = 0.0;
+	uint64_t core_throttles = 0, package_throttles = 0;
+	bool throttle_valid = false;
+	bool psi = false;
+#if defined(STRESS_THERMAL_ZONES)
+	static stress_tz_throttle_t throttle_prev;
+	static bool throttle_prev_valid = false;
+	stress_tz_throttle_t throttle;
+
+	temperature = stress_tz_get_max_temperature();
+	if (stress_tz_get_throttle(&throttle) == 0) {
+		if (throttle_prev_valid) {
+			core_throttles = throttle.core - throttle_prev.core;
+			package_throttles = throttle.package - throttle_prev.package;
+			throttle_valid = true;
+		}
+		throttle_prev = throttle;
+		throttle_prev_valid = true;
+	}
+#endif
+
+	(void)stress_get_setting("psi", &psi);
+	for (ss = stressors_head; ss; ss = ss->next) {
+		uint64_t bogo_ops = 0, delta_ops;
+		double utime = 0.0, stime = 0.0, dt, rate;
+		long int rss_kb = 0;
+		int32_t j, running = 0;
+		size_t i;
+		stress_json_t json;
+
+		if (ss->ignore.run || ss->ignore.permute)
+			continue;
+
+		for (j = 0; j < ss->instances; j++) {
+			const stress_stats_t *const stats = ss->stats[j];
+
+			if (!stats)
+				continue;
+			bogo_ops += stats->args.ci->counter;
+			if (stats->s_pid.pid && !stats->s_pid.reaped &&
+			    (stress_metrics_interval_proc_usage(stats->s_pid.pid,
+					&utime, &stime, &rss_kb) == 0)) {
+				running++;
+				/* include the oomable child doing the work */
+				if (stats->s_pid.oomable_child)
+					(void)stress_metrics_interval_proc_usage(stats->s_pid.oomable_child,
+						&utime, &stime, &rss_kb);
+			}
+		}
+		if (ss->interval.time <= 0.0)
+			ss->interval.time = g_shared->time_started;
+		/* sequential and permute runs reset the counters */
+		delta_ops = (bogo_ops >= ss->interval.bogo_ops) ?
+			bogo_ops - ss->interval.bogo_ops : bogo_ops;
+		dt = now - ss->interval.time;
+		rate = (dt > 0.0) ? (double)delta_ops / dt : 0.0;
+		ss->interval.bogo_ops = bogo_ops;
+		ss->interval.time = now;
+
+		if (!fp) {
+			char therm[64];
+
+			*therm = '\0';
+			if (temperature > 0.0)
+				(void)snprintf(therm, sizeof(therm), ", %.1f C", temperature);
+			if (throttle_valid)
+				(void)snprintf(therm + strlen(therm), sizeof(therm) - strlen(therm),
+					", %" PRIu64 " throttles",
+					core_throttles + package_throttles);
+			pr_inf("metrics-interval: %-13s %9" PRIu64 " bogo ops, %12.2f bogo ops/s, %d running%s\n",
+				ss->stressor->name, bogo_ops, rate, running, therm);
+			if (psi)
+				stress_psi_interval(NULL, ss->stressor->name);
+			if (!stress_json_enabled())
+				continue;
+		}
+
+		/* one interval record for both --json and --metrics-interval-file */
+		stress_json_begin(&json, "interval");
+		stress_json_double(&json, "run-time", now - g_shared->time_started);
+		stress_json_str(&json, "stressor", ss->stressor->name);
+		stress_json_int64(&json, "instances", (int64_t)ss->instances);
+		stress_json_int64(&json, "running", (int64_t)running);
+		stress_json_uint64(&json, "bogo-ops", bogo_ops);
+		stress_json_double(&json, "bogo-ops-per-second", rate);
+		stress_json_double(&json, "user-time", utime);
+		stress_json_double(&json, "system-time", stime);
+		stress_json_int64(&json, "max-rss", (int64_t)rss_kb);
+		if (temperature > 0.0)
+			stress_json_double(&json, "max-temperature", temperature);
+		if (throttle_valid) {
+			stress_json_uint64(&json, "core-throttle-events", core_throttles);
+			stress_json_uint64(&json, "package-throttle-events", package_throttles);
+		}
+		if (psi)
+			stress_psi_interval(&json, ss->stressor->name);
+
+		/* misc metrics, mean of all instances that have set them */
+		stress_json_object_begin(&json, "metrics");
+		for (i = 0; ss->stats[0] && (i < ss->stats[0]->metrics.n_items); i++) {
+			const char *description = ss->stats[0]->metrics.items[i].description;
+			double total = 0.0;
+			int32_t n = 0;
+
+			if (!description)
+				continue;
+			for (j = 0; j < ss->instances; j++) {
+				const stress_metrics_item_t *item = stress_metrics_item(ss->stats[j], i);
+
+				if (item && item->description) {
+					total += item->value;
+					n++;
+				}
+			}
+			stress_json_double(&json, description, n ? total / (double)n : 0.0);
+		}
+		stress_json_object_end(&json);
+		stress_json_end_file(&json, fp);
+	}
+	if (fp)
+		(void)fflush(fp);
+}
+
+/*
+ *  stress_metrics_latency_yaml()
+ *	output merged latency statistics of a stressor to yaml file
+ */
+static void stress_metrics_latency_yaml(FILE *yaml, const stress_latency_stat_t *latency)
+{
+	static const double percentiles[] = { 50.0, 90.0, 99.0, 99.9, 99.99 };
+	static const char * const percentile_names[] = { "p50", "p90", "p99", "p999", "p9999" };
+	const stress_latency_hist_t *hist = &latency->hist;
+	char name[64];
+	size_t i;
+
+	(void)snprintf(name, sizeof(name), "%s", stress_description_yamlify(latency->description));
+	pr_yaml(yaml, "      latency-%s-samples: %" PRIu64 "\n", name, hist->count);
+	pr_yaml(yaml, "      latency-%s-mean-ns: %f\n", name, stress_latency_hist_mean(hist));
+	pr_yaml(yaml, "      latency-%s-min-ns: %" PRIu64 "\n", name, hist->min_ns);
+	for (i = 0; i < SIZEOF_ARRAY(percentiles); i++) {
+		pr_yaml(yaml, "      latency-%s-%s-ns: %" PRIu64 "\n", name, percentile_names[i],
+			stress_latency_hist_percentile(hist, percentiles[i]));
+	}
+	pr_yaml(yaml, "      latency-%s-max-ns: %" PRIu64 "\n", name, hist->max_ns);
+}
+
+/*
+ *  stress_metrics_warmup_check()
+ *	called by the periodic stats process to snapshot the bogo-op
+ *	counter and cpu times of each running stressor instance at the
+ *	end of the --warmup window. The snapshot is subtracted from the
+ *	totals when the instance finishes so that metrics only cover the
+ *	steady state. With --warmup auto the snapshot is taken once the
+ *	bogo-op rate of two consecutive windows differs by less than
+ *	STRESS_WARMUP_STEADY
+ */
+void stress_metrics_warmup_check(const int32_t warmup, const double now)
+{
+	stress_stressor_t *ss;
+
+	for (ss = stressors_head; ss; ss = ss->next) {
+		int32_t j;
+
+		if (ss->ignore.run || ss->ignore.permute || !ss->stats)
+			continue;
+
+		for (j = 0; j < ss->instances; j++) {
+			stress_stats_t *const stats = ss->stats[j];
+			stress_warmup_t *w;
+			uint64_t counter;
+			long int rss_kb = 0;
+
+			if (!stats)
+				continue;
+			w = &stats->warmup;
+			if (w->valid || !stats->s_pid.pid || stats->s_pid.reaped ||
+			    (stats->start <= 0.0) || (now < stats->start))
+				continue;
+
+			counter = stats->args.ci->counter;
+			if (warmup == STRESS_WARMUP_AUTO) {
+				double dt, rate, prev_rate;
+
+				if (w->window_time < stats->start) {
+					w->window_time = now;
+					w->window_counter = counter;
+					w->window_rate = 0.0;
+					continue;
+				}
+				dt = now - w->window_time;
+				if (dt < STRESS_WARMUP_WINDOW)
+					continue;
+				rate = (counter >= w->window_counter) ?
+					(double)(counter - w->window_counter) / dt : 0.0;
+				prev_rate = w->window_rate;
+				w->window_time = now;
+				w->window_counter = counter;
+				w->window_rate = rate;
+				if ((prev_rate <= 0.0) || (rate <= 0.0) ||
+				    (fabs(rate - prev_rate) > prev_rate * STRESS_WARMUP_STEADY))
+					continue;
+			} else if ((now - stats->start) < (double)warmup / 1000.0) {
+				continue;
+			}
+
+			w->utime = 0.0;
+			w->stime = 0.0;
+			w->usage = (stress_metrics_interval_proc_usage(stats->s_pid.pid,
+					&w->utime, &w->stime, &rss_kb) == 0);
+			if (w->usage && stats->s_pid.oomable_child)
+				(void)stress_metrics_interval_proc_usage(stats->s_pid.oomable_child,
+					&w->utime, &w->stime, &rss_kb);
+			w->counter = counter;
+			w->time = now;
+			w->valid = true;
+		}
+	}
+}
+
+/*
+ *  stress_metrics_offcpu_sample()
+ *	called by the periodic stats process to sample the --offcpu
+ *	scheduler statistics of running stressor instances, the
+ *	oomable child is sampled if the instance has one as this is
+ *	the process doing the work
+ */
+void stress_metrics_offcpu_sample(const double now)
+{
+	stress_stressor_t *ss;
+
+	for (ss = stressors_head; ss; ss = ss->next) {
+		int32_t j;
+
+		if (ss->ignore.run || ss->ignore.permute || !ss->stats)
+			continue;
+
+		for (j = 0; j < ss->instances; j++) {
+			stress_stats_t *const stats = ss->stats[j];
+			pid_t pid;
+
+			if (!stats || !stats->s_pid.pid || stats->s_pid.reaped)
+				continue;
+			pid = stats->s_pid.oomable_child ? stats->s_pid.oomable_child : stats->s_pid.pid;
+			stress_offcpu_sample(&stats->offcpu, pid, now);
+		}
+	}
+}
+
+/*
+ *  stress_metrics_memfootprint_sample()
+ *	called by the periodic stats process to sample the
+ *	--mem-footprint memory use and page faults of running
+ *	stressor instances and their oomable children
+ */
+void stress_metrics_memfootprint_sample(const double now)
+{
+	stress_stressor_t *ss;
+
+	for (ss = stressors_head; ss; ss = ss->next) {
+		int32_t j;
+
+		if (ss->ignore.run || ss->ignore.permute || !ss->stats)
+			continue;
+
+		for (j = 0; j < ss->instances; j++) {
+			stress_stats_t *const stats = ss->stats[j];
+
+			if (!stats || !stats->s_pid.pid || stats->s_pid.reaped)
+				continue;
+			stress_memfootprint_sample(&stats->memfootprint, stats->s_pid.pid,
+				stats->s_pid.oomable_child, now);
+		}
+	}
 }
 
 /*
- *  stress_exit_status_type()
- *	report exit status of all instances of a given status type
+ *  stress_metrics_ksm_sample()
+ *	called by the periodic stats process to sample the pages
+ *	merged by --ksm of running stressor instances and the
+ *	system wide pages sharing
  */
-static void stress_exit_status_type(const char *name, const size_t type)
+void stress_metrics_ksm_sample(void)
 {
 	stress_stressor_t *ss;
 
-	char *str;
-	size_t str_len = 1;
-	uint32_t n = 0;
-
-	str = malloc(1);
-	if (!str)
-		return;
-	*str = '\0';
-
+	stress_ksm_sys_sample();
 	for (ss = stressors_head; ss; ss = ss->next) {
-		uint32_t count = ss->status[type];
+		int32_t j;
 
-		if ((ss->ignore.run) && (type == STRESS_STRESSOR_STATUS_SKIPPED)) {
-			count = ss->instances;
-		}
-		if (count > 0) {
-			char buf[80];
-			char *new_str;
-			size_t buf_len;
+		if (ss->ignore.run || ss->ignore.permute || !ss->stats)
+			continue;
 
-			(void)snprintf(buf, sizeof(buf), " %s (%" PRIu32")",
-				ss->stressor->name, count);
-			buf_len = strlen(buf);
-			new_str = realloc(str, str_len + buf_len);
-			if (!new_str) {
-				free(str);
-				return;
-			}
-			str = new_str;
-			str_len += buf_len;
-			(void)shim_strlcat(str, buf, str_len);
-			n += count;
+		for (j = 0; j < ss->instances; j++) {
+			stress_stats_t *const stats = ss->stats[j];
+
+			if (!stats || !stats->s_pid.pid || stats->s_pid.reaped)
+				continue;
+			stress_ksm_sample(&stats->ksm, stats->s_pid.pid,
+				stats->s_pid.oomable_child);
 		}
 	}
-	if (n) {
-		pr_inf("%s: %" PRIu32 ":%s\n", name, n, str);
-	} else  {
-		pr_inf("%s: 0\n", name);
+}
+
+/*
+ *  stress_openmetrics_label()
+ *	output an escaped OpenMetrics label value
+ */
+static void stress_openmetrics_label(FILE *fp, const char *str)
+{
+	(void)fputc('"', fp);
+	for (; *str; str++) {
+		if ((*str == '"') || (*str == '\\'))
+			(void)fprintf(fp, "\\%c", *str);
+		else if (*str == '\n')
+			(void)fputs("\\n", fp);
+		else
+			(void)fputc(*str, fp);
 	}
-	free(str);
+	(void)fputc('"', fp);
 }
 
 /*
- *  stress_exit_status_summary()
- *	provide summary of exit status of all instances
+ *  stress_openmetrics_family()
+ *	output an OpenMetrics metric family header
  */
-static void stress_exit_status_summary(void)
+static void stress_openmetrics_family(
+	FILE *fp,
+	const char *name,
+	const char *type,
+	const char *help)
 {
-	stress_exit_status_type("skipped", STRESS_STRESSOR_STATUS_SKIPPED);
-	stress_exit_status_type("passed", STRESS_STRESSOR_STATUS_PASSED);
-	stress_exit_status_type("failed", STRESS_STRESSOR_STATUS_FAILED);
-	stress_exit_status_type("metrics untrustworthy", STRESS_STRESSOR_STATUS_BAD_METRICS);
+	(void)fprintf(fp, "# TYPE stress_ng_%s %s\n", name, type);
+	(void)fprintf(fp, "# HELP stress_ng_%s %s\n", name, help);
 }
 
 /*
- *  stress_metrics_check()
- *	as per ELISA request, sanity check bogo ops and run flag
- *	to see if corruption occurred and print failure messages
- *	and set *success to false if hash and data is dubious.
+ *  stress_metrics_openmetrics_dump()
+ *	output live per stressor bogo-ops, rates, CPU usage and misc
+ *	metrics in the OpenMetrics text format for --metrics-listen. The
+ *	counters in the shared stats are read without locking so scraping
+ *	does not perturb the stressors
  */
-static void stress_metrics_check(bool *success)
+void stress_metrics_openmetrics_dump(FILE *fp, const double now)
 {
+	static const struct {
+		const char *name;
+		const char *type;
+		const char *suffix;
+		const char *help;
+	} families[] = {
+		{ "bogo_ops",		"counter",	"_total",	"Bogo operations completed by all instances." },
+		{ "bogo_ops_per_second","gauge",	"",		"Bogo operations per second of wall clock time." },
+		{ "instances",		"gauge",	"",		"Instances of the stressor." },
+		{ "instances_running",	"gauge",	"",		"Instances of the stressor that are running." },
+		{ "user_seconds",	"counter",	"_total",	"User CPU time of running instances." },
+		{ "system_seconds",	"counter",	"_total",	"System CPU time of running instances." },
+		{ "max_rss_bytes",	"gauge",	"",		"Largest resident set size of running instances." },
+	};
 	stress_stressor_t *ss;
-	bool ok = true;
-	uint64_t counter_check = 0;
-	uint32_t instances = 0;
-	double min_run_time = DBL_MAX;
-
-	for (ss = stressors_head; ss; ss = ss->next) {
-		int32_t j;
-
-		if (ss->ignore.run)
-			continue;
+	size_t f, i;
 
-		instances += ss->instances;
+	for (f = 0; f < SIZEOF_ARRAY(families); f++) {
+		stress_openmetrics_family(fp, families[f].name, families[f].type, families[f].help);
 
-		for (j = 0; j < ss->instances; j++) {
-			const stress_stats_t *const stats = ss->stats[j];
-			const stress_checksum_t *checksum = stats->checksum;
-			stress_checksum_t stats_checksum;
+		for (ss = stressors_head; ss; ss = ss->next) {
+			uint64_t bogo_ops = 0;
+			double utime = 0.0, stime = 0.0, elapsed = 0.0, value = 0.0;
+			long int rss_kb = 0;
+			int32_t j, running = 0, started = 0;
 
-			if (!stats->completed)
+			if (ss->ignore.run || ss->ignore.permute || !ss->stats)
 				continue;
 
-			counter_check |= stats->args.ci.counter;
-			if (stats->duration < min_run_time)
-				min_run_time = stats->duration;
+			for (j = 0; j < ss->instances; j++) {
+				const stress_stats_t *const stats = ss->stats[j];
 
-			if (checksum == NULL) {
-				pr_fail("%s instance %d unexpected null checksum data\n",
-					ss->stressor->name, j);
-				ok = false;
-				continue;
+				if (!stats || (stats->start <= 0.0))
+					continue;
+				started++;
+				bogo_ops += stats->args.ci->counter;
+				if (stats->s_pid.pid && !stats->s_pid.reaped &&
+				    (stress_metrics_interval_proc_usage(stats->s_pid.pid,
+						&utime, &stime, &rss_kb) == 0)) {
+					running++;
+					elapsed += now - stats->start;
+					if (stats->s_pid.oomable_child)
+						(void)stress_metrics_interval_proc_usage(stats->s_pid.oomable_child,
+							&utime, &stime, &rss_kb);
+				} else {
+					elapsed += stats->duration;
+				}
 			}
 
-			(void)shim_memset(&stats_checksum, 0, sizeof(stats_checksum));
-			stats_checksum.data.ci.counter = stats->args.ci.counter;
-			stats_checksum.data.ci.run_ok = stats->args.ci.run_ok;
-			stress_hash_checksum(&stats_checksum);
-
-			if (stats->args.ci.counter != checksum->data.ci.counter) {
-				pr_fail("%s instance %d corrupted bogo-ops counter, %" PRIu64 " vs %" PRIu64 "\n",
-					ss->stressor->name, j,
-					stats->args.ci.counter, checksum->data.ci.counter);
-				ok = false;
-			}
-			if (stats->args.ci.run_ok != checksum->data.ci.run_ok) {
-				pr_fail("%s instance %d corrupted run flag, %d vs %d\n",
-					ss->stressor->name, j,
-					stats->args.ci.run_ok, checksum->data.ci.run_ok);
-				ok = false;
-			}
-			if (stats_checksum.hash != checksum->hash) {
-				pr_fail("%s instance %d hash error in bogo-ops counter and run flag, %" PRIu32 " vs %" PRIu32 "\n",
-					ss->stressor->name, j,
-					stats_checksum.hash, checksum->hash);
-				ok = false;
+			switch (f) {
+			case 0:
+				value = (double)bogo_ops;
+				break;
+			case 1:
+				value = (started && (elapsed > 0.0)) ?
+					(double)bogo_ops / (elapsed / (double)started) : 0.0;
+				break;
+			case 2:
+				value = (double)ss->instances;
+				break;
+			case 3:
+				value = (double)running;
+				break;
+			case 4:
+				value = utime;
+				break;
+			case 5:
+				value = stime;
+				break;
+			default:
+				value = (double)rss_kb * (double)KB;
+				break;
 			}
+			(void)fprintf(fp, "stress_ng_%s%s{stressor=", families[f].name, families[f].suffix);
+			stress_openmetrics_label(fp, ss->stressor->name);
+			(void)fprintf(fp, "} %.17g\n", value);
 		}
 	}
 
-	/*
-	 *  No point sanity checking metrics if nothing happened
-	 */
-	if (instances == 0) {
-		pr_dbg("metrics-check: no stressors run\n");
-		return;
-	}
-
-	/*
-	 *  Bogo ops counter should be not zero for the majority of
-	 *  stressors after 30 seconds of run time
-	 */
-	if (!counter_check && (min_run_time > 30.0))
-		pr_warn("metrics-check: all bogo-op counters are zero, data may be incorrect\n");
-
-	if (ok) {
-		pr_dbg("metrics-check: all stressor metrics validated and sane\n");
-	} else {
-		pr_fail("metrics-check: stressor metrics corrupted, data is compromised\n");
-		*success = false;
-	}
-}
+	stress_openmetrics_family(fp, "metric", "gauge",
+		"Stressor specific metric, mean of the instances that reported it.");
+	for (ss = stressors_head; ss; ss = ss->next) {
+		if (ss->ignore.run || ss->ignore.permute || !ss->stats)
+			continue;
 
-static char *stress_description_yamlify(const char *description)
-{
-	static char yamlified[40];
-	char *dst;
-	const char *src, *end = yamlified + sizeof(yamlified);
+		for (i = 0; i < ss->stats[0]->metrics.n_items; i++) {
+			const char *description = ss->stats[0]->metrics.items[i].description;
+			double total = 0.0;
+			int32_t j, n = 0;
 
-	for (dst = yamlified, src = description; *src; src++) {
-		register int ch = (int)*src;
+			if (!description)
+				continue;
+			for (j = 0; j < ss->instances; j++) {
+				const stress_metrics_item_t *item = stress_metrics_item(ss->stats[j], i);
 
-		if (isalpha((unsigned char)ch)) {
-			*(dst++) = (char)tolower((unsigned char)ch);
-		} else if (isdigit((unsigned char)ch)) {
-			*(dst++) = (char)ch;
-		} else if (ch == ' ') {
-			*(dst++) = '-';
+				if (item && item->description) {
+					total += item->value;
+					n++;
+				}
+			}
+			(void)fprintf(fp, "stress_ng_metric{stressor=");
+			stress_openmetrics_label(fp, ss->stressor->name);
+			(void)fprintf(fp, ",metric=");
+			stress_openmetrics_label(fp, description);
+			(void)fprintf(fp, "} %.17g\n", n ? total / (double)n : 0.0);
 		}
-		if (dst >= end - 1)
-			break;
 	}
-	*dst = '\0';
-
-	return yamlified;
 }
 
 /*
@@ -2202,7 +4458,19 @@ static void stress_metrics_dump(FILE *yaml)
 	stress_stressor_t *ss;
 	const stress_metrics_item_t *item;
 	const char *description;
+	stress_latency_stat_t *latency = NULL;
 	bool misc_metrics = false;
+	int32_t warmup = 0;
+
+	(void)stress_get_setting("warmup", &warmup);
+
+	if (g_opt_flags & OPT_FLAGS_LATENCY) {
+		latency = (stress_latency_stat_t *)malloc(sizeof(*latency));
+		if (!latency) {
+			pr_inf("cannot allocate latency statistics, not reporting latencies\n");
+			g_opt_flags &= ~OPT_FLAGS_LATENCY;
+		}
+	}
 
 	pr_block_begin();
 	if (g_opt_flags & OPT_FLAGS_METRICS_BRIEF) {
@@ -2224,10 +4492,10 @@ static void stress_metrics_dump(FILE *yaml)
 	pr_yaml(yaml, "metrics:\n");
 
 	for (ss = stressors_head; ss; ss = ss->next) {
-		uint64_t c_total = 0;
-		double   r_total = 0.0, u_total = 0.0, s_total = 0.0;
+		uint64_t c_total = 0, cyc_total = 0, ref_total = 0;
+		double   r_total = 0.0, u_total = 0.0, s_total = 0.0, cyc_utime = 0.0;
 		long int maxrss = 0;
-		int32_t  j;
+		int32_t  j, steady = 0;
 		size_t i;
 		const char *name;
 		double u_time, s_time, t_time, bogo_rate_r_time, bogo_rate, cpu_usage;
@@ -2248,8 +4516,10 @@ static void stress_metrics_dump(FILE *yaml)
 
 			if (stats->completed)
 				ss->completed_instances++;
+			if (stats->warmup.valid)
+				steady++;
 
-			run_ok  |= stats->args.ci.run_ok;
+			run_ok  |= stats->args.ci->run_ok;
 			c_total += stats->counter_total;
 			u_total += stats->rusage_utime_total;
 			s_total += stats->rusage_stime_total;
@@ -2258,6 +4528,9 @@ static void stress_metrics_dump(FILE *yaml)
 				maxrss = stats->rusage_maxrss;
 #endif
 			r_total += stats->duration_total;
+			cyc_total += stats->cpu_cycles;
+			ref_total += stats->cpu_ref_cycles;
+			cyc_utime += stats->cpu_cycles_utime;
 		}
 		/* Real time in terms of average wall clock time of all procs */
 		r_total = ss->completed_instances ?
@@ -2350,8 +4623,28 @@ static void stress_metrics_dump(FILE *yaml)
 			pr_yaml(yaml, "      cpu-usage-per-instance: %f\n", cpu_usage);
 			pr_yaml(yaml, "      max-rss: %ld\n", maxrss);
 		}
+		if (warmup) {
+			pr_yaml(yaml, "      warmup-excluded-instances: %" PRId32 "\n", steady);
+			if (steady < ss->instances)
+				pr_inf("%s: %" PRId32 " of %" PRId32 " instances did not complete the "
+					"warm-up, their metrics include the warm-up\n",
+					name, ss->instances - steady, ss->instances);
+		}
+		/* effective frequency of stressor threads, cycles / ref-cycles ~ APERF / MPERF */
+		if ((cyc_total > 0) && (ref_total > 0) && (cyc_utime > 0.0)) {
+			const double eff_ghz = (double)cyc_total / cyc_utime / STRESS_DBL_NANOSECOND;
+			const double ratio = (double)cyc_total / (double)ref_total;
+
+			if (g_opt_flags & OPT_FLAGS_SN) {
+				pr_yaml(yaml, "      cpu-effective-ghz: %e\n", eff_ghz);
+				pr_yaml(yaml, "      cpu-aperf-mperf-ratio: %e\n", ratio);
+			} else {
+				pr_yaml(yaml, "      cpu-effective-ghz: %f\n", eff_ghz);
+				pr_yaml(yaml, "      cpu-aperf-mperf-ratio: %f\n", ratio);
+			}
+		}
 
-		for (i = 0; i < SIZEOF_ARRAY(ss->stats[0]->metrics.items); i++) {
+		for (i = 0; i < ss->stats[0]->metrics.n_items; i++) {
 			item = &ss->stats[0]->metrics.items[i];
 			description = item->description;
 
@@ -2360,9 +4653,9 @@ static void stress_metrics_dump(FILE *yaml)
 
 				misc_metrics = true;
 				for (j = 0; j < ss->instances; j++) {
-					const stress_stats_t *const stats = ss->stats[j];
-
-					total += stats->metrics.items[i].value;
+					item = stress_metrics_item(ss->stats[j], i);
+					if (item)
+						total += item->value;
 				}
 				metric = ss->completed_instances ? total / ss->completed_instances : 0.0;
 				if (g_opt_flags & OPT_FLAGS_SN) {
@@ -2372,6 +4665,17 @@ static void stress_metrics_dump(FILE *yaml)
 				}
 			}
 		}
+#if defined(STRESS_RAPL)
+		if (g_opt_flags & OPT_FLAGS_RAPL)
+			stress_rapl_metrics_yaml(yaml, ss, g_shared->rapl_domains);
+#endif
+		if (yaml && (g_opt_flags & OPT_FLAGS_LATENCY)) {
+			for (i = 0; i < STRESS_LATENCY_MAX_IDS; i++) {
+				if (!stress_latency_merge(ss->stats, ss->instances, i, latency))
+					continue;
+				stress_metrics_latency_yaml(yaml, latency);
+			}
+		}
 		pr_yaml(yaml, "\n");
 	}
 
@@ -2388,11 +4692,11 @@ static void stress_metrics_dump(FILE *yaml)
 				continue;
 
 			name = ss->stressor->name;
-			if (ss->stats[0]->metrics.max_metrics > SIZEOF_ARRAY(ss->stats[0]->metrics.items))
-				pr_metrics("note: %zd metrics were set, only reporting first %zd metrics\n",
-					ss->stats[0]->metrics.max_metrics, SIZEOF_ARRAY(ss->stats[0]->metrics.items));
+			if (ss->stats[0]->metrics.max_metrics >= STRESS_MISC_METRICS_MAX)
+				pr_metrics("note: %zd metrics were set, only reporting first %d metrics\n",
+					ss->stats[0]->metrics.max_metrics + 1, STRESS_MISC_METRICS_MAX);
 
-			for (i = 0; i < SIZEOF_ARRAY(ss->stats[0]->metrics.items); i++) {
+			for (i = 0; i < ss->stats[0]->metrics.n_items; i++) {
 				item = &ss->stats[0]->metrics.items[i];
 				description = item->description;
 
@@ -2412,8 +4716,8 @@ static void stress_metrics_dump(FILE *yaml)
 							int e;
 							const stress_stats_t *const stats = ss->stats[j];
 
-							item = &stats->metrics.items[i];
-							if ((item->value > 0.0) || (item->value < 0.0)) {
+							item = stress_metrics_item(stats, i);
+							if (item && ((item->value > 0.0) || (item->value < 0.0))) {
 								const double f = frexp(item->value, &e);
 
 								mantissa *= f;
@@ -2445,8 +4749,8 @@ static void stress_metrics_dump(FILE *yaml)
 						for (j = 0; j < ss->instances; j++) {
 							const stress_stats_t *const stats = ss->stats[j];
 
-							item = &stats->metrics.items[i];
-							if ((item->value > 0.0) || (item->value < 0.0)) {
+							item = stress_metrics_item(stats, i);
+							if (item && ((item->value > 0.0) || (item->value < 0.0))) {
 								const double reciprocal = 1.0 / item->value;
 
 								sum += reciprocal;
@@ -2472,41 +4776,185 @@ static void stress_metrics_dump(FILE *yaml)
 						for (j = 0; j < ss->instances; j++) {
 							const stress_stats_t *const stats = ss->stats[j];
 
-							item = &stats->metrics.items[i];
-							if (item->value > 0.0)
-								total += item->value;
-						}
-						if (g_opt_flags & OPT_FLAGS_SN) {
-							pr_metrics("%-13s %13.2e %s (total of %" PRIu32 " instance%s)\n",
-								name, total, description,
-								ss->completed_instances, plural);
-						} else {
-							pr_metrics("%-13s %13.2f %s (total of %" PRIu32 " instance%s)\n",
-								name, total, description,
-								ss->completed_instances, plural);
-						}
-						break;
-					case STRESS_METRIC_MAXIMUM:
-						for (j = 0; j < ss->instances; j++) {
-							const stress_stats_t *const stats = ss->stats[j];
+							item = stress_metrics_item(stats, i);
+							if (item && item->value > 0.0)
+								total += item->value;
+						}
+						if (g_opt_flags & OPT_FLAGS_SN) {
+							pr_metrics("%-13s %13.2e %s (total of %" PRIu32 " instance%s)\n",
+								name, total, description,
+								ss->completed_instances, plural);
+						} else {
+							pr_metrics("%-13s %13.2f %s (total of %" PRIu32 " instance%s)\n",
+								name, total, description,
+								ss->completed_instances, plural);
+						}
+						break;
+					case STRESS_METRIC_MAXIMUM:
+						for (j = 0; j < ss->instances; j++) {
+							const stress_stats_t *const stats = ss->stats[j];
+
+							item = stress_metrics_item(stats, i);
+							if (item && (item->value > 0.0) && (item->value > maximum))
+								maximum = item->value;
+						}
+						if (g_opt_flags & OPT_FLAGS_SN) {
+							pr_metrics("%-13s %13.2e %s (maximum of %" PRIu32 " instance%s)\n",
+								name, maximum, description,
+								ss->completed_instances, plural);
+						} else {
+							pr_metrics("%-13s %13.2f %s (maximum of %" PRIu32 " instance%s)\n",
+								name, maximum, description,
+								ss->completed_instances, plural);
+						}
+						break;
+					}
+				}
+			}
+		}
+	}
+
+	if (latency) {
+		bool header = false;
+
+		for (ss = stressors_head; ss; ss = ss->next) {
+			size_t i;
+
+			if (ss->ignore.run)
+				continue;
+			if (!ss->stats)
+				continue;
+
+			for (i = 0; i < STRESS_LATENCY_MAX_IDS; i++) {
+				const stress_latency_hist_t *hist = &latency->hist;
+
+				if (!stress_latency_merge(ss->stats, ss->instances, i, latency))
+					continue;
+				if (!header) {
+					pr_metrics("latency metrics (nanoseconds):\n");
+					pr_metrics("%-13s %-20s %10s %10s %10s %10s %10s %10s %10s\n",
+						"stressor", "latency", "samples", "mean",
+						"p50", "p90", "p99", "p99.9", "max");
+					header = true;
+				}
+				pr_metrics("%-13s %-20.20s %10" PRIu64 " %10.0f %10" PRIu64 " %10" PRIu64
+					" %10" PRIu64 " %10" PRIu64 " %10" PRIu64 "\n",
+					ss->stressor->name, latency->description, hist->count,
+					stress_latency_hist_mean(hist),
+					stress_latency_hist_percentile(hist, 50.0),
+					stress_latency_hist_percentile(hist, 90.0),
+					stress_latency_hist_percentile(hist, 99.0),
+					stress_latency_hist_percentile(hist, 99.9),
+					hist->max_ns);
+			}
+		}
+		free(latency);
+	}
+#if defined(STRESS_RAPL)
+	if ((g_opt_flags & OPT_FLAGS_RAPL) &&
+	    !(g_opt_flags & OPT_FLAGS_METRICS_BRIEF))
+		stress_rapl_metrics_dump(stressors_head, g_shared->rapl_domains);
+#endif
+	pr_block_end();
+}
+
+/*
+ *  stress_repeat_t975()
+ *	two-sided 95% Student's t critical value for df degrees of freedom
+ */
+static double stress_repeat_t975(const size_t df)
+{
+	static const double t975[] = {
+		12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262, 2.228,
+		2.201, 2.179, 2.160, 2.145, 2.131, 2.120, 2.110, 2.101, 2.093, 2.086,
+		2.080, 2.074, 2.069, 2.064, 2.060, 2.056, 2.052, 2.048, 2.045, 2.042,
+	};
+
+	if (df < 1)
+		return 0.0;
+	if (df <= SIZEOF_ARRAY(t975))
+		return t975[df - 1];
+	return 1.960;
+}
+
+/*
+ *  stress_repeat_dump()
+ *	output the --repeat mean, standard deviation, coefficient of
+ *	variation and 95% confidence interval of each metric, warn
+ *	if the coefficient of variation is too high to trust a result
+ */
+static void stress_repeat_dump(FILE *yaml, stress_stressor_t *stressors_list)
+{
+	stress_stressor_t *ss;
+	bool header = false;
+	int32_t warmup = 1;
+
+	(void)stress_get_setting("repeat-warmup", &warmup);
+
+	pr_block_begin();
+	for (ss = stressors_list; ss; ss = ss->next) {
+		const double *samples = ss->repeat.samples;
+		const char *name = ss->stressor->name;
+		size_t m;
+
+		if (!samples || !ss->repeat.n_runs)
+			continue;
 
-							item = &stats->metrics.items[i];
-							if ((item->value > 0.0) && (item->value > maximum))
-								maximum = item->value;
-						}
-						if (g_opt_flags & OPT_FLAGS_SN) {
-							pr_metrics("%-13s %13.2e %s (maximum of %" PRIu32 " instance%s)\n",
-								name, maximum, description,
-								ss->completed_instances, plural);
-						} else {
-							pr_metrics("%-13s %13.2f %s (maximum of %" PRIu32 " instance%s)\n",
-								name, maximum, description,
-								ss->completed_instances, plural);
-						}
-						break;
-					}
-				}
+		if (!header) {
+			pr_inf("repeat: %-13s %-30s %12s %12s %7s %25s\n",
+				"stressor", "metric", "mean", "stddev", "CoV %", "95% confidence interval");
+			pr_yaml(yaml, "repeat:\n");
+			header = true;
+		}
+		pr_yaml(yaml, "    - stressor: %s\n", name);
+		pr_yaml(yaml, "      runs: %zu\n", ss->repeat.n_runs);
+		pr_yaml(yaml, "      warmup-runs: %" PRId32 "\n", warmup);
+		pr_yaml(yaml, "      metrics:\n");
+
+		for (m = 0; m < STRESS_REPEAT_METRICS; m++) {
+			const stress_metrics_item_t *item = (m == 0) ? NULL :
+				stress_metrics_item(ss->stats[0], m - 1);
+			const char *description = (m == 0) ? "bogo ops per second real time" :
+				(item ? item->description : NULL);
+			double sum = 0.0, sum_sq = 0.0, mean, stddev = 0.0, cov, half;
+			size_t r, n = 0;
+
+			if (!description)
+				continue;
+			for (r = 0; r < ss->repeat.n_runs; r++) {
+				const double value = samples[(r * STRESS_REPEAT_METRICS) + m];
+
+				if (isnan(value))
+					continue;
+				sum += value;
+				n++;
+			}
+			if (n == 0)
+				continue;
+			mean = sum / (double)n;
+			for (r = 0; r < ss->repeat.n_runs; r++) {
+				const double value = samples[(r * STRESS_REPEAT_METRICS) + m];
+
+				if (!isnan(value))
+					sum_sq += (value - mean) * (value - mean);
 			}
+			if (n > 1)
+				stddev = sqrt(sum_sq / (double)(n - 1));
+			cov = (mean != 0.0) ? 100.0 * stddev / fabs(mean) : 0.0;
+			half = stress_repeat_t975(n - 1) * stddev / sqrt((double)n);
+
+			pr_inf("repeat: %-13s %-30.30s %12.2f %12.2f %7.2f %12.2f..%.2f\n",
+				name, description, mean, stddev, cov, mean - half, mean + half);
+			pr_yaml(yaml, "        - metric: %s\n", stress_description_yamlify(description));
+			pr_yaml(yaml, "          samples: %zu\n", n);
+			pr_yaml(yaml, "          mean: %f\n", mean);
+			pr_yaml(yaml, "          stddev: %f\n", stddev);
+			pr_yaml(yaml, "          cov-percent: %f\n", cov);
+			pr_yaml(yaml, "          ci95-low: %f\n", mean - half);
+			pr_yaml(yaml, "          ci95-high: %f\n", mean + half);
+			if ((n > 1) && (cov > repeat_cov))
+				pr_warn("repeat: %s %s coefficient of variation %.2f%% exceeds %.2f%%, "
+					"result is not trustworthy\n", name, description, cov, repeat_cov);
 		}
 	}
 	pr_block_end();
@@ -2571,6 +5019,71 @@ static void stress_times_dump(
 	}
 }
 
+/*
+ *  stress_phase_dump()
+ *	output the mean per instance time spent in each phase of
+ *	a stressor: launch (fork to entry of the stressor function),
+ *	init (entry to the first bogo-op), run (first bogo-op to
+ *	return) and teardown (return to being reaped by the parent)
+ */
+static void stress_phase_dump(FILE *yaml, stress_stressor_t *stressors_list)
+{
+	stress_stressor_t *ss;
+	bool header = false;
+
+	if (!(g_opt_flags & OPT_FLAGS_TIMES))
+		return;
+
+	pr_block_begin();
+	for (ss = stressors_list; ss; ss = ss->next) {
+		double launch = 0.0, init = 0.0, run = 0.0, teardown = 0.0, init_pc;
+		int32_t j, n = 0, n_reaped = 0;
+
+		if (ss->ignore.run)
+			continue;
+
+		for (j = 0; j < ss->instances; j++) {
+			const stress_phase_times_t *phase = &ss->stats[j]->phase;
+			const double first_op = (phase->first_op > 0.0) ? phase->first_op : phase->leave;
+
+			if ((phase->fork <= 0.0) || (phase->enter <= 0.0) || (phase->leave <= 0.0))
+				continue;
+			launch += phase->enter - phase->fork;
+			init += first_op - phase->enter;
+			run += phase->leave - first_op;
+			n++;
+			if (phase->reaped >= phase->leave) {
+				teardown += phase->reaped - phase->leave;
+				n_reaped++;
+			}
+		}
+		if (!n)
+			continue;
+		launch /= (double)n;
+		init /= (double)n;
+		run /= (double)n;
+		if (n_reaped)
+			teardown /= (double)n_reaped;
+		init_pc = ((init + run) > 0.0) ? 100.0 * init / (init + run) : 0.0;
+
+		if (!header) {
+			pr_inf("phases: %-13s %9s %9s %9s %9s %7s\n",
+				"stressor", "launch", "init", "run", "teardown", "init%");
+			pr_yaml(yaml, "phase-times:\n");
+			header = true;
+		}
+		pr_inf("phases: %-13s %8.3fs %8.3fs %8.3fs %8.3fs %6.2f%%\n",
+			ss->stressor->name, launch, init, run, teardown, init_pc);
+		pr_yaml(yaml, "    - stressor: %s\n", ss->stressor->name);
+		pr_yaml(yaml, "      launch-time: %f\n", launch);
+		pr_yaml(yaml, "      init-time: %f\n", init);
+		pr_yaml(yaml, "      run-time: %f\n", run);
+		pr_yaml(yaml, "      teardown-time: %f\n", teardown);
+		pr_yaml(yaml, "      init-time-percent: %f\n", init_pc);
+	}
+	pr_block_end();
+}
+
 /*
  *  stress_log_args()
  *	dump to syslog argv[]
@@ -2689,8 +5202,10 @@ static void *stress_map_page(int prot, char *prot_str, size_t page_size)
 static inline void stress_shared_map(const int32_t num_procs)
 {
 	const size_t page_size = stress_get_page_size();
-	size_t len = sizeof(stress_shared_t) +
-		     (sizeof(stress_stats_t) * (size_t)num_procs);
+	const size_t counters_offset = (sizeof(stress_shared_t) +
+		     (sizeof(stress_stats_t) * (size_t)num_procs) + 63) & ~(size_t)63;
+	size_t len = counters_offset +
+		     (sizeof(stress_counter_slot_t) * (size_t)num_procs);
 	size_t sz = (len + (page_size << 1)) & ~(page_size - 1);
 #if defined(HAVE_MPROTECT)
 	void *last_page;
@@ -2709,6 +5224,7 @@ static inline void stress_shared_map(const int32_t num_procs)
 	/* Paraniod */
 	(void)shim_memset(g_shared, 0, sz);
 	g_shared->length = sz;
+	g_shared->counters = (stress_counter_slot_t *)((uintptr_t)g_shared + counters_offset);
 	g_shared->instance_count.started = 0;
 	g_shared->instance_count.exited = 0;
 	g_shared->instance_count.reaped = 0;
@@ -2792,6 +5308,16 @@ STRESS_PRAGMA_POP
 		goto err_unmap_page_ro;
 	stress_set_vma_anon_name(g_shared->mapped.page_ro, page_size, "mapped-wo");
 
+	/*
+	 *  latency histograms are large, so only map these if required
+	 */
+	if ((g_opt_flags & OPT_FLAGS_LATENCY) &&
+	    (stress_latency_map(num_procs) < 0)) {
+		pr_inf("cannot mmap latency statistics, errno=%d (%s), disabling --latency\n",
+			errno, strerror(errno));
+		g_opt_flags &= ~OPT_FLAGS_LATENCY;
+	}
+
 	return;
 
 err_unmap_page_ro:
@@ -2831,6 +5357,7 @@ void stress_shared_unmap(void)
 	(void)munmap((void *)g_shared->mapped.page_none, page_size);
 	(void)munmap((void *)g_shared->checksum.checksums, g_shared->checksum.length);
 	(void)munmap((void *)g_shared, g_shared->length);
+	stress_latency_unmap();
 }
 
 /*
@@ -2893,7 +5420,7 @@ static inline void stress_exclude_unsupported(bool *unsupported)
 					continue;
 
 				if ((ss->stressor == stressor) && ss->instances &&
-					(stressor->info->supported(ss->stressor->name) < 0)) {
+					(stress_probe_cache_supported(ss->stressor->name, stressor->info->supported) < 0)) {
 						stress_ignore_stressor(ss, STRESS_STRESSOR_UNSUPPORTED);
 						*unsupported = true;
 				}
@@ -3071,6 +5598,33 @@ static inline void stress_exclude_pathological(void)
 	}
 }
 
+/*
+ *  stress_metrics_heap_size()
+ *	shared heap space to reserve for the misc metrics of all the
+ *	stressor instances, stressors that declare their metrics get
+ *	extra space in case a declared size needs to grow
+ */
+static size_t stress_metrics_heap_size(void)
+{
+	stress_stressor_t *ss;
+	size_t size = 0;
+
+	for (ss = stressors_head; ss; ss = ss->next) {
+		const stressor_info_t *info;
+		size_t n;
+
+		if (ss->ignore.run)
+			continue;
+
+		info = ss->stressor->info;
+		n = (info && info->metrics_max) ?
+			STRESS_MINIMUM(info->metrics_max, STRESS_MISC_METRICS_MAX) + STRESS_MISC_METRICS_MAX :
+			STRESS_MISC_METRICS_MAX;
+		size += (size_t)ss->instances * n * sizeof(stress_metrics_item_t);
+	}
+	return size;
+}
+
 /*
  *  stress_setup_stats_buffers()
  *	setup the stats data from the shared memory
@@ -3079,6 +5633,7 @@ static inline void stress_setup_stats_buffers(void)
 {
 	stress_stressor_t *ss;
 	stress_stats_t *stats = g_shared->stats;
+	stress_counter_slot_t *counter = g_shared->counters;
 
 	for (ss = stressors_head; ss; ss = ss->next) {
 		int32_t i;
@@ -3086,14 +5641,15 @@ static inline void stress_setup_stats_buffers(void)
 		if (ss->ignore.run)
 			continue;
 
-		for (i = 0; i < ss->instances; i++, stats++) {
-			size_t j;
-
+		for (i = 0; i < ss->instances; i++, stats++, counter++) {
 			ss->stats[i] = stats;
-			for (j = 0; j < SIZEOF_ARRAY(stats->metrics.items); j++) {
-				stats->metrics.items[j].value = 0.0;
-				stats->metrics.items[j].description = NULL;
-			}
+			stats->args.ci = &counter->ci;
+			stats->args.latency = stress_latency_instance(
+				(int32_t)(stats - g_shared->stats));
+			stats->placement_cpu = -1;
+			stats->metrics.max_metrics = 0;
+			stats->metrics.n_items = 0;
+			stats->metrics.items = NULL;
 		}
 	}
 }
@@ -3227,6 +5783,35 @@ static void stress_enable_classes(const uint32_t class)
 	}
 }
 
+/*
+ *  stress_stressor_opt_safe()
+ *	true if opt is a stressor instances or bogo-ops option or a
+ *	stressor specific option that does not take a string, string
+ *	and callback options may name files, devices or code to load
+ */
+bool stress_stressor_opt_safe(const int opt)
+{
+	size_t i;
+
+	for (i = 0; i < SIZEOF_ARRAY(stressors); i++) {
+		const stressor_info_t *info = stressors[i].info;
+
+		if ((stressors[i].short_getopt == opt) ||
+		    (stressors[i].op == (stress_op_t)opt))
+			return true;
+		if (info->opts) {
+			size_t j;
+
+			for (j = 0; info->opts[j].opt_name; j++) {
+				if (info->opts[j].opt == opt)
+					return (info->opts[j].type_id != TYPE_ID_STR) &&
+					       (info->opts[j].type_id != TYPE_ID_CALLBACK);
+			}
+		}
+	}
+	return false;
+}
+
 /*
  *  stress_parse_opts
  *	parse argv[] and set stress-ng options accordingly
@@ -3246,7 +5831,7 @@ int stress_parse_opts(int argc, char **argv, const bool jobmode)
 
 		opterr = (!jobmode) ? opterr : 0;
 next_opt:
-		if ((c = getopt_long(argc, argv, "?kKhMVvqnt:b:c:i:j:m:d:f:s:l:p:P:C:S:a:y:F:D:T:u:o:r:B:R:w:x:Y:",
+		if ((c = getopt_long(argc, argv, STRESS_SHORT_OPTIONS,
 			stress_long_options, &option_index)) == -1) {
 			break;
 		}
@@ -3304,6 +5889,19 @@ next_opt:
 			stress_get_processors(&g_opt_parallel);
 			stress_check_max_stressors("all", g_opt_parallel);
 			break;
+		case OPT_hugetlb:
+			stress_set_setting_true("global", "hugetlb", NULL);
+			break;
+		case OPT_hugetlb_size:
+			u64 = stress_get_uint64_byte(optarg);
+			stress_check_range_bytes("hugetlb-size", u64, 0, 16 * GB);
+			if (u64 & (u64 - 1)) {
+				(void)fprintf(stderr, "hugetlb-size %" PRIu64 " must be a power of 2, "
+					"e.g. 2M or 1G\n", u64);
+				longjmp(g_error_env, 1);
+			}
+			stress_set_setting_global("hugetlb-size", TYPE_ID_UINT64, &u64);
+			break;
 		case OPT_cache_size:
 			/* 1K..4GB should be enough range  */
 			u64 = stress_get_uint64_byte(optarg);
@@ -3342,6 +5940,33 @@ next_opt:
 				stress_enable_classes(u32);
 			}
 			break;
+		case OPT_agent:
+			if (stress_cluster_set_agent(optarg) < 0)
+				exit(EXIT_FAILURE);
+			break;
+		case OPT_coordinate:
+			if (stress_cluster_set_coordinate(optarg) < 0)
+				exit(EXIT_FAILURE);
+			break;
+		case OPT_cluster_token:
+			stress_set_setting_global("cluster-token", TYPE_ID_STR, (void *)optarg);
+			break;
+		case OPT_compare:
+			g_opt_flags |= OPT_FLAGS_METRICS;
+			stress_set_setting_global("compare", TYPE_ID_STR, (void *)optarg);
+			break;
+		case OPT_compare_threshold: {
+				char *end;
+
+				errno = 0;
+				compare_threshold = strtod(optarg, &end);
+				if ((errno != 0) || (end == optarg) || (*end != '\0') ||
+				    (compare_threshold < 0.0) || (compare_threshold > 1000.0)) {
+					(void)fprintf(stderr, "compare-threshold must be a percentage in the range 0 to 1000\n");
+					return EXIT_FAILURE;
+				}
+			}
+			break;
 		case OPT_config:
 			printf("config:\n%s", stress_config);
 			exit(EXIT_SUCCESS);
@@ -3359,9 +5984,25 @@ next_opt:
 			i32 = stress_get_int32(optarg);
 			stress_set_setting_global("ionice-level", TYPE_ID_INT32, &i32);
 			break;
+		case OPT_interference:
+			stress_set_setting_global("interference", TYPE_ID_STR, (void *)optarg);
+			break;
 		case OPT_job:
 			stress_set_setting_global("job", TYPE_ID_STR, (void *)optarg);
 			break;
+		case OPT_json:
+			stress_set_setting_global("json", TYPE_ID_STR, (void *)optarg);
+			break;
+		case OPT_launchers:
+			i32 = stress_get_int32(optarg);
+			stress_check_range("launchers", (uint64_t)i32, 0, STRESS_LAUNCHERS_MAX);
+			stress_set_setting_global("launchers", TYPE_ID_INT32, &i32);
+			break;
+		case OPT_lock_type:
+			if (stress_lock_set_type(optarg) < 0)
+				exit(EXIT_FAILURE);
+			stress_set_setting_global("lock-type", TYPE_ID_STR, (void *)optarg);
+			break;
 		case OPT_log_file:
 			stress_set_setting_global("log-file", TYPE_ID_STR, (void *)optarg);
 			break;
@@ -3376,9 +6017,29 @@ next_opt:
 			if (stress_set_mbind(optarg) < 0)
 				exit(EXIT_FAILURE);
 			break;
+		case OPT_metrics_interval:
+			if (stress_set_metrics_interval(optarg) < 0)
+				exit(EXIT_FAILURE);
+			break;
+		case OPT_metrics_interval_file:
+			stress_set_setting_global("metrics-interval-file", TYPE_ID_STR, (void *)optarg);
+			break;
+		case OPT_metrics_listen:
+			if (stress_openmetrics_set_listen(optarg) < 0)
+				exit(EXIT_FAILURE);
+			break;
 		case OPT_no_madvise:
 			g_opt_flags &= ~OPT_FLAGS_MMAP_MADVISE;
 			break;
+		case OPT_mem_footprint:
+			stress_set_setting_true("global", "mem-footprint", NULL);
+			break;
+		case OPT_offcpu:
+			stress_set_setting_true("global", "offcpu", NULL);
+			break;
+		case OPT_psi:
+			stress_set_setting_true("global", "psi", NULL);
+			break;
 		case OPT_oom_avoid_bytes:
 			{
 				size_t shmall, freemem, totalmem, freeswap, totalswap, bytes;
@@ -3415,6 +6076,28 @@ next_opt:
 			stress_check_max_stressors("random", i32);
 			stress_set_setting_global("random", TYPE_ID_INT32, &i32);
 			break;
+		case OPT_repeat:
+			i32 = stress_get_int32(optarg);
+			stress_check_range("repeat", (uint64_t)i32, 2, 10000);
+			stress_set_setting_global("repeat", TYPE_ID_INT32, &i32);
+			break;
+		case OPT_repeat_cov: {
+				char *end;
+
+				errno = 0;
+				repeat_cov = strtod(optarg, &end);
+				if ((errno != 0) || (end == optarg) || (*end != '\0') ||
+				    (repeat_cov < 0.0) || (repeat_cov > 1000.0)) {
+					(void)fprintf(stderr, "repeat-cov must be a percentage in the range 0 to 1000\n");
+					return EXIT_FAILURE;
+				}
+			}
+			break;
+		case OPT_repeat_warmup:
+			i32 = stress_get_int32(optarg);
+			stress_check_range("repeat-warmup", (uint64_t)i32, 0, 1000);
+			stress_set_setting_global("repeat-warmup", TYPE_ID_INT32, &i32);
+			break;
 		case OPT_sched:
 			i32 = stress_get_opt_sched(optarg);
 			stress_set_setting_global("sched", TYPE_ID_INT32, &i32);
@@ -3450,6 +6133,28 @@ next_opt:
 			stress_check_range("sequential", (uint64_t)g_opt_sequential,
 				MIN_SEQUENTIAL, MAX_SEQUENTIAL);
 			break;
+		case OPT_pipeline_seq:
+			g_opt_flags |= OPT_FLAGS_SYNC_START;
+			stress_set_setting_true("global", "pipeline-seq", NULL);
+			break;
+		case OPT_thp:
+			i32 = stress_mmap_thp_parse(optarg);
+			stress_set_setting_global("thp", TYPE_ID_INT32, &i32);
+			break;
+		case OPT_probe_cache:
+			stress_set_setting_global("probe-cache", TYPE_ID_STR, (void *)optarg);
+			break;
+		case OPT_placement:
+			i32 = (int32_t)stress_placement_parse(optarg);
+			stress_set_setting_global("placement", TYPE_ID_INT32, &i32);
+			break;
+#if defined(STRESS_PERF_SAMPLE)
+		case OPT_perf_sample:
+			i32 = stress_get_int32(optarg);
+			stress_check_range("perf-sample", (uint64_t)i32, 1, STRESS_PERF_SAMPLE_TOP_MAX);
+			stress_set_setting_global("perf-sample", TYPE_ID_INT32, &i32);
+			break;
+#endif
 		case OPT_permute:
 			g_opt_flags |= OPT_FLAGS_PERMUTE;
 			g_opt_permute = stress_get_int32(optarg);
@@ -3460,9 +6165,34 @@ next_opt:
 			if (stress_set_status(optarg) < 0)
 				exit(EXIT_FAILURE);
 			break;
+		case OPT_sync_start_at:
+			u64 = stress_get_uint64(optarg);
+			stress_set_setting_global("sync-start-at", TYPE_ID_UINT64, &u64);
+			g_opt_flags |= OPT_FLAGS_SYNC_START;
+			break;
+		case OPT_resctrl:
+			if (stress_resctrl_add(optarg) < 0)
+				exit(EXIT_FAILURE);
+			break;
+		case OPT_stressor_cgroup:
+			if (stress_stressor_cgroup_add(optarg) < 0)
+				exit(EXIT_FAILURE);
+			break;
 		case OPT_stressors:
 			stress_show_stressor_names();
 			exit(EXIT_SUCCESS);
+		case OPT_target_power:
+			i32 = stress_get_int32(optarg);
+			stress_check_range("target-power", (uint64_t)i32, 1, STRESS_TARGET_POWER_MAX);
+			stress_set_setting_global("target-power", TYPE_ID_INT32, &i32);
+			g_opt_flags |= (OPT_FLAGS_THROTTLE | OPT_FLAGS_RAPL_REQUIRED);
+			break;
+		case OPT_target_util:
+			i32 = stress_get_int32(optarg);
+			stress_check_range("target-util", (uint64_t)i32, 1, STRESS_TARGET_UTIL_MAX);
+			stress_set_setting_global("target-util", TYPE_ID_INT32, &i32);
+			g_opt_flags |= OPT_FLAGS_THROTTLE;
+			break;
 		case OPT_taskset:
 			if (stress_set_cpu_affinity(optarg) < 0)
 				exit(EXIT_FAILURE);
@@ -3490,6 +6220,10 @@ next_opt:
 		case OPT_vmstat_units:
 			stress_set_vmstat_units(optarg);
 			break;
+		case OPT_warmup:
+			if (stress_set_warmup(optarg) < 0)
+				exit(EXIT_FAILURE);
+			break;
 		case OPT_thermalstat:
 			if (stress_set_thermalstat(optarg) < 0)
 				exit(EXIT_FAILURE);
@@ -3498,6 +6232,9 @@ next_opt:
 			if (stress_set_iostat(optarg) < 0)
 				exit(EXIT_FAILURE);
 			break;
+		case OPT_iostat_yaml:
+			stress_set_setting_global("iostat-yaml", TYPE_ID_STR, (void *)optarg);
+			break;
 		case OPT_raplstat:
 			if (stress_set_raplstat(optarg) < 0)
 				exit(EXIT_FAILURE);
@@ -3606,22 +6343,180 @@ static void stress_setup_parallel(const uint32_t class, const int32_t instances)
 		if (ss->ignore.run)
 			continue;
 
-		/*
-		 * Share bogo ops between processes equally, rounding up
-		 * if nonzero bogo_ops
-		 */
-		ss->bogo_ops = ss->instances ?
-			(ss->bogo_ops + (ss->instances - 1)) / ss->instances : 0;
-		if (ss->instances)
-			stress_alloc_proc_resources(&ss->stats, ss->instances);
+		/*
+		 * Share bogo ops between processes equally, rounding up
+		 * if nonzero bogo_ops
+		 */
+		ss->bogo_ops = ss->instances ?
+			(ss->bogo_ops + (ss->instances - 1)) / ss->instances : 0;
+		if (ss->instances)
+			stress_alloc_proc_resources(&ss->stats, ss->instances);
+	}
+}
+
+/*
+ *  stress_run_sequential()
+ *	run stressors sequentially
+ */
+static inline void stress_run_sequential(
+	const int32_t ticks_per_sec,
+	double *duration,
+	bool *success,
+	bool *resource_success,
+	bool *metrics_success)
+{
+	stress_stressor_t *ss;
+	stress_checksum_t *checksum = g_shared->checksum.checksums;
+	size_t total_run = 0, run = 0;
+	const bool progress = !!(g_opt_flags & OPT_FLAGS_PROGRESS);
+	bool pipelined = false;
+
+	(void)stress_get_setting("pipeline-seq", &pipelined);
+	if (pipelined && !g_opt_timeout) {
+		pr_inf("--pipeline-seq requires a timeout, ignoring option\n");
+		pipelined = false;
+	}
+
+	if (progress) {
+		for (ss = stressors_head; ss; ss = ss->next) {
+			if (!ss->ignore.run)
+				total_run++;
+		}
+	}
+
+	/*
+	 *  Step through each stressor one by one
+	 */
+	for (ss = stressors_head; ss && stress_continue_flag(); ss = ss->next) {
+		stress_stressor_t *next;
+
+		if (ss->ignore.run)
+			continue;
+
+		if (progress) {
+			struct tm *tm_finish;
+			time_t t_finish;
+			const char *name = ss->stressor->name;
+			char finish[64];
+
+			t_finish = time(NULL);
+			t_finish += g_opt_timeout * ((108 * (total_run - run)) / 100);
+			t_finish += g_opt_pause * (total_run - run - 1);
+			tm_finish = localtime(&t_finish);
+			if (tm_finish)
+				(void)strftime(finish, sizeof(finish), "%T %F", tm_finish);
+			else
+				*finish = '\0';
+
+			run++;
+			pr_inf("starting %s, %zd of %zd (%.2f%%)%s%s\n",
+				name, run, total_run,
+				(total_run > 0) ?  100.0 * (double)run / (double)total_run : 100.0,
+				*finish ? ", finish at " : "", finish);
+		}
+		next = ss->next;
+		if (pipelined) {
+			/* find the next stressor to pre-start while this one winds down */
+			for (pipeline.ss = next; pipeline.ss && pipeline.ss->ignore.run; pipeline.ss = pipeline.ss->next)
+				;
+			pipeline.checksum = checksum + ss->instances;
+		}
+		ss->next = NULL;
+		stress_run(ticks_per_sec, ss, duration, success, resource_success,
+			metrics_success, &checksum);
+		ss->next = next;
+	}
+	stress_pipeline_stop(success, resource_success, metrics_success);
+	stress_metrics_check(success);
+}
+
+/*
+ *  stress_run_scale_sweep()
+ *	run each stressor sequentially with 1, 2, 4.. N instances,
+ *	where N is the number of instances requested, recording
+ *	the throughput at each instance count
+ */
+static void stress_run_scale_sweep(
+	const int32_t ticks_per_sec,
+	double *duration,
+	bool *success,
+	bool *resource_success,
+	bool *metrics_success)
+{
+	stress_stressor_t *ss;
+	stress_checksum_t *checksum = g_shared->checksum.checksums;
+
+	for (ss = stressors_head; ss && stress_continue_flag(); ss = ss->next) {
+		stress_stressor_t *next;
+		const int32_t instances = ss->instances;
+		int32_t n;
+		size_t max_steps;
+
+		if (ss->ignore.run || (instances < 1))
+			continue;
+
+		for (max_steps = 1, n = 1; n < instances; max_steps++)
+			n = (n > instances / 2) ? instances : n * 2;
+		ss->scale_sweep.steps = (stress_scale_sweep_step_t *)
+			calloc(max_steps, sizeof(*ss->scale_sweep.steps));
+		if (!ss->scale_sweep.steps) {
+			pr_inf("%s: cannot allocate scale sweep results, skipping stressor\n",
+				ss->stressor->name);
+			checksum += instances;
+			continue;
+		}
+		ss->scale_sweep.n_steps = 0;
+
+		next = ss->next;
+		ss->next = NULL;
+		for (n = 1; stress_continue_flag(); ) {
+			stress_scale_sweep_step_t *step = &ss->scale_sweep.steps[ss->scale_sweep.n_steps];
+			stress_checksum_t *step_checksum = checksum;
+			int32_t j, completed = 0;
+			double total = 0.0;
+
+			pr_inf("scale-sweep: running %s with %" PRId32 " instance%s\n",
+				ss->stressor->name, n, n == 1 ? "" : "s");
+			for (j = 0; j < n; j++)
+				ss->stats[j]->duration = 0.0;
+			ss->instances = n;
+			stress_run(ticks_per_sec, ss, duration, success, resource_success,
+				metrics_success, &step_checksum);
+
+			step->instances = n;
+			step->bogo_ops = 0;
+			for (j = 0; j < n; j++) {
+				const stress_stats_t *const stats = ss->stats[j];
+
+				step->bogo_ops += stats->args.ci->counter;
+				if (stats->duration > 0.0) {
+					total += stats->duration;
+					completed++;
+				}
+			}
+			step->duration = completed ? total / (double)completed : 0.0;
+			step->rate = (step->duration > 0.0) ?
+				(double)step->bogo_ops / step->duration : 0.0;
+			ss->scale_sweep.n_steps++;
+
+			if (n >= instances)
+				break;
+			n = (n > instances / 2) ? instances : n * 2;
+		}
+		/* the final step runs all the instances, restore the full count */
+		ss->instances = instances;
+		ss->next = next;
+		checksum += instances;
 	}
+	stress_metrics_check(success);
 }
 
 /*
- *  stress_run_sequential()
- *	run stressors sequentially
+ *  stress_run_repeat()
+ *	run each stressor sequentially warm-up + N times, recording
+ *	the bogo ops/s rate and misc metrics of each measured run
  */
-static inline void stress_run_sequential(
+static void stress_run_repeat(
 	const int32_t ticks_per_sec,
 	double *duration,
 	bool *success,
@@ -3630,51 +6525,83 @@ static inline void stress_run_sequential(
 {
 	stress_stressor_t *ss;
 	stress_checksum_t *checksum = g_shared->checksum.checksums;
-	size_t total_run = 0, run = 0;
-	const bool progress = !!(g_opt_flags & OPT_FLAGS_PROGRESS);
+	int32_t runs = 0, warmup = 1;
 
-	if (progress) {
-		for (ss = stressors_head; ss; ss = ss->next) {
-			if (!ss->ignore.run)
-				total_run++;
-		}
-	}
+	(void)stress_get_setting("repeat", &runs);
+	(void)stress_get_setting("repeat-warmup", &warmup);
 
-	/*
-	 *  Step through each stressor one by one
-	 */
 	for (ss = stressors_head; ss && stress_continue_flag(); ss = ss->next) {
 		stress_stressor_t *next;
+		const int32_t instances = ss->instances;
+		int32_t run;
 
-		if (ss->ignore.run)
+		if (ss->ignore.run || (instances < 1))
 			continue;
 
-		if (progress) {
-			struct tm *tm_finish;
-			time_t t_finish;
-			const char *name = ss->stressor->name;
-			char finish[64];
+		ss->repeat.samples = (double *)calloc((size_t)runs * STRESS_REPEAT_METRICS,
+			sizeof(*ss->repeat.samples));
+		if (!ss->repeat.samples) {
+			pr_inf("%s: cannot allocate repeat results, skipping stressor\n",
+				ss->stressor->name);
+			checksum += instances;
+			continue;
+		}
+		ss->repeat.n_runs = 0;
 
-			t_finish = time(NULL);
-			t_finish += g_opt_timeout * ((108 * (total_run - run)) / 100);
-			t_finish += g_opt_pause * (total_run - run - 1);
-			tm_finish = localtime(&t_finish);
-			if (tm_finish)
-				(void)strftime(finish, sizeof(finish), "%T %F", tm_finish);
+		next = ss->next;
+		ss->next = NULL;
+		for (run = 0; (run < warmup + runs) && stress_continue_flag(); run++) {
+			stress_checksum_t *run_checksum = checksum;
+			double *samples, total = 0.0, rate;
+			uint64_t bogo_ops = 0;
+			int32_t j, completed = 0;
+			size_t i;
+
+			if (run < warmup)
+				pr_inf("repeat: running %s, warm-up run %" PRId32 " of %" PRId32 "\n",
+					ss->stressor->name, run + 1, warmup);
 			else
-				*finish = '\0';
+				pr_inf("repeat: running %s, run %" PRId32 " of %" PRId32 "\n",
+					ss->stressor->name, run - warmup + 1, runs);
+			for (j = 0; j < instances; j++)
+				ss->stats[j]->duration = 0.0;
+			stress_run(ticks_per_sec, ss, duration, success, resource_success,
+				metrics_success, &run_checksum);
+			if (run < warmup)
+				continue;
 
-			run++;
-			pr_inf("starting %s, %zd of %zd (%.2f%%)%s%s\n",
-				name, run, total_run,
-				(total_run > 0) ?  100.0 * (double)run / (double)total_run : 100.0,
-				*finish ? ", finish at " : "", finish);
+			for (j = 0; j < instances; j++) {
+				const stress_stats_t *const stats = ss->stats[j];
+
+				bogo_ops += stats->args.ci->counter;
+				if (stats->duration > 0.0) {
+					total += stats->duration;
+					completed++;
+				}
+			}
+			rate = (completed && (total > 0.0)) ?
+				(double)bogo_ops / (total / (double)completed) : 0.0;
+
+			samples = &ss->repeat.samples[ss->repeat.n_runs * STRESS_REPEAT_METRICS];
+			samples[0] = rate;
+			for (i = 0; i < STRESS_MISC_METRICS_MAX; i++) {
+				double metric = 0.0;
+				int32_t n = 0;
+
+				for (j = 0; j < instances; j++) {
+					const stress_metrics_item_t *item = stress_metrics_item(ss->stats[j], i);
+
+					if (item && item->description) {
+						metric += item->value;
+						n++;
+					}
+				}
+				samples[1 + i] = n ? metric / (double)n : NAN;
+			}
+			ss->repeat.n_runs++;
 		}
-		next = ss->next;
-		ss->next = NULL;
-		stress_run(ticks_per_sec, ss, duration, success, resource_success,
-			metrics_success, &checksum);
 		ss->next = next;
+		checksum += instances;
 	}
 	stress_metrics_check(success);
 }
@@ -3771,6 +6698,244 @@ static inline void stress_run_permute(
 	}
 }
 
+/* --interference aggressor placements, nearest first */
+static const struct {
+	const char *name;			/* placement name */
+	stress_cpu_distance_t distance;		/* wanted victim to aggressor distance */
+} stress_interference_placements[STRESS_INTERFERENCE_PLACEMENTS] = {
+	{ "smt-sibling",	STRESS_CPU_DISTANCE_SMT },
+	{ "same-llc",		STRESS_CPU_DISTANCE_LLC },
+	{ "remote",		STRESS_CPU_DISTANCE_REMOTE },
+};
+
+/*
+ *  stress_interference_victim()
+ *	find the --interference victim stressor, NULL if not found
+ */
+static stress_stressor_t *stress_interference_victim(stress_stressor_t *stressors_list)
+{
+	stress_stressor_t *ss;
+	char *name = NULL;
+
+	if (!stress_get_setting("interference", &name) || !name)
+		return NULL;
+	for (ss = stressors_list; ss; ss = ss->next) {
+		if (!ss->ignore.run && !strcmp(ss->stressor->name, name))
+			return ss;
+	}
+	return NULL;
+}
+
+/*
+ *  stress_interference_cpus()
+ *	pick a victim CPU and the aggressor CPU for each placement,
+ *	remote falls back to a CPU on a different LLC of the same
+ *	node on single node systems. Only the first few usable CPUs
+ *	are tried as the victim to bound the topology lookups
+ */
+static int32_t stress_interference_cpus(int32_t placement_cpu[STRESS_INTERFERENCE_PLACEMENTS])
+{
+	uint32_t *cpus = NULL, n_cpus, i, j;
+	int32_t victim_cpu = -1;
+	size_t best = 0;
+
+	for (i = 0; i < STRESS_INTERFERENCE_PLACEMENTS; i++)
+		placement_cpu[i] = -1;
+	n_cpus = stress_get_usable_cpus(&cpus, true);
+	if (!n_cpus)
+		return -1;
+
+	for (i = 0; (i < n_cpus) && (i < 8); i++) {
+		int32_t found[STRESS_INTERFERENCE_PLACEMENTS];
+		stress_cpu_distance_t found_distance[STRESS_INTERFERENCE_PLACEMENTS];
+		size_t k, n_found = 0;
+
+		for (k = 0; k < STRESS_INTERFERENCE_PLACEMENTS; k++) {
+			found[k] = -1;
+			found_distance[k] = STRESS_CPU_DISTANCE_UNKNOWN;
+		}
+		for (j = 0; j < n_cpus; j++) {
+			const stress_cpu_distance_t distance = (i == j) ? STRESS_CPU_DISTANCE_SAME :
+				stress_cpu_distance((int32_t)cpus[i], (int32_t)cpus[j]);
+
+			for (k = 0; k < STRESS_INTERFERENCE_PLACEMENTS; k++) {
+				const stress_cpu_distance_t wanted = stress_interference_placements[k].distance;
+
+				if (found_distance[k] == wanted)
+					continue;
+				if ((distance == wanted) ||
+				    ((wanted == STRESS_CPU_DISTANCE_REMOTE) &&
+				     (distance == STRESS_CPU_DISTANCE_NODE) && (found[k] < 0))) {
+					found[k] = (int32_t)cpus[j];
+					found_distance[k] = distance;
+				}
+			}
+		}
+		for (k = 0; k < STRESS_INTERFERENCE_PLACEMENTS; k++)
+			n_found += (found[k] >= 0);
+		if ((victim_cpu < 0) || (n_found > best)) {
+			victim_cpu = (int32_t)cpus[i];
+			best = n_found;
+			for (k = 0; k < STRESS_INTERFERENCE_PLACEMENTS; k++)
+				placement_cpu[k] = found[k];
+		}
+		if (best == STRESS_INTERFERENCE_PLACEMENTS)
+			break;
+	}
+	stress_free_usable_cpus(&cpus);
+	return victim_cpu;
+}
+
+/*
+ *  stress_interference_rate()
+ *	bogo ops per second of the single victim instance
+ */
+static double stress_interference_rate(const stress_stressor_t *victim)
+{
+	const stress_stats_t *const stats = victim->stats[0];
+
+	return (stats->duration > 0.0) ?
+		(double)stats->args.ci->counter / stats->duration : 0.0;
+}
+
+/*
+ *  stress_run_interference()
+ *	run the --interference victim stressor alone pinned to a CPU
+ *	and then against each of the other stressors as an aggressor
+ *	pinned to an SMT sibling, a CPU sharing the LLC and a remote
+ *	CPU, one instance each, recording the victim throughput
+ */
+static void stress_run_interference(
+	const int32_t ticks_per_sec,
+	double *duration,
+	bool *success,
+	bool *resource_success,
+	bool *metrics_success)
+{
+	stress_stressor_t *ss, *victim;
+	int32_t placement_cpu[STRESS_INTERFERENCE_PLACEMENTS];
+	int32_t victim_cpu;
+	int32_t *instances;
+	size_t i, n;
+
+	victim = stress_interference_victim(stressors_head);
+	if (!victim) {
+		pr_inf("interference: victim stressor is not one of the stressors being run\n");
+		return;
+	}
+	victim_cpu = stress_interference_cpus(placement_cpu);
+	if (victim_cpu < 0) {
+		pr_inf("interference: cannot determine the usable CPUs, skipping interference run\n");
+		return;
+	}
+
+	for (n = 0, ss = stressors_head; ss; ss = ss->next)
+		n++;
+	instances = (int32_t *)calloc(n, sizeof(*instances));
+	if (!instances) {
+		pr_inf("interference: cannot allocate instance counts, skipping interference run\n");
+		return;
+	}
+	for (i = 0, ss = stressors_head; ss; ss = ss->next, i++) {
+		instances[i] = ss->instances;
+		ss->ignore.permute = true;
+		ss->instances = STRESS_MINIMUM(ss->instances, 1);
+		ss->stats[0]->duration = 0.0;
+	}
+
+	victim->ignore.permute = false;
+	victim->interference.pin = true;
+	victim->interference.cpu = victim_cpu;
+	pr_inf("interference: running victim %s alone on CPU %" PRId32 "\n",
+		victim->stressor->name, victim_cpu);
+	stress_run_parallel(ticks_per_sec, duration, success, resource_success, metrics_success);
+	victim->interference.rate[0] = stress_interference_rate(victim);
+
+	for (ss = stressors_head; ss && stress_continue_flag(); ss = ss->next) {
+		if ((ss == victim) || ss->ignore.run || (ss->instances < 1))
+			continue;
+		ss->ignore.permute = false;
+		ss->interference.pin = true;
+		for (i = 0; (i < STRESS_INTERFERENCE_PLACEMENTS) && stress_continue_flag(); i++) {
+			ss->interference.placement_cpu[i] = placement_cpu[i];
+			if (placement_cpu[i] < 0) {
+				pr_inf("interference: no %s CPU for aggressor %s, skipping\n",
+					stress_interference_placements[i].name, ss->stressor->name);
+				continue;
+			}
+			pr_inf("interference: running victim %s on CPU %" PRId32
+				" with aggressor %s on %s CPU %" PRId32 "\n",
+				victim->stressor->name, victim_cpu, ss->stressor->name,
+				stress_interference_placements[i].name, placement_cpu[i]);
+			ss->interference.cpu = placement_cpu[i];
+			victim->stats[0]->duration = 0.0;
+			stress_run_parallel(ticks_per_sec, duration, success, resource_success, metrics_success);
+			ss->interference.rate[i] = stress_interference_rate(victim);
+		}
+		ss->interference.pin = false;
+		ss->ignore.permute = true;
+	}
+
+	for (i = 0, ss = stressors_head; ss; ss = ss->next, i++) {
+		ss->instances = instances[i];
+		ss->ignore.permute = false;
+		ss->interference.pin = false;
+	}
+	free(instances);
+}
+
+/*
+ *  stress_interference_dump()
+ *	output the --interference victim throughput and slowdown
+ *	factor with each aggressor placement
+ */
+static void stress_interference_dump(FILE *yaml, stress_stressor_t *stressors_list)
+{
+	stress_stressor_t *ss, *victim;
+	double alone;
+
+	victim = stress_interference_victim(stressors_list);
+	if (!victim || (victim->interference.rate[0] <= 0.0))
+		return;
+
+	alone = victim->interference.rate[0];
+	pr_block_begin();
+	pr_inf("interference: victim %s on CPU %" PRId32 ", %.2f bogo ops/s alone\n",
+		victim->stressor->name, victim->interference.cpu, alone);
+	pr_inf("interference: %-13s %-12s %5s %12s %8s\n",
+		"aggressor", "placement", "CPU", "bogo ops/s", "slowdown");
+	pr_yaml(yaml, "interference:\n");
+	pr_yaml(yaml, "    - victim: %s\n", victim->stressor->name);
+	pr_yaml(yaml, "      cpu: %" PRId32 "\n", victim->interference.cpu);
+	pr_yaml(yaml, "      bogo-ops-per-second: %f\n", alone);
+	pr_yaml(yaml, "      aggressors:\n");
+
+	for (ss = stressors_list; ss; ss = ss->next) {
+		size_t i;
+
+		if (ss == victim)
+			continue;
+		for (i = 0; i < STRESS_INTERFERENCE_PLACEMENTS; i++) {
+			const int32_t cpu = ss->interference.placement_cpu[i];
+			const double rate = ss->interference.rate[i];
+			const double slowdown = (rate > 0.0) ? alone / rate : 0.0;
+
+			if ((cpu < 0) || (rate <= 0.0))
+				continue;
+			pr_inf("interference: %-13s %-12s %5" PRId32 " %12.2f %8.2f\n",
+				ss->stressor->name, stress_interference_placements[i].name,
+				cpu, rate, slowdown);
+			pr_yaml(yaml, "        - stressor: %s\n", ss->stressor->name);
+			pr_yaml(yaml, "          placement: %s\n", stress_interference_placements[i].name);
+			pr_yaml(yaml, "          cpu: %" PRId32 "\n", cpu);
+			pr_yaml(yaml, "          bogo-ops-per-second: %f\n", rate);
+			pr_yaml(yaml, "          slowdown: %f\n", slowdown);
+		}
+	}
+	pr_yaml(yaml, "\n");
+	pr_block_end();
+}
+
 /*
  *  stress_mlock_executable()
  *	try to mlock image into memory so it
@@ -3788,23 +6953,103 @@ static inline void stress_mlock_executable(void)
 
 /*
  *  stress_yaml_open()
- *	open YAML results file
+ *	open YAML results file, if readable is true the file is opened
+ *	for reading too so that the results can be parsed by --compare,
+ *	without a file name an anonymous temporary file is used
  */
-static FILE *stress_yaml_open(const char *yaml_filename)
+static FILE *stress_yaml_open(const char *yaml_filename, const bool readable)
 {
 	FILE *yaml = NULL;
 
 	if (yaml_filename) {
-		yaml = fopen(yaml_filename, "w");
+		yaml = fopen(yaml_filename, readable ? "w+" : "w");
 		if (!yaml)
 			pr_err("Cannot output YAML data to %s\n", yaml_filename);
 
 		pr_yaml(yaml, "---\n");
 		stress_yaml_runinfo(yaml);
+	} else if (readable) {
+		yaml = tmpfile();
+		if (!yaml)
+			pr_err("Cannot create temporary file for YAML data, errno=%d (%s)\n",
+				errno, strerror(errno));
 	}
 	return yaml;
 }
 
+/*
+ *  stress_json_run_begin()
+ *	write the --json run-start record, the schema version is only
+ *	written here and applies to all the following records
+ */
+static void stress_json_run_begin(void)
+{
+#if defined(HAVE_UNAME) &&	\
+    defined(HAVE_SYS_UTSNAME_H)
+	struct utsname uts;
+#endif
+	const size_t hostname_len = stress_get_hostname_length();
+	char *hostname;
+	const stress_stressor_t *ss;
+	stress_json_t json;
+
+	if (!stress_json_enabled())
+		return;
+
+	stress_json_begin(&json, "run-start");
+	stress_json_int64(&json, "schema", STRESS_JSON_SCHEMA);
+	stress_json_str(&json, "stress-ng-version", VERSION);
+	stress_json_int64(&json, "epoch-secs", (int64_t)time(NULL));
+	hostname = (char *)malloc(hostname_len + 1);
+	if (hostname && !gethostname(hostname, hostname_len)) {
+		hostname[hostname_len] = '\0';
+		stress_json_str(&json, "hostname", hostname);
+	}
+	free(hostname);
+#if defined(HAVE_UNAME) &&	\
+    defined(HAVE_SYS_UTSNAME_H)
+	if (uname(&uts) >= 0) {
+		stress_json_str(&json, "sysname", uts.sysname);
+		stress_json_str(&json, "release", uts.release);
+		stress_json_str(&json, "machine", uts.machine);
+	}
+#endif
+	stress_json_int64(&json, "cpus", (int64_t)stress_get_processors_configured());
+	stress_json_int64(&json, "cpus-online", (int64_t)stress_get_processors_online());
+	stress_json_uint64(&json, "timeout", g_opt_timeout);
+	stress_json_object_begin(&json, "stressors");
+	for (ss = stressors_head; ss; ss = ss->next) {
+		if (!ss->ignore.run)
+			stress_json_int64(&json, ss->stressor->name, (int64_t)ss->instances);
+	}
+	stress_json_object_end(&json);
+	stress_json_end(&json);
+}
+
+/*
+ *  stress_json_run_end()
+ *	write the --json run-end record, its absence marks a run that
+ *	was killed before completion
+ */
+static void stress_json_run_end(
+	const double duration,
+	const bool success,
+	const bool resource_success,
+	const bool metrics_success)
+{
+	stress_json_t json;
+
+	if (!stress_json_enabled())
+		return;
+
+	stress_json_begin(&json, "run-end");
+	stress_json_double(&json, "run-time", duration);
+	stress_json_str(&json, "result", success ? "successful" : "unsuccessful");
+	stress_json_str(&json, "resources", resource_success ? "sufficient" : "insufficient");
+	stress_json_str(&json, "metrics", metrics_success ? "trustworthy" : "untrustworthy");
+	stress_json_end(&json);
+}
+
 /*
  *  stress_yaml_close()
  *	close YAML results file
@@ -3876,10 +7121,15 @@ int main(int argc, char **argv, char **envp)
 	bool success = true;
 	bool resource_success = true;
 	bool metrics_success = true;
+	NOCLOBBER bool compare_success = true;
 	FILE *yaml;				/* YAML output file */
 	char *yaml_filename = NULL;		/* YAML file name */
+	char *json_filename = NULL;		/* JSON records file name */
+	char *probe_cache = NULL;		/* --probe-cache file name */
+	char *compare_filename = NULL;		/* --compare baseline YAML file name */
 	char *log_filename;			/* log filename */
 	char *job_filename = NULL;		/* job filename */
+	char *interference = NULL;		/* --interference victim stressor */
 	int32_t ticks_per_sec;			/* clock ticks per second (jiffies) */
 	int32_t ionice_class = UNDEFINED;	/* ionice class */
 	int32_t ionice_level = UNDEFINED;	/* ionice level */
@@ -3889,6 +7139,14 @@ int main(int argc, char **argv, char **envp)
 	const uint32_t cpus_configured = (uint32_t)stress_get_processors_configured();
 	int ret;
 	bool unsupported = false;		/* true if stressors are unsupported */
+	int32_t target_power, target_util;	/* --target-power, --target-util */
+	int32_t repeat;				/* --repeat N */
+	bool offcpu;				/* --offcpu */
+	bool mem_footprint;			/* --mem-footprint */
+	bool psi;				/* --psi */
+#if defined(STRESS_PERF_SAMPLE)
+	int32_t perf_sample_top = 0;		/* --perf-sample top N functions */
+#endif
 
 	main_pid = getpid();
 
@@ -3896,6 +7154,7 @@ int main(int argc, char **argv, char **envp)
 	stress_set_stack_smash_check_flag(true);
 
 	stress_fixup_stressor_names();
+	stress_multiver_select(stressors, SIZEOF_ARRAY(stressors));
 
 	if (stress_set_temp_path(".") < 0)
 		exit(EXIT_FAILURE);
@@ -3913,6 +7172,16 @@ int main(int argc, char **argv, char **envp)
 		ret = EXIT_SUCCESS;
 		goto exit_temp_path_free;
 	}
+	/* ..and with a handshake fd to time exec to main() startup */
+	if ((argc == 3) && !strcmp(argv[1], "--exec-exit")) {
+		const int fd = atoi(argv[2]);
+		const char ch = 'M';
+
+		if (fd > 2)
+			VOID_RET(ssize_t, write(fd, &ch, sizeof(ch)));
+		ret = EXIT_SUCCESS;
+		goto exit_temp_path_free;
+	}
 
 	stressors_head = NULL;
 	stressors_tail = NULL;
@@ -3954,6 +7223,15 @@ int main(int argc, char **argv, char **envp)
 		goto exit_stressors_free;
 	}
 
+	/*
+	 *  Multi-host --agent and --coordinate runs do not
+	 *  run any stressors in this process
+	 */
+	if (stress_cluster_mode()) {
+		ret = stress_cluster_run();
+		goto exit_stressors_free;
+	}
+
 	if (g_opt_flags & OPT_FLAGS_KSM)
 		stress_ksm_memory_merge(1);
 
@@ -3995,6 +7273,54 @@ int main(int argc, char **argv, char **envp)
 		goto exit_stressors_free;
 	}
 
+	/*
+	 *  Sanity check --scale-sweep, stressors are swept one at a time
+	 */
+	if ((g_opt_flags & OPT_FLAGS_SCALE_SWEEP) &&
+	    (g_opt_flags & (OPT_FLAGS_RANDOM | OPT_FLAGS_ALL | OPT_FLAGS_PERMUTE))) {
+		(void)fprintf(stderr, "cannot invoke --scale-sweep with the --random, "
+			"--all or --permute options\n");
+		ret = EXIT_FAILURE;
+		goto exit_stressors_free;
+	}
+
+	/*
+	 *  Sanity check --interference, the victim is run against one
+	 *  aggressor at a time
+	 */
+	if (stress_get_setting("interference", &interference) &&
+	    ((g_opt_flags & (OPT_FLAGS_RANDOM | OPT_FLAGS_ALL | OPT_FLAGS_PERMUTE |
+			     OPT_FLAGS_SEQUENTIAL | OPT_FLAGS_SCALE_SWEEP)) ||
+	     stress_get_setting("repeat", &repeat))) {
+		(void)fprintf(stderr, "cannot invoke --interference with the --random, "
+			"--all, --permute, --sequential, --scale-sweep or --repeat options\n");
+		ret = EXIT_FAILURE;
+		goto exit_stressors_free;
+	}
+
+	/*
+	 *  Sanity check --repeat, stressors are repeated one at a time
+	 */
+	if (stress_get_setting("repeat", &repeat) &&
+	    (g_opt_flags & (OPT_FLAGS_RANDOM | OPT_FLAGS_ALL | OPT_FLAGS_PERMUTE | OPT_FLAGS_SCALE_SWEEP))) {
+		(void)fprintf(stderr, "cannot invoke --repeat with the --random, "
+			"--all, --permute or --scale-sweep options\n");
+		ret = EXIT_FAILURE;
+		goto exit_stressors_free;
+	}
+
+	/*
+	 *  Sanity check --target-power and --target-util, only one
+	 *  quantity can be controlled at a time
+	 */
+	if (stress_get_setting("target-power", &target_power) &&
+	    stress_get_setting("target-util", &target_util)) {
+		(void)fprintf(stderr, "cannot invoke mutually exclusive "
+			"--target-power and --target-util options together\n");
+		ret = EXIT_FAILURE;
+		goto exit_stressors_free;
+	}
+
 	/*
 	 *  Sanity check mutually exclusive random seed flags
 	 */
@@ -4028,6 +7354,7 @@ int main(int argc, char **argv, char **envp)
 	stress_log_system_info();
 	stress_log_system_mem_info();
 	stress_runinfo();
+	stress_multiver_log_info();
 	stress_cpuidle_log_info();
 	pr_dbg("%" PRId32 " processor%s online, %" PRId32
 		" processor%s configured\n",
@@ -4051,6 +7378,8 @@ int main(int argc, char **argv, char **envp)
 	/*
 	 *  Discard stressors that we can't run
 	 */
+	if (stress_get_setting("probe-cache", &probe_cache))
+		stress_probe_cache_load(probe_cache);
 	stress_exclude_unsupported(&unsupported);
 	stress_exclude_pathological();
 	/*
@@ -4072,6 +7401,10 @@ int main(int argc, char **argv, char **envp)
 	if (g_opt_flags & OPT_FLAGS_PERF_STATS)
 		stress_perf_init();
 #endif
+#if defined(STRESS_PERF_SAMPLE)
+	if (stress_get_setting("perf-sample", &perf_sample_top))
+		(void)stress_perf_sample_init();
+#endif
 
 	/*
 	 *  Setup running environment
@@ -4090,6 +7423,12 @@ int main(int argc, char **argv, char **envp)
 	(void)stress_get_setting("ionice-level", &ionice_level);
 	stress_set_iopriority(ionice_class, ionice_level);
 	(void)stress_get_setting("yaml", &yaml_filename);
+	cpu_cycles_stats = (yaml_filename != NULL) && (g_opt_flags & OPT_FLAGS_METRICS);
+	if (stress_get_setting("json", &json_filename) &&
+	    (stress_json_open(json_filename) < 0)) {
+		ret = EXIT_FAILURE;
+		goto exit_logging_close;
+	}
 
 	stress_mlock_executable();
 
@@ -4120,6 +7459,8 @@ int main(int argc, char **argv, char **envp)
 	 *  excluded stressors, so exclude check again
 	 */
 	stress_exclude_unsupported(&unsupported);
+	stress_probe_cache_save();
+	stress_probe_cache_free();
 	stress_exclude_pathological();
 
 	stress_set_proc_limits();
@@ -4141,6 +7482,8 @@ int main(int argc, char **argv, char **envp)
 	 *  across all the child stressors
 	 */
 	stress_shared_map(stress_get_total_instances(stressors_head));
+	if (g_opt_flags & OPT_FLAGS_C_STATES)
+		stress_cpuidle_percpu_init(stressors_head);
 
 	if (stress_lock_mem_map() < 0) {
 		pr_err("failed to create shared heap\n");
@@ -4151,7 +7494,7 @@ int main(int argc, char **argv, char **envp)
 	/*
 	 *  And now shared memory is created, initialize pr_* lock mechanism
 	 */
-	if (!stress_shared_heap_init()) {
+	if (!stress_shared_heap_init(stress_metrics_heap_size())) {
 		pr_err("failed to create shared heap\n");
 		ret = EXIT_FAILURE;
 		goto exit_shared_unmap;
@@ -4204,18 +7547,33 @@ int main(int argc, char **argv, char **envp)
 
 	stress_clear_warn_once();
 	stress_stressors_init();
+	stress_stressor_cgroup_setup(stressors_head);
+	stress_resctrl_setup(stressors_head);
 
 	/* Start thrasher process if required */
 	if (g_opt_flags & OPT_FLAGS_THRASH)
 		stress_thrash_start();
 
+	if (g_opt_flags & OPT_FLAGS_KSM)
+		stress_ksm_start();
 	stress_vmstat_start();
+	stress_openmetrics_start();
+	if ((g_opt_flags & OPT_FLAGS_THROTTLE) &&
+	    (stress_throttle_start() < 0))
+		g_opt_flags &= ~OPT_FLAGS_THROTTLE;
 	stress_smart_start();
 	stress_klog_start();
 	stress_clocksource_check();
 	stress_config_check();
-
-	if (g_opt_flags & OPT_FLAGS_SEQUENTIAL) {
+	stress_json_run_begin();
+
+	if (stress_get_setting("interference", &interference)) {
+		stress_run_interference(ticks_per_sec, &duration, &success, &resource_success, &metrics_success);
+	} else if (g_opt_flags & OPT_FLAGS_SCALE_SWEEP) {
+		stress_run_scale_sweep(ticks_per_sec, &duration, &success, &resource_success, &metrics_success);
+	} else if (stress_get_setting("repeat", &repeat)) {
+		stress_run_repeat(ticks_per_sec, &duration, &success, &resource_success, &metrics_success);
+	} else if (g_opt_flags & OPT_FLAGS_SEQUENTIAL) {
 		stress_run_sequential(ticks_per_sec, &duration, &success, &resource_success, &metrics_success);
 	} else if (g_opt_flags & OPT_FLAGS_PERMUTE) {
 		stress_run_permute(ticks_per_sec, &duration, &success, &resource_success, &metrics_success);
@@ -4224,6 +7582,7 @@ int main(int argc, char **argv, char **envp)
 	}
 
 	stress_clocksource_check();
+	stress_json_run_end(duration, success, resource_success, metrics_success);
 
 	/* Stop alarms */
 	(void)alarm(0);
@@ -4231,8 +7590,11 @@ int main(int argc, char **argv, char **envp)
 	/* Stop thasher process */
 	if (g_opt_flags & OPT_FLAGS_THRASH)
 		stress_thrash_stop();
+	if (g_opt_flags & OPT_FLAGS_THROTTLE)
+		stress_throttle_stop();
 
-	yaml = stress_yaml_open(yaml_filename);
+	(void)stress_get_setting("compare", &compare_filename);
+	yaml = stress_yaml_open(yaml_filename, compare_filename != NULL);
 
 	/*
 	 *  Dump metrics
@@ -4251,6 +7613,13 @@ int main(int argc, char **argv, char **envp)
 	if (g_opt_flags & OPT_FLAGS_PERF_STATS)
 		stress_perf_stat_dump(yaml, stressors_head, duration);
 #endif
+#if defined(STRESS_PERF_SAMPLE)
+	/*
+	 *  Dump perf sampling hot spots
+	 */
+	if (perf_sample_top > 0)
+		stress_perf_sample_dump(yaml, perf_sample_top);
+#endif
 
 #if defined(STRESS_THERMAL_ZONES)
 	/*
@@ -4270,17 +7639,77 @@ int main(int argc, char **argv, char **envp)
 	if (g_opt_flags & OPT_FLAGS_RAPL_REQUIRED)
 		stress_rapl_free_domains(g_shared->rapl_domains);
 #endif
+	/*
+	 *  Dump --scale-sweep results
+	 */
+	stress_scale_sweep_dump(yaml, stressors_head);
+	/*
+	 *  Dump --interference victim slowdowns
+	 */
+	stress_interference_dump(yaml, stressors_head);
+	/*
+	 *  Dump --offcpu scheduling breakdown
+	 */
+	if (stress_get_setting("offcpu", &offcpu))
+		stress_offcpu_dump(yaml, stressors_head);
+	/*
+	 *  Dump --mem-footprint memory use and page fault rates
+	 */
+	if (stress_get_setting("mem-footprint", &mem_footprint))
+		stress_memfootprint_dump(yaml, stressors_head);
+	/*
+	 *  Dump --ksm memory savings and ksmd cost
+	 */
+	if (g_opt_flags & OPT_FLAGS_KSM)
+		stress_ksm_dump(yaml, stressors_head);
+	/*
+	 *  Dump --psi pressure stall information
+	 */
+	if (stress_get_setting("psi", &psi))
+		stress_psi_dump(yaml, stressors_head);
+	/*
+	 *  Dump --stressor-cgroup throttling statistics
+	 */
+	stress_stressor_cgroup_dump(yaml);
+	/*
+	 *  Dump --resctrl cache occupancy and memory bandwidth
+	 */
+	stress_resctrl_dump(yaml, stressors_head);
+	/*
+	 *  Dump --repeat statistics
+	 */
+	stress_repeat_dump(yaml, stressors_head);
+	/*
+	 *  Dump --placement instance to CPU map
+	 */
+	stress_placement_dump(yaml, stressors_head);
+	/*
+	 *  Dump --sync-start barrier start spread
+	 */
+	stress_sync_start_dump(yaml);
 	/*
 	 *  Dump run times
 	 */
 	stress_times_dump(yaml, ticks_per_sec, duration);
+	/*
+	 *  Dump per stressor launch, init, run and teardown times
+	 */
+	stress_phase_dump(yaml, stressors_head);
+	/*
+	 *  Compare metrics against --compare baseline
+	 */
+	if (compare_filename)
+		compare_success = (stress_compare_yaml(yaml, compare_filename, compare_threshold) == 0);
 	stress_exit_status_summary();
 
 	stress_klog_stop(&success);
 	stress_smart_stop();
+	stress_openmetrics_stop();
 	stress_vmstat_stop();
 	stress_ftrace_stop();
 	stress_ftrace_free();
+	stress_stressor_cgroup_cleanup();
+	stress_resctrl_cleanup();
 
 	pr_inf("%s run completed in %s\n",
 		success ? "successful" : "unsuccessful",
@@ -4296,6 +7725,10 @@ int main(int argc, char **argv, char **envp)
 	stress_stressors_free();
 	stress_cpuidle_free();
 	stress_cache_free();
+	stress_placement_deinit();
+#if defined(STRESS_PERF_SAMPLE)
+	stress_perf_sample_deinit();
+#endif
 	stress_shared_unmap();
 	stress_settings_free();
 	stress_temp_path_free();
@@ -4306,6 +7739,7 @@ int main(int argc, char **argv, char **envp)
 	shim_closelog();
 	pr_closelog();
 	stress_yaml_close(yaml);
+	stress_json_close();
 
 	/*
 	 *  Done!
@@ -4316,6 +7750,8 @@ int main(int argc, char **argv, char **envp)
 		exit(EXIT_NO_RESOURCE);
 	if (!metrics_success)
 		exit(EXIT_METRICS_UNTRUSTWORTHY);
+	if (!compare_success)
+		exit(EXIT_PERF_REGRESSION);
 	exit(EXIT_SUCCESS);
 
 exit_lock_destroy:
@@ -4328,6 +7764,7 @@ exit_lock_mem_unmap:
 	stress_lock_mem_unmap();
 
 exit_logging_close:
+	stress_json_close();
 	shim_closelog();
 	pr_closelog();
 
@@ -208,26 +208,56 @@ typedef struct {
 } stress_metrics_item_t;
 
 typedef struct {
-	size_t max_metrics;
-	stress_metrics_item_t items[STRESS_MISC_METRICS_MAX];
+	size_t max_metrics;		/* highest metric index requested */
+	size_t n_items;			/* number of items allocated */
+	stress_metrics_item_t *items;	/* items, allocated on the shared heap */
 } stress_metrics_data_t;
 
+/*
+ *  Process local batched bogo-op accounting, ops are accumulated
+ *  in pending and published to the shared counter every threshold
+ *  ops, the threshold adapts to keep publishing intervals at around
+ *  STRESS_BOGO_BATCH_USECS microseconds
+ */
+typedef struct {
+	uint64_t pending;		/* ops not yet published */
+	uint64_t threshold;		/* publish after this many ops */
+	double time_published;		/* time of last publish */
+} stress_bogo_batch_t;
+
 /* stressor args */
 typedef struct {
 	const char *name;		/* stressor name */
 	uint64_t max_ops;		/* max number of bogo ops */
-	stress_counter_info_t ci;	/* counter info struct */
+	stress_counter_info_t *ci;	/* counter info, in g_shared->counters */
+	stress_bogo_batch_t bogo_batch;	/* batched bogo-op accounting */
 	uint32_t instance;		/* stressor instance # */
 	uint32_t instances;		/* number of instances */
 	pid_t pid;			/* stress pid info */
 	size_t page_size;		/* page size */
 	double time_end;		/* when to end */
+	double throttle_start;		/* start of --target-* duty cycle run */
 	stress_mapped_t *mapped;	/* mmap'd pages, addr of g_shared mapped */
 	stress_metrics_data_t *metrics;	/* misc per stressor metrics */
+	struct stress_latency_stat *latency; /* latency histograms, NULL if --latency not used */
 	struct stress_stats *stats; 	/* stressor stats */
 	const struct stressor_info *info; /* stressor info */
 } stress_args_t;
 
+/* --repeat samples per run, bogo ops/s then the misc metrics */
+#define STRESS_REPEAT_METRICS		(1 + STRESS_MISC_METRICS_MAX)
+
+/* --interference aggressor placements relative to the victim CPU */
+#define STRESS_INTERFERENCE_PLACEMENTS	(3)
+
+/* --scale-sweep throughput at a given instance count */
+typedef struct {
+	int32_t instances;		/* instances run in this step */
+	uint64_t bogo_ops;		/* total bogo ops of all instances */
+	double duration;		/* mean wall clock time of instances */
+	double rate;			/* bogo ops per second */
+} stress_scale_sweep_step_t;
+
 typedef struct stress_stressor_info {
 	struct stress_stressor_info *next; /* next proc info struct in list */
 	struct stress_stressor_info *prev; /* prev proc info struct in list */
@@ -236,12 +266,33 @@ typedef struct stress_stressor_info {
 	int32_t completed_instances;	/* count of completed instances */
 	int32_t instances;		/* number of instances per stressor */
 	uint64_t bogo_ops;		/* number of bogo ops */
+	struct stress_cstate_cpu *cstates_cpu; /* per CPU C-state stats, shared */
 	uint32_t status[STRESS_STRESSOR_STATUS_MAX];
 					/* number of instances that passed/failed/skipped */
 	struct {
 		uint8_t run;		/* ignore running the stressor, unsupported or excluded */
 		bool	permute;	/* ignore flag, saved for permute */
 	} ignore;
+	struct {
+		uint64_t bogo_ops;	/* bogo ops at last interval sample */
+		double	time;		/* time of last interval sample */
+	} interval;
+	struct {
+		stress_scale_sweep_step_t *steps; /* per instance count results */
+		size_t	n_steps;	/* number of steps run */
+	} scale_sweep;
+	struct {
+		double	*samples;	/* [run][STRESS_REPEAT_METRICS] values, NAN = unset */
+		size_t	n_runs;		/* number of measured runs */
+	} repeat;
+	struct {
+		bool	pin;		/* pin the instance to cpu */
+		int32_t	cpu;		/* CPU the instance is pinned to */
+		int32_t	placement_cpu[STRESS_INTERFERENCE_PLACEMENTS];
+					/* aggressor CPU per placement, -1 = none */
+		double	rate[STRESS_INTERFERENCE_PLACEMENTS];
+					/* victim bogo ops/s per aggressor placement */
+	} interference;
 } stress_stressor_t;
 
 #include "core-version.h"
@@ -260,6 +311,16 @@ typedef struct stress_stressor_info {
 #include "core-time.h"
 #include "core-thermal-zone.h"
 
+/*
+ *  Per instance counter info is kept in its own cacheline
+ *  sized slot to avoid false sharing of the hot bogo-op
+ *  counter with neighbouring instances and stats data
+ */
+typedef union {
+	stress_counter_info_t ci;	/* counter info */
+	uint8_t pad[64];		/* cacheline padding */
+} ALIGN64 stress_counter_slot_t;
+
 /* Per stressor information */
 
 #if defined(CHECK_UNEXPECTED) && 	\
@@ -295,6 +356,7 @@ do {				\
 #define EXIT_SIGNALED			(5)
 #define EXIT_BY_SYS_EXIT		(6)
 #define EXIT_METRICS_UNTRUSTWORTHY	(7)
+#define EXIT_PERF_REGRESSION		(8)
 
 /*
  *  Stressor run states
@@ -310,6 +372,7 @@ do {				\
 #define STRESS_STATE_ZOMBIE		(8)
 
 #define STRESS_INTERRUPTS_MAX		(8)	/* see core_interrupts.c */
+#define STRESS_IRQ_DIST_MAX		(5)	/* see core_interrupts.c */
 #define STRESS_CSTATES_MAX		(16)
 
 /* oomable flags */
@@ -449,6 +512,8 @@ typedef struct stressor_info {
 	const stress_help_t *help;	/* stressor help options */
 	const stress_class_t class;	/* stressor class */
 	const stress_verify_t verify;	/* verification mode */
+	const bool instance_threads;	/* true = instances can run as threads */
+	const size_t metrics_max;	/* misc metrics used, 0 = STRESS_MISC_METRICS_MAX */
 	const char *unimplemented_reason;	/* unsupported reason message */
 } stressor_info_t;
 
@@ -543,12 +608,132 @@ typedef struct {
 	uint64_t count_stop;
 } stress_interrupts_t;
 
+/* per CPU distribution of an interrupt or softirq type during a run */
+typedef struct {
+	uint64_t total;			/* events on all CPUs */
+	uint32_t cpus;			/* number of CPUs that handled events */
+	int32_t busiest_cpu;		/* CPU that handled the most events */
+	double	busiest_share;		/* % of events on busiest CPU */
+	double	imbalance;		/* busiest CPU events / mean per CPU */
+} stress_irq_dist_t;
+
+#define STRESS_WARMUP_AUTO		(-1)	/* --warmup auto */
+#define STRESS_WARMUP_POLL_MS		(250)	/* warm-up check interval */
+#define STRESS_WARMUP_WINDOW		(1.0)	/* auto steady state window, secs */
+#define STRESS_WARMUP_STEADY		(0.05)	/* auto steady state rate tolerance */
+
+#define STRESS_OFFCPU_POLL_MS		(100)	/* off-CPU sampling interval */
+#define STRESS_OFFCPU_WCHAN_MAX		(8)	/* blocking functions per instance */
+
+/* kernel function a blocked task is waiting in */
+typedef struct {
+	char name[48];			/* /proc/pid/wchan function name */
+	uint32_t count;			/* samples blocked in this function */
+} stress_offcpu_wchan_t;
+
+/* --offcpu on-CPU, runqueue wait and blocked time, sampled by the periodic stats process */
+typedef struct {
+	pid_t pid;			/* task being sampled */
+	uint64_t oncpu_ns_prev;		/* previous schedstat on-CPU time */
+	uint64_t runq_ns_prev;		/* previous schedstat runqueue wait time */
+	double time_prev;		/* time of previous sample */
+	uint64_t oncpu_ns;		/* accumulated on-CPU time */
+	uint64_t runq_ns;		/* accumulated runqueue wait time */
+	double wall;			/* accumulated sampled wall clock time */
+	uint32_t samples;		/* number of samples */
+	uint32_t blocked_samples;	/* samples where the task was blocked */
+	uint32_t wchan_other;		/* blocked samples not in wchan[] */
+	stress_offcpu_wchan_t wchan[STRESS_OFFCPU_WCHAN_MAX];
+} stress_offcpu_t;
+
+#define STRESS_MEMFOOTPRINT_POLL_MS	(250)	/* memory footprint sampling interval */
+#define STRESS_KSM_POLL_MS		(500)	/* --ksm merged pages sampling interval */
+
+/* --ksm pages merged by kernel samepage merging, sampled by the periodic stats process */
+typedef struct {
+	uint64_t merging_pages_peak;	/* peak /proc/pid/ksm_merging_pages */
+	uint32_t samples;		/* number of samples */
+} stress_ksm_t;
+
+/* --mem-footprint peak memory use and page fault rates, sampled by the periodic stats process */
+typedef struct {
+	pid_t pid;			/* task being sampled for page faults */
+	uint64_t minflt_prev;		/* previous minor page fault count */
+	uint64_t majflt_prev;		/* previous major page fault count */
+	double time_prev;		/* time of previous sample */
+	uint64_t minflt;		/* accumulated minor page faults */
+	uint64_t majflt;		/* accumulated major page faults */
+	double wall;			/* accumulated sampled wall clock time */
+	uint64_t rss_kb;		/* RSS at peak PSS */
+	uint64_t pss_kb;		/* peak PSS */
+	uint64_t uss_kb;		/* USS (private pages) at peak PSS */
+	uint64_t anon_kb;		/* anonymous memory at peak PSS */
+	uint64_t anon_huge_kb;		/* anonymous transparent huge pages at peak PSS */
+	uint32_t samples;		/* number of samples */
+} stress_memfootprint_t;
+
+#define STRESS_PSI_RESOURCES		(3)	/* cpu, memory and io */
+
+/* --psi pressure stall information of a resource */
+typedef struct {
+	double some_avg10;		/* some tasks stalled, % over last 10 secs */
+	double full_avg10;		/* all tasks stalled, % over last 10 secs */
+	uint64_t some_total;		/* some tasks stalled total, microseconds */
+	uint64_t full_total;		/* all tasks stalled total, microseconds */
+} stress_psi_resource_t;
+
+/* --psi snapshot of host and stressor cgroup pressure stall information */
+typedef struct {
+	double time;			/* time of snapshot */
+	bool host_valid;		/* true if /proc/pressure was read */
+	bool cgroup_valid;		/* true if stressor cgroup *.pressure was read */
+	stress_psi_resource_t host[STRESS_PSI_RESOURCES];
+	stress_psi_resource_t cgroup[STRESS_PSI_RESOURCES];
+} stress_psi_snapshot_t;
+
+/* --psi snapshots at start and end of a stressor instance */
+typedef struct {
+	stress_psi_snapshot_t start;	/* snapshot at instance start */
+	stress_psi_snapshot_t stop;	/* snapshot at instance end */
+} stress_psi_t;
+
+/* end of --warmup snapshot, taken by the periodic stats process */
+typedef struct {
+	double time;			/* time of snapshot */
+	uint64_t counter;		/* bogo-op counter at snapshot */
+	double utime;			/* user time at snapshot */
+	double stime;			/* system time at snapshot */
+	bool usage;			/* utime and stime are valid */
+	bool valid;			/* snapshot taken */
+	double window_time;		/* auto: start of rate window */
+	uint64_t window_counter;	/* auto: counter at start of window */
+	double window_rate;		/* auto: previous window bogo-op rate */
+} stress_warmup_t;
+
 typedef struct {
 	bool   valid;
 	double time[STRESS_CSTATES_MAX];
 	double residency[STRESS_CSTATES_MAX];
 } stress_cstate_stats_t;
 
+/* per CPU C-state stats, begin values until the end of a run */
+typedef struct stress_cstate_cpu {
+	bool	valid;				/* true if CPU has C-states */
+	bool	affinity;			/* CPU is in stressor affinity set */
+	double	time;				/* sample duration in seconds */
+	double	residency[STRESS_CSTATES_MAX];	/* residency in microseconds */
+	uint64_t usage[STRESS_CSTATES_MAX];	/* number of C-state entries */
+} stress_cstate_cpu_t;
+
+/* --times per instance phase timestamps, 0.0 if not reached */
+typedef struct {
+	double fork;			/* parent forked the instance */
+	double enter;			/* entry to the stressor function */
+	double first_op;		/* first bogo-op counted */
+	double leave;			/* return from the stressor function */
+	double reaped;			/* instance reaped by the parent */
+} stress_phase_times_t;
+
 /* Per stressor statistics and accounting info */
 typedef struct stress_stats {
 	stress_args_t args;		/* stressor args */
@@ -556,10 +741,14 @@ typedef struct stress_stats {
 	double duration;		/* finish - start */
 	uint64_t counter_total;		/* counter total */
 	double duration_total;		/* wall clock duration */
+	double sync_start;		/* time released by --sync-start barrier */
+	stress_phase_times_t phase;	/* fork, setup, run and teardown times */
 	stress_pid_t s_pid;		/* stressor pid */
 	bool sigalarmed;		/* set true if signalled with SIGALRM */
 	bool signalled;			/* set true if signalled with a kill */
 	bool completed;			/* true if stressor completed */
+	bool instance_thread;		/* run as a thread of instance 0 */
+	int exit_status;		/* instance thread exit status, -1 if not set */
 #if defined(STRESS_PERF_STATS)
 	stress_perf_t sp;		/* perf counters */
 #endif
@@ -571,17 +760,28 @@ typedef struct stress_stats {
 #endif
 	stress_checksum_t *checksum;	/* pointer to checksum data */
 	stress_interrupts_t interrupts[STRESS_INTERRUPTS_MAX];
+	stress_irq_dist_t irq_dist[STRESS_IRQ_DIST_MAX]; /* per CPU distribution */
 	stress_cstate_stats_t cstates;	/* cstate stats */
+	stress_warmup_t warmup;		/* --warmup snapshot */
+	stress_offcpu_t offcpu;		/* --offcpu scheduling breakdown */
+	stress_memfootprint_t memfootprint; /* --mem-footprint memory use */
+	stress_ksm_t ksm;		/* --ksm merged pages */
+	stress_psi_t psi;		/* --psi pressure stall information */
+	uint64_t resctrl_llc_occupancy;	/* --resctrl LLC occupancy at finish */
 	stress_metrics_data_t metrics;	/* misc metrics */
 	double rusage_utime;		/* rusage user time */
 	double rusage_stime;		/* rusage system time */
 	double rusage_utime_total;	/* rusage user time */
 	double rusage_stime_total;	/* rusage system time */
 	long int rusage_maxrss;		/* rusage max RSS, 0 = unused */
+	uint64_t cpu_cycles;		/* stressor thread core cycles */
+	uint64_t cpu_ref_cycles;	/* stressor thread reference cycles */
+	double cpu_cycles_utime;	/* user time while counting cycles */
+	int32_t placement_cpu;		/* --placement CPU, -1 = not placed */
 } stress_stats_t;
 
 typedef struct shared_heap {
-	void *str_list_head;		/* list of heap strings */
+	void *str_hash_table;		/* hash table of interned heap strings */
 	void *lock;			/* heap global lock */
 	void *heap;			/* mmap'd heap */
 	size_t heap_size;		/* heap size */
@@ -644,6 +844,13 @@ typedef struct {
 		uint32_t futex[STRESS_PROCS_MAX] ALIGNED(4);/* Shared futexes */
 		uint64_t timeout[STRESS_PROCS_MAX];	/* Shared futex timeouts */
 	} futex;
+	struct {
+		/* futexes must be aligned to avoid -EINVAL */
+		uint32_t generation ALIGNED(4);	/* --sync-start barrier generation */
+		uint32_t releases;	/* number of barrier releases */
+		double spread_max;	/* largest first to last start spread */
+		double spread_total;	/* sum of all start spreads */
+	} sync_start;
 #if defined(HAVE_SEM_SYSV) && 	\
     defined(HAVE_KEY_T)
 	struct {
@@ -669,17 +876,27 @@ typedef struct {
 		double start_time ALIGNED(8);	/* Time to complete operation */
 		uint32_t value;		/* Dummy value to operate on */
 	} syncload;
+	struct {
+		double duty;		/* --target-* duty cycle, 0.0..1.0 */
+		double achieved_total;	/* sum of achieved power or utilization */
+		uint64_t samples;	/* number of controller samples */
+	} throttle;
 	struct {
 		stress_checksum_t *checksums;	/* per stressor counter checksum */
 		size_t	length;		/* size of checksums mapping */
 	} checksum;
 	struct {
-		uint8_t allocated[65536 / sizeof(uint8_t)];	/* allocation bitmap */
-		void *lock;		/* lock for allocator */
+		uint64_t allocated[65536 / 64];	/* allocation bitmap, 1 bit per port */
+		void *lock;		/* lock for allocator without atomics */
 	} net_port_map;
 	struct {
 		uint32_t ready;		/* incremented when rawsock stressor is ready */
 	} rawsock;
+	struct {
+		uint64_t pages_sharing_peak;	/* --ksm peak system pages sharing */
+		uint64_t pages_shared_peak;	/* --ksm pages shared at the peak */
+	} ksm;
+	stress_counter_slot_t *counters;/* per instance counter slots, after stats[] */
 	stress_stats_t stats[];		/* Shared statistics */
 } stress_shared_t;
 
@@ -721,6 +938,8 @@ static inline void ALWAYS_INLINE OPTIMIZE3 stress_continue_set_flag(const bool s
 	g_stress_continue_flag = setting;
 }
 
+extern void stress_bogo_first_op(stress_args_t *args);
+
 /*
  *  stress_bogo_add()
  *	add inc to the stressor bogo ops counter
@@ -731,11 +950,13 @@ static inline void ALWAYS_INLINE OPTIMIZE3 stress_continue_set_flag(const bool s
  */
 static inline void ALWAYS_INLINE OPTIMIZE3 stress_bogo_add(stress_args_t *args, const uint64_t inc)
 {
-	args->ci.counter_ready = false;
+	if (UNLIKELY(!args->ci->counter))
+		stress_bogo_first_op(args);
+	args->ci->counter_ready = false;
 	stress_asm_mb();
-	args->ci.counter += inc;
+	args->ci->counter += inc;
 	stress_asm_mb();
-	args->ci.counter_ready = true;
+	args->ci->counter_ready = true;
 }
 
 /*
@@ -748,11 +969,13 @@ static inline void ALWAYS_INLINE OPTIMIZE3 stress_bogo_add(stress_args_t *args,
  */
 static inline void ALWAYS_INLINE OPTIMIZE3 stress_bogo_inc(stress_args_t *args)
 {
-	args->ci.counter_ready = false;
+	if (UNLIKELY(!args->ci->counter))
+		stress_bogo_first_op(args);
+	args->ci->counter_ready = false;
 	stress_asm_mb();
-	args->ci.counter++;
+	args->ci->counter++;
 	stress_asm_mb();
-	args->ci.counter_ready = true;
+	args->ci->counter_ready = true;
 }
 
 /*
@@ -761,7 +984,7 @@ static inline void ALWAYS_INLINE OPTIMIZE3 stress_bogo_inc(stress_args_t *args)
  */
 static inline uint64_t ALWAYS_INLINE OPTIMIZE3 stress_bogo_get(stress_args_t *args)
 {
-	return args->ci.counter;
+	return args->ci->counter;
 }
 
 /*
@@ -770,7 +993,7 @@ static inline uint64_t ALWAYS_INLINE OPTIMIZE3 stress_bogo_get(stress_args_t *ar
  */
 static inline void ALWAYS_INLINE OPTIMIZE3 stress_bogo_ready(stress_args_t *args)
 {
-	args->ci.counter_ready = true;
+	args->ci->counter_ready = true;
 }
 
 /*
@@ -783,11 +1006,89 @@ static inline void ALWAYS_INLINE OPTIMIZE3 stress_bogo_ready(stress_args_t *args
  */
 static inline void ALWAYS_INLINE OPTIMIZE3 stress_bogo_set(stress_args_t *args, const uint64_t val)
 {
-	args->ci.counter_ready = false;
+	if (UNLIKELY(!args->ci->counter && val))
+		stress_bogo_first_op(args);
+	args->ci->counter_ready = false;
 	stress_asm_mb();
-	args->ci.counter = val;
+	args->ci->counter = val;
 	stress_asm_mb();
-	args->ci.counter_ready = true;
+	args->ci->counter_ready = true;
+}
+
+#define STRESS_BOGO_BATCH_MIN		(16ULL)		/* minimum ops per publish */
+#define STRESS_BOGO_BATCH_MAX		(65536ULL)	/* maximum ops per publish */
+#define STRESS_BOGO_BATCH_USECS		(10000.0)	/* target publish interval */
+
+/*
+ *  stress_bogo_batch_begin()
+ *	(re)start batched bogo-op accounting, this is called by
+ *	stress_run_child() before a stressor is invoked. Ops added
+ *	with stress_bogo_batch_inc() and stress_bogo_batch_add() are
+ *	published to the shared counter periodically and finally
+ *	flushed when the stressor returns to stress_run_child()
+ */
+static inline void stress_bogo_batch_begin(stress_args_t *args)
+{
+	args->bogo_batch.pending = 0;
+	args->bogo_batch.threshold = STRESS_BOGO_BATCH_MIN;
+	args->bogo_batch.time_published = stress_time_now();
+}
+
+/*
+ *  stress_bogo_batch_flush()
+ *	publish any pending batched bogo-ops to the shared counter
+ */
+static inline void ALWAYS_INLINE stress_bogo_batch_flush(stress_args_t *args)
+{
+	if (args->bogo_batch.pending) {
+		stress_bogo_add(args, args->bogo_batch.pending);
+		args->bogo_batch.pending = 0;
+	}
+}
+
+/*
+ *  stress_bogo_batch_publish()
+ *	flush pending bogo-ops and adjust the batch threshold so
+ *	that publishing occurs at around STRESS_BOGO_BATCH_USECS
+ */
+static inline void stress_bogo_batch_publish(stress_args_t *args)
+{
+	const double now = stress_time_now();
+	const double delta = (now - args->bogo_batch.time_published) * STRESS_DBL_MICROSECOND;
+
+	stress_bogo_batch_flush(args);
+	args->bogo_batch.time_published = now;
+
+	if ((delta < STRESS_BOGO_BATCH_USECS * 0.5) &&
+	    (args->bogo_batch.threshold < STRESS_BOGO_BATCH_MAX))
+		args->bogo_batch.threshold <<= 1;
+	else if ((delta > STRESS_BOGO_BATCH_USECS * 2.0) &&
+		 (args->bogo_batch.threshold > STRESS_BOGO_BATCH_MIN))
+		args->bogo_batch.threshold >>= 1;
+}
+
+/*
+ *  stress_bogo_batch_add()
+ *	add inc to the batched bogo-ops counter, publishing
+ *	to the shared counter when the threshold is reached
+ */
+static inline void ALWAYS_INLINE OPTIMIZE3 stress_bogo_batch_add(stress_args_t *args, const uint64_t inc)
+{
+	args->bogo_batch.pending += inc;
+	if (UNLIKELY(args->bogo_batch.pending >= args->bogo_batch.threshold))
+		stress_bogo_batch_publish(args);
+}
+
+/*
+ *  stress_bogo_batch_inc()
+ *	increment the batched bogo-ops counter, publishing
+ *	to the shared counter when the threshold is reached
+ */
+static inline void ALWAYS_INLINE OPTIMIZE3 stress_bogo_batch_inc(stress_args_t *args)
+{
+	args->bogo_batch.pending++;
+	if (UNLIKELY(args->bogo_batch.pending >= args->bogo_batch.threshold))
+		stress_bogo_batch_publish(args);
 }
 
 /*
@@ -798,9 +1099,11 @@ static inline void ALWAYS_INLINE OPTIMIZE3 stress_bogo_set(stress_args_t *args,
  */
 static inline void ALWAYS_INLINE stress_force_killed_bogo(stress_args_t *args)
 {
-	args->ci.force_killed = true;
+	args->ci->force_killed = true;
 }
 
+extern void stress_throttle(stress_args_t *args);
+
 /*
  *  stress_continue()
  *      returns true if we can keep on running a stressor
@@ -809,11 +1112,30 @@ static inline bool ALWAYS_INLINE OPTIMIZE3 stress_continue(stress_args_t *args)
 {
 	if (UNLIKELY(!g_stress_continue_flag))
 		return false;
+	if (UNLIKELY(g_opt_flags & OPT_FLAGS_THROTTLE))
+		stress_throttle(args);
 	if (LIKELY(args->max_ops == 0))
 		return true;
 	return stress_bogo_get(args) < args->max_ops;
 }
 
+/*
+ *  stress_bogo_batch_continue()
+ *      returns true if we can keep on running a stressor that
+ *	uses batched bogo-op accounting, pending ops are included
+ *	so that --ops limits are not overshot
+ */
+static inline bool ALWAYS_INLINE OPTIMIZE3 stress_bogo_batch_continue(stress_args_t *args)
+{
+	if (UNLIKELY(!g_stress_continue_flag))
+		return false;
+	if (UNLIKELY(g_opt_flags & OPT_FLAGS_THROTTLE))
+		stress_throttle(args);
+	if (LIKELY(args->max_ops == 0))
+		return true;
+	return (stress_bogo_get(args) + args->bogo_batch.pending) < args->max_ops;
+}
+
 /*
  *  stress_bogo_add_lock()
  *	add val to the stressor bogo ops counter with lock, return true
@@ -864,6 +1186,7 @@ static inline bool stress_bogo_inc_lock(stress_args_t *args, void *lock, const b
 #define STRESS_METRIC_MAXIMUM		(0x4)
 
 extern WARN_UNUSED int stress_parse_opts(int argc, char **argv, const bool jobmode);
+extern bool stress_stressor_opt_safe(const int opt);
 extern void stress_sync_start_init(stress_pid_t *s_pid);
 extern void stress_sync_start_cont_list(stress_pid_t *s_pids_head);
 extern void stress_sync_start_cont_s_pid(stress_pid_t *s_pid);
@@ -878,6 +1201,12 @@ static inline void stress_sync_start_s_pid_list_add(stress_pid_t **s_pids_head,
 	*s_pids_head = s_pid;
 }
 
+extern void stress_metrics_interval_dump(FILE *fp, const double now);
+extern void stress_metrics_warmup_check(const int32_t warmup, const double now);
+extern void stress_metrics_openmetrics_dump(FILE *fp, const double now);
+extern void stress_metrics_offcpu_sample(const double now);
+extern void stress_metrics_memfootprint_sample(const double now);
+extern void stress_metrics_ksm_sample(void);
 extern void stress_shared_readonly(void);
 extern void stress_shared_unmap(void);
 extern void stress_log_system_mem_info(void);
@@ -76,9 +76,9 @@ static void stress_nop_spin_ ## name(				\
 			(*duration) += stress_time_now() - t;	\
 			(*count) += (double)(64 * NOP_LOOPS);	\
 								\
-			stress_bogo_inc(args);			\
+			stress_bogo_batch_inc(args);		\
 		}						\
-	} while (flag && stress_continue(args));		\
+	} while (flag && stress_bogo_batch_continue(args));	\
 }
 
 STRESS_NOP_SPIN_OP(nop, stress_asm_nop)
@@ -294,7 +294,7 @@ static void stress_nop_random(
 
 		current_instr = &nop_instrs[n];
 		stress_nop_callfunc(current_instr, args, false, duration, count);
-	} while (stress_continue(args));
+	} while (stress_bogo_batch_continue(args));
 }
 
 static void NORETURN stress_sigill_nop_handler(int signum)
@@ -370,6 +370,7 @@ const stressor_info_t stress_nop_info = {
 	.stressor = stress_nop,
 	.class = CLASS_CPU,
 	.opts = opts,
+	.metrics_max = 1,
 	.help = help
 };
 #else
@@ -94,8 +94,8 @@ static int stress_null(stress_args_t *args)
 			} else {
 				bytes += ret;
 			}
-			stress_bogo_inc(args);
-		} while (stress_continue(args));
+			stress_bogo_batch_inc(args);
+		} while (stress_bogo_batch_continue(args));
 		duration += stress_time_now() - t;
 	} else {
 		if (args->instance == 0)
@@ -205,5 +205,6 @@ const stressor_info_t stress_null_info = {
 	.class = CLASS_DEV | CLASS_MEMORY | CLASS_OS,
 	.opts = opts,
 	.verify = VERIFY_ALWAYS,
+	.metrics_max = 1,
 	.help = help
 };
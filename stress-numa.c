@@ -18,12 +18,16 @@
  *
  */
 #include "stress-ng.h"
+#include "core-affinity.h"
 #include "core-attribute.h"
 #include "core-builtin.h"
 #include "core-capabilities.h"
 #include "core-madvise.h"
 #include "core-mmap.h"
 #include "core-numa.h"
+#include "core-put.h"
+
+#include <ctype.h>
 
 #if defined(HAVE_LINUX_MEMPOLICY_H)
 #include <linux/mempolicy.h>
@@ -32,10 +36,14 @@
 #define MIN_NUMA_MMAP_BYTES	(1 * MB)
 #define MAX_NUMA_MMAP_BYTES	(MAX_MEM_LIMIT)
 #define DEFAULT_NUMA_MMAP_BYTES	(4 * MB)
+#define DEFAULT_NUMA_MATRIX_BYTES (256 * MB)
+#define DEFAULT_NUMA_BALANCE_BYTES (64 * MB)
 
 static const stress_help_t help[] = {
 	{ NULL,	"numa N",		"start N workers stressing NUMA interfaces" },
+	{ NULL,	"numa-balance",		"measure how fast NUMA balancing migrates memory after a moved task" },
 	{ NULL,	"numa-bytes N",		"size of memory region to be exercised" },
+	{ NULL,	"numa-matrix",		"measure CPU node to memory node bandwidth and latency matrix" },
 	{ NULL,	"numa-ops N",		"stop after N NUMA bogo operations" },
 	{ NULL,	"numa-shuffle-addr",	"shuffle page addresses to move to numa nodes" },
 	{ NULL,	"numa-shuffle-node",	"shuffle numa nodes on numa pages moves" },
@@ -43,7 +51,9 @@ static const stress_help_t help[] = {
 };
 
 static const stress_opt_t opts[] = {
+	{ OPT_numa_balance,      "numa-balance",      TYPE_ID_BOOL, 0, 1, NULL },
 	{ OPT_numa_bytes,        "numa-bytes",        TYPE_ID_SIZE_T_BYTES_VM, MIN_NUMA_MMAP_BYTES, MAX_NUMA_MMAP_BYTES, NULL },
+	{ OPT_numa_matrix,       "numa-matrix",       TYPE_ID_BOOL, 0, 1, NULL },
 	{ OPT_numa_shuffle_addr, "numa-shuffle-addr", TYPE_ID_BOOL, 0, 1, NULL },
 	{ OPT_numa_shuffle_node, "numa-shiffle-node", TYPE_ID_BOOL, 0, 1, NULL },
 	END_OPT,
@@ -170,6 +180,570 @@ static void stress_numa_check_maps(
 	(void)fclose(fp);
 }
 
+#if defined(HAVE_CPU_SET_T) &&		\
+    defined(HAVE_SCHED_GETAFFINITY) &&	\
+    defined(HAVE_SCHED_SETAFFINITY)
+#define STRESS_NUMA_MATRIX	(1)
+
+#define STRESS_NUMA_MATRIX_NODES_MAX	(64)		/* largest matrix */
+#define STRESS_NUMA_MATRIX_METRICS_MAX	(6)		/* largest matrix reported as metrics */
+#define STRESS_NUMA_MATRIX_LINE		(64)		/* pointer chase stride */
+#define STRESS_NUMA_MATRIX_LOADS	(1U << 20)	/* dependent loads per latency sample */
+#define STRESS_NUMA_MATRIX_BW_TIME	(0.1)		/* minimum seconds per bandwidth sample */
+
+typedef struct {
+	int node;			/* NUMA node number */
+	int ncpus;			/* CPUs on the node, 0 = memory only node */
+	cpu_set_t cpus;			/* CPUs on the node */
+} stress_numa_matrix_node_t;
+
+typedef struct {
+	double bw_total;		/* sum of read bandwidth, MB per sec */
+	double latency_total;		/* sum of dependent load latency, ns */
+	uint64_t samples;		/* number of samples */
+} stress_numa_matrix_cell_t;
+
+static int stress_numa_matrix_node_cmp(const void *p1, const void *p2)
+{
+	const stress_numa_matrix_node_t *n1 = (const stress_numa_matrix_node_t *)p1;
+	const stress_numa_matrix_node_t *n2 = (const stress_numa_matrix_node_t *)p2;
+
+	return n1->node - n2->node;
+}
+
+/*
+ *  stress_numa_matrix_nodes()
+ *	find the NUMA nodes and the CPUs on each node,
+ *	returns number of nodes found
+ */
+static size_t stress_numa_matrix_nodes(stress_numa_matrix_node_t *nodes, const size_t max_nodes)
+{
+	DIR *dir;
+	const struct dirent *d;
+	static const char *path = "/sys/devices/system/node";
+	size_t n = 0;
+
+	dir = opendir(path);
+	if (!dir)
+		return 0;
+
+	while ((n < max_nodes) && ((d = readdir(dir)) != NULL)) {
+		char filename[PATH_MAX], buf[4096], *ptr;
+		int node;
+
+		if (strncmp(d->d_name, "node", 4) || !isdigit((unsigned char)d->d_name[4]))
+			continue;
+		if (sscanf(d->d_name + 4, "%d", &node) != 1)
+			continue;
+
+		nodes[n].node = node;
+		nodes[n].ncpus = 0;
+		CPU_ZERO(&nodes[n].cpus);
+		(void)snprintf(filename, sizeof(filename), "%s/%s/cpulist", path, d->d_name);
+		if (stress_system_read(filename, buf, sizeof(buf)) > 0) {
+			ptr = strchr(buf, '\n');
+			if (ptr)
+				*ptr = '\0';
+			if (*buf)
+				(void)stress_parse_cpu_affinity(buf, &nodes[n].cpus, &nodes[n].ncpus);
+		}
+		n++;
+	}
+	(void)closedir(dir);
+
+	qsort(nodes, n, sizeof(*nodes), stress_numa_matrix_node_cmp);
+	return n;
+}
+
+/*
+ *  stress_numa_matrix_chain()
+ *	link the cache lines of buf into a single random cycle
+ *	for dependent load latency measurements. The random
+ *	ordering is built in word 1 of each line, the link to
+ *	the next line is stored in word 0.
+ */
+static void stress_numa_matrix_chain(uintptr_t *buf, const size_t lines)
+{
+	const size_t stride = STRESS_NUMA_MATRIX_LINE / sizeof(*buf);
+	size_t i;
+
+	for (i = 0; i < lines; i++)
+		buf[(i * stride) + 1] = (uintptr_t)i;
+	for (i = lines - 1; i > 0; i--) {
+		const size_t j = (size_t)stress_mwc64modn((uint64_t)i + 1);
+		const uintptr_t tmp = buf[(i * stride) + 1];
+
+		buf[(i * stride) + 1] = buf[(j * stride) + 1];
+		buf[(j * stride) + 1] = tmp;
+	}
+	for (i = 0; i < lines; i++) {
+		const size_t from = (size_t)buf[(i * stride) + 1];
+		const size_t to = (size_t)buf[(((i + 1) % lines) * stride) + 1];
+
+		buf[from * stride] = (uintptr_t)&buf[to * stride];
+	}
+}
+
+/*
+ *  stress_numa_matrix_bandwidth()
+ *	sequential read bandwidth of buf in MB per sec
+ */
+static double stress_numa_matrix_bandwidth(const uint64_t *buf, const size_t buf_size)
+{
+	const size_t n = buf_size / sizeof(*buf);
+	const double t_start = stress_time_now();
+	uint64_t passes = 0, sum = 0;
+	double duration;
+
+	do {
+		register uint64_t s0 = 0, s1 = 0, s2 = 0, s3 = 0;
+		register size_t i;
+
+		for (i = 0; i < n; i += 4) {
+			s0 += buf[i];
+			s1 += buf[i + 1];
+			s2 += buf[i + 2];
+			s3 += buf[i + 3];
+		}
+		sum += s0 + s1 + s2 + s3;
+		passes++;
+		duration = stress_time_now() - t_start;
+	} while ((duration < STRESS_NUMA_MATRIX_BW_TIME) && stress_continue_flag());
+
+	stress_uint64_put(sum);
+	return (duration > 0.0) ? ((double)buf_size * (double)passes) / (duration * (double)MB) : 0.0;
+}
+
+/*
+ *  stress_numa_matrix_latency()
+ *	dependent load latency in ns chasing the buf cache line chain
+ */
+static double stress_numa_matrix_latency(uintptr_t *buf)
+{
+	register void **ptr = (void **)buf;
+	register uint32_t i;
+	double t_start, duration;
+
+	t_start = stress_time_now();
+	for (i = 0; i < STRESS_NUMA_MATRIX_LOADS; i++)
+		ptr = (void **)*ptr;
+	duration = stress_time_now() - t_start;
+	stress_void_ptr_put((void *)ptr);
+
+	return (duration * STRESS_DBL_NANOSECOND) / (double)STRESS_NUMA_MATRIX_LOADS;
+}
+
+/*
+ *  stress_numa_matrix_move()
+ *	migrate buf to the given node, returns -1 if the node
+ *	has no memory or the pages cannot be moved
+ */
+static int stress_numa_matrix_move(
+	stress_numa_mask_t *numa_mask,
+	void *buf,
+	const size_t buf_size,
+	const int node)
+{
+	long int lret;
+
+	if ((node < 0) || ((unsigned long int)node >= numa_mask->max_nodes))
+		return -1;
+	(void)shim_memset(numa_mask->mask, 0x00, numa_mask->mask_size);
+	STRESS_SETBIT(numa_mask->mask, (unsigned long int)node);
+	lret = shim_mbind(buf, buf_size, MPOL_BIND, numa_mask->mask,
+		numa_mask->max_nodes, MPOL_MF_MOVE | MPOL_MF_STRICT);
+	return (lret < 0) ? -1 : 0;
+}
+
+/*
+ *  stress_numa_matrix_log()
+ *	log a CPU node by memory node table of cell values
+ */
+static void stress_numa_matrix_log(
+	stress_args_t *args,
+	const char *title,
+	const stress_numa_matrix_node_t *nodes,
+	const size_t n_nodes,
+	const stress_numa_matrix_cell_t *cells,
+	const bool latency)
+{
+	char row[STRESS_NUMA_MATRIX_NODES_MAX * 10 + 16];
+	size_t cpu, mem, len;
+
+	pr_inf("%s: %s, CPU node (rows) by memory node (columns)\n", args->name, title);
+	len = (size_t)snprintf(row, sizeof(row), "%8s", "");
+	for (mem = 0; mem < n_nodes; mem++)
+		len += (size_t)snprintf(row + len, sizeof(row) - len, " %9s%d", "node", nodes[mem].node);
+	pr_inf("%s: %s\n", args->name, row);
+
+	for (cpu = 0; cpu < n_nodes; cpu++) {
+		if (!nodes[cpu].ncpus)
+			continue;
+		len = (size_t)snprintf(row, sizeof(row), "  node%-2d", nodes[cpu].node);
+		for (mem = 0; mem < n_nodes; mem++) {
+			const stress_numa_matrix_cell_t *cell = &cells[(cpu * n_nodes) + mem];
+
+			if (cell->samples) {
+				const double value = latency ? cell->latency_total : cell->bw_total;
+
+				len += (size_t)snprintf(row + len, sizeof(row) - len, " %10.1f",
+					value / (double)cell->samples);
+			} else {
+				len += (size_t)snprintf(row + len, sizeof(row) - len, " %10s", "n/a");
+			}
+		}
+		pr_inf("%s: %s\n", args->name, row);
+	}
+}
+
+/*
+ *  stress_numa_matrix()
+ *	measure read bandwidth and dependent load latency from
+ *	each NUMA node with CPUs to each NUMA node with memory,
+ *	useful to validate SNC/NPS settings and CXL memory nodes
+ */
+static int stress_numa_matrix(
+	stress_args_t *args,
+	stress_numa_mask_t *numa_mask,
+	size_t numa_bytes)
+{
+	stress_numa_matrix_node_t *nodes;
+	stress_numa_matrix_cell_t *cells;
+	size_t n_nodes, cpu, mem;
+	uintptr_t *buf;
+	cpu_set_t mask_orig;
+	int rc = EXIT_SUCCESS;
+
+	numa_bytes &= ~(size_t)(STRESS_NUMA_MATRIX_LINE - 1);
+
+	nodes = (stress_numa_matrix_node_t *)calloc(STRESS_NUMA_MATRIX_NODES_MAX, sizeof(*nodes));
+	if (!nodes) {
+		pr_inf_skip("%s: cannot allocate NUMA node information, skipping stressor\n", args->name);
+		return EXIT_NO_RESOURCE;
+	}
+	n_nodes = stress_numa_matrix_nodes(nodes, STRESS_NUMA_MATRIX_NODES_MAX);
+	if (n_nodes == 0) {
+		pr_inf_skip("%s: cannot read NUMA nodes from /sys/devices/system/node, skipping stressor\n", args->name);
+		rc = EXIT_NO_RESOURCE;
+		goto nodes_free;
+	}
+	cells = (stress_numa_matrix_cell_t *)calloc(n_nodes * n_nodes, sizeof(*cells));
+	if (!cells) {
+		pr_inf_skip("%s: cannot allocate NUMA matrix, skipping stressor\n", args->name);
+		rc = EXIT_NO_RESOURCE;
+		goto nodes_free;
+	}
+	if (sched_getaffinity(0, sizeof(mask_orig), &mask_orig) < 0) {
+		pr_inf_skip("%s: sched_getaffinity failed, errno=%d (%s), skipping stressor\n",
+			args->name, errno, strerror(errno));
+		rc = EXIT_NO_RESOURCE;
+		goto cells_free;
+	}
+
+	buf = (uintptr_t *)mmap(NULL, numa_bytes, PROT_READ | PROT_WRITE,
+				MAP_ANONYMOUS | MAP_PRIVATE, -1, 0);
+	if (buf == MAP_FAILED) {
+		pr_inf_skip("%s: cannot mmap %zu byte matrix buffer, errno=%d (%s), skipping stressor\n",
+			args->name, numa_bytes, errno, strerror(errno));
+		rc = EXIT_NO_RESOURCE;
+		goto cells_free;
+	}
+	stress_set_vma_anon_name(buf, numa_bytes, "numa-matrix");
+	stress_numa_matrix_chain(buf, numa_bytes / STRESS_NUMA_MATRIX_LINE);
+
+	if (args->instance == 0)
+		pr_inf("%s: measuring %zu x %zu NUMA node matrix using a %zuMB buffer\n",
+			args->name, n_nodes, n_nodes, numa_bytes / (size_t)MB);
+
+	stress_set_proc_state(args->name, STRESS_STATE_SYNC_WAIT);
+	stress_sync_start_wait(args);
+	stress_set_proc_state(args->name, STRESS_STATE_RUN);
+
+	do {
+		for (mem = 0; mem < n_nodes; mem++) {
+			if (stress_numa_matrix_move(numa_mask, buf, numa_bytes, nodes[mem].node) < 0)
+				continue;
+			for (cpu = 0; cpu < n_nodes; cpu++) {
+				stress_numa_matrix_cell_t *cell = &cells[(cpu * n_nodes) + mem];
+				double bw, latency;
+
+				if (!nodes[cpu].ncpus)
+					continue;
+				if (sched_setaffinity(0, sizeof(nodes[cpu].cpus), &nodes[cpu].cpus) < 0)
+					continue;
+				bw = stress_numa_matrix_bandwidth((uint64_t *)buf, numa_bytes);
+				latency = stress_numa_matrix_latency(buf);
+				if (UNLIKELY(!stress_continue_flag()))
+					goto done;
+				cell->bw_total += bw;
+				cell->latency_total += latency;
+				cell->samples++;
+			}
+		}
+		stress_bogo_inc(args);
+	} while (stress_continue(args));
+done:
+	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
+	(void)sched_setaffinity(0, sizeof(mask_orig), &mask_orig);
+
+	if (args->instance == 0) {
+		stress_numa_matrix_log(args, "read bandwidth MB per sec", nodes, n_nodes, cells, false);
+		stress_numa_matrix_log(args, "dependent load latency ns", nodes, n_nodes, cells, true);
+	}
+	if (n_nodes <= STRESS_NUMA_MATRIX_METRICS_MAX) {
+		size_t idx = 0;
+
+		for (cpu = 0; cpu < n_nodes; cpu++) {
+			for (mem = 0; mem < n_nodes; mem++) {
+				const stress_numa_matrix_cell_t *cell = &cells[(cpu * n_nodes) + mem];
+				char str[64];
+
+				if (!cell->samples)
+					continue;
+				(void)snprintf(str, sizeof(str), "node %d to node %d read MB per sec",
+					nodes[cpu].node, nodes[mem].node);
+				stress_metrics_set(args, idx++, str,
+					cell->bw_total / (double)cell->samples, STRESS_METRIC_HARMONIC_MEAN);
+				(void)snprintf(str, sizeof(str), "node %d to node %d latency ns",
+					nodes[cpu].node, nodes[mem].node);
+				stress_metrics_set(args, idx++, str,
+					cell->latency_total / (double)cell->samples, STRESS_METRIC_GEOMETRIC_MEAN);
+			}
+		}
+	} else if (args->instance == 0) {
+		pr_inf("%s: more than %d NUMA nodes, matrix is not reported in the metrics\n",
+			args->name, STRESS_NUMA_MATRIX_METRICS_MAX);
+	}
+
+	(void)munmap((void *)buf, numa_bytes);
+cells_free:
+	free(cells);
+nodes_free:
+	free(nodes);
+
+	return rc;
+}
+
+#define STRESS_NUMA_BALANCE_SAMPLE	(0.1)		/* seconds between locality samples */
+#define STRESS_NUMA_BALANCE_WAIT	(10.0)		/* maximum seconds per round to reach locality */
+#define STRESS_NUMA_BALANCE_LOCAL	(90)		/* % of pages on the new node deemed local */
+#define STRESS_NUMA_BALANCE_TREND_MAX	(100)		/* maximum trend samples logged */
+
+typedef struct {
+	double t;			/* time since the task was moved */
+	double latency;			/* dependent load latency, ns */
+	double local;			/* % of pages on the new node */
+} stress_numa_balance_sample_t;
+
+/*
+ *  stress_numa_balance_on_node()
+ *	return number of pages currently on the given node,
+ *	move_pages with NULL nodes only queries the page status
+ */
+static size_t stress_numa_balance_on_node(
+	void **pages,
+	int *status,
+	const size_t n_pages,
+	const int node)
+{
+	size_t i, n = 0;
+
+	if (shim_move_pages(0, n_pages, pages, NULL, status, 0) < 0)
+		return 0;
+	for (i = 0; i < n_pages; i++)
+		n += (status[i] == node);
+	return n;
+}
+
+/*
+ *  stress_numa_balance()
+ *	touch a working set on one node, move the task to the CPUs
+ *	of another node and measure how quickly the kernel's automatic
+ *	NUMA balancing migrates the working set after it
+ */
+static int stress_numa_balance(stress_args_t *args, size_t numa_bytes)
+{
+	const size_t page_size = args->page_size;
+	stress_numa_matrix_node_t *nodes;
+	stress_numa_balance_sample_t *samples;
+	size_t n_nodes, n_cpu_nodes, n_pages, i;
+	size_t cpu_nodes[STRESS_NUMA_MATRIX_NODES_MAX];
+	void **pages = NULL;
+	int *status = NULL;
+	cpu_set_t mask_orig;
+	char buf[32];
+	int mode = 0, rc = EXIT_SUCCESS;
+	bool trend = (args->instance == 0);
+	uint64_t rounds = 0, local_rounds = 0;
+	double migrated = 0.0, migrate_duration = 0.0, local_time = 0.0;
+	double latency_start = 0.0, latency_end = 0.0;
+
+	numa_bytes &= ~(page_size - 1);
+	n_pages = numa_bytes / page_size;
+
+	nodes = (stress_numa_matrix_node_t *)calloc(STRESS_NUMA_MATRIX_NODES_MAX, sizeof(*nodes));
+	if (!nodes) {
+		pr_inf_skip("%s: cannot allocate NUMA node information, skipping stressor\n", args->name);
+		return EXIT_NO_RESOURCE;
+	}
+	n_nodes = stress_numa_matrix_nodes(nodes, STRESS_NUMA_MATRIX_NODES_MAX);
+	for (n_cpu_nodes = 0, i = 0; i < n_nodes; i++) {
+		if (nodes[i].ncpus)
+			cpu_nodes[n_cpu_nodes++] = i;
+	}
+	if (n_cpu_nodes < 2) {
+		if (args->instance == 0)
+			pr_inf_skip("%s: --numa-balance needs at least two NUMA nodes with CPUs, "
+				"skipping stressor\n", args->name);
+		rc = EXIT_NO_RESOURCE;
+		goto nodes_free;
+	}
+	if (sched_getaffinity(0, sizeof(mask_orig), &mask_orig) < 0) {
+		pr_inf_skip("%s: sched_getaffinity failed, errno=%d (%s), skipping stressor\n",
+			args->name, errno, strerror(errno));
+		rc = EXIT_NO_RESOURCE;
+		goto nodes_free;
+	}
+
+	if ((stress_system_read("/proc/sys/kernel/numa_balancing", buf, sizeof(buf)) > 0) &&
+	    (sscanf(buf, "%d", &mode) != 1))
+		mode = 0;
+	if ((args->instance == 0) && (mode == 0))
+		pr_inf("%s: /proc/sys/kernel/numa_balancing is disabled, the working set "
+			"is not expected to follow the task\n", args->name);
+
+	pages = (void **)calloc(n_pages, sizeof(*pages));
+	status = (int *)calloc(n_pages, sizeof(*status));
+	samples = (stress_numa_balance_sample_t *)calloc(STRESS_NUMA_BALANCE_TREND_MAX, sizeof(*samples));
+	if (!pages || !status || !samples) {
+		pr_inf_skip("%s: cannot allocate %zu page status entries, skipping stressor\n",
+			args->name, n_pages);
+		rc = EXIT_NO_RESOURCE;
+		goto tidy;
+	}
+
+	if (args->instance == 0)
+		pr_inf("%s: migrating a %zuMB working set between %zu NUMA nodes with CPUs, "
+			"numa_balancing mode %d\n", args->name, numa_bytes / (size_t)MB,
+			n_cpu_nodes, mode);
+
+	stress_set_proc_state(args->name, STRESS_STATE_SYNC_WAIT);
+	stress_sync_start_wait(args);
+	stress_set_proc_state(args->name, STRESS_STATE_RUN);
+
+	do {
+		const stress_numa_matrix_node_t *from = &nodes[cpu_nodes[rounds % n_cpu_nodes]];
+		const stress_numa_matrix_node_t *to = &nodes[cpu_nodes[(rounds + 1) % n_cpu_nodes]];
+		uintptr_t *ptr;
+		size_t local, local_begin, n_samples = 0;
+		double t, t_start, t_sample, latency = 0.0;
+		bool converged = false;
+
+		/* first touch the working set on the CPUs of the from node */
+		if (sched_setaffinity(0, sizeof(from->cpus), &from->cpus) < 0) {
+			pr_inf_skip("%s: cannot set CPU affinity to node %d, errno=%d (%s), "
+				"skipping stressor\n", args->name, from->node, errno, strerror(errno));
+			rc = EXIT_NO_RESOURCE;
+			break;
+		}
+		ptr = (uintptr_t *)mmap(NULL, numa_bytes, PROT_READ | PROT_WRITE,
+					MAP_ANONYMOUS | MAP_PRIVATE, -1, 0);
+		if (ptr == MAP_FAILED) {
+			pr_inf_skip("%s: cannot mmap %zu byte working set, errno=%d (%s), "
+				"skipping stressor\n", args->name, numa_bytes, errno, strerror(errno));
+			rc = EXIT_NO_RESOURCE;
+			break;
+		}
+		stress_set_vma_anon_name(ptr, numa_bytes, "numa-balance");
+		stress_numa_matrix_chain(ptr, numa_bytes / STRESS_NUMA_MATRIX_LINE);
+		for (i = 0; i < n_pages; i++)
+			pages[i] = (void *)((uint8_t *)ptr + (i * page_size));
+
+		/* move the task and keep accessing until the working set follows */
+		(void)sched_setaffinity(0, sizeof(to->cpus), &to->cpus);
+		local_begin = stress_numa_balance_on_node(pages, status, n_pages, to->node);
+		local = local_begin;
+		latency_start += stress_numa_matrix_latency(ptr);
+
+		t_start = stress_time_now();
+		t_sample = t_start + STRESS_NUMA_BALANCE_SAMPLE;
+		do {
+			latency = stress_numa_matrix_latency(ptr);
+			t = stress_time_now();
+			if (t < t_sample)
+				continue;
+			t_sample = t + STRESS_NUMA_BALANCE_SAMPLE;
+
+			local = stress_numa_balance_on_node(pages, status, n_pages, to->node);
+			if (trend && (n_samples < STRESS_NUMA_BALANCE_TREND_MAX)) {
+				samples[n_samples].t = t - t_start;
+				samples[n_samples].latency = latency;
+				samples[n_samples].local = 100.0 * (double)local / (double)n_pages;
+				n_samples++;
+			}
+			if (local * 100 >= n_pages * STRESS_NUMA_BALANCE_LOCAL) {
+				converged = true;
+				break;
+			}
+		} while (stress_continue_flag() &&
+			 (t - t_start < STRESS_NUMA_BALANCE_WAIT));
+		t = stress_time_now() - t_start;
+		(void)munmap((void *)ptr, numa_bytes);
+
+		if (trend && (n_samples > 0)) {
+			pr_dbg("%s: node %d to node %d load latency and locality over time:\n",
+				args->name, from->node, to->node);
+			for (i = 0; i < n_samples; i++)
+				pr_dbg("%s: %8.3fs %9.2f ns %6.2f%% local\n", args->name,
+					samples[i].t, samples[i].latency, samples[i].local);
+			trend = false;
+		}
+		/* ignore rounds cut short by the end of the run */
+		if (!converged && !stress_continue_flag())
+			break;
+
+		if (local > local_begin)
+			migrated += (double)(local - local_begin);
+		migrate_duration += t;
+		latency_end += latency;
+		if (converged) {
+			local_time += t;
+			local_rounds++;
+		}
+		rounds++;
+		stress_bogo_inc(args);
+	} while (stress_continue(args));
+
+	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
+	(void)sched_setaffinity(0, sizeof(mask_orig), &mask_orig);
+
+	if (rounds > 0) {
+		stress_metrics_set(args, 0, "pages migrated per sec",
+			(migrate_duration > 0.0) ? migrated / migrate_duration : 0.0,
+			STRESS_METRIC_HARMONIC_MEAN);
+		stress_metrics_set(args, 1, "% rounds reaching locality",
+			100.0 * (double)local_rounds / (double)rounds,
+			STRESS_METRIC_GEOMETRIC_MEAN);
+		if (local_rounds > 0)
+			stress_metrics_set(args, 2, "secs time to locality",
+				local_time / (double)local_rounds,
+				STRESS_METRIC_GEOMETRIC_MEAN);
+		stress_metrics_set(args, 3, "ns load latency after task move",
+			latency_start / (double)rounds, STRESS_METRIC_GEOMETRIC_MEAN);
+		stress_metrics_set(args, 4, "ns load latency at end of round",
+			latency_end / (double)rounds, STRESS_METRIC_GEOMETRIC_MEAN);
+	}
+tidy:
+	free(samples);
+	free(status);
+	free(pages);
+nodes_free:
+	free(nodes);
+
+	return rc;
+}
+#endif
+
 /*
  *  stress_numa()
  *	stress the Linux NUMA interfaces
@@ -185,7 +759,8 @@ static int stress_numa(stress_args_t *args)
 	int failed = 0;
 	void **pages;
 	size_t k;
-	bool numa_shuffle_addr = false, numa_shuffle_node = false;
+	bool numa_shuffle_addr = false, numa_shuffle_node = false, numa_matrix = false;
+	bool numa_balance = false;
 	stress_numa_stats_t stats_begin, stats_end;
 	size_t status_size, dest_nodes_size, pages_size;
 	double t, duration, metric;
@@ -208,8 +783,16 @@ static int stress_numa(stress_args_t *args)
 			numa_shuffle_node = true;
 	}
 
+	(void)stress_get_setting("numa-matrix", &numa_matrix);
+	(void)stress_get_setting("numa-balance", &numa_balance);
+
 	if (numa_bytes == 0) {
-		numa_bytes = DEFAULT_NUMA_MMAP_BYTES;
+		if (numa_matrix)
+			numa_bytes = DEFAULT_NUMA_MATRIX_BYTES;
+		else if (numa_balance)
+			numa_bytes = DEFAULT_NUMA_BALANCE_BYTES;
+		else
+			numa_bytes = DEFAULT_NUMA_MMAP_BYTES;
 	} else {
 		if (args->instances > 0) {
 			numa_bytes /= args->instances;
@@ -235,6 +818,27 @@ static int stress_numa(stress_args_t *args)
 		goto numa_mask_free;
 	}
 
+	if (numa_matrix) {
+#if defined(STRESS_NUMA_MATRIX)
+		rc = stress_numa_matrix(args, numa_mask, numa_bytes);
+		goto old_numa_mask_free;
+#else
+		if (args->instance == 0)
+			pr_inf("%s: --numa-matrix requires CPU affinity support, ignoring option\n",
+				args->name);
+#endif
+	}
+	if (numa_balance) {
+#if defined(STRESS_NUMA_MATRIX)
+		rc = stress_numa_balance(args, numa_bytes);
+		goto old_numa_mask_free;
+#else
+		if (args->instance == 0)
+			pr_inf("%s: --numa-balance requires CPU affinity support, ignoring option\n",
+				args->name);
+#endif
+	}
+
 	if (!args->instance) {
 		char str[32];
 
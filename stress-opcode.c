@@ -683,6 +683,7 @@ const stressor_info_t stress_opcode_info = {
 	.stressor = stress_opcode,
 	.class = CLASS_CPU | CLASS_OS,
 	.opts = opts,
+	.metrics_max = 8,
 	.help = help
 };
 #else
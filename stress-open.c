@@ -1216,5 +1216,6 @@ const stressor_info_t stress_open_info = {
 	.stressor = stress_open,
 	.class = CLASS_FILESYSTEM | CLASS_OS,
 	.opts = opts,
+	.metrics_max = 1,
 	.help = help
 };
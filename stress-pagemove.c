@@ -320,6 +320,7 @@ const stressor_info_t stress_pagemove_info = {
 	.class = CLASS_VM | CLASS_OS,
 	.opts = opts,
 	.verify = VERIFY_ALWAYS,
+	.metrics_max = 1,
 	.help = help
 };
 #else
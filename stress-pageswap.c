@@ -18,6 +18,7 @@
  */
 #include "stress-ng.h"
 #include "core-out-of-memory.h"
+#include "core-swapstat.h"
 
 static const stress_help_t help[] = {
 	{ NULL,	"pageswap N",		"start N workers that swap pages out and in" },
@@ -46,27 +47,11 @@ static int stress_pageswap_supported(const char *name)
 
 #if defined(MADV_PAGEOUT)
 
-static void stress_pageswap_count_paged_out(void *page, const size_t page_size, double *count)
-{
-#if defined(HAVE_MINCORE) &&    \
-    NEED_GLIBC(2,2,0)
-	unsigned char vec[1];
-	int ret;
-
-	ret = shim_mincore(page, page_size, vec);
-	if ((ret == 0) && ((vec[0] & 0x01) == 0))
-		(*count) += 1.0;
-#else
-	(void)page;
-	(void)page_size;
-	(void)count;
-#endif
-}
-
 static void stress_pageswap_unmap(
 	stress_args_t *args,
 	page_info_t **head,
 	double *count,
+	stress_latency_hist_t *hist,
 	int *rc)
 {
 	page_info_t *pi = *head;
@@ -77,7 +62,8 @@ static void stress_pageswap_unmap(
 		const size_t size = pi->size;
 
 		(void)madvise(pi, size, MADV_PAGEOUT);
-		stress_pageswap_count_paged_out(pi, size, count);
+		/* swap the page back in if it was paged out */
+		(*count) += (double)stress_swapstat_fault_latency(pi, size, size, hist);
 		if (UNLIKELY(verify && (pi->self != pi))) {
 			pr_fail("%s: page at %p does not contain expected data\n",
 				args->name, (void *)pi);
@@ -103,22 +89,26 @@ static int stress_pageswap_child(stress_args_t *args, void *context)
 	page_info_t *head = NULL;
 	double count = 0.0, t, duration, rate;
 	int rc = EXIT_SUCCESS;
+	stress_swapstat_t swap_start, swap_end;
+	stress_latency_hist_t fault_hist;
 
 	(void)context;
 
+	stress_latency_hist_init(&fault_hist);
+	stress_swapstat_read(&swap_start);
 	t = stress_time_now();
 	do {
 		page_info_t *pi;
 
 		if ((g_opt_flags & OPT_FLAGS_OOM_AVOID) && stress_low_memory(page_size)) {
-			stress_pageswap_unmap(args, &head, &count, &rc);
+			stress_pageswap_unmap(args, &head, &count, &fault_hist, &rc);
 			max = 0;
 		}
 
 		pi = (page_info_t *)mmap(NULL, page_size, PROT_READ | PROT_WRITE,
 			MAP_ANONYMOUS | MAP_SHARED, -1, 0);
 		if (UNLIKELY(pi == MAP_FAILED)) {
-			stress_pageswap_unmap(args, &head, &count, &rc);
+			stress_pageswap_unmap(args, &head, &count, &fault_hist, &rc);
 			max = 0;
 		} else {
 			page_info_t *oldhead = head;
@@ -138,7 +128,7 @@ static int stress_pageswap_child(stress_args_t *args, void *context)
 #endif
 
 			if (UNLIKELY(max++ > 65536)) {
-				stress_pageswap_unmap(args, &head, &count, &rc);
+				stress_pageswap_unmap(args, &head, &count, &fault_hist, &rc);
 				max = 0;
 			}
 			stress_bogo_inc(args);
@@ -146,12 +136,14 @@ static int stress_pageswap_child(stress_args_t *args, void *context)
 	} while ((rc == EXIT_SUCCESS) && stress_continue(args));
 	duration = stress_time_now() - t;
 
-	stress_pageswap_unmap(args, &head, &count, &rc);
+	stress_pageswap_unmap(args, &head, &count, &fault_hist, &rc);
 
 	rate = (count > 0.0) ? duration / count : 0.0;
 	if (rate > 0.0)
 		stress_metrics_set(args, 0, "millisecs per page swapout",
 			rate * 1000000, STRESS_METRIC_HARMONIC_MEAN);
+	stress_swapstat_read(&swap_end);
+	(void)stress_swapstat_metrics(args, 1, &swap_start, &swap_end, &fault_hist);
 
 	return rc;
 }
@@ -179,6 +171,7 @@ const stressor_info_t stress_pageswap_info = {
 	.supported = stress_pageswap_supported,
 	.class = CLASS_OS | CLASS_VM,
 	.verify = VERIFY_OPTIONAL,
+	.metrics_max = 1 + STRESS_SWAPSTAT_METRICS,
 	.help = help
 };
 
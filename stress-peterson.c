@@ -262,6 +262,7 @@ const stressor_info_t stress_peterson_info = {
 	.stressor = stress_peterson,
 	.class = CLASS_CPU_CACHE | CLASS_IPC,
 	.verify = VERIFY_ALWAYS,
+	.metrics_max = 1,
 	.supported = stress_peterson_supported,
 	.help = help
 };
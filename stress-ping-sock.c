@@ -137,6 +137,7 @@ const stressor_info_t stress_ping_sock_info = {
 	.stressor = stress_ping_sock,
 	.class = CLASS_NETWORK | CLASS_OS,
 	.supported = stress_rawsock_supported,
+	.metrics_max = 1,
 	.help = help
 };
 #else
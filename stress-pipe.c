@@ -20,6 +20,7 @@
 #include "stress-ng.h"
 #include "core-affinity.h"
 #include "core-builtin.h"
+#include "core-latency.h"
 
 #include <sys/ioctl.h>
 
@@ -354,7 +355,9 @@ static int stress_pipe_write_generic(
 
 	do {
 		register ssize_t ret;
+		uint64_t t_lat;
 
+		t_lat = stress_latency_begin(args);
 		ret = write(fd, buf, pipe_data_size);
 		if (UNLIKELY(ret <= 0)) {
 			if ((errno == EAGAIN) || (errno == EINTR))
@@ -369,6 +372,7 @@ static int stress_pipe_write_generic(
 			}
 			continue;
 		}
+		stress_latency_end(args, 0, t_lat);
 		stress_bogo_inc(args);
 		bytes += ret;
 	} while (stress_continue(args));
@@ -395,8 +399,10 @@ static int stress_pipe_write_generic_verify(
 
 	do {
 		register ssize_t ret;
+		uint64_t t_lat;
 
 		*buf32 = val++;
+		t_lat = stress_latency_begin(args);
 		ret = write(fd, buf, pipe_data_size);
 		if (UNLIKELY(ret <= 0)) {
 			if ((errno == EAGAIN) || (errno == EINTR))
@@ -411,6 +417,7 @@ static int stress_pipe_write_generic_verify(
 			}
 			continue;
 		}
+		stress_latency_end(args, 0, t_lat);
 		stress_bogo_inc(args);
 		bytes += ret;
 	} while (stress_continue(args));
@@ -443,11 +450,13 @@ static int stress_pipe_write_splice(
 
 	do {
 		register ssize_t ret;
+		uint64_t t_lat;
 
 		iov.iov_base = buf + offset;
 		offset += pipe_data_size;
 		if (UNLIKELY(offset >= offset_end))
 			offset = 0;
+		t_lat = stress_latency_begin(args);
 		ret = vmsplice(fd, &iov, 1, 0);
 		if (UNLIKELY(ret <= 0)) {
 			if ((errno == EAGAIN) || (errno == EINTR))
@@ -462,6 +471,7 @@ static int stress_pipe_write_splice(
 			}
 			continue;
 		}
+		stress_latency_end(args, 0, t_lat);
 		stress_bogo_inc(args);
 		bytes += pipe_data_size;
 	} while (stress_continue(args));
@@ -494,6 +504,7 @@ static int stress_pipe_write_splice_verify(
 
 	do {
 		register ssize_t ret;
+		uint64_t t_lat;
 		uint32_t *buf32;
 
 		iov.iov_base = buf + offset;
@@ -502,6 +513,7 @@ static int stress_pipe_write_splice_verify(
 		offset += pipe_data_size;
 		if (UNLIKELY(offset >= offset_end))
 			offset = 0;
+		t_lat = stress_latency_begin(args);
 		ret = vmsplice(fd, &iov, 1, 0);
 		if (UNLIKELY(ret <= 0)) {
 			if ((errno == EAGAIN) || (errno == EINTR))
@@ -516,6 +528,7 @@ static int stress_pipe_write_splice_verify(
 			}
 			continue;
 		}
+		stress_latency_end(args, 0, t_lat);
 		stress_bogo_inc(args);
 		bytes += pipe_data_size;
 	} while (stress_continue(args));
@@ -686,6 +699,7 @@ again:
 
 		/* Parent */
 		(void)close(pipefds[0]);
+		stress_latency_set_description(args, 0, "pipe write");
 		t = stress_time_now();
 #if defined(HAVE_VMSPLICE)
 		if (pipe_vmsplice) {
@@ -738,5 +752,6 @@ const stressor_info_t stress_pipe_info = {
 	.class = CLASS_PIPE_IO | CLASS_MEMORY | CLASS_OS | CLASS_IPC,
 	.opts = opts,
 	.verify = VERIFY_OPTIONAL,
+	.metrics_max = 1,
 	.help = help
 };
@@ -20,6 +20,15 @@
 #include "stress-ng.h"
 #include "core-builtin.h"
 #include "core-killpid.h"
+#include "core-latency.h"
+
+#if defined(HAVE_SYS_EPOLL_H)
+#include <sys/epoll.h>
+#endif
+
+#if defined(HAVE_SYS_EVENTFD_H)
+#include <sys/eventfd.h>
+#endif
 
 /*
  *  Herd of pipe processes, simulates how GNU make passes tokens
@@ -32,6 +41,35 @@
  */
 #define PIPE_HERD_MAX	(100)
 
+#if defined(__linux__) &&		\
+    defined(HAVE_ATOMIC_ADD_FETCH) &&	\
+    defined(HAVE_ATOMIC_LOAD)
+#define HAVE_PIPEHERD_BROADCAST
+#endif
+
+#define PIPEHERD_BCAST_ALL	(0)
+#define PIPEHERD_BCAST_PIPE	(1)
+#define PIPEHERD_BCAST_EVENTFD	(2)
+#define PIPEHERD_BCAST_FUTEX	(3)
+#define PIPEHERD_BCAST_EPOLL	(4)
+#define PIPEHERD_BCAST_MAX	(5)
+
+#define PIPEHERD_WAKE_FIRST	(0)
+#define PIPEHERD_WAKE_LAST	(1)
+
+#define MIN_PIPEHERD_READERS	(1)
+#define MAX_PIPEHERD_READERS	(PIPE_HERD_MAX)
+#define DEFAULT_PIPEHERD_READERS (8)
+
+typedef struct {
+	uint32_t	gen;		/* round generation, idle readers futex wait on this */
+	uint32_t	ready;		/* readers about to block on the wake primitive */
+	uint32_t	done;		/* readers woken in this round */
+	uint32_t	wake;		/* futex broadcast wake word */
+	uint32_t	method;		/* wake method of this round */
+	uint64_t	t_wake[PIPE_HERD_MAX];	/* reader resume times, nanoseconds */
+} stress_pipeherd_bcast_t;
+
 typedef struct {
 	uint64_t	counter;
 	uint32_t	check;
@@ -39,11 +77,26 @@ typedef struct {
 
 static const stress_help_t help[] = {
 	{ "p N", "pipeherd N",		"start N multi-process workers exercising pipes I/O" },
+	{ NULL,	"pipeherd-broadcast M",	"time one writer waking K readers: all, pipe, eventfd, futex, epoll" },
 	{ NULL,	"pipeherd-ops N",	"stop after N pipeherd I/O bogo operations" },
+	{ NULL,	"pipeherd-readers K",	"number of readers woken per broadcast, default is 8" },
 	{ NULL,	"pipeherd-yield",	"force processes to yield after each write" },
 	{ NULL,	NULL,			NULL }
 };
 
+static const char * const stress_pipeherd_broadcasts[] = {
+	"all",
+	"pipe",
+	"eventfd",
+	"futex",
+	"epoll",
+};
+
+static const char *stress_pipeherd_broadcast_method(const size_t i)
+{
+	return (i < SIZEOF_ARRAY(stress_pipeherd_broadcasts)) ? stress_pipeherd_broadcasts[i] : NULL;
+}
+
 static int stress_pipeherd_read_write(stress_args_t *args, const int fd[2], const bool pipeherd_yield)
 {
 	while (stress_continue(args)) {
@@ -69,6 +122,347 @@ static int stress_pipeherd_read_write(stress_args_t *args, const int fd[2], cons
 	return EXIT_SUCCESS;
 }
 
+#if defined(HAVE_PIPEHERD_BROADCAST)
+/*
+ *  stress_pipeherd_bcast_fds_t
+ *	broadcast wake primitives shared by the writer and readers
+ */
+typedef struct {
+	int pipe_fds[2];	/* K readers each read one byte */
+	int efd_sem;		/* K readers each read one semaphore count */
+	int efd_bcast;		/* level triggered epoll readable event */
+} stress_pipeherd_bcast_fds_t;
+
+/*
+ *  stress_pipeherd_bcast_wait()
+ *	wait for a shared futex counter to reach n, returns false
+ *	if the stressor should stop
+ */
+static bool stress_pipeherd_bcast_wait(stress_args_t *args, uint32_t *counter, const uint32_t n)
+{
+	for (;;) {
+		const uint32_t val = __atomic_load_n(counter, __ATOMIC_SEQ_CST);
+		struct timespec timeout;
+
+		if (val >= n)
+			return true;
+		if (UNLIKELY(!stress_continue(args)))
+			return false;
+		timeout.tv_sec = 0;
+		timeout.tv_nsec = 100000000;
+		(void)shim_futex_wait(counter, (int)val, &timeout);
+	}
+}
+
+/*
+ *  stress_pipeherd_bcast_reader()
+ *	block on the round's wake primitive, timestamp the resume
+ *	and then idle until the writer starts the next round
+ */
+static void stress_pipeherd_bcast_reader(
+	stress_pipeherd_bcast_t *bcast,
+	const stress_pipeherd_bcast_fds_t *fds,
+	const uint32_t readers,
+	const size_t reader)
+{
+	uint32_t gen = 0;
+	int epfd = -1;
+#if defined(HAVE_SYS_EPOLL_H) &&	\
+    defined(HAVE_EPOLL_CREATE)
+	struct epoll_event ev;
+
+	epfd = epoll_create(1);
+	if (epfd >= 0) {
+		(void)shim_memset(&ev, 0, sizeof(ev));
+		ev.events = EPOLLIN;
+		ev.data.fd = fds->efd_bcast;
+		if (epoll_ctl(epfd, EPOLL_CTL_ADD, fds->efd_bcast, &ev) < 0) {
+			(void)close(epfd);
+			epfd = -1;
+		}
+	}
+#endif
+
+	while (stress_continue_flag()) {
+		uint32_t wake;
+		uint64_t val;
+		char ch;
+		ssize_t ret = 0;
+
+		/* idle until the writer starts a new round */
+		while (__atomic_load_n(&bcast->gen, __ATOMIC_SEQ_CST) == gen) {
+			if (UNLIKELY(!stress_continue_flag()))
+				goto done;
+			(void)shim_futex_wait(&bcast->gen, (int)gen, NULL);
+		}
+		gen = __atomic_load_n(&bcast->gen, __ATOMIC_SEQ_CST);
+		wake = __atomic_load_n(&bcast->wake, __ATOMIC_SEQ_CST);
+
+		if (__atomic_add_fetch(&bcast->ready, 1, __ATOMIC_SEQ_CST) == readers)
+			(void)shim_futex_wake(&bcast->ready, 1);
+
+		switch (bcast->method) {
+		case PIPEHERD_BCAST_PIPE:
+			ret = read(fds->pipe_fds[0], &ch, sizeof(ch));
+			break;
+		case PIPEHERD_BCAST_EVENTFD:
+			ret = read(fds->efd_sem, &val, sizeof(val));
+			break;
+		case PIPEHERD_BCAST_FUTEX:
+			while (__atomic_load_n(&bcast->wake, __ATOMIC_SEQ_CST) == wake) {
+				if (UNLIKELY(!stress_continue_flag()))
+					goto done;
+				(void)shim_futex_wait(&bcast->wake, (int)wake, NULL);
+			}
+			break;
+#if defined(HAVE_SYS_EPOLL_H) &&	\
+    defined(HAVE_EPOLL_CREATE)
+		case PIPEHERD_BCAST_EPOLL:
+			ret = epoll_wait(epfd, &ev, 1, -1);
+			break;
+#endif
+		default:
+			break;
+		}
+		if (ret < 0)
+			break;
+		bcast->t_wake[reader] = stress_latency_now();
+
+		if (__atomic_add_fetch(&bcast->done, 1, __ATOMIC_SEQ_CST) == readers)
+			(void)shim_futex_wake(&bcast->done, 1);
+	}
+done:
+	if (epfd >= 0)
+		(void)close(epfd);
+}
+
+/*
+ *  stress_pipeherd_bcast_write()
+ *	wake all K readers with one broadcast on the given primitive
+ */
+static int stress_pipeherd_bcast_write(
+	stress_pipeherd_bcast_t *bcast,
+	const stress_pipeherd_bcast_fds_t *fds,
+	const uint32_t readers,
+	const uint32_t method)
+{
+	char buf[PIPE_HERD_MAX];
+	uint64_t val;
+
+	switch (method) {
+	case PIPEHERD_BCAST_PIPE:
+		(void)shim_memset(buf, 'w', sizeof(buf));
+		return (write(fds->pipe_fds[1], buf, (size_t)readers) == (ssize_t)readers) ? 0 : -1;
+	case PIPEHERD_BCAST_EVENTFD:
+		val = (uint64_t)readers;
+		return (write(fds->efd_sem, &val, sizeof(val)) == (ssize_t)sizeof(val)) ? 0 : -1;
+	case PIPEHERD_BCAST_FUTEX:
+		(void)__atomic_add_fetch(&bcast->wake, 1, __ATOMIC_SEQ_CST);
+		return (shim_futex_wake(&bcast->wake, INT_MAX) < 0) ? -1 : 0;
+	case PIPEHERD_BCAST_EPOLL:
+		val = 1;
+		return (write(fds->efd_bcast, &val, sizeof(val)) == (ssize_t)sizeof(val)) ? 0 : -1;
+	default:
+		break;
+	}
+	return -1;
+}
+
+/*
+ *  stress_pipeherd_broadcast()
+ *	one writer wakes K blocked readers per round, the time from the
+ *	write to the first and the last reader resuming is measured for
+ *	pipe, eventfd, futex and epoll wake ups
+ */
+static int stress_pipeherd_broadcast(stress_args_t *args, const size_t pipeherd_broadcast)
+{
+	static const char * const wake_names[] = { "first", "last" };
+	stress_pipeherd_bcast_t *bcast;
+	stress_pipeherd_bcast_fds_t fds;
+	stress_latency_hist_t *hists;
+	uint32_t readers = DEFAULT_PIPEHERD_READERS, method;
+	uint64_t rounds[PIPEHERD_BCAST_MAX];
+	pid_t pids[PIPE_HERD_MAX];
+	size_t i, j, idx;
+	int rc = EXIT_SUCCESS;
+	bool available[PIPEHERD_BCAST_MAX];
+
+	if (!stress_get_setting("pipeherd-readers", &readers)) {
+		if (g_opt_flags & OPT_FLAGS_MAXIMIZE)
+			readers = MAX_PIPEHERD_READERS;
+		if (g_opt_flags & OPT_FLAGS_MINIMIZE)
+			readers = MIN_PIPEHERD_READERS;
+	}
+
+	bcast = (stress_pipeherd_bcast_t *)stress_mmap_populate(NULL, sizeof(*bcast),
+		PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+	if (bcast == MAP_FAILED) {
+		pr_inf_skip("%s: failed to mmap %zu bytes, skipping stressor\n",
+			args->name, sizeof(*bcast));
+		return EXIT_NO_RESOURCE;
+	}
+	stress_set_vma_anon_name(bcast, sizeof(*bcast), "broadcast-state");
+	hists = (stress_latency_hist_t *)calloc(PIPEHERD_BCAST_MAX * 2, sizeof(*hists));
+	if (!hists) {
+		pr_inf_skip("%s: failed to allocate latency histograms, skipping stressor\n",
+			args->name);
+		(void)munmap((void *)bcast, sizeof(*bcast));
+		return EXIT_NO_RESOURCE;
+	}
+	for (i = 0; i < PIPEHERD_BCAST_MAX * 2; i++)
+		stress_latency_hist_init(&hists[i]);
+	(void)shim_memset(rounds, 0, sizeof(rounds));
+	(void)shim_memset(available, 0, sizeof(available));
+
+	fds.efd_sem = -1;
+	fds.efd_bcast = -1;
+	available[PIPEHERD_BCAST_FUTEX] = true;
+	available[PIPEHERD_BCAST_PIPE] = (pipe(fds.pipe_fds) == 0);
+#if defined(HAVE_SYS_EVENTFD_H) &&	\
+    defined(HAVE_EVENTFD) &&		\
+    defined(EFD_SEMAPHORE)
+	fds.efd_sem = eventfd(0, EFD_SEMAPHORE);
+	available[PIPEHERD_BCAST_EVENTFD] = (fds.efd_sem >= 0);
+	fds.efd_bcast = eventfd(0, 0);
+#if defined(HAVE_SYS_EPOLL_H) &&	\
+    defined(HAVE_EPOLL_CREATE)
+	available[PIPEHERD_BCAST_EPOLL] = (fds.efd_bcast >= 0);
+#endif
+#endif
+	if ((pipeherd_broadcast != PIPEHERD_BCAST_ALL) && !available[pipeherd_broadcast]) {
+		if (args->instance == 0)
+			pr_inf_skip("%s: %s broadcast wake ups are not available, skipping stressor\n",
+				args->name, stress_pipeherd_broadcasts[pipeherd_broadcast]);
+		rc = EXIT_NO_RESOURCE;
+		goto close_fds;
+	}
+
+	for (i = 0; i < PIPE_HERD_MAX; i++)
+		pids[i] = -1;
+
+	stress_set_proc_state(args->name, STRESS_STATE_SYNC_WAIT);
+	stress_sync_start_wait(args);
+	stress_set_proc_state(args->name, STRESS_STATE_RUN);
+
+	for (i = 0; i < readers; i++) {
+		pids[i] = fork();
+		if (pids[i] == 0) {
+			stress_parent_died_alarm();
+			(void)sched_settings_apply(true);
+			stress_pipeherd_bcast_reader(bcast, &fds, readers, i);
+			_exit(EXIT_SUCCESS);
+		} else if (pids[i] < 0) {
+			pr_inf_skip("%s: fork failed, errno=%d (%s), skipping stressor\n",
+				args->name, errno, strerror(errno));
+			rc = EXIT_NO_RESOURCE;
+			goto reap;
+		}
+	}
+
+	method = PIPEHERD_BCAST_ALL;
+	do {
+		uint64_t t_write, t_first = UINT64_MAX, t_last = 0;
+		uint64_t val;
+
+		/* pick the wake method, all cycles through the available methods */
+		if (pipeherd_broadcast == PIPEHERD_BCAST_ALL) {
+			do {
+				method = (method + 1) % PIPEHERD_BCAST_MAX;
+			} while (!available[method]);
+		} else {
+			method = (uint32_t)pipeherd_broadcast;
+		}
+
+		/* start a new round and wait for the readers to block */
+		bcast->method = method;
+		__atomic_store_n(&bcast->ready, 0, __ATOMIC_SEQ_CST);
+		__atomic_store_n(&bcast->done, 0, __ATOMIC_SEQ_CST);
+		(void)__atomic_add_fetch(&bcast->gen, 1, __ATOMIC_SEQ_CST);
+		(void)shim_futex_wake(&bcast->gen, INT_MAX);
+		if (!stress_pipeherd_bcast_wait(args, &bcast->ready, readers))
+			break;
+		/* give the last ready reader time to block */
+		(void)shim_usleep(20);
+
+		t_write = stress_latency_now();
+		if (stress_pipeherd_bcast_write(bcast, &fds, readers, method) < 0) {
+			pr_fail("%s: %s broadcast wake up failed, errno=%d (%s)\n",
+				args->name, stress_pipeherd_broadcasts[method],
+				errno, strerror(errno));
+			rc = EXIT_FAILURE;
+			break;
+		}
+		if (!stress_pipeherd_bcast_wait(args, &bcast->done, readers))
+			break;
+		if (method == PIPEHERD_BCAST_EPOLL)
+			VOID_RET(ssize_t, read(fds.efd_bcast, &val, sizeof(val)));
+
+		for (i = 0; i < readers; i++) {
+			const uint64_t t = bcast->t_wake[i];
+
+			if (t < t_first)
+				t_first = t;
+			if (t > t_last)
+				t_last = t;
+		}
+		stress_latency_hist_record(&hists[(method * 2) + PIPEHERD_WAKE_FIRST],
+			(t_first > t_write) ? t_first - t_write : 0);
+		stress_latency_hist_record(&hists[(method * 2) + PIPEHERD_WAKE_LAST],
+			(t_last > t_write) ? t_last - t_write : 0);
+		rounds[method]++;
+		stress_bogo_inc(args);
+	} while (stress_continue(args));
+
+reap:
+	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
+	for (i = 0; i < readers; i++) {
+		if (pids[i] > 0)
+			(void)stress_kill_pid_wait(pids[i], NULL);
+	}
+
+	if (args->instance == 0)
+		pr_inf("%s: %" PRIu32 " readers, wake up latency in usec, "
+			"first p50, p99, last p50, p99:\n", args->name, readers);
+	for (idx = 0, i = 1; i < PIPEHERD_BCAST_MAX; i++) {
+		double lat[2][2];
+
+		if (!rounds[i])
+			continue;
+		for (j = 0; j < 2; j++) {
+			const stress_latency_hist_t *hist = &hists[(i * 2) + j];
+			char desc[64];
+
+			lat[j][0] = (double)stress_latency_hist_percentile(hist, 50.0) / 1000.0;
+			lat[j][1] = (double)stress_latency_hist_percentile(hist, 99.0) / 1000.0;
+			(void)snprintf(desc, sizeof(desc), "%s %s wake p50 usec",
+				stress_pipeherd_broadcasts[i], wake_names[j]);
+			stress_metrics_set(args, idx++, desc, lat[j][0], STRESS_METRIC_GEOMETRIC_MEAN);
+			(void)snprintf(desc, sizeof(desc), "%s %s wake p99 usec",
+				stress_pipeherd_broadcasts[i], wake_names[j]);
+			stress_metrics_set(args, idx++, desc, lat[j][1], STRESS_METRIC_GEOMETRIC_MEAN);
+		}
+		if (args->instance == 0)
+			pr_inf("%s: %-8s %10.2f %10.2f %10.2f %10.2f\n",
+				args->name, stress_pipeherd_broadcasts[i],
+				lat[0][0], lat[0][1], lat[1][0], lat[1][1]);
+	}
+
+close_fds:
+	if (available[PIPEHERD_BCAST_PIPE]) {
+		(void)close(fds.pipe_fds[0]);
+		(void)close(fds.pipe_fds[1]);
+	}
+	if (fds.efd_sem >= 0)
+		(void)close(fds.efd_sem);
+	if (fds.efd_bcast >= 0)
+		(void)close(fds.efd_bcast);
+	free(hists);
+	(void)munmap((void *)bcast, sizeof(*bcast));
+
+	return rc;
+}
+#endif
+
 /*
  *  stress_pipeherd
  *	stress by heavy pipe I/O
@@ -89,6 +483,18 @@ static int stress_pipeherd(stress_args_t *args)
 	struct rusage usage;
 	double t1, t2;
 #endif
+	size_t pipeherd_broadcast;
+
+	if (stress_get_setting("pipeherd-broadcast", &pipeherd_broadcast)) {
+#if defined(HAVE_PIPEHERD_BROADCAST)
+		return stress_pipeherd_broadcast(args, pipeherd_broadcast);
+#else
+		if (args->instance == 0)
+			pr_inf_skip("%s: broadcast wake ups are not implemented on this "
+				"system, skipping stressor\n", args->name);
+		return EXIT_NOT_IMPLEMENTED;
+#endif
+	}
 
 	if (!stress_get_setting("pipeherd-yield", &pipeherd_yield)) {
 		if (g_opt_flags & OPT_FLAGS_AGGRESSIVE)
@@ -215,6 +621,8 @@ static int stress_pipeherd(stress_args_t *args)
 }
 
 static const stress_opt_t opts[] = {
+	{ OPT_pipeherd_broadcast, "pipeherd-broadcast", TYPE_ID_SIZE_T_METHOD, 0, 0, stress_pipeherd_broadcast_method },
+	{ OPT_pipeherd_readers, "pipeherd-readers", TYPE_ID_UINT32, MIN_PIPEHERD_READERS, MAX_PIPEHERD_READERS, NULL },
 	{ OPT_pipeherd_yield, "pipeherd-yield", TYPE_ID_BOOL, 0, 1, NULL },
 	END_OPT,
 };
@@ -224,5 +632,6 @@ const stressor_info_t stress_pipeherd_info = {
 	.class = CLASS_PIPE_IO | CLASS_MEMORY | CLASS_OS | CLASS_IPC,
 	.opts = opts,
 	.verify = VERIFY_ALWAYS,
+	.metrics_max = 16,
 	.help = help
 };
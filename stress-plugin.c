@@ -17,7 +17,10 @@
  *
  */
 #include "stress-ng.h"
+#include "core-builtin.h"
 #include "core-killpid.h"
+#include "core-latency.h"
+#include "stress-plugin.h"
 
 #if defined(HAVE_LINK_H)
 #include <link.h>
@@ -42,7 +45,10 @@ typedef int (*stress_plugin_func)(void);
 
 typedef struct {
 	const char *name;
-	stress_plugin_func func;
+	stress_plugin_func func;		/* legacy function, NULL for kernels */
+	const stress_plugin_kernel_t *kernel;	/* versioned kernel, NULL for legacy */
+	stress_plugin_args_t pargs;		/* kernel args, per process */
+	bool initialized;			/* kernel init succeeded */
 } stress_plugin_method_info_t;
 
 static stress_plugin_method_info_t *stress_plugin_methods;
@@ -99,6 +105,7 @@ static const sig_report_t sig_report[] = {
 #endif
 
 static uint64_t *sig_count;
+static stress_latency_hist_t *plugin_hists;	/* per method run latency, shared */
 
 static int stress_plugin_supported(const char *name)
 {
@@ -128,19 +135,192 @@ static void MLOCKED_TEXT NORETURN stress_sig_handler(int signum)
 	_exit(1);
 }
 
-static int stress_plugin_method_all(void)
+#if defined(SIGALRM)
+/*
+ *  stress_sigalrm_handler()
+ *	end of run, stop after the current call so that
+ *	plugin kernels can be torn down by their fini function
+ */
+static void MLOCKED_TEXT stress_sigalrm_handler(int signum)
 {
-	register size_t i;
-	register int ret = 0;
+	if (signum < MAX_SIGS)
+		sig_count[signum]++;
 
-	for (i = 1; LIKELY(stress_continue_flag() && (i < stress_plugin_methods_num)); i++) {
-		ret = stress_plugin_methods[i].func();
-		if (ret)
-			break;
+	stress_continue_set_flag(false);
+}
+#endif
+
+/*
+ *  stress_plugin_metrics_set()
+ *	plugin ABI metrics_set callback, plugins can set metrics
+ *	0..STRESS_PLUGIN_METRICS_MAX - 1
+ */
+static int stress_plugin_metrics_set(
+	stress_plugin_args_t *pargs,
+	const size_t idx,
+	const char *description,
+	const double value,
+	const int mean_type)
+{
+	stress_args_t *args = (stress_args_t *)pargs->host;
+
+	if ((idx >= STRESS_PLUGIN_METRICS_MAX) || !description)
+		return -1;
+	if ((mean_type < STRESS_METRIC_GEOMETRIC_MEAN) || (mean_type > STRESS_METRIC_MAXIMUM))
+		return -1;
+	stress_metrics_set_const_check(args, idx, (char *)description, false, value, mean_type);
+	return 0;
+}
+
+/*
+ *  stress_plugin_keep_running()
+ *	plugin ABI keep_running callback
+ */
+static int stress_plugin_keep_running(stress_plugin_args_t *pargs)
+{
+	return stress_continue((stress_args_t *)pargs->host);
+}
+
+/*
+ *  stress_plugin_method_init()
+ *	set up the args of a kernel and call its init function,
+ *	legacy functions need no set-up
+ */
+static int stress_plugin_method_init(stress_args_t *args, stress_plugin_method_info_t *method)
+{
+	const stress_plugin_kernel_t *kernel = method->kernel;
+	stress_plugin_args_t *pargs = &method->pargs;
+
+	if (!kernel)
+		return 0;
+
+	(void)shim_memset(pargs, 0, sizeof(*pargs));
+	pargs->abi_version = STRESS_PLUGIN_ABI_VERSION;
+	pargs->instance = args->instance;
+	pargs->instances = args->instances;
+	pargs->ops_per_call = kernel->ops_per_call ? kernel->ops_per_call : 1;
+	pargs->metrics_set = stress_plugin_metrics_set;
+	pargs->keep_running = stress_plugin_keep_running;
+	pargs->host = (void *)args;
+
+	if (kernel->init && kernel->init(pargs)) {
+		pr_inf_skip("%s: plugin kernel '%s' init failed, skipping stressor\n",
+			args->name, method->name);
+		return -1;
+	}
+	method->initialized = true;
+	return 0;
+}
+
+/*
+ *  stress_plugin_method_fini()
+ *	call the fini function of an initialized kernel
+ */
+static void stress_plugin_method_fini(stress_plugin_method_info_t *method)
+{
+	if (method->kernel && method->initialized && method->kernel->fini)
+		method->kernel->fini(&method->pargs);
+	method->initialized = false;
+}
+
+/*
+ *  stress_plugin_method_run()
+ *	run a legacy function or a batch of a kernel and account the
+ *	bogo-ops, returns non-zero on failure
+ */
+static int stress_plugin_method_run(stress_args_t *args, const size_t idx)
+{
+	stress_plugin_method_info_t *method = &stress_plugin_methods[idx];
+	const stress_plugin_kernel_t *kernel = method->kernel;
+	int ret;
+
+	if (!kernel) {
+		ret = method->func();
+		if (LIKELY(!ret))
+			stress_bogo_inc(args);
+		return ret;
 	}
+
+	if (plugin_hists && (kernel->flags & STRESS_PLUGIN_F_LATENCY)) {
+		const uint64_t t = stress_latency_now();
+		uint64_t ns;
+
+		ret = kernel->run(&method->pargs);
+		ns = stress_latency_now() - t;
+		stress_latency_hist_record(&plugin_hists[idx], ns);
+		stress_latency_record(args, 0, ns);
+	} else {
+		ret = kernel->run(&method->pargs);
+	}
+	if (LIKELY(!ret))
+		stress_bogo_add(args, method->pargs.ops_per_call);
 	return ret;
 }
 
+/*
+ *  stress_plugin_child()
+ *	run the plugin method(s) in a child process, method 0
+ *	runs all the methods one by one
+ */
+static int stress_plugin_child(stress_args_t *args, const size_t plugin_method)
+{
+	const size_t first = plugin_method ? plugin_method : 1;
+	const size_t last = plugin_method ? plugin_method + 1 : stress_plugin_methods_num;
+	size_t i;
+	int rc = EXIT_SUCCESS;
+
+	for (i = first; i < last; i++) {
+		if (stress_plugin_method_init(args, &stress_plugin_methods[i]) < 0) {
+			rc = EXIT_NO_RESOURCE;
+			goto fini;
+		}
+	}
+
+	do {
+		for (i = first; LIKELY(stress_continue_flag() && (i < last)); i++) {
+			if (stress_plugin_method_run(args, i))
+				goto fini;
+		}
+	} while (stress_continue(args));
+
+fini:
+	for (i = first; i < last; i++)
+		stress_plugin_method_fini(&stress_plugin_methods[i]);
+	return rc;
+}
+
+/*
+ *  stress_plugin_latency_metrics()
+ *	report the per call latency of kernels that are timed
+ */
+static void stress_plugin_latency_metrics(stress_args_t *args)
+{
+	size_t i, idx = STRESS_PLUGIN_METRICS_MAX;
+
+	if (!plugin_hists)
+		return;
+
+	for (i = 1; (i < stress_plugin_methods_num) && (idx + 3 <= STRESS_MISC_METRICS_MAX); i++) {
+		const stress_latency_hist_t *hist = &plugin_hists[i];
+		char msg[64];
+
+		if (!hist->count)
+			continue;
+		(void)snprintf(msg, sizeof(msg), "%s nanosecs per call (mean)",
+			stress_plugin_methods[i].name);
+		stress_metrics_set(args, idx++, msg,
+			stress_latency_hist_mean(hist), STRESS_METRIC_HARMONIC_MEAN);
+		(void)snprintf(msg, sizeof(msg), "%s nanosecs per call (p50)",
+			stress_plugin_methods[i].name);
+		stress_metrics_set(args, idx++, msg,
+			(double)stress_latency_hist_percentile(hist, 50.0), STRESS_METRIC_HARMONIC_MEAN);
+		(void)snprintf(msg, sizeof(msg), "%s nanosecs per call (p99)",
+			stress_plugin_methods[i].name);
+		stress_metrics_set(args, idx++, msg,
+			(double)stress_latency_hist_percentile(hist, 99.0), STRESS_METRIC_HARMONIC_MEAN);
+	}
+}
+
 /*
  *  stress_plugin_so()
  *     set default plugin shared object file
@@ -152,7 +332,8 @@ static void stress_plugin_so(const char *opt_name, const char *opt_arg, stress_t
 	ElfW(Dyn) *section;
 	char * strtab = NULL;
 	unsigned long int symentries = 0;
-	size_t i, size, n_funcs;
+	size_t i, size, n_funcs, n_kernels = 0;
+	const stress_plugin_kernel_t *kernels;
 
 	stress_plugin_methods = NULL;
 	stress_plugin_methods_num = 0;
@@ -167,6 +348,25 @@ static void stress_plugin_so(const char *opt_name, const char *opt_arg, stress_t
 		longjmp(g_error_env, 1);
 	}
 
+	/* versioned plugin kernels, optional */
+	kernels = (const stress_plugin_kernel_t *)dlsym(stress_plugin_so_dl, STRESS_PLUGIN_KERNELS_SYMBOL);
+	if (kernels) {
+		for (n_kernels = 0; kernels[n_kernels].name; n_kernels++) {
+			const stress_plugin_kernel_t *kernel = &kernels[n_kernels];
+
+			if (kernel->abi_version != STRESS_PLUGIN_ABI_VERSION) {
+				fprintf(stderr, "plugin-so: kernel %s has ABI version %" PRIu32
+					", expecting version %d\n", kernel->name,
+					kernel->abi_version, STRESS_PLUGIN_ABI_VERSION);
+				longjmp(g_error_env, 1);
+			}
+			if (!kernel->run) {
+				fprintf(stderr, "plugin-so: kernel %s has no run function\n", kernel->name);
+				longjmp(g_error_env, 1);
+			}
+		}
+	}
+
 	dlinfo(stress_plugin_so_dl, RTLD_DI_LINKMAP, &map);
 
 	for (section = map->l_ld; section->d_tag != DT_NULL; ++section) {
@@ -206,22 +406,28 @@ static void stress_plugin_so(const char *opt_name, const char *opt_arg, stress_t
 				n_funcs++;
 		}
 	}
-	if (!n_funcs) {
-		fprintf(stderr, "plugin-so: cannot find any function symbols in file %s\n", opt_arg);
+	if (!n_funcs && !n_kernels) {
+		fprintf(stderr, "plugin-so: cannot find any function symbols or %s kernels in file %s\n",
+			STRESS_PLUGIN_KERNELS_SYMBOL, opt_arg);
 		longjmp(g_error_env, 1);
 	}
 
-	stress_plugin_methods = (stress_plugin_method_info_t *)calloc(n_funcs + 1, sizeof(*stress_plugin_methods));
+	stress_plugin_methods = (stress_plugin_method_info_t *)calloc(n_kernels + n_funcs + 1, sizeof(*stress_plugin_methods));
 	if (!stress_plugin_methods) {
-		fprintf(stderr, "plugin-so: cannot allocate %zu plugin methods\n", n_funcs);
+		fprintf(stderr, "plugin-so: cannot allocate %zu plugin methods\n", n_kernels + n_funcs);
 		longjmp(g_error_env, 1);
 	}
 
 	n_funcs = 0;
 	stress_plugin_methods[n_funcs].name = "all";
-	stress_plugin_methods[n_funcs].func = stress_plugin_method_all;
 	n_funcs++;
 
+	for (i = 0; i < n_kernels; i++) {
+		stress_plugin_methods[n_funcs].name = kernels[i].name;
+		stress_plugin_methods[n_funcs].kernel = &kernels[i];
+		n_funcs++;
+	}
+
 	for (i = 0; i < size / symentries; i++) {
 		if (ELF64_ST_TYPE(symtab[i].st_info) == STT_FUNC) {
 			const Elf64_Sym *sym = &symtab[i];
@@ -250,8 +456,8 @@ static int stress_plugin(stress_args_t *args)
 	int rc;
 	size_t i;
 	size_t plugin_method = 0;
-	stress_plugin_func func;
 	const size_t sig_count_size = MAX_SIGS * sizeof(*sig_count);
+	size_t hists_size = 0;
 	bool report_sigs;
 
 	if (!stress_plugin_so_dl) {
@@ -287,7 +493,31 @@ static int stress_plugin(stress_args_t *args)
 	}
 	stress_set_vma_anon_name(sig_count, sig_count_size, "signal-counters");
 
-	func = stress_plugin_methods[plugin_method].func;
+	plugin_hists = NULL;
+	for (i = 1; i < stress_plugin_methods_num; i++) {
+		const stress_plugin_kernel_t *kernel = stress_plugin_methods[i].kernel;
+
+		if (kernel && (kernel->flags & STRESS_PLUGIN_F_LATENCY)) {
+			hists_size = stress_plugin_methods_num * sizeof(*plugin_hists);
+			break;
+		}
+	}
+	if (hists_size) {
+		plugin_hists = (stress_latency_hist_t *)mmap(NULL, hists_size,
+			PROT_READ | PROT_WRITE, MAP_ANONYMOUS | MAP_SHARED, -1, 0);
+		if (plugin_hists == MAP_FAILED) {
+			pr_inf("%s: cannot mmap %zu bytes for call latency histograms, "
+				"errno=%d (%s), disabling call latency metrics\n",
+				args->name, hists_size, errno, strerror(errno));
+			plugin_hists = NULL;
+		} else {
+			stress_set_vma_anon_name(plugin_hists, hists_size, "latency-histograms");
+			for (i = 0; i < stress_plugin_methods_num; i++)
+				stress_latency_hist_init(&plugin_hists[i]);
+		}
+	}
+	stress_latency_set_description(args, 0, "plugin call");
+
 	if (args->instance == 0)
 		pr_dbg("%s: exercising plugin method '%s'\n", args->name, stress_plugin_methods[plugin_method].name);
 
@@ -324,16 +554,15 @@ again:
 				if (stress_sighandler(args->name, sig_report[i].signum, stress_sig_handler, NULL) < 0)
 					_exit(EXIT_FAILURE);
 			}
+#if defined(SIGALRM)
+			if (stress_sighandler(args->name, SIGALRM, stress_sigalrm_handler, NULL) < 0)
+				_exit(EXIT_FAILURE);
+#endif
 
 			/* Disable stack smashing messages */
 			stress_set_stack_smash_check_flag(false);
 
-			do {
-				if (func())
-					break;
-				stress_bogo_inc(args);
-			} while (stress_continue(args));
-			_exit(0);
+			_exit(stress_plugin_child(args, plugin_method));
 		}
 		if (pid > 0) {
 			int ret, status;
@@ -345,12 +574,17 @@ again:
 						args->name, errno, strerror(errno));
 				stress_force_killed_bogo(args);
 				(void)stress_kill_pid_wait(pid, NULL);
+			} else if (WIFEXITED(status) && (WEXITSTATUS(status) == EXIT_NO_RESOURCE)) {
+				/* kernel init failure, no point in retrying */
+				rc = EXIT_NO_RESOURCE;
+				goto err;
 			}
 		}
 	} while (stress_continue(args));
 
 finish:
 	rc = EXIT_SUCCESS;
+	stress_plugin_latency_metrics(args);
 
 	for (report_sigs = false, i = 0; i < MAX_SIGS; i++) {
 		if (sig_count[i] && stress_plugin_report_signum((int)i)) {
@@ -374,6 +608,8 @@ err:
 	free(stress_plugin_methods);
 	(void)dlclose(stress_plugin_so_dl);
 	(void)munmap((void *)sig_count, sig_count_size);
+	if (plugin_hists)
+		(void)munmap((void *)plugin_hists, hists_size);
 	return rc;
 }
 
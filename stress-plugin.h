@@ -0,0 +1,86 @@
+/*
+ * Copyright (C) 2025      Colin Ian King.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+#ifndef STRESS_PLUGIN_H
+#define STRESS_PLUGIN_H
+
+/*
+ *  stress-ng plugin kernel ABI. This header is self contained so that
+ *  it can be included by plugin shared objects built outside of the
+ *  stress-ng source tree. A plugin exports a table of kernels named
+ *  STRESS_PLUGIN_KERNELS_SYMBOL terminated by an entry with a NULL
+ *  name, for example:
+ *
+ *	static int example_run(stress_plugin_args_t *pargs)
+ *	{
+ *		... do pargs->ops_per_call operations of work ...
+ *		return 0;
+ *	}
+ *
+ *	const stress_plugin_kernel_t stress_plugin_kernels[] = {
+ *		{ STRESS_PLUGIN_ABI_VERSION, "example", 1000, 0,
+ *		  NULL, example_run, NULL },
+ *		{ 0, NULL, 0, 0, NULL, NULL, NULL },
+ *	};
+ *
+ *  Plain int stress_name(void) functions are still supported as the
+ *  unversioned legacy plugin interface.
+ */
+#include <stddef.h>
+#include <stdint.h>
+
+#define STRESS_PLUGIN_ABI_VERSION	(1)
+#define STRESS_PLUGIN_KERNELS_SYMBOL	"stress_plugin_kernels"
+
+/* kernel flags */
+#define STRESS_PLUGIN_F_LATENCY		(0x00000001U)	/* time each run call */
+
+/* metric mean types, match the stress-ng STRESS_METRIC_* types */
+#define STRESS_PLUGIN_METRIC_GEOMETRIC_MEAN	(1)
+#define STRESS_PLUGIN_METRIC_HARMONIC_MEAN	(2)
+#define STRESS_PLUGIN_METRIC_TOTAL		(3)
+#define STRESS_PLUGIN_METRIC_MAXIMUM		(4)
+
+/* metric indexes available to a plugin, 0..STRESS_PLUGIN_METRICS_MAX - 1 */
+#define STRESS_PLUGIN_METRICS_MAX	(16)
+
+typedef struct stress_plugin_args {
+	uint32_t abi_version;		/* ABI version of stress-ng */
+	uint32_t instance;		/* stressor instance number */
+	uint32_t instances;		/* number of stressor instances */
+	uint64_t ops_per_call;		/* bogo-ops accounted per run call */
+	void *priv;			/* plugin private data, e.g. set by init */
+	/* set metric idx to value, returns 0 on success, -1 on a bad idx */
+	int (*metrics_set)(struct stress_plugin_args *pargs, const size_t idx,
+		const char *description, const double value, const int mean_type);
+	/* returns non-zero while the kernel should keep running */
+	int (*keep_running)(struct stress_plugin_args *pargs);
+	void *host;			/* stress-ng private, do not touch */
+} stress_plugin_args_t;
+
+typedef struct stress_plugin_kernel {
+	uint32_t abi_version;		/* must be STRESS_PLUGIN_ABI_VERSION */
+	const char *name;		/* kernel name, used by --plugin-method */
+	uint64_t ops_per_call;		/* bogo-ops per run call, 0 = 1 */
+	uint32_t flags;			/* STRESS_PLUGIN_F_* flags */
+	int (*init)(stress_plugin_args_t *pargs);	/* set-up, NULL = none */
+	int (*run)(stress_plugin_args_t *pargs);	/* run a batch, 0 = success */
+	void (*fini)(stress_plugin_args_t *pargs);	/* tear-down, NULL = none */
+} stress_plugin_kernel_t;
+
+#endif
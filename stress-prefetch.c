@@ -36,11 +36,17 @@
 
 #define STRESS_PTRU64_ADD(ptru64, inc)	(uint64_t *)(((uintptr_t)(ptru64)) + inc)
 
+#define STRESS_PREFETCH_SWEEP_LEVELS	(4)		/* L1, L2, L3 and memory */
+#define STRESS_PREFETCH_SWEEP_MEM_MIN	(16 * MB)	/* minimum memory level size */
+#define STRESS_PREFETCH_SWEEP_MEM_MAX	(256 * MB)	/* maximum memory level size */
+#define STRESS_PREFETCH_SWEEP_TIME	(0.005)		/* minimum secs per measurement */
+
 static const stress_help_t help[] = {
 	{ NULL,	"prefetch N",		"start N workers exercising memory prefetching " },
 	{ NULL,	"prefetch-l3-size N",	"specify the L3 cache size of the CPU" },
 	{ NULL, "prefetch-method M",	"specify the prefetch method" },
 	{ NULL,	"prefetch-ops N",	"stop after N bogo prefetching operations" },
+	{ NULL,	"prefetch-sweep",	"report read rates over prefetch distance and stride for all methods" },
 	{ NULL,	NULL,			NULL }
 };
 
@@ -52,6 +58,21 @@ typedef struct {
 	double 	rate;
 } stress_prefetch_info_t;
 
+typedef struct {
+	size_t size;			/* working set size in bytes */
+	char name[8];			/* cache level name */
+} stress_prefetch_level_t;
+
+/* prefetch distances in units of the stride, 0 = no prefetch */
+static const size_t prefetch_sweep_distances[] = {
+	0, 1, 2, 4, 8, 16, 32, 64, 128
+};
+
+/* read strides in bytes */
+static const size_t prefetch_sweep_strides[] = {
+	64, 128, 256
+};
+
 typedef struct {
 	char *name;
 	int method;
@@ -355,6 +376,241 @@ static uint64_t stress_prefetch_data_set(uint64_t *l3_data, const uint64_t *l3_d
 	return checksum;
 }
 
+#define STRESS_PREFETCH_SWEEP_LOOP(func)				\
+	while (ptr < end) {						\
+		func(STRESS_PTRU64_ADD(ptr, distance));			\
+		sum += *(ptr + 0);					\
+		sum += *(ptr + 1);					\
+		sum += *(ptr + 2);					\
+		sum += *(ptr + 3);					\
+		sum += *(ptr + 4);					\
+		sum += *(ptr + 5);					\
+		sum += *(ptr + 6);					\
+		sum += *(ptr + 7);					\
+		ptr = STRESS_PTRU64_ADD(ptr, stride);			\
+	}
+
+/*
+ *  stress_prefetch_sweep_pass()
+ *	read a cache line every stride bytes from buf to end, prefetching
+ *	distance bytes ahead of the current read position
+ */
+static uint64_t OPTIMIZE3 NOINLINE stress_prefetch_sweep_pass(
+	const int method,
+	const uint64_t *buf,
+	const uint64_t *end,
+	const size_t stride,
+	const size_t distance)
+{
+	register const uint64_t *ptr = buf;
+	register uint64_t sum = 0;
+
+	if (distance == 0) {
+		STRESS_PREFETCH_SWEEP_LOOP(stress_prefetch_none);
+		return sum;
+	}
+
+	switch (method) {
+	default:
+	case STRESS_PREFETCH_BUILTIN:
+		STRESS_PREFETCH_SWEEP_LOOP(stress_prefetch_builtin);
+		break;
+	case STRESS_PREFETCH_BUILTIN_L0:
+		STRESS_PREFETCH_SWEEP_LOOP(stress_prefetch_builtin_locality0);
+		break;
+	case STRESS_PREFETCH_BUILTIN_L3:
+		STRESS_PREFETCH_SWEEP_LOOP(stress_prefetch_builtin_locality3);
+		break;
+#if defined(HAVE_ASM_X86_PREFETCHT0)
+	case STRESS_PREFETCH_X86_PREFETCHT0:
+		STRESS_PREFETCH_SWEEP_LOOP(stress_asm_x86_prefetcht0);
+		break;
+#endif
+#if defined(HAVE_ASM_X86_PREFETCHT1)
+	case STRESS_PREFETCH_X86_PREFETCHT1:
+		STRESS_PREFETCH_SWEEP_LOOP(stress_asm_x86_prefetcht1);
+		break;
+#endif
+#if defined(HAVE_ASM_X86_PREFETCHT2)
+	case STRESS_PREFETCH_X86_PREFETCHT2:
+		STRESS_PREFETCH_SWEEP_LOOP(stress_asm_x86_prefetcht2);
+		break;
+#endif
+#if defined(HAVE_ASM_X86_PREFETCHNTA)
+	case STRESS_PREFETCH_X86_PREFETCHNTA:
+		STRESS_PREFETCH_SWEEP_LOOP(stress_asm_x86_prefetchnta);
+		break;
+#endif
+#if defined(HAVE_ASM_PPC64_DCBT)
+	case STRESS_PREFETCH_PPC64_DCBT:
+		STRESS_PREFETCH_SWEEP_LOOP(stress_asm_ppc64_dcbt);
+		break;
+#endif
+#if defined(HAVE_ASM_PPC64_DCBTST)
+	case STRESS_PREFETCH_PPC64_DCBTST:
+		STRESS_PREFETCH_SWEEP_LOOP(stress_asm_ppc64_dcbtst);
+		break;
+#endif
+#if defined(HAVE_ASM_ARM_PRFM)
+	case STRESS_PREFETCH_ARM_PRFM_PLDL1KEEP:
+		STRESS_PREFETCH_SWEEP_LOOP(stress_asm_arm_prfm_pldl1keep);
+		break;
+	case STRESS_PREFETCH_ARM_PRFM_PLDL2KEEP:
+		STRESS_PREFETCH_SWEEP_LOOP(stress_asm_arm_prfm_pldl2keep);
+		break;
+	case STRESS_PREFETCH_ARM_PRFM_PLDL3KEEP:
+		STRESS_PREFETCH_SWEEP_LOOP(stress_asm_arm_prfm_pldl3keep);
+		break;
+	case STRESS_PREFETCH_ARM_PRFM_PLDL1STRM:
+		STRESS_PREFETCH_SWEEP_LOOP(stress_asm_arm_prfm_pldl1strm);
+		break;
+	case STRESS_PREFETCH_ARM_PRFM_PLDL2STRM:
+		STRESS_PREFETCH_SWEEP_LOOP(stress_asm_arm_prfm_pldl2strm);
+		break;
+	case STRESS_PREFETCH_ARM_PRFM_PLDL3STRM:
+		STRESS_PREFETCH_SWEEP_LOOP(stress_asm_arm_prfm_pldl3strm);
+		break;
+#endif
+	}
+	return sum;
+}
+
+/*
+ *  stress_prefetch_sweep_levels()
+ *	determine the working set sizes for the L1, L2, L3 cache
+ *	and memory levels, cache working sets are half the cache
+ *	size so they stay cache resident, returns number of levels
+ */
+static size_t stress_prefetch_sweep_levels(stress_prefetch_level_t *levels)
+{
+	size_t n = 0, largest = 0;
+#if defined(__linux__)
+	stress_cpu_cache_cpus_t *cpu_caches;
+
+	cpu_caches = stress_cpu_cache_get_all_details();
+	if (cpu_caches) {
+		uint16_t level;
+
+		for (level = 1; level <= 3; level++) {
+			const stress_cpu_cache_t *cache = stress_cpu_cache_get(cpu_caches, level);
+
+			if (!cache || (cache->size < 2 * KB))
+				continue;
+			levels[n].size = (size_t)cache->size / 2;
+			(void)snprintf(levels[n].name, sizeof(levels[n].name), "L%" PRIu16, level);
+			if ((size_t)cache->size > largest)
+				largest = (size_t)cache->size;
+			n++;
+		}
+		stress_free_cpu_caches(cpu_caches);
+	}
+#endif
+	if (largest == 0)
+		largest = DEFAULT_PREFETCH_L3_SIZE;
+	largest *= 4;
+	if (largest < STRESS_PREFETCH_SWEEP_MEM_MIN)
+		largest = STRESS_PREFETCH_SWEEP_MEM_MIN;
+	if (largest > STRESS_PREFETCH_SWEEP_MEM_MAX)
+		largest = STRESS_PREFETCH_SWEEP_MEM_MAX;
+	levels[n].size = largest;
+	(void)shim_strscpy(levels[n].name, "mem", sizeof(levels[n].name));
+	n++;
+
+	return n;
+}
+
+/*
+ *  stress_prefetch_sweep()
+ *	measure the read rate of each available prefetch method over a
+ *	range of prefetch distances and read strides for working sets
+ *	that fit in each cache level and one that spills to memory,
+ *	report the rates and the best distance per method and level
+ */
+static void stress_prefetch_sweep(stress_args_t *args)
+{
+	stress_prefetch_level_t levels[STRESS_PREFETCH_SWEEP_LEVELS];
+	const size_t n_levels = stress_prefetch_sweep_levels(levels);
+	const size_t max_distance = prefetch_sweep_distances[SIZEOF_ARRAY(prefetch_sweep_distances) - 1] *
+				    prefetch_sweep_strides[SIZEOF_ARRAY(prefetch_sweep_strides) - 1];
+	const size_t buf_size = levels[n_levels - 1].size + max_distance;
+	uint64_t *buf, sum = 0;
+	size_t m, l, s, d, len;
+	char line[256];
+
+	buf = (uint64_t *)mmap(NULL, buf_size, PROT_READ | PROT_WRITE,
+#if defined(MAP_POPULATE)
+		MAP_POPULATE |
+#endif
+		MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (buf == MAP_FAILED) {
+		pr_inf("%s: cannot allocate %zu bytes for prefetch sweep, skipping sweep\n",
+			args->name, buf_size);
+		return;
+	}
+	stress_set_vma_anon_name(buf, buf_size, "prefetch-sweep");
+	(void)stress_prefetch_data_set(buf, STRESS_PTRU64_ADD(buf, buf_size));
+
+	pr_block_begin();
+	pr_inf("%s: prefetch sweep read rates in GB per sec, distances in strides:\n", args->name);
+	len = (size_t)snprintf(line, sizeof(line), "%-15s %-5s %6s", "method", "level", "stride");
+	for (d = 0; d < SIZEOF_ARRAY(prefetch_sweep_distances); d++)
+		len += (size_t)snprintf(line + len, sizeof(line) - len, " %6zu", prefetch_sweep_distances[d]);
+	pr_inf("%s: %s\n", args->name, line);
+
+	for (m = 0; m < SIZEOF_ARRAY(prefetch_methods); m++) {
+		if (!prefetch_methods[m].available())
+			continue;
+		for (l = 0; l < n_levels; l++) {
+			const uint64_t *end = STRESS_PTRU64_ADD(buf, levels[l].size);
+			double best_rate = 0.0;
+			size_t best_distance = 0, best_stride = 0;
+
+			for (s = 0; s < SIZEOF_ARRAY(prefetch_sweep_strides); s++) {
+				const size_t stride = prefetch_sweep_strides[s];
+				const double bytes = (double)(levels[l].size / stride) * STRESS_CACHE_LINE_SIZE;
+
+				len = (size_t)snprintf(line, sizeof(line), "%-15s %-5s %6zu",
+					prefetch_methods[m].name, levels[l].name, stride);
+				for (d = 0; d < SIZEOF_ARRAY(prefetch_sweep_distances); d++) {
+					const size_t distance = prefetch_sweep_distances[d] * stride;
+					double t, duration, rate;
+					uint64_t passes = 0;
+
+					/* warm cache level sized working sets */
+					sum += stress_prefetch_sweep_pass(prefetch_methods[m].method,
+							buf, end, stride, distance);
+					t = stress_time_now();
+					do {
+						sum += stress_prefetch_sweep_pass(prefetch_methods[m].method,
+								buf, end, stride, distance);
+						passes++;
+						duration = stress_time_now() - t;
+					} while (duration < STRESS_PREFETCH_SWEEP_TIME);
+
+					rate = (duration > 0.0) ? (bytes * (double)passes) / duration : 0.0;
+					len += (size_t)snprintf(line + len, sizeof(line) - len,
+						" %6.2f", rate / (double)GB);
+					if ((distance > 0) && (rate > best_rate)) {
+						best_rate = rate;
+						best_distance = distance;
+						best_stride = stride;
+					}
+				}
+				pr_inf("%s: %s\n", args->name, line);
+				if (UNLIKELY(!stress_continue(args)))
+					goto done;
+			}
+			pr_inf("%s: %-15s %-5s best prefetch distance %zu bytes (stride %zu) @ %.2f GB per sec\n",
+				args->name, prefetch_methods[m].name, levels[l].name,
+				best_distance, best_stride, best_rate / (double)GB);
+		}
+	}
+done:
+	pr_block_end();
+	stress_uint64_put(sum);
+	(void)munmap((void *)buf, buf_size);
+}
+
 /*
  *  stress_prefetch()
  *	stress cache/memory/CPU with stream stressors
@@ -368,10 +624,12 @@ static int stress_prefetch(stress_args_t *args)
 	size_t prefetch_method = STRESS_PREFETCH_BUILTIN;
 	double best_rate, ns, non_prefetch_rate;
 	bool success = true;
+	bool prefetch_sweep = false;
 	bool check_prefetch_rate;
 	const bool verify = !!(g_opt_flags & OPT_FLAGS_VERIFY);
 
 	(void)stress_get_setting("prefetch-method", &prefetch_method);
+	(void)stress_get_setting("prefetch-sweep", &prefetch_sweep);
 
 	if (!prefetch_methods[prefetch_method].available()) {
 		(void)pr_inf("%s: prefetch-method '%s' is not available on this CPU, skipping stressor\n",
@@ -422,6 +680,9 @@ static int stress_prefetch(stress_args_t *args)
 	stress_sync_start_wait(args);
 	stress_set_proc_state(args->name, STRESS_STATE_RUN);
 
+	if (prefetch_sweep && (args->instance == 0))
+		stress_prefetch_sweep(args);
+
 	do {
 		for (i = 0; i < SIZEOF_ARRAY(prefetch_info); i++) {
 			stress_prefetch_benchmark(args, prefetch_info,
@@ -488,6 +749,7 @@ static const char *stress_prefetch_method(const size_t i)
 static const stress_opt_t opts[] = {
 	{ OPT_prefetch_l3_size,	"prefetch-l3-size", TYPE_ID_SIZE_T_BYTES_VM, MIN_PREFETCH_L3_SIZE, MAX_PREFETCH_L3_SIZE, NULL },
 	{ OPT_prefetch_method,	"prefetch-method",  TYPE_ID_SIZE_T_METHOD, 0, 0, stress_prefetch_method },
+	{ OPT_prefetch_sweep,	"prefetch-sweep",   TYPE_ID_BOOL, 0, 1, NULL },
 	END_OPT,
 };
 
@@ -496,5 +758,6 @@ const stressor_info_t stress_prefetch_info = {
 	.class = CLASS_CPU | CLASS_CPU_CACHE | CLASS_MEMORY,
 	.opts = opts,
 	.verify = VERIFY_OPTIONAL,
+	.metrics_max = 2,
 	.help = help
 };
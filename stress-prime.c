@@ -17,6 +17,9 @@
  *
  */
 #include "stress-ng.h"
+#include "core-builtin.h"
+#include "core-cpu-cache.h"
+#include "core-pthread.h"
 
 #if defined(HAVE_GMP_H)
 #include <gmp.h>
@@ -30,15 +33,20 @@
 #define STRESS_PRIME_METHOD_INC		(1)
 #define STRESS_PRIME_METHOD_PWR2	(2)
 #define STRESS_PRIME_METHOD_PWR10	(3)
+#define STRESS_PRIME_METHOD_SIEVE	(4)
+
+#define MIN_PRIME_THREADS		(1)
+#define MAX_PRIME_THREADS		(256)
 
 #define STRESS_PRIME_PROGRESS_INC_SECS	(60.0)
 
 static const stress_help_t help[] = {
 	{ NULL,	"prime N",		"start N workers that find prime numbers" },
 	{ NULL,	"prime-ops N",		"stop after N prime operations" },
-	{ NULL, "prime-method M",	"method of searching for next prime [ factorial | inc | pwr2 | pwr10 ]" },
+	{ NULL, "prime-method M",	"method of searching for next prime [ factorial | inc | pwr2 | pwr10 | sieve ]" },
 	{ NULL,	"prime-progress",	"show prime progress every 60 seconds (just first stressor instance)" },
 	{ NULL,	"prime-start N",	"value N from where to start computing primes" },
+	{ NULL,	"prime-threads N",	"number of threads used by the sieve method" },
 	{ NULL,	NULL,		 	NULL }
 };
 
@@ -47,6 +55,7 @@ static const char *stress_prime_methods[] = {
 	"inc",		/* STRESS_PRIME_METHOD_INC */
 	"pwr2",		/* STRESS_PRIME_METHOD_PWR2 */
 	"pwr10",	/* STRESS_PRIME_METHOD_PWR10 */
+	"sieve",	/* STRESS_PRIME_METHOD_SIEVE */
 };
 
 static const char *stress_prime_method(const size_t i)
@@ -58,6 +67,7 @@ static const stress_opt_t opts[] = {
 	{ OPT_prime_method,   "prime-method",   TYPE_ID_SIZE_T_METHOD, 0, 0, stress_prime_method },
 	{ OPT_prime_progress, "prime-progress", TYPE_ID_BOOL, 0, 1, NULL },
 	{ OPT_prime_start,    "prime-start",    TYPE_ID_STR, 0, 0, NULL },
+	{ OPT_prime_threads,  "prime-threads",  TYPE_ID_UINT32, MIN_PRIME_THREADS, MAX_PRIME_THREADS, NULL },
 	END_OPT,
 };
 
@@ -138,6 +148,338 @@ static int stress_prime_start(char *prime_start, mpz_t start)
 	return 0;
 }
 
+/*
+ *  Segmented Sieve of Eratosthenes, each bogo-op sieves the next
+ *  window of STRESS_PRIME_SIEVE_WINDOW integers twice, once using
+ *  L1 cache sized segments and once using L2 cache sized segments,
+ *  with the segments of the window interleaved over prime-threads
+ *  threads. Segments hold one byte per odd number.
+ */
+#define STRESS_PRIME_SIEVE_WINDOW	(1ULL << 24)
+#define STRESS_PRIME_SIEVE_LIMIT	(1ULL << 48)
+#define STRESS_PRIME_SIEVE_BASE_MAX	(1ULL << 24)	/* sqrt(STRESS_PRIME_SIEVE_LIMIT) */
+#define STRESS_PRIME_SIEVE_PI_WINDOW	(1077871)	/* primes < 2^24, including 2 */
+
+typedef struct {
+	const uint32_t *base_primes;	/* odd primes < STRESS_PRIME_SIEVE_BASE_MAX */
+	size_t n_base_primes;		/* number of base primes */
+	uint64_t lo;			/* even start of window */
+	size_t seg_size;		/* segment size in bytes */
+	size_t n_segs;			/* segments in window */
+} stress_prime_sieve_t;
+
+typedef struct {
+	const stress_prime_sieve_t *sieve; /* shared sieve window */
+	uint8_t *seg;			/* per thread segment buffer */
+	size_t first;			/* first segment */
+	size_t stride;			/* segment stride */
+	uint64_t primes;		/* primes found */
+	uint64_t segs;			/* segments sieved */
+#if defined(HAVE_LIB_PTHREAD)
+	pthread_t pthread;		/* thread handle */
+#endif
+	int ret;			/* pthread_create return */
+} stress_prime_sieve_thread_t;
+
+/*
+ *  stress_prime_sieve_base()
+ *	find the odd base primes < STRESS_PRIME_SIEVE_BASE_MAX,
+ *	returns the number of primes found
+ */
+static size_t stress_prime_sieve_base(uint8_t *odd, uint32_t *base_primes)
+{
+	const size_t n = (size_t)(STRESS_PRIME_SIEVE_BASE_MAX / 2);
+	size_t i, count = 0;
+
+	/* odd[i] represents 2 * i + 1 */
+	(void)shim_memset(odd, 1, n);
+	odd[0] = 0;
+	for (i = 1; (2 * i + 1) * (2 * i + 1) < STRESS_PRIME_SIEVE_BASE_MAX; i++) {
+		if (odd[i]) {
+			const size_t p = 2 * i + 1;
+			register size_t j;
+
+			for (j = (p * p) / 2; j < n; j += p)
+				odd[j] = 0;
+		}
+	}
+	for (i = 1; i < n; i++) {
+		if (odd[i])
+			base_primes[count++] = (uint32_t)(2 * i + 1);
+	}
+	return count;
+}
+
+/*
+ *  stress_prime_sieve_segment()
+ *	sieve the odd numbers lo, lo + 2, .. lo + 2 * (seg_size - 1)
+ *	and return the number of primes found
+ */
+static uint64_t OPTIMIZE3 stress_prime_sieve_segment(
+	const stress_prime_sieve_t *sieve,
+	uint8_t *seg,
+	const uint64_t lo)
+{
+	const size_t seg_size = sieve->seg_size;
+	const uint64_t hi = lo + 2 * (seg_size - 1);
+	register uint64_t count = 0;
+	size_t i;
+
+	(void)shim_memset(seg, 1, seg_size);
+	if (lo == 1)
+		seg[0] = 0;
+
+	for (i = 0; i < sieve->n_base_primes; i++) {
+		const uint64_t p = (uint64_t)sieve->base_primes[i];
+		register uint64_t m = p * p;
+		register size_t j;
+
+		if (m > hi)
+			break;
+		if (m < lo) {
+			m = ((lo + p - 1) / p) * p;
+			if (!(m & 1))
+				m += p;
+		}
+		for (j = (size_t)((m - lo) >> 1); j < seg_size; j += (size_t)p)
+			seg[j] = 0;
+	}
+	for (i = 0; i < seg_size; i++)
+		count += seg[i];
+	return count;
+}
+
+/*
+ *  stress_prime_sieve_thread()
+ *	sieve every stride'th segment of the window from segment first
+ */
+static void *stress_prime_sieve_thread(void *arg)
+{
+	stress_prime_sieve_thread_t *t = (stress_prime_sieve_thread_t *)arg;
+	const stress_prime_sieve_t *sieve = t->sieve;
+	size_t i;
+
+	t->primes = 0;
+	t->segs = 0;
+	for (i = t->first; i < sieve->n_segs; i += t->stride) {
+		const uint64_t lo = sieve->lo + 1 + (2 * (uint64_t)i * sieve->seg_size);
+
+		t->primes += stress_prime_sieve_segment(sieve, t->seg, lo);
+		t->segs++;
+	}
+	return &g_nowt;
+}
+
+/*
+ *  stress_prime_sieve_window()
+ *	sieve the window using seg_size segments over num_threads
+ *	threads, returns the number of primes in the window
+ */
+static uint64_t stress_prime_sieve_window(
+	stress_prime_sieve_t *sieve,
+	stress_prime_sieve_thread_t *threads,
+	const size_t num_threads,
+	const size_t seg_size)
+{
+	size_t i;
+	uint64_t primes = 0;
+
+	sieve->seg_size = seg_size;
+	sieve->n_segs = (size_t)(STRESS_PRIME_SIEVE_WINDOW / 2) / seg_size;
+
+	for (i = 0; i < num_threads; i++) {
+		stress_prime_sieve_thread_t *t = &threads[i];
+
+		t->first = i;
+		t->stride = num_threads;
+#if defined(HAVE_LIB_PTHREAD)
+		/* the first segments are sieved by the calling thread */
+		t->ret = (i == 0) ? -1 :
+			pthread_create(&t->pthread, NULL, stress_prime_sieve_thread, (void *)t);
+#else
+		t->ret = -1;
+#endif
+	}
+	/* sieve segments where threads could not be created */
+	for (i = 0; i < num_threads; i++) {
+		if (threads[i].ret != 0)
+			(void)stress_prime_sieve_thread((void *)&threads[i]);
+	}
+#if defined(HAVE_LIB_PTHREAD)
+	for (i = 1; i < num_threads; i++) {
+		if (threads[i].ret == 0)
+			(void)pthread_join(threads[i].pthread, NULL);
+	}
+#endif
+	for (i = 0; i < num_threads; i++)
+		primes += threads[i].primes;
+	/* 2 is the only even prime */
+	if (sieve->lo <= 2)
+		primes++;
+	return primes;
+}
+
+/*
+ *  stress_prime_sieve_seg_size()
+ *	segment size for a cache level, a power of 2 no larger
+ *	than the cache size so segments evenly divide the window
+ */
+static size_t stress_prime_sieve_seg_size(const uint16_t cache_level, const size_t default_size)
+{
+	size_t cache_size, cache_line_size, seg_size;
+
+	stress_cpu_cache_get_level_size(cache_level, &cache_size, &cache_line_size);
+	if (cache_size == 0)
+		cache_size = default_size;
+	for (seg_size = 4096; (seg_size << 1) <= cache_size; seg_size <<= 1)
+		;
+	if (seg_size > (size_t)(STRESS_PRIME_SIEVE_WINDOW / 2))
+		seg_size = (size_t)(STRESS_PRIME_SIEVE_WINDOW / 2);
+	return seg_size;
+}
+
+/*
+ *  stress_prime_sieve()
+ *	segmented sieve prime search, compare L1 and L2 sized
+ *	segment throughput
+ */
+static int stress_prime_sieve(stress_args_t *args, mpz_t start)
+{
+	stress_prime_sieve_t sieve;
+	stress_prime_sieve_thread_t *threads;
+	uint32_t prime_threads = 1;
+	size_t i, num_threads, seg_sizes[2], buf_size, base_size;
+	uint64_t lo_start = 0, primes[2] = { 0, 0 }, segs[2] = { 0, 0 };
+	double duration[2] = { 0.0, 0.0 }, numbers = 0.0;
+	uint8_t *buf;
+	uint32_t *base_primes;
+	int rc = EXIT_SUCCESS;
+	const bool verify = !!(g_opt_flags & OPT_FLAGS_VERIFY);
+
+	(void)stress_get_setting("prime-threads", &prime_threads);
+	num_threads = (size_t)prime_threads;
+
+	if (mpz_fits_ulong_p(start) &&
+	    ((uint64_t)mpz_get_ui(start) < STRESS_PRIME_SIEVE_LIMIT - STRESS_PRIME_SIEVE_WINDOW)) {
+		lo_start = (uint64_t)mpz_get_ui(start) & ~1ULL;
+	} else if (args->instance == 0) {
+		pr_inf("%s: --prime-start must be less than 2^48 for the sieve "
+			"method, starting from 0\n", args->name);
+	}
+
+	seg_sizes[0] = stress_prime_sieve_seg_size(1, 32 * KB);
+	seg_sizes[1] = stress_prime_sieve_seg_size(2, 1 * MB);
+
+	threads = (stress_prime_sieve_thread_t *)calloc(num_threads, sizeof(*threads));
+	if (!threads) {
+		pr_inf_skip("%s: cannot allocate %zu thread states, skipping stressor\n",
+			args->name, num_threads);
+		return EXIT_NO_RESOURCE;
+	}
+	/* sieve for the base primes is reused for the segment buffers */
+	buf_size = STRESS_MAXIMUM((size_t)(STRESS_PRIME_SIEVE_BASE_MAX / 2),
+				  num_threads * seg_sizes[1]);
+	buf = (uint8_t *)stress_mmap_populate(NULL, buf_size,
+			PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (buf == MAP_FAILED) {
+		pr_inf_skip("%s: cannot mmap %zu bytes for sieve segments, "
+			"skipping stressor\n", args->name, buf_size);
+		free(threads);
+		return EXIT_NO_RESOURCE;
+	}
+	stress_set_vma_anon_name(buf, buf_size, "sieve-segments");
+	base_size = (size_t)STRESS_PRIME_SIEVE_PI_WINDOW * sizeof(*base_primes);
+	base_primes = (uint32_t *)stress_mmap_populate(NULL, base_size,
+			PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (base_primes == MAP_FAILED) {
+		pr_inf_skip("%s: cannot mmap %zu bytes for base primes, "
+			"skipping stressor\n", args->name, base_size);
+		(void)munmap((void *)buf, buf_size);
+		free(threads);
+		return EXIT_NO_RESOURCE;
+	}
+	stress_set_vma_anon_name(base_primes, base_size, "sieve-base-primes");
+
+	sieve.base_primes = base_primes;
+	sieve.n_base_primes = stress_prime_sieve_base(buf, base_primes);
+	sieve.lo = lo_start;
+	for (i = 0; i < num_threads; i++) {
+		threads[i].sieve = &sieve;
+		threads[i].seg = buf + (i * seg_sizes[1]);
+	}
+
+	if (args->instance == 0)
+		pr_dbg("%s: sieve segment sizes L1 %zuK, L2 %zuK, %zu threads\n",
+			args->name, seg_sizes[0] >> 10, seg_sizes[1] >> 10, num_threads);
+
+	stress_set_proc_state(args->name, STRESS_STATE_SYNC_WAIT);
+	stress_sync_start_wait(args);
+	stress_set_proc_state(args->name, STRESS_STATE_RUN);
+
+	do {
+		uint64_t count[2];
+
+		for (i = 0; i < SIZEOF_ARRAY(seg_sizes); i++) {
+			const double t = stress_time_now();
+			size_t j;
+
+			count[i] = stress_prime_sieve_window(&sieve, threads, num_threads, seg_sizes[i]);
+			duration[i] += stress_time_now() - t;
+			primes[i] += count[i];
+			for (j = 0; j < num_threads; j++)
+				segs[i] += threads[j].segs;
+		}
+		numbers += (double)STRESS_PRIME_SIEVE_WINDOW;
+
+		if (verify) {
+			if (count[0] != count[1]) {
+				pr_fail("%s: sieve of %" PRIu64 "..%" PRIu64 " found %" PRIu64
+					" primes with L1 segments and %" PRIu64 " primes with L2 segments\n",
+					args->name, sieve.lo, sieve.lo + (uint64_t)STRESS_PRIME_SIEVE_WINDOW - 1,
+					count[0], count[1]);
+				rc = EXIT_FAILURE;
+			} else if ((sieve.lo == 0) && (count[0] != STRESS_PRIME_SIEVE_PI_WINDOW)) {
+				pr_fail("%s: sieve of 0..%" PRIu64 " found %" PRIu64
+					" primes, expected %d\n", args->name,
+					(uint64_t)STRESS_PRIME_SIEVE_WINDOW - 1, count[0],
+					STRESS_PRIME_SIEVE_PI_WINDOW);
+				rc = EXIT_FAILURE;
+			}
+		}
+		sieve.lo += STRESS_PRIME_SIEVE_WINDOW;
+		if (sieve.lo > STRESS_PRIME_SIEVE_LIMIT - STRESS_PRIME_SIEVE_WINDOW)
+			sieve.lo = lo_start;
+		stress_bogo_inc(args);
+	} while ((rc == EXIT_SUCCESS) && stress_continue(args));
+
+	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
+
+	for (i = 0; i < SIZEOF_ARRAY(seg_sizes); i++) {
+		char msg[40];
+		const char *level = i ? "L2" : "L1";
+
+		(void)snprintf(msg, sizeof(msg), "primes per sec, %s segments", level);
+		stress_metrics_set(args, (i * 3) + 0, msg,
+			(duration[i] > 0.0) ? (double)primes[i] / duration[i] : 0.0,
+			STRESS_METRIC_HARMONIC_MEAN);
+		(void)snprintf(msg, sizeof(msg), "segments per sec, %s segments", level);
+		stress_metrics_set(args, (i * 3) + 1, msg,
+			(duration[i] > 0.0) ? (double)segs[i] / duration[i] : 0.0,
+			STRESS_METRIC_HARMONIC_MEAN);
+		(void)snprintf(msg, sizeof(msg), "M integers per sec, %s segments", level);
+		stress_metrics_set(args, (i * 3) + 2, msg,
+			(duration[i] > 0.0) ? numbers / duration[i] / 1000000.0 : 0.0,
+			STRESS_METRIC_HARMONIC_MEAN);
+	}
+	stress_metrics_set(args, 6, "primes found", (double)primes[0], STRESS_METRIC_TOTAL);
+
+	(void)munmap((void *)base_primes, base_size);
+	(void)munmap((void *)buf, buf_size);
+	free(threads);
+
+	return rc;
+}
+
 static int OPTIMIZE3 stress_prime(stress_args_t *args)
 {
 	double rate, t_progress_secs;
@@ -146,7 +488,7 @@ static int OPTIMIZE3 stress_prime(stress_args_t *args)
 	NOCLOBBER size_t t_start;
 	uint64_t ops;
 	mpz_t start, value, factorial;
-	int prime_method = STRESS_PRIME_METHOD_INC;
+	size_t prime_method = STRESS_PRIME_METHOD_INC;
 	bool prime_progress = false;
 	char *prime_start = NULL;
 
@@ -167,6 +509,14 @@ static int OPTIMIZE3 stress_prime(stress_args_t *args)
 		mpz_set_ui(start, 1);
 	}
 
+	if (prime_method == STRESS_PRIME_METHOD_SIEVE) {
+		int rc;
+
+		rc = stress_prime_sieve(args, start);
+		mpz_clears(start, value, factorial, NULL);
+		return rc;
+	}
+
 	mpz_set_ui(factorial, 2);
 
 	/* only report progress on instance 0 */
@@ -250,7 +600,7 @@ const stressor_info_t stress_prime_info = {
 	.stressor = stress_prime,
 	.class = CLASS_CPU | CLASS_INTEGER | CLASS_COMPUTE,
 	.opts = opts,
-	.verify = VERIFY_NONE,
+	.verify = VERIFY_OPTIONAL,
 	.help = help
 };
 
@@ -260,7 +610,7 @@ const stressor_info_t stress_prime_info = {
 	.stressor = stress_unimplemented,
 	.class = CLASS_CPU | CLASS_INTEGER | CLASS_COMPUTE,
 	.opts = opts,
-	.verify = VERIFY_NONE,
+	.verify = VERIFY_OPTIONAL,
 	.help = help,
 	.unimplemented_reason = "built without gmp.h, or libgmp"
 };
@@ -20,6 +20,7 @@
 #include "core-builtin.h"
 #include "core-killpid.h"
 #include "core-capabilities.h"
+#include "core-latency.h"
 #include "core-pthread.h"
 
 #if defined(HAVE_PTHREAD_NP_H)
@@ -31,6 +32,7 @@
 */
 
 #define MUTEX_PROCS	(3)
+#define MUTEX_HIGH_PRIO	(MUTEX_PROCS - 1)	/* child with the highest priority */
 
 #if defined(HAVE_PTHREAD_PRIO_INHERIT)
 #define STRESS_PRIO_INV_TYPE_INHERIT	(PTHREAD_PRIO_INHERIT)
@@ -156,6 +158,8 @@ typedef struct {
 	stress_prio_inv_child_info_t	child_info[MUTEX_PROCS];
 	pthread_mutex_t mutex;
 	stress_args_t *args;
+	stress_latency_hist_t wait_hist;	/* high priority lock blocking times */
+	volatile uint64_t wait_begin;		/* start of in-progress wait, 0 if none */
 } stress_prio_inv_info_t;
 
 typedef void (*stress_prio_inv_func_t)(const size_t instance, stress_prio_inv_info_t *info);
@@ -193,13 +197,26 @@ static void mutex_exercise(const size_t instance, stress_prio_inv_info_t *prio_i
 	stress_prio_inv_child_info_t *child_info = &prio_inv_info->child_info[instance];
 	stress_args_t *args = prio_inv_info->args;
 	pthread_mutex_t *mutex = &prio_inv_info->mutex;
+	stress_latency_hist_t *wait_hist = (instance == MUTEX_HIGH_PRIO) ?
+		&prio_inv_info->wait_hist : NULL;
 
 	do {
+		uint64_t t_begin = 0;
+
+		if (wait_hist) {
+			t_begin = stress_latency_now();
+			prio_inv_info->wait_begin = t_begin;
+		}
 		if (UNLIKELY(pthread_mutex_lock(mutex) < 0)) {
 			pr_fail("%s: pthread_mutex_lock failed, errno=%d (%s)\n",
 				args->name, errno, strerror(errno));
 			break;
 		}
+		/* only the high priority child records how long it was blocked */
+		if (wait_hist) {
+			stress_latency_hist_record(wait_hist, stress_latency_now() - t_begin);
+			prio_inv_info->wait_begin = 0;
+		}
 
 		stress_prio_inv_getrusage(child_info);
 		stress_bogo_inc(args);
@@ -321,6 +338,7 @@ static int stress_prio_inv(stress_args_t *args)
 	stress_prio_inv_info_t *prio_inv_info;
 	stress_prio_inv_child_info_t *child_info;
 	const char *policy_name;
+	uint64_t t_end, wait_begin;
 #if defined(DEBUG_USAGE)
 	double total_usage;
 #endif
@@ -343,6 +361,8 @@ static int stress_prio_inv(stress_args_t *args)
 	stress_set_vma_anon_name(prio_inv_info, sizeof(*prio_inv_info), "state");
 	child_info = prio_inv_info->child_info;
 	prio_inv_info->args = args;
+	stress_latency_hist_init(&prio_inv_info->wait_hist);
+	prio_inv_info->wait_begin = 0;
 
 	(void)stress_get_setting("prio-inv-type", &prio_inv_type);
 	(void)stress_get_setting("prio-inv-policy", &prio_inv_policy);
@@ -460,6 +480,7 @@ static int stress_prio_inv(stress_args_t *args)
 
 reap:
 	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
+	t_end = stress_latency_now();
 
 	/* Need to send alarm to all children before waitpid'ing them */
 	for (i = 0; i < MUTEX_PROCS; i++) {
@@ -498,6 +519,33 @@ reap:
 			args->name, child_info[0].usage, child_info[2].usage);
 	}
 
+	/*
+	 *  An unbounded inversion leaves the high priority child blocked
+	 *  until it is killed, so account for the wait still in progress
+	 */
+	wait_begin = prio_inv_info->wait_begin;
+	if ((wait_begin > 0) && (t_end > wait_begin)) {
+		pr_inf("%s: high priority process was still blocked on the mutex "
+			"after %.3f secs with '%s' protocol\n", args->name,
+			(double)(t_end - wait_begin) / STRESS_DBL_NANOSECOND,
+			stress_prio_inv_types[prio_inv_type].option);
+		stress_latency_hist_record(&prio_inv_info->wait_hist, t_end - wait_begin);
+	}
+
+	if (prio_inv_info->wait_hist.count > 0) {
+		const stress_latency_hist_t *wait_hist = &prio_inv_info->wait_hist;
+		const char *type_name = stress_prio_inv_types[prio_inv_type].option;
+		char msg[64];
+
+		(void)snprintf(msg, sizeof(msg), "%s high prio lock wait p99 (usec)", type_name);
+		stress_metrics_set(args, 0, msg,
+			(double)stress_latency_hist_percentile(wait_hist, 99.0) / 1000.0,
+			STRESS_METRIC_GEOMETRIC_MEAN);
+		(void)snprintf(msg, sizeof(msg), "%s high prio lock wait max (usec)", type_name);
+		stress_metrics_set(args, 1, msg,
+			(double)wait_hist->max_ns / 1000.0, STRESS_METRIC_MAXIMUM);
+	}
+
 	(void)pthread_mutex_destroy(&prio_inv_info->mutex);
 #if !defined(SCHED_OTHER)
 unmap_prio_inv_info:
@@ -512,6 +560,7 @@ const stressor_info_t stress_prio_inv_info = {
 	.class = CLASS_OS | CLASS_SCHEDULER,
 	.opts = opts,
 	.verify = VERIFY_ALWAYS,
+	.metrics_max = 2,
 	.help = help
 };
 #else
@@ -580,6 +580,7 @@ const stressor_info_t stress_priv_instr_info = {
 	.stressor = stress_priv_instr,
 	.class = CLASS_CPU,
 	.verify = VERIFY_ALWAYS,
+	.metrics_max = 1,
 	.help = help
 };
 
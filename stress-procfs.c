@@ -20,6 +20,7 @@
 #include "stress-ng.h"
 #include "core-arch.h"
 #include "core-builtin.h"
+#include "core-killpid.h"
 #include "core-pthread.h"
 #include "core-put.h"
 
@@ -41,9 +42,18 @@
 static const stress_help_t help[] = {
 	{ NULL,	"procfs N",	"start N workers reading portions of /proc" },
 	{ NULL,	"procfs-ops N",	"stop procfs workers after N bogo read operations" },
+	{ NULL,	"procfs-readers N", "measure N threads polling /proc files of a memory stressor" },
 	{ NULL,	NULL,		NULL }
 };
 
+#define MIN_PROCFS_READERS	(1)
+#define MAX_PROCFS_READERS	(1024)
+
+static const stress_opt_t opts[] = {
+	{ OPT_procfs_readers, "procfs-readers", TYPE_ID_UINT32, MIN_PROCFS_READERS, MAX_PROCFS_READERS, NULL },
+	END_OPT,
+};
+
 #if defined(HAVE_LIB_PTHREAD) &&	\
     defined(__linux__)
 
@@ -754,6 +764,273 @@ static int stress_procfs_no_entries(stress_args_t *args)
 	return EXIT_NO_RESOURCE;
 }
 
+#define PROCFS_READERS_PHASE	(0.5)	/* seconds per baseline and loaded phase */
+#define PROCFS_TARGET_VMAS	(256)	/* VMAs in target for smaps to walk */
+#define PROCFS_TARGET_PAGES	(64)	/* pages mapped and touched per target op */
+
+typedef enum {
+	PROCFS_READER_PID_STAT,
+	PROCFS_READER_PID_SMAPS_ROLLUP,
+	PROCFS_READER_PID_SMAPS,
+	PROCFS_READER_STAT,
+	PROCFS_READER_MAX,
+} stress_procfs_reader_file_t;
+
+static const char * const procfs_reader_names[PROCFS_READER_MAX] = {
+	"stat",
+	"smaps_rollup",
+	"smaps",
+	"/proc/stat",
+};
+
+typedef struct {
+	char paths[PROCFS_READER_MAX][PATH_MAX];	/* files to read */
+	volatile bool active;		/* readers read while true */
+	volatile bool stop;		/* readers exit when true */
+} stress_procfs_readers_t;
+
+typedef struct {
+	pthread_t pthread;		/* reader thread */
+	int ret;			/* pthread_create return */
+	stress_procfs_readers_t *readers;
+	uint32_t index;			/* reader number, staggers start file */
+	uint64_t reads[PROCFS_READER_MAX];	/* completed reads */
+	double duration[PROCFS_READER_MAX];	/* time spent reading */
+} stress_procfs_reader_t;
+
+/*
+ *  stress_procfs_reader_thread()
+ *	open, read to EOF and close the monitored files in
+ *	turn while the readers are active
+ */
+static void *stress_procfs_reader_thread(void *ptr)
+{
+	stress_procfs_reader_t *reader = (stress_procfs_reader_t *)ptr;
+	stress_procfs_readers_t *readers = reader->readers;
+	size_t i = reader->index % PROCFS_READER_MAX;
+	char buf[PROC_BUF_SZ];
+
+	(void)pthread_sigmask(SIG_BLOCK, &set, NULL);
+
+	while (!readers->stop) {
+		double t;
+		int fd;
+
+		if (!readers->active) {
+			(void)shim_usleep(1000);
+			continue;
+		}
+		i = (i + 1) % PROCFS_READER_MAX;
+		t = stress_time_now();
+		fd = open(readers->paths[i], O_RDONLY);
+		if (fd < 0)
+			continue;
+		while (read(fd, buf, sizeof(buf)) > 0)
+			;
+		(void)close(fd);
+		reader->duration[i] += stress_time_now() - t;
+		reader->reads[i]++;
+	}
+	return &g_nowt;
+}
+
+/*
+ *  stress_procfs_target()
+ *	memory stressor that is monitored by the readers, holds many
+ *	VMAs and repeatedly maps, touches and unmaps pages to take
+ *	the mmap lock for write and read, counts completed ops
+ */
+static void NORETURN stress_procfs_target(const size_t page_size, uint64_t *counter)
+{
+	const size_t size = page_size * PROCFS_TARGET_PAGES;
+	size_t i;
+
+	stress_parent_died_alarm();
+	(void)sched_settings_apply(true);
+
+	/* alternate protections so the VMAs do not merge */
+	for (i = 0; i < PROCFS_TARGET_VMAS; i++) {
+		void *ptr = mmap(NULL, page_size, (i & 1) ? PROT_READ : PROT_READ | PROT_WRITE,
+				MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+		if (ptr == MAP_FAILED)
+			break;
+		stress_uint8_put(*(volatile uint8_t *)ptr);
+	}
+
+	while (stress_continue_flag()) {
+		uint8_t *ptr;
+
+		ptr = (uint8_t *)mmap(NULL, size, PROT_READ | PROT_WRITE,
+				MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		if (ptr == MAP_FAILED) {
+			(void)shim_usleep(1000);
+			continue;
+		}
+		for (i = 0; i < size; i += page_size)
+			ptr[i] = (uint8_t)i;
+		(void)munmap((void *)ptr, size);
+		(*counter)++;
+	}
+	_exit(EXIT_SUCCESS);
+}
+
+/*
+ *  stress_procfs_readers()
+ *	--procfs-readers mode, N threads read the /proc files that
+ *	monitoring agents poll for a target process running a memory
+ *	stressor, alternating phases with and without readers to
+ *	measure reader throughput and the target slowdown
+ */
+static int stress_procfs_readers(stress_args_t *args, const uint32_t procfs_readers)
+{
+	stress_procfs_readers_t readers;
+	stress_procfs_reader_t *reader;
+	uint64_t *counter, reads[PROCFS_READER_MAX];
+	double duration[PROCFS_READER_MAX], base_time = 0.0, load_time = 0.0;
+	uint64_t base_ops = 0, load_ops = 0, total_reads;
+	uint32_t i, n_readers = 0;
+	size_t j;
+	pid_t pid;
+	int rc = EXIT_SUCCESS;
+
+	counter = (uint64_t *)stress_mmap_populate(NULL, args->page_size,
+		PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+	if (counter == MAP_FAILED) {
+		pr_inf_skip("%s: cannot mmap target op counter, skipping stressor\n", args->name);
+		return EXIT_NO_RESOURCE;
+	}
+	stress_set_vma_anon_name(counter, args->page_size, "procfs-counter");
+	*counter = 0;
+
+	reader = (stress_procfs_reader_t *)calloc(procfs_readers, sizeof(*reader));
+	if (!reader) {
+		pr_inf_skip("%s: cannot allocate %" PRIu32 " readers, skipping stressor\n",
+			args->name, procfs_readers);
+		rc = EXIT_NO_RESOURCE;
+		goto unmap_counter;
+	}
+
+	pid = fork();
+	if (pid < 0) {
+		pr_inf_skip("%s: cannot fork target process, errno=%d (%s), skipping stressor\n",
+			args->name, errno, strerror(errno));
+		rc = EXIT_NO_RESOURCE;
+		goto free_reader;
+	} else if (pid == 0) {
+		stress_procfs_target(args->page_size, counter);
+	}
+
+	(void)snprintf(readers.paths[PROCFS_READER_PID_STAT], PATH_MAX, "/proc/%" PRIdMAX "/stat", (intmax_t)pid);
+	(void)snprintf(readers.paths[PROCFS_READER_PID_SMAPS_ROLLUP], PATH_MAX, "/proc/%" PRIdMAX "/smaps_rollup", (intmax_t)pid);
+	(void)snprintf(readers.paths[PROCFS_READER_PID_SMAPS], PATH_MAX, "/proc/%" PRIdMAX "/smaps", (intmax_t)pid);
+	(void)shim_strscpy(readers.paths[PROCFS_READER_STAT], "/proc/stat", PATH_MAX);
+	readers.active = false;
+	readers.stop = false;
+
+	for (i = 0; i < procfs_readers; i++) {
+		reader[i].readers = &readers;
+		reader[i].index = i;
+		reader[i].ret = pthread_create(&reader[i].pthread, NULL,
+				stress_procfs_reader_thread, &reader[i]);
+		if (reader[i].ret == 0)
+			n_readers++;
+	}
+	if (n_readers == 0) {
+		pr_inf_skip("%s: cannot create any reader threads, skipping stressor\n", args->name);
+		rc = EXIT_NO_RESOURCE;
+		goto reap;
+	}
+	if ((args->instance == 0) && (n_readers < procfs_readers))
+		pr_inf("%s: only %" PRIu32 " of %" PRIu32 " reader threads created\n",
+			args->name, n_readers, procfs_readers);
+
+	stress_set_proc_state(args->name, STRESS_STATE_SYNC_WAIT);
+	stress_sync_start_wait(args);
+	stress_set_proc_state(args->name, STRESS_STATE_RUN);
+
+	do {
+		uint64_t ops;
+		double t;
+
+		/* baseline phase, target runs alone */
+		ops = *counter;
+		t = stress_time_now();
+		(void)shim_usleep((uint64_t)(PROCFS_READERS_PHASE * STRESS_DBL_MICROSECOND));
+		if (UNLIKELY(!stress_continue(args)))
+			break;
+		base_ops += *counter - ops;
+		base_time += stress_time_now() - t;
+
+		/* loaded phase, readers poll the target */
+		readers.active = true;
+		ops = *counter;
+		t = stress_time_now();
+		(void)shim_usleep((uint64_t)(PROCFS_READERS_PHASE * STRESS_DBL_MICROSECOND));
+		readers.active = false;
+		load_ops += *counter - ops;
+		load_time += stress_time_now() - t;
+
+		for (total_reads = 0, i = 0; i < procfs_readers; i++) {
+			for (j = 0; j < PROCFS_READER_MAX; j++)
+				total_reads += reader[i].reads[j];
+		}
+		stress_bogo_set(args, total_reads);
+	} while (stress_continue(args));
+
+	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
+reap:
+	readers.stop = true;
+	for (i = 0; i < procfs_readers; i++) {
+		if (reader[i].ret == 0)
+			(void)pthread_join(reader[i].pthread, NULL);
+	}
+	(void)stress_kill_pid_wait(pid, NULL);
+	if (rc != EXIT_SUCCESS)
+		goto free_reader;
+
+	(void)shim_memset(reads, 0, sizeof(reads));
+	(void)shim_memset(duration, 0, sizeof(duration));
+	for (total_reads = 0, i = 0; i < procfs_readers; i++) {
+		for (j = 0; j < PROCFS_READER_MAX; j++) {
+			reads[j] += reader[i].reads[j];
+			duration[j] += reader[i].duration[j];
+			total_reads += reader[i].reads[j];
+		}
+	}
+	stress_metrics_set(args, 0, "reads per sec",
+		(load_time > 0.0) ? (double)total_reads / load_time : 0.0,
+		STRESS_METRIC_HARMONIC_MEAN);
+	for (j = 0; j < PROCFS_READER_MAX; j++) {
+		char str[64];
+
+		if (!reads[j])
+			continue;
+		(void)snprintf(str, sizeof(str), "usec per %s read", procfs_reader_names[j]);
+		stress_metrics_set(args, 1 + j, str,
+			(duration[j] * STRESS_DBL_MICROSECOND) / (double)reads[j],
+			STRESS_METRIC_HARMONIC_MEAN);
+	}
+	if ((base_time > 0.0) && (load_time > 0.0) && (base_ops > 0)) {
+		const double base_rate = (double)base_ops / base_time;
+		const double load_rate = (double)load_ops / load_time;
+
+		stress_metrics_set(args, 1 + PROCFS_READER_MAX, "target ops per sec without readers",
+			base_rate, STRESS_METRIC_HARMONIC_MEAN);
+		stress_metrics_set(args, 2 + PROCFS_READER_MAX, "target ops per sec with readers",
+			load_rate, STRESS_METRIC_HARMONIC_MEAN);
+		stress_metrics_set(args, 3 + PROCFS_READER_MAX, "% target slowdown with readers",
+			100.0 * (1.0 - (load_rate / base_rate)), STRESS_METRIC_MAXIMUM);
+	}
+
+free_reader:
+	free(reader);
+unmap_counter:
+	(void)munmap((void *)counter, args->page_size);
+
+	return rc;
+}
+
 /*
  *  stress_procfs
  *	stress reading all of /proc
@@ -765,6 +1042,13 @@ static int stress_procfs(stress_args_t *args)
 	int rc, ret[MAX_PROCFS_THREADS];
 	stress_ctxt_t ctxt;
 	struct dirent **dlist = NULL;
+	uint32_t procfs_readers = 0;
+
+	(void)stress_get_setting("procfs-readers", &procfs_readers);
+	if (procfs_readers > 0) {
+		(void)sigfillset(&set);
+		return stress_procfs_readers(args, procfs_readers);
+	}
 
 	n = stress_proc_scandir("/proc", &dlist, NULL, alphasort);
 	if (n <= 0)
@@ -858,12 +1142,14 @@ static int stress_procfs(stress_args_t *args)
 const stressor_info_t stress_procfs_info = {
 	.stressor = stress_procfs,
 	.class = CLASS_FILESYSTEM | CLASS_OS,
+	.opts = opts,
 	.help = help
 };
 #else
 const stressor_info_t stress_procfs_info = {
 	.stressor = stress_unimplemented,
 	.class = CLASS_FILESYSTEM | CLASS_OS,
+	.opts = opts,
 	.help = help,
 	.unimplemented_reason = "built without librt or only supported on Linux"
 };
@@ -0,0 +1,378 @@
+/*
+ * Copyright (C) 2025      Colin Ian King.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+#include "stress-ng.h"
+#include "core-builtin.h"
+#include "core-latency.h"
+#include "core-madvise.h"
+
+#if defined(HAVE_SPAWN_H)
+#include <spawn.h>
+#endif
+
+#define MIN_PROCLAT_RSS		(4 * MB)
+#define MAX_PROCLAT_RSS		(MAX_MEM_LIMIT)
+#define DEFAULT_PROCLAT_RSS	(256 * MB)
+
+#define PROCLAT_METHOD_ALL	(0)
+#define PROCLAT_METHOD_CLONE3	(1)
+#define PROCLAT_METHOD_FORK	(2)
+#define PROCLAT_METHOD_SPAWN	(3)
+#define PROCLAT_METHOD_VFORK	(4)
+#define PROCLAT_METHODS		(4)
+
+#define PROCLAT_PAGES_NORMAL	(0)
+#define PROCLAT_PAGES_THP	(1)
+#define PROCLAT_PAGE_TYPES	(2)
+
+#define PROCLAT_RUNNING		(0)	/* create to child running */
+#define PROCLAT_EXIT		(1)	/* create to child exit */
+#define PROCLAT_LATENCIES	(2)
+
+#define PROCLAT_STEPS_MAX	(8)	/* RSS sizes in the curve */
+#define PROCLAT_SAMPLES		(8)	/* samples per method per RSS size per round */
+
+static const stress_help_t help[] = {
+	{ NULL,	"proclat N",		"start N workers measuring process creation latency against RSS" },
+	{ NULL,	"proclat-method M",	"select creation method: all, clone3, fork, spawn, vfork" },
+	{ NULL,	"proclat-ops N",	"stop after N bogo process creation rounds" },
+	{ NULL,	"proclat-rss N",	"grow the parent RSS up to N bytes" },
+	{ NULL,	NULL,			NULL }
+};
+
+static const char * const stress_proclat_methods[] = {
+	"all",
+	"clone3",
+	"fork",
+	"spawn",
+	"vfork",
+};
+
+static const char * const stress_proclat_page_types[PROCLAT_PAGE_TYPES] = {
+	"normal",
+	"thp",
+};
+
+static const char *stress_proclat_method(const size_t i)
+{
+	return (i < SIZEOF_ARRAY(stress_proclat_methods)) ? stress_proclat_methods[i] : NULL;
+}
+
+static const stress_opt_t opts[] = {
+	{ OPT_proclat_method, "proclat-method", TYPE_ID_SIZE_T_METHOD, 0, 0, stress_proclat_method },
+	{ OPT_proclat_rss,    "proclat-rss",    TYPE_ID_SIZE_T_BYTES_VM, MIN_PROCLAT_RSS, MAX_PROCLAT_RSS, NULL },
+	END_OPT,
+};
+
+#if defined(__linux__)
+
+/*
+ *  stress_proclat_create()
+ *	create a child with the given method that runs stress-ng
+ *	--exec-exit, the child writes the time it started running
+ *	to *t_running, returns the child pid or -1 on failure
+ */
+static pid_t stress_proclat_create(
+	const size_t method,
+	char *exec_prog,
+	char *argv[],
+	char *env[],
+	volatile uint64_t *t_running)
+{
+	pid_t pid = -1;
+
+	switch (method) {
+	case PROCLAT_METHOD_CLONE3: {
+			struct shim_clone_args cl_args;
+
+			(void)shim_memset(&cl_args, 0, sizeof(cl_args));
+			cl_args.exit_signal = SIGCHLD;
+			pid = shim_clone3(&cl_args, sizeof(cl_args));
+			if (pid == 0) {
+				*t_running = stress_latency_now();
+				_exit(execve(exec_prog, argv, env));
+			}
+		}
+		break;
+	case PROCLAT_METHOD_FORK:
+		pid = fork();
+		if (pid == 0) {
+			*t_running = stress_latency_now();
+			_exit(execve(exec_prog, argv, env));
+		}
+		break;
+#if defined(HAVE_SPAWN_H) &&	\
+    defined(HAVE_POSIX_SPAWN)
+	case PROCLAT_METHOD_SPAWN:
+		/* posix_spawn returns once the child is running the new program */
+		if (posix_spawn(&pid, exec_prog, NULL, NULL, argv, env) != 0)
+			pid = -1;
+		else
+			*t_running = stress_latency_now();
+		break;
+#endif
+#if defined(HAVE_VFORK)
+	case PROCLAT_METHOD_VFORK:
+		pid = shim_vfork();
+		if (pid == 0) {
+			*t_running = stress_latency_now();
+			_exit(execve(exec_prog, argv, env));
+		}
+		break;
+#endif
+	default:
+		errno = ENOSYS;
+		break;
+	}
+	return pid;
+}
+
+/*
+ *  stress_proclat_rss_steps()
+ *	RSS sizes of the curve, 0, 4MB, 16MB.. and the maximum RSS
+ */
+static size_t stress_proclat_rss_steps(const size_t rss_max, size_t steps[PROCLAT_STEPS_MAX])
+{
+	size_t n = 0, sz;
+
+	steps[n++] = 0;
+	for (sz = MIN_PROCLAT_RSS; (sz < rss_max) && (n < PROCLAT_STEPS_MAX - 1); sz <<= 2)
+		steps[n++] = sz;
+	steps[n++] = rss_max;
+	return n;
+}
+
+/*
+ *  stress_proclat()
+ *	grow the parent RSS with normal and transparent huge pages
+ *	and time the creation of processes that exec and exit with
+ *	each of the creation methods
+ */
+static int stress_proclat(stress_args_t *args)
+{
+	size_t proclat_method = PROCLAT_METHOD_ALL;
+	size_t proclat_rss = DEFAULT_PROCLAT_RSS;
+	size_t steps[PROCLAT_STEPS_MAX], n_steps, step, method, page_type, i;
+	bool supported[PROCLAT_METHODS + 1];
+	char exec_path[PATH_MAX];
+	char *exec_prog;
+	char *argv[3], *env[1];
+	uint8_t *mem;
+	volatile uint64_t *t_running;
+	stress_latency_hist_t *hists;
+	size_t n_page_types = 1;
+	int rc = EXIT_SUCCESS;
+
+	(void)stress_get_setting("proclat-method", &proclat_method);
+	if (!stress_get_setting("proclat-rss", &proclat_rss)) {
+		if (g_opt_flags & OPT_FLAGS_MAXIMIZE)
+			proclat_rss = MAX_PROCLAT_RSS;
+		if (g_opt_flags & OPT_FLAGS_MINIMIZE)
+			proclat_rss = MIN_PROCLAT_RSS;
+	}
+	proclat_rss &= ~(size_t)(args->page_size - 1);
+	n_steps = stress_proclat_rss_steps(proclat_rss, steps);
+
+	exec_prog = stress_get_proc_self_exe(exec_path, sizeof(exec_path));
+	if (!exec_prog) {
+		if (args->instance == 0)
+			pr_inf_skip("%s: skipping stressor, can't determine stress-ng "
+				"executable name\n", args->name);
+		return EXIT_NOT_IMPLEMENTED;
+	}
+	argv[0] = exec_prog;
+	argv[1] = "--exec-exit";
+	argv[2] = NULL;
+	env[0] = NULL;
+
+	for (method = 1; method <= PROCLAT_METHODS; method++)
+		supported[method] = (proclat_method == PROCLAT_METHOD_ALL) || (proclat_method == method);
+#if !defined(HAVE_SPAWN_H) ||	\
+    !defined(HAVE_POSIX_SPAWN)
+	supported[PROCLAT_METHOD_SPAWN] = false;
+#endif
+#if !defined(HAVE_VFORK)
+	supported[PROCLAT_METHOD_VFORK] = false;
+#endif
+#if defined(MADV_HUGEPAGE) &&	\
+    defined(MADV_NOHUGEPAGE)
+	n_page_types = PROCLAT_PAGE_TYPES;
+#endif
+
+	t_running = (volatile uint64_t *)stress_mmap_populate(NULL, args->page_size,
+		PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+	if (t_running == MAP_FAILED) {
+		pr_inf_skip("%s: failed to mmap %zu bytes, skipping stressor\n",
+			args->name, args->page_size);
+		return EXIT_NO_RESOURCE;
+	}
+	stress_set_vma_anon_name((void *)t_running, args->page_size, "proclat-time");
+
+	/* over allocate by a huge page so the region can be huge page aligned */
+	mem = (uint8_t *)mmap(NULL, proclat_rss + (2 * MB), PROT_READ | PROT_WRITE,
+		MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+	if (mem == MAP_FAILED) {
+		pr_inf_skip("%s: failed to mmap %zu bytes, skipping stressor\n",
+			args->name, proclat_rss);
+		(void)munmap((void *)t_running, args->page_size);
+		return EXIT_NO_RESOURCE;
+	}
+	stress_set_vma_anon_name(mem, proclat_rss + (2 * MB), "proclat-rss");
+
+	hists = (stress_latency_hist_t *)calloc(n_steps * PROCLAT_PAGE_TYPES *
+		(PROCLAT_METHODS + 1) * PROCLAT_LATENCIES, sizeof(*hists));
+	if (!hists) {
+		pr_inf_skip("%s: failed to allocate latency histograms, skipping stressor\n",
+			args->name);
+		rc = EXIT_NO_RESOURCE;
+		goto tidy;
+	}
+	for (i = 0; i < n_steps * PROCLAT_PAGE_TYPES * (PROCLAT_METHODS + 1) * PROCLAT_LATENCIES; i++)
+		stress_latency_hist_init(&hists[i]);
+	stress_latency_set_description(args, PROCLAT_RUNNING, "create to running");
+	stress_latency_set_description(args, PROCLAT_EXIT, "create to exit");
+
+	stress_set_proc_state(args->name, STRESS_STATE_SYNC_WAIT);
+	stress_sync_start_wait(args);
+	stress_set_proc_state(args->name, STRESS_STATE_RUN);
+
+	do {
+		for (page_type = 0; (page_type < n_page_types) && stress_continue(args); page_type++) {
+			uint8_t *rss = (uint8_t *)(((uintptr_t)mem + (2 * MB) - 1) & ~(uintptr_t)((2 * MB) - 1));
+			size_t populated = 0;
+
+			(void)shim_madvise(mem, proclat_rss + (2 * MB), SHIM_MADV_DONTNEED);
+#if defined(MADV_HUGEPAGE) &&	\
+    defined(MADV_NOHUGEPAGE)
+			(void)madvise(mem, proclat_rss + (2 * MB),
+				(page_type == PROCLAT_PAGES_THP) ? MADV_HUGEPAGE : MADV_NOHUGEPAGE);
+#endif
+			for (step = 0; (step < n_steps) && stress_continue(args); step++) {
+				/* grow the RSS to the step size */
+				for (; populated < steps[step]; populated += args->page_size)
+					rss[populated] = (uint8_t)populated;
+
+				for (method = 1; method <= PROCLAT_METHODS; method++) {
+					stress_latency_hist_t *hist = &hists[(((step * PROCLAT_PAGE_TYPES) + page_type) *
+						(PROCLAT_METHODS + 1) + method) * PROCLAT_LATENCIES];
+
+					for (i = 0; supported[method] && (i < PROCLAT_SAMPLES) && stress_continue(args); i++) {
+						uint64_t t_begin, t_exit;
+						pid_t pid;
+						int status;
+
+						*t_running = 0;
+						t_begin = stress_latency_now();
+						pid = stress_proclat_create(method, exec_prog, argv, env, t_running);
+						if (pid < 0) {
+							if ((errno == ENOSYS) || (errno == EPERM)) {
+								if (args->instance == 0)
+									pr_inf("%s: %s not available, disabling it\n",
+										args->name, stress_proclat_methods[method]);
+								supported[method] = false;
+							}
+							break;
+						}
+						if (shim_waitpid(pid, &status, 0) < 0)
+							break;
+						t_exit = stress_latency_now();
+						if (!WIFEXITED(status) || (WEXITSTATUS(status) != EXIT_SUCCESS)) {
+							/* child may be killed by the end of run SIGALRM */
+							if (!stress_continue(args))
+								break;
+							pr_fail("%s: %s child failed to exec and exit, status=0x%x\n",
+								args->name, stress_proclat_methods[method], status);
+							rc = EXIT_FAILURE;
+							break;
+						}
+						if (*t_running >= t_begin) {
+							stress_latency_hist_record(&hist[PROCLAT_RUNNING], *t_running - t_begin);
+							stress_latency_record(args, PROCLAT_RUNNING, *t_running - t_begin);
+						}
+						stress_latency_hist_record(&hist[PROCLAT_EXIT], t_exit - t_begin);
+						stress_latency_record(args, PROCLAT_EXIT, t_exit - t_begin);
+					}
+				}
+			}
+		}
+		stress_bogo_inc(args);
+	} while ((rc == EXIT_SUCCESS) && stress_continue(args));
+
+	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
+
+	if (args->instance == 0)
+		pr_inf("%s: %8s %-6s %-6s %12s %12s (p50 usec)\n", args->name,
+			"RSS (MB)", "pages", "method", "running", "exit");
+	for (page_type = 0; page_type < n_page_types; page_type++) {
+		for (method = 1; method <= PROCLAT_METHODS; method++) {
+			for (step = 0; step < n_steps; step++) {
+				const stress_latency_hist_t *hist = &hists[(((step * PROCLAT_PAGE_TYPES) + page_type) *
+					(PROCLAT_METHODS + 1) + method) * PROCLAT_LATENCIES];
+				const double running = (double)stress_latency_hist_percentile(&hist[PROCLAT_RUNNING], 50.0) / 1000.0;
+				const double exited = (double)stress_latency_hist_percentile(&hist[PROCLAT_EXIT], 50.0) / 1000.0;
+				char msg[64];
+				size_t idx;
+
+				if (!hist[PROCLAT_EXIT].count)
+					continue;
+				if (args->instance == 0)
+					pr_inf("%s: %8.1f %-6s %-6s %12.2f %12.2f\n", args->name,
+						(double)steps[step] / (double)MB,
+						stress_proclat_page_types[page_type],
+						stress_proclat_methods[method], running, exited);
+				/* metrics for the largest RSS */
+				if (step != n_steps - 1)
+					continue;
+				idx = ((page_type * PROCLAT_METHODS) + (method - 1)) * PROCLAT_LATENCIES;
+				(void)snprintf(msg, sizeof(msg), "usec %s %s create to running at max RSS",
+					stress_proclat_page_types[page_type], stress_proclat_methods[method]);
+				stress_metrics_set(args, idx + PROCLAT_RUNNING, msg,
+					running, STRESS_METRIC_GEOMETRIC_MEAN);
+				(void)snprintf(msg, sizeof(msg), "usec %s %s create to exit at max RSS",
+					stress_proclat_page_types[page_type], stress_proclat_methods[method]);
+				stress_metrics_set(args, idx + PROCLAT_EXIT, msg,
+					exited, STRESS_METRIC_GEOMETRIC_MEAN);
+			}
+		}
+	}
+	free(hists);
+tidy:
+	(void)munmap((void *)mem, proclat_rss + (2 * MB));
+	(void)munmap((void *)t_running, args->page_size);
+
+	return rc;
+}
+
+const stressor_info_t stress_proclat_info = {
+	.stressor = stress_proclat,
+	.class = CLASS_SCHEDULER | CLASS_OS,
+	.opts = opts,
+	.verify = VERIFY_ALWAYS,
+	.metrics_max = PROCLAT_PAGE_TYPES * PROCLAT_METHODS * PROCLAT_LATENCIES,
+	.help = help
+};
+#else
+const stressor_info_t stress_proclat_info = {
+	.stressor = stress_unimplemented,
+	.class = CLASS_SCHEDULER | CLASS_OS,
+	.opts = opts,
+	.verify = VERIFY_ALWAYS,
+	.help = help,
+	.unimplemented_reason = "only supported on Linux"
+};
+#endif
@@ -523,5 +523,6 @@ const stressor_info_t stress_pseek_info = {
 	.class = CLASS_IO | CLASS_FILESYSTEM | CLASS_OS,
 	.opts = opts,
 	.verify = VERIFY_ALWAYS,
+	.metrics_max = 2,
 	.help = help
 };
@@ -34,6 +34,12 @@
 #include <sys/prctl.h>
 #endif
 
+#if defined(HAVE_SEMAPHORE_H)
+#include <semaphore.h>
+#endif
+
+#include <sched.h>
+
 #define MIN_PTHREAD		(1)
 #define MAX_PTHREAD		(30000)
 #define DEFAULT_PTHREAD		(1024)
@@ -52,6 +58,7 @@
 
 static const stress_help_t help[] = {
 	{ NULL,	"pthread N",	 "start N workers that create multiple threads" },
+	{ NULL,	"pthread-bench", "compare thread create rate of pthread, mmap stack, clone and pooled threads" },
 	{ NULL,	"pthread-max P", "create P threads at a time by each worker" },
 	{ NULL,	"pthread-ops N", "stop pthread workers after N bogo threads created" },
 	{ NULL,	NULL,		 NULL }
@@ -82,6 +89,7 @@ static stress_pthread_info_t pthreads[MAX_PTHREAD];
 #endif
 
 static const stress_opt_t opts[] = {
+	{ OPT_pthread_bench, "pthread-bench", TYPE_ID_BOOL, 0, 1, NULL },
 	{ OPT_pthread_max, "pthread-max", TYPE_ID_UINT64, MIN_PTHREAD, MAX_PTHREAD, NULL },
 	END_OPT,
 };
@@ -422,6 +430,437 @@ die:
 	return &g_nowt;
 }
 
+/*
+ *  --pthread-bench thread creation methods
+ */
+#define PTHREAD_BENCH_BATCH_MAX		(256)	/* threads per batch */
+#define PTHREAD_BENCH_STACK_SIZE	(64 * KB)
+
+#if defined(__linux__) &&		\
+    defined(HAVE_CLONE) &&		\
+    defined(CLONE_VM) &&		\
+    defined(CLONE_FS) &&		\
+    defined(CLONE_FILES) &&		\
+    defined(CLONE_SIGHAND) &&		\
+    defined(CLONE_THREAD) &&		\
+    defined(CLONE_SYSVSEM) &&		\
+    defined(CLONE_CHILD_CLEARTID)
+#define STRESS_PTHREAD_BENCH_CLONE
+#endif
+
+#if defined(HAVE_SEM_POSIX) &&		\
+    defined(HAVE_SEMAPHORE_H)
+#define STRESS_PTHREAD_BENCH_POOL
+#endif
+
+enum {
+	PTHREAD_BENCH_DEFAULT,		/* pthread_create, glibc allocated stack */
+	PTHREAD_BENCH_STACK,		/* pthread_create, caller mmap'd stack */
+	PTHREAD_BENCH_CLONE,		/* clone() thread, caller mmap'd stack */
+	PTHREAD_BENCH_POOL,		/* hand off to an idle pooled thread */
+	PTHREAD_BENCH_MAX,
+};
+
+/* per thread slot, reused by each batch */
+typedef struct {
+	volatile double	t_create;	/* time when created or dispatched */
+	volatile double	t_run;		/* time when thread started running */
+	pthread_t pthread;		/* pthread or pool worker */
+	int	  ret;			/* pthread create return */
+#if defined(HAVE_PTHREAD_ATTR_SETSTACK)
+	pthread_attr_t attr;		/* attr with caller provided stack */
+	bool	  attr_ok;		/* attr initialized */
+#endif
+#if defined(STRESS_PTHREAD_BENCH_CLONE)
+	pid_t	  ctid;			/* cleared by the kernel on clone thread exit */
+#endif
+#if defined(STRESS_PTHREAD_BENCH_POOL)
+	sem_t	  go;			/* pool worker wakeup */
+	struct stress_pthread_bench *bench;
+#endif
+	void	  *stack;		/* caller provided stack */
+} stress_pthread_bench_slot_t;
+
+typedef struct stress_pthread_bench {
+	stress_pthread_bench_slot_t *slots;
+	size_t	n;			/* slots per batch */
+	size_t	n_pool;			/* pool workers running */
+	size_t	stack_size;		/* size of each caller provided stack */
+	void	*stacks;		/* mmap'd stacks, n * stack_size */
+#if defined(STRESS_PTHREAD_BENCH_POOL)
+	sem_t	done;			/* pool worker completions */
+	volatile bool pool_stop;	/* pool workers exit request */
+#endif
+	double	duration[PTHREAD_BENCH_MAX];	/* time in batches */
+	uint64_t threads[PTHREAD_BENCH_MAX];	/* threads run in batches */
+	double	latency[PTHREAD_BENCH_MAX];	/* sum of create to run times */
+	uint64_t latency_n[PTHREAD_BENCH_MAX];	/* number of latencies summed */
+} stress_pthread_bench_t;
+
+static const char * const stress_pthread_bench_names[PTHREAD_BENCH_MAX] = {
+	"pthread_create",
+	"mmap stack pthread_create",
+	"clone",
+	"thread pool",
+};
+
+/*
+ *  stress_pthread_bench_func()
+ *	pthread that just notes when it started running
+ */
+static void *stress_pthread_bench_func(void *arg)
+{
+	stress_pthread_bench_slot_t *slot = (stress_pthread_bench_slot_t *)arg;
+
+	slot->t_run = stress_time_now();
+	return NULL;
+}
+
+/*
+ *  stress_pthread_bench_join()
+ *	join the first n created pthreads of a batch
+ */
+static void stress_pthread_bench_join(stress_pthread_bench_t *bench, const size_t n)
+{
+	size_t i;
+
+	for (i = 0; i < n; i++)
+		(void)pthread_join(bench->slots[i].pthread, NULL);
+}
+
+/*
+ *  stress_pthread_bench_default()
+ *	create and join a batch of pthreads with glibc managed stacks
+ */
+static size_t stress_pthread_bench_default(stress_pthread_bench_t *bench)
+{
+	size_t i;
+
+	for (i = 0; i < bench->n; i++) {
+		stress_pthread_bench_slot_t *slot = &bench->slots[i];
+
+		slot->t_run = 0.0;
+		slot->t_create = stress_time_now();
+		if (UNLIKELY(pthread_create(&slot->pthread, NULL,
+				stress_pthread_bench_func, (void *)slot) != 0))
+			break;
+	}
+	stress_pthread_bench_join(bench, i);
+	return i;
+}
+
+/*
+ *  stress_pthread_bench_stack()
+ *	create and join a batch of pthreads on caller provided stacks,
+ *	avoids the glibc stack cache and guard page mprotect
+ */
+static size_t stress_pthread_bench_stack(stress_pthread_bench_t *bench)
+{
+#if defined(HAVE_PTHREAD_ATTR_SETSTACK)
+	size_t i;
+
+	for (i = 0; i < bench->n; i++) {
+		stress_pthread_bench_slot_t *slot = &bench->slots[i];
+
+		if (UNLIKELY(!slot->attr_ok))
+			break;
+		slot->t_run = 0.0;
+		slot->t_create = stress_time_now();
+		if (UNLIKELY(pthread_create(&slot->pthread, &slot->attr,
+				stress_pthread_bench_func, (void *)slot) != 0))
+			break;
+	}
+	stress_pthread_bench_join(bench, i);
+	return i;
+#else
+	(void)bench;
+
+	return 0;
+#endif
+}
+
+#if defined(STRESS_PTHREAD_BENCH_CLONE)
+/*
+ *  stress_pthread_bench_clone_func()
+ *	raw clone thread, no TLS of its own so only note the start time,
+ *	returning makes clone() exit just this thread
+ */
+static int stress_pthread_bench_clone_func(void *arg)
+{
+	stress_pthread_bench_slot_t *slot = (stress_pthread_bench_slot_t *)arg;
+
+	slot->t_run = stress_time_now();
+	return 0;
+}
+#endif
+
+/*
+ *  stress_pthread_bench_clone()
+ *	create a batch of raw clone() threads and wait for each to
+ *	exit using the futex the kernel clears on thread exit
+ */
+static size_t stress_pthread_bench_clone(stress_pthread_bench_t *bench)
+{
+#if defined(STRESS_PTHREAD_BENCH_CLONE)
+	const int flags = CLONE_VM | CLONE_FS | CLONE_FILES | CLONE_SIGHAND |
+			  CLONE_THREAD | CLONE_SYSVSEM | CLONE_CHILD_CLEARTID;
+	size_t i, j;
+
+	for (i = 0; i < bench->n; i++) {
+		stress_pthread_bench_slot_t *slot = &bench->slots[i];
+		char *stack_top = (char *)stress_get_stack_top(slot->stack, bench->stack_size);
+		pid_t tid;
+
+		slot->t_run = 0.0;
+		__atomic_store_n(&slot->ctid, -1, __ATOMIC_RELEASE);
+		slot->t_create = stress_time_now();
+		tid = clone(stress_pthread_bench_clone_func, stress_align_stack(stack_top),
+			flags, (void *)slot, NULL, NULL, &slot->ctid);
+		if (UNLIKELY(tid < 0))
+			break;
+	}
+	for (j = 0; j < i; j++) {
+		pid_t ctid;
+
+		while ((ctid = __atomic_load_n(&bench->slots[j].ctid, __ATOMIC_ACQUIRE)) != 0)
+			(void)shim_futex_wait(&bench->slots[j].ctid, ctid, NULL);
+	}
+	return i;
+#else
+	(void)bench;
+
+	return 0;
+#endif
+}
+
+#if defined(STRESS_PTHREAD_BENCH_POOL)
+/*
+ *  stress_pthread_bench_pool_func()
+ *	pooled thread, note the start time of each dispatch
+ */
+static void *stress_pthread_bench_pool_func(void *arg)
+{
+	stress_pthread_bench_slot_t *slot = (stress_pthread_bench_slot_t *)arg;
+	stress_pthread_bench_t *bench = slot->bench;
+
+	for (;;) {
+		if (sem_wait(&slot->go) < 0) {
+			if (errno == EINTR)
+				continue;
+			break;
+		}
+		if (bench->pool_stop)
+			break;
+		slot->t_run = stress_time_now();
+		(void)sem_post(&bench->done);
+	}
+	return NULL;
+}
+#endif
+
+/*
+ *  stress_pthread_bench_pool()
+ *	dispatch a batch of work to idle pooled threads and wait
+ *	for them all to run
+ */
+static size_t stress_pthread_bench_pool(stress_pthread_bench_t *bench)
+{
+#if defined(STRESS_PTHREAD_BENCH_POOL)
+	size_t i, j;
+
+	for (i = 0; i < bench->n_pool; i++) {
+		stress_pthread_bench_slot_t *slot = &bench->slots[i];
+
+		slot->t_run = 0.0;
+		slot->t_create = stress_time_now();
+		if (UNLIKELY(sem_post(&slot->go) < 0))
+			break;
+	}
+	for (j = 0; j < i; j++) {
+		while (sem_wait(&bench->done) < 0) {
+			if (errno != EINTR)
+				return j;
+		}
+	}
+	return i;
+#else
+	(void)bench;
+
+	return 0;
+#endif
+}
+
+/*
+ *  stress_pthread_bench_pool_start()
+ *	start the pooled threads that are reused for every dispatch
+ */
+static void stress_pthread_bench_pool_start(stress_pthread_bench_t *bench)
+{
+#if defined(STRESS_PTHREAD_BENCH_POOL)
+	size_t i;
+
+	bench->pool_stop = false;
+	if (sem_init(&bench->done, 0, 0) < 0)
+		return;
+	for (i = 0; i < bench->n; i++) {
+		stress_pthread_bench_slot_t *slot = &bench->slots[i];
+
+		slot->bench = bench;
+		if (sem_init(&slot->go, 0, 0) < 0)
+			break;
+		if (pthread_create(&slot->pthread, NULL,
+				stress_pthread_bench_pool_func, (void *)slot) != 0) {
+			(void)sem_destroy(&slot->go);
+			break;
+		}
+	}
+	bench->n_pool = i;
+#else
+	(void)bench;
+#endif
+}
+
+/*
+ *  stress_pthread_bench_pool_stop()
+ *	stop and reap the pooled threads
+ */
+static void stress_pthread_bench_pool_stop(stress_pthread_bench_t *bench)
+{
+#if defined(STRESS_PTHREAD_BENCH_POOL)
+	size_t i;
+
+	bench->pool_stop = true;
+	for (i = 0; i < bench->n_pool; i++)
+		(void)sem_post(&bench->slots[i].go);
+	for (i = 0; i < bench->n_pool; i++) {
+		(void)pthread_join(bench->slots[i].pthread, NULL);
+		(void)sem_destroy(&bench->slots[i].go);
+	}
+	(void)sem_destroy(&bench->done);
+	bench->n_pool = 0;
+#else
+	(void)bench;
+#endif
+}
+
+/*
+ *  stress_pthread_bench_batch()
+ *	run a batch of threads with method, accumulating the time
+ *	taken and the create to run latencies
+ */
+static void stress_pthread_bench_batch(
+	stress_args_t *args,
+	stress_pthread_bench_t *bench,
+	const int method,
+	size_t (*func)(stress_pthread_bench_t *bench))
+{
+	const double t = stress_time_now();
+	const size_t n = func(bench);
+	size_t i;
+
+	bench->duration[method] += stress_time_now() - t;
+	bench->threads[method] += n;
+	for (i = 0; i < n; i++) {
+		const double lat = bench->slots[i].t_run - bench->slots[i].t_create;
+
+		if (lat > 0.0) {
+			bench->latency[method] += lat;
+			bench->latency_n[method]++;
+		}
+	}
+	stress_bogo_add(args, n);
+}
+
+/*
+ *  stress_pthread_bench()
+ *	compare thread creation rate and create to run latency of
+ *	pthread_create with glibc and caller provided stacks, raw clone()
+ *	threads and dispatching to a pool of reused threads, running a
+ *	batch of each method in turn until the run ends
+ */
+static int stress_pthread_bench(stress_args_t *args, const uint64_t pthread_max)
+{
+	stress_pthread_bench_t bench;
+	size_t i;
+	int m;
+
+	(void)shim_memset(&bench, 0, sizeof(bench));
+	bench.n = (size_t)STRESS_MINIMUM(pthread_max, PTHREAD_BENCH_BATCH_MAX);
+	bench.stack_size = STRESS_MAXIMUM(PTHREAD_BENCH_STACK_SIZE, stress_get_min_pthread_stack_size());
+	bench.slots = (stress_pthread_bench_slot_t *)calloc(bench.n, sizeof(*bench.slots));
+	if (!bench.slots) {
+		pr_inf_skip("%s: cannot allocate %zu thread slots, skipping stressor\n",
+			args->name, bench.n);
+		return EXIT_NO_RESOURCE;
+	}
+	bench.stacks = stress_mmap_populate(NULL, bench.n * bench.stack_size,
+		PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (bench.stacks == MAP_FAILED) {
+		pr_inf_skip("%s: cannot mmap %zu thread stacks, skipping stressor\n",
+			args->name, bench.n);
+		free(bench.slots);
+		return EXIT_NO_RESOURCE;
+	}
+	stress_set_vma_anon_name(bench.stacks, bench.n * bench.stack_size, "pthread-stacks");
+	for (i = 0; i < bench.n; i++) {
+		stress_pthread_bench_slot_t *slot = &bench.slots[i];
+
+		slot->stack = (void *)((uintptr_t)bench.stacks + (i * bench.stack_size));
+#if defined(HAVE_PTHREAD_ATTR_SETSTACK)
+		if (pthread_attr_init(&slot->attr) == 0) {
+			slot->attr_ok = (pthread_attr_setstack(&slot->attr,
+				slot->stack, bench.stack_size) == 0);
+			if (!slot->attr_ok)
+				(void)pthread_attr_destroy(&slot->attr);
+		}
+#endif
+	}
+	stress_pthread_bench_pool_start(&bench);
+	if (args->instance == 0)
+		pr_dbg("%s: %zu threads per batch, %zu pooled threads\n",
+			args->name, bench.n, bench.n_pool);
+
+	stress_set_proc_state(args->name, STRESS_STATE_SYNC_WAIT);
+	stress_sync_start_wait(args);
+	stress_set_proc_state(args->name, STRESS_STATE_RUN);
+
+	do {
+		stress_pthread_bench_batch(args, &bench, PTHREAD_BENCH_DEFAULT, stress_pthread_bench_default);
+		stress_pthread_bench_batch(args, &bench, PTHREAD_BENCH_STACK, stress_pthread_bench_stack);
+		stress_pthread_bench_batch(args, &bench, PTHREAD_BENCH_CLONE, stress_pthread_bench_clone);
+		stress_pthread_bench_batch(args, &bench, PTHREAD_BENCH_POOL, stress_pthread_bench_pool);
+	} while (keep_running() && stress_continue(args));
+
+	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
+	stress_pthread_bench_pool_stop(&bench);
+
+	for (m = 0; m < PTHREAD_BENCH_MAX; m++) {
+		char msg[64];
+
+		if (!bench.threads[m])
+			continue;
+		(void)snprintf(msg, sizeof(msg), "%s threads per sec", stress_pthread_bench_names[m]);
+		stress_metrics_set(args, 2 + (2 * m), msg,
+			(bench.duration[m] > 0.0) ? (double)bench.threads[m] / bench.duration[m] : 0.0,
+			STRESS_METRIC_HARMONIC_MEAN);
+		(void)snprintf(msg, sizeof(msg), "%s nanosecs create to run", stress_pthread_bench_names[m]);
+		stress_metrics_set(args, 3 + (2 * m), msg,
+			bench.latency_n[m] ? (bench.latency[m] * STRESS_DBL_NANOSECOND) / (double)bench.latency_n[m] : 0.0,
+			STRESS_METRIC_HARMONIC_MEAN);
+	}
+
+#if defined(HAVE_PTHREAD_ATTR_SETSTACK)
+	for (i = 0; i < bench.n; i++) {
+		if (bench.slots[i].attr_ok)
+			(void)pthread_attr_destroy(&bench.slots[i].attr);
+	}
+#endif
+	(void)munmap(bench.stacks, bench.n * bench.stack_size);
+	free(bench.slots);
+
+	return EXIT_SUCCESS;
+}
+
 /*
  *  stress_pthread()
  *	stress by creating pthreads
@@ -432,6 +871,7 @@ static int stress_pthread(stress_args_t *args)
 	bool locked = false;
 	uint64_t limited = 0, attempted = 0, maximum = 0;
 	uint64_t pthread_max = DEFAULT_PTHREAD;
+	bool pthread_bench = false;
 	int ret;
 	stress_pthread_args_t pargs = { args, NULL, 0 };
 	sigset_t set;
@@ -465,6 +905,9 @@ static int stress_pthread(stress_args_t *args)
 		if (g_opt_flags & OPT_FLAGS_MINIMIZE)
 			pthread_max = MIN_PTHREAD;
 	}
+	(void)stress_get_setting("pthread-bench", &pthread_bench);
+	if (pthread_bench)
+		return stress_pthread_bench(args, pthread_max);
 
 	ret = pthread_cond_init(&cond, NULL);
 	if (ret) {
@@ -707,6 +1150,7 @@ const stressor_info_t stress_pthread_info = {
 	.class = CLASS_SCHEDULER | CLASS_OS,
 	.opts = opts,
 	.verify = VERIFY_ALWAYS,
+	.metrics_max = 2 + (2 * PTHREAD_BENCH_MAX),
 	.help = help
 };
 #else
@@ -18,6 +18,10 @@
  */
 #include "stress-ng.h"
 #include "core-builtin.h"
+#include "core-cpu-cache.h"
+#include "core-madvise.h"
+#include "core-mmap.h"
+#include "core-put.h"
 
 #define MIN_NEXT_PTRS_4K_PAGES		(64)
 #define MAX_NEXT_PTRS_4K_PAGES		(256 * 1024)
@@ -26,9 +30,21 @@
 
 #define PTRS_PER_4K_PAGE		(PAGE_SIZE_4K / sizeof(void *))	/* Must be power of 2 */
 
+#define MIN_PTR_CHASE_CURVE_SIZE	(16 * KB)
+#define MAX_PTR_CHASE_CURVE_SIZE	(MAX_MEM_LIMIT)
+#define PTR_CHASE_CURVE_START		(4 * KB)
+#define PTR_CHASE_CURVE_MAX_POINTS	(64)
+#define PTR_CHASE_CURVE_MAX_LEVELS	(5)
+#define PTR_CHASE_CURVE_MIN_LOADS	(1U << 20)
+#define PTR_CHASE_CURVE_MIN_TIME	(0.01)
+#define PTR_CHASE_CURVE_UNROLL		(16)
+
 static const stress_help_t help[] = {
 	{ NULL,	"ptr-chase N",	 	"start N workers that chase pointers around many nodes" },
 	{ NULL,	"ptr-chase-ops N",	"stop after N bogo pointer chase operations" },
+	{ NULL,	"ptr-chase-curve",	"measure load latency over a sweep of working set sizes" },
+	{ NULL,	"ptr-chase-hugepages",	"use huge pages for --ptr-chase-curve buffer" },
+	{ NULL,	"ptr-chase-max-size N",	"maximum working set size for --ptr-chase-curve" },
 	{ NULL,	"ptr-chase-pages N",	"N is the number of pages for nodes of pointers" },
 	{ NULL,	NULL,		 	NULL }
 };
@@ -38,11 +54,316 @@ typedef struct stress_ptrs {
 	struct stress_ptrs *next[PTRS_PER_4K_PAGE];
 } stress_ptrs_t;
 
+typedef struct {
+	size_t size;		/* working set size in bytes */
+	double ns;		/* best nanoseconds per dependent load */
+} stress_ptr_chase_point_t;
+
 static const stress_opt_t opts[] = {
-	{ OPT_ptr_chase_pages, "ptr-chase-pages", TYPE_ID_UINT64, MIN_NEXT_PTRS_4K_PAGES, MAX_NEXT_PTRS_4K_PAGES, NULL },
+	{ OPT_ptr_chase_curve,	  "ptr-chase-curve",	 TYPE_ID_BOOL, 0, 1, NULL },
+	{ OPT_ptr_chase_hugepages,"ptr-chase-hugepages", TYPE_ID_BOOL, 0, 1, NULL },
+	{ OPT_ptr_chase_max_size, "ptr-chase-max-size",	 TYPE_ID_SIZE_T_BYTES_VM, MIN_PTR_CHASE_CURVE_SIZE, MAX_PTR_CHASE_CURVE_SIZE, NULL },
+	{ OPT_ptr_chase_pages,	  "ptr-chase-pages",	 TYPE_ID_UINT64, MIN_NEXT_PTRS_4K_PAGES, MAX_NEXT_PTRS_4K_PAGES, NULL },
 	END_OPT,
 };
 
+/*
+ *  stress_ptr_chase_loads()
+ *	follow a chain of dependent loads, loads must be
+ *	a multiple of PTR_CHASE_CURVE_UNROLL
+ */
+static void * OPTIMIZE3 stress_ptr_chase_loads(void *start, const size_t loads)
+{
+	register void **ptr = (void **)start;
+	register size_t i;
+
+	for (i = 0; i < loads; i += PTR_CHASE_CURVE_UNROLL) {
+		ptr = (void **)*ptr;
+		ptr = (void **)*ptr;
+		ptr = (void **)*ptr;
+		ptr = (void **)*ptr;
+		ptr = (void **)*ptr;
+		ptr = (void **)*ptr;
+		ptr = (void **)*ptr;
+		ptr = (void **)*ptr;
+		ptr = (void **)*ptr;
+		ptr = (void **)*ptr;
+		ptr = (void **)*ptr;
+		ptr = (void **)*ptr;
+		ptr = (void **)*ptr;
+		ptr = (void **)*ptr;
+		ptr = (void **)*ptr;
+		ptr = (void **)*ptr;
+	}
+	return (void *)ptr;
+}
+
+/*
+ *  stress_ptr_chase_chain()
+ *	link the first lines cache lines of buffer into a single
+ *	randomly ordered cycle (Sattolo's algorithm) so that the
+ *	hardware prefetchers cannot predict the next load
+ */
+static void stress_ptr_chase_chain(
+	uint8_t *buffer,
+	uint32_t *perm,
+	const size_t lines,
+	const size_t line_size)
+{
+	size_t i;
+
+	for (i = 0; i < lines; i++)
+		perm[i] = (uint32_t)i;
+	for (i = lines - 1; i > 0; i--) {
+		const size_t j = (size_t)stress_mwc32modn((uint32_t)i);
+		const uint32_t tmp = perm[i];
+
+		perm[i] = perm[j];
+		perm[j] = tmp;
+	}
+	for (i = 0; i < lines; i++) {
+		void **line = (void **)(buffer + ((size_t)perm[i] * line_size));
+
+		*line = (void *)(buffer + ((size_t)perm[(i + 1) % lines] * line_size));
+	}
+}
+
+/*
+ *  stress_ptr_chase_curve_sizes()
+ *	working set sizes, two points per power of 2 from 4K up to max_size
+ */
+static size_t stress_ptr_chase_curve_sizes(
+	stress_ptr_chase_point_t *points,
+	const size_t max_size)
+{
+	size_t size, n = 0;
+
+	for (size = PTR_CHASE_CURVE_START; size <= max_size; size <<= 1) {
+		if (n >= PTR_CHASE_CURVE_MAX_POINTS)
+			break;
+		points[n].size = size;
+		points[n].ns = 0.0;
+		n++;
+		if (((size + (size >> 1)) <= max_size) && (n < PTR_CHASE_CURVE_MAX_POINTS)) {
+			points[n].size = size + (size >> 1);
+			points[n].ns = 0.0;
+			n++;
+		}
+	}
+	return n;
+}
+
+/*
+ *  stress_ptr_chase_curve()
+ *	lmbench lat_mem_rd style load latency curve, sweep the
+ *	working set size from 4K to beyond the last level cache
+ *	and measure the time per dependent load for each size
+ */
+static int stress_ptr_chase_curve(stress_args_t *args)
+{
+	stress_ptr_chase_point_t points[PTR_CHASE_CURVE_MAX_POINTS];
+	uint64_t cache_size[PTR_CHASE_CURVE_MAX_LEVELS + 1];
+	stress_cpu_cache_cpus_t *cpu_caches;
+	size_t max_size = 0, llc_size = 0, line_size = 0;
+	size_t i, n_points, perm_size, metric = 0;
+	uint16_t level, max_level = 0;
+	bool ptr_chase_hugepages = false;
+	const bool verify = !!(g_opt_flags & OPT_FLAGS_VERIFY);
+	uint8_t *buffer;
+	uint32_t *perm;
+	size_t buffer_sz;
+	char str[32], desc[64];
+	int rc = EXIT_SUCCESS;
+
+	(void)stress_get_setting("ptr-chase-hugepages", &ptr_chase_hugepages);
+
+	(void)shim_memset(cache_size, 0, sizeof(cache_size));
+	cpu_caches = stress_cpu_cache_get_all_details();
+	if (cpu_caches) {
+		max_level = stress_cpu_cache_get_max_level(cpu_caches);
+		if (max_level > PTR_CHASE_CURVE_MAX_LEVELS)
+			max_level = PTR_CHASE_CURVE_MAX_LEVELS;
+		for (level = 1; level <= max_level; level++) {
+			const stress_cpu_cache_t *cache = stress_cpu_cache_get(cpu_caches, level);
+
+			if (cache)
+				cache_size[level] = cache->size;
+		}
+		stress_free_cpu_caches(cpu_caches);
+	}
+	stress_cpu_cache_get_llc_size(&llc_size, &line_size);
+	if (line_size < sizeof(void *))
+		line_size = 64;
+
+	if (!stress_get_setting("ptr-chase-max-size", &max_size)) {
+		/* go well beyond the LLC into DRAM */
+		max_size = (llc_size > 0) ? llc_size * 4 : 256 * MB;
+		if (max_size < 64 * MB)
+			max_size = 64 * MB;
+		if (max_size > GB)
+			max_size = GB;
+		if (g_opt_flags & OPT_FLAGS_MINIMIZE)
+			max_size = MIN_PTR_CHASE_CURVE_SIZE;
+	}
+	/* chain indices are 32 bit */
+	if ((max_size / line_size) > UINT32_MAX)
+		max_size = (size_t)UINT32_MAX * line_size;
+
+	n_points = stress_ptr_chase_curve_sizes(points, max_size);
+	max_size = points[n_points - 1].size;
+
+	/* map unpopulated, the page size advice must precede the page faults */
+	buffer = (uint8_t *)stress_mmap_hugetlb(args, max_size,
+				PROT_READ | PROT_WRITE,
+				MAP_ANONYMOUS | MAP_PRIVATE, false, &buffer_sz);
+	if (buffer == MAP_FAILED) {
+		pr_inf_skip("%s: mmap allocation of %zu bytes failed, "
+			"errno=%d (%s), skipping stressor\n",
+			args->name, max_size, errno, strerror(errno));
+		return EXIT_NO_RESOURCE;
+	}
+	stress_set_vma_anon_name(buffer, max_size, "ptr-chase-curve");
+#if defined(HAVE_MADVISE) &&	\
+    defined(MADV_HUGEPAGE) &&	\
+    defined(MADV_NOHUGEPAGE)
+	/* explicitly select page size to separate TLB from cache effects */
+	(void)madvise((void *)buffer, max_size,
+		ptr_chase_hugepages ? MADV_HUGEPAGE : MADV_NOHUGEPAGE);
+#else
+	if (ptr_chase_hugepages && (args->instance == 0))
+		pr_inf("%s: huge pages not supported, using default page size\n",
+			args->name);
+#endif
+	stress_mmap_populate_range((void *)buffer, max_size, PROT_READ | PROT_WRITE);
+
+	perm_size = (max_size / line_size) * sizeof(*perm);
+	perm = (uint32_t *)stress_mmap_populate(NULL, perm_size,
+				PROT_READ | PROT_WRITE,
+				MAP_ANONYMOUS | MAP_PRIVATE, -1, 0);
+	if (perm == MAP_FAILED) {
+		pr_inf_skip("%s: mmap allocation of %zu bytes failed, "
+			"errno=%d (%s), skipping stressor\n",
+			args->name, perm_size, errno, strerror(errno));
+		(void)munmap((void *)buffer, buffer_sz);
+		return EXIT_NO_RESOURCE;
+	}
+	stress_set_vma_anon_name(perm, perm_size, "ptr-chase-perm");
+
+	if (args->instance == 0)
+		pr_dbg("%s: latency curve of %zu sizes from 4K to %s, %zu byte cache lines, %s pages\n",
+			args->name, n_points, stress_uint64_to_str(str, sizeof(str), (uint64_t)max_size),
+			line_size, ptr_chase_hugepages ? "huge" : "small");
+
+	stress_set_proc_state(args->name, STRESS_STATE_SYNC_WAIT);
+	stress_sync_start_wait(args);
+	stress_set_proc_state(args->name, STRESS_STATE_RUN);
+
+	do {
+		for (i = 0; i < n_points; i++) {
+			const size_t lines = points[i].size / line_size;
+			size_t loads = 0, chunk;
+			double t, duration, ns;
+			void *ptr = (void *)buffer;
+
+			stress_ptr_chase_chain(buffer, perm, lines, line_size);
+
+			if (verify) {
+				/* a full cycle of the chain must end where it started */
+				size_t j;
+
+				for (j = 0; j < lines; j++)
+					ptr = *(void **)ptr;
+				if (ptr != (void *)buffer) {
+					pr_fail("%s: pointer chain of %zu cache lines is "
+						"not a single cycle\n", args->name, lines);
+					rc = EXIT_FAILURE;
+					goto tidy;
+				}
+			}
+
+			/* warm up caches and TLB */
+			chunk = (lines + PTR_CHASE_CURVE_UNROLL - 1) & ~(size_t)(PTR_CHASE_CURVE_UNROLL - 1);
+			ptr = stress_ptr_chase_loads(ptr, chunk);
+			if (chunk < 4096)
+				chunk = 4096;
+
+			t = stress_time_now();
+			do {
+				ptr = stress_ptr_chase_loads(ptr, chunk);
+				loads += chunk;
+				duration = stress_time_now() - t;
+			} while (((loads < PTR_CHASE_CURVE_MIN_LOADS) ||
+				  (duration < PTR_CHASE_CURVE_MIN_TIME)) &&
+				 stress_continue_flag());
+			stress_void_ptr_put(ptr);
+
+			ns = (duration * STRESS_DBL_NANOSECOND) / (double)loads;
+			if ((points[i].ns <= 0.0) || (ns < points[i].ns))
+				points[i].ns = ns;
+			stress_bogo_inc(args);
+			if (!stress_continue(args))
+				break;
+		}
+	} while (stress_continue(args));
+
+	pr_block_begin();
+	for (i = 0; i < n_points; i++) {
+		const char *knee = "";
+
+		if (points[i].ns <= 0.0)
+			continue;
+
+		(void)stress_uint64_to_str(str, sizeof(str), (uint64_t)points[i].size);
+		(void)snprintf(desc, sizeof(desc), "ns per load %s working set", str);
+		stress_metrics_set(args, metric++, desc,
+			points[i].ns, STRESS_METRIC_GEOMETRIC_MEAN);
+
+		if (args->instance != 0)
+			continue;
+		/* annotate the first size that exceeds each cache level */
+		for (level = 1; level <= max_level; level++) {
+			if (cache_size[level] &&
+			    (points[i].size > cache_size[level]) &&
+			    ((i == 0) || (points[i - 1].size <= cache_size[level]))) {
+				(void)snprintf(desc, sizeof(desc), " <- exceeds L%" PRIu16 " (%s)",
+					level, stress_uint64_to_str(str, sizeof(str), cache_size[level]));
+				knee = desc;
+			}
+		}
+		pr_inf("%s: %10zu bytes %8.2f ns per load%s\n",
+			args->name, points[i].size, points[i].ns, knee);
+	}
+
+	/* per level latency estimate, largest size within half the cache size */
+	for (level = 1; level <= max_level; level++) {
+		double ns = 0.0;
+
+		/* need the curve to go beyond the cache for a meaningful estimate */
+		if (!cache_size[level] || (max_size <= cache_size[level]))
+			continue;
+		for (i = 0; i < n_points; i++) {
+			if ((points[i].size <= cache_size[level] / 2) && (points[i].ns > 0.0))
+				ns = points[i].ns;
+		}
+		if (ns > 0.0) {
+			(void)snprintf(desc, sizeof(desc), "ns per load L%" PRIu16 " cache", level);
+			stress_metrics_set(args, metric++, desc, ns, STRESS_METRIC_GEOMETRIC_MEAN);
+		}
+	}
+	if ((llc_size > 0) && (points[n_points - 1].size >= llc_size * 2) &&
+	    (points[n_points - 1].ns > 0.0))
+		stress_metrics_set(args, metric++, "ns per load memory",
+			points[n_points - 1].ns, STRESS_METRIC_GEOMETRIC_MEAN);
+	pr_block_end();
+
+tidy:
+	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
+	(void)munmap((void *)perm, perm_size);
+	(void)munmap((void *)buffer, buffer_sz);
+
+	return rc;
+}
+
 /*
  *  stress_ptr_chase()
  *	stress list
@@ -57,9 +378,14 @@ static int stress_ptr_chase(stress_args_t *args)
 	register uintptr_t ptr_mask = ~(uintptr_t)1;
 	register stress_ptrs_t *ptr;
 	size_t ptrs_size, total = 0, visited = 0;
-	size_t alloc_size;
+	size_t alloc_size, mmap_size;
 	double metric, t_start, duration;
 	uint64_t counter;
+	bool ptr_chase_curve = false;
+
+	(void)stress_get_setting("ptr-chase-curve", &ptr_chase_curve);
+	if (ptr_chase_curve)
+		return stress_ptr_chase_curve(args);
 
 	if (!stress_get_setting("ptr-chase-pages", &ptr_chase_pages)) {
 		if (g_opt_flags & OPT_FLAGS_MAXIMIZE)
@@ -77,10 +403,10 @@ static int stress_ptr_chase(stress_args_t *args)
 			args->name, alloc_size);
 		return EXIT_NO_RESOURCE;
 	}
-	ptrs_mmap = (stress_ptrs_t *)stress_mmap_populate(NULL, alloc_size,
+	ptrs_mmap = (stress_ptrs_t *)stress_mmap_hugetlb(args, alloc_size,
 					PROT_READ | PROT_WRITE,
 					MAP_ANONYMOUS | MAP_PRIVATE,
-					-1, 0);
+					true, &mmap_size);
 	if (ptrs_mmap == MAP_FAILED) {
 		pr_inf_skip("%s: mmap allocating of %zu bytes failed, "
 			"errno=%d (%s), skipping stressor\n",
@@ -168,7 +494,7 @@ static int stress_ptr_chase(stress_args_t *args)
 	(void)munmap((void *)ptrs, ptrs_size);
 
 tidy_ptrs_mmap:
-	(void)munmap((void *)ptrs_mmap, alloc_size);
+	(void)munmap((void *)ptrs_mmap, mmap_size);
 
 tidy_ptrs_heap:
 	free(ptrs_heap);
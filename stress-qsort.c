@@ -29,6 +29,9 @@
 #define MAX_QSORT_SIZE		(4 * MB)
 #define DEFAULT_QSORT_SIZE	(256 * KB)
 
+#define MIN_QSORT_THREADS	(0)
+#define MAX_QSORT_THREADS	(256)
+
 static volatile bool do_jmp = true;
 static sigjmp_buf jmp_env;
 
@@ -40,6 +43,7 @@ static const stress_help_t help[] = {
 	{ NULL,	"qsort-method M",	"select qsort method [ qsort-libc | qsort_bm ]" },
 	{ NULL,	"qsort-ops N",		"stop after N qsort bogo operations" },
 	{ NULL,	"qsort-size N",		"number of 32 bit integers to sort" },
+	{ NULL,	"qsort-threads N",	"sort in parallel using a sample sort over N threads" },
 	{ NULL,	NULL,			NULL }
 };
 
@@ -271,6 +275,19 @@ fail:
 	return false;
 }
 
+static qsort_func_t stress_qsort_par_func;
+
+/*
+ *  stress_qsort_par_sort()
+ *	sort a bucket of the parallel sort with the selected method
+ */
+static int stress_qsort_par_sort(int32_t *data, const size_t n, const bool reverse)
+{
+	stress_qsort_par_func(data, n, sizeof(*data),
+		reverse ? stress_sort_cmp_rev_int32 : stress_sort_cmp_fwd_int32);
+	return 0;
+}
+
 /*
  *  stress_qsort()
  *	stress qsort
@@ -278,6 +295,7 @@ fail:
 static int OPTIMIZE3 stress_qsort(stress_args_t *args)
 {
 	uint64_t qsort_size = DEFAULT_QSORT_SIZE;
+	uint32_t qsort_threads = 0;
 	int32_t *data;
 	size_t n, data_size, qsort_method = 0;
 	struct sigaction old_action;
@@ -290,6 +308,7 @@ static int OPTIMIZE3 stress_qsort(stress_args_t *args)
 	stress_catch_sigill();
 
 	(void)stress_get_setting("qsort-method", &qsort_method);
+	(void)stress_get_setting("qsort-threads", &qsort_threads);
 	if (!stress_get_setting("qsort-size", &qsort_size)) {
 		if (g_opt_flags & OPT_FLAGS_MAXIMIZE)
 			qsort_size = MAX_QSORT_SIZE;
@@ -309,6 +328,17 @@ static int OPTIMIZE3 stress_qsort(stress_args_t *args)
 	(void)stress_madvise_collapse(data, data_size);
 	stress_set_vma_anon_name(data, data_size, "qsort-data");
 
+	if (qsort_threads > 0) {
+		stress_qsort_par_func = stress_qsort_methods[qsort_method].qsort_func;
+		if (args->instance == 0)
+			pr_inf("%s: using method '%s' on %" PRIu32 " threads\n",
+				args->name, stress_qsort_methods[qsort_method].name, qsort_threads);
+		stress_sort_data_int32_init(data, n);
+		rc = stress_sort_int32_parallel(args, data, n, qsort_threads, stress_qsort_par_sort);
+		(void)munmap((void *)data, data_size);
+		return rc;
+	}
+
 	ret = sigsetjmp(jmp_env, 1);
 	if (ret) {
 		/*
@@ -411,8 +441,9 @@ static const char *stress_qsort_method(const size_t i)
 }
 
 static const stress_opt_t opts[] = {
-	{ OPT_qsort_size,   "qsort-size",   TYPE_ID_UINT64, MIN_QSORT_SIZE, MAX_QSORT_SIZE, NULL },
-	{ OPT_qsort_method, "qsort-method", TYPE_ID_SIZE_T_METHOD, 0, 0, stress_qsort_method },
+	{ OPT_qsort_size,    "qsort-size",    TYPE_ID_UINT64, MIN_QSORT_SIZE, MAX_QSORT_SIZE, NULL },
+	{ OPT_qsort_method,  "qsort-method",  TYPE_ID_SIZE_T_METHOD, 0, 0, stress_qsort_method },
+	{ OPT_qsort_threads, "qsort-threads", TYPE_ID_UINT32, MIN_QSORT_THREADS, MAX_QSORT_THREADS, NULL },
 	END_OPT,
 };
 
@@ -421,5 +452,6 @@ const stressor_info_t stress_qsort_info = {
 	.class = CLASS_CPU_CACHE | CLASS_CPU | CLASS_MEMORY | CLASS_SORT,
 	.opts = opts,
 	.verify = VERIFY_OPTIONAL,
+	.metrics_max = 3,
 	.help = help
 };
@@ -18,18 +18,21 @@
  *
  */
 #include "stress-ng.h"
+#include "core-asm-x86.h"
 #include "core-builtin.h"
 #include "core-cpu-cache.h"
+#include "core-nt-store.h"
 
 #define MIN_RADIXSORT_SIZE	(1 * KB)
-#define MAX_RADIXSORT_SIZE	(4 * MB)
+#define MAX_RADIXSORT_SIZE	(64 * MB)
+#define MAX_RADIXSORT_STR_SIZE	(4 * MB)
 #define DEFAULT_RADIXSORT_SIZE	(256 * KB)
 
 static const stress_help_t help[] = {
 	{ NULL,	"radixsort N",		"start N workers radix sorting random strings" },
-	{ NULL,	"radixsort-method M",	"select sort method [ radixsort-libc | radixsort-nonlibc]" },
+	{ NULL,	"radixsort-method M",	"select sort method [ radixsort-libc | radixsort-nonlibc | radixsort-lsd32 | radixsort-lsd64 ]" },
 	{ NULL,	"radixsort-ops N",	"stop after N radixsort bogo operations" },
-	{ NULL,	"radixsort-size N",	"number of strings to sort" },
+	{ NULL,	"radixsort-size N",	"number of strings or integer keys to sort" },
 	{ NULL,	NULL,			NULL }
 };
 
@@ -38,6 +41,7 @@ typedef int (*radixsort_func_t)(const unsigned char **base, int nmemb, const uns
 typedef struct {
 	const char *name;
 	const radixsort_func_t radixsort_func;
+	const size_t key_bytes;		/* integer key size, 0 for strings */
 } stress_radixsort_method_t;
 
 #define STR_SIZE	(8)
@@ -151,11 +155,238 @@ static int radixsort_nonlibc(
 	return 0;
 }
 
+/*
+ *  LSD radix sort of 32 and 64 bit integer keys, 8 bit digits. The
+ *  digit histograms for all the passes are gathered in a single read
+ *  of the keys, passes where all keys share the same digit are skipped
+ *  and each pass scatters the keys through 256 cache line sized
+ *  software write-combining buffers that are flushed to the destination
+ *  with non-temporal stores when full.
+ */
+#define RADIX_LSD_LINE_SIZE	(64)
+#define RADIX_LSD_BUCKETS	(256)
+
+/*
+ *  radix_lsd_flush_line()
+ *	write a full 64 byte write-combining buffer to dst
+ */
+static inline void ALWAYS_INLINE radix_lsd_flush_line(void *dst, const void *src)
+{
+#if defined(HAVE_NT_STORE128)
+	__uint128_t *d = (__uint128_t *)dst;
+	const __uint128_t *s = (const __uint128_t *)src;
+
+	stress_nt_store128(d + 0, s[0]);
+	stress_nt_store128(d + 1, s[1]);
+	stress_nt_store128(d + 2, s[2]);
+	stress_nt_store128(d + 3, s[3]);
+#else
+	(void)shim_memcpy(dst, src, RADIX_LSD_LINE_SIZE);
+#endif
+}
+
+#define RADIX_LSD_SORT(bits, type)						\
+static void OPTIMIZE3 radixsort_lsd ## bits(					\
+	type *data,								\
+	type *tmp,								\
+	const size_t n)								\
+{										\
+	enum { LINE = RADIX_LSD_LINE_SIZE / sizeof(type) };			\
+	size_t hist[sizeof(type)][RADIX_LSD_BUCKETS];				\
+	size_t pos[RADIX_LSD_BUCKETS], start[RADIX_LSD_BUCKETS];		\
+	type wc[RADIX_LSD_BUCKETS][LINE] ALIGN64;				\
+	type *src = data, *dst = tmp;						\
+	size_t i, pass;								\
+										\
+	if (n < 2)								\
+		return;								\
+										\
+	(void)shim_memset(hist, 0, sizeof(hist));				\
+	for (i = 0; i < n; i++) {						\
+		register type v = data[i];					\
+		register size_t d;						\
+										\
+		for (d = 0; d < sizeof(type); d++, v >>= 8)			\
+			hist[d][v & 0xff]++;					\
+	}									\
+										\
+	for (pass = 0; pass < sizeof(type); pass++) {				\
+		const int shift = (int)(pass * 8);				\
+		size_t b, offset = 0;						\
+		type *swap;							\
+										\
+		/* all keys have the same digit, nothing to do */		\
+		if (hist[pass][(src[0] >> shift) & 0xff] == n)			\
+			continue;						\
+		for (b = 0; b < RADIX_LSD_BUCKETS; b++) {			\
+			pos[b] = offset;					\
+			start[b] = offset;					\
+			offset += hist[pass][b];				\
+		}								\
+		for (i = 0; i < n; i++) {					\
+			register const type v = src[i];				\
+			register const size_t bucket = (v >> shift) & 0xff;	\
+			register const size_t p = pos[bucket]++;		\
+										\
+			wc[bucket][p & (LINE - 1)] = v;				\
+			if (((p + 1) & (LINE - 1)) == 0) {			\
+				const size_t line = p + 1 - LINE;		\
+										\
+				if (LIKELY(line >= start[bucket])) {		\
+					radix_lsd_flush_line(dst + line, wc[bucket]); \
+				} else {					\
+					/* first line is shared with the previous bucket */ \
+					(void)shim_memcpy(dst + start[bucket],	\
+						&wc[bucket][start[bucket] & (LINE - 1)], \
+						(p + 1 - start[bucket]) * sizeof(type)); \
+				}						\
+			}							\
+		}								\
+		/* flush partially filled buffers */				\
+		for (b = 0; b < RADIX_LSD_BUCKETS; b++) {			\
+			size_t from = pos[b] & ~(size_t)(LINE - 1);		\
+										\
+			if (from < start[b])					\
+				from = start[b];				\
+			if (from < pos[b])					\
+				(void)shim_memcpy(dst + from,			\
+					&wc[b][from & (LINE - 1)],		\
+					(pos[b] - from) * sizeof(type));	\
+		}								\
+		swap = src;							\
+		src = dst;							\
+		dst = swap;							\
+	}									\
+	RADIX_LSD_SFENCE();							\
+	if (src != data)							\
+		(void)shim_memcpy(data, src, n * sizeof(type));			\
+}
+
+#if defined(HAVE_NT_STORE128) &&	\
+    defined(HAVE_ASM_X86_SFENCE)
+#define RADIX_LSD_SFENCE()	stress_asm_x86_sfence()
+#else
+#define RADIX_LSD_SFENCE()
+#endif
+
+RADIX_LSD_SORT(32, uint32_t)
+RADIX_LSD_SORT(64, uint64_t)
+
+/*
+ *  stress_radixsort_lsd()
+ *	sort n random integer keys of key_bytes bytes with the
+ *	LSD radix sort, each bogo-op sorts a new set of random keys
+ */
+static int stress_radixsort_lsd(
+	stress_args_t *args,
+	const size_t n,
+	const size_t key_bytes)
+{
+	const size_t buf_size = n * key_bytes;
+	uint8_t *data, *tmp;
+	double duration = 0.0, sorted = 0.0, rate;
+	int rc = EXIT_SUCCESS;
+	const bool verify = !!(g_opt_flags & OPT_FLAGS_VERIFY);
+
+	data = (uint8_t *)stress_mmap_populate(NULL, buf_size,
+			PROT_READ | PROT_WRITE, MAP_ANONYMOUS | MAP_PRIVATE, -1, 0);
+	if (data == MAP_FAILED) {
+		pr_inf_skip("%s: mmap failed allocating %zu %zu bit keys, "
+			"skipping stressor\n", args->name, n, key_bytes * 8);
+		return EXIT_NO_RESOURCE;
+	}
+	stress_set_vma_anon_name(data, buf_size, "radixsort-keys");
+	tmp = (uint8_t *)stress_mmap_populate(NULL, buf_size,
+			PROT_READ | PROT_WRITE, MAP_ANONYMOUS | MAP_PRIVATE, -1, 0);
+	if (tmp == MAP_FAILED) {
+		pr_inf_skip("%s: mmap failed allocating %zu %zu bit keys, "
+			"skipping stressor\n", args->name, n, key_bytes * 8);
+		(void)munmap((void *)data, buf_size);
+		return EXIT_NO_RESOURCE;
+	}
+	stress_set_vma_anon_name(tmp, buf_size, "radixsort-tmp");
+
+	stress_set_proc_state(args->name, STRESS_STATE_SYNC_WAIT);
+	stress_sync_start_wait(args);
+	stress_set_proc_state(args->name, STRESS_STATE_RUN);
+
+	do {
+		uint64_t sum = 0, sum_sorted = 0;
+		size_t i;
+		double t;
+		bool ordered = true;
+
+		if (key_bytes == sizeof(uint32_t)) {
+			uint32_t *keys = (uint32_t *)data;
+
+			for (i = 0; i < n; i++) {
+				keys[i] = stress_mwc32();
+				sum += keys[i];
+			}
+			t = stress_time_now();
+			radixsort_lsd32(keys, (uint32_t *)tmp, n);
+			duration += stress_time_now() - t;
+			if (verify) {
+				for (i = 0; i < n; i++)
+					sum_sorted += keys[i];
+				for (i = 1; ordered && (i < n); i++)
+					ordered = (keys[i - 1] <= keys[i]);
+			}
+		} else {
+			uint64_t *keys = (uint64_t *)data;
+
+			for (i = 0; i < n; i++) {
+				keys[i] = stress_mwc64();
+				sum += keys[i];
+			}
+			t = stress_time_now();
+			radixsort_lsd64(keys, (uint64_t *)tmp, n);
+			duration += stress_time_now() - t;
+			if (verify) {
+				for (i = 0; i < n; i++)
+					sum_sorted += keys[i];
+				for (i = 1; ordered && (i < n); i++)
+					ordered = (keys[i - 1] <= keys[i]);
+			}
+		}
+		sorted += (double)n;
+
+		if (verify) {
+			if (!ordered) {
+				pr_fail("%s: sort error detected, incorrect ordering found\n",
+					args->name);
+				rc = EXIT_FAILURE;
+			} else if (sum != sum_sorted) {
+				pr_fail("%s: sort error detected, sum of keys changed from "
+					"0x%" PRIx64 " to 0x%" PRIx64 "\n",
+					args->name, sum, sum_sorted);
+				rc = EXIT_FAILURE;
+			}
+		}
+		stress_bogo_inc(args);
+	} while ((rc == EXIT_SUCCESS) && stress_continue(args));
+
+	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
+
+	rate = (duration > 0.0) ? sorted / duration : 0.0;
+	stress_metrics_set(args, 0, "Mkeys sorted per sec",
+		rate / 1000000.0, STRESS_METRIC_HARMONIC_MEAN);
+	stress_metrics_set(args, 1, "MB per sec sorted",
+		rate * (double)key_bytes / (double)MB, STRESS_METRIC_HARMONIC_MEAN);
+
+	(void)munmap((void *)tmp, buf_size);
+	(void)munmap((void *)data, buf_size);
+
+	return rc;
+}
+
 static const stress_radixsort_method_t stress_radixsort_methods[] = {
 #if defined(HAVE_LIB_BSD)
-	{ "radixsort-libc",	radixsort },
+	{ "radixsort-libc",	radixsort,		0 },
 #endif
-	{ "radixsort-nonlibc",	radixsort_nonlibc },
+	{ "radixsort-nonlibc",	radixsort_nonlibc,	0 },
+	{ "radixsort-lsd32",	NULL,			sizeof(uint32_t) },
+	{ "radixsort-lsd64",	NULL,			sizeof(uint64_t) },
 };
 
 /*
@@ -210,10 +441,14 @@ static int stress_radixsort(stress_args_t *args)
 
 	if (!stress_get_setting("radixsort-size", &radixsort_size)) {
 		if (g_opt_flags & OPT_FLAGS_MAXIMIZE)
-			radixsort_size = MAX_RADIXSORT_SIZE;
+			radixsort_size = stress_radixsort_methods[radixsort_method].key_bytes ?
+				MAX_RADIXSORT_SIZE : MAX_RADIXSORT_STR_SIZE;
 		if (g_opt_flags & OPT_FLAGS_MINIMIZE)
 			radixsort_size = MIN_RADIXSORT_SIZE;
 	}
+	if (stress_radixsort_methods[radixsort_method].key_bytes)
+		return stress_radixsort_lsd(args, (size_t)radixsort_size,
+			stress_radixsort_methods[radixsort_method].key_bytes);
 	n = (int)radixsort_size;
 
 	text = (unsigned char *)calloc((size_t)n, STR_SIZE);
@@ -314,5 +549,6 @@ const stressor_info_t stress_radixsort_info = {
 	.class = CLASS_CPU_CACHE | CLASS_CPU | CLASS_MEMORY | CLASS_SORT,
 	.opts = opts,
 	.verify = VERIFY_OPTIONAL,
+	.metrics_max = 2,
 	.help = help
 };
@@ -33,10 +33,26 @@
 #define STRESS_RANDLIST_ALLOC_HEAP	(0)
 #define STRESS_RANDLIST_ALLOC_MMAP	(1)
 
+#define RANDLIST_LAYOUT_ARENA		(0)
+#define RANDLIST_LAYOUT_ARENA_SHUFFLED	(1)
+#define RANDLIST_LAYOUT_HEAP		(2)
+
+/*
+ *  Item layouts, arena places the items contiguously in list order,
+ *  arena-shuffled places them contiguously in random list order and
+ *  heap allocates each item individually in random list order
+ */
+static const char * const randlist_layouts[] = {
+	"arena",
+	"arena-shuffled",
+	"heap",
+};
+
 static const stress_help_t help[] = {
 	{ NULL,	"randlist N",		"start N workers that exercise random ordered list" },
 	{ NULL, "randlist-compact",	"reduce mmap and malloc overheads" },
 	{ NULL, "randlist-items N",	"number of items in the random ordered list" },
+	{ NULL, "randlist-layout L",	"select item layout: arena, arena-shuffled, heap" },
 	{ NULL,	"randlist-ops N",	"stop after N randlist bogo no-op operations" },
 	{ NULL, "randlist-size N",	"size of data in each item in the list" },
 	{ NULL,	NULL,			NULL }
@@ -105,7 +121,7 @@ PRAGMA_UNROLL_N(8)
 	return false;
 }
 
-static inline void OPTIMIZE3 stress_randlist_exercise(
+static inline size_t OPTIMIZE3 stress_randlist_exercise(
 	stress_args_t *args,
 	stress_randlist_item_t *head,
 	const size_t randlist_size,
@@ -113,9 +129,10 @@ static inline void OPTIMIZE3 stress_randlist_exercise(
 	int *rc)
 {
 	register stress_randlist_item_t *ptr;
+	register size_t nodes = 0;
 	uint8_t dataval = stress_mwc8();
 
-	for (ptr = head; ptr; ptr = ptr->next) {
+	for (ptr = head; ptr; ptr = ptr->next, nodes++) {
 		shim_builtin_prefetch(ptr->next);
 		ptr->dataval = dataval;
 		(void)shim_memset(ptr->data, dataval, randlist_size);
@@ -124,7 +141,7 @@ static inline void OPTIMIZE3 stress_randlist_exercise(
 			break;
 	}
 
-	for (ptr = head; ptr; ptr = ptr->next) {
+	for (ptr = head; ptr; ptr = ptr->next, nodes++) {
 		shim_builtin_prefetch(ptr->next);
 		if (UNLIKELY(!stress_continue_flag()))
 			break;
@@ -133,6 +150,12 @@ static inline void OPTIMIZE3 stress_randlist_exercise(
 			*rc = EXIT_FAILURE;
 		}
 	}
+	return nodes;
+}
+
+static const char *stress_randlist_layout(const size_t i)
+{
+	return (i < SIZEOF_ARRAY(randlist_layouts)) ? randlist_layouts[i] : NULL;
 }
 
 /*
@@ -152,9 +175,15 @@ static int stress_randlist(stress_args_t *args)
 	size_t randlist_size = DEFAULT_RANDLIST_SIZE;
 	size_t heap_allocs = 0;
 	size_t mmap_allocs = 0;
+	size_t randlist_layout = RANDLIST_LAYOUT_HEAP;
+	double duration = 0.0, nodes = 0.0, rate;
 	int rc = EXIT_SUCCESS;
 
 	(void)stress_get_setting("randlist-compact", &randlist_compact);
+	(void)stress_get_setting("randlist-layout", &randlist_layout);
+	/* randlist-compact is the same as the arena-shuffled layout */
+	if (randlist_compact && (randlist_layout == RANDLIST_LAYOUT_HEAP))
+		randlist_layout = RANDLIST_LAYOUT_ARENA_SHUFFLED;
 	if (!stress_get_setting("randlist-items", &randlist_items)) {
 		if (g_opt_flags & OPT_FLAGS_MAXIMIZE)
 			randlist_items = MAX_RANDLIST_ITEMS;
@@ -178,7 +207,7 @@ static int stress_randlist(stress_args_t *args)
 		return EXIT_NO_RESOURCE;
 	}
 
-	if (randlist_compact) {
+	if (randlist_layout != RANDLIST_LAYOUT_HEAP) {
 		const size_t size = sizeof(*ptr) + randlist_size;
 
 		compact_ptr = (stress_randlist_item_t *)calloc(randlist_items, size);
@@ -235,9 +264,10 @@ retry:
 	}
 
 	/*
-	 *  Shuffle into random item order
+	 *  Shuffle into random item order, the arena layout keeps
+	 *  the items in address order
 	 */
-	for (i = 0; i < randlist_items; i++) {
+	for (i = 0; (randlist_layout != RANDLIST_LAYOUT_ARENA) && (i < randlist_items); i++) {
 		size_t n = (size_t)stress_mwc32modn(randlist_items);
 
 		ptr = ptrs[i];
@@ -267,12 +297,19 @@ retry:
 	stress_set_proc_state(args->name, STRESS_STATE_RUN);
 
 	do {
-		stress_randlist_exercise(args, head, randlist_size, verify, &rc);
+		const double t = stress_time_now();
+
+		nodes += (double)stress_randlist_exercise(args, head, randlist_size, verify, &rc);
+		duration += stress_time_now() - t;
 		stress_bogo_inc(args);
 	} while ((rc == EXIT_SUCCESS) && stress_continue(args));
 
 	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
 
+	rate = (nodes > 0.0) ? (duration * STRESS_DBL_NANOSECOND) / nodes : 0.0;
+	stress_metrics_set(args, 0, "nanosecs per node traversed",
+		rate, STRESS_METRIC_GEOMETRIC_MEAN);
+
 	pr_dbg("%s: heap allocations: %zd, mmap allocations: %zd\n", args->name, heap_allocs, mmap_allocs);
 
 	if (compact_ptr) {
@@ -291,6 +328,7 @@ retry:
 static const stress_opt_t opts[] = {
 	{ OPT_randlist_compact,	"randlist-compact", TYPE_ID_BOOL, 0, 1, NULL },
 	{ OPT_randlist_items,	"randlist-items",   TYPE_ID_SIZE_T, MIN_RANDLIST_ITEMS, MAX_RANDLIST_ITEMS, NULL },
+	{ OPT_randlist_layout,	"randlist-layout",  TYPE_ID_SIZE_T_METHOD, 0, 0, stress_randlist_layout },
 	{ OPT_randlist_size,	"randlist-size",    TYPE_ID_SIZE_T, MIN_RANDLIST_SIZE, MAX_RANDLIST_SIZE, NULL },
 	END_OPT,
 };
@@ -300,5 +338,6 @@ const stressor_info_t stress_randlist_info = {
 	.class = CLASS_MEMORY,
 	.opts = opts,
 	.verify = VERIFY_OPTIONAL,
+	.metrics_max = 1,
 	.help = help
 };
@@ -18,8 +18,11 @@
  *
  */
 #include "stress-ng.h"
+#include "core-killpid.h"
 #include "core-vmstat.h"
 
+#include <ctype.h>
+
 #if defined(HAVE_SYS_SYSMACROS_H)
 #include <sys/sysmacros.h>
 #endif
@@ -31,6 +34,7 @@
 static const stress_help_t help[] = {
 	{ NULL,	"rawdev N",	   "start N workers that read a raw device" },
 	{ NULL,	"rawdev-method M", "specify the rawdev read method to use" },
+	{ NULL,	"rawdev-mq",	   "parallel random reads, one reader per blk-mq hardware queue" },
 	{ NULL,	"rawdev-ops N",	   "stop after N rawdev read operations" },
 	{ NULL,	NULL,		   NULL }
 };
@@ -38,6 +42,9 @@ static const stress_help_t help[] = {
 #define	MIN_BLKSZ	((int)512)
 #define	MAX_BLKSZ	((int)(128 * KB))
 
+#define RAWDEV_MQ_MAX	(64)	/* maximum hardware queues exercised */
+#define RAWDEV_MQ_BATCH	(64)	/* reads between shared counter updates */
+
 #if defined(HAVE_SYS_SYSMACROS_H) &&	\
     defined(BLKGETSIZE) && 		\
     defined(BLKSSZGET)
@@ -353,6 +360,7 @@ static const char *stress_rawdev_method(const size_t i)
 
 static const stress_opt_t opts[] = {
 	{ OPT_rawdev_method, "rawdev-method", TYPE_ID_SIZE_T_METHOD, 0, 0, stress_rawdev_method },
+	{ OPT_rawdev_mq,     "rawdev-mq",     TYPE_ID_BOOL, 0, 1, NULL },
 	END_OPT,
 };
 
@@ -360,6 +368,7 @@ static const stress_opt_t opts[] = {
 
 static const stress_opt_t opts[] = {
 	{ OPT_rawdev_method, "rawdev-method", TYPE_ID_SIZE_T_METHOD, 0, 0, stress_unimplemented_method },
+	{ OPT_rawdev_mq,     "rawdev-mq",     TYPE_ID_BOOL, 0, 1, NULL },
 	END_OPT,
 };
 
@@ -369,6 +378,279 @@ static const stress_opt_t opts[] = {
     defined(BLKGETSIZE) && 		\
     defined(BLKSSZGET)
 
+typedef struct {
+	uint64_t reads;			/* completed reads */
+	double duration;		/* reader run time */
+	int cpus;			/* number of CPUs mapped to the queue */
+	bool failed;			/* reader encountered an error */
+} stress_rawdev_mq_t;
+
+/*
+ *  stress_rawdev_mq_cpu_list()
+ *	parse a blk-mq cpu_list such as "0, 1, 4-7" into set,
+ *	returns number of CPUs in the set
+ */
+static int stress_rawdev_mq_cpu_list(char *str, cpu_set_t *set)
+{
+	char *ptr, *token;
+	int n = 0;
+
+	CPU_ZERO(set);
+	for (ptr = str; (token = strtok(ptr, ", \n")) != NULL; ptr = NULL) {
+		int lo, hi, cpu;
+		const char *dash = strchr(token, '-');
+
+		lo = atoi(token);
+		hi = dash ? atoi(dash + 1) : lo;
+		for (cpu = lo; (cpu <= hi) && (cpu < CPU_SETSIZE); cpu++) {
+			if ((cpu >= 0) && !CPU_ISSET(cpu, set)) {
+				CPU_SET(cpu, set);
+				n++;
+			}
+		}
+	}
+	return n;
+}
+
+/*
+ *  stress_rawdev_mq_queues()
+ *	find the blk-mq hardware queue CPU mappings of the block device
+ *	devpath, partitions use the mq directory of their parent device,
+ *	returns the number of hardware queues
+ */
+static size_t stress_rawdev_mq_queues(const char *devpath, cpu_set_t *sets, stress_rawdev_mq_t *mq)
+{
+	static const char * const fmts[] = {
+		"/sys/dev/block/%u:%u/mq",
+		"/sys/dev/block/%u:%u/../mq",
+	};
+	struct stat statbuf;
+	size_t i, n = 0;
+
+	if (stat(devpath, &statbuf) < 0)
+		return 0;
+
+	for (i = 0; (i < SIZEOF_ARRAY(fmts)) && (n == 0); i++) {
+		char path[PATH_MAX];
+		DIR *dir;
+		const struct dirent *d;
+
+		(void)snprintf(path, sizeof(path), fmts[i],
+			(unsigned int)major(statbuf.st_rdev),
+			(unsigned int)minor(statbuf.st_rdev));
+		dir = opendir(path);
+		if (!dir)
+			continue;
+		while ((d = readdir(dir)) != NULL) {
+			char filename[PATH_MAX + 300], buf[4096];
+			int q;
+
+			if (!isdigit((unsigned char)d->d_name[0]))
+				continue;
+			q = atoi(d->d_name);
+			if ((q < 0) || (q >= RAWDEV_MQ_MAX))
+				continue;
+			(void)snprintf(filename, sizeof(filename), "%s/%s/cpu_list", path, d->d_name);
+			if (stress_system_read(filename, buf, sizeof(buf)) <= 0)
+				continue;
+			mq[q].cpus = stress_rawdev_mq_cpu_list(buf, &sets[q]);
+			if ((size_t)q >= n)
+				n = (size_t)q + 1;
+		}
+		(void)closedir(dir);
+	}
+	return n;
+}
+
+/*
+ *  stress_rawdev_mq_reader()
+ *	pin to the CPUs mapped to hardware queue q so that reads are
+ *	submitted on that queue and issue random aligned O_DIRECT reads
+ */
+static void stress_rawdev_mq_reader(
+	stress_args_t *args,
+	const char *devpath,
+	const size_t blks,
+	const size_t blksz,
+	const size_t mmapsz,
+	const size_t q,
+	cpu_set_t *set,
+	stress_rawdev_mq_t *mq)
+{
+	char *buffer;
+	uint64_t reads = 0;
+	double t_start;
+	int fd;
+
+#if defined(HAVE_SCHED_SETAFFINITY)
+	if (sched_setaffinity(0, sizeof(*set), set) < 0)
+		pr_dbg("%s: cannot pin hardware queue %zu reader, errno=%d (%s)\n",
+			args->name, q, errno, strerror(errno));
+#else
+	(void)set;
+#endif
+	buffer = stress_mmap_populate(NULL, mmapsz,
+			PROT_READ | PROT_WRITE,
+			MAP_ANONYMOUS | MAP_PRIVATE, -1, 0);
+	if (buffer == MAP_FAILED)
+		return;
+	fd = open(devpath, O_RDONLY | O_DIRECT);
+	if (fd < 0) {
+		pr_fail("%s: cannot open raw block device: errno=%d (%s)\n",
+			args->name, errno, strerror(errno));
+		mq->failed = true;
+		(void)munmap((void *)buffer, mmapsz);
+		return;
+	}
+
+	t_start = stress_time_now();
+	while (stress_continue(args)) {
+		int i;
+
+		for (i = 0; i < RAWDEV_MQ_BATCH; i++) {
+			const off_t offset = (off_t)blksz * stress_mwc64modn(blks);
+			const ssize_t ret = pread(fd, buffer, blksz, offset);
+
+			if (UNLIKELY(ret < 0)) {
+				if (errno == EINTR)
+					break;
+				pr_fail("%s: pread at %" PRIdMAX " failed, errno=%d (%s)\n",
+					args->name, (intmax_t)offset, errno, strerror(errno));
+				mq->failed = true;
+				goto done;
+			}
+			reads++;
+			stress_bogo_inc(args);
+		}
+		mq->reads = reads;
+		mq->duration = stress_time_now() - t_start;
+	}
+done:
+	mq->reads = reads;
+	mq->duration = stress_time_now() - t_start;
+	(void)close(fd);
+	(void)munmap((void *)buffer, mmapsz);
+}
+
+/*
+ *  stress_rawdev_mq()
+ *	run one reader per blk-mq hardware queue in parallel and
+ *	report per-queue and aggregate IOPS
+ */
+static int stress_rawdev_mq(
+	stress_args_t *args,
+	const char *devpath,
+	const size_t blks,
+	const size_t blksz,
+	const size_t mmapsz)
+{
+	stress_pid_t *s_pids, *s_pids_head = NULL;
+	stress_rawdev_mq_t *mq;
+	cpu_set_t *sets;
+	const size_t mq_sz = sizeof(*mq) * RAWDEV_MQ_MAX;
+	size_t i, n, idx, started = 0;
+	double iops_total = 0.0;
+	int rc = EXIT_SUCCESS;
+
+	sets = (cpu_set_t *)calloc(RAWDEV_MQ_MAX, sizeof(*sets));
+	if (!sets) {
+		pr_inf_skip("%s: cannot allocate CPU sets, skipping stressor\n", args->name);
+		return EXIT_NO_RESOURCE;
+	}
+	mq = (stress_rawdev_mq_t *)stress_mmap_populate(NULL, mq_sz,
+			PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+	if (mq == MAP_FAILED) {
+		pr_inf_skip("%s: cannot mmap %zu bytes for queue statistics, skipping stressor\n",
+			args->name, mq_sz);
+		free(sets);
+		return EXIT_NO_RESOURCE;
+	}
+	stress_set_vma_anon_name(mq, mq_sz, "mq-stats");
+
+	n = stress_rawdev_mq_queues(devpath, sets, mq);
+	if (n == 0) {
+		pr_inf_skip("%s: cannot find blk-mq hardware queues for %s, skipping stressor\n",
+			args->name, devpath);
+		(void)munmap((void *)mq, mq_sz);
+		free(sets);
+		return EXIT_NO_RESOURCE;
+	}
+	s_pids = stress_s_pids_mmap(n);
+	if (s_pids == MAP_FAILED) {
+		pr_inf_skip("%s: failed to mmap %zu PIDs, skipping stressor\n", args->name, n);
+		(void)munmap((void *)mq, mq_sz);
+		free(sets);
+		return EXIT_NO_RESOURCE;
+	}
+	if (args->instance == 0)
+		pr_dbg("%s: %zu blk-mq hardware queues on %s\n", args->name, n, devpath);
+
+	for (i = 0; i < n; i++) {
+		if (mq[i].cpus == 0)
+			continue;
+		stress_sync_start_init(&s_pids[i]);
+		s_pids[i].pid = fork();
+		if (s_pids[i].pid == 0) {
+			s_pids[i].pid = getpid();
+			stress_parent_died_alarm();
+
+			stress_set_proc_state(args->name, STRESS_STATE_SYNC_WAIT);
+			stress_sync_start_wait_s_pid(&s_pids[i]);
+			stress_set_proc_state(args->name, STRESS_STATE_RUN);
+			stress_rawdev_mq_reader(args, devpath, blks, blksz, mmapsz, i, &sets[i], &mq[i]);
+			_exit(EXIT_SUCCESS);
+		} else if (s_pids[i].pid > 0) {
+			stress_sync_start_s_pid_list_add(&s_pids_head, &s_pids[i]);
+			started++;
+		}
+	}
+	if (started == 0) {
+		pr_inf_skip("%s: cannot fork hardware queue readers, skipping stressor\n", args->name);
+		rc = EXIT_NO_RESOURCE;
+		goto tidy;
+	}
+
+	stress_set_proc_state(args->name, STRESS_STATE_SYNC_WAIT);
+	stress_sync_start_wait(args);
+	stress_sync_start_cont_list(s_pids_head);
+	stress_set_proc_state(args->name, STRESS_STATE_RUN);
+
+	while (stress_continue(args)) {
+		for (i = 0; i < n; i++) {
+			if (mq[i].failed)
+				break;
+		}
+		if (i < n)
+			break;
+		(void)shim_usleep(100000);
+	}
+	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
+	(void)stress_kill_and_wait_many(args, s_pids, n, SIGALRM, true);
+
+	for (idx = 0, i = 0; i < n; i++) {
+		char str[64];
+		double iops;
+
+		if (mq[i].failed)
+			rc = EXIT_FAILURE;
+		if (mq[i].duration <= 0.0)
+			continue;
+		iops = (double)mq[i].reads / mq[i].duration;
+		iops_total += iops;
+		if (idx < STRESS_MISC_METRICS_MAX - 1) {
+			(void)snprintf(str, sizeof(str), "IOPS hardware queue %zu (%d CPUs)", i, mq[i].cpus);
+			stress_metrics_set(args, idx++, str, iops, STRESS_METRIC_HARMONIC_MEAN);
+		}
+	}
+	stress_metrics_set(args, idx, "IOPS all hardware queues", iops_total, STRESS_METRIC_TOTAL);
+tidy:
+	(void)stress_s_pids_munmap(s_pids, n);
+	(void)munmap((void *)mq, mq_sz);
+	free(sets);
+
+	return rc;
+}
+
 static int stress_rawdev(stress_args_t *args)
 {
 	int ret, fd, rc = EXIT_SUCCESS;
@@ -376,6 +658,7 @@ static int stress_rawdev(stress_args_t *args)
 	const char *path = stress_get_temp_path();
 	size_t blks, blksz = 0, mmapsz;
 	size_t i, j, rawdev_method = 0;
+	bool rawdev_mq = false;
 	const size_t page_size = args->page_size;
 	stress_rawdev_func func;
 	stress_metrics_t *metrics;
@@ -404,6 +687,7 @@ static int stress_rawdev(stress_args_t *args)
 	}
 
 	(void)stress_get_setting("rawdev-method", &rawdev_method);
+	(void)stress_get_setting("rawdev-mq", &rawdev_mq);
 	func = rawdev_methods[rawdev_method].func;
 
 	fd = open(devpath, O_RDONLY | O_NONBLOCK);
@@ -449,6 +733,12 @@ static int stress_rawdev(stress_args_t *args)
 	stress_set_vma_anon_name(buffer, mmapsz, "io-buffer");
 
 	(void)close(fd);
+	if (rawdev_mq) {
+		rc = stress_rawdev_mq(args, devpath, blks, blksz, mmapsz);
+		(void)munmap((void *)buffer, mmapsz);
+		free(metrics);
+		return rc;
+	}
 	fd = open(devpath, O_RDONLY | O_DIRECT);
 	if (fd < 0) {
 		pr_inf("%s: cannot open raw block device: errno=%d (%s)\n",
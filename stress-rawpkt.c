@@ -34,6 +34,10 @@
 #include <linux/if_tun.h>
 #endif
 
+#if defined(HAVE_LINUX_IF_XDP_H)
+#include <linux/if_xdp.h>
+#endif
+
 #if defined(HAVE_LINUX_SOCKIOS_H)
 #include <linux/sockios.h>
 #endif
@@ -52,6 +56,10 @@
 #include <linux/udp.h>
 #endif
 
+#if defined(HAVE_POLL_H)
+#include <poll.h>
+#endif
+
 #include <arpa/inet.h>
 
 #define DEFAULT_RAWPKT_PORT	(14000)
@@ -61,11 +69,49 @@
 #endif
 #define PACKET_SIZE	(2048)
 
+#define MIN_RAWPKT_BATCH	(1)
+#define MAX_RAWPKT_BATCH	(256)
+#define DEFAULT_RAWPKT_BATCH	(64)
+
+#define RAWPKT_TX_BLOCK_SIZE	(64 * KB)	/* TX ring block size */
+#define RAWPKT_XDP_FRAMES	(2048)		/* UMEM frames and ring entries */
+
+#if defined(PACKET_RX_RING) &&	\
+    defined(PACKET_VERSION) &&	\
+    defined(HAVE_TPACKET_REQ3) &&	\
+    defined(HAVE_POLL_H)
+#define STRESS_RAWPKT_RX_RING	(1)
+#endif
+
+#if defined(PACKET_TX_RING) &&	\
+    defined(PACKET_VERSION) &&	\
+    defined(HAVE_TPACKET_REQ3)
+#define STRESS_RAWPKT_TX_RING	(1)
+#endif
+
+#if defined(HAVE_LINUX_IF_XDP_H) &&	\
+    defined(AF_XDP) &&			\
+    defined(SOL_XDP) &&			\
+    defined(XDP_ZEROCOPY) &&		\
+    defined(XDP_UMEM_PGOFF_COMPLETION_RING) && \
+    defined(HAVE_ATOMIC_LOAD) &&	\
+    defined(HAVE_ATOMIC_STORE)
+#define STRESS_RAWPKT_XDP	(1)
+#endif
+
+typedef struct {
+	uint64_t packets;	/* packets transmitted by the client */
+	uint64_t syscalls;	/* send system calls made by the client */
+} stress_rawpkt_stats_t;
+
 static const stress_help_t help[] = {
 	{ NULL, "rawpkt N",		"start N workers exercising raw packets" },
+	{ NULL,	"rawpkt-batch N",	"send N packets per system call in TX ring and AF_XDP modes" },
 	{ NULL,	"rawpkt-ops N",		"stop after N raw packet bogo operations" },
 	{ NULL,	"rawpkt-port P",	"use raw packet ports P to P + number of workers - 1" },
 	{ NULL, "rawpkt-rxring N",	"setup raw packets with RX ring with N number of blocks, this selects TPACKET_V3"},
+	{ NULL, "rawpkt-txring N",	"send raw packets with a TPACKET_V3 TX ring with N 64K blocks" },
+	{ NULL, "rawpkt-xdp",		"send raw packets with an AF_XDP socket and UMEM" },
 	{ NULL,	NULL,			NULL }
 };
 
@@ -85,8 +131,11 @@ static int stress_rawpkt_supported(const char *name)
 }
 
 static const stress_opt_t opts[] = {
+	{ OPT_rawpkt_batch,  "rawpkt-batch",  TYPE_ID_SIZE_T, MIN_RAWPKT_BATCH, MAX_RAWPKT_BATCH, NULL },
 	{ OPT_rawpkt_port,   "rawpkt-port",   TYPE_ID_INT_PORT, MIN_PORT, MAX_PORT, NULL },
 	{ OPT_rawpkt_rxring, "rawpkt-rxring", TYPE_ID_INT, 1, 16, NULL },
+	{ OPT_rawpkt_txring, "rawpkt-txring", TYPE_ID_INT, 1, 16, NULL },
+	{ OPT_rawpkt_xdp,    "rawpkt-xdp",    TYPE_ID_BOOL, 0, 1, NULL },
 	END_OPT,
 };
 
@@ -243,6 +292,270 @@ static void stress_rawpkt_sockopts(const int fd)
 	}
 }
 
+#if defined(STRESS_RAWPKT_TX_RING) ||	\
+    defined(STRESS_RAWPKT_XDP)
+/*
+ *  stress_rawpkt_fill()
+ *	copy the packet template into a ring frame and
+ *	set the IP id and checksum
+ */
+static inline void OPTIMIZE3 stress_rawpkt_fill(
+	uint8_t *frame,
+	const uint8_t *tmpl,
+	const size_t len,
+	const uint16_t id)
+{
+	struct iphdr *ip = (struct iphdr *)(frame + sizeof(struct ethhdr));
+
+	(void)shim_memcpy(frame, tmpl, len);
+	ip->id = htons(id);
+	ip->check = 0;
+	ip->check = stress_ipv4_checksum((uint16_t *)ip, sizeof(struct iphdr) + sizeof(struct udphdr));
+}
+#endif
+
+#if defined(STRESS_RAWPKT_TX_RING)
+/*
+ *  stress_rawpkt_txring()
+ *	send packets by filling up to batch frames of a TPACKET_V3
+ *	PACKET_TX_RING and flushing them with one sendto, returns
+ *	-1 if the TX ring cannot be used
+ */
+static int OPTIMIZE3 stress_rawpkt_txring(
+	stress_args_t *args,
+	const int fd,
+	const uint8_t *tmpl,
+	const size_t len,
+	const struct sockaddr_ll *sadr,
+	const int blocknr,
+	const size_t batch,
+	stress_rawpkt_stats_t *stats)
+{
+	struct tpacket_req3 tp;
+	int val = TPACKET_V3;
+	const size_t data_off = TPACKET3_HDRLEN - sizeof(struct sockaddr_ll);
+	size_t ring_size, frame_mask, frame = 0;
+	uint8_t *ring;
+	uint16_t id = 12345;
+
+	if (setsockopt(fd, SOL_PACKET, PACKET_VERSION, &val, sizeof(val)) < 0) {
+		if (args->instance == 0)
+			pr_inf("%s: cannot set TPACKET_V3, errno=%d (%s), using sendto\n",
+				args->name, errno, strerror(errno));
+		return -1;
+	}
+	(void)shim_memset(&tp, 0, sizeof(tp));
+	tp.tp_block_size = RAWPKT_TX_BLOCK_SIZE;
+	tp.tp_block_nr = (unsigned int)blocknr;
+	tp.tp_frame_size = PACKET_SIZE;
+	tp.tp_frame_nr = (RAWPKT_TX_BLOCK_SIZE / PACKET_SIZE) * (unsigned int)blocknr;
+	if (setsockopt(fd, SOL_PACKET, PACKET_TX_RING, (void *)&tp, sizeof(tp)) < 0) {
+		if (args->instance == 0)
+			pr_inf("%s: cannot setup TPACKET_V3 TX ring, errno=%d (%s), using sendto\n",
+				args->name, errno, strerror(errno));
+		return -1;
+	}
+	ring_size = (size_t)tp.tp_block_size * tp.tp_block_nr;
+	ring = (uint8_t *)mmap(NULL, ring_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	if (ring == MAP_FAILED) {
+		if (args->instance == 0)
+			pr_inf("%s: cannot mmap TX ring, errno=%d (%s), using sendto\n",
+				args->name, errno, strerror(errno));
+		return -1;
+	}
+	frame_mask = tp.tp_frame_nr - 1;
+
+	do {
+		size_t i;
+		ssize_t ret;
+		uint64_t n = 0;
+
+		for (i = 0; i < batch; i++) {
+			struct tpacket3_hdr *hdr = (struct tpacket3_hdr *)(ring + (frame * PACKET_SIZE));
+
+			if (*(volatile uint32_t *)&hdr->tp_status != TP_STATUS_AVAILABLE)
+				break;
+			stress_rawpkt_fill((uint8_t *)hdr + data_off, tmpl, len, id++);
+			hdr->tp_len = (uint32_t)len;
+			hdr->tp_next_offset = 0;
+			__sync_synchronize();
+			*(volatile uint32_t *)&hdr->tp_status = TP_STATUS_SEND_REQUEST;
+			frame = (frame + 1) & frame_mask;
+			n++;
+		}
+		/* blocks until all the frames are sent and available again */
+		ret = sendto(fd, NULL, 0, 0, (const struct sockaddr *)sadr, sizeof(*sadr));
+		stats->syscalls++;
+		if (UNLIKELY(ret < 0)) {
+			if ((errno == EINTR) || (errno == ENOBUFS) || (errno == EAGAIN))
+				continue;
+			pr_fail("%s: TX ring sendto failed, errno=%d (%s)\n",
+				args->name, errno, strerror(errno));
+			(void)munmap((void *)ring, ring_size);
+			return EXIT_FAILURE;
+		}
+		stats->packets += n;
+	} while (stress_continue(args));
+
+	(void)munmap((void *)ring, ring_size);
+	return EXIT_SUCCESS;
+}
+#endif
+
+#if defined(STRESS_RAWPKT_XDP)
+/*
+ *  stress_rawpkt_xdp()
+ *	send packets from a UMEM using an AF_XDP socket bound to
+ *	queue 0 of the interface, zero copy mode is used if the
+ *	driver supports it. Up to batch descriptors are queued on
+ *	the TX ring for each sendto wakeup, returns -1 if AF_XDP
+ *	cannot be used
+ */
+static int OPTIMIZE3 stress_rawpkt_xdp(
+	stress_args_t *args,
+	const uint8_t *tmpl,
+	const size_t len,
+	const int ifindex,
+	const size_t batch,
+	stress_rawpkt_stats_t *stats)
+{
+	const size_t umem_size = (size_t)RAWPKT_XDP_FRAMES * PACKET_SIZE;
+	const uint32_t mask = RAWPKT_XDP_FRAMES - 1;
+	struct xdp_umem_reg mr;
+	struct xdp_mmap_offsets off;
+	struct sockaddr_xdp sxdp;
+	socklen_t optlen = sizeof(off);
+	int fd, ring_nr = RAWPKT_XDP_FRAMES, rc = -1;
+	size_t tx_size = 0, cq_size = 0, i;
+	uint8_t *umem, *tx_map = MAP_FAILED, *cq_map = MAP_FAILED;
+	uint32_t *tx_prod, *cq_prod, *cq_cons, prod, outstanding = 0;
+	struct xdp_desc *tx_desc;
+	uint16_t id = 12345;
+
+	fd = socket(AF_XDP, SOCK_RAW, 0);
+	if (fd < 0) {
+		if (args->instance == 0)
+			pr_inf("%s: cannot create AF_XDP socket, errno=%d (%s), using sendto\n",
+				args->name, errno, strerror(errno));
+		return -1;
+	}
+	umem = (uint8_t *)mmap(NULL, umem_size, PROT_READ | PROT_WRITE,
+				MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (umem == MAP_FAILED) {
+		if (args->instance == 0)
+			pr_inf("%s: cannot allocate %zu byte UMEM, errno=%d (%s), using sendto\n",
+				args->name, umem_size, errno, strerror(errno));
+		(void)close(fd);
+		return -1;
+	}
+	stress_set_vma_anon_name(umem, umem_size, "xdp-umem");
+
+	(void)shim_memset(&mr, 0, sizeof(mr));
+	mr.addr = (uint64_t)(uintptr_t)umem;
+	mr.len = umem_size;
+	mr.chunk_size = PACKET_SIZE;
+	mr.headroom = 0;
+	if ((setsockopt(fd, SOL_XDP, XDP_UMEM_REG, &mr, sizeof(mr)) < 0) ||
+	    (setsockopt(fd, SOL_XDP, XDP_UMEM_FILL_RING, &ring_nr, sizeof(ring_nr)) < 0) ||
+	    (setsockopt(fd, SOL_XDP, XDP_UMEM_COMPLETION_RING, &ring_nr, sizeof(ring_nr)) < 0) ||
+	    (setsockopt(fd, SOL_XDP, XDP_TX_RING, &ring_nr, sizeof(ring_nr)) < 0) ||
+	    (getsockopt(fd, SOL_XDP, XDP_MMAP_OFFSETS, &off, &optlen) < 0)) {
+		if (args->instance == 0)
+			pr_inf("%s: cannot setup AF_XDP UMEM and rings, errno=%d (%s), using sendto\n",
+				args->name, errno, strerror(errno));
+		goto unmap_umem;
+	}
+
+	tx_size = off.tx.desc + ((size_t)ring_nr * sizeof(struct xdp_desc));
+	tx_map = (uint8_t *)mmap(NULL, tx_size, PROT_READ | PROT_WRITE,
+				MAP_SHARED | MAP_POPULATE, fd, XDP_PGOFF_TX_RING);
+	cq_size = off.cr.desc + ((size_t)ring_nr * sizeof(uint64_t));
+	cq_map = (uint8_t *)mmap(NULL, cq_size, PROT_READ | PROT_WRITE,
+				MAP_SHARED | MAP_POPULATE, fd, XDP_UMEM_PGOFF_COMPLETION_RING);
+	if ((tx_map == MAP_FAILED) || (cq_map == MAP_FAILED)) {
+		if (args->instance == 0)
+			pr_inf("%s: cannot mmap AF_XDP rings, errno=%d (%s), using sendto\n",
+				args->name, errno, strerror(errno));
+		goto unmap_rings;
+	}
+	tx_prod = (uint32_t *)(tx_map + off.tx.producer);
+	tx_desc = (struct xdp_desc *)(tx_map + off.tx.desc);
+	cq_prod = (uint32_t *)(cq_map + off.cr.producer);
+	cq_cons = (uint32_t *)(cq_map + off.cr.consumer);
+
+	(void)shim_memset(&sxdp, 0, sizeof(sxdp));
+	sxdp.sxdp_family = AF_XDP;
+	sxdp.sxdp_ifindex = (uint32_t)ifindex;
+	sxdp.sxdp_queue_id = 0;
+	sxdp.sxdp_flags = XDP_ZEROCOPY;
+	if (bind(fd, (struct sockaddr *)&sxdp, sizeof(sxdp)) < 0) {
+		sxdp.sxdp_flags = XDP_COPY;
+		if (bind(fd, (struct sockaddr *)&sxdp, sizeof(sxdp)) < 0) {
+			if (args->instance == 0)
+				pr_inf("%s: cannot bind AF_XDP socket, errno=%d (%s), using sendto\n",
+					args->name, errno, strerror(errno));
+			goto unmap_rings;
+		}
+	}
+	if (args->instance == 0)
+		pr_dbg("%s: using AF_XDP in %s mode\n", args->name,
+			(sxdp.sxdp_flags == XDP_ZEROCOPY) ? "zero copy" : "copy");
+
+	for (i = 0; i < RAWPKT_XDP_FRAMES; i++)
+		(void)shim_memcpy(umem + (i * PACKET_SIZE), tmpl, len);
+	prod = *tx_prod;
+
+	do {
+		const uint32_t cq_p = __atomic_load_n(cq_prod, __ATOMIC_ACQUIRE);
+		const uint32_t cq_c = *cq_cons;
+		uint32_t n;
+		ssize_t ret;
+
+		/* completed frames can be reused */
+		if (cq_p != cq_c) {
+			outstanding -= (cq_p - cq_c);
+			stats->packets += (uint64_t)(cq_p - cq_c);
+			__atomic_store_n(cq_cons, cq_p, __ATOMIC_RELEASE);
+		}
+		n = STRESS_MINIMUM((uint32_t)batch, RAWPKT_XDP_FRAMES - outstanding);
+		for (i = 0; i < n; i++, prod++) {
+			const uint64_t addr = (uint64_t)(prod & mask) * PACKET_SIZE;
+			struct xdp_desc *desc = &tx_desc[prod & mask];
+
+			stress_rawpkt_fill(umem + addr, tmpl, len, id++);
+			desc->addr = addr;
+			desc->len = (uint32_t)len;
+			desc->options = 0;
+		}
+		__atomic_store_n(tx_prod, prod, __ATOMIC_RELEASE);
+		outstanding += n;
+
+		ret = sendto(fd, NULL, 0, MSG_DONTWAIT, NULL, 0);
+		stats->syscalls++;
+		if (UNLIKELY(ret < 0)) {
+			if ((errno == EINTR) || (errno == ENOBUFS) ||
+			    (errno == EAGAIN) || (errno == EBUSY))
+				continue;
+			pr_fail("%s: AF_XDP sendto failed, errno=%d (%s)\n",
+				args->name, errno, strerror(errno));
+			rc = EXIT_FAILURE;
+			goto unmap_rings;
+		}
+	} while (stress_continue(args));
+	rc = EXIT_SUCCESS;
+
+unmap_rings:
+	if (cq_map != MAP_FAILED)
+		(void)munmap((void *)cq_map, cq_size);
+	if (tx_map != MAP_FAILED)
+		(void)munmap((void *)tx_map, tx_size);
+unmap_umem:
+	(void)close(fd);
+	(void)munmap((void *)umem, umem_size);
+	return rc;
+}
+#endif
+
 /*
  *  stress_rawpkt_client()
  *	client sender
@@ -252,7 +565,11 @@ static void NORETURN OPTIMIZE3 stress_rawpkt_client(
 	struct ifreq *hwaddr,
 	struct ifreq *ifaddr,
 	const struct ifreq *idx,
-	const int port)
+	const int port,
+	const int txring,
+	const bool xdp,
+	const size_t batch,
+	stress_rawpkt_stats_t *stats)
 {
 	int rc = EXIT_FAILURE;
 	uint16_t id = 12345;
@@ -290,12 +607,46 @@ static void NORETURN OPTIMIZE3 stress_rawpkt_client(
 	sadr.sll_halen = ETH_ALEN;
 	(void)shim_memcpy(&sadr.sll_addr, eth->h_dest, sizeof(eth->h_dest));
 
+#if defined(STRESS_RAWPKT_XDP)
+	if (xdp) {
+		rc = stress_rawpkt_xdp(args, (const uint8_t *)buf,
+			sizeof(struct ethhdr) + ip->tot_len, idx->ifr_ifindex, batch, stats);
+		if (rc >= 0)
+			goto err;
+		rc = EXIT_FAILURE;
+	}
+#else
+	(void)xdp;
+#endif
+
 	if ((fd = socket(PF_PACKET, SOCK_RAW, htons(ETH_P_ALL))) < 0) {
 		pr_fail("%s: socket failed, errno=%d (%s)\n",
 			args->name, errno, strerror(errno));
 		goto err;
 	}
 
+#if defined(STRESS_RAWPKT_TX_RING)
+	if (txring) {
+		rc = stress_rawpkt_txring(args, fd, (const uint8_t *)buf,
+			sizeof(struct ethhdr) + ip->tot_len, &sadr, txring, batch, stats);
+		if (rc >= 0) {
+			(void)close(fd);
+			goto err;
+		}
+		rc = EXIT_FAILURE;
+		/* the failed TX ring setup may have changed the socket */
+		(void)close(fd);
+		if ((fd = socket(PF_PACKET, SOCK_RAW, htons(ETH_P_ALL))) < 0) {
+			pr_fail("%s: socket failed, errno=%d (%s)\n",
+				args->name, errno, strerror(errno));
+			goto err;
+		}
+	}
+#else
+	(void)txring;
+	(void)batch;
+#endif
+
 	do {
 		ssize_t n;
 
@@ -303,9 +654,12 @@ static void NORETURN OPTIMIZE3 stress_rawpkt_client(
 		ip->check = stress_ipv4_checksum((uint16_t *)ip, sizeof(struct iphdr) + sizeof(struct udphdr));
 
 		n = sendto(fd, buf, sizeof(struct ethhdr) + ip->tot_len, 0, (struct sockaddr *)&sadr, sizeof(sadr));
+		stats->syscalls++;
 		if (UNLIKELY(n < 0)) {
 			pr_fail("%s: raw socket sendto failed on port %d, errno=%d (%s)\n",
 				args->name, port, errno, strerror(errno));
+		} else {
+			stats->packets++;
 		}
 #if defined(SIOCOUTQ)
 		/* Occasionally exercise SIOCOUTQ */
@@ -325,6 +679,38 @@ err:
 	_exit(rc);
 }
 
+/*
+ *  stress_rawpkt_check()
+ *	account for a received packet if it was sent by the client
+ */
+static inline void OPTIMIZE3 stress_rawpkt_check(
+	stress_args_t *args,
+	const uint8_t *pkt,
+	const size_t len,
+	const bool outgoing,
+	const in_addr_t addr,
+	const int port,
+	uint64_t *rx_pkts,
+	double *bytes)
+{
+	const struct ethhdr *eth = (const struct ethhdr *)pkt;
+	const struct iphdr *ip = (const struct iphdr *)(pkt + sizeof(struct ethhdr));
+	const struct udphdr *udp = (const struct udphdr *)(pkt + sizeof(struct ethhdr) + sizeof(struct iphdr));
+
+	if (UNLIKELY(len < sizeof(struct ethhdr) + sizeof(struct iphdr) + sizeof(struct udphdr)))
+		return;
+	if ((eth->h_proto == htons(ETH_P_IP)) &&
+	    ((in_addr_t)ip->saddr == addr) &&
+	    (ip->protocol == SOL_UDP) &&
+	    (ntohs(udp->source) == port)) {
+		stress_bogo_inc(args);
+		*bytes += (double)len;
+		/* loopback packets are seen outgoing and incoming */
+		if (!outgoing)
+			(*rx_pkts)++;
+	}
+}
+
 /*
  *  stress_rawpkt_server()
  *	server reader
@@ -333,20 +719,22 @@ static int OPTIMIZE3 stress_rawpkt_server(
 	stress_args_t *args,
 	struct ifreq *ifaddr,
 	const int port,
-	const int blocknr)
+	const int blocknr,
+	const stress_rawpkt_stats_t *stats)
 {
 	int fd;
 	int rc = EXIT_SUCCESS;
 	uint32_t buf[PACKET_SIZE / sizeof(uint32_t)];
-	const struct ethhdr *eth = (struct ethhdr *)buf;
-	const struct iphdr *ip = (struct iphdr *)((uintptr_t)buf + sizeof(struct ethhdr));
-	const struct udphdr *udp = (struct udphdr *)((uintptr_t)buf + sizeof(struct ethhdr) + sizeof(struct iphdr));
-	struct sockaddr saddr;
-	int saddr_len = sizeof(saddr);
+	struct sockaddr_ll saddr;
+	socklen_t saddr_len;
 	const in_addr_t addr = inet_addr(inet_ntoa((((struct sockaddr_in *)&(ifaddr->ifr_addr))->sin_addr)));
-	uint64_t all_pkts = 0;
-	const ssize_t min_size = sizeof(struct ethhdr) + sizeof(struct iphdr) + sizeof(struct udphdr);
+	uint64_t all_pkts = 0, rx_pkts = 0;
 	double t_start, duration, bytes = 0.0, rate;
+#if defined(STRESS_RAWPKT_RX_RING)
+	uint8_t *ring = MAP_FAILED;
+	size_t ring_size = 0, block_size = 0;
+	int block = 0;
+#endif
 
 	if (stress_sig_stop_stressing(args->name, SIGALRM) < 0) {
 		rc = EXIT_FAILURE;
@@ -376,12 +764,24 @@ static int OPTIMIZE3 stress_rawpkt_server(
 		tp.tp_block_nr = blocknr;
 		tp.tp_frame_size = getpagesize() / blocknr;
 		tp.tp_frame_nr = tp.tp_block_size / tp.tp_frame_size * blocknr;
+		tp.tp_retire_blk_tov = 10;	/* retire part filled blocks after 10ms */
 
 		if (setsockopt(fd, SOL_PACKET, PACKET_RX_RING, (void*) &tp, sizeof(tp)) < 0) {
 			rc = stress_exit_status(errno);
 			pr_fail("%s: setsockopt failed to set rx ring, errno=%d (%s)\n", args->name, errno, strerror(errno));
 			goto close_fd;
 		}
+#if defined(STRESS_RAWPKT_RX_RING)
+		/* received packets are only placed in the ring */
+		block_size = tp.tp_block_size;
+		ring_size = block_size * tp.tp_block_nr;
+		ring = (uint8_t *)mmap(NULL, ring_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+		if (ring == MAP_FAILED) {
+			rc = stress_exit_status(errno);
+			pr_fail("%s: mmap of rx ring failed, errno=%d (%s)\n", args->name, errno, strerror(errno));
+			goto close_fd;
+		}
+#endif
 	}
 #else
 	(void)blocknr;
@@ -389,17 +789,49 @@ static int OPTIMIZE3 stress_rawpkt_server(
 
 	t_start = stress_time_now();
 	do {
-		ssize_t n;
-
-		n = recvfrom(fd, buf, sizeof(buf), 0, &saddr, (socklen_t *)&saddr_len);
-		if (LIKELY(n >= min_size)) {
-			all_pkts++;
-			if ((eth->h_proto == htons(ETH_P_IP)) &&
-			    ((in_addr_t)ip->saddr == addr) &&
-			    (ip->protocol == SOL_UDP) &&
-			    (ntohs(udp->source) == port)) {
-				stress_bogo_inc(args);
-				bytes += (double)n;
+#if defined(STRESS_RAWPKT_RX_RING)
+		if (ring != MAP_FAILED) {
+			struct tpacket_block_desc *pbd = (struct tpacket_block_desc *)(ring + ((size_t)block * block_size));
+			const struct tpacket3_hdr *ppd;
+			uint32_t i, num_pkts;
+
+			if (!(*(volatile uint32_t *)&pbd->hdr.bh1.block_status & TP_STATUS_USER)) {
+				struct pollfd pfd;
+
+				pfd.fd = fd;
+				pfd.events = POLLIN | POLLERR;
+				pfd.revents = 0;
+				(void)poll(&pfd, 1, 10);
+				continue;
+			}
+			__sync_synchronize();
+			num_pkts = pbd->hdr.bh1.num_pkts;
+			ppd = (const struct tpacket3_hdr *)((uint8_t *)pbd + pbd->hdr.bh1.offset_to_first_pkt);
+			for (i = 0; i < num_pkts; i++) {
+				const struct sockaddr_ll *sll = (const struct sockaddr_ll *)
+					((const uint8_t *)ppd + TPACKET_ALIGN(sizeof(*ppd)));
+
+				all_pkts++;
+				stress_rawpkt_check(args, (const uint8_t *)ppd + ppd->tp_mac,
+					ppd->tp_snaplen, sll->sll_pkttype == PACKET_OUTGOING,
+					addr, port, &rx_pkts, &bytes);
+				ppd = (const struct tpacket3_hdr *)((const uint8_t *)ppd + ppd->tp_next_offset);
+			}
+			__sync_synchronize();
+			*(volatile uint32_t *)&pbd->hdr.bh1.block_status = TP_STATUS_KERNEL;
+			block = (block + 1) % blocknr;
+		} else
+#endif
+		{
+			ssize_t n;
+
+			saddr_len = sizeof(saddr);
+			n = recvfrom(fd, buf, sizeof(buf), 0, (struct sockaddr *)&saddr, &saddr_len);
+			if (LIKELY(n > 0)) {
+				all_pkts++;
+				stress_rawpkt_check(args, (const uint8_t *)buf, (size_t)n,
+					saddr.sll_pkttype == PACKET_OUTGOING,
+					addr, port, &rx_pkts, &bytes);
 			}
 		}
 #if defined(SIOCINQ)
@@ -420,8 +852,21 @@ static int OPTIMIZE3 stress_rawpkt_server(
 		(double)stress_bogo_get(args), STRESS_METRIC_TOTAL);
 	stress_metrics_set(args, 2, "packets received",
 		(double)all_pkts, STRESS_METRIC_TOTAL);
+	rate = (duration > 0.0) ? (double)stats->packets / duration : 0.0;
+	stress_metrics_set(args, 3, "Mpps sent per core",
+		rate / 1000000.0, STRESS_METRIC_HARMONIC_MEAN);
+	rate = (duration > 0.0) ? (double)rx_pkts / duration : 0.0;
+	stress_metrics_set(args, 4, "Mpps received per core",
+		rate / 1000000.0, STRESS_METRIC_HARMONIC_MEAN);
+	rate = (stats->syscalls > 0) ? (double)stats->packets / (double)stats->syscalls : 0.0;
+	stress_metrics_set(args, 5, "packets sent per send syscall",
+		rate, STRESS_METRIC_HARMONIC_MEAN);
 
 	stress_rawpkt_sockopts(fd);
+#if defined(STRESS_RAWPKT_RX_RING)
+	if (ring != MAP_FAILED)
+		(void)munmap((void *)ring, ring_size);
+#endif
 #if defined(PACKET_RX_RING) &&	\
     defined(PACKET_VERSION) &&	\
     defined(HAVE_TPACKET_REQ3)
@@ -449,19 +894,38 @@ static int stress_rawpkt(stress_args_t *args)
 	int reserved_port, rawpkt_port = DEFAULT_RAWPKT_PORT;
 	int fd, rc = EXIT_FAILURE, parent_cpu;
 	struct ifreq hwaddr, ifaddr, idx;
-	int rawpkt_rxring = 0;
+	int rawpkt_rxring = 0, rawpkt_txring = 0;
+	bool rawpkt_xdp = false;
+	size_t rawpkt_batch = DEFAULT_RAWPKT_BATCH;
+	stress_rawpkt_stats_t *stats;
 
 	if (stress_sigchld_set_handler(args) < 0)
 		return EXIT_NO_RESOURCE;
 
+	(void)stress_get_setting("rawpkt-batch", &rawpkt_batch);
 	(void)stress_get_setting("rawpkt-port", &rawpkt_port);
 	(void)stress_get_setting("rawpkt-rxring", &rawpkt_rxring);
+	(void)stress_get_setting("rawpkt-txring", &rawpkt_txring);
+	(void)stress_get_setting("rawpkt-xdp", &rawpkt_xdp);
 
 	if ((rawpkt_rxring & (rawpkt_rxring - 1)) != 0) {
 		(void)pr_inf("%s: --rawpkt-rxing value %d is not "
 			"a power of 2, disabling option\n", args->name, rawpkt_rxring);
 		rawpkt_rxring = 0;
 	}
+	if ((rawpkt_txring & (rawpkt_txring - 1)) != 0) {
+		(void)pr_inf("%s: --rawpkt-txring value %d is not "
+			"a power of 2, disabling option\n", args->name, rawpkt_txring);
+		rawpkt_txring = 0;
+	}
+#if !defined(STRESS_RAWPKT_TX_RING)
+	if (rawpkt_txring && (args->instance == 0))
+		pr_inf("%s: TPACKET_V3 TX ring not supported, using sendto\n", args->name);
+#endif
+#if !defined(STRESS_RAWPKT_XDP)
+	if (rawpkt_xdp && (args->instance == 0))
+		pr_inf("%s: AF_XDP not supported, using sendto\n", args->name);
+#endif
 	rawpkt_port += args->instance;
 	if (rawpkt_port > MAX_PORT)
 		rawpkt_port -= (MAX_PORT - MIN_PORT + 1); /* Wrap round */
@@ -512,6 +976,16 @@ static int stress_rawpkt(stress_args_t *args)
 	}
 	(void)close(fd);
 
+	/* client send statistics are shared with the server process */
+	stats = (stress_rawpkt_stats_t *)stress_mmap_populate(NULL, sizeof(*stats),
+		PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+	if (stats == MAP_FAILED) {
+		pr_inf("%s: could not allocate shared memory, errno=%d (%s)\n",
+			args->name, errno, strerror(errno));
+		return EXIT_NO_RESOURCE;
+	}
+	stress_set_vma_anon_name(stats, sizeof(*stats), "rawpkt-stats");
+
 	stress_set_proc_state(args->name, STRESS_STATE_SYNC_WAIT);
 	stress_sync_start_wait(args);
 	stress_set_proc_state(args->name, STRESS_STATE_RUN);
@@ -527,16 +1001,19 @@ again:
 		}
 		pr_fail("%s: fork failed, errno=%d (%s)\n",
 			args->name, errno, strerror(errno));
+		(void)munmap((void *)stats, sizeof(*stats));
 		return rc;
 	} else if (pid == 0) {
 		(void)stress_change_cpu(args, parent_cpu);
-		stress_rawpkt_client(args, &hwaddr, &ifaddr, &idx, rawpkt_port);
+		stress_rawpkt_client(args, &hwaddr, &ifaddr, &idx, rawpkt_port,
+			rawpkt_txring, rawpkt_xdp, rawpkt_batch, stats);
 	} else {
-		rc = stress_rawpkt_server(args, &ifaddr, rawpkt_port, rawpkt_rxring);
+		rc = stress_rawpkt_server(args, &ifaddr, rawpkt_port, rawpkt_rxring, stats);
 		(void)stress_kill_pid_wait(pid, NULL);
 	}
 finish:
 	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
+	(void)munmap((void *)stats, sizeof(*stats));
 
 	return rc;
 }
@@ -547,6 +1024,7 @@ const stressor_info_t stress_rawpkt_info = {
 	.opts = opts,
 	.supported = stress_rawpkt_supported,
 	.verify = VERIFY_ALWAYS,
+	.metrics_max = 6,
 	.help = help
 };
 #else
@@ -347,6 +347,7 @@ const stressor_info_t stress_rawsock_info = {
 	.opts = opts,
 	.supported = stress_rawsock_supported,
 	.verify = VERIFY_ALWAYS,
+	.metrics_max = 1,
 	.help = help,
 	.init = stress_rawsock_init,
 	.deinit = stress_rawsock_deinit,
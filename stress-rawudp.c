@@ -326,6 +326,7 @@ const stressor_info_t stress_rawudp_info = {
 	.opts = opts,
 	.supported = stress_rawudp_supported,
 	.verify = VERIFY_ALWAYS,
+	.metrics_max = 2,
 	.help = help
 };
 #else
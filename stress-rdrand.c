@@ -31,6 +31,7 @@
 static const stress_help_t help[] = {
 	{ NULL,	"rdrand N",	"start N workers exercising rdrand (x86 only)" },
 	{ NULL,	"rdrand-ops N",	"stop after N rdrand bogo operations" },
+	{ NULL, "rdrand-scale",	"measure rdrand and rdseed throughput as instances are added" },
 	{ NULL, "rdrand-seed",	"use rdseed instead of rdrand" },
 	{ NULL,	NULL,		NULL }
 };
@@ -38,7 +39,13 @@ static const stress_help_t help[] = {
 #define STRESS_SANE_LOOPS_QUICK	16
 #define STRESS_SANE_LOOPS	65536
 
+#define RDRAND_SCALE_BATCH	(1024)	/* successful reads per timed batch */
+#define RDRAND_SCALE_SLOT_MIN	(0.1)	/* minimum secs per scaling step */
+#define RDRAND_SCALE_GUARD	(0.1)	/* fraction of each end of a step not measured */
+#define RDRAND_SCALE_METRICS	(64)	/* maximum metrics in scaling mode */
+
 static const stress_opt_t opts[] = {
+	{ OPT_rdrand_scale, "rdrand-scale", TYPE_ID_BOOL, 0, 1, NULL },
 	{ OPT_rdrand_seed, "rdrand-seed", TYPE_ID_BOOL, 0, 1, NULL },
 	END_OPT,
 };
@@ -209,6 +216,142 @@ static inline uint64_t rand64(void)
 }
 #endif
 
+#if defined(STRESS_ARCH_X86_64) &&	\
+    defined(HAVE_ASM_X86_RDRAND)
+#define STRESS_RDRAND_SCALE
+
+/* --rdrand-scale results of one instruction at one instance count */
+typedef struct {
+	double duration;	/* measured time */
+	uint64_t reads;		/* successful reads */
+	uint64_t fails;		/* reads that failed with carry clear */
+} stress_rdrand_scale_t;
+
+/*
+ *  stress_rdrand_scale_batch()
+ *	read RDRAND_SCALE_BATCH random values, counting failed tries
+ */
+static void OPTIMIZE3 stress_rdrand_scale_batch(const bool seed, stress_rdrand_scale_t *scale)
+{
+	uint64_t val, fails = 0;
+	register int i;
+
+	if (seed) {
+#if defined(HAVE_ASM_X86_RDSEED)
+		for (i = 0; i < RDRAND_SCALE_BATCH; i++) {
+			while (!stress_asm_x86_rdseed_try(&val))
+				fails++;
+		}
+#endif
+	} else {
+		for (i = 0; i < RDRAND_SCALE_BATCH; i++) {
+			while (!stress_asm_x86_rdrand_try(&val))
+				fails++;
+		}
+	}
+	scale->fails += fails;
+	(void)val;
+}
+
+/*
+ *  stress_rdrand_scale()
+ *	step through 1, 2, 4 .. N active instances in fixed time slots
+ *	common to all instances, running rdrand and then rdseed in each
+ *	step. Inactive instances sleep, active ones measure the per
+ *	instance throughput and the failed tries (carry clear, DRNG
+ *	underflow) away from the step edges. The totals over all the
+ *	instances give the throughput curve of the shared DRNG.
+ */
+static int stress_rdrand_scale(stress_args_t *args, const bool have_rdseed)
+{
+	const size_t n_insns = have_rdseed ? 2 : 1;
+	static const char * const insn_names[] = { "rdrand", "rdseed" };
+	stress_rdrand_scale_t *scale;
+	uint32_t *step_instances, n;
+	size_t n_steps, n_slots, i;
+	double t0, slot;
+
+	for (n_steps = 1, n = 1; n < args->instances; n_steps++)
+		n = (n > args->instances / 2) ? args->instances : n * 2;
+	while ((n_steps > 1) && (n_steps * n_insns * 2 > RDRAND_SCALE_METRICS))
+		n_steps--;
+	n_slots = n_steps * n_insns;
+
+	step_instances = (uint32_t *)calloc(n_steps, sizeof(*step_instances));
+	scale = (stress_rdrand_scale_t *)calloc(n_slots, sizeof(*scale));
+	if (!step_instances || !scale) {
+		pr_inf_skip("%s: cannot allocate scaling results, skipping stressor\n",
+			args->name);
+		free(scale);
+		free(step_instances);
+		return EXIT_NO_RESOURCE;
+	}
+	for (n = 1, i = 0; i < n_steps; i++) {
+		step_instances[i] = n;
+		n = (n > args->instances / 2) ? args->instances : n * 2;
+	}
+
+	slot = (double)g_opt_timeout / (double)n_slots;
+	if (slot < RDRAND_SCALE_SLOT_MIN)
+		slot = RDRAND_SCALE_SLOT_MIN;
+	/* all instances share the same run end time and hence the same slots */
+	t0 = args->time_end - (double)g_opt_timeout;
+	if ((args->instance == 0) && (slot < 1.0))
+		pr_inf("%s: only %.2f seconds per scaling step, use a longer --timeout "
+			"for more accurate results\n", args->name, slot);
+
+	do {
+		const double now = stress_time_now();
+		const uint64_t idx = (now > t0) ? (uint64_t)((now - t0) / slot) : 0;
+		const size_t s = (size_t)(idx % n_slots);
+		const double offset = (now - t0) - ((double)idx * slot);
+		stress_rdrand_scale_t batch;
+		double t;
+
+		if (args->instance >= step_instances[s / n_insns]) {
+			(void)shim_usleep(1000);
+			continue;
+		}
+		(void)shim_memset(&batch, 0, sizeof(batch));
+		t = stress_time_now();
+		stress_rdrand_scale_batch((s % n_insns) == 1, &batch);
+		t = stress_time_now() - t;
+		stress_bogo_inc(args);
+
+		/* keep contending at the step edges but do not count them */
+		if ((offset < slot * RDRAND_SCALE_GUARD) ||
+		    (offset > slot * (1.0 - RDRAND_SCALE_GUARD)))
+			continue;
+		scale[s].duration += t;
+		scale[s].reads += RDRAND_SCALE_BATCH;
+		scale[s].fails += batch.fails;
+	} while (stress_continue(args));
+
+	for (i = 0; i < n_slots; i++) {
+		char msg[64];
+		const char *insn = insn_names[i % n_insns];
+		const uint32_t instances = step_instances[i / n_insns];
+
+		if (scale[i].duration <= 0.0)
+			continue;
+		(void)snprintf(msg, sizeof(msg), "%s MB per sec, %" PRIu32 " instance%s",
+			insn, instances, instances == 1 ? "" : "s");
+		stress_metrics_set(args, i * 2, msg,
+			((double)scale[i].reads * sizeof(uint64_t)) / (scale[i].duration * (double)MB),
+			STRESS_METRIC_TOTAL);
+		(void)snprintf(msg, sizeof(msg), "%% failed %s tries, %" PRIu32 " instance%s",
+			insn, instances, instances == 1 ? "" : "s");
+		stress_metrics_set(args, (i * 2) + 1, msg,
+			100.0 * (double)scale[i].fails / (double)(scale[i].reads + scale[i].fails),
+			STRESS_METRIC_MAXIMUM);
+	}
+	free(scale);
+	free(step_instances);
+
+	return EXIT_SUCCESS;
+}
+#endif
+
 static int stress_rdrand_sane(stress_args_t *args)
 {
 	const uint64_t r1 = rand64();
@@ -266,12 +409,19 @@ static int stress_rdrand(stress_args_t *args)
 #if defined(HAVE_SEED_CAPABILITY)
 	bool rdrand_seed = false;
 #endif
+	bool rdrand_scale = false;
 	static uint64_t ALIGN64 counters[16];
 
 	(void)shim_memset(counters, 0, sizeof(counters));
 #if defined(HAVE_SEED_CAPABILITY)
 	(void)stress_get_setting("rdrand-seed", &rdrand_seed);
 #endif
+	(void)stress_get_setting("rdrand-scale", &rdrand_scale);
+#if !defined(STRESS_RDRAND_SCALE)
+	if (rdrand_scale && (args->instance == 0))
+		pr_inf("%s: --rdrand-scale is only supported on x86-64, ignoring option\n",
+			args->name);
+#endif
 
 #if defined(STRESS_ARCH_X86) &&		\
     defined(HAVE_ASM_X86_RDRAND) &&	\
@@ -293,6 +443,14 @@ static int stress_rdrand(stress_args_t *args)
 		uint64_t c;
 
 		rc = stress_rdrand_sane(args);
+#if defined(STRESS_RDRAND_SCALE)
+		if (rdrand_scale) {
+			if (rc == EXIT_SUCCESS)
+				rc = stress_rdrand_scale(args, stress_cpu_x86_has_rdseed());
+			stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
+			return rc;
+		}
+#endif
 
 		time_start = stress_time_now();
 
@@ -389,6 +547,7 @@ const stressor_info_t stress_rdrand_info = {
 	.opts = opts,
 	.class = CLASS_CPU,
 	.verify = VERIFY_ALWAYS,
+	.metrics_max = RDRAND_SCALE_METRICS,
 	.help = help
 };
 #else
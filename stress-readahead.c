@@ -18,8 +18,14 @@
  *
  */
 #include "stress-ng.h"
+#include "core-builtin.h"
+#include "core-mincore.h"
 #include "core-pragma.h"
 
+#if defined(HAVE_SYS_SYSMACROS_H)
+#include <sys/sysmacros.h>
+#endif
+
 #define MIN_READAHEAD_BYTES	(1 * MB)
 #define MAX_READAHEAD_BYTES	(MAX_FILE_LIMIT)
 #define DEFAULT_READAHEAD_BYTES	(64 * MB)
@@ -27,16 +33,34 @@
 #define BUF_ALIGNMENT		(4096)
 #define BUF_SIZE		(4096)
 #define MAX_OFFSETS		(16)
+#define READAHEAD_STRIDE	(4 * BUF_SIZE)	/* stride mode read spacing */
+
+#define READAHEAD_MODE_RANDOM	(0)
+#define READAHEAD_MODE_SEQ	(1)
+#define READAHEAD_MODE_STRIDE	(2)
 
 static const stress_help_t help[] = {
 	{ NULL,	"readahead N",		"start N workers exercising file readahead" },
 	{ NULL,	"readahead-bytes N",	"size of file to readahead on (default is 1GB)" },
+	{ NULL,	"readahead-mode M",	"read mode: random, seq or stride (sweeps readahead windows)" },
 	{ NULL,	"readahead-ops N",	"stop after N readahead bogo operations" },
 	{ NULL,	NULL,			NULL }
 };
 
+static const char *stress_readahead_mode(const size_t i)
+{
+	static const char * const modes[] = {
+		"random",
+		"seq",
+		"stride",
+	};
+
+	return (i < SIZEOF_ARRAY(modes)) ? modes[i] : NULL;
+}
+
 static const stress_opt_t opts[] = {
 	{ OPT_readahead_bytes, "readahead-bytes", TYPE_ID_UINT64_BYTES_FS, MIN_READAHEAD_BYTES, MAX_READAHEAD_BYTES, NULL },
+	{ OPT_readahead_mode,  "readahead-mode",  TYPE_ID_SIZE_T_METHOD, 0, 0, stress_readahead_mode },
 	END_OPT,
 };
 
@@ -45,6 +69,35 @@ static const stress_opt_t opts[] = {
 
 typedef uint64_t	buffer_t;
 
+typedef struct {
+	const char *name;		/* window name for metrics */
+	const size_t window;		/* explicit readahead() window, 0 = none */
+	const bool kernel;		/* leave kernel heuristic readahead enabled */
+} stress_readahead_window_t;
+
+typedef struct {
+	double bytes;			/* bytes read */
+	double duration;		/* time in readahead and reads */
+	uint64_t reads;			/* reads with a residency check */
+	uint64_t hits;			/* reads that were already in the page cache */
+} stress_readahead_stats_t;
+
+/*
+ *  windows swept in seq and stride modes, kernel uses the normal
+ *  kernel readahead heuristics, the others disable them with
+ *  POSIX_FADV_RANDOM and issue explicit readahead() calls
+ */
+static const stress_readahead_window_t stress_readahead_windows[] = {
+	{ "kernel",	0,		true },
+	{ "none",	0,		false },
+	{ "32K",	32 * KB,	false },
+	{ "128K",	128 * KB,	false },
+	{ "512K",	512 * KB,	false },
+	{ "2M",		2 * MB,		false },
+};
+
+#define NUM_READAHEAD_WINDOWS	(SIZEOF_ARRAY(stress_readahead_windows))
+
 static void OPTIMIZE3 stress_readahead_generate_offsets(
 	off_t *offsets,
 	const uint64_t rounded_readahead_bytes)
@@ -81,6 +134,139 @@ static int do_readahead(
 	return 0;
 }
 
+/*
+ *  stress_readahead_verify()
+ *	check buffer contents read from offset, returns number of bad values
+ */
+static uint64_t OPTIMIZE3 stress_readahead_verify(const buffer_t *buf, const off_t offset)
+{
+	register size_t j;
+	const off_t o = offset / BUF_SIZE;
+	uint64_t baddata = 0;
+
+PRAGMA_UNROLL_N(8)
+	for (j = 0; j < (BUF_SIZE / sizeof(*buf)); j++) {
+		const buffer_t v = (buffer_t)o + j;
+
+		if (UNLIKELY(buf[j] != v))
+			baddata++;
+	}
+	return baddata;
+}
+
+/*
+ *  stress_readahead_device_info()
+ *	report the readahead size of the file system backing device
+ */
+static void stress_readahead_device_info(stress_args_t *args, const struct stat *statbuf)
+{
+#if defined(HAVE_SYS_SYSMACROS_H)
+	static const char * const fmts[] = {
+		"/sys/dev/block/%u:%u/queue/read_ahead_kb",
+		"/sys/dev/block/%u:%u/../queue/read_ahead_kb",	/* partitions */
+	};
+	size_t i;
+
+	for (i = 0; i < SIZEOF_ARRAY(fmts); i++) {
+		char path[PATH_MAX], buf[32];
+
+		(void)snprintf(path, sizeof(path), fmts[i],
+			(unsigned int)major(statbuf->st_dev),
+			(unsigned int)minor(statbuf->st_dev));
+		if (stress_system_read(path, buf, sizeof(buf)) > 0) {
+			pr_inf("%s: backing device readahead is %" PRIu32 " KB\n",
+				args->name, (uint32_t)atoi(buf));
+			return;
+		}
+	}
+#else
+	(void)args;
+	(void)statbuf;
+#endif
+}
+
+/*
+ *  stress_readahead_pass()
+ *	drop the file from the page cache and read through it sequentially
+ *	or strided using readahead window w, residency of each page is
+ *	checked with mincore before each read
+ */
+static int stress_readahead_pass(
+	stress_args_t *args,
+	const int fd,
+	const char *fs_type,
+	buffer_t *buf,
+	uint8_t *map,
+	const uint64_t size,
+	const off_t stride,
+	const stress_readahead_window_t *w,
+	stress_readahead_stats_t *stats,
+	uint64_t *misreads)
+{
+	const bool verify = !!(g_opt_flags & OPT_FLAGS_VERIFY);
+	const off_t page_mask = ~(off_t)(stress_get_page_size() - 1);
+	off_t offset, ra_end = 0;
+
+#if defined(HAVE_POSIX_FADVISE) &&	\
+    defined(POSIX_FADV_DONTNEED)
+	(void)posix_fadvise(fd, 0, (off_t)size, POSIX_FADV_DONTNEED);
+#endif
+#if defined(HAVE_POSIX_FADVISE) &&	\
+    defined(POSIX_FADV_NORMAL) &&	\
+    defined(POSIX_FADV_RANDOM)
+	(void)posix_fadvise(fd, 0, (off_t)size, w->kernel ? POSIX_FADV_NORMAL : POSIX_FADV_RANDOM);
+#endif
+
+	for (offset = 0; (uint64_t)offset + BUF_SIZE <= size; offset += stride) {
+		ssize_t pret;
+		size_t resident;
+		double t;
+
+		if (UNLIKELY(!stress_continue(args)))
+			break;
+		if (map && (stress_mincore_resident(map + (offset & page_mask),
+				BUF_SIZE, &resident) == 0)) {
+			stats->reads++;
+			stats->hits += (resident > 0);
+		}
+
+		t = stress_time_now();
+		/* asynchronous style readahead, stay half a window ahead */
+		while ((w->window > 0) &&
+		       ((uint64_t)ra_end < size) &&
+		       (offset + (off_t)(w->window / 2) >= ra_end)) {
+			if (UNLIKELY(readahead(fd, ra_end, w->window) < 0)) {
+				pr_fail("%s: readahead failed, errno=%d (%s)%s\n",
+					args->name, errno, strerror(errno), fs_type);
+				return -1;
+			}
+			ra_end += (off_t)w->window;
+		}
+		pret = pread(fd, buf, BUF_SIZE, offset);
+		stats->duration += stress_time_now() - t;
+		if (UNLIKELY(pret <= 0)) {
+			if ((errno == EAGAIN) || (errno == EINTR))
+				continue;
+			if (errno) {
+				pr_fail("%s: read failed, errno=%d (%s)%s\n",
+					args->name, errno, strerror(errno), fs_type);
+				return -1;
+			}
+			continue;
+		}
+		if (UNLIKELY(pret != BUF_SIZE))
+			(*misreads)++;
+		stats->bytes += (double)pret;
+		if (verify && UNLIKELY(stress_readahead_verify(buf, offset))) {
+			pr_fail("%s: error in data between 0x%" PRIxMAX " and 0x%" PRIxMAX "\n",
+				args->name, (intmax_t)offset, (intmax_t)offset + BUF_SIZE - 1);
+			return -1;
+		}
+		stress_bogo_inc(args);
+	}
+	return 0;
+}
+
 /*
  *  stress_readahead
  *	stress file system cache via readahead calls
@@ -101,6 +287,7 @@ static int stress_readahead(stress_args_t *args)
 	off_t offsets[MAX_OFFSETS] ALIGN64;
 	int generate_offsets = 0;
 	const bool verify = !!(g_opt_flags & OPT_FLAGS_VERIFY);
+	size_t readahead_mode = READAHEAD_MODE_RANDOM;
 
 	if (!stress_get_setting("readahead-bytes", &readahead_bytes)) {
 		if (g_opt_flags & OPT_FLAGS_MAXIMIZE)
@@ -108,6 +295,7 @@ static int stress_readahead(stress_args_t *args)
 		if (g_opt_flags & OPT_FLAGS_MINIMIZE)
 			readahead_bytes = MIN_READAHEAD_BYTES;
 	}
+	(void)stress_get_setting("readahead-mode", &readahead_mode);
 	readahead_bytes /= args->instances;
 	if (readahead_bytes < MIN_READAHEAD_BYTES)
 		readahead_bytes = MIN_READAHEAD_BYTES;
@@ -203,6 +391,64 @@ PRAGMA_UNROLL_N(8)
 	rounded_readahead_bytes = (uint64_t)statbuf.st_size -
 		(uint64_t)(statbuf.st_size % BUF_SIZE);
 
+	if (readahead_mode != READAHEAD_MODE_RANDOM) {
+		stress_readahead_stats_t stats[NUM_READAHEAD_WINDOWS];
+		const off_t stride = (readahead_mode == READAHEAD_MODE_STRIDE) ?
+			READAHEAD_STRIDE : BUF_SIZE;
+		uint8_t *map;
+		size_t w = 0, idx;
+
+		/* dirty pages cannot be dropped from the page cache */
+		(void)shim_fdatasync(fd);
+		if (args->instance == 0)
+			stress_readahead_device_info(args, &statbuf);
+		map = (uint8_t *)mmap(NULL, (size_t)rounded_readahead_bytes,
+			PROT_READ, MAP_SHARED, fd, 0);
+		if (map == MAP_FAILED) {
+			pr_inf("%s: cannot mmap file for page cache residency checks, "
+				"hit ratios will not be reported\n", args->name);
+			map = NULL;
+		}
+		(void)shim_memset(stats, 0, sizeof(stats));
+
+		stress_set_proc_state(args->name, STRESS_STATE_SYNC_WAIT);
+		stress_sync_start_wait(args);
+		stress_set_proc_state(args->name, STRESS_STATE_RUN);
+
+		rc = EXIT_SUCCESS;
+		do {
+			if (stress_readahead_pass(args, fd, fs_type, buf, map,
+					rounded_readahead_bytes, stride,
+					&stress_readahead_windows[w], &stats[w], &misreads) < 0) {
+				rc = EXIT_FAILURE;
+				break;
+			}
+			w = (w + 1) % NUM_READAHEAD_WINDOWS;
+		} while (stress_continue(args));
+
+		for (idx = 0, w = 0; w < NUM_READAHEAD_WINDOWS; w++) {
+			char desc[64];
+
+			if (stats[w].duration <= 0.0)
+				continue;
+			(void)snprintf(desc, sizeof(desc), "MB per sec %s readahead window",
+				stress_readahead_windows[w].name);
+			stress_metrics_set(args, idx++, desc,
+				stats[w].bytes / (stats[w].duration * (double)MB),
+				STRESS_METRIC_HARMONIC_MEAN);
+			if (stats[w].reads > 0) {
+				(void)snprintf(desc, sizeof(desc), "%% page cache hits %s readahead window",
+					stress_readahead_windows[w].name);
+				stress_metrics_set(args, idx++, desc,
+					100.0 * (double)stats[w].hits / (double)stats[w].reads,
+					STRESS_METRIC_GEOMETRIC_MEAN);
+			}
+		}
+		if (map)
+			(void)munmap((void *)map, (size_t)rounded_readahead_bytes);
+		goto close_finish;
+	}
+
 	stress_set_proc_state(args->name, STRESS_STATE_SYNC_WAIT);
 	stress_sync_start_wait(args);
 	stress_set_proc_state(args->name, STRESS_STATE_RUN);
@@ -234,16 +480,7 @@ rnd_rd_retry:
 				misreads++;
 
 			if (verify) {
-				size_t j;
-				const off_t o = offsets[i] / BUF_SIZE;
-
-PRAGMA_UNROLL_N(8)
-				for (j = 0; j < (BUF_SIZE / sizeof(*buf)); j++) {
-					const buffer_t v = (buffer_t)o + j;
-
-					if (UNLIKELY(buf[j] != v))
-						baddata++;
-				}
+				baddata += stress_readahead_verify(buf, offsets[i]);
 				if (UNLIKELY(baddata)) {
 					pr_fail("%s: error in data between 0x%" PRIxMAX " and 0x%" PRIxMAX "\n",
 						args->name,
@@ -17,11 +17,23 @@
  *
  */
 #include "stress-ng.h"
+#include "core-builtin.h"
+
+#define MIN_REGEX_CORPUS	(4 * KB)
+#define MAX_REGEX_CORPUS	(1 * GB)
 
 static const stress_help_t help[] = {
-	{ NULL,	"regex N",	"start N workers exercise POSIX regular expressions" },
-	{ NULL,	"regex-ops N",	"stop after N regular expression operations" },
-	{ NULL,	NULL,		NULL }
+	{ NULL,	"regex N",	  "start N workers exercise POSIX regular expressions" },
+	{ NULL,	"regex-corpus N", "scan a generated N byte log corpus with precompiled regexes" },
+	{ NULL,	"regex-file F",	  "scan file F as the corpus with precompiled regexes" },
+	{ NULL,	"regex-ops N",	  "stop after N regular expression operations" },
+	{ NULL,	NULL,		  NULL }
+};
+
+static const stress_opt_t opts[] = {
+	{ OPT_regex_corpus, "regex-corpus", TYPE_ID_SIZE_T_BYTES_VM, MIN_REGEX_CORPUS, MAX_REGEX_CORPUS, NULL },
+	{ OPT_regex_file,   "regex-file",   TYPE_ID_STR, 0, 0, NULL },
+	END_OPT,
 };
 
 #if defined(HAVE_REGEX_H) &&	\
@@ -32,6 +44,11 @@ static const stress_help_t help[] = {
 
 #include <regex.h>
 
+#if defined(HAVE_LIB_PCRE2)
+#define PCRE2_CODE_UNIT_WIDTH	8
+#include <pcre2.h>
+#endif
+
 #define N_REGEXES	SIZEOF_ARRAY(stress_posix_regex)
 
 typedef struct stress_posix_regex {
@@ -112,6 +129,395 @@ static double stress_regex_rate(double t[N_REGEXES], uint64_t c[N_REGEXES])
 	return (t_total > 0.0) ? (double)c_total / t_total : 0.0;
 }
 
+/*
+ *  --regex-corpus and --regex-file, patterns are compiled once and
+ *  then used to count matching lines in a large corpus, much like
+ *  grep -c, so throughput is dominated by the matcher and not regcomp
+ */
+static const stress_posix_regex_t stress_corpus_regex[] = {
+	{ "ERROR", "literal" },
+	{ "(timeout|refused|reset)", "alternation" },
+	{ "user=[a-z]+@[a-z]+\\.com", "email" },
+	{ "ip=10\\.[0-9]+\\.[0-9]+\\.[0-9]+", "IP-address" },
+	{ "latency=[0-9]{3,}\\.[0-9]+ms", "slow latency" },
+	{ "^2026/0[1-6]/[0-9]{2} ", "date prefix" },
+	{ "code=0x[0-9a-f]*ff ", "hex suffix" },
+	{ "app\\[[0-9]+\\]: (WARN|ERROR) .*refused", "level and message" },
+};
+
+#define N_CORPUS_REGEXES	SIZEOF_ARRAY(stress_corpus_regex)
+#define REGEX_WINDOW		(64 * KB)	/* POSIX regexec window size */
+
+typedef struct {
+	double bytes;		/* corpus bytes scanned */
+	double duration;	/* time scanning */
+	size_t lines;		/* matching lines from first scan */
+	bool scanned;		/* lines is valid */
+} stress_regex_corpus_stats_t;
+
+/*
+ *  stress_regex_corpus_gen()
+ *	fill corpus with len bytes of log lines, corpus[len] is '\0'
+ */
+static void stress_regex_corpus_gen(char *corpus, const size_t len)
+{
+	static const char * const levels[] = {
+		"INFO", "INFO", "INFO", "INFO", "INFO", "DEBUG", "DEBUG", "WARN", "ERROR"
+	};
+	static const char * const messages[] = {
+		"request completed",
+		"session started",
+		"cache miss",
+		"connection refused",
+		"timeout waiting for reply",
+		"connection reset by peer",
+	};
+	static const char * const names[] = {
+		"fred", "jane", "admin", "backup", "www", "root"
+	};
+	char *ptr = corpus;
+	const char *end = corpus + len;
+
+	while (ptr < end) {
+		char line[256];
+		int n;
+		size_t sz;
+
+		n = snprintf(line, sizeof(line),
+			"2026/%2.2u/%2.2u %2.2u:%2.2u:%2.2u host%u app[%u]: %s %s "
+			"ip=%u.%u.%u.%u user=%s@example.com latency=%u.%ums code=0x%x\n",
+			1 + stress_mwc8modn(12), 1 + stress_mwc8modn(28),
+			stress_mwc8modn(24), stress_mwc8modn(60), stress_mwc8modn(60),
+			stress_mwc8modn(16), stress_mwc16modn(32768),
+			levels[stress_mwc8modn(SIZEOF_ARRAY(levels))],
+			messages[stress_mwc8modn(SIZEOF_ARRAY(messages))],
+			stress_mwc1() ? 10 : 192, stress_mwc8(), stress_mwc8(), stress_mwc8(),
+			names[stress_mwc8modn(SIZEOF_ARRAY(names))],
+			stress_mwc16modn(2000), stress_mwc8modn(10), stress_mwc16());
+		if (n < 0)
+			break;
+		sz = STRESS_MINIMUM((size_t)n, (size_t)(end - ptr));
+		(void)shim_memcpy(ptr, line, sz);
+		ptr += sz;
+	}
+	corpus[len - 1] = '\n';
+	corpus[len] = '\0';
+}
+
+/*
+ *  stress_regex_corpus_load()
+ *	copy a file into corpus, NUL bytes would stop regexec early
+ *	so these are turned into newlines
+ */
+static int stress_regex_corpus_load(
+	stress_args_t *args,
+	const char *filename,
+	char **corpus,
+	size_t *len)
+{
+	struct stat statbuf;
+	void *file;
+	char *ptr, *end;
+	int fd;
+
+	fd = open(filename, O_RDONLY);
+	if (fd < 0) {
+		pr_inf_skip("%s: cannot open --regex-file %s, errno=%d (%s), "
+			"skipping stressor\n", args->name, filename, errno, strerror(errno));
+		return EXIT_NO_RESOURCE;
+	}
+	if ((fstat(fd, &statbuf) < 0) || (statbuf.st_size <= 0)) {
+		pr_inf_skip("%s: --regex-file %s is empty or cannot be stat'd, "
+			"skipping stressor\n", args->name, filename);
+		(void)close(fd);
+		return EXIT_NO_RESOURCE;
+	}
+	*len = (size_t)statbuf.st_size;
+	file = mmap(NULL, *len, PROT_READ, MAP_PRIVATE, fd, 0);
+	(void)close(fd);
+	if (file == MAP_FAILED) {
+		pr_inf_skip("%s: cannot mmap --regex-file %s, errno=%d (%s), "
+			"skipping stressor\n", args->name, filename, errno, strerror(errno));
+		return EXIT_NO_RESOURCE;
+	}
+	*corpus = (char *)stress_mmap_populate(NULL, *len + 1, PROT_READ | PROT_WRITE,
+		MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (*corpus == MAP_FAILED) {
+		pr_inf_skip("%s: cannot mmap %zu byte corpus, skipping stressor\n",
+			args->name, *len + 1);
+		(void)munmap(file, *len);
+		return EXIT_NO_RESOURCE;
+	}
+	(void)shim_memcpy(*corpus, file, *len);
+	(void)munmap(file, *len);
+
+	end = *corpus + *len;
+	for (ptr = *corpus; (ptr = (char *)memchr(ptr, '\0', (size_t)(end - ptr))) != NULL; )
+		*ptr++ = '\n';
+	(*corpus)[*len] = '\0';
+	return EXIT_SUCCESS;
+}
+
+/*
+ *  stress_regex_posix_scan()
+ *	count the lines of corpus that regex matches. regexec() costs
+ *	at least the length of the string it is given, so the corpus
+ *	is scanned in windows of whole lines, each temporarily NUL
+ *	terminated in place
+ */
+static size_t stress_regex_posix_scan(const regex_t *regex, char *corpus, const size_t len)
+{
+	char *ptr = corpus;
+	char *const end = corpus + len;
+	size_t lines = 0;
+
+	while (ptr < end) {
+		char *win_end = ptr + STRESS_MINIMUM(REGEX_WINDOW, (size_t)(end - ptr));
+		const char *str = ptr;
+		char saved;
+
+		if (win_end < end) {
+			char *eol = win_end;
+
+			while ((eol > ptr) && (eol[-1] != '\n'))
+				eol--;
+			if (eol == ptr) {
+				/* a line longer than the window */
+				eol = (char *)memchr(win_end, '\n', (size_t)(end - win_end));
+				eol = eol ? eol + 1 : end;
+			}
+			win_end = eol;
+		}
+		saved = *win_end;
+		*win_end = '\0';
+
+		while (str < win_end) {
+			regmatch_t regmatch[1];
+			const char *eol;
+
+			if (regexec(regex, str, SIZEOF_ARRAY(regmatch), regmatch, 0) != 0)
+				break;
+			lines++;
+			/* REG_NEWLINE stops matches spanning lines, skip to the next one */
+			eol = (const char *)memchr(str + regmatch[0].rm_so, '\n',
+				(size_t)(win_end - str) - (size_t)regmatch[0].rm_so);
+			if (!eol)
+				break;
+			str = eol + 1;
+		}
+		*win_end = saved;
+		ptr = win_end;
+	}
+	return lines;
+}
+
+#if defined(HAVE_LIB_PCRE2)
+/*
+ *  stress_regex_pcre2_scan()
+ *	count the lines of corpus that code matches, using the
+ *	JIT fast path if the pattern was JIT compiled
+ */
+static size_t stress_regex_pcre2_scan(
+	const pcre2_code *code,
+	pcre2_match_data *match_data,
+	const bool jit,
+	const char *corpus,
+	const size_t len)
+{
+	const PCRE2_SPTR subject = (PCRE2_SPTR)corpus;
+	const PCRE2_SIZE *ovector = pcre2_get_ovector_pointer(match_data);
+	PCRE2_SIZE offset = 0;
+	size_t lines = 0;
+
+	while (offset < len) {
+		const char *eol;
+		int ret;
+
+		if (jit)
+			ret = pcre2_jit_match(code, subject, len, offset, 0, match_data, NULL);
+		else
+			ret = pcre2_match(code, subject, len, offset, 0, match_data, NULL);
+		if (ret < 0)
+			break;
+		lines++;
+		eol = (const char *)memchr(corpus + ovector[0], '\n', len - ovector[0]);
+		if (!eol)
+			break;
+		offset = (PCRE2_SIZE)(eol - corpus) + 1;
+	}
+	return lines;
+}
+#endif
+
+/*
+ *  stress_regex_corpus_check()
+ *	each pattern must match the same number of lines on every scan
+ *	and with every engine
+ */
+static bool stress_regex_corpus_check(
+	stress_args_t *args,
+	stress_regex_corpus_stats_t *stats,
+	const size_t i,
+	const char *engine,
+	const size_t lines)
+{
+	if (!stats->scanned) {
+		stats->lines = lines;
+		stats->scanned = true;
+		return true;
+	}
+	if (stats->lines == lines)
+		return true;
+	pr_fail("%s: %s regex '%s' matched %zu lines, expected %zu\n",
+		args->name, engine, stress_corpus_regex[i].regex, lines, stats->lines);
+	return false;
+}
+
+/*
+ *  stress_regex_corpus()
+ *	scan a large corpus with precompiled POSIX and PCRE2 regexes
+ */
+static int stress_regex_corpus(
+	stress_args_t *args,
+	const size_t regex_corpus,
+	const char *regex_file)
+{
+	regex_t regex[N_CORPUS_REGEXES];
+	bool compiled[N_CORPUS_REGEXES];
+	stress_regex_corpus_stats_t stats[N_CORPUS_REGEXES][2];
+#if defined(HAVE_LIB_PCRE2)
+	pcre2_code *code[N_CORPUS_REGEXES];
+	pcre2_match_data *match_data[N_CORPUS_REGEXES];
+	bool jit[N_CORPUS_REGEXES];
+#endif
+	const bool verify = !!(g_opt_flags & OPT_FLAGS_VERIFY);
+	char *corpus;
+	size_t i, len;
+	int rc = EXIT_SUCCESS;
+
+	if (regex_file) {
+		rc = stress_regex_corpus_load(args, regex_file, &corpus, &len);
+		if (rc != EXIT_SUCCESS)
+			return rc;
+	} else {
+		len = regex_corpus;
+		corpus = (char *)stress_mmap_populate(NULL, len + 1, PROT_READ | PROT_WRITE,
+			MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		if (corpus == MAP_FAILED) {
+			pr_inf_skip("%s: cannot mmap %zu byte corpus, skipping stressor\n",
+				args->name, len + 1);
+			return EXIT_NO_RESOURCE;
+		}
+		stress_regex_corpus_gen(corpus, len);
+	}
+	stress_set_vma_anon_name(corpus, len + 1, "regex-corpus");
+
+	(void)shim_memset(stats, 0, sizeof(stats));
+	for (i = 0; i < N_CORPUS_REGEXES; i++) {
+		int ret;
+
+		ret = regcomp(&regex[i], stress_corpus_regex[i].regex, REG_EXTENDED | REG_NEWLINE);
+		compiled[i] = (ret == 0);
+		if (!compiled[i] && (args->instance == 0)) {
+			char errbuf[256];
+
+			(void)regerror(ret, &regex[i], errbuf, sizeof(errbuf));
+			pr_inf("%s: failed to compile %s regex '%s', error: %s\n",
+				args->name, stress_corpus_regex[i].description,
+				stress_corpus_regex[i].regex, errbuf);
+		}
+#if defined(HAVE_LIB_PCRE2)
+		{
+			int errcode;
+			PCRE2_SIZE erroffset;
+
+			match_data[i] = NULL;
+			jit[i] = false;
+			code[i] = pcre2_compile((PCRE2_SPTR)stress_corpus_regex[i].regex,
+				PCRE2_ZERO_TERMINATED, PCRE2_MULTILINE, &errcode, &erroffset, NULL);
+			if (code[i]) {
+				jit[i] = (pcre2_jit_compile(code[i], PCRE2_JIT_COMPLETE) == 0);
+				match_data[i] = pcre2_match_data_create_from_pattern(code[i], NULL);
+				if (!match_data[i]) {
+					pcre2_code_free(code[i]);
+					code[i] = NULL;
+				}
+			}
+		}
+#endif
+	}
+
+	stress_set_proc_state(args->name, STRESS_STATE_SYNC_WAIT);
+	stress_sync_start_wait(args);
+	stress_set_proc_state(args->name, STRESS_STATE_RUN);
+
+	do {
+		for (i = 0; LIKELY((i < N_CORPUS_REGEXES) && stress_continue(args)); i++) {
+			double t;
+			size_t lines;
+
+			if (compiled[i]) {
+				t = stress_time_now();
+				lines = stress_regex_posix_scan(&regex[i], corpus, len);
+				stats[i][0].duration += stress_time_now() - t;
+				stats[i][0].bytes += (double)len;
+				stress_bogo_inc(args);
+				if (UNLIKELY(verify && !stress_regex_corpus_check(args, &stats[i][0], i, "POSIX", lines))) {
+					rc = EXIT_FAILURE;
+					goto done;
+				}
+			}
+#if defined(HAVE_LIB_PCRE2)
+			if (code[i]) {
+				t = stress_time_now();
+				lines = stress_regex_pcre2_scan(code[i], match_data[i], jit[i], corpus, len);
+				stats[i][1].duration += stress_time_now() - t;
+				stats[i][1].bytes += (double)len;
+				stress_bogo_inc(args);
+				/* both engines count the same lines, so check against POSIX when possible */
+				if (UNLIKELY(verify && !stress_regex_corpus_check(args,
+						compiled[i] ? &stats[i][0] : &stats[i][1], i, "PCRE2", lines))) {
+					rc = EXIT_FAILURE;
+					goto done;
+				}
+			}
+#endif
+		}
+	} while (stress_continue(args));
+done:
+	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
+
+	for (i = 0; i < N_CORPUS_REGEXES; i++) {
+		char str[64];
+
+		if (stats[i][0].duration > 0.0) {
+			(void)snprintf(str, sizeof(str), "POSIX '%s' MB per sec",
+				stress_corpus_regex[i].description);
+			stress_metrics_set(args, i * 2, str,
+				stats[i][0].bytes / (stats[i][0].duration * (double)MB),
+				STRESS_METRIC_HARMONIC_MEAN);
+		}
+#if defined(HAVE_LIB_PCRE2)
+		if (stats[i][1].duration > 0.0) {
+			(void)snprintf(str, sizeof(str), "PCRE2%s '%s' MB per sec",
+				jit[i] ? " JIT" : "", stress_corpus_regex[i].description);
+			stress_metrics_set(args, (i * 2) + 1, str,
+				stats[i][1].bytes / (stats[i][1].duration * (double)MB),
+				STRESS_METRIC_HARMONIC_MEAN);
+		}
+		if (match_data[i])
+			pcre2_match_data_free(match_data[i]);
+		if (code[i])
+			pcre2_code_free(code[i]);
+#endif
+		if (compiled[i])
+			regfree(&regex[i]);
+	}
+	(void)munmap((void *)corpus, len + 1);
+
+	return rc;
+}
+
 /*
  *  stress_regex()
  *	stress POSIX regular expressions
@@ -119,6 +525,8 @@ static double stress_regex_rate(double t[N_REGEXES], uint64_t c[N_REGEXES])
 static int stress_regex(stress_args_t *args)
 {
 	size_t i;
+	size_t regex_corpus = 0;
+	char *regex_file = NULL;
 
 	double comp_times[N_REGEXES];
 	double exec_times[N_REGEXES];
@@ -134,6 +542,11 @@ static int stress_regex(stress_args_t *args)
 		failed[i] = false;
 	}
 
+	(void)stress_get_setting("regex-corpus", &regex_corpus);
+	(void)stress_get_setting("regex-file", &regex_file);
+	if (regex_corpus || regex_file)
+		return stress_regex_corpus(args, regex_corpus, regex_file);
+
 	stress_set_proc_state(args->name, STRESS_STATE_SYNC_WAIT);
 	stress_sync_start_wait(args);
 	stress_set_proc_state(args->name, STRESS_STATE_RUN);
@@ -208,6 +621,8 @@ static int stress_regex(stress_args_t *args)
 const stressor_info_t stress_regex_info = {
 	.stressor = stress_regex,
 	.class = CLASS_CPU,
+	.opts = opts,
+	.verify = VERIFY_OPTIONAL,
 	.help = help
 };
 #else
@@ -215,6 +630,7 @@ const stressor_info_t stress_regex_info = {
 const stressor_info_t stress_regex_info = {
 	.stressor = stress_unimplemented,
 	.class = CLASS_CPU,
+	.opts = opts,
 	.help = help,
 	.unimplemented_reason = "no POSIX regex support"
 };
@@ -334,6 +334,7 @@ const stressor_info_t stress_remap_info = {
 	.opts = opts,
 	.class = CLASS_MEMORY | CLASS_OS,
 	.verify = VERIFY_ALWAYS,
+	.metrics_max = 1,
 	.help = help
 };
 #else
@@ -467,5 +467,6 @@ const stressor_info_t stress_revio_info = {
 	.class = CLASS_IO | CLASS_OS,
 	.opts = opts,
 	.verify = VERIFY_ALWAYS,
+	.metrics_max = 1,
 	.help = help
 };
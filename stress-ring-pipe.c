@@ -280,6 +280,7 @@ const stressor_info_t stress_ring_pipe_info = {
 	.class = CLASS_PIPE_IO | CLASS_OS,
 	.opts = opts,
 	.verify = VERIFY_NONE,
+	.metrics_max = 2,
 	.help = help
 };
 
@@ -22,6 +22,7 @@
 #include "core-helper.h"
 #include "core-out-of-memory.h"
 #include "core-pragma.h"
+#include "core-pthread.h"
 
 #if defined(HAVE_LINUX_RSEQ_H)
 #include <linux/rseq.h>
@@ -30,12 +31,23 @@
 #include <sys/rseq.h>
 #endif
 
+#define MIN_RSEQ_THREADS	(1)
+#define MAX_RSEQ_THREADS	(64)
+
 static const stress_help_t help[] = {
 	{ NULL,	"rseq N",	"start N workers that exercise restartable sequences" },
+	{ NULL,	"rseq-bench",	"benchmark rseq per-CPU counters and freelists against atomics" },
 	{ NULL,	"rseq-ops N",	"stop after N bogo restartable sequence operations" },
+	{ NULL,	"rseq-threads N", "maximum number of rseq-bench threads, default is number of CPUs" },
 	{ NULL,	NULL,		NULL }
 };
 
+static const stress_opt_t opts[] = {
+	{ OPT_rseq_bench,   "rseq-bench",   TYPE_ID_BOOL, 0, 1, NULL },
+	{ OPT_rseq_threads, "rseq-threads", TYPE_ID_UINT32, MIN_RSEQ_THREADS, MAX_RSEQ_THREADS, NULL },
+	END_OPT,
+};
+
 #if defined(HAVE_LINUX_RSEQ_H) &&		\
     defined(HAVE_ASM_NOP) &&			\
     defined(__NR_rseq) &&			\
@@ -176,6 +188,512 @@ static int stress_rseq_supported(const char *name)
 	return 0;
 }
 
+#if defined(STRESS_ARCH_X86_64) &&		\
+    defined(HAVE_LIB_PTHREAD) &&		\
+    defined(HAVE_ATOMIC_FETCH_ADD) &&		\
+    defined(HAVE_ATOMIC_LOAD)
+#define STRESS_RSEQ_BENCH
+#endif
+
+#if defined(STRESS_RSEQ_BENCH)
+
+#define STRESS_RSEQ_STR_(x)		#x
+#define STRESS_RSEQ_STR(x)		STRESS_RSEQ_STR_(x)
+
+#define STRESS_RSEQ_BENCH_CELL_NS	(50000000ULL)	/* duration of each sweep cell */
+#define STRESS_RSEQ_BENCH_STEPS		(8)		/* max thread count steps */
+#define STRESS_RSEQ_BENCH_NODES		(16)		/* freelist nodes per thread */
+
+#define STRESS_RSEQ_ATOMIC_COUNTER	(0)
+#define STRESS_RSEQ_SHARDED_ATOMIC	(1)
+#define STRESS_RSEQ_PERCPU_COUNTER	(2)
+#define STRESS_RSEQ_LOCKED_FREELIST	(3)
+#define STRESS_RSEQ_PERCPU_FREELIST	(4)
+#define STRESS_RSEQ_METHODS		(5)
+
+static const char * const stress_rseq_methods[STRESS_RSEQ_METHODS] = {
+	"atomic-counter",
+	"sharded-atomic",
+	"rseq-counter",
+	"locked-freelist",
+	"rseq-freelist",
+};
+
+typedef struct stress_rseq_node {
+	struct stress_rseq_node *next;	/* must be first, see rseq asm */
+} stress_rseq_node_t;
+
+typedef struct {
+	uint64_t count;			/* per-CPU counter or atomic shard */
+	stress_rseq_node_t *head;	/* per-CPU freelist */
+} ALIGN64 stress_rseq_percpu_t;
+
+typedef struct {
+	pthread_t pthread;
+	stress_rseq_node_t *stash;	/* nodes owned by thread, not on a list */
+	uint64_t ops;			/* operations in this cell */
+	int method;			/* benchmark method */
+	int ret;			/* pthread_create return */
+} ALIGN64 stress_rseq_thread_t;
+
+static stress_rseq_percpu_t *rseq_percpu;
+static uint32_t rseq_n_percpu;
+static uint64_t ALIGN64 rseq_shared_counter;
+static stress_rseq_node_t *rseq_locked_head;
+static pthread_mutex_t rseq_locked_mutex = PTHREAD_MUTEX_INITIALIZER;
+static volatile bool rseq_bench_go;
+static volatile bool rseq_bench_stop;
+
+/*
+ *  The per-CPU operations below follow the librseq x86-64 layout,
+ *  the critical section descriptor lives in the __rseq_cs section,
+ *  the abort handler is preceded by the RSEQ_SIG signature that
+ *  glibc registered and the final store is the single commit
+ *  instruction. A non-zero return means the sequence was aborted
+ *  by preemption, signal delivery or migration and must be retried.
+ */
+
+/*
+ *  stress_rseq_percpu_add()
+ *	add 1 to *v if still running on cpu
+ */
+static inline int stress_rseq_percpu_add(struct rseq *rs, uint64_t *v, const uint32_t cpu)
+{
+	int aborted;
+
+	__asm__ __volatile__(
+		".pushsection __rseq_cs, \"aw\"\n\t"
+		".balign 32\n\t"
+		"3:\n\t"
+		".long 0x0, 0x0\n\t"
+		".quad 1f, (2f - 1f), 4f\n\t"
+		".popsection\n\t"
+		"leaq 3b(%%rip), %%rax\n\t"
+		"movq %%rax, (%[rseq_cs])\n\t"
+		"1:\n\t"
+		"cmpl %[cpu], %[cpu_id]\n\t"
+		"jnz 4f\n\t"
+		"addq $1, %[v]\n\t"
+		"2:\n\t"
+		"xorl %[aborted], %[aborted]\n\t"
+		".pushsection __rseq_failure, \"ax\"\n\t"
+		".byte 0x0f, 0xb9, 0x3d\n\t"
+		".long " STRESS_RSEQ_STR(RSEQ_SIG) "\n\t"
+		"4:\n\t"
+		"movl $1, %[aborted]\n\t"
+		"jmp 5f\n\t"
+		".popsection\n\t"
+		"5:\n\t"
+		: [aborted] "=&r" (aborted),
+		  [v] "+m" (*v)
+		: [cpu] "r" (cpu),
+		  [cpu_id] "m" (rs->cpu_id),
+		  [rseq_cs] "r" (&rs->rseq_cs)
+		: "memory", "cc", "rax");
+
+	return aborted;
+}
+
+/*
+ *  stress_rseq_percpu_push()
+ *	push node onto the *head list if still running on cpu
+ */
+static inline int stress_rseq_percpu_push(
+	struct rseq *rs,
+	stress_rseq_node_t **head,
+	stress_rseq_node_t *node,
+	const uint32_t cpu)
+{
+	int aborted;
+
+	__asm__ __volatile__(
+		".pushsection __rseq_cs, \"aw\"\n\t"
+		".balign 32\n\t"
+		"3:\n\t"
+		".long 0x0, 0x0\n\t"
+		".quad 1f, (2f - 1f), 4f\n\t"
+		".popsection\n\t"
+		"leaq 3b(%%rip), %%rax\n\t"
+		"movq %%rax, (%[rseq_cs])\n\t"
+		"1:\n\t"
+		"cmpl %[cpu], %[cpu_id]\n\t"
+		"jnz 4f\n\t"
+		"movq %[head], %%rcx\n\t"
+		"movq %%rcx, (%[node])\n\t"
+		"movq %[node], %[head]\n\t"
+		"2:\n\t"
+		"xorl %[aborted], %[aborted]\n\t"
+		".pushsection __rseq_failure, \"ax\"\n\t"
+		".byte 0x0f, 0xb9, 0x3d\n\t"
+		".long " STRESS_RSEQ_STR(RSEQ_SIG) "\n\t"
+		"4:\n\t"
+		"movl $1, %[aborted]\n\t"
+		"jmp 5f\n\t"
+		".popsection\n\t"
+		"5:\n\t"
+		: [aborted] "=&r" (aborted),
+		  [head] "+m" (*head)
+		: [cpu] "r" (cpu),
+		  [cpu_id] "m" (rs->cpu_id),
+		  [rseq_cs] "r" (&rs->rseq_cs),
+		  [node] "r" (node)
+		: "memory", "cc", "rax", "rcx");
+
+	return aborted;
+}
+
+/*
+ *  stress_rseq_percpu_pop()
+ *	pop a node from the *head list if still running on cpu,
+ *	*node is NULL if the list is empty
+ */
+static inline int stress_rseq_percpu_pop(
+	struct rseq *rs,
+	stress_rseq_node_t **head,
+	stress_rseq_node_t **node,
+	const uint32_t cpu)
+{
+	int aborted;
+	stress_rseq_node_t *n;
+
+	__asm__ __volatile__(
+		".pushsection __rseq_cs, \"aw\"\n\t"
+		".balign 32\n\t"
+		"3:\n\t"
+		".long 0x0, 0x0\n\t"
+		".quad 1f, (2f - 1f), 4f\n\t"
+		".popsection\n\t"
+		"leaq 3b(%%rip), %%rax\n\t"
+		"movq %%rax, (%[rseq_cs])\n\t"
+		"1:\n\t"
+		"cmpl %[cpu], %[cpu_id]\n\t"
+		"jnz 4f\n\t"
+		"movq %[head], %[n]\n\t"
+		"testq %[n], %[n]\n\t"
+		"jz 2f\n\t"
+		"movq (%[n]), %%rcx\n\t"
+		"movq %%rcx, %[head]\n\t"
+		"2:\n\t"
+		"xorl %[aborted], %[aborted]\n\t"
+		".pushsection __rseq_failure, \"ax\"\n\t"
+		".byte 0x0f, 0xb9, 0x3d\n\t"
+		".long " STRESS_RSEQ_STR(RSEQ_SIG) "\n\t"
+		"4:\n\t"
+		"movl $1, %[aborted]\n\t"
+		"jmp 5f\n\t"
+		".popsection\n\t"
+		"5:\n\t"
+		: [aborted] "=&r" (aborted),
+		  [n] "=&r" (n),
+		  [head] "+m" (*head)
+		: [cpu] "r" (cpu),
+		  [cpu_id] "m" (rs->cpu_id),
+		  [rseq_cs] "r" (&rs->rseq_cs)
+		: "memory", "cc", "rax", "rcx");
+
+	*node = n;
+	return aborted;
+}
+
+/*
+ *  stress_rseq_bench_cpu()
+ *	current CPU of the thread, clamped to the per-CPU array
+ */
+static inline uint32_t stress_rseq_bench_cpu(struct rseq *rs)
+{
+	const uint32_t cpu = STRESS_ACCESS_ONCE(rs->cpu_id_start);
+
+	return LIKELY(cpu < rseq_n_percpu) ? cpu : cpu % rseq_n_percpu;
+}
+
+static inline stress_rseq_node_t *stress_rseq_stash_pop(stress_rseq_thread_t *thread)
+{
+	stress_rseq_node_t *node = thread->stash;
+
+	if (node)
+		thread->stash = node->next;
+	return node;
+}
+
+/*
+ *  stress_rseq_bench_freelist()
+ *	repeatedly push a node and pop a node, nodes may migrate
+ *	between lists when the thread migrates between CPUs so
+ *	fall back to the thread's stash when a list is empty
+ */
+static void OPTIMIZE3 stress_rseq_bench_freelist(stress_rseq_thread_t *thread, struct rseq *rs)
+{
+	stress_rseq_node_t *node = stress_rseq_stash_pop(thread);
+	const bool locked = (thread->method == STRESS_RSEQ_LOCKED_FREELIST);
+	uint64_t ops = 0;
+
+	while (LIKELY(!rseq_bench_stop)) {
+		if (locked) {
+			(void)pthread_mutex_lock(&rseq_locked_mutex);
+			if (node) {
+				node->next = rseq_locked_head;
+				rseq_locked_head = node;
+			}
+			node = rseq_locked_head;
+			if (node)
+				rseq_locked_head = node->next;
+			(void)pthread_mutex_unlock(&rseq_locked_mutex);
+		} else {
+			uint32_t cpu;
+
+			if (node) {
+				do {
+					cpu = stress_rseq_bench_cpu(rs);
+				} while (stress_rseq_percpu_push(rs, &rseq_percpu[cpu].head, node, cpu));
+			}
+			do {
+				cpu = stress_rseq_bench_cpu(rs);
+			} while (stress_rseq_percpu_pop(rs, &rseq_percpu[cpu].head, &node, cpu));
+		}
+		if (UNLIKELY(!node))
+			node = stress_rseq_stash_pop(thread);
+		ops++;
+	}
+	if (node) {
+		node->next = thread->stash;
+		thread->stash = node;
+	}
+	thread->ops = ops;
+}
+
+/*
+ *  stress_rseq_bench_thread()
+ *	exercise one benchmark method until told to stop
+ */
+static void OPTIMIZE3 *stress_rseq_bench_thread(void *arg)
+{
+	stress_rseq_thread_t *thread = (stress_rseq_thread_t *)arg;
+	struct rseq *rs = stress_rseq_get_area();
+	uint64_t ops = 0;
+
+	while (!rseq_bench_go && !rseq_bench_stop)
+		(void)shim_sched_yield();
+
+	switch (thread->method) {
+	case STRESS_RSEQ_ATOMIC_COUNTER:
+		while (LIKELY(!rseq_bench_stop)) {
+			(void)__atomic_fetch_add(&rseq_shared_counter, 1, __ATOMIC_RELAXED);
+			ops++;
+		}
+		break;
+	case STRESS_RSEQ_SHARDED_ATOMIC:
+		while (LIKELY(!rseq_bench_stop)) {
+			const uint32_t cpu = stress_rseq_bench_cpu(rs);
+
+			(void)__atomic_fetch_add(&rseq_percpu[cpu].count, 1, __ATOMIC_RELAXED);
+			ops++;
+		}
+		break;
+	case STRESS_RSEQ_PERCPU_COUNTER:
+		while (LIKELY(!rseq_bench_stop)) {
+			uint32_t cpu;
+
+			do {
+				cpu = stress_rseq_bench_cpu(rs);
+			} while (stress_rseq_percpu_add(rs, &rseq_percpu[cpu].count, cpu));
+			ops++;
+		}
+		break;
+	default:
+		stress_rseq_bench_freelist(thread, rs);
+		return &g_nowt;
+	}
+	thread->ops = ops;
+	return &g_nowt;
+}
+
+/*
+ *  stress_rseq_bench_cell()
+ *	run n_threads threads of one method, verify the counters or
+ *	freelists are consistent and return the total operations
+ */
+static int stress_rseq_bench_cell(
+	stress_args_t *args,
+	const int method,
+	stress_rseq_thread_t *threads,
+	const uint32_t n_threads,
+	stress_rseq_node_t *nodes,
+	uint64_t *total_ops,
+	double *duration)
+{
+	uint32_t i, created = 0;
+	uint64_t ops = 0, sum = 0;
+	double t_start = 0.0, t_end;
+
+	(void)shim_memset(rseq_percpu, 0, sizeof(*rseq_percpu) * rseq_n_percpu);
+	rseq_shared_counter = 0;
+	rseq_locked_head = NULL;
+	rseq_bench_go = false;
+	rseq_bench_stop = false;
+
+	for (i = 0; i < n_threads; i++) {
+		stress_rseq_node_t *thread_nodes = &nodes[i * STRESS_RSEQ_BENCH_NODES];
+		size_t j;
+
+		for (j = 0; j < STRESS_RSEQ_BENCH_NODES - 1; j++)
+			thread_nodes[j].next = &thread_nodes[j + 1];
+		thread_nodes[j].next = NULL;
+		threads[i].stash = thread_nodes;
+		threads[i].ops = 0;
+		threads[i].method = method;
+		threads[i].ret = pthread_create(&threads[i].pthread, NULL,
+				stress_rseq_bench_thread, (void *)&threads[i]);
+		if (threads[i].ret)
+			break;
+		created++;
+	}
+	if (created == n_threads) {
+		t_start = stress_time_now();
+		rseq_bench_go = true;
+		(void)shim_nanosleep_uint64(STRESS_RSEQ_BENCH_CELL_NS);
+	}
+	rseq_bench_stop = true;
+	for (i = 0; i < created; i++)
+		VOID_RET(int, pthread_join(threads[i].pthread, NULL));
+	t_end = stress_time_now();
+
+	if (created < n_threads) {
+		pr_inf_skip("%s: cannot create %" PRIu32 " threads, skipping stressor\n",
+			args->name, n_threads);
+		return EXIT_NO_RESOURCE;
+	}
+
+	for (i = 0; i < n_threads; i++)
+		ops += threads[i].ops;
+
+	switch (method) {
+	case STRESS_RSEQ_ATOMIC_COUNTER:
+		sum = rseq_shared_counter;
+		break;
+	case STRESS_RSEQ_SHARDED_ATOMIC:
+	case STRESS_RSEQ_PERCPU_COUNTER:
+		for (i = 0; i < rseq_n_percpu; i++)
+			sum += rseq_percpu[i].count;
+		break;
+	default:
+		/* every node must be on exactly one list or stash */
+		{
+			const uint64_t n_nodes = (uint64_t)n_threads * STRESS_RSEQ_BENCH_NODES;
+			const stress_rseq_node_t *node;
+
+			for (node = rseq_locked_head; node && (sum <= n_nodes); node = node->next)
+				sum++;
+			for (i = 0; i < rseq_n_percpu; i++)
+				for (node = rseq_percpu[i].head; node && (sum <= n_nodes); node = node->next)
+					sum++;
+			for (i = 0; i < n_threads; i++)
+				for (node = threads[i].stash; node && (sum <= n_nodes); node = node->next)
+					sum++;
+			if (sum != n_nodes) {
+				pr_fail("%s: %s found %" PRIu64 " nodes, expected %" PRIu64 "\n",
+					args->name, stress_rseq_methods[method], sum, n_nodes);
+				return EXIT_FAILURE;
+			}
+		}
+		sum = ops;
+		break;
+	}
+	if (sum != ops) {
+		pr_fail("%s: %s counted %" PRIu64 " increments, expected %" PRIu64 "\n",
+			args->name, stress_rseq_methods[method], sum, ops);
+		return EXIT_FAILURE;
+	}
+	*total_ops += ops;
+	*duration += t_end - t_start;
+	stress_bogo_add(args, ops);
+
+	return EXIT_SUCCESS;
+}
+
+/*
+ *  stress_rseq_bench()
+ *	compare rseq per-CPU counters and freelists against a
+ *	shared atomic counter, sharded atomics and a locked
+ *	freelist at increasing thread counts
+ */
+static int stress_rseq_bench(stress_args_t *args)
+{
+	int32_t cpus = stress_get_processors_online();
+	uint32_t rseq_threads, steps[STRESS_RSEQ_BENCH_STEPS], n;
+	size_t n_steps = 0, s, metric = 0;
+	int m, rc = EXIT_SUCCESS;
+	uint64_t total_ops[STRESS_RSEQ_METHODS][STRESS_RSEQ_BENCH_STEPS];
+	double duration[STRESS_RSEQ_METHODS][STRESS_RSEQ_BENCH_STEPS];
+	stress_rseq_thread_t *threads;
+	stress_rseq_node_t *nodes;
+
+	if (!stress_get_setting("rseq-threads", &rseq_threads)) {
+		rseq_threads = (cpus < 2) ? 2 : (uint32_t)cpus;
+		if (rseq_threads > MAX_RSEQ_THREADS)
+			rseq_threads = MAX_RSEQ_THREADS;
+	}
+	/* thread counts 1, 2, 4.. up to and including rseq_threads */
+	for (n = 1; (n < rseq_threads) && (n_steps < STRESS_RSEQ_BENCH_STEPS - 1); n <<= 1)
+		steps[n_steps++] = n;
+	steps[n_steps++] = rseq_threads;
+
+	cpus = stress_get_processors_configured();
+	rseq_n_percpu = (cpus < 1) ? 1 : (uint32_t)cpus;
+	rseq_percpu = (stress_rseq_percpu_t *)calloc(rseq_n_percpu, sizeof(*rseq_percpu));
+	threads = (stress_rseq_thread_t *)calloc(rseq_threads, sizeof(*threads));
+	nodes = (stress_rseq_node_t *)calloc((size_t)rseq_threads * STRESS_RSEQ_BENCH_NODES, sizeof(*nodes));
+	if (!rseq_percpu || !threads || !nodes) {
+		pr_inf_skip("%s: cannot allocate per-CPU and thread data, "
+			"skipping stressor\n", args->name);
+		rc = EXIT_NO_RESOURCE;
+		goto free_data;
+	}
+	(void)shim_memset(total_ops, 0, sizeof(total_ops));
+	(void)shim_memset(duration, 0, sizeof(duration));
+
+	stress_set_proc_state(args->name, STRESS_STATE_SYNC_WAIT);
+	stress_sync_start_wait(args);
+	stress_set_proc_state(args->name, STRESS_STATE_RUN);
+
+	do {
+		for (m = 0; m < STRESS_RSEQ_METHODS; m++) {
+			for (s = 0; s < n_steps; s++) {
+				rc = stress_rseq_bench_cell(args, m, threads, steps[s],
+					nodes, &total_ops[m][s], &duration[m][s]);
+				if (rc != EXIT_SUCCESS)
+					goto done;
+				if (UNLIKELY(!stress_continue(args)))
+					goto done;
+			}
+		}
+	} while (stress_continue(args));
+done:
+	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
+
+	for (m = 0; m < STRESS_RSEQ_METHODS; m++) {
+		for (s = 0; s < n_steps; s++) {
+			char str[64];
+
+			if (duration[m][s] <= 0.0)
+				continue;
+			(void)snprintf(str, sizeof(str), "%s ops per sec, %" PRIu32 " threads",
+				stress_rseq_methods[m], steps[s]);
+			stress_metrics_set(args, metric++, str,
+				(double)total_ops[m][s] / duration[m][s],
+				STRESS_METRIC_HARMONIC_MEAN);
+		}
+	}
+
+free_data:
+	free(nodes);
+	free(threads);
+	free(rseq_percpu);
+	rseq_percpu = NULL;
+
+	return rc;
+}
+#endif
+
 /*
  *  stress_rseq()
  *	exercise restartable sequences rseq
@@ -218,6 +736,18 @@ static int stress_rseq(stress_args_t *args)
 {
 	int ret;
 	double rate;
+	bool rseq_bench = false;
+
+	(void)stress_get_setting("rseq-bench", &rseq_bench);
+	if (rseq_bench) {
+#if defined(STRESS_RSEQ_BENCH)
+		return stress_rseq_bench(args);
+#else
+		if (args->instance == 0)
+			pr_inf("%s: rseq-bench is only supported on x86-64, "
+				"exercising rseq critical sections instead\n", args->name);
+#endif
+	}
 
 	/*
 	 *  rseq_info is in a shared page to avoid losing the
@@ -260,12 +790,14 @@ const stressor_info_t stress_rseq_info = {
 	.stressor = stress_rseq,
 	.supported = stress_rseq_supported,
 	.class = CLASS_CPU,
+	.opts = opts,
 	.help = help
 };
 #else
 const stressor_info_t stress_rseq_info = {
 	.stressor = stress_unimplemented,
 	.class = CLASS_CPU,
+	.opts = opts,
 	.help = help,
 	.unimplemented_reason = "built without Linux restartable sequences support"
 };
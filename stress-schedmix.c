@@ -21,6 +21,8 @@
 #include "core-builtin.h"
 #include "core-capabilities.h"
 #include "core-killpid.h"
+#include "core-latency.h"
+#include "core-lock.h"
 #include "core-sched.h"
 
 #include <sched.h>
@@ -48,15 +50,34 @@
 #define MAX_SCHEDMIX_PROCS	(64)
 #define DEFAULT_SCHEDMIX_PROCS	(16)
 
+#define MIN_SCHEDMIX_SLICE_US	(100)
+#define MAX_SCHEDMIX_SLICE_US	(100000)
+
 static const stress_help_t help[] = {
 	{ NULL,	"schedmix N",		"start N workers that exercise a mix of scheduling loads" },
 	{ NULL,	"schedmix-ops N",	"stop after N schedmix bogo operations" },
+	{ NULL, "schedmix-policy P",	"select scheduling policy P, default is mix of all policies" },
 	{ NULL, "schedmix-procs N",	"select number of schedmix child processes 1..64" },
+	{ NULL, "schedmix-slice-us N",	"request a fair scheduler time slice of N microseconds" },
 	{ NULL,	NULL,			NULL }
 };
 
+/*
+ *  stress_schedmix_policy()
+ *	policy names for --schedmix-policy, "mix" followed
+ *	by the available scheduling policies
+ */
+static const char *stress_schedmix_policy(const size_t i)
+{
+	if (i == 0)
+		return "mix";
+	return (i <= stress_sched_types_length) ? stress_sched_types[i - 1].sched_name : NULL;
+}
+
 static const stress_opt_t opts[] = {
+	{ OPT_schedmix_policy,   "schedmix-policy",   TYPE_ID_SIZE_T_METHOD, 0, 0, stress_schedmix_policy },
         { OPT_schedmix_procs, "schedmix-procs", TYPE_ID_SIZE_T, MIN_SCHEDMIX_PROCS, MAX_SCHEDMIX_PROCS, NULL },
+	{ OPT_schedmix_slice_us, "schedmix-slice-us", TYPE_ID_UINT32, MIN_SCHEDMIX_SLICE_US, MAX_SCHEDMIX_SLICE_US, NULL },
 	END_OPT,
 };
 
@@ -76,6 +97,59 @@ typedef struct {
 static stress_schedmix_sem_t *schedmix_sem;
 #endif
 
+typedef struct {
+	stress_latency_hist_t *hists;	/* shared per-policy wakeup latency histograms */
+	void *lock;			/* lock for merging into hists */
+	size_t policy;			/* 0 = random mix, otherwise policy index + 1 */
+	uint64_t slice_ns;		/* fair scheduler slice request, 0 = default */
+} stress_schedmix_ctxt_t;
+
+/*
+ *  stress_schedmix_policy_index()
+ *	map a scheduling policy to the stress_sched_types index,
+ *	returns -1 if not found
+ */
+static ssize_t stress_schedmix_policy_index(int policy)
+{
+	size_t i;
+
+#if defined(SCHED_RESET_ON_FORK)
+	policy &= ~SCHED_RESET_ON_FORK;
+#endif
+	for (i = 0; i < stress_sched_types_length; i++) {
+		if (stress_sched_types[i].sched == policy)
+			return (ssize_t)i;
+	}
+	return -1;
+}
+
+/*
+ *  stress_schedmix_wakeup_latency()
+ *	sleep for a short random time and measure how late the
+ *	process gets to run after the timer expires, recorded
+ *	against the scheduling policy the process is running with
+ */
+static void stress_schedmix_wakeup_latency(
+	stress_args_t *args,
+	stress_latency_hist_t *hists)
+{
+	const uint64_t sleep_ns = 10000 + stress_mwc32modn(990000);
+	const ssize_t idx = stress_schedmix_policy_index(sched_getscheduler(0));
+	uint64_t t_begin, t_end;
+
+	if (idx < 0)
+		return;
+	t_begin = stress_latency_now();
+	if (UNLIKELY(shim_nanosleep_uint64(sleep_ns) < 0))
+		return;
+	t_end = stress_latency_now();
+	/* sleep cut short when the stressor is terminating */
+	if (UNLIKELY(!stress_continue(args)))
+		return;
+	stress_latency_hist_record(&hists[idx],
+		(t_end - t_begin > sleep_ns) ? (t_end - t_begin - sleep_ns) : 0);
+}
+
 static inline void stress_schedmix_waste_time(stress_args_t *args)
 {
 	int i, n, status;
@@ -305,9 +379,17 @@ static void stress_schedmix_itimer_handler(int signum)
 }
 #endif
 
-static int stress_schedmix_child(stress_args_t *args)
+static int stress_schedmix_child(stress_args_t *args, const stress_schedmix_ctxt_t *ctxt)
 {
 	int old_policy = -1, rc = EXIT_SUCCESS;
+	stress_latency_hist_t *hists;
+	size_t i;
+
+	hists = (stress_latency_hist_t *)calloc(stress_sched_types_length, sizeof(*hists));
+	if (hists) {
+		for (i = 0; i < stress_sched_types_length; i++)
+			stress_latency_hist_init(&hists[i]);
+	}
 
 #if defined(HAVE_SETITIMER) &&	\
     defined(ITIMER_PROF)
@@ -333,9 +415,13 @@ static int stress_schedmix_child(stress_args_t *args)
 		 *  find a new randomized policy that is not the same
 		 *  as the previous old policy
 		 */
-		do {
-			policy = stress_mwc8modn((uint8_t)stress_sched_types_length);
-		} while (policy == old_policy);
+		if (ctxt->policy) {
+			policy = (int)ctxt->policy - 1;
+		} else {
+			do {
+				policy = stress_mwc8modn((uint8_t)stress_sched_types_length);
+			} while (policy == old_policy);
+		}
 		old_policy = policy;
 
 		new_policy = stress_sched_types[policy].sched;
@@ -393,6 +479,21 @@ static int stress_schedmix_child(stress_args_t *args)
      defined(SCHED_IDLE) ||		\
      defined(SCHED_BATCH)
 case_sched_other:
+#endif
+#if defined(SCHED_DEADLINE) &&		\
+    defined(HAVE_SCHED_GETATTR) &&	\
+    defined(HAVE_SCHED_SETATTR)
+			if (ctxt->slice_ns) {
+				/* EEVDF custom slice request, Linux 6.12+ */
+				(void)shim_memset(&attr, 0, sizeof(attr));
+				attr.size = sizeof(attr);
+				attr.sched_policy = (uint32_t)new_policy;
+				attr.sched_nice = nice(0);
+				attr.sched_runtime = ctxt->slice_ns;
+
+				ret = shim_sched_setattr(pid, &attr, 0);
+				break;
+			}
 #endif
 			param.sched_priority = 0;
 			ret = sched_setscheduler(pid, new_policy, &param);
@@ -456,6 +557,8 @@ case_sched_fifo:
 				rc = EXIT_FAILURE;
 			}
 		}
+		if (hists)
+			stress_schedmix_wakeup_latency(args, hists);
 		stress_schedmix_waste_time(args);
 		stress_bogo_inc(args);
 	} while (stress_continue(args));
@@ -465,16 +568,57 @@ case_sched_fifo:
 	stress_schedmix_itimer_clear();
 #endif
 
+	if (hists) {
+		if (stress_lock_acquire(ctxt->lock) == 0) {
+			for (i = 0; i < stress_sched_types_length; i++)
+				stress_latency_hist_merge(&ctxt->hists[i], &hists[i]);
+			(void)stress_lock_release(ctxt->lock);
+		}
+		free(hists);
+	}
+
 	return rc;
 }
 
+/*
+ *  stress_schedmix_report()
+ *	report wakeup latencies for each policy that was run
+ */
+static void stress_schedmix_report(stress_args_t *args, const stress_latency_hist_t *hists)
+{
+	size_t i, metric = 0;
+
+	for (i = 0; i < stress_sched_types_length; i++) {
+		const stress_latency_hist_t *hist = &hists[i];
+		const char *name = stress_sched_types[i].sched_name;
+		char msg[64];
+
+		if (hist->count == 0)
+			continue;
+		(void)snprintf(msg, sizeof(msg), "%s wakeup latency mean (usec)", name);
+		stress_metrics_set(args, metric++, msg,
+			stress_latency_hist_mean(hist) / 1000.0, STRESS_METRIC_GEOMETRIC_MEAN);
+		(void)snprintf(msg, sizeof(msg), "%s wakeup latency p99 (usec)", name);
+		stress_metrics_set(args, metric++, msg,
+			(double)stress_latency_hist_percentile(hist, 99.0) / 1000.0,
+			STRESS_METRIC_GEOMETRIC_MEAN);
+		(void)snprintf(msg, sizeof(msg), "%s wakeup latency p99.9 (usec)", name);
+		stress_metrics_set(args, metric++, msg,
+			(double)stress_latency_hist_percentile(hist, 99.9) / 1000.0,
+			STRESS_METRIC_GEOMETRIC_MEAN);
+	}
+}
+
 static int stress_schedmix(stress_args_t *args)
 {
 	stress_pid_t *s_pids, *s_pids_head = NULL;
 	size_t i;
 	size_t schedmix_procs = DEFAULT_SCHEDMIX_PROCS;
+	size_t hists_size;
+	uint32_t schedmix_slice_us = 0;
 	int rc;
 	const int parent_cpu = stress_get_cpu();
+	stress_schedmix_ctxt_t ctxt;
 
 	if (stress_sched_types_length == (0)) {
 		if (args->instance == 0) {
@@ -508,6 +652,30 @@ static int stress_schedmix(stress_args_t *args)
 #endif
 
 	(void)stress_get_setting("schedmix-procs", &schedmix_procs);
+	(void)shim_memset(&ctxt, 0, sizeof(ctxt));
+	(void)stress_get_setting("schedmix-policy", &ctxt.policy);
+	(void)stress_get_setting("schedmix-slice-us", &schedmix_slice_us);
+	ctxt.slice_ns = (uint64_t)schedmix_slice_us * 1000;
+
+	ctxt.lock = stress_lock_create("schedmix-latency");
+	if (!ctxt.lock) {
+		pr_inf_skip("%s: failed to create latency lock, skipping stressor\n", args->name);
+		rc = EXIT_NO_RESOURCE;
+		goto free_sem;
+	}
+	hists_size = stress_sched_types_length * sizeof(*ctxt.hists);
+	ctxt.hists = (stress_latency_hist_t *)stress_mmap_populate(NULL, hists_size,
+			PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+	if (ctxt.hists == MAP_FAILED) {
+		pr_inf_skip("%s: cannot mmap %zu bytes for latency histograms, skipping stressor\n",
+			args->name, hists_size);
+		(void)stress_lock_destroy(ctxt.lock);
+		rc = EXIT_NO_RESOURCE;
+		goto free_sem;
+	}
+	stress_set_vma_anon_name(ctxt.hists, hists_size, "latency-histograms");
+	for (i = 0; i < stress_sched_types_length; i++)
+		stress_latency_hist_init(&ctxt.hists[i]);
 
 	for (i = 0; i < schedmix_procs; i++) {
 		stress_sync_start_init(&s_pids[i]);
@@ -524,7 +692,7 @@ static int stress_schedmix(stress_args_t *args)
 			VOID_RET(int, nice(stress_mwc8modn(7)));
 			stress_parent_died_alarm();
 			(void)stress_change_cpu(args, parent_cpu);
-			_exit(stress_schedmix_child(args));
+			_exit(stress_schedmix_child(args, &ctxt));
 		} else {
 			stress_sync_start_s_pid_list_add(&s_pids_head, &s_pids[i]);
 		}
@@ -541,15 +709,19 @@ static int stress_schedmix(stress_args_t *args)
 
 	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
 
+	rc = stress_kill_and_wait_many(args, s_pids, schedmix_procs, SIGALRM, true);
+
+	stress_schedmix_report(args, ctxt.hists);
+	(void)munmap((void *)ctxt.hists, hists_size);
+	(void)stress_lock_destroy(ctxt.lock);
+
+free_sem:
 #if defined(HAVE_SCHEDMIX_SEM)
 	if (schedmix_sem) {
 		(void)sem_destroy(&schedmix_sem->sem);
 		(void)munmap((void *)schedmix_sem, sizeof(*schedmix_sem));
 	}
 #endif
-
-	rc = stress_kill_and_wait_many(args, s_pids, schedmix_procs, SIGALRM, true);
-
 	(void)stress_s_pids_munmap(s_pids, MAX_SCHEDMIX_PROCS);
 
 	return rc;
@@ -21,6 +21,7 @@
 #include "core-affinity.h"
 #include "core-builtin.h"
 #include "core-killpid.h"
+#include "core-latency.h"
 #include "core-net.h"
 
 #if defined(HAVE_SYS_UN_H)
@@ -45,6 +46,15 @@ UNEXPECTED
 
 #define SOCKET_BUF		(8192)	/* Socket I/O buffer size */
 
+#define MIN_SCTP_STREAMS	(1)
+#define MAX_SCTP_STREAMS	(1024)
+#define MIN_SCTP_MSG_SIZE	(64)
+#define MAX_SCTP_MSG_SIZE	(64 * KB)
+#define SCTP_STREAM_METRICS	(16)	/* streams with per-stream metrics */
+
+#define SCTP_STYLE_ONE_TO_ONE	(0)
+#define SCTP_STYLE_ONE_TO_MANY	(1)
+
 typedef struct {
 	const int	sched_type;
 	const char 	*name;
@@ -54,9 +64,12 @@ static const stress_help_t help[] = {
 	{ NULL,	"sctp N",	 "start N workers performing SCTP send/receives " },
 	{ NULL,	"sctp-domain D", "specify sctp domain, default is ipv4" },
 	{ NULL,	"sctp-if I",	 "use network interface I, e.g. lo, eth0, etc." },
+	{ NULL,	"sctp-msg-size N", "send N byte messages in multi-stream mode" },
 	{ NULL,	"sctp-ops N",	 "stop after N SCTP bogo operations" },
 	{ NULL,	"sctp-port P",	 "use SCTP ports P to P + number of workers - 1" },
 	{ NULL, "sctp-sched S",	 "specify sctp scheduler" },
+	{ NULL,	"sctp-streams N", "send messages round-robin over N streams per association" },
+	{ NULL,	"sctp-style S",	 "multi-stream mode socket style, one-to-one or one-to-many" },
 	{ NULL,	NULL, 		 NULL }
 };
 
@@ -94,13 +107,26 @@ static const char *stress_sctp_sched(const size_t i)
 	return (i < SIZEOF_ARRAY(stress_sctp_scheds)) ? stress_sctp_scheds[i].name : NULL;
 }
 
+static const char * const stress_sctp_styles[] = {
+	"one-to-one",	/* SCTP_STYLE_ONE_TO_ONE, SOCK_STREAM */
+	"one-to-many",	/* SCTP_STYLE_ONE_TO_MANY, SOCK_SEQPACKET */
+};
+
+static const char *stress_sctp_style(const size_t i)
+{
+	return (i < SIZEOF_ARRAY(stress_sctp_styles)) ? stress_sctp_styles[i] : NULL;
+}
+
 static int sctp_domain_mask = DOMAIN_INET | DOMAIN_INET6;
 
 static const stress_opt_t opts[] = {
-	{ OPT_sctp_domain, "sctp-domain", TYPE_ID_INT_DOMAIN, 0, 0, &sctp_domain_mask },
-	{ OPT_sctp_if,     "sctp-if",     TYPE_ID_STR, 0, 0, NULL },
-	{ OPT_sctp_port,   "sctp-port",   TYPE_ID_INT_PORT, MIN_PORT, MAX_PORT, NULL },
-	{ OPT_sctp_sched,  "sctp-sched",  TYPE_ID_SIZE_T_METHOD, 0, 0, stress_sctp_sched },
+	{ OPT_sctp_domain,   "sctp-domain",   TYPE_ID_INT_DOMAIN, 0, 0, &sctp_domain_mask },
+	{ OPT_sctp_if,       "sctp-if",       TYPE_ID_STR, 0, 0, NULL },
+	{ OPT_sctp_msg_size, "sctp-msg-size", TYPE_ID_SIZE_T_BYTES_VM, MIN_SCTP_MSG_SIZE, MAX_SCTP_MSG_SIZE, NULL },
+	{ OPT_sctp_port,     "sctp-port",     TYPE_ID_INT_PORT, MIN_PORT, MAX_PORT, NULL },
+	{ OPT_sctp_sched,    "sctp-sched",    TYPE_ID_SIZE_T_METHOD, 0, 0, stress_sctp_sched },
+	{ OPT_sctp_streams,  "sctp-streams",  TYPE_ID_UINT16, MIN_SCTP_STREAMS, MAX_SCTP_STREAMS, NULL },
+	{ OPT_sctp_style,    "sctp-style",    TYPE_ID_SIZE_T_METHOD, 0, 0, stress_sctp_style },
 	END_OPT,
 };
 
@@ -594,6 +620,394 @@ die:
 	return rc;
 }
 
+#if defined(SCTP_INITMSG) &&			\
+    defined(HAVE_SCTP_INITMSG) &&		\
+    defined(SCTP_EVENTS) &&			\
+    defined(HAVE_SCTP_EVENT_SUBSCRIBE)
+#define STRESS_SCTP_STREAMS
+
+/*
+ *  multi-stream mode configuration
+ */
+typedef struct {
+	int port;		/* SCTP port */
+	int domain;		/* AF_INET or AF_INET6 */
+	int sched_type;		/* stream scheduler, -1 for default */
+	const char *ifname;	/* optional interface */
+	uint16_t streams;	/* streams per association */
+	size_t msg_size;	/* bytes per message */
+	size_t style;		/* SCTP_STYLE_ONE_TO_ONE or SCTP_STYLE_ONE_TO_MANY */
+} stress_sctp_streams_t;
+
+/*
+ *  multi-stream mode message header, the rest of the message is padding
+ */
+typedef struct {
+	uint64_t ns;		/* send time, CLOCK_MONOTONIC */
+	uint32_t seq;		/* per stream sequence number */
+	uint16_t stream;	/* stream the message was sent on */
+	uint16_t pad;
+	pid_t pid;		/* stressor pid */
+} stress_sctp_msg_hdr_t;
+
+/*
+ *  stress_sctp_streams_socket()
+ *	create a one-to-one or one-to-many socket that negotiates
+ *	cfg->streams inbound and outbound streams per association
+ */
+static int stress_sctp_streams_socket(
+	stress_args_t *args,
+	const stress_sctp_streams_t *cfg)
+{
+	struct sctp_initmsg initmsg;
+	const int type = (cfg->style == SCTP_STYLE_ONE_TO_MANY) ?
+		SOCK_SEQPACKET : SOCK_STREAM;
+	int fd;
+
+	fd = socket(cfg->domain, type, IPPROTO_SCTP);
+	if (fd < 0) {
+		if (errno == EPROTONOSUPPORT) {
+			if (args->instance == 0)
+				pr_inf_skip("%s: SCTP protocol not supported, skipping stressor\n",
+					args->name);
+			return -EXIT_NO_RESOURCE;
+		}
+		pr_fail("%s: socket failed, errno=%d (%s)\n",
+			args->name, errno, strerror(errno));
+		return -EXIT_FAILURE;
+	}
+	(void)shim_memset(&initmsg, 0, sizeof(initmsg));
+	initmsg.sinit_num_ostreams = cfg->streams;
+	initmsg.sinit_max_instreams = cfg->streams;
+	if (setsockopt(fd, IPPROTO_SCTP, SCTP_INITMSG, &initmsg, sizeof(initmsg)) < 0) {
+		pr_fail("%s: setsockopt SCTP_INITMSG failed, errno=%d (%s)\n",
+			args->name, errno, strerror(errno));
+		(void)close(fd);
+		return -EXIT_FAILURE;
+	}
+#if defined(HAVE_SCTP_SCHED_TYPE) &&	\
+    defined(HAVE_SCTP_ASSOC_VALUE)
+	if (cfg->sched_type > -1) {
+		struct sctp_assoc_value val;
+
+		(void)shim_memset(&val, 0, sizeof(val));
+		val.assoc_value = (uint32_t)cfg->sched_type;
+		(void)setsockopt(fd, SOL_SCTP, SCTP_STREAM_SCHEDULER, &val, sizeof(val));
+	}
+#endif
+	return fd;
+}
+
+/*
+ *  stress_sctp_streams_sender()
+ *	client, send time stamped messages round-robin over all the
+ *	streams of the association as fast as possible
+ */
+static int OPTIMIZE3 stress_sctp_streams_sender(
+	stress_args_t *args,
+	const pid_t mypid,
+	const stress_sctp_streams_t *cfg)
+{
+	struct sockaddr *addr, *to = NULL;
+	socklen_t addr_len = 0, to_len = 0;
+	stress_sctp_msg_hdr_t *hdr;
+	uint32_t *seqs;
+	uint8_t *buf;
+	uint16_t stream = 0, streams = cfg->streams;
+	int fd, retries = 0, rc = EXIT_SUCCESS;
+
+	stress_parent_died_alarm();
+	(void)sched_settings_apply(true);
+
+	buf = (uint8_t *)malloc(cfg->msg_size);
+	seqs = (uint32_t *)calloc(cfg->streams, sizeof(*seqs));
+	if (!buf || !seqs) {
+		free(seqs);
+		free(buf);
+		return EXIT_NO_RESOURCE;
+	}
+	(void)shim_memset(buf, stress_ascii32[mypid & 0x1f], cfg->msg_size);
+	hdr = (stress_sctp_msg_hdr_t *)buf;
+	hdr->pid = mypid;
+	hdr->pad = 0;
+
+	fd = stress_sctp_streams_socket(args, cfg);
+	if (fd < 0) {
+		rc = -fd;
+		goto free_bufs;
+	}
+	if (stress_set_sockaddr_if(args->name, args->instance, mypid,
+			cfg->domain, cfg->port, cfg->ifname,
+			&addr, &addr_len, NET_ADDR_LOOPBACK) < 0) {
+		rc = EXIT_FAILURE;
+		goto close_fd;
+	}
+
+	if (cfg->style == SCTP_STYLE_ONE_TO_MANY) {
+		/* the association is set up implicitly by the first send */
+		to = addr;
+		to_len = addr_len;
+	} else {
+		while (connect(fd, addr, addr_len) < 0) {
+			const int save_errno = errno;
+
+			if (UNLIKELY(!stress_continue_flag()))
+				goto close_fd;
+			if (++retries > 100) {
+				pr_fail("%s: connect failed after 100 retries, errno=%d (%s)\n",
+					args->name, save_errno, strerror(save_errno));
+				rc = EXIT_FAILURE;
+				goto close_fd;
+			}
+			(void)shim_usleep(10000);
+		}
+#if defined(SCTP_STATUS) && 	\
+    defined(HAVE_SCTP_STATUS)
+		{
+			struct sctp_status status;
+			socklen_t len = sizeof(status);
+
+			/* the peer may grant fewer streams than asked for */
+			(void)shim_memset(&status, 0, sizeof(status));
+			if ((getsockopt(fd, IPPROTO_SCTP, SCTP_STATUS, &status, &len) == 0) &&
+			    (status.sstat_outstrms > 0) &&
+			    (status.sstat_outstrms < streams)) {
+				pr_inf("%s: association only has %" PRIu16 " of %" PRIu16 " streams\n",
+					args->name, (uint16_t)status.sstat_outstrms, streams);
+				streams = (uint16_t)status.sstat_outstrms;
+			}
+		}
+#endif
+	}
+
+	while (LIKELY(stress_continue_flag())) {
+		ssize_t n;
+
+		hdr->stream = stream;
+		hdr->seq = seqs[stream];
+		hdr->ns = stress_latency_now();
+		n = sctp_sendmsg(fd, buf, cfg->msg_size, to, to_len,
+				0, 0, stream, 0, 0);
+		if (UNLIKELY(n < 0)) {
+			if ((errno == EINTR) || (errno == EAGAIN) || (errno == ENOMEM))
+				continue;
+			if ((errno == ECONNREFUSED) && to && (++retries < 100)) {
+				/* receiver not listening yet */
+				(void)shim_usleep(10000);
+				continue;
+			}
+			if ((errno == EPIPE) || (errno == ECONNRESET) || !stress_continue_flag())
+				break;
+			pr_fail("%s: sctp_sendmsg on stream %" PRIu16 " failed, errno=%d (%s)\n",
+				args->name, stream, errno, strerror(errno));
+			rc = EXIT_FAILURE;
+			break;
+		}
+		seqs[stream]++;
+		stream++;
+		if (stream >= streams)
+			stream = 0;
+	}
+
+close_fd:
+	(void)close(fd);
+free_bufs:
+	free(seqs);
+	free(buf);
+
+	return rc;
+}
+
+/*
+ *  stress_sctp_streams_receiver()
+ *	server, receive messages on all streams, check each stream is
+ *	delivered in order and measure the per-stream one-way latency
+ *	and overall throughput
+ */
+static int OPTIMIZE3 stress_sctp_streams_receiver(
+	stress_args_t *args,
+	const pid_t mypid,
+	const stress_sctp_streams_t *cfg)
+{
+	struct sctp_event_subscribe events;
+	struct sockaddr *addr = NULL;
+	socklen_t addr_len = 0;
+	stress_latency_hist_t *hist;
+	uint32_t *expect;
+	double *lat_total, bytes = 0.0, t_start, duration, worst = 0.0, rate;
+	uint64_t *lat_count, msgs = 0, out_of_order = 0;
+	uint8_t *buf;
+	int fd, rfd = -1, so_reuseaddr = 1, rc = EXIT_SUCCESS;
+	bool in_msg = false;
+	size_t i;
+	uint16_t s;
+
+	if (stress_sig_stop_stressing(args->name, SIGALRM))
+		return EXIT_FAILURE;
+
+	buf = (uint8_t *)malloc(cfg->msg_size);
+	expect = (uint32_t *)calloc(cfg->streams, sizeof(*expect));
+	lat_total = (double *)calloc(cfg->streams, sizeof(*lat_total));
+	lat_count = (uint64_t *)calloc(cfg->streams, sizeof(*lat_count));
+	hist = (stress_latency_hist_t *)malloc(sizeof(*hist));
+	if (!buf || !expect || !lat_total || !lat_count || !hist) {
+		pr_inf_skip("%s: cannot allocate %" PRIu16 " stream buffers, skipping stressor\n",
+			args->name, cfg->streams);
+		rc = EXIT_NO_RESOURCE;
+		goto free_bufs;
+	}
+	stress_latency_hist_init(hist);
+
+	fd = stress_sctp_streams_socket(args, cfg);
+	if (fd < 0) {
+		rc = -fd;
+		goto free_bufs;
+	}
+	if (setsockopt(fd, SOL_SOCKET, SO_REUSEADDR,
+		&so_reuseaddr, sizeof(so_reuseaddr)) < 0) {
+		pr_fail("%s: setsockopt failed, errno=%d (%s)\n",
+			args->name, errno, strerror(errno));
+		rc = EXIT_FAILURE;
+		goto close_fd;
+	}
+	/* sctp_recvmsg only fills in the stream with data io events on */
+	(void)shim_memset(&events, 0, sizeof(events));
+	events.sctp_data_io_event = 1;
+	if (setsockopt(fd, SOL_SCTP, SCTP_EVENTS, &events, sizeof(events)) < 0) {
+		pr_fail("%s: setsockopt SCTP_EVENTS failed, errno=%d (%s)\n",
+			args->name, errno, strerror(errno));
+		rc = EXIT_FAILURE;
+		goto close_fd;
+	}
+	if (stress_set_sockaddr_if(args->name, args->instance, mypid,
+		cfg->domain, cfg->port, cfg->ifname, &addr, &addr_len, NET_ADDR_ANY) < 0) {
+		rc = EXIT_FAILURE;
+		goto close_fd;
+	}
+	if (bind(fd, addr, addr_len) < 0) {
+		rc = stress_exit_status(errno);
+		pr_fail("%s: bind failed, errno=%d (%s)\n",
+			args->name, errno, strerror(errno));
+		goto close_fd;
+	}
+	if (listen(fd, 10) < 0) {
+		pr_fail("%s: listen failed, errno=%d (%s)\n",
+			args->name, errno, strerror(errno));
+		rc = EXIT_FAILURE;
+		goto close_fd;
+	}
+	if (cfg->style == SCTP_STYLE_ONE_TO_MANY) {
+		rfd = fd;
+	} else {
+		rfd = accept(fd, (struct sockaddr *)NULL, NULL);
+		if (rfd < 0) {
+			if (stress_continue(args) && (errno != EINTR)) {
+				pr_fail("%s: accept failed, errno=%d (%s)\n",
+					args->name, errno, strerror(errno));
+				rc = EXIT_FAILURE;
+			}
+			goto close_fd;
+		}
+	}
+
+	t_start = stress_time_now();
+	do {
+		struct sctp_sndrcvinfo sinfo;
+		const stress_sctp_msg_hdr_t *hdr = (const stress_sctp_msg_hdr_t *)buf;
+		uint64_t ns;
+		int flags = 0;
+		ssize_t n;
+
+		n = sctp_recvmsg(rfd, buf, cfg->msg_size, NULL, 0, &sinfo, &flags);
+		if (UNLIKELY(n <= 0)) {
+			if ((n < 0) && ((errno == EINTR) || (errno == EAGAIN)))
+				continue;
+			break;
+		}
+		if (UNLIKELY(flags & MSG_NOTIFICATION))
+			continue;
+		bytes += (double)n;
+
+		/* large messages may be delivered in parts, only the first has a header */
+		if (UNLIKELY(in_msg || (n < (ssize_t)sizeof(*hdr)))) {
+			in_msg = !(flags & MSG_EOR);
+			continue;
+		}
+		in_msg = !(flags & MSG_EOR);
+		ns = stress_latency_now();
+
+		s = sinfo.sinfo_stream;
+		if (UNLIKELY((hdr->pid != mypid) || (s != hdr->stream) || (s >= cfg->streams))) {
+			pr_fail("%s: received unexpected message, pid %" PRIdMAX
+				" stream %" PRIu16 " on stream %" PRIu16 "\n",
+				args->name, (intmax_t)hdr->pid, hdr->stream, s);
+			rc = EXIT_FAILURE;
+			break;
+		}
+		/* SCTP delivers each stream in order, gaps or reordering are a failure */
+		if (UNLIKELY(hdr->seq != expect[s]))
+			out_of_order++;
+		expect[s] = hdr->seq + 1;
+
+		ns = (ns > hdr->ns) ? ns - hdr->ns : 0;
+		stress_latency_hist_record(hist, ns);
+		stress_latency_record(args, 0, ns);
+		lat_total[s] += (double)ns;
+		lat_count[s]++;
+		msgs++;
+		stress_bogo_inc(args);
+	} while (stress_continue(args));
+	duration = stress_time_now() - t_start;
+
+	if (out_of_order) {
+		pr_fail("%s: %" PRIu64 " messages were delivered out of order within their stream\n",
+			args->name, out_of_order);
+		rc = EXIT_FAILURE;
+	}
+
+	rate = (duration > 0.0) ? bytes / (duration * (double)MB) : 0.0;
+	stress_metrics_set(args, 0, "MB per sec",
+		rate, STRESS_METRIC_HARMONIC_MEAN);
+	rate = (duration > 0.0) ? (double)msgs / duration : 0.0;
+	stress_metrics_set(args, 1, "messages per sec",
+		rate, STRESS_METRIC_HARMONIC_MEAN);
+	stress_metrics_set(args, 2, "mean one-way latency (usec)",
+		stress_latency_hist_mean(hist) / 1000.0, STRESS_METRIC_GEOMETRIC_MEAN);
+	stress_metrics_set(args, 3, "p99 one-way latency (usec)",
+		(double)stress_latency_hist_percentile(hist, 99.0) / 1000.0,
+		STRESS_METRIC_GEOMETRIC_MEAN);
+	for (i = 0; i < cfg->streams; i++) {
+		const double mean = lat_count[i] ?
+			lat_total[i] / ((double)lat_count[i] * 1000.0) : 0.0;
+
+		if (mean > worst)
+			worst = mean;
+		if (i < SCTP_STREAM_METRICS) {
+			char msg[64];
+
+			(void)snprintf(msg, sizeof(msg), "stream %zu mean latency (usec)", i);
+			stress_metrics_set(args, 5 + i, msg,
+				mean, STRESS_METRIC_GEOMETRIC_MEAN);
+		}
+	}
+	stress_metrics_set(args, 4, "slowest stream mean latency (usec)",
+		worst, STRESS_METRIC_GEOMETRIC_MEAN);
+
+	if (rfd != fd)
+		(void)close(rfd);
+close_fd:
+	(void)close(fd);
+free_bufs:
+	free(hist);
+	free(lat_count);
+	free(lat_total);
+	free(expect);
+	free(buf);
+
+	return rc;
+}
+#endif
+
 static void stress_sctp_sigpipe(int signum)
 {
 	(void)signum;
@@ -614,6 +1028,13 @@ static int stress_sctp(stress_args_t *args)
 	size_t sctp_sched = 1; /* default to fcfs */
 	int ret, reserved_port, parent_cpu;
 	char *sctp_if = NULL;
+	uint16_t sctp_streams = 1;
+	size_t sctp_msg_size = SOCKET_BUF;
+	size_t sctp_style = SCTP_STYLE_ONE_TO_ONE;
+	bool streams_mode;
+#if defined(STRESS_SCTP_STREAMS)
+	stress_sctp_streams_t cfg;
+#endif
 
 	if (stress_sigchld_set_handler(args) < 0)
 		return EXIT_NO_RESOURCE;
@@ -621,6 +1042,9 @@ static int stress_sctp(stress_args_t *args)
 	(void)stress_get_setting("sctp-domain", &sctp_domain);
 	(void)stress_get_setting("sctp-if", &sctp_if);
 	(void)stress_get_setting("sctp-port", &sctp_port);
+	streams_mode = stress_get_setting("sctp-streams", &sctp_streams);
+	streams_mode |= stress_get_setting("sctp-msg-size", &sctp_msg_size);
+	streams_mode |= stress_get_setting("sctp-style", &sctp_style);
 	if (stress_get_setting("sctp-sched", &sctp_sched)) {
 #if defined(HAVE_SCTP_SCHED_TYPE) &&	\
     defined(HAVE_SCTP_ASSOC_VALUE)
@@ -641,6 +1065,19 @@ static int stress_sctp(stress_args_t *args)
 		}
 	}
 
+	if (streams_mode) {
+#if defined(STRESS_SCTP_STREAMS)
+		if (sctp_msg_size < sizeof(stress_sctp_msg_hdr_t))
+			sctp_msg_size = sizeof(stress_sctp_msg_hdr_t);
+		stress_latency_set_description(args, 0, "sctp one-way");
+#else
+		if (args->instance == 0)
+			pr_inf("%s: SCTP_INITMSG or SCTP_EVENTS not supported, ignoring "
+				"--sctp-streams, --sctp-msg-size and --sctp-style\n", args->name);
+		streams_mode = false;
+#endif
+	}
+
 	if (stress_sighandler(args->name, SIGPIPE, stress_sctp_sigpipe, NULL) < 0)
 		return EXIT_FAILURE;
 
@@ -658,6 +1095,16 @@ static int stress_sctp(stress_args_t *args)
 	pr_dbg("%s: process [%" PRIdMAX "] using socket port %d\n",
 		args->name, (intmax_t)args->pid, sctp_port);
 
+#if defined(STRESS_SCTP_STREAMS)
+	cfg.port = sctp_port;
+	cfg.domain = sctp_domain;
+	cfg.sched_type = sctp_sched_type;
+	cfg.ifname = sctp_if;
+	cfg.streams = sctp_streams;
+	cfg.msg_size = sctp_msg_size;
+	cfg.style = sctp_style;
+#endif
+
 	ret = EXIT_FAILURE;
 
 	stress_set_proc_state(args->name, STRESS_STATE_SYNC_WAIT);
@@ -676,12 +1123,22 @@ again:
 		return EXIT_FAILURE;
 	} else if (pid == 0) {
 		 (void)stress_change_cpu(args, parent_cpu);
-		ret = stress_sctp_client(args, mypid, sctp_port, sctp_domain, sctp_sched_type, sctp_if);
+#if defined(STRESS_SCTP_STREAMS)
+		if (streams_mode)
+			ret = stress_sctp_streams_sender(args, mypid, &cfg);
+		else
+#endif
+			ret = stress_sctp_client(args, mypid, sctp_port, sctp_domain, sctp_sched_type, sctp_if);
 		_exit(ret);
 	} else {
 		int status;
 
-		ret = stress_sctp_server(args, mypid, sctp_port, sctp_domain, sctp_sched_type, sctp_if);
+#if defined(STRESS_SCTP_STREAMS)
+		if (streams_mode)
+			ret = stress_sctp_streams_receiver(args, mypid, &cfg);
+		else
+#endif
+			ret = stress_sctp_server(args, mypid, sctp_port, sctp_domain, sctp_sched_type, sctp_if);
 		(void)stress_kill_pid_wait(pid, &status);
 		if (WIFEXITED(status)) {
 			if (WEXITSTATUS(status) != EXIT_SUCCESS) {
@@ -22,14 +22,33 @@
 #include "core-madvise.h"
 #include "core-out-of-memory.h"
 
+#if defined(HAVE_LINUX_PERF_EVENT_H)
+#include <linux/perf_event.h>
+#endif
+
 #define MMAP_MAX	(256*1024)
 
+#define MIN_SECRETMEM_RATE	(1)
+#define MAX_SECRETMEM_RATE	(1000000)
+#define DEFAULT_SECRETMEM_RATE	(10000)
+
+#define SECRETMEM_PROBE_SLOTS	(100)		/* probe time slots per second */
+#define SECRETMEM_PROBE_CHUNK	(64 * KB)	/* pipe write/read size */
+
 static const stress_help_t help[] = {
 	{ NULL,	"secretmem N",		"start N workers that use secretmem mappings" },
 	{ NULL,	"secretmem-ops N",	"stop after N secretmem bogo operations" },
+	{ NULL,	"secretmem-probe",	"measure kernel copy cost of secretmem churn against memfd" },
+	{ NULL,	"secretmem-rate N",	"allocate and free N pages per second with --secretmem-probe" },
 	{ NULL,	NULL,		NULL }
 };
 
+static const stress_opt_t opts[] = {
+	{ OPT_secretmem_probe, "secretmem-probe", TYPE_ID_BOOL, 0, 1, NULL },
+	{ OPT_secretmem_rate,  "secretmem-rate",  TYPE_ID_UINT32, MIN_SECRETMEM_RATE, MAX_SECRETMEM_RATE, NULL },
+	END_OPT,
+};
+
 #if defined(__NR_memfd_secret) &&	\
     defined(__linux__)
 
@@ -85,6 +104,247 @@ static bool stress_secretmem_unmap(
 	return retry;
 }
 
+#if defined(HAVE_LINUX_PERF_EVENT_H) &&	\
+    defined(HAVE_SYSCALL) &&		\
+    defined(__NR_perf_event_open)
+#define STRESS_SECRETMEM_DTLB
+#endif
+
+#define SECRETMEM_PHASE_MEMFD	(0)	/* baseline, memfd_create pages */
+#define SECRETMEM_PHASE_SECRET	(1)	/* memfd_secret pages */
+#define SECRETMEM_PHASE_MAX	(2)
+
+typedef struct {
+	double bytes;		/* bytes copied by the probe */
+	double duration;	/* time spent in the probe */
+	uint64_t dtlb_misses;	/* dTLB read misses during the probe */
+} stress_secretmem_probe_t;
+
+#if defined(STRESS_SECRETMEM_DTLB)
+/*
+ *  stress_secretmem_dtlb_open()
+ *	open a dTLB read miss counter on this process, including kernel
+ *	misses if permitted as these are the ones the direct map affects
+ */
+static int stress_secretmem_dtlb_open(void)
+{
+	struct perf_event_attr attr;
+	int fd;
+
+	(void)shim_memset(&attr, 0, sizeof(attr));
+	attr.size = sizeof(attr);
+	attr.type = PERF_TYPE_HW_CACHE;
+	attr.config = PERF_COUNT_HW_CACHE_DTLB |
+		      (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+		      (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+	attr.exclude_hv = 1;
+
+	fd = (int)syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+	if (fd < 0) {
+		attr.exclude_kernel = 1;
+		fd = (int)syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+	}
+	return fd;
+}
+#endif
+
+/*
+ *  stress_secretmem_dtlb()
+ *	read the dTLB read miss counter, 0 if not available
+ */
+static uint64_t stress_secretmem_dtlb(const int dtlb_fd)
+{
+	uint64_t misses = 0;
+
+	if (dtlb_fd < 0)
+		return 0;
+	if (read(dtlb_fd, &misses, sizeof(misses)) != (ssize_t)sizeof(misses))
+		return 0;
+	return misses;
+}
+
+/*
+ *  stress_secretmem_churn()
+ *	allocate, fault in and free n pages of memfd or secretmem
+ *	memory, a secretmem file can only be sized once so a new
+ *	file is used each time for both kinds of memory
+ */
+static int stress_secretmem_churn(
+	const int phase,
+	const size_t n,
+	const size_t page_size)
+{
+	const size_t sz = n * page_size;
+	uint8_t *ptr;
+	int fd, saved_errno;
+
+	fd = (phase == SECRETMEM_PHASE_SECRET) ?
+		shim_memfd_secret(0) :
+		shim_memfd_create("stress-secretmem-probe", 0);
+	if (UNLIKELY(fd < 0))
+		return -1;
+	if (UNLIKELY(ftruncate(fd, (off_t)sz) != 0))
+		goto err;
+	ptr = (uint8_t *)mmap(NULL, sz, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	if (UNLIKELY(ptr == MAP_FAILED))
+		goto err;
+	(void)shim_memset((void *)ptr, 0xff, sz);
+	(void)stress_munmap_retry_enomem((void *)ptr, sz);
+	(void)close(fd);
+	return 0;
+
+err:
+	saved_errno = errno;
+	(void)close(fd);
+	errno = saved_errno;
+	return -1;
+}
+
+/*
+ *  stress_secretmem_probe()
+ *	run a kernel copy heavy loop of pipe writes and reads
+ *	until end_time, accumulating throughput and dTLB misses
+ */
+static void stress_secretmem_probe(
+	const int pipefds[2],
+	uint8_t *buf,
+	const int dtlb_fd,
+	const double end_time,
+	stress_secretmem_probe_t *probe)
+{
+	const uint64_t misses = stress_secretmem_dtlb(dtlb_fd);
+	const double t = stress_time_now();
+	double now;
+
+	do {
+		ssize_t ret;
+
+		ret = write(pipefds[1], buf, SECRETMEM_PROBE_CHUNK);
+		if (UNLIKELY(ret <= 0))
+			break;
+		ret = read(pipefds[0], buf, (size_t)ret);
+		if (UNLIKELY(ret <= 0))
+			break;
+		probe->bytes += (double)ret * 2.0;
+		now = stress_time_now();
+	} while (now < end_time);
+
+	probe->duration += stress_time_now() - t;
+	probe->dtlb_misses += stress_secretmem_dtlb(dtlb_fd) - misses;
+}
+
+/*
+ *  stress_secretmem_probe_child()
+ *	allocate and free memfd pages at a fixed rate while measuring
+ *	pipe copy throughput for the first half of the run as a baseline,
+ *	then do the same with secretmem pages for the second half. The
+ *	baseline runs first as secretmem splits large direct map pages
+ *	and the kernel does not merge them again when the pages are freed.
+ */
+static int stress_secretmem_probe_child(stress_args_t *args)
+{
+	const size_t page_size = args->page_size;
+	const double slot = 1.0 / (double)SECRETMEM_PROBE_SLOTS;
+	static const char * const phase_names[SECRETMEM_PHASE_MAX] = {
+		"memfd",
+		"secretmem",
+	};
+	stress_secretmem_probe_t probes[SECRETMEM_PHASE_MAX];
+	uint32_t secretmem_rate = DEFAULT_SECRETMEM_RATE;
+	size_t n, i;
+	double t, t_switch;
+	int pipefds[2], phase, dtlb_fd = -1;
+	int ret = EXIT_SUCCESS;
+	uint8_t *buf;
+
+	(void)stress_get_setting("secretmem-rate", &secretmem_rate);
+	n = (secretmem_rate + SECRETMEM_PROBE_SLOTS - 1) / SECRETMEM_PROBE_SLOTS;
+	(void)shim_memset(probes, 0, sizeof(probes));
+
+	buf = (uint8_t *)malloc(SECRETMEM_PROBE_CHUNK);
+	if (UNLIKELY(!buf)) {
+		pr_inf_skip("%s: cannot allocate probe buffer, skipping stressor\n",
+			args->name);
+		return EXIT_NO_RESOURCE;
+	}
+	(void)shim_memset(buf, 0xa5, SECRETMEM_PROBE_CHUNK);
+	if (pipe(pipefds) < 0) {
+		pr_inf_skip("%s: pipe failed, errno=%d (%s), skipping stressor\n",
+			args->name, errno, strerror(errno));
+		free(buf);
+		return EXIT_NO_RESOURCE;
+	}
+#if defined(STRESS_SECRETMEM_DTLB)
+	dtlb_fd = stress_secretmem_dtlb_open();
+#endif
+	if ((dtlb_fd < 0) && (args->instance == 0))
+		pr_inf("%s: cannot open dTLB miss counter, not reporting dTLB misses\n",
+			args->name);
+
+	stress_set_proc_state(args->name, STRESS_STATE_SYNC_WAIT);
+	stress_sync_start_wait(args);
+	stress_set_proc_state(args->name, STRESS_STATE_RUN);
+
+	t = stress_time_now();
+	t_switch = t + ((args->time_end - t) / 2.0);
+	phase = SECRETMEM_PHASE_MEMFD;
+
+	do {
+		if ((phase == SECRETMEM_PHASE_MEMFD) && (t >= t_switch))
+			phase = SECRETMEM_PHASE_SECRET;
+
+		if (UNLIKELY(stress_secretmem_churn(phase, n, page_size) < 0)) {
+			pr_inf_skip("%s: cannot allocate %zu %s pages, errno=%d (%s), "
+				"skipping stressor\n", args->name, n,
+				phase_names[phase], errno, strerror(errno));
+			ret = EXIT_NO_RESOURCE;
+			break;
+		}
+		t += slot;
+		stress_secretmem_probe(pipefds, buf, dtlb_fd, t, &probes[phase]);
+		stress_bogo_inc(args);
+	} while (stress_continue(args));
+
+	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
+
+	for (i = 0; i < SECRETMEM_PHASE_MAX; i++) {
+		char msg[64];
+		const double mb = probes[i].bytes / (double)MB;
+
+		if (probes[i].duration <= 0.0)
+			continue;
+		(void)snprintf(msg, sizeof(msg), "%s probe MB per sec", phase_names[i]);
+		stress_metrics_set(args, i * 2, msg, mb / probes[i].duration,
+			STRESS_METRIC_HARMONIC_MEAN);
+		if ((dtlb_fd >= 0) && (mb > 0.0)) {
+			(void)snprintf(msg, sizeof(msg), "%s dTLB misses per MB", phase_names[i]);
+			stress_metrics_set(args, (i * 2) + 1, msg,
+				(double)probes[i].dtlb_misses / mb,
+				STRESS_METRIC_GEOMETRIC_MEAN);
+		}
+	}
+	if ((probes[SECRETMEM_PHASE_MEMFD].duration > 0.0) &&
+	    (probes[SECRETMEM_PHASE_SECRET].duration > 0.0) &&
+	    (probes[SECRETMEM_PHASE_MEMFD].bytes > 0.0)) {
+		const double base = probes[SECRETMEM_PHASE_MEMFD].bytes /
+				    probes[SECRETMEM_PHASE_MEMFD].duration;
+		const double secret = probes[SECRETMEM_PHASE_SECRET].bytes /
+				      probes[SECRETMEM_PHASE_SECRET].duration;
+
+		/* a ratio rather than a difference, means of negative values are not useful */
+		stress_metrics_set(args, 4, "% of memfd throughput with secretmem",
+			100.0 * secret / base, STRESS_METRIC_GEOMETRIC_MEAN);
+	}
+
+	if (dtlb_fd >= 0)
+		(void)close(dtlb_fd);
+	(void)close(pipefds[0]);
+	(void)close(pipefds[1]);
+	free(buf);
+
+	return ret;
+}
+
 /*
  *  stress_secretmem_child()
  *     OOMable secretmem stressor
@@ -95,9 +355,14 @@ static int stress_secretmem_child(stress_args_t *args, void *context)
 	const size_t page_size3 = page_size * 3;
 	uint8_t **mappings;
 	int fd;
+	bool secretmem_probe = false;
 
 	(void)context;
 
+	(void)stress_get_setting("secretmem-probe", &secretmem_probe);
+	if (secretmem_probe)
+		return stress_secretmem_probe_child(args);
+
 	mappings = (uint8_t **)calloc(MMAP_MAX, sizeof(*mappings));
 	if (UNLIKELY(!mappings)) {
 		pr_fail("%s: calloc failed, out of memory\n", args->name);
@@ -197,6 +462,8 @@ static int stress_secretmem(stress_args_t *args)
 const stressor_info_t stress_secretmem_info = {
 	.stressor = stress_secretmem,
 	.class = CLASS_CPU,
+	.opts = opts,
+	.metrics_max = 5,
 	.help = help,
 	.supported = stress_secretmem_supported
 };
@@ -204,6 +471,7 @@ const stressor_info_t stress_secretmem_info = {
 const stressor_info_t stress_secretmem_info = {
 	.stressor = stress_unimplemented,
 	.class = CLASS_CPU,
+	.opts = opts,
 	.help = help,
 	.unimplemented_reason = "built with headers that did not define memfd_secret() system call"
 };
@@ -385,5 +385,6 @@ const stressor_info_t stress_seek_info = {
 	.class = CLASS_IO | CLASS_OS,
 	.opts = opts,
 	.verify = VERIFY_OPTIONAL,
+	.metrics_max = 2,
 	.help = help
 };
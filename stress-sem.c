@@ -312,6 +312,7 @@ const stressor_info_t stress_sem_info = {
 	.class = CLASS_OS | CLASS_SCHEDULER | CLASS_IPC,
 	.opts = opts,
 	.verify = VERIFY_ALWAYS,
+	.metrics_max = 3,
 	.init = stress_sem_init,
 	.deinit = stress_sem_deinit,
 	.help = help
@@ -209,6 +209,7 @@ const stressor_info_t stress_sendfile_info = {
 	.class = CLASS_PIPE_IO | CLASS_OS,
 	.opts = opts,
 	.verify = VERIFY_ALWAYS,
+	.metrics_max = 1,
 	.help = help
 };
 #else
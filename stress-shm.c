@@ -20,10 +20,15 @@
 #include "stress-ng.h"
 #include "core-builtin.h"
 #include "core-killpid.h"
+#include "core-latency.h"
 #include "core-madvise.h"
 #include "core-mincore.h"
 #include "core-out-of-memory.h"
 
+#if defined(HAVE_LINUX_MEMFD_H)
+#include <linux/memfd.h>
+#endif
+
 #define MIN_SHM_POSIX_BYTES	(1 * MB)
 #define MAX_SHM_POSIX_BYTES	(1 * GB)
 #define DEFAULT_SHM_POSIX_BYTES	(8 * MB)
@@ -34,6 +39,10 @@
 
 #define SHM_NAME_LEN		(128)
 
+#define SHM_RING_NORMAL		(0)	/* normal page backed shm ring */
+#define SHM_RING_THP		(1)	/* transparent huge page backed shm ring */
+#define SHM_RING_HUGETLB	(2)	/* hugetlb backed shm ring */
+
 typedef struct {
 	ssize_t	index;
 	char	shm_name[SHM_NAME_LEN];
@@ -45,13 +54,26 @@ static const stress_help_t help[] = {
 	{ NULL,	"shm-mlock",	"attempt to mlock pages into memory" },
 	{ NULL,	"shm-objs N",	"allocate N POSIX shared memory objects per iteration" },
 	{ NULL,	"shm-ops N",	"stop after N POSIX shared memory bogo operations" },
+	{ NULL,	"shm-ring P",	"stream messages through a shm ring backed by pages P: normal, thp, hugetlb" },
 	{ NULL,	NULL,		NULL }
 };
 
+static const char * const stress_shm_ring_backings[] = {
+	"normal",
+	"thp",
+	"hugetlb",
+};
+
+static const char *stress_shm_ring_backing(const size_t i)
+{
+	return (i < SIZEOF_ARRAY(stress_shm_ring_backings)) ? stress_shm_ring_backings[i] : NULL;
+}
+
 static const stress_opt_t opts[] = {
 	{ OPT_shm_bytes, "shm-bytes", TYPE_ID_SIZE_T_BYTES_VM, MIN_SHM_POSIX_BYTES, MAX_MEM_LIMIT, NULL },
 	{ OPT_shm_mlock, "shm-mlock", TYPE_ID_BOOL, 0, 1, NULL },
 	{ OPT_shm_objs,  "shm-objs",  TYPE_ID_SIZE_T, MIN_SHM_POSIX_OBJECTS, MAX_48, NULL },
+	{ OPT_shm_ring,  "shm-ring",  TYPE_ID_SIZE_T_METHOD, 0, 0, stress_shm_ring_backing },
 	END_OPT,
 };
 
@@ -341,6 +363,328 @@ reap:
 	return rc;
 }
 
+#if defined(HAVE_ATOMIC_LOAD) &&	\
+    defined(HAVE_ATOMIC_STORE)
+#define HAVE_SHM_RING
+#endif
+
+#if defined(HAVE_SHM_RING)
+/*
+ *  stress_shm_ring_t
+ *	single producer, single consumer ring header, the indices are
+ *	message counts and live in separate cachelines so the producer
+ *	and consumer do not false share
+ */
+typedef struct {
+	uint64_t head ALIGN64;		/* messages written by the producer */
+	uint64_t tail ALIGN64;		/* messages read by the consumer */
+	uint64_t t_recv ALIGN64;	/* consumer receive time of last message */
+	uint32_t stop;			/* producer has finished */
+	uint32_t failed;		/* consumer verification failures */
+} stress_shm_ring_t;
+
+typedef struct {
+	uint64_t seq;			/* message sequence number */
+	uint64_t t_send;		/* producer send time, nanoseconds */
+} stress_shm_ring_msg_t;
+
+static const size_t stress_shm_ring_sizes[] = {
+	64, 256, 1024, 4096, 16384, 65536
+};
+
+#define SHM_RING_SPINS		(64)		/* busy spins before yielding */
+#define SHM_RING_STREAM_BYTES	(64 * MB)	/* bytes streamed per message size */
+#define SHM_RING_STREAM_MAX	(65536)		/* max messages streamed per message size */
+#define SHM_RING_LATENCY_MSGS	(256)		/* single messages timed per message size */
+
+/*
+ *  stress_shm_ring_wait()
+ *	wait for a ring index to reach a value, spin then yield,
+ *	returns false if the producer stopped
+ */
+static inline bool stress_shm_ring_wait(
+	stress_shm_ring_t *ring,
+	uint64_t *index,
+	const uint64_t value,
+	const bool producer)
+{
+	int spins = 0;
+
+	while (__atomic_load_n(index, __ATOMIC_ACQUIRE) < value) {
+		if (UNLIKELY(producer ? !stress_continue_flag() :
+				__atomic_load_n(&ring->stop, __ATOMIC_RELAXED)))
+			return false;
+		if (++spins >= SHM_RING_SPINS) {
+			spins = 0;
+			(void)shim_sched_yield();
+		}
+	}
+	return true;
+}
+
+static inline size_t stress_shm_ring_stream_msgs(const size_t size)
+{
+	const size_t n = SHM_RING_STREAM_BYTES / size;
+
+	return (n > SHM_RING_STREAM_MAX) ? SHM_RING_STREAM_MAX : n;
+}
+
+/*
+ *  stress_shm_ring_consumer()
+ *	copy messages out of the ring in the same size order as the
+ *	producer writes them, checking the sequence numbers
+ */
+static void stress_shm_ring_consumer(
+	stress_shm_ring_t *ring,
+	uint8_t *data,
+	const size_t data_size,
+	uint8_t *buf)
+{
+	uint64_t tail = 0;
+
+	for (;;) {
+		size_t i;
+
+		for (i = 0; i < SIZEOF_ARRAY(stress_shm_ring_sizes); i++) {
+			const size_t size = stress_shm_ring_sizes[i];
+			const size_t slots = data_size / size;
+			const size_t n = stress_shm_ring_stream_msgs(size) + SHM_RING_LATENCY_MSGS;
+			size_t j;
+
+			if (slots < 4)
+				break;
+			for (j = 0; j < n; j++) {
+				const stress_shm_ring_msg_t *msg = (stress_shm_ring_msg_t *)buf;
+
+				if (!stress_shm_ring_wait(ring, &ring->head, tail + 1, false))
+					return;
+				(void)shim_memcpy(buf, data + ((tail % slots) * size), size);
+				if (UNLIKELY(msg->seq != tail))
+					ring->failed++;
+				__atomic_store_n(&ring->t_recv, stress_latency_now(), __ATOMIC_RELAXED);
+				tail++;
+				__atomic_store_n(&ring->tail, tail, __ATOMIC_RELEASE);
+			}
+		}
+	}
+}
+
+/*
+ *  stress_shm_ring()
+ *	stream messages of several sizes through a shared memory ring
+ *	between a producer and a consumer process, measuring throughput
+ *	and then the one way latency of single messages on an idle ring
+ */
+static int stress_shm_ring(stress_args_t *args, const size_t shm_ring, const size_t shm_bytes)
+{
+	char shm_name[SHM_NAME_LEN];
+	const size_t huge_size = 2 * MB;
+	size_t size, data_size, i, n_sizes = 0, idx;
+	stress_latency_hist_t *hists;
+	stress_shm_ring_t *ring;
+	double gbytes_sec[SIZEOF_ARRAY(stress_shm_ring_sizes)];
+	uint8_t *mapping, *data, *buf;
+	uint64_t head = 0;
+	pid_t pid;
+	int fd = -1, rc = EXIT_SUCCESS;
+	size_t backing = shm_ring;
+
+	size = (shm_bytes + huge_size - 1) & ~(huge_size - 1);
+	shm_name[0] = '\0';
+
+	mapping = MAP_FAILED;
+#if defined(MFD_HUGETLB)
+	if (backing == SHM_RING_HUGETLB) {
+		(void)snprintf(shm_name, sizeof(shm_name), "stress-shm-ring-%" PRIdMAX "-%" PRIu32,
+			(intmax_t)args->pid, args->instance);
+		fd = shim_memfd_create(shm_name, MFD_HUGETLB);
+		shm_name[0] = '\0';
+		if (fd >= 0) {
+			/* hugetlb pages are reserved at mmap time, so this fails if none are free */
+			if (ftruncate(fd, (off_t)size) == 0)
+				mapping = (uint8_t *)mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+			if (mapping == MAP_FAILED) {
+				(void)close(fd);
+				fd = -1;
+			}
+		}
+	}
+#endif
+	if ((backing == SHM_RING_HUGETLB) && (mapping == MAP_FAILED)) {
+		if (args->instance == 0)
+			pr_inf("%s: cannot allocate %zu bytes of hugetlb backed shared memory, "
+				"using transparent huge pages instead\n", args->name, size);
+		backing = SHM_RING_THP;
+	}
+	if (mapping == MAP_FAILED) {
+		(void)snprintf(shm_name, sizeof(shm_name), "/stress-shm-ring-%" PRIdMAX "-%" PRIu32,
+			(intmax_t)args->pid, args->instance);
+		fd = shm_open(shm_name, O_CREAT | O_RDWR | O_EXCL, S_IRUSR | S_IWUSR);
+		if (fd < 0) {
+			pr_inf_skip("%s: shm_open failed, errno=%d (%s), skipping stressor\n",
+				args->name, errno, strerror(errno));
+			return EXIT_NO_RESOURCE;
+		}
+		if (ftruncate(fd, (off_t)size) < 0) {
+			pr_inf_skip("%s: ftruncate of %zu bytes failed, errno=%d (%s), skipping stressor\n",
+				args->name, size, errno, strerror(errno));
+			rc = EXIT_NO_RESOURCE;
+			goto close_fd;
+		}
+		mapping = (uint8_t *)mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+		if (mapping == MAP_FAILED) {
+			pr_inf_skip("%s: mmap of %zu bytes failed, errno=%d (%s), skipping stressor\n",
+				args->name, size, errno, strerror(errno));
+			rc = EXIT_NO_RESOURCE;
+			goto close_fd;
+		}
+	}
+#if defined(MADV_HUGEPAGE)
+	if (backing == SHM_RING_THP)
+		(void)shim_madvise(mapping, size, MADV_HUGEPAGE);
+#endif
+	(void)shim_memset(mapping, 0, size);
+
+	/* ring header in the first page, message data on the remaining pages */
+	ring = (stress_shm_ring_t *)mapping;
+	data = mapping + args->page_size;
+	data_size = size - args->page_size;
+
+	buf = (uint8_t *)malloc(stress_shm_ring_sizes[SIZEOF_ARRAY(stress_shm_ring_sizes) - 1]);
+	hists = (stress_latency_hist_t *)calloc(SIZEOF_ARRAY(stress_shm_ring_sizes), sizeof(*hists));
+	if (!buf || !hists) {
+		pr_inf_skip("%s: cannot allocate message buffer, skipping stressor\n", args->name);
+		free(hists);
+		free(buf);
+		rc = EXIT_NO_RESOURCE;
+		goto unmap;
+	}
+	for (i = 0; i < SIZEOF_ARRAY(stress_shm_ring_sizes); i++) {
+		stress_latency_hist_init(&hists[i]);
+		gbytes_sec[i] = 0.0;
+		if ((data_size / stress_shm_ring_sizes[i]) >= 4)
+			n_sizes++;
+	}
+	(void)shim_memset(buf, 0x5a, stress_shm_ring_sizes[SIZEOF_ARRAY(stress_shm_ring_sizes) - 1]);
+
+	stress_set_proc_state(args->name, STRESS_STATE_SYNC_WAIT);
+	stress_sync_start_wait(args);
+	stress_set_proc_state(args->name, STRESS_STATE_RUN);
+
+again:
+	pid = fork();
+	if (pid < 0) {
+		if (stress_redo_fork(args, errno))
+			goto again;
+		if (stress_continue(args)) {
+			pr_fail("%s: fork failed, errno=%d (%s)\n",
+				args->name, errno, strerror(errno));
+			rc = EXIT_FAILURE;
+		}
+		goto free_buf;
+	} else if (pid == 0) {
+		stress_parent_died_alarm();
+		(void)sched_settings_apply(true);
+		stress_shm_ring_consumer(ring, data, data_size, buf);
+		_exit(EXIT_SUCCESS);
+	}
+
+	/* producer */
+	do {
+		for (i = 0; i < n_sizes; i++) {
+			const size_t msg_size = stress_shm_ring_sizes[i];
+			const size_t slots = data_size / msg_size;
+			const size_t n = stress_shm_ring_stream_msgs(msg_size);
+			stress_shm_ring_msg_t *msg = (stress_shm_ring_msg_t *)buf;
+			double t, duration;
+			size_t j;
+
+			t = stress_time_now();
+			for (j = 0; j < n; j++) {
+				if (UNLIKELY(!stress_shm_ring_wait(ring, &ring->tail, (head + 1 > slots) ? head + 1 - slots : 0, true)))
+					goto stop;
+				msg->seq = head;
+				msg->t_send = 0;
+				(void)shim_memcpy(data + ((head % slots) * msg_size), buf, msg_size);
+				head++;
+				__atomic_store_n(&ring->head, head, __ATOMIC_RELEASE);
+			}
+			if (UNLIKELY(!stress_shm_ring_wait(ring, &ring->tail, head, true)))
+				goto stop;
+			duration = stress_time_now() - t;
+			if (duration > 0.0) {
+				const double rate = ((double)n * (double)msg_size) / (duration * (double)GB);
+
+				/* running average over the sweep passes */
+				gbytes_sec[i] = (gbytes_sec[i] > 0.0) ? (gbytes_sec[i] + rate) / 2.0 : rate;
+			}
+			stress_bogo_add(args, n);
+
+			/* one way latency of single messages on an idle ring */
+			for (j = 0; j < SHM_RING_LATENCY_MSGS; j++) {
+				uint64_t t_recv;
+
+				msg->seq = head;
+				msg->t_send = stress_latency_now();
+				(void)shim_memcpy(data + ((head % slots) * msg_size), buf, msg_size);
+				head++;
+				__atomic_store_n(&ring->head, head, __ATOMIC_RELEASE);
+				if (UNLIKELY(!stress_shm_ring_wait(ring, &ring->tail, head, true)))
+					goto stop;
+				t_recv = __atomic_load_n(&ring->t_recv, __ATOMIC_RELAXED);
+				stress_latency_hist_record(&hists[i],
+					(t_recv > msg->t_send) ? t_recv - msg->t_send : 0);
+			}
+			stress_bogo_add(args, SHM_RING_LATENCY_MSGS);
+		}
+	} while (stress_continue(args));
+stop:
+	__atomic_store_n(&ring->stop, 1, __ATOMIC_RELAXED);
+	(void)stress_kill_pid_wait(pid, NULL);
+	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
+
+	if (ring->failed) {
+		pr_fail("%s: %" PRIu32 " ring messages received out of sequence\n",
+			args->name, ring->failed);
+		rc = EXIT_FAILURE;
+	}
+
+	if (args->instance == 0) {
+		pr_inf("%s: %s page backed %zu byte ring\n", args->name,
+			stress_shm_ring_backings[backing], data_size);
+		pr_inf("%s: %8s %10s %10s %10s\n", args->name,
+			"msg size", "GB/sec", "lat p50ns", "lat p99ns");
+	}
+	for (idx = 0, i = 0; i < n_sizes; i++) {
+		const double p50 = (double)stress_latency_hist_percentile(&hists[i], 50.0);
+		const double p99 = (double)stress_latency_hist_percentile(&hists[i], 99.0);
+		char desc[64];
+
+		if (gbytes_sec[i] <= 0.0)
+			continue;
+		if (args->instance == 0)
+			pr_inf("%s: %8zu %10.3f %10.0f %10.0f\n", args->name,
+				stress_shm_ring_sizes[i], gbytes_sec[i], p50, p99);
+		(void)snprintf(desc, sizeof(desc), "%zu byte message GB per sec", stress_shm_ring_sizes[i]);
+		stress_metrics_set(args, idx++, desc, gbytes_sec[i], STRESS_METRIC_HARMONIC_MEAN);
+		(void)snprintf(desc, sizeof(desc), "%zu byte message latency p50 nsec", stress_shm_ring_sizes[i]);
+		stress_metrics_set(args, idx++, desc, p50, STRESS_METRIC_GEOMETRIC_MEAN);
+	}
+
+free_buf:
+	free(hists);
+	free(buf);
+unmap:
+	(void)munmap((void *)mapping, size);
+close_fd:
+	(void)close(fd);
+	if (*shm_name)
+		(void)shm_unlink(shm_name);
+
+	return rc;
+}
+#endif
+
 /*
  *  stress_shm()
  *	stress POSIX shared memory
@@ -358,6 +702,7 @@ static int stress_shm(stress_args_t *args)
 	uint32_t restarts = 0;
 	size_t shm_posix_bytes = DEFAULT_SHM_POSIX_BYTES;
 	size_t shm_posix_objects = DEFAULT_SHM_POSIX_OBJECTS;
+	size_t shm_ring;
 
 	if (!stress_get_setting("shm-mlock", &shm_mlock)) {
 		if (g_opt_flags & OPT_FLAGS_AGGRESSIVE)
@@ -384,6 +729,17 @@ static int stress_shm(stress_args_t *args)
 	}
 	orig_sz = sz = shm_posix_bytes & ~(page_size - 1);
 
+	if (stress_get_setting("shm-ring", &shm_ring)) {
+#if defined(HAVE_SHM_RING)
+		return stress_shm_ring(args, shm_ring, sz);
+#else
+		if (args->instance == 0)
+			pr_inf_skip("%s: shared memory ring needs atomic load/store "
+				"support, skipping stressor\n", args->name);
+		return EXIT_NOT_IMPLEMENTED;
+#endif
+	}
+
 #if defined(__linux__)
 	/*
 	 *  /dev/shm should be mounted with tmpfs and
@@ -526,6 +882,7 @@ const stressor_info_t stress_shm_info = {
 	.class = CLASS_VM | CLASS_OS | CLASS_IPC,
 	.opts = opts,
 	.verify = VERIFY_ALWAYS,
+	.metrics_max = 12,
 	.help = help
 };
 #else
@@ -173,5 +173,6 @@ const stressor_info_t stress_sigabrt_info = {
 	.stressor = stress_sigabrt,
 	.class = CLASS_SIGNAL | CLASS_OS,
 	.verify = VERIFY_ALWAYS,
+	.metrics_max = 1,
 	.help = help
 };
@@ -145,5 +145,6 @@ const stressor_info_t stress_sigchld_info = {
 	.stressor = stress_sigchld,
 	.class = CLASS_SIGNAL | CLASS_OS,
 	.verify = VERIFY_ALWAYS,
+	.metrics_max = 4,
 	.help = help
 };
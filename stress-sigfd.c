@@ -21,6 +21,7 @@
 #include "core-affinity.h"
 #include "core-builtin.h"
 #include "core-killpid.h"
+#include "core-siglat.h"
 
 #if defined(HAVE_SYS_SIGNALFD_H)
 #include <sys/signalfd.h>
@@ -30,10 +31,16 @@ UNEXPECTED
 
 static const stress_help_t help[] = {
 	{ NULL,	"sigfd N",	"start N workers reading signals via signalfd reads " },
+	{ NULL,	"sigfd-latency", "measure sigqueue to signalfd read delivery latency" },
 	{ NULL,	"sigfd-ops N",	"stop after N bogo signalfd reads" },
 	{ NULL,	NULL,		NULL }
 };
 
+static const stress_opt_t opts[] = {
+	{ OPT_sigfd_latency, "sigfd-latency", TYPE_ID_BOOL, 0, 1, NULL },
+	END_OPT,
+};
+
 #if defined(HAVE_SYS_SIGNALFD_H) && 	\
     defined(HAVE_SIGNALFD) &&		\
     NEED_GLIBC(2,8,0) && 		\
@@ -63,6 +70,17 @@ static int stress_sigfd(stress_args_t *args)
 	int sfd, parent_cpu, rc = EXIT_SUCCESS;
 	const int bad_fd = stress_get_bad_fd();
 	sigset_t mask;
+	bool sigfd_latency = false;
+
+	(void)stress_get_setting("sigfd-latency", &sigfd_latency);
+	if (sigfd_latency) {
+		stress_set_proc_state(args->name, STRESS_STATE_SYNC_WAIT);
+		stress_sync_start_wait(args);
+		stress_set_proc_state(args->name, STRESS_STATE_RUN);
+		rc = stress_siglat(args, STRESS_SIGLAT_SIGNALFD, SIGRTMIN, 0);
+		stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
+		return rc;
+	}
 
 	(void)sigemptyset(&mask);
 	(void)sigaddset(&mask, SIGRTMIN);
@@ -197,13 +215,16 @@ finish:
 const stressor_info_t stress_sigfd_info = {
 	.stressor = stress_sigfd,
 	.class = CLASS_SIGNAL | CLASS_OS,
+	.opts = opts,
 	.verify = VERIFY_OPTIONAL,
+	.metrics_max = STRESS_SIGLAT_METRICS,
 	.help = help
 };
 #else
 const stressor_info_t stress_sigfd_info = {
 	.stressor = stress_unimplemented,
 	.class = CLASS_SIGNAL | CLASS_OS,
+	.opts = opts,
 	.verify = VERIFY_OPTIONAL,
 	.help = help,
 	.unimplemented_reason = "built without sys/signalfd.h, signalfd() or sigqueue() system calls"
@@ -263,5 +263,6 @@ const stressor_info_t stress_sighup_info = {
 	.stressor = stress_sighup,
 	.class = CLASS_SIGNAL | CLASS_OS,
 	.verify = VERIFY_ALWAYS,
+	.metrics_max = 1,
 	.help = help
 };
@@ -246,6 +246,7 @@ const stressor_info_t stress_sigio_info = {
 	.stressor = stress_sigio,
 	.class = CLASS_SIGNAL | CLASS_OS,
 	.verify = VERIFY_ALWAYS,
+	.metrics_max = 1,
 	.help = help
 };
 #else
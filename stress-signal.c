@@ -18,13 +18,20 @@
  *
  */
 #include "stress-ng.h"
+#include "core-siglat.h"
 
 static const stress_help_t help[] = {
 	{ NULL,	"signal N",	"start N workers that exercise signal" },
+	{ NULL,	"signal-latency", "measure kill to handler signal delivery latency" },
 	{ NULL,	"signal-ops N",	"stop after N bogo signals" },
 	{ NULL,	NULL,		 NULL }
 };
 
+static const stress_opt_t opts[] = {
+	{ OPT_signal_latency, "signal-latency", TYPE_ID_BOOL, 0, 1, NULL },
+	END_OPT,
+};
+
 static uint64_t counter;
 
 static void MLOCKED_TEXT stress_signal_handler(int signum)
@@ -71,6 +78,17 @@ static int stress_signal(stress_args_t *args)
 	int rc = EXIT_SUCCESS;
 	const pid_t pid = getpid();
 	const uint64_t *pcounter = (uint64_t *)&counter;
+	bool signal_latency = false;
+
+	(void)stress_get_setting("signal-latency", &signal_latency);
+	if (signal_latency) {
+		stress_set_proc_state(args->name, STRESS_STATE_SYNC_WAIT);
+		stress_sync_start_wait(args);
+		stress_set_proc_state(args->name, STRESS_STATE_RUN);
+		rc = stress_siglat(args, STRESS_SIGLAT_KILL, SIGUSR1, 0);
+		stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
+		return rc;
+	}
 
 	counter = 0;
 
@@ -136,6 +154,8 @@ static int stress_signal(stress_args_t *args)
 const stressor_info_t stress_signal_info = {
 	.stressor = stress_signal,
 	.class = CLASS_SIGNAL | CLASS_OS,
+	.opts = opts,
 	.verify = VERIFY_ALWAYS,
+	.metrics_max = STRESS_SIGLAT_METRICS,
 	.help = help
 };
@@ -375,5 +375,6 @@ const stressor_info_t stress_signest_info = {
 	.stressor = stress_signest,
 	.class = CLASS_SIGNAL | CLASS_OS,
 	.verify = VERIFY_ALWAYS,
+	.metrics_max = 1,
 	.help = help
 };
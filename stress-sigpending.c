@@ -18,13 +18,20 @@
  *
  */
 #include "stress-ng.h"
+#include "core-siglat.h"
 
 static const stress_help_t help[] = {
 	{ NULL,	"sigpending N",     "start N workers exercising sigpending" },
+	{ NULL,	"sigpending-latency", "measure pthread_sigqueue to handler signal latency" },
 	{ NULL,	"sigpending-ops N", "stop after N sigpending bogo operations" },
 	{ NULL,	NULL,		    NULL }
 };
 
+static const stress_opt_t opts[] = {
+	{ OPT_sigpending_latency, "sigpending-latency", TYPE_ID_BOOL, 0, 1, NULL },
+	END_OPT,
+};
+
 /*
  *  stress_sigpending
  *	stress sigpending system call
@@ -32,6 +39,19 @@ static const stress_help_t help[] = {
 static int stress_sigpending(stress_args_t *args)
 {
 	sigset_t new_sigset ALIGN64, old_sigset ALIGN64;
+	bool sigpending_latency = false;
+
+	(void)stress_get_setting("sigpending-latency", &sigpending_latency);
+	if (sigpending_latency) {
+		int rc;
+
+		stress_set_proc_state(args->name, STRESS_STATE_SYNC_WAIT);
+		stress_sync_start_wait(args);
+		stress_set_proc_state(args->name, STRESS_STATE_RUN);
+		rc = stress_siglat(args, STRESS_SIGLAT_PTHREAD_SIGQUEUE, SIGUSR1, 0);
+		stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
+		return rc;
+	}
 
 	if (stress_sighandler(args->name, SIGUSR1, stress_sighandler_nop, NULL) < 0)
 		return EXIT_FAILURE;
@@ -96,6 +116,8 @@ static int stress_sigpending(stress_args_t *args)
 const stressor_info_t stress_sigpending_info = {
 	.stressor = stress_sigpending,
 	.class = CLASS_SIGNAL | CLASS_OS,
+	.opts = opts,
 	.verify = VERIFY_ALWAYS,
+	.metrics_max = STRESS_SIGLAT_METRICS,
 	.help = help
 };
@@ -21,13 +21,20 @@
 #include "core-affinity.h"
 #include "core-builtin.h"
 #include "core-killpid.h"
+#include "core-siglat.h"
 
 static const stress_help_t help[] = {
 	{ NULL,	"sigq N",	"start N workers sending sigqueue signals" },
+	{ NULL,	"sigq-latency",	"measure sigqueue to sigwaitinfo delivery latency" },
 	{ NULL,	"sigq-ops N",	"stop after N sigqueue bogo operations" },
 	{ NULL,	NULL,		NULL }
 };
 
+static const stress_opt_t opts[] = {
+	{ OPT_sigq_latency, "sigq-latency", TYPE_ID_BOOL, 0, 1, NULL },
+	END_OPT,
+};
+
 #if defined(HAVE_SIGQUEUE) && \
     defined(HAVE_SIGWAITINFO) && \
     defined(SA_SIGINFO)
@@ -75,6 +82,17 @@ static int stress_sigq(stress_args_t *args)
 #endif
 	int rc = EXIT_SUCCESS, parent_cpu;
 	int val = stress_mwc32();
+	bool sigq_latency = false;
+
+	(void)stress_get_setting("sigq-latency", &sigq_latency);
+	if (sigq_latency) {
+		stress_set_proc_state(args->name, STRESS_STATE_SYNC_WAIT);
+		stress_sync_start_wait(args);
+		stress_set_proc_state(args->name, STRESS_STATE_RUN);
+		rc = stress_siglat(args, STRESS_SIGLAT_SIGWAITINFO, SIGUSR1, 0);
+		stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
+		return rc;
+	}
 
 	if (val == 0)
 		val++;
@@ -226,13 +244,16 @@ finish:
 const stressor_info_t stress_sigq_info = {
 	.stressor = stress_sigq,
 	.class = CLASS_SIGNAL | CLASS_OS | CLASS_IPC,
+	.opts = opts,
 	.verify = VERIFY_ALWAYS,
+	.metrics_max = STRESS_SIGLAT_METRICS,
 	.help = help
 };
 #else
 const stressor_info_t stress_sigq_info = {
 	.stressor = stress_unimplemented,
 	.class = CLASS_SIGNAL | CLASS_OS | CLASS_IPC,
+	.opts = opts,
 	.verify = VERIFY_ALWAYS,
 	.help = help,
 	.unimplemented_reason = "built without sigqueue() or sigwaitinfo() or defined SA_SIGINFO"
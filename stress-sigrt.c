@@ -19,13 +19,20 @@
  */
 #include "stress-ng.h"
 #include "core-builtin.h"
+#include "core-siglat.h"
 
 static const stress_help_t help[] = {
 	{ NULL,	"sigrt N",	"start N workers sending real time signals" },
+	{ NULL,	"sigrt-latency", "measure sigqueue to handler real time signal latency" },
 	{ NULL,	"sigrt-ops N",	"stop after N real time signal bogo operations" },
 	{ NULL,	NULL,		NULL }
 };
 
+static const stress_opt_t opts[] = {
+	{ OPT_sigrt_latency, "sigrt-latency", TYPE_ID_BOOL, 0, 1, NULL },
+	END_OPT,
+};
+
 #if defined(HAVE_SIGQUEUE) &&		\
     defined(HAVE_SIGWAITINFO) &&	\
     defined(SIGRTMIN) &&		\
@@ -45,6 +52,17 @@ static int stress_sigrt(stress_args_t *args)
 	stress_metrics_t *stress_sigrt_metrics;
 	size_t stress_sigrt_metrics_size = sizeof(*stress_sigrt_metrics) * MAX_RTPIDS;
 	double count, duration, rate;
+	bool sigrt_latency = false;
+
+	(void)stress_get_setting("sigrt-latency", &sigrt_latency);
+	if (sigrt_latency) {
+		stress_set_proc_state(args->name, STRESS_STATE_SYNC_WAIT);
+		stress_sync_start_wait(args);
+		stress_set_proc_state(args->name, STRESS_STATE_RUN);
+		rc = stress_siglat(args, STRESS_SIGLAT_SIGQUEUE, SIGRTMIN, 1);
+		stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
+		return rc;
+	}
 
 	stress_sigrt_metrics = (stress_metrics_t *)
 		stress_mmap_populate(NULL, stress_sigrt_metrics_size,
@@ -195,13 +213,16 @@ reap:
 const stressor_info_t stress_sigrt_info = {
 	.stressor = stress_sigrt,
 	.class = CLASS_SIGNAL | CLASS_OS,
+	.opts = opts,
 	.verify = VERIFY_ALWAYS,
+	.metrics_max = 1 + STRESS_SIGLAT_METRICS,
 	.help = help
 };
 #else
 const stressor_info_t stress_sigrt_info = {
 	.stressor = stress_unimplemented,
 	.class = CLASS_SIGNAL | CLASS_OS,
+	.opts = opts,
 	.verify = VERIFY_ALWAYS,
 	.help = help,
 	.unimplemented_reason = "built without sigqueue() or sigwaitinfo() or defined SIGRTMIN or SIGRTMAX"
@@ -100,6 +100,7 @@ const stressor_info_t stress_sigtrap_info = {
 	.stressor = stress_sigtrap,
 	.class = CLASS_SIGNAL | CLASS_OS,
 	.verify = VERIFY_ALWAYS,
+	.metrics_max = 1,
 	.help = help
 };
 #else
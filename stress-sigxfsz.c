@@ -136,6 +136,7 @@ const stressor_info_t stress_sigxfsz_info = {
 	.stressor = stress_sigxfsz,
 	.class = CLASS_SIGNAL | CLASS_OS,
 	.verify = VERIFY_ALWAYS,
+	.metrics_max = 1,
 	.help = help
 };
 #else
@@ -18,11 +18,25 @@
  *
  */
 #include "stress-ng.h"
+#include "core-builtin.h"
+#include "core-ebr.h"
+#include "core-pthread.h"
 
 #define MIN_SKIPLIST_SIZE	(1 * KB)
 #define MAX_SKIPLIST_SIZE	(4 * MB)
 #define DEFAULT_SKIPLIST_SIZE	(1 * KB)
 
+#define MIN_SKIPLIST_THREADS	(0)
+#define MAX_SKIPLIST_THREADS	(256)
+
+#define MIN_SKIPLIST_RWMIX	(0)
+#define MAX_SKIPLIST_RWMIX	(100)
+#define DEFAULT_SKIPLIST_RWMIX	(80)
+
+#define MIN_SKIPLIST_INSMIX	(0)
+#define MAX_SKIPLIST_INSMIX	(100)
+#define DEFAULT_SKIPLIST_INSMIX	(50)
+
 typedef struct skip_node {
 	unsigned long int value;
 	struct skip_node *skip_nodes[1];
@@ -35,10 +49,13 @@ typedef struct {
 } skip_list_t;
 
 static const stress_help_t help[] = {
-	{ NULL,	"skiplist N",	  "start N workers that exercise a skiplist search" },
-	{ NULL,	"skiplist-ops N", "stop after N skiplist search bogo operations" },
-	{ NULL,	"skiplist-size N", "number of 32 bit integers to add to skiplist" },
-	{ NULL,	NULL,		  NULL }
+	{ NULL,	"skiplist N",	     "start N workers that exercise a skiplist search" },
+	{ NULL,	"skiplist-insmix N", "percentage of lock-free skiplist writes that are inserts" },
+	{ NULL,	"skiplist-ops N",    "stop after N skiplist search bogo operations" },
+	{ NULL,	"skiplist-rwmix N",  "percentage of lock-free skiplist ops that are searches" },
+	{ NULL,	"skiplist-size N",   "number of 32 bit integers to add to skiplist" },
+	{ NULL,	"skiplist-threads N","use a lock-free skiplist shared by N threads" },
+	{ NULL,	NULL,		     NULL }
 };
 
 /*
@@ -200,6 +217,494 @@ static void skip_list_free(skip_list_t *list)
 		free(skip_node);
 }
 
+#if defined(HAVE_LIB_PTHREAD) &&		\
+    defined(HAVE_ATOMIC_COMPARE_EXCHANGE) &&	\
+    defined(HAVE_ATOMIC_FETCH_AND) &&		\
+    defined(HAVE_ATOMIC_FETCH_OR) &&		\
+    defined(STRESS_EBR)
+#define HAVE_SKIPLIST_LOCKFREE
+
+/*
+ *  Lock-free skiplist, each level is a Harris style linked list where
+ *  the low bit of a next pointer marks the node as logically deleted at
+ *  that level. Deletion marks the levels top down, the thread that marks
+ *  level 0 owns the delete and unlinks the node with a search. Nodes are
+ *  reclaimed with epoch based reclamation.
+ */
+#define LF_MAX_LEVEL		(24)
+#define LF_MARK			((uintptr_t)1)
+#define LF_PTR(p)		((lf_node_t *)((p) & ~LF_MARK))
+#define LF_EPOCH_OPS		(64)		/* ops between epoch advance attempts */
+#define LF_PHASE_OPS		(256 * 1024)	/* ops in each timed phase */
+
+#define LF_NODE_INSERTING	(0x1)		/* inserter still linking upper levels */
+#define LF_NODE_DELETED		(0x2)		/* deleter has marked level 0 */
+
+typedef struct lf_node {
+	stress_ebr_node_t ebr;		/* retired list link, must be first */
+	uint64_t key;
+	uint32_t top;			/* number of levels */
+	uint32_t state;			/* LF_NODE_* flags */
+	uintptr_t next[];		/* marked next pointers */
+} lf_node_t;
+
+struct lf_skiplist;
+
+typedef struct {
+	stress_pthread_work_t work;	/* thread work, must be first */
+	struct lf_skiplist *lf;		/* shared skiplist */
+	uint64_t rnd;			/* per thread xorshift state */
+	stress_ebr_thread_t *ebr;	/* per thread epoch state */
+	size_t ops;			/* ops to perform */
+	size_t done;			/* ops performed */
+	int64_t net;			/* inserts - deletes */
+	bool nomem;			/* node allocation failed */
+} ALIGN64 lf_thread_t;
+
+typedef struct lf_skiplist {
+	lf_node_t *head;		/* head sentinel, key 0 */
+	lf_node_t *tail;		/* tail sentinel, key UINT64_MAX */
+	stress_ebr_t ebr;		/* epoch reclamation */
+	lf_thread_t *threads;		/* per thread state */
+	size_t threads_n;		/* number of threads */
+	uint64_t key_range;		/* keys are 1..key_range */
+	uint32_t rwmix;			/* percentage of reads */
+	uint32_t insmix;		/* percentage of writes that are inserts */
+} lf_skiplist_t;
+
+static inline uint64_t lf_rand(lf_thread_t *t)
+{
+	register uint64_t x = t->rnd;
+
+	x ^= x << 13;
+	x ^= x >> 7;
+	x ^= x << 17;
+	t->rnd = x;
+	return x;
+}
+
+static lf_node_t *lf_node_alloc(const uint64_t key, const uint32_t top)
+{
+	lf_node_t *node;
+
+	node = (lf_node_t *)calloc(1, sizeof(*node) + (top * sizeof(node->next[0])));
+	if (UNLIKELY(!node))
+		return NULL;
+	node->key = key;
+	node->top = top;
+	return node;
+}
+
+/*
+ *  lf_find()
+ *	find the predecessors and successors of key at each level,
+ *	unlinking marked nodes on the way, true if key is found
+ */
+static bool OPTIMIZE3 lf_find(
+	lf_skiplist_t *lf,
+	const uint64_t key,
+	lf_node_t **preds,
+	lf_node_t **succs)
+{
+	lf_node_t *pred, *curr;
+	uintptr_t raw;
+	int level;
+
+retry:
+	pred = lf->head;
+	for (level = LF_MAX_LEVEL - 1; level >= 0; level--) {
+		curr = LF_PTR(__atomic_load_n(&pred->next[level], __ATOMIC_ACQUIRE));
+		for (;;) {
+			raw = __atomic_load_n(&curr->next[level], __ATOMIC_ACQUIRE);
+			while (raw & LF_MARK) {
+				uintptr_t expected = (uintptr_t)curr;
+
+				if (!__atomic_compare_exchange_n(&pred->next[level], &expected,
+						raw & ~LF_MARK, false,
+						__ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+					goto retry;
+				curr = LF_PTR(raw);
+				raw = __atomic_load_n(&curr->next[level], __ATOMIC_ACQUIRE);
+			}
+			if (curr->key >= key)
+				break;
+			pred = curr;
+			curr = LF_PTR(raw);
+		}
+		preds[level] = pred;
+		succs[level] = curr;
+	}
+	return succs[0]->key == key;
+}
+
+/*
+ *  lf_contains()
+ *	wait-free search, marked nodes are skipped but not unlinked
+ */
+static bool OPTIMIZE3 lf_contains(lf_skiplist_t *lf, const uint64_t key)
+{
+	lf_node_t *pred = lf->head, *curr = NULL;
+	uintptr_t raw;
+	int level;
+
+	for (level = LF_MAX_LEVEL - 1; level >= 0; level--) {
+		curr = LF_PTR(__atomic_load_n(&pred->next[level], __ATOMIC_ACQUIRE));
+		for (;;) {
+			raw = __atomic_load_n(&curr->next[level], __ATOMIC_ACQUIRE);
+			while (raw & LF_MARK) {
+				curr = LF_PTR(raw);
+				raw = __atomic_load_n(&curr->next[level], __ATOMIC_ACQUIRE);
+			}
+			if (curr->key >= key)
+				break;
+			pred = curr;
+			curr = LF_PTR(raw);
+		}
+	}
+	return curr && (curr->key == key);
+}
+
+/*
+ *  lf_insert()
+ *	insert key, returns 1 if inserted, 0 if already present and
+ *	-1 if out of memory
+ */
+static int OPTIMIZE3 lf_insert(lf_thread_t *t, const uint64_t key)
+{
+	lf_skiplist_t *lf = t->lf;
+	lf_node_t *preds[LF_MAX_LEVEL], *succs[LF_MAX_LEVEL];
+	lf_node_t *node = NULL;
+	uint64_t r = lf_rand(t);
+	uint32_t top = 1, level, state;
+
+	while ((r & 1) && (top < LF_MAX_LEVEL)) {
+		r >>= 1;
+		top++;
+	}
+
+	for (;;) {
+		uintptr_t expected;
+
+		if (lf_find(lf, key, preds, succs)) {
+			free(node);	/* never published */
+			return 0;
+		}
+		if (!node) {
+			node = lf_node_alloc(key, top);
+			if (UNLIKELY(!node))
+				return -1;
+			node->state = LF_NODE_INSERTING;
+		}
+		for (level = 0; level < top; level++)
+			node->next[level] = (uintptr_t)succs[level];
+		expected = (uintptr_t)succs[0];
+		if (__atomic_compare_exchange_n(&preds[0]->next[0], &expected,
+				(uintptr_t)node, false, __ATOMIC_RELEASE, __ATOMIC_RELAXED))
+			break;
+	}
+
+	/* link the upper levels, stop if the node gets deleted */
+	for (level = 1; level < top; level++) {
+		for (;;) {
+			uintptr_t old = __atomic_load_n(&node->next[level], __ATOMIC_ACQUIRE);
+			uintptr_t expected;
+
+			if (old & LF_MARK)
+				goto linked;
+			if ((old != (uintptr_t)succs[level]) &&
+			    !__atomic_compare_exchange_n(&node->next[level], &old,
+					(uintptr_t)succs[level], false,
+					__ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+				continue;
+			expected = (uintptr_t)succs[level];
+			if (__atomic_compare_exchange_n(&preds[level]->next[level], &expected,
+					(uintptr_t)node, false, __ATOMIC_RELEASE, __ATOMIC_RELAXED))
+				break;
+			(void)lf_find(lf, key, preds, succs);
+			if (succs[0] != node)
+				goto linked;
+		}
+	}
+linked:
+	/*
+	 *  A delete that was flagged while linking leaves retiring the node
+	 *  to the inserter, it may have been linked at a level after the
+	 *  deleter's unlinking search
+	 */
+	state = __atomic_fetch_and(&node->state, ~LF_NODE_INSERTING, __ATOMIC_ACQ_REL);
+	if (state & LF_NODE_DELETED) {
+		(void)lf_find(lf, key, preds, succs);
+		stress_ebr_retire(&lf->ebr, t->ebr, node);
+	}
+	return 1;
+}
+
+/*
+ *  lf_delete()
+ *	delete key, returns 1 if deleted, 0 if not present
+ */
+static int OPTIMIZE3 lf_delete(lf_thread_t *t, const uint64_t key)
+{
+	lf_skiplist_t *lf = t->lf;
+	lf_node_t *preds[LF_MAX_LEVEL], *succs[LF_MAX_LEVEL];
+	lf_node_t *victim;
+	uintptr_t raw;
+	uint32_t state;
+	int level;
+
+	if (!lf_find(lf, key, preds, succs))
+		return 0;
+	victim = succs[0];
+
+	for (level = (int)victim->top - 1; level >= 1; level--) {
+		raw = __atomic_load_n(&victim->next[level], __ATOMIC_ACQUIRE);
+		while (!(raw & LF_MARK)) {
+			(void)__atomic_compare_exchange_n(&victim->next[level], &raw,
+				raw | LF_MARK, false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE);
+		}
+	}
+	raw = __atomic_load_n(&victim->next[0], __ATOMIC_ACQUIRE);
+	for (;;) {
+		if (raw & LF_MARK)
+			return 0;	/* another thread deleted it */
+		if (__atomic_compare_exchange_n(&victim->next[0], &raw, raw | LF_MARK,
+				false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+			break;
+	}
+	/*
+	 *  Flag the delete before unlinking, if the inserter is still
+	 *  linking it will unlink and retire the node once it is done
+	 */
+	state = __atomic_fetch_or(&victim->state, LF_NODE_DELETED, __ATOMIC_ACQ_REL);
+	(void)lf_find(lf, key, preds, succs);
+	if (!(state & LF_NODE_INSERTING))
+		stress_ebr_retire(&lf->ebr, t->ebr, victim);
+	return 1;
+}
+
+/*
+ *  lf_thread()
+ *	perform a mix of searches, inserts and deletes of random keys
+ */
+static void *lf_thread(void *arg)
+{
+	lf_thread_t *t = (lf_thread_t *)arg;
+	lf_skiplist_t *lf = t->lf;
+	size_t i;
+
+	for (i = 0; i < t->ops; i++) {
+		const uint64_t r = lf_rand(t);
+		const uint64_t key = 1 + ((r >> 8) % lf->key_range);
+		const uint32_t pct = (uint32_t)((r & 0xff) % 100);
+
+		if ((i & (LF_EPOCH_OPS - 1)) == 0) {
+			if (UNLIKELY(!stress_continue_flag()))
+				break;
+			stress_ebr_try_advance(&lf->ebr);
+		}
+		stress_ebr_enter(&lf->ebr, t->ebr);
+		if (pct < lf->rwmix) {
+			(void)lf_contains(lf, key);
+		} else if ((lf_rand(t) % 100) < lf->insmix) {
+			const int ret = lf_insert(t, key);
+
+			if (UNLIKELY(ret < 0)) {
+				t->nomem = true;
+				stress_ebr_exit(t->ebr);
+				break;
+			}
+			t->net += ret;
+		} else {
+			t->net -= lf_delete(t, key);
+		}
+		stress_ebr_exit(t->ebr);
+	}
+	t->done = i;
+	return &g_nowt;
+}
+
+/*
+ *  lf_run()
+ *	run ops random ops over threads_n threads
+ */
+static void lf_run(lf_skiplist_t *lf, const size_t threads_n, const size_t ops)
+{
+	size_t i;
+
+	for (i = 0; i < threads_n; i++) {
+		lf_thread_t *t = &lf->threads[i];
+
+		t->ops = (ops / threads_n) + ((i < (ops % threads_n)) ? 1 : 0);
+		t->done = 0;
+	}
+	stress_pthread_work_run(lf->threads, sizeof(*lf->threads), threads_n, lf_thread);
+}
+
+/*
+ *  lf_check()
+ *	check each level is in ascending key order with no marked
+ *	nodes, returns the number of level 0 nodes or -1 on error
+ */
+static int64_t lf_check(const lf_skiplist_t *lf)
+{
+	int64_t count = 0;
+	int level;
+
+	for (level = LF_MAX_LEVEL - 1; level >= 0; level--) {
+		const lf_node_t *node = lf->head;
+
+		while (node != lf->tail) {
+			const uintptr_t raw = node->next[level];
+
+			if ((raw & LF_MARK) || !raw || (LF_PTR(raw)->key <= node->key))
+				return -1;
+			node = LF_PTR(raw);
+			if ((level == 0) && (node != lf->tail))
+				count++;
+		}
+	}
+	return count;
+}
+
+/*
+ *  stress_skiplist_lockfree()
+ *	concurrent lock-free skiplist mode, each bogo-op runs a mix of
+ *	random searches, inserts and deletes on threads_n threads and then
+ *	the same number of ops on one thread as a scaling baseline
+ */
+static int stress_skiplist_lockfree(
+	stress_args_t *args,
+	const size_t n,
+	const uint32_t threads_n,
+	const uint32_t rwmix,
+	const uint32_t insmix)
+{
+	lf_skiplist_t lf;
+	lf_node_t *node;
+	size_t i;
+	int64_t expected = 0, count;
+	double t, duration_par = 0.0, duration_one = 0.0;
+	double ops_par = 0.0, ops_one = 0.0, rate_par, rate_one;
+	char msg[40];
+	int rc = EXIT_SUCCESS;
+
+	(void)shim_memset(&lf, 0, sizeof(lf));
+	lf.threads_n = (size_t)threads_n;
+	lf.key_range = (uint64_t)n * 2;
+	lf.rwmix = rwmix;
+	lf.insmix = insmix;
+	lf.head = lf_node_alloc(0, LF_MAX_LEVEL);
+	lf.tail = lf_node_alloc(UINT64_MAX, LF_MAX_LEVEL);
+	lf.threads = (lf_thread_t *)calloc(lf.threads_n, sizeof(*lf.threads));
+	if (!lf.head || !lf.tail || !lf.threads ||
+	    (stress_ebr_init(&lf.ebr, lf.threads_n) < 0)) {
+		pr_inf_skip("%s: cannot allocate lock-free skiplist state for %zu threads, "
+			"skipping stressor\n", args->name, lf.threads_n);
+		rc = EXIT_NO_RESOURCE;
+		goto free_lf;
+	}
+	for (i = 0; i < LF_MAX_LEVEL; i++)
+		lf.head->next[i] = (uintptr_t)lf.tail;
+	for (i = 0; i < lf.threads_n; i++) {
+		lf.threads[i].lf = &lf;
+		lf.threads[i].ebr = &lf.ebr.threads[i];
+		lf.threads[i].rnd = stress_mwc64() | 1;
+	}
+
+	/* half fill the key range */
+	for (i = 0; i < n; i++) {
+		const int ret = lf_insert(&lf.threads[0], 1 + (lf_rand(&lf.threads[0]) % lf.key_range));
+
+		if (ret < 0) {
+			pr_inf_skip("%s: out of memory initializing the skip list, "
+				"skipping stressor\n", args->name);
+			rc = EXIT_NO_RESOURCE;
+			goto free_nodes;
+		}
+		expected += ret;
+	}
+
+	stress_set_proc_state(args->name, STRESS_STATE_SYNC_WAIT);
+	stress_sync_start_wait(args);
+	stress_set_proc_state(args->name, STRESS_STATE_RUN);
+
+	do {
+		size_t j;
+
+		for (j = 0; j < 2; j++) {
+			const size_t nthreads = (j == 0) ? lf.threads_n : 1;
+
+			t = stress_time_now();
+			lf_run(&lf, nthreads, LF_PHASE_OPS);
+			t = stress_time_now() - t;
+			for (i = 0; i < nthreads; i++) {
+				lf_thread_t *lt = &lf.threads[i];
+
+				if (lt->nomem) {
+					pr_inf("%s: out of memory inserting into the skip list\n",
+						args->name);
+					rc = EXIT_NO_RESOURCE;
+				}
+				expected += lt->net;
+				lt->net = 0;
+				if (j == 0)
+					ops_par += (double)lt->done;
+				else
+					ops_one += (double)lt->done;
+			}
+			if (j == 0)
+				duration_par += t;
+			else
+				duration_one += t;
+
+			count = lf_check(&lf);
+			if (count < 0) {
+				pr_fail("%s: lock-free skiplist is corrupt, found an "
+					"out of order or marked node\n", args->name);
+				rc = EXIT_FAILURE;
+			} else if (count != expected) {
+				pr_fail("%s: lock-free skiplist has %" PRId64 " nodes, "
+					"expected %" PRId64 "\n", args->name, count, expected);
+				rc = EXIT_FAILURE;
+			}
+			if ((rc != EXIT_SUCCESS) || !stress_continue_flag())
+				break;
+		}
+		if (rc != EXIT_SUCCESS)
+			break;
+		stress_bogo_inc(args);
+	} while (stress_continue(args));
+
+	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
+
+	rate_par = (duration_par > 0.0) ? ops_par / duration_par : 0.0;
+	rate_one = (duration_one > 0.0) ? ops_one / duration_one : 0.0;
+	(void)snprintf(msg, sizeof(msg), "skiplist ops per sec, %zu threads", lf.threads_n);
+	stress_metrics_set(args, 0, msg, rate_par, STRESS_METRIC_HARMONIC_MEAN);
+	stress_metrics_set(args, 1, "skiplist ops per sec, 1 thread",
+		rate_one, STRESS_METRIC_HARMONIC_MEAN);
+	stress_metrics_set(args, 2, "% parallel scaling efficiency",
+		(rate_one > 0.0) ? 100.0 * rate_par / (rate_one * (double)lf.threads_n) : 0.0,
+		STRESS_METRIC_HARMONIC_MEAN);
+
+free_nodes:
+	node = LF_PTR(lf.head->next[0]);
+	while (node && (node != lf.tail)) {
+		lf_node_t *next = LF_PTR(node->next[0]);
+
+		free(node);
+		node = next;
+	}
+free_lf:
+	stress_ebr_free(&lf.ebr);
+	free(lf.threads);
+	free(lf.tail);
+	free(lf.head);
+
+	return rc;
+}
+#endif
+
 /*
  *  stress_skiplist()
  *	stress skiplist
@@ -208,8 +713,15 @@ static int OPTIMIZE3 stress_skiplist(stress_args_t *args)
 {
 	unsigned long int n, i, ln2n;
 	uint64_t skiplist_size = DEFAULT_SKIPLIST_SIZE;
+	uint32_t skiplist_threads = 0;
+	uint32_t skiplist_rwmix = DEFAULT_SKIPLIST_RWMIX;
+	uint32_t skiplist_insmix = DEFAULT_SKIPLIST_INSMIX;
 	int rc = EXIT_FAILURE;
 
+	(void)stress_get_setting("skiplist-threads", &skiplist_threads);
+	(void)stress_get_setting("skiplist-rwmix", &skiplist_rwmix);
+	(void)stress_get_setting("skiplist-insmix", &skiplist_insmix);
+
 	if (!stress_get_setting("skiplist-size", &skiplist_size)) {
 		if (g_opt_flags & OPT_FLAGS_MAXIMIZE)
 			skiplist_size = MAX_SKIPLIST_SIZE;
@@ -219,6 +731,17 @@ static int OPTIMIZE3 stress_skiplist(stress_args_t *args)
 	n = (unsigned long int)skiplist_size;
 	ln2n = skip_list_ln2(n);
 
+	if (skiplist_threads > 0) {
+#if defined(HAVE_SKIPLIST_LOCKFREE)
+		return stress_skiplist_lockfree(args, (size_t)n, skiplist_threads,
+			skiplist_rwmix, skiplist_insmix);
+#else
+		if (args->instance == 0)
+			pr_inf("%s: lock-free skiplist requires pthreads and atomic "
+				"builtins, ignoring --skiplist-threads\n", args->name);
+#endif
+	}
+
 	/*
 	 *  This stops static analyzers getting confused for
 	 *  sizes where they assume ln2n is 0
@@ -278,7 +801,10 @@ finish:
 }
 
 static const stress_opt_t opts[] = {
-	{ OPT_skiplist_size, "skiplist-size", TYPE_ID_UINT64, MIN_SKIPLIST_SIZE, MAX_SKIPLIST_SIZE, NULL },
+	{ OPT_skiplist_insmix,  "skiplist-insmix",  TYPE_ID_UINT32, MIN_SKIPLIST_INSMIX, MAX_SKIPLIST_INSMIX, NULL },
+	{ OPT_skiplist_rwmix,   "skiplist-rwmix",   TYPE_ID_UINT32, MIN_SKIPLIST_RWMIX, MAX_SKIPLIST_RWMIX, NULL },
+	{ OPT_skiplist_size,    "skiplist-size",    TYPE_ID_UINT64, MIN_SKIPLIST_SIZE, MAX_SKIPLIST_SIZE, NULL },
+	{ OPT_skiplist_threads, "skiplist-threads", TYPE_ID_UINT32, MIN_SKIPLIST_THREADS, MAX_SKIPLIST_THREADS, NULL },
 	END_OPT,
 };
 
@@ -287,5 +813,6 @@ const stressor_info_t stress_skiplist_info = {
 	.class = CLASS_CPU_CACHE | CLASS_CPU | CLASS_MEMORY | CLASS_SEARCH,
 	.opts = opts,
 	.verify = VERIFY_ALWAYS,
+	.metrics_max = 3,
 	.help = help
 };
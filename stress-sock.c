@@ -21,9 +21,12 @@
 #include "core-affinity.h"
 #include "core-attribute.h"
 #include "core-builtin.h"
+#include "core-io-uring.h"
 #include "core-killpid.h"
+#include "core-latency.h"
 #include "core-madvise.h"
 #include "core-net.h"
+#include "io-uring.h"
 
 #include <sys/ioctl.h>
 
@@ -57,6 +60,22 @@ UNEXPECTED
 UNEXPECTED
 #endif
 
+#if defined(HAVE_LINUX_ERRQUEUE_H)
+#include <linux/errqueue.h>
+#endif
+
+#if defined(HAVE_POLL_H)
+#include <poll.h>
+#endif
+
+#if defined(HAVE_SYS_EPOLL_H)
+#include <sys/epoll.h>
+#endif
+
+#if defined(HAVE_LINUX_FILTER_H)
+#include <linux/filter.h>
+#endif
+
 #include <netinet/in.h>
 #include <arpa/inet.h>
 
@@ -84,6 +103,28 @@ UNEXPECTED
 
 #define MSGVEC_SIZE		(4)
 
+#define MIN_SOCKET_REUSEPORT		(1)
+#define MAX_SOCKET_REUSEPORT		(1024)
+#define MIN_SOCKET_REUSEPORT_CONNS	(1)
+#define MAX_SOCKET_REUSEPORT_CONNS	(65536)
+#define DEFAULT_SOCKET_REUSEPORT_CONNS	(64)
+#define MIN_SOCKET_REUSEPORT_SIZE	(1)
+#define MAX_SOCKET_REUSEPORT_SIZE	(MMAP_IO_SIZE)
+#define DEFAULT_SOCKET_REUSEPORT_SIZE	(64)
+#define SOCKET_REUSEPORT_EVENTS		(256)
+
+#define MIN_SOCKET_RR_SIZE		(1)
+#define MAX_SOCKET_RR_SIZE		(MMAP_BUF_SIZE / 2)
+
+#define SOCKET_ENGINE_EPOLL		(0)
+#define SOCKET_ENGINE_IO_URING		(1)
+#define SOCKET_ENGINE_CONN_REQUESTS	(16)	/* round trips per connection */
+
+#define MIN_SOCKET_ZEROCOPY_WINDOW	(1)
+#define MAX_SOCKET_ZEROCOPY_WINDOW	(65536)
+#define DEFAULT_SOCKET_ZEROCOPY_WINDOW	(256)
+#define SOCKET_ZEROCOPY_RX_MAP_SIZE	(256 * KB)
+
 #define PROC_CONG_CTRLS		"/proc/sys/net/ipv4/tcp_allowed_congestion_control"
 
 typedef struct {
@@ -91,9 +132,53 @@ typedef struct {
 	const int   optval;
 } stress_sock_options_t;
 
+#if defined(MSG_ZEROCOPY) &&		\
+    defined(SO_ZEROCOPY) &&		\
+    defined(HAVE_LINUX_ERRQUEUE_H) &&	\
+    defined(SO_EE_ORIGIN_ZEROCOPY) &&	\
+    defined(SO_EE_CODE_ZEROCOPY_COPIED) && \
+    defined(IP_RECVERR) &&		\
+    defined(IPV6_RECVERR) &&		\
+    defined(HAVE_POLL_H) &&		\
+    defined(HAVE_POLL)
+#define STRESS_SOCK_ZEROCOPY	(1)
+
+typedef struct {
+	uint32_t *lens;		/* bytes of each outstanding zero-copy send */
+	uint32_t window;	/* maximum outstanding zero-copy sends */
+	uint32_t next;		/* notification id of the next zero-copy send */
+	uint32_t completed;	/* number of zero-copy sends completed */
+	uint64_t zc_bytes;	/* bytes sent without a copy */
+	uint64_t copied_bytes;	/* bytes the kernel had to copy */
+} stress_sock_zc_tx_t;
+#endif
+
+#if defined(__linux__) &&		\
+    defined(TCP_ZEROCOPY_RECEIVE)
+#define STRESS_SOCK_ZEROCOPY_RECEIVE	(1)
+
+/* kernel ABI of struct tcp_zerocopy_receive up to the flags field */
+typedef struct {
+	uint64_t address;	/* in: address of mapping */
+	uint32_t length;	/* in/out: number of bytes to map/mapped */
+	uint32_t recv_skip_hint; /* out: bytes to skip */
+	uint32_t inq;		/* out: bytes in read queue */
+	int32_t err;		/* out: socket error */
+	uint64_t copybuf_address; /* in: copy buffer address */
+	int32_t copybuf_len;	/* in/out: copy buffer bytes avail/used */
+	uint32_t flags;		/* in: flags */
+} stress_tcp_zerocopy_receive_t;
+
+typedef struct {
+	uint64_t zc_bytes;	/* bytes mapped without a copy */
+	uint64_t copied_bytes;	/* bytes copied */
+} stress_sock_zc_rx_t;
+#endif
+
 static const stress_help_t help[] = {
 	{ "S N", "sock N",		"start N workers exercising socket I/O" },
 	{ NULL,	"sock-domain D",	"specify socket domain, default is ipv4" },
+	{ NULL,	"sock-engine E",	"request/response server engine: epoll or io-uring" },
 	{ NULL,	"sock-if I",		"use network interface I, e.g. lo, eth0, etc." },
 	{ NULL,	"sock-msgs N",		"number of messages to send per connection" },
 	{ NULL,	"sock-nodelay",		"disable Nagle algorithm, send data immediately" },
@@ -101,11 +186,24 @@ static const stress_help_t help[] = {
 	{ NULL,	"sock-opts option", 	"socket options [send|sendmsg|sendmmsg]" },
 	{ NULL,	"sock-port P",		"use socket ports P to P + number of workers - 1" },
 	{ NULL, "sock-protocol",	"use socket protocol P, default is tcp, can be mptcp" },
+	{ NULL,	"sock-reuseport N",	"use N SO_REUSEPORT epoll listeners with many connections" },
+	{ NULL,	"sock-reuseport-cbpf",	"steer SO_REUSEPORT connections to listeners by CPU" },
+	{ NULL,	"sock-reuseport-conns N", "number of concurrent connections for --sock-reuseport" },
+	{ NULL,	"sock-reuseport-size N", "request/response size in bytes for --sock-reuseport" },
+	{ NULL,	"sock-rr N",		"request/response ping-pong with N byte messages" },
+	{ NULL,	"sock-rr-client-cpu N",	"pin the --sock-rr client to CPU N" },
+	{ NULL,	"sock-rr-server-cpu N",	"pin the --sock-rr server to CPU N" },
 	{ NULL,	"sock-type T",		"socket type (stream, seqpacket)" },
-	{ NULL, "sock-zerocopy",	"enable zero copy sends" },
+	{ NULL, "sock-zerocopy",	"enable zero copy sends and receives" },
+	{ NULL, "sock-zerocopy-window N", "maximum outstanding zero copy sends" },
 	{ NULL,	NULL,			NULL }
 };
 
+static const char * const sock_engines[] = {
+	"epoll",
+	"io-uring",
+};
+
 static const stress_sock_options_t sock_options_opts[] = {
 	{ "random",	SOCKET_OPT_RANDOM },
 	{ "send",	SOCKET_OPT_SEND },
@@ -467,6 +565,188 @@ static const int sol_socket_so_opts[] = {
 };
 
 
+/*
+ *  stress_sock_cpu_time()
+ *	user + system CPU time of the calling process in seconds
+ */
+static double stress_sock_cpu_time(void)
+{
+	struct rusage usage;
+
+	if (shim_getrusage(RUSAGE_SELF, &usage) < 0)
+		return 0.0;
+	return stress_timeval_to_double(&usage.ru_utime) +
+	       stress_timeval_to_double(&usage.ru_stime);
+}
+
+#if defined(STRESS_SOCK_ZEROCOPY)
+/*
+ *  stress_sock_zc_reap()
+ *	read MSG_ZEROCOPY completion notifications from the socket
+ *	error queue, waiting up to timeout_ms for the first one. Each
+ *	notification covers the send ids ee_info..ee_data and flags
+ *	if the kernel had to fall back to copying the data
+ */
+static void stress_sock_zc_reap(const int fd, stress_sock_zc_tx_t *zc, const int timeout_ms)
+{
+	if (timeout_ms > 0) {
+		struct pollfd pfd;
+
+		pfd.fd = fd;
+		pfd.events = 0;		/* POLLERR is always reported */
+		pfd.revents = 0;
+		(void)poll(&pfd, 1, timeout_ms);
+	}
+
+	for (;;) {
+		char control[128];
+		struct msghdr msg;
+		struct cmsghdr *cmsg;
+
+		(void)shim_memset(&msg, 0, sizeof(msg));
+		msg.msg_control = control;
+		msg.msg_controllen = sizeof(control);
+		if (recvmsg(fd, &msg, MSG_ERRQUEUE | MSG_DONTWAIT) < 0)
+			break;
+		for (cmsg = CMSG_FIRSTHDR(&msg); cmsg; cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+			const struct sock_extended_err *serr;
+			uint32_t id;
+
+			if (!(((cmsg->cmsg_level == SOL_IP) && (cmsg->cmsg_type == IP_RECVERR)) ||
+			      ((cmsg->cmsg_level == SOL_IPV6) && (cmsg->cmsg_type == IPV6_RECVERR))))
+				continue;
+			serr = (const struct sock_extended_err *)CMSG_DATA(cmsg);
+			if ((serr->ee_errno != 0) || (serr->ee_origin != SO_EE_ORIGIN_ZEROCOPY))
+				continue;
+			for (id = serr->ee_info; id != serr->ee_data + 1; id++) {
+				const uint64_t len = zc->lens[id % zc->window];
+
+				if (serr->ee_code & SO_EE_CODE_ZEROCOPY_COPIED)
+					zc->copied_bytes += len;
+				else
+					zc->zc_bytes += len;
+				zc->completed++;
+			}
+		}
+	}
+}
+
+/*
+ *  stress_sock_zc_sent()
+ *	account for a successful send of len bytes, for MSG_ZEROCOPY the
+ *	buffer cannot be reused until its completion arrives so
+ *	throttle the sender to at most window outstanding sends
+ */
+static void stress_sock_zc_sent(
+	const int fd,
+	stress_sock_zc_tx_t *zc,
+	const int flag,
+	const size_t len)
+{
+	if (!(flag & MSG_ZEROCOPY)) {
+		zc->copied_bytes += len;
+		return;
+	}
+	zc->lens[zc->next % zc->window] = (uint32_t)len;
+	zc->next++;
+
+	while ((zc->next - zc->completed >= zc->window) && stress_continue_flag())
+		stress_sock_zc_reap(fd, zc, 10);
+}
+
+/*
+ *  stress_sock_zc_enobufs()
+ *	a MSG_ZEROCOPY send failed with ENOBUFS because the socket
+ *	is out of optmem for notifications, reap completions to free
+ *	some and only fall back to copying sends if none completed
+ */
+static void stress_sock_zc_enobufs(const int fd, stress_sock_zc_tx_t *zc, int *flag)
+{
+	const uint32_t completed = zc->completed;
+
+	if (*flag & MSG_ZEROCOPY) {
+		stress_sock_zc_reap(fd, zc, 10);
+		if (zc->completed != completed)
+			return;
+	}
+	*flag &= ~MSG_ZEROCOPY;
+}
+
+/*
+ *  stress_sock_zc_drain()
+ *	wait for all the outstanding completions on a connection
+ *	before it is closed, ids restart at zero on a new connection
+ */
+static void stress_sock_zc_drain(const int fd, stress_sock_zc_tx_t *zc)
+{
+	int i;
+
+	for (i = 0; (i < 100) && (zc->completed != zc->next); i++)
+		stress_sock_zc_reap(fd, zc, 10);
+	zc->next = 0;
+	zc->completed = 0;
+}
+#endif
+
+#if defined(STRESS_SOCK_ZEROCOPY_RECEIVE)
+/*
+ *  stress_sock_zc_receive()
+ *	receive data with TCP_ZEROCOPY_RECEIVE, full pages are mapped
+ *	into the map region and the remaining bytes that cannot be
+ *	mapped are copied into buf, returns bytes received, 0 on
+ *	end of file and -1 on error
+ */
+static ssize_t stress_sock_zc_receive(
+	const int fd,
+	void *map,
+	const size_t map_len,
+	char *buf,
+	stress_sock_zc_rx_t *zc_rx)
+{
+	stress_tcp_zerocopy_receive_t zc;
+	socklen_t zc_len = sizeof(zc);
+	ssize_t n = 0;
+
+	(void)shim_memset(&zc, 0, sizeof(zc));
+	zc.address = (uint64_t)(uintptr_t)map;
+	zc.length = (uint32_t)map_len;
+	zc.copybuf_address = (uint64_t)(uintptr_t)buf;
+	zc.copybuf_len = MMAP_IO_SIZE;
+
+	if (UNLIKELY(getsockopt(fd, IPPROTO_TCP, TCP_ZEROCOPY_RECEIVE, &zc, &zc_len) < 0))
+		return -1;
+	if (zc.length > 0) {
+		const volatile uint8_t *ptr = (const volatile uint8_t *)map;
+		const uint8_t *end = (const uint8_t *)map + zc.length;
+
+		/* touch the mapped data, the next call unmaps it */
+		while (ptr < end) {
+			(void)*ptr;
+			ptr += 4096;
+		}
+		zc_rx->zc_bytes += zc.length;
+		n += (ssize_t)zc.length;
+	}
+	/* older kernels do not support the copy buffer */
+	if ((zc_len >= (socklen_t)(offsetof(stress_tcp_zerocopy_receive_t, copybuf_len) +
+				   sizeof(zc.copybuf_len))) && (zc.copybuf_len > 0)) {
+		zc_rx->copied_bytes += (uint64_t)zc.copybuf_len;
+		n += (ssize_t)zc.copybuf_len;
+	}
+	if ((n == 0) || (zc.recv_skip_hint > 0)) {
+		const size_t len = (zc.recv_skip_hint > 0) ?
+			STRESS_MINIMUM((size_t)zc.recv_skip_hint, (size_t)MMAP_IO_SIZE) : MMAP_IO_SIZE;
+		const ssize_t ret = recv(fd, buf, len, 0);
+
+		if (ret < 0)
+			return (n > 0) ? n : -1;
+		zc_rx->copied_bytes += (uint64_t)ret;
+		n += ret;
+	}
+	return n;
+}
+#endif
+
 /*
  *  stress_sock_client()
  *	client reader
@@ -488,11 +768,21 @@ static int OPTIMIZE3 stress_sock_client(
 	size_t n_ctrls;
 	char **ctrls;
 	int recvflag = 0, rc = EXIT_FAILURE;
-	uint64_t inq_bytes = 0, inq_samples = 0;
+	uint64_t inq_bytes = 0, inq_samples = 0, rx_bytes = 0;
 	uint32_t count = 0;
+	double cpu_start, cpu_duration, metric;
+#if defined(STRESS_SOCK_ZEROCOPY_RECEIVE)
+	stress_sock_zc_rx_t zc_rx;
+	bool zc_rx_enabled = sock_zerocopy &&
+		((sock_domain == AF_INET) || (sock_domain == AF_INET6)) &&
+		(sock_type == SOCK_STREAM) && (sock_protocol == IPPROTO_TCP);
+
+	(void)shim_memset(&zc_rx, 0, sizeof(zc_rx));
+#endif
 
 	stress_parent_died_alarm();
 	(void)sched_settings_apply(true);
+	cpu_start = stress_sock_cpu_time();
 
 	ctrls = stress_get_congestion_controls(sock_domain, &n_ctrls);
 
@@ -501,7 +791,10 @@ static int OPTIMIZE3 stress_sock_client(
 		int fd;
 		int retries = 0;
 		socklen_t addr_len = 0;
-		double metric;
+		uint64_t t_lat;
+#if defined(STRESS_SOCK_ZEROCOPY_RECEIVE)
+		void *zc_map = MAP_FAILED;
+#endif
 
 retry:
 		if (UNLIKELY(!stress_continue_flag()))
@@ -554,6 +847,7 @@ retry:
 			(void)close(fd);
 			goto free_controls;
 		}
+		t_lat = stress_latency_begin(args);
 		if (UNLIKELY(connect(fd, addr, addr_len) < 0)) {
 			const int errno_tmp = errno;
 
@@ -568,7 +862,25 @@ retry:
 			}
 			goto retry;
 		}
+		stress_latency_end(args, 1, t_lat);
 
+#if defined(STRESS_SOCK_ZEROCOPY_RECEIVE)
+		/*
+		 *  TCP_ZEROCOPY_RECEIVE maps received pages into a
+		 *  region mmap'd on the socket instead of copying them
+		 */
+		if (zc_rx_enabled) {
+			zc_map = mmap(NULL, SOCKET_ZEROCOPY_RX_MAP_SIZE, PROT_READ,
+				MAP_SHARED, fd, 0);
+			if (zc_map == MAP_FAILED) {
+				if (args->instance == 0)
+					pr_inf("%s: cannot mmap socket for TCP_ZEROCOPY_RECEIVE, "
+						"errno=%d (%s), using copying receives\n",
+						args->name, errno, strerror(errno));
+				zc_rx_enabled = false;
+			}
+		}
+#endif
 #if defined(TCP_CONGESTION)
 		/*
 		 *  Randomly set congestion control
@@ -800,6 +1112,17 @@ retry:
 			 *  Receive using equivalent receive method
 			 *  as the send
 			 */
+#if defined(STRESS_SOCK_ZEROCOPY_RECEIVE)
+			if (zc_map != MAP_FAILED) {
+				n = stress_sock_zc_receive(fd, zc_map,
+					SOCKET_ZEROCOPY_RX_MAP_SIZE, buf, &zc_rx);
+				if (UNLIKELY(n < 0) && (errno != EINTR) && (errno != ECONNRESET)) {
+					pr_fail("%s: getsockopt TCP_ZEROCOPY_RECEIVE failed, errno=%d (%s)\n",
+						args->name, errno, strerror(errno));
+					break;
+				}
+			} else
+#endif
 			switch (opt) {
 			case SOCKET_OPT_RECV:
 				n = recv(fd, buf, MMAP_IO_SIZE, recvflag);
@@ -843,6 +1166,7 @@ retry:
 				}
 				break;
 			}
+			rx_bytes += (uint64_t)n;
 			count++;
 		} while (stress_continue(args));
 
@@ -859,6 +1183,10 @@ retry:
 		}
 #endif
 
+#if defined(STRESS_SOCK_ZEROCOPY_RECEIVE)
+		if (zc_map != MAP_FAILED)
+			(void)munmap(zc_map, SOCKET_ZEROCOPY_RX_MAP_SIZE);
+#endif
 		(void)shutdown(fd, SHUT_RDWR);
 		(void)close(fd);
 		metric = (inq_samples > 0) ? (double)inq_bytes / (double)inq_samples : 0.0;
@@ -875,6 +1203,19 @@ retry:
 	}
 #endif
 
+	cpu_duration = stress_sock_cpu_time() - cpu_start;
+	metric = (cpu_duration > 0.0) ? (double)rx_bytes / cpu_duration / (double)GB : 0.0;
+	stress_metrics_set(args, 6, "receive GB per CPU second",
+		metric, STRESS_METRIC_HARMONIC_MEAN);
+#if defined(STRESS_SOCK_ZEROCOPY_RECEIVE)
+	if (zc_rx_enabled) {
+		stress_metrics_set(args, 7, "zero-copied MB received",
+			(double)zc_rx.zc_bytes / (double)MB, STRESS_METRIC_TOTAL);
+		stress_metrics_set(args, 8, "copied MB received",
+			(double)zc_rx.copied_bytes / (double)MB, STRESS_METRIC_TOTAL);
+	}
+#endif
+
 	rc = EXIT_SUCCESS;
 free_controls:
 	free(ctrls);
@@ -920,9 +1261,18 @@ static int OPTIMIZE3 stress_sock_server(
 	double t, duration, metric;
 	uint64_t outq_bytes = 0, outq_samples = 0;
 	size_t sock_msgs = DEFAULT_SOCKET_MSGS;
+	uint64_t tx_bytes = 0;
+	double cpu_start;
 #if defined(SIOCOUTQ)
 	uint32_t count = 0;
 #endif
+#if defined(STRESS_SOCK_ZEROCOPY)
+	stress_sock_zc_tx_t zc;
+
+	(void)shim_memset(&zc, 0, sizeof(zc));
+	zc.window = DEFAULT_SOCKET_ZEROCOPY_WINDOW;
+	(void)stress_get_setting("sock-zerocopy-window", &zc.window);
+#endif
 
 	if (!stress_get_setting("sock-msgs", &sock_msgs)) {
 		if (g_opt_flags & OPT_FLAGS_MAXIMIZE)
@@ -951,6 +1301,14 @@ static int OPTIMIZE3 stress_sock_server(
 		if (!warned) {
 			if (setsockopt(fd, SOL_SOCKET, SO_ZEROCOPY, &so_zerocopy, sizeof(so_zerocopy)) == 0) {
 				sendflag |= MSG_ZEROCOPY;
+#if defined(STRESS_SOCK_ZEROCOPY)
+				zc.lens = (uint32_t *)calloc(zc.window, sizeof(*zc.lens));
+				if (!zc.lens) {
+					pr_inf("%s: cannot allocate zero copy window, "
+						"disabling zerocopy\n", args->name);
+					sendflag &= ~MSG_ZEROCOPY;
+				}
+#endif
 			} else {
 				if (args->instance == 0) {
 					pr_inf("%s: cannot enable zerocopy on data being sent\n", args->name);
@@ -1021,6 +1379,7 @@ static int OPTIMIZE3 stress_sock_server(
 		(void)stress_madvise_mergeable(ptr, page_size);
 
 	t = stress_time_now();
+	cpu_start = stress_sock_cpu_time();
 	do {
 		int sfd;
 
@@ -1039,6 +1398,7 @@ static int OPTIMIZE3 stress_sock_server(
 #endif
 		if (LIKELY(sfd >= 0)) {
 			size_t i, j, k;
+			ssize_t ret;
 			struct sockaddr saddr;
 			socklen_t len;
 			int sndbuf, opt;
@@ -1126,6 +1486,7 @@ static int OPTIMIZE3 stress_sock_server(
 
 			for (k = 0; LIKELY((k < sock_msgs) && stress_continue(args)); k++) {
 				int flag = sendflag;
+				const uint64_t t_lat = stress_latency_begin(args);
 
 				if (UNLIKELY(sock_opts == SOCKET_OPT_RANDOM))
 					opt = stress_mwc8modn(3);
@@ -1134,9 +1495,17 @@ static int OPTIMIZE3 stress_sock_server(
 				case SOCKET_OPT_SEND:
 					for (i = 16; i < MMAP_IO_SIZE; i += 16) {
 retry_send:
-						if (UNLIKELY(send(sfd, buf, i, flag) < 0)) {
+						ret = send(sfd, buf, i, flag);
+						if (UNLIKELY(ret < 0)) {
 							if (errno == ENOBUFS) {
+#if defined(STRESS_SOCK_ZEROCOPY)
+								if (zc.lens)
+									stress_sock_zc_enobufs(sfd, &zc, &flag);
+								else
+									flag = 0;
+#else
 								flag = 0;
+#endif
 								goto retry_send;
 							}
 							if (stress_send_error(errno)) {
@@ -1146,6 +1515,11 @@ retry_send:
 							break;
 						} else {
 							msgs++;
+							tx_bytes += (uint64_t)ret;
+#if defined(STRESS_SOCK_ZEROCOPY)
+							if (zc.lens)
+								stress_sock_zc_sent(sfd, &zc, flag, (size_t)ret);
+#endif
 						}
 					}
 					break;
@@ -1158,9 +1532,17 @@ retry_send:
 					msg.msg_iov = vec;
 					msg.msg_iovlen = j;
 retry_sendmsg:
-					if (UNLIKELY(sendmsg(sfd, &msg, flag) < 0)) {
+					ret = sendmsg(sfd, &msg, flag);
+					if (UNLIKELY(ret < 0)) {
 						if (errno == ENOBUFS) {
+#if defined(STRESS_SOCK_ZEROCOPY)
+							if (zc.lens)
+								stress_sock_zc_enobufs(sfd, &zc, &flag);
+							else
+								flag = 0;
+#else
 							flag = 0;
+#endif
 							goto retry_sendmsg;
 						}
 						if (stress_send_error(errno)) {
@@ -1169,6 +1551,11 @@ retry_sendmsg:
 						}
 					} else {
 						msgs += j;
+						tx_bytes += (uint64_t)ret;
+#if defined(STRESS_SOCK_ZEROCOPY)
+						if (zc.lens)
+							stress_sock_zc_sent(sfd, &zc, flag, (size_t)ret);
+#endif
 					}
 					break;
 #if defined(HAVE_SENDMMSG)
@@ -1183,9 +1570,17 @@ retry_sendmsg:
 						msgvec[i].msg_hdr.msg_iovlen = j;
 					}
 retry_sendmmsg:
-					if (UNLIKELY(sendmmsg(sfd, msgvec, MSGVEC_SIZE, flag) < 0)) {
+					ret = sendmmsg(sfd, msgvec, MSGVEC_SIZE, flag);
+					if (UNLIKELY(ret < 0)) {
 						if (errno == ENOBUFS) {
+#if defined(STRESS_SOCK_ZEROCOPY)
+							if (zc.lens)
+								stress_sock_zc_enobufs(sfd, &zc, &flag);
+							else
+								flag = 0;
+#else
 							flag = 0;
+#endif
 							goto retry_sendmmsg;
 						}
 						if (stress_send_error(errno)) {
@@ -1194,6 +1589,13 @@ retry_sendmmsg:
 						}
 					} else {
 						msgs += (MSGVEC_SIZE * j);
+						for (i = 0; i < (size_t)ret; i++) {
+							tx_bytes += msgvec[i].msg_len;
+#if defined(STRESS_SOCK_ZEROCOPY)
+							if (zc.lens)
+								stress_sock_zc_sent(sfd, &zc, flag, (size_t)msgvec[i].msg_len);
+#endif
+						}
 					}
 					break;
 #endif
@@ -1203,6 +1605,7 @@ retry_sendmmsg:
 					(void)close(sfd);
 					goto die_close;
 				}
+				stress_latency_end(args, 0, t_lat);
 				stress_bogo_inc(args);
 			}
 			if (UNLIKELY(getpeername(sfd, &saddr, &len) < 0)) {
@@ -1224,6 +1627,10 @@ retry_sendmmsg:
 			stress_sock_ioctl(fd, sock_domain, rt);
 			stress_read_fdinfo(self, sfd);
 
+#if defined(STRESS_SOCK_ZEROCOPY)
+			if (zc.lens)
+				stress_sock_zc_drain(sfd, &zc);
+#endif
 			(void)close(sfd);
 		}
 
@@ -1244,10 +1651,25 @@ retry_sendmmsg:
 	metric = (outq_samples > 0) ? (double)outq_bytes / (double)outq_samples : 0.0;
 	stress_metrics_set(args, 1, "byte average out queue length",
 		metric, STRESS_METRIC_HARMONIC_MEAN);
+	duration = stress_sock_cpu_time() - cpu_start;
+	metric = (duration > 0.0) ? (double)tx_bytes / duration / (double)GB : 0.0;
+	stress_metrics_set(args, 3, "send GB per CPU second",
+		metric, STRESS_METRIC_HARMONIC_MEAN);
+#if defined(STRESS_SOCK_ZEROCOPY)
+	if (zc.lens) {
+		stress_metrics_set(args, 4, "zero-copied MB sent",
+			(double)zc.zc_bytes / (double)MB, STRESS_METRIC_TOTAL);
+		stress_metrics_set(args, 5, "copied MB sent",
+			(double)zc.copied_bytes / (double)MB, STRESS_METRIC_TOTAL);
+	}
+#endif
 
 die_close:
 	(void)close(fd);
 die:
+#if defined(STRESS_SOCK_ZEROCOPY)
+	free(zc.lens);
+#endif
 	if (ptr != MAP_FAILED)
 		(void)munmap(ptr, page_size);
 #if defined(AF_UNIX) &&		\
@@ -1263,123 +1685,1503 @@ die:
 	return rc;
 }
 
-static void stress_sock_sigpipe_handler(int signum)
+#if defined(HAVE_SYS_EPOLL_H) &&	\
+    defined(HAVE_EPOLL_CREATE1) &&	\
+    defined(SO_REUSEPORT) &&		\
+    defined(EPOLLIN) &&			\
+    defined(EPOLLOUT)
+#define STRESS_SOCK_REUSEPORT	(1)
+
+typedef struct {
+	int fd;			/* connection fd, -1 if not in use */
+	size_t tx;		/* bytes of current message sent */
+	size_t rx;		/* bytes of current message received */
+	uint64_t t_send;	/* time request was started, ns */
+	uint32_t requests;	/* round trips on this connection */
+	bool wait_out;		/* true if waiting on EPOLLOUT */
+} stress_sock_conn_t;
+
+/*
+ *  stress_sock_reuseport_send()
+ *	send the remainder of a size byte message on a non-blocking
+ *	connection, if the socket is full wait on EPOLLOUT for the
+ *	rest, returns -1 on error
+ */
+static int stress_sock_reuseport_send(
+	const int epfd,
+	stress_sock_conn_t *conn,
+	const char *buf,
+	const size_t size)
 {
-	(void)signum;
+	struct epoll_event ev;
+
+	while (conn->tx < size) {
+		const ssize_t ret = send(conn->fd, buf + conn->tx, size - conn->tx, MSG_NOSIGNAL);
+
+		if (UNLIKELY(ret < 0)) {
+			if (errno == EINTR)
+				continue;
+			if ((errno != EAGAIN) && (errno != EWOULDBLOCK))
+				return -1;
+			if (!conn->wait_out) {
+				(void)shim_memset(&ev, 0, sizeof(ev));
+				ev.events = EPOLLIN | EPOLLOUT;
+				ev.data.ptr = conn;
+				if (epoll_ctl(epfd, EPOLL_CTL_MOD, conn->fd, &ev) < 0)
+					return -1;
+				conn->wait_out = true;
+			}
+			return 0;
+		}
+		conn->tx += (size_t)ret;
+	}
+	if (conn->wait_out) {
+		(void)shim_memset(&ev, 0, sizeof(ev));
+		ev.events = EPOLLIN;
+		ev.data.ptr = conn;
+		if (epoll_ctl(epfd, EPOLL_CTL_MOD, conn->fd, &ev) < 0)
+			return -1;
+		conn->wait_out = false;
+	}
+	return 0;
+}
 
-	stress_continue_set_flag(false);
+/*
+ *  stress_sock_reuseport_recv()
+ *	receive the remainder of a size byte message on a non-blocking
+ *	connection, returns 1 when a full message has been received,
+ *	0 if more data is required and -1 on error or end of file
+ */
+static int stress_sock_reuseport_recv(
+	stress_sock_conn_t *conn,
+	char *buf,
+	const size_t size)
+{
+	while (conn->rx < size) {
+		const ssize_t ret = recv(conn->fd, buf + conn->rx, size - conn->rx, 0);
+
+		if (UNLIKELY(ret == 0))
+			return -1;
+		if (UNLIKELY(ret < 0)) {
+			if (errno == EINTR)
+				continue;
+			if ((errno == EAGAIN) || (errno == EWOULDBLOCK))
+				return 0;
+			return -1;
+		}
+		conn->rx += (size_t)ret;
+	}
+	conn->rx = 0;
+	return 1;
 }
 
 /*
- *  stress_sock_kernel_rt()
- * 	return true if kernel is PREEMPT_RT, true if
- * 	not sure, false if definitely not PREEMPT_RT.
+ *  stress_sock_reuseport_close()
+ *	remove a connection from epoll and close it
  */
-static bool stress_sock_kernel_rt(void)
+static void stress_sock_reuseport_close(const int epfd, stress_sock_conn_t *conn)
 {
-#if defined(HAVE_UNAME) &&	\
-    defined(HAVE_SYS_UTSNAME_H)
-	struct utsname buf;
+	(void)epoll_ctl(epfd, EPOLL_CTL_DEL, conn->fd, NULL);
+	(void)close(conn->fd);
+	conn->fd = -1;
+}
 
-	if (uname(&buf) < 0)
-		return true;	/* Not sure, assume rt */
+#if defined(SO_ATTACH_REUSEPORT_CBPF) &&	\
+    defined(HAVE_LINUX_FILTER_H) &&		\
+    defined(SKF_AD_CPU)
+/*
+ *  stress_sock_reuseport_cbpf()
+ *	attach a classic BPF program to the SO_REUSEPORT group that
+ *	steers new connections to listener (CPU % n_listeners)
+ */
+static int stress_sock_reuseport_cbpf(const int fd, const uint32_t n_listeners)
+{
+	struct sock_filter code[] = {
+		{ BPF_LD  | BPF_W | BPF_ABS, 0, 0, (uint32_t)(SKF_AD_OFF + SKF_AD_CPU) },
+		{ BPF_ALU | BPF_MOD | BPF_K, 0, 0, n_listeners },
+		{ BPF_RET | BPF_A, 0, 0, 0 },
+	};
+	struct sock_fprog prog;
 
-	if (strstr(buf.version, "PREEMPT_RT"))
-		return true;	/* Definitely rt */
+	prog.len = (unsigned short int)SIZEOF_ARRAY(code);
+	prog.filter = code;
 
-	/* probably not RT */
-	return false;
-#else
-	return true;		/* Not sure, assume rt */
-#endif
+	return setsockopt(fd, SOL_SOCKET, SO_ATTACH_REUSEPORT_CBPF, &prog, sizeof(prog));
 }
+#endif
 
 /*
- *  stress_sock
- *	stress by heavy socket I/O
+ *  stress_sock_reuseport_server()
+ *	epoll driven listener, accepts connections on its own
+ *	SO_REUSEPORT socket and echoes back size byte responses
+ *	for each size byte request
  */
-static int stress_sock(stress_args_t *args)
+static void NORETURN stress_sock_reuseport_server(
+	const int listen_fd,
+	const size_t n_conns,
+	const size_t size)
 {
-	pid_t pid, mypid = getpid();
-	size_t idx;
-	int sock_opts;
-	int sock_domain = AF_INET;
-	int sock_type;
-	int sock_port = DEFAULT_SOCKET_PORT;
-	int sock_protocol = 0;
-	int sock_zerocopy = false;
-	int rc = EXIT_SUCCESS, reserved_port, parent_cpu;
-	const bool rt = stress_sock_kernel_rt();
-	char *mmap_buffer;
-	char *sock_if = NULL;
+	struct epoll_event ev, events[SOCKET_REUSEPORT_EVENTS];
+	stress_sock_conn_t *conns, listener;
+	char buf[MAX_SOCKET_REUSEPORT_SIZE];
+	int epfd, flags;
+	size_t j;
 
-	if (stress_sigchld_set_handler(args) < 0)
-		return EXIT_NO_RESOURCE;
+	stress_parent_died_alarm();
+	(void)sched_settings_apply(true);
 
-	(void)stress_get_setting("sock-if", &sock_if);
-	(void)stress_get_setting("sock-domain", &sock_domain);
-	(void)stress_get_setting("sock-port", &sock_port);
-	(void)stress_get_setting("sock-zerocopy", &sock_zerocopy);
-	sock_opts = stress_get_setting("sock-opts", &idx) ?
-		sock_options_opts[idx].optval : SOCKET_OPT_SEND;
-#if defined(SOCK_STREAM)
-	sock_type = stress_get_setting("sock-type", &idx) ?
-		sock_options_types[idx].optval : SOCK_STREAM;
-#else
-	sock_type = stress_get_setting("sock-type", &idx) ?
-		sock_options_types[idx].optval : 1;
-#endif
-	sock_protocol = stress_get_setting("sock-protocol", &idx) ?
-		sock_options_protocols[idx].optval : IPPROTO_TCP;
+	/* accept until EAGAIN on each listener wakeup */
+	flags = fcntl(listen_fd, F_GETFL, 0);
+	if ((flags < 0) || (fcntl(listen_fd, F_SETFL, flags | O_NONBLOCK) < 0))
+		_exit(EXIT_NO_RESOURCE);
+
+	conns = (stress_sock_conn_t *)calloc(n_conns, sizeof(*conns));
+	if (!conns)
+		_exit(EXIT_NO_RESOURCE);
+	for (j = 0; j < n_conns; j++)
+		conns[j].fd = -1;
+	epfd = epoll_create1(0);
+	if (epfd < 0) {
+		free(conns);
+		_exit(EXIT_NO_RESOURCE);
+	}
+	(void)shim_memset(&listener, 0, sizeof(listener));
+	listener.fd = listen_fd;
+	(void)shim_memset(&ev, 0, sizeof(ev));
+	ev.events = EPOLLIN;
+	ev.data.ptr = &listener;
+	if (epoll_ctl(epfd, EPOLL_CTL_ADD, listen_fd, &ev) < 0) {
+		(void)close(epfd);
+		free(conns);
+		_exit(EXIT_NO_RESOURCE);
+	}
 
-#if !defined(MSG_ZEROCOPY)
-	if (sock_zerocopy)
-		pr_inf("sock: cannot enable sock-zerocopy, MSG_ZEROCOPY is not available\n");
-#endif
+	while (stress_continue_flag()) {
+		int i, n;
 
-	if (sock_if) {
-		int ret;
-		struct sockaddr if_addr;
+		n = epoll_wait(epfd, events, SOCKET_REUSEPORT_EVENTS, 100);
+		if (UNLIKELY(n < 0)) {
+			if (errno == EINTR)
+				continue;
+			break;
+		}
+		for (i = 0; i < n; i++) {
+			stress_sock_conn_t *conn = (stress_sock_conn_t *)events[i].data.ptr;
 
-		ret = stress_net_interface_exists(sock_if, sock_domain, &if_addr);
-		if (ret < 0) {
-			pr_inf("%s: interface '%s' is not enabled for domain '%s', defaulting to using loopback\n",
-				args->name, sock_if, stress_net_domain(sock_domain));
-			sock_if = NULL;
+			if (conn == &listener) {
+				j = 0;
+
+				for (;;) {
+					const int fd = accept4(listen_fd, NULL, NULL, SOCK_NONBLOCK);
+#if defined(TCP_NODELAY)
+					int one = 1;
+#endif
+
+					if (fd < 0)
+						break;
+					while ((j < n_conns) && (conns[j].fd >= 0))
+						j++;
+					if (j >= n_conns) {
+						(void)close(fd);
+						continue;
+					}
+#if defined(TCP_NODELAY)
+					(void)setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+#endif
+					(void)shim_memset(&conns[j], 0, sizeof(conns[j]));
+					conns[j].fd = fd;
+					ev.events = EPOLLIN;
+					ev.data.ptr = &conns[j];
+					if (epoll_ctl(epfd, EPOLL_CTL_ADD, fd, &ev) < 0) {
+						(void)close(fd);
+						conns[j].fd = -1;
+					}
+				}
+				continue;
+			}
+			if (events[i].events & EPOLLOUT) {
+				if (stress_sock_reuseport_send(epfd, conn, buf, size) < 0) {
+					stress_sock_reuseport_close(epfd, conn);
+					continue;
+				}
+			}
+			if (events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR)) {
+				int ret;
+
+				while ((ret = stress_sock_reuseport_recv(conn, buf, size)) > 0) {
+					conn->tx = 0;
+					if (stress_sock_reuseport_send(epfd, conn, buf, size) < 0) {
+						ret = -1;
+						break;
+					}
+				}
+				if (ret < 0)
+					stress_sock_reuseport_close(epfd, conn);
+			}
 		}
 	}
-	sock_port += args->instance;
-	if (sock_port > MAX_PORT)
-		sock_port -= (MAX_PORT- MIN_PORT + 1);
-	reserved_port = stress_net_reserve_ports(sock_port, sock_port);
-	if (reserved_port < 0) {
-		pr_inf_skip("%s: cannot reserve port %d, skipping stressor\n",
-			args->name, sock_port);
-		return EXIT_NO_RESOURCE;
-	}
-	sock_port = reserved_port;
+	(void)close(epfd);
+	free(conns);
+	_exit(EXIT_SUCCESS);
+}
 
-	pr_dbg("%s: process [%d] using socket port %d\n",
-		args->name, (int)args->pid, sock_port);
+#if defined(STRESS_IO_URING) &&		\
+    defined(__NR_io_uring_register) &&	\
+    defined(IORING_ACCEPT_MULTISHOT) &&	\
+    defined(IORING_RECV_MULTISHOT) &&	\
+    defined(IORING_CQE_F_MORE) &&	\
+    defined(IORING_CQE_F_NOTIF) &&	\
+    defined(IORING_CQE_F_BUFFER) &&	\
+    defined(IOSQE_BUFFER_SELECT) &&	\
+    defined(HAVE_IORING_OP_ACCEPT) &&	\
+    defined(HAVE_IORING_OP_RECV) &&	\
+    defined(HAVE_IORING_OP_SEND) &&	\
+    defined(HAVE_IORING_OP_SEND_ZC)
+#define STRESS_SOCK_IO_URING	(1)
+
+#define SOCKET_URING_ENTRIES	(256)	/* submission queue size */
+#define SOCKET_URING_BUFS	(128)	/* provided buffers, power of 2 */
+#define SOCKET_URING_BGID	(0)	/* provided buffer group id */
+
+/* these are enums in newer headers, so use the ABI values */
+#define STRESS_IORING_REGISTER_PBUF_RING	(22)
+#define STRESS_IORING_CQE_BUFFER_SHIFT		(16)
+
+/* user_data is the request type, connection generation and index */
+#define SOCKET_URING_ACCEPT	(1ULL)
+#define SOCKET_URING_RECV	(2ULL)
+#define SOCKET_URING_SEND	(3ULL)
+#define SOCKET_URING_DATA(type, gen, idx)	\
+	(((type) << 56) | ((uint64_t)(gen) << 32) | (uint64_t)(idx))
 
-	if (stress_sighandler(args->name, SIGPIPE, stress_sock_sigpipe_handler, NULL) < 0)
-		return EXIT_NO_RESOURCE;
+/*
+ *  io_uring server state, a single ring with a provided buffer
+ *  ring that multishot receives pick their buffers from
+ */
+typedef struct {
+	stress_io_uring_t ring;		/* io_uring rings */
+	unsigned int sq_local_tail;	/* tail including unsubmitted sqes */
+	bool ext_arg;			/* io_uring_enter timeouts supported */
+	struct io_uring_buf_ring *br;	/* provided buffer ring */
+	size_t br_size;
+	uint16_t br_tail;		/* provided buffer ring local tail */
+	char *bufs;			/* provided buffers */
+	size_t bufs_size;
+} stress_sock_uring_t;
 
-	mmap_buffer = (char *)stress_mmap_populate(NULL, MMAP_BUF_SIZE,
-				PROT_READ | PROT_WRITE,
-				MAP_ANONYMOUS | MAP_PRIVATE, -1, 0);
-	if (mmap_buffer == MAP_FAILED) {
-		pr_inf("%s: cannot mmap I/O buffer, errno=%d (%s)\n",
-			args->name, errno, strerror(errno));
-		return EXIT_NO_RESOURCE;
-	}
-	stress_set_vma_anon_name(mmap_buffer, MMAP_BUF_SIZE, "io-buffer");
+/*
+ *  io_uring server per connection state
+ */
+typedef struct {
+	int fd;			/* connection fd, -1 if not in use */
+	uint16_t gen;		/* generation, to discard stale completions */
+	bool sending;		/* a send is in flight */
+	size_t rx;		/* bytes of current request received */
+	size_t tx;		/* bytes of current response sent */
+	uint64_t pending;	/* responses still to be sent */
+} stress_sock_uring_conn_t;
 
-	stress_set_proc_state(args->name, STRESS_STATE_SYNC_WAIT);
-	stress_sync_start_wait(args);
-	stress_set_proc_state(args->name, STRESS_STATE_RUN);
-again:
-	parent_cpu = stress_get_cpu();
+/*
+ *  stress_sock_uring_deinit()
+ *	unmap the rings and buffers and close the io_uring
+ */
+static void stress_sock_uring_deinit(stress_sock_uring_t *ur)
+{
+	/* close the ring before unmapping the buffers it may reference */
+	stress_io_uring_deinit(&ur->ring);
+	if (ur->bufs)
+		(void)munmap((void *)ur->bufs, ur->bufs_size);
+	if (ur->br)
+		(void)munmap((void *)ur->br, ur->br_size);
+	ur->bufs = NULL;
+	ur->br = NULL;
+}
+
+/*
+ *  stress_sock_uring_buf_add()
+ *	hand provided buffer bid back to the kernel
+ */
+static inline void stress_sock_uring_buf_add(stress_sock_uring_t *ur, const uint16_t bid)
+{
+	struct io_uring_buf *buf = &ur->br->bufs[ur->br_tail & (SOCKET_URING_BUFS - 1)];
+
+	buf->addr = (uint64_t)(uintptr_t)(ur->bufs + ((size_t)bid * MMAP_IO_SIZE));
+	buf->len = MMAP_IO_SIZE;
+	buf->bid = bid;
+	ur->br_tail++;
+	stress_asm_mb();
+	ur->br->tail = ur->br_tail;
+}
+
+/*
+ *  stress_sock_uring_init()
+ *	create the io_uring, map the rings and register a ring of
+ *	provided receive buffers, returns 0 on success, -1 on failure
+ */
+static int stress_sock_uring_init(stress_sock_uring_t *ur)
+{
+	struct io_uring_buf_reg reg;
+	void *ptr;
+	uint16_t bid;
+
+	(void)shim_memset(ur, 0, sizeof(*ur));
+	if (stress_io_uring_init(&ur->ring, SOCKET_URING_ENTRIES) < 0)
+		return -1;
+	ur->sq_local_tail = *ur->ring.sq_tail;
+#if defined(IORING_FEAT_EXT_ARG) &&	\
+    defined(IORING_ENTER_EXT_ARG)
+	ur->ext_arg = !!(ur->ring.features & IORING_FEAT_EXT_ARG);
+#endif
+
+	/* the provided buffer ring must be page aligned, mmap guarantees this */
+	ur->br_size = SOCKET_URING_BUFS * sizeof(struct io_uring_buf);
+	ptr = mmap(NULL, ur->br_size, PROT_READ | PROT_WRITE,
+		MAP_PRIVATE | MAP_ANONYMOUS | MAP_POPULATE, -1, 0);
+	if (ptr == MAP_FAILED)
+		goto fail;
+	ur->br = (struct io_uring_buf_ring *)ptr;
+
+	ur->bufs_size = SOCKET_URING_BUFS * MMAP_IO_SIZE;
+	ptr = mmap(NULL, ur->bufs_size, PROT_READ | PROT_WRITE,
+		MAP_PRIVATE | MAP_ANONYMOUS | MAP_POPULATE, -1, 0);
+	if (ptr == MAP_FAILED)
+		goto fail;
+	ur->bufs = (char *)ptr;
+
+	(void)shim_memset(&reg, 0, sizeof(reg));
+	reg.ring_addr = (uint64_t)(uintptr_t)ur->br;
+	reg.ring_entries = SOCKET_URING_BUFS;
+	reg.bgid = SOCKET_URING_BGID;
+	if (shim_io_uring_register(ur->ring.fd, STRESS_IORING_REGISTER_PBUF_RING, &reg, 1) < 0)
+		goto fail;
+	for (bid = 0; bid < SOCKET_URING_BUFS; bid++)
+		stress_sock_uring_buf_add(ur, bid);
+	return 0;
+fail:
+	stress_sock_uring_deinit(ur);
+	return -1;
+}
+
+/*
+ *  stress_sock_uring_submit()
+ *	submit the queued sqes and optionally wait up to 100ms
+ *	for at least one completion
+ */
+static int stress_sock_uring_submit(stress_sock_uring_t *ur, const bool wait)
+{
+	const unsigned int to_submit = ur->sq_local_tail - *ur->ring.sq_tail;
+	unsigned int flags = wait ? IORING_ENTER_GETEVENTS : 0;
+	void *arg = NULL;
+	size_t argsz = 0;
+	int ret;
+#if defined(IORING_FEAT_EXT_ARG) &&	\
+    defined(IORING_ENTER_EXT_ARG)
+	struct __kernel_timespec ts;
+	struct io_uring_getevents_arg getevents_arg;
+
+	if (wait && ur->ext_arg) {
+		ts.tv_sec = 0;
+		ts.tv_nsec = 100000000;
+		(void)shim_memset(&getevents_arg, 0, sizeof(getevents_arg));
+		getevents_arg.ts = (uint64_t)(uintptr_t)&ts;
+		flags |= IORING_ENTER_EXT_ARG;
+		arg = &getevents_arg;
+		argsz = sizeof(getevents_arg);
+	}
+#endif
+	stress_asm_mb();
+	*ur->ring.sq_tail = ur->sq_local_tail;
+	stress_asm_mb();
+
+	ret = shim_io_uring_enter(ur->ring.fd, to_submit, wait ? 1 : 0, flags, arg, argsz);
+	if ((ret < 0) && ((errno == EINTR) || (errno == ETIME) ||
+			  (errno == EAGAIN) || (errno == EBUSY)))
+		return 0;
+	return ret;
+}
+
+/*
+ *  stress_sock_uring_sqe()
+ *	get a cleared sqe, submitting the queue first if it is full
+ */
+static struct io_uring_sqe *stress_sock_uring_sqe(stress_sock_uring_t *ur, const uint64_t user_data)
+{
+	struct io_uring_sqe *sqe;
+	unsigned int idx;
+
+	if ((ur->sq_local_tail - *ur->ring.sq_head) >= ur->ring.sq_entries) {
+		if (stress_sock_uring_submit(ur, false) < 0)
+			return NULL;
+		if ((ur->sq_local_tail - *ur->ring.sq_head) >= ur->ring.sq_entries)
+			return NULL;
+	}
+	idx = ur->sq_local_tail & *ur->ring.sq_mask;
+	sqe = &ur->ring.sqes[idx];
+	(void)shim_memset(sqe, 0, sizeof(*sqe));
+	sqe->user_data = user_data;
+	ur->ring.sq_array[idx] = idx;
+	ur->sq_local_tail++;
+	return sqe;
+}
+
+/*
+ *  stress_sock_uring_accept()
+ *	arm a multishot accept on the listening socket
+ */
+static int stress_sock_uring_accept(stress_sock_uring_t *ur, const int listen_fd)
+{
+	struct io_uring_sqe *sqe;
+
+	sqe = stress_sock_uring_sqe(ur, SOCKET_URING_DATA(SOCKET_URING_ACCEPT, 0, 0));
+	if (!sqe)
+		return -1;
+	sqe->opcode = IORING_OP_ACCEPT;
+	sqe->fd = listen_fd;
+	sqe->ioprio = IORING_ACCEPT_MULTISHOT;
+	return 0;
+}
+
+/*
+ *  stress_sock_uring_recv()
+ *	arm a multishot receive on connection idx that picks its
+ *	buffers from the provided buffer ring
+ */
+static int stress_sock_uring_recv(
+	stress_sock_uring_t *ur,
+	const stress_sock_uring_conn_t *conn,
+	const uint32_t idx)
+{
+	struct io_uring_sqe *sqe;
+
+	sqe = stress_sock_uring_sqe(ur, SOCKET_URING_DATA(SOCKET_URING_RECV, conn->gen, idx));
+	if (!sqe)
+		return -1;
+	sqe->opcode = IORING_OP_RECV;
+	sqe->fd = conn->fd;
+	sqe->ioprio = IORING_RECV_MULTISHOT;
+	sqe->flags = IOSQE_BUFFER_SELECT;
+	sqe->buf_group = SOCKET_URING_BGID;
+	return 0;
+}
+
+/*
+ *  stress_sock_uring_send()
+ *	send the rest of the response on connection idx, the
+ *	response buffer is never modified so zero copy sends
+ *	need not wait for their notifications to reuse it
+ */
+static int stress_sock_uring_send(
+	stress_sock_uring_t *ur,
+	stress_sock_uring_conn_t *conn,
+	const uint32_t idx,
+	const char *buf,
+	const size_t size,
+	const bool send_zc)
+{
+	struct io_uring_sqe *sqe;
+
+	sqe = stress_sock_uring_sqe(ur, SOCKET_URING_DATA(SOCKET_URING_SEND, conn->gen, idx));
+	if (!sqe)
+		return -1;
+	sqe->opcode = send_zc ? IORING_OP_SEND_ZC : IORING_OP_SEND;
+	sqe->fd = conn->fd;
+	sqe->addr = (uint64_t)(uintptr_t)(buf + conn->tx);
+	sqe->len = (uint32_t)(size - conn->tx);
+	sqe->msg_flags = MSG_NOSIGNAL;
+	conn->sending = true;
+	return 0;
+}
+
+/*
+ *  stress_sock_uring_close()
+ *	shutdown and close a connection, the shutdown terminates the
+ *	multishot receive that holds a reference to the socket
+ */
+static void stress_sock_uring_close(stress_sock_uring_conn_t *conn)
+{
+	(void)shutdown(conn->fd, SHUT_RDWR);
+	(void)close(conn->fd);
+	conn->fd = -1;
+}
+
+/*
+ *  stress_sock_uring_server()
+ *	io_uring driven listener, a multishot accept and a multishot
+ *	receive per connection using provided buffers, size byte
+ *	responses are sent with IORING_OP_SEND_ZC for each size byte
+ *	request, falling back to IORING_OP_SEND if it is not supported
+ */
+static void NORETURN stress_sock_uring_server(
+	const int listen_fd,
+	const size_t n_conns,
+	const size_t size)
+{
+	static char buf[MAX_SOCKET_REUSEPORT_SIZE];
+	stress_sock_uring_t ur;
+	stress_sock_uring_conn_t *conns;
+	bool send_zc = true;
+	int rc = EXIT_SUCCESS;
+	size_t j;
+
+	stress_parent_died_alarm();
+	(void)sched_settings_apply(true);
+
+	conns = (stress_sock_uring_conn_t *)calloc(n_conns, sizeof(*conns));
+	if (!conns)
+		_exit(EXIT_NO_RESOURCE);
+	for (j = 0; j < n_conns; j++)
+		conns[j].fd = -1;
+	if (stress_sock_uring_init(&ur) < 0) {
+		free(conns);
+		_exit(EXIT_NO_RESOURCE);
+	}
+	(void)shim_memset(buf, 'a', sizeof(buf));
+	if (stress_sock_uring_accept(&ur, listen_fd) < 0) {
+		rc = EXIT_NO_RESOURCE;
+		goto deinit;
+	}
+
+	while (stress_continue_flag()) {
+		unsigned int head, tail;
+
+		if (UNLIKELY(stress_sock_uring_submit(&ur, true) < 0)) {
+			rc = EXIT_FAILURE;
+			break;
+		}
+		head = *ur.ring.cq_head;
+		stress_asm_mb();
+		tail = *ur.ring.cq_tail;
+
+		for (; head != tail; head++) {
+			const struct io_uring_cqe *cqe = &ur.ring.cqes[head & *ur.ring.cq_mask];
+			const uint64_t type = cqe->user_data >> 56;
+			const uint16_t gen = (uint16_t)(cqe->user_data >> 32);
+			const uint32_t idx = (uint32_t)cqe->user_data;
+			const int res = cqe->res;
+			const uint32_t flags = cqe->flags;
+			stress_sock_uring_conn_t *conn = (idx < n_conns) ? &conns[idx] : NULL;
+
+			/* always recycle selected buffers, even for stale completions */
+			if (flags & IORING_CQE_F_BUFFER)
+				stress_sock_uring_buf_add(&ur, (uint16_t)(flags >> STRESS_IORING_CQE_BUFFER_SHIFT));
+
+			switch (type) {
+			case SOCKET_URING_ACCEPT:
+				if (res >= 0) {
+					for (j = 0; (j < n_conns) && (conns[j].fd >= 0); j++)
+						;
+					if (j >= n_conns) {
+						(void)close(res);
+					} else {
+#if defined(TCP_NODELAY)
+						int one = 1;
+
+						(void)setsockopt(res, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+#endif
+						conns[j].fd = res;
+						conns[j].gen++;
+						conns[j].sending = false;
+						conns[j].rx = 0;
+						conns[j].tx = 0;
+						conns[j].pending = 0;
+						if (stress_sock_uring_recv(&ur, &conns[j], (uint32_t)j) < 0)
+							stress_sock_uring_close(&conns[j]);
+					}
+				} else if (res == -EINVAL) {
+					/* multishot accept is not supported */
+					rc = EXIT_NO_RESOURCE;
+					goto deinit;
+				}
+				if (!(flags & IORING_CQE_F_MORE)) {
+					if (stress_sock_uring_accept(&ur, listen_fd) < 0) {
+						rc = EXIT_FAILURE;
+						goto deinit;
+					}
+				}
+				break;
+			case SOCKET_URING_RECV:
+				if (!conn || (conn->fd < 0) || (conn->gen != gen))
+					break;
+				if (res > 0) {
+					conn->rx += (size_t)res;
+					while (conn->rx >= size) {
+						conn->rx -= size;
+						conn->pending++;
+					}
+					if (!conn->sending && conn->pending) {
+						conn->tx = 0;
+						if (stress_sock_uring_send(&ur, conn, idx, buf, size, send_zc) < 0) {
+							stress_sock_uring_close(conn);
+							break;
+						}
+					}
+					if (flags & IORING_CQE_F_MORE)
+						break;
+				} else if (res != -ENOBUFS) {
+					/* end of file or error */
+					stress_sock_uring_close(conn);
+					break;
+				}
+				/* multishot receive terminated, re-arm it */
+				if (stress_sock_uring_recv(&ur, conn, idx) < 0)
+					stress_sock_uring_close(conn);
+				break;
+			case SOCKET_URING_SEND:
+				if (!conn || (conn->fd < 0) || (conn->gen != gen))
+					break;
+				/* zero copy completion notification, buffer is static */
+				if (flags & IORING_CQE_F_NOTIF)
+					break;
+				if (res < 0) {
+					if (send_zc && ((res == -EINVAL) || (res == -EOPNOTSUPP))) {
+						send_zc = false;
+						if (stress_sock_uring_send(&ur, conn, idx, buf, size, send_zc) == 0)
+							break;
+					}
+					stress_sock_uring_close(conn);
+					break;
+				}
+				conn->tx += (size_t)res;
+				if (conn->tx >= size) {
+					conn->tx = 0;
+					conn->pending--;
+					if (!conn->pending) {
+						conn->sending = false;
+						break;
+					}
+				}
+				if (stress_sock_uring_send(&ur, conn, idx, buf, size, send_zc) < 0)
+					stress_sock_uring_close(conn);
+				break;
+			default:
+				break;
+			}
+		}
+		stress_asm_mb();
+		*ur.ring.cq_head = head;
+	}
+deinit:
+	for (j = 0; j < n_conns; j++) {
+		if (conns[j].fd >= 0)
+			(void)close(conns[j].fd);
+	}
+	stress_sock_uring_deinit(&ur);
+	free(conns);
+	_exit(rc);
+}
+
+/*
+ *  stress_sock_uring_supported()
+ *	check the io_uring engine can be set up before
+ *	forking the listener processes
+ */
+static bool stress_sock_uring_supported(void)
+{
+	stress_sock_uring_t ur;
+
+	if (stress_sock_uring_init(&ur) < 0)
+		return false;
+	stress_sock_uring_deinit(&ur);
+	return true;
+}
+#endif
+
+/*
+ *  stress_sock_reuseport_connect()
+ *	open a non-blocking connection for conn and send the
+ *	first request on it, returns -1 on failure
+ */
+static int stress_sock_reuseport_connect(
+	const int epfd,
+	stress_sock_conn_t *conn,
+	const int sock_domain,
+	const int sock_protocol,
+	const struct sockaddr *addr,
+	const socklen_t addr_len,
+	const char *buf,
+	const size_t size)
+{
+	struct epoll_event ev;
+	int fd, flags;
+#if defined(TCP_NODELAY)
+	int one = 1;
+#endif
+
+	fd = socket(sock_domain, SOCK_STREAM, sock_protocol);
+	if (fd < 0)
+		return -1;
+	if (connect(fd, addr, addr_len) < 0)
+		goto close_fd;
+#if defined(TCP_NODELAY)
+	(void)setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+#endif
+	flags = fcntl(fd, F_GETFL, 0);
+	if ((flags < 0) || (fcntl(fd, F_SETFL, flags | O_NONBLOCK) < 0))
+		goto close_fd;
+	(void)shim_memset(&ev, 0, sizeof(ev));
+	ev.events = EPOLLIN;
+	ev.data.ptr = conn;
+	if (epoll_ctl(epfd, EPOLL_CTL_ADD, fd, &ev) < 0)
+		goto close_fd;
+	(void)shim_memset(conn, 0, sizeof(*conn));
+	conn->fd = fd;
+	conn->t_send = stress_latency_now();
+	if (stress_sock_reuseport_send(epfd, conn, buf, size) == 0)
+		return 0;
+	(void)epoll_ctl(epfd, EPOLL_CTL_DEL, fd, NULL);
+	conn->fd = -1;
+close_fd:
+	(void)close(fd);
+	return -1;
+}
+
+/*
+ *  stress_sock_reuseport()
+ *	--sock-reuseport mode, N SO_REUSEPORT listeners on the same
+ *	port each served by an epoll process, the stressor drives
+ *	many concurrent connections with closed loop fixed size
+ *	request/response exchanges measuring the round-trip latency
+ */
+static int stress_sock_reuseport(
+	stress_args_t *args,
+	char *buf,
+	const pid_t mypid,
+	int sock_domain,
+	const int sock_protocol,
+	const int sock_port,
+	const char *sock_if)
+{
+	uint32_t sock_reuseport = 1;
+	size_t sock_reuseport_conns = DEFAULT_SOCKET_REUSEPORT_CONNS;
+	size_t sock_reuseport_size = DEFAULT_SOCKET_REUSEPORT_SIZE;
+	size_t sock_engine = SOCKET_ENGINE_EPOLL;
+	bool sock_reuseport_cbpf = false, churn;
+	struct epoll_event events[SOCKET_REUSEPORT_EVENTS];
+	struct sockaddr *addr = NULL;
+	socklen_t addr_len = 0;
+	stress_sock_conn_t *conns = NULL;
+	stress_latency_hist_t *hist;
+	int *listen_fds;
+	pid_t *pids;
+	int epfd = -1, rc = EXIT_SUCCESS;
+	uint32_t i, n_listeners = 0, n_pids = 0;
+	size_t j, active = 0, server_conns;
+	uint64_t requests = 0, connections = 0;
+	double t_start, duration, rate;
+
+	/* an explicit engine compares engines with connection churn */
+	churn = stress_get_setting("sock-engine", &sock_engine);
+	(void)stress_get_setting("sock-reuseport", &sock_reuseport);
+	(void)stress_get_setting("sock-reuseport-cbpf", &sock_reuseport_cbpf);
+	if (!stress_get_setting("sock-reuseport-conns", &sock_reuseport_conns)) {
+		if (g_opt_flags & OPT_FLAGS_MAXIMIZE)
+			sock_reuseport_conns = MAX_SOCKET_REUSEPORT_CONNS;
+		if (g_opt_flags & OPT_FLAGS_MINIMIZE)
+			sock_reuseport_conns = MIN_SOCKET_REUSEPORT_CONNS;
+	}
+	(void)stress_get_setting("sock-reuseport-size", &sock_reuseport_size);
+
+	if ((sock_domain != AF_INET) && (sock_domain != AF_INET6)) {
+		if (args->instance == 0)
+			pr_inf("%s: --sock-reuseport requires an ipv4 or ipv6 domain, using ipv4\n",
+				args->name);
+		sock_domain = AF_INET;
+	}
+
+	if (sock_engine == SOCKET_ENGINE_IO_URING) {
+#if defined(STRESS_SOCK_IO_URING)
+		if (!stress_sock_uring_supported()) {
+			if (args->instance == 0)
+				pr_inf_skip("%s: cannot set up io-uring with multishot receive "
+					"provided buffers, errno=%d (%s), skipping stressor\n",
+					args->name, errno, strerror(errno));
+			return EXIT_NOT_IMPLEMENTED;
+		}
+#else
+		if (args->instance == 0)
+			pr_inf_skip("%s: io-uring engine is not supported, skipping stressor\n",
+				args->name);
+		return EXIT_NOT_IMPLEMENTED;
+#endif
+	}
+
+	listen_fds = (int *)calloc(sock_reuseport, sizeof(*listen_fds));
+	pids = (pid_t *)calloc(sock_reuseport, sizeof(*pids));
+	hist = (stress_latency_hist_t *)malloc(sizeof(*hist));
+	if (!listen_fds || !pids || !hist) {
+		pr_inf_skip("%s: cannot allocate listener state, skipping stressor\n", args->name);
+		rc = EXIT_NO_RESOURCE;
+		goto free_state;
+	}
+	stress_latency_hist_init(hist);
+
+	if (stress_set_sockaddr_if(args->name, args->instance, mypid,
+			sock_domain, sock_port, sock_if,
+			&addr, &addr_len, NET_ADDR_ANY) < 0) {
+		rc = EXIT_FAILURE;
+		goto free_state;
+	}
+
+	/*
+	 *  Bind all the listeners in the parent so the SO_REUSEPORT
+	 *  group index of listener i is i, this is required for the
+	 *  CPU steering program to select the intended listener
+	 */
+	for (i = 0; i < sock_reuseport; i++) {
+		int fd, one = 1;
+
+		fd = socket(sock_domain, SOCK_STREAM, sock_protocol);
+		if (fd < 0) {
+			rc = stress_exit_status(errno);
+			pr_fail("%s: socket failed, errno=%d (%s)\n",
+				args->name, errno, strerror(errno));
+			goto close_listeners;
+		}
+		listen_fds[n_listeners++] = fd;
+		if ((setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one)) < 0) ||
+		    (setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &one, sizeof(one)) < 0)) {
+			pr_fail("%s: setsockopt failed, errno=%d (%s)\n",
+				args->name, errno, strerror(errno));
+			rc = EXIT_FAILURE;
+			goto close_listeners;
+		}
+		if (bind(fd, addr, addr_len) < 0) {
+			rc = stress_exit_status(errno);
+			pr_fail("%s: bind failed, errno=%d (%s)\n",
+				args->name, errno, strerror(errno));
+			goto close_listeners;
+		}
+		if (listen(fd, (int)STRESS_MINIMUM(sock_reuseport_conns, 65535)) < 0) {
+			rc = stress_exit_status(errno);
+			pr_fail("%s: listen failed, errno=%d (%s)\n",
+				args->name, errno, strerror(errno));
+			goto close_listeners;
+		}
+	}
+
+	if (sock_reuseport_cbpf) {
+#if defined(SO_ATTACH_REUSEPORT_CBPF) &&	\
+    defined(HAVE_LINUX_FILTER_H) &&		\
+    defined(SKF_AD_CPU)
+		if (stress_sock_reuseport_cbpf(listen_fds[0], n_listeners) < 0) {
+			if (args->instance == 0)
+				pr_inf("%s: cannot attach SO_REUSEPORT CPU steering program, errno=%d (%s), "
+					"using default hashing\n", args->name, errno, strerror(errno));
+			sock_reuseport_cbpf = false;
+		}
+#else
+		if (args->instance == 0)
+			pr_inf("%s: SO_ATTACH_REUSEPORT_CBPF is not available, using default hashing\n",
+				args->name);
+		sock_reuseport_cbpf = false;
+#endif
+	}
+
+	/*
+	 *  with connection churn a listener may accept a new connection
+	 *  before it has seen the old one close, so allow for both
+	 */
+	server_conns = churn ? sock_reuseport_conns * 2 : sock_reuseport_conns;
+	for (i = 0; i < n_listeners; i++) {
+		pids[i] = fork();
+		if (pids[i] < 0) {
+			rc = stress_exit_status(errno);
+			pr_fail("%s: fork failed, errno=%d (%s)\n",
+				args->name, errno, strerror(errno));
+			goto reap;
+		} else if (pids[i] == 0) {
+			uint32_t k;
+
+			for (k = 0; k < n_listeners; k++) {
+				if (k != i)
+					(void)close(listen_fds[k]);
+			}
+#if defined(HAVE_SCHED_SETAFFINITY) &&	\
+    defined(HAVE_CPU_SET_T)
+			/* pin listener i to CPU i to match the steering program */
+			if (sock_reuseport_cbpf && (i < CPU_SETSIZE)) {
+				cpu_set_t set;
+
+				CPU_ZERO(&set);
+				CPU_SET((int)i, &set);
+				(void)sched_setaffinity(0, sizeof(set), &set);
+			}
+#endif
+#if defined(STRESS_SOCK_IO_URING)
+			if (sock_engine == SOCKET_ENGINE_IO_URING)
+				stress_sock_uring_server(listen_fds[i],
+					server_conns, sock_reuseport_size);
+#endif
+			stress_sock_reuseport_server(listen_fds[i],
+				server_conns, sock_reuseport_size);
+		}
+		n_pids++;
+	}
+
+	conns = (stress_sock_conn_t *)calloc(sock_reuseport_conns, sizeof(*conns));
+	if (!conns) {
+		pr_inf_skip("%s: cannot allocate %zu connections, skipping stressor\n",
+			args->name, sock_reuseport_conns);
+		rc = EXIT_NO_RESOURCE;
+		goto reap;
+	}
+	for (j = 0; j < sock_reuseport_conns; j++)
+		conns[j].fd = -1;
+
+	epfd = epoll_create1(0);
+	if (epfd < 0) {
+		rc = stress_exit_status(errno);
+		pr_fail("%s: epoll_create1 failed, errno=%d (%s)\n",
+			args->name, errno, strerror(errno));
+		goto reap;
+	}
+
+	(void)shim_memset(buf, 'A' + (args->instance % 26), sock_reuseport_size);
+	t_start = stress_time_now();
+	for (j = 0; stress_continue_flag() && (j < sock_reuseport_conns); j++) {
+		if (stress_sock_reuseport_connect(epfd, &conns[j], sock_domain, sock_protocol,
+				addr, addr_len, buf, sock_reuseport_size) < 0) {
+			if (active == 0) {
+				rc = stress_exit_status(errno);
+				pr_fail("%s: connect failed, errno=%d (%s)\n",
+					args->name, errno, strerror(errno));
+				goto reap;
+			}
+			break;
+		}
+		active++;
+		connections++;
+	}
+	if (active < sock_reuseport_conns)
+		pr_dbg("%s: only %zu of %zu connections established\n",
+			args->name, active, sock_reuseport_conns);
+
+	if (!churn)
+		t_start = stress_time_now();
+	while (stress_continue(args) && (active > 0)) {
+		int k, n;
+
+		n = epoll_wait(epfd, events, SOCKET_REUSEPORT_EVENTS, 100);
+		if (UNLIKELY(n < 0)) {
+			if (errno == EINTR)
+				continue;
+			pr_fail("%s: epoll_wait failed, errno=%d (%s)\n",
+				args->name, errno, strerror(errno));
+			rc = EXIT_FAILURE;
+			break;
+		}
+		for (k = 0; k < n; k++) {
+			stress_sock_conn_t *conn = (stress_sock_conn_t *)events[k].data.ptr;
+			int ret;
+
+			if (events[k].events & EPOLLOUT) {
+				if (stress_sock_reuseport_send(epfd, conn, buf, sock_reuseport_size) < 0) {
+					stress_sock_reuseport_close(epfd, conn);
+					active--;
+					continue;
+				}
+			}
+			if (!(events[k].events & (EPOLLIN | EPOLLHUP | EPOLLERR)))
+				continue;
+			ret = stress_sock_reuseport_recv(conn, buf + MMAP_IO_SIZE, sock_reuseport_size);
+			if (ret > 0) {
+				const uint64_t now = stress_latency_now();
+				const uint64_t rtt = now - conn->t_send;
+
+				stress_latency_hist_record(hist, rtt);
+				stress_latency_record(args, 0, rtt);
+				requests++;
+				stress_bogo_inc(args);
+
+				conn->tx = 0;
+				conn->t_send = now;
+				if (churn && (++conn->requests >= SOCKET_ENGINE_CONN_REQUESTS)) {
+					stress_sock_reuseport_close(epfd, conn);
+					if (stress_sock_reuseport_connect(epfd, conn, sock_domain, sock_protocol,
+							addr, addr_len, buf, sock_reuseport_size) < 0) {
+						active--;
+						continue;
+					}
+					connections++;
+					continue;
+				}
+				ret = stress_sock_reuseport_send(epfd, conn, buf, sock_reuseport_size);
+			}
+			if (ret < 0) {
+				stress_sock_reuseport_close(epfd, conn);
+				active--;
+			}
+		}
+	}
+	duration = stress_time_now() - t_start;
+
+	if (stress_continue_flag() && (active == 0) && (rc == EXIT_SUCCESS)) {
+		pr_fail("%s: all connections to the SO_REUSEPORT listeners were closed\n",
+			args->name);
+		rc = EXIT_FAILURE;
+	}
+
+	rate = (duration > 0.0) ? (double)requests / duration : 0.0;
+	stress_metrics_set(args, 0, "requests per sec",
+		rate, STRESS_METRIC_HARMONIC_MEAN);
+	stress_metrics_set(args, 1, "round-trip p50 latency (usec)",
+		(double)stress_latency_hist_percentile(hist, 50.0) / 1000.0,
+		STRESS_METRIC_GEOMETRIC_MEAN);
+	stress_metrics_set(args, 2, "round-trip p99 latency (usec)",
+		(double)stress_latency_hist_percentile(hist, 99.0) / 1000.0,
+		STRESS_METRIC_GEOMETRIC_MEAN);
+	stress_metrics_set(args, 3, "round-trip p99.9 latency (usec)",
+		(double)stress_latency_hist_percentile(hist, 99.9) / 1000.0,
+		STRESS_METRIC_GEOMETRIC_MEAN);
+	stress_metrics_set(args, 4, "concurrent connections",
+		(double)active, STRESS_METRIC_TOTAL);
+	stress_metrics_set(args, 5, "SO_REUSEPORT listeners",
+		(double)n_listeners, STRESS_METRIC_GEOMETRIC_MEAN);
+	if (churn) {
+		rate = (duration > 0.0) ? (double)connections / duration : 0.0;
+		stress_metrics_set(args, 6, "connections per sec",
+			rate, STRESS_METRIC_HARMONIC_MEAN);
+	}
+
+reap:
+	if (conns) {
+		for (j = 0; j < sock_reuseport_conns; j++) {
+			if (conns[j].fd >= 0)
+				(void)close(conns[j].fd);
+		}
+		free(conns);
+	}
+	if (epfd >= 0)
+		(void)close(epfd);
+	for (i = 0; i < n_pids; i++)
+		(void)stress_kill_and_wait(args, pids[i], SIGALRM, true);
+close_listeners:
+	for (i = 0; i < n_listeners; i++)
+		(void)close(listen_fds[i]);
+free_state:
+	free(hist);
+	free(pids);
+	free(listen_fds);
+
+	return rc;
+}
+#endif
+
+/*
+ *  stress_sock_rr_cpu()
+ *	fetch a --sock-rr CPU pinning setting, -1 if not
+ *	set or not a configured CPU
+ */
+static int32_t stress_sock_rr_cpu(stress_args_t *args, const char *opt)
+{
+	int32_t cpu = -1;
+	const int32_t cpus = stress_get_processors_configured();
+
+	if (!stress_get_setting(opt, &cpu))
+		return -1;
+	if ((cpus > 0) && (cpu >= cpus)) {
+		if (args->instance == 0)
+			pr_inf("%s: --%s %" PRId32 " is not a configured CPU, not pinning\n",
+				args->name, opt, cpu);
+		return -1;
+	}
+	return cpu;
+}
+
+/*
+ *  stress_sock_rr_xfer()
+ *	send or receive exactly size bytes, returns -1 on error
+ *	or end of file, retries on timeouts while the stressor runs
+ */
+static int stress_sock_rr_xfer(
+	const int fd,
+	char *buf,
+	const size_t size,
+	const bool tx)
+{
+	size_t n = 0;
+
+	while (n < size) {
+		const ssize_t ret = tx ?
+			send(fd, buf + n, size - n, MSG_NOSIGNAL) :
+			recv(fd, buf + n, size - n, 0);
+
+		if (UNLIKELY(ret == 0))
+			return -1;
+		if (UNLIKELY(ret < 0)) {
+			if ((errno == EINTR) || (errno == EAGAIN) || (errno == EWOULDBLOCK)) {
+				if (!stress_continue_flag())
+					return -1;
+				continue;
+			}
+			return -1;
+		}
+		n += (size_t)ret;
+	}
+	return 0;
+}
+
+/*
+ *  stress_sock_rr_server()
+ *	echo size byte responses to size byte requests,
+ *	one connection at a time
+ */
+static void NORETURN stress_sock_rr_server(
+	const int listen_fd,
+	char *buf,
+	const size_t size,
+	const int32_t cpu)
+{
+	struct timeval tv;
+
+	stress_parent_died_alarm();
+	(void)sched_settings_apply(true);
+	stress_placement_set(cpu);
+
+	/* wake up periodically to check if the stressor has finished */
+	tv.tv_sec = 0;
+	tv.tv_usec = 100000;
+	(void)setsockopt(listen_fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+
+	while (stress_continue_flag()) {
+		const int fd = accept(listen_fd, NULL, NULL);
+#if defined(TCP_NODELAY)
+		int one = 1;
+#endif
+
+		if (fd < 0)
+			continue;
+#if defined(TCP_NODELAY)
+		(void)setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+#endif
+		(void)setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+		while (stress_continue_flag()) {
+			if (stress_sock_rr_xfer(fd, buf, size, false) < 0)
+				break;
+			if (stress_sock_rr_xfer(fd, buf, size, true) < 0)
+				break;
+		}
+		(void)close(fd);
+	}
+	_exit(EXIT_SUCCESS);
+}
+
+/*
+ *  stress_sock_rr()
+ *	--sock-rr mode, a TCP_RR style ping-pong of one size byte
+ *	request and response at a time on a single connection,
+ *	the round-trip latencies are recorded into a histogram
+ */
+static int stress_sock_rr(
+	stress_args_t *args,
+	char *buf,
+	const pid_t mypid,
+	const int sock_domain,
+	const int sock_type,
+	const int sock_protocol,
+	const int sock_port,
+	const char *sock_if,
+	const size_t size)
+{
+	const int32_t client_cpu = stress_sock_rr_cpu(args, "sock-rr-client-cpu");
+	const int32_t server_cpu = stress_sock_rr_cpu(args, "sock-rr-server-cpu");
+	struct sockaddr *addr = NULL;
+	socklen_t addr_len = 0;
+	stress_latency_hist_t *hist;
+	int listen_fd, fd = -1, one = 1, rc = EXIT_SUCCESS;
+	uint64_t transactions = 0;
+	double t_start, duration, rate;
+	char *rx_buf = buf + MAX_SOCKET_RR_SIZE;
+	pid_t pid;
+#if defined(AF_UNIX)
+	/* tcp and mptcp are not valid protocols for unix sockets */
+	const int protocol = (sock_domain == AF_UNIX) ? 0 : sock_protocol;
+#else
+	const int protocol = sock_protocol;
+#endif
+
+	hist = (stress_latency_hist_t *)malloc(sizeof(*hist));
+	if (!hist) {
+		pr_inf_skip("%s: cannot allocate latency histogram, skipping stressor\n", args->name);
+		return EXIT_NO_RESOURCE;
+	}
+	stress_latency_hist_init(hist);
+
+	if (stress_set_sockaddr_if(args->name, args->instance, mypid,
+			sock_domain, sock_port, sock_if,
+			&addr, &addr_len, NET_ADDR_ANY) < 0) {
+		free(hist);
+		return EXIT_FAILURE;
+	}
+	/* bind before forking so the client never races the server */
+	listen_fd = socket(sock_domain, sock_type, protocol);
+	if (listen_fd < 0) {
+		rc = stress_exit_status(errno);
+		pr_fail("%s: socket failed, errno=%d (%s)\n",
+			args->name, errno, strerror(errno));
+		goto free_hist;
+	}
+	(void)setsockopt(listen_fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+	if (bind(listen_fd, addr, addr_len) < 0) {
+		rc = stress_exit_status(errno);
+		pr_fail("%s: bind failed, errno=%d (%s)\n",
+			args->name, errno, strerror(errno));
+		goto close_listen;
+	}
+	if (listen(listen_fd, 8) < 0) {
+		rc = stress_exit_status(errno);
+		pr_fail("%s: listen failed, errno=%d (%s)\n",
+			args->name, errno, strerror(errno));
+		goto close_listen;
+	}
+
+again:
+	pid = fork();
+	if (pid < 0) {
+		if (stress_redo_fork(args, errno))
+			goto again;
+		rc = stress_exit_status(errno);
+		pr_fail("%s: fork failed, errno=%d (%s)\n",
+			args->name, errno, strerror(errno));
+		goto close_listen;
+	} else if (pid == 0) {
+		stress_sock_rr_server(listen_fd, rx_buf, size, server_cpu);
+	}
+	(void)close(listen_fd);
+	listen_fd = -1;
+	stress_placement_set(client_cpu);
+
+	(void)shim_memset(buf, 'A' + (args->instance % 26), size);
+	t_start = stress_time_now();
+	while (stress_continue(args)) {
+		uint64_t t;
+
+		if (fd < 0) {
+			struct timeval tv;
+
+			fd = socket(sock_domain, sock_type, protocol);
+			if (UNLIKELY(fd < 0)) {
+				rc = stress_exit_status(errno);
+				pr_fail("%s: socket failed, errno=%d (%s)\n",
+					args->name, errno, strerror(errno));
+				break;
+			}
+			if (UNLIKELY(connect(fd, addr, addr_len) < 0)) {
+				rc = stress_exit_status(errno);
+				pr_fail("%s: connect failed, errno=%d (%s)\n",
+					args->name, errno, strerror(errno));
+				break;
+			}
+#if defined(TCP_NODELAY)
+			if ((sock_domain == AF_INET) || (sock_domain == AF_INET6))
+				(void)setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+#endif
+			tv.tv_sec = 0;
+			tv.tv_usec = 100000;
+			(void)setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+		}
+
+		t = stress_latency_now();
+		if (UNLIKELY((stress_sock_rr_xfer(fd, buf, size, true) < 0) ||
+			     (stress_sock_rr_xfer(fd, rx_buf, size, false) < 0))) {
+			/* reconnect if the server dropped the connection */
+			(void)close(fd);
+			fd = -1;
+			continue;
+		}
+		t = stress_latency_now() - t;
+		stress_latency_hist_record(hist, t);
+		stress_latency_record(args, 0, t);
+		transactions++;
+		stress_bogo_inc(args);
+	}
+	duration = stress_time_now() - t_start;
+
+	rate = (duration > 0.0) ? (double)transactions / duration : 0.0;
+	stress_metrics_set(args, 0, "transactions per sec",
+		rate, STRESS_METRIC_HARMONIC_MEAN);
+	stress_metrics_set(args, 1, "round-trip mean latency (usec)",
+		stress_latency_hist_mean(hist) / 1000.0, STRESS_METRIC_GEOMETRIC_MEAN);
+	stress_metrics_set(args, 2, "round-trip p50 latency (usec)",
+		(double)stress_latency_hist_percentile(hist, 50.0) / 1000.0,
+		STRESS_METRIC_GEOMETRIC_MEAN);
+	stress_metrics_set(args, 3, "round-trip p90 latency (usec)",
+		(double)stress_latency_hist_percentile(hist, 90.0) / 1000.0,
+		STRESS_METRIC_GEOMETRIC_MEAN);
+	stress_metrics_set(args, 4, "round-trip p99 latency (usec)",
+		(double)stress_latency_hist_percentile(hist, 99.0) / 1000.0,
+		STRESS_METRIC_GEOMETRIC_MEAN);
+	stress_metrics_set(args, 5, "round-trip p99.9 latency (usec)",
+		(double)stress_latency_hist_percentile(hist, 99.9) / 1000.0,
+		STRESS_METRIC_GEOMETRIC_MEAN);
+
+	if (fd >= 0)
+		(void)close(fd);
+	(void)stress_kill_pid_wait(pid, NULL);
+close_listen:
+	if (listen_fd >= 0)
+		(void)close(listen_fd);
+#if defined(AF_UNIX) &&		\
+    defined(HAVE_SOCKADDR_UN)
+	if (addr && (sock_domain == AF_UNIX)) {
+		const struct sockaddr_un *addr_un = (struct sockaddr_un *)addr;
+
+		(void)shim_unlink(addr_un->sun_path);
+	}
+#endif
+free_hist:
+	free(hist);
+
+	return rc;
+}
+
+static void stress_sock_sigpipe_handler(int signum)
+{
+	(void)signum;
+
+	stress_continue_set_flag(false);
+}
+
+/*
+ *  stress_sock_kernel_rt()
+ * 	return true if kernel is PREEMPT_RT, true if
+ * 	not sure, false if definitely not PREEMPT_RT.
+ */
+static bool stress_sock_kernel_rt(void)
+{
+#if defined(HAVE_UNAME) &&	\
+    defined(HAVE_SYS_UTSNAME_H)
+	struct utsname buf;
+
+	if (uname(&buf) < 0)
+		return true;	/* Not sure, assume rt */
+
+	if (strstr(buf.version, "PREEMPT_RT"))
+		return true;	/* Definitely rt */
+
+	/* probably not RT */
+	return false;
+#else
+	return true;		/* Not sure, assume rt */
+#endif
+}
+
+/*
+ *  stress_sock
+ *	stress by heavy socket I/O
+ */
+static int stress_sock(stress_args_t *args)
+{
+	pid_t pid, mypid = getpid();
+	size_t idx;
+	int sock_opts;
+	int sock_domain = AF_INET;
+	int sock_type;
+	int sock_port = DEFAULT_SOCKET_PORT;
+	int sock_protocol = 0;
+	int sock_zerocopy = false;
+	uint32_t sock_reuseport = 0;
+	size_t sock_engine, sock_rr = 0;
+	int rc = EXIT_SUCCESS, reserved_port, parent_cpu;
+	const bool rt = stress_sock_kernel_rt();
+	char *mmap_buffer;
+	char *sock_if = NULL;
+
+	if (stress_sigchld_set_handler(args) < 0)
+		return EXIT_NO_RESOURCE;
+
+	(void)stress_get_setting("sock-if", &sock_if);
+	(void)stress_get_setting("sock-domain", &sock_domain);
+	(void)stress_get_setting("sock-port", &sock_port);
+	(void)stress_get_setting("sock-zerocopy", &sock_zerocopy);
+	(void)stress_get_setting("sock-reuseport", &sock_reuseport);
+	(void)stress_get_setting("sock-rr", &sock_rr);
+	sock_opts = stress_get_setting("sock-opts", &idx) ?
+		sock_options_opts[idx].optval : SOCKET_OPT_SEND;
+#if defined(SOCK_STREAM)
+	sock_type = stress_get_setting("sock-type", &idx) ?
+		sock_options_types[idx].optval : SOCK_STREAM;
+#else
+	sock_type = stress_get_setting("sock-type", &idx) ?
+		sock_options_types[idx].optval : 1;
+#endif
+	sock_protocol = stress_get_setting("sock-protocol", &idx) ?
+		sock_options_protocols[idx].optval : IPPROTO_TCP;
+
+#if !defined(MSG_ZEROCOPY)
+	if (sock_zerocopy)
+		pr_inf("sock: cannot enable sock-zerocopy, MSG_ZEROCOPY is not available\n");
+#endif
+
+	if (sock_if) {
+		int ret;
+		struct sockaddr if_addr;
+
+		ret = stress_net_interface_exists(sock_if, sock_domain, &if_addr);
+		if (ret < 0) {
+			pr_inf("%s: interface '%s' is not enabled for domain '%s', defaulting to using loopback\n",
+				args->name, sock_if, stress_net_domain(sock_domain));
+			sock_if = NULL;
+		}
+	}
+	sock_port += args->instance;
+	if (sock_port > MAX_PORT)
+		sock_port -= (MAX_PORT- MIN_PORT + 1);
+	reserved_port = stress_net_reserve_ports(sock_port, sock_port);
+	if (reserved_port < 0) {
+		pr_inf_skip("%s: cannot reserve port %d, skipping stressor\n",
+			args->name, sock_port);
+		return EXIT_NO_RESOURCE;
+	}
+	sock_port = reserved_port;
+
+	pr_dbg("%s: process [%d] using socket port %d\n",
+		args->name, (int)args->pid, sock_port);
+
+	if (stress_sighandler(args->name, SIGPIPE, stress_sock_sigpipe_handler, NULL) < 0)
+		return EXIT_NO_RESOURCE;
+
+	mmap_buffer = (char *)stress_mmap_populate(NULL, MMAP_BUF_SIZE,
+				PROT_READ | PROT_WRITE,
+				MAP_ANONYMOUS | MAP_PRIVATE, -1, 0);
+	if (mmap_buffer == MAP_FAILED) {
+		pr_inf("%s: cannot mmap I/O buffer, errno=%d (%s)\n",
+			args->name, errno, strerror(errno));
+		return EXIT_NO_RESOURCE;
+	}
+	stress_set_vma_anon_name(mmap_buffer, MMAP_BUF_SIZE, "io-buffer");
+
+	/* server and client record into separate histograms */
+	stress_latency_set_description(args, 0, "sock send");
+	stress_latency_set_description(args, 1, "sock connect");
+
+	stress_set_proc_state(args->name, STRESS_STATE_SYNC_WAIT);
+	stress_sync_start_wait(args);
+	stress_set_proc_state(args->name, STRESS_STATE_RUN);
+
+	if (sock_rr) {
+		stress_latency_set_description(args, 0, "sock round-trip");
+		rc = stress_sock_rr(args, mmap_buffer, mypid, sock_domain, sock_type,
+			sock_protocol, sock_port, sock_if, sock_rr);
+		(void)munmap((void *)mmap_buffer, MMAP_BUF_SIZE);
+		goto finish;
+	}
+	if (sock_reuseport || stress_get_setting("sock-engine", &sock_engine)) {
+#if defined(STRESS_SOCK_REUSEPORT)
+		stress_latency_set_description(args, 0, "sock round-trip");
+		rc = stress_sock_reuseport(args, mmap_buffer, mypid, sock_domain,
+			sock_protocol, sock_port, sock_if);
+#else
+		if (args->instance == 0)
+			pr_inf_skip("%s: --sock-reuseport and --sock-engine require epoll and SO_REUSEPORT, "
+				"skipping stressor\n", args->name);
+		rc = EXIT_NO_RESOURCE;
+#endif
+		(void)munmap((void *)mmap_buffer, MMAP_BUF_SIZE);
+		goto finish;
+	}
+again:
+	parent_cpu = stress_get_cpu();
 	pid = fork();
 	if (pid < 0) {
 		if (stress_redo_fork(args, errno))
@@ -1417,6 +3219,11 @@ finish:
 
 static int sock_domain_mask = DOMAIN_ALL;
 
+static const char *stress_sock_engine(const size_t i)
+{
+	return (i < SIZEOF_ARRAY(sock_engines)) ? sock_engines[i] : NULL;
+}
+
 static const char *stress_sock_opts(const size_t i)
 {
 	return (i < SIZEOF_ARRAY(sock_options_opts)) ? sock_options_opts[i].optname : NULL;
@@ -1434,14 +3241,23 @@ static const char *stress_sock_protocols(const size_t i)
 
 static const stress_opt_t opts[] = {
 	{ OPT_sock_domain,   "sock-domain",   TYPE_ID_INT_DOMAIN, 0, 0, &sock_domain_mask },
+	{ OPT_sock_engine,   "sock-engine",   TYPE_ID_SIZE_T_METHOD, 0, 0, stress_sock_engine },
 	{ OPT_sock_if,	     "sock-if",       TYPE_ID_STR, 0, 0, NULL },
 	{ OPT_sock_msgs,     "sock-msgs",     TYPE_ID_SIZE_T, MIN_SOCKET_MSGS, MAX_SOCKET_MSGS, NULL },
 	{ OPT_sock_nodelay,  "sock-nodelay",  TYPE_ID_BOOL, 0, 1, NULL },
 	{ OPT_sock_opts,     "sock-opts",     TYPE_ID_SIZE_T_METHOD, 0, 0, stress_sock_opts },
+	{ OPT_sock_rr,	     "sock-rr",       TYPE_ID_SIZE_T_BYTES_VM, MIN_SOCKET_RR_SIZE, MAX_SOCKET_RR_SIZE, NULL },
+	{ OPT_sock_rr_client_cpu, "sock-rr-client-cpu", TYPE_ID_INT32, 0, INT32_MAX, NULL },
+	{ OPT_sock_rr_server_cpu, "sock-rr-server-cpu", TYPE_ID_INT32, 0, INT32_MAX, NULL },
 	{ OPT_sock_type,     "sock-type",     TYPE_ID_SIZE_T_METHOD, 0, 0, stress_sock_types },
 	{ OPT_sock_port,     "sock-port",     TYPE_ID_INT_PORT, MIN_PORT, MAX_PORT, NULL },
 	{ OPT_sock_protocol, "sock-protocol", TYPE_ID_SIZE_T_METHOD, 0, 0, stress_sock_protocols },
+	{ OPT_sock_reuseport, "sock-reuseport", TYPE_ID_UINT32, MIN_SOCKET_REUSEPORT, MAX_SOCKET_REUSEPORT, NULL },
+	{ OPT_sock_reuseport_cbpf, "sock-reuseport-cbpf", TYPE_ID_BOOL, 0, 1, NULL },
+	{ OPT_sock_reuseport_conns, "sock-reuseport-conns", TYPE_ID_SIZE_T, MIN_SOCKET_REUSEPORT_CONNS, MAX_SOCKET_REUSEPORT_CONNS, NULL },
+	{ OPT_sock_reuseport_size, "sock-reuseport-size", TYPE_ID_SIZE_T_BYTES_VM, MIN_SOCKET_REUSEPORT_SIZE, MAX_SOCKET_REUSEPORT_SIZE, NULL },
 	{ OPT_sock_zerocopy, "sock-zerocopy", TYPE_ID_BOOL, 0, 1, NULL },
+	{ OPT_sock_zerocopy_window, "sock-zerocopy-window", TYPE_ID_UINT32, MIN_SOCKET_ZEROCOPY_WINDOW, MAX_SOCKET_ZEROCOPY_WINDOW, NULL },
 	END_OPT,
 };
 
@@ -1450,5 +3266,6 @@ const stressor_info_t stress_sock_info = {
 	.class = CLASS_NETWORK | CLASS_OS | CLASS_IPC,
 	.opts = opts,
 	.verify = VERIFY_ALWAYS,
+	.metrics_max = 9,
 	.help = help
 };
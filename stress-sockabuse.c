@@ -432,5 +432,6 @@ const stressor_info_t stress_sockabuse_info = {
 	.class = CLASS_NETWORK | CLASS_OS,
 	.opts = opts,
 	.verify = VERIFY_ALWAYS,
+	.metrics_max = 1,
 	.help = help
 };
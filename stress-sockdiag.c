@@ -18,7 +18,11 @@
  *
  */
 #include "stress-ng.h"
+#include "core-builtin.h"
+#include "core-time.h"
+
 #include <sys/socket.h>
+#include <netinet/in.h>
 
 #if defined(HAVE_LINUX_NETLINK_H)
 #include <linux/netlink.h>
@@ -44,12 +48,25 @@ UNEXPECTED
 UNEXPECTED
 #endif
 
+#if defined(HAVE_LINUX_INET_DIAG_H)
+#include <linux/inet_diag.h>
+#endif
+
+#define MIN_SOCKDIAG_SOCKETS	(4)
+#define MAX_SOCKDIAG_SOCKETS	(4000000)
+
 static const stress_help_t help[] = {
 	{ NULL,	"sockdiag N",	  "start N workers exercising sockdiag netlink" },
 	{ NULL,	"sockdiag-ops N", "stop sockdiag workers after N bogo messages" },
+	{ NULL,	"sockdiag-sockets N", "create N sockets and measure filtered and unfiltered dump cost" },
 	{ NULL,	NULL,		  NULL }
 };
 
+static const stress_opt_t opts[] = {
+	{ OPT_sockdiag_sockets, "sockdiag-sockets", TYPE_ID_UINT32, MIN_SOCKDIAG_SOCKETS, MAX_SOCKDIAG_SOCKETS, NULL },
+	END_OPT,
+};
+
 #if defined(__linux__) && 		\
     defined(HAVE_LINUX_SOCK_DIAG_H) &&	\
     defined(HAVE_LINUX_NETLINK_H) && 	\
@@ -277,6 +294,392 @@ static int sockdiag_recv(stress_args_t *args, const int fd)
 	return 0;
 }
 
+#if defined(HAVE_LINUX_INET_DIAG_H) &&	\
+    defined(HAVE_GETRUSAGE) &&		\
+    defined(RUSAGE_SELF)
+#define STRESS_SOCKDIAG_SCALE	(1)
+
+#define SOCKDIAG_TCP_ESTABLISHED	(1)	/* TCP_ESTABLISHED */
+
+/* socket states created for --sockdiag-sockets */
+typedef enum {
+	SOCKDIAG_SOCK_UNIX,		/* connected unix socket pair */
+	SOCKDIAG_SOCK_TCP,		/* established loopback TCP pair */
+	SOCKDIAG_SOCK_UDP,		/* bound UDP socket */
+	SOCKDIAG_SOCK_TIME_WAIT,	/* closed TCP connection in TIME_WAIT */
+	SOCKDIAG_SOCK_MAX,
+} stress_sockdiag_sock_t;
+
+/* dumps measured for --sockdiag-sockets */
+typedef enum {
+	SOCKDIAG_DUMP_TCP,		/* all TCP sockets */
+	SOCKDIAG_DUMP_TCP_FILTERED,	/* established TCP, source port bytecode filter */
+	SOCKDIAG_DUMP_UDP,		/* all UDP sockets */
+	SOCKDIAG_DUMP_UNIX,		/* all unix sockets */
+	SOCKDIAG_DUMP_MAX,
+} stress_sockdiag_dump_t;
+
+static const char * const sockdiag_dump_names[SOCKDIAG_DUMP_MAX] = {
+	"tcp",
+	"tcp filtered",
+	"udp",
+	"unix",
+};
+
+typedef struct {
+	double duration;		/* wall clock time dumping */
+	double cpu;			/* user + system CPU time dumping */
+	uint64_t sockets;		/* sockets reported */
+	uint64_t dumps;			/* completed dumps */
+} stress_sockdiag_stats_t;
+
+typedef struct {
+	struct nlmsghdr nlh;
+	struct inet_diag_req_v2 req;
+	struct rtattr rta;
+	struct inet_diag_bc_op ops[4];
+} stress_sockdiag_inet_request_t;
+
+/*
+ *  stress_sockdiag_cpu_now()
+ *	user + system CPU time of this process in seconds
+ */
+static double stress_sockdiag_cpu_now(void)
+{
+	struct rusage usage;
+
+	if (getrusage(RUSAGE_SELF, &usage) < 0)
+		return 0.0;
+	return stress_timeval_to_double(&usage.ru_utime) +
+	       stress_timeval_to_double(&usage.ru_stime);
+}
+
+/*
+ *  stress_sockdiag_tcp_pair()
+ *	connect to the listener and accept the connection,
+ *	returns -1 if the pair cannot be created
+ */
+static int stress_sockdiag_tcp_pair(
+	const int listen_fd,
+	const struct sockaddr_in *addr,
+	int fds[2])
+{
+	fds[0] = socket(AF_INET, SOCK_STREAM, 0);
+	if (fds[0] < 0)
+		return -1;
+	if (connect(fds[0], (const struct sockaddr *)addr, sizeof(*addr)) < 0) {
+		(void)close(fds[0]);
+		return -1;
+	}
+	fds[1] = accept(listen_fd, NULL, NULL);
+	if (fds[1] < 0) {
+		(void)close(fds[0]);
+		return -1;
+	}
+	return 0;
+}
+
+/*
+ *  stress_sockdiag_create()
+ *	create up to n sockets in a mix of states, returns the
+ *	number of open fds in fds, counts are per state
+ */
+static size_t stress_sockdiag_create(
+	const size_t n,
+	int *fds,
+	const int listen_fd,
+	const struct sockaddr_in *addr,
+	uint64_t counts[SOCKDIAG_SOCK_MAX])
+{
+	size_t n_fds = 0, i;
+	bool failed[SOCKDIAG_SOCK_MAX];
+	struct sockaddr_in udp_addr;
+
+	(void)shim_memset(failed, 0, sizeof(failed));
+	(void)shim_memset(&udp_addr, 0, sizeof(udp_addr));
+	udp_addr.sin_family = AF_INET;
+	udp_addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+	for (i = 0; (n_fds + 2 <= n) && stress_continue_flag(); i++) {
+		const stress_sockdiag_sock_t type = (stress_sockdiag_sock_t)(i % SOCKDIAG_SOCK_MAX);
+		int pair[2];
+
+		if (failed[SOCKDIAG_SOCK_UNIX] && failed[SOCKDIAG_SOCK_TCP] &&
+		    failed[SOCKDIAG_SOCK_UDP])
+			break;
+		if (failed[type])
+			continue;
+
+		switch (type) {
+		case SOCKDIAG_SOCK_UNIX:
+			if (socketpair(AF_UNIX, SOCK_STREAM, 0, pair) < 0) {
+				failed[type] = true;
+				continue;
+			}
+			fds[n_fds++] = pair[0];
+			fds[n_fds++] = pair[1];
+			counts[type] += 2;
+			break;
+		case SOCKDIAG_SOCK_TCP:
+			if (stress_sockdiag_tcp_pair(listen_fd, addr, pair) < 0) {
+				failed[type] = true;
+				continue;
+			}
+			fds[n_fds++] = pair[0];
+			fds[n_fds++] = pair[1];
+			counts[type] += 2;
+			break;
+		case SOCKDIAG_SOCK_UDP:
+			pair[0] = socket(AF_INET, SOCK_DGRAM, 0);
+			if (pair[0] < 0) {
+				failed[type] = true;
+				continue;
+			}
+			if (bind(pair[0], (struct sockaddr *)&udp_addr, sizeof(udp_addr)) < 0) {
+				(void)close(pair[0]);
+				failed[type] = true;
+				continue;
+			}
+			fds[n_fds++] = pair[0];
+			counts[type]++;
+			break;
+		case SOCKDIAG_SOCK_TIME_WAIT:
+			/* server closes first so the server side holds TIME_WAIT */
+			if (stress_sockdiag_tcp_pair(listen_fd, addr, pair) < 0) {
+				failed[type] = true;
+				continue;
+			}
+			(void)close(pair[1]);
+			(void)close(pair[0]);
+			counts[type]++;
+			break;
+		default:
+			break;
+		}
+	}
+	return n_fds;
+}
+
+/*
+ *  stress_sockdiag_dump()
+ *	issue one sock_diag dump request and count the
+ *	sockets reported, returns -1 on failure
+ */
+static int stress_sockdiag_dump(
+	const int fd,
+	const stress_sockdiag_dump_t dump,
+	const uint16_t port,
+	uint64_t *sockets)
+{
+	static uint32_t buf[8192] ALIGN64;
+	struct sockaddr_nl nladdr;
+	ssize_t ret;
+
+	(void)shim_memset(&nladdr, 0, sizeof(nladdr));
+	nladdr.nl_family = AF_NETLINK;
+
+	if (dump == SOCKDIAG_DUMP_UNIX) {
+		stress_sockdiag_request_t request;
+
+		(void)shim_memset(&request, 0, sizeof(request));
+		request.nlh.nlmsg_len = sizeof(request);
+		request.nlh.nlmsg_type = SOCK_DIAG_BY_FAMILY;
+		request.nlh.nlmsg_flags = NLM_F_REQUEST | NLM_F_DUMP;
+		request.udr.sdiag_family = AF_UNIX;
+		request.udr.udiag_states = ~0U;
+		ret = sendto(fd, &request, sizeof(request), 0,
+			(struct sockaddr *)&nladdr, sizeof(nladdr));
+	} else {
+		stress_sockdiag_inet_request_t request;
+		size_t len = offsetof(stress_sockdiag_inet_request_t, rta);
+
+		(void)shim_memset(&request, 0, sizeof(request));
+		request.nlh.nlmsg_type = SOCK_DIAG_BY_FAMILY;
+		request.nlh.nlmsg_flags = NLM_F_REQUEST | NLM_F_DUMP;
+		request.req.sdiag_family = AF_INET;
+		request.req.sdiag_protocol = (dump == SOCKDIAG_DUMP_UDP) ? IPPROTO_UDP : IPPROTO_TCP;
+		request.req.idiag_states = ~0U;
+		if (dump == SOCKDIAG_DUMP_TCP_FILTERED) {
+			/* port >= listener port && port <= listener port, else reject */
+			request.req.idiag_states = 1U << SOCKDIAG_TCP_ESTABLISHED;
+			request.rta.rta_type = INET_DIAG_REQ_BYTECODE;
+			request.rta.rta_len = RTA_LENGTH(sizeof(request.ops));
+			request.ops[0].code = INET_DIAG_BC_S_GE;
+			request.ops[0].yes = 2 * sizeof(request.ops[0]);
+			request.ops[0].no = (unsigned short int)(sizeof(request.ops) + 4);
+			request.ops[1].no = port;
+			request.ops[2].code = INET_DIAG_BC_S_LE;
+			request.ops[2].yes = 2 * sizeof(request.ops[0]);
+			request.ops[2].no = (unsigned short int)((2 * sizeof(request.ops[0])) + 4);
+			request.ops[3].no = port;
+			len = sizeof(request);
+		}
+		request.nlh.nlmsg_len = (uint32_t)len;
+		ret = sendto(fd, &request, len, 0,
+			(struct sockaddr *)&nladdr, sizeof(nladdr));
+	}
+	if (ret < 0)
+		return -1;
+
+	for (;;) {
+		struct nlmsghdr *h = (struct nlmsghdr *)buf;
+
+		ret = recv(fd, buf, sizeof(buf), 0);
+		if (UNLIKELY(ret <= 0)) {
+			if ((ret < 0) && (errno == EINTR) && stress_continue_flag())
+				continue;
+			return -1;
+		}
+		for (; NLMSG_OK(h, ret); h = NLMSG_NEXT(h, ret)) {
+			if (h->nlmsg_type == NLMSG_DONE)
+				return 0;
+			if (UNLIKELY(h->nlmsg_type == NLMSG_ERROR)) {
+				const struct nlmsgerr *err = (const struct nlmsgerr *)NLMSG_DATA(h);
+
+				errno = -err->error;
+				return -1;
+			}
+			(*sockets)++;
+		}
+	}
+}
+
+/*
+ *  stress_sockdiag_scale()
+ *	--sockdiag-sockets mode, create many sockets in a mix
+ *	of states then measure the time, socket rate and CPU
+ *	cost of unfiltered and filtered sock_diag dumps
+ */
+static int stress_sockdiag_scale(stress_args_t *args, const uint32_t sockdiag_sockets)
+{
+	stress_sockdiag_stats_t stats[SOCKDIAG_DUMP_MAX];
+	uint64_t counts[SOCKDIAG_SOCK_MAX];
+	struct sockaddr_in addr;
+	socklen_t addr_len = sizeof(addr);
+	size_t n, n_fds = 0, limit, i;
+	int *fds, listen_fd, nl_fd = -1, rc = EXIT_SUCCESS;
+	double t;
+
+	limit = stress_get_file_limit();
+	n = (limit > 64) ? STRESS_MINIMUM((size_t)sockdiag_sockets, limit - 64) : 0;
+	if (n < 4) {
+		pr_inf_skip("%s: not enough free file descriptors for --sockdiag-sockets, "
+			"skipping stressor\n", args->name);
+		return EXIT_NO_RESOURCE;
+	}
+	if ((args->instance == 0) && (n < (size_t)sockdiag_sockets))
+		pr_inf("%s: file descriptor limit allows only %zu of %" PRIu32 " sockets\n",
+			args->name, n, sockdiag_sockets);
+
+	fds = (int *)calloc(n, sizeof(*fds));
+	if (!fds) {
+		pr_inf_skip("%s: cannot allocate %zu file descriptors, skipping stressor\n",
+			args->name, n);
+		return EXIT_NO_RESOURCE;
+	}
+
+	(void)shim_memset(&addr, 0, sizeof(addr));
+	addr.sin_family = AF_INET;
+	addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	listen_fd = socket(AF_INET, SOCK_STREAM, 0);
+	if (listen_fd < 0) {
+		rc = stress_exit_status(errno);
+		pr_fail("%s: socket failed, errno=%d (%s)\n",
+			args->name, errno, strerror(errno));
+		goto free_fds;
+	}
+	if ((bind(listen_fd, (struct sockaddr *)&addr, sizeof(addr)) < 0) ||
+	    (getsockname(listen_fd, (struct sockaddr *)&addr, &addr_len) < 0) ||
+	    (listen(listen_fd, SOMAXCONN) < 0)) {
+		rc = stress_exit_status(errno);
+		pr_fail("%s: cannot create loopback listener, errno=%d (%s)\n",
+			args->name, errno, strerror(errno));
+		goto close_listen;
+	}
+	nl_fd = socket(AF_NETLINK, SOCK_RAW, NETLINK_SOCK_DIAG);
+	if (nl_fd < 0) {
+		if (args->instance == 0)
+			pr_inf_skip("%s: NETLINK_SOCK_DIAG not supported, skipping stressor\n",
+				args->name);
+		rc = EXIT_NOT_IMPLEMENTED;
+		goto close_listen;
+	}
+
+	(void)shim_memset(counts, 0, sizeof(counts));
+	(void)shim_memset(stats, 0, sizeof(stats));
+	t = stress_time_now();
+	n_fds = stress_sockdiag_create(n, fds, listen_fd, &addr, counts);
+	pr_dbg("%s: created %" PRIu64 " unix, %" PRIu64 " TCP, %" PRIu64 " UDP and %"
+		PRIu64 " TIME_WAIT sockets in %.2f secs\n", args->name,
+		counts[SOCKDIAG_SOCK_UNIX], counts[SOCKDIAG_SOCK_TCP],
+		counts[SOCKDIAG_SOCK_UDP], counts[SOCKDIAG_SOCK_TIME_WAIT],
+		stress_time_now() - t);
+
+	stress_set_proc_state(args->name, STRESS_STATE_SYNC_WAIT);
+	stress_sync_start_wait(args);
+	stress_set_proc_state(args->name, STRESS_STATE_RUN);
+
+	do {
+		for (i = 0; (i < SOCKDIAG_DUMP_MAX) && stress_continue_flag(); i++) {
+			const double cpu = stress_sockdiag_cpu_now();
+			uint64_t sockets = 0;
+
+			t = stress_time_now();
+			if (UNLIKELY(stress_sockdiag_dump(nl_fd, (stress_sockdiag_dump_t)i,
+					ntohs(addr.sin_port), &sockets) < 0)) {
+				if (!stress_continue_flag())
+					break;
+				pr_fail("%s: NETLINK_SOCK_DIAG %s dump failed, errno=%d (%s)\n",
+					args->name, sockdiag_dump_names[i], errno, strerror(errno));
+				rc = EXIT_FAILURE;
+				goto done;
+			}
+			stats[i].duration += stress_time_now() - t;
+			stats[i].cpu += stress_sockdiag_cpu_now() - cpu;
+			stats[i].sockets += sockets;
+			stats[i].dumps++;
+			stress_bogo_inc(args);
+		}
+	} while (stress_continue(args));
+done:
+	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
+
+	for (i = 0; i < SOCKDIAG_DUMP_MAX; i++) {
+		const stress_sockdiag_stats_t *s = &stats[i];
+		char str[64];
+
+		if (!s->dumps)
+			continue;
+		(void)snprintf(str, sizeof(str), "usec per %s dump", sockdiag_dump_names[i]);
+		stress_metrics_set(args, (i * 4), str,
+			(s->duration * STRESS_DBL_MICROSECOND) / (double)s->dumps,
+			STRESS_METRIC_HARMONIC_MEAN);
+		(void)snprintf(str, sizeof(str), "sockets per %s dump", sockdiag_dump_names[i]);
+		stress_metrics_set(args, (i * 4) + 1, str,
+			(double)s->sockets / (double)s->dumps,
+			STRESS_METRIC_GEOMETRIC_MEAN);
+		(void)snprintf(str, sizeof(str), "%s sockets dumped per sec", sockdiag_dump_names[i]);
+		stress_metrics_set(args, (i * 4) + 2, str,
+			(s->duration > 0.0) ? (double)s->sockets / s->duration : 0.0,
+			STRESS_METRIC_HARMONIC_MEAN);
+		(void)snprintf(str, sizeof(str), "usec CPU per %s dump", sockdiag_dump_names[i]);
+		stress_metrics_set(args, (i * 4) + 3, str,
+			(s->cpu * STRESS_DBL_MICROSECOND) / (double)s->dumps,
+			STRESS_METRIC_HARMONIC_MEAN);
+	}
+
+	(void)close(nl_fd);
+close_listen:
+	(void)close(listen_fd);
+	for (i = 0; i < n_fds; i++)
+		(void)close(fds[i]);
+free_fds:
+	free(fds);
+
+	return rc;
+}
+#endif
+
 /*
  *  stress_sockdiag
  *	stress by heavy socket I/O
@@ -284,6 +687,18 @@ static int sockdiag_recv(stress_args_t *args, const int fd)
 static int stress_sockdiag(stress_args_t *args)
 {
 	int rc = EXIT_SUCCESS;
+	uint32_t sockdiag_sockets = 0;
+
+	(void)stress_get_setting("sockdiag-sockets", &sockdiag_sockets);
+	if (sockdiag_sockets > 0) {
+#if defined(STRESS_SOCKDIAG_SCALE)
+		return stress_sockdiag_scale(args, sockdiag_sockets);
+#else
+		if (args->instance == 0)
+			pr_inf("%s: --sockdiag-sockets requires linux/inet_diag.h and "
+				"getrusage(), ignoring option\n", args->name);
+#endif
+	}
 
 	stress_set_proc_state(args->name, STRESS_STATE_SYNC_WAIT);
 	stress_sync_start_wait(args);
@@ -330,6 +745,7 @@ static int stress_sockdiag(stress_args_t *args)
 const stressor_info_t stress_sockdiag_info = {
 	.stressor = stress_sockdiag,
 	.class = CLASS_NETWORK | CLASS_OS,
+	.opts = opts,
 	.verify = VERIFY_ALWAYS,
 	.help = help
 };
@@ -337,6 +753,7 @@ const stressor_info_t stress_sockdiag_info = {
 const stressor_info_t stress_sockdiag_info = {
 	.stressor = stress_unimplemented,
 	.class = CLASS_NETWORK | CLASS_OS,
+	.opts = opts,
 	.verify = VERIFY_ALWAYS,
 	.help = help,
 	.unimplemented_reason = "built without linux/sock_diag.h, linux/netlink.h, linux/rtnetlink.h or linux/unix_diag.h"
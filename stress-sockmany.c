@@ -21,6 +21,7 @@
 #include "core-affinity.h"
 #include "core-builtin.h"
 #include "core-killpid.h"
+#include "core-latency.h"
 #include "core-net.h"
 
 #if defined(HAVE_NETINET_TCP_H)
@@ -34,6 +35,11 @@ UNEXPECTED
 #define SOCKET_MANY_BUF		(8)
 #define SOCKET_MANY_FDS		(100000)
 
+#define MIN_SOCKET_MANY_RATE	(1)
+#define MAX_SOCKET_MANY_RATE	(256)
+#define MIN_SOCKET_MANY_REUSEPORT (1)
+#define MAX_SOCKET_MANY_REUSEPORT (64)
+
 typedef struct {
 	int max_fd;
 	int fds[SOCKET_MANY_FDS];
@@ -41,15 +47,25 @@ typedef struct {
 
 static const stress_help_t help[] = {
 	{ NULL, "sockmany N",		"start N workers exercising many socket connections" },
+	{ NULL,	"sockmany-defer-accept", "set TCP_DEFER_ACCEPT on the --sockmany-rate listeners" },
+	{ NULL,	"sockmany-fastopen",	"use TCP fast open for --sockmany-rate connections" },
 	{ NULL,	"sockmany-if I",	"use network interface I, e.g. lo, eth0, etc." },
 	{ NULL,	"sockmany-ops N",	"stop after N sockmany bogo operations" },
 	{ NULL,	"sockmany-port",	"use socket ports P to P + number of workers - 1" },
+	{ NULL,	"sockmany-rate N",	"measure connection rate and latency with N parallel connectors" },
+	{ NULL,	"sockmany-reuseport N",	"use N SO_REUSEPORT accept loops for --sockmany-rate" },
+	{ NULL,	"sockmany-syncookies",	"use a one entry backlog to force SYN cookies for --sockmany-rate" },
 	{ NULL,	NULL,			NULL }
 };
 
 static const stress_opt_t opts[] = {
-	{ OPT_sockmany_if,   "sockmany-if",   TYPE_ID_STR, 0, 0, NULL },
-	{ OPT_sockmany_port, "sockmany-port", TYPE_ID_INT_PORT, MIN_PORT, MAX_PORT, NULL },
+	{ OPT_sockmany_defer_accept, "sockmany-defer-accept", TYPE_ID_BOOL, 0, 1, NULL },
+	{ OPT_sockmany_fastopen,     "sockmany-fastopen",     TYPE_ID_BOOL, 0, 1, NULL },
+	{ OPT_sockmany_if,           "sockmany-if",           TYPE_ID_STR, 0, 0, NULL },
+	{ OPT_sockmany_port,         "sockmany-port",         TYPE_ID_INT_PORT, MIN_PORT, MAX_PORT, NULL },
+	{ OPT_sockmany_rate,         "sockmany-rate",         TYPE_ID_UINT32, MIN_SOCKET_MANY_RATE, MAX_SOCKET_MANY_RATE, NULL },
+	{ OPT_sockmany_reuseport,    "sockmany-reuseport",    TYPE_ID_UINT32, MIN_SOCKET_MANY_REUSEPORT, MAX_SOCKET_MANY_REUSEPORT, NULL },
+	{ OPT_sockmany_syncookies,   "sockmany-syncookies",   TYPE_ID_BOOL, 0, 1, NULL },
 	END_OPT,
 };
 
@@ -277,6 +293,426 @@ die:
 	return rc;
 }
 
+/*
+ *  --sockmany-rate connection establishment rate mode
+ */
+typedef struct {
+	stress_latency_hist_t connect;	/* socket to connect (or TFO sendto) latency */
+	stress_latency_hist_t request;	/* socket to first response latency */
+	uint64_t connections;		/* completed connections */
+	uint64_t failures;		/* failed connection attempts */
+} stress_sockmany_rate_t;
+
+typedef enum {
+	SOCKMANY_NETSTAT_LISTEN_OVERFLOWS,
+	SOCKMANY_NETSTAT_LISTEN_DROPS,
+	SOCKMANY_NETSTAT_SYNCOOKIES_SENT,
+	SOCKMANY_NETSTAT_TFO_PASSIVE,
+	SOCKMANY_NETSTAT_MAX,
+} stress_sockmany_netstat_t;
+
+static const char * const sockmany_netstat_names[SOCKMANY_NETSTAT_MAX] = {
+	"ListenOverflows",
+	"ListenDrops",
+	"SyncookiesSent",
+	"TCPFastOpenPassive",
+};
+
+/*
+ *  stress_sockmany_netstat()
+ *	read the system wide TcpExt listen queue counters
+ *	from /proc/net/netstat, zero if they are not available
+ */
+static void stress_sockmany_netstat(uint64_t values[SOCKMANY_NETSTAT_MAX])
+{
+	static char names[8192], nums[8192];
+	FILE *fp;
+
+	(void)shim_memset(values, 0, sizeof(*values) * SOCKMANY_NETSTAT_MAX);
+	fp = fopen("/proc/net/netstat", "r");
+	if (!fp)
+		return;
+	while (fgets(names, sizeof(names), fp) && fgets(nums, sizeof(nums), fp)) {
+		char *name, *num, *name_save = NULL, *num_save = NULL;
+
+		if (strncmp(names, "TcpExt:", 7))
+			continue;
+		name = strtok_r(names, " \n", &name_save);
+		num = strtok_r(nums, " \n", &num_save);
+		while (name && num) {
+			size_t i;
+
+			for (i = 0; i < SOCKMANY_NETSTAT_MAX; i++) {
+				if (!strcmp(name, sockmany_netstat_names[i]))
+					values[i] = (uint64_t)strtoull(num, NULL, 10);
+			}
+			name = strtok_r(NULL, " \n", &name_save);
+			num = strtok_r(NULL, " \n", &num_save);
+		}
+		break;
+	}
+	(void)fclose(fp);
+}
+
+/*
+ *  stress_sockmany_rate_server()
+ *	accept connections, reply to the one byte request
+ *	and close first so the server holds the TIME_WAIT state
+ */
+static void NORETURN stress_sockmany_rate_server(const int listen_fd)
+{
+	stress_parent_died_alarm();
+	(void)sched_settings_apply(true);
+
+	while (stress_continue_flag()) {
+		char ch;
+		const int fd = accept(listen_fd, NULL, NULL);
+
+		if (UNLIKELY(fd < 0)) {
+			if ((errno == EMFILE) || (errno == ENFILE) ||
+			    (errno == ENOBUFS) || (errno == ENOMEM))
+				(void)shim_usleep(1000);
+			continue;
+		}
+		if (LIKELY(recv(fd, &ch, sizeof(ch), 0) == (ssize_t)sizeof(ch)))
+			VOID_RET(ssize_t, send(fd, &ch, sizeof(ch), MSG_NOSIGNAL));
+		(void)close(fd);
+	}
+	_exit(EXIT_SUCCESS);
+}
+
+/*
+ *  stress_sockmany_rate_client()
+ *	open connections as fast as possible, each sends a one byte
+ *	request and waits for the reply and the server side close
+ */
+static void NORETURN stress_sockmany_rate_client(
+	const struct sockaddr *addr,
+	const socklen_t addr_len,
+	const bool sockmany_fastopen,
+	stress_sockmany_rate_t *rate)
+{
+	stress_parent_died_alarm();
+	(void)sched_settings_apply(true);
+
+	while (stress_continue_flag()) {
+		char ch = 'C';
+		uint64_t t0, t1, t2;
+		int fd, ret, save_errno;
+
+		t0 = stress_latency_now();
+		fd = socket(addr->sa_family, SOCK_STREAM, 0);
+		if (UNLIKELY(fd < 0)) {
+			rate->failures++;
+			(void)shim_usleep(1000);
+			continue;
+		}
+		if (sockmany_fastopen) {
+#if defined(MSG_FASTOPEN)
+			/* request is sent in the SYN once a TFO cookie is cached */
+			ret = (sendto(fd, &ch, sizeof(ch), MSG_FASTOPEN | MSG_NOSIGNAL,
+				addr, addr_len) == (ssize_t)sizeof(ch)) ? 0 : -1;
+#else
+			ret = -1;
+#endif
+			t1 = stress_latency_now();
+		} else {
+			ret = connect(fd, addr, addr_len);
+			t1 = stress_latency_now();
+			if (LIKELY(ret == 0))
+				ret = (send(fd, &ch, sizeof(ch), MSG_NOSIGNAL) == (ssize_t)sizeof(ch)) ? 0 : -1;
+		}
+		if (UNLIKELY(ret < 0)) {
+			save_errno = errno;
+			rate->failures++;
+			(void)close(fd);
+			/* out of ephemeral ports, back off */
+			if (save_errno == EADDRNOTAVAIL)
+				(void)shim_usleep(10000);
+			continue;
+		}
+		if (LIKELY(recv(fd, &ch, sizeof(ch), 0) == (ssize_t)sizeof(ch))) {
+			t2 = stress_latency_now();
+			/* wait for the server close */
+			VOID_RET(ssize_t, recv(fd, &ch, sizeof(ch), 0));
+			stress_latency_hist_record(&rate->connect, t1 - t0);
+			stress_latency_hist_record(&rate->request, t2 - t0);
+			rate->connections++;
+		} else if (stress_continue_flag()) {
+			/* ignore the connection cut short at the end of the run */
+			rate->failures++;
+		}
+		(void)close(fd);
+	}
+	_exit(EXIT_SUCCESS);
+}
+
+/*
+ *  stress_sockmany_rate()
+ *	--sockmany-rate mode, N connector processes open and close
+ *	connections to one or more (SO_REUSEPORT) accept loops,
+ *	measure the connection rate and connect latency
+ */
+static int stress_sockmany_rate(
+	stress_args_t *args,
+	const uint32_t sockmany_rate,
+	const int sockmany_port,
+	const pid_t mypid,
+	const char *sockmany_if)
+{
+	uint32_t sockmany_reuseport = 0;
+	bool sockmany_fastopen = false, sockmany_defer_accept = false;
+	bool sockmany_syncookies = false;
+	stress_sockmany_rate_t *rates;
+	stress_latency_hist_t *connect_hist, *request_hist;
+	const size_t rates_size = sizeof(*rates) * sockmany_rate;
+	struct sockaddr *addr = NULL;
+	socklen_t addr_len = 0;
+	uint64_t netstat_begin[SOCKMANY_NETSTAT_MAX], netstat_end[SOCKMANY_NETSTAT_MAX];
+	uint64_t connections, failures;
+	uint32_t i, n_listeners, n_pids = 0;
+	int *listen_fds = NULL;
+	pid_t *pids = NULL;
+	char buf[32];
+	double t_start, duration = 0.0;
+	int rc = EXIT_SUCCESS;
+
+	(void)stress_get_setting("sockmany-reuseport", &sockmany_reuseport);
+	(void)stress_get_setting("sockmany-fastopen", &sockmany_fastopen);
+	(void)stress_get_setting("sockmany-defer-accept", &sockmany_defer_accept);
+	(void)stress_get_setting("sockmany-syncookies", &sockmany_syncookies);
+	n_listeners = sockmany_reuseport ? sockmany_reuseport : 1;
+
+#if !defined(MSG_FASTOPEN) ||	\
+    !defined(SOL_TCP) ||	\
+    !defined(TCP_FASTOPEN)
+	if (sockmany_fastopen) {
+		if (args->instance == 0)
+			pr_inf("%s: TCP fast open is not supported, ignoring --sockmany-fastopen\n",
+				args->name);
+		sockmany_fastopen = false;
+	}
+#endif
+	if ((args->instance == 0) && sockmany_fastopen &&
+	    (stress_system_read("/proc/sys/net/ipv4/tcp_fastopen", buf, sizeof(buf)) > 0) &&
+	    !(atoi(buf) & 2))
+		pr_inf("%s: server side TCP fast open is disabled in "
+			"/proc/sys/net/ipv4/tcp_fastopen, connections will use a "
+			"normal handshake\n", args->name);
+	if ((args->instance == 0) && sockmany_syncookies &&
+	    (stress_system_read("/proc/sys/net/ipv4/tcp_syncookies", buf, sizeof(buf)) > 0) &&
+	    (atoi(buf) == 0))
+		pr_inf("%s: SYN cookies are disabled in /proc/sys/net/ipv4/tcp_syncookies, "
+			"accept queue overflows will drop connections\n", args->name);
+
+	rates = (stress_sockmany_rate_t *)stress_mmap_populate(NULL, rates_size,
+		PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+	if (rates == MAP_FAILED) {
+		pr_inf_skip("%s: cannot mmap %zu bytes of connection statistics, "
+			"skipping stressor\n", args->name, rates_size);
+		return EXIT_NO_RESOURCE;
+	}
+	stress_set_vma_anon_name(rates, rates_size, "sockmany-rates");
+	for (i = 0; i < sockmany_rate; i++) {
+		stress_latency_hist_init(&rates[i].connect);
+		stress_latency_hist_init(&rates[i].request);
+		rates[i].connections = 0;
+		rates[i].failures = 0;
+	}
+
+	listen_fds = (int *)calloc(n_listeners, sizeof(*listen_fds));
+	pids = (pid_t *)calloc(n_listeners + sockmany_rate, sizeof(*pids));
+	connect_hist = (stress_latency_hist_t *)malloc(sizeof(*connect_hist));
+	request_hist = (stress_latency_hist_t *)malloc(sizeof(*request_hist));
+	if (!listen_fds || !pids || !connect_hist || !request_hist) {
+		pr_inf_skip("%s: cannot allocate connection state, skipping stressor\n", args->name);
+		rc = EXIT_NO_RESOURCE;
+		goto free_state;
+	}
+	for (i = 0; i < n_listeners; i++)
+		listen_fds[i] = -1;
+
+	if (stress_set_sockaddr_if(args->name, args->instance, mypid,
+			AF_INET, sockmany_port, sockmany_if,
+			&addr, &addr_len, NET_ADDR_ANY) < 0) {
+		rc = EXIT_FAILURE;
+		goto free_state;
+	}
+
+	for (i = 0; i < n_listeners; i++) {
+		int fd, one = 1;
+
+		fd = socket(AF_INET, SOCK_STREAM, 0);
+		if (fd < 0) {
+			rc = stress_exit_status(errno);
+			pr_fail("%s: socket failed, errno=%d (%s)\n",
+				args->name, errno, strerror(errno));
+			goto close_listeners;
+		}
+		listen_fds[i] = fd;
+		if (setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one)) < 0) {
+			pr_fail("%s: setsockopt SO_REUSEADDR failed, errno=%d (%s)\n",
+				args->name, errno, strerror(errno));
+			rc = EXIT_FAILURE;
+			goto close_listeners;
+		}
+		if (sockmany_reuseport) {
+#if defined(SO_REUSEPORT)
+			if (setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &one, sizeof(one)) < 0) {
+				pr_fail("%s: setsockopt SO_REUSEPORT failed, errno=%d (%s)\n",
+					args->name, errno, strerror(errno));
+				rc = EXIT_FAILURE;
+				goto close_listeners;
+			}
+#else
+			if ((args->instance == 0) && (i == 0))
+				pr_inf("%s: SO_REUSEPORT is not supported, using one listener\n",
+					args->name);
+			n_listeners = 1;
+#endif
+		}
+#if defined(SOL_TCP) &&	\
+    defined(TCP_FASTOPEN)
+		if (sockmany_fastopen) {
+			int qlen = SOMAXCONN;
+
+			VOID_RET(int, setsockopt(fd, SOL_TCP, TCP_FASTOPEN, &qlen, sizeof(qlen)));
+		}
+#endif
+#if defined(SOL_TCP) &&	\
+    defined(TCP_DEFER_ACCEPT)
+		if (sockmany_defer_accept) {
+			int secs = 1;
+
+			VOID_RET(int, setsockopt(fd, SOL_TCP, TCP_DEFER_ACCEPT, &secs, sizeof(secs)));
+		}
+#endif
+		if (bind(fd, addr, addr_len) < 0) {
+			rc = stress_exit_status(errno);
+			pr_fail("%s: bind failed, errno=%d (%s)\n",
+				args->name, errno, strerror(errno));
+			goto close_listeners;
+		}
+		/* a one entry backlog overflows the accept queue and forces SYN cookies */
+		if (listen(fd, sockmany_syncookies ? 1 : SOMAXCONN) < 0) {
+			rc = stress_exit_status(errno);
+			pr_fail("%s: listen failed, errno=%d (%s)\n",
+				args->name, errno, strerror(errno));
+			goto close_listeners;
+		}
+	}
+
+	for (i = 0; i < n_listeners; i++) {
+		pids[n_pids] = fork();
+		if (pids[n_pids] < 0) {
+			rc = stress_exit_status(errno);
+			pr_fail("%s: fork failed, errno=%d (%s)\n",
+				args->name, errno, strerror(errno));
+			goto reap;
+		} else if (pids[n_pids] == 0) {
+			stress_sockmany_rate_server(listen_fds[i]);
+		}
+		n_pids++;
+	}
+
+	stress_sockmany_netstat(netstat_begin);
+	t_start = stress_time_now();
+	for (i = 0; i < sockmany_rate; i++) {
+		pids[n_pids] = fork();
+		if (pids[n_pids] < 0) {
+			if (i > 0)
+				break;
+			rc = stress_exit_status(errno);
+			pr_fail("%s: fork failed, errno=%d (%s)\n",
+				args->name, errno, strerror(errno));
+			goto reap;
+		} else if (pids[n_pids] == 0) {
+			stress_sockmany_rate_client(addr, addr_len, sockmany_fastopen, &rates[i]);
+		}
+		n_pids++;
+	}
+
+	do {
+		(void)shim_usleep(100000);
+		for (connections = 0, i = 0; i < sockmany_rate; i++)
+			connections += rates[i].connections;
+		stress_bogo_set(args, connections);
+	} while (stress_continue(args));
+	duration = stress_time_now() - t_start;
+
+reap:
+	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
+	for (i = 0; i < n_pids; i++)
+		(void)stress_kill_pid_wait(pids[i], NULL);
+	if (rc != EXIT_SUCCESS)
+		goto close_listeners;
+
+	stress_sockmany_netstat(netstat_end);
+	stress_latency_hist_init(connect_hist);
+	stress_latency_hist_init(request_hist);
+	for (connections = 0, failures = 0, i = 0; i < sockmany_rate; i++) {
+		stress_latency_hist_merge(connect_hist, &rates[i].connect);
+		stress_latency_hist_merge(request_hist, &rates[i].request);
+		connections += rates[i].connections;
+		failures += rates[i].failures;
+	}
+
+	stress_metrics_set(args, 0, "connections per sec",
+		(duration > 0.0) ? (double)connections / duration : 0.0,
+		STRESS_METRIC_HARMONIC_MEAN);
+	if (connect_hist->count) {
+		stress_metrics_set(args, 1, "usec p50 connect latency",
+			(double)stress_latency_hist_percentile(connect_hist, 50.0) / 1000.0,
+			STRESS_METRIC_HARMONIC_MEAN);
+		stress_metrics_set(args, 2, "usec p99 connect latency",
+			(double)stress_latency_hist_percentile(connect_hist, 99.0) / 1000.0,
+			STRESS_METRIC_MAXIMUM);
+		stress_metrics_set(args, 3, "usec p99.9 connect latency",
+			(double)stress_latency_hist_percentile(connect_hist, 99.9) / 1000.0,
+			STRESS_METRIC_MAXIMUM);
+		stress_metrics_set(args, 4, "usec p50 request latency",
+			(double)stress_latency_hist_percentile(request_hist, 50.0) / 1000.0,
+			STRESS_METRIC_HARMONIC_MEAN);
+		stress_metrics_set(args, 5, "usec p99 request latency",
+			(double)stress_latency_hist_percentile(request_hist, 99.0) / 1000.0,
+			STRESS_METRIC_MAXIMUM);
+	}
+	stress_metrics_set(args, 6, "failed connection attempts",
+		(double)failures, STRESS_METRIC_TOTAL);
+	/* system wide counters, all instances see the same values */
+	stress_metrics_set(args, 7, "accept queue overflows (system wide)",
+		(double)(netstat_end[SOCKMANY_NETSTAT_LISTEN_OVERFLOWS] -
+			 netstat_begin[SOCKMANY_NETSTAT_LISTEN_OVERFLOWS]),
+		STRESS_METRIC_MAXIMUM);
+	stress_metrics_set(args, 8, "listen drops (system wide)",
+		(double)(netstat_end[SOCKMANY_NETSTAT_LISTEN_DROPS] -
+			 netstat_begin[SOCKMANY_NETSTAT_LISTEN_DROPS]),
+		STRESS_METRIC_MAXIMUM);
+	stress_metrics_set(args, 9, "SYN cookies sent (system wide)",
+		(double)(netstat_end[SOCKMANY_NETSTAT_SYNCOOKIES_SENT] -
+			 netstat_begin[SOCKMANY_NETSTAT_SYNCOOKIES_SENT]),
+		STRESS_METRIC_MAXIMUM);
+	if (sockmany_fastopen)
+		stress_metrics_set(args, 10, "TFO passive opens (system wide)",
+			(double)(netstat_end[SOCKMANY_NETSTAT_TFO_PASSIVE] -
+				 netstat_begin[SOCKMANY_NETSTAT_TFO_PASSIVE]),
+			STRESS_METRIC_MAXIMUM);
+
+close_listeners:
+	for (i = 0; i < n_listeners; i++) {
+		if (listen_fds[i] >= 0)
+			(void)close(listen_fds[i]);
+	}
+free_state:
+	free(request_hist);
+	free(connect_hist);
+	free(pids);
+	free(listen_fds);
+	(void)munmap((void *)rates, rates_size);
+
+	return rc;
+}
+
 static void stress_sockmany_sigpipe_handler(int signum)
 {
 	(void)signum;
@@ -293,6 +729,7 @@ static int stress_sockmany(stress_args_t *args)
 	pid_t pid, ppid = getppid();
 	stress_sock_fds_t *sock_fds;
 	int sockmany_port = DEFAULT_SOCKET_MANY_PORT;
+	uint32_t sockmany_rate = 0;
 	int rc = EXIT_SUCCESS, reserved_port, parent_cpu;
 	char *sockmany_if = NULL;
 
@@ -301,6 +738,7 @@ static int stress_sockmany(stress_args_t *args)
 
 	(void)stress_get_setting("sockmany-if", &sockmany_if);
 	(void)stress_get_setting("sockmany-port", &sockmany_port);
+	(void)stress_get_setting("sockmany-rate", &sockmany_rate);
 
 	if (sockmany_if) {
 		int ret;
@@ -328,6 +766,17 @@ static int stress_sockmany(stress_args_t *args)
 	pr_dbg("%s: process [%d] using socket port %d\n",
 		args->name, (int)args->pid, sockmany_port);
 
+	if (sockmany_rate > 0) {
+		stress_set_proc_state(args->name, STRESS_STATE_SYNC_WAIT);
+		stress_sync_start_wait(args);
+		stress_set_proc_state(args->name, STRESS_STATE_RUN);
+
+		rc = stress_sockmany_rate(args, sockmany_rate, sockmany_port, ppid, sockmany_if);
+		stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
+		stress_net_release_ports(sockmany_port, sockmany_port);
+		return rc;
+	}
+
 	sock_fds = (stress_sock_fds_t *)stress_mmap_populate(NULL, sizeof(*sock_fds),
 		PROT_READ | PROT_WRITE,
 		MAP_SHARED | MAP_ANONYMOUS, -1, 0);
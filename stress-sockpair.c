@@ -359,5 +359,6 @@ const stressor_info_t stress_sockpair_info = {
 	.stressor = stress_sockpair,
 	.class = CLASS_NETWORK | CLASS_OS,
 	.verify = VERIFY_OPTIONAL,
+	.metrics_max = 2,
 	.help = help
 };
@@ -19,6 +19,7 @@
 #include "stress-ng.h"
 #include "core-builtin.h"
 #include "core-pragma.h"
+#include "core-pthread.h"
 
 #if defined(HAVE_SYS_TREE_H)
 #include <sys/tree.h>
@@ -46,6 +47,9 @@
 #define MAX_SPARSEMATRIX_SIZE		(10000000)
 #define DEFAULT_SPARSEMATRIX_SIZE	(500)
 
+/* CSR SpMV threads, 0 = disabled */
+#define MAX_SPARSEMATRIX_SPMV_THREADS	(256)
+
 #if defined(CIRCLEQ_ENTRY) && 		\
     defined(CIRCLEQ_HEAD) &&		\
     defined(CIRCLEQ_INIT) &&		\
@@ -109,6 +113,7 @@ static const stress_help_t help[] = {
 	{ NULL,	"sparsematrix-method M", "select storage method: all, hash, hashjudy, judy, list, mmap, qhash, rb, splay" },
 	{ NULL,	"sparsematrix-ops N",	 "stop after N bogo sparse matrix operations" },
 	{ NULL,	"sparsematrix-size N",	 "M is the width and height X x Y of the matrix" },
+	{ NULL,	"sparsematrix-spmv N",	 "run CSR sparse matrix-vector multiplies on N threads" },
 	{ NULL,	NULL,		 	 NULL }
 };
 
@@ -1296,6 +1301,274 @@ static uint32_t mmap_get(void *handle, const uint32_t x, const uint32_t y)
 	return *((uint32_t *)(m->mmap) + offset);
 }
 
+/*
+ *  Compressed sparse row (CSR) sparse matrix-vector multiply, the
+ *  populated matrix is converted to CSR and y = A.x is computed
+ *  repeatedly with the rows split over threads by non-zero count
+ */
+#define SPMV_NNZ_PER_RUN	(16 * 1024 * 1024)	/* products per timed run */
+
+typedef struct {
+	uint32_t rows;		/* rows (and columns) in matrix */
+	uint32_t nnz;		/* number of non-zero values */
+	uint32_t *row_ptr;	/* rows + 1 offsets into col_idx and val */
+	uint32_t *col_idx;	/* column of each non-zero value */
+	double *val;		/* non-zero values */
+	double *x;		/* input vector */
+	double *y;		/* output vector */
+	uint32_t iterations;	/* SpMV iterations per run */
+} stress_spmv_csr_t;
+
+typedef struct {
+	stress_pthread_work_t work;	/* thread work item, must be first */
+	const stress_spmv_csr_t *csr;	/* shared CSR matrix */
+	uint32_t row_begin;		/* first row to multiply */
+	uint32_t row_end;		/* last row + 1 to multiply */
+} stress_spmv_thread_t;
+
+typedef struct {
+	double	flops;		/* floating point ops performed */
+	double	bytes;		/* minimum bytes of memory traffic */
+	double	duration;	/* SpMV duration, seconds */
+} stress_spmv_info_t;
+
+static int spmv_xy_cmp(const void *p1, const void *p2)
+{
+	const uint64_t v1 = *(const uint64_t *)p1;
+	const uint64_t v2 = *(const uint64_t *)p2;
+
+	return (v1 > v2) - (v1 < v2);
+}
+
+/*
+ *  stress_spmv_rows()
+ *	y = A.x for rows row_begin..row_end - 1, repeated iterations times
+ */
+static void *stress_spmv_rows(void *arg)
+{
+	const stress_spmv_thread_t *t = (const stress_spmv_thread_t *)arg;
+	const stress_spmv_csr_t *csr = t->csr;
+	const uint32_t *row_ptr = csr->row_ptr;
+	const uint32_t *col_idx = csr->col_idx;
+	const double *val = csr->val;
+	const double *x = csr->x;
+	double *y = csr->y;
+	uint32_t i, row;
+
+	for (i = 0; i < csr->iterations; i++) {
+		for (row = t->row_begin; row < t->row_end; row++) {
+			register double sum = 0.0;
+			register uint32_t j;
+			const uint32_t end = row_ptr[row + 1];
+
+			for (j = row_ptr[row]; j < end; j++)
+				sum += val[j] * x[col_idx[j]];
+			y[row] = sum;
+		}
+		if (UNLIKELY(!stress_continue_flag()))
+			break;
+	}
+	return &g_nowt;
+}
+
+/*
+ *  stress_spmv_run()
+ *	run the SpMV on threads_n threads, row ranges have about the same
+ *	number of non-zero values
+ */
+static void stress_spmv_run(
+	const stress_spmv_csr_t *csr,
+	stress_spmv_thread_t *threads,
+	const uint32_t threads_n)
+{
+	uint32_t i, row = 0;
+
+	for (i = 0; i < threads_n; i++) {
+		stress_spmv_thread_t *t = &threads[i];
+		const uint64_t nnz_end = ((uint64_t)csr->nnz * (i + 1)) / threads_n;
+
+		t->csr = csr;
+		t->row_begin = row;
+		if (i == threads_n - 1) {
+			row = csr->rows;
+		} else {
+			while ((row < csr->rows) && (csr->row_ptr[row + 1] <= nnz_end))
+				row++;
+		}
+		t->row_end = row;
+	}
+	stress_pthread_work_run(threads, sizeof(*threads), (size_t)threads_n,
+		stress_spmv_rows);
+}
+
+static void stress_spmv_csr_free(stress_spmv_csr_t *csr)
+{
+	free(csr->y);
+	free(csr->x);
+	free(csr->val);
+	free(csr->col_idx);
+	free(csr->row_ptr);
+}
+
+/*
+ *  stress_sparse_spmv_test()
+ *	populate a sparse matrix with the given method, convert it to CSR
+ *	by reading back each populated element and run repeated SpMVs on
+ *	threads_n threads, the result is checked against a single threaded
+ *	SpMV
+ */
+static int stress_sparse_spmv_test(
+	stress_args_t *args,
+	const uint64_t sparsematrix_items,
+	const uint32_t sparsematrix_size,
+	const stress_sparsematrix_method_info_t *info,
+	test_info_t *test_info,
+	const uint32_t threads_n,
+	stress_spmv_info_t *spmv_info)
+{
+	void *handle;
+	uint64_t i, *xy = NULL;
+	uint32_t row, nnz;
+	int rc = SPARSE_TEST_OK;
+	size_t objmem = 0;
+	double t1, *y_ref = NULL;
+	stress_spmv_csr_t csr;
+	stress_spmv_thread_t *threads = NULL;
+
+	const uint32_t w = stress_mwc32();
+	const uint32_t z = stress_mwc32();
+
+	(void)shim_memset(&csr, 0, sizeof(csr));
+	handle = info->create(sparsematrix_items, sparsematrix_size, sparsematrix_size);
+	if (UNLIKELY(!handle)) {
+		test_info->skip_no_mem = true;
+		return SPARSE_TEST_ENOMEM;
+	}
+
+	/* populate, recording the (y,x) positions for the CSR conversion */
+	xy = (uint64_t *)calloc((size_t)sparsematrix_items, sizeof(*xy));
+	if (UNLIKELY(!xy)) {
+		rc = SPARSE_TEST_ENOMEM;
+		goto err;
+	}
+	stress_mwc_set_seed(w, z);
+	t1 = stress_time_now();
+	for (i = 0; LIKELY(stress_continue_flag() && (i < sparsematrix_items)); i++) {
+		register const uint32_t x = stress_mwc32modn(sparsematrix_size);
+		register const uint32_t y = stress_mwc32modn(sparsematrix_size);
+		uint32_t v = value_map(x, y);
+
+		if (v == 0)
+			v = ~(uint32_t)0;
+		if (info->get(handle, x, y) == 0) {
+			if (UNLIKELY(info->put(handle, x, y, v) < 0)) {
+				pr_fail("%s: %s failed to put into "
+					"sparse matrix at position "
+					"(%" PRIu32 ",%" PRIu32 ")\n",
+					args->name, info->name, x, y);
+				rc = SPARSE_TEST_FAILED;
+				goto err;
+			}
+		}
+		xy[i] = ((uint64_t)y << 32) | x;
+	}
+	test_info->put_ops += i;
+	test_info->put_duration += stress_time_now() - t1;
+	if (UNLIKELY(i < sparsematrix_items))
+		goto err;
+
+	/* sort by row then column and drop duplicate positions */
+	qsort(xy, (size_t)sparsematrix_items, sizeof(*xy), spmv_xy_cmp);
+	for (nnz = 0, i = 0; i < sparsematrix_items; i++) {
+		if ((i == 0) || (xy[i] != xy[i - 1]))
+			xy[nnz++] = xy[i];
+	}
+
+	csr.rows = sparsematrix_size;
+	csr.nnz = nnz;
+	csr.row_ptr = (uint32_t *)calloc((size_t)csr.rows + 1, sizeof(*csr.row_ptr));
+	csr.col_idx = (uint32_t *)calloc((size_t)nnz, sizeof(*csr.col_idx));
+	csr.val = (double *)calloc((size_t)nnz, sizeof(*csr.val));
+	csr.x = (double *)calloc((size_t)csr.rows, sizeof(*csr.x));
+	csr.y = (double *)calloc((size_t)csr.rows, sizeof(*csr.y));
+	y_ref = (double *)calloc((size_t)csr.rows, sizeof(*y_ref));
+	threads = (stress_spmv_thread_t *)calloc((size_t)threads_n, sizeof(*threads));
+	if (UNLIKELY(!csr.row_ptr || !csr.col_idx || !csr.val || !csr.x ||
+		     !csr.y || !y_ref || !threads)) {
+		test_info->skip_no_mem = true;
+		rc = SPARSE_TEST_ENOMEM;
+		goto err;
+	}
+
+	/* convert to CSR, values are read back from the sparse matrix */
+	t1 = stress_time_now();
+	for (i = 0; i < nnz; i++) {
+		const uint32_t x = (uint32_t)xy[i];
+		const uint32_t y = (uint32_t)(xy[i] >> 32);
+		uint32_t v = value_map(x, y);
+		const uint32_t gv = info->get(handle, x, y);
+
+		if (v == 0)
+			v = ~(uint32_t)0;
+		if (UNLIKELY(gv != v)) {
+			pr_fail("%s: %s mismatch (%" PRIu32 ",%" PRIu32
+				") was %" PRIu32 ", got %" PRIu32 "\n",
+				args->name, info->name, x, y, v, gv);
+			rc = SPARSE_TEST_FAILED;
+			goto err;
+		}
+		csr.row_ptr[y + 1]++;
+		csr.col_idx[i] = x;
+		csr.val[i] = (double)(gv & 0xffff) / 65536.0;
+	}
+	test_info->get_ops += nnz;
+	test_info->get_duration += stress_time_now() - t1;
+	for (row = 0; row < csr.rows; row++) {
+		csr.row_ptr[row + 1] += csr.row_ptr[row];
+		csr.x[row] = 1.0 + (double)(row & 0xff) / 256.0;
+	}
+	free(xy);
+	xy = NULL;
+
+	/* single threaded reference result */
+	csr.iterations = 1;
+	stress_spmv_run(&csr, threads, 1);
+	(void)shim_memcpy(y_ref, csr.y, (size_t)csr.rows * sizeof(*y_ref));
+	(void)shim_memset(csr.y, 0, (size_t)csr.rows * sizeof(*csr.y));
+
+	csr.iterations = (nnz > 0) ? (uint32_t)STRESS_MAXIMUM(1, SPMV_NNZ_PER_RUN / nnz) : 1;
+	t1 = stress_time_now();
+	stress_spmv_run(&csr, threads, threads_n);
+	spmv_info->duration += stress_time_now() - t1;
+	if (UNLIKELY(!stress_continue_flag()))
+		goto err;
+	spmv_info->flops += 2.0 * (double)nnz * (double)csr.iterations;
+	/* values, column indices, row offsets, x and y vectors */
+	spmv_info->bytes += (double)csr.iterations *
+		(((double)nnz * (sizeof(*csr.val) + sizeof(*csr.col_idx))) +
+		 ((double)(csr.rows + 1) * sizeof(*csr.row_ptr)) +
+		 ((double)csr.rows * (sizeof(*csr.x) + sizeof(*csr.y))));
+
+	for (row = 0; row < csr.rows; row++) {
+		if (UNLIKELY(csr.y[row] != y_ref[row])) {
+			pr_fail("%s: %s SpMV row %" PRIu32 " is %f, expected %f\n",
+				args->name, info->name, row, csr.y[row], y_ref[row]);
+			rc = SPARSE_TEST_FAILED;
+			break;
+		}
+	}
+err:
+	free(threads);
+	free(y_ref);
+	stress_spmv_csr_free(&csr);
+	free(xy);
+	info->destroy(handle, &objmem);
+	if (objmem > test_info->max_objmem)
+		test_info->max_objmem = objmem;
+
+	return rc;
+}
+
 /*
  * Table of sparse matrix stress methods
  */
@@ -1331,6 +1604,7 @@ static const stress_opt_t opts[] = {
 	{ OPT_sparsematrix_items,  "sparsematrix-items",  TYPE_ID_UINT64, MIN_SPARSEMATRIX_ITEMS, MAX_SPARSEMATRIX_ITEMS, NULL },
 	{ OPT_sparsematrix_method, "sparsematrix-method", TYPE_ID_SIZE_T_METHOD, 0, 1, sparsematrix_method },
 	{ OPT_sparsematrix_size,   "sparsematrix-size",   TYPE_ID_UINT32, MIN_SPARSEMATRIX_SIZE, MAX_SPARSEMATRIX_SIZE, NULL },
+	{ OPT_sparsematrix_spmv,   "sparsematrix-spmv",   TYPE_ID_UINT32, 0, MAX_SPARSEMATRIX_SPMV_THREADS, NULL },
 	END_OPT,
 };
 
@@ -1354,7 +1628,10 @@ static int stress_sparsematrix(stress_args_t *args)
 	test_info_t test_info[SIZEOF_ARRAY(sparsematrix_methods)];
 	size_t i, begin, end;
 	size_t method = 0;	/* All methods */
+	uint32_t sparsematrix_spmv = 0;
+	stress_spmv_info_t spmv_info;
 
+	(void)shim_memset(&spmv_info, 0, sizeof(spmv_info));
 	for (i = 0; i < SIZEOF_ARRAY(test_info); i++) {
 		test_info[i].skip_no_mem = false;
 		test_info[i].max_objmem = 0;
@@ -1365,6 +1642,9 @@ static int stress_sparsematrix(stress_args_t *args)
 	}
 
 	(void)stress_get_setting("sparsematrix-method", &method);
+	(void)stress_get_setting("sparsematrix-spmv", &sparsematrix_spmv);
+	if ((sparsematrix_spmv > 0) && (method == 0))
+		method = 1;	/* SpMV uses a single method, default to hash */
 
 	if (!stress_get_setting("sparsematrix-size", &sparsematrix_size)) {
 		if (g_opt_flags & OPT_FLAGS_MAXIMIZE)
@@ -1397,6 +1677,11 @@ static int stress_sparsematrix(stress_args_t *args)
 			args->name, sparsematrix_items,
 			sparsematrix_size, sparsematrix_size,
 			percent_full);
+		if (sparsematrix_spmv > 0)
+			pr_inf("%s: CSR SpMV on %" PRIu32 " thread%s using %s method to populate matrix\n",
+				args->name, sparsematrix_spmv,
+				(sparsematrix_spmv == 1) ? "" : "s",
+				sparsematrix_methods[method].name);
 	}
 
 	stress_set_proc_state(args->name, STRESS_STATE_SYNC_WAIT);
@@ -1404,7 +1689,16 @@ static int stress_sparsematrix(stress_args_t *args)
 	stress_set_proc_state(args->name, STRESS_STATE_RUN);
 
 	do {
-		if (method == 0) {	/* All methods */
+		if (sparsematrix_spmv > 0) {
+			if (UNLIKELY(stress_sparse_spmv_test(args,
+					sparsematrix_items,
+					sparsematrix_size,
+					&sparsematrix_methods[method],
+					&test_info[method],
+					sparsematrix_spmv,
+					&spmv_info) == SPARSE_TEST_FAILED))
+				goto err;
+		} else if (method == 0) {	/* All methods */
 			for (i = 1; i < SIZEOF_ARRAY(sparsematrix_methods); i++) {
 				if (UNLIKELY(stress_sparse_method_test(args,
 						(size_t)sparsematrix_items,
@@ -1455,6 +1749,16 @@ static int stress_sparsematrix(stress_args_t *args)
 				rate, STRESS_METRIC_HARMONIC_MEAN);
 		}
 	}
+	if ((sparsematrix_spmv > 0) && (spmv_info.duration > 0.0)) {
+		const size_t idx = SIZEOF_ARRAY(sparsematrix_methods) * 2;
+
+		stress_metrics_set(args, idx + 0, "SpMV GFLOPS",
+			spmv_info.flops / spmv_info.duration / 1.0E9,
+			STRESS_METRIC_HARMONIC_MEAN);
+		stress_metrics_set(args, idx + 1, "SpMV GB per sec effective bandwidth",
+			spmv_info.bytes / spmv_info.duration / 1.0E9,
+			STRESS_METRIC_HARMONIC_MEAN);
+	}
 
 	rc = EXIT_SUCCESS;
 err:
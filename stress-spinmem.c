@@ -282,6 +282,7 @@ const stressor_info_t stress_spinmem_info = {
 	.stressor = stress_spinmem,
 	.class = CLASS_CPU | CLASS_MEMORY | CLASS_CPU_CACHE,
 	.verify = VERIFY_ALWAYS,
+	.metrics_max = 1,
 	.opts = opts,
 	.help = help
 };
@@ -390,6 +390,7 @@ const stressor_info_t stress_splice_info = {
 	.stressor = stress_splice,
 	.class = CLASS_PIPE_IO | CLASS_OS,
 	.opts = opts,
+	.metrics_max = 1,
 	.help = help
 };
 #else
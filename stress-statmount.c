@@ -214,6 +214,7 @@ const stressor_info_t stress_statmount_info = {
 	.stressor = stress_statmount,
 	.class = CLASS_FILESYSTEM | CLASS_OS,
 	.verify = VERIFY_ALWAYS,
+	.metrics_max = 1,
 	.help = help
 };
 #else
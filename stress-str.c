@@ -18,6 +18,9 @@
  *
  */
 #include "stress-ng.h"
+#include "core-builtin.h"
+#include "core-put.h"
+#include "core-vecmath.h"
 
 #define STR1LEN 256
 #define STR2LEN 128
@@ -48,8 +51,10 @@ typedef struct {
 
 static const stress_help_t help[] = {
 	{ NULL,	"str N",	   "start N workers exercising lib C string functions" },
+	{ NULL,	"str-hit P",	   "place --str-sweep search hits P percent into the string" },
 	{ NULL,	"str-method func", "specify the string function to stress" },
 	{ NULL,	"str-ops N",	   "stop after N bogo string operations" },
+	{ NULL,	"str-sweep",	   "measure GB per sec of string functions from 1 byte to 64K strings" },
 	{ NULL,	NULL,		   NULL }
 };
 
@@ -625,6 +630,321 @@ static size_t stress_str_all(stress_args_t *args, stress_str_args_t *info)
 	return 0;
 }
 
+/*
+ *  --str-sweep, libc and vector reference string function
+ *  throughput over a range of string lengths and alignments
+ */
+#define STR_SWEEP_LEN_MAX	(64 * KB)	/* longest string */
+#define STR_SWEEP_PAD		(128)		/* alignment and over-read slack */
+#define STR_SWEEP_BYTES		(256 * KB)	/* bytes processed per timed batch */
+#define STR_SWEEP_HIT_CHAR	('#')		/* not in the stress_rndstr alphabet */
+#define STR_SWEEP_MISS_CHAR	('$')		/* not in the stress_rndstr alphabet */
+
+#if defined(HAVE_VECMATH) && \
+    ((defined(HAVE_COMPILER_GCC_OR_MUSL) && NEED_GNUC(4,8,4)) ||	\
+     (defined(HAVE_COMPILER_CLANG) && NEED_CLANG(14,0,0)))
+#define STR_SWEEP_REF	(1)
+
+typedef uint8_t stress_str_vec_t __attribute__ ((vector_size (16), may_alias));
+typedef uint64_t stress_str_vec64_t __attribute__ ((vector_size (16)));
+#endif
+
+typedef enum {
+	STR_SWEEP_STRLEN,
+	STR_SWEEP_STRCHR,
+	STR_SWEEP_STRRCHR,
+	STR_SWEEP_STRCMP,
+	STR_SWEEP_STRCPY,
+	STR_SWEEP_REF_STRLEN,
+	STR_SWEEP_REF_STRCHR,
+	STR_SWEEP_MAX,
+} stress_str_sweep_func_t;
+
+static const char * const str_sweep_names[STR_SWEEP_MAX] = {
+	"strlen",
+	"strchr",
+	"strrchr",
+	"strcmp",
+	"strcpy",
+	"ref strlen",
+	"ref strchr",
+};
+
+static const size_t str_sweep_lens[] = {
+	1, 16, 256, 4 * KB, STR_SWEEP_LEN_MAX
+};
+
+#define STR_SWEEP_LENS	(SIZEOF_ARRAY(str_sweep_lens))
+
+/* called via volatile pointers so the compiler cannot use builtins */
+static void * volatile str_sweep_libc[] = {
+	(void *)strlen,
+	(void *)strchr,
+	(void *)strrchr,
+	(void *)strcmp,
+	(void *)strcpy,
+};
+
+typedef struct {
+	double bytes;			/* bytes processed */
+	double duration;		/* time processing */
+} stress_str_sweep_stats_t;
+
+#if defined(STR_SWEEP_REF)
+static inline bool ALWAYS_INLINE stress_str_vec_any(const stress_str_vec64_t v)
+{
+	return (v[0] | v[1]) != 0;
+}
+
+/*
+ *  stress_str_ref_strlen()
+ *	16 byte vector strlen, aligned vector loads may read past
+ *	the terminating NUL but never past the aligned block it is in
+ */
+static size_t OPTIMIZE3 stress_str_ref_strlen(const char *str)
+{
+	const char *ptr = str;
+	const stress_str_vec_t zero = { 0 };
+
+	while (((uintptr_t)ptr & (sizeof(stress_str_vec_t) - 1)) != 0) {
+		if (!*ptr)
+			return (size_t)(ptr - str);
+		ptr++;
+	}
+	while (!stress_str_vec_any((stress_str_vec64_t)(*(const stress_str_vec_t *)ptr == zero)))
+		ptr += sizeof(stress_str_vec_t);
+	while (*ptr)
+		ptr++;
+	return (size_t)(ptr - str);
+}
+
+/*
+ *  stress_str_ref_strchr()
+ *	16 byte vector strchr, tests for the character or NUL
+ */
+static char * OPTIMIZE3 stress_str_ref_strchr(const char *str, const int c)
+{
+	const char *ptr = str;
+	const stress_str_vec_t zero = { 0 };
+	const stress_str_vec_t chr = zero + (uint8_t)c;
+
+	while (((uintptr_t)ptr & (sizeof(stress_str_vec_t) - 1)) != 0) {
+		if (*ptr == (char)c)
+			return (char *)ptr;
+		if (!*ptr)
+			return NULL;
+		ptr++;
+	}
+	for (;;) {
+		const stress_str_vec_t v = *(const stress_str_vec_t *)ptr;
+
+		if (stress_str_vec_any((stress_str_vec64_t)((v == zero) | (v == chr))))
+			break;
+		ptr += sizeof(stress_str_vec_t);
+	}
+	for (;;) {
+		if (*ptr == (char)c)
+			return (char *)ptr;
+		if (!*ptr)
+			return NULL;
+		ptr++;
+	}
+}
+#endif
+
+/*
+ *  stress_str_sweep_run()
+ *	call a string function n times, returns false if
+ *	verifying and the result is not the expected result
+ */
+static bool OPTIMIZE3 stress_str_sweep_run(
+	const stress_str_sweep_func_t func,
+	const char *str,
+	const char *cmp,
+	char *dst,
+	const size_t len,
+	const size_t hit,
+	const size_t n)
+{
+	typedef size_t (*test_strlen_t)(const char *s);
+	typedef char *(*test_strchr_t)(const char *s, int c);
+	typedef int (*test_strcmp_t)(const char *s1, const char *s2);
+	typedef char *(*test_strcpy_t)(char *dest, const char *src);
+
+	register size_t i;
+	uintptr_t sum = 0;
+	bool ok = true;
+
+	switch (func) {
+	case STR_SWEEP_STRLEN: {
+			const test_strlen_t fn = (test_strlen_t)str_sweep_libc[STR_SWEEP_STRLEN];
+
+			for (i = 0; i < n; i++)
+				sum += fn(str);
+			ok = (sum == len * n);
+		}
+		break;
+	case STR_SWEEP_STRCHR:
+	case STR_SWEEP_STRRCHR: {
+			const test_strchr_t fn = (test_strchr_t)str_sweep_libc[func];
+
+			for (i = 0; i < n; i++)
+				sum += (uintptr_t)fn(str, STR_SWEEP_HIT_CHAR);
+			ok = (sum == (uintptr_t)(str + hit) * n);
+		}
+		break;
+	case STR_SWEEP_STRCMP: {
+			const test_strcmp_t fn = (test_strcmp_t)str_sweep_libc[STR_SWEEP_STRCMP];
+
+			for (i = 0; i < n; i++)
+				sum += (fn(str, cmp) != 0);
+			ok = (sum == n);
+		}
+		break;
+	case STR_SWEEP_STRCPY: {
+			const test_strcpy_t fn = (test_strcpy_t)str_sweep_libc[STR_SWEEP_STRCPY];
+
+			for (i = 0; i < n; i++)
+				sum += (uintptr_t)fn(dst, str);
+			ok = (sum == (uintptr_t)dst * n) && !memcmp(dst, str, len + 1);
+		}
+		break;
+#if defined(STR_SWEEP_REF)
+	case STR_SWEEP_REF_STRLEN:
+		for (i = 0; i < n; i++)
+			sum += stress_str_ref_strlen(str);
+		ok = (sum == len * n);
+		break;
+	case STR_SWEEP_REF_STRCHR:
+		for (i = 0; i < n; i++)
+			sum += (uintptr_t)stress_str_ref_strchr(str, STR_SWEEP_HIT_CHAR);
+		ok = (sum == (uintptr_t)(str + hit) * n);
+		break;
+#endif
+	default:
+		break;
+	}
+	stress_uint64_put((uint64_t)sum);
+	return ok;
+}
+
+/*
+ *  stress_str_sweep()
+ *	measure GB per sec of string functions over a range of lengths
+ *	with aligned and unaligned starts, the search character and the
+ *	first difference for strcmp are str_hit percent into the string
+ */
+static int stress_str_sweep(stress_args_t *args, const uint32_t str_hit)
+{
+	const size_t buf_size = STR_SWEEP_LEN_MAX + STR_SWEEP_PAD;
+	stress_str_sweep_stats_t *stats;
+	char *buf, *cmp_buf, *dst_buf;
+	size_t l, align, f;
+	int rc = EXIT_SUCCESS;
+	const bool verify = !!(g_opt_flags & OPT_FLAGS_VERIFY);
+
+	stats = (stress_str_sweep_stats_t *)calloc(STR_SWEEP_MAX * STR_SWEEP_LENS * 2, sizeof(*stats));
+	buf = (char *)stress_mmap_populate(NULL, buf_size * 3, PROT_READ | PROT_WRITE,
+		MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (!stats || (buf == MAP_FAILED)) {
+		pr_inf_skip("%s: cannot allocate string sweep buffers, skipping stressor\n", args->name);
+		if (buf != MAP_FAILED)
+			(void)munmap((void *)buf, buf_size * 3);
+		free(stats);
+		return EXIT_NO_RESOURCE;
+	}
+	stress_set_vma_anon_name(buf, buf_size * 3, "str-sweep");
+	cmp_buf = buf + buf_size;
+	dst_buf = cmp_buf + buf_size;
+
+	stress_set_proc_state(args->name, STRESS_STATE_SYNC_WAIT);
+	stress_sync_start_wait(args);
+	stress_set_proc_state(args->name, STRESS_STATE_RUN);
+
+	do {
+		for (l = 0; l < STR_SWEEP_LENS; l++) {
+			const size_t len = str_sweep_lens[l];
+			const size_t hit = ((len - 1) * str_hit) / 100;
+			const size_t n = STRESS_MAXIMUM(STR_SWEEP_BYTES / len, 1);
+
+			for (align = 0; align < 2; align++) {
+				/* unaligned strings start 1 byte past a 64 byte boundary */
+				char *str = buf + align;
+				char *cmp = cmp_buf + align;
+				char *dst = dst_buf + align;
+
+				stress_rndstr(str, len + 1);
+				str[hit] = STR_SWEEP_HIT_CHAR;
+				(void)shim_memcpy(cmp, str, len + 1);
+				cmp[hit] = STR_SWEEP_MISS_CHAR;
+
+				for (f = 0; f < STR_SWEEP_MAX; f++) {
+					stress_str_sweep_stats_t *s = &stats[((f * STR_SWEEP_LENS) + l) * 2 + align];
+					double t, bytes;
+					bool ok;
+
+#if !defined(STR_SWEEP_REF)
+					if (f >= STR_SWEEP_REF_STRLEN)
+						break;
+#endif
+					t = stress_time_now();
+					ok = stress_str_sweep_run((stress_str_sweep_func_t)f, str, cmp,
+						dst, len, hit, n);
+					s->duration += stress_time_now() - t;
+
+					switch (f) {
+					case STR_SWEEP_STRCHR:
+					case STR_SWEEP_STRCMP:
+					case STR_SWEEP_REF_STRCHR:
+						bytes = (double)(hit + 1);
+						break;
+					default:
+						bytes = (double)len;
+						break;
+					}
+					s->bytes += bytes * (double)n;
+					stress_bogo_inc(args);
+
+					if (UNLIKELY(verify && !ok)) {
+						pr_fail("%s: %s of a %zu byte %saligned string returned an "
+							"unexpected result\n", args->name, str_sweep_names[f],
+							len, align ? "un" : "");
+						rc = EXIT_FAILURE;
+						goto done;
+					}
+					if (UNLIKELY(!stress_continue(args)))
+						goto done;
+				}
+			}
+		}
+	} while (stress_continue(args));
+done:
+	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
+
+	for (f = 0; f < STR_SWEEP_MAX; f++) {
+		for (l = 0; l < STR_SWEEP_LENS; l++) {
+			for (align = 0; align < 2; align++) {
+				const size_t idx = ((f * STR_SWEEP_LENS) + l) * 2 + align;
+				const stress_str_sweep_stats_t *s = &stats[idx];
+				char msg[64];
+
+				if (s->duration <= 0.0)
+					continue;
+				(void)snprintf(msg, sizeof(msg), "%s %zuB %saligned GB per sec",
+					str_sweep_names[f], str_sweep_lens[l], align ? "un" : "");
+				stress_metrics_set(args, idx, msg,
+					s->bytes / (s->duration * (double)GB),
+					STRESS_METRIC_HARMONIC_MEAN);
+			}
+		}
+	}
+
+	(void)munmap((void *)buf, buf_size * 3);
+	free(stats);
+
+	return rc;
+}
+
 /*
  *  stress_str()
  *	stress CPU by doing various string operations
@@ -636,6 +956,13 @@ static int stress_str(stress_args_t *args)
 	stress_str_args_t info;
 	const stress_str_method_info_t *str_method_info;
 	size_t i, j, str_method = 0;
+	bool str_sweep = false;
+	uint32_t str_hit = 100;
+
+	(void)stress_get_setting("str-sweep", &str_sweep);
+	(void)stress_get_setting("str-hit", &str_hit);
+	if (str_sweep)
+		return stress_str_sweep(args, str_hit);
 
 	(void)stress_get_setting("str-method", &str_method);
 	str_method_info = &str_methods[str_method];
@@ -702,7 +1029,9 @@ static const char *stress_str_method(const size_t i)
 }
 
 static const stress_opt_t opts[] = {
+	{ OPT_str_hit,    "str-hit",    TYPE_ID_UINT32, 0, 100, NULL },
 	{ OPT_str_method, "str-method", TYPE_ID_SIZE_T_METHOD, 0, 0, stress_str_method },
+	{ OPT_str_sweep,  "str-sweep",  TYPE_ID_BOOL, 0, 1, NULL },
 	END_OPT,
 };
 
@@ -29,11 +29,14 @@
  *
  */
 #include "stress-ng.h"
+#include "core-builtin.h"
 #include "core-cpu.h"
 #include "core-cpu-cache.h"
+#include "core-mmap.h"
 #include "core-nt-store.h"
 #include "core-numa.h"
 #include "core-pragma.h"
+#include "core-simd.h"
 #include "core-target-clones.h"
 
 #include <math.h>
@@ -48,21 +51,86 @@
 
 #define STORE(dst, src)			dst = src
 
+#define STREAM_KERNEL_COPY		(0)
+#define STREAM_KERNEL_SCALE		(1)
+#define STREAM_KERNEL_ADD		(2)
+#define STREAM_KERNEL_TRIAD		(3)
+#define STREAM_KERNELS			(4)
+
+#if defined(HAVE_ATOMIC_ADD_FETCH) &&	\
+    defined(HAVE_ATOMIC_COMPARE_EXCHANGE) && \
+    defined(HAVE_ATOMIC_LOAD) &&	\
+    defined(HAVE_ATOMIC_STORE)
+#define STREAM_PARALLEL
+#endif
+
 typedef struct {
 	const char *name;
 	const int advice;
 } stress_stream_madvise_info_t;
 
+#define STREAM_METHOD_DEFAULT	(-1)	/* built-in compiler generated kernels */
+#define STREAM_METHOD_AUTO	(-2)	/* widest SIMD kernels available */
+
+typedef struct {
+	const char *name;
+	const int type;
+} stress_stream_method_info_t;
+
+/*
+ *  per-instance --stream-parallel kernel statistics
+ */
+typedef struct {
+	double bytes[STREAM_KERNELS];	/* bytes read + written per kernel */
+	double duration[STREAM_KERNELS];/* time spent per kernel */
+	long int node;			/* NUMA node of arrays, -1 if unknown */
+	uint32_t round;			/* runs of the instance, the barrier round */
+	bool valid;			/* set if statistics are valid */
+} stress_stream_instance_t;
+
+/*
+ *  --stream-parallel shared state, instances barrier
+ *  synchronize on the start of each kernel phase. The shared
+ *  state lives for all the --seq or --permute rounds of the
+ *  stressor, so the arrivals and aborts are keyed by round
+ */
+typedef struct {
+	uint32_t instances;		/* number of instances in barrier */
+	uint64_t arrived;		/* round << 32 | instances arrived */
+	uint32_t generation;		/* barrier generation */
+	uint32_t abort_round;		/* round an instance stopped in, 0 = none */
+	size_t size;			/* size of the mapping */
+	stress_stream_instance_t instance[];
+} stress_stream_shared_t;
+
+static const char * const stream_kernel_names[STREAM_KERNELS] = {
+	"copy", "scale", "add", "triad"
+};
+
+static stress_stream_shared_t *stream_shared = NULL;
+
 static const stress_help_t help[] = {
 	{ NULL,	"stream N",		"start N workers exercising memory bandwidth" },
 	{ NULL,	"stream-index N",	"specify number of indices into the data (0..3)" },
 	{ NULL,	"stream-l3-size N",	"specify the L3 cache size of the CPU" },
 	{ NULL,	"stream-madvise M",	"specify mmap'd stream buffer madvise advice" },
+	{ NULL,	"stream-method M",	"specify stream kernel method" },
 	{ NULL,	"stream-mlock",		"attempt to mlock pages into memory" },
 	{ NULL,	"stream-ops N",		"stop after N bogo stream operations" },
+	{ NULL,	"stream-parallel",	"synchronize instances per kernel, report aggregate bandwidth" },
 	{ NULL,	NULL,                   NULL }
 };
 
+static const stress_stream_method_info_t stream_method_info[] = {
+	{ "default",	STREAM_METHOD_DEFAULT },
+	{ "auto",	STREAM_METHOD_AUTO },
+	{ "avx512",	STRESS_SIMD_AVX512 },
+	{ "avx2",	STRESS_SIMD_AVX2 },
+	{ "sse2",	STRESS_SIMD_SSE2 },
+	{ "sve",	STRESS_SIMD_SVE },
+	{ "neon",	STRESS_SIMD_NEON },
+};
+
 static const stress_stream_madvise_info_t stream_madvise_info[] = {
 #if !defined(HAVE_MADVISE)
 	/* No MADVISE, default to normal, ignored */
@@ -656,17 +724,18 @@ PRAGMA_UNROLL_N(8)
 static inline void *stress_stream_mmap(
 	stress_args_t *args,
 	const uint64_t sz,
-	const bool stream_mlock)
+	const bool stream_mlock,
+	size_t *mapped_sz)
 {
 	void *ptr;
 
-	ptr = stress_mmap_populate(NULL, (size_t)sz, PROT_READ | PROT_WRITE,
+	ptr = stress_mmap_hugetlb(args, (size_t)sz, PROT_READ | PROT_WRITE,
 #if defined(HAVE_MADVISE)
 		MAP_PRIVATE |
 #else
 		MAP_SHARED |
 #endif
-		MAP_ANONYMOUS, -1, 0);
+		MAP_ANONYMOUS, true, mapped_sz);
 	/* Coverity Scan believes NULL can be returned, doh */
 	if (!ptr || (ptr == MAP_FAILED)) {
 		pr_err("%s: cannot allocate %" PRIu64 " bytes\n",
@@ -764,6 +833,215 @@ static void stress_stream_init_index(
 	}
 }
 
+/*
+ *  stress_stream_simd_kernel()
+ *	run one of the 4 STREAM kernels using explicit SIMD
+ *	kernels, only for direct (non-indexed) array access
+ */
+static void stress_stream_simd_kernel(
+	const stress_simd_method_t *simd,
+	const int kernel,
+	double *const RESTRICT a,
+	double *const RESTRICT b,
+	double *const RESTRICT c,
+	const double q,
+	const uint64_t n,
+	double *const RESTRICT rd_bytes,
+	double *const RESTRICT wr_bytes,
+	double *const RESTRICT fp_ops)
+{
+	const double bytes = (double)n * (double)sizeof(double);
+
+	switch (kernel) {
+	case STREAM_KERNEL_COPY:
+		simd->copy(c, a, (size_t)n * sizeof(double));
+		*rd_bytes += bytes;
+		break;
+	case STREAM_KERNEL_SCALE:
+		simd->scale(b, c, q, (size_t)n);
+		*rd_bytes += bytes;
+		*fp_ops += (double)n;
+		break;
+	case STREAM_KERNEL_ADD:
+		simd->add(c, b, a, (size_t)n);
+		*rd_bytes += bytes * 2.0;
+		*fp_ops += (double)n;
+		break;
+	default:
+		simd->triad(a, b, c, q, (size_t)n);
+		*rd_bytes += bytes * 2.0;
+		*fp_ops += (double)n * 2.0;
+		break;
+	}
+	*wr_bytes += bytes;
+}
+
+/*
+ *  stress_stream_kernel()
+ *	run one of the 4 STREAM kernels using the given indexing mode
+ */
+static void stress_stream_kernel(
+	const int kernel,
+	const uint32_t stream_index,
+	const bool nt,
+	const stress_simd_method_t *simd,
+	double *const RESTRICT a,
+	double *const RESTRICT b,
+	double *const RESTRICT c,
+	const double q,
+	size_t *const RESTRICT idx1,
+	size_t *const RESTRICT idx2,
+	size_t *const RESTRICT idx3,
+	const uint64_t n,
+	double *const RESTRICT rd_bytes,
+	double *const RESTRICT wr_bytes,
+	double *const RESTRICT fp_ops)
+{
+#if !defined(HAVE_NT_STORE_DOUBLE)
+	(void)nt;
+#endif
+	switch (stream_index) {
+	case 3:
+		switch (kernel) {
+		case STREAM_KERNEL_COPY:
+			stress_stream_copy_index3(c, a, idx1, idx2, idx3, n, rd_bytes, wr_bytes, fp_ops);
+			break;
+		case STREAM_KERNEL_SCALE:
+			stress_stream_scale_index3(b, c, q, idx1, idx2, idx3, n, rd_bytes, wr_bytes, fp_ops);
+			break;
+		case STREAM_KERNEL_ADD:
+			stress_stream_add_index3(c, b, a, idx1, idx2, idx3, n, rd_bytes, wr_bytes, fp_ops);
+			break;
+		default:
+			stress_stream_triad_index3(a, b, c, q, idx1, idx2, idx3, n, rd_bytes, wr_bytes, fp_ops);
+			break;
+		}
+		break;
+	case 2:
+		switch (kernel) {
+		case STREAM_KERNEL_COPY:
+			stress_stream_copy_index2(c, a, idx1, idx2, n, rd_bytes, wr_bytes, fp_ops);
+			break;
+		case STREAM_KERNEL_SCALE:
+			stress_stream_scale_index2(b, c, q, idx1, idx2, n, rd_bytes, wr_bytes, fp_ops);
+			break;
+		case STREAM_KERNEL_ADD:
+			stress_stream_add_index2(c, b, a, idx1, idx2, n, rd_bytes, wr_bytes, fp_ops);
+			break;
+		default:
+			stress_stream_triad_index2(a, b, c, q, idx1, idx2, n, rd_bytes, wr_bytes, fp_ops);
+			break;
+		}
+		break;
+	case 1:
+		switch (kernel) {
+		case STREAM_KERNEL_COPY:
+			stress_stream_copy_index1(c, a, idx1, n, rd_bytes, wr_bytes, fp_ops);
+			break;
+		case STREAM_KERNEL_SCALE:
+			stress_stream_scale_index1(b, c, q, idx1, n, rd_bytes, wr_bytes, fp_ops);
+			break;
+		case STREAM_KERNEL_ADD:
+			stress_stream_add_index1(c, b, a, idx1, n, rd_bytes, wr_bytes, fp_ops);
+			break;
+		default:
+			stress_stream_triad_index1(a, b, c, q, idx1, n, rd_bytes, wr_bytes, fp_ops);
+			break;
+		}
+		break;
+	case 0:
+	default:
+		if (simd) {
+			stress_stream_simd_kernel(simd, kernel, a, b, c, q, n,
+				rd_bytes, wr_bytes, fp_ops);
+			break;
+		}
+#if defined(HAVE_NT_STORE_DOUBLE)
+		if (nt) {
+			switch (kernel) {
+			case STREAM_KERNEL_COPY:
+				stress_stream_copy_index0_nt(c, a, n, rd_bytes, wr_bytes, fp_ops);
+				break;
+			case STREAM_KERNEL_SCALE:
+				stress_stream_scale_index0_nt(b, c, q, n, rd_bytes, wr_bytes, fp_ops);
+				break;
+			case STREAM_KERNEL_ADD:
+				stress_stream_add_index0_nt(c, b, a, n, rd_bytes, wr_bytes, fp_ops);
+				break;
+			default:
+				stress_stream_triad_index0_nt(a, b, c, q, n, rd_bytes, wr_bytes, fp_ops);
+				break;
+			}
+			break;
+		}
+#endif
+		switch (kernel) {
+		case STREAM_KERNEL_COPY:
+			stress_stream_copy_index0(c, a, n, rd_bytes, wr_bytes, fp_ops);
+			break;
+		case STREAM_KERNEL_SCALE:
+			stress_stream_scale_index0(b, c, q, n, rd_bytes, wr_bytes, fp_ops);
+			break;
+		case STREAM_KERNEL_ADD:
+			stress_stream_add_index0(c, b, a, n, rd_bytes, wr_bytes, fp_ops);
+			break;
+		default:
+			stress_stream_triad_index0(a, b, c, q, n, rd_bytes, wr_bytes, fp_ops);
+			break;
+		}
+		break;
+	}
+}
+
+#if defined(STREAM_PARALLEL)
+/*
+ *  stress_stream_barrier()
+ *	wait for all the --stream-parallel instances of the round
+ *	to arrive, returns false if an instance has stopped in the
+ *	round or the run is over. Rounds do not overlap, the first
+ *	arrival of a round discards the count of earlier rounds
+ */
+static bool stress_stream_barrier(const uint32_t round)
+{
+	const uint32_t generation = __atomic_load_n(&stream_shared->generation, __ATOMIC_ACQUIRE);
+	uint64_t arrived, next;
+
+	if (__atomic_load_n(&stream_shared->abort_round, __ATOMIC_ACQUIRE) == round)
+		return false;
+
+	arrived = __atomic_load_n(&stream_shared->arrived, __ATOMIC_ACQUIRE);
+	do {
+		next = ((uint32_t)(arrived >> 32) == round) ?
+			arrived + 1 : (((uint64_t)round << 32) | 1);
+	} while (!__atomic_compare_exchange_n(&stream_shared->arrived, &arrived, next,
+			false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE));
+
+	if ((uint32_t)next >= stream_shared->instances) {
+		/* last to arrive, release the others */
+		__atomic_store_n(&stream_shared->arrived, (uint64_t)round << 32, __ATOMIC_RELAXED);
+		(void)__atomic_add_fetch(&stream_shared->generation, 1, __ATOMIC_RELEASE);
+		return true;
+	}
+	while (__atomic_load_n(&stream_shared->generation, __ATOMIC_ACQUIRE) == generation) {
+		if ((__atomic_load_n(&stream_shared->abort_round, __ATOMIC_ACQUIRE) == round) ||
+		    UNLIKELY(!stress_continue_flag()))
+			return false;
+		(void)shim_sched_yield();
+	}
+	return true;
+}
+
+/*
+ *  stress_stream_barrier_abort()
+ *	stop all the other instances of the round waiting in the barrier
+ */
+static void stress_stream_barrier_abort(const uint32_t round)
+{
+	if (stream_shared)
+		__atomic_store_n(&stream_shared->abort_round, round, __ATOMIC_RELEASE);
+}
+#endif
+
 /*
  *  stress_stream()
  *	stress cache/memory/CPU with stream stressors
@@ -773,6 +1051,7 @@ static int stress_stream(stress_args_t *args)
 	int rc = EXIT_FAILURE;
 	double *a = MAP_FAILED, *b = MAP_FAILED, *c = MAP_FAILED;
 	size_t *idx1 = MAP_FAILED, *idx2 = MAP_FAILED, *idx3 = MAP_FAILED;
+	size_t sz_a = 0, sz_b = 0, sz_c = 0, sz_idx1 = 0, sz_idx2 = 0, sz_idx3 = 0;
 	const double q = 3.0;
 	double old_checksum = -1.0;
 	double fp_ops = 0.0, t1, t2, dt;
@@ -782,15 +1061,44 @@ static int stress_stream(stress_args_t *args)
 	uint32_t init_counter, init_counter_max;
 	bool guess = false;
 	bool stream_mlock = false;
+	bool stream_parallel = false;
+	size_t stream_method = 0;
+	const stress_simd_method_t *simd = NULL;
 #if defined(HAVE_NT_STORE_DOUBLE)
 	const bool has_sse2 = stress_cpu_x86_has_sse2();
 #endif
 	double rd_bytes = 0.0, wr_bytes = 0.0;
 	const bool verify = !!(g_opt_flags & OPT_FLAGS_VERIFY);
+	stress_stream_instance_t *inst = NULL;
+	stress_numa_mask_t *numa_mask = NULL;
+#if defined(STREAM_PARALLEL)
+	uint32_t round = 0;
+#endif
+	long int node = -1;
 
 	stress_catch_sigill();
 
 	(void)stress_get_setting("stream-mlock", &stream_mlock);
+	(void)stress_get_setting("stream-parallel", &stream_parallel);
+#if defined(STREAM_PARALLEL)
+	if (stream_parallel) {
+		if (stream_shared && (args->instance < stream_shared->instances)) {
+			inst = &stream_shared->instance[args->instance];
+			/* every round runs all the instances, so the runs count the rounds */
+			round = ++inst->round;
+		} else {
+			if (args->instance == 0)
+				pr_inf("%s: cannot allocate --stream-parallel shared data, "
+					"running instances independently\n", args->name);
+			stream_parallel = false;
+		}
+	}
+#else
+	if (stream_parallel && (args->instance == 0))
+		pr_inf("%s: --stream-parallel requires atomic operations, "
+			"running instances independently\n", args->name);
+	stream_parallel = false;
+#endif
 
 	if (stress_get_setting("stream-l3-size", &stream_L3_size))
 		L3 = stream_L3_size;
@@ -798,6 +1106,32 @@ static int stress_stream(stress_args_t *args)
 		L3 = get_stream_L3_size(args);
 
 	(void)stress_get_setting("stream-index", &stream_index);
+	(void)stress_get_setting("stream-method", &stream_method);
+
+	switch (stream_method_info[stream_method].type) {
+	case STREAM_METHOD_DEFAULT:
+		break;
+	case STREAM_METHOD_AUTO:
+		simd = stress_simd_method_best();
+		if (!simd && (args->instance == 0))
+			pr_inf("%s: no SIMD stream kernels available, using default kernels\n",
+				args->name);
+		break;
+	default:
+		simd = stress_simd_method((stress_simd_type_t)stream_method_info[stream_method].type);
+		if (!simd && (args->instance == 0))
+			pr_inf("%s: %s stream kernels not supported, using default kernels\n",
+				args->name, stream_method_info[stream_method].name);
+		break;
+	}
+	if (simd && (stream_index != 0)) {
+		if (args->instance == 0)
+			pr_inf("%s: --stream-method %s is only used with --stream-index 0, "
+				"using default kernels\n", args->name, simd->name);
+		simd = NULL;
+	}
+	if (simd && (args->instance == 0))
+		pr_inf("%s: using %s SIMD stream kernels\n", args->name, simd->name);
 
 	/* Have to take a hunch and badly guess size */
 	if (!L3) {
@@ -838,33 +1172,48 @@ static int stress_stream(stress_args_t *args)
 	sz = n * sizeof(*a);
 	sz_idx = n * sizeof(size_t);
 
-	a = stress_stream_mmap(args, sz, stream_mlock);
+	a = stress_stream_mmap(args, sz, stream_mlock, &sz_a);
 	if (a == MAP_FAILED)
 		goto err_unmap;
-	b = stress_stream_mmap(args, sz, stream_mlock);
+	b = stress_stream_mmap(args, sz, stream_mlock, &sz_b);
 	if (b == MAP_FAILED)
 		goto err_unmap;
-	c = stress_stream_mmap(args, sz, stream_mlock);
+	c = stress_stream_mmap(args, sz, stream_mlock, &sz_c);
 	if (c == MAP_FAILED)
 		goto err_unmap;
 
+	if (stream_parallel) {
+		/* place the arrays on the NUMA node this instance is running on */
+		numa_mask = stress_numa_mask_alloc();
+		node = stress_numa_bind_local(numa_mask, a, (size_t)sz);
+		if (node >= 0) {
+			(void)stress_numa_bind_local(numa_mask, b, (size_t)sz);
+			(void)stress_numa_bind_local(numa_mask, c, (size_t)sz);
+		} else {
+			unsigned int cpu, cpu_node;
+
+			if (shim_getcpu(&cpu, &cpu_node, NULL) == 0)
+				node = (long int)cpu_node;
+		}
+	}
+
 	switch (stream_index) {
 	case 3:
-		idx3 = stress_stream_mmap(args, sz_idx, stream_mlock);
+		idx3 = stress_stream_mmap(args, sz_idx, stream_mlock, &sz_idx3);
 		if (idx3 == MAP_FAILED)
 			goto err_unmap;
 		stress_stream_init_index(idx3, n);
 		goto case_stream_index_2;
 	case 2:
 case_stream_index_2:
-		idx2 = stress_stream_mmap(args, sz_idx, stream_mlock);
+		idx2 = stress_stream_mmap(args, sz_idx, stream_mlock, &sz_idx2);
 		if (idx2 == MAP_FAILED)
 			goto err_unmap;
 		stress_stream_init_index(idx2, n);
 		goto case_stream_index_1;
 	case 1:
 case_stream_index_1:
-		idx1 = stress_stream_mmap(args, sz_idx, stream_mlock);
+		idx1 = stress_stream_mmap(args, sz_idx, stream_mlock, &sz_idx1);
 		if (idx1 == MAP_FAILED)
 			goto err_unmap;
 		stress_stream_init_index(idx1, n);
@@ -894,53 +1243,93 @@ case_stream_index_1:
 		if (init_counter >= init_counter_max)
 			init_counter = 0;
 
-		switch (stream_index) {
-		case 3:
-			t1 = stress_time_now();
-			stress_stream_copy_index3(c, a, idx1, idx2, idx3, n, &rd_bytes, &wr_bytes, &fp_ops);
-			stress_stream_scale_index3(b, c, q, idx1, idx2, idx3, n, &rd_bytes, &wr_bytes, &fp_ops);
-			stress_stream_add_index3(c, b, a, idx1, idx2, idx3, n, &rd_bytes, &wr_bytes, &fp_ops);
-			stress_stream_triad_index3(a, b, c, q, idx1, idx2, idx3, n, &rd_bytes, &wr_bytes, &fp_ops);
-			t2 = stress_time_now();
-			break;
-		case 2:
-			t1 = stress_time_now();
-			stress_stream_copy_index2(c, a, idx1, idx2, n, &rd_bytes, &wr_bytes, &fp_ops);
-			stress_stream_scale_index2(b, c, q, idx1, idx2, n, &rd_bytes, &wr_bytes, &fp_ops);
-			stress_stream_add_index2(c, b, a, idx1, idx2, n, &rd_bytes, &wr_bytes, &fp_ops);
-			stress_stream_triad_index2(a, b, c, q, idx1, idx2, n, &rd_bytes, &wr_bytes, &fp_ops);
-			t2 = stress_time_now();
-			break;
-		case 1:
-			t1 = stress_time_now();
-			stress_stream_copy_index1(c, a, idx1, n, &rd_bytes, &wr_bytes, &fp_ops);
-			stress_stream_scale_index1(b, c, q, idx1, n, &rd_bytes, &wr_bytes, &fp_ops);
-			stress_stream_add_index1(c, b, a, idx1, n, &rd_bytes, &wr_bytes, &fp_ops);
-			stress_stream_triad_index1(a, b, c, q, idx1, n, &rd_bytes, &wr_bytes, &fp_ops);
-			t2 = stress_time_now();
-			break;
-		case 0:
-		default:
+#if defined(STREAM_PARALLEL)
+		if (stream_parallel) {
+			int k;
+			bool stop = false;
 #if defined(HAVE_NT_STORE_DOUBLE)
-			if (has_sse2) {
+			const bool nt = has_sse2;
+#else
+			const bool nt = false;
+#endif
+
+			for (k = 0; k < STREAM_KERNELS; k++) {
+				const double bytes = rd_bytes + wr_bytes;
+
+				if (!stress_stream_barrier(round)) {
+					stop = true;
+					break;
+				}
 				t1 = stress_time_now();
-				stress_stream_copy_index0_nt(c, a, n, &rd_bytes, &wr_bytes, &fp_ops);
-				stress_stream_scale_index0_nt(b, c, q, n, &rd_bytes, &wr_bytes, &fp_ops);
-				stress_stream_add_index0_nt(c, b, a, n,  &rd_bytes, &wr_bytes, &fp_ops);
-				stress_stream_triad_index0_nt(a, b, c, q, n, &rd_bytes, &wr_bytes, &fp_ops);
+				stress_stream_kernel(k, stream_index, nt, simd, a, b, c, q,
+					idx1, idx2, idx3, n, &rd_bytes, &wr_bytes, &fp_ops);
 				t2 = stress_time_now();
-				break;
+				inst->duration[k] += (t2 - t1);
+				inst->bytes[k] += (rd_bytes + wr_bytes) - bytes;
+				dt += (t2 - t1);
 			}
+			if (stop)
+				break;
+		} else
 #endif
-			t1 = stress_time_now();
-			stress_stream_copy_index0(c, a, n, &rd_bytes, &wr_bytes, &fp_ops);
-			stress_stream_scale_index0(b, c, q, n, &rd_bytes, &wr_bytes, &fp_ops);
-			stress_stream_add_index0(c, b, a, n, &rd_bytes, &wr_bytes, &fp_ops);
-			stress_stream_triad_index0(a, b, c, q, n, &rd_bytes, &wr_bytes, &fp_ops);
-			t2 = stress_time_now();
-			break;
+		{
+			switch (stream_index) {
+			case 3:
+				t1 = stress_time_now();
+				stress_stream_copy_index3(c, a, idx1, idx2, idx3, n, &rd_bytes, &wr_bytes, &fp_ops);
+				stress_stream_scale_index3(b, c, q, idx1, idx2, idx3, n, &rd_bytes, &wr_bytes, &fp_ops);
+				stress_stream_add_index3(c, b, a, idx1, idx2, idx3, n, &rd_bytes, &wr_bytes, &fp_ops);
+				stress_stream_triad_index3(a, b, c, q, idx1, idx2, idx3, n, &rd_bytes, &wr_bytes, &fp_ops);
+				t2 = stress_time_now();
+				break;
+			case 2:
+				t1 = stress_time_now();
+				stress_stream_copy_index2(c, a, idx1, idx2, n, &rd_bytes, &wr_bytes, &fp_ops);
+				stress_stream_scale_index2(b, c, q, idx1, idx2, n, &rd_bytes, &wr_bytes, &fp_ops);
+				stress_stream_add_index2(c, b, a, idx1, idx2, n, &rd_bytes, &wr_bytes, &fp_ops);
+				stress_stream_triad_index2(a, b, c, q, idx1, idx2, n, &rd_bytes, &wr_bytes, &fp_ops);
+				t2 = stress_time_now();
+				break;
+			case 1:
+				t1 = stress_time_now();
+				stress_stream_copy_index1(c, a, idx1, n, &rd_bytes, &wr_bytes, &fp_ops);
+				stress_stream_scale_index1(b, c, q, idx1, n, &rd_bytes, &wr_bytes, &fp_ops);
+				stress_stream_add_index1(c, b, a, idx1, n, &rd_bytes, &wr_bytes, &fp_ops);
+				stress_stream_triad_index1(a, b, c, q, idx1, n, &rd_bytes, &wr_bytes, &fp_ops);
+				t2 = stress_time_now();
+				break;
+			case 0:
+			default:
+				if (simd) {
+					t1 = stress_time_now();
+					stress_stream_simd_kernel(simd, STREAM_KERNEL_COPY, a, b, c, q, n, &rd_bytes, &wr_bytes, &fp_ops);
+					stress_stream_simd_kernel(simd, STREAM_KERNEL_SCALE, a, b, c, q, n, &rd_bytes, &wr_bytes, &fp_ops);
+					stress_stream_simd_kernel(simd, STREAM_KERNEL_ADD, a, b, c, q, n, &rd_bytes, &wr_bytes, &fp_ops);
+					stress_stream_simd_kernel(simd, STREAM_KERNEL_TRIAD, a, b, c, q, n, &rd_bytes, &wr_bytes, &fp_ops);
+					t2 = stress_time_now();
+					break;
+				}
+#if defined(HAVE_NT_STORE_DOUBLE)
+				if (has_sse2) {
+					t1 = stress_time_now();
+					stress_stream_copy_index0_nt(c, a, n, &rd_bytes, &wr_bytes, &fp_ops);
+					stress_stream_scale_index0_nt(b, c, q, n, &rd_bytes, &wr_bytes, &fp_ops);
+					stress_stream_add_index0_nt(c, b, a, n,  &rd_bytes, &wr_bytes, &fp_ops);
+					stress_stream_triad_index0_nt(a, b, c, q, n, &rd_bytes, &wr_bytes, &fp_ops);
+					t2 = stress_time_now();
+					break;
+				}
+#endif
+				t1 = stress_time_now();
+				stress_stream_copy_index0(c, a, n, &rd_bytes, &wr_bytes, &fp_ops);
+				stress_stream_scale_index0(b, c, q, n, &rd_bytes, &wr_bytes, &fp_ops);
+				stress_stream_add_index0(c, b, a, n, &rd_bytes, &wr_bytes, &fp_ops);
+				stress_stream_triad_index0(a, b, c, q, n, &rd_bytes, &wr_bytes, &fp_ops);
+				t2 = stress_time_now();
+				break;
+			}
+			dt += (t2 - t1);
 		}
-		dt += (t2 - t1);
 
 		if (verify) {
 			double new_checksum;
@@ -963,6 +1352,11 @@ case_stream_index_1:
 		stress_bogo_inc(args);
 	} while (stress_continue(args));
 
+#if defined(STREAM_PARALLEL)
+	if (stream_parallel)
+		stress_stream_barrier_abort(round);
+#endif
+
 	if (dt >= 4.5) {
 		const double mb_rd_rate = (rd_bytes / (double)MB) / dt;
 		const double mb_wr_rate = (wr_bytes / (double)MB) / dt;
@@ -977,6 +1371,25 @@ case_stream_index_1:
 			mb_wr_rate, STRESS_METRIC_HARMONIC_MEAN);
 		stress_metrics_set(args, 2, "Mflop per sec (double precision) compute rate",
 			fp_rate, STRESS_METRIC_HARMONIC_MEAN);
+		if (inst) {
+			double rate[STREAM_KERNELS];
+			int k;
+
+			for (k = 0; k < STREAM_KERNELS; k++) {
+				rate[k] = (inst->duration[k] > 0.0) ?
+					(inst->bytes[k] / (double)GB) / inst->duration[k] : 0.0;
+			}
+			stress_metrics_set(args, 3, "GB per sec copy aggregate rate",
+				rate[STREAM_KERNEL_COPY], STRESS_METRIC_TOTAL);
+			stress_metrics_set(args, 4, "GB per sec scale aggregate rate",
+				rate[STREAM_KERNEL_SCALE], STRESS_METRIC_TOTAL);
+			stress_metrics_set(args, 5, "GB per sec add aggregate rate",
+				rate[STREAM_KERNEL_ADD], STRESS_METRIC_TOTAL);
+			stress_metrics_set(args, 6, "GB per sec triad aggregate rate",
+				rate[STREAM_KERNEL_TRIAD], STRESS_METRIC_TOTAL);
+			inst->node = node;
+			inst->valid = true;
+		}
 	} else {
 		if (args->instance == 0)
 			pr_inf("%s: run duration too short to reliably determine memory rate\n", args->name);
@@ -984,21 +1397,144 @@ case_stream_index_1:
 
 err_unmap:
 	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
+#if defined(STREAM_PARALLEL)
+	if (stream_parallel)
+		stress_stream_barrier_abort(round);
+#endif
+	stress_numa_mask_free(numa_mask);
 	if (idx3 != MAP_FAILED)
-		(void)munmap((void *)idx3, sz_idx);
+		(void)munmap((void *)idx3, sz_idx3);
 	if (idx2 != MAP_FAILED)
-		(void)munmap((void *)idx2, sz_idx);
+		(void)munmap((void *)idx2, sz_idx2);
 	if (idx1 != MAP_FAILED)
-		(void)munmap((void *)idx1, sz_idx);
+		(void)munmap((void *)idx1, sz_idx1);
 	if (c != MAP_FAILED)
-		(void)munmap((void *)c, sz);
+		(void)munmap((void *)c, sz_c);
 	if (b != MAP_FAILED)
-		(void)munmap((void *)b, sz);
+		(void)munmap((void *)b, sz_b);
 	if (a != MAP_FAILED)
-		(void)munmap((void *)a, sz);
+		(void)munmap((void *)a, sz_a);
 	return rc;
 }
 
+/*
+ *  stress_stream_init()
+ *	allocate --stream-parallel shared state
+ */
+static void stress_stream_init(const uint32_t instances)
+{
+#if defined(STREAM_PARALLEL)
+	stress_stream_shared_t *shared;
+	bool stream_parallel = false;
+	size_t size;
+	uint32_t i;
+
+	(void)stress_get_setting("stream-parallel", &stream_parallel);
+	if (!stream_parallel || (instances < 1))
+		return;
+
+	size = sizeof(*shared) + ((size_t)instances * sizeof(shared->instance[0]));
+	shared = (stress_stream_shared_t *)mmap(NULL, size, PROT_READ | PROT_WRITE,
+				MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+	if (shared == MAP_FAILED)
+		return;
+	stress_set_vma_anon_name(shared, size, "stream-parallel");
+	(void)shim_memset(shared, 0, size);
+	shared->instances = instances;
+	shared->size = size;
+	for (i = 0; i < instances; i++)
+		shared->instance[i].node = -1;
+	stream_shared = shared;
+#else
+	(void)instances;
+#endif
+}
+
+/*
+ *  stress_stream_deinit()
+ *	report --stream-parallel aggregate bandwidth per NUMA node
+ */
+static void stress_stream_deinit(void)
+{
+	uint32_t i, j, valid = 0;
+	double total[STREAM_KERNELS];
+	int k;
+
+	if (!stream_shared)
+		return;
+
+	for (k = 0; k < STREAM_KERNELS; k++)
+		total[k] = 0.0;
+
+	for (i = 0; i < stream_shared->instances; i++) {
+		if (stream_shared->instance[i].valid)
+			valid++;
+	}
+	if (!valid)
+		goto unmap;
+
+	pr_block_begin();
+	pr_inf("stream: aggregate bandwidth (GB/sec) of %" PRIu32 " synchronized instances:\n", valid);
+	pr_inf("stream: %6s %5s %10s %10s %10s %10s\n", "node", "inst",
+		stream_kernel_names[0], stream_kernel_names[1],
+		stream_kernel_names[2], stream_kernel_names[3]);
+
+	for (i = 0; i < stream_shared->instances; i++) {
+		const stress_stream_instance_t *inst = &stream_shared->instance[i];
+		const long int node = inst->node;
+		double rate[STREAM_KERNELS];
+		uint32_t count = 0;
+		char node_str[24];
+
+		if (!inst->valid)
+			continue;
+
+		/* only report a node on the first instance that uses it */
+		for (j = 0; j < i; j++) {
+			if (stream_shared->instance[j].valid &&
+			    (stream_shared->instance[j].node == node))
+				break;
+		}
+		if (j < i)
+			continue;
+
+		for (k = 0; k < STREAM_KERNELS; k++)
+			rate[k] = 0.0;
+		for (j = i; j < stream_shared->instances; j++) {
+			const stress_stream_instance_t *other = &stream_shared->instance[j];
+
+			if (!other->valid || (other->node != node))
+				continue;
+			for (k = 0; k < STREAM_KERNELS; k++) {
+				if (other->duration[k] > 0.0)
+					rate[k] += (other->bytes[k] / (double)GB) / other->duration[k];
+			}
+			count++;
+		}
+		for (k = 0; k < STREAM_KERNELS; k++)
+			total[k] += rate[k];
+
+		if (node < 0)
+			(void)shim_strscpy(node_str, "?", sizeof(node_str));
+		else
+			(void)snprintf(node_str, sizeof(node_str), "%ld", node);
+		pr_inf("stream: %6s %5" PRIu32 " %10.3f %10.3f %10.3f %10.3f\n",
+			node_str, count, rate[0], rate[1], rate[2], rate[3]);
+	}
+	pr_inf("stream: %6s %5" PRIu32 " %10.3f %10.3f %10.3f %10.3f\n",
+		"total", valid, total[0], total[1], total[2], total[3]);
+	pr_block_end();
+
+unmap:
+	(void)munmap((void *)stream_shared, stream_shared->size);
+	stream_shared = NULL;
+}
+
+static const char *stress_stream_method(const size_t i)
+{
+	return (i < SIZEOF_ARRAY(stream_method_info)) ? stream_method_info[i].name : NULL;
+}
+
 static const char *stress_stream_madvise(const size_t i)
 {
 	return (i < SIZEOF_ARRAY(stream_madvise_info)) ? stream_madvise_info[i].name : NULL;
@@ -1008,7 +1544,9 @@ static const stress_opt_t opts[] = {
 	{ OPT_stream_index,   "stream-index",   TYPE_ID_UINT32, 0, 3, NULL },
 	{ OPT_stream_l3_size, "stream-l3-size", TYPE_ID_UINT64_BYTES_VM, MIN_STREAM_L3_SIZE, MAX_STREAM_L3_SIZE, NULL },
 	{ OPT_stream_madvise, "stream-madvise", TYPE_ID_SIZE_T_METHOD, 0, 0, stress_stream_madvise },
+	{ OPT_stream_method,  "stream-method",  TYPE_ID_SIZE_T_METHOD, 0, 0, stress_stream_method },
 	{ OPT_stream_mlock,   "stream-mlock",   TYPE_ID_BOOL, 0, 1, NULL },
+	{ OPT_stream_parallel,"stream-parallel",TYPE_ID_BOOL, 0, 1, NULL },
 	END_OPT,
 };
 
@@ -1016,6 +1554,9 @@ const stressor_info_t stress_stream_info = {
 	.stressor = stress_stream,
 	.class = CLASS_CPU | CLASS_FP | CLASS_CPU_CACHE | CLASS_MEMORY,
 	.opts = opts,
+	.init = stress_stream_init,
+	.deinit = stress_stream_deinit,
 	.verify = VERIFY_OPTIONAL,
+	.metrics_max = 7,
 	.help = help
 };
@@ -22,6 +22,7 @@
 #include "core-capabilities.h"
 #include "core-madvise.h"
 #include "core-out-of-memory.h"
+#include "core-swapstat.h"
 
 #include <sys/ioctl.h>
 
@@ -265,34 +266,6 @@ static int stress_swap_set_size(
 	return 0;
 }
 
-static void stress_swap_check_swapped(uint64_t *swapped_out)
-{
-	FILE *fp;
-	char buf[4096];
-	uint64_t swapout = 0;
-	static uint64_t prev_swapout = 0;
-
-	fp = fopen("/proc/vmstat", "r");
-	if (!fp)
-		return;
-
-	while (fgets(buf, sizeof(buf), fp) != NULL) {
-		if (strncmp(buf, "pswpout", 7) == 0) {
-			swapout = (uint64_t)atoll(buf + 8);
-			break;
-		}
-	}
-	(void)fclose(fp);
-
-	if (prev_swapout == 0) {
-		prev_swapout = swapout;
-		return;
-	}
-
-	*swapped_out += swapout - prev_swapout;
-	prev_swapout = swapout;
-}
-
 static void stress_swap_clean_dir(stress_args_t *args)
 {
 	char path[PATH_MAX];
@@ -330,11 +303,11 @@ static int stress_swap_child(stress_args_t *args, void *context)
 	char filename[PATH_MAX];
 	int fd, ret;
 	uint8_t *page;
-	uint64_t swapped_out = 0;
 	int32_t max_swap_pages;
 	const size_t page_size = args->page_size;
 	bool swap_self = false;
-	double t, duration, rate;
+	stress_swapstat_t swap_start, swap_end;
+	stress_latency_hist_t fault_hist;
 
 	(void)context;
 
@@ -400,7 +373,8 @@ static int stress_swap_child(stress_args_t *args, void *context)
 	stress_sync_start_wait(args);
 	stress_set_proc_state(args->name, STRESS_STATE_RUN);
 
-	t = stress_time_now();
+	stress_latency_hist_init(&fault_hist);
+	stress_swapstat_read(&swap_start);
 	do {
 		int swapflags = 0;
 		int bad_flags;
@@ -488,7 +462,7 @@ static int stress_swap_child(stress_args_t *args, void *context)
 			if (swap_self)
 				stress_swap_self(args->page_size);
 #endif
-			stress_swap_check_swapped(&swapped_out);
+			(void)stress_swapstat_fault_latency(ptr, mmap_size, page_size, &fault_hist);
 
 			/* Check page has check address value */
 			for (i = 0, p = ptr; p < p_end; p += page_size, i++) {
@@ -530,9 +504,8 @@ static int stress_swap_child(stress_args_t *args, void *context)
 		stress_bogo_inc(args);
 	} while (stress_continue(args));
 
-	duration = stress_time_now() - t;
-	rate = (duration > 0.0) ? swapped_out / duration : 0.0;
-	stress_metrics_set(args, 0, "pages swapped out per second", rate, STRESS_METRIC_GEOMETRIC_MEAN);
+	stress_swapstat_read(&swap_end);
+	(void)stress_swapstat_metrics(args, 0, &swap_start, &swap_end, &fault_hist);
 
 	ret = EXIT_SUCCESS;
 tidy_close:
@@ -566,6 +539,7 @@ const stressor_info_t stress_swap_info = {
 	.class = CLASS_VM | CLASS_OS,
 	.opts = opts,
 	.verify = VERIFY_ALWAYS,
+	.metrics_max = STRESS_SWAPSTAT_METRICS,
 	.help = help
 };
 #else
@@ -21,6 +21,7 @@
 #include "core-affinity.h"
 #include "core-builtin.h"
 #include "core-killpid.h"
+#include "core-latency.h"
 
 #if defined(HAVE_MQUEUE_H)
 #include <mqueue.h>
@@ -37,6 +38,7 @@ UNEXPECTED
 static const stress_help_t help[] = {
 	{ "s N","switch N",	 	"start N workers doing rapid context switches" },
 	{ NULL, "switch-freq N", 	"set frequency of context switches" },
+	{ NULL, "switch-matrix",	"measure switch latency between every pair of CPUs" },
 	{ NULL, "switch-method M",	"mq | pipe | sem-sysv" },
 	{ NULL,	"switch-ops N",	 	"stop after N context switch bogo operations" },
 	{ NULL, NULL, 			NULL }
@@ -53,6 +55,9 @@ typedef struct {
 
 #define THRESH_FREQ	(100)		/* Delay adjustment rate in HZ */
 
+#define SWITCH_MATRIX_ROUNDS	(1000)	/* timed round trips per CPU pair per pass */
+#define SWITCH_MATRIX_WARMUP	(100)	/* untimed round trips after re-pinning */
+
 /*
  *  stress_switch_rate()
  *	report context switch duration
@@ -239,12 +244,15 @@ again:
 		(void)close(pipefds[0]);
 		(void)shim_memset(buf, '_', buf_size);
 
+		stress_latency_set_description(args, 0, "pipe write");
 		t_start = stress_time_now();
 		do {
 			ssize_t ret;
+			uint64_t t_lat;
 
 			stress_bogo_inc(args);
 
+			t_lat = stress_latency_begin(args);
 			ret = write(fd, buf, buf_size);
 			if (UNLIKELY(ret <= 0)) {
 				if ((errno == EAGAIN) || (errno == EINTR))
@@ -258,6 +266,7 @@ again:
 				}
 				continue;
 			}
+			stress_latency_end(args, 0, t_lat);
 
 			if (UNLIKELY(switch_freq))
 				stress_switch_delay(args, switch_delay, threshold, t_start, &delay);
@@ -346,14 +355,18 @@ again:
 		struct sembuf sem ALIGN64;
 
 		/* Parent */
+		stress_latency_set_description(args, 0, "sem-sysv round-trip");
 		t_start = stress_time_now();
 		do {
+			uint64_t t_lat;
+
 			stress_bogo_inc(args);
 
 			sem.sem_num = 0;
 			sem.sem_op = 1;
 			sem.sem_flg = SEM_UNDO;
 
+			t_lat = stress_latency_begin(args);
 			if (UNLIKELY(semop(sem_id, &sem, 1) < 0))
 				break;
 
@@ -368,6 +381,7 @@ again:
 
 			if (UNLIKELY(semop(sem_id, &sem, 1) < 0))
 				break;
+			stress_latency_end(args, 0, t_lat);
 		} while (stress_continue(args));
 
 		stress_switch_rate(args, "sem-sysv", t_start, stress_time_now(), 2 * stress_bogo_get(args));
@@ -449,13 +463,17 @@ again:
 		uint64_t delay = switch_delay;
 
 		/* Parent */
+		stress_latency_set_description(args, 0, "mq receive");
 		t_start = stress_time_now();
 		do {
 			unsigned int prio;
+			uint64_t t_lat;
 
 			stress_bogo_inc(args);
+			t_lat = stress_latency_begin(args);
 			if (UNLIKELY(mq_receive(mq, (char *)&msg, sizeof(msg), &prio) < 0))
 				break;
+			stress_latency_end(args, 0, t_lat);
 
 			if (UNLIKELY(switch_freq))
 				stress_switch_delay(args, switch_delay, threshold, t_start, &delay);
@@ -475,6 +493,242 @@ finish:
 }
 #endif
 
+/*
+ *  stress_switch_matrix_child()
+ *	matrix mode far end, move to the CPU named in each
+ *	message if it changed and bounce the message back
+ */
+static void stress_switch_matrix_child(const int rfd, const int wfd)
+{
+	int32_t cpu, cur = -1;
+
+	while (stress_continue_flag()) {
+		ssize_t ret;
+
+		ret = read(rfd, &cpu, sizeof(cpu));
+		if (UNLIKELY(ret <= 0)) {
+			if ((ret < 0) && ((errno == EAGAIN) || (errno == EINTR)))
+				continue;
+			break;
+		}
+		if (UNLIKELY(cpu != cur)) {
+			stress_placement_set(cpu);
+			cur = cpu;
+		}
+		if (UNLIKELY(write(wfd, &cpu, sizeof(cpu)) <= 0))
+			break;
+	}
+}
+
+/*
+ *  stress_switch_matrix_pair()
+ *	ping-pong rounds messages to the far end pinned on cpu,
+ *	returns the mean nanoseconds per one-way switch or < 0 on error
+ */
+static double stress_switch_matrix_pair(
+	const int rfd,
+	const int wfd,
+	const int32_t cpu,
+	const uint32_t rounds)
+{
+	uint32_t i;
+	double t;
+
+	t = stress_time_now();
+	for (i = 0; i < rounds; i++) {
+		int32_t reply;
+
+		if (UNLIKELY(write(wfd, &cpu, sizeof(cpu)) != (ssize_t)sizeof(cpu)))
+			return -1.0;
+		if (UNLIKELY(read(rfd, &reply, sizeof(reply)) != (ssize_t)sizeof(reply)))
+			return -1.0;
+	}
+	t = stress_time_now() - t;
+
+	return (t * STRESS_NANOSECOND) / (2.0 * (double)rounds);
+}
+
+/*
+ *  stress_switch_matrix()
+ *	pin the two ends of a pipe ping-pong to each pair of CPUs in
+ *	turn, repeating over all pairs until the run ends, and report
+ *	the switch latency of each pair and of each topology distance
+ */
+static int stress_switch_matrix(stress_args_t *args)
+{
+	uint32_t *cpus = NULL, n_cpus, n, i, j, k, n_pairs, reported = 0;
+	double *total_ns = NULL;
+	uint64_t *passes = NULL;
+	int p2c[2], c2p[2], rc = EXIT_SUCCESS;
+	size_t idx;
+	pid_t pid;
+	double sum = 0.0;
+	uint64_t sum_n = 0;
+	double class_ns[STRESS_CPU_DISTANCE_UNKNOWN + 1];
+	uint64_t class_n[STRESS_CPU_DISTANCE_UNKNOWN + 1];
+
+	n_cpus = stress_get_usable_cpus(&cpus, true);
+	if (n_cpus == 0) {
+		pr_inf_skip("%s: cannot determine usable CPUs, skipping stressor\n", args->name);
+		return EXIT_NO_RESOURCE;
+	}
+	/* drop offline or otherwise disallowed CPUs */
+	for (n = 0, i = 0; i < n_cpus; i++) {
+		stress_placement_set((int32_t)cpus[i]);
+		if (stress_get_cpu() == cpus[i])
+			cpus[n++] = cpus[i];
+	}
+	n_pairs = (n * (n + 1)) / 2;
+	if (n_pairs == 0) {
+		pr_inf_skip("%s: cannot pin to any CPUs, skipping stressor\n", args->name);
+		stress_free_usable_cpus(&cpus);
+		return EXIT_NO_RESOURCE;
+	}
+	total_ns = (double *)calloc(n_pairs, sizeof(*total_ns));
+	passes = (uint64_t *)calloc(n_pairs, sizeof(*passes));
+	if (!total_ns || !passes) {
+		pr_inf_skip("%s: cannot allocate %" PRIu32 " CPU pair results, skipping stressor\n",
+			args->name, n_pairs);
+		rc = EXIT_NO_RESOURCE;
+		goto free_cpus;
+	}
+	if (pipe(p2c) < 0) {
+		pr_fail("%s: pipe failed, errno=%d (%s)\n",
+			args->name, errno, strerror(errno));
+		rc = EXIT_FAILURE;
+		goto free_cpus;
+	}
+	if (pipe(c2p) < 0) {
+		pr_fail("%s: pipe failed, errno=%d (%s)\n",
+			args->name, errno, strerror(errno));
+		rc = EXIT_FAILURE;
+		goto close_p2c;
+	}
+	pr_dbg("%s: measuring %" PRIu32 " CPU pairs of %" PRIu32 " CPUs\n",
+		args->name, n_pairs, n);
+
+	stress_set_proc_state(args->name, STRESS_STATE_SYNC_WAIT);
+	stress_sync_start_wait(args);
+	stress_set_proc_state(args->name, STRESS_STATE_RUN);
+again:
+	pid = fork();
+	if (pid < 0) {
+		if (stress_redo_fork(args, errno))
+			goto again;
+		if (UNLIKELY(!stress_continue(args)))
+			goto close_c2p;
+		pr_fail("%s: fork failed, errno=%d (%s)\n",
+			args->name, errno, strerror(errno));
+		rc = EXIT_FAILURE;
+		goto close_c2p;
+	} else if (pid == 0) {
+		stress_parent_died_alarm();
+		(void)sched_settings_apply(true);
+		(void)close(p2c[1]);
+		(void)close(c2p[0]);
+		stress_switch_matrix_child(p2c[0], c2p[1]);
+		_exit(EXIT_SUCCESS);
+	}
+	(void)close(p2c[0]);
+	(void)close(c2p[1]);
+	p2c[0] = -1;
+	c2p[1] = -1;
+
+	do {
+		for (k = 0, i = 0; i < n; i++) {
+			stress_placement_set((int32_t)cpus[i]);
+			for (j = i; j < n; j++, k++) {
+				double ns;
+
+				if (UNLIKELY(stress_switch_matrix_pair(c2p[0], p2c[1],
+						(int32_t)cpus[j], SWITCH_MATRIX_WARMUP) < 0.0))
+					goto stop;
+				ns = stress_switch_matrix_pair(c2p[0], p2c[1],
+						(int32_t)cpus[j], SWITCH_MATRIX_ROUNDS);
+				if (UNLIKELY(ns < 0.0))
+					goto stop;
+				total_ns[k] += ns;
+				passes[k]++;
+				stress_bogo_add(args, 2 * SWITCH_MATRIX_ROUNDS);
+				if (UNLIKELY(!stress_continue(args)))
+					goto stop;
+			}
+		}
+	} while (stress_continue(args));
+stop:
+	(void)close(p2c[1]);
+	p2c[1] = -1;
+	(void)stress_kill_pid_wait(pid, NULL);
+
+	/* per distance averages first, then as many pairs as there are metrics */
+	for (i = 0; i <= STRESS_CPU_DISTANCE_UNKNOWN; i++) {
+		class_ns[i] = 0.0;
+		class_n[i] = 0;
+	}
+	for (k = 0, i = 0; i < n; i++) {
+		for (j = i; j < n; j++, k++) {
+			const stress_cpu_distance_t d = stress_cpu_distance((int32_t)cpus[i], (int32_t)cpus[j]);
+
+			if (!passes[k])
+				continue;
+			class_ns[d] += total_ns[k] / (double)passes[k];
+			class_n[d]++;
+			sum += total_ns[k] / (double)passes[k];
+			sum_n++;
+		}
+	}
+	stress_metrics_set(args, 0, "nanosecs per context switch (matrix)",
+		sum_n ? sum / (double)sum_n : 0.0, STRESS_METRIC_HARMONIC_MEAN);
+	idx = 1;
+	for (i = 0; i <= STRESS_CPU_DISTANCE_UNKNOWN; i++) {
+		char msg[64];
+
+		if (!class_n[i])
+			continue;
+		(void)snprintf(msg, sizeof(msg), "%s nsec per switch",
+			stress_cpu_distance_name((stress_cpu_distance_t)i));
+		stress_metrics_set(args, idx++, msg,
+			class_ns[i] / (double)class_n[i], STRESS_METRIC_HARMONIC_MEAN);
+	}
+	for (k = 0, i = 0; i < n; i++) {
+		for (j = i; j < n; j++, k++) {
+			char msg[64];
+			const double ns = passes[k] ? total_ns[k] / (double)passes[k] : 0.0;
+
+			pr_dbg("%s: cpu %" PRIu32 " to cpu %" PRIu32 " (%s) %.1f nsec per switch\n",
+				args->name, cpus[i], cpus[j],
+				stress_cpu_distance_name(stress_cpu_distance((int32_t)cpus[i], (int32_t)cpus[j])), ns);
+			if (idx >= STRESS_MISC_METRICS_MAX)
+				continue;
+			(void)snprintf(msg, sizeof(msg), "cpu %" PRIu32 " to %" PRIu32 " nsec",
+				cpus[i], cpus[j]);
+			stress_metrics_set(args, idx++, msg, ns, STRESS_METRIC_HARMONIC_MEAN);
+			reported++;
+		}
+	}
+	if ((reported < n_pairs) && (args->instance == 0))
+		pr_inf("%s: only the first %" PRIu32 " of %" PRIu32 " CPU pairs are reported as metrics, "
+			"use -v to log all pairs\n", args->name, reported, n_pairs);
+
+close_c2p:
+	if (c2p[0] >= 0)
+		(void)close(c2p[0]);
+	if (c2p[1] >= 0)
+		(void)close(c2p[1]);
+close_p2c:
+	if (p2c[0] >= 0)
+		(void)close(p2c[0]);
+	if (p2c[1] >= 0)
+		(void)close(p2c[1]);
+free_cpus:
+	free(passes);
+	free(total_ns);
+	stress_free_usable_cpus(&cpus);
+	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
+
+	return rc;
+}
+
 static stress_switch_method_t stress_switch_methods[] = {
 #if defined(HAVE_MQUEUE_H) &&   \
     defined(HAVE_LIB_RT) &&     \
@@ -496,6 +750,11 @@ static int stress_switch(stress_args_t *args)
 {
 	uint64_t switch_freq = 0, switch_delay, threshold;
 	size_t switch_method = 0, i;
+	bool switch_matrix = false;
+
+	(void)stress_get_setting("switch-matrix", &switch_matrix);
+	if (switch_matrix)
+		return stress_switch_matrix(args);
 
 	for (i = 0; i < SIZEOF_ARRAY(stress_switch_methods); i++) {
 		if (strcmp(stress_switch_methods[i].name, "pipe") == 0) {
@@ -520,6 +779,7 @@ static const char *stress_switch_method(const size_t i)
 
 static const stress_opt_t opts[] = {
 	{ OPT_switch_freq,   "switch-freq",   TYPE_ID_UINT64, 0, STRESS_NANOSECOND, NULL },
+	{ OPT_switch_matrix, "switch-matrix", TYPE_ID_BOOL, 0, 1, NULL },
 	{ OPT_switch_method, "switch-method", TYPE_ID_SIZE_T_METHOD, 0, 1, stress_switch_method },
 	END_OPT,
 };
@@ -18,15 +18,30 @@
  *
  */
 #include "stress-ng.h"
+#include "core-latency.h"
+#include "core-pthread.h"
+#include "core-vmstat.h"
 
 #define MIN_SYNC_FILE_BYTES	(1 * MB)
 #define MAX_SYNC_FILE_BYTES	(MAX_FILE_LIMIT)
 #define DEFAULT_SYNC_FILE_BYTES	(1 * GB)
 
+#define MIN_SYNC_FILE_RECORD	(512)
+#define MAX_SYNC_FILE_RECORD	(1 * MB)
+#define DEFAULT_SYNC_FILE_RECORD (4 * KB)
+
+#define MAX_SYNC_FILE_WRITERS	(1024)
+
+/* group commit files are truncated and rewritten when they reach this size */
+#define SYNC_FILE_COMMIT_BYTES	(64 * MB)
+
 static const stress_help_t help[] = {
 	{ NULL,	"sync-file N",	     "start N workers exercise sync_file_range" },
 	{ NULL,	"sync-file-bytes N", "size of file to be sync'd" },
 	{ NULL,	"sync-file-ops N",   "stop after N sync_file_range bogo operations" },
+	{ NULL,	"sync-file-per-writer", "group commit writers append to their own file" },
+	{ NULL,	"sync-file-record N", "size of group commit records (default 4K)" },
+	{ NULL,	"sync-file-writers N", "N threads appending records with fdatasync" },
 	{ NULL,	NULL,		     NULL }
 };
 
@@ -44,7 +59,10 @@ UNEXPECTED
 #endif
 
 static const stress_opt_t opts[] = {
-	{ OPT_sync_file_bytes, "sync-file-bytes", TYPE_ID_OFF_T, MIN_SYNC_FILE_BYTES, MAX_SYNC_FILE_BYTES, NULL },
+	{ OPT_sync_file_bytes,      "sync-file-bytes",      TYPE_ID_OFF_T, MIN_SYNC_FILE_BYTES, MAX_SYNC_FILE_BYTES, NULL },
+	{ OPT_sync_file_per_writer, "sync-file-per-writer", TYPE_ID_BOOL, 0, 1, NULL },
+	{ OPT_sync_file_record,     "sync-file-record",     TYPE_ID_SIZE_T_BYTES_FS, MIN_SYNC_FILE_RECORD, MAX_SYNC_FILE_RECORD, NULL },
+	{ OPT_sync_file_writers,    "sync-file-writers",    TYPE_ID_UINT32, 0, MAX_SYNC_FILE_WRITERS, NULL },
 	END_OPT,
 };
 
@@ -95,6 +113,251 @@ static int stress_sync_allocate(
 	return 0;
 }
 
+#if defined(HAVE_LIB_PTHREAD) &&	\
+    defined(HAVE_FDATASYNC)
+#define STRESS_SYNC_FILE_COMMIT
+#endif
+
+#if defined(STRESS_SYNC_FILE_COMMIT)
+typedef struct {
+	int fd;				/* file appended to */
+	off_t offset;			/* next append offset */
+	pthread_mutex_t lock;		/* serializes offset reservation */
+} stress_sync_commit_file_t;
+
+typedef struct {
+	stress_args_t *args;
+	stress_sync_commit_file_t *file; /* file to append to */
+	uint8_t *record;		/* record to write */
+	size_t record_size;		/* size of each record */
+	volatile bool *stop;		/* set by the stressor to stop writing */
+	uint64_t commits;		/* completed writes + fdatasyncs */
+	stress_latency_hist_t hist;	/* fdatasync latencies */
+	pthread_t pthread;
+	int ret;			/* pthread_create return */
+	int err;			/* errno of write/sync failure, 0 if ok */
+} stress_sync_commit_writer_t;
+
+/*
+ *  stress_sync_commit_writer()
+ *	append records to a file, each followed by an fdatasync, the
+ *	file is truncated and appended to again when it gets too large
+ */
+static void *stress_sync_commit_writer(void *arg)
+{
+	stress_sync_commit_writer_t *w = (stress_sync_commit_writer_t *)arg;
+	stress_sync_commit_file_t *file = w->file;
+	const off_t record_size = (off_t)w->record_size;
+	sigset_t set;
+
+	/* leave signal handling to the main thread */
+	(void)sigfillset(&set);
+	(void)pthread_sigmask(SIG_BLOCK, &set, NULL);
+
+	while (!*w->stop && stress_continue_flag()) {
+		off_t offset;
+		uint64_t t;
+		ssize_t ret;
+
+		(void)pthread_mutex_lock(&file->lock);
+		offset = file->offset;
+		file->offset += record_size;
+		if (file->offset > (off_t)SYNC_FILE_COMMIT_BYTES) {
+			VOID_RET(int, ftruncate(file->fd, 0));
+			offset = 0;
+			file->offset = record_size;
+		}
+		(void)pthread_mutex_unlock(&file->lock);
+
+		w->record[0]++;
+		ret = pwrite(file->fd, w->record, w->record_size, offset);
+		if (UNLIKELY(ret < 0)) {
+			if (errno == EINTR)
+				continue;
+			w->err = errno;
+			break;
+		}
+		t = stress_latency_now();
+		if (UNLIKELY(shim_fdatasync(file->fd) < 0)) {
+			if (errno == EINTR)
+				continue;
+			w->err = errno;
+			break;
+		}
+		stress_latency_hist_record(&w->hist, stress_latency_now() - t);
+		w->commits++;
+	}
+	return &g_nowt;
+}
+
+/*
+ *  stress_sync_commit()
+ *	group commit benchmark, N writer threads append fixed size
+ *	records to one shared file or a file each, syncing with fdatasync
+ *	after each record, reports commits/sec and sync latencies
+ */
+static int stress_sync_commit(
+	stress_args_t *args,
+	const uint32_t writers,
+	const size_t record_size,
+	const bool per_writer)
+{
+	stress_sync_commit_writer_t *w;
+	stress_sync_commit_file_t *files;
+	stress_latency_hist_t *hist;
+	const size_t n_files = per_writer ? writers : 1;
+	const char *path = stress_get_temp_path();
+	const char *fs_name, *dev;
+	const char *fs_type = "";
+	uintmax_t blocks;
+	volatile bool stop = false;
+	size_t i, started = 0;
+	uint64_t commits;
+	double t_start, duration;
+	int ret, rc = EXIT_SUCCESS;
+	char desc[96], tag[48];
+
+	w = (stress_sync_commit_writer_t *)calloc(writers, sizeof(*w));
+	files = (stress_sync_commit_file_t *)calloc(n_files, sizeof(*files));
+	hist = (stress_latency_hist_t *)calloc(1, sizeof(*hist));
+	if (!w || !files || !hist) {
+		pr_inf_skip("%s: cannot allocate %" PRIu32 " group commit writers, skipping stressor\n",
+			args->name, writers);
+		free(hist);
+		free(files);
+		free(w);
+		return EXIT_NO_RESOURCE;
+	}
+
+	ret = stress_temp_dir_mk_args(args);
+	if (ret < 0) {
+		rc = stress_exit_status(-ret);
+		goto tidy_free;
+	}
+	for (i = 0; i < n_files; i++)
+		files[i].fd = -1;
+	for (i = 0; i < n_files; i++) {
+		char filename[PATH_MAX];
+
+		(void)stress_temp_filename_args(args, filename, sizeof(filename), stress_mwc32());
+		files[i].fd = open(filename, O_CREAT | O_RDWR | O_TRUNC, S_IRUSR | S_IWUSR);
+		if (files[i].fd < 0) {
+			pr_inf_skip("%s: cannot create file to sync on, skipping stressor: errno=%d (%s)\n",
+				args->name, errno, strerror(errno));
+			rc = EXIT_NO_RESOURCE;
+			goto tidy_files;
+		}
+		if (i == 0)
+			fs_type = stress_get_fs_type(filename);
+		(void)shim_unlink(filename);
+		(void)pthread_mutex_init(&files[i].lock, NULL);
+	}
+
+	/* tag the metrics with the device and file system being synced */
+	fs_name = path ? stress_get_fs_info(path, &blocks) : NULL;
+	dev = path ? stress_find_mount_dev(path) : NULL;
+	(void)snprintf(tag, sizeof(tag), "%s %s", dev ? dev : "unknown",
+		fs_name ? fs_name : "unknown");
+	if (args->instance == 0)
+		pr_dbg("%s: %" PRIu32 " writers appending %zu byte records to %zu file%s on %s\n",
+			args->name, writers, record_size, n_files,
+			(n_files == 1) ? "" : "s", tag);
+
+	stress_set_proc_state(args->name, STRESS_STATE_SYNC_WAIT);
+	stress_sync_start_wait(args);
+	stress_set_proc_state(args->name, STRESS_STATE_RUN);
+
+	t_start = stress_time_now();
+	for (i = 0; i < writers; i++) {
+		w[i].args = args;
+		w[i].file = &files[per_writer ? i : 0];
+		w[i].record_size = record_size;
+		w[i].stop = &stop;
+		stress_latency_hist_init(&w[i].hist);
+		w[i].record = (uint8_t *)malloc(record_size);
+		if (!w[i].record) {
+			w[i].ret = -1;
+			continue;
+		}
+		stress_rndbuf(w[i].record, record_size);
+		w[i].ret = pthread_create(&w[i].pthread, NULL,
+			stress_sync_commit_writer, (void *)&w[i]);
+		if (w[i].ret == 0)
+			started++;
+	}
+	if (started == 0) {
+		pr_inf_skip("%s: cannot create any writer threads, skipping stressor\n", args->name);
+		rc = EXIT_NO_RESOURCE;
+		goto tidy_writers;
+	}
+
+	/* writers count commits, the stressor accounts them as bogo-ops */
+	while (stress_continue(args)) {
+		bool failed = false;
+
+		(void)shim_usleep(50000);
+		for (commits = 0, i = 0; i < writers; i++) {
+			commits += w[i].commits;
+			failed |= (w[i].err != 0);
+		}
+		stress_bogo_set(args, commits);
+		if (failed)
+			break;
+	}
+	stop = true;
+	for (i = 0; i < writers; i++) {
+		if (w[i].ret == 0)
+			(void)pthread_join(w[i].pthread, NULL);
+	}
+	duration = stress_time_now() - t_start;
+	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
+
+	stress_latency_hist_init(hist);
+	for (commits = 0, i = 0; i < writers; i++) {
+		if ((w[i].ret == 0) && (w[i].err != 0) && (w[i].err != ENOSPC)) {
+			pr_fail("%s: record write or fdatasync failed, errno=%d (%s)%s\n",
+				args->name, w[i].err, strerror(w[i].err), fs_type);
+			rc = EXIT_FAILURE;
+		}
+		commits += w[i].commits;
+		stress_latency_hist_merge(hist, &w[i].hist);
+	}
+	stress_bogo_set(args, commits);
+
+	if ((duration > 0.0) && (hist->count > 0)) {
+		(void)snprintf(desc, sizeof(desc), "commits per sec %s", tag);
+		stress_metrics_set(args, 0, desc, (double)commits / duration,
+			STRESS_METRIC_HARMONIC_MEAN);
+		(void)snprintf(desc, sizeof(desc), "usec p50 fdatasync %s", tag);
+		stress_metrics_set(args, 1, desc,
+			(double)stress_latency_hist_percentile(hist, 50.0) / 1000.0,
+			STRESS_METRIC_GEOMETRIC_MEAN);
+		(void)snprintf(desc, sizeof(desc), "usec p99 fdatasync %s", tag);
+		stress_metrics_set(args, 2, desc,
+			(double)stress_latency_hist_percentile(hist, 99.0) / 1000.0,
+			STRESS_METRIC_GEOMETRIC_MEAN);
+	}
+
+tidy_writers:
+	for (i = 0; i < writers; i++)
+		free(w[i].record);
+tidy_files:
+	for (i = 0; i < n_files; i++) {
+		if (files[i].fd >= 0) {
+			(void)pthread_mutex_destroy(&files[i].lock);
+			(void)close(files[i].fd);
+		}
+	}
+	(void)stress_temp_dir_rm_args(args);
+tidy_free:
+	free(hist);
+	free(files);
+	free(w);
+
+	return rc;
+}
+#endif
+
 /*
  *  stress_sync_file
  *	stress the sync_file_range system call
@@ -106,6 +369,23 @@ static int stress_sync_file(stress_args_t *args)
 	off_t sync_file_bytes = DEFAULT_SYNC_FILE_BYTES;
 	char filename[PATH_MAX];
 	const char *fs_type;
+	uint32_t sync_file_writers = 0;
+	size_t sync_file_record = DEFAULT_SYNC_FILE_RECORD;
+	bool sync_file_per_writer = false;
+
+	(void)stress_get_setting("sync-file-writers", &sync_file_writers);
+	(void)stress_get_setting("sync-file-record", &sync_file_record);
+	(void)stress_get_setting("sync-file-per-writer", &sync_file_per_writer);
+	if (sync_file_writers > 0) {
+#if defined(STRESS_SYNC_FILE_COMMIT)
+		return stress_sync_commit(args, sync_file_writers,
+			sync_file_record, sync_file_per_writer);
+#else
+		if (args->instance == 0)
+			pr_inf("%s: --sync-file-writers requires pthread and fdatasync support, "
+				"using sync_file_range mode\n", args->name);
+#endif
+	}
 
 	if (!stress_get_setting("sync_file-bytes", &sync_file_bytes)) {
 		if (g_opt_flags & OPT_FLAGS_MAXIMIZE)
@@ -265,6 +545,7 @@ const stressor_info_t stress_sync_file_info = {
 	.class = CLASS_IO | CLASS_FILESYSTEM | CLASS_OS,
 	.opts = opts,
 	.verify = VERIFY_ALWAYS,
+	.metrics_max = 3,
 	.help = help
 };
 #else
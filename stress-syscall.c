@@ -21,6 +21,7 @@
 #include "core-cpu-cache.h"
 #include "core-builtin.h"
 #include "core-io-priority.h"
+#include "core-latency.h"
 
 #include <math.h>
 #include <sched.h>
@@ -548,6 +549,8 @@ static uint64_t syscall_time_now(void)
 
 static const stress_help_t help[] = {
 	{ NULL,	"syscall N",		"start N workers that exercise a wide range of system calls" },
+	{ NULL,	"syscall-latency",	"report min, median, p99 and max latency of each system call" },
+	{ NULL,	"syscall-latency-yaml F","write the system call latency report to YAML file F" },
 	{ NULL,	"syscall-method M",	"select method of selecting system calls to exercise" },
 	{ NULL,	"syscall-ops N",	"stop after N syscall bogo operations" },
 	{ NULL,	"syscall-top N",	"display fastest top N system calls" },
@@ -8419,6 +8422,7 @@ static const syscall_t syscalls[] = {
 
 static syscall_stats_t syscall_stats[STRESS_SYSCALLS_MAX];	/* stats */
 static size_t stress_syscall_index[STRESS_SYSCALLS_MAX];	/* shuffle index */
+static stress_latency_hist_t *syscall_hists;		/* --syscall-latency histograms */
 
 /*
  *  stress_syscall_reset_index()
@@ -8575,6 +8579,58 @@ static void stress_syscall_report_syscall_top10(stress_args_t *args)
 	pr_block_end();
 }
 
+/*
+ *  stress_syscall_report_latency()
+ *	report the latency distribution of all successfully exercised
+ *	system calls in system call name order so that the reports of
+ *	different runs can be compared, optionally also to a YAML file
+ */
+static void stress_syscall_report_latency(stress_args_t *args, const char *yaml_filename)
+{
+	size_t i;
+	FILE *yaml = NULL;
+
+	if (yaml_filename) {
+		yaml = fopen(yaml_filename, "w");
+		if (yaml) {
+			pr_yaml(yaml, "---\n");
+			pr_yaml(yaml, "syscall-latency:\n");
+		} else {
+			pr_err("%s: cannot open syscall latency YAML file %s, errno=%d (%s)\n",
+				args->name, yaml_filename, errno, strerror(errno));
+		}
+	}
+
+	pr_block_begin();
+	pr_inf("%s: system call latencies (timings in nanosecs):\n", args->name);
+	pr_inf("%s: %25s %10s %10s %10s %10s %10s\n", args->name,
+		"System Call", "Count", "Min (ns)", "p50 (ns)", "p99 (ns)", "Max (ns)");
+	for (i = 0; i < STRESS_SYSCALLS_MAX; i++) {
+		const stress_latency_hist_t *hist = &syscall_hists[i];
+		uint64_t p50, p99;
+
+		if (hist->count == 0)
+			continue;
+		p50 = stress_latency_hist_percentile(hist, 50.0);
+		p99 = stress_latency_hist_percentile(hist, 99.0);
+
+		pr_inf("%s: %25s %10" PRIu64 " %10" PRIu64 " %10" PRIu64
+			" %10" PRIu64 " %10" PRIu64 "\n", args->name,
+			syscalls[i].name, hist->count, hist->min_ns,
+			p50, p99, hist->max_ns);
+		pr_yaml(yaml, "  - syscall: %s\n", syscalls[i].name);
+		pr_yaml(yaml, "    count: %" PRIu64 "\n", hist->count);
+		pr_yaml(yaml, "    min-ns: %" PRIu64 "\n", hist->min_ns);
+		pr_yaml(yaml, "    p50-ns: %" PRIu64 "\n", p50);
+		pr_yaml(yaml, "    p99-ns: %" PRIu64 "\n", p99);
+		pr_yaml(yaml, "    max-ns: %" PRIu64 "\n", hist->max_ns);
+	}
+	pr_block_end();
+
+	if (yaml)
+		(void)fclose(yaml);
+}
+
 static int cmp_test_duration(const void *p1, const void *p2)
 {
 	const size_t i1 = *(const size_t *)p1;
@@ -8715,6 +8771,8 @@ static void stress_syscall_benchmark_calls(stress_args_t *args)
 			ss->total_duration += (double)d;
 			ss->succeed = true;
 			ss->count++;
+			if (syscall_hists)
+				stress_latency_hist_record(&syscall_hists[j], d);
 		}
 		stress_bogo_inc(args);
 	}
@@ -8732,7 +8790,12 @@ static int stress_syscall(stress_args_t *args)
 	int syscall_method = SYSCALL_METHOD_FAST75;
 	char exec_path[PATH_MAX];
 	const uint32_t rnd_filenum = stress_mwc32();
+	bool syscall_latency = false;
+	char *syscall_latency_yaml = NULL;
+	size_t hists_size = 0;
 
+	(void)stress_get_setting("syscall-latency", &syscall_latency);
+	(void)stress_get_setting("syscall-latency-yaml", &syscall_latency_yaml);
 	(void)stress_get_setting("syscall-method", &syscall_method);
 
 	if (args->instance == 0) {
@@ -8812,9 +8875,30 @@ static int stress_syscall(stress_args_t *args)
 	if (symlink(syscall_filename, syscall_symlink_filename) < 0)
 		*syscall_symlink_filename = '\0';
 
+	/*
+	 *  Only the first instance reports latencies, so the
+	 *  fairly large histograms are only allocated for it
+	 */
+	syscall_hists = NULL;
+	if ((args->instance == 0) && (syscall_latency || syscall_latency_yaml)) {
+		hists_size = sizeof(*syscall_hists) * STRESS_SYSCALLS_MAX;
+		syscall_hists = (stress_latency_hist_t *)mmap(NULL, hists_size,
+				PROT_READ | PROT_WRITE,
+				MAP_ANONYMOUS | MAP_PRIVATE, -1, 0);
+		if (syscall_hists == MAP_FAILED) {
+			pr_inf("%s: cannot allocate %zu bytes for system call latency "
+				"histograms, disabling latency report\n", args->name, hists_size);
+			syscall_hists = NULL;
+		} else {
+			stress_set_vma_anon_name(syscall_hists, hists_size, "latency-hists");
+		}
+	}
+
 	for (i = 0; i < STRESS_SYSCALLS_MAX; i++) {
 		syscall_stats_t *ss = &syscall_stats[i];
 
+		if (syscall_hists)
+			stress_latency_hist_init(&syscall_hists[i]);
 		ss->total_duration = 0.0;
 		ss->count = 0ULL;
 		ss->min_duration = ~0ULL;
@@ -8864,6 +8948,12 @@ static int stress_syscall(stress_args_t *args)
 			args->name, STRESS_SYSCALLS_MAX, exercised,
 			(double)exercised * 100.0 / (double)STRESS_SYSCALLS_MAX);
 		stress_syscall_report_syscall_top10(args);
+		if (syscall_hists)
+			stress_syscall_report_latency(args, syscall_latency_yaml);
+	}
+	if (syscall_hists) {
+		(void)munmap((void *)syscall_hists, hists_size);
+		syscall_hists = NULL;
 	}
 
 	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
@@ -8897,6 +8987,8 @@ static const char *stress_syscall_method(const size_t i)
 }
 
 static const stress_opt_t opts[] = {
+	{ OPT_syscall_latency, "syscall-latency", TYPE_ID_BOOL, 0, 1, NULL },
+	{ OPT_syscall_latency_yaml, "syscall-latency-yaml", TYPE_ID_STR, 0, 0, NULL },
 	{ OPT_syscall_method, "syscall-method", TYPE_ID_SIZE_T_METHOD, 0, 0, stress_syscall_method },
 	{ OPT_syscall_top,    "syscall-top",    TYPE_ID_SIZE_T, 0, 1000, NULL },
 	END_OPT,
@@ -342,6 +342,7 @@ const stressor_info_t stress_tee_info = {
 	.stressor = stress_tee,
 	.class = CLASS_PIPE_IO | CLASS_OS | CLASS_SCHEDULER,
 	.verify = VERIFY_ALWAYS,
+	.metrics_max = 1,
 	.help = help
 };
 #else
@@ -19,6 +19,7 @@
  */
 #include "stress-ng.h"
 #include "core-capabilities.h"
+#include "core-latency.h"
 
 #include <sys/ioctl.h>
 
@@ -110,6 +111,71 @@ static void stress_timerfd_set(
 	timer->it_interval.tv_nsec = timer->it_value.tv_nsec;
 }
 
+/* programmed expiry schedule of a timerfd */
+typedef struct {
+	uint64_t next_ns;	/* CLOCK_REALTIME of the oldest unread expiry */
+	uint64_t interval_ns;	/* timer interval */
+} stress_timerfd_expiry_t;
+
+/*
+ *  stress_timerfd_now()
+ *	CLOCK_REALTIME in nanoseconds, the clock the timers run on
+ */
+static inline uint64_t stress_timerfd_now(void)
+{
+	struct timespec ts;
+
+	if (UNLIKELY(clock_gettime(CLOCK_REALTIME, &ts) < 0))
+		return 0;
+	return ((uint64_t)ts.tv_sec * STRESS_NANOSECOND) + (uint64_t)ts.tv_nsec;
+}
+
+/*
+ *  stress_timerfd_expiry_set()
+ *	note the schedule of a timer just armed with timer
+ */
+static inline void stress_timerfd_expiry_set(
+	stress_timerfd_expiry_t *expiry,
+	const struct itimerspec *timer,
+	const uint64_t now_ns)
+{
+	expiry->interval_ns = ((uint64_t)timer->it_interval.tv_sec * STRESS_NANOSECOND) +
+			      (uint64_t)timer->it_interval.tv_nsec;
+	expiry->next_ns = now_ns + ((uint64_t)timer->it_value.tv_sec * STRESS_NANOSECOND) +
+			  (uint64_t)timer->it_value.tv_nsec;
+}
+
+/*
+ *  stress_timerfd_lateness_metrics()
+ *	report expiry lateness percentiles labelled with the timer
+ *	rate and number of timers they were measured at
+ */
+static void stress_timerfd_lateness_metrics(
+	stress_args_t *args,
+	const stress_latency_hist_t *hist,
+	const uint64_t timerfd_freq,
+	const int timerfd_fds,
+	const uint64_t missed)
+{
+	static const double percentiles[] = { 50.0, 99.0, 99.9 };
+	char msg[96];
+	size_t i;
+
+	for (i = 0; i < SIZEOF_ARRAY(percentiles); i++) {
+		(void)snprintf(msg, sizeof(msg), "usec p%g expiry lateness (%" PRIu64 " Hz, %d timers)",
+			percentiles[i], timerfd_freq, timerfd_fds);
+		stress_metrics_set(args, i, msg,
+			(double)stress_latency_hist_percentile(hist, percentiles[i]) / 1000.0,
+			STRESS_METRIC_MAXIMUM);
+	}
+	(void)snprintf(msg, sizeof(msg), "usec max expiry lateness (%" PRIu64 " Hz, %d timers)",
+		timerfd_freq, timerfd_fds);
+	stress_metrics_set(args, i++, msg, (double)hist->max_ns / 1000.0, STRESS_METRIC_MAXIMUM);
+	stress_metrics_set(args, i, "% expiries missed",
+		(hist->count + missed) ? 100.0 * (double)missed / (double)(hist->count + missed) : 0.0,
+		STRESS_METRIC_MAXIMUM);
+}
+
 /*
  *  stress_timerfd
  *	stress timerfd
@@ -130,6 +196,9 @@ static int stress_timerfd(stress_args_t *args)
 	const pid_t self = getpid();
 	int *timerfds;
 	int ret, rc = EXIT_SUCCESS;
+	stress_latency_hist_t *hist;
+	stress_timerfd_expiry_t *expiry;
+	uint64_t missed = 0;
 #if defined(USE_POLL)
 	struct pollfd *pollfds;
 #endif
@@ -171,13 +240,31 @@ static int stress_timerfd(stress_args_t *args)
 	for (i = 0; i < timerfd_fds; i++)
 		timerfds[i] = -1;
 
+	hist = (stress_latency_hist_t *)malloc(sizeof(*hist));
+	if (!hist) {
+		pr_inf_skip("%s: cannot allocate expiry lateness histogram, "
+			"skipping stressor\n", args->name);
+		rc = EXIT_NO_RESOURCE;
+		goto free_timerfds;
+	}
+	stress_latency_hist_init(hist);
+	stress_latency_set_description(args, 0, "timerfd expiry lateness");
+
+	expiry = (stress_timerfd_expiry_t *)calloc((size_t)timerfd_fds, sizeof(*expiry));
+	if (!expiry) {
+		pr_inf_skip("%s: cannot allocate %d timer expiry schedules, "
+			"skipping stressor\n", args->name, timerfd_fds);
+		rc = EXIT_NO_RESOURCE;
+		goto free_hist;
+	}
+
 #if defined(USE_POLL)
 	pollfds = (struct pollfd *)calloc((size_t)timerfd_fds, sizeof(*pollfds));
 	if (!pollfds) {
 		pr_inf_skip("%s: cannot allocate %" PRIu32 " pollfd file descriptors, "
 			"skipping stressor\n", args->name, timerfd_fds);
 		rc = EXIT_NO_RESOURCE;
-		goto free_timerfds;
+		goto free_expiry;
 	}
 #endif
 
@@ -240,6 +327,7 @@ static int stress_timerfd(stress_args_t *args)
 	for (i = 0; i < timerfd_fds; i++) {
 		if (timerfds[i] < 0)
 			continue;
+		stress_timerfd_expiry_set(&expiry[i], &timer, stress_timerfd_now());
 		if (timerfd_settime(timerfds[i], 0, &timer, NULL) < 0) {
 			pr_fail("%s: timerfd_settime failed on fd %d, errno=%d (%s)\n",
 				args->name, timerfds[i], errno, strerror(errno));
@@ -306,6 +394,7 @@ static int stress_timerfd(stress_args_t *args)
 
 		for (i = 0; i < timerfd_fds; i++) {
 			ssize_t rret;
+			uint64_t now_ns;
 
 			if (timerfds[i] < 0)
 				continue;
@@ -319,6 +408,7 @@ static int stress_timerfd(stress_args_t *args)
 				continue;
 			rret = read(pollfds[i].fd, &expval, sizeof expval);
 #endif
+			now_ns = stress_timerfd_now();
 
 			if (UNLIKELY(rret < 0)) {
 				pr_fail("%s: read of timerfd failed, errno=%d (%s)\n",
@@ -330,8 +420,26 @@ static int stress_timerfd(stress_args_t *args)
 					args->name, errno, strerror(errno));
 				break;
 			}
+#if defined(HAVE_SYS_TIMERFD_H) &&	\
+    defined(TFD_IOC_SET_TICKS)
+			/* the tick count of the first timer is overwritten by TFD_IOC_SET_TICKS */
+			if (i == 0)
+				rret = 0;
+#endif
+			if (LIKELY((rret == (ssize_t)sizeof(expval)) && (expval > 0))) {
+				/* lateness of the oldest expiry consumed by this read */
+				const uint64_t ns = (now_ns > expiry[i].next_ns) ?
+					now_ns - expiry[i].next_ns : 0;
+
+				stress_latency_hist_record(hist, ns);
+				stress_latency_record(args, 0, ns);
+				/* expirations beyond the first were never observed */
+				missed += expval - 1;
+				expiry[i].next_ns += expval * expiry[i].interval_ns;
+			}
 			if (timerfd_rand) {
 				stress_timerfd_set(&timer, timerfd_rand);
+				stress_timerfd_expiry_set(&expiry[i], &timer, stress_timerfd_now());
 				if (UNLIKELY(timerfd_settime(timerfds[i], 0, &timer, NULL) < 0)) {
 					pr_fail("%s: timerfd_settime failed, errno=%d (%s)\n",
 						args->name, errno, strerror(errno));
@@ -377,6 +485,8 @@ static int stress_timerfd(stress_args_t *args)
 
 	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
 
+	stress_timerfd_lateness_metrics(args, hist, timerfd_freq, timerfd_fds, missed);
+
 
 close_timer_fds:
 	for (i = 0; i < timerfd_fds; i++) {
@@ -387,8 +497,12 @@ close_timer_fds:
 free_pollfds:
 #if defined(USE_POLL)
 	free(pollfds);
-free_timerfds:
+free_expiry:
 #endif
+	free(expiry);
+free_hist:
+	free(hist);
+free_timerfds:
 	free(timerfds);
 
 close_file_fd:
@@ -404,6 +518,7 @@ const stressor_info_t stress_timerfd_info = {
 	.stressor = stress_timerfd,
 	.class = CLASS_INTERRUPT | CLASS_OS,
 	.verify = VERIFY_ALWAYS,
+	.metrics_max = 5,
 	.opts = opts,
 	.help = help
 };
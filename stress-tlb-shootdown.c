@@ -22,17 +22,25 @@
 #include "core-builtin.h"
 #include "core-cpu-cache.h"
 #include "core-killpid.h"
+#include "core-latency.h"
 #include "core-out-of-memory.h"
 #include "core-pragma.h"
+#include "core-pthread.h"
 
 #include <sched.h>
 
 static const stress_help_t help[] = {
 	{ NULL,	"tlb-shootdown N",	"start N workers that force TLB shootdowns" },
 	{ NULL,	"tlb-shootdown-ops N",	"stop after N TLB shootdown bogo ops" },
+	{ NULL,	"tlb-shootdown-sweep",	"time mprotect/munmap shootdowns sweeping the CPUs using the mm" },
 	{ NULL,	NULL,			NULL }
 };
 
+static const stress_opt_t opts[] = {
+	{ OPT_tlb_shootdown_sweep, "tlb-shootdown-sweep", TYPE_ID_BOOL, 0, 1, NULL },
+	END_OPT,
+};
+
 #if defined(HAVE_SCHED_GETAFFINITY) && 	\
     defined(HAVE_MPROTECT)
 
@@ -41,6 +49,7 @@ static const stress_help_t help[] = {
 #define MMAP_PAGES		(512)
 #define STRESS_CACHE_LINE_SHIFT	(6)	/* Typical 64 byte size */
 #define STRESS_CACHE_LINE_SIZE	(1 << STRESS_CACHE_LINE_SHIFT)
+#define TLB_METRICS_MAX		(16)	/* TLB_SWEEP_STEPS_MAX * TLB_SWEEP_OP_TYPES */
 
 /*
  *  stress_tlb_shootdown_read_mem()
@@ -148,6 +157,209 @@ static void *stress_tlb_shootdown_mmap(
 	return mem;
 }
 
+#if defined(HAVE_LIB_PTHREAD) &&	\
+    defined(__linux__)
+#define TLB_SWEEP_STEPS_MAX	(8)	/* CPU count steps in the sweep */
+#define TLB_SWEEP_OPS		(256)	/* operations per step per round */
+#define TLB_SWEEP_THREADS_MAX	(1023)	/* maximum threads holding the mm */
+
+#define TLB_SWEEP_MPROTECT	(0)
+#define TLB_SWEEP_MUNMAP	(1)
+#define TLB_SWEEP_OP_TYPES	(2)
+
+/* a thread that holds the mm on a CPU during the sweep */
+typedef struct {
+	pthread_t pthread;		/* thread */
+	int ret;			/* pthread_create return */
+	uint32_t index;			/* thread index, 1.. */
+	uint32_t cpu;			/* CPU the thread is pinned to */
+	struct stress_tlb_shootdown_sweep *sweep;
+} stress_tlb_sweep_thread_t;
+
+/* shared sweep state */
+typedef struct stress_tlb_shootdown_sweep {
+	uint8_t *mem;			/* mprotect'd memory read by the threads */
+	size_t mem_size;		/* size of mem */
+	size_t page_size;		/* page size */
+	volatile uint32_t active;	/* number of CPUs currently holding the mm */
+	volatile bool stop;		/* true to stop the threads */
+} stress_tlb_shootdown_sweep_t;
+
+static const char * const stress_tlb_sweep_op_names[TLB_SWEEP_OP_TYPES] = {
+	"mprotect",
+	"munmap",
+};
+
+/*
+ *  stress_tlb_shootdown_sweep_thread()
+ *	pinned to a CPU, read the mprotect'd memory to keep the mm
+ *	and its TLB entries live on the CPU while the thread is part
+ *	of the active CPU set, otherwise sleep
+ */
+static void *stress_tlb_shootdown_sweep_thread(void *arg)
+{
+	const stress_tlb_sweep_thread_t *thread = (stress_tlb_sweep_thread_t *)arg;
+	stress_tlb_shootdown_sweep_t *sweep = thread->sweep;
+	cpu_set_t mask;
+
+	CPU_ZERO(&mask);
+	CPU_SET((int)thread->cpu, &mask);
+	(void)sched_setaffinity(0, sizeof(mask), &mask);
+
+	while (!sweep->stop) {
+		if (thread->index < sweep->active)
+			stress_tlb_shootdown_read_mem(sweep->mem, sweep->mem_size, sweep->page_size);
+		else
+			(void)shim_usleep(10000);
+	}
+	return &g_nowt;
+}
+
+/*
+ *  stress_tlb_shootdown_sweep()
+ *	sweep the number of CPUs running threads of the mm and time
+ *	mprotect and munmap calls that need TLB flushes on all of them
+ */
+static int stress_tlb_shootdown_sweep(
+	stress_args_t *args,
+	const uint32_t *cpus,
+	const uint32_t n_cpus)
+{
+	const size_t page_size = args->page_size;
+	const size_t mmap_size = page_size * MMAP_PAGES;
+	stress_tlb_shootdown_sweep_t sweep;
+	stress_tlb_sweep_thread_t *threads;
+	stress_latency_hist_t *hists;
+	uint32_t steps[TLB_SWEEP_STEPS_MAX];
+	uint32_t n_steps = 0, n_threads, step, i;
+	cpu_set_t mask;
+	int rc = EXIT_SUCCESS;
+
+	/* 1, 2, 4.. CPUs and all the CPUs */
+	for (i = 1; (i < n_cpus) && (n_steps < TLB_SWEEP_STEPS_MAX - 1); i <<= 1)
+		steps[n_steps++] = i;
+	steps[n_steps++] = STRESS_MAXIMUM(n_cpus, 1);
+	n_threads = STRESS_MINIMUM(steps[n_steps - 1] - 1, TLB_SWEEP_THREADS_MAX);
+
+	sweep.mem_size = mmap_size;
+	sweep.page_size = page_size;
+	sweep.active = 1;
+	sweep.stop = false;
+	sweep.mem = stress_tlb_shootdown_mmap(args, NULL, mmap_size,
+			PROT_WRITE | PROT_READ, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if ((void *)sweep.mem == MAP_FAILED)
+		return EXIT_NO_RESOURCE;
+	stress_set_vma_anon_name(sweep.mem, mmap_size, "tlb-shootdown-sweep");
+	(void)shim_memset(sweep.mem, 0xff, mmap_size);
+
+	threads = (stress_tlb_sweep_thread_t *)calloc((size_t)n_threads + 1, sizeof(*threads));
+	hists = (stress_latency_hist_t *)calloc((size_t)n_steps * TLB_SWEEP_OP_TYPES, sizeof(*hists));
+	if (!threads || !hists) {
+		pr_inf_skip("%s: failed to allocate sweep state, skipping stressor\n", args->name);
+		rc = EXIT_NO_RESOURCE;
+		goto tidy;
+	}
+	for (i = 0; i < n_steps * TLB_SWEEP_OP_TYPES; i++)
+		stress_latency_hist_init(&hists[i]);
+	stress_latency_set_description(args, TLB_SWEEP_MPROTECT, "mprotect shootdown");
+	stress_latency_set_description(args, TLB_SWEEP_MUNMAP, "munmap shootdown");
+
+	if (n_cpus > 0) {
+		CPU_ZERO(&mask);
+		CPU_SET((int)cpus[0], &mask);
+		(void)sched_setaffinity(0, sizeof(mask), &mask);
+	}
+	for (i = 0; i < n_threads; i++) {
+		threads[i].index = i + 1;
+		threads[i].cpu = cpus[i + 1];
+		threads[i].sweep = &sweep;
+		threads[i].ret = pthread_create(&threads[i].pthread, NULL,
+			stress_tlb_shootdown_sweep_thread, (void *)&threads[i]);
+	}
+
+	stress_set_proc_state(args->name, STRESS_STATE_SYNC_WAIT);
+	stress_sync_start_wait(args);
+	stress_set_proc_state(args->name, STRESS_STATE_RUN);
+
+	do {
+		for (step = 0; (step < n_steps) && stress_continue(args); step++) {
+			stress_latency_hist_t *hist = &hists[step * TLB_SWEEP_OP_TYPES];
+			uint32_t op;
+
+			sweep.active = steps[step];
+			/* let the newly active threads start running in the mm */
+			(void)shim_usleep(1000);
+
+			for (op = 0; (op < TLB_SWEEP_OPS) && stress_continue(args); op++) {
+				uint64_t t_begin, ns;
+				uint8_t *mem;
+
+				/* populate writable PTEs, then write protect them */
+				(void)mprotect(sweep.mem, mmap_size, PROT_READ | PROT_WRITE);
+				stress_tlb_shootdown_write_mem(sweep.mem, mmap_size, page_size);
+				t_begin = stress_latency_now();
+				(void)mprotect(sweep.mem, mmap_size, PROT_READ);
+				ns = stress_latency_now() - t_begin;
+				stress_latency_hist_record(&hist[TLB_SWEEP_MPROTECT], ns);
+				stress_latency_record(args, TLB_SWEEP_MPROTECT, ns);
+
+				mem = (uint8_t *)mmap(NULL, mmap_size, PROT_READ | PROT_WRITE,
+					MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+				if (mem == MAP_FAILED)
+					continue;
+				stress_tlb_shootdown_write_mem(mem, mmap_size, page_size);
+				t_begin = stress_latency_now();
+				(void)munmap((void *)mem, mmap_size);
+				ns = stress_latency_now() - t_begin;
+				stress_latency_hist_record(&hist[TLB_SWEEP_MUNMAP], ns);
+				stress_latency_record(args, TLB_SWEEP_MUNMAP, ns);
+
+				stress_bogo_inc(args);
+			}
+		}
+	} while (stress_continue(args));
+
+	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
+
+	sweep.stop = true;
+	for (i = 0; i < n_threads; i++) {
+		if (threads[i].ret == 0)
+			(void)pthread_join(threads[i].pthread, NULL);
+	}
+
+	if (args->instance == 0)
+		pr_inf("%s: %5s %-8s %10s %10s %10s (usec)\n", args->name,
+			"CPUs", "op", "mean", "p50", "p99");
+	for (step = 0; step < n_steps; step++) {
+		uint32_t op;
+
+		for (op = 0; op < TLB_SWEEP_OP_TYPES; op++) {
+			const stress_latency_hist_t *hist = &hists[(step * TLB_SWEEP_OP_TYPES) + op];
+			const double p50 = (double)stress_latency_hist_percentile(hist, 50.0) / 1000.0;
+			char msg[64];
+
+			if (!hist->count)
+				continue;
+			if (args->instance == 0)
+				pr_inf("%s: %5" PRIu32 " %-8s %10.2f %10.2f %10.2f\n", args->name,
+					steps[step], stress_tlb_sweep_op_names[op],
+					stress_latency_hist_mean(hist) / 1000.0, p50,
+					(double)stress_latency_hist_percentile(hist, 99.0) / 1000.0);
+			(void)snprintf(msg, sizeof(msg), "usec %s p50 latency on %" PRIu32 " CPU%s",
+				stress_tlb_sweep_op_names[op], steps[step],
+				(steps[step] == 1) ? "" : "s");
+			stress_metrics_set(args, (step * TLB_SWEEP_OP_TYPES) + op, msg,
+				p50, STRESS_METRIC_GEOMETRIC_MEAN);
+		}
+	}
+tidy:
+	free(hists);
+	free(threads);
+	(void)munmap((void *)sweep.mem, mmap_size);
+	return rc;
+}
+#endif
+
 /*
  *  stress_tlb_shootdown()
  *	stress out TLB shootdowns
@@ -164,6 +376,9 @@ static int stress_tlb_shootdown(stress_args_t *args)
 	int rc = EXIT_SUCCESS;
 	uint32_t tlb_procs, i;
 	uint8_t *mem;
+	bool tlb_shootdown_sweep = false;
+	uint64_t madvise_count = 0;
+	double madvise_ns = 0.0;
 #if defined(HAVE_MADVISE) &&	\
     defined(MADV_DONTNEED)
 	int fd, ret;
@@ -172,6 +387,20 @@ static int stress_tlb_shootdown(stress_args_t *args)
 	char filename[PATH_MAX];
 #endif
 
+	(void)stress_get_setting("tlb-shootdown-sweep", &tlb_shootdown_sweep);
+	if (tlb_shootdown_sweep) {
+#if defined(HAVE_LIB_PTHREAD) &&	\
+    defined(__linux__)
+		rc = stress_tlb_shootdown_sweep(args, cpus, n_cpus);
+		goto err_free_cpus;
+#else
+		if (args->instance == 0)
+			pr_inf("%s: --tlb-shootdown-sweep requires Linux pthreads, "
+				"running default shootdown stressor\n", args->name);
+#endif
+	}
+	stress_latency_set_description(args, 0, "madvise shootdown");
+
 	s_pids = stress_s_pids_mmap(MAX_TLB_PROCS);
 	if (s_pids == MAP_FAILED) {
 		pr_inf_skip("%s: failed to mmap %d PIDs, skipping stressor\n", args->name, MAX_TLB_PROCS);
@@ -321,11 +550,21 @@ PRAGMA_UNROLL_N(8)
 		(void)shim_madvise(memfd, mmapfd_size, SHIM_MADV_DONTNEED);
 		stress_tlb_shootdown_read_mem(memfd, mmapfd_size, page_size);
 
-		(void)shim_madvise(mem, mmap_size, SHIM_MADV_DONTNEED);
-		stress_tlb_shootdown_read_mem(mem, mmap_size, page_size);
-
-		(void)shim_madvise(mem, mmap_size, SHIM_MADV_DONTNEED);
-		stress_tlb_shootdown_write_mem(mem, mmap_size, page_size);
+		/* zapping the shared pages flushes the TLBs of the child processes */
+		for (i = 0; i < 2; i++) {
+			const uint64_t t_begin = stress_latency_now();
+			uint64_t ns;
+
+			(void)shim_madvise(mem, mmap_size, SHIM_MADV_DONTNEED);
+			ns = stress_latency_now() - t_begin;
+			stress_latency_record(args, 0, ns);
+			madvise_ns += (double)ns;
+			madvise_count++;
+			if (i)
+				stress_tlb_shootdown_write_mem(mem, mmap_size, page_size);
+			else
+				stress_tlb_shootdown_read_mem(mem, mmap_size, page_size);
+		}
 #endif
 #if defined(__linux__)
 		{
@@ -346,6 +585,10 @@ PRAGMA_UNROLL_N(8)
 
 	stress_kill_and_wait_many(args, s_pids, tlb_procs, SIGALRM, true);
 
+	if (madvise_count > 0)
+		stress_metrics_set(args, 0, "usec madvise DONTNEED shootdown latency",
+			madvise_ns / (double)madvise_count / 1000.0, STRESS_METRIC_GEOMETRIC_MEAN);
+
 	(void)munmap((void *)mem, mmap_size);
 err_munmap_memfd:
 #if defined(HAVE_MADVISE) &&	\
@@ -367,12 +610,15 @@ err_free_cpus:
 const stressor_info_t stress_tlb_shootdown_info = {
 	.stressor = stress_tlb_shootdown,
 	.class = CLASS_OS | CLASS_MEMORY,
+	.opts = opts,
+	.metrics_max = TLB_METRICS_MAX,
 	.help = help
 };
 #else
 const stressor_info_t stress_tlb_shootdown_info = {
 	.stressor = stress_unimplemented,
 	.class = CLASS_OS | CLASS_MEMORY,
+	.opts = opts,
 	.help = help,
 	.unimplemented_reason = "built without sched_getaffinity() or mprotect() system calls"
 };
@@ -91,7 +91,7 @@ static const stress_tree_method_info_t stress_tree_methods[];
 
 static const stress_help_t help[] = {
 	{ NULL,	"tree N",	 "start N workers that exercise tree structures" },
-	{ NULL,	"tree-method M", "select tree method: all,avl,binary,btree,rb,splay" },
+	{ NULL,	"tree-method M", "select tree method: all,avl,binary,bplus,btree,rb,splay,veb" },
 	{ NULL,	"tree-ops N",	 "stop after N bogo tree operations" },
 	{ NULL,	"tree-size N",	 "N is the number of items in the tree" },
 	{ NULL,	NULL,		 NULL }
@@ -879,6 +879,506 @@ PRAGMA_UNROLL_N(4)
 	metrics->count += (double)n;
 }
 
+/*
+ *  Arenas for the cache conscious trees, these are mapped on first
+ *  use and reused on each bogo-op, they are unmapped at the end
+ */
+typedef struct {
+	void *addr;		/* arena mapping, NULL if not mapped */
+	size_t size;		/* size of mapping in bytes */
+} stress_tree_arena_t;
+
+static stress_tree_arena_t bplus_arena;
+static stress_tree_arena_t veb_arena;
+
+static void *stress_tree_arena_get(
+	stress_tree_arena_t *arena,
+	const size_t size,
+	const char *name)
+{
+	if (arena->addr && (arena->size >= size))
+		return arena->addr;
+	if (arena->addr)
+		(void)munmap(arena->addr, arena->size);
+	arena->addr = mmap(NULL, size, PROT_READ | PROT_WRITE,
+			MAP_ANONYMOUS | MAP_PRIVATE, -1, 0);
+	if (arena->addr == MAP_FAILED) {
+		arena->addr = NULL;
+		arena->size = 0;
+		return NULL;
+	}
+	arena->size = size;
+	stress_set_vma_anon_name(arena->addr, size, name);
+	return arena->addr;
+}
+
+static void stress_tree_arena_free(stress_tree_arena_t *arena)
+{
+	if (arena->addr)
+		(void)munmap(arena->addr, arena->size);
+	arena->addr = NULL;
+	arena->size = 0;
+}
+
+/*
+ *  B+tree with 64 byte cache line sized nodes allocated from an arena,
+ *  children and leaf links are 32 bit arena indices rather than pointers
+ *  so an inner node holds 7 keys and 8 children and a leaf 14 keys
+ */
+#define BPLUS_INNER_KEYS	(7)
+#define BPLUS_LEAF_KEYS		(14)
+#define BPLUS_NIL		(0xffffffffU)
+#define BPLUS_MAX_DEPTH		(32)
+
+typedef struct {
+	uint16_t count;		/* number of keys */
+	uint16_t leaf;		/* non-zero for a leaf node */
+	union {
+		struct {
+			uint32_t key[BPLUS_INNER_KEYS];
+			uint32_t child[BPLUS_INNER_KEYS + 1];
+		} inner;
+		struct {
+			uint32_t key[BPLUS_LEAF_KEYS];
+			uint32_t next;	/* next leaf, BPLUS_NIL if last */
+		} leaf;
+	} u;
+} ALIGN64 bplus_node_t;
+
+typedef struct {
+	bplus_node_t *nodes;	/* arena of nodes */
+	uint32_t used;		/* nodes allocated */
+	uint32_t capacity;	/* nodes in the arena */
+	uint32_t root;		/* root node index */
+} bplus_tree_t;
+
+static inline uint32_t bplus_alloc(bplus_tree_t *tree, const uint16_t leaf)
+{
+	bplus_node_t *node;
+
+	if (UNLIKELY(tree->used >= tree->capacity))
+		return BPLUS_NIL;
+	node = &tree->nodes[tree->used];
+	node->count = 0;
+	node->leaf = leaf;
+	return tree->used++;
+}
+
+/*
+ *  bplus_inner_pos()
+ *	index of the child to descend, the number of keys <= value
+ */
+static inline int OPTIMIZE3 bplus_inner_pos(const bplus_node_t *node, const uint32_t value)
+{
+	register int i, pos = 0;
+
+PRAGMA_UNROLL_N(8)
+	for (i = 0; i < (int)node->count; i++)
+		pos += (value >= node->u.inner.key[i]);
+	return pos;
+}
+
+static bool OPTIMIZE3 bplus_insert(bplus_tree_t *tree, const uint32_t value)
+{
+	uint32_t path[BPLUS_MAX_DEPTH];
+	int slot[BPLUS_MAX_DEPTH];
+	uint32_t tmp_key[BPLUS_LEAF_KEYS + 1];
+	uint32_t tmp_child[BPLUS_INNER_KEYS + 2];
+	uint32_t idx = tree->root, new_idx, sep;
+	bplus_node_t *node, *right;
+	int depth = 0, pos, i, n;
+
+	if (UNLIKELY(idx == BPLUS_NIL)) {
+		idx = bplus_alloc(tree, 1);
+		if (UNLIKELY(idx == BPLUS_NIL))
+			return false;
+		node = &tree->nodes[idx];
+		node->count = 1;
+		node->u.leaf.key[0] = value;
+		node->u.leaf.next = BPLUS_NIL;
+		tree->root = idx;
+		return true;
+	}
+
+	node = &tree->nodes[idx];
+	while (!node->leaf) {
+		pos = bplus_inner_pos(node, value);
+		path[depth] = idx;
+		slot[depth] = pos;
+		depth++;
+		idx = node->u.inner.child[pos];
+		node = &tree->nodes[idx];
+	}
+
+	for (pos = 0; (pos < (int)node->count) && (node->u.leaf.key[pos] < value); pos++)
+		;
+	if ((pos < (int)node->count) && (node->u.leaf.key[pos] == value))
+		return true;
+	if (node->count < BPLUS_LEAF_KEYS) {
+		for (i = (int)node->count; i > pos; i--)
+			node->u.leaf.key[i] = node->u.leaf.key[i - 1];
+		node->u.leaf.key[pos] = value;
+		node->count++;
+		return true;
+	}
+
+	/* split a full leaf, 8 keys stay, 7 keys move right */
+	new_idx = bplus_alloc(tree, 1);
+	if (UNLIKELY(new_idx == BPLUS_NIL))
+		return false;
+	right = &tree->nodes[new_idx];
+	for (i = 0, n = 0; i < BPLUS_LEAF_KEYS; i++) {
+		if (i == pos)
+			tmp_key[n++] = value;
+		tmp_key[n++] = node->u.leaf.key[i];
+	}
+	if (pos == BPLUS_LEAF_KEYS)
+		tmp_key[n++] = value;
+	node->count = (BPLUS_LEAF_KEYS + 2) / 2;
+	right->count = (uint16_t)(n - node->count);
+	(void)shim_memcpy(node->u.leaf.key, tmp_key, node->count * sizeof(uint32_t));
+	(void)shim_memcpy(right->u.leaf.key, tmp_key + node->count, right->count * sizeof(uint32_t));
+	right->u.leaf.next = node->u.leaf.next;
+	node->u.leaf.next = new_idx;
+	sep = right->u.leaf.key[0];
+
+	/* insert separator into parents, splitting full parents */
+	while (depth > 0) {
+		uint32_t split_idx;
+
+		depth--;
+		node = &tree->nodes[path[depth]];
+		pos = slot[depth];
+		if (node->count < BPLUS_INNER_KEYS) {
+			for (i = (int)node->count; i > pos; i--) {
+				node->u.inner.key[i] = node->u.inner.key[i - 1];
+				node->u.inner.child[i + 1] = node->u.inner.child[i];
+			}
+			node->u.inner.key[pos] = sep;
+			node->u.inner.child[pos + 1] = new_idx;
+			node->count++;
+			return true;
+		}
+		/* split a full inner node, 4 keys stay, 1 moves up, 3 move right */
+		split_idx = bplus_alloc(tree, 0);
+		if (UNLIKELY(split_idx == BPLUS_NIL))
+			return false;
+		right = &tree->nodes[split_idx];
+		tmp_child[0] = node->u.inner.child[0];
+		for (i = 0, n = 0; i < BPLUS_INNER_KEYS; i++) {
+			if (i == pos) {
+				tmp_key[n] = sep;
+				tmp_child[++n] = new_idx;
+			}
+			tmp_key[n] = node->u.inner.key[i];
+			tmp_child[++n] = node->u.inner.child[i + 1];
+		}
+		if (pos == BPLUS_INNER_KEYS) {
+			tmp_key[n] = sep;
+			tmp_child[++n] = new_idx;
+		}
+		node->count = (BPLUS_INNER_KEYS + 1) / 2;
+		right->count = (uint16_t)(n - node->count - 1);
+		(void)shim_memcpy(node->u.inner.key, tmp_key, node->count * sizeof(uint32_t));
+		(void)shim_memcpy(node->u.inner.child, tmp_child, (node->count + 1) * sizeof(uint32_t));
+		(void)shim_memcpy(right->u.inner.key, tmp_key + node->count + 1, right->count * sizeof(uint32_t));
+		(void)shim_memcpy(right->u.inner.child, tmp_child + node->count + 1, (right->count + 1) * sizeof(uint32_t));
+		sep = tmp_key[node->count];
+		new_idx = split_idx;
+	}
+
+	/* root was split, grow a new root */
+	idx = bplus_alloc(tree, 0);
+	if (UNLIKELY(idx == BPLUS_NIL))
+		return false;
+	node = &tree->nodes[idx];
+	node->count = 1;
+	node->u.inner.key[0] = sep;
+	node->u.inner.child[0] = tree->root;
+	node->u.inner.child[1] = new_idx;
+	tree->root = idx;
+	return true;
+}
+
+static inline bool OPTIMIZE3 bplus_find(const bplus_tree_t *tree, const uint32_t value)
+{
+	register const bplus_node_t *node;
+	register int i;
+
+	if (UNLIKELY(tree->root == BPLUS_NIL))
+		return false;
+	node = &tree->nodes[tree->root];
+	while (!node->leaf)
+		node = &tree->nodes[node->u.inner.child[bplus_inner_pos(node, value)]];
+	for (i = 0; i < (int)node->count; i++) {
+		if (node->u.leaf.key[i] == value)
+			return true;
+	}
+	return false;
+}
+
+static void stress_tree_bplus(
+	stress_args_t *args,
+	const size_t n,
+	struct tree_node *nodes,
+	stress_tree_metrics_t *metrics,
+	int *rc)
+{
+	size_t i;
+	struct tree_node *node;
+	bplus_tree_t tree;
+	bool find;
+	double t;
+
+	/* leaves are at least half full, so n / 4 nodes is plenty */
+	tree.capacity = (uint32_t)((n / 4) + 64);
+	tree.nodes = (bplus_node_t *)stress_tree_arena_get(&bplus_arena,
+			(size_t)tree.capacity * sizeof(bplus_node_t), "bplus-tree-arena");
+	if (!tree.nodes) {
+		pr_inf_skip("%s: cannot mmap %zu byte B+tree arena, skipping the "
+			"bplus method\n", args->name,
+			(size_t)tree.capacity * sizeof(bplus_node_t));
+		return;
+	}
+	tree.used = 0;
+	tree.root = BPLUS_NIL;
+
+	t = stress_time_now();
+	for (node = nodes, i = 0; i < n; i++, node++) {
+		if (UNLIKELY(!bplus_insert(&tree, node->value))) {
+			pr_fail("%s: bplus tree arena of %" PRIu32 " nodes exhausted\n",
+				args->name, tree.capacity);
+			*rc = EXIT_FAILURE;
+			return;
+		}
+	}
+	metrics->insert += stress_time_now() - t;
+
+	/* Mandatory forward tree check */
+	t = stress_time_now();
+PRAGMA_UNROLL_N(4)
+	for (node = nodes, i = 0; i < n; i++, node++) {
+		find = bplus_find(&tree, node->value);
+		if (UNLIKELY(!find)) {
+			pr_fail("%s: bplus node #%zd not found\n",
+				args->name, i);
+			*rc = EXIT_FAILURE;
+		}
+	}
+	metrics->find += stress_time_now() - t;
+
+	if (g_opt_flags & OPT_FLAGS_VERIFY) {
+		uint32_t idx;
+		size_t count = 0;
+
+		/* optional random find */
+		for (i = 0; i < n; i++) {
+			const size_t j = stress_mwc32modn(n);
+
+			find = bplus_find(&tree, nodes[j].value);
+			if (UNLIKELY(!find)) {
+				pr_fail("%s: bplus node #%zd not found\n",
+					args->name, j);
+				*rc = EXIT_FAILURE;
+			}
+		}
+		/* optional leaf chain walk, must be n ascending keys */
+		for (idx = tree.root; !tree.nodes[idx].leaf; )
+			idx = tree.nodes[idx].u.inner.child[0];
+		for (; idx != BPLUS_NIL; idx = tree.nodes[idx].u.leaf.next) {
+			const bplus_node_t *leaf = &tree.nodes[idx];
+			int k;
+
+			for (k = 0; k < (int)leaf->count; k++, count++) {
+				if (UNLIKELY((k > 0) && (leaf->u.leaf.key[k - 1] >= leaf->u.leaf.key[k]))) {
+					pr_fail("%s: bplus leaf keys out of order\n", args->name);
+					*rc = EXIT_FAILURE;
+				}
+			}
+		}
+		if (UNLIKELY(count != n)) {
+			pr_fail("%s: bplus leaves hold %zu keys, expected %zu\n",
+				args->name, count, n);
+			*rc = EXIT_FAILURE;
+		}
+	}
+	/* the whole tree is freed by resetting the arena */
+	t = stress_time_now();
+	tree.used = 0;
+	tree.root = BPLUS_NIL;
+	metrics->remove += stress_time_now() - t;
+	metrics->count += (double)n;
+}
+
+/*
+ *  Static search tree, a complete binary search tree stored implicitly
+ *  (no pointers) in van Emde Boas layout, the tree of height h is split
+ *  into a top tree of height h - h / 2 and bottom trees of height h / 2
+ *  that are each laid out contiguously, recursively. Searching uses the
+ *  per depth top tree size, bottom tree size and top tree root depth
+ *  tables of Brodal, Fagerberg and Jacob to find each node's position.
+ */
+#define VEB_MAX_HEIGHT		(32)
+#define VEB_SENTINEL		(0xffffffffU)
+
+typedef struct {
+	uint32_t *tree;				/* keys in vEB order */
+	int height;				/* tree height */
+	uint32_t top[VEB_MAX_HEIGHT];		/* top tree size at depth */
+	uint32_t bottom[VEB_MAX_HEIGHT];	/* bottom tree size at depth */
+	int depth[VEB_MAX_HEIGHT];		/* depth of top tree root */
+} veb_tree_t;
+
+static void veb_prepare(veb_tree_t *veb, const int d, const int h)
+{
+	int ht, hb;
+
+	if (h <= 1)
+		return;
+	hb = h >> 1;
+	ht = h - hb;
+	veb->top[d + ht] = (1U << ht) - 1;
+	veb->bottom[d + ht] = (1U << hb) - 1;
+	veb->depth[d + ht] = d;
+	veb_prepare(veb, d, ht);
+	veb_prepare(veb, d + ht, hb);
+}
+
+/*
+ *  veb_layout()
+ *	lay out the subtree of height h rooted at breadth first index r
+ *	at depth d starting at position p, keys are taken in order from
+ *	the sorted keys, positions past n hold sentinels
+ */
+static void OPTIMIZE3 veb_layout(
+	veb_tree_t *veb,
+	const uint32_t *sorted,
+	const size_t n,
+	const uint64_t r,
+	const int d,
+	const int h,
+	const size_t p)
+{
+	uint64_t j;
+	int ht, hb;
+	size_t t, b;
+
+	if (h == 1) {
+		/* in-order rank of breadth first node r */
+		const uint64_t rank = (((r - (1ULL << d)) << 1) + 1) << (veb->height - 1 - d);
+
+		veb->tree[p] = (rank - 1 < n) ? sorted[rank - 1] : VEB_SENTINEL;
+		return;
+	}
+	hb = h >> 1;
+	ht = h - hb;
+	t = ((size_t)1 << ht) - 1;
+	b = ((size_t)1 << hb) - 1;
+	veb_layout(veb, sorted, n, r, d, ht, p);
+	for (j = 0; j < (1ULL << ht); j++)
+		veb_layout(veb, sorted, n, (r << ht) | j, d + ht, hb, p + t + (j * b));
+}
+
+static inline bool OPTIMIZE3 veb_find(const veb_tree_t *veb, const uint32_t value)
+{
+	uint32_t pos[VEB_MAX_HEIGHT];
+	register uint32_t i = 1;
+	register int d;
+
+	pos[0] = 0;
+	for (d = 0; d < veb->height; d++) {
+		register uint32_t key;
+
+		if (d > 0)
+			pos[d] = pos[veb->depth[d]] + veb->top[d] + ((i & veb->top[d]) * veb->bottom[d]);
+		key = veb->tree[pos[d]];
+		if (key == value)
+			return true;
+		i = (i << 1) | (value > key);
+	}
+	return false;
+}
+
+static int veb_cmp(const void *p1, const void *p2)
+{
+	const uint32_t v1 = *(const uint32_t *)p1;
+	const uint32_t v2 = *(const uint32_t *)p2;
+
+	return (v1 > v2) - (v1 < v2);
+}
+
+static void stress_tree_veb(
+	stress_args_t *args,
+	const size_t n,
+	struct tree_node *nodes,
+	stress_tree_metrics_t *metrics,
+	int *rc)
+{
+	size_t i, tree_size;
+	struct tree_node *node;
+	veb_tree_t veb;
+	uint32_t *sorted;
+	bool find;
+	double t;
+
+	(void)shim_memset(&veb, 0, sizeof(veb));
+	for (veb.height = 1; (((size_t)1 << veb.height) - 1) < n; veb.height++)
+		;
+	tree_size = ((size_t)1 << veb.height) - 1;
+	veb.tree = (uint32_t *)stress_tree_arena_get(&veb_arena,
+			(tree_size + n) * sizeof(uint32_t), "veb-tree");
+	if (!veb.tree) {
+		pr_inf_skip("%s: cannot mmap %zu byte vEB tree, skipping the "
+			"veb method\n", args->name, (tree_size + n) * sizeof(uint32_t));
+		return;
+	}
+	sorted = veb.tree + tree_size;
+	veb_prepare(&veb, 0, veb.height);
+
+	/* a static tree is built from the sorted keys in one go */
+	t = stress_time_now();
+	for (node = nodes, i = 0; i < n; i++, node++)
+		sorted[i] = node->value;
+	qsort(sorted, n, sizeof(*sorted), veb_cmp);
+	veb_layout(&veb, sorted, n, 1, 0, veb.height, 0);
+	metrics->insert += stress_time_now() - t;
+
+	/* Mandatory forward tree check */
+	t = stress_time_now();
+PRAGMA_UNROLL_N(4)
+	for (node = nodes, i = 0; i < n; i++, node++) {
+		find = veb_find(&veb, node->value);
+		if (UNLIKELY(!find)) {
+			pr_fail("%s: veb node #%zd not found\n",
+				args->name, i);
+			*rc = EXIT_FAILURE;
+		}
+	}
+	metrics->find += stress_time_now() - t;
+
+	if (g_opt_flags & OPT_FLAGS_VERIFY) {
+		/* optional reverse find */
+		for (node = &nodes[n - 1], i = n - 1; node >= nodes; node--, i--) {
+			find = veb_find(&veb, node->value);
+			if (UNLIKELY(!find)) {
+				pr_fail("%s: veb node #%zd not found\n",
+					args->name, i);
+				*rc = EXIT_FAILURE;
+			}
+		}
+		/* optional absent key find */
+		for (i = 0; i < n; i++) {
+			if (UNLIKELY(veb_find(&veb, (uint32_t)(n + i)))) {
+				pr_fail("%s: veb found key %zu that was not inserted\n",
+					args->name, n + i);
+				*rc = EXIT_FAILURE;
+				break;
+			}
+		}
+	}
+	metrics->count += (double)n;
+}
+
 static void stress_tree_all(
 	stress_args_t *args,
 	const size_t n,
@@ -900,6 +1400,8 @@ static const stress_tree_method_info_t stress_tree_methods[] = {
 	{ "splay",	stress_tree_splay },
 #endif
 	{ "btree",	stress_tree_btree },
+	{ "bplus",	stress_tree_bplus },
+	{ "veb",	stress_tree_veb },
 };
 
 static stress_tree_metrics_t stress_tree_metrics[SIZEOF_ARRAY(stress_tree_methods)];
@@ -1040,8 +1542,24 @@ tidy:
 			stress_metrics_set(args, j, msg,
 				rate, STRESS_METRIC_HARMONIC_MEAN);
 			j++;
+			if (stress_tree_metrics[i].find > 0.0) {
+				(void)snprintf(msg, sizeof(msg), "%s tree lookups per sec", stress_tree_methods[i].name);
+				stress_metrics_set(args, j, msg,
+					stress_tree_metrics[i].count / stress_tree_metrics[i].find,
+					STRESS_METRIC_HARMONIC_MEAN);
+				j++;
+			}
+			if (stress_tree_metrics[i].insert > 0.0) {
+				(void)snprintf(msg, sizeof(msg), "%s tree inserts per sec", stress_tree_methods[i].name);
+				stress_metrics_set(args, j, msg,
+					stress_tree_metrics[i].count / stress_tree_metrics[i].insert,
+					STRESS_METRIC_HARMONIC_MEAN);
+				j++;
+			}
 		}
 	}
+	stress_tree_arena_free(&veb_arena);
+	stress_tree_arena_free(&bplus_arena);
 	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
 	free(nodes);
 
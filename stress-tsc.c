@@ -24,7 +24,12 @@
 #include "core-asm-s390.h"
 #include "core-asm-sparc.h"
 #include "core-asm-x86.h"
+#include "core-affinity.h"
+#include "core-builtin.h"
 #include "core-cpu.h"
+#include "core-killpid.h"
+
+#include <math.h>
 
 #if defined(HAVE_SYS_PLATFORM_PPC_H)
 #include <sys/platform/ppc.h>
@@ -39,12 +44,14 @@ static const stress_help_t help[] = {
 	{ NULL,	"tsc-ops N",	"stop after N TSC bogo operations" },
 	{ NULL, "tsc-lfence",	"add lfence after TSC reads for serialization (x86 only)" },
 	{ NULL,	"tsc-rdscp",	"use rdtscp instead of rdtsc, disables tsc-lfence (x86 only)" },
+	{ NULL,	"tsc-skew",	"measure read cost per counter instruction and cross-CPU counter skew" },
 	{ NULL,	NULL,		NULL }
 };
 
 static const stress_opt_t opts[] = {
 	{ OPT_tsc_lfence, "tsc-lfence", TYPE_ID_BOOL, 0, 1, NULL },
 	{ OPT_tsc_rdtscp, "tsc-rdtscp", TYPE_ID_BOOL, 0, 1, NULL },
+	{ OPT_tsc_skew,   "tsc-skew",   TYPE_ID_BOOL, 0, 1, NULL },
 	END_OPT,
 };
 
@@ -52,6 +59,7 @@ static const stress_opt_t opts[] = {
     defined(HAVE_ASM_LOONG64_RDTIME)
 
 #define HAVE_STRESS_TSC_CAPABILITY
+#define STRESS_TSC_INSN		"rdtime.d"
 
 static bool tsc_supported = true;
 
@@ -72,6 +80,7 @@ static inline uint64_t rdtsc(void) {
     defined(SIGILL)
 
 #define HAVE_STRESS_TSC_CAPABILITY
+#define STRESS_TSC_INSN		"rdtime"
 
 static sigjmp_buf jmpbuf;
 static bool tsc_supported = false;
@@ -121,6 +130,7 @@ static int stress_tsc_supported(const char *name)
     !defined(HAVE_COMPILER_TCC)
 
 #define HAVE_STRESS_TSC_CAPABILITY
+#define STRESS_TSC_INSN		"rdtsc"
 
 #if defined(HAVE_ASM_X86_LFENCE)
 #define HAVE_STRESS_TSC_LFENCE
@@ -167,6 +177,7 @@ static inline uint64_t rdtsc(void)
       defined(HAVE_PPC_GET_TIMEBASE)
 
 #define HAVE_STRESS_TSC_CAPABILITY
+#define STRESS_TSC_INSN		"mftb"
 
 static bool tsc_supported = true;
 
@@ -189,6 +200,7 @@ static inline uint64_t rdtsc(void)
 #elif defined(STRESS_ARCH_S390)
 
 #define HAVE_STRESS_TSC_CAPABILITY
+#define STRESS_TSC_INSN		"stck"
 
 static bool tsc_supported = true;
 
@@ -212,6 +224,7 @@ static inline uint64_t rdtsc(void)
       defined(HAVE_ASM_SPARC_TICK)
 
 #define HAVE_STRESS_TSC_CAPABILITY
+#define STRESS_TSC_INSN		"rd %tick"
 
 static bool tsc_supported = true;
 
@@ -632,6 +645,461 @@ static int stress_tsc_generic(stress_args_t *args, const bool verify, double *du
 	return ret;
 }
 
+/*
+ *  --tsc-skew read cost methods, the generic read is always available
+ */
+typedef enum {
+	STRESS_TSC_METHOD_GENERIC,
+	STRESS_TSC_METHOD_LFENCE,
+	STRESS_TSC_METHOD_RDTSCP,
+	STRESS_TSC_METHOD_MAX,
+} stress_tsc_method_t;
+
+static const char * const stress_tsc_method_names[STRESS_TSC_METHOD_MAX] = {
+	STRESS_TSC_INSN,
+	"lfence+rdtsc",
+	"rdtscp",
+};
+
+/*
+ *  stress_tsc_method_available()
+ *	true if the read method can be used on this CPU
+ */
+static bool stress_tsc_method_available(const stress_tsc_method_t method)
+{
+	switch (method) {
+	case STRESS_TSC_METHOD_GENERIC:
+		return true;
+	case STRESS_TSC_METHOD_LFENCE:
+#if defined(HAVE_STRESS_TSC_LFENCE)
+		return stress_cpu_is_x86();
+#else
+		return false;
+#endif
+	case STRESS_TSC_METHOD_RDTSCP:
+#if defined(HAVE_ASM_X86_RDTSCP)
+		return stress_cpu_is_x86() && stress_cpu_x86_has_rdtscp();
+#else
+		return false;
+#endif
+	default:
+		break;
+	}
+	return false;
+}
+
+/*
+ *  stress_tsc_read_cost()
+ *	time back to back reads using method for secs seconds,
+ *	returns nanoseconds per read
+ */
+static double stress_tsc_read_cost(const stress_tsc_method_t method, const double secs)
+{
+	const double t_start = stress_time_now();
+	double t;
+	uint64_t reads = 0;
+
+	do {
+		int i;
+
+		switch (method) {
+#if defined(HAVE_STRESS_TSC_LFENCE)
+		case STRESS_TSC_METHOD_LFENCE:
+			for (i = 0; i < 64; i++)
+				TSCx32_lfence();
+			break;
+#endif
+#if defined(HAVE_ASM_X86_RDTSCP)
+		case STRESS_TSC_METHOD_RDTSCP:
+			for (i = 0; i < 64; i++)
+				TSCPx32();
+			break;
+#endif
+		default:
+			for (i = 0; i < 64; i++)
+				TSCx32();
+			break;
+		}
+		reads += 64 * 32;
+		t = stress_time_now() - t_start;
+	} while ((t < secs) && stress_continue_flag());
+
+	return (reads > 0) ? (t * STRESS_DBL_NANOSECOND) / (double)reads : 0.0;
+}
+
+/*
+ *  stress_tsc_read_costs()
+ *	report nanoseconds per read for each available read method
+ *	as metrics 1..STRESS_TSC_METHOD_MAX
+ */
+static void stress_tsc_read_costs(stress_args_t *args)
+{
+	size_t i;
+
+	for (i = 0; i < STRESS_TSC_METHOD_MAX; i++) {
+		const stress_tsc_method_t method = (stress_tsc_method_t)i;
+		char msg[64];
+		double ns;
+
+		if (!stress_tsc_method_available(method))
+			continue;
+		ns = stress_tsc_read_cost(method, 0.1);
+		(void)snprintf(msg, sizeof(msg), "nanosecs per %s read",
+			stress_tsc_method_names[i]);
+		stress_metrics_set(args, 1 + i, msg, ns, STRESS_METRIC_HARMONIC_MEAN);
+	}
+}
+
+#if defined(HAVE_ATOMIC_LOAD) &&		\
+    defined(HAVE_ATOMIC_STORE) &&		\
+    defined(HAVE_ATOMIC_ADD_FETCH) &&		\
+    defined(HAVE_SCHED_GETAFFINITY) &&		\
+    defined(HAVE_SCHED_SETAFFINITY)
+#define STRESS_TSC_SKEW
+
+#define TSC_SKEW_WARMUP		(100)	/* untimed exchanges after re-pinning */
+#define TSC_SKEW_ROUNDS		(1000)	/* timed exchanges per CPU pair per pass */
+#define TSC_SKEW_TABLE_CPUS	(32)	/* largest matrix printed as a table */
+#define TSC_SKEW_METRIC		(1 + STRESS_TSC_METHOD_MAX)
+
+/*
+ *  skew mode shared state, the remote counter value travels on
+ *  the same cacheline as the sequence number, control is kept
+ *  on a separate (double) cacheline
+ */
+typedef struct {
+	uint64_t seq ALIGNED(128);	/* line bounced between the two CPUs */
+	uint64_t tsc;			/* counter read by the ponger */
+	uint32_t gen ALIGNED(128);	/* pair generation, bumped by the pinger */
+	uint32_t ready;			/* generation the ponger is pinned for */
+	int32_t cpu;			/* CPU the ponger pins to */
+	bool stop;			/* ponger exit request */
+} stress_tsc_skew_t;
+
+/* tightest bounds of remote minus local counter for one CPU pair */
+typedef struct {
+	int64_t lo;			/* remote - local >= lo */
+	int64_t hi;			/* remote - local <= hi */
+	uint64_t rtt;			/* shortest round trip, ticks */
+	uint64_t violations;		/* rounds where the remote read was out of order */
+} stress_tsc_skew_pair_t;
+
+/*
+ *  stress_tsc_ordered()
+ *	counter read that cannot be hoisted above the preceding
+ *	load of the sequence number
+ */
+static inline uint64_t stress_tsc_ordered(void)
+{
+#if defined(HAVE_STRESS_TSC_LFENCE)
+	lfence();
+#else
+	__atomic_thread_fence(__ATOMIC_SEQ_CST);
+#endif
+	return rdtsc();
+}
+
+/*
+ *  stress_tsc_skew_wait()
+ *	spin until *seq reaches expected, returns false if the
+ *	stressor is stopping
+ */
+static inline bool OPTIMIZE3 stress_tsc_skew_wait(uint64_t *seq, const uint64_t expected)
+{
+	uint32_t spins = 0;
+
+	while (__atomic_load_n(seq, __ATOMIC_ACQUIRE) != expected) {
+		/* avoid live lock if the other end is preempted */
+		if (UNLIKELY(++spins >= 0x10000)) {
+			spins = 0;
+			(void)shim_sched_yield();
+			if (!stress_continue_flag())
+				return false;
+		}
+	}
+	return true;
+}
+
+/*
+ *  stress_tsc_skew_ponger()
+ *	child, pin to the CPU of each new pair and on every odd
+ *	sequence number read the counter and hand it back
+ */
+static void stress_tsc_skew_ponger(stress_tsc_skew_t *skew)
+{
+	uint32_t gen = 0;
+
+	stress_parent_died_alarm();
+
+	for (;;) {
+		uint32_t i, next, spins = 0;
+
+		while ((next = __atomic_load_n(&skew->gen, __ATOMIC_ACQUIRE)) == gen) {
+			if (__atomic_load_n(&skew->stop, __ATOMIC_ACQUIRE) || !stress_continue_flag())
+				return;
+			if (++spins >= 1024) {
+				spins = 0;
+				(void)shim_sched_yield();
+			}
+		}
+		gen = next;
+		stress_placement_set(skew->cpu);
+		__atomic_store_n(&skew->ready, gen, __ATOMIC_RELEASE);
+
+		for (i = 0; i < TSC_SKEW_WARMUP + TSC_SKEW_ROUNDS; i++) {
+			if (UNLIKELY(!stress_tsc_skew_wait(&skew->seq, ((uint64_t)i * 2) + 1)))
+				return;
+			skew->tsc = stress_tsc_ordered();
+			__atomic_store_n(&skew->seq, ((uint64_t)i * 2) + 2, __ATOMIC_RELEASE);
+		}
+	}
+}
+
+/*
+ *  stress_tsc_skew_pair()
+ *	exchange counter reads with the ponger on cpu, the remote read
+ *	happens between the local reads before and after each exchange
+ *	so it bounds remote - local, returns false if stopped
+ */
+static bool OPTIMIZE3 stress_tsc_skew_pair(
+	stress_tsc_skew_t *skew,
+	const int32_t cpu,
+	stress_tsc_skew_pair_t *pair)
+{
+	uint32_t i, gen;
+
+	__atomic_store_n(&skew->seq, 0, __ATOMIC_RELAXED);
+	skew->cpu = cpu;
+	gen = __atomic_add_fetch(&skew->gen, 1, __ATOMIC_ACQ_REL);
+	while (__atomic_load_n(&skew->ready, __ATOMIC_ACQUIRE) != gen) {
+		if (UNLIKELY(!stress_continue_flag()))
+			return false;
+		(void)shim_sched_yield();
+	}
+
+	for (i = 0; i < TSC_SKEW_WARMUP + TSC_SKEW_ROUNDS; i++) {
+		uint64_t t0, t1, remote;
+		int64_t lo, hi;
+
+		t0 = stress_tsc_ordered();
+		__atomic_store_n(&skew->seq, ((uint64_t)i * 2) + 1, __ATOMIC_RELEASE);
+		if (UNLIKELY(!stress_tsc_skew_wait(&skew->seq, ((uint64_t)i * 2) + 2)))
+			return false;
+		t1 = stress_tsc_ordered();
+		remote = skew->tsc;
+
+		if (i < TSC_SKEW_WARMUP)
+			continue;
+		lo = (int64_t)(remote - t1);
+		hi = (int64_t)(remote - t0);
+		if (lo > pair->lo)
+			pair->lo = lo;
+		if (hi < pair->hi)
+			pair->hi = hi;
+		if ((t1 - t0) < pair->rtt)
+			pair->rtt = t1 - t0;
+		/* remote read must lie between the two local reads */
+		if ((lo > 0) || (hi < 0))
+			pair->violations++;
+	}
+	return true;
+}
+
+/*
+ *  stress_tsc_skew_ns()
+ *	best estimate of remote - local skew of a pair in nanoseconds,
+ *	the midpoint of the tightest bounds
+ */
+static inline double stress_tsc_skew_ns(const stress_tsc_skew_pair_t *pair, const double ns_per_tick)
+{
+	return (((double)pair->lo + (double)pair->hi) / 2.0) * ns_per_tick;
+}
+
+/*
+ *  stress_tsc_skew_table()
+ *	log the matrix of column CPU minus row CPU counter skew
+ */
+static void stress_tsc_skew_table(
+	stress_args_t *args,
+	const uint32_t *cpus,
+	const uint32_t n,
+	const stress_tsc_skew_pair_t *pairs,
+	const double ns_per_tick)
+{
+	char *line;
+	const size_t line_len = 8 + ((size_t)n * 16);
+	uint32_t i, j;
+
+	line = (char *)malloc(line_len);
+	if (!line)
+		return;
+
+	pr_inf("%s: counter skew of column CPU minus row CPU (nanosecs):\n", args->name);
+	(void)snprintf(line, line_len, "%6s", "cpu");
+	for (j = 0; j < n; j++)
+		(void)snprintf(line + strlen(line), line_len - strlen(line), " %8" PRIu32, cpus[j]);
+	pr_inf("%s: %s\n", args->name, line);
+
+	for (i = 0; i < n; i++) {
+		(void)snprintf(line, line_len, "%6" PRIu32, cpus[i]);
+		for (j = 0; j < n; j++) {
+			const uint32_t lo = STRESS_MINIMUM(i, j), hi = STRESS_MAXIMUM(i, j);
+			/* upper triangle index of pair lo, hi with lo < hi */
+			const size_t k = ((size_t)lo * ((2 * (size_t)n) - lo - 1)) / 2 + (hi - lo - 1);
+
+			if (i == j) {
+				(void)snprintf(line + strlen(line), line_len - strlen(line), " %8s", "-");
+			} else if (pairs[k].rtt == UINT64_MAX) {
+				(void)snprintf(line + strlen(line), line_len - strlen(line), " %8s", "?");
+			} else {
+				/* pairs are measured with the lower CPU index local */
+				const double ns = stress_tsc_skew_ns(&pairs[k], ns_per_tick);
+
+				(void)snprintf(line + strlen(line), line_len - strlen(line), " %8.1f",
+					(i < j) ? ns : -ns);
+			}
+		}
+		pr_inf("%s: %s\n", args->name, line);
+	}
+	free(line);
+}
+
+/*
+ *  stress_tsc_skew()
+ *	pin two processes to each pair of CPUs in turn and ping-pong
+ *	counter reads over a shared cacheline, repeating over all pairs
+ *	until the run ends. Returns EXIT_NO_RESOURCE if it cannot run
+ *	so the caller falls back to the normal read loop
+ */
+static int stress_tsc_skew(stress_args_t *args, const bool verify)
+{
+	stress_tsc_skew_t *skew;
+	stress_tsc_skew_pair_t *pairs = NULL;
+	uint32_t *cpus = NULL, n_cpus, n, i, j, k, n_pairs;
+	uint64_t violations = 0, c0, c1;
+	double t0, t1, ns_per_tick, max_skew = 0.0, rtt_sum = 0.0;
+	size_t measured = 0;
+	pid_t pid;
+	int rc = EXIT_SUCCESS;
+
+	n_cpus = stress_get_usable_cpus(&cpus, true);
+	/* drop offline or otherwise disallowed CPUs */
+	for (n = 0, i = 0; i < n_cpus; i++) {
+		stress_placement_set((int32_t)cpus[i]);
+		if (stress_get_cpu() == cpus[i])
+			cpus[n++] = cpus[i];
+	}
+	n_pairs = (n * (n - 1)) / 2;
+	if ((n < 2) || (n_pairs == 0)) {
+		pr_inf("%s: --tsc-skew needs at least 2 usable CPUs, skipping skew check\n",
+			args->name);
+		stress_free_usable_cpus(&cpus);
+		return EXIT_NO_RESOURCE;
+	}
+	pairs = (stress_tsc_skew_pair_t *)calloc(n_pairs, sizeof(*pairs));
+	skew = (stress_tsc_skew_t *)stress_mmap_populate(NULL, sizeof(*skew),
+		PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+	if (!pairs || (skew == MAP_FAILED)) {
+		pr_inf("%s: cannot allocate %" PRIu32 " CPU pair results, skipping skew check\n",
+			args->name, n_pairs);
+		if (skew != MAP_FAILED)
+			(void)munmap((void *)skew, sizeof(*skew));
+		free(pairs);
+		stress_free_usable_cpus(&cpus);
+		return EXIT_NO_RESOURCE;
+	}
+	stress_set_vma_anon_name(skew, sizeof(*skew), "tsc-skew");
+	(void)shim_memset((void *)skew, 0, sizeof(*skew));
+	for (k = 0; k < n_pairs; k++) {
+		pairs[k].lo = INT64_MIN;
+		pairs[k].hi = INT64_MAX;
+		pairs[k].rtt = UINT64_MAX;
+	}
+	pr_dbg("%s: measuring counter skew of %" PRIu32 " CPU pairs of %" PRIu32 " CPUs\n",
+		args->name, n_pairs, n);
+
+	/* ticks to nanoseconds, the counter need not tick at the CPU clock */
+	t0 = stress_time_now();
+	c0 = rdtsc();
+	while (((t1 = stress_time_now()) - t0) < 0.01)
+		;
+	c1 = rdtsc();
+	ns_per_tick = (c1 > c0) ? ((t1 - t0) * STRESS_DBL_NANOSECOND) / (double)(c1 - c0) : 0.0;
+again:
+	pid = fork();
+	if (pid < 0) {
+		if (stress_redo_fork(args, errno))
+			goto again;
+		if (UNLIKELY(!stress_continue(args)))
+			goto finish;
+		pr_err("%s: fork failed: errno=%d: (%s)\n",
+			args->name, errno, strerror(errno));
+		rc = EXIT_NO_RESOURCE;
+		goto finish;
+	} else if (pid == 0) {
+		stress_tsc_skew_ponger(skew);
+		_exit(EXIT_SUCCESS);
+	}
+
+	do {
+		for (k = 0, i = 0; i < n; i++) {
+			stress_placement_set((int32_t)cpus[i]);
+			for (j = i + 1; j < n; j++, k++) {
+				if (UNLIKELY(!stress_tsc_skew_pair(skew, (int32_t)cpus[j], &pairs[k])))
+					goto stop;
+				stress_bogo_add(args, 2 * TSC_SKEW_ROUNDS);
+				if (UNLIKELY(!stress_continue(args)))
+					goto stop;
+			}
+		}
+	} while (stress_continue(args));
+stop:
+	__atomic_store_n(&skew->stop, true, __ATOMIC_RELEASE);
+	if (stress_kill_and_wait(args, pid, SIGALRM, false) != EXIT_SUCCESS)
+		rc = EXIT_FAILURE;
+
+	for (k = 0, i = 0; i < n; i++) {
+		for (j = i + 1; j < n; j++, k++) {
+			double ns;
+
+			if (pairs[k].rtt == UINT64_MAX)
+				continue;
+			ns = fabs(stress_tsc_skew_ns(&pairs[k], ns_per_tick));
+			if (ns > max_skew)
+				max_skew = ns;
+			rtt_sum += (double)pairs[k].rtt * ns_per_tick;
+			measured++;
+			violations += pairs[k].violations;
+			if (pairs[k].violations) {
+				pr_inf("%s: CPU %" PRIu32 " counter read out of order with CPU %" PRIu32
+					" in %" PRIu64 " exchanges, skew bounds %" PRId64 "..%" PRId64 " ticks\n",
+					args->name, cpus[j], cpus[i], pairs[k].violations,
+					pairs[k].lo, pairs[k].hi);
+			}
+		}
+	}
+	if (violations && verify) {
+		pr_fail("%s: counter not monotonic across CPUs, %" PRIu64 " out of order exchanges\n",
+			args->name, violations);
+		rc = EXIT_FAILURE;
+	}
+	stress_metrics_set(args, TSC_SKEW_METRIC, "nanosecs max cross-CPU skew",
+		max_skew, STRESS_METRIC_MAXIMUM);
+	stress_metrics_set(args, TSC_SKEW_METRIC + 1, "nanosecs cross-CPU exchange round trip",
+		measured ? rtt_sum / (double)measured : 0.0, STRESS_METRIC_HARMONIC_MEAN);
+	stress_metrics_set(args, TSC_SKEW_METRIC + 2, "cross-CPU out of order exchanges",
+		(double)violations, STRESS_METRIC_TOTAL);
+	if (n <= TSC_SKEW_TABLE_CPUS)
+		stress_tsc_skew_table(args, cpus, n, pairs, ns_per_tick);
+finish:
+	(void)munmap((void *)skew, sizeof(*skew));
+	free(pairs);
+	stress_free_usable_cpus(&cpus);
+
+	return rc;
+}
+#endif
+
 /*
  *  stress_tsc()
  *      stress Intel tsc instruction
@@ -640,6 +1108,7 @@ static int stress_tsc(stress_args_t *args)
 {
 	bool tsc_lfence = false;
 	bool tsc_rdtscp = false;
+	bool tsc_skew = false;
 	int ret = EXIT_SUCCESS;
 	int (*tsc_func)(stress_args_t *args, const bool verify, double *duration) = stress_tsc_generic;
 
@@ -649,6 +1118,7 @@ static int stress_tsc(stress_args_t *args)
 
 	(void)stress_get_setting("tsc-lfence", &tsc_lfence);
 	(void)stress_get_setting("tsc-rdtscp", &tsc_rdtscp);
+	(void)stress_get_setting("tsc-skew", &tsc_skew);
 
 	if (tsc_lfence) {
 #if defined(HAVE_STRESS_TSC_LFENCE)
@@ -690,6 +1160,25 @@ static int stress_tsc(stress_args_t *args)
 		const bool verify = !!(g_opt_flags & OPT_FLAGS_VERIFY);
 		double duration = 0.0, count;
 
+		if (tsc_skew) {
+			stress_tsc_read_costs(args);
+#if defined(STRESS_TSC_SKEW)
+			/* one instance checks skew, the CPU pairs are shared */
+			if (args->instance == 0) {
+				const int rc = stress_tsc_skew(args, verify);
+
+				if (rc != EXIT_NO_RESOURCE) {
+					stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
+					return rc;
+				}
+			}
+#else
+			if (args->instance == 0)
+				pr_inf("%s: --tsc-skew skew check not supported, "
+					"only measuring read costs\n", args->name);
+#endif
+		}
+
 		tsc_func(args, verify, &duration);
 		count = 32.0 * 4.0 * (double)stress_bogo_get(args);
 		duration = (count > 0.0) ? duration / count : 0.0;
@@ -706,6 +1195,7 @@ const stressor_info_t stress_tsc_info = {
 	.supported = stress_tsc_supported,
 	.class = CLASS_CPU,
 	.verify = VERIFY_OPTIONAL,
+	.metrics_max = 1 + STRESS_TSC_METHOD_MAX + 3,
 	.opts = opts,
 	.help = help
 };
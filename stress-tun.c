@@ -23,6 +23,7 @@
 #include "core-capabilities.h"
 #include "core-killpid.h"
 #include "core-net.h"
+#include "core-pthread.h"
 
 #include <sys/ioctl.h>
 
@@ -44,19 +45,44 @@ UNEXPECTED
 UNEXPECTED
 #endif
 
+#if defined(HAVE_LINUX_VIRTIO_NET_H)
+#include <linux/virtio_net.h>
+#endif
+
+#if defined(HAVE_NETINET_IP_H)
+#include <netinet/ip.h>
+#endif
+
+#if defined(HAVE_NETINET_TCP_H)
+#include <netinet/tcp.h>
+#endif
+
+#include <net/ethernet.h>
 #include <arpa/inet.h>
 
 #define PACKETS_TO_SEND		(64)
 
+#define MIN_TUN_QUEUES		(1)
+#define MAX_TUN_QUEUES		(256)
+#define TUN_QUEUE_METRICS	(32)	/* queues with per-queue metrics */
+
+#define TUN_MTU			(1500)
+#define MIN_TUN_GSO		(TUN_MTU)
+#define MAX_TUN_GSO		(65000)	/* GSO frame payload bytes */
+
 static const stress_help_t help[] = {
 	{ NULL,	"tun N",	"start N workers exercising tun interface" },
+	{ NULL,	"tun-gso N",	"send N byte TSO frames with --tun-queues" },
 	{ NULL,	"tun-ops N",	"stop after N tun bogo operations" },
+	{ NULL,	"tun-queues N",	"write vnet header frames to N queues, one thread per queue" },
 	{ NULL, "tun-tap",	"use TAP interface instead of TUN" },
 	{ NULL,	NULL,		NULL }
 };
 
 static const stress_opt_t opts[] = {
-	{ OPT_tun_tap, "tun-tap", TYPE_ID_BOOL, 0, 1, NULL },
+	{ OPT_tun_gso,	  "tun-gso",	TYPE_ID_SIZE_T_BYTES_VM, MIN_TUN_GSO, MAX_TUN_GSO, NULL },
+	{ OPT_tun_queues, "tun-queues", TYPE_ID_UINT32, MIN_TUN_QUEUES, MAX_TUN_QUEUES, NULL },
+	{ OPT_tun_tap,	  "tun-tap",	TYPE_ID_BOOL, 0, 1, NULL },
 	END_OPT,
 };
 
@@ -96,6 +122,360 @@ static int stress_tun_supported(const char *name)
 	return 0;
 }
 
+#if defined(HAVE_LIB_PTHREAD) &&		\
+    defined(HAVE_LINUX_VIRTIO_NET_H) &&		\
+    defined(HAVE_NETINET_IP_H) &&		\
+    defined(HAVE_NETINET_TCP_H) &&		\
+    defined(IFF_MULTI_QUEUE) &&			\
+    defined(IFF_VNET_HDR) &&			\
+    defined(IFF_NO_PI) &&			\
+    defined(VIRTIO_NET_HDR_F_NEEDS_CSUM) &&	\
+    defined(VIRTIO_NET_HDR_GSO_TCPV4) &&	\
+    defined(SIOCGIFFLAGS) &&			\
+    defined(SIOCSIFFLAGS)
+#define STRESS_TUN_MULTI_QUEUE
+
+/*
+ *  per queue writer state
+ */
+typedef struct {
+	int fd;			/* queue file descriptor */
+	pthread_t pthread;	/* writer thread */
+	int pthread_ret;	/* pthread_create return */
+	int err;		/* errno of a failed write, 0 if none */
+	const uint8_t *frame;	/* vnet header + packet to write */
+	size_t frame_len;	/* bytes per write */
+	size_t ip_len;		/* IP bytes per write */
+	size_t segs;		/* wire packets per write */
+	uint64_t frames;	/* frames written */
+	double duration;	/* time spent writing */
+} ALIGNED(64) stress_tun_queue_t;
+
+static volatile bool tun_queues_stop;
+
+/*
+ *  stress_tun_queue_writer()
+ *	write the same frame to a queue until told to stop
+ */
+static void *stress_tun_queue_writer(void *arg)
+{
+	stress_tun_queue_t *q = (stress_tun_queue_t *)arg;
+	const double t = stress_time_now();
+
+	while (LIKELY(!tun_queues_stop && stress_continue_flag())) {
+		if (UNLIKELY(write(q->fd, q->frame, q->frame_len) < 0)) {
+			if ((errno == EINTR) || (errno == EAGAIN) || (errno == ENOBUFS))
+				continue;
+			q->err = errno;
+			break;
+		}
+		q->frames++;
+	}
+	q->duration = stress_time_now() - t;
+	return &g_nowt;
+}
+
+/*
+ *  stress_tun_tcp_csum()
+ *	TCP pseudo header partial checksum for checksum offload,
+ *	len is zero for TSO frames as each segment has its own length
+ */
+static uint16_t stress_tun_tcp_csum(const struct iphdr *ip, const uint16_t len)
+{
+	uint32_t sum = 0;
+
+	sum += (ntohl(ip->saddr) >> 16) + (ntohl(ip->saddr) & 0xffff);
+	sum += (ntohl(ip->daddr) >> 16) + (ntohl(ip->daddr) & 0xffff);
+	sum += IPPROTO_TCP + len;
+	while (sum >> 16)
+		sum = (sum & 0xffff) + (sum >> 16);
+	return htons((uint16_t)sum);
+}
+
+/*
+ *  stress_tun_queue_frame()
+ *	build a vnet header and an IPv4 TCP packet to a non-local
+ *	address on the tun subnet, with checksum offload and TSO if
+ *	payload is more than one MSS, returns the frame length
+ */
+static size_t stress_tun_queue_frame(
+	uint8_t *frame,
+	const bool tun_tap,
+	const uint8_t *hwaddr,
+	const struct in_addr *tun_addr,
+	const size_t payload,
+	size_t *segs)
+{
+	const size_t l2_len = tun_tap ? sizeof(struct ether_header) : 0;
+	const size_t hdrs_len = sizeof(struct iphdr) + sizeof(struct tcphdr);
+	const size_t mss = TUN_MTU - hdrs_len;
+	struct virtio_net_hdr *vnet = (struct virtio_net_hdr *)frame;
+	uint8_t *pkt = frame + sizeof(*vnet);
+	struct iphdr *ip = (struct iphdr *)(pkt + l2_len);
+	struct tcphdr *tcp = (struct tcphdr *)(pkt + l2_len + sizeof(*ip));
+	const bool gso = payload > mss;
+	const uint32_t host = ntohl(tun_addr->s_addr);
+
+	(void)shim_memset(frame, 0, sizeof(*vnet) + l2_len + hdrs_len);
+	if (tun_tap) {
+		struct ether_header *eth = (struct ether_header *)pkt;
+
+		/* addressed to the tap itself so it reaches the IP layer */
+		(void)shim_memcpy(eth->ether_dhost, hwaddr, ETH_ALEN);
+		(void)shim_memcpy(eth->ether_shost, hwaddr, ETH_ALEN);
+		eth->ether_shost[0] ^= 0x02;
+		eth->ether_type = htons(ETHERTYPE_IP);
+	}
+	ip->version = 4;
+	ip->ihl = sizeof(*ip) >> 2;
+	ip->tot_len = htons((uint16_t)(hdrs_len + payload));
+	ip->id = htons(stress_mwc16());
+	ip->ttl = 64;
+	ip->protocol = IPPROTO_TCP;
+	/* peer and destination are on the tun subnet but not local */
+	ip->saddr = htonl((host & ~0xffU) | ((host + 1) & 0xfe));
+	ip->daddr = htonl((host & ~0xffU) | ((host + 2) & 0xfe) | 1);
+	ip->check = stress_ipv4_checksum((uint16_t *)ip, sizeof(*ip));
+
+	tcp->source = htons(40000);
+	tcp->dest = htons(9);
+	tcp->seq = htonl(stress_mwc32());
+	tcp->doff = sizeof(*tcp) >> 2;
+	tcp->ack = 1;
+	tcp->psh = 1;
+	tcp->window = htons(65535);
+	tcp->check = stress_tun_tcp_csum(ip, gso ? 0 : (uint16_t)(sizeof(*tcp) + payload));
+	(void)shim_memset(pkt + l2_len + hdrs_len, 0x5a, payload);
+
+	/* the vnet header is in native endian unless TUNSETVNETLE/BE is used */
+	vnet->flags = VIRTIO_NET_HDR_F_NEEDS_CSUM;
+	vnet->csum_start = (uint16_t)(l2_len + sizeof(*ip));
+	vnet->csum_offset = (uint16_t)offsetof(struct tcphdr, check);
+	vnet->hdr_len = (uint16_t)(l2_len + hdrs_len);
+	if (gso) {
+		vnet->gso_type = VIRTIO_NET_HDR_GSO_TCPV4;
+		vnet->gso_size = (uint16_t)mss;
+		*segs = (payload + mss - 1) / mss;
+	} else {
+		vnet->gso_type = VIRTIO_NET_HDR_GSO_NONE;
+		*segs = 1;
+	}
+	return sizeof(*vnet) + l2_len + hdrs_len + payload;
+}
+
+/*
+ *  stress_tun_queues()
+ *	--tun-queues mode, open an IFF_MULTI_QUEUE IFF_VNET_HDR device
+ *	with tun_queues queues and write checksum offloaded (and with
+ *	--tun-gso, TSO) frames to each queue from its own thread, as
+ *	a vhost-net guest transmit path does. The frames are routed
+ *	to a non-local address and dropped (or forwarded back out of
+ *	the device) by the host stack
+ */
+static int stress_tun_queues(
+	stress_args_t *args,
+	const uint32_t tun_queues,
+	const size_t tun_gso,
+	const bool tun_tap)
+{
+	stress_tun_queue_t *queues;
+	struct ifreq ifr;
+	struct sockaddr_in *sin;
+	struct in_addr tun_addr;
+	uint8_t hwaddr[ETH_ALEN];
+	uint8_t *frame;
+	const size_t frame_size = sizeof(struct virtio_net_hdr) +
+		sizeof(struct ether_header) + sizeof(struct iphdr) +
+		sizeof(struct tcphdr) + MAX_TUN_GSO;
+	size_t frame_len, segs, ip_len;
+	const size_t payload = tun_gso ? tun_gso :
+		TUN_MTU - sizeof(struct iphdr) - sizeof(struct tcphdr);
+	char ip_addr[32];
+	uint64_t frames = 0, packets = 0;
+	double bytes = 0.0, min_gbits = -1.0, duration = 0.0, rate;
+	int sfd, ret, rc = EXIT_SUCCESS;
+	uint32_t i, n_queues = 0;
+	size_t idx = 3;
+
+	queues = (stress_tun_queue_t *)calloc(tun_queues, sizeof(*queues));
+	frame = (uint8_t *)calloc(1, frame_size);
+	if (!queues || !frame) {
+		pr_inf_skip("%s: cannot allocate %" PRIu32 " queues, skipping stressor\n",
+			args->name, tun_queues);
+		free(frame);
+		free(queues);
+		return EXIT_NO_RESOURCE;
+	}
+
+	(void)shim_memset(&ifr, 0, sizeof(ifr));
+	for (i = 0; i < tun_queues; i++) {
+		queues[i].pthread_ret = -1;
+		queues[i].fd = open(tun_dev, O_RDWR);
+		if (queues[i].fd < 0) {
+			rc = stress_exit_status(errno);
+			pr_fail("%s: cannot open %s, errno=%d (%s)\n",
+				args->name, tun_dev, errno, strerror(errno));
+			goto close_queues;
+		}
+		n_queues++;
+		/* the first queue names the device, the rest attach to it */
+		ifr.ifr_flags = (tun_tap ? IFF_TAP : IFF_TUN) |
+			IFF_NO_PI | IFF_MULTI_QUEUE | IFF_VNET_HDR;
+		if (ioctl(queues[i].fd, TUNSETIFF, (void *)&ifr) < 0) {
+			if ((i == 0) && (errno == EINVAL)) {
+				pr_inf_skip("%s: IFF_MULTI_QUEUE with IFF_VNET_HDR not supported, "
+					"skipping stressor\n", args->name);
+				rc = EXIT_NOT_IMPLEMENTED;
+				goto close_queues;
+			}
+			rc = stress_exit_status(errno);
+			pr_fail("%s: ioctl TUNSETIFF on queue %" PRIu32 " failed, errno=%d (%s)\n",
+				args->name, i, errno, strerror(errno));
+			goto close_queues;
+		}
+#if defined(TUNSETOFFLOAD) &&	\
+    defined(TUN_F_CSUM) &&	\
+    defined(TUN_F_TSO4)
+		VOID_RET(int, ioctl(queues[i].fd, TUNSETOFFLOAD, TUN_F_CSUM | TUN_F_TSO4));
+#endif
+	}
+	VOID_RET(int, ioctl(queues[0].fd, TUNSETPERSIST, 0));
+
+	sfd = socket(AF_INET, SOCK_DGRAM, 0);
+	if (sfd < 0) {
+		rc = stress_exit_status(errno);
+		pr_fail("%s: socket failed, errno=%d (%s)\n",
+			args->name, errno, strerror(errno));
+		goto close_queues;
+	}
+	ifr.ifr_addr.sa_family = AF_INET;
+	sin = (struct sockaddr_in *)&ifr.ifr_addr;
+	for (ret = -1, i = 0; i < 32; i++) {
+		(void)snprintf(ip_addr, sizeof(ip_addr), "192.168.%" PRIu8 ".%" PRIu8,
+			(uint8_t)((stress_mwc8modn(252)) + 2),
+			(uint8_t)((stress_mwc8modn(250)) + 1));
+		(void)inet_pton(AF_INET, ip_addr, &sin->sin_addr);
+		ret = ioctl(sfd, SIOCSIFADDR, &ifr);
+		if (ret == 0)
+			break;
+	}
+	tun_addr = sin->sin_addr;
+	if ((ret == 0) && (ioctl(sfd, SIOCGIFFLAGS, &ifr) == 0)) {
+		ifr.ifr_flags |= IFF_UP | IFF_RUNNING;
+		ret = ioctl(sfd, SIOCSIFFLAGS, &ifr);
+	}
+	(void)shim_memset(hwaddr, 0, sizeof(hwaddr));
+#if defined(SIOCGIFHWADDR)
+	if ((ret == 0) && tun_tap && (ioctl(sfd, SIOCGIFHWADDR, &ifr) == 0))
+		(void)shim_memcpy(hwaddr, ifr.ifr_hwaddr.sa_data, ETH_ALEN);
+#endif
+	(void)close(sfd);
+	if (ret < 0) {
+		rc = stress_exit_status(errno);
+		pr_fail("%s: cannot assign an address to and bring up %s, errno=%d (%s)\n",
+			args->name, ifr.ifr_name, errno, strerror(errno));
+		goto close_queues;
+	}
+
+	frame_len = stress_tun_queue_frame(frame, tun_tap, hwaddr, &tun_addr, payload, &segs);
+	ip_len = sizeof(struct iphdr) + sizeof(struct tcphdr) + payload;
+
+	/* check the kernel accepts the frame before starting the writers */
+	if (write(queues[0].fd, frame, frame_len) < 0) {
+		if (errno == EINVAL) {
+			pr_inf_skip("%s: vnet header frame rejected, errno=%d (%s), "
+				"skipping stressor\n", args->name, errno, strerror(errno));
+			rc = EXIT_NOT_IMPLEMENTED;
+		} else {
+			rc = stress_exit_status(errno);
+			pr_fail("%s: write to %s failed, errno=%d (%s)\n",
+				args->name, ifr.ifr_name, errno, strerror(errno));
+		}
+		goto close_queues;
+	}
+	pr_dbg("%s: %s with %" PRIu32 " queues, %zu byte frames of %zu packets\n",
+		args->name, ifr.ifr_name, tun_queues, frame_len, segs);
+
+	tun_queues_stop = false;
+	for (i = 0; i < n_queues; i++) {
+		queues[i].frame = frame;
+		queues[i].frame_len = frame_len;
+		queues[i].ip_len = ip_len;
+		queues[i].segs = segs;
+		queues[i].pthread_ret = pthread_create(&queues[i].pthread, NULL,
+			stress_tun_queue_writer, &queues[i]);
+		if (queues[i].pthread_ret != 0) {
+			pr_inf("%s: only %" PRIu32 " of %" PRIu32 " queue threads created\n",
+				args->name, i, n_queues);
+			break;
+		}
+	}
+
+	while (stress_continue(args)) {
+		uint64_t total = 0;
+
+		(void)shim_usleep(100000);
+		for (i = 0; i < n_queues; i++)
+			total += queues[i].frames;
+		stress_bogo_set(args, total);
+		if (i == 0)
+			break;
+	}
+	tun_queues_stop = true;
+
+	for (i = 0; i < n_queues; i++) {
+		stress_tun_queue_t *q = &queues[i];
+		double gbits, pps;
+
+		if (q->pthread_ret != 0)
+			continue;
+		(void)pthread_join(q->pthread, NULL);
+		if (q->err) {
+			pr_fail("%s: write to queue %" PRIu32 " failed, errno=%d (%s)\n",
+				args->name, i, q->err, strerror(q->err));
+			rc = EXIT_FAILURE;
+		}
+		frames += q->frames;
+		packets += q->frames * q->segs;
+		bytes += (double)q->frames * (double)q->ip_len;
+		if (q->duration > duration)
+			duration = q->duration;
+		gbits = (q->duration > 0.0) ?
+			((double)q->frames * (double)q->ip_len * 8.0) / (q->duration * 1.0E9) : 0.0;
+		pps = (q->duration > 0.0) ?
+			((double)q->frames * (double)q->segs) / q->duration : 0.0;
+		if ((min_gbits < 0.0) || (gbits < min_gbits))
+			min_gbits = gbits;
+		if (i < TUN_QUEUE_METRICS) {
+			char msg[64];
+
+			(void)snprintf(msg, sizeof(msg), "queue %" PRIu32 " Gbit/s", i);
+			stress_metrics_set(args, idx++, msg, gbits, STRESS_METRIC_HARMONIC_MEAN);
+			(void)snprintf(msg, sizeof(msg), "queue %" PRIu32 " packets per sec", i);
+			stress_metrics_set(args, idx++, msg, pps, STRESS_METRIC_HARMONIC_MEAN);
+		}
+	}
+	stress_bogo_set(args, frames);
+
+	rate = (duration > 0.0) ? (bytes * 8.0) / (duration * 1.0E9) : 0.0;
+	stress_metrics_set(args, 0, "Gbit/s total",
+		rate, STRESS_METRIC_HARMONIC_MEAN);
+	rate = (duration > 0.0) ? (double)packets / duration : 0.0;
+	stress_metrics_set(args, 1, "packets per sec total",
+		rate, STRESS_METRIC_HARMONIC_MEAN);
+	stress_metrics_set(args, 2, "slowest queue Gbit/s",
+		min_gbits > 0.0 ? min_gbits : 0.0, STRESS_METRIC_HARMONIC_MEAN);
+
+close_queues:
+	for (i = 0; i < n_queues; i++)
+		(void)close(queues[i].fd);
+	free(frame);
+	free(queues);
+
+	return rc;
+}
+#endif
+
 /*
  *  stress_tun
  *	stress tun interface
@@ -107,13 +487,31 @@ static int stress_tun(stress_args_t *args)
 	const gid_t group = getegid();
 	char ip_addr[32];
 	bool tun_tap = false;
+	uint32_t tun_queues = 0;
+	size_t tun_gso = 0;
 
+	(void)stress_get_setting("tun-gso", &tun_gso);
+	(void)stress_get_setting("tun-queues", &tun_queues);
 	(void)stress_get_setting("tun-tap", &tun_tap);
 
 	stress_set_proc_state(args->name, STRESS_STATE_SYNC_WAIT);
 	stress_sync_start_wait(args);
 	stress_set_proc_state(args->name, STRESS_STATE_RUN);
 
+	if (tun_queues) {
+#if defined(STRESS_TUN_MULTI_QUEUE)
+		rc = stress_tun_queues(args, tun_queues, tun_gso, tun_tap);
+		stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
+		return rc;
+#else
+		if (args->instance == 0)
+			pr_inf("%s: multi-queue vnet header tun devices or pthreads "
+				"are not supported, ignoring --tun-queues\n", args->name);
+#endif
+	} else if (tun_gso && (args->instance == 0)) {
+		pr_inf("%s: --tun-gso requires --tun-queues, ignoring it\n", args->name);
+	}
+
 	do {
 		int i, fd, sfd, ret, status, parent_cpu;
 		pid_t pid;
@@ -190,6 +190,7 @@ const stressor_info_t stress_udp_flood_info = {
 	.class = CLASS_NETWORK | CLASS_OS,
 	.opts = opts,
 	.verify = VERIFY_ALWAYS,
+	.metrics_max = 3,
 	.help = help
 };
 #else
@@ -22,6 +22,7 @@
 #include "core-builtin.h"
 #include "core-cpu.h"
 #include "core-killpid.h"
+#include "core-latency.h"
 #include "core-net.h"
 
 #include <sys/ioctl.h>
@@ -44,11 +45,29 @@ UNEXPECTED
 UNEXPECTED
 #endif
 
+#if defined(HAVE_POLL_H)
+#include <poll.h>
+#endif
+
 #include <netinet/in.h>
 
 #define DEFAULT_UDP_PORT	(7000)
 
 #define UDP_BUF			(1024)	/* UDP I/O buffer size */
+#define UDP_GRO_BUF		(65536)	/* UDP GRO coalesced receive buffer size */
+#define UDP_GSO_MAX_PAYLOAD	(65000)	/* maximum GSO send size */
+#define UDP_GSO_MAX_SEGS	(64)	/* kernel UDP_MAX_SEGMENTS */
+
+#define MIN_UDP_BATCH		(1)
+#define MAX_UDP_BATCH		(256)
+#define DEFAULT_UDP_BATCH	(1)
+
+#define MIN_UDP_GSO		(16)
+#define MAX_UDP_GSO		(16 * KB)
+
+#define MIN_UDP_RR		(1)
+#define MAX_UDP_RR		(16 * KB)
+#define UDP_RR_TIMEOUT_MS	(100)	/* response timeout before a resend */
 
 /* See bugs section of udplite(7) */
 #if !defined(SOL_UDPLITE)
@@ -60,18 +79,76 @@ UNEXPECTED
 #if !defined(UDPLITE_RECV_CSCOV)
 #define UDPLITE_RECV_CSCOV	(11)
 #endif
+#if !defined(SOL_UDP)
+#define SOL_UDP			(17)
+#endif
+
+#if defined(HAVE_SENDMMSG) &&	\
+    defined(HAVE_RECVMMSG) &&	\
+    defined(MSG_WAITFORONE)
+#define STRESS_UDP_MMSG		(1)
+#endif
+
+typedef struct {
+	uint64_t packets;	/* datagrams, GSO/GRO segments counted individually */
+	uint64_t bytes;		/* payload bytes */
+	uint64_t syscalls;	/* send or receive system calls */
+} stress_udp_stats_t;
 
 static const stress_help_t help[] = {
 	{ NULL,	"udp N",	"start N workers performing UDP send/receives " },
+	{ NULL,	"udp-batch N",	"send and receive N datagrams per sendmmsg/recvmmsg" },
 	{ NULL,	"udp-domain D",	"specify domain, default is ipv4" },
 	{ NULL, "udp-gro",	"enable UDP-GRO" },
+	{ NULL,	"udp-gso N",	"enable UDP-GSO with N byte segments" },
 	{ NULL,	"udp-if I",	"use network interface I, e.g. lo, eth0, etc." },
 	{ NULL,	"udp-lite",	"use the UDP-Lite (RFC 3828) protocol" },
 	{ NULL,	"udp-ops N",	"stop after N udp bogo operations" },
 	{ NULL,	"udp-port P",	"use ports P to P + number of workers - 1" },
+	{ NULL,	"udp-rr N",	"request/response ping-pong with N byte datagrams" },
+	{ NULL,	"udp-rr-client-cpu N", "pin the --udp-rr client to CPU N" },
+	{ NULL,	"udp-rr-server-cpu N", "pin the --udp-rr server to CPU N" },
 	{ NULL,	NULL,		NULL }
 };
 
+/*
+ *  stress_udp_gso_segs()
+ *	maximum number of udp_gso sized segments per GSO send
+ */
+static size_t stress_udp_gso_segs(const size_t udp_gso)
+{
+	const size_t segs = UDP_GSO_MAX_PAYLOAD / udp_gso;
+
+	return STRESS_MINIMUM(segs, UDP_GSO_MAX_SEGS);
+}
+
+/*
+ *  stress_udp_gro_size()
+ *	return the GRO segment size of a coalesced datagram of
+ *	len bytes, or len if it was not coalesced
+ */
+static size_t stress_udp_gro_size(struct msghdr *msg, const size_t len)
+{
+#if defined(UDP_GRO)
+	struct cmsghdr *cmsg;
+
+	if (!msg->msg_control)
+		return len;
+	for (cmsg = CMSG_FIRSTHDR(msg); cmsg; cmsg = CMSG_NXTHDR(msg, cmsg)) {
+		if ((cmsg->cmsg_level == SOL_UDP) && (cmsg->cmsg_type == UDP_GRO)) {
+			int gso_size;
+
+			(void)shim_memcpy(&gso_size, CMSG_DATA(cmsg), sizeof(gso_size));
+			if (gso_size > 0)
+				return (size_t)gso_size;
+		}
+	}
+#else
+	(void)msg;
+#endif
+	return len;
+}
+
 static int OPTIMIZE3 stress_udp_client(
 	stress_args_t *args,
 	const pid_t mypid,
@@ -79,20 +156,57 @@ static int OPTIMIZE3 stress_udp_client(
 	const int udp_proto,
 	const int udp_port,
 	const bool udp_gro,
-	const char *udp_if)
+	const size_t udp_batch,
+	const size_t udp_gso,
+	const char *udp_if,
+	stress_udp_stats_t *stats)
 {
 	struct sockaddr *addr = NULL;
 	int rc = EXIT_FAILURE;
 	const pid_t pid = getpid();
+	const size_t buf_size = udp_gso ? udp_gso * stress_udp_gso_segs(udp_gso) : UDP_BUF;
+	size_t i;
+	char *buf;
+#if defined(STRESS_UDP_MMSG)
+	struct mmsghdr *msgvec = NULL;
+	struct iovec iov;
+#endif
 
 	stress_parent_died_alarm();
 	(void)sched_settings_apply(true);
 
+	buf = (char *)mmap(NULL, buf_size, PROT_READ | PROT_WRITE,
+			MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (buf == MAP_FAILED) {
+		pr_inf("%s: cannot allocate %zu byte send buffer, errno=%d (%s)\n",
+			args->name, buf_size, errno, strerror(errno));
+		return EXIT_NO_RESOURCE;
+	}
+	stress_set_vma_anon_name(buf, buf_size, "udp-send-buffer");
+	/*
+	 *  every datagram, and every GSO segment of a datagram,
+	 *  starts with the client pid for the server to verify
+	 */
+	(void)shim_memset(buf, stress_mwc8(), buf_size);
+	for (i = 0; i + sizeof(pid) <= buf_size; i += udp_gso ? udp_gso : buf_size)
+		(void)shim_memcpy(buf + i, &pid, sizeof(pid));
+
+#if defined(STRESS_UDP_MMSG)
+	if (udp_batch > 1) {
+		msgvec = (struct mmsghdr *)calloc(udp_batch, sizeof(*msgvec));
+		if (!msgvec) {
+			pr_inf("%s: cannot allocate %zu sendmmsg messages\n",
+				args->name, udp_batch);
+			rc = EXIT_NO_RESOURCE;
+			goto child_unmap;
+		}
+	}
+#endif
+
 	do {
 		socklen_t len;
 		int fd, j = 0;
-		char ALIGN64 buf[UDP_BUF];
-		pid_t *pidptr = (pid_t *)buf;
+		size_t gso_size = udp_gso, step, end;
 
 		if (UNLIKELY((fd = socket(udp_domain, SOCK_DGRAM, udp_proto)) < 0)) {
 			pr_fail("%s: socket failed, errno=%d (%s)\n",
@@ -209,19 +323,69 @@ static int OPTIMIZE3 stress_udp_client(
 				VOID_RET(int, setsockopt(fd, udp_proto, UDP_SEGMENT, &val, slen));
 			}
 		}
+		if (gso_size > 0) {
+			int val = (int)gso_size;
+
+			if (setsockopt(fd, udp_proto, UDP_SEGMENT, &val, sizeof(val)) < 0) {
+				if (args->instance == 0)
+					pr_inf("%s: cannot set UDP_SEGMENT to %zu bytes, errno=%d (%s), "
+						"disabling UDP-GSO\n", args->name, gso_size,
+						errno, strerror(errno));
+				gso_size = 0;
+			}
+		}
 #else
 		UNEXPECTED
 #endif
-		(void)shim_memset(buf, stress_mwc8(), sizeof(buf));
-		*pidptr = pid;
+		/*
+		 *  without GSO sweep the datagram size from 16 bytes
+		 *  to UDP_BUF, with GSO sweep the number of segments
+		 *  sent in each GSO datagram
+		 */
+		if (gso_size > 0) {
+			step = gso_size;
+			end = buf_size + 1;
+		} else {
+			step = 16;
+			end = UDP_BUF;
+		}
+#if defined(STRESS_UDP_MMSG)
+		if (msgvec) {
+			size_t k;
+
+			for (k = 0; k < udp_batch; k++) {
+				msgvec[k].msg_hdr.msg_name = addr;
+				msgvec[k].msg_hdr.msg_namelen = len;
+				msgvec[k].msg_hdr.msg_iov = &iov;
+				msgvec[k].msg_hdr.msg_iovlen = 1;
+			}
+			iov.iov_base = buf;
+		}
+#endif
 
 		do {
-			register size_t i;
-
-			for (i = 16; i < sizeof(buf); i += 16, j++) {
+			for (i = step; i < end; i += step, j++) {
+				const uint64_t segs = gso_size ? (uint64_t)(i / gso_size) : 1;
 				ssize_t ret;
 
-				ret = sendto(fd, buf, i, 0, addr, len);
+#if defined(STRESS_UDP_MMSG)
+				if (msgvec) {
+					iov.iov_len = i;
+					ret = sendmmsg(fd, msgvec, (unsigned int)udp_batch, 0);
+					if (LIKELY(ret > 0)) {
+						stats->packets += segs * (uint64_t)ret;
+						stats->bytes += (uint64_t)i * (uint64_t)ret;
+					}
+				} else
+#endif
+				{
+					ret = sendto(fd, buf, i, 0, addr, len);
+					if (LIKELY(ret > 0)) {
+						stats->packets += segs;
+						stats->bytes += (uint64_t)ret;
+					}
+				}
+				stats->syscalls++;
 				if (UNLIKELY(ret < 0)) {
 					if ((errno == EINTR) || (errno == ENETUNREACH))
 						break;
@@ -255,6 +419,11 @@ static int OPTIMIZE3 stress_udp_client(
 
 	rc = EXIT_SUCCESS;
 child_die:
+#if defined(STRESS_UDP_MMSG)
+	free(msgvec);
+child_unmap:
+#endif
+	(void)munmap((void *)buf, buf_size);
 #if defined(AF_UNIX) &&		\
     defined(HAVE_SOCKADDR_UN)
 	if ((udp_domain == AF_UNIX) && addr) {
@@ -266,6 +435,40 @@ child_die:
 	return rc;
 }
 
+/*
+ *  stress_udp_verify()
+ *	check each datagram, or each segment of a GRO coalesced
+ *	datagram, starts with the client pid, returns the number
+ *	of datagrams verified or 0 on a mismatch
+ */
+static uint64_t OPTIMIZE3 stress_udp_verify(
+	stress_args_t *args,
+	const char *buf,
+	const size_t len,
+	const size_t seg_size,
+	const pid_t client_pid)
+{
+	size_t off;
+	uint64_t segs = 0;
+
+	for (off = 0; off < len; off += seg_size, segs++) {
+		pid_t pid;
+
+		if (UNLIKELY(len - off < sizeof(pid)))
+			break;
+		(void)shim_memcpy(&pid, buf + off, sizeof(pid));
+		if (UNLIKELY(pid != client_pid)) {
+			pr_fail("%s: server received unexpected data "
+				"contents, got 0x%" PRIxMAX ", "
+				"expected 0x%" PRIxMAX "\n",
+				args->name, (intmax_t)pid,
+				(intmax_t)client_pid);
+			return 0;
+		}
+	}
+	return segs;
+}
+
 static int OPTIMIZE3 stress_udp_server(
 	stress_args_t *args,
 	const pid_t mypid,
@@ -274,10 +477,21 @@ static int OPTIMIZE3 stress_udp_server(
 	const int udp_proto,
 	const int udp_port,
 	const bool udp_gro,
-	const char *udp_if)
+	const size_t udp_batch,
+	const size_t udp_gso,
+	const char *udp_if,
+	stress_udp_stats_t *stats)
 {
-	char ALIGN64 buf[UDP_BUF];
+	const size_t buf_size = udp_gro ? UDP_GRO_BUF : STRESS_MAXIMUM(UDP_BUF, udp_gso);
+	char *bufs;
 	int fd;
+#if defined(STRESS_UDP_MMSG)
+	struct mmsghdr *msgvec = NULL;
+	struct iovec *iovs = NULL;
+	char *ctrls = NULL;
+	const size_t ctrl_size = CMSG_SPACE(sizeof(int));
+	size_t i;
+#endif
 #if !defined(__minix__)
 	int so_reuseaddr = 1;
 #endif
@@ -285,6 +499,39 @@ static int OPTIMIZE3 stress_udp_server(
 	struct sockaddr *addr = NULL;
 	int rc = EXIT_FAILURE;
 
+	bufs = (char *)mmap(NULL, buf_size * udp_batch, PROT_READ | PROT_WRITE,
+			MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (bufs == MAP_FAILED) {
+		pr_inf("%s: cannot allocate %zu byte receive buffers, errno=%d (%s)\n",
+			args->name, buf_size * udp_batch, errno, strerror(errno));
+		return EXIT_NO_RESOURCE;
+	}
+	stress_set_vma_anon_name(bufs, buf_size * udp_batch, "udp-recv-buffers");
+
+#if defined(STRESS_UDP_MMSG)
+	/*
+	 *  batched and GRO receives use msghdrs, GRO needs
+	 *  the control message to find the segment size
+	 */
+	if ((udp_batch > 1) || udp_gro) {
+		msgvec = (struct mmsghdr *)calloc(udp_batch, sizeof(*msgvec));
+		iovs = (struct iovec *)calloc(udp_batch, sizeof(*iovs));
+		ctrls = (char *)calloc(udp_batch, ctrl_size);
+		if (!msgvec || !iovs || !ctrls) {
+			pr_inf("%s: cannot allocate %zu receive messages\n",
+				args->name, udp_batch);
+			rc = EXIT_NO_RESOURCE;
+			goto die;
+		}
+		for (i = 0; i < udp_batch; i++) {
+			iovs[i].iov_base = bufs + (i * buf_size);
+			iovs[i].iov_len = buf_size;
+			msgvec[i].msg_hdr.msg_iov = &iovs[i];
+			msgvec[i].msg_hdr.msg_iovlen = 1;
+		}
+	}
+#endif
+
 	if (stress_sig_stop_stressing(args->name, SIGALRM) < 0)
 		goto die;
 	if ((fd = socket(udp_domain, SOCK_DGRAM, udp_proto)) < 0) {
@@ -349,7 +596,31 @@ static int OPTIMIZE3 stress_udp_server(
 #else
 		UNEXPECTED
 #endif
-		n = recvfrom(fd, buf, sizeof(buf), 0, addr, &len);
+#if defined(STRESS_UDP_MMSG)
+		if (msgvec) {
+			for (i = 0; i < udp_batch; i++) {
+				msgvec[i].msg_hdr.msg_name = addr;
+				msgvec[i].msg_hdr.msg_namelen = addr_len;
+				if (udp_gro) {
+					msgvec[i].msg_hdr.msg_control = ctrls + (i * ctrl_size);
+					msgvec[i].msg_hdr.msg_controllen = ctrl_size;
+				}
+			}
+			if (udp_batch > 1) {
+				n = recvmmsg(fd, msgvec, (unsigned int)udp_batch, MSG_WAITFORONE, NULL);
+			} else {
+				n = recvmsg(fd, &msgvec[0].msg_hdr, 0);
+				if (n > 0) {
+					msgvec[0].msg_len = (unsigned int)n;
+					n = 1;
+				}
+			}
+		} else
+#endif
+		{
+			n = recvfrom(fd, bufs, buf_size, 0, addr, &len);
+		}
+		stats->syscalls++;
 		if (UNLIKELY(n <= 0)) {
 			if (n == 0)
 				break;
@@ -358,25 +629,38 @@ static int OPTIMIZE3 stress_udp_server(
 				continue;
 			}
 			if (errno != EINTR) {
-				pr_fail("%s: recvfrom failed, errno=%d (%s)\n",
+				pr_fail("%s: receive failed, errno=%d (%s)\n",
 					args->name, errno, strerror(errno));
 				rc = EXIT_FAILURE;
 				goto die_close;
 			}
 			break;
-		} else {
-			const pid_t *pidptr = (const pid_t *)buf;
-			const pid_t pid = *pidptr;
-
-			if (UNLIKELY(pid != client_pid)) {
-				pr_fail("%s: server received unexpected data "
-					"contents, got 0x%" PRIxMAX ", "
-					"expected 0x%" PRIxMAX "\n",
-					args->name, (intmax_t)pid,
-					(intmax_t)client_pid);
+		}
+#if defined(STRESS_UDP_MMSG)
+		if (msgvec) {
+			for (i = 0; i < (size_t)n; i++) {
+				const size_t mlen = (size_t)msgvec[i].msg_len;
+				const size_t seg_size = stress_udp_gro_size(&msgvec[i].msg_hdr, mlen);
+				const uint64_t segs = stress_udp_verify(args, bufs + (i * buf_size),
+								mlen, seg_size, client_pid);
+
+				if (UNLIKELY(segs == 0)) {
+					rc = EXIT_FAILURE;
+					goto die_close;
+				}
+				stats->packets += segs;
+				stats->bytes += (uint64_t)mlen;
+				stress_bogo_add(args, segs);
+			}
+		} else
+#endif
+		{
+			if (UNLIKELY(stress_udp_verify(args, bufs, (size_t)n, (size_t)n, client_pid) == 0)) {
 				rc = EXIT_FAILURE;
 				goto die_close;
 			}
+			stats->packets++;
+			stats->bytes += (uint64_t)n;
 			stress_bogo_inc(args);
 		}
 	} while (stress_continue(args));
@@ -395,6 +679,12 @@ die:
 		(void)shim_unlink(addr_un->sun_path);
 	}
 #endif
+#if defined(STRESS_UDP_MMSG)
+	free(ctrls);
+	free(iovs);
+	free(msgvec);
+#endif
+	(void)munmap((void *)bufs, buf_size * udp_batch);
 	return rc;
 }
 
@@ -402,6 +692,241 @@ die:
  *  stress_udp
  *	stress by heavy udp ops
  */
+#if defined(HAVE_POLL_H)
+/*
+ *  stress_udp_rr_cpu()
+ *	fetch a --udp-rr CPU pinning setting, -1 if not
+ *	set or not a configured CPU
+ */
+static int32_t stress_udp_rr_cpu(stress_args_t *args, const char *opt)
+{
+	int32_t cpu = -1;
+	const int32_t cpus = stress_get_processors_configured();
+
+	if (!stress_get_setting(opt, &cpu))
+		return -1;
+	if ((cpus > 0) && (cpu >= cpus)) {
+		if (args->instance == 0)
+			pr_inf("%s: --%s %" PRId32 " is not a configured CPU, not pinning\n",
+				args->name, opt, cpu);
+		return -1;
+	}
+	return cpu;
+}
+
+/*
+ *  stress_udp_rr_server()
+ *	echo each request datagram back to its sender
+ */
+static void NORETURN stress_udp_rr_server(
+	const int fd,
+	char *buf,
+	const size_t size,
+	const int32_t cpu)
+{
+	struct timeval tv;
+
+	stress_parent_died_alarm();
+	(void)sched_settings_apply(true);
+	stress_placement_set(cpu);
+
+	/* wake up periodically to check if the stressor has finished */
+	tv.tv_sec = 0;
+	tv.tv_usec = 100000;
+	(void)setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+
+	while (stress_continue_flag()) {
+		struct sockaddr_storage from;
+		socklen_t from_len = sizeof(from);
+		const ssize_t n = recvfrom(fd, buf, size, 0,
+			(struct sockaddr *)&from, &from_len);
+
+		if (n <= 0)
+			continue;
+		(void)sendto(fd, buf, (size_t)n, 0, (struct sockaddr *)&from, from_len);
+	}
+	_exit(EXIT_SUCCESS);
+}
+
+/*
+ *  stress_udp_rr()
+ *	--udp-rr mode, a UDP_RR style ping-pong of one size byte
+ *	request and response datagram at a time. Each request carries
+ *	a sequence number so late responses to a request that timed
+ *	out and was resent are discarded, the round-trip latencies
+ *	are recorded into a histogram
+ */
+static int stress_udp_rr(
+	stress_args_t *args,
+	const pid_t mypid,
+	const int udp_domain,
+	const int udp_proto,
+	const int udp_port,
+	const char *udp_if,
+	const size_t size)
+{
+	const int32_t client_cpu = stress_udp_rr_cpu(args, "udp-rr-client-cpu");
+	const int32_t server_cpu = stress_udp_rr_cpu(args, "udp-rr-server-cpu");
+	const size_t seq_size = STRESS_MINIMUM(size, sizeof(uint64_t));
+	const size_t buf_size = MAX_UDP_RR * 2;
+	struct sockaddr *addr = NULL;
+	socklen_t addr_len = 0;
+	stress_latency_hist_t *hist;
+	int server_fd, fd = -1, rc = EXIT_SUCCESS;
+	uint64_t transactions = 0, timeouts = 0, seq = 0;
+	double t_start, duration, rate;
+	char *buf, *rx_buf;
+	pid_t pid;
+
+	buf = (char *)stress_mmap_populate(NULL, buf_size,
+		PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (buf == MAP_FAILED) {
+		pr_inf_skip("%s: cannot mmap %zu byte buffer, skipping stressor\n",
+			args->name, buf_size);
+		return EXIT_NO_RESOURCE;
+	}
+	stress_set_vma_anon_name(buf, buf_size, "udp-rr-buffer");
+	rx_buf = buf + MAX_UDP_RR;
+	hist = (stress_latency_hist_t *)malloc(sizeof(*hist));
+	if (!hist) {
+		pr_inf_skip("%s: cannot allocate latency histogram, skipping stressor\n", args->name);
+		(void)munmap((void *)buf, buf_size);
+		return EXIT_NO_RESOURCE;
+	}
+	stress_latency_hist_init(hist);
+
+	if (stress_set_sockaddr_if(args->name, args->instance, mypid,
+			udp_domain, udp_port, udp_if,
+			&addr, &addr_len, NET_ADDR_ANY) < 0) {
+		rc = EXIT_FAILURE;
+		goto free_buf;
+	}
+	/* bind before forking so no request is sent before the server exists */
+	server_fd = socket(udp_domain, SOCK_DGRAM, udp_proto);
+	if (server_fd < 0) {
+		rc = stress_exit_status(errno);
+		pr_fail("%s: socket failed, errno=%d (%s)\n",
+			args->name, errno, strerror(errno));
+		goto free_buf;
+	}
+	if (bind(server_fd, addr, addr_len) < 0) {
+		rc = stress_exit_status(errno);
+		pr_fail("%s: bind failed, errno=%d (%s)\n",
+			args->name, errno, strerror(errno));
+		(void)close(server_fd);
+		goto free_buf;
+	}
+
+again:
+	pid = fork();
+	if (pid < 0) {
+		if (stress_redo_fork(args, errno))
+			goto again;
+		rc = stress_exit_status(errno);
+		pr_fail("%s: fork failed, errno=%d (%s)\n",
+			args->name, errno, strerror(errno));
+		(void)close(server_fd);
+		goto free_buf;
+	} else if (pid == 0) {
+		stress_udp_rr_server(server_fd, rx_buf, size, server_cpu);
+	}
+	(void)close(server_fd);
+	stress_placement_set(client_cpu);
+
+	fd = socket(udp_domain, SOCK_DGRAM, udp_proto);
+	if (fd < 0) {
+		rc = stress_exit_status(errno);
+		pr_fail("%s: socket failed, errno=%d (%s)\n",
+			args->name, errno, strerror(errno));
+		goto reap;
+	}
+	if (connect(fd, addr, addr_len) < 0) {
+		rc = stress_exit_status(errno);
+		pr_fail("%s: connect failed, errno=%d (%s)\n",
+			args->name, errno, strerror(errno));
+		goto reap;
+	}
+
+	(void)shim_memset(buf, 'A' + (args->instance % 26), size);
+	t_start = stress_time_now();
+	while (stress_continue(args)) {
+		struct pollfd pfd;
+		uint64_t t;
+		bool done = false;
+
+		seq++;
+		(void)shim_memcpy(buf, &seq, seq_size);
+		t = stress_latency_now();
+		if (UNLIKELY(send(fd, buf, size, 0) < 0)) {
+			if ((errno == EINTR) || (errno == ENOBUFS) ||
+			    (errno == ECONNREFUSED) || (errno == EAGAIN))
+				continue;
+			rc = EXIT_FAILURE;
+			pr_fail("%s: send failed, errno=%d (%s)\n",
+				args->name, errno, strerror(errno));
+			break;
+		}
+		while (!done && stress_continue_flag()) {
+			ssize_t n;
+
+			pfd.fd = fd;
+			pfd.events = POLLIN;
+			pfd.revents = 0;
+			if (poll(&pfd, 1, UDP_RR_TIMEOUT_MS) <= 0) {
+				/* request or response lost, resend a new one */
+				if (stress_continue_flag())
+					timeouts++;
+				break;
+			}
+			n = recv(fd, rx_buf, size, MSG_DONTWAIT);
+			if (n < (ssize_t)seq_size)
+				continue;
+			/* discard stale responses to earlier timed out requests */
+			if (shim_memcmp(rx_buf, buf, seq_size))
+				continue;
+			done = true;
+		}
+		if (!done)
+			continue;
+		t = stress_latency_now() - t;
+		stress_latency_hist_record(hist, t);
+		stress_latency_record(args, 0, t);
+		transactions++;
+		stress_bogo_inc(args);
+	}
+	duration = stress_time_now() - t_start;
+
+	rate = (duration > 0.0) ? (double)transactions / duration : 0.0;
+	stress_metrics_set(args, 0, "transactions per sec",
+		rate, STRESS_METRIC_HARMONIC_MEAN);
+	stress_metrics_set(args, 1, "round-trip mean latency (usec)",
+		stress_latency_hist_mean(hist) / 1000.0, STRESS_METRIC_GEOMETRIC_MEAN);
+	stress_metrics_set(args, 2, "round-trip p50 latency (usec)",
+		(double)stress_latency_hist_percentile(hist, 50.0) / 1000.0,
+		STRESS_METRIC_GEOMETRIC_MEAN);
+	stress_metrics_set(args, 3, "round-trip p90 latency (usec)",
+		(double)stress_latency_hist_percentile(hist, 90.0) / 1000.0,
+		STRESS_METRIC_GEOMETRIC_MEAN);
+	stress_metrics_set(args, 4, "round-trip p99 latency (usec)",
+		(double)stress_latency_hist_percentile(hist, 99.0) / 1000.0,
+		STRESS_METRIC_GEOMETRIC_MEAN);
+	stress_metrics_set(args, 5, "round-trip p99.9 latency (usec)",
+		(double)stress_latency_hist_percentile(hist, 99.9) / 1000.0,
+		STRESS_METRIC_GEOMETRIC_MEAN);
+	stress_metrics_set(args, 6, "request timeouts",
+		(double)timeouts, STRESS_METRIC_TOTAL);
+reap:
+	if (fd >= 0)
+		(void)close(fd);
+	(void)stress_kill_pid_wait(pid, NULL);
+free_buf:
+	free(hist);
+	(void)munmap((void *)buf, buf_size);
+
+	return rc;
+}
+#endif
+
 static int stress_udp(stress_args_t *args)
 {
 	int udp_port = DEFAULT_UDP_PORT;
@@ -414,12 +939,20 @@ static int stress_udp(stress_args_t *args)
 #endif
 	bool udp_gro = false;
 	char *udp_if = NULL;
+	size_t udp_batch = DEFAULT_UDP_BATCH;
+	size_t udp_gso = 0;
+	size_t udp_rr = 0;
+	stress_udp_stats_t rx_stats, *tx_stats;
+	double t, duration, rate;
 
 	if (stress_sigchld_set_handler(args) < 0)
 		return EXIT_NO_RESOURCE;
 
+	(void)stress_get_setting("udp-batch", &udp_batch);
+	(void)stress_get_setting("udp-gso", &udp_gso);
 	(void)stress_get_setting("udp-if", &udp_if);
 	(void)stress_get_setting("udp-port", &udp_port);
+	(void)stress_get_setting("udp-rr", &udp_rr);
 	(void)stress_get_setting("udp-domain", &udp_domain);
 #if defined(IPPROTO_UDPLITE)
 	(void)stress_get_setting("udp-lite", &udp_lite);
@@ -451,6 +984,30 @@ static int stress_udp(stress_args_t *args)
 
 #if defined(UDP_GRO)
 	(void)stress_get_setting("udp-gro", &udp_gro);
+#endif
+#if !defined(STRESS_UDP_MMSG)
+	if (udp_batch > 1) {
+		if (args->instance == 0)
+			pr_inf("%s: sendmmsg or recvmmsg not available, "
+				"disabling --udp-batch\n", args->name);
+		udp_batch = 1;
+	}
+#endif
+#if !defined(UDP_SEGMENT)
+	if (udp_gso > 0) {
+		if (args->instance == 0)
+			pr_inf("%s: UDP_SEGMENT not available, disabling --udp-gso\n",
+				args->name);
+		udp_gso = 0;
+	}
+#endif
+#if defined(IPPROTO_UDPLITE)
+	if ((udp_gso > 0) && (udp_proto == IPPROTO_UDPLITE)) {
+		if (args->instance == 0)
+			pr_inf("%s: UDP-GSO is not supported by UDP-Lite, disabling --udp-gso\n",
+				args->name);
+		udp_gso = 0;
+	}
 #endif
 	if (udp_if) {
 		int ret;
@@ -464,9 +1021,38 @@ static int stress_udp(stress_args_t *args)
 		}
 	}
 
+	if (udp_rr) {
+#if defined(HAVE_POLL_H)
+		stress_latency_set_description(args, 0, "udp round-trip");
+		stress_set_proc_state(args->name, STRESS_STATE_SYNC_WAIT);
+		stress_sync_start_wait(args);
+		stress_set_proc_state(args->name, STRESS_STATE_RUN);
+		rc = stress_udp_rr(args, mypid, udp_domain, udp_proto, udp_port,
+			udp_if, udp_rr);
+		stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
+		stress_net_release_ports(udp_port, udp_port);
+		return rc;
+#else
+		if (args->instance == 0)
+			pr_inf("%s: poll is not available, disabling --udp-rr\n", args->name);
+#endif
+	}
+
+	/* client send statistics are shared with the server process */
+	tx_stats = (stress_udp_stats_t *)stress_mmap_populate(NULL, sizeof(*tx_stats),
+		PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+	if (tx_stats == MAP_FAILED) {
+		pr_inf("%s: could not allocate shared memory, errno=%d (%s)\n",
+			args->name, errno, strerror(errno));
+		return EXIT_NO_RESOURCE;
+	}
+	stress_set_vma_anon_name(tx_stats, sizeof(*tx_stats), "udp-stats");
+	(void)shim_memset(&rx_stats, 0, sizeof(rx_stats));
+
 	stress_set_proc_state(args->name, STRESS_STATE_SYNC_WAIT);
 	stress_sync_start_wait(args);
 	stress_set_proc_state(args->name, STRESS_STATE_RUN);
+	t = stress_time_now();
 again:
 	parent_cpu = stress_get_cpu();
 	pid = fork();
@@ -475,30 +1061,60 @@ again:
 			goto again;
 		pr_fail("%s: fork failed, errno=%d (%s)\n",
 			args->name, errno, strerror(errno));
+		(void)munmap((void *)tx_stats, sizeof(*tx_stats));
 		return EXIT_FAILURE;
 	} else if (pid == 0) {
 		(void)stress_change_cpu(args, parent_cpu);
-		rc = stress_udp_client(args, mypid, udp_domain, udp_proto, udp_port, udp_gro, udp_if);
+		rc = stress_udp_client(args, mypid, udp_domain, udp_proto, udp_port,
+			udp_gro, udp_batch, udp_gso, udp_if, tx_stats);
 		_exit(rc);
 	} else {
 		int status;
 
-		rc = stress_udp_server(args, mypid, pid, udp_domain, udp_proto, udp_port, udp_gro, udp_if);
+		rc = stress_udp_server(args, mypid, pid, udp_domain, udp_proto, udp_port,
+			udp_gro, udp_batch, udp_gso, udp_if, &rx_stats);
 		(void)stress_kill_pid_wait(pid, &status);
 		if (WIFEXITED(status))
 			if (WEXITSTATUS(status) != EXIT_SUCCESS)
 				rc = WEXITSTATUS(status);
 	}
+	duration = stress_time_now() - t;
+
+	rate = (duration > 0.0) ? (double)rx_stats.packets / duration : 0.0;
+	stress_metrics_set(args, 0, "packets received per sec",
+		rate, STRESS_METRIC_HARMONIC_MEAN);
+	rate = (duration > 0.0) ? (double)rx_stats.bytes / duration / (double)MB : 0.0;
+	stress_metrics_set(args, 1, "MB received per sec",
+		rate, STRESS_METRIC_HARMONIC_MEAN);
+	rate = (rx_stats.packets > 0) ? (double)rx_stats.syscalls / (double)rx_stats.packets : 0.0;
+	stress_metrics_set(args, 2, "receive syscalls per packet",
+		rate, STRESS_METRIC_HARMONIC_MEAN);
+	rate = (duration > 0.0) ? (double)tx_stats->packets / duration : 0.0;
+	stress_metrics_set(args, 3, "packets sent per sec",
+		rate, STRESS_METRIC_HARMONIC_MEAN);
+	rate = (duration > 0.0) ? (double)tx_stats->bytes / duration / (double)MB : 0.0;
+	stress_metrics_set(args, 4, "MB sent per sec",
+		rate, STRESS_METRIC_HARMONIC_MEAN);
+	rate = (tx_stats->packets > 0) ? (double)tx_stats->syscalls / (double)tx_stats->packets : 0.0;
+	stress_metrics_set(args, 5, "send syscalls per packet",
+		rate, STRESS_METRIC_HARMONIC_MEAN);
+
+	(void)munmap((void *)tx_stats, sizeof(*tx_stats));
 	return rc;
 }
 
 static int udp_domain_mask = DOMAIN_INET | DOMAIN_INET6;
 
 static const stress_opt_t opts[] = {
+	{ OPT_udp_batch,  "udp-batch",  TYPE_ID_SIZE_T, MIN_UDP_BATCH, MAX_UDP_BATCH, NULL },
 	{ OPT_udp_domain, "udp-domain", TYPE_ID_INT_DOMAIN, 0, 0, &udp_domain_mask },
 	{ OPT_udp_port,   "udp-port",   TYPE_ID_INT_PORT, MIN_PORT, MAX_PORT, NULL },
+	{ OPT_udp_rr,     "udp-rr",     TYPE_ID_SIZE_T_BYTES_VM, MIN_UDP_RR, MAX_UDP_RR, NULL },
+	{ OPT_udp_rr_client_cpu, "udp-rr-client-cpu", TYPE_ID_INT32, 0, INT32_MAX, NULL },
+	{ OPT_udp_rr_server_cpu, "udp-rr-server-cpu", TYPE_ID_INT32, 0, INT32_MAX, NULL },
 	{ OPT_udp_lite,   "udp-lite",   TYPE_ID_BOOL, 0, 1, NULL },
-	{ OPT_udp_gro,    "upd-gro",    TYPE_ID_BOOL, 0, 1, NULL },
+	{ OPT_udp_gro,    "udp-gro",    TYPE_ID_BOOL, 0, 1, NULL },
+	{ OPT_udp_gso,    "udp-gso",    TYPE_ID_SIZE_T_BYTES_VM, MIN_UDP_GSO, MAX_UDP_GSO, NULL },
 	{ OPT_udp_if,     "udp-if",     TYPE_ID_STR, 0, 0, NULL },
 	END_OPT,
 };
@@ -508,5 +1124,6 @@ const stressor_info_t stress_udp_info = {
 	.class = CLASS_NETWORK | CLASS_OS,
 	.opts = opts,
 	.verify = VERIFY_ALWAYS,
+	.metrics_max = 7,
 	.help = help
 };
@@ -296,5 +296,6 @@ const stressor_info_t stress_unlink_info = {
 	.stressor = stress_unlink,
 	.class = CLASS_FILESYSTEM | CLASS_OS,
 	.verify = VERIFY_NONE,
+	.metrics_max = 1,
 	.help = help
 };
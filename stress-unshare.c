@@ -309,6 +309,7 @@ const stressor_info_t stress_unshare_info = {
 	.stressor = stress_unshare,
 	.class = CLASS_OS,
 	.verify = VERIFY_ALWAYS,
+	.metrics_max = 1,
 	.help = help
 };
 #else
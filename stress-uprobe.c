@@ -290,6 +290,7 @@ const stressor_info_t stress_uprobe_info = {
 	.stressor = stress_uprobe,
 	.class = CLASS_CPU,
 	.supported = stress_uprobe_supported,
+	.metrics_max = 1,
 	.help = help
 };
 #else
@@ -348,5 +348,6 @@ const stressor_info_t stress_urandom_info = {
 	.stressor = stress_urandom,
 	.class = CLASS_DEV | CLASS_OS,
 	.verify = VERIFY_OPTIONAL,
+	.metrics_max = 2,
 	.help = help
 };
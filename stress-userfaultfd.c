@@ -20,7 +20,9 @@
 #include "stress-ng.h"
 #include "core-builtin.h"
 #include "core-killpid.h"
+#include "core-lock.h"
 #include "core-out-of-memory.h"
+#include "core-pthread.h"
 
 #include <sched.h>
 #include <sys/ioctl.h>
@@ -43,10 +45,25 @@ UNEXPECTED
 #define MAX_USERFAULT_BYTES	(MAX_MEM_LIMIT)
 #define DEFAULT_USERFAULT_BYTES	(256 * MB)
 
+#define MIN_USERFAULT_THREADS	(1)
+#define MAX_USERFAULT_THREADS	(64)
+#define DEFAULT_USERFAULT_THREADS (1)
+
+#define MIN_USERFAULT_BATCH	(1)
+#define MAX_USERFAULT_BATCH	(512)
+#define DEFAULT_USERFAULT_BATCH	(1)
+
+#define USERFAULT_MODE_MISSING	(0)
+#define USERFAULT_MODE_MINOR	(1)
+#define USERFAULT_MODE_WP	(2)
+
 static const stress_help_t help[] = {
 	{ NULL,	"userfaultfd N",	"start N page faulting workers with userspace handling" },
-	{ NULL, "userfualtfd-bytes N",	"size of mmap'd region to fault on" },
+	{ NULL,	"userfaultfd-batch N",	"resolve N pages per fault with each UFFDIO ioctl" },
+	{ NULL, "userfaultfd-bytes N",	"size of mmap'd region to fault on" },
+	{ NULL,	"userfaultfd-mode M",	"fault mode, M = missing, minor or wp" },
 	{ NULL,	"userfaultfd-ops N",	"stop after N page faults have been handled" },
+	{ NULL,	"userfaultfd-threads N","number of fault handling threads and faulters" },
 	{ NULL,	NULL,			NULL }
 };
 
@@ -62,16 +79,33 @@ static const stress_help_t help[] = {
 /* Context for clone */
 typedef struct {
 	stress_args_t *args;
-	uint8_t *data;
+	uint8_t *data;		/* start of this faulter's stripe */
 	size_t page_size;
-	size_t sz;
+	size_t sz;		/* size of this faulter's stripe */
+	int fd;			/* userfaultfd, for re-arming write protection */
+	int mode;		/* USERFAULT_MODE_* */
 	pid_t parent;
+	pid_t pid;		/* faulter pid */
+	uint8_t *stack;		/* faulter clone stack */
+	double touch_duration;	/* total time spent touching pages */
+	double touch_max;	/* longest single page touch */
+	uint64_t touches;	/* number of pages touched */
 } stress_context_t;
 
 #endif
 
+static const char *stress_userfaultfd_modes(const size_t i)
+{
+	static const char * const modes[] = { "missing", "minor", "wp" };
+
+	return (i < SIZEOF_ARRAY(modes)) ? modes[i] : NULL;
+}
+
 static const stress_opt_t opts[] = {
-	{ OPT_userfaultfd_bytes, "userfaultfd-bytes", TYPE_ID_SIZE_T_BYTES_VM, MIN_USERFAULT_BYTES, MAX_USERFAULT_BYTES, NULL },
+	{ OPT_userfaultfd_batch,   "userfaultfd-batch",   TYPE_ID_SIZE_T, MIN_USERFAULT_BATCH, MAX_USERFAULT_BATCH, NULL },
+	{ OPT_userfaultfd_bytes,   "userfaultfd-bytes",   TYPE_ID_SIZE_T_BYTES_VM, MIN_USERFAULT_BYTES, MAX_USERFAULT_BYTES, NULL },
+	{ OPT_userfaultfd_mode,    "userfaultfd-mode",    TYPE_ID_SIZE_T_METHOD, 0, 0, stress_userfaultfd_modes },
+	{ OPT_userfaultfd_threads, "userfaultfd-threads", TYPE_ID_UINT32, MIN_USERFAULT_THREADS, MAX_USERFAULT_THREADS, NULL },
 	END_OPT,
 };
 
@@ -87,6 +121,47 @@ static const stress_opt_t opts[] = {
 #define STRESS_USERFAULT_SUPPORTED_CHECK_ALWAYS	(STRESS_USERFAULT_REPORT_ALWAYS |	\
 						 STRESS_USERFAULT_SUPPORTED_CHECK)
 
+#if defined(UFFDIO_CONTINUE) &&			\
+    defined(_UFFDIO_CONTINUE) &&		\
+    defined(UFFDIO_REGISTER_MODE_MINOR) &&	\
+    defined(UFFD_FEATURE_MINOR_SHMEM) &&	\
+    defined(UFFD_PAGEFAULT_FLAG_MINOR)
+#define STRESS_USERFAULT_MINOR
+#endif
+
+#if defined(UFFDIO_WRITEPROTECT) &&		\
+    defined(_UFFDIO_WRITEPROTECT) &&		\
+    defined(UFFDIO_WRITEPROTECT_MODE_WP) &&	\
+    defined(UFFDIO_REGISTER_MODE_WP) &&		\
+    defined(UFFD_FEATURE_PAGEFAULT_FLAG_WP) &&	\
+    defined(UFFD_PAGEFAULT_FLAG_WP)
+#define STRESS_USERFAULT_WP
+#endif
+
+/* Fault handler state, one per handler thread */
+typedef struct {
+	stress_args_t *args;
+	int fd;			/* shared userfaultfd */
+	int mode;		/* USERFAULT_MODE_* */
+	bool do_poll;		/* fd is non-blocking, poll before read */
+	uint8_t *data;		/* start of registered region */
+	size_t sz;		/* size of registered region */
+	size_t page_size;
+	size_t batch_sz;	/* bytes resolved per fault */
+	void *src;		/* UFFDIO_COPY source pages */
+	void *lock;		/* bogo counter lock */
+	pid_t self;
+	uint64_t faults;	/* faults handled */
+	uint64_t bytes;		/* bytes resolved */
+	double duration;	/* wait + resolve time */
+	double resolve_duration;/* time in resolving ioctls */
+	int rc;
+#if defined(HAVE_LIB_PTHREAD)
+	pthread_t pthread;
+	int ret;		/* pthread_create return */
+#endif
+} stress_userfaultfd_handler_t;
+
 /*
  *  stress_userfaultfd_error()
  *	convert errno into stress-ng return error code and report
@@ -153,6 +228,28 @@ static void MLOCKED_TEXT NORETURN stress_child_alarm_handler(int signum)
 	_exit(0);
 }
 
+#if defined(STRESS_USERFAULT_WP)
+/*
+ *  stress_userfaultfd_wp()
+ *	set or clear write protection on a range, clearing it
+ *	also wakes any thread blocked on a fault in the range
+ */
+static int stress_userfaultfd_wp(
+	const int fd,
+	uint8_t *addr,
+	const size_t len,
+	const bool wp)
+{
+	struct uffdio_writeprotect wprotect;
+
+	wprotect.range.start = (unsigned long int)addr;
+	wprotect.range.len = len;
+	wprotect.mode = wp ? UFFDIO_WRITEPROTECT_MODE_WP : 0;
+
+	return ioctl(fd, UFFDIO_WRITEPROTECT, &wprotect);
+}
+#endif
+
 /*
  *  stress_userfaultfd_clone()
  *	generate page faults for parent to handle
@@ -172,67 +269,348 @@ static int stress_userfaultfd_clone(void *arg)
 		register uint8_t *ptr;
 		register const uint8_t *end = c->data + c->sz;
 
-		/* hint we don't need these pages */
-		if (UNLIKELY(shim_madvise(c->data, c->sz, MADV_DONTNEED) < 0)) {
-			pr_fail("%s: madvise failed, errno=%d (%s)\n",
-				args->name, errno, strerror(errno));
-			return -1;
+#if defined(STRESS_USERFAULT_WP)
+		if (c->mode == USERFAULT_MODE_WP) {
+			/* re-arm write protection on our stripe */
+			if (UNLIKELY(stress_userfaultfd_wp(c->fd, c->data, c->sz, true) < 0)) {
+				pr_fail("%s: ioctl UFFDIO_WRITEPROTECT failed, errno=%d (%s)\n",
+					args->name, errno, strerror(errno));
+				return -1;
+			}
+		} else
+#endif
+		{
+			/*
+			 *  hint we don't need these pages, for shmem backed
+			 *  minor faults this only zaps the page table entries
+			 */
+			if (UNLIKELY(shim_madvise(c->data, c->sz, MADV_DONTNEED) < 0)) {
+				pr_fail("%s: madvise failed, errno=%d (%s)\n",
+					args->name, errno, strerror(errno));
+				return -1;
+			}
 		}
 		/* and trigger some page faults */
-		for (ptr = c->data; ptr < end; ptr += c->page_size)
+		for (ptr = c->data; ptr < end; ptr += c->page_size) {
+			double t, delta;
+
+			t = stress_time_now();
 			*ptr = 0xff;
+			delta = stress_time_now() - t;
+			c->touch_duration += delta;
+			if (delta > c->touch_max)
+				c->touch_max = delta;
+			c->touches++;
+		}
 	} while (stress_continue(args));
 
 	return 0;
 }
 
 /*
- *  handle_page_fault()
- *	handle a write page fault caused by child
+ *  stress_userfaultfd_wake()
+ *	wake the thread faulting on addr
  */
-static inline int handle_page_fault(
-	stress_args_t *args,
-	const int fd,
-	uint8_t *addr,
-	void *zero_page,
-	const uint8_t *data_start,
-	const uint8_t *data_end,
-	const size_t page_size)
+static inline void stress_userfaultfd_wake(
+	stress_userfaultfd_handler_t *h,
+	const uint8_t *addr)
 {
-	if (UNLIKELY((addr < data_start) || (addr >= data_end))) {
-		pr_fail("%s: page fault address is out of range\n", args->name);
-		return -1;
-	}
+	struct uffdio_range wake;
+
+	wake.start = (unsigned long int)addr;
+	wake.len = h->page_size;
+	VOID_RET(int, ioctl(h->fd, UFFDIO_WAKE, &wake));
+}
+
+/*
+ *  stress_userfaultfd_missing()
+ *	resolve a missing page fault on len bytes at start using
+ *	UFFDIO_COPY or UFFDIO_ZEROPAGE, returns bytes resolved or
+ *	-1 on failure. Pages already resolved by another handler
+ *	result in EEXIST and are not treated as an error.
+ */
+static ssize_t stress_userfaultfd_missing(
+	stress_userfaultfd_handler_t *h,
+	uint8_t *start,
+	const size_t len)
+{
+	stress_args_t *args = h->args;
 
 	if (stress_mwc32() & 1) {
 		struct uffdio_copy copy;
 
 		copy.copy = 0;
 		copy.mode = 0;
-		copy.dst = (unsigned long int)addr;
-		copy.src = (unsigned long int)zero_page;
-		copy.len = page_size;
+		copy.dst = (unsigned long int)start;
+		copy.src = (unsigned long int)h->src;
+		copy.len = len;
 
-		if (UNLIKELY(ioctl(fd, UFFDIO_COPY, &copy) < 0)) {
+		if (UNLIKELY(ioctl(h->fd, UFFDIO_COPY, &copy) < 0)) {
+			if (errno == EEXIST)
+				return (copy.copy > 0) ? (ssize_t)copy.copy : 0;
 			pr_fail("%s: page fault ioctl UFFDIO_COPY failed, errno=%d (%s)\n",
 				args->name, errno, strerror(errno));
 			return -1;
 		}
+		return (ssize_t)copy.copy;
 	} else {
 		struct uffdio_zeropage zeropage;
 
-		zeropage.range.start = (unsigned long int)addr;
-		zeropage.range.len = page_size;
+		zeropage.range.start = (unsigned long int)start;
+		zeropage.range.len = len;
 		zeropage.mode = 0;
-		if (UNLIKELY(ioctl(fd, UFFDIO_ZEROPAGE, &zeropage) < 0)) {
+		zeropage.zeropage = 0;
+
+		if (UNLIKELY(ioctl(h->fd, UFFDIO_ZEROPAGE, &zeropage) < 0)) {
+			if (errno == EEXIST)
+				return (zeropage.zeropage > 0) ? (ssize_t)zeropage.zeropage : 0;
 			pr_fail("%s: page fault ioctl UFFDIO_ZEROPAGE failed, errno=%d (%s)\n",
 				args->name, errno, strerror(errno));
 			return -1;
 		}
+		return (ssize_t)zeropage.zeropage;
+	}
+}
+
+#if defined(STRESS_USERFAULT_MINOR)
+/*
+ *  stress_userfaultfd_minor()
+ *	resolve a minor page fault on len bytes at start by mapping
+ *	the existing page cache pages with UFFDIO_CONTINUE
+ */
+static ssize_t stress_userfaultfd_minor(
+	stress_userfaultfd_handler_t *h,
+	uint8_t *start,
+	const size_t len)
+{
+	stress_args_t *args = h->args;
+	struct uffdio_continue cont;
+
+	cont.range.start = (unsigned long int)start;
+	cont.range.len = len;
+	cont.mode = 0;
+	cont.mapped = 0;
+
+	if (UNLIKELY(ioctl(h->fd, UFFDIO_CONTINUE, &cont) < 0)) {
+		if (errno == EEXIST)
+			return (cont.mapped > 0) ? (ssize_t)cont.mapped : 0;
+		pr_fail("%s: page fault ioctl UFFDIO_CONTINUE failed, errno=%d (%s)\n",
+			args->name, errno, strerror(errno));
+		return -1;
+	}
+	return (ssize_t)cont.mapped;
+}
+#endif
+
+/*
+ *  handle_page_fault()
+ *	handle a write page fault caused by a faulter, the fault is
+ *	resolved on a batch_sz aligned range around the faulting
+ *	address clipped to the registered region
+ */
+static inline int handle_page_fault(
+	stress_userfaultfd_handler_t *h,
+	uint8_t *addr)
+{
+	stress_args_t *args = h->args;
+	const uint8_t *data_end = h->data + h->sz;
+	uint8_t *start;
+	size_t offset, len;
+	ssize_t ret;
+	double t;
+
+	if (UNLIKELY((addr < h->data) || (addr >= data_end))) {
+		pr_fail("%s: page fault address is out of range\n", args->name);
+		return -1;
+	}
+	addr = (uint8_t *)((uintptr_t)addr & ~(h->page_size - 1));
+	offset = (size_t)(addr - h->data);
+	offset -= offset % h->batch_sz;
+	start = h->data + offset;
+	len = STRESS_MINIMUM(h->batch_sz, (size_t)(data_end - start));
+
+	t = stress_time_now();
+	switch (h->mode) {
+#if defined(STRESS_USERFAULT_MINOR)
+	case USERFAULT_MODE_MINOR:
+		ret = stress_userfaultfd_minor(h, start, len);
+		break;
+#endif
+#if defined(STRESS_USERFAULT_WP)
+	case USERFAULT_MODE_WP:
+		ret = stress_userfaultfd_wp(h->fd, start, len, false);
+		if (UNLIKELY(ret < 0)) {
+			pr_fail("%s: page fault ioctl UFFDIO_WRITEPROTECT failed, errno=%d (%s)\n",
+				args->name, errno, strerror(errno));
+		} else {
+			ret = (ssize_t)len;
+		}
+		break;
+#endif
+	default:
+		ret = stress_userfaultfd_missing(h, start, len);
+		break;
+	}
+	if (UNLIKELY(ret < 0))
+		return -1;
+
+	/*
+	 *  A short resolve means part of the range was already
+	 *  resolved, possibly before the faulting page, so
+	 *  resolve just the faulting page and wake it
+	 */
+	if ((size_t)ret < len) {
+		switch (h->mode) {
+#if defined(STRESS_USERFAULT_MINOR)
+		case USERFAULT_MODE_MINOR:
+			if (UNLIKELY(stress_userfaultfd_minor(h, addr, h->page_size) < 0))
+				return -1;
+			break;
+#endif
+		case USERFAULT_MODE_MISSING:
+			if (UNLIKELY(stress_userfaultfd_missing(h, addr, h->page_size) < 0))
+				return -1;
+			break;
+		default:
+			break;
+		}
+		stress_userfaultfd_wake(h, addr);
 	}
+	h->resolve_duration += stress_time_now() - t;
+	h->bytes += (uint64_t)ret;
+	h->faults++;
+
 	return 0;
 }
 
+/*
+ *  stress_userfaultfd_handler()
+ *	read and handle page faults from the shared userfaultfd
+ *	until the stressor is told to stop
+ */
+static void stress_userfaultfd_handler(stress_userfaultfd_handler_t *h)
+{
+	stress_args_t *args = h->args;
+	int count = 0;
+
+	do {
+		struct uffd_msg msg;
+		ssize_t ret;
+		double t;
+
+		/* check we should break out before we block on the read */
+		if (UNLIKELY(!stress_continue_flag()))
+			break;
+
+		t = stress_time_now();
+		/*
+		 * polled wait exercises userfaultfd_poll
+		 * in the kernel, but only works if fd is NONBLOCKing
+		 */
+		if (h->do_poll) {
+			struct pollfd fds[1];
+
+			(void)shim_memset(fds, 0, sizeof fds);
+			fds[0].fd = h->fd;
+			fds[0].events = POLLIN;
+			/* wait for 1 second max */
+
+			ret = poll(fds, 1, 1000);
+			if (ret == 0)
+				continue;	/* timed out, redo the poll */
+			if (ret < 0) {
+				if (errno == EINTR)
+					continue;
+				if (errno != ENOMEM) {
+					pr_fail("%s: poll failed, errno=%d (%s)\n",
+						args->name, errno, strerror(errno));
+					if (UNLIKELY(!stress_continue_flag()))
+						break;
+				}
+				/*
+				 *  poll ran out of free space for internal
+				 *  fd tables, so give up and block on the
+				 *  read anyway
+				 */
+				goto do_read;
+			}
+			/* No data, re-poll */
+			if (!(fds[0].revents & POLLIN))
+				continue;
+
+			if (UNLIKELY(count++ >= COUNT_MAX)) {
+				(void)stress_read_fdinfo(h->self, h->fd);
+				count = 0;
+			}
+		}
+
+do_read:
+		ret = read(h->fd, &msg, sizeof(msg));
+		if (UNLIKELY(ret < 0)) {
+			/* another handler thread took the message */
+			if ((errno == EINTR) || (errno == EAGAIN))
+				continue;
+			pr_fail("%s: read failed, errno=%d (%s)\n",
+				args->name, errno, strerror(errno));
+			if (UNLIKELY(!stress_continue_flag()))
+				break;
+			continue;
+		}
+		/* We only expect a page fault event */
+		if (msg.event != UFFD_EVENT_PAGEFAULT) {
+			pr_fail("%s: msg event not a pagefault event\n", args->name);
+			continue;
+		}
+		/* We only expect a write fault */
+		if (!(msg.arg.pagefault.flags & UFFD_PAGEFAULT_FLAG_WRITE)) {
+			pr_fail("%s: msg event not write page fault event\n", args->name);
+			continue;
+		}
+#if defined(STRESS_USERFAULT_MINOR)
+		if ((h->mode == USERFAULT_MODE_MINOR) &&
+		    !(msg.arg.pagefault.flags & UFFD_PAGEFAULT_FLAG_MINOR)) {
+			pr_fail("%s: msg event not minor page fault event\n", args->name);
+			continue;
+		}
+#endif
+#if defined(STRESS_USERFAULT_WP)
+		if ((h->mode == USERFAULT_MODE_WP) &&
+		    !(msg.arg.pagefault.flags & UFFD_PAGEFAULT_FLAG_WP)) {
+			pr_fail("%s: msg event not write protect page fault event\n", args->name);
+			continue;
+		}
+#endif
+		/* Go handle the page fault */
+		if (handle_page_fault(h, (uint8_t *)(intptr_t)msg.arg.pagefault.address) < 0) {
+			h->rc = EXIT_FAILURE;
+			break;
+		}
+		h->duration += stress_time_now() - t;
+		if (UNLIKELY(!stress_bogo_inc_lock(args, h->lock, true)))
+			break;
+	} while (stress_continue(args));
+}
+
+#if defined(HAVE_LIB_PTHREAD)
+/*
+ *  stress_userfaultfd_pthread()
+ *	additional fault handler thread
+ */
+static void *stress_userfaultfd_pthread(void *arg)
+{
+	stress_userfaultfd_handler_t *h = (stress_userfaultfd_handler_t *)arg;
+	sigset_t set;
+
+	/* leave signal handling to the main thread */
+	(void)sigfillset(&set);
+	(void)pthread_sigmask(SIG_BLOCK, &set, NULL);
+
+	stress_userfaultfd_handler(h);
+
+	return &g_nowt;
+}
+#endif
+
 /*
  *  stress_userfaultfd_oomable()
  *	stress userfaultfd system call, this
@@ -242,35 +620,41 @@ static inline int handle_page_fault(
 static int stress_userfaultfd_child(stress_args_t *args, void *context)
 {
 	const size_t page_size = args->page_size;
-	size_t sz;
+	size_t sz, stripe_sz, userfaultfd_batch = DEFAULT_USERFAULT_BATCH;
+	size_t userfaultfd_mode = USERFAULT_MODE_MISSING;
+	size_t userfaultfd_bytes = DEFAULT_USERFAULT_BYTES;
+	uint32_t userfaultfd_threads = DEFAULT_USERFAULT_THREADS;
+	uint32_t i, faulters, threads;
 	uint8_t *data;
-	void *zero_page = NULL;
-	int fd = -1, rc = EXIT_SUCCESS, count = 0;
-	const unsigned int uffdio_copy = 1 << _UFFDIO_COPY;
-	const unsigned int uffdio_zeropage = 1 << _UFFDIO_ZEROPAGE;
-	pid_t pid;
+	void *src = NULL;
+	int fd = -1, memfd = -1, rc = EXIT_SUCCESS;
+	unsigned int ioctls_needed;
+	uint64_t features = 0, mode = UFFDIO_REGISTER_MODE_MISSING;
 	const pid_t self = getpid();
 	struct uffdio_api api;
 	struct uffdio_register reg;
-	stress_context_t c;
+	stress_context_t *c;
+	stress_userfaultfd_handler_t *h;
 	bool do_poll = true;
-	static uint8_t stack[STACK_SIZE]; /* Child clone stack */
-	uint8_t *stack_top = (uint8_t *)stress_get_stack_top((void *)stack, STACK_SIZE);
-	size_t userfaultfd_bytes = DEFAULT_USERFAULT_BYTES;
-	double t, duration = 0.0, rate;
+	double t_start, duration, rate;
+	uint64_t faults = 0, bytes = 0, touches = 0;
+	double handle_duration = 0.0, resolve_duration = 0.0;
+	double touch_duration = 0.0, touch_max = 0.0;
+	void *lock = context;
 
 	if (stress_sigchld_set_handler(args) < 0)
 		return EXIT_NO_RESOURCE;
 
-	(void)context;
-	(void)shim_memset(stack, 0, sizeof(stack));
-
 	if (!stress_get_setting("userfaultfd-bytes", &userfaultfd_bytes)) {
 		if (g_opt_flags & OPT_FLAGS_MAXIMIZE)
 			userfaultfd_bytes = MAX_32;
 		if (g_opt_flags & OPT_FLAGS_MINIMIZE)
 			userfaultfd_bytes = MIN_USERFAULT_BYTES;
 	}
+	(void)stress_get_setting("userfaultfd-batch", &userfaultfd_batch);
+	(void)stress_get_setting("userfaultfd-mode", &userfaultfd_mode);
+	(void)stress_get_setting("userfaultfd-threads", &userfaultfd_threads);
+
 	userfaultfd_bytes /= args->instances;
 	if (userfaultfd_bytes < MIN_USERFAULT_BYTES)
 		userfaultfd_bytes = MIN_USERFAULT_BYTES;
@@ -279,13 +663,97 @@ static int stress_userfaultfd_child(stress_args_t *args, void *context)
 
 	sz = userfaultfd_bytes & ~(page_size - 1);
 
-	if (posix_memalign(&zero_page, page_size, page_size)) {
-		pr_err("%s: zero page allocation failed\n", args->name);
+	switch (userfaultfd_mode) {
+	case USERFAULT_MODE_MINOR:
+#if defined(STRESS_USERFAULT_MINOR)
+		features = UFFD_FEATURE_MINOR_SHMEM;
+		mode = UFFDIO_REGISTER_MODE_MINOR;
+		ioctls_needed = 1U << _UFFDIO_CONTINUE;
+		break;
+#else
+		if (args->instance == 0)
+			pr_inf_skip("%s: minor fault mode not supported, "
+				"stressor will be skipped\n", args->name);
+		return EXIT_NO_RESOURCE;
+#endif
+	case USERFAULT_MODE_WP:
+#if defined(STRESS_USERFAULT_WP)
+		features = UFFD_FEATURE_PAGEFAULT_FLAG_WP;
+		mode = UFFDIO_REGISTER_MODE_WP;
+		ioctls_needed = 1U << _UFFDIO_WRITEPROTECT;
+		break;
+#else
+		if (args->instance == 0)
+			pr_inf_skip("%s: write protect fault mode not supported, "
+				"stressor will be skipped\n", args->name);
 		return EXIT_NO_RESOURCE;
+#endif
+	default:
+		userfaultfd_mode = USERFAULT_MODE_MISSING;
+		ioctls_needed = (1U << _UFFDIO_COPY) | (1U << _UFFDIO_ZEROPAGE);
+		break;
 	}
 
-	data = mmap(NULL, sz, PROT_READ | PROT_WRITE,
-		MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	threads = userfaultfd_threads;
+#if !defined(HAVE_LIB_PTHREAD)
+	if ((threads > 1) && (args->instance == 0))
+		pr_inf("%s: built without pthread support, using 1 fault handler\n",
+			args->name);
+	threads = 1;
+#endif
+	/* one faulter per handler, each faulter needs at least a page */
+	faulters = STRESS_MINIMUM(userfaultfd_threads, (uint32_t)(sz / page_size));
+	stripe_sz = (sz / faulters) & ~(page_size - 1);
+
+	userfaultfd_batch *= page_size;
+	if (userfaultfd_batch > sz)
+		userfaultfd_batch = sz;
+
+	c = (stress_context_t *)calloc(faulters, sizeof(*c));
+	if (!c) {
+		pr_inf_skip("%s: cannot allocate %" PRIu32 " faulter "
+			"contexts, skipping stressor\n", args->name, faulters);
+		return EXIT_NO_RESOURCE;
+	}
+	h = (stress_userfaultfd_handler_t *)calloc(threads, sizeof(*h));
+	if (!h) {
+		pr_inf_skip("%s: cannot allocate %" PRIu32 " fault "
+			"handlers, skipping stressor\n", args->name, threads);
+		free(c);
+		return EXIT_NO_RESOURCE;
+	}
+
+	if (posix_memalign(&src, page_size, userfaultfd_batch)) {
+		pr_err("%s: copy source page allocation failed\n", args->name);
+		rc = EXIT_NO_RESOURCE;
+		goto free_contexts;
+	}
+	(void)shim_memset(src, 0, userfaultfd_batch);
+
+	if (userfaultfd_mode == USERFAULT_MODE_MINOR) {
+		/* minor faults need shmem backed page cache pages */
+		memfd = shim_memfd_create("stress-userfaultfd", 0);
+		if (memfd < 0) {
+			if (args->instance == 0)
+				pr_inf_skip("%s: memfd_create failed, errno=%d (%s), "
+					"stressor will be skipped\n",
+					args->name, errno, strerror(errno));
+			rc = EXIT_NO_RESOURCE;
+			goto free_zeropage;
+		}
+		if (ftruncate(memfd, (off_t)sz) < 0) {
+			pr_inf_skip("%s: ftruncate on memfd failed, errno=%d (%s), "
+				"stressor will be skipped\n",
+				args->name, errno, strerror(errno));
+			rc = EXIT_NO_RESOURCE;
+			goto free_zeropage;
+		}
+		data = mmap(NULL, sz, PROT_READ | PROT_WRITE,
+			MAP_SHARED, memfd, 0);
+	} else {
+		data = mmap(NULL, sz, PROT_READ | PROT_WRITE,
+			MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	}
 	if (data == MAP_FAILED) {
 		rc = EXIT_NO_RESOURCE;
 		pr_err("%s: mmap failed\n", args->name);
@@ -293,6 +761,13 @@ static int stress_userfaultfd_child(stress_args_t *args, void *context)
 	}
 	stress_set_vma_anon_name(data, sz, "userfaultfd-data");
 
+	/*
+	 *  minor and write protect faults are taken on pages that
+	 *  are already present, so populate them before registering
+	 */
+	if (userfaultfd_mode != USERFAULT_MODE_MISSING)
+		(void)shim_memset(data, 0x5a, sz);
+
 	/* Exercise invalid flags */
 	fd = shim_userfaultfd(~0);
 	if (fd >= 0)
@@ -308,12 +783,23 @@ static int stress_userfaultfd_child(stress_args_t *args, void *context)
 
 	if (stress_set_nonblock(fd) < 0)
 		do_poll = false;
+	/* threads blocked in read() would never be woken on termination */
+	if (!do_poll)
+		threads = 1;
 
 	/* API sanity check */
 	(void)shim_memset(&api, 0, sizeof(api));
 	api.api = UFFD_API;
-	api.features = 0;
+	api.features = features;
 	if (ioctl(fd, UFFDIO_API, &api) < 0) {
+		if ((errno == EINVAL) && features) {
+			if (args->instance == 0)
+				pr_inf_skip("%s: userfaultfd %s fault mode not supported, "
+					"stressor will be skipped\n", args->name,
+					stress_userfaultfd_modes(userfaultfd_mode));
+			rc = EXIT_NO_RESOURCE;
+			goto unmap_data;
+		}
 		pr_fail("%s: ioctl UFFDIO_API failed, errno=%d (%s)\n",
 			args->name, errno, strerror(errno));
 		rc = EXIT_FAILURE;
@@ -330,150 +816,164 @@ static int stress_userfaultfd_child(stress_args_t *args, void *context)
 	(void)shim_memset(&reg, 0, sizeof(reg));
 	reg.range.start = (unsigned long int)data;
 	reg.range.len = sz;
-	reg.mode = UFFDIO_REGISTER_MODE_MISSING;
+	reg.mode = mode;
 	if (ioctl(fd, UFFDIO_REGISTER, &reg) < 0) {
+		if ((errno == EINVAL) && features) {
+			if (args->instance == 0)
+				pr_inf_skip("%s: userfaultfd %s fault mode cannot be "
+					"registered, stressor will be skipped\n", args->name,
+					stress_userfaultfd_modes(userfaultfd_mode));
+			rc = EXIT_NO_RESOURCE;
+			goto unmap_data;
+		}
 		pr_fail("%s: ioctl UFFDIO_REGISTER failed, errno=%d (%s)\n",
 			args->name, errno, strerror(errno));
 		rc = EXIT_FAILURE;
 		goto unmap_data;
 	}
 
-	/* OK, so do we have copy supported? */
-	if ((reg.ioctls & uffdio_copy) != uffdio_copy) {
-		pr_fail("%s: ioctl UFFDIO_REGISTER did not support _UFFDIO_COPY\n",
-			args->name);
+	/* OK, so do we have the resolving ioctls supported? */
+	if ((reg.ioctls & ioctls_needed) != ioctls_needed) {
+		pr_fail("%s: ioctl UFFDIO_REGISTER did not support the %s mode "
+			"resolving ioctls\n", args->name,
+			stress_userfaultfd_modes(userfaultfd_mode));
 		rc = EXIT_FAILURE;
-		goto unmap_data;
+		goto unreg;
 	}
-	/* OK, so do we have zeropage supported? */
-	if ((reg.ioctls & uffdio_zeropage) != uffdio_zeropage) {
-		pr_fail("%s: ioctl UFFDIO_REGISTER did not support _UFFDIO_ZEROPAGE\n",
-			args->name);
-		rc = EXIT_FAILURE;
-		goto unmap_data;
+
+	/* Set up contexts for the faulters, each takes a stripe */
+	for (i = 0; i < faulters; i++) {
+		c[i].args = args;
+		c[i].data = data + (i * stripe_sz);
+		c[i].sz = (i == faulters - 1) ? sz - (i * stripe_sz) : stripe_sz;
+		c[i].page_size = page_size;
+		c[i].fd = fd;
+		c[i].mode = (int)userfaultfd_mode;
+		c[i].parent = self;
+		c[i].pid = -1;
+		c[i].stack = (uint8_t *)mmap(NULL, STACK_SIZE, PROT_READ | PROT_WRITE,
+			MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		if (c[i].stack == MAP_FAILED) {
+			pr_inf_skip("%s: cannot mmap clone stack, errno=%d (%s), "
+				"skipping stressor\n", args->name,
+				errno, strerror(errno));
+			c[i].stack = NULL;
+			rc = EXIT_NO_RESOURCE;
+			goto free_stacks;
+		}
+		stress_set_vma_anon_name(c[i].stack, STACK_SIZE, "clone-stack");
 	}
 
-	/* Set up context for child */
-	c.args = args;
-	c.data = data;
-	c.sz = sz;
-	c.page_size = page_size;
-	c.parent = self;
+	/* and the fault handlers */
+	for (i = 0; i < threads; i++) {
+		h[i].args = args;
+		h[i].fd = fd;
+		h[i].mode = (int)userfaultfd_mode;
+		h[i].do_poll = do_poll;
+		h[i].data = data;
+		h[i].sz = sz;
+		h[i].page_size = page_size;
+		h[i].batch_sz = userfaultfd_batch;
+		h[i].src = src;
+		h[i].lock = lock;
+		h[i].self = self;
+		h[i].rc = EXIT_SUCCESS;
+#if defined(HAVE_LIB_PTHREAD)
+		h[i].ret = -1;
+#endif
+	}
 
 	stress_set_proc_state(args->name, STRESS_STATE_SYNC_WAIT);
 	stress_sync_start_wait(args);
 	stress_set_proc_state(args->name, STRESS_STATE_RUN);
 
+	t_start = stress_time_now();
+#if defined(HAVE_LIB_PTHREAD)
+	for (i = 1; i < threads; i++)
+		h[i].ret = pthread_create(&h[i].pthread, NULL,
+				stress_userfaultfd_pthread, (void *)&h[i]);
+#endif
+
 	/*
 	 *  We need to clone and share the same VM address space
-	 *  as parent so we can perform the page fault handling
+	 *  as parent so we can perform the page fault handling,
+	 *  signal handlers are not shared so the faulter's SIGALRM
+	 *  exit handler does not terminate the handlers before the
+	 *  metrics are gathered
 	 */
-	pid = clone(stress_userfaultfd_clone, stress_align_stack(stack_top),
-		SIGCHLD | CLONE_FILES | CLONE_FS | CLONE_SIGHAND | CLONE_VM, &c);
-	if (pid < 0) {
-		pr_err("%s: clone failed, errno=%d (%s)\n",
-			args->name, errno, strerror(errno));
-		goto unreg;
-	}
-
-	/* Parent */
-	do {
-		struct uffd_msg msg;
-		struct uffdio_range wake;
-		ssize_t ret;
-		double counter;
+	for (i = 0; i < faulters; i++) {
+		uint8_t *stack_top = (uint8_t *)stress_get_stack_top((void *)c[i].stack, STACK_SIZE);
 
-		/* check we should break out before we block on the read */
-		if (UNLIKELY(!stress_continue_flag()))
+		c[i].pid = clone(stress_userfaultfd_clone, stress_align_stack(stack_top),
+			SIGCHLD | CLONE_FILES | CLONE_FS | CLONE_VM, &c[i]);
+		if (c[i].pid < 0) {
+			pr_err("%s: clone failed, errno=%d (%s)\n",
+				args->name, errno, strerror(errno));
 			break;
+		}
+	}
 
-		t = stress_time_now();
-		/*
-		 * polled wait exercises userfaultfd_poll
-		 * in the kernel, but only works if fd is NONBLOCKing
-		 */
-		if (do_poll) {
-			struct pollfd fds[1];
-
-			(void)shim_memset(fds, 0, sizeof fds);
-			fds[0].fd = fd;
-			fds[0].events = POLLIN;
-			/* wait for 1 second max */
+	/* Main thread is fault handler 0 */
+	if (i > 0)
+		stress_userfaultfd_handler(&h[0]);
+	duration = stress_time_now() - t_start;
 
-			ret = poll(fds, 1, 1000);
-			if (ret == 0)
-				continue;	/* timed out, redo the poll */
-			if (ret < 0) {
-				if (errno == EINTR)
-					continue;
-				if (errno != ENOMEM) {
-					pr_fail("%s: poll failed, errno=%d (%s)\n",
-						args->name, errno, strerror(errno));
-					if (UNLIKELY(!stress_continue_flag()))
-						break;
-				}
-				/*
-				 *  poll ran out of free space for internal
-				 *  fd tables, so give up and block on the
-				 *  read anyway
-				 */
-				goto do_read;
-			}
-			/* No data, re-poll */
-			if (!(fds[0].revents & POLLIN))
-				continue;
+	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
 
-			if (UNLIKELY(count++ >= COUNT_MAX)) {
-				(void)stress_read_fdinfo(self, fd);
-				count = 0;
-			}
-		}
+	for (i = 0; i < faulters; i++) {
+		if (c[i].pid > 0)
+			stress_kill_and_wait(args, c[i].pid, SIGALRM, false);
+	}
+	/* faulters are gone, handler threads exit on the next poll timeout */
+	stress_continue_set_flag(false);
+#if defined(HAVE_LIB_PTHREAD)
+	for (i = 1; i < threads; i++) {
+		if (h[i].ret == 0)
+			(void)pthread_join(h[i].pthread, NULL);
+	}
+#endif
 
-do_read:
-		ret = read(fd, &msg, sizeof(msg));
-		if (UNLIKELY(ret < 0)) {
-			if (errno == EINTR)
-				continue;
-			pr_fail("%s: read failed, errno=%d (%s)\n",
-				args->name, errno, strerror(errno));
-			if (UNLIKELY(!stress_continue_flag()))
-				break;
-			continue;
-		}
-		/* We only expect a page fault event */
-		if (msg.event != UFFD_EVENT_PAGEFAULT) {
-			pr_fail("%s: msg event not a pagefault event\n", args->name);
-			continue;
-		}
-		/* We only expect a write fault */
-		if (!(msg.arg.pagefault.flags & UFFD_PAGEFAULT_FLAG_WRITE)) {
-			pr_fail("%s: msg event not write page fault event\n", args->name);
-			continue;
-		}
-		/* Go handle the page fault */
-		if (handle_page_fault(args, fd, (uint8_t *)(intptr_t)msg.arg.pagefault.address,
-				zero_page, data, data + sz, page_size) < 0)
-			break;
-		duration += stress_time_now() - t;
-		stress_bogo_inc(args);
-		counter = (double)stress_bogo_get(args);
-
-		rate = (counter > 0.0) ? duration / counter : 0.0;
-		stress_metrics_set(args, 0, "nanosecs per page fault",
-			rate * STRESS_DBL_NANOSECOND, STRESS_METRIC_HARMONIC_MEAN);
-
-		(void)shim_memset(&wake, 0, sizeof(wake));
-		wake.start = (uintptr_t)data;
-		wake.len = page_size;
-		VOID_RET(int, ioctl(fd, UFFDIO_WAKE, &wake));
-	} while (stress_continue(args));
+	for (i = 0; i < threads; i++) {
+		faults += h[i].faults;
+		bytes += h[i].bytes;
+		handle_duration += h[i].duration;
+		resolve_duration += h[i].resolve_duration;
+		if (h[i].rc != EXIT_SUCCESS)
+			rc = h[i].rc;
+	}
+	for (i = 0; i < faulters; i++) {
+		touches += c[i].touches;
+		touch_duration += c[i].touch_duration;
+		if (c[i].touch_max > touch_max)
+			touch_max = c[i].touch_max;
+	}
 
-	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
+	rate = (faults > 0) ? handle_duration / (double)faults : 0.0;
+	stress_metrics_set(args, 0, "nanosecs per page fault",
+		rate * STRESS_DBL_NANOSECOND, STRESS_METRIC_HARMONIC_MEAN);
+	rate = (duration > 0.0) ? (double)faults / duration : 0.0;
+	stress_metrics_set(args, 1, "page faults per sec",
+		rate, STRESS_METRIC_HARMONIC_MEAN);
+	rate = (faults > 0) ? resolve_duration / (double)faults : 0.0;
+	stress_metrics_set(args, 2, "nanosecs per fault resolve",
+		rate * STRESS_DBL_NANOSECOND, STRESS_METRIC_HARMONIC_MEAN);
+	rate = (duration > 0.0) ? (double)bytes / (duration * (double)MB) : 0.0;
+	stress_metrics_set(args, 3, "MB per sec resolved",
+		rate, STRESS_METRIC_HARMONIC_MEAN);
+	rate = (touches > 0) ? touch_duration / (double)touches : 0.0;
+	stress_metrics_set(args, 4, "nanosecs per page touch",
+		rate * STRESS_DBL_NANOSECOND, STRESS_METRIC_HARMONIC_MEAN);
+	stress_metrics_set(args, 5, "nanosecs max page touch",
+		touch_max * STRESS_DBL_NANOSECOND, STRESS_METRIC_MAXIMUM);
 
-	stress_kill_and_wait(args, pid, SIGALRM, false);
+free_stacks:
+	for (i = 0; i < faulters; i++) {
+		if (c[i].stack)
+			(void)munmap((void *)c[i].stack, STACK_SIZE);
+	}
 unreg:
 	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
-	if (ioctl(fd, UFFDIO_UNREGISTER, &reg) < 0) {
+	if (ioctl(fd, UFFDIO_UNREGISTER, &reg.range) < 0) {
 		pr_fail("%s: ioctl UFFDIO_UNREGISTER failed, errno=%d (%s)\n",
 			args->name, errno, strerror(errno));
 		rc = EXIT_FAILURE;
@@ -484,9 +984,14 @@ unmap_data:
 	(void)munmap((void *)data, sz);
 free_zeropage:
 	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
-	free(zero_page);
+	free(src);
 	if (fd > -1)
 		(void)close(fd);
+	if (memfd > -1)
+		(void)close(memfd);
+free_contexts:
+	free(h);
+	free(c);
 
 	return rc;
 }
@@ -497,7 +1002,18 @@ free_zeropage:
  */
 static int stress_userfaultfd(stress_args_t *args)
 {
-	return stress_oomable_child(args, NULL, stress_userfaultfd_child, STRESS_OOMABLE_NORMAL);
+	void *counter_lock;
+	int rc;
+
+	counter_lock = stress_lock_create("counter");
+	if (!counter_lock) {
+		pr_inf_skip("%s: failed to create counter lock. skipping stressor\n", args->name);
+		return EXIT_NO_RESOURCE;
+	}
+	rc = stress_oomable_child(args, counter_lock, stress_userfaultfd_child, STRESS_OOMABLE_NORMAL);
+	(void)stress_lock_destroy(counter_lock);
+
+	return rc;
 }
 
 const stressor_info_t stress_userfaultfd_info = {
@@ -506,6 +1022,7 @@ const stressor_info_t stress_userfaultfd_info = {
 	.opts = opts,
 	.supported = stress_userfaultfd_supported,
 	.verify = VERIFY_ALWAYS,
+	.metrics_max = 6,
 	.help = help
 };
 #else
@@ -364,6 +364,7 @@ const stressor_info_t stress_usersyscall_info = {
 	.class = CLASS_OS,
 	.supported = stress_supported,
 	.verify = VERIFY_ALWAYS,
+	.metrics_max = 1,
 	.help = help
 };
 
@@ -18,6 +18,7 @@
  *
  */
 #include "stress-ng.h"
+#include "core-clocksource.h"
 
 #include <time.h>
 
@@ -35,13 +36,17 @@ UNEXPECTED
 
 static const stress_help_t help[] = {
 	{ NULL,	"vdso N",	"start N workers exercising functions in the VDSO" },
+	{ NULL,	"vdso-clocksources", "repeat --vdso-timing for each available clocksource" },
 	{ NULL,	"vdso-func F",	"use just vDSO function F" },
 	{ NULL,	"vdso-ops N",	"stop after N vDSO function calls" },
+	{ NULL,	"vdso-timing",	"report ns per call of vDSO functions and equivalent system calls" },
 	{ NULL,	NULL,		NULL }
 };
 
 static const stress_opt_t opts[] = {
+	{ OPT_vdso_clocksources, "vdso-clocksources", TYPE_ID_BOOL, 0, 1, NULL },
 	{ OPT_vdso_func, "vdso-func", TYPE_ID_STR, 0, 0, NULL },
+	{ OPT_vdso_timing, "vdso-timing", TYPE_ID_BOOL, 0, 1, NULL },
 	END_OPT,
 };
 
@@ -72,6 +77,70 @@ typedef struct vdso_sym {
 	bool duplicate;		/* True if a duplicate call */
 } stress_vdso_sym_t;
 
+#define VDSO_TIMING_CLOCK_GETTIME	(0)
+#define VDSO_TIMING_GETTIMEOFDAY	(1)
+#define VDSO_TIMING_TIME		(2)
+#define VDSO_TIMING_GETCPU		(3)
+
+#define VDSO_TIMING_LOOPS		(1024)	/* calls between time checks */
+#define VDSO_TIMING_SLICE		(0.01)	/* seconds per measurement */
+#define VDSO_TIMING_CLOCKSOURCES	(8)	/* max clocksources timed */
+
+/*
+ *  vDSO function and the system call it replaces
+ */
+typedef struct {
+	const char *name;	/* function and clock id name */
+	const char *sym;	/* vDSO function name, without prefix */
+	const int kind;		/* VDSO_TIMING_* */
+	const long int nr;	/* system call number, -1 if none */
+	const clockid_t clk;	/* clock id for clock_gettime */
+} stress_vdso_timing_t;
+
+static const stress_vdso_timing_t vdso_timings[] = {
+#if defined(HAVE_CLOCK_GETTIME) &&	\
+    defined(__NR_clock_gettime)
+#if defined(CLOCK_REALTIME)
+	{ "clock_gettime REALTIME",	"clock_gettime", VDSO_TIMING_CLOCK_GETTIME, __NR_clock_gettime, CLOCK_REALTIME },
+#endif
+#if defined(CLOCK_MONOTONIC)
+	{ "clock_gettime MONOTONIC",	"clock_gettime", VDSO_TIMING_CLOCK_GETTIME, __NR_clock_gettime, CLOCK_MONOTONIC },
+#endif
+#if defined(CLOCK_MONOTONIC_RAW)
+	{ "clock_gettime MONOTONIC_RAW", "clock_gettime", VDSO_TIMING_CLOCK_GETTIME, __NR_clock_gettime, CLOCK_MONOTONIC_RAW },
+#endif
+#if defined(CLOCK_REALTIME_COARSE)
+	{ "clock_gettime REALTIME_COARSE", "clock_gettime", VDSO_TIMING_CLOCK_GETTIME, __NR_clock_gettime, CLOCK_REALTIME_COARSE },
+#endif
+#if defined(CLOCK_MONOTONIC_COARSE)
+	{ "clock_gettime MONOTONIC_COARSE", "clock_gettime", VDSO_TIMING_CLOCK_GETTIME, __NR_clock_gettime, CLOCK_MONOTONIC_COARSE },
+#endif
+#if defined(CLOCK_BOOTTIME)
+	{ "clock_gettime BOOTTIME",	"clock_gettime", VDSO_TIMING_CLOCK_GETTIME, __NR_clock_gettime, CLOCK_BOOTTIME },
+#endif
+#if defined(CLOCK_TAI)
+	{ "clock_gettime TAI",		"clock_gettime", VDSO_TIMING_CLOCK_GETTIME, __NR_clock_gettime, CLOCK_TAI },
+#endif
+#endif
+#if defined(__NR_gettimeofday)
+	{ "gettimeofday",		"gettimeofday",	VDSO_TIMING_GETTIMEOFDAY, __NR_gettimeofday, 0 },
+#endif
+#if defined(__NR_time)
+	{ "time",			"time",		VDSO_TIMING_TIME, __NR_time, 0 },
+#endif
+#if defined(__NR_getcpu)
+	{ "getcpu",			"getcpu",	VDSO_TIMING_GETCPU, __NR_getcpu, 0 },
+#endif
+};
+
+#define VDSO_TIMINGS	(SIZEOF_ARRAY(vdso_timings))
+
+typedef struct {
+	double vdso_ns;		/* sum of vDSO ns per call measurements */
+	double syscall_ns;	/* sum of system call ns per call measurements */
+	uint64_t count;		/* number of measurements */
+} stress_vdso_timing_stat_t;
+
 static stress_vdso_sym_t *vdso_sym_list;
 
 /*
@@ -473,6 +542,239 @@ static int vdso_sym_list_check_vdso_func(stress_vdso_sym_t **list)
 	return 0;
 }
 
+/*
+ *  vdso_sym_find()
+ *	find the vDSO address of function name, NULL if not in the vDSO
+ */
+static void *vdso_sym_find(const char *name)
+{
+	static const char * const prefixes[] = { "", "__vdso_", "__kernel_" };
+	const stress_vdso_sym_t *vdso_sym;
+	size_t i;
+
+	for (i = 0; i < SIZEOF_ARRAY(prefixes); i++) {
+		char sym_name[64];
+
+		(void)snprintf(sym_name, sizeof(sym_name), "%s%s", prefixes[i], name);
+		for (vdso_sym = vdso_sym_list; vdso_sym; vdso_sym = vdso_sym->next) {
+			if (!strcmp(vdso_sym->name, sym_name))
+				return vdso_sym->addr;
+		}
+	}
+	return NULL;
+}
+
+/*
+ *  stress_vdso_timing_ns()
+ *	time calls to the vDSO function at addr or, if addr is NULL,
+ *	the equivalent system call, returns ns per call or -1.0 if
+ *	the calls failed
+ */
+static double OPTIMIZE3 stress_vdso_timing_ns(const stress_vdso_timing_t *vt, void *addr)
+{
+	const double t_start = stress_time_now();
+	double t_now;
+	uint64_t calls = 0;
+	int i, ret = 0;
+
+	do {
+		switch (vt->kind) {
+		case VDSO_TIMING_CLOCK_GETTIME: {
+			int (*vdso_clock_gettime)(clockid_t clk_id, struct timespec *tp);
+			struct timespec ts;
+
+			*(void **)(&vdso_clock_gettime) = addr;
+			if (addr) {
+				for (i = 0; i < VDSO_TIMING_LOOPS; i++)
+					ret |= vdso_clock_gettime(vt->clk, &ts);
+			} else {
+				for (i = 0; i < VDSO_TIMING_LOOPS; i++)
+					ret |= (int)syscall(vt->nr, vt->clk, &ts);
+			}
+			break;
+		}
+		case VDSO_TIMING_GETTIMEOFDAY: {
+			int (*vdso_gettimeofday)(struct timeval *tv, struct timezone *tz);
+			struct timeval tv;
+
+			*(void **)(&vdso_gettimeofday) = addr;
+			if (addr) {
+				for (i = 0; i < VDSO_TIMING_LOOPS; i++)
+					ret |= vdso_gettimeofday(&tv, NULL);
+			} else {
+				for (i = 0; i < VDSO_TIMING_LOOPS; i++)
+					ret |= (int)syscall(vt->nr, &tv, NULL);
+			}
+			break;
+		}
+		case VDSO_TIMING_TIME: {
+			time_t (*vdso_time)(time_t *tloc);
+
+			*(void **)(&vdso_time) = addr;
+			if (addr) {
+				for (i = 0; i < VDSO_TIMING_LOOPS; i++)
+					ret |= (vdso_time(NULL) == (time_t)-1);
+			} else {
+				for (i = 0; i < VDSO_TIMING_LOOPS; i++)
+					ret |= (syscall(vt->nr, NULL) == -1);
+			}
+			break;
+		}
+		case VDSO_TIMING_GETCPU: {
+			int (*vdso_getcpu)(unsigned *cpu, unsigned *node, void *tcache);
+			unsigned cpu, node;
+
+			*(void **)(&vdso_getcpu) = addr;
+			if (addr) {
+				for (i = 0; i < VDSO_TIMING_LOOPS; i++)
+					ret |= vdso_getcpu(&cpu, &node, NULL);
+			} else {
+				for (i = 0; i < VDSO_TIMING_LOOPS; i++)
+					ret |= (int)syscall(vt->nr, &cpu, &node, NULL);
+			}
+			break;
+		}
+		default:
+			return -1.0;
+		}
+		calls += VDSO_TIMING_LOOPS;
+		t_now = stress_time_now();
+	} while (t_now - t_start < VDSO_TIMING_SLICE);
+
+	if (ret)
+		return -1.0;
+	return ((t_now - t_start) * (double)STRESS_NANOSECOND) / (double)calls;
+}
+
+/*
+ *  stress_vdso_timing()
+ *	report ns per call of each vDSO function against the equivalent
+ *	system call, optionally for each available clocksource
+ */
+static int stress_vdso_timing(stress_args_t *args)
+{
+	stress_vdso_timing_stat_t *stats;
+	char clocksources[VDSO_TIMING_CLOCKSOURCES][64];
+	char orig_cs[64], avail[256];
+	void *addrs[VDSO_TIMINGS];
+	bool vdso_clocksources = false;
+	size_t n_cs = 0, cs, i, idx;
+	int rc = EXIT_SUCCESS;
+
+	(void)stress_get_setting("vdso-clocksources", &vdso_clocksources);
+
+	stats = (stress_vdso_timing_stat_t *)calloc(VDSO_TIMING_CLOCKSOURCES * VDSO_TIMINGS, sizeof(*stats));
+	if (!stats) {
+		pr_inf_skip("%s: cannot allocate timing statistics, skipping stressor\n", args->name);
+		return EXIT_NO_RESOURCE;
+	}
+	for (i = 0; i < VDSO_TIMINGS; i++)
+		addrs[i] = vdso_sym_find(vdso_timings[i].sym);
+
+	if (stress_clocksource_get(orig_cs, sizeof(orig_cs)) < 0)
+		(void)shim_strscpy(orig_cs, "unknown", sizeof(orig_cs));
+	(void)shim_strscpy(clocksources[n_cs++], orig_cs, sizeof(clocksources[0]));
+
+	/* only one instance may switch the system wide clocksource */
+	if (vdso_clocksources && (args->instance == 0)) {
+		if (stress_clocksource_available(avail, sizeof(avail)) < 0) {
+			pr_inf("%s: cannot read the available clocksources, "
+				"timing %s only\n", args->name, orig_cs);
+		} else if (stress_clocksource_set(orig_cs) < 0) {
+			pr_inf("%s: cannot switch clocksource (need root?), timing %s only\n",
+				args->name, orig_cs);
+		} else {
+			char *token, *saveptr = NULL;
+
+			for (token = strtok_r(avail, " \t\n", &saveptr);
+			     token && (n_cs < VDSO_TIMING_CLOCKSOURCES);
+			     token = strtok_r(NULL, " \t\n", &saveptr)) {
+				if (strcmp(token, orig_cs))
+					(void)shim_strscpy(clocksources[n_cs++], token, sizeof(clocksources[0]));
+			}
+		}
+	}
+
+	stress_set_proc_state(args->name, STRESS_STATE_SYNC_WAIT);
+	stress_sync_start_wait(args);
+	stress_set_proc_state(args->name, STRESS_STATE_RUN);
+
+	do {
+		for (cs = 0; (cs < n_cs) && stress_continue(args); cs++) {
+			if ((n_cs > 1) && (stress_clocksource_set(clocksources[cs]) < 0)) {
+				pr_inf("%s: cannot switch to clocksource %s\n", args->name, clocksources[cs]);
+				continue;
+			}
+			for (i = 0; i < VDSO_TIMINGS; i++) {
+				stress_vdso_timing_stat_t *stat = &stats[(cs * VDSO_TIMINGS) + i];
+				const double syscall_ns = stress_vdso_timing_ns(&vdso_timings[i], NULL);
+				const double vdso_ns = addrs[i] ?
+					stress_vdso_timing_ns(&vdso_timings[i], addrs[i]) : 0.0;
+
+				if (UNLIKELY((syscall_ns < 0.0) || (vdso_ns < 0.0))) {
+					pr_fail("%s: %s failed with clocksource %s\n", args->name,
+						vdso_timings[i].name, clocksources[cs]);
+					rc = EXIT_FAILURE;
+					goto done;
+				}
+				stat->syscall_ns += syscall_ns;
+				stat->vdso_ns += vdso_ns;
+				stat->count++;
+			}
+			stress_bogo_add(args, VDSO_TIMINGS);
+		}
+	} while (stress_continue(args));
+done:
+	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
+	if (n_cs > 1)
+		(void)stress_clocksource_set(orig_cs);
+
+	if (args->instance == 0)
+		pr_inf("%s: %-12s %-32s %10s %10s %8s\n", args->name,
+			"clocksource", "function", "vDSO ns", "syscall ns", "speedup");
+	for (idx = 0, cs = 0; cs < n_cs; cs++) {
+		for (i = 0; i < VDSO_TIMINGS; i++) {
+			const stress_vdso_timing_stat_t *stat = &stats[(cs * VDSO_TIMINGS) + i];
+			const double syscall_ns = stat->count ? stat->syscall_ns / (double)stat->count : 0.0;
+			const double vdso_ns = stat->count ? stat->vdso_ns / (double)stat->count : 0.0;
+			char desc[80];
+
+			if (stat->count == 0)
+				continue;
+			if (args->instance == 0) {
+				if (addrs[i]) {
+					pr_inf("%s: %-12s %-32s %10.2f %10.2f %7.1fx\n", args->name,
+						clocksources[cs], vdso_timings[i].name, vdso_ns, syscall_ns,
+						(vdso_ns > 0.0) ? syscall_ns / vdso_ns : 0.0);
+					/* a vDSO call close to syscall cost has fallen back to the kernel */
+					if ((vdso_ns > 0.0) && (syscall_ns < vdso_ns * 2.0) &&
+					    (vdso_timings[i].kind != VDSO_TIMING_GETCPU))
+						pr_inf("%s: %s with clocksource %s is not much faster than "
+							"the system call, the vDSO may be using the slow "
+							"system call path\n", args->name,
+							vdso_timings[i].name, clocksources[cs]);
+				} else {
+					pr_inf("%s: %-12s %-32s %10s %10.2f %8s\n", args->name,
+						clocksources[cs], vdso_timings[i].name, "n/a", syscall_ns, "n/a");
+				}
+			}
+			/* metrics are for the original clocksource */
+			if (cs != 0)
+				continue;
+			if (addrs[i]) {
+				(void)snprintf(desc, sizeof(desc), "nanosecs per vDSO %s", vdso_timings[i].name);
+				stress_metrics_set(args, idx++, desc, vdso_ns, STRESS_METRIC_HARMONIC_MEAN);
+			}
+			(void)snprintf(desc, sizeof(desc), "nanosecs per syscall %s", vdso_timings[i].name);
+			stress_metrics_set(args, idx++, desc, syscall_ns, STRESS_METRIC_HARMONIC_MEAN);
+		}
+	}
+	free(stats);
+	vdso_sym_list_free(&vdso_sym_list);
+
+	return rc;
+}
+
 /*
  *  stress_vdso()
  *	stress system wraps in vDSO
@@ -483,6 +785,7 @@ static int stress_vdso(stress_args_t *args)
 	uint64_t counter;
 	int n_vdso = 0;
 	register stress_vdso_sym_t *vdso_sym;
+	bool vdso_timing = false;
 
 	if (!vdso_sym_list) {
 		/* Should not fail, but worth checking to avoid breakage */
@@ -492,6 +795,9 @@ static int stress_vdso(stress_args_t *args)
 		return EXIT_NOT_IMPLEMENTED;
 	}
 	vdso_sym_list_remove_duplicates(&vdso_sym_list);
+	(void)stress_get_setting("vdso-timing", &vdso_timing);
+	if (vdso_timing)
+		return stress_vdso_timing(args);
 	if (vdso_sym_list_check_vdso_func(&vdso_sym_list) < 0) {
 		return EXIT_FAILURE;
 	}
@@ -562,6 +868,7 @@ const stressor_info_t stress_vdso_info = {
 	.supported = stress_vdso_supported,
 	.class = CLASS_OS,
 	.opts = opts,
+	.metrics_max = 2 + (2 * VDSO_TIMINGS),
 	.help = help
 };
 #else
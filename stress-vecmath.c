@@ -329,6 +329,7 @@ const stressor_info_t stress_vecmath_info = {
 	.stressor = stress_vecmath,
 	.class = CLASS_CPU | CLASS_INTEGER | CLASS_COMPUTE | CLASS_VECTOR,
 	.verify = VERIFY_ALWAYS,
+	.instance_threads = true,
 	.help = help
 };
 #else
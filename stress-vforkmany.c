@@ -336,5 +336,6 @@ const stressor_info_t stress_vforkmany_info = {
 	.class = CLASS_SCHEDULER | CLASS_OS,
 	.opts = opts,
 	.verify = VERIFY_ALWAYS,
+	.metrics_max = 1,
 	.help = help
 };
@@ -37,6 +37,7 @@ static const stress_help_t help[] = {
 	{ NULL,	"vm-rw N",	 "start N vm read/write process_vm* copy workers" },
 	{ NULL,	"vm-rw-bytes N", "transfer N bytes of memory per bogo operation" },
 	{ NULL,	"vm-rw-ops N",	 "stop after N vm process_vm* copy bogo operations" },
+	{ NULL,	"vm-rw-sweep",	 "compare process_vm_readv, /proc/pid/mem, shared memory and pidfd_getfd copies" },
 	{ NULL,	NULL,		 NULL }
 };
 
@@ -62,10 +63,54 @@ typedef struct {
 	uint8_t val;	/* Value to check */
 } stress_addr_msg_t;
 
+#define VM_RW_SWEEP_PVM_1	(0)	/* process_vm_readv, 1 remote iovec */
+#define VM_RW_SWEEP_PVM_16	(1)	/* process_vm_readv, 16 remote iovecs */
+#define VM_RW_SWEEP_PVM_256	(2)	/* process_vm_readv, 256 remote iovecs */
+#define VM_RW_SWEEP_PROC_MEM	(3)	/* pread on /proc/pid/mem */
+#define VM_RW_SWEEP_SHM		(4)	/* memcpy from a shared mapping */
+#define VM_RW_SWEEP_PIDFD	(5)	/* pidfd_getfd + mmap + memcpy */
+#define VM_RW_SWEEP_METHODS	(6)
+
+#define VM_RW_SWEEP_SLICE	(0.01)	/* seconds per method and size */
+
+static const char * const stress_vm_rw_sweep_methods[VM_RW_SWEEP_METHODS] = {
+	"pvm-readv-1",
+	"pvm-readv-16",
+	"pvm-readv-256",
+	"proc-mem",
+	"shm-memcpy",
+	"pidfd-mmap",
+};
+
+static const size_t stress_vm_rw_sweep_iovs[] = { 1, 16, 256 };
+
+static const size_t stress_vm_rw_sweep_sizes[] = {
+	4 * KB, 64 * KB, 1 * MB, 16 * MB, 256 * MB
+};
+
+#define VM_RW_SWEEP_SIZES	(SIZEOF_ARRAY(stress_vm_rw_sweep_sizes))
+
+typedef struct {
+	double bytes;		/* bytes copied */
+	double duration;	/* time taken */
+} stress_vm_rw_sweep_stat_t;
+
+typedef struct {
+	pid_t pid;		/* child holding the source memory */
+	int pidfd;		/* pidfd of child, -1 if not supported */
+	int memfd;		/* memfd backing the source memory */
+	int proc_fd;		/* /proc/pid/mem of child, -1 if not readable */
+	uint8_t *src;		/* source memory, same address in child */
+	uint8_t *dst;		/* local destination buffer */
+	size_t sz;		/* size of src and dst */
+	struct iovec iov[256];	/* remote iovecs */
+} stress_vm_rw_sweep_t;
+
 #endif
 
 static const stress_opt_t opts[] = {
 	{ OPT_vm_rw_bytes, "vm-rw-bytes", TYPE_ID_SIZE_T_BYTES_VM, MIN_VM_RW_BYTES, MAX_VM_RW_BYTES, NULL },
+	{ OPT_vm_rw_sweep, "vm-rw-sweep", TYPE_ID_BOOL, 0, 1, NULL },
 	END_OPT,
 };
 
@@ -355,6 +400,243 @@ fail:
 	return EXIT_SUCCESS;
 }
 
+/*
+ *  stress_vm_rw_sweep_copy()
+ *	copy len bytes from the child's source memory into the
+ *	local buffer using a given method, returns -1 on failure
+ */
+static int stress_vm_rw_sweep_copy(
+	stress_vm_rw_sweep_t *sw,
+	const size_t method,
+	const size_t len)
+{
+	struct iovec local;
+	size_t i, n, chunk;
+	ssize_t ret;
+	int fd;
+	void *ptr;
+
+	switch (method) {
+	case VM_RW_SWEEP_PVM_1:
+	case VM_RW_SWEEP_PVM_16:
+	case VM_RW_SWEEP_PVM_256:
+		n = stress_vm_rw_sweep_iovs[method - VM_RW_SWEEP_PVM_1];
+		chunk = len / n;
+		for (i = 0; i < n; i++) {
+			sw->iov[i].iov_base = sw->src + (i * chunk);
+			sw->iov[i].iov_len = chunk;
+		}
+		local.iov_base = sw->dst;
+		local.iov_len = chunk * n;
+		ret = process_vm_readv(sw->pid, &local, 1, sw->iov, n, 0);
+		return (ret == (ssize_t)(chunk * n)) ? 0 : -1;
+	case VM_RW_SWEEP_PROC_MEM:
+		ret = pread(sw->proc_fd, sw->dst, len, (off_t)(uintptr_t)sw->src);
+		return (ret == (ssize_t)len) ? 0 : -1;
+	case VM_RW_SWEEP_SHM:
+		(void)shim_memcpy(sw->dst, sw->src, len);
+		return 0;
+	case VM_RW_SWEEP_PIDFD:
+		/* a checkpointer has to fetch and map the fd for each copy */
+		fd = shim_pidfd_getfd(sw->pidfd, sw->memfd, 0);
+		if (fd < 0)
+			return -1;
+		ptr = mmap(NULL, len, PROT_READ, MAP_SHARED, fd, 0);
+		if (ptr == MAP_FAILED) {
+			(void)close(fd);
+			return -1;
+		}
+		(void)shim_memcpy(sw->dst, ptr, len);
+		(void)munmap(ptr, len);
+		(void)close(fd);
+		return 0;
+	default:
+		return -1;
+	}
+}
+
+/*
+ *  stress_vm_rw_sweep_child()
+ *	hold the source memory and memfd until killed
+ */
+static void NORETURN stress_vm_rw_sweep_child(void)
+{
+	stress_parent_died_alarm();
+	for (;;)
+		(void)pause();
+}
+
+/*
+ *  stress_vm_rw_sweep()
+ *	compare the bandwidth of copying another process's memory using
+ *	process_vm_readv with 1, 16 and 256 remote iovecs, pread of
+ *	/proc/pid/mem, memcpy from shared memory and pidfd_getfd + mmap
+ *	over a range of transfer sizes
+ */
+static int stress_vm_rw_sweep(stress_args_t *args, const size_t sz)
+{
+	stress_vm_rw_sweep_t sw;
+	stress_vm_rw_sweep_stat_t *stats;
+	const bool verify = !!(g_opt_flags & OPT_FLAGS_VERIFY);
+	bool supported[VM_RW_SWEEP_METHODS];
+	char path[PATH_MAX];
+	size_t i, method, n_sizes, idx;
+	int rc = EXIT_SUCCESS;
+
+	stats = (stress_vm_rw_sweep_stat_t *)calloc(VM_RW_SWEEP_METHODS * VM_RW_SWEEP_SIZES, sizeof(*stats));
+	if (!stats) {
+		pr_inf_skip("%s: cannot allocate statistics, skipping stressor\n", args->name);
+		return EXIT_NO_RESOURCE;
+	}
+	for (n_sizes = 0; n_sizes < VM_RW_SWEEP_SIZES; n_sizes++)
+		if (stress_vm_rw_sweep_sizes[n_sizes] > sz)
+			break;
+	if (n_sizes == 0)
+		n_sizes = 1;
+	sw.sz = stress_vm_rw_sweep_sizes[n_sizes - 1];
+
+	sw.memfd = shim_memfd_create("vm-rw-sweep", 0);
+	if (sw.memfd < 0) {
+		pr_inf_skip("%s: memfd_create failed, errno=%d (%s), skipping stressor\n",
+			args->name, errno, strerror(errno));
+		free(stats);
+		return EXIT_NO_RESOURCE;
+	}
+	if (ftruncate(sw.memfd, (off_t)sw.sz) < 0) {
+		pr_inf_skip("%s: ftruncate of %zu byte memfd failed, errno=%d (%s), skipping stressor\n",
+			args->name, sw.sz, errno, strerror(errno));
+		(void)close(sw.memfd);
+		free(stats);
+		return EXIT_NO_RESOURCE;
+	}
+	sw.src = (uint8_t *)mmap(NULL, sw.sz, PROT_READ | PROT_WRITE, MAP_SHARED, sw.memfd, 0);
+	sw.dst = (uint8_t *)stress_mmap_populate(NULL, sw.sz, PROT_READ | PROT_WRITE,
+				MAP_ANONYMOUS | MAP_PRIVATE, -1, 0);
+	if ((sw.src == MAP_FAILED) || (sw.dst == MAP_FAILED)) {
+		pr_inf_skip("%s: cannot mmap %zu byte buffers, errno=%d (%s), skipping stressor\n",
+			args->name, sw.sz, errno, strerror(errno));
+		rc = EXIT_NO_RESOURCE;
+		goto tidy_mmap;
+	}
+	stress_set_vma_anon_name(sw.dst, sw.sz, "vm-rw-sweep-dst");
+	for (i = 0; i < sw.sz; i++)
+		sw.src[i] = (uint8_t)(i * 31);
+
+	/* the child inherits the memfd and src mapping at the same address */
+again:
+	sw.pid = fork();
+	if (sw.pid < 0) {
+		if (stress_redo_fork(args, errno))
+			goto again;
+		pr_inf_skip("%s: fork failed, errno=%d (%s), skipping stressor\n",
+			args->name, errno, strerror(errno));
+		rc = EXIT_NO_RESOURCE;
+		goto tidy_mmap;
+	} else if (sw.pid == 0) {
+		stress_vm_rw_sweep_child();
+	}
+
+	(void)snprintf(path, sizeof(path), "/proc/%" PRIdMAX "/mem", (intmax_t)sw.pid);
+	sw.proc_fd = open(path, O_RDONLY);
+	sw.pidfd = shim_pidfd_open(sw.pid, 0);
+
+	/* probe each method once with the smallest size */
+	for (method = 0; method < VM_RW_SWEEP_METHODS; method++) {
+		supported[method] = (stress_vm_rw_sweep_copy(&sw, method, stress_vm_rw_sweep_sizes[0]) == 0);
+		if (!supported[method] && (args->instance == 0))
+			pr_inf("%s: %s not supported, errno=%d (%s)\n", args->name,
+				stress_vm_rw_sweep_methods[method], errno, strerror(errno));
+	}
+
+	stress_set_proc_state(args->name, STRESS_STATE_SYNC_WAIT);
+	stress_sync_start_wait(args);
+	stress_set_proc_state(args->name, STRESS_STATE_RUN);
+
+	do {
+		for (method = 0; method < VM_RW_SWEEP_METHODS; method++) {
+			if (!supported[method])
+				continue;
+			for (i = 0; (i < n_sizes) && stress_continue(args); i++) {
+				stress_vm_rw_sweep_stat_t *stat = &stats[(method * VM_RW_SWEEP_SIZES) + i];
+				const size_t len = stress_vm_rw_sweep_sizes[i];
+				const double t_start = stress_time_now();
+				double t_now;
+				size_t count = 0;
+
+				do {
+					if (UNLIKELY(stress_vm_rw_sweep_copy(&sw, method, len) < 0)) {
+						pr_fail("%s: %s copy of %zu bytes failed, errno=%d (%s)\n",
+							args->name, stress_vm_rw_sweep_methods[method],
+							len, errno, strerror(errno));
+						rc = EXIT_FAILURE;
+						goto done;
+					}
+					count++;
+					t_now = stress_time_now();
+				} while (t_now - t_start < VM_RW_SWEEP_SLICE);
+				stat->bytes += (double)count * (double)len;
+				stat->duration += t_now - t_start;
+
+				if (UNLIKELY(verify)) {
+					size_t j;
+
+					for (j = 0; j < len; j += args->page_size) {
+						if (UNLIKELY(sw.dst[j] != (uint8_t)(j * 31))) {
+							pr_fail("%s: %s copy at offset %zu: got 0x%2.2x, expected 0x%2.2x\n",
+								args->name, stress_vm_rw_sweep_methods[method],
+								j, sw.dst[j], (uint8_t)(j * 31));
+							rc = EXIT_FAILURE;
+							goto done;
+						}
+					}
+					(void)shim_memset(sw.dst, 0, len);
+				}
+			}
+		}
+		stress_bogo_inc(args);
+	} while (stress_continue(args));
+done:
+	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
+
+	if (args->instance == 0)
+		pr_inf("%s: %-14s %10s %12s\n", args->name, "method", "size", "GB/sec");
+	for (idx = 0, method = 0; method < VM_RW_SWEEP_METHODS; method++) {
+		for (i = 0; i < n_sizes; i++) {
+			const stress_vm_rw_sweep_stat_t *stat = &stats[(method * VM_RW_SWEEP_SIZES) + i];
+			const double rate = (stat->duration > 0.0) ? stat->bytes / (stat->duration * (double)GB) : 0.0;
+			char desc[64], size_str[32];
+
+			if (stat->duration <= 0.0)
+				continue;
+			(void)stress_uint64_to_str(size_str, sizeof(size_str),
+				(uint64_t)stress_vm_rw_sweep_sizes[i]);
+			if (args->instance == 0)
+				pr_inf("%s: %-14s %10s %12.3f\n", args->name,
+					stress_vm_rw_sweep_methods[method], size_str, rate);
+			if ((i != 0) && (i != n_sizes - 1))
+				continue;
+			(void)snprintf(desc, sizeof(desc), "%s %s GB per sec",
+				stress_vm_rw_sweep_methods[method], size_str);
+			stress_metrics_set(args, idx++, desc, rate, STRESS_METRIC_HARMONIC_MEAN);
+		}
+	}
+
+	if (sw.pidfd >= 0)
+		(void)close(sw.pidfd);
+	if (sw.proc_fd >= 0)
+		(void)close(sw.proc_fd);
+	(void)stress_kill_pid_wait(sw.pid, NULL);
+tidy_mmap:
+	if (sw.dst != MAP_FAILED)
+		(void)munmap((void *)sw.dst, sw.sz);
+	if (sw.src != MAP_FAILED)
+		(void)munmap((void *)sw.src, sw.sz);
+	(void)close(sw.memfd);
+	free(stats);
+
+	return rc;
+}
+
 /*
  *  stress_vm_rw
  *	stress vm_read_v/vm_write_v
@@ -365,6 +647,7 @@ static int stress_vm_rw(stress_args_t *args)
 	uint8_t stack[64*1024];
 	uint8_t *stack_top = (uint8_t *)stress_get_stack_top((void *)stack, STACK_SIZE);
 	size_t vm_rw_bytes = DEFAULT_VM_RW_BYTES;
+	bool vm_rw_sweep = false;
 	int rc;
 
 	if (!stress_get_setting("vm-rw-bytes", &vm_rw_bytes)) {
@@ -382,6 +665,10 @@ static int stress_vm_rw(stress_args_t *args)
 	ctxt.sz = vm_rw_bytes & ~(args->page_size - 1);
 	ctxt.iov_count = (ctxt.sz + CHUNK_SIZE - 1) / CHUNK_SIZE;
 
+	(void)stress_get_setting("vm-rw-sweep", &vm_rw_sweep);
+	if (vm_rw_sweep)
+		return stress_vm_rw_sweep(args, ctxt.sz);
+
 	if (pipe(ctxt.pipe_wr) < 0) {
 		pr_fail("%s: pipe failed, errno=%d (%s)\n",
 			args->name, errno, strerror(errno));
@@ -426,6 +713,7 @@ const stressor_info_t stress_vm_rw_info = {
 	.class = CLASS_VM | CLASS_MEMORY | CLASS_OS,
 	.opts = opts,
 	.verify = VERIFY_OPTIONAL,
+	.metrics_max = VM_RW_SWEEP_METHODS * 2,
 	.help = help
 };
 #else
@@ -203,6 +203,7 @@ const stressor_info_t stress_vm_splice_info = {
 	.class = CLASS_VM | CLASS_PIPE_IO | CLASS_OS,
 	.opts = opts,
 	.verify = VERIFY_ALWAYS,
+	.metrics_max = 2,
 	.help = help
 };
 #else
@@ -25,9 +25,11 @@
 #include "core-target-clones.h"
 #include "core-madvise.h"
 #include "core-mincore.h"
+#include "core-mmap.h"
 #include "core-nt-load.h"
 #include "core-nt-store.h"
 #include "core-numa.h"
+#include "core-pthread.h"
 #include "core-out-of-memory.h"
 #include "core-pragma.h"
 #include "core-vecmath.h"
@@ -36,6 +38,18 @@
 #define MAX_VM_BYTES		(MAX_MEM_LIMIT)
 #define DEFAULT_VM_BYTES	(256 * MB)
 
+/*
+ *  --vm-threads needs per thread mwc and vm method state
+ */
+#if defined(HAVE_LIB_PTHREAD) &&	\
+    defined(HAVE_STRESS_THREAD_LOCAL)
+#define STRESS_VM_THREADS	(1)
+#endif
+
+#define MIN_VM_THREADS		(1)
+#define MAX_VM_THREADS		(1024)
+#define DEFAULT_VM_THREADS	(1)
+
 #define MIN_VM_HANG		(0)
 #define MAX_VM_HANG		(3600)
 #define DEFAULT_VM_HANG		(~0ULL)
@@ -72,6 +86,7 @@ typedef struct {
 #if defined(HAVE_LINUX_MEMPOLICY_H)
 	stress_numa_mask_t *numa_mask;
 #endif
+	uint32_t vm_threads;
 	bool vm_numa;
 } stress_vm_context_t;
 
@@ -90,6 +105,7 @@ static const stress_help_t help[] = {
 #if defined(MAP_POPULATE)
 	{ NULL,	 "vm-populate",	 "populate (prefault) page tables for a mapping" },
 #endif
+	{ NULL,	 "vm-threads N", "split the mapping into N stripes, each stressed by a thread" },
 	{ NULL,	 NULL,		 NULL }
 };
 
@@ -755,7 +771,7 @@ static size_t TARGET_CLONES OPTIMIZE3 stress_vm_gray(
 	stress_args_t *args,
 	const uint64_t max_ops)
 {
-	static uint8_t val = 0;
+	static STRESS_THREAD_LOCAL uint8_t val = 0;
 	register uint8_t v;
 	register uint8_t *ptr;
 	register size_t bit_errors = 0;
@@ -840,7 +856,7 @@ static size_t TARGET_CLONES stress_vm_grayflip(
 	stress_args_t *args,
 	const uint64_t max_ops)
 {
-	static uint8_t val = 0;
+	static STRESS_THREAD_LOCAL uint8_t val = 0;
 	uint8_t v;
 	register uint8_t *ptr;
 	size_t bit_errors = 0;
@@ -919,7 +935,7 @@ static size_t TARGET_CLONES stress_vm_incdec(
 	stress_args_t *args,
 	const uint64_t max_ops)
 {
-	static uint8_t val = 0;
+	static STRESS_THREAD_LOCAL uint8_t val = 0;
 	register uint8_t *ptr;
 	size_t bit_errors = 0;
 	register uint64_t c = stress_bogo_get(args);
@@ -967,7 +983,7 @@ static size_t TARGET_CLONES stress_vm_prime_incdec(
 	stress_args_t *args,
 	const uint64_t max_ops)
 {
-	static uint8_t val = 0;
+	static STRESS_THREAD_LOCAL uint8_t val = 0;
 	register uint8_t *ptr = buf;
 	size_t bit_errors = 0, i;
 	const uint64_t prime = stress_get_prime64(sz + 4096);
@@ -1654,7 +1670,7 @@ static size_t TARGET_CLONES stress_vm_inc_nybble(
 	stress_args_t *args,
 	const uint64_t max_ops)
 {
-	static uint8_t val = 0;
+	static STRESS_THREAD_LOCAL uint8_t val = 0;
 	register uint8_t *ptr;
 	size_t bit_errors = 0;
 	register uint64_t c = stress_bogo_get(args);
@@ -1828,7 +1844,7 @@ static size_t TARGET_CLONES stress_vm_prime_zero(
 	register uint64_t c = stress_bogo_get(args);
 	register uint8_t i = 0;
 	register const size_t prime = 61; /* prime less than cache line size */
-	static size_t offset = 0;
+	static STRESS_THREAD_LOCAL size_t offset = 0;
 	register uint8_t *ptr;
 
 #if SIZE_MAX > UINT32_MAX
@@ -1892,7 +1908,7 @@ static size_t TARGET_CLONES stress_vm_prime_one(
 	uint64_t c = stress_bogo_get(args);
 	register uint8_t i = 0;
 	register const size_t prime = 61; /* prime less than cache line size */
-	static size_t offset = 0;
+	static STRESS_THREAD_LOCAL size_t offset = 0;
 	register uint8_t *ptr;
 
 #if SIZE_MAX > UINT32_MAX
@@ -1956,7 +1972,7 @@ static size_t TARGET_CLONES stress_vm_prime_gray_zero(
 	register uint64_t c = stress_bogo_get(args);
 	register uint8_t i = 0;
 	register const size_t prime = 61; /* prime less than cache line size */
-	static size_t offset = 0;
+	static STRESS_THREAD_LOCAL size_t offset = 0;
 	register uint8_t *ptr;
 
 #if SIZE_MAX > UINT32_MAX
@@ -2020,7 +2036,7 @@ static size_t TARGET_CLONES stress_vm_prime_gray_one(
 	register uint64_t c = stress_bogo_get(args);
 	register uint8_t i = 0;
 	register const size_t prime = 61; /* prime less than cache line size */
-	static size_t offset = 0;
+	static STRESS_THREAD_LOCAL size_t offset = 0;
 	register uint8_t *ptr;
 
 #if SIZE_MAX > UINT32_MAX
@@ -2078,7 +2094,7 @@ static size_t OPTIMIZE3 TARGET_CLONES stress_vm_write64(
 	stress_args_t *args,
 	const uint64_t max_ops)
 {
-	static uint64_t val;
+	static STRESS_THREAD_LOCAL uint64_t val;
 	register uint64_t *ptr = (uint64_t *)buf;
 	register const uint64_t v = val;
 	register size_t i = 0;
@@ -2327,7 +2343,7 @@ static size_t TARGET_CLONES stress_vm_write1024v(
 
 	stress_vint8w1024_t *ptr = (stress_vint8w1024_t *)buf;
 	stress_vint8w1024_t v;
-	static uint64_t val = 0;
+	static STRESS_THREAD_LOCAL uint64_t val = 0;
 	uint64x16_t *vptr = (uint64x16_t *)&v;
 	register size_t i = 0;
 	register const size_t n = sz / sizeof(*ptr);
@@ -2380,7 +2396,7 @@ static size_t TARGET_CLONES stress_vm_rowhammer(
 {
 	size_t bit_errors = 0;
 	uint32_t *buf32 = (uint32_t *)buf;
-	static uint32_t val = 0xff5a00a5;
+	static STRESS_THREAD_LOCAL uint32_t val = 0xff5a00a5;
 	register size_t j;
 	register volatile uint32_t *addr0, *addr1;
 	register size_t errors = 0;
@@ -2797,7 +2813,7 @@ static size_t TARGET_CLONES stress_vm_cache_lines(
 	size_t bit_errors = 0;
 	register uint64_t c = stress_bogo_get(args);
 	uint8_t i;
-	static size_t offset = 0;
+	static STRESS_THREAD_LOCAL size_t offset = 0;
 
 	for (i = 0, ptr = (uint8_t *)buf + offset; ptr < (uint8_t *)buf_end; ptr += stress_vm_cache_line_size) {
 		*ptr = i++;
@@ -3322,7 +3338,8 @@ static const stress_vm_method_info_t vm_methods[] = {
 
 /*
  *  stress_vm_all()
- *	work through all vm stressors sequentially
+ *	dummy function, not called, stress_vm_method_next()
+ *	works through all the vm methods sequentially
  */
 static size_t stress_vm_all(
 	void *buf,
@@ -3330,17 +3347,153 @@ static size_t stress_vm_all(
 	const size_t sz,
 	stress_args_t *args,
 	const uint64_t max_ops)
+{
+	(void)buf;
+	(void)buf_end;
+	(void)sz;
+	(void)args;
+	(void)max_ops;
+
+	return 0;
+}
+
+/*
+ *  stress_vm_method_next()
+ *	return the index of the vm method to run next, the "all"
+ *	method works through all vm methods sequentially
+ */
+static size_t stress_vm_method_next(const stress_vm_context_t *context, stress_args_t *args)
 {
 	static size_t i = 1;
-	size_t bit_errors = 0;
+	size_t method = (size_t)(context->vm_method - vm_methods);
+
+	if (method == 0) {
+		method = i;
+		i++;
+		if (UNLIKELY(i >= SIZEOF_ARRAY(vm_methods)))
+			i = 1;
+#if defined(STRESS_RAPL)
+		stress_rapl_method(args, vm_methods[method].name);
+#else
+		(void)args;
+#endif
+	}
+	return method;
+}
+
+/*
+ *  stress_vm_stripe()
+ *	get the start and size of the page aligned stripe of buf
+ *	for thread, the last stripe takes the remainder of buf
+ */
+static void stress_vm_stripe(
+	uint8_t *buf,
+	const size_t buf_sz,
+	const uint32_t n_threads,
+	const uint32_t thread,
+	const size_t page_size,
+	uint8_t **stripe,
+	size_t *stripe_sz)
+{
+	const size_t sz = (buf_sz / n_threads) & ~(page_size - 1);
+
+	*stripe = buf + ((size_t)thread * sz);
+	*stripe_sz = (thread == n_threads - 1) ? buf_sz - ((size_t)thread * sz) : sz;
+}
 
-	bit_errors = vm_methods[i].func(buf, buf_end, sz, args, max_ops);
-	i++;
-	if (UNLIKELY(i >= SIZEOF_ARRAY(vm_methods)))
-		i = 1;
+#if defined(STRESS_VM_THREADS)
+/* --vm-threads per thread state */
+typedef struct {
+	stress_args_t args;		/* per thread copy of args */
+	stress_counter_info_t ci;	/* per thread bogo-op counter */
+	stress_vm_func func;		/* vm method to run */
+	void *buf;			/* start of stripe */
+	void *buf_end;			/* end of stripe */
+	size_t sz;			/* size of stripe */
+	uint64_t max_ops;		/* max ops for this thread */
+	size_t bit_errors;		/* bit errors found in stripe */
+	pthread_t pthread;		/* thread handle */
+	int ret;			/* pthread_create return */
+} stress_vm_thread_t;
+
+/*
+ *  stress_vm_thread()
+ *	exercise one stripe of the mapping, signals are blocked so
+ *	they are handled by the main thread
+ */
+static void *stress_vm_thread(void *arg)
+{
+	stress_vm_thread_t *thread = (stress_vm_thread_t *)arg;
+	sigset_t set;
+
+	(void)sigfillset(&set);
+	(void)pthread_sigmask(SIG_BLOCK, &set, NULL);
+	stress_mwc_reseed();
+
+	thread->bit_errors = thread->func(thread->buf, thread->buf_end,
+		thread->sz, &thread->args, thread->max_ops);
+	return &g_nowt;
+}
+
+/*
+ *  stress_vm_threads_run()
+ *	run func concurrently on each stripe of buf, one thread per
+ *	stripe. Each thread counts bogo-ops in its own counter and these
+ *	are added to the instance counter once all the threads have
+ *	completed. Returns the total number of bit errors found.
+ */
+static size_t stress_vm_threads_run(
+	stress_args_t *args,
+	stress_vm_thread_t *threads,
+	const uint32_t n_threads,
+	const stress_vm_func func,
+	uint8_t *buf,
+	const size_t buf_sz,
+	const uint64_t max_ops)
+{
+	const uint64_t c = stress_bogo_get(args);
+	uint64_t thread_max_ops = 0, ops = 0;
+	size_t bit_errors = 0;
+	uint32_t i;
+
+	if (max_ops)
+		thread_max_ops = (max_ops > c) ? ((max_ops - c) / n_threads) + 1 : 1;
+
+	for (i = 0; i < n_threads; i++) {
+		stress_vm_thread_t *thread = &threads[i];
+		uint8_t *stripe;
+		size_t stripe_sz;
+
+		stress_vm_stripe(buf, buf_sz, n_threads, i, args->page_size, &stripe, &stripe_sz);
+		(void)shim_memset(&thread->ci, 0, sizeof(thread->ci));
+		thread->args = *args;
+		thread->args.ci = &thread->ci;
+		thread->func = func;
+		thread->buf = (void *)stripe;
+		thread->buf_end = (void *)(stripe + stripe_sz);
+		thread->sz = stripe_sz;
+		thread->max_ops = thread_max_ops;
+		thread->bit_errors = 0;
+		thread->ret = pthread_create(&thread->pthread, NULL, stress_vm_thread, (void *)thread);
+		/* cannot create thread, exercise the stripe in this thread */
+		if (thread->ret)
+			thread->bit_errors = func(thread->buf, thread->buf_end,
+				thread->sz, &thread->args, thread->max_ops);
+	}
+
+	for (i = 0; i < n_threads; i++) {
+		stress_vm_thread_t *thread = &threads[i];
+
+		if (!thread->ret)
+			(void)pthread_join(thread->pthread, NULL);
+		bit_errors += thread->bit_errors;
+		ops += thread->ci.counter;
+	}
+	stress_bogo_add(args, ops);
 
 	return bit_errors;
 }
+#endif
 
 #if defined(MAP_LOCKED) ||	\
     defined(MAP_POPULATE)
@@ -3364,12 +3517,24 @@ static int stress_vm_child(stress_args_t *args, void *ctxt)
 	size_t vm_madvise = 0;
 	int advice = -1;
 	int rc = EXIT_SUCCESS;
-	size_t buf_sz;
+	size_t buf_sz, mapped_sz = 0;
 	size_t vm_bytes = DEFAULT_VM_BYTES;
 	const size_t page_size = args->page_size;
+#if defined(HAVE_MPROTECT) &&	\
+    defined(PROT_NONE)
+	const size_t guard_sz = page_size;
+#else
+	const size_t guard_sz = 0;
+#endif
 	bool vm_keep = false;
 	stress_vm_context_t *context = (stress_vm_context_t *)ctxt;
-	const stress_vm_func func = context->vm_method->func;
+	uint32_t n_threads = context->vm_threads;
+	double method_bytes[SIZEOF_ARRAY(vm_methods)];
+	double method_duration[SIZEOF_ARRAY(vm_methods)];
+	size_t i;
+#if defined(STRESS_VM_THREADS)
+	stress_vm_thread_t *threads = NULL;
+#endif
 
 	stress_catch_sigill();
 
@@ -3397,6 +3562,31 @@ static int stress_vm_child(stress_args_t *args, void *ctxt)
 	if (stress_get_setting("vm-madvise", &vm_madvise))
 		advice = vm_madvise_info[vm_madvise].advice;
 
+	(void)shim_memset(method_bytes, 0, sizeof(method_bytes));
+	(void)shim_memset(method_duration, 0, sizeof(method_duration));
+
+	/* each thread needs at least a page sized stripe */
+	if ((size_t)n_threads > buf_sz / page_size)
+		n_threads = (uint32_t)(buf_sz / page_size);
+	if (n_threads < 1)
+		n_threads = 1;
+#if defined(STRESS_VM_THREADS)
+	if (n_threads > 1) {
+		threads = (stress_vm_thread_t *)calloc((size_t)n_threads, sizeof(*threads));
+		if (!threads) {
+			pr_inf("%s: cannot allocate %" PRIu32 " thread states, "
+				"using 1 thread\n", args->name, n_threads);
+			n_threads = 1;
+		}
+	}
+#else
+	n_threads = 1;
+#endif
+	if ((args->instance == 0) && (n_threads != context->vm_threads))
+		pr_inf("%s: using %" PRIu32 " threads instead of %" PRIu32
+			" requested threads\n", args->name, n_threads,
+			context->vm_threads);
+
 	do {
 		if (!vm_keep || (buf == NULL)) {
 			if (UNLIKELY(!stress_continue_flag()))
@@ -3405,20 +3595,15 @@ static int stress_vm_child(stress_args_t *args, void *ctxt)
 				buf = MAP_FAILED;
 				errno = ENOMEM;
 			} else {
-#if defined(HAVE_MPROTECT) &&	\
-    defined(PROT_NONE)
 				/*
 				 *   allocate buffer + one trailing page
 				 *   so the last page can be marked PROT_NONE later
 				 *   to catch any buffer over-runs.
 				 */
-				buf = (uint8_t *)mmap(NULL, buf_sz + page_size,
-#else
-				buf = (uint8_t *)mmap(NULL, buf_sz,
-#endif
+				buf = (uint8_t *)stress_mmap_hugetlb(args, buf_sz + guard_sz,
 					PROT_READ | PROT_WRITE,
 					MAP_PRIVATE | MAP_ANONYMOUS |
-					vm_flags, -1, 0);
+					vm_flags, false, &mapped_sz);
 			}
 			if (UNLIKELY(buf == MAP_FAILED)) {
 				buf = NULL;
@@ -3452,14 +3637,50 @@ static int stress_vm_child(stress_args_t *args, void *ctxt)
 			else
 				(void)shim_madvise(buf, buf_sz, advice);
 #if defined(HAVE_LINUX_MEMPOLICY_H)
-			if (UNLIKELY(context->vm_numa))
-				stress_numa_randomize_pages(context->numa_mask, buf, page_size, buf_sz);
+			if (UNLIKELY(context->vm_numa)) {
+				if (n_threads > 1) {
+					uint32_t t;
+
+					/* interleave the stripes across the NUMA nodes */
+					for (t = 0; t < n_threads; t++) {
+						uint8_t *stripe;
+						size_t stripe_sz;
+
+						stress_vm_stripe((uint8_t *)buf, buf_sz, n_threads, t,
+							page_size, &stripe, &stripe_sz);
+						(void)stress_numa_bind_node(context->numa_mask,
+							(void *)stripe, stripe_sz, (unsigned long int)t);
+					}
+				} else {
+					stress_numa_randomize_pages(context->numa_mask, buf, page_size, buf_sz);
+				}
+			}
 #endif
 		}
 
 		no_mem_retries = 0;
 		(void)stress_mincore_touch_pages(buf, buf_sz);
-		*(context->bit_error_count) += func(buf, buf_end, buf_sz, args, max_ops);
+		{
+			const size_t method = stress_vm_method_next(context, args);
+			const stress_vm_func func = vm_methods[method].func;
+			const double t = stress_time_now();
+			double duration;
+
+#if defined(STRESS_VM_THREADS)
+			if (n_threads > 1)
+				*(context->bit_error_count) += stress_vm_threads_run(args,
+					threads, n_threads, func, (uint8_t *)buf, buf_sz, max_ops);
+			else
+#endif
+				*(context->bit_error_count) += func(buf, buf_end, buf_sz, args, max_ops);
+
+			/* ignore passes cut short by the end of the run unless there are none */
+			duration = stress_time_now() - t;
+			if (stress_continue_flag() || (method_duration[method] <= 0.0)) {
+				method_bytes[method] += (double)buf_sz;
+				method_duration[method] += duration;
+			}
+		}
 
 		if (vm_hang == 0) {
 			while (stress_continue_vm(args)) {
@@ -3471,22 +3692,26 @@ static int stress_vm_child(stress_args_t *args, void *ctxt)
 
 		if (!vm_keep) {
 			(void)stress_madvise_random(buf, buf_sz);
-#if defined(HAVE_MPROTECT) &&	\
-    defined(PROT_NONE)
-			(void)stress_munmap_retry_enomem(buf, buf_sz + page_size);
-#else
-			(void)stress_munmap_retry_enomem(buf, buf_sz);
-#endif
+			(void)stress_munmap_retry_enomem(buf, mapped_sz);
 		}
 	} while (stress_continue_vm(args));
 
-	if (vm_keep && (buf != NULL)) {
-#if defined(HAVE_MPROTECT) && 	\
-    defined(PROT_NONE)
-		(void)stress_munmap_retry_enomem(buf, buf_sz + page_size);
-#else
-		(void)stress_munmap_retry_enomem(buf, buf_sz);
+	if (vm_keep && (buf != NULL))
+		(void)stress_munmap_retry_enomem(buf, mapped_sz);
+#if defined(STRESS_VM_THREADS)
+	free(threads);
 #endif
+
+	for (i = 1; i < SIZEOF_ARRAY(vm_methods); i++) {
+		char description[64];
+
+		if (method_duration[i] <= 0.0)
+			continue;
+		(void)snprintf(description, sizeof(description),
+			"MB per sec %s rate", vm_methods[i].name);
+		stress_metrics_set(args, i - 1, description,
+			method_bytes[i] / (method_duration[i] * (double)MB),
+			STRESS_METRIC_HARMONIC_MEAN);
 	}
 
 	return rc;
@@ -3562,6 +3787,8 @@ static int stress_vm(stress_args_t *args)
 
 	(void)stress_get_setting("vm-method", &vm_method);
 	context.vm_method = &vm_methods[vm_method];
+	context.vm_threads = DEFAULT_VM_THREADS;
+	(void)stress_get_setting("vm-threads", &context.vm_threads);
 
 	if (args->instance == 0)
 		pr_dbg("%s: using method '%s'\n", args->name, context.vm_method->name);
@@ -3640,6 +3867,7 @@ static const stress_opt_t opts[] = {
 	{ OPT_vm_method,   "vm-method",   TYPE_ID_SIZE_T_METHOD, 0, 0, stress_vm_method },
 	{ OPT_vm_numa,	   "vm-numa",	  TYPE_ID_BOOL, 0, 1, NULL },
 	{ OPT_vm_populate, "vm-populate", TYPE_ID_BOOL, 0, 1, NULL },
+	{ OPT_vm_threads,  "vm-threads",  TYPE_ID_UINT32, MIN_VM_THREADS, MAX_VM_THREADS, NULL },
 	END_OPT,
 };
 
@@ -3648,5 +3876,6 @@ const stressor_info_t stress_vm_info = {
 	.class = CLASS_VM | CLASS_MEMORY | CLASS_OS,
 	.opts = opts,
 	.verify = VERIFY_OPTIONAL,
+	.metrics_max = SIZEOF_ARRAY(vm_methods) - 1,
 	.help = help
 };
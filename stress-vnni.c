@@ -21,6 +21,7 @@
 #include "core-bitops.h"
 #include "core-builtin.h"
 #include "core-cpu.h"
+#include "core-perf.h"
 #include "core-put.h"
 #include "core-pragma.h"
 #include "core-target-clones.h"
@@ -38,6 +39,7 @@ static const stress_help_t help[] = {
 	{ NULL,	"vnni-intrinsic",	"use x86 intrinsic vnni methods, disable generic methods" },
 	{ NULL,	"vnni-method M",	"specify specific vnni methods to exercise" },
 	{ NULL,	"vnni-ops N",		"stop after N vnni bogo operations" },
+	{ NULL,	"vnni-width-report",	"report effective GHz and ops per cycle of each vector width" },
 	{ NULL,	NULL,		 NULL }
 };
 
@@ -91,6 +93,16 @@ typedef struct {
 	double				 duration;		/* usage duration */
 } stress_vnni_method_t;
 
+/* per method --vnni-width-report totals */
+typedef struct {
+	double count;		/* method calls */
+	double duration;	/* time running method */
+	double cycles;		/* core cycles running method */
+	double ref_cycles;	/* reference cycles running method */
+} stress_vnni_width_t;
+
+#define VNNI_WIDTH_CELL		(0.25)	/* seconds per method per round */
+
 static bool vnni_checksum_okay;
 
 static uint32_t OPTIMIZE3 stress_vnni_checksum(void)
@@ -498,6 +510,119 @@ static void stress_vnni_all(stress_args_t *args)
 	}
 }
 
+/*
+ *  stress_vnni_width_pin()
+ *	pin to the current CPU so the cycle counters and the frequency
+ *	are for one core for the entire width report
+ */
+static void stress_vnni_width_pin(stress_args_t *args)
+{
+#if defined(HAVE_SCHED_SETAFFINITY) &&	\
+    defined(HAVE_CPU_SET_T)
+	cpu_set_t mask;
+	const unsigned int cpu = stress_get_cpu();
+
+	CPU_ZERO(&mask);
+	CPU_SET((int)cpu, &mask);
+	if ((sched_setaffinity(0, sizeof(mask), &mask) < 0) && (args->instance == 0))
+		pr_inf("%s: cannot pin to CPU %u, errno=%d (%s), "
+			"widths may run on different CPUs\n",
+			args->name, cpu, errno, strerror(errno));
+#else
+	(void)args;
+#endif
+}
+
+/*
+ *  stress_vnni_width_report()
+ *	run each capable method for VNNI_WIDTH_CELL seconds in turn on
+ *	a pinned CPU, counting core and reference cycles (APERF/MPERF
+ *	equivalents) per method to get the effective clock of each width
+ */
+static void stress_vnni_width_report(stress_args_t *args, const size_t vnni_method)
+{
+	stress_vnni_width_t *widths;
+	size_t i, j;
+#if defined(STRESS_PERF_STATS)
+	stress_perf_cycles_t pc;
+	const bool have_cycles = (stress_perf_cycles_open(&pc) == 0);
+#else
+	const bool have_cycles = false;
+#endif
+
+	widths = (stress_vnni_width_t *)calloc(SIZEOF_ARRAY(stress_vnni_methods), sizeof(*widths));
+	if (!widths) {
+		pr_inf("%s: cannot allocate width report data, running normal methods\n", args->name);
+		return;
+	}
+	if (!have_cycles && (args->instance == 0))
+		pr_inf("%s: cannot open perf cycle counters, effective GHz and "
+			"ops per cycle will not be reported\n", args->name);
+
+	stress_vnni_width_pin(args);
+
+	do {
+		for (i = 1; (i < SIZEOF_ARRAY(stress_vnni_methods)) && stress_continue(args); i++) {
+			const stress_vnni_method_t *method = &stress_vnni_methods[i];
+			uint64_t c1 = 0, r1 = 0, c2 = 0, r2 = 0;
+			double count, duration, t_end;
+
+			if (!method->vnni_capable ||
+			    (vnni_intrinsic && !method->vnni_intrinsic) ||
+			    (vnni_method && (vnni_method != i)))
+				continue;
+
+			count = method->count;
+			duration = method->duration;
+#if defined(STRESS_PERF_STATS)
+			if (have_cycles)
+				(void)stress_perf_cycles_read(&pc, &c1, &r1);
+#endif
+			t_end = stress_time_now() + VNNI_WIDTH_CELL;
+			do {
+				stress_vnni_exercise(args, i);
+			} while (vnni_checksum_okay && (stress_time_now() < t_end) && stress_continue(args));
+#if defined(STRESS_PERF_STATS)
+			if (have_cycles)
+				(void)stress_perf_cycles_read(&pc, &c2, &r2);
+#endif
+			widths[i].count += method->count - count;
+			widths[i].duration += method->duration - duration;
+			widths[i].cycles += (double)(c2 - c1);
+			widths[i].ref_cycles += (double)(r2 - r1);
+			if (!vnni_checksum_okay)
+				break;
+		}
+	} while (vnni_checksum_okay && stress_continue(args));
+
+#if defined(STRESS_PERF_STATS)
+	if (have_cycles)
+		stress_perf_cycles_close(&pc);
+#endif
+
+	/* metrics follow the ops per sec metrics of each method */
+	for (i = 1, j = SIZEOF_ARRAY(stress_vnni_methods); i < SIZEOF_ARRAY(stress_vnni_methods); i++) {
+		const stress_vnni_width_t *width = &widths[i];
+		char buf[64];
+
+		if ((width->duration <= 0.0) || (width->cycles <= 0.0))
+			continue;
+		(void)snprintf(buf, sizeof(buf), "%s effective GHz", stress_vnni_methods[i].name);
+		stress_metrics_set(args, j++, buf,
+			width->cycles / (width->duration * STRESS_DBL_NANOSECOND),
+			STRESS_METRIC_GEOMETRIC_MEAN);
+		(void)snprintf(buf, sizeof(buf), "%s ops per cycle", stress_vnni_methods[i].name);
+		stress_metrics_set(args, j++, buf,
+			width->count / width->cycles, STRESS_METRIC_GEOMETRIC_MEAN);
+		if (width->ref_cycles > 0.0) {
+			(void)snprintf(buf, sizeof(buf), "%s aperf mperf ratio", stress_vnni_methods[i].name);
+			stress_metrics_set(args, j++, buf,
+				width->cycles / width->ref_cycles, STRESS_METRIC_GEOMETRIC_MEAN);
+		}
+	}
+	free(widths);
+}
+
 /*
  *  stress_vnni()
  *	stress intel VNNI ops
@@ -505,6 +630,7 @@ static void stress_vnni_all(stress_args_t *args)
 static int stress_vnni(stress_args_t *args)
 {
 	size_t i, j, vnni_method = 0, intrinsic_count = 0;
+	bool vnni_width_report = false;
 
 	stress_catch_sigill();
 
@@ -519,6 +645,7 @@ static int stress_vnni(stress_args_t *args)
 	vnni_intrinsic = false;
 	(void)stress_get_setting("vnni-method", &vnni_method);
 	(void)stress_get_setting("vnni-intrinsic", &vnni_intrinsic);
+	(void)stress_get_setting("vnni-width-report", &vnni_width_report);
 
 	avx_capable = false;
 	for (i = 0; i < SIZEOF_ARRAY(stress_vnni_methods); i++) {
@@ -556,13 +683,16 @@ static int stress_vnni(stress_args_t *args)
 	stress_sync_start_wait(args);
 	stress_set_proc_state(args->name, STRESS_STATE_RUN);
 
-	do {
+	if (vnni_width_report)
+		stress_vnni_width_report(args, vnni_method);
+
+	while (vnni_checksum_okay && stress_continue(args)) {
 		if (UNLIKELY(vnni_method)) {
 			stress_vnni_exercise(args, vnni_method);
 		} else {
 			stress_vnni_all(args);
 		}
-	} while (vnni_checksum_okay && stress_continue(args));
+	}
 
 	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
 
@@ -591,6 +721,7 @@ static const char *stress_vnni_method(const size_t i)
 static const stress_opt_t opts[] = {
 	{ OPT_vnni_intrinsic, "vnni-intrinsic", TYPE_ID_BOOL, 0, 1, NULL },
 	{ OPT_vnni_method,    "vnni-method",    TYPE_ID_SIZE_T_METHOD, 0, 0, stress_vnni_method },
+	{ OPT_vnni_width_report, "vnni-width-report", TYPE_ID_BOOL, 0, 1, NULL },
 	END_OPT,
 };
 
@@ -20,6 +20,9 @@
  */
 #include "stress-ng.h"
 #include "core-arch.h"
+#include "core-builtin.h"
+#include "core-put.h"
+#include "core-vecmath.h"
 
 #if defined(HAVE_BSD_WCHAR_H)
 #include <bsd/wchar.h>
@@ -37,8 +40,10 @@
 
 static const stress_help_t help[] = {
 	{ NULL,	"wcs N",	   "start N workers on lib C wide char string functions" },
+	{ NULL,	"wcs-hit P",	   "place --wcs-sweep search hits P percent into the string" },
 	{ NULL,	"wcs-method func", "specify the wide character string function to stress" },
 	{ NULL,	"wcs-ops N",	   "stop after N bogo wide character string operations" },
+	{ NULL,	"wcs-sweep",	   "measure GB per sec of wide string functions from 1 byte to 64K strings" },
 	{ NULL,	NULL,		   NULL }
 };
 
@@ -681,6 +686,328 @@ static size_t stress_wcs_all(stress_args_t *args, stress_wcs_args_t *info)
 	return 0;
 }
 
+#if defined(HAVE_WCSLEN) &&	\
+    defined(HAVE_WCSCHR) &&	\
+    defined(HAVE_WCSRCHR) &&	\
+    defined(HAVE_WCSCMP) &&	\
+    defined(HAVE_WCSCPY) &&	\
+    defined(HAVE_WCHAR) &&	\
+    !defined(STRESS_ARCH_M68K)
+#define HAVE_WCS_SWEEP
+
+/*
+ *  --wcs-sweep, sizes are in bytes so results line up with
+ *  --str-sweep, strings are bytes / sizeof(wchar_t) characters
+ */
+#define WCS_SWEEP_BYTES_MAX	(64 * KB)	/* longest string in bytes */
+#define WCS_SWEEP_PAD		(32)		/* alignment slack in wide chars */
+#define WCS_SWEEP_BATCH		(256 * KB)	/* bytes per timed batch */
+#define WCS_SWEEP_HIT_CHAR	(L'@')		/* never generated by stress_wcs_fill */
+#define WCS_SWEEP_MISS_CHAR	(L'$')		/* never generated by stress_wcs_fill */
+
+#if defined(HAVE_VECMATH) && \
+    ((defined(HAVE_COMPILER_GCC_OR_MUSL) && NEED_GNUC(4,8,4)) ||	\
+     (defined(HAVE_COMPILER_CLANG) && NEED_CLANG(14,0,0)))
+#define WCS_SWEEP_REF	(1)
+
+typedef wchar_t stress_wcs_vec_t __attribute__ ((vector_size (16), may_alias));
+typedef uint64_t stress_wcs_vec64_t __attribute__ ((vector_size (16)));
+#endif
+
+typedef enum {
+	WCS_SWEEP_WCSLEN,
+	WCS_SWEEP_WCSCHR,
+	WCS_SWEEP_WCSRCHR,
+	WCS_SWEEP_WCSCMP,
+	WCS_SWEEP_WCSCPY,
+	WCS_SWEEP_REF_WCSLEN,
+	WCS_SWEEP_REF_WCSCHR,
+	WCS_SWEEP_MAX,
+} stress_wcs_sweep_func_t;
+
+static const char * const wcs_sweep_names[WCS_SWEEP_MAX] = {
+	"wcslen",
+	"wcschr",
+	"wcsrchr",
+	"wcscmp",
+	"wcscpy",
+	"ref wcslen",
+	"ref wcschr",
+};
+
+static const size_t wcs_sweep_bytes[] = {
+	1, 16, 256, 4 * KB, WCS_SWEEP_BYTES_MAX
+};
+
+#define WCS_SWEEP_LENS	(SIZEOF_ARRAY(wcs_sweep_bytes))
+
+/* libc functions are called indirectly to defeat builtin expansion */
+static void * volatile wcs_sweep_libc[] = {
+	(void *)wcslen,
+	(void *)wcschr,
+	(void *)wcsrchr,
+	(void *)wcscmp,
+	(void *)wcscpy,
+};
+
+typedef struct {
+	double bytes;			/* bytes of string scanned */
+	double duration;		/* time spent scanning */
+} stress_wcs_sweep_stats_t;
+
+#if defined(WCS_SWEEP_REF)
+static inline bool ALWAYS_INLINE stress_wcs_vec_any(const stress_wcs_vec64_t v)
+{
+	return (v[0] | v[1]) != 0;
+}
+
+/*
+ *  stress_wcs_ref_wcslen()
+ *	wcslen using 16 byte vector compares once the pointer
+ *	is 16 byte aligned, so loads never cross a page boundary
+ */
+static size_t OPTIMIZE3 stress_wcs_ref_wcslen(const wchar_t *str)
+{
+	const wchar_t *ptr = str;
+	const stress_wcs_vec_t zero = { 0 };
+
+	while (((uintptr_t)ptr & (sizeof(stress_wcs_vec_t) - 1)) != 0) {
+		if (!*ptr)
+			return (size_t)(ptr - str);
+		ptr++;
+	}
+	while (!stress_wcs_vec_any((stress_wcs_vec64_t)(*(const stress_wcs_vec_t *)ptr == zero)))
+		ptr += sizeof(stress_wcs_vec_t) / sizeof(wchar_t);
+	while (*ptr)
+		ptr++;
+	return (size_t)(ptr - str);
+}
+
+/*
+ *  stress_wcs_ref_wcschr()
+ *	wcschr, vector scan for either wc or the terminator
+ *	then a scalar scan of the matching block
+ */
+static wchar_t * OPTIMIZE3 stress_wcs_ref_wcschr(const wchar_t *str, const wchar_t wc)
+{
+	const wchar_t *ptr = str;
+	const stress_wcs_vec_t zero = { 0 };
+	const stress_wcs_vec_t chr = zero + wc;
+
+	while (((uintptr_t)ptr & (sizeof(stress_wcs_vec_t) - 1)) != 0) {
+		if (*ptr == wc)
+			return (wchar_t *)ptr;
+		if (!*ptr)
+			return NULL;
+		ptr++;
+	}
+	for (;;) {
+		const stress_wcs_vec_t v = *(const stress_wcs_vec_t *)ptr;
+
+		if (stress_wcs_vec_any((stress_wcs_vec64_t)((v == zero) | (v == chr))))
+			break;
+		ptr += sizeof(stress_wcs_vec_t) / sizeof(wchar_t);
+	}
+	for (;;) {
+		if (*ptr == wc)
+			return (wchar_t *)ptr;
+		if (!*ptr)
+			return NULL;
+		ptr++;
+	}
+}
+#endif
+
+/*
+ *  stress_wcs_sweep_run()
+ *	n calls of one wide string function on a len character
+ *	string, false if the results are not as expected
+ */
+static bool OPTIMIZE3 stress_wcs_sweep_run(
+	const stress_wcs_sweep_func_t func,
+	const wchar_t *str,
+	const wchar_t *cmp,
+	wchar_t *dst,
+	const size_t len,
+	const size_t hit,
+	const size_t n)
+{
+	typedef size_t (*test_wcslen_t)(const wchar_t *s);
+	typedef wchar_t *(*test_wcschr_t)(const wchar_t *wcs, wchar_t wc);
+	typedef int (*test_wcscmp_t)(const wchar_t *s1, const wchar_t *s2);
+	typedef wchar_t *(*test_wcscpy_t)(wchar_t *dest, const wchar_t *src);
+
+	register size_t i;
+	uintptr_t sum = 0;
+	bool ok = true;
+
+	switch (func) {
+	case WCS_SWEEP_WCSLEN: {
+			const test_wcslen_t fn = (test_wcslen_t)wcs_sweep_libc[WCS_SWEEP_WCSLEN];
+
+			for (i = 0; i < n; i++)
+				sum += fn(str);
+			ok = (sum == len * n);
+		}
+		break;
+	case WCS_SWEEP_WCSCHR:
+	case WCS_SWEEP_WCSRCHR: {
+			const test_wcschr_t fn = (test_wcschr_t)wcs_sweep_libc[func];
+
+			for (i = 0; i < n; i++)
+				sum += (uintptr_t)fn(str, WCS_SWEEP_HIT_CHAR);
+			ok = (sum == (uintptr_t)(str + hit) * n);
+		}
+		break;
+	case WCS_SWEEP_WCSCMP: {
+			const test_wcscmp_t fn = (test_wcscmp_t)wcs_sweep_libc[WCS_SWEEP_WCSCMP];
+
+			for (i = 0; i < n; i++)
+				sum += (fn(str, cmp) != 0);
+			ok = (sum == n);
+		}
+		break;
+	case WCS_SWEEP_WCSCPY: {
+			const test_wcscpy_t fn = (test_wcscpy_t)wcs_sweep_libc[WCS_SWEEP_WCSCPY];
+
+			for (i = 0; i < n; i++)
+				sum += (uintptr_t)fn(dst, str);
+			ok = (sum == (uintptr_t)dst * n) &&
+			     !memcmp(dst, str, (len + 1) * sizeof(wchar_t));
+		}
+		break;
+#if defined(WCS_SWEEP_REF)
+	case WCS_SWEEP_REF_WCSLEN:
+		for (i = 0; i < n; i++)
+			sum += stress_wcs_ref_wcslen(str);
+		ok = (sum == len * n);
+		break;
+	case WCS_SWEEP_REF_WCSCHR:
+		for (i = 0; i < n; i++)
+			sum += (uintptr_t)stress_wcs_ref_wcschr(str, WCS_SWEEP_HIT_CHAR);
+		ok = (sum == (uintptr_t)(str + hit) * n);
+		break;
+#endif
+	default:
+		break;
+	}
+	stress_uint64_put((uint64_t)sum);
+	return ok;
+}
+
+/*
+ *  stress_wcs_sweep()
+ *	GB per sec of wide string functions for 1 byte to 64K byte
+ *	strings, starting on and one wide character off a 64 byte
+ *	boundary, searches hit and wcscmp differs wcs_hit percent in
+ */
+static int stress_wcs_sweep(stress_args_t *args, const uint32_t wcs_hit)
+{
+	const size_t buf_len = (WCS_SWEEP_BYTES_MAX / sizeof(wchar_t)) + WCS_SWEEP_PAD;
+	const size_t buf_size = buf_len * sizeof(wchar_t);
+	stress_wcs_sweep_stats_t *stats;
+	wchar_t *buf, *cmp_buf, *dst_buf;
+	size_t l, align, f;
+	int rc = EXIT_SUCCESS;
+	const bool verify = !!(g_opt_flags & OPT_FLAGS_VERIFY);
+
+	stats = (stress_wcs_sweep_stats_t *)calloc(WCS_SWEEP_MAX * WCS_SWEEP_LENS * 2, sizeof(*stats));
+	buf = (wchar_t *)stress_mmap_populate(NULL, buf_size * 3, PROT_READ | PROT_WRITE,
+		MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (!stats || (buf == MAP_FAILED)) {
+		pr_inf_skip("%s: cannot allocate wide string sweep buffers, skipping stressor\n", args->name);
+		if (buf != MAP_FAILED)
+			(void)munmap((void *)buf, buf_size * 3);
+		free(stats);
+		return EXIT_NO_RESOURCE;
+	}
+	stress_set_vma_anon_name(buf, buf_size * 3, "wcs-sweep");
+	cmp_buf = buf + buf_len;
+	dst_buf = cmp_buf + buf_len;
+
+	stress_set_proc_state(args->name, STRESS_STATE_SYNC_WAIT);
+	stress_sync_start_wait(args);
+	stress_set_proc_state(args->name, STRESS_STATE_RUN);
+
+	do {
+		for (l = 0; l < WCS_SWEEP_LENS; l++) {
+			const size_t len = STRESS_MAXIMUM(wcs_sweep_bytes[l] / sizeof(wchar_t), 1);
+			const size_t hit = ((len - 1) * wcs_hit) / 100;
+			const size_t n = STRESS_MAXIMUM(WCS_SWEEP_BATCH / (len * sizeof(wchar_t)), 1);
+
+			for (align = 0; align < 2; align++) {
+				wchar_t *str = buf + align;
+				wchar_t *cmp = cmp_buf + align;
+				wchar_t *dst = dst_buf + align;
+
+				stress_wcs_fill(str, len + 1);
+				str[hit] = WCS_SWEEP_HIT_CHAR;
+				(void)shim_memcpy(cmp, str, (len + 1) * sizeof(wchar_t));
+				cmp[hit] = WCS_SWEEP_MISS_CHAR;
+
+				for (f = 0; f < WCS_SWEEP_MAX; f++) {
+					stress_wcs_sweep_stats_t *s = &stats[((f * WCS_SWEEP_LENS) + l) * 2 + align];
+					double t;
+					size_t chars;
+					bool ok;
+
+#if !defined(WCS_SWEEP_REF)
+					if (f >= WCS_SWEEP_REF_WCSLEN)
+						break;
+#endif
+					t = stress_time_now();
+					ok = stress_wcs_sweep_run((stress_wcs_sweep_func_t)f, str, cmp,
+						dst, len, hit, n);
+					s->duration += stress_time_now() - t;
+
+					/* forward searches and wcscmp stop at the hit */
+					chars = ((f == WCS_SWEEP_WCSCHR) ||
+						 (f == WCS_SWEEP_WCSCMP) ||
+						 (f == WCS_SWEEP_REF_WCSCHR)) ? hit + 1 : len;
+					s->bytes += (double)(chars * sizeof(wchar_t)) * (double)n;
+					stress_bogo_inc(args);
+
+					if (UNLIKELY(verify && !ok)) {
+						pr_fail("%s: %s of a %zu character %saligned string returned an "
+							"unexpected result\n", args->name, wcs_sweep_names[f],
+							len, align ? "un" : "");
+						rc = EXIT_FAILURE;
+						goto done;
+					}
+					if (UNLIKELY(!stress_continue(args)))
+						goto done;
+				}
+			}
+		}
+	} while (stress_continue(args));
+done:
+	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
+
+	for (f = 0; f < WCS_SWEEP_MAX; f++) {
+		for (l = 0; l < WCS_SWEEP_LENS; l++) {
+			for (align = 0; align < 2; align++) {
+				const size_t idx = ((f * WCS_SWEEP_LENS) + l) * 2 + align;
+				const stress_wcs_sweep_stats_t *s = &stats[idx];
+				char msg[64];
+
+				if (s->duration <= 0.0)
+					continue;
+				(void)snprintf(msg, sizeof(msg), "%s %zuB %saligned GB per sec",
+					wcs_sweep_names[f], wcs_sweep_bytes[l], align ? "un" : "");
+				stress_metrics_set(args, idx, msg,
+					s->bytes / (s->duration * (double)GB),
+					STRESS_METRIC_HARMONIC_MEAN);
+			}
+		}
+	}
+
+	(void)munmap((void *)buf, buf_size * 3);
+	free(stats);
+
+	return rc;
+}
+#endif
+
 /*
  *  stress_wcs()
  *	stress CPU by doing wide character string ops
@@ -693,11 +1020,26 @@ static int stress_wcs(stress_args_t *args)
 	wchar_t strdst[STRDSTLEN];
 	stress_wcs_args_t info;
 	int metrics_count = 0;
+	bool wcs_sweep = false;
+	uint32_t wcs_hit = 100;
 
 	/* No wcs* functions available on this system? */
 	if (SIZEOF_ARRAY(wcs_methods) < 2)
 		return stress_unimplemented(args);
 
+	(void)stress_get_setting("wcs-sweep", &wcs_sweep);
+	(void)stress_get_setting("wcs-hit", &wcs_hit);
+	if (wcs_sweep) {
+#if defined(HAVE_WCS_SWEEP)
+		return stress_wcs_sweep(args, wcs_hit);
+#else
+		if (args->instance == 0)
+			pr_inf_skip("%s: --wcs-sweep requires wcslen, wcschr, wcsrchr, "
+				"wcscmp and wcscpy, skipping stressor\n", args->name);
+		return EXIT_NO_RESOURCE;
+#endif
+	}
+
 	(void)stress_get_setting("wcs-method", &wcs_method);
 	wcs_method_info = &wcs_methods[wcs_method];
 	info.libc_func = wcs_method_info->libc_func;
@@ -768,7 +1110,9 @@ static const char *stress_wcs_method(const size_t i)
 }
 
 static const stress_opt_t opts[] = {
+	{ OPT_wcs_hit,    "wcs-hit",    TYPE_ID_UINT32, 0, 100, NULL },
 	{ OPT_wcs_method, "wcs-method", TYPE_ID_SIZE_T_METHOD, 0, 0, stress_wcs_method },
+	{ OPT_wcs_sweep,  "wcs-sweep",  TYPE_ID_BOOL, 0, 1, NULL },
 	END_OPT,
 };
 
@@ -25,6 +25,7 @@
 #include "core-asm-generic.h"
 #include "core-cpu-cache.h"
 #include "core-builtin.h"
+#include "core-latency.h"
 #include "core-madvise.h"
 #include "core-pthread.h"
 #include "core-put.h"
@@ -47,12 +48,16 @@
 #define WORKLOAD_THREADED	(1)
 #endif
 
+/*
+ *  per quantum open-loop timings, all latencies are measured from
+ *  the intended start time so work delayed behind earlier late work
+ *  is not hidden (coordinated omission)
+ */
 typedef struct {
-#if defined(WORKLOAD_THREADED)
-	pthread_t pthread;
-#endif
-	int ret;
-} workload_thread_t;
+	stress_latency_hist_t delay;	/* actual start - intended start */
+	stress_latency_hist_t response;	/* completion - intended start */
+	uint64_t missed;		/* completions after the deadline */
+} stress_workload_lat_t;
 
 #if defined(WORKLOAD_THREADED)
 typedef struct {
@@ -60,9 +65,18 @@ typedef struct {
 	uint8_t *buffer;
 	size_t buffer_len;
 	int workload_method;
+	stress_workload_lat_t lat;
 } stress_workload_ctxt_t;
 #endif
 
+typedef struct {
+#if defined(WORKLOAD_THREADED)
+	pthread_t pthread;
+	stress_workload_ctxt_t c;
+#endif
+	int ret;
+} workload_thread_t;
+
 #define NUM_BUCKETS	(20)
 
 #define STRESS_WORKLOAD_DIST_CLUSTER	(0)
@@ -90,13 +104,54 @@ typedef struct {
 #define STRESS_WORKLOAD_METHOD_VECFP	(13)
 #define STRESS_WORKLOAD_METHOD_MAX	STRESS_WORKLOAD_METHOD_RANDOM
 
+/* workload quanta operations, synthesised quanta are all cpu bursts */
+#define STRESS_WORKLOAD_OP_CPU		(0)	/* cpu burst using the workload-method */
+#define STRESS_WORKLOAD_OP_SLEEP	(1)	/* sleep for the duration */
+#define STRESS_WORKLOAD_OP_TOUCH	(2)	/* write to size bytes, repeat for the duration */
+#define STRESS_WORKLOAD_OP_READ		(3)	/* read size bytes, repeat for the duration */
+#define STRESS_WORKLOAD_OP_MAX		STRESS_WORKLOAD_OP_READ
+
+#define STRESS_WORKLOAD_TRACE_MAGIC	"SNGWTRC"	/* 8 bytes with the terminating nul */
+#define STRESS_WORKLOAD_TRACE_VERSION	(1)
+#define STRESS_WORKLOAD_TRACE_SIZE_MAX	(GB)		/* largest memory op size */
+
 #define SCHED_UNDEFINED	(-1)
 
 typedef struct {
 	double when_us;
 	double run_duration_sec;
+	double intended;		/* intended start time */
+	double deadline;		/* completion deadline */
+	size_t size;			/* bytes used by memory ops */
+	int op;				/* STRESS_WORKLOAD_OP_* operation */
 } stress_workload_t;
 
+/* --workload-trace file header, followed by the records */
+typedef struct {
+	char magic[8];			/* STRESS_WORKLOAD_TRACE_MAGIC */
+	uint32_t version;		/* STRESS_WORKLOAD_TRACE_VERSION */
+	uint32_t record_size;		/* sizeof(stress_workload_trace_rec_t) */
+} stress_workload_trace_hdr_t;
+
+/* --workload-trace record, host byte order, sorted by offset_us */
+typedef struct {
+	uint64_t offset_us;		/* start time from the start of the trace */
+	uint32_t duration_us;		/* duration of the operation */
+	uint32_t size;			/* bytes used by memory ops */
+	uint8_t op;			/* STRESS_WORKLOAD_OP_* operation */
+	uint8_t reserved[7];		/* zero */
+} stress_workload_trace_rec_t;
+
+/* memory mapped --workload-trace file */
+typedef struct {
+	void *mapping;			/* trace file mapping, MAP_FAILED if none */
+	size_t mapping_len;		/* size of trace file mapping */
+	const stress_workload_trace_rec_t *recs;
+	size_t n_recs;			/* number of records */
+	double length;			/* duration of one replay of the trace in seconds */
+	size_t size_max;		/* largest memory op size */
+} stress_workload_trace_t;
+
 typedef struct {
 	const char *name;
 	const int type;
@@ -115,6 +170,7 @@ typedef struct {
 
 static const stress_help_t help[] = {
 	{ NULL,	"workload N",		"start N workers that exercise a mix of scheduling loads" },
+	{ NULL,	"workload-deadline-us N", "quanta completion deadline in microseconds, default is workload-quanta-us" },
 	{ NULL,	"workload-dist type",	"workload distribution type [random1, random2, random3, cluster]" },
 	{ NULL, "workload-load P",	"percentage load P per workload time slice" },
 	{ NULL,	"workload-ops N",	"stop after N workload bogo operations" },
@@ -122,6 +178,7 @@ static const stress_help_t help[] = {
 	{ NULL, "workload-sched P",	"select scheduler policy [idle, fifo, rr, other, batch, deadline]" },
 	{ NULL, "workload-slice-us N",	"duration of workload time load in microseconds" },
 	{ NULL,	"workload-threads N",	"number of workload threads workers to use, default is 0 (disabled)" },
+	{ NULL,	"workload-trace F",	"replay the cpu burst, sleep and memory records in trace file F" },
 	{ NULL, "workload-method M",	"select a workload method, default is all" },
 	{ NULL,	NULL,			NULL }
 };
@@ -168,6 +225,7 @@ static const char *stress_workload_sched(const size_t i)
 }
 
 static const stress_opt_t opts[] = {
+	{ OPT_workload_deadline_us, "workload-deadline-us", TYPE_ID_UINT32, 1, 10000000, NULL },
 	{ OPT_workload_dist,      "workload-dist",      TYPE_ID_SIZE_T_METHOD, 0, 0, stress_workload_dist },
 	{ OPT_workload_load,      "workload-load",      TYPE_ID_UINT32, 1, 100, NULL },
 	{ OPT_workload_method,    "workload-method",    TYPE_ID_SIZE_T_METHOD, 0, 0, stress_workload_method },
@@ -175,6 +233,7 @@ static const stress_opt_t opts[] = {
 	{ OPT_workload_sched,     "workload-sched",     TYPE_ID_SIZE_T_METHOD, 0, 0, stress_workload_sched },
 	{ OPT_workload_slice_us,  "workload-slice-us",  TYPE_ID_UINT32, 1, 10000000, NULL },
 	{ OPT_workload_threads,   "workload-threads",   TYPE_ID_UINT32, 0, 1024, NULL },
+	{ OPT_workload_trace,     "workload-trace",     TYPE_ID_STR, 0, 0, NULL },
 	END_OPT,
 };
 
@@ -613,6 +672,62 @@ static inline void stress_workload_waste_time(
 	}
 }
 
+/*
+ *  stress_workload_touch()
+ *	write to each cache line in buffer
+ */
+static void OPTIMIZE3 stress_workload_touch(uint8_t *buffer, const size_t buffer_len)
+{
+	register volatile uint8_t *ptr = (volatile uint8_t *)buffer;
+	register const uint8_t *end = buffer + buffer_len;
+	register const uint8_t val = stress_mwc8();
+
+	while (ptr < end) {
+		*ptr = val;
+		ptr += 64;
+	}
+}
+
+/*
+ *  stress_workload_run_op()
+ *	run a synthesised workload quanta or a replayed trace record
+ */
+static void stress_workload_run_op(
+	const int workload_method,
+	const stress_workload_t *wl,
+	uint8_t *buffer,
+	const size_t buffer_len)
+{
+	double t_end;
+	size_t size;
+
+	switch (wl->op) {
+	case STRESS_WORKLOAD_OP_SLEEP:
+		if (wl->run_duration_sec > 0.0)
+			(void)shim_nanosleep_uint64((uint64_t)(wl->run_duration_sec * STRESS_DBL_NANOSECOND));
+		break;
+	case STRESS_WORKLOAD_OP_TOUCH:
+		t_end = stress_time_now() + wl->run_duration_sec;
+		size = STRESS_MINIMUM(wl->size, buffer_len);
+		do {
+			stress_workload_touch(buffer, size);
+		} while (stress_time_now() < t_end);
+		break;
+	case STRESS_WORKLOAD_OP_READ:
+		t_end = stress_time_now() + wl->run_duration_sec;
+		/* reads are in 256 byte chunks, don't read past the buffer */
+		size = STRESS_MINIMUM(wl->size, buffer_len) & ~(size_t)255;
+		do {
+			stress_workload_read(buffer, size);
+		} while (stress_time_now() < t_end);
+		break;
+	case STRESS_WORKLOAD_OP_CPU:
+	default:
+		stress_workload_waste_time(workload_method, wl->run_duration_sec, buffer, buffer_len);
+		break;
+	}
+}
+
 static void stress_workload_bucket_init(stress_workload_bucket_t *bucket, const double width)
 {
 	size_t i;
@@ -677,6 +792,36 @@ static void stress_workload_bucket_report(stress_workload_bucket_t *bucket)
 	pr_block_end();
 }
 
+static void stress_workload_lat_init(stress_workload_lat_t *lat)
+{
+	stress_latency_hist_init(&lat->delay);
+	stress_latency_hist_init(&lat->response);
+	lat->missed = 0;
+}
+
+/*
+ *  stress_workload_lat_account()
+ *	account scheduling delay and response time of a quantum
+ *	that started at t_start and completed at t_done
+ */
+static void stress_workload_lat_account(
+	stress_workload_lat_t *lat,
+	const stress_workload_t *wl,
+	const double t_start,
+	const double t_done)
+{
+	const double delay = t_start - wl->intended;
+	const double response = t_done - wl->intended;
+
+	/* quanta may start a little early when yielding rather than sleeping */
+	stress_latency_hist_record(&lat->delay,
+		(delay > 0.0) ? (uint64_t)(delay * STRESS_DBL_NANOSECOND) : 0);
+	stress_latency_hist_record(&lat->response,
+		(response > 0.0) ? (uint64_t)(response * STRESS_DBL_NANOSECOND) : 0);
+	if (t_done > wl->deadline)
+		lat->missed++;
+}
+
 static int stress_workload_cmp(const void *p1, const void *p2)
 {
 	const stress_workload_t *w1 = (const stress_workload_t *)p1;
@@ -702,11 +847,13 @@ static int stress_workload_exercise(
 	const uint32_t workload_load,
 	const uint32_t workload_slice_us,
 	const uint32_t workload_quanta_us,
+	const uint32_t workload_deadline_us,
 	const uint32_t workload_threads,
 	const uint32_t max_quanta,
 	const int workload_dist,
 	stress_workload_t *workload,
 	stress_workload_bucket_t *slice_offset_bucket,
+	stress_workload_lat_t *lat,
 	uint8_t *buffer,
 	const size_t buffer_len)
 {
@@ -783,14 +930,18 @@ static int stress_workload_exercise(
 
 	for (i = 0; i < max_quanta; i++) {
 		const double run_when = t_begin + (workload[i].when_us * scale_us_to_sec);
+		double t_start;
 
+		workload[i].intended = run_when;
+		workload[i].deadline = run_when + ((double)workload_deadline_us * scale_us_to_sec);
 		sleep_duration_ns = (run_when - stress_time_now()) * STRESS_DBL_NANOSECOND;
 		if (sleep_duration_ns > 10000.0) {
 			(void)shim_nanosleep_uint64((uint64_t)sleep_duration_ns);
 		} else {
 			(void)shim_sched_yield();
 		}
-		stress_workload_bucket_account(slice_offset_bucket, STRESS_DBL_MICROSECOND * (stress_time_now() - t_begin));
+		t_start = stress_time_now();
+		stress_workload_bucket_account(slice_offset_bucket, STRESS_DBL_MICROSECOND * (t_start - t_begin));
 		if (run_duration_sec > 0.0) {
 			if (workload_threads) {
 #if defined(WORKLOAD_THREADED)
@@ -806,9 +957,11 @@ static int stress_workload_exercise(
 					(void)shim_nanosleep_uint64((uint64_t)(run_duration_sec * STRESS_DBL_NANOSECOND));
 #else
 				stress_workload_waste_time(workload_method, run_duration_sec, buffer, buffer_len);
+				stress_workload_lat_account(lat, &workload[i], t_start, stress_time_now());
 #endif
 			} else {
 				stress_workload_waste_time(workload_method, run_duration_sec, buffer, buffer_len);
+				stress_workload_lat_account(lat, &workload[i], t_start, stress_time_now());
 			}
 		}
 		stress_bogo_inc(args);
@@ -820,6 +973,157 @@ static int stress_workload_exercise(
 	return EXIT_SUCCESS;
 }
 
+/*
+ *  stress_workload_trace_load()
+ *	memory map and sanity check a --workload-trace file
+ */
+static int stress_workload_trace_load(
+	stress_args_t *args,
+	const char *filename,
+	stress_workload_trace_t *trace)
+{
+	const stress_workload_trace_hdr_t *hdr;
+	struct stat statbuf;
+	size_t i;
+	int fd;
+
+	fd = open(filename, O_RDONLY);
+	if (fd < 0) {
+		pr_err("%s: cannot open workload trace %s, errno=%d (%s)\n",
+			args->name, filename, errno, strerror(errno));
+		return -1;
+	}
+	if (fstat(fd, &statbuf) < 0) {
+		pr_err("%s: cannot stat workload trace %s, errno=%d (%s)\n",
+			args->name, filename, errno, strerror(errno));
+		(void)close(fd);
+		return -1;
+	}
+	if ((statbuf.st_size < (off_t)(sizeof(*hdr) + sizeof(*trace->recs))) ||
+	    ((((size_t)statbuf.st_size - sizeof(*hdr)) % sizeof(*trace->recs)) != 0)) {
+		pr_err("%s: workload trace %s has an invalid size of %jd bytes\n",
+			args->name, filename, (intmax_t)statbuf.st_size);
+		(void)close(fd);
+		return -1;
+	}
+	trace->mapping_len = (size_t)statbuf.st_size;
+	trace->mapping = mmap(NULL, trace->mapping_len, PROT_READ, MAP_PRIVATE, fd, 0);
+	(void)close(fd);
+	if (trace->mapping == MAP_FAILED) {
+		pr_err("%s: cannot mmap workload trace %s, errno=%d (%s)\n",
+			args->name, filename, errno, strerror(errno));
+		return -1;
+	}
+#if defined(MADV_SEQUENTIAL)
+	(void)shim_madvise(trace->mapping, trace->mapping_len, MADV_SEQUENTIAL);
+#endif
+
+	hdr = (const stress_workload_trace_hdr_t *)trace->mapping;
+	if (memcmp(hdr->magic, STRESS_WORKLOAD_TRACE_MAGIC, sizeof(hdr->magic)) ||
+	    (hdr->version != STRESS_WORKLOAD_TRACE_VERSION) ||
+	    (hdr->record_size != sizeof(*trace->recs))) {
+		pr_err("%s: %s is not a version %d workload trace file\n",
+			args->name, filename, STRESS_WORKLOAD_TRACE_VERSION);
+		goto err;
+	}
+	trace->recs = (const stress_workload_trace_rec_t *)(hdr + 1);
+	trace->n_recs = (trace->mapping_len - sizeof(*hdr)) / sizeof(*trace->recs);
+	trace->length = 0.0;
+	trace->size_max = 0;
+
+	for (i = 0; i < trace->n_recs; i++) {
+		const stress_workload_trace_rec_t *rec = &trace->recs[i];
+		const double end = (double)(rec->offset_us + rec->duration_us) / STRESS_DBL_MICROSECOND;
+
+		if (rec->op > STRESS_WORKLOAD_OP_MAX) {
+			pr_err("%s: workload trace %s record %zu has an invalid op %" PRIu8 "\n",
+				args->name, filename, i, rec->op);
+			goto err;
+		}
+		if (i && (rec->offset_us < trace->recs[i - 1].offset_us)) {
+			pr_err("%s: workload trace %s record %zu is not sorted by offset\n",
+				args->name, filename, i);
+			goto err;
+		}
+		if (rec->size > STRESS_WORKLOAD_TRACE_SIZE_MAX) {
+			pr_err("%s: workload trace %s record %zu size %" PRIu32 " is too large\n",
+				args->name, filename, i, rec->size);
+			goto err;
+		}
+		if ((rec->op == STRESS_WORKLOAD_OP_TOUCH) || (rec->op == STRESS_WORKLOAD_OP_READ))
+			trace->size_max = STRESS_MAXIMUM(trace->size_max, (size_t)rec->size);
+		if (end > trace->length)
+			trace->length = end;
+	}
+	if (args->instance == 0)
+		pr_dbg("%s: replaying %zu records of %.3f seconds from %s\n",
+			args->name, trace->n_recs, trace->length, filename);
+	return 0;
+err:
+	(void)munmap(trace->mapping, trace->mapping_len);
+	trace->mapping = MAP_FAILED;
+	trace->n_recs = 0;
+	return -1;
+}
+
+/*
+ *  stress_workload_replay()
+ *	replay a pass of the trace records at their offsets from
+ *	*t_begin, the records are run in this process or dispatched
+ *	to the workload threads, the next pass starts at the end of
+ *	this pass on the same open-loop schedule so replay lag is
+ *	not absorbed by a late pass
+ */
+static void stress_workload_replay(
+	stress_args_t *args,
+#if defined(WORKLOAD_THREADED)
+	const mqd_t mq,
+#endif
+	const uint32_t workload_method,
+	const uint32_t workload_deadline_us,
+	const uint32_t workload_threads,
+	const stress_workload_trace_t *trace,
+	double *t_begin,
+	stress_workload_lat_t *lat,
+	uint8_t *buffer,
+	const size_t buffer_len)
+{
+	const double scale_us_to_sec = 1.0 / STRESS_DBL_MICROSECOND;
+	size_t i;
+
+	for (i = 0; (i < trace->n_recs) && stress_continue(args); i++) {
+		const stress_workload_trace_rec_t *rec = &trace->recs[i];
+		stress_workload_t wl;
+		double sleep_duration_ns, t_start;
+
+		wl.when_us = (double)rec->offset_us;
+		wl.run_duration_sec = (double)rec->duration_us * scale_us_to_sec;
+		wl.intended = *t_begin + (wl.when_us * scale_us_to_sec);
+		wl.deadline = wl.intended + wl.run_duration_sec +
+			((double)workload_deadline_us * scale_us_to_sec);
+		wl.size = (size_t)rec->size;
+		wl.op = (int)rec->op;
+
+		sleep_duration_ns = (wl.intended - stress_time_now()) * STRESS_DBL_NANOSECOND;
+		if (sleep_duration_ns > 10000.0)
+			(void)shim_nanosleep_uint64((uint64_t)sleep_duration_ns);
+		else if (sleep_duration_ns > 0.0)
+			(void)shim_sched_yield();
+
+		if (workload_threads) {
+#if defined(WORKLOAD_THREADED)
+			(void)mq_send(mq, (const char *)&wl, sizeof(wl), 0);
+#endif
+		} else {
+			t_start = stress_time_now();
+			stress_workload_run_op(workload_method, &wl, buffer, buffer_len);
+			stress_workload_lat_account(lat, &wl, t_start, stress_time_now());
+		}
+		stress_bogo_inc(args);
+	}
+	*t_begin += trace->length;
+}
+
 #if defined(WORKLOAD_THREADED)
 static void *stress_workload_thread(void *ctxt)
 {
@@ -831,9 +1135,12 @@ static void *stress_workload_thread(void *ctxt)
 		stress_workload_t wl;
 
 		ret = mq_receive(c->mq, (char *)&wl, sizeof(wl), &prio);
-		if (ret == sizeof(wl))
-			stress_workload_waste_time(c->workload_method, wl.run_duration_sec, c->buffer, c->buffer_len);
-		else {
+		if (ret == sizeof(wl)) {
+			const double t_start = stress_time_now();
+
+			stress_workload_run_op(c->workload_method, &wl, c->buffer, c->buffer_len);
+			stress_workload_lat_account(&c->lat, &wl, t_start, stress_time_now());
+		} else {
 			if ((errno == EINTR) || (errno == ETIMEDOUT)) {
 				continue;
 			}
@@ -842,23 +1149,89 @@ static void *stress_workload_thread(void *ctxt)
 	}
 	return NULL;
 }
+
+/*
+ *  stress_workload_threads_stop()
+ *	cancel and reap workload threads
+ */
+static void stress_workload_threads_stop(workload_thread_t *threads, const uint32_t n)
+{
+	uint32_t i;
+
+	for (i = 0; threads && (i < n); i++) {
+		if (threads[i].ret == 0) {
+			VOID_RET(int, pthread_cancel(threads[i].pthread));
+			VOID_RET(int, pthread_join(threads[i].pthread, NULL));
+			threads[i].ret = -1;
+		}
+	}
+}
 #endif
 
+/*
+ *  stress_workload_lat_report()
+ *	report scheduling delay and response time percentiles
+ *	and the number of quanta that missed their deadline
+ */
+static void stress_workload_lat_report(stress_args_t *args, stress_workload_lat_t *lat, const bool replay)
+{
+	const stress_latency_hist_t *delay = &lat->delay;
+	const stress_latency_hist_t *response = &lat->response;
+	const double missed_pc = (response->count > 0) ?
+		100.0 * (double)lat->missed / (double)response->count : 0.0;
+
+	if (response->count == 0)
+		return;
+
+	/* when replaying a trace the delay is the lag behind the trace timing */
+	stress_metrics_set(args, 0, replay ? "replay lag mean (usec)" : "scheduling delay mean (usec)",
+		stress_latency_hist_mean(delay) / 1000.0, STRESS_METRIC_GEOMETRIC_MEAN);
+	stress_metrics_set(args, 1, replay ? "replay lag p99 (usec)" : "scheduling delay p99 (usec)",
+		(double)stress_latency_hist_percentile(delay, 99.0) / 1000.0,
+		STRESS_METRIC_GEOMETRIC_MEAN);
+	stress_metrics_set(args, 2, replay ? "replay lag p99.9 (usec)" : "scheduling delay p99.9 (usec)",
+		(double)stress_latency_hist_percentile(delay, 99.9) / 1000.0,
+		STRESS_METRIC_GEOMETRIC_MEAN);
+	stress_metrics_set(args, 3, "response time p50 (usec)",
+		(double)stress_latency_hist_percentile(response, 50.0) / 1000.0,
+		STRESS_METRIC_GEOMETRIC_MEAN);
+	stress_metrics_set(args, 4, "response time p99 (usec)",
+		(double)stress_latency_hist_percentile(response, 99.0) / 1000.0,
+		STRESS_METRIC_GEOMETRIC_MEAN);
+	stress_metrics_set(args, 5, "response time p99.9 (usec)",
+		(double)stress_latency_hist_percentile(response, 99.9) / 1000.0,
+		STRESS_METRIC_GEOMETRIC_MEAN);
+	stress_metrics_set(args, 6, "response time max (usec)",
+		(double)response->max_ns / 1000.0, STRESS_METRIC_MAXIMUM);
+	stress_metrics_set(args, 7, "missed deadlines",
+		(double)lat->missed, STRESS_METRIC_TOTAL);
+	stress_metrics_set(args, 8, "missed deadlines (%)",
+		missed_pc, STRESS_METRIC_GEOMETRIC_MEAN);
+	if (replay)
+		stress_metrics_set(args, 9, "replay lag max (usec)",
+			(double)delay->max_ns / 1000.0, STRESS_METRIC_MAXIMUM);
+}
+
 static int stress_workload(stress_args_t *args)
 {
 	uint32_t workload_load = 30;
 	uint32_t workload_slice_us = 100000;	/* 1/10th second */
 	uint32_t workload_quanta_us = 1000;	/* 1/1000th second */
+	uint32_t workload_deadline_us;
 	uint32_t workload_threads = 2;		/* 0 = disabled */
 	uint32_t max_quanta;
 	size_t workload_sched = 0;		/* undefined */
 	size_t workload_dist_idx = 0;
 	size_t workload_method_idx = 0;
 	int workload_dist, workload_method;
-	stress_workload_t *workload;
+	stress_workload_t *workload = NULL;
 	uint8_t *buffer;
-	const size_t buffer_len = MB;
+	size_t buffer_len = MB;
 	stress_workload_bucket_t slice_offset_bucket;
+	stress_workload_trace_t trace;
+	char *workload_trace = NULL;
+	double t_begin;
+	stress_workload_lat_t *lat;
 	int rc = EXIT_SUCCESS;
 #if defined(WORKLOAD_THREADED)
 	workload_thread_t *threads = NULL;
@@ -871,13 +1244,26 @@ static int stress_workload(stress_args_t *args)
 	(void)stress_get_setting("workload-load", &workload_load);
 	(void)stress_get_setting("workload-method", &workload_method_idx);
 	(void)stress_get_setting("workload-quanta-us", &workload_quanta_us);
+	if (!stress_get_setting("workload-deadline-us", &workload_deadline_us))
+		workload_deadline_us = workload_quanta_us;
 	(void)stress_get_setting("workload-sched", &workload_sched);
 	(void)stress_get_setting("workload-slice-us", &workload_slice_us);
 	(void)stress_get_setting("workload-threads", &workload_threads);
+	(void)stress_get_setting("workload-trace", &workload_trace);
 
 	workload_method = workload_methods[workload_method_idx].method;
 	workload_dist = workload_dists[workload_dist_idx].type;
 
+	(void)shim_memset(&trace, 0, sizeof(trace));
+	trace.mapping = MAP_FAILED;
+	if (workload_trace) {
+		if (stress_workload_trace_load(args, workload_trace, &trace) < 0)
+			return EXIT_FAILURE;
+		/* memory ops touch or read from the start of the buffer */
+		if (trace.size_max > buffer_len)
+			buffer_len = (trace.size_max + args->page_size - 1) & ~(args->page_size - 1);
+	}
+
 	if (args->instance == 0) {
 		uint32_t timer_slack_ns;
 
@@ -898,15 +1284,25 @@ static int stress_workload(stress_args_t *args)
 	if (buffer == MAP_FAILED) {
 		pr_inf_skip("%s: cannot mmap %zd sized buffer, "
 			"skipping stressor\n", args->name, buffer_len);
-		return EXIT_NO_RESOURCE;
+		rc = EXIT_NO_RESOURCE;
+		goto exit_unmap_trace;
 	}
 	(void)stress_madvise_nohugepage(buffer, buffer_len);
 	stress_set_vma_anon_name(buffer, buffer_len, "workload-buffer");
 
+	/* latency histograms are large, keep them off the stack */
+	lat = (stress_workload_lat_t *)calloc(1, sizeof(*lat));
+	if (!lat) {
+		pr_inf_skip("%s: cannot allocate latency statistics, "
+			"skipping stressor\n", args->name);
+		rc = EXIT_NO_RESOURCE;
+		goto exit_free_buffer;
+	}
+	stress_workload_lat_init(lat);
+
 	if (workload_threads > 0) {
 #if defined(WORKLOAD_THREADED)
 		struct mq_attr attr;
-		static stress_workload_ctxt_t c;
 		uint32_t threads_started = 0;
 
 		(void)snprintf(mq_name, sizeof(mq_name), "/%s-%" PRIdMAX "-%" PRIu32,
@@ -921,7 +1317,7 @@ static int stress_workload(stress_args_t *args)
 				"skipping stressor\n", args->name,
 				errno, strerror(errno));
 			rc = EXIT_NO_RESOURCE;
-			goto exit_free_buffer;
+			goto exit_free_lat;
 		}
 		threads = (workload_thread_t *)calloc((size_t)workload_threads, sizeof(*threads));
 		if (!threads) {
@@ -932,13 +1328,16 @@ static int stress_workload(stress_args_t *args)
 			goto exit_close_mq;
 		}
 
-		c.buffer = buffer;
-		c.buffer_len = buffer_len;
-		c.workload_method = workload_method;
-		c.mq = mq;
 		for (i = 0; i < workload_threads; i++) {
+			stress_workload_ctxt_t *c = &threads[i].c;
+
+			c->buffer = buffer;
+			c->buffer_len = buffer_len;
+			c->workload_method = workload_method;
+			c->mq = mq;
+			stress_workload_lat_init(&c->lat);
 			threads[i].ret = pthread_create(&threads[i].pthread, NULL,
-                                stress_workload_thread, (void *)&c);
+                                stress_workload_thread, (void *)c);
 			if (threads[i].ret == 0)
 				threads_started++;
 		}
@@ -960,7 +1359,7 @@ static int stress_workload(stress_args_t *args)
 		pr_inf("%s: running with %" PRIu32 " threads per stressor instance\n",
 			args->name, workload_threads);
 
-	if (workload_quanta_us > workload_slice_us) {
+	if (!trace.n_recs && (workload_quanta_us > workload_slice_us)) {
 		pr_err("%s: workload-quanta-us %" PRIu32 " must be less "
 			"than workload-slice-us %" PRIu32 "\n",
 			args->name, workload_quanta_us, workload_slice_us);
@@ -968,7 +1367,7 @@ static int stress_workload(stress_args_t *args)
 #if defined(WORKLOAD_THREADED)
 		goto exit_free_threads;
 #else
-		goto exit_free_buffer;
+		goto exit_free_lat;
 #endif
 	}
 
@@ -979,15 +1378,16 @@ static int stress_workload(stress_args_t *args)
 	if (workload_threads > 0)
 		max_quanta *= workload_threads;
 
-	workload = (stress_workload_t *)calloc(max_quanta, sizeof(*workload));
-	if (!workload) {
+	if (!trace.n_recs)
+		workload = (stress_workload_t *)calloc(max_quanta, sizeof(*workload));
+	if (!trace.n_recs && !workload) {
 		pr_inf_skip("%s: cannot allocate %" PRIu32 " scheduler workload timings, "
 			"skipping stressor\n", args->name, max_quanta);
 		rc = EXIT_NO_RESOURCE;
 #if defined(WORKLOAD_THREADED)
 		goto exit_free_threads;
 #else
-		goto exit_free_buffer;
+		goto exit_free_lat;
 #endif
 	}
 
@@ -999,7 +1399,21 @@ static int stress_workload(stress_args_t *args)
 	stress_sync_start_wait(args);
 	stress_set_proc_state(args->name, STRESS_STATE_RUN);
 
+	t_begin = stress_time_now();
 	do {
+		if (trace.n_recs) {
+			stress_workload_replay(args,
+#if defined(WORKLOAD_THREADED)
+					mq,
+#endif
+					workload_method,
+					workload_deadline_us,
+					workload_threads,
+					&trace, &t_begin,
+					lat,
+					buffer, buffer_len);
+			continue;
+		}
 		stress_workload_exercise(args,
 #if defined(WORKLOAD_THREADED)
 					mq,
@@ -1008,28 +1422,35 @@ static int stress_workload(stress_args_t *args)
 					workload_load,
 					workload_slice_us,
 					workload_quanta_us,
+					workload_deadline_us,
 					workload_threads,
 					max_quanta, workload_dist,
 					workload,
 					&slice_offset_bucket,
+					lat,
 					buffer, buffer_len);
 	} while (stress_continue(args));
 
 	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
 
-	if (args->instance == 0)
+#if defined(WORKLOAD_THREADED)
+	stress_workload_threads_stop(threads, workload_threads);
+	for (i = 0; threads && (i < workload_threads); i++) {
+		stress_latency_hist_merge(&lat->delay, &threads[i].c.lat.delay);
+		stress_latency_hist_merge(&lat->response, &threads[i].c.lat.response);
+		lat->missed += threads[i].c.lat.missed;
+	}
+#endif
+	stress_workload_lat_report(args, lat, trace.n_recs > 0);
+
+	if ((args->instance == 0) && !trace.n_recs)
 		stress_workload_bucket_report(&slice_offset_bucket);
 
 	free(workload);
 
 #if defined(WORKLOAD_THREADED)
 exit_free_threads:
-	for (i = 0; threads && (i < workload_threads); i++) {
-		if (threads[i].ret == 0) {
-			VOID_RET(int, pthread_cancel(threads[i].pthread));
-			VOID_RET(int, pthread_join(threads[i].pthread, NULL));
-		}
-	}
+	stress_workload_threads_stop(threads, workload_threads);
 
 exit_close_mq:
 	if (mq != (mqd_t)-1) {
@@ -1039,8 +1460,13 @@ exit_close_mq:
 
 	free(threads);
 #endif
+exit_free_lat:
+	free(lat);
 exit_free_buffer:
 	(void)munmap((void *)buffer, buffer_len);
+exit_unmap_trace:
+	if (trace.mapping != MAP_FAILED)
+		(void)munmap(trace.mapping, trace.mapping_len);
 	return rc;
 }
 
@@ -1049,5 +1475,6 @@ const stressor_info_t stress_workload_info = {
 	.class = CLASS_SCHEDULER | CLASS_OS,
 	.opts = opts,
 	.verify = VERIFY_ALWAYS,
+	.metrics_max = 10,
 	.help = help
 };
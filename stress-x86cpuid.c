@@ -253,6 +253,7 @@ const stressor_info_t stress_x86cpuid_info = {
 	.stressor = stress_x86cpuid,
 	.class = CLASS_CPU,
 	.verify = VERIFY_ALWAYS,
+	.metrics_max = 1,
 	.help = help
 };
 #else
@@ -527,6 +527,7 @@ const stressor_info_t stress_x86syscall_info = {
 	.supported = stress_x86syscall_supported,
 	.opts = opts,
 	.verify = VERIFY_ALWAYS,
+	.metrics_max = 2,
 	.help = help
 };
 #else
@@ -287,6 +287,7 @@ const stressor_info_t stress_zero_info = {
 	.stressor = stress_zero,
 	.class = CLASS_DEV | CLASS_MEMORY | CLASS_OS,
 	.verify = VERIFY_ALWAYS,
+	.metrics_max = 1,
 	.opts = opts,
 	.help = help
 };
@@ -0,0 +1,864 @@
+/*
+ * Copyright (C) 2025      Colin Ian King.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+#include "stress-ng.h"
+#include "core-builtin.h"
+#include "core-io-uring.h"
+#include "core-killpid.h"
+#include "core-net.h"
+#include "io-uring.h"
+
+#include <netinet/in.h>
+
+#if defined(HAVE_SYS_SENDFILE_H)
+#include <sys/sendfile.h>
+#endif
+
+#if defined(HAVE_POLL_H)
+#include <poll.h>
+#endif
+
+#if defined(HAVE_LINUX_ERRQUEUE_H)
+#include <linux/errqueue.h>
+#endif
+
+#if defined(HAVE_LINUX_PERF_EVENT_H)
+#include <linux/perf_event.h>
+#endif
+
+#define MIN_ZEROCOPY_BYTES	(1 * MB)
+#define MAX_ZEROCOPY_BYTES	(1 * GB)
+#define DEFAULT_ZEROCOPY_BYTES	(16 * MB)
+
+#define DEFAULT_ZEROCOPY_PORT	(17000)
+
+#define ZEROCOPY_CHUNK		(64 * KB)	/* read/send, splice and zerocopy send size */
+#define ZEROCOPY_DRAIN_BUF	(256 * KB)	/* receiver drain buffer size */
+
+#define ZEROCOPY_UNSUPPORTED	(-2)
+
+static const stress_help_t help[] = {
+	{ NULL,	"zerocopy N",		"start N workers moving a file to a TCP socket" },
+	{ NULL,	"zerocopy-bytes N",	"size of the page cache file to send (default 16MB)" },
+	{ NULL,	"zerocopy-if I",	"use network interface I, e.g. lo, eth0, etc." },
+	{ NULL,	"zerocopy-method M",	"select file to socket method, default all" },
+	{ NULL,	"zerocopy-ops N",	"stop after N bogo whole file sends" },
+	{ NULL,	"zerocopy-port P",	"use socket ports P to P + number of workers - 1" },
+	{ NULL,	NULL,			NULL }
+};
+
+#if defined(HAVE_SENDFILE)
+#define STRESS_ZEROCOPY_SENDFILE
+#endif
+
+#if defined(HAVE_SPLICE) &&		\
+    defined(SPLICE_F_MOVE) &&		\
+    defined(SPLICE_F_MORE)
+#define STRESS_ZEROCOPY_SPLICE
+#endif
+
+#if defined(STRESS_ZEROCOPY_SPLICE) &&	\
+    defined(STRESS_IO_URING) &&		\
+    defined(HAVE_IORING_OP_SPLICE)
+#define STRESS_ZEROCOPY_IO_URING
+#endif
+
+#if defined(MSG_ZEROCOPY) &&		\
+    defined(SO_ZEROCOPY) &&		\
+    defined(HAVE_LINUX_ERRQUEUE_H) &&	\
+    defined(SO_EE_ORIGIN_ZEROCOPY) &&	\
+    defined(SO_EE_CODE_ZEROCOPY_COPIED) && \
+    defined(IP_RECVERR) &&		\
+    defined(HAVE_POLL_H) &&		\
+    defined(HAVE_POLL)
+#define STRESS_ZEROCOPY_MSG_ZEROCOPY
+#endif
+
+#if defined(HAVE_LINUX_PERF_EVENT_H) &&	\
+    defined(HAVE_SYSCALL) &&		\
+    defined(__NR_perf_event_open)
+#define STRESS_ZEROCOPY_CYCLES
+#endif
+
+#if defined(AF_INET) &&			\
+    defined(SOCK_STREAM)
+
+typedef struct {
+	stress_args_t *args;
+	int file_fd;			/* page cache file */
+	int sock_fd;			/* connected sending socket */
+	size_t file_size;		/* size of the file */
+	uint8_t *buf;			/* read/send buffer */
+	void *file_map;			/* file mapping for MSG_ZEROCOPY */
+	int pipe_fds[2];		/* splice pipe */
+	uint64_t zc_sends;		/* MSG_ZEROCOPY sends */
+	uint64_t zc_completed;		/* MSG_ZEROCOPY completion notifications */
+	uint64_t zc_copied;		/* completions where the kernel copied */
+#if defined(STRESS_ZEROCOPY_IO_URING)
+	stress_io_uring_t ring;		/* io_uring for linked splices */
+#endif
+} stress_zerocopy_t;
+
+typedef ssize_t (*stress_zerocopy_func_t)(stress_zerocopy_t *zc);
+
+typedef struct {
+	const char *name;		/* method name */
+	const stress_zerocopy_func_t func; /* whole file send function */
+} stress_zerocopy_method_t;
+
+typedef struct {
+	double bytes;			/* bytes sent */
+	double duration;		/* time sending */
+	uint64_t cycles;		/* sender CPU cycles */
+	bool supported;			/* false if method cannot be used */
+} stress_zerocopy_stats_t;
+
+/*
+ *  stress_zerocopy_read_send()
+ *	copy the file into a user buffer with pread and send it
+ */
+static ssize_t stress_zerocopy_read_send(stress_zerocopy_t *zc)
+{
+	size_t off = 0;
+
+	while (off < zc->file_size) {
+		const size_t len = STRESS_MINIMUM(zc->file_size - off, (size_t)ZEROCOPY_CHUNK);
+		ssize_t n, sent = 0;
+
+		n = pread(zc->file_fd, zc->buf, len, (off_t)off);
+		if (UNLIKELY(n <= 0))
+			return (n == 0) ? (ssize_t)off : -1;
+		while (sent < n) {
+			const ssize_t ret = send(zc->sock_fd, zc->buf + sent,
+				(size_t)(n - sent), MSG_NOSIGNAL);
+
+			if (UNLIKELY(ret < 0))
+				return (errno == EINTR) ? (ssize_t)off : -1;
+			sent += ret;
+		}
+		off += (size_t)n;
+	}
+	return (ssize_t)off;
+}
+
+/*
+ *  stress_zerocopy_sendfile()
+ *	send the file with sendfile
+ */
+static ssize_t stress_zerocopy_sendfile(stress_zerocopy_t *zc)
+{
+#if defined(STRESS_ZEROCOPY_SENDFILE)
+	off_t off = 0;
+
+	while ((size_t)off < zc->file_size) {
+		const ssize_t ret = sendfile(zc->sock_fd, zc->file_fd, &off,
+			zc->file_size - (size_t)off);
+
+		if (UNLIKELY(ret < 0)) {
+			if ((errno == ENOSYS) || (errno == EINVAL))
+				return ZEROCOPY_UNSUPPORTED;
+			return (errno == EINTR) ? (ssize_t)off : -1;
+		}
+		if (ret == 0)
+			break;
+	}
+	return (ssize_t)off;
+#else
+	(void)zc;
+	return ZEROCOPY_UNSUPPORTED;
+#endif
+}
+
+/*
+ *  stress_zerocopy_splice()
+ *	splice the file into a pipe and the pipe into the socket
+ */
+static ssize_t stress_zerocopy_splice(stress_zerocopy_t *zc)
+{
+#if defined(STRESS_ZEROCOPY_SPLICE)
+	loff_t off = 0;
+
+	if (zc->pipe_fds[0] < 0)
+		return ZEROCOPY_UNSUPPORTED;
+	while ((size_t)off < zc->file_size) {
+		const size_t len = STRESS_MINIMUM(zc->file_size - (size_t)off, (size_t)ZEROCOPY_CHUNK);
+		ssize_t n, ret;
+
+		n = splice(zc->file_fd, &off, zc->pipe_fds[1], NULL, len,
+			SPLICE_F_MOVE | SPLICE_F_MORE);
+		if (UNLIKELY(n <= 0)) {
+			if ((n < 0) && ((errno == ENOSYS) || (errno == EINVAL)))
+				return ZEROCOPY_UNSUPPORTED;
+			return ((n == 0) || (errno == EINTR)) ? (ssize_t)off : -1;
+		}
+		while (n > 0) {
+			ret = splice(zc->pipe_fds[0], NULL, zc->sock_fd, NULL, (size_t)n,
+				SPLICE_F_MOVE | SPLICE_F_MORE);
+			if (UNLIKELY(ret <= 0))
+				return -1;
+			n -= ret;
+		}
+	}
+	return (ssize_t)off;
+#else
+	(void)zc;
+	return ZEROCOPY_UNSUPPORTED;
+#endif
+}
+
+#if defined(STRESS_ZEROCOPY_IO_URING)
+/*
+ *  stress_zerocopy_uring_splice_sqe()
+ *	queue a splice request
+ */
+static void stress_zerocopy_uring_splice_sqe(
+	stress_zerocopy_t *zc,
+	const int fd_in,
+	const int64_t off_in,
+	const int fd_out,
+	const size_t len,
+	const uint8_t flags)
+{
+	const unsigned int tail = *zc->ring.sq_tail;
+	const unsigned int idx = tail & *zc->ring.sq_mask;
+	struct io_uring_sqe *sqe = &zc->ring.sqes[idx];
+
+	(void)shim_memset(sqe, 0, sizeof(*sqe));
+	sqe->opcode = IORING_OP_SPLICE;
+	sqe->flags = flags;
+	sqe->splice_fd_in = fd_in;
+	sqe->splice_off_in = (uint64_t)off_in;
+	sqe->fd = fd_out;
+	sqe->off = (uint64_t)-1;
+	sqe->len = (uint32_t)len;
+	sqe->splice_flags = SPLICE_F_MOVE | SPLICE_F_MORE;
+	zc->ring.sq_array[idx] = idx;
+	stress_asm_mb();
+	*zc->ring.sq_tail = tail + 1;
+	stress_asm_mb();
+}
+#endif
+
+/*
+ *  stress_zerocopy_io_uring_splice()
+ *	submit linked file to pipe and pipe to socket splices
+ */
+static ssize_t stress_zerocopy_io_uring_splice(stress_zerocopy_t *zc)
+{
+#if defined(STRESS_ZEROCOPY_IO_URING)
+	size_t off = 0;
+
+	if ((zc->ring.fd < 0) || (zc->pipe_fds[0] < 0))
+		return ZEROCOPY_UNSUPPORTED;
+	while (off < zc->file_size) {
+		const size_t len = STRESS_MINIMUM(zc->file_size - off, (size_t)ZEROCOPY_CHUNK);
+		int32_t res[2] = { 0, 0 };
+		unsigned int head;
+		int i, ret;
+
+		stress_zerocopy_uring_splice_sqe(zc, zc->file_fd, (int64_t)off,
+			zc->pipe_fds[1], len, IOSQE_IO_LINK);
+		stress_zerocopy_uring_splice_sqe(zc, zc->pipe_fds[0], -1,
+			zc->sock_fd, len, 0);
+		ret = shim_io_uring_enter(zc->ring.fd, 2, 2, IORING_ENTER_GETEVENTS, NULL, 0);
+		if (UNLIKELY(ret < 0)) {
+			if (errno != EINTR)
+				return -1;
+			/* requests may still be in flight, wait for them */
+			(void)shim_io_uring_enter(zc->ring.fd, 0, 2, IORING_ENTER_GETEVENTS, NULL, 0);
+		}
+		head = *zc->ring.cq_head;
+		for (i = 0; i < 2; i++) {
+			const struct io_uring_cqe *cqe;
+
+			stress_asm_mb();
+			if (head == *zc->ring.cq_tail)
+				break;
+			cqe = &zc->ring.cqes[head & *zc->ring.cq_mask];
+			/* user_data is not set, completions arrive in link order */
+			res[i] = cqe->res;
+			head++;
+		}
+		*zc->ring.cq_head = head;
+		stress_asm_mb();
+
+		if (UNLIKELY(res[0] <= 0)) {
+			if ((res[0] == -EINVAL) || (res[0] == -EOPNOTSUPP))
+				return ZEROCOPY_UNSUPPORTED;
+			return (res[0] == 0) ? (ssize_t)off : -1;
+		}
+		if (UNLIKELY(res[1] < 0))
+			return -1;
+		/* drain any short pipe to socket splice synchronously */
+		while (res[1] < res[0]) {
+			const ssize_t n = splice(zc->pipe_fds[0], NULL, zc->sock_fd, NULL,
+				(size_t)(res[0] - res[1]), SPLICE_F_MOVE);
+
+			if (UNLIKELY(n <= 0))
+				return -1;
+			res[1] += (int32_t)n;
+		}
+		off += (size_t)res[0];
+		if (UNLIKELY(!stress_continue_flag()))
+			break;
+	}
+	return (ssize_t)off;
+#else
+	(void)zc;
+	return ZEROCOPY_UNSUPPORTED;
+#endif
+}
+
+#if defined(STRESS_ZEROCOPY_MSG_ZEROCOPY)
+/*
+ *  stress_zerocopy_reap()
+ *	read MSG_ZEROCOPY completion notifications from the socket
+ *	error queue, waiting up to timeout_ms for the first one
+ */
+static void stress_zerocopy_reap(stress_zerocopy_t *zc, const int timeout_ms)
+{
+	if (timeout_ms > 0) {
+		struct pollfd pfd;
+
+		pfd.fd = zc->sock_fd;
+		pfd.events = 0;		/* POLLERR is always reported */
+		pfd.revents = 0;
+		(void)poll(&pfd, 1, timeout_ms);
+	}
+
+	for (;;) {
+		char control[128];
+		struct msghdr msg;
+		struct cmsghdr *cmsg;
+
+		(void)shim_memset(&msg, 0, sizeof(msg));
+		msg.msg_control = control;
+		msg.msg_controllen = sizeof(control);
+		if (recvmsg(zc->sock_fd, &msg, MSG_ERRQUEUE | MSG_DONTWAIT) < 0)
+			break;
+		for (cmsg = CMSG_FIRSTHDR(&msg); cmsg; cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+			const struct sock_extended_err *serr;
+			uint32_t n;
+
+			if ((cmsg->cmsg_level != SOL_IP) || (cmsg->cmsg_type != IP_RECVERR))
+				continue;
+			serr = (const struct sock_extended_err *)CMSG_DATA(cmsg);
+			if ((serr->ee_errno != 0) || (serr->ee_origin != SO_EE_ORIGIN_ZEROCOPY))
+				continue;
+			/* notifications cover the send range ee_info..ee_data */
+			n = serr->ee_data - serr->ee_info + 1;
+			zc->zc_completed += n;
+			if (serr->ee_code & SO_EE_CODE_ZEROCOPY_COPIED)
+				zc->zc_copied += n;
+		}
+	}
+}
+#endif
+
+/*
+ *  stress_zerocopy_msg_zerocopy()
+ *	send the mmap'd page cache pages with MSG_ZEROCOPY and wait
+ *	for the kernel to release them
+ */
+static ssize_t stress_zerocopy_msg_zerocopy(stress_zerocopy_t *zc)
+{
+#if defined(STRESS_ZEROCOPY_MSG_ZEROCOPY)
+	const uint8_t *data = (const uint8_t *)zc->file_map;
+	size_t off = 0;
+
+	if (!zc->file_map)
+		return ZEROCOPY_UNSUPPORTED;
+	while (off < zc->file_size) {
+		const size_t len = STRESS_MINIMUM(zc->file_size - off, (size_t)ZEROCOPY_CHUNK);
+		const ssize_t ret = send(zc->sock_fd, data + off, len, MSG_ZEROCOPY | MSG_NOSIGNAL);
+
+		if (UNLIKELY(ret < 0)) {
+			if (errno == ENOBUFS) {
+				/* out of optmem for notifications, reap some */
+				stress_zerocopy_reap(zc, 10);
+				continue;
+			}
+			if (errno == EINTR)
+				break;
+			return -1;
+		}
+		zc->zc_sends++;
+		off += (size_t)ret;
+		stress_zerocopy_reap(zc, 0);
+	}
+	/* the pages are pinned until the kernel notifies completion */
+	while ((zc->zc_completed < zc->zc_sends) && stress_continue_flag())
+		stress_zerocopy_reap(zc, 100);
+	return (ssize_t)off;
+#else
+	(void)zc;
+	return ZEROCOPY_UNSUPPORTED;
+#endif
+}
+
+static const stress_zerocopy_method_t stress_zerocopy_methods[] = {
+	{ "all",		NULL },
+	{ "read-send",		stress_zerocopy_read_send },
+	{ "sendfile",		stress_zerocopy_sendfile },
+	{ "splice",		stress_zerocopy_splice },
+	{ "io-uring-splice",	stress_zerocopy_io_uring_splice },
+	{ "msg-zerocopy",	stress_zerocopy_msg_zerocopy },
+};
+
+#define NUM_ZEROCOPY_METHODS	(SIZEOF_ARRAY(stress_zerocopy_methods))
+
+#if defined(STRESS_ZEROCOPY_CYCLES)
+/*
+ *  stress_zerocopy_cycles_open()
+ *	open a user and kernel CPU cycles counter on this process
+ */
+static int stress_zerocopy_cycles_open(void)
+{
+	struct perf_event_attr attr;
+
+	(void)shim_memset(&attr, 0, sizeof(attr));
+	attr.size = sizeof(attr);
+	attr.type = PERF_TYPE_HARDWARE;
+	attr.config = PERF_COUNT_HW_CPU_CYCLES;
+	attr.exclude_hv = 1;
+
+	return (int)syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+}
+#endif
+
+/*
+ *  stress_zerocopy_cycles()
+ *	read the CPU cycles counter, 0 if not available
+ */
+static uint64_t stress_zerocopy_cycles(const int cycles_fd)
+{
+	uint64_t cycles = 0;
+
+	if (cycles_fd < 0)
+		return 0;
+	if (read(cycles_fd, &cycles, sizeof(cycles)) != (ssize_t)sizeof(cycles))
+		return 0;
+	return cycles;
+}
+
+/*
+ *  stress_zerocopy_drain()
+ *	receiver, read and discard everything sent
+ */
+static void NORETURN stress_zerocopy_drain(const int fd)
+{
+	static uint8_t drain_buf[ZEROCOPY_DRAIN_BUF];
+
+	stress_parent_died_alarm();
+	for (;;) {
+		const ssize_t n = recv(fd, drain_buf, sizeof(drain_buf), 0);
+
+		if (n == 0)
+			break;
+		if ((n < 0) && (errno != EINTR))
+			break;
+	}
+	(void)close(fd);
+	_exit(0);
+}
+
+/*
+ *  stress_zerocopy_connect()
+ *	create a connected TCP socket pair, returns the
+ *	sending socket and the receiving socket in *rfd
+ */
+static int stress_zerocopy_connect(
+	stress_args_t *args,
+	const int port,
+	const char *zerocopy_if,
+	int *rfd)
+{
+	struct sockaddr *addr;
+	socklen_t addr_len;
+	int lfd, sfd, so_reuseaddr = 1;
+
+	lfd = socket(AF_INET, SOCK_STREAM, 0);
+	if (lfd < 0) {
+		pr_fail("%s: socket failed, errno=%d (%s)\n",
+			args->name, errno, strerror(errno));
+		return -1;
+	}
+	(void)setsockopt(lfd, SOL_SOCKET, SO_REUSEADDR, &so_reuseaddr, sizeof(so_reuseaddr));
+	if (stress_set_sockaddr_if(args->name, args->instance, args->pid,
+			AF_INET, port, zerocopy_if, &addr, &addr_len, NET_ADDR_LOOPBACK) < 0) {
+		(void)close(lfd);
+		return -1;
+	}
+	if ((bind(lfd, addr, addr_len) < 0) || (listen(lfd, 1) < 0)) {
+		pr_fail("%s: bind/listen on port %d failed, errno=%d (%s)\n",
+			args->name, port, errno, strerror(errno));
+		(void)close(lfd);
+		return -1;
+	}
+	sfd = socket(AF_INET, SOCK_STREAM, 0);
+	if (sfd < 0) {
+		pr_fail("%s: socket failed, errno=%d (%s)\n",
+			args->name, errno, strerror(errno));
+		(void)close(lfd);
+		return -1;
+	}
+	/* connect completes on the listen backlog */
+	if (connect(sfd, addr, addr_len) < 0) {
+		pr_fail("%s: connect failed, errno=%d (%s)\n",
+			args->name, errno, strerror(errno));
+		(void)close(sfd);
+		(void)close(lfd);
+		return -1;
+	}
+	*rfd = accept(lfd, NULL, NULL);
+	(void)close(lfd);
+	if (*rfd < 0) {
+		pr_fail("%s: accept failed, errno=%d (%s)\n",
+			args->name, errno, strerror(errno));
+		(void)close(sfd);
+		return -1;
+	}
+	return sfd;
+}
+
+/*
+ *  stress_zerocopy_file()
+ *	create and populate the page cache file
+ */
+static int stress_zerocopy_file(stress_args_t *args, const char *filename, const size_t size)
+{
+	uint8_t buf[4096];
+	size_t off;
+	int fd;
+
+	fd = open(filename, O_CREAT | O_RDWR | O_TRUNC, S_IRUSR | S_IWUSR);
+	if (fd < 0) {
+		pr_fail("%s: open %s failed, errno=%d (%s)\n",
+			args->name, filename, errno, strerror(errno));
+		return -1;
+	}
+	(void)shim_unlink(filename);
+	stress_rndbuf(buf, sizeof(buf));
+	for (off = 0; off < size; off += sizeof(buf)) {
+		if (pwrite(fd, buf, sizeof(buf), (off_t)off) < 0) {
+			pr_inf_skip("%s: cannot write %zu byte file, errno=%d (%s), skipping stressor\n",
+				args->name, size, errno, strerror(errno));
+			(void)close(fd);
+			return -1;
+		}
+		if (UNLIKELY(!stress_continue_flag()))
+			break;
+	}
+	return fd;
+}
+
+/*
+ *  stress_zerocopy
+ *	move a page cache file to a connected TCP socket using
+ *	read+send, sendfile, splice, io_uring splice and MSG_ZEROCOPY
+ */
+static int stress_zerocopy(stress_args_t *args)
+{
+	stress_zerocopy_t zc;
+	stress_zerocopy_stats_t stats[NUM_ZEROCOPY_METHODS];
+	uint64_t zerocopy_bytes = DEFAULT_ZEROCOPY_BYTES;
+	size_t zerocopy_method = 0, method, i, idx;
+	int zerocopy_port = DEFAULT_ZEROCOPY_PORT;
+	char *zerocopy_if = NULL;
+	char filename[PATH_MAX];
+	int rc = EXIT_SUCCESS, reserved_port, rfd = -1, cycles_fd = -1, ret;
+	pid_t pid;
+
+	(void)shim_memset(&zc, 0, sizeof(zc));
+	(void)shim_memset(stats, 0, sizeof(stats));
+	zc.args = args;
+	zc.file_fd = -1;
+	zc.sock_fd = -1;
+	zc.pipe_fds[0] = -1;
+	zc.pipe_fds[1] = -1;
+#if defined(STRESS_ZEROCOPY_IO_URING)
+	zc.ring.fd = -1;
+#endif
+
+	if (!stress_get_setting("zerocopy-bytes", &zerocopy_bytes)) {
+		if (g_opt_flags & OPT_FLAGS_MAXIMIZE)
+			zerocopy_bytes = MAX_ZEROCOPY_BYTES;
+		if (g_opt_flags & OPT_FLAGS_MINIMIZE)
+			zerocopy_bytes = MIN_ZEROCOPY_BYTES;
+	}
+	(void)stress_get_setting("zerocopy-method", &zerocopy_method);
+	(void)stress_get_setting("zerocopy-port", &zerocopy_port);
+	(void)stress_get_setting("zerocopy-if", &zerocopy_if);
+	zc.file_size = (size_t)zerocopy_bytes;
+
+	if (zerocopy_if) {
+		struct sockaddr if_addr;
+
+		if (stress_net_interface_exists(zerocopy_if, AF_INET, &if_addr) < 0) {
+			pr_inf("%s: interface '%s' is not enabled for domain '%s', defaulting to using loopback\n",
+				args->name, zerocopy_if, stress_net_domain(AF_INET));
+			zerocopy_if = NULL;
+		}
+	}
+	zerocopy_port += args->instance;
+	if (zerocopy_port > MAX_PORT)
+		zerocopy_port -= (MAX_PORT - MIN_PORT + 1);
+	reserved_port = stress_net_reserve_ports(zerocopy_port, zerocopy_port);
+	if (reserved_port < 0) {
+		pr_inf_skip("%s: cannot reserve port %d, skipping stressor\n",
+			args->name, zerocopy_port);
+		return EXIT_NO_RESOURCE;
+	}
+	zerocopy_port = reserved_port;
+
+	if (stress_sighandler(args->name, SIGPIPE, SIG_IGN, NULL) < 0) {
+		rc = EXIT_NO_RESOURCE;
+		goto release_port;
+	}
+
+	ret = stress_temp_dir_mk_args(args);
+	if (ret < 0) {
+		rc = stress_exit_status(-ret);
+		goto release_port;
+	}
+	(void)stress_temp_filename_args(args, filename, sizeof(filename), stress_mwc32());
+	zc.file_fd = stress_zerocopy_file(args, filename, zc.file_size);
+	if (zc.file_fd < 0) {
+		rc = EXIT_NO_RESOURCE;
+		goto tidy_dir;
+	}
+
+	zc.buf = (uint8_t *)stress_mmap_populate(NULL, ZEROCOPY_CHUNK, PROT_READ | PROT_WRITE,
+		MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (zc.buf == MAP_FAILED) {
+		zc.buf = NULL;
+		pr_inf_skip("%s: cannot mmap %zu byte buffer, skipping stressor\n",
+			args->name, (size_t)ZEROCOPY_CHUNK);
+		rc = EXIT_NO_RESOURCE;
+		goto tidy_file;
+	}
+	stress_set_vma_anon_name(zc.buf, ZEROCOPY_CHUNK, "read-send-buffer");
+
+	zc.file_map = mmap(NULL, zc.file_size, PROT_READ, MAP_SHARED, zc.file_fd, 0);
+	if (zc.file_map == MAP_FAILED)
+		zc.file_map = NULL;
+	if (pipe(zc.pipe_fds) < 0) {
+		zc.pipe_fds[0] = -1;
+		zc.pipe_fds[1] = -1;
+	}
+#if defined(F_SETPIPE_SZ)
+	if (zc.pipe_fds[0] >= 0)
+		(void)fcntl(zc.pipe_fds[1], F_SETPIPE_SZ, ZEROCOPY_CHUNK);
+#endif
+#if defined(STRESS_ZEROCOPY_IO_URING)
+	/* a small ring for linked splice pairs */
+	if (stress_io_uring_init(&zc.ring, 4) < 0)
+		pr_dbg("%s: cannot create io-uring, errno=%d (%s)\n",
+			args->name, errno, strerror(errno));
+#endif
+#if defined(STRESS_ZEROCOPY_CYCLES)
+	cycles_fd = stress_zerocopy_cycles_open();
+#endif
+	if ((cycles_fd < 0) && (args->instance == 0))
+		pr_inf("%s: CPU cycles counter not available, cycles per byte will not be reported\n",
+			args->name);
+
+	zc.sock_fd = stress_zerocopy_connect(args, zerocopy_port, zerocopy_if, &rfd);
+	if (zc.sock_fd < 0) {
+		rc = EXIT_FAILURE;
+		goto tidy_zc;
+	}
+#if defined(STRESS_ZEROCOPY_MSG_ZEROCOPY)
+	{
+		int one = 1;
+
+		if (setsockopt(zc.sock_fd, SOL_SOCKET, SO_ZEROCOPY, &one, sizeof(one)) < 0) {
+			if (zc.file_map)
+				(void)munmap(zc.file_map, zc.file_size);
+			zc.file_map = NULL;
+		}
+	}
+#endif
+
+	for (i = 1; i < NUM_ZEROCOPY_METHODS; i++)
+		stats[i].supported = true;
+
+	stress_set_proc_state(args->name, STRESS_STATE_SYNC_WAIT);
+	stress_sync_start_wait(args);
+	stress_set_proc_state(args->name, STRESS_STATE_RUN);
+again:
+	pid = fork();
+	if (pid < 0) {
+		if (stress_redo_fork(args, errno))
+			goto again;
+		if (UNLIKELY(!stress_continue(args)))
+			goto tidy_sock;
+		pr_err("%s: fork failed, errno=%d (%s)\n",
+			args->name, errno, strerror(errno));
+		rc = EXIT_FAILURE;
+		goto tidy_sock;
+	} else if (pid == 0) {
+		(void)close(zc.sock_fd);
+		stress_zerocopy_drain(rfd);
+	}
+	(void)close(rfd);
+	rfd = -1;
+
+	method = (zerocopy_method == 0) ? 1 : zerocopy_method;
+	do {
+		stress_zerocopy_stats_t *stat = &stats[method];
+		uint64_t c1, c2;
+		double t1, t2;
+		ssize_t n;
+
+		c1 = stress_zerocopy_cycles(cycles_fd);
+		t1 = stress_time_now();
+		n = stress_zerocopy_methods[method].func(&zc);
+		t2 = stress_time_now();
+		c2 = stress_zerocopy_cycles(cycles_fd);
+
+		if (n == ZEROCOPY_UNSUPPORTED) {
+			stat->supported = false;
+			if (args->instance == 0)
+				pr_inf("%s: method %s is not supported%s\n",
+					args->name, stress_zerocopy_methods[method].name,
+					(zerocopy_method == 0) ? ", skipping it" : "");
+			if (zerocopy_method != 0) {
+				rc = EXIT_NOT_IMPLEMENTED;
+				break;
+			}
+		} else if (n < 0) {
+			if (!stress_continue_flag())
+				break;
+			pr_fail("%s: %s failed, errno=%d (%s)\n",
+				args->name, stress_zerocopy_methods[method].name,
+				errno, strerror(errno));
+			rc = EXIT_FAILURE;
+			break;
+		} else {
+			stat->bytes += (double)n;
+			stat->duration += t2 - t1;
+			stat->cycles += c2 - c1;
+			if ((size_t)n == zc.file_size)
+				stress_bogo_inc(args);
+		}
+
+		if (zerocopy_method == 0) {
+			/* rotate through the supported methods */
+			for (i = 0; i < NUM_ZEROCOPY_METHODS - 1; i++) {
+				method = (method % (NUM_ZEROCOPY_METHODS - 1)) + 1;
+				if (stats[method].supported)
+					break;
+			}
+			if (!stats[method].supported) {
+				rc = EXIT_NOT_IMPLEMENTED;
+				break;
+			}
+		}
+	} while (stress_continue(args));
+
+	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
+	(void)shutdown(zc.sock_fd, SHUT_WR);
+	(void)stress_kill_pid_wait(pid, NULL);
+
+	for (idx = 0, i = 1; i < NUM_ZEROCOPY_METHODS; i++) {
+		const stress_zerocopy_stats_t *stat = &stats[i];
+		char desc[64];
+		double rate;
+
+		if ((stat->duration <= 0.0) || (stat->bytes <= 0.0))
+			continue;
+		rate = stat->bytes / stat->duration;
+		(void)snprintf(desc, sizeof(desc), "GB per sec %s", stress_zerocopy_methods[i].name);
+		stress_metrics_set(args, idx++, desc, rate / (double)GB, STRESS_METRIC_HARMONIC_MEAN);
+		if (cycles_fd >= 0) {
+			(void)snprintf(desc, sizeof(desc), "CPU cycles per byte %s", stress_zerocopy_methods[i].name);
+			stress_metrics_set(args, idx++, desc, (double)stat->cycles / stat->bytes,
+				STRESS_METRIC_HARMONIC_MEAN);
+		}
+	}
+	if (zc.zc_completed > 0)
+		stress_metrics_set(args, idx, "% msg-zerocopy sends copied",
+			100.0 * (double)zc.zc_copied / (double)zc.zc_completed,
+			STRESS_METRIC_GEOMETRIC_MEAN);
+
+tidy_sock:
+	if (rfd >= 0)
+		(void)close(rfd);
+	(void)close(zc.sock_fd);
+tidy_zc:
+	if (cycles_fd >= 0)
+		(void)close(cycles_fd);
+#if defined(STRESS_ZEROCOPY_IO_URING)
+	stress_io_uring_deinit(&zc.ring);
+#endif
+	if (zc.pipe_fds[0] >= 0) {
+		(void)close(zc.pipe_fds[0]);
+		(void)close(zc.pipe_fds[1]);
+	}
+	if (zc.file_map)
+		(void)munmap(zc.file_map, zc.file_size);
+	(void)munmap((void *)zc.buf, ZEROCOPY_CHUNK);
+tidy_file:
+	(void)close(zc.file_fd);
+tidy_dir:
+	(void)stress_temp_dir_rm_args(args);
+release_port:
+	stress_net_release_ports(zerocopy_port, zerocopy_port);
+
+	return rc;
+}
+#endif
+
+static const char *stress_zerocopy_method(const size_t i)
+{
+#if defined(AF_INET) &&			\
+    defined(SOCK_STREAM)
+	return (i < NUM_ZEROCOPY_METHODS) ? stress_zerocopy_methods[i].name : NULL;
+#else
+	return (i == 0) ? "all" : NULL;
+#endif
+}
+
+static const stress_opt_t opts[] = {
+	{ OPT_zerocopy_bytes,  "zerocopy-bytes",  TYPE_ID_UINT64_BYTES_VM, MIN_ZEROCOPY_BYTES, MAX_ZEROCOPY_BYTES, NULL },
+	{ OPT_zerocopy_if,     "zerocopy-if",     TYPE_ID_STR, 0, 0, NULL },
+	{ OPT_zerocopy_method, "zerocopy-method", TYPE_ID_SIZE_T_METHOD, 0, 0, stress_zerocopy_method },
+	{ OPT_zerocopy_port,   "zerocopy-port",   TYPE_ID_INT_PORT, MIN_PORT, MAX_PORT, NULL },
+	END_OPT,
+};
+
+#if defined(AF_INET) &&			\
+    defined(SOCK_STREAM)
+const stressor_info_t stress_zerocopy_info = {
+	.stressor = stress_zerocopy,
+	.class = CLASS_NETWORK | CLASS_PIPE_IO | CLASS_OS,
+	.opts = opts,
+	.verify = VERIFY_ALWAYS,
+	.help = help
+};
+#else
+const stressor_info_t stress_zerocopy_info = {
+	.stressor = stress_unimplemented,
+	.class = CLASS_NETWORK | CLASS_PIPE_IO | CLASS_OS,
+	.opts = opts,
+	.verify = VERIFY_ALWAYS,
+	.help = help,
+	.unimplemented_reason = "built without AF_INET stream socket support"
+};
+#endif
@@ -24,6 +24,7 @@
 #include "core-builtin.h"
 #include "core-cpu.h"
 #include "core-killpid.h"
+#include "core-pthread.h"
 #include "core-target-clones.h"
 
 #include <ctype.h>
@@ -35,6 +36,7 @@ static const stress_help_t help[] = {
 	{ NULL,	"zlib-mem-level L",	"specify zlib compression state memory usage 1=minimum, 9=maximum" },
 	{ NULL,	"zlib-method M",	"specify zlib random data generation method M" },
 	{ NULL,	"zlib-ops N",		"stop after N zlib bogo compression operations" },
+	{ NULL,	"zlib-parallel N",	"compress 128K blocks on N threads, sweep levels and data types" },
 	{ NULL,	"zlib-strategy S",	"specify zlib strategy 0=default, 1=filtered, 2=huffman only, 3=rle, 4=fixed" },
 	{ NULL,	"zlib-stream-bytes S",	"specify the number of bytes to deflate until the current stream will be closed" },
 	{ NULL,	"zlib-window-bits W",	"specify zlib window bits -8-(-15) | 8-15 | 24-31 | 40-47" },
@@ -54,6 +56,15 @@ static const stress_help_t help[] = {
 #define ZLIB_MIN_MEM_LEVEL	(1)
 #define ZLIB_MAX_MEM_LEVEL	(9)
 
+#define ZLIB_MIN_PARALLEL	(0)	/* 0 = parallel mode disabled */
+#define ZLIB_MAX_PARALLEL	(256)
+
+#define ZLIB_PAR_BLOCK_SIZE	(KB * 128)	/* pigz default block size */
+#define ZLIB_PAR_DICT_SIZE	(KB * 32)	/* last 32K of previous block */
+#define ZLIB_PAR_BLOCKS		(32)
+#define ZLIB_PAR_DATA_SIZE	(ZLIB_PAR_BLOCK_SIZE * ZLIB_PAR_BLOCKS)
+#define ZLIB_PAR_OUT_SIZE	(ZLIB_PAR_BLOCK_SIZE + (ZLIB_PAR_BLOCK_SIZE >> 3) + 64)
+
 typedef void (*stress_zlib_rand_data_func)(stress_args_t *args,
 	uint64_t *RESTRICT data, uint64_t *RESTRICT data_end);
 
@@ -262,17 +273,9 @@ static void stress_rand_data_binary(
 	uint64_t *RESTRICT data,
 	uint64_t *RESTRICT data_end)
 {
-	register uint32_t *ptr = (uint32_t *)data;
-	register const uint32_t *end = (uint32_t *)data_end;
-
 	(void)args;
 
-	while (ptr < end) {
-		*(ptr++) = stress_mwc32();
-		*(ptr++) = stress_mwc32();
-		*(ptr++) = stress_mwc32();
-		*(ptr++) = stress_mwc32();
-	}
+	stress_mwc_fill(data, (size_t)((uintptr_t)data_end - (uintptr_t)data));
 }
 
 /*
@@ -1360,6 +1363,7 @@ static const stress_opt_t opts[] = {
 	{ OPT_zlib_level,        "zlib-level",        TYPE_ID_UINT32, ZLIB_MIN_COMPRESSION, ZLIB_MAX_COMPRESSION, NULL },
 	{ OPT_zlib_mem_level,    "zlib-mem-level",    TYPE_ID_UINT32, ZLIB_MIN_MEM_LEVEL, ZLIB_MAX_MEM_LEVEL, NULL },
 	{ OPT_zlib_method,       "zlib-method",       TYPE_ID_SIZE_T_METHOD, 0, 0, stress_zlib_method },
+	{ OPT_zlib_parallel,     "zlib-parallel",     TYPE_ID_UINT32, ZLIB_MIN_PARALLEL, ZLIB_MAX_PARALLEL, NULL },
 	{ OPT_zlib_window_bits,  "zlib-window-bits",  TYPE_ID_CALLBACK, 0, 0, stress_zlib_window_bits },
 	{ OPT_zlib_stream_bytes, "zlib-stream-bytes", TYPE_ID_UINT64_BYTES_VM, 0, MAX_MEM_LIMIT, NULL },
 	{ OPT_zlib_strategy,     "zlib-stategy",      TYPE_ID_UINT32, Z_DEFAULT_STRATEGY, Z_FIXED, NULL },
@@ -1741,6 +1745,354 @@ zlib_checksum_error:
 	return ret;
 }
 
+typedef struct {
+	const uint8_t	*in;		/* ZLIB_PAR_BLOCKS blocks of input */
+	uint8_t		*out;		/* ZLIB_PAR_OUT_SIZE per block output */
+	size_t		*out_len;	/* compressed size of each block */
+	int		level;		/* compression level */
+	int		mem_level;	/* zlib memory usage */
+	int		strategy;	/* zlib strategy */
+	size_t		first;		/* first block to compress */
+	size_t		stride;		/* block stride, number of threads */
+	int		zret;		/* zlib error, Z_OK if all good */
+#if defined(HAVE_LIB_PTHREAD)
+	pthread_t	pthread;	/* thread handle */
+#endif
+	int		ret;		/* pthread_create return */
+} stress_zlib_par_thread_t;
+
+typedef struct {
+	double		duration;	/* time compressing and reassembling */
+	double		bytes_in;	/* uncompressed bytes */
+	double		bytes_out;	/* compressed bytes */
+} stress_zlib_par_stats_t;
+
+/*
+ *  data types swept in parallel mode when --zlib-method is random
+ */
+static const char * const zlib_par_methods[] = {
+	"text", "latin", "utf8", "objcode", "binary",
+};
+
+static const int zlib_par_levels[] = { 1, 3, 6, 9 };
+
+/*
+ *  stress_zlib_par_thread()
+ *	compress every stride'th block as a raw deflate stream
+ *	primed with the last 32K of the preceding block and
+ *	ended with a sync flush (the last block is finished)
+ *	so the blocks can be concatenated into one stream
+ */
+static void *stress_zlib_par_thread(void *arg)
+{
+	stress_zlib_par_thread_t *t = (stress_zlib_par_thread_t *)arg;
+	z_stream stream;
+	size_t i;
+
+	(void)shim_memset(&stream, 0, sizeof(stream));
+	t->zret = deflateInit2(&stream, t->level, Z_DEFLATED, -15,
+			t->mem_level, t->strategy);
+	if (t->zret != Z_OK)
+		return &g_nowt;
+
+	for (i = t->first; i < ZLIB_PAR_BLOCKS; i += t->stride) {
+		const bool last = (i == ZLIB_PAR_BLOCKS - 1);
+		const uint8_t *in = t->in + (i * ZLIB_PAR_BLOCK_SIZE);
+
+		if (i > 0) {
+			t->zret = deflateSetDictionary(&stream, in - ZLIB_PAR_DICT_SIZE,
+					ZLIB_PAR_DICT_SIZE);
+			if (t->zret != Z_OK)
+				break;
+		}
+		stream.next_in = (unsigned char *)in;
+		stream.avail_in = ZLIB_PAR_BLOCK_SIZE;
+		stream.next_out = t->out + (i * ZLIB_PAR_OUT_SIZE);
+		stream.avail_out = ZLIB_PAR_OUT_SIZE;
+
+		t->zret = deflate(&stream, last ? Z_FINISH : Z_SYNC_FLUSH);
+		if (t->zret != (last ? Z_STREAM_END : Z_OK)) {
+			t->zret = Z_STREAM_ERROR;
+			break;
+		}
+		if ((stream.avail_in != 0) || (stream.avail_out == 0)) {
+			t->zret = Z_BUF_ERROR;
+			break;
+		}
+		t->out_len[i] = ZLIB_PAR_OUT_SIZE - stream.avail_out;
+		t->zret = deflateReset(&stream);
+		if (t->zret != Z_OK)
+			break;
+	}
+	(void)deflateEnd(&stream);
+	return &g_nowt;
+}
+
+/*
+ *  stress_zlib_par_verify()
+ *	inflate the reassembled stream and compare it to the input
+ */
+static int stress_zlib_par_verify(
+	stress_args_t *args,
+	const uint8_t *stream_buf,
+	const size_t stream_len,
+	const uint8_t *in,
+	uint8_t *check)
+{
+	z_stream stream;
+	int zret;
+
+	(void)shim_memset(&stream, 0, sizeof(stream));
+	zret = inflateInit2(&stream, -15);
+	if (zret != Z_OK) {
+		pr_fail("%s: zlib inflateInit error: %s\n",
+			args->name, stress_zlib_err(zret));
+		return EXIT_FAILURE;
+	}
+	stream.next_in = (unsigned char *)stream_buf;
+	stream.avail_in = (unsigned int)stream_len;
+	stream.next_out = check;
+	stream.avail_out = ZLIB_PAR_DATA_SIZE;
+	zret = inflate(&stream, Z_FINISH);
+	(void)inflateEnd(&stream);
+
+	if (zret != Z_STREAM_END) {
+		pr_fail("%s: zlib inflate of reassembled blocks error: %s\n",
+			args->name, stress_zlib_err(zret));
+		return EXIT_FAILURE;
+	}
+	if ((stream.total_out != ZLIB_PAR_DATA_SIZE) ||
+	    (shim_memcmp(in, check, ZLIB_PAR_DATA_SIZE) != 0)) {
+		pr_fail("%s: zlib inflated reassembled blocks do not match "
+			"the original data\n", args->name);
+		return EXIT_FAILURE;
+	}
+	return EXIT_SUCCESS;
+}
+
+/*
+ *  stress_zlib_par_compress()
+ *	compress ZLIB_PAR_BLOCKS blocks of data over num_threads
+ *	threads and reassemble the compressed blocks in order
+ */
+static int stress_zlib_par_compress(
+	stress_args_t *args,
+	stress_zlib_par_thread_t *threads,
+	const size_t num_threads,
+	uint8_t *stream_buf,
+	size_t *stream_len)
+{
+	size_t i, len = 0;
+	int zret = Z_OK;
+
+	for (i = 0; i < num_threads; i++) {
+		stress_zlib_par_thread_t *t = &threads[i];
+
+		t->first = i;
+		t->stride = num_threads;
+		t->zret = Z_OK;
+#if defined(HAVE_LIB_PTHREAD)
+		/* the first blocks are compressed by the calling thread */
+		t->ret = (i == 0) ? -1 :
+			pthread_create(&t->pthread, NULL, stress_zlib_par_thread, (void *)t);
+#else
+		t->ret = -1;
+#endif
+	}
+	/* compress blocks where threads could not be created */
+	for (i = 0; i < num_threads; i++) {
+		if (threads[i].ret != 0)
+			(void)stress_zlib_par_thread((void *)&threads[i]);
+	}
+#if defined(HAVE_LIB_PTHREAD)
+	for (i = 1; i < num_threads; i++) {
+		if (threads[i].ret == 0)
+			(void)pthread_join(threads[i].pthread, NULL);
+	}
+#endif
+	for (i = 0; i < num_threads; i++) {
+		if (threads[i].zret != Z_OK)
+			zret = threads[i].zret;
+	}
+	if (zret != Z_OK) {
+		pr_fail("%s: zlib parallel block deflate error: %s\n",
+			args->name, stress_zlib_err(zret));
+		return EXIT_FAILURE;
+	}
+
+	for (i = 0; i < ZLIB_PAR_BLOCKS; i++) {
+		(void)shim_memcpy(stream_buf + len,
+			threads[0].out + (i * ZLIB_PAR_OUT_SIZE), threads[0].out_len[i]);
+		len += threads[0].out_len[i];
+	}
+	*stream_len = len;
+
+	return EXIT_SUCCESS;
+}
+
+/*
+ *  stress_zlib_parallel()
+ *	pigz style parallel compression, the input is split into
+ *	128K blocks that are compressed on zlib_parallel threads and
+ *	reassembled in order, sweeping compression levels and data types
+ */
+static int stress_zlib_parallel(stress_args_t *args, const uint32_t zlib_parallel)
+{
+	stress_zlib_par_thread_t *threads;
+	stress_zlib_args_t zlib_args;
+	size_t method_idx[SIZEOF_ARRAY(zlib_par_methods)];
+	int levels[SIZEOF_ARRAY(zlib_par_levels)];
+	stress_zlib_par_stats_t stats[SIZEOF_ARRAY(zlib_par_methods)][SIZEOF_ARRAY(zlib_par_levels)];
+	size_t n_methods, n_levels, i, j, idx;
+	size_t stream_len = 0;
+	const size_t num_threads = (size_t)zlib_parallel;
+	const size_t out_size = ZLIB_PAR_OUT_SIZE * ZLIB_PAR_BLOCKS;
+	const size_t buf_size = ZLIB_PAR_DATA_SIZE + out_size + out_size + ZLIB_PAR_DATA_SIZE;
+	size_t out_len[ZLIB_PAR_BLOCKS];
+	uint8_t *buf, *in, *out, *stream_buf, *check;
+	uint32_t level;
+	int rc = EXIT_SUCCESS;
+	const bool verify = !!(g_opt_flags & OPT_FLAGS_VERIFY);
+
+	(void)stress_zlib_get_args(&zlib_args);
+
+	/* --zlib-method random sweeps a set of data types */
+	if (zlib_args.method == 0) {
+		for (n_methods = 0; n_methods < SIZEOF_ARRAY(zlib_par_methods); n_methods++) {
+			for (i = 1; i < SIZEOF_ARRAY(zlib_rand_data_methods); i++) {
+				if (!strcmp(zlib_rand_data_methods[i].name, zlib_par_methods[n_methods]))
+					break;
+			}
+			method_idx[n_methods] = i;
+		}
+	} else {
+		method_idx[0] = zlib_args.method;
+		n_methods = 1;
+	}
+	/* --zlib-level selects one level, otherwise sweep levels */
+	if (stress_get_setting("zlib-level", &level)) {
+		levels[0] = (int)level;
+		n_levels = 1;
+	} else {
+		for (n_levels = 0; n_levels < SIZEOF_ARRAY(zlib_par_levels); n_levels++)
+			levels[n_levels] = zlib_par_levels[n_levels];
+	}
+	if (zlib_args.window_bits != 15)
+		pr_inf("%s: --zlib-window-bits is ignored in parallel mode, "
+			"using raw deflate with a 32K window\n", args->name);
+
+	threads = (stress_zlib_par_thread_t *)calloc(num_threads, sizeof(*threads));
+	if (!threads) {
+		pr_inf_skip("%s: cannot allocate %zu thread states, skipping stressor\n",
+			args->name, num_threads);
+		return EXIT_NO_RESOURCE;
+	}
+	buf = (uint8_t *)stress_mmap_populate(NULL, buf_size,
+			PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (buf == MAP_FAILED) {
+		pr_inf_skip("%s: cannot mmap %zu bytes for parallel compression "
+			"buffers, skipping stressor\n", args->name, buf_size);
+		free(threads);
+		return EXIT_NO_RESOURCE;
+	}
+	stress_set_vma_anon_name(buf, buf_size, "zlib-parallel");
+	in = buf;
+	out = in + ZLIB_PAR_DATA_SIZE;
+	stream_buf = out + out_size;
+	check = stream_buf + out_size;
+
+	(void)shim_memset(stats, 0, sizeof(stats));
+	(void)shim_memset(out_len, 0, sizeof(out_len));
+
+	if (args->instance == 0)
+		pr_dbg("%s: parallel mode, %zu threads, %d KB blocks, %zu data types, %zu levels\n",
+			args->name, num_threads, (int)(ZLIB_PAR_BLOCK_SIZE / KB), n_methods, n_levels);
+
+	stress_set_proc_state(args->name, STRESS_STATE_SYNC_WAIT);
+	stress_sync_start_wait(args);
+	stress_set_proc_state(args->name, STRESS_STATE_RUN);
+
+	do {
+		for (i = 0; (i < n_methods) && stress_continue(args); i++) {
+			const stress_zlib_method_t *method = &zlib_rand_data_methods[method_idx[i]];
+
+			for (idx = 0; idx < ZLIB_PAR_DATA_SIZE; idx += DATA_SIZE) {
+				method->func(args, (uint64_t *)(void *)(in + idx),
+					(uint64_t *)(void *)(in + idx + DATA_SIZE));
+			}
+
+			for (j = 0; (j < n_levels) && stress_continue(args); j++) {
+				size_t k;
+				double t;
+
+				for (k = 0; k < num_threads; k++) {
+					threads[k].in = in;
+					threads[k].out = out;
+					threads[k].out_len = out_len;
+					threads[k].level = levels[j];
+					threads[k].mem_level = (int)zlib_args.mem_level;
+					threads[k].strategy = (int)zlib_args.strategy;
+				}
+				t = stress_time_now();
+				rc = stress_zlib_par_compress(args, threads, num_threads,
+						stream_buf, &stream_len);
+				stats[i][j].duration += stress_time_now() - t;
+				if (rc != EXIT_SUCCESS)
+					goto tidy;
+				stats[i][j].bytes_in += (double)ZLIB_PAR_DATA_SIZE;
+				stats[i][j].bytes_out += (double)stream_len;
+
+				if (verify) {
+					rc = stress_zlib_par_verify(args, stream_buf, stream_len, in, check);
+					if (rc != EXIT_SUCCESS)
+						goto tidy;
+				}
+				stress_bogo_inc(args);
+			}
+		}
+	} while (stress_continue(args));
+
+	if (args->instance == 0) {
+		pr_block_begin();
+		pr_inf("%s: %zu threads, MB/sec and compressed size %% per level:\n",
+			args->name, num_threads);
+	}
+	for (i = 0, idx = 0; i < n_methods; i++) {
+		const char *name = zlib_rand_data_methods[method_idx[i]].name;
+		char line[128];
+		char *ptr = line;
+
+		*ptr = '\0';
+		for (j = 0; j < n_levels; j++) {
+			const stress_zlib_par_stats_t *st = &stats[i][j];
+			const double rate = (st->duration > 0.0) ? (st->bytes_in / st->duration) / MB : 0.0;
+			const double ratio = (st->bytes_in > 0.0) ? 100.0 * st->bytes_out / st->bytes_in : 0.0;
+			char msg[64];
+
+			(void)snprintf(ptr, sizeof(line) - (size_t)(ptr - line),
+				"  L%d %8.2f %6.2f%%", levels[j], rate, ratio);
+			ptr += strlen(ptr);
+			if (st->bytes_in <= 0.0)
+				continue;
+			(void)snprintf(msg, sizeof(msg), "%s level %d MB/sec", name, levels[j]);
+			stress_metrics_set(args, idx++, msg, rate, STRESS_METRIC_HARMONIC_MEAN);
+			(void)snprintf(msg, sizeof(msg), "%s level %d %% compressed size", name, levels[j]);
+			stress_metrics_set(args, idx++, msg, ratio, STRESS_METRIC_GEOMETRIC_MEAN);
+		}
+		if (args->instance == 0)
+			pr_inf("%s: %-8.8s%s\n", args->name, name, line);
+	}
+	if (args->instance == 0)
+		pr_block_end();
+
+tidy:
+	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
+	(void)munmap((void *)buf, buf_size);
+	free(threads);
+
+	return rc;
+}
+
 /*
  *  stress_zlib()
  *	stress cpu with compression and decompression
@@ -1752,9 +2104,14 @@ static int stress_zlib(stress_args_t *args)
 	bool error = false;
 	bool interrupted = false;
 	stress_zlib_shared_checksums_t *shared_checksums;
+	uint32_t zlib_parallel = 0;
 
 	stress_catch_sigill();
 
+	(void)stress_get_setting("zlib-parallel", &zlib_parallel);
+	if (zlib_parallel > 0)
+		return stress_zlib_parallel(args, zlib_parallel);
+
 	if (stress_sigchld_set_handler(args) < 0)
 		return EXIT_NO_RESOURCE;
 
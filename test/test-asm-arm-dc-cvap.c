@@ -0,0 +1,31 @@
+/*
+ * Copyright (C) 2025 Colin Ian King
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+
+#if defined(__aarch64__)
+int main(void)
+{
+	int a = 0;
+
+	__asm__ __volatile__("dc cvap, %0\n" : : "r" (&a) : "memory");
+
+	return 0;
+}
+#else
+#error not an ARMv8 so no dc cvap instruction
+#endif
@@ -0,0 +1,32 @@
+/*
+ * Copyright (C) 2025 Colin Ian King
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+
+#if defined(__ARM_ARCH_7__)   || defined(__ARM_ARCH_7A__)  || \
+    defined(__ARM_ARCH_7R__)  || defined(__ARM_ARCH_7M__)  || \
+    defined(__ARM_ARCH_7EM__) || defined(__ARM_ARCH_8A__)  || \
+    defined(__aarch64__)
+int main(void)
+{
+	__asm__ __volatile__("dsb sy;\n");
+
+	return 0;
+}
+#else
+#error not an ARM so no dsb instruction
+#endif
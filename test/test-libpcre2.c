@@ -0,0 +1,42 @@
+/*
+ * Copyright (C) 2025      Colin Ian King
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+#define PCRE2_CODE_UNIT_WIDTH	8
+#include <pcre2.h>
+
+int main(void)
+{
+	static const char subject[] = "test123";
+	pcre2_code *code;
+	pcre2_match_data *match_data;
+	PCRE2_SIZE erroffset;
+	int errcode, ret;
+
+	code = pcre2_compile((PCRE2_SPTR)"[0-9]+", PCRE2_ZERO_TERMINATED,
+		PCRE2_MULTILINE, &errcode, &erroffset, NULL);
+	if (!code)
+		return 1;
+	(void)pcre2_jit_compile(code, PCRE2_JIT_COMPLETE);
+	match_data = pcre2_match_data_create_from_pattern(code, NULL);
+	ret = pcre2_jit_match(code, (PCRE2_SPTR)subject, sizeof(subject) - 1,
+		0, 0, match_data, NULL);
+	pcre2_match_data_free(match_data);
+	pcre2_code_free(code);
+
+	return ret;
+}